@@ -27,6 +27,8 @@ LOCAL_SRC_FILES := \
     android/service/main.cpp \
     android/service/daemon.cpp \
     android/service/host_connector.cpp \
+    android/service/memory_pressure_listener.cpp \
+    android/service/frame_statistics_reporter.cpp \
     android/service/local_socket_connection.cpp \
     android/service/message_processor.cpp \
     android/service/activity_manager_interface.cpp \
@@ -34,11 +36,18 @@ LOCAL_SRC_FILES := \
     android/service/platform_service_interface.cpp \
     android/service/platform_service.cpp \
     android/service/platform_api_stub.cpp \
+    android/service/icon_store.cpp \
+    android/service/worker_pool.cpp \
+    src/anbox/bridge/guest_frame_statistics.cpp \
+    src/anbox/bridge/window_state_encoder.cpp \
+    src/anbox/bridge/window_state_frame.cpp \
     src/anbox/common/fd.cpp \
     src/anbox/common/wait_handle.cpp \
+    src/anbox/rpc/framing.cpp \
     src/anbox/rpc/message_processor.cpp \
     src/anbox/rpc/pending_call_cache.cpp \
     src/anbox/rpc/channel.cpp \
+    src/anbox/rpc/send_buffer.cpp \
     src/anbox/protobuf/anbox_rpc.proto \
     src/anbox/protobuf/anbox_bridge.proto
 proto_header_dir := $(call local-generated-sources-dir)/proto/$(LOCAL_PATH)/src/anbox/protobuf
@@ -99,6 +108,7 @@ include $(BUILD_SHARED_LIBRARY)
 TMP_PATH := $(LOCAL_PATH)
 
 include $(TMP_PATH)/android/appmgr/Android.mk
+include $(TMP_PATH)/android/ashmem/Android.mk
 include $(TMP_PATH)/android/fingerprint/Android.mk
 include $(TMP_PATH)/android/power/Android.mk
 include $(TMP_PATH)/android/qemu-props/Android.mk
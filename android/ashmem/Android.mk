@@ -0,0 +1,9 @@
+LOCAL_PATH := $(call my-dir)
+
+# Preloaded into all processes, see init.goldfish.rc
+include $(CLEAR_VARS)
+LOCAL_MODULE := libashmem-memfd
+LOCAL_MODULE_TAGS := optional
+LOCAL_SRC_FILES := ashmem_memfd.c
+LOCAL_SHARED_LIBRARIES := libdl liblog
+include $(BUILD_SHARED_LIBRARY)
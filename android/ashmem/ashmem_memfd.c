@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Compatibility shim for hosts without the ashmem kernel module.
+ *
+ * It gets preloaded into every process of the container and takes over the
+ * ashmem API of libcutils. As long as /dev/ashmem is there all calls go down
+ * to libcutils as usual. Otherwise regions are memfds instead: their size is
+ * fixed by sealing them and protection is reduced by sealing them against
+ * writes. Nothing gets ever purged, so pinning always succeeds and unpinned
+ * regions stay around until the last reference is gone, just like with
+ * newer Android versions.
+ *
+ * Being plain files, memfds can be handed out of the container (e.g. to the
+ * host through the anbox sockets) without any copy either.
+ */
+
+#define LOG_TAG "ashmem-memfd"
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cutils/ashmem.h>
+#include <cutils/log.h>
+
+#ifndef __NR_memfd_create
+#if defined(__x86_64__)
+#define __NR_memfd_create 319
+#elif defined(__i386__)
+#define __NR_memfd_create 356
+#elif defined(__aarch64__)
+#define __NR_memfd_create 279
+#elif defined(__arm__)
+#define __NR_memfd_create 385
+#endif
+#endif
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS (1024 + 9)
+#define F_GET_SEALS (1024 + 10)
+#define F_SEAL_SEAL 0x0001
+#define F_SEAL_SHRINK 0x0002
+#define F_SEAL_GROW 0x0004
+#define F_SEAL_WRITE 0x0008
+#endif
+
+#ifndef F_SEAL_FUTURE_WRITE
+#define F_SEAL_FUTURE_WRITE 0x0010
+#endif
+
+#define ASHMEM_DEVICE "/dev/ashmem"
+
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+static int use_memfd;
+
+static int (*real_create_region)(const char *name, size_t size);
+static int (*real_set_prot_region)(int fd, int prot);
+static int (*real_pin_region)(int fd, size_t offset, size_t len);
+static int (*real_unpin_region)(int fd, size_t offset, size_t len);
+static int (*real_get_size_region)(int fd);
+
+static void init(void)
+{
+    real_create_region = dlsym(RTLD_NEXT, "ashmem_create_region");
+    real_set_prot_region = dlsym(RTLD_NEXT, "ashmem_set_prot_region");
+    real_pin_region = dlsym(RTLD_NEXT, "ashmem_pin_region");
+    real_unpin_region = dlsym(RTLD_NEXT, "ashmem_unpin_region");
+    real_get_size_region = dlsym(RTLD_NEXT, "ashmem_get_size_region");
+
+    use_memfd = access(ASHMEM_DEVICE, R_OK | W_OK) != 0 ||
+                !real_create_region || !real_set_prot_region ||
+                !real_pin_region || !real_unpin_region ||
+                !real_get_size_region;
+}
+
+static int memfd_mode(void)
+{
+    pthread_once(&init_once, init);
+    return use_memfd;
+}
+
+int ashmem_create_region(const char *name, size_t size)
+{
+    int fd;
+
+    if (!memfd_mode())
+        return real_create_region(name, size);
+
+    fd = syscall(__NR_memfd_create, name ? name : "none",
+                 MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        ALOGE("Failed to create memfd for region %s: %s", name,
+              strerror(errno));
+        return fd;
+    }
+
+    /* ashmem regions can't change their size once created either */
+    if (ftruncate(fd, size) < 0 ||
+        fcntl(fd, F_ADD_SEALS, F_SEAL_GROW | F_SEAL_SHRINK) < 0) {
+        int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return -1;
+    }
+
+    return fd;
+}
+
+int ashmem_set_prot_region(int fd, int prot)
+{
+    if (!memfd_mode())
+        return real_set_prot_region(fd, prot);
+
+    if (prot & PROT_WRITE)
+        return 0;
+
+    /*
+     * Only the write protection can be enforced. Unlike a plain write seal
+     * a future write seal works with writable mappings that already exist,
+     * which is what ashmem does too, but it needs Linux 5.1.
+     */
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_FUTURE_WRITE) == 0)
+        return 0;
+    return fcntl(fd, F_ADD_SEALS, F_SEAL_WRITE);
+}
+
+int ashmem_pin_region(int fd, size_t offset, size_t len)
+{
+    if (!memfd_mode())
+        return real_pin_region(fd, offset, len);
+    return ASHMEM_NOT_PURGED;
+}
+
+int ashmem_unpin_region(int fd, size_t offset, size_t len)
+{
+    if (!memfd_mode())
+        return real_unpin_region(fd, offset, len);
+    return 0;
+}
+
+int ashmem_get_size_region(int fd)
+{
+    struct stat st;
+
+    if (!memfd_mode())
+        return real_get_size_region(fd);
+
+    if (fstat(fd, &st) < 0)
+        return -1;
+    return st.st_size;
+}
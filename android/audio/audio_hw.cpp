@@ -22,13 +22,18 @@
 #include <pthread.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <sys/un.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
+#include <atomic>
+
 #include <cutils/log.h>
 #include <cutils/str_parms.h>
 
@@ -58,6 +63,19 @@ struct generic_stream_out {
   struct generic_audio_device *dev;
   audio_devices_t device;
   int fd;
+  // As negotiated with and reported by the Anbox audio server.
+  uint32_t sample_rate;
+  audio_channel_mask_t channel_mask;
+  audio_format_t format;
+  uint32_t latency_ms;
+  size_t buffer_size;
+  // Set when the server lets us write into shared memory instead of the
+  // socket.
+  anbox::audio::SharedRing *ring;
+  size_t ring_mapped_size;
+  // Frames written since the stream was opened. Only updated by the
+  // writer but read without the device lock held.
+  std::atomic<uint64_t> frames_written;
 };
 
 struct generic_stream_in {
@@ -65,10 +83,15 @@ struct generic_stream_in {
   struct generic_audio_device *dev;
   audio_devices_t device;
   int fd;
+  // As negotiated with and reported by the Anbox audio server.
+  uint32_t sample_rate;
+  audio_channel_mask_t channel_mask;
+  size_t buffer_size;
 };
 
 static uint32_t out_get_sample_rate(const struct audio_stream *stream) {
-  return OUT_SAMPLING_RATE;
+  const struct generic_stream_out *out = (const struct generic_stream_out *)stream;
+  return out->sample_rate;
 }
 
 static int out_set_sample_rate(struct audio_stream *stream, uint32_t rate) {
@@ -76,15 +99,18 @@ static int out_set_sample_rate(struct audio_stream *stream, uint32_t rate) {
 }
 
 static size_t out_get_buffer_size(const struct audio_stream *stream) {
-  return OUT_BUFFER_SIZE;
+  const struct generic_stream_out *out = (const struct generic_stream_out *)stream;
+  return out->buffer_size;
 }
 
 static audio_channel_mask_t out_get_channels(const struct audio_stream *stream) {
-  return AUDIO_CHANNEL_OUT_STEREO;
+  const struct generic_stream_out *out = (const struct generic_stream_out *)stream;
+  return out->channel_mask;
 }
 
 static audio_format_t out_get_format(const struct audio_stream *stream) {
-  return AUDIO_FORMAT_PCM_16_BIT;
+  const struct generic_stream_out *out = (const struct generic_stream_out *)stream;
+  return out->format;
 }
 
 static int out_set_format(struct audio_stream *stream, audio_format_t format) {
@@ -164,7 +190,8 @@ static char *out_get_parameters(const struct audio_stream *stream, const char *k
 }
 
 static uint32_t out_get_latency(const struct audio_stream_out *stream) {
-  return OUT_LATENCY_MS;
+  const struct generic_stream_out *out = (const struct generic_stream_out *)stream;
+  return out->latency_ms;
 }
 
 static int out_set_volume(struct audio_stream_out *stream, float left,
@@ -172,21 +199,106 @@ static int out_set_volume(struct audio_stream_out *stream, float left,
   return -ENOSYS;
 }
 
+// Tells the server there is new data in the shared ring.
+static int ring_notify(struct generic_stream_out *out) {
+  const uint32_t write_pos = out->ring->write_pos.load();
+  return write(out->fd, &write_pos, sizeof(write_pos)) == sizeof(write_pos) ? 0 : -EIO;
+}
+
+static ssize_t ring_write(struct generic_stream_out *out, const uint8_t *buffer,
+                          size_t bytes) {
+  anbox::audio::SharedRing *ring = out->ring;
+  const uint32_t size = ring->size;
+  size_t written = 0;
+
+  while (written < bytes) {
+    const uint32_t write_pos = ring->write_pos.load(std::memory_order_relaxed);
+    const uint32_t read_pos = ring->read_pos.load();
+    const uint32_t space = size - (write_pos - read_pos);
+    if (space == 0) {
+      // The server only reads once told so, and then only wakes us up if
+      // it sees us waiting. Checking again after announcing that we wait
+      // makes sure we don't miss it consuming in between.
+      if (ring_notify(out) < 0)
+        return -EIO;
+      ring->writer_waiting.store(1);
+      if (ring->read_pos.load() == read_pos) {
+        uint32_t server_pos;
+        if (read(out->fd, &server_pos, sizeof(server_pos)) <= 0) {
+          ring->writer_waiting.store(0);
+          return -EIO;
+        }
+      }
+      ring->writer_waiting.store(0);
+      continue;
+    }
+
+    const uint32_t offset = write_pos & (size - 1);
+    size_t chunk = bytes - written;
+    if (chunk > space)
+      chunk = space;
+    if (chunk > size - offset)
+      chunk = size - offset;
+    memcpy(ring->data() + offset, buffer + written, chunk);
+    ring->write_pos.store(write_pos + chunk);
+    written += chunk;
+  }
+
+  if (ring_notify(out) < 0)
+    return -EIO;
+  return written;
+}
+
 static ssize_t out_write(struct audio_stream_out *stream, const void *buffer,
                          size_t bytes) {
   struct generic_stream_out *out = (struct generic_stream_out *)stream;
   struct generic_audio_device *adev = out->dev;
 
   pthread_mutex_lock(&adev->lock);
-  if (out->fd >= 0)
-    bytes = write(out->fd, buffer, bytes);
+  ssize_t written = bytes;
+  if (out->fd >= 0 && out->ring)
+    written = ring_write(out, (const uint8_t *)buffer, bytes);
+  else if (out->fd >= 0)
+    written = write(out->fd, buffer, bytes);
+  if (written > 0)
+    out->frames_written.fetch_add(written / audio_stream_out_frame_size(stream));
   pthread_mutex_unlock(&adev->lock);
-  return bytes;
+  return written;
+}
+
+// Frames the host has played by now. Everything written is still queued
+// in the ring until the server takes it and then sits in the host sink
+// for its latency which is what the server reported minus the ring.
+static uint64_t out_presented_frames(const struct generic_stream_out *out) {
+  const size_t frame_size = audio_stream_out_frame_size(&out->stream);
+  uint64_t queued = (uint64_t)out->latency_ms * out->sample_rate / 1000;
+  if (out->ring) {
+    const uint32_t ring_frames = out->ring->size / frame_size;
+    queued = queued > ring_frames ? queued - ring_frames : 0;
+    queued += (out->ring->write_pos.load() - out->ring->read_pos.load()) / frame_size;
+  }
+
+  const uint64_t written = out->frames_written.load();
+  return written > queued ? written - queued : 0;
 }
 
 static int out_get_render_position(const struct audio_stream_out *stream,
                                    uint32_t *dsp_frames) {
-  return -ENOSYS;
+  const struct generic_stream_out *out = (const struct generic_stream_out *)stream;
+  if (!dsp_frames)
+    return -EINVAL;
+  *dsp_frames = (uint32_t)out_presented_frames(out);
+  return 0;
+}
+
+static int out_get_presentation_position(const struct audio_stream_out *stream,
+                                         uint64_t *frames, struct timespec *timestamp) {
+  const struct generic_stream_out *out = (const struct generic_stream_out *)stream;
+  if (!frames || !timestamp)
+    return -EINVAL;
+  clock_gettime(CLOCK_MONOTONIC, timestamp);
+  *frames = out_presented_frames(out);
+  return 0;
 }
 
 static int out_add_audio_effect(const struct audio_stream *stream, effect_handle_t effect) {
@@ -203,7 +315,8 @@ static int out_get_next_write_timestamp(const struct audio_stream_out *stream,
 }
 
 static uint32_t in_get_sample_rate(const struct audio_stream *stream) {
-  return IN_SAMPLING_RATE;
+  const struct generic_stream_in *in = (const struct generic_stream_in *)stream;
+  return in->sample_rate;
 }
 
 static int in_set_sample_rate(struct audio_stream *stream, uint32_t rate) {
@@ -211,11 +324,13 @@ static int in_set_sample_rate(struct audio_stream *stream, uint32_t rate) {
 }
 
 static size_t in_get_buffer_size(const struct audio_stream *stream) {
-  return IN_BUFFER_SIZE;
+  const struct generic_stream_in *in = (const struct generic_stream_in *)stream;
+  return in->buffer_size;
 }
 
 static audio_channel_mask_t in_get_channels(const struct audio_stream *stream) {
-  return AUDIO_CHANNEL_IN_MONO;
+  const struct generic_stream_in *in = (const struct generic_stream_in *)stream;
+  return in->channel_mask;
 }
 
 static audio_format_t in_get_format(const struct audio_stream *stream) {
@@ -308,15 +423,27 @@ static ssize_t in_read(struct audio_stream_in *stream, void *buffer,
   struct generic_stream_in *in = (struct generic_stream_in *)stream;
   struct generic_audio_device *adev = in->dev;
 
+  // The server sends whole chunks but they may still arrive in pieces
+  // and the framework expects its buffer to be filled.
+  ssize_t ret = 0;
   pthread_mutex_lock(&adev->lock);
-  if (in->fd >= 0)
-    bytes = read(in->fd, buffer, bytes);
-  if (adev->mic_mute && (bytes > 0)) {
-    memset(buffer, 0, bytes);
+  while (in->fd >= 0 && ret < (ssize_t)bytes) {
+    const ssize_t count = read(in->fd, (uint8_t *)buffer + ret, bytes - ret);
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count <= 0) {
+      if (ret == 0)
+        ret = count < 0 ? -errno : -EIO;
+      break;
+    }
+    ret += count;
+  }
+  if (adev->mic_mute && (ret > 0)) {
+    memset(buffer, 0, ret);
   }
   pthread_mutex_unlock(&adev->lock);
 
-  return bytes;
+  return ret;
 }
 
 static uint32_t in_get_input_frames_lost(struct audio_stream_in *stream) {
@@ -331,7 +458,9 @@ static int in_remove_audio_effect(const struct audio_stream *stream, effect_hand
   return 0;
 }
 
-static int connect_audio_server(const anbox::audio::ClientInfo::Type &type) {
+// Sends |client_info| to the server which answers with the format it
+// accepted in its place.
+static int connect_audio_server(anbox::audio::ClientInfo *client_info) {
   int fd = socket(AF_LOCAL, SOCK_STREAM, 0);
   if (fd < 0)
     return -errno;
@@ -349,26 +478,72 @@ static int connect_audio_server(const anbox::audio::ClientInfo::Type &type) {
   // We will send out client type information to the server and the
   // server will either deny the request by closing the connection
   // or by sending us the approved client details back.
-  anbox::audio::ClientInfo client_info{type};
-  if (::write(fd, &client_info, sizeof(client_info)) < 0) {
+  if (::write(fd, client_info, sizeof(*client_info)) < 0) {
     close(fd);
     return -EIO;
   }
 
-  auto bytes_read = ::read(fd, &client_info, sizeof(client_info));
-  if (bytes_read < 0) {
+  auto bytes_read = ::read(fd, client_info, sizeof(*client_info));
+  if (bytes_read != sizeof(*client_info)) {
     close(fd);
     return -EIO;
   }
 
-  // FIXME once we have real client details we need to check if we
-  // got everything we need or if anything is missing.
-
   ALOGE("Successfully connected Anbox audio server");
 
   return fd;
 }
 
+// Receives the memory the server shares with us and maps it.
+static anbox::audio::SharedRing *receive_ring(int fd, size_t *mapped_size) {
+  char dummy = 0;
+  struct iovec iov;
+  iov.iov_base = &dummy;
+  iov.iov_len = sizeof(dummy);
+
+  char control[CMSG_SPACE(sizeof(int))];
+  memset(control, 0, sizeof(control));
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  if (recvmsg(fd, &msg, MSG_WAITALL) <= 0)
+    return NULL;
+
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+    return NULL;
+
+  int memory_fd = -1;
+  memcpy(&memory_fd, CMSG_DATA(cmsg), sizeof(memory_fd));
+
+  struct stat st;
+  if (fstat(memory_fd, &st) != 0 || (size_t)st.st_size < sizeof(anbox::audio::SharedRing)) {
+    close(memory_fd);
+    return NULL;
+  }
+
+  void *addr = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, memory_fd, 0);
+  close(memory_fd);
+  if (addr == MAP_FAILED)
+    return NULL;
+
+  anbox::audio::SharedRing *ring = (anbox::audio::SharedRing *)addr;
+  const uint32_t size = ring->size;
+  if (size == 0 || (size & (size - 1)) != 0 ||
+      sizeof(anbox::audio::SharedRing) + size > (size_t)st.st_size) {
+    munmap(addr, st.st_size);
+    return NULL;
+  }
+
+  *mapped_size = st.st_size;
+  return ring;
+}
+
 static int adev_open_output_stream(struct audio_hw_device *dev,
                                    audio_io_handle_t handle,
                                    audio_devices_t devices,
@@ -379,6 +554,7 @@ static int adev_open_output_stream(struct audio_hw_device *dev,
   struct generic_audio_device *adev = (struct generic_audio_device *)dev;
   struct generic_stream_out *out;
   int ret = 0, fd = 0;
+  bool shared_memory = false;
 
   pthread_mutex_lock(&adev->lock);
   if (adev->output != NULL) {
@@ -386,27 +562,74 @@ static int adev_open_output_stream(struct audio_hw_device *dev,
     goto error;
   }
 
-  fd = connect_audio_server(anbox::audio::ClientInfo::Type::Playback);
-  if (fd < 0) {
-    ret = fd;
-    ALOGE("Failed to connect with Anbox audio servers (err %d)", ret);
-    goto error;
-  }
+  {
+    // The host plays what the mixer produces when it can so that nobody
+    // has to resample. Everything else it replaces with a format it
+    // can play which we suggest to the framework to retry with.
+    anbox::audio::ClientInfo requested;
+    memset(&requested, 0, sizeof(requested));
+    requested.type = anbox::audio::ClientInfo::Type::Playback;
+    requested.flags = anbox::audio::ClientInfo::SharedMemory;
+    requested.format = config->format == AUDIO_FORMAT_PCM_FLOAT ?
+        anbox::audio::ClientInfo::Format::Float : anbox::audio::ClientInfo::Format::S16;
+    requested.channels = audio_channel_count_from_out_mask(config->channel_mask);
+    requested.sample_rate = config->sample_rate > 0 ? config->sample_rate : OUT_SAMPLING_RATE;
+
+    anbox::audio::ClientInfo accepted = requested;
+    fd = connect_audio_server(&accepted);
+    if (fd < 0) {
+      ret = fd;
+      ALOGE("Failed to connect with Anbox audio servers (err %d)", ret);
+      goto error;
+    }
 
-  if ((config->format != AUDIO_FORMAT_PCM_16_BIT) ||
-      (config->channel_mask != AUDIO_CHANNEL_OUT_STEREO) ||
-      (config->sample_rate != OUT_SAMPLING_RATE)) {
-    ALOGE("Error opening output stream format %d, channel_mask %04x, sample_rate %u",
-          config->format, config->channel_mask, config->sample_rate);
-    config->format = AUDIO_FORMAT_PCM_16_BIT;
-    config->channel_mask = AUDIO_CHANNEL_OUT_STEREO;
-    config->sample_rate = OUT_SAMPLING_RATE;
-    ret = -EINVAL;
-    goto error;
+    const audio_format_t format = accepted.format == anbox::audio::ClientInfo::Format::Float ?
+        AUDIO_FORMAT_PCM_FLOAT : AUDIO_FORMAT_PCM_16_BIT;
+    const audio_channel_mask_t channel_mask = audio_channel_out_mask_from_count(accepted.channels);
+    if (format != config->format || channel_mask != config->channel_mask ||
+        accepted.sample_rate != config->sample_rate) {
+      ALOGE("Error opening output stream format %d, channel_mask %04x, sample_rate %u",
+            config->format, config->channel_mask, config->sample_rate);
+      close(fd);
+      config->format = format;
+      config->channel_mask = channel_mask;
+      config->sample_rate = accepted.sample_rate;
+      ret = -EINVAL;
+      goto error;
+    }
+    shared_memory = (accepted.flags & anbox::audio::ClientInfo::SharedMemory) != 0;
   }
 
   out = (struct generic_stream_out *)calloc(1, sizeof(struct generic_stream_out));
   out->fd = fd;
+  out->sample_rate = config->sample_rate;
+  out->channel_mask = config->channel_mask;
+  out->format = config->format;
+  out->latency_ms = OUT_LATENCY_MS;
+  out->buffer_size = OUT_BUFFER_SIZE;
+
+  {
+    // The server tells us about its buffering right after approving us.
+    anbox::audio::StreamInfo stream_info;
+    if (::read(fd, &stream_info, sizeof(stream_info)) == sizeof(stream_info)) {
+      if (stream_info.latency_ms > 0)
+        out->latency_ms = stream_info.latency_ms;
+      if (stream_info.period_size > 0)
+        out->buffer_size = stream_info.period_size;
+    }
+  }
+
+  if (shared_memory) {
+    // Followed by the memory we write into from now on.
+    out->ring = receive_ring(fd, &out->ring_mapped_size);
+    if (!out->ring) {
+      ALOGE("Failed to set up shared memory with the Anbox audio server");
+      close(fd);
+      free(out);
+      ret = -EIO;
+      goto error;
+    }
+  }
 
   out->stream.common.get_sample_rate = out_get_sample_rate;
   out->stream.common.set_sample_rate = out_set_sample_rate;
@@ -424,6 +647,7 @@ static int adev_open_output_stream(struct audio_hw_device *dev,
   out->stream.set_volume = out_set_volume;
   out->stream.write = out_write;
   out->stream.get_render_position = out_get_render_position;
+  out->stream.get_presentation_position = out_get_presentation_position;
   out->stream.get_next_write_timestamp = out_get_next_write_timestamp;
 
   out->dev = adev;
@@ -443,6 +667,11 @@ static void adev_close_output_stream(struct audio_hw_device *dev,
 
   pthread_mutex_lock(&adev->lock);
   if (stream == adev->output) {
+    struct generic_stream_out *out = (struct generic_stream_out *)stream;
+    if (out->ring)
+      munmap(out->ring, out->ring_mapped_size);
+    if (out->fd >= 0)
+      close(out->fd);
     free(stream);
     adev->output = NULL;
   }
@@ -507,7 +736,9 @@ static int adev_get_mic_mute(const struct audio_hw_device *dev, bool *state) {
 
 static size_t adev_get_input_buffer_size(const struct audio_hw_device *dev,
                                          const struct audio_config *config) {
-  return IN_BUFFER_SIZE;
+  // 20 ms, what we ask the server for by default.
+  return config->sample_rate / 50 * audio_channel_count_from_in_mask(config->channel_mask) *
+         sizeof(int16_t);
 }
 
 static int adev_open_input_stream(struct audio_hw_device *dev,
@@ -528,27 +759,54 @@ static int adev_open_input_stream(struct audio_hw_device *dev,
     goto error;
   }
 
-  if ((config->format != AUDIO_FORMAT_PCM_16_BIT) ||
-      (config->channel_mask != AUDIO_CHANNEL_IN_MONO) ||
-      (config->sample_rate != IN_SAMPLING_RATE)) {
-    ALOGE("Error opening input stream format %d, channel_mask %04x, sample_rate %u",
-          config->format, config->channel_mask, config->sample_rate);
+  if (config->format != AUDIO_FORMAT_PCM_16_BIT) {
+    ALOGE("Error opening input stream format %d", config->format);
     config->format = AUDIO_FORMAT_PCM_16_BIT;
-    config->channel_mask = AUDIO_CHANNEL_IN_MONO;
-    config->sample_rate = IN_SAMPLING_RATE;
     ret = -EINVAL;
     goto error;
   }
 
-  fd = connect_audio_server(anbox::audio::ClientInfo::Type::Recording);
-  if (fd < 0) {
-    ret = fd;
-    ALOGE("Failed to connect with Anbox audio servers (err %d)", ret);
-    goto error;
+  {
+    // Like for playback the server records in the format we ask for if
+    // it can and suggests one otherwise.
+    anbox::audio::ClientInfo accepted;
+    memset(&accepted, 0, sizeof(accepted));
+    accepted.type = anbox::audio::ClientInfo::Type::Recording;
+    accepted.format = anbox::audio::ClientInfo::Format::S16;
+    accepted.channels = audio_channel_count_from_in_mask(config->channel_mask);
+    accepted.sample_rate = config->sample_rate > 0 ? config->sample_rate : IN_SAMPLING_RATE;
+
+    fd = connect_audio_server(&accepted);
+    if (fd < 0) {
+      ret = fd;
+      ALOGE("Failed to connect with Anbox audio servers (err %d)", ret);
+      goto error;
+    }
+
+    const audio_channel_mask_t channel_mask = audio_channel_in_mask_from_count(accepted.channels);
+    if (channel_mask != config->channel_mask || accepted.sample_rate != config->sample_rate) {
+      ALOGE("Error opening input stream channel_mask %04x, sample_rate %u",
+            config->channel_mask, config->sample_rate);
+      close(fd);
+      config->channel_mask = channel_mask;
+      config->sample_rate = accepted.sample_rate;
+      ret = -EINVAL;
+      goto error;
+    }
   }
 
   in = (struct generic_stream_in *)calloc(1, sizeof(struct generic_stream_in));
   in->fd = fd;
+  in->sample_rate = config->sample_rate;
+  in->channel_mask = config->channel_mask;
+  in->buffer_size = IN_BUFFER_SIZE;
+
+  {
+    anbox::audio::StreamInfo stream_info;
+    if (::read(fd, &stream_info, sizeof(stream_info)) == sizeof(stream_info) &&
+        stream_info.period_size > 0)
+      in->buffer_size = stream_info.period_size;
+  }
 
   in->stream.common.get_sample_rate = in_get_sample_rate;
   in->stream.common.set_sample_rate = in_set_sample_rate;
@@ -583,6 +841,10 @@ static void adev_close_input_stream(struct audio_hw_device *dev,
 
   pthread_mutex_lock(&adev->lock);
   if (stream == adev->input) {
+    // Lets the server know it can stop recording.
+    struct generic_stream_in *in = (struct generic_stream_in *)stream;
+    if (in->fd >= 0)
+      close(in->fd);
     free(stream);
     adev->input = NULL;
   }
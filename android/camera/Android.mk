@@ -37,6 +37,7 @@ emulator_camera_shared_libraries := \
 emulator_camera_c_includes := external/jpeg \
 	frameworks/native/include/media/hardware \
 	$(LOCAL_PATH)/../opengl/system/OpenglSystemCommon \
+	$(LOCAL_PATH)/../../src \
 	$(call include-path-for, camera)
 
 emulator_camera_src := \
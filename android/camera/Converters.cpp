@@ -21,6 +21,8 @@
 #define LOG_NDEBUG 0
 #define LOG_TAG "EmulatedCamera_Converter"
 #include <cutils/log.h>
+/* Before the color macros of Converters.h can get in its way. */
+#include "anbox/camera/yuv_rows.h"
 #include "Converters.h"
 
 namespace android {
@@ -63,25 +65,15 @@ static void _YUV420SToRGB32(const uint8_t* Y,
                             int width,
                             int height)
 {
-    const uint8_t* U_pos = U;
-    const uint8_t* V_pos = V;
+    /* Chroma rows are shared by two rows of pixels. */
+    const int uv_stride = (width / 2) * dUV;
+    uint8_t* out = reinterpret_cast<uint8_t*>(rgb);
 
     for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x += 2, U += dUV, V += dUV) {
-            const uint8_t nU = *U;
-            const uint8_t nV = *V;
-            *rgb = YUVToRGB32(*Y, nU, nV);
-            Y++; rgb++;
-            *rgb = YUVToRGB32(*Y, nU, nV);
-            Y++; rgb++;
-        }
-        if (y & 0x1) {
-            U_pos = U;
-            V_pos = V;
-        } else {
-            U = U_pos;
-            V = V_pos;
-        }
+        anbox::camera::yuv_row_to_rgb32(Y + y * width,
+                                        U + (y / 2) * uv_stride,
+                                        V + (y / 2) * uv_stride,
+                                        dUV, out + y * width * 4, width);
     }
 }
 
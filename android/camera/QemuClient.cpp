@@ -22,6 +22,9 @@
 #define LOG_NDEBUG 1
 #define LOG_TAG "EmulatedCamera_QemuClient"
 #include <cutils/log.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include "EmulatedCamera.h"
 #include "QemuClient.h"
 
@@ -432,15 +435,22 @@ const char CameraQemuClient::mQueryStart[]      = "start";
 const char CameraQemuClient::mQueryStop[]       = "stop";
 /* Get next video frame from the camera device. */
 const char CameraQemuClient::mQueryFrame[]      = "frame";
+/* Get the memory frames are shared through. */
+const char CameraQemuClient::mQueryRing[]       = "ring";
 
 CameraQemuClient::CameraQemuClient()
-    : QemuClient()
+    : QemuClient(),
+      mRing(NULL),
+      mRingSize(0),
+      mSlotSize(0),
+      mVideoSize(0),
+      mPreviewSize(0)
 {
 }
 
 CameraQemuClient::~CameraQemuClient()
 {
-
+    releaseRing();
 }
 
 status_t CameraQemuClient::queryConnect()
@@ -484,13 +494,92 @@ status_t CameraQemuClient::queryStart(uint32_t pixel_format,
     ALOGE_IF(res != NO_ERROR, "%s: Query failed: %s",
             __FUNCTION__, query.mReplyData ? query.mReplyData :
                                              "No error message");
+    if (res == NO_ERROR && queryRing() != NO_ERROR) {
+        ALOGW("%s: Receiving frames through the pipe", __FUNCTION__);
+    }
     return res;
 }
 
+status_t CameraQemuClient::queryRing()
+{
+    ALOGV("%s", __FUNCTION__);
+
+    releaseRing();
+
+    QemuQuery query(mQueryRing);
+    doQuery(&query);
+    status_t res = query.getCompletionStatus();
+    size_t slots = 0;
+    if (res != NO_ERROR || query.mReplyData == NULL ||
+        sscanf(query.mReplyData, "slots=%zu size=%zu video=%zu preview=%zu",
+               &slots, &mSlotSize, &mVideoSize, &mPreviewSize) != 4 ||
+        mVideoSize + mPreviewSize > mSlotSize) {
+        ALOGE("%s: Query failed: %s", __FUNCTION__,
+             query.mReplyData ? query.mReplyData : "No error message");
+        return res != NO_ERROR ? res : EINVAL;
+    }
+
+    /* The memory follows the reply, attached to a single byte. */
+    char dummy = 0;
+    struct iovec iov;
+    iov.iov_base = &dummy;
+    iov.iov_len = sizeof(dummy);
+
+    char control[CMSG_SPACE(sizeof(int))];
+    memset(control, 0, sizeof(control));
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    if (recvmsg(mPipeFD, &msg, MSG_WAITALL) <= 0) {
+        ALOGE("%s: Unable to receive frame memory: %s", __FUNCTION__,
+             strerror(errno));
+        return errno ? errno : EIO;
+    }
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET ||
+        cmsg->cmsg_type != SCM_RIGHTS) {
+        ALOGE("%s: No frame memory attached", __FUNCTION__);
+        return EIO;
+    }
+
+    int memory_fd = -1;
+    memcpy(&memory_fd, CMSG_DATA(cmsg), sizeof(memory_fd));
+
+    const size_t size = slots * mSlotSize;
+    void* addr = mmap(NULL, size, PROT_READ, MAP_SHARED, memory_fd, 0);
+    close(memory_fd);
+    if (addr == MAP_FAILED) {
+        ALOGE("%s: Unable to map %zu bytes of frame memory: %s", __FUNCTION__,
+             size, strerror(errno));
+        return errno ? errno : EIO;
+    }
+
+    mRing = reinterpret_cast<uint8_t*>(addr);
+    mRingSize = size;
+    return NO_ERROR;
+}
+
+void CameraQemuClient::releaseRing()
+{
+    if (mRing != NULL) {
+        munmap(mRing, mRingSize);
+        mRing = NULL;
+        mRingSize = 0;
+    }
+}
+
 status_t CameraQemuClient::queryStop()
 {
     ALOGV("%s", __FUNCTION__);
 
+    releaseRing();
+
     QemuQuery query(mQueryStop);
     doQuery(&query);
     const status_t res = query.getCompletionStatus();
@@ -516,6 +605,10 @@ status_t CameraQemuClient::queryFrame(void* vframe,
              mQueryFrame, (vframe && vframe_size) ? vframe_size : 0,
              (pframe && pframe_size) ? pframe_size : 0, r_scale, g_scale, b_scale,
              exposure_comp);
+    if (mRing != NULL) {
+        /* Only ask for the slot the frames are in. */
+        strncat(query_str, " shm", sizeof(query_str) - strlen(query_str) - 1);
+    }
     QemuQuery query(query_str);
     doQuery(&query);
     const status_t res = query.getCompletionStatus();
@@ -526,6 +619,27 @@ status_t CameraQemuClient::queryFrame(void* vframe,
         return res;
     }
 
+    if (mRing != NULL) {
+        /* The service leaves the slot alone until we query the next frame
+         * and has checked the frame sizes against the started ones. */
+        size_t slot = 0;
+        if (query.mReplyData == NULL ||
+            sscanf(query.mReplyData, "slot=%zu", &slot) != 1 ||
+            (slot + 1) * mSlotSize > mRingSize) {
+            ALOGE("%s: Invalid frame slot: %s", __FUNCTION__,
+                 query.mReplyData ? query.mReplyData : "No slot");
+            return EINVAL;
+        }
+        const uint8_t* frame = mRing + slot * mSlotSize;
+        if (vframe != NULL && vframe_size != 0) {
+            memcpy(vframe, frame, vframe_size);
+        }
+        if (pframe != NULL && pframe_size != 0) {
+            memcpy(pframe, frame + mVideoSize, pframe_size);
+        }
+        return NO_ERROR;
+    }
+
     /* Copy requested frames. */
     size_t cur_offset = 0;
     const uint8_t* frame = reinterpret_cast<const uint8_t*>(query.mReplyData);
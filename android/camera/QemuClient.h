@@ -415,6 +415,30 @@ public:
                         float b_scale,
                         float exposure_comp);
 
+private:
+    /* Asks the service for the memory it captures frames into, so that frame
+     * queries only need to tell which slot of it to read. Without it frames
+     * are sent through the pipe.
+     * Return:
+     *  NO_ERROR on success, or an appropriate error status on failure.
+     */
+    status_t queryRing();
+
+    /* Unmaps the memory received with queryRing(). */
+    void releaseRing();
+
+    /****************************************************************************
+     * Data members
+     ***************************************************************************/
+
+    /* Frame memory shared with the service, NULL if frames come through the
+     * pipe. Each slot holds a video frame followed by a preview frame. */
+    uint8_t*    mRing;
+    size_t      mRingSize;
+    size_t      mSlotSize;
+    size_t      mVideoSize;
+    size_t      mPreviewSize;
+
     /****************************************************************************
      * Names of the queries available for the emulated camera.
      ***************************************************************************/
@@ -430,6 +454,8 @@ private:
     static const char mQueryStop[];
     /* Query frame(s). */
     static const char mQueryFrame[];
+    /* Query memory frames are shared through. */
+    static const char mQueryRing[];
 };
 
 }; /* namespace android */
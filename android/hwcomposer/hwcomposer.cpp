@@ -23,6 +23,11 @@
 #include <algorithm>
 #include <string>
 
+#include <errno.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
 #define LOG_NDEBUG 1
 #include <cutils/log.h>
 
@@ -69,8 +74,25 @@ struct HwcContext {
     bool framebuffer_visible;
     size_t first_overlay;
     size_t num_overlays;
+
+    // Vsync events are generated by our own thread but aligned to the
+    // refresh cycle of the host display which we query from the host.
+    const hwc_procs_t* procs;
+    pthread_t vsync_thread;
+    pthread_mutex_t vsync_lock;
+    pthread_cond_t vsync_cond;
+    bool vsync_enabled;
+    bool vsync_thread_running;
 };
 
+// Used until the host told us about the refresh rate of its display.
+static const int64_t default_vsync_period = 1000000000 / 60;
+// Nanoseconds after which we synchronize period and phase with the host
+// again. Besides not drifting away from its display this picks up when
+// the host slows vsync down while no window needs frames at the display
+// rate, or speeds it up again once one does.
+static const int64_t vsync_resync_interval = 250000000;
+
 static void dump_layer(hwc_layer_1_t const* l) {
     ALOGD("\tname='%s', type=%d, flags=%08x, handle=%p, tr=%02x, blend=%04x, {%d,%d,%d,%d}, {%d,%d,%d,%d}",
             l->name, l->compositionType, l->flags, l->handle, l->transform, l->blending,
@@ -141,6 +163,10 @@ static int hwc_prepare(hwc_composer_device_1_t* dev, size_t numDisplays,
  * We're using "implicit" synchronization, so make sure we aren't passing any
  * sync object descriptors around.
  */
+// Fence fds need a sync driver the container doesn't give us, so none of
+// them are ever signaled by us. Nothing is lost by dropping them: the host
+// orders the writes into a color buffer against its composition with fences
+// of its own and only then lets the next write go ahead.
 static void check_sync_fds(size_t numDisplays, hwc_display_contents_1_t** displays)
 {
     unsigned int i, j;
@@ -166,20 +192,107 @@ static void check_sync_fds(size_t numDisplays, hwc_display_contents_1_t** displa
     }
 }
 
+// The host rejects longer names.
+static const size_t maxLayerNameLength = 255;
+
+// A layer as rcPostLayers takes it. Each one is followed by its zero
+// terminated name padded to a multiple of four bytes.
+//
+// NOTE: If you modify this struct you have to modify the version on the
+// host side too. See src/anbox/graphics/posted_layers.h
+struct PostedLayer {
+    uint32_t colorBuffer;
+    int32_t sourceCrop[4];
+    int32_t displayFrame[4];
+    uint32_t transform;
+    uint32_t blending;
+    uint32_t planeAlpha;
+    uint32_t nameSize;
+};
+
+static void append_layer(std::vector<uint8_t>& data, const hwc_layer_1_t* layer,
+                         uint32_t colorBuffer) {
+    PostedLayer record;
+    record.colorBuffer = colorBuffer;
+    record.sourceCrop[0] = layer->sourceCrop.left;
+    record.sourceCrop[1] = layer->sourceCrop.top;
+    record.sourceCrop[2] = layer->sourceCrop.right;
+    record.sourceCrop[3] = layer->sourceCrop.bottom;
+    record.displayFrame[0] = layer->displayFrame.left;
+    record.displayFrame[1] = layer->displayFrame.top;
+    record.displayFrame[2] = layer->displayFrame.right;
+    record.displayFrame[3] = layer->displayFrame.bottom;
+    record.transform = layer->transform;
+    record.blending = layer->blending;
+    record.planeAlpha = layer->planeAlpha;
+    const size_t nameLength = std::min<size_t>(strlen(layer->name), maxLayerNameLength);
+    record.nameSize = nameLength + 1;
+
+    // Comes zeroed which terminates the name and fills the padding.
+    const size_t offset = data.size();
+    data.resize(offset + sizeof(record) + ((record.nameSize + 3) & ~3u), 0);
+    memcpy(&data[offset], &record, sizeof(record));
+    memcpy(&data[offset + sizeof(record)], layer->name, nameLength);
+}
+
+// Whether |layer| replaces whatever is below it in its display frame.
+static bool is_opaque(const hwc_layer_1_t* layer) {
+    return layer->blending == HWC_BLENDING_NONE && layer->planeAlpha == 0xff;
+}
+
+static bool contains(const hwc_rect_t& outer, const hwc_rect_t& inner) {
+    return inner.left >= outer.left && inner.top >= outer.top &&
+           inner.right <= outer.right && inner.bottom <= outer.bottom;
+}
+
+// Whether one of the opaque layers in |above| covers |layer|. Those
+// aren't sent to the host at all as it would skip drawing them anyway.
+static bool is_hidden(const hwc_layer_1_t* layer,
+                      const std::vector<const hwc_layer_1_t*>& above) {
+    for (const auto cover : above) {
+        if (is_opaque(cover) && contains(cover->displayFrame, layer->displayFrame))
+            return true;
+    }
+    return false;
+}
+
+// Android draws the mouse pointer into a layer of its own. The host shows
+// its own cursor which follows the pointer without involving us at all.
+static const char* cursorLayerName = "Sprite";
+
+static bool is_cursor(const hwc_layer_1_t* layer) {
+    return (layer->flags & HWC_IS_CURSOR_LAYER) ||
+           strcmp(layer->name, cursorLayerName) == 0;
+}
+
+static int64_t monotonic_time_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
 static int hwc_set(hwc_composer_device_1_t* dev, size_t numDisplays,
                    hwc_display_contents_1_t** displays) {
     auto context = reinterpret_cast<HwcContext*>(dev);
+    // Lets the host tell how long the frame takes until it is on screen.
+    const auto submitTime = static_cast<uint64_t>(monotonic_time_ns());
 
     if (displays == NULL || displays[0] == NULL)
         return -EFAULT;
 
     DEFINE_AND_VALIDATE_HOST_CONNECTION();
 
+    // All layers go out with a single write together with the end of the
+    // frame. Only touched by the thread SurfaceFlinger composes on.
+    static std::vector<uint8_t> layers;
+    static std::vector<const hwc_layer_1_t*> posted;
+    layers.clear();
+    posted.clear();
+
     for (size_t i = 0 ; i < displays[0]->numHwLayers ; i++) {
         const auto layer = &displays[0]->hwLayers[i];
 
-        if (layer->flags & HWC_SKIP_LAYER ||
-            layer->flags & HWC_IS_CURSOR_LAYER)
+        if (layer->flags & HWC_SKIP_LAYER || is_cursor(layer))
             continue;
 
 #if 0
@@ -194,34 +307,119 @@ static int hwc_set(hwc_composer_device_1_t* dev, size_t numDisplays,
             return -EINVAL;
         }
 
-        rcEnc->rcPostLayer(rcEnc,
-                           layer->name,
-                           cb->hostHandle,
-                           layer->sourceCrop.left,
-                           layer->sourceCrop.top,
-                           layer->sourceCrop.right,
-                           layer->sourceCrop.bottom,
-                           layer->displayFrame.left,
-                           layer->displayFrame.top,
-                           layer->displayFrame.right,
-                           layer->displayFrame.bottom);
-        hostCon->flush();
+        posted.push_back(layer);
     }
 
-    rcEnc->rcPostAllLayersDone(rcEnc);
+    // Culled from the top down so we only have to look at the layers
+    // which are actually posted. The host draws them in painter's order.
+    static std::vector<const hwc_layer_1_t*> visible;
+    visible.clear();
+    for (size_t n = posted.size(); n-- > 0;) {
+        if (!is_hidden(posted[n], visible))
+            visible.push_back(posted[n]);
+    }
+    for (size_t n = visible.size(); n-- > 0;) {
+        const auto cb = reinterpret_cast<const cb_handle_t*>(visible[n]->handle);
+        append_layer(layers, visible[n], cb->hostHandle);
+    }
+
+    // Moving the pointer makes SurfaceFlinger compose a frame which differs
+    // from the last one only by the cursor layer we dropped above. There is
+    // nothing new to show for the host then. A layer never gets the buffer
+    // which is currently on screen queued again so the same list of buffers
+    // also means the same content.
+    static std::vector<uint8_t> lastLayers;
+    if (layers != lastLayers) {
+        if (!layers.empty())
+            rcEnc->rcPostLayers(rcEnc, &layers[0], layers.size());
+        rcEnc->rcPostAllLayersDone2(rcEnc,
+                                    static_cast<uint32_t>(submitTime >> 32),
+                                    static_cast<uint32_t>(submitTime));
+        hostCon->flush();
+        lastLayers.swap(layers);
+    }
 
     check_sync_fds(numDisplays, displays);
 
     return 0;
 }
 
+static void* hwc_vsync_thread(void* data) {
+    auto context = reinterpret_cast<HwcContext*>(data);
+
+    int64_t period = 0;
+    int64_t phase = 0;
+    int64_t last_resync = 0;
+
+    while (true) {
+        pthread_mutex_lock(&context->vsync_lock);
+        while (context->vsync_thread_running && !context->vsync_enabled)
+            pthread_cond_wait(&context->vsync_cond, &context->vsync_lock);
+        const bool running = context->vsync_thread_running;
+        pthread_mutex_unlock(&context->vsync_lock);
+
+        if (!running)
+            break;
+
+        int64_t now = monotonic_time_ns();
+        if (period <= 0 || now - last_resync >= vsync_resync_interval) {
+            // Host and container share the same kernel and with that the
+            // same monotonic clock so the phase the host reports can be
+            // used as is.
+            DEFINE_HOST_CONNECTION();
+            if (rcEnc) {
+                period = rcEnc->rcGetDisplayVsyncPeriod(rcEnc, 0);
+                phase = rcEnc->rcGetDisplayVsyncPhase(rcEnc, 0);
+            }
+            if (period <= 0) {
+                period = default_vsync_period;
+                phase = 0;
+            }
+            now = monotonic_time_ns();
+            last_resync = now;
+        }
+
+        const int64_t next_vsync = now - ((now - phase) % period) + period;
+
+        struct timespec ts;
+        ts.tv_sec = next_vsync / 1000000000;
+        ts.tv_nsec = next_vsync % 1000000000;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR);
+
+        pthread_mutex_lock(&context->vsync_lock);
+        const hwc_procs_t* procs = context->procs;
+        const bool enabled = context->vsync_enabled;
+        pthread_mutex_unlock(&context->vsync_lock);
+
+        if (enabled && procs && procs->vsync)
+            procs->vsync(procs, HWC_DISPLAY_PRIMARY, next_vsync);
+    }
+
+    return nullptr;
+}
+
 static int hwc_event_control(hwc_composer_device_1* dev, int disp,
                              int event, int enabled) {
-    return -EFAULT;
+    auto context = reinterpret_cast<HwcContext*>(dev);
+
+    if (disp != HWC_DISPLAY_PRIMARY || event != HWC_EVENT_VSYNC)
+        return -EINVAL;
+
+    pthread_mutex_lock(&context->vsync_lock);
+    context->vsync_enabled = (enabled != 0);
+    pthread_cond_signal(&context->vsync_cond);
+    pthread_mutex_unlock(&context->vsync_lock);
+
+    return 0;
 }
 
 static void hwc_register_procs(hwc_composer_device_1* dev,
                                hwc_procs_t const* procs) {
+    auto context = reinterpret_cast<HwcContext*>(dev);
+
+    pthread_mutex_lock(&context->vsync_lock);
+    context->procs = procs;
+    pthread_mutex_unlock(&context->vsync_lock);
 }
 
 static int hwc_blank(hwc_composer_device_1* dev, int disp, int blank) {
@@ -234,6 +432,16 @@ static int hwc_query(hwc_composer_device_1* dev, int what, int* value) {
 
 static int hwc_device_close(hw_device_t* dev) {
     auto context = reinterpret_cast<HwcContext*>(dev);
+
+    pthread_mutex_lock(&context->vsync_lock);
+    context->vsync_thread_running = false;
+    pthread_cond_signal(&context->vsync_cond);
+    pthread_mutex_unlock(&context->vsync_lock);
+
+    pthread_join(context->vsync_thread, nullptr);
+    pthread_cond_destroy(&context->vsync_cond);
+    pthread_mutex_destroy(&context->vsync_lock);
+
     delete context;
     return 0;
 }
@@ -310,6 +518,20 @@ static int hwc_device_open(const hw_module_t* module, const char* name, hw_devic
     dev->device.registerProcs = hwc_register_procs;
     dev->device.dump = nullptr;
 
+    dev->procs = nullptr;
+    dev->vsync_enabled = false;
+    dev->vsync_thread_running = true;
+    pthread_mutex_init(&dev->vsync_lock, nullptr);
+    pthread_cond_init(&dev->vsync_cond, nullptr);
+
+    if (pthread_create(&dev->vsync_thread, nullptr, hwc_vsync_thread, dev) != 0) {
+        ALOGE("Failed to create vsync thread");
+        pthread_cond_destroy(&dev->vsync_cond);
+        pthread_mutex_destroy(&dev->vsync_lock);
+        delete dev;
+        return -ENOMEM;
+    }
+
     *device = &dev->device.common;
 
     return 0;
@@ -18,16 +18,30 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "ErrorLog.h"
 
 class IOStream {
 public:
 
+    // Traffic counters, see stats().
+    struct Stats {
+        size_t flushes;
+        size_t flushedBytes;
+        size_t readbacks;
+    };
+
+    // Payloads up to this size are copied into the command buffer by
+    // writeLarge() instead of being written directly.
+    static const size_t kDirectWriteThreshold = 64 * 1024;
+
     IOStream(size_t bufSize) {
         m_buf = NULL;
         m_bufsize = bufSize;
+        m_defaultBufsize = bufSize;
         m_free = 0;
+        resetStats();
     }
 
     virtual void *allocBuffer(size_t minSize) = 0;
@@ -36,6 +50,14 @@ public:
     virtual const unsigned char *read( void *buf, size_t *inout_len) = 0;
     virtual int writeFully(const void* buf, size_t len) = 0;
 
+    // Commits the first |size| bytes of the buffer followed by |len| bytes
+    // from |buf|. Streams which can write both at once should do so.
+    virtual int commitBufferWith(size_t size, const void *buf, size_t len) {
+        int stat = commitBuffer(size);
+        if (stat < 0) return stat;
+        return writeFully(buf, len);
+    }
+
     virtual ~IOStream() {
 
         // NOTE: m_buf is 'owned' by the child class thus we expect it to be released by it
@@ -72,22 +94,60 @@ public:
 
         if (!m_buf || m_free == m_bufsize) return 0;
 
-        int stat = commitBuffer(m_bufsize - m_free);
-        m_buf = NULL;
-        m_free = 0;
+        const size_t len = m_bufsize - m_free;
+        int stat = commitBuffer(len);
+        bufferCommitted(len);
         return stat;
     }
 
+    // Append a variable sized payload to the command currently being
+    // encoded. Small payloads are copied into the command buffer so they
+    // leave together with the surrounding commands at the next flush
+    // point. Only large ones flush the pending commands and go out
+    // directly, where saving the copy outweighs the extra write.
+    int writeLarge(const void *buf, size_t len) {
+
+        if (len <= kDirectWriteThreshold) {
+            unsigned char *ptr = alloc(len);
+            if (!ptr) return -1;
+            memcpy(ptr, buf, len);
+            return 0;
+        }
+
+        // The pending commands go out together with the payload.
+        const size_t pending = m_buf ? m_bufsize - m_free : 0;
+        int stat = pending > 0 ? commitBufferWith(pending, buf, len)
+                               : writeFully(buf, len);
+        bufferCommitted(pending + len);
+        return stat < 0 ? -1 : 0;
+    }
+
     const unsigned char *readback(void *buf, size_t len) {
+        m_stats.readbacks++;
         flush();
         return readFully(buf, len);
     }
 
+    const Stats &stats() const { return m_stats; }
+    void resetStats() { memset(&m_stats, 0, sizeof(m_stats)); }
+
 
 private:
+    void bufferCommitted(size_t len) {
+        m_buf = NULL;
+        m_free = 0;
+        // A single large command must not make every later buffer as large,
+        // the stream decides whether it keeps the memory around.
+        m_bufsize = m_defaultBufsize;
+        m_stats.flushes++;
+        m_stats.flushedBytes += len;
+    }
+
     unsigned char *m_buf;
     size_t m_bufsize;
+    size_t m_defaultBufsize;
     size_t m_free;
+    Stats m_stats;
 };
 
 //
@@ -32,10 +32,13 @@ GLClientState::GLClientState(int nLocations)
     }
     m_nLocations = nLocations;
     m_states = new VertexAttribState[m_nLocations];
+    m_hostArrays = new HostArrayState[m_nLocations];
     for (int i = 0; i < m_nLocations; i++) {
         m_states[i].enabled = 0;
         m_states[i].enableDirty = false;
         m_states[i].data = 0;
+        m_states[i].divisor = 0;
+        memset(&m_hostArrays[i], 0, sizeof(HostArrayState));
     }
     m_currentArrayVbo = 0;
     m_currentIndexVbo = 0;
@@ -71,6 +74,10 @@ GLClientState::GLClientState(int nLocations)
 
 GLClientState::~GLClientState()
 {
+    for (int i = 0; i < m_nLocations; i++) {
+        free(m_hostArrays[i].data);
+    }
+    delete [] m_hostArrays;
     delete m_states;
 }
 
@@ -98,6 +105,65 @@ void GLClientState::setState(int location, int size, GLenum type, GLboolean norm
     m_states[location].normalized = normalized;
 }
 
+bool GLClientState::updateHostArray(int location, const unsigned char *data, unsigned int stride, unsigned int datalen)
+{
+    if (!validLocation(location)) {
+        return false;
+    }
+
+    const VertexAttribState &state = m_states[location];
+    HostArrayState &host = m_hostArrays[location];
+    const unsigned int vsize = state.elementSize;
+    if (stride == 0) stride = vsize;
+
+    if (host.valid && host.size == state.size && host.type == state.type &&
+            host.normalized == state.normalized && host.datalen == datalen) {
+        bool equal = true;
+        if (stride == vsize) {
+            equal = memcmp(host.data, data, datalen) == 0;
+        } else {
+            const unsigned char *src = data;
+            for (unsigned int i = 0; equal && i < datalen; i += vsize, src += stride) {
+                equal = memcmp(host.data + i, src, vsize) == 0;
+            }
+        }
+        if (equal) {
+            return true;
+        }
+    }
+
+    host.valid = false;
+    if (datalen == 0 || vsize == 0 || datalen > MAX_HOST_ARRAY_SIZE) {
+        return false;
+    }
+
+    if (host.allocated < datalen) {
+        unsigned char *p = (unsigned char *)realloc(host.data, datalen);
+        if (!p) {
+            return false;
+        }
+        host.data = p;
+        host.allocated = datalen;
+    }
+
+    glUtilsPackPointerData(host.data, (unsigned char *)data, state.size, state.type, stride, datalen);
+    host.size = state.size;
+    host.type = state.type;
+    host.normalized = state.normalized;
+    host.datalen = datalen;
+    host.valid = true;
+    return false;
+}
+
+void GLClientState::invalidateHostArray(int location)
+{
+    if (!validLocation(location)) {
+        return;
+    }
+
+    m_hostArrays[location].valid = false;
+}
+
 void GLClientState::setBufferObject(int location, GLuint id)
 {
     if (!validLocation(location)) {
@@ -107,6 +173,15 @@ void GLClientState::setBufferObject(int location, GLuint id)
     m_states[location].bufferObject = id;
 }
 
+void GLClientState::setDivisor(int location, GLuint divisor)
+{
+    if (!validLocation(location)) {
+        return;
+    }
+
+    m_states[location].divisor = divisor;
+}
+
 const GLClientState::VertexAttribState * GLClientState::getState(int location)
 {
     if (!validLocation(location)) {
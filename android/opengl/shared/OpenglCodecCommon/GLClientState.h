@@ -27,6 +27,10 @@
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
 
+#ifndef GL_VERTEX_ATTRIB_ARRAY_DIVISOR_EXT
+#define GL_VERTEX_ATTRIB_ARRAY_DIVISOR_EXT 0x88FE
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include "ErrorLog.h"
@@ -63,6 +67,7 @@ public:
         unsigned int elementSize;
         bool enableDirty;  // true if any enable state has changed since last draw
         bool normalized;
+        GLuint divisor;  // GL_EXT_instanced_arrays, 0 advances per vertex
     } VertexAttribState;
 
     typedef struct {
@@ -74,6 +79,11 @@ public:
         MAX_TEXTURE_UNITS = 32,
     };
 
+    // Client arrays up to this size are remembered by updateHostArray().
+    enum {
+        MAX_HOST_ARRAY_SIZE = 64 * 1024,
+    };
+
 public:
     GLClientState(int nLocations = CODEC_MAX_VERTEX_ATTRIBUTES);
     ~GLClientState();
@@ -85,6 +95,7 @@ public:
     void enable(int location, int state);
     void setState(int  location, int size, GLenum type, GLboolean normalized, GLsizei stride, const void *data);
     void setBufferObject(int location, GLuint id);
+    void setDivisor(int location, GLuint divisor);
     const VertexAttribState  *getState(int location);
     const VertexAttribState  *getStateAndEnableDirty(int location, bool *enableChanged);
     int getLocation(GLenum loc);
@@ -134,6 +145,21 @@ public:
     }
     size_t pixelDataSize(GLsizei width, GLsizei height, GLenum format, GLenum type, int pack) const;
 
+    // Client side vertex arrays are copied to the host on every draw call
+    // and stay around there, bound to their attribute location, until the
+    // next one replaces them. To avoid transferring arrays which have not
+    // changed since the previous draw, a tightly packed copy of what the
+    // host got for each location is kept here.
+    //
+    // Returns true if the host already holds the |datalen| bytes at |data|
+    // (using the location's current size and type, with |stride|) for
+    // |location|. Otherwise the copy gets updated and false is returned, in
+    // which case the caller has to send the data.
+    bool updateHostArray(int location, const unsigned char *data, unsigned int stride, unsigned int datalen);
+    // Forget what the host holds for |location|, e.g. because the location
+    // got redirected to a buffer object.
+    void invalidateHostArray(int location);
+
     void setCurrentProgram(GLint program) { m_currentProgram = program; }
     GLint currentProgram() const { return m_currentProgram; }
 
@@ -186,8 +212,19 @@ public:
     void deleteTextures(GLsizei n, const GLuint* textures);
 
 private:
+    typedef struct {
+        bool valid;
+        GLint size;
+        GLenum type;
+        bool normalized;
+        unsigned char *data;
+        unsigned int datalen;
+        unsigned int allocated;
+    } HostArrayState;
+
     PixelStoreState m_pixelStore;
     VertexAttribState *m_states;
+    HostArrayState *m_hostArrays;
     int m_maxVertexAttribs;
     bool m_maxVertexAttribsDirty;
     int m_nLocations;
@@ -256,6 +293,9 @@ public:
         case GL_VERTEX_ATTRIB_ARRAY_NORMALIZED:
             *ptr = (T)(vertexAttrib->normalized);
             break;
+        case GL_VERTEX_ATTRIB_ARRAY_DIVISOR_EXT:
+            *ptr = (T)(vertexAttrib->divisor);
+            break;
         case GL_CURRENT_VERTEX_ATTRIB:
             handled = false;
             break;
@@ -15,6 +15,8 @@
 */
 
 #include "GLSharedGroup.h"
+#include "SharedBufferMemory.h"
+#include <string.h>
 
 /**** KeyedVector utilities ****/
 
@@ -27,14 +29,19 @@ static void clearObjectMap(android::DefaultKeyedVector<GLuint, T>& v) {
 
 /**** BufferData ****/
 
-BufferData::BufferData() : m_size(0) {};
-BufferData::BufferData(GLsizeiptr size, void * data) : m_size(size)
+BufferData::BufferData() : m_size(0), m_sharedMemory(NULL) {};
+BufferData::BufferData(GLsizeiptr size, void * data) : m_size(size), m_sharedMemory(NULL)
 {
     void * buffer = NULL;
     if (size>0) buffer = m_fixedBuffer.alloc(size);
     if (data) memcpy(buffer, data, size);
 }
 
+BufferData::~BufferData()
+{
+    delete m_sharedMemory;
+}
+
 /**** ProgramData ****/
 ProgramData::ProgramData() : m_numIndexes(0),
                              m_initialized(false),
@@ -63,7 +70,7 @@ ProgramData::~ProgramData()
     m_Indexes = NULL;
 }
 
-void ProgramData::setIndexInfo(GLuint index, GLint base, GLint size, GLenum type)
+void ProgramData::setIndexInfo(GLuint index, GLint base, GLint size, GLenum type, const char* name)
 {
     if (index>=m_numIndexes)
         return;
@@ -80,6 +87,7 @@ void ProgramData::setIndexInfo(GLuint index, GLint base, GLint size, GLenum type
     m_Indexes[index].hostLocsPerElement = 1;
     m_Indexes[index].flags = 0;
     m_Indexes[index].samplerValue = 0;
+    m_Indexes[index].name = name;
 }
 
 void ProgramData::setIndexFlags(GLuint index, GLuint flags)
@@ -114,6 +122,33 @@ GLenum ProgramData::getTypeForLocation(GLint location)
     return 0;
 }
 
+// Only names of whole uniforms and of their first element are answered
+// here, the host has to be asked for the location of any other element.
+bool ProgramData::getLocationForName(const char* name, GLint* location)
+{
+    if (!m_initialized)
+        return false;
+
+    const size_t length = strlen(name);
+    for (GLuint i = 0; i < m_numIndexes; i++) {
+        const android::String8& indexName = m_Indexes[i].name;
+        if (indexName == name ||
+            (indexName.length() == length + 3 &&
+             strncmp(indexName.string(), name, length) == 0 &&
+             strcmp(indexName.string() + length, "[0]") == 0)) {
+            *location = m_Indexes[i].base;
+            return true;
+        }
+    }
+
+    if (strchr(name, '['))
+        return false;
+
+    // Not an active uniform.
+    *location = -1;
+    return true;
+}
+
 void ProgramData::setupLocationShiftWAR()
 {
     m_locShiftWAR = false;
@@ -291,6 +326,35 @@ void GLSharedGroup::deleteBufferData(GLuint bufferId)
     }
 }
 
+SharedBufferMemory * GLSharedGroup::getBufferSharedMemory(GLuint bufferId)
+{
+    android::AutoMutex _lock(m_lock);
+    BufferData * buf = m_buffers.valueFor(bufferId);
+    return buf ? buf->m_sharedMemory : NULL;
+}
+
+SharedBufferMemory * GLSharedGroup::detachBufferSharedMemory(GLuint bufferId)
+{
+    android::AutoMutex _lock(m_lock);
+    BufferData * buf = m_buffers.valueFor(bufferId);
+    if (!buf) return NULL;
+    SharedBufferMemory * memory = buf->m_sharedMemory;
+    buf->m_sharedMemory = NULL;
+    return memory;
+}
+
+void GLSharedGroup::setBufferSharedMemory(GLuint bufferId, SharedBufferMemory * memory)
+{
+    android::AutoMutex _lock(m_lock);
+    BufferData * buf = m_buffers.valueFor(bufferId);
+    if (!buf) {
+        delete memory;
+        return;
+    }
+    delete buf->m_sharedMemory;
+    buf->m_sharedMemory = memory;
+}
+
 void GLSharedGroup::addProgramData(GLuint program)
 {
     android::AutoMutex _lock(m_lock);
@@ -364,7 +428,7 @@ void GLSharedGroup::setProgramIndexInfo(GLuint program, GLuint index, GLint base
     ProgramData* pData = m_programs.valueFor(program);
     if (pData)
     {
-        pData->setIndexInfo(index,base,size,type);
+        pData->setIndexInfo(index,base,size,type,name);
 
         if (type == GL_SAMPLER_2D) {
             size_t n = pData->getNumShaders();
@@ -398,6 +462,13 @@ GLenum GLSharedGroup::getProgramUniformType(GLuint program, GLint location)
     return type;
 }
 
+bool GLSharedGroup::getProgramUniformLocation(GLuint program, const char* name, GLint* location)
+{
+    android::AutoMutex _lock(m_lock);
+    ProgramData* pData = m_programs.valueFor(program);
+    return pData ? pData->getLocationForName(name, location) : false;
+}
+
 bool  GLSharedGroup::isProgram(GLuint program)
 {
     android::AutoMutex _lock(m_lock);
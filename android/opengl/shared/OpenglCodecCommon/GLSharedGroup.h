@@ -37,11 +37,16 @@
 #include "FixedBuffer.h"
 #include "SmartPtr.h"
 
+class SharedBufferMemory;
+
 struct BufferData {
     BufferData();
     BufferData(GLsizeiptr size, void * data);
+    ~BufferData();
     GLsizeiptr  m_size;
     FixedBuffer m_fixedBuffer;    
+    // Memory the content is streamed to the host through, if any.
+    SharedBufferMemory * m_sharedMemory;
 };
 
 class ProgramData {
@@ -54,6 +59,7 @@ private:
         GLint hostLocsPerElement;
         GLuint flags;
         GLint samplerValue; // only set for sampler uniforms
+        android::String8 name;
     } IndexInfo;
 
     GLuint m_numIndexes;
@@ -72,10 +78,11 @@ public:
     void initProgramData(GLuint numIndexes);
     bool isInitialized();
     virtual ~ProgramData();
-    void setIndexInfo(GLuint index, GLint base, GLint size, GLenum type);
+    void setIndexInfo(GLuint index, GLint base, GLint size, GLenum type, const char* name);
     void setIndexFlags(GLuint index, GLuint flags);
     GLuint getIndexForLocation(GLint location);
     GLenum getTypeForLocation(GLint location);
+    bool getLocationForName(const char* name, GLint* location);
 
     bool needUniformLocationWAR() const { return m_locShiftWAR; }
     void setupLocationShiftWAR();
@@ -116,6 +123,11 @@ public:
     void    updateBufferData(GLuint bufferId, GLsizeiptr size, void * data);
     GLenum  subUpdateBufferData(GLuint bufferId, GLintptr offset, GLsizeiptr size, void * data);
     void    deleteBufferData(GLuint);
+    // The group keeps ownership of memory set on a buffer until it is
+    // detached again.
+    SharedBufferMemory * getBufferSharedMemory(GLuint bufferId);
+    SharedBufferMemory * detachBufferSharedMemory(GLuint bufferId);
+    void    setBufferSharedMemory(GLuint bufferId, SharedBufferMemory * memory);
 
     bool    isProgram(GLuint program);
     bool    isProgramInitialized(GLuint program);
@@ -126,6 +138,7 @@ public:
     void    deleteProgramData(GLuint program);
     void    setProgramIndexInfo(GLuint program, GLuint index, GLint base, GLint size, GLenum type, const char* name);
     GLenum  getProgramUniformType(GLuint program, GLint location);
+    bool    getProgramUniformLocation(GLuint program, const char* name, GLint* location);
     void    setupLocationShiftWAR(GLuint program);
     GLint   locationWARHostToApp(GLuint program, GLint hostLoc, GLint arrIndex);
     GLint   locationWARAppToHost(GLuint program, GLint appLoc);
@@ -0,0 +1,161 @@
+/*
+* Copyright (C) 2016 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "SharedBufferMemory.h"
+
+#include <cutils/ashmem.h>
+#include <cutils/log.h>
+#include <hardware/qemu_pipe.h>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+// Every piece of shared memory holds an ashmem fd and a pipe, don't let a
+// process with lots of buffers run out of file descriptors because of it.
+static const int kMaxSharedMemories = 64;
+
+static volatile int32_t sNumSharedMemories = 0;
+// Cleared once the host told us it has the feature disabled.
+static volatile bool sEnabled = true;
+
+static int shareMemory(int fd, size_t size, uint32_t* handle)
+{
+    int sock = qemu_pipe_open("anbox:buffer-memory");
+    if (sock < 0) {
+        return -EIO;
+    }
+
+    struct {
+        uint32_t size;
+    } request = { (uint32_t) size };
+
+    struct iovec iov;
+    iov.iov_base = &request;
+    iov.iov_len = sizeof(request);
+
+    char control[CMSG_SPACE(sizeof(int))];
+    memset(control, 0, sizeof(control));
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+    struct {
+        int32_t result;
+        uint32_t handle;
+    } reply = { -EIO, 0 };
+    if (sendmsg(sock, &msg, MSG_NOSIGNAL) != (ssize_t) sizeof(request) ||
+        read(sock, &reply, sizeof(reply)) != sizeof(reply)) {
+        reply.result = -EIO;
+    }
+
+    if (reply.result != 0) {
+        close(sock);
+        return reply.result;
+    }
+
+    // The host forgets about the memory once we close the pipe.
+    *handle = reply.handle;
+    return sock;
+}
+
+SharedBufferMemory* SharedBufferMemory::create(size_t size)
+{
+    if (!sEnabled || size == 0) {
+        return NULL;
+    }
+    if (__sync_add_and_fetch(&sNumSharedMemories, 1) > kMaxSharedMemories) {
+        __sync_sub_and_fetch(&sNumSharedMemories, 1);
+        return NULL;
+    }
+
+    const size_t total = sizeof(Header) + size;
+    int fd = ashmem_create_region("anbox-gl-buffer", total);
+    if (fd < 0) {
+        __sync_sub_and_fetch(&sNumSharedMemories, 1);
+        return NULL;
+    }
+
+    void* addr = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        close(fd);
+        __sync_sub_and_fetch(&sNumSharedMemories, 1);
+        return NULL;
+    }
+
+    uint32_t handle = 0;
+    int sock = shareMemory(fd, size, &handle);
+    if (sock < 0) {
+        if (sock == -ENOSYS) {
+            sEnabled = false;
+        }
+        munmap(addr, total);
+        close(fd);
+        __sync_sub_and_fetch(&sNumSharedMemories, 1);
+        return NULL;
+    }
+
+    return new SharedBufferMemory(fd, sock, (uint8_t*) addr, size, handle);
+}
+
+SharedBufferMemory::SharedBufferMemory(int fd, int sock, uint8_t* data, size_t size, uint32_t handle) :
+    m_fd(fd),
+    m_sock(sock),
+    m_data(data),
+    m_size(size),
+    m_handle(handle),
+    m_sequence(0)
+{
+}
+
+SharedBufferMemory::~SharedBufferMemory()
+{
+    if (busy()) {
+        ALOGW("Destroying shared buffer memory %u before the host read it", m_handle);
+    }
+    munmap(m_data, sizeof(Header) + m_size);
+    close(m_sock);
+    close(m_fd);
+    __sync_sub_and_fetch(&sNumSharedMemories, 1);
+}
+
+bool SharedBufferMemory::update(size_t offset, const void* data, size_t size, uint32_t* sequence)
+{
+    if (offset > m_size || size > m_size - offset || busy()) {
+        return false;
+    }
+
+    memcpy(m_data + sizeof(Header) + offset, data, size);
+    *sequence = ++m_sequence;
+    return true;
+}
+
+bool SharedBufferMemory::busy() const
+{
+    const Header* header = (const Header*) m_data;
+    return __atomic_load_n(&header->consumed, __ATOMIC_ACQUIRE) != m_sequence;
+}
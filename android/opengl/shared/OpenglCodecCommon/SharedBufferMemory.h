@@ -0,0 +1,65 @@
+/*
+* Copyright (C) 2016 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef __SHARED_BUFFER_MEMORY_H__
+#define __SHARED_BUFFER_MEMORY_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Memory shared with the host through a "anbox:buffer-memory" pipe to
+// stream the content of a buffer object through. Updates are written to
+// the memory and only their range is sent through the GL stream, the host
+// reads the data from its own mapping of the memory.
+//
+// The memory starts with a Header the host stores the sequence number of
+// the last update it read in. The content of the buffer follows it.
+class SharedBufferMemory {
+public:
+    struct Header {
+        uint32_t consumed;
+        uint32_t reserved[15];
+    };
+
+    // Returns NULL if the host doesn't support shared buffer memory or the
+    // process already shares too much of it.
+    static SharedBufferMemory* create(size_t size);
+    ~SharedBufferMemory();
+
+    uint32_t handle() const { return m_handle; }
+    size_t size() const { return m_size; }
+
+    // Copies |size| bytes from |data| to |offset| and returns the sequence
+    // number to send along with the update in |sequence|. Fails if the host
+    // didn't read the previous update yet, the data has to be sent through
+    // the stream then.
+    bool update(size_t offset, const void* data, size_t size, uint32_t* sequence);
+
+    // Whether the host still has to read the last update. The memory must
+    // not be destroyed before, the host can't look it up anymore then.
+    bool busy() const;
+
+private:
+    SharedBufferMemory(int fd, int sock, uint8_t* data, size_t size, uint32_t handle);
+
+    int m_fd;
+    int m_sock;
+    uint8_t* m_data;
+    size_t m_size;
+    uint32_t m_handle;
+    uint32_t m_sequence;
+};
+
+#endif
@@ -50,10 +50,29 @@ GLenum GLEncoder::s_glGetError(void * self)
         return err;
     }
 
+    if (ctx->m_deferHostErrors) {
+        ctx->m_errorQueried = true;
+        return GL_NO_ERROR;
+    }
+
     return ctx->m_glGetError_enc(self);
 
 }
 
+void GLEncoder::syncHostError()
+{
+    if (!m_deferHostErrors || !m_errorQueried) {
+        return;
+    }
+    m_errorQueried = false;
+
+    // Like the host we only keep the first error until it is queried.
+    GLenum err = m_glGetError_enc(this);
+    if (err != GL_NO_ERROR && getError() == GL_NO_ERROR) {
+        setError(err);
+    }
+}
+
 GLint * GLEncoder::getCompressedTextureFormats()
 {
     if (m_compressedTextureFormats == NULL) {
@@ -956,6 +975,8 @@ GLEncoder::GLEncoder(IOStream *stream, ChecksumCalculator *protocol)
     m_initialized = false;
     m_state = NULL;
     m_error = GL_NO_ERROR;
+    m_deferHostErrors = false;
+    m_errorQueried = false;
     m_num_compressedTextureFormats = 0;
     m_compressedTextureFormats = NULL;
 
@@ -1026,4 +1047,5 @@ void GLEncoder::s_glFinish(void *self)
 {
     GLEncoder *ctx = (GLEncoder *)self;
     ctx->glFinishRoundTrip(self);
+    ctx->syncHostError();
 }
@@ -40,6 +40,15 @@ public:
     virtual void setError(GLenum error){ m_error = error; };
     virtual GLenum getError() { return m_error; };
 
+    // With deferred host errors glGetError() doesn't ask the host each
+    // time. It reports what was caught locally or what the host reported
+    // at the last sync point.
+    void setDeferHostErrors(bool defer) { m_deferHostErrors = defer; }
+    // Sync point for deferred host errors, called where the application
+    // waits for the host anyway. Only asks the host when the application
+    // looked for errors since the last one.
+    void syncHostError();
+
     void override2DTextureTarget(GLenum target);
     void restore2DTextureTarget();
 
@@ -49,6 +58,8 @@ private:
     GLClientState *m_state;
     GLSharedGroupPtr m_shared;
     GLenum  m_error;
+    bool    m_deferHostErrors;
+    bool    m_errorQueried;
     FixedBuffer m_fixedBuffer;
     GLint *m_compressedTextureFormats;
     GLint m_num_compressedTextureFormats;
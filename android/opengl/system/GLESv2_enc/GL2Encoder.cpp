@@ -15,6 +15,7 @@
 */
 
 #include "GL2Encoder.h"
+#include "SharedBufferMemory.h"
 #include <assert.h>
 #include <ctype.h>
 #include <cmath>
@@ -23,6 +24,10 @@
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 #endif
 
+// Smaller buffers are cheap enough to send through the stream, static ones
+// are usually only specified once.
+static const GLsizeiptr kMinSharedBufferSize = 16 * 1024;
+
 static GLubyte *gVendorString= (GLubyte *) "Android";
 static GLubyte *gRendererString= (GLubyte *) "Android HW-GLES 2.0";
 static GLubyte *gVersionString= (GLubyte *) "OpenGL ES 2.0";
@@ -48,10 +53,18 @@ GL2Encoder::GL2Encoder(IOStream *stream, ChecksumCalculator *protocol)
     m_initialized = false;
     m_state = NULL;
     m_error = GL_NO_ERROR;
+    m_deferHostErrors = false;
+    m_errorQueried = false;
     m_num_compressedTextureFormats = 0;
     m_max_cubeMapTextureSize = 0;
     m_max_renderBufferSize = 0;
     m_max_textureSize = 0;
+    m_max_textureImageUnits = 0;
+    m_max_vertexTextureImageUnits = 0;
+    m_max_combinedTextureImageUnits = 0;
+    m_max_vertexUniformVectors = 0;
+    m_max_fragmentUniformVectors = 0;
+    m_max_varyingVectors = 0;
     m_compressedTextureFormats = NULL;
 
     //overrides
@@ -59,6 +72,7 @@ GL2Encoder::GL2Encoder(IOStream *stream, ChecksumCalculator *protocol)
 
     OVERRIDE(glFlush);
     OVERRIDE(glPixelStorei);
+    OVERRIDE(glReadPixelsAsyncANBOX);
     OVERRIDE(glGetString);
     OVERRIDE(glBindBuffer);
     OVERRIDE(glBufferData);
@@ -66,12 +80,15 @@ GL2Encoder::GL2Encoder(IOStream *stream, ChecksumCalculator *protocol)
     OVERRIDE(glDeleteBuffers);
     OVERRIDE(glDrawArrays);
     OVERRIDE(glDrawElements);
+    OVERRIDE(glDrawArraysInstancedEXT);
+    OVERRIDE(glDrawElementsInstancedEXT);
     OVERRIDE(glGetIntegerv);
     OVERRIDE(glGetFloatv);
     OVERRIDE(glGetBooleanv);
     OVERRIDE(glVertexAttribPointer);
     OVERRIDE(glEnableVertexAttribArray);
     OVERRIDE(glDisableVertexAttribArray);
+    OVERRIDE(glVertexAttribDivisorEXT);
     OVERRIDE(glGetVertexAttribiv);
     OVERRIDE(glGetVertexAttribfv);
     OVERRIDE(glGetVertexAttribPointerv);
@@ -145,10 +162,29 @@ GLenum GL2Encoder::s_glGetError(void * self)
         return err;
     }
 
+    if (ctx->m_deferHostErrors) {
+        ctx->m_errorQueried = true;
+        return GL_NO_ERROR;
+    }
+
     return ctx->m_glGetError_enc(self);
 
 }
 
+void GL2Encoder::syncHostError()
+{
+    if (!m_deferHostErrors || !m_errorQueried) {
+        return;
+    }
+    m_errorQueried = false;
+
+    // Like the host we only keep the first error until it is queried.
+    GLenum err = m_glGetError_enc(this);
+    if (err != GL_NO_ERROR && getError() == GL_NO_ERROR) {
+        setError(err);
+    }
+}
+
 void GL2Encoder::s_glFlush(void *self)
 {
     GL2Encoder *ctx = (GL2Encoder *) self;
@@ -156,6 +192,20 @@ void GL2Encoder::s_glFlush(void *self)
     ctx->m_stream->flush();
 }
 
+void GL2Encoder::s_glReadPixelsAsyncANBOX(void *self, GLuint token, GLint x, GLint y,
+        GLsizei width, GLsizei height, GLenum format, GLenum type, GLsizei bufSize)
+{
+    GL2Encoder *ctx = (GL2Encoder *) self;
+    SET_ERROR_IF(width < 0 || height < 0 || bufSize < 0, GL_INVALID_VALUE);
+    SET_ERROR_IF((size_t)bufSize < ctx->m_state->pixelDataSize(width, height, format, type, 1),
+                 GL_INVALID_OPERATION);
+
+    // Send the request right away so the host reads the pixels while we
+    // carry on, glFetchReadPixelsANBOX only has to pick them up.
+    ctx->m_glReadPixelsAsyncANBOX_enc(self, token, x, y, width, height, format, type, bufSize);
+    ctx->m_stream->flush();
+}
+
 const GLubyte *GL2Encoder::s_glGetString(void *self, GLenum name)
 {
     (void)self;
@@ -204,8 +254,27 @@ void GL2Encoder::s_glBufferData(void * self, GLenum target, GLsizeiptr size, con
     SET_ERROR_IF(bufferId==0, GL_INVALID_OPERATION);
     SET_ERROR_IF(size<0, GL_INVALID_VALUE);
 
+    // Memory of the previous data store is reused if the size still fits.
+    SharedBufferMemory *memory = ctx->m_shared->detachBufferSharedMemory(bufferId);
+    const bool shareable = data != NULL && usage != GL_STATIC_DRAW &&
+                           size >= kMinSharedBufferSize;
+    if (memory && (!shareable || memory->size() != (size_t)size)) {
+        ctx->releaseSharedMemory(memory);
+        memory = NULL;
+    }
+    if (!memory && shareable) {
+        memory = SharedBufferMemory::create(size);
+    }
+
     ctx->m_shared->updateBufferData(bufferId, size, (void*)data);
-    ctx->m_glBufferData_enc(self, target, size, data, usage);
+    ctx->m_shared->setBufferSharedMemory(bufferId, memory);
+
+    uint32_t sequence = 0;
+    if (memory && memory->update(0, data, size, &sequence)) {
+        ctx->glBufferDataSharedANBOX(self, target, size, usage, memory->handle(), sequence);
+    } else {
+        ctx->m_glBufferData_enc(self, target, size, data, usage);
+    }
 }
 
 void GL2Encoder::s_glBufferSubData(void * self, GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid * data)
@@ -218,7 +287,14 @@ void GL2Encoder::s_glBufferSubData(void * self, GLenum target, GLintptr offset,
     GLenum res = ctx->m_shared->subUpdateBufferData(bufferId, offset, size, (void*)data);
     SET_ERROR_IF(res, res);
 
-    ctx->m_glBufferSubData_enc(self, target, offset, size, data);
+    // Falls back to the stream while the host still reads the last update.
+    SharedBufferMemory *memory = ctx->m_shared->getBufferSharedMemory(bufferId);
+    uint32_t sequence = 0;
+    if (memory && memory->update(offset, data, size, &sequence)) {
+        ctx->glBufferSubDataSharedANBOX(self, target, offset, size, memory->handle(), sequence);
+    } else {
+        ctx->m_glBufferSubData_enc(self, target, offset, size, data);
+    }
 }
 
 void GL2Encoder::s_glDeleteBuffers(void * self, GLsizei n, const GLuint * buffers)
@@ -226,12 +302,25 @@ void GL2Encoder::s_glDeleteBuffers(void * self, GLsizei n, const GLuint * buffer
     GL2Encoder *ctx = (GL2Encoder *) self;
     SET_ERROR_IF(n<0, GL_INVALID_VALUE);
     for (int i=0; i<n; i++) {
+        ctx->releaseSharedMemory(ctx->m_shared->detachBufferSharedMemory(buffers[i]));
         ctx->m_shared->deleteBufferData(buffers[i]);
         ctx->m_state->unBindBuffer(buffers[i]);
         ctx->m_glDeleteBuffers_enc(self,1,&buffers[i]);
     }
 }
 
+void GL2Encoder::releaseSharedMemory(SharedBufferMemory *memory)
+{
+    if (!memory) {
+        return;
+    }
+    // The host can't look the memory up anymore once it is gone.
+    if (memory->busy()) {
+        glFinishRoundTrip(this);
+    }
+    delete memory;
+}
+
 void GL2Encoder::s_glVertexAttribPointer(void *self, GLuint indx, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid * ptr)
 {
     GL2Encoder *ctx = (GL2Encoder *)self;
@@ -264,10 +353,13 @@ void GL2Encoder::s_glGetIntegerv(void *self, GLenum param, GLint *ptr)
     }
 
     case GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS:
+        ctx->getCachedLimit(param, ptr, &ctx->m_max_combinedTextureImageUnits);
+        break;
     case GL_MAX_VERTEX_TEXTURE_IMAGE_UNITS:
+        ctx->getCachedLimit(param, ptr, &ctx->m_max_vertexTextureImageUnits);
+        break;
     case GL_MAX_TEXTURE_IMAGE_UNITS:
-        ctx->m_glGetIntegerv_enc(self, param, ptr);
-        *ptr = MIN(*ptr, GLClientState::MAX_TEXTURE_UNITS);
+        ctx->getCachedLimit(param, ptr, &ctx->m_max_textureImageUnits);
         break;
 
     case GL_TEXTURE_BINDING_2D:
@@ -278,28 +370,22 @@ void GL2Encoder::s_glGetIntegerv(void *self, GLenum param, GLint *ptr)
         break;
 
     case GL_MAX_CUBE_MAP_TEXTURE_SIZE:
-        if (ctx->m_max_cubeMapTextureSize != 0) {
-            *ptr = ctx->m_max_cubeMapTextureSize;
-        } else {
-            ctx->m_glGetIntegerv_enc(self, param, ptr);
-            ctx->m_max_cubeMapTextureSize = *ptr;
-        }
+        ctx->getCachedLimit(param, ptr, &ctx->m_max_cubeMapTextureSize);
         break;
     case GL_MAX_RENDERBUFFER_SIZE:
-        if (ctx->m_max_renderBufferSize != 0) {
-            *ptr = ctx->m_max_renderBufferSize;
-        } else {
-            ctx->m_glGetIntegerv_enc(self, param, ptr);
-            ctx->m_max_renderBufferSize = *ptr;
-        }
+        ctx->getCachedLimit(param, ptr, &ctx->m_max_renderBufferSize);
         break;
     case GL_MAX_TEXTURE_SIZE:
-        if (ctx->m_max_textureSize != 0) {
-            *ptr = ctx->m_max_textureSize;
-        } else {
-            ctx->m_glGetIntegerv_enc(self, param, ptr);
-            ctx->m_max_textureSize = *ptr;
-        }
+        ctx->getCachedLimit(param, ptr, &ctx->m_max_textureSize);
+        break;
+    case GL_MAX_VERTEX_UNIFORM_VECTORS:
+        ctx->getCachedLimit(param, ptr, &ctx->m_max_vertexUniformVectors);
+        break;
+    case GL_MAX_FRAGMENT_UNIFORM_VECTORS:
+        ctx->getCachedLimit(param, ptr, &ctx->m_max_fragmentUniformVectors);
+        break;
+    case GL_MAX_VARYING_VECTORS:
+        ctx->getCachedLimit(param, ptr, &ctx->m_max_varyingVectors);
         break;
     case GL_MAX_VERTEX_ATTRIBS:
         if (!ctx->m_state->getClientStateParameter<GLint>(param, ptr)) {
@@ -315,6 +401,21 @@ void GL2Encoder::s_glGetIntegerv(void *self, GLenum param, GLint *ptr)
     }
 }
 
+void GL2Encoder::getCachedLimit(GLenum param, GLint *ptr, GLint *cache)
+{
+    if (*cache == 0) {
+        m_glGetIntegerv_enc(this, param, cache);
+        switch (param) {
+        case GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS:
+        case GL_MAX_VERTEX_TEXTURE_IMAGE_UNITS:
+        case GL_MAX_TEXTURE_IMAGE_UNITS:
+            *cache = MIN(*cache, GLClientState::MAX_TEXTURE_UNITS);
+            break;
+        }
+    }
+    *ptr = *cache;
+}
+
 
 void GL2Encoder::s_glGetFloatv(void *self, GLenum param, GLfloat *ptr)
 {
@@ -427,6 +528,17 @@ void GL2Encoder::s_glDisableVertexAttribArray(void *self, GLuint index)
     ctx->m_state->enable(index, 0);
 }
 
+void GL2Encoder::s_glVertexAttribDivisorEXT(void *self, GLuint index, GLuint divisor)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    assert(ctx->m_state);
+    GLint maxIndex;
+    ctx->glGetIntegerv(self, GL_MAX_VERTEX_ATTRIBS, &maxIndex);
+    SET_ERROR_IF(!(index < maxIndex), GL_INVALID_VALUE);
+    ctx->m_state->setDivisor(index, divisor);
+    ctx->m_glVertexAttribDivisorEXT_enc(self, index, divisor);
+}
+
 
 void GL2Encoder::s_glGetVertexAttribiv(void *self, GLuint index, GLenum pname, GLint *params)
 {
@@ -472,7 +584,7 @@ void GL2Encoder::s_glGetVertexAttribPointerv(void *self, GLuint index, GLenum pn
 }
 
 
-void GL2Encoder::sendVertexAttributes(GLint first, GLsizei count)
+void GL2Encoder::sendVertexAttributes(GLint first, GLsizei count, GLsizei primcount)
 {
     assert(m_state);
 
@@ -492,15 +604,33 @@ void GL2Encoder::sendVertexAttributes(GLint first, GLsizei count)
         if (state->enabled) {
             m_glEnableVertexAttribArray_enc(this, i);
 
-            unsigned int datalen = state->elementSize * count;
+            // Instanced attributes advance per instance rather than per
+            // vertex, so the vertex range doesn't apply to them.
+            GLint attribFirst = first;
+            GLsizei attribCount = count;
+            if (state->divisor != 0) {
+                attribFirst = 0;
+                attribCount = (primcount + state->divisor - 1) / state->divisor;
+            }
+
+            unsigned int datalen = state->elementSize * attribCount;
             int stride = state->stride == 0 ? state->elementSize : state->stride;
-            int firstIndex = stride * first;
+            int firstIndex = stride * attribFirst;
 
-            this->m_glBindBuffer_enc(this, GL_ARRAY_BUFFER, state->bufferObject);
             if (state->bufferObject == 0) {
+                // The host still has the array handed over with the last
+                // draw bound to this location, so leave it alone if the
+                // content didn't change.
+                unsigned char *data = (unsigned char *)state->data + firstIndex;
+                if (m_state->updateHostArray(i, data, state->stride, datalen)) {
+                    continue;
+                }
+                this->m_glBindBuffer_enc(this, GL_ARRAY_BUFFER, 0);
                 this->glVertexAttribPointerData(this, i, state->size, state->type, state->normalized, state->stride,
-                                                (unsigned char *)state->data + firstIndex, datalen);
+                                                data, datalen);
             } else {
+                m_state->invalidateHostArray(i);
+                this->m_glBindBuffer_enc(this, GL_ARRAY_BUFFER, state->bufferObject);
                 this->glVertexAttribPointerOffset(this, i, state->size, state->type, state->normalized, state->stride,
                                                   (uintptr_t) state->data + firstIndex);
             }
@@ -534,9 +664,21 @@ static bool isValidDrawType(GLenum mode) {
 void GL2Encoder::s_glDrawArrays(void *self, GLenum mode, GLint first, GLsizei count)
 {
     GL2Encoder *ctx = (GL2Encoder *)self;
+    ctx->drawArrays(mode, first, count, 1, false);
+}
+
+void GL2Encoder::s_glDrawArraysInstancedEXT(void *self, GLenum mode, GLint first, GLsizei count, GLsizei primcount)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    ctx->drawArrays(mode, first, count, primcount, true);
+}
+
+void GL2Encoder::drawArrays(GLenum mode, GLint first, GLsizei count, GLsizei primcount, bool instanced)
+{
+    GL2Encoder *ctx = this;
 
     SET_ERROR_IF(!isValidDrawMode(mode), GL_INVALID_ENUM);
-    SET_ERROR_IF(count<0, GL_INVALID_VALUE);
+    SET_ERROR_IF(count<0 || primcount<0, GL_INVALID_VALUE);
 
     bool has_arrays = false;
     int nLocations = ctx->m_state->nLocations();
@@ -558,17 +700,34 @@ void GL2Encoder::s_glDrawArrays(void *self, GLenum mode, GLint first, GLsizei co
         return;
     }
 
-    ctx->sendVertexAttributes(first, count);
-    ctx->m_glDrawArrays_enc(ctx, mode, 0, count);
+    ctx->sendVertexAttributes(first, count, primcount);
+    if (instanced) {
+        ctx->m_glDrawArraysInstancedEXT_enc(ctx, mode, 0, count, primcount);
+    } else {
+        ctx->m_glDrawArrays_enc(ctx, mode, 0, count);
+    }
 }
 
 void GL2Encoder::s_glDrawElements(void *self, GLenum mode, GLsizei count, GLenum type, const void *indices)
 {
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    ctx->drawElements(mode, count, type, indices, 1, false);
+}
 
+void GL2Encoder::s_glDrawElementsInstancedEXT(void *self, GLenum mode, GLsizei count, GLenum type,
+                                              const void *indices, GLsizei primcount)
+{
     GL2Encoder *ctx = (GL2Encoder *)self;
+    ctx->drawElements(mode, count, type, indices, primcount, true);
+}
+
+void GL2Encoder::drawElements(GLenum mode, GLsizei count, GLenum type, const void *indices,
+                              GLsizei primcount, bool instanced)
+{
+    GL2Encoder *ctx = this;
     assert(ctx->m_state != NULL);
     SET_ERROR_IF(!(isValidDrawMode(mode) && isValidDrawType(type)),GL_INVALID_ENUM);
-    SET_ERROR_IF(count<0, GL_INVALID_VALUE);
+    SET_ERROR_IF(count<0 || primcount<0, GL_INVALID_VALUE);
 
     bool has_immediate_arrays = false;
     bool has_indirect_arrays = false;
@@ -597,13 +756,17 @@ void GL2Encoder::s_glDrawElements(void *self, GLenum mode, GLsizei count, GLenum
     bool adjustIndices = true;
     if (ctx->m_state->currentIndexVbo() != 0) {
         if (!has_immediate_arrays) {
-            ctx->sendVertexAttributes(0, count);
-            ctx->m_glBindBuffer_enc(self, GL_ELEMENT_ARRAY_BUFFER, ctx->m_state->currentIndexVbo());
-            ctx->glDrawElementsOffset(ctx, mode, count, type, (uintptr_t)indices);
+            ctx->sendVertexAttributes(0, count, primcount);
+            ctx->m_glBindBuffer_enc(ctx, GL_ELEMENT_ARRAY_BUFFER, ctx->m_state->currentIndexVbo());
+            if (instanced) {
+                ctx->glDrawElementsInstancedOffsetANBOX(ctx, mode, count, type, (uintptr_t)indices, primcount);
+            } else {
+                ctx->glDrawElementsOffset(ctx, mode, count, type, (uintptr_t)indices);
+            }
             adjustIndices = false;
         } else {
             BufferData * buf = ctx->m_shared->getBufferData(ctx->m_state->currentIndexVbo());
-            ctx->m_glBindBuffer_enc(self, GL_ELEMENT_ARRAY_BUFFER, 0);
+            ctx->m_glBindBuffer_enc(ctx, GL_ELEMENT_ARRAY_BUFFER, 0);
             indices = (void*)((GLintptr)buf->m_fixedBuffer.ptr() + (GLintptr)indices);
         }
     }
@@ -646,9 +809,14 @@ void GL2Encoder::s_glDrawElements(void *self, GLenum mode, GLsizei count, GLenum
             ALOGE("unsupported index buffer type %d\n", type);
         }
         if (has_indirect_arrays || 1) {
-            ctx->sendVertexAttributes(minIndex, maxIndex - minIndex + 1);
-            ctx->glDrawElementsData(ctx, mode, count, type, adjustedIndices,
-                                    count * glSizeof(type));
+            ctx->sendVertexAttributes(minIndex, maxIndex - minIndex + 1, primcount);
+            if (instanced) {
+                ctx->glDrawElementsInstancedDataANBOX(ctx, mode, count, type, adjustedIndices,
+                                                      count * glSizeof(type), primcount);
+            } else {
+                ctx->glDrawElementsData(ctx, mode, count, type, adjustedIndices,
+                                        count * glSizeof(type));
+            }
             // XXX - OPTIMIZATION (see the other else branch) should be implemented
             if(!has_indirect_arrays) {
                 //ALOGD("unoptimized drawelements !!!\n");
@@ -799,6 +967,7 @@ void GL2Encoder::s_glFinish(void *self)
 {
     GL2Encoder *ctx = (GL2Encoder *)self;
     ctx->glFinishRoundTrip(self);
+    ctx->syncHostError();
 }
 
 void GL2Encoder::s_glLinkProgram(void * self, GLuint program)
@@ -806,34 +975,45 @@ void GL2Encoder::s_glLinkProgram(void * self, GLuint program)
     GL2Encoder *ctx = (GL2Encoder *)self;
     ctx->m_glLinkProgram_enc(self, program);
 
-    GLint linkStatus = 0;
-    ctx->glGetProgramiv(self,program,GL_LINK_STATUS,&linkStatus);
-    if (!linkStatus)
-        return;
+    // The link status and all active uniforms come back with a single
+    // round trip, see s_glGetLinkedProgramInfo on the host side.
+    GLint count = 1024;
+    GLint *info = NULL;
+    while (true) {
+        info = new GLint[count];
+        ctx->glGetLinkedProgramInfo(self, program, count * sizeof(GLint), info);
+        if (info[2] <= count)
+            break;
+        count = info[2];
+        delete[] info;
+    }
 
-    //get number of active uniforms in the program
-    GLint numUniforms=0;
-    ctx->glGetProgramiv(self, program, GL_ACTIVE_UNIFORMS, &numUniforms);
-    ctx->m_shared->initProgramData(program,numUniforms);
+    if (!info[0]) {
+        delete[] info;
+        return;
+    }
 
-    //get the length of the longest uniform name
-    GLint maxLength=0;
-    ctx->glGetProgramiv(self, program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    const GLint numUniforms = info[1];
+    ctx->m_shared->initProgramData(program, numUniforms);
 
-    GLint size;
-    GLenum type;
-    GLchar *name = new GLchar[maxLength+1];
-    GLint location;
+    const GLint *p = &info[3];
+    const GLint *end = &info[info[2] < 3 ? 3 : info[2]];
     //for each active uniform, get its size and starting location.
-    for (GLint i=0 ; i<numUniforms ; ++i)
+    for (GLint i = 0; i < numUniforms && p + 4 <= end; ++i)
     {
-        ctx->glGetActiveUniform(self, program, i, maxLength, NULL, &size, &type, name);
-        location = ctx->m_glGetUniformLocation_enc(self, program, name);
+        const GLint size = p[0];
+        const GLenum type = p[1];
+        const GLint location = p[2];
+        const size_t nameSize = (p[3] + sizeof(GLint)) / sizeof(GLint);
+        if (p[3] < 0 || p + 4 + nameSize > end)
+            break;
+        const GLchar *name = reinterpret_cast<const GLchar*>(&p[4]);
         ctx->m_shared->setProgramIndexInfo(program, i, location, size, type, name);
+        p += 4 + nameSize;
     }
     ctx->m_shared->setupLocationShiftWAR(program);
 
-    delete[] name;
+    delete[] info;
 }
 
 void GL2Encoder::s_glDeleteProgram(void *self, GLuint program)
@@ -963,7 +1143,11 @@ int GL2Encoder::s_glGetUniformLocation(void *self, GLuint program, const GLchar
         }
     }
 
-    int hostLoc = ctx->m_glGetUniformLocation_enc(self, program, name);
+    // Answered from what we got when the program was linked if possible.
+    GLint hostLoc = -1;
+    if (!ctx->m_shared->getProgramUniformLocation(program, name, &hostLoc)) {
+        hostLoc = ctx->m_glGetUniformLocation_enc(self, program, name);
+    }
     if (hostLoc >= 0 && needLocationWAR) {
         return ctx->m_shared->locationWARHostToApp(program, hostLoc, arrIndex);
     }
@@ -39,6 +39,15 @@ public:
     virtual void setError(GLenum error){ m_error = error; };
     virtual GLenum getError() { return m_error; };
 
+    // With deferred host errors glGetError() doesn't ask the host each
+    // time. It reports what was caught locally or what the host reported
+    // at the last sync point.
+    void setDeferHostErrors(bool defer) { m_deferHostErrors = defer; }
+    // Sync point for deferred host errors, called where the application
+    // waits for the host anyway. Only asks the host when the application
+    // looked for errors since the last one.
+    void syncHostError();
+
     void override2DTextureTarget(GLenum target);
     void restore2DTextureTarget();
 
@@ -48,17 +57,38 @@ private:
     GLClientState *m_state;
     GLSharedGroupPtr m_shared;
     GLenum  m_error;
+    bool    m_deferHostErrors;
+    bool    m_errorQueried;
 
     GLint *m_compressedTextureFormats;
     GLint m_num_compressedTextureFormats;
     GLint *getCompressedTextureFormats();
 
+    // Implementation limits don't change, so they're only queried from the
+    // host once and answered locally afterwards.
     GLint m_max_cubeMapTextureSize;
     GLint m_max_renderBufferSize;
     GLint m_max_textureSize;
+    GLint m_max_textureImageUnits;
+    GLint m_max_vertexTextureImageUnits;
+    GLint m_max_combinedTextureImageUnits;
+    GLint m_max_vertexUniformVectors;
+    GLint m_max_fragmentUniformVectors;
+    GLint m_max_varyingVectors;
+    void getCachedLimit(GLenum param, GLint *ptr, GLint *cache);
     FixedBuffer m_fixedBuffer;
 
-    void sendVertexAttributes(GLint first, GLsizei count);
+    // Instanced attributes are sent for |primcount| instances, all others
+    // from |first| on for |count| vertices.
+    void sendVertexAttributes(GLint first, GLsizei count, GLsizei primcount = 1);
+    // Shared by the plain and the instanced draw calls, |instanced| tells
+    // which of them to send.
+    void drawArrays(GLenum mode, GLint first, GLsizei count, GLsizei primcount, bool instanced);
+    void drawElements(GLenum mode, GLsizei count, GLenum type, const void *indices,
+                      GLsizei primcount, bool instanced);
+    // Waits for the host to read the last update of |memory| if necessary
+    // and destroys it.
+    void releaseSharedMemory(SharedBufferMemory *memory);
     bool updateHostTexture2DBinding(GLenum texUnit, GLenum newTarget);
     void checkValidUniformParam(void * self, GLsizei count, GLboolean transpose);
     void getHostLocation(void *self, GLint location, GLint *hostLoc);
@@ -73,6 +103,10 @@ private:
     glPixelStorei_client_proc_t m_glPixelStorei_enc;
     static void s_glPixelStorei(void *self, GLenum param, GLint value);
 
+    glReadPixelsAsyncANBOX_client_proc_t m_glReadPixelsAsyncANBOX_enc;
+    static void s_glReadPixelsAsyncANBOX(void *self, GLuint token, GLint x, GLint y,
+            GLsizei width, GLsizei height, GLenum format, GLenum type, GLsizei bufSize);
+
     glGetString_client_proc_t m_glGetString_enc;
     static const GLubyte * s_glGetString(void *self, GLenum name);
 
@@ -93,6 +127,13 @@ private:
     glDrawElements_client_proc_t m_glDrawElements_enc;
     static void s_glDrawElements(void *self, GLenum mode, GLsizei count, GLenum type, const void *indices);
 
+    glDrawArraysInstancedEXT_client_proc_t m_glDrawArraysInstancedEXT_enc;
+    static void s_glDrawArraysInstancedEXT(void *self, GLenum mode, GLint first, GLsizei count, GLsizei primcount);
+
+    glDrawElementsInstancedEXT_client_proc_t m_glDrawElementsInstancedEXT_enc;
+    static void s_glDrawElementsInstancedEXT(void *self, GLenum mode, GLsizei count, GLenum type,
+                                             const void *indices, GLsizei primcount);
+
 
     glGetIntegerv_client_proc_t m_glGetIntegerv_enc;
     static void s_glGetIntegerv(void *self, GLenum pname, GLint *ptr);
@@ -113,6 +154,9 @@ private:
     glDisableVertexAttribArray_client_proc_t m_glDisableVertexAttribArray_enc;
     static void s_glDisableVertexAttribArray(void *self, GLuint index);
 
+    glVertexAttribDivisorEXT_client_proc_t m_glVertexAttribDivisorEXT_enc;
+    static void s_glVertexAttribDivisorEXT(void *self, GLuint index, GLuint divisor);
+
     glGetVertexAttribiv_client_proc_t m_glGetVertexAttribiv_enc;
     static void s_glGetVertexAttribiv(void *self, GLuint index, GLenum pname, GLint *params);
 
@@ -218,6 +218,16 @@ int gl2_client_context_t::initDispatchByName(void *(*getProc)(const char *, void
 	glGetCompressedTextureFormats = (glGetCompressedTextureFormats_client_proc_t) getProc("glGetCompressedTextureFormats", userData);
 	glShaderString = (glShaderString_client_proc_t) getProc("glShaderString", userData);
 	glFinishRoundTrip = (glFinishRoundTrip_client_proc_t) getProc("glFinishRoundTrip", userData);
+	glGetLinkedProgramInfo = (glGetLinkedProgramInfo_client_proc_t) getProc("glGetLinkedProgramInfo", userData);
+	glReadPixelsAsyncANBOX = (glReadPixelsAsyncANBOX_client_proc_t) getProc("glReadPixelsAsyncANBOX", userData);
+	glFetchReadPixelsANBOX = (glFetchReadPixelsANBOX_client_proc_t) getProc("glFetchReadPixelsANBOX", userData);
+	glVertexAttribDivisorEXT = (glVertexAttribDivisorEXT_client_proc_t) getProc("glVertexAttribDivisorEXT", userData);
+	glDrawArraysInstancedEXT = (glDrawArraysInstancedEXT_client_proc_t) getProc("glDrawArraysInstancedEXT", userData);
+	glDrawElementsInstancedEXT = (glDrawElementsInstancedEXT_client_proc_t) getProc("glDrawElementsInstancedEXT", userData);
+	glDrawElementsInstancedOffsetANBOX = (glDrawElementsInstancedOffsetANBOX_client_proc_t) getProc("glDrawElementsInstancedOffsetANBOX", userData);
+	glDrawElementsInstancedDataANBOX = (glDrawElementsInstancedDataANBOX_client_proc_t) getProc("glDrawElementsInstancedDataANBOX", userData);
+	glBufferDataSharedANBOX = (glBufferDataSharedANBOX_client_proc_t) getProc("glBufferDataSharedANBOX", userData);
+	glBufferSubDataSharedANBOX = (glBufferSubDataSharedANBOX_client_proc_t) getProc("glBufferSubDataSharedANBOX", userData);
 	return 0;
 }
 
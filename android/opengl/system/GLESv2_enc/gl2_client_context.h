@@ -218,6 +218,16 @@ struct gl2_client_context_t {
 	glGetCompressedTextureFormats_client_proc_t glGetCompressedTextureFormats;
 	glShaderString_client_proc_t glShaderString;
 	glFinishRoundTrip_client_proc_t glFinishRoundTrip;
+	glGetLinkedProgramInfo_client_proc_t glGetLinkedProgramInfo;
+	glReadPixelsAsyncANBOX_client_proc_t glReadPixelsAsyncANBOX;
+	glFetchReadPixelsANBOX_client_proc_t glFetchReadPixelsANBOX;
+	glVertexAttribDivisorEXT_client_proc_t glVertexAttribDivisorEXT;
+	glDrawArraysInstancedEXT_client_proc_t glDrawArraysInstancedEXT;
+	glDrawElementsInstancedEXT_client_proc_t glDrawElementsInstancedEXT;
+	glDrawElementsInstancedOffsetANBOX_client_proc_t glDrawElementsInstancedOffsetANBOX;
+	glDrawElementsInstancedDataANBOX_client_proc_t glDrawElementsInstancedDataANBOX;
+	glBufferDataSharedANBOX_client_proc_t glBufferDataSharedANBOX;
+	glBufferSubDataSharedANBOX_client_proc_t glBufferSubDataSharedANBOX;
 	 virtual ~gl2_client_context_t() {}
 
 	typedef gl2_client_context_t *CONTEXT_ACCESSOR_TYPE(void);
@@ -217,6 +217,16 @@ typedef void (gl2_APIENTRY *glDrawElementsData_client_proc_t) (void * ctx, GLenu
 typedef void (gl2_APIENTRY *glGetCompressedTextureFormats_client_proc_t) (void * ctx, int, GLint*);
 typedef void (gl2_APIENTRY *glShaderString_client_proc_t) (void * ctx, GLuint, const GLchar*, GLsizei);
 typedef int (gl2_APIENTRY *glFinishRoundTrip_client_proc_t) (void * ctx);
+typedef void (gl2_APIENTRY *glGetLinkedProgramInfo_client_proc_t) (void * ctx, GLuint, GLsizei, GLint*);
+typedef void (gl2_APIENTRY *glReadPixelsAsyncANBOX_client_proc_t) (void * ctx, GLuint, GLint, GLint, GLsizei, GLsizei, GLenum, GLenum, GLsizei);
+typedef void (gl2_APIENTRY *glFetchReadPixelsANBOX_client_proc_t) (void * ctx, GLuint, GLsizei, GLvoid*);
+typedef void (gl2_APIENTRY *glVertexAttribDivisorEXT_client_proc_t) (void * ctx, GLuint, GLuint);
+typedef void (gl2_APIENTRY *glDrawArraysInstancedEXT_client_proc_t) (void * ctx, GLenum, GLint, GLsizei, GLsizei);
+typedef void (gl2_APIENTRY *glDrawElementsInstancedEXT_client_proc_t) (void * ctx, GLenum, GLsizei, GLenum, const void*, GLsizei);
+typedef void (gl2_APIENTRY *glDrawElementsInstancedOffsetANBOX_client_proc_t) (void * ctx, GLenum, GLsizei, GLenum, GLuint, GLsizei);
+typedef void (gl2_APIENTRY *glDrawElementsInstancedDataANBOX_client_proc_t) (void * ctx, GLenum, GLsizei, GLenum, void*, GLuint, GLsizei);
+typedef void (gl2_APIENTRY *glBufferDataSharedANBOX_client_proc_t) (void * ctx, GLenum, GLsizeiptr, GLenum, GLuint, GLuint);
+typedef void (gl2_APIENTRY *glBufferSubDataSharedANBOX_client_proc_t) (void * ctx, GLenum, GLintptr, GLsizeiptr, GLuint, GLuint);
 
 
 #endif
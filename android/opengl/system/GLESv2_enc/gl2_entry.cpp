@@ -214,6 +214,16 @@ extern "C" {
 	void glGetCompressedTextureFormats(int count, GLint* formats);
 	void glShaderString(GLuint shader, const GLchar* string, GLsizei len);
 	int glFinishRoundTrip();
+	void glGetLinkedProgramInfo(GLuint program, GLsizei bufSize, GLint* info);
+	void glReadPixelsAsyncANBOX(GLuint token, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLsizei bufSize);
+	void glFetchReadPixelsANBOX(GLuint token, GLsizei bufSize, GLvoid* pixels);
+	void glVertexAttribDivisorEXT(GLuint index, GLuint divisor);
+	void glDrawArraysInstancedEXT(GLenum mode, GLint start, GLsizei count, GLsizei primcount);
+	void glDrawElementsInstancedEXT(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei primcount);
+	void glDrawElementsInstancedOffsetANBOX(GLenum mode, GLsizei count, GLenum type, GLuint offset, GLsizei primcount);
+	void glDrawElementsInstancedDataANBOX(GLenum mode, GLsizei count, GLenum type, void* data, GLuint datalen, GLsizei primcount);
+	void glBufferDataSharedANBOX(GLenum target, GLsizeiptr size, GLenum usage, GLuint memory, GLuint sequence);
+	void glBufferSubDataSharedANBOX(GLenum target, GLintptr offset, GLsizeiptr size, GLuint memory, GLuint sequence);
 };
 
 #endif
@@ -1481,3 +1491,63 @@ int glFinishRoundTrip()
 	return ctx->glFinishRoundTrip(ctx);
 }
 
+void glGetLinkedProgramInfo(GLuint program, GLsizei bufSize, GLint* info)
+{
+	GET_CONTEXT;
+	ctx->glGetLinkedProgramInfo(ctx, program, bufSize, info);
+}
+
+void glReadPixelsAsyncANBOX(GLuint token, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLsizei bufSize)
+{
+	GET_CONTEXT;
+	ctx->glReadPixelsAsyncANBOX(ctx, token, x, y, width, height, format, type, bufSize);
+}
+
+void glFetchReadPixelsANBOX(GLuint token, GLsizei bufSize, GLvoid* pixels)
+{
+	GET_CONTEXT;
+	ctx->glFetchReadPixelsANBOX(ctx, token, bufSize, pixels);
+}
+
+void glVertexAttribDivisorEXT(GLuint index, GLuint divisor)
+{
+	GET_CONTEXT;
+	ctx->glVertexAttribDivisorEXT(ctx, index, divisor);
+}
+
+void glDrawArraysInstancedEXT(GLenum mode, GLint start, GLsizei count, GLsizei primcount)
+{
+	GET_CONTEXT;
+	ctx->glDrawArraysInstancedEXT(ctx, mode, start, count, primcount);
+}
+
+void glDrawElementsInstancedEXT(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei primcount)
+{
+	GET_CONTEXT;
+	ctx->glDrawElementsInstancedEXT(ctx, mode, count, type, indices, primcount);
+}
+
+void glDrawElementsInstancedOffsetANBOX(GLenum mode, GLsizei count, GLenum type, GLuint offset, GLsizei primcount)
+{
+	GET_CONTEXT;
+	ctx->glDrawElementsInstancedOffsetANBOX(ctx, mode, count, type, offset, primcount);
+}
+
+void glDrawElementsInstancedDataANBOX(GLenum mode, GLsizei count, GLenum type, void* data, GLuint datalen, GLsizei primcount)
+{
+	GET_CONTEXT;
+	ctx->glDrawElementsInstancedDataANBOX(ctx, mode, count, type, data, datalen, primcount);
+}
+
+void glBufferDataSharedANBOX(GLenum target, GLsizeiptr size, GLenum usage, GLuint memory, GLuint sequence)
+{
+	GET_CONTEXT;
+	ctx->glBufferDataSharedANBOX(ctx, target, size, usage, memory, sequence);
+}
+
+void glBufferSubDataSharedANBOX(GLenum target, GLintptr offset, GLsizeiptr size, GLuint memory, GLuint sequence)
+{
+	GET_CONTEXT;
+	ctx->glBufferSubDataSharedANBOX(ctx, target, offset, size, memory, sequence);
+}
+
@@ -209,6 +209,11 @@ static const struct _gl2_funcs_by_name {
 	{"glExtGetProgramBinarySourceQCOM", (void*)glExtGetProgramBinarySourceQCOM},
 	{"glStartTilingQCOM", (void*)glStartTilingQCOM},
 	{"glEndTilingQCOM", (void*)glEndTilingQCOM},
+	{"glReadPixelsAsyncANBOX", (void*)glReadPixelsAsyncANBOX},
+	{"glFetchReadPixelsANBOX", (void*)glFetchReadPixelsANBOX},
+	{"glVertexAttribDivisorEXT", (void*)glVertexAttribDivisorEXT},
+	{"glDrawArraysInstancedEXT", (void*)glDrawArraysInstancedEXT},
+	{"glDrawElementsInstancedEXT", (void*)glDrawElementsInstancedEXT},
 };
 static const int gl2_num_funcs = sizeof(gl2_funcs_by_name) / sizeof(struct _gl2_funcs_by_name);
 
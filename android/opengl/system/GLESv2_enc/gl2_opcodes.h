@@ -211,7 +211,17 @@
 #define OP_glGetCompressedTextureFormats 					2253
 #define OP_glShaderString 					2254
 #define OP_glFinishRoundTrip 					2255
-#define OP_last 					2256
+#define OP_glGetLinkedProgramInfo 					2256
+#define OP_glReadPixelsAsyncANBOX 					2257
+#define OP_glFetchReadPixelsANBOX 					2258
+#define OP_glVertexAttribDivisorEXT 					2259
+#define OP_glDrawArraysInstancedEXT 					2260
+#define OP_glDrawElementsInstancedEXT 					2261
+#define OP_glDrawElementsInstancedOffsetANBOX 					2262
+#define OP_glDrawElementsInstancedDataANBOX 					2263
+#define OP_glBufferDataSharedANBOX 					2264
+#define OP_glBufferSubDataSharedANBOX 					2265
+#define OP_last 					2266
 
 
 #endif
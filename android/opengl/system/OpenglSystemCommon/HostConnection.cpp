@@ -18,13 +18,19 @@
 #include "QemuPipeStream.h"
 #include "ThreadInfo.h"
 #include <cutils/log.h>
+#include <cutils/properties.h>
 #include "GLEncoder.h"
 #include "GL2Encoder.h"
 #include <memory>
+#include <stdio.h>
+#include <string.h>
 
 #define STREAM_BUFFER_SIZE  4*1024*1024
 #define STREAM_PORT_NUM     22468
 
+/* Number of frames the stream statistics are accumulated over */
+#define STREAM_STATS_FRAMES 120
+
 /* Set to 1 to use a QEMU pipe, or 0 for a TCP connection */
 #define  USE_QEMU_PIPE  1
 
@@ -33,8 +39,54 @@ HostConnection::HostConnection() :
     m_glEnc(NULL),
     m_gl2Enc(NULL),
     m_rcEnc(NULL),
-    m_checksumHelper()
+    m_checksumHelper(),
+    m_logStreamStats(false),
+    m_statsFrames(0),
+    m_deferGLErrors(false)
 {
+    char prop[PROPERTY_VALUE_MAX];
+    property_get("debug.anbox.gl.stream_stats", prop, "0");
+    m_logStreamStats = atoi(prop) != 0;
+
+    property_get("debug.anbox.gl.defer_errors", prop, "0");
+    m_deferGLErrors = deferGLErrors(prop);
+}
+
+// debug.anbox.gl.defer_errors is either 1 to defer errors in all
+// processes or a comma separated list of the processes to defer errors in.
+bool HostConnection::deferGLErrors(const char *prop)
+{
+    if (!strcmp(prop, "1")) {
+        return true;
+    }
+    if (!prop[0] || !strcmp(prop, "0")) {
+        return false;
+    }
+
+    char name[PROPERTY_VALUE_MAX] = "";
+    FILE *f = fopen("/proc/self/cmdline", "r");
+    if (!f) {
+        return false;
+    }
+    const bool haveName = fgets(name, sizeof(name), f) != NULL;
+    fclose(f);
+    if (!haveName || !name[0]) {
+        return false;
+    }
+
+    const size_t len = strlen(name);
+    for (const char *p = prop; *p; ) {
+        const char *end = strchr(p, ',');
+        const size_t n = end ? size_t(end - p) : strlen(p);
+        if (n == len && !strncmp(p, name, n)) {
+            return true;
+        }
+        p += n;
+        if (*p == ',') {
+            p++;
+        }
+    }
+    return false;
 }
 
 HostConnection::~HostConnection()
@@ -108,12 +160,36 @@ HostConnection *HostConnection::get()
     return tinfo->hostConn;
 }
 
+void HostConnection::frameDone()
+{
+    if (!m_stream) {
+        return;
+    }
+
+    m_stream->flush();
+
+    if (!m_logStreamStats || ++m_statsFrames < STREAM_STATS_FRAMES) {
+        return;
+    }
+
+    const IOStream::Stats &stats = m_stream->stats();
+    ALOGD("HostConnection %p: %.1f flushes/frame, %zu bytes/flush, "
+          "%.1f round trips/frame\n", this,
+          float(stats.flushes) / m_statsFrames,
+          stats.flushes ? stats.flushedBytes / stats.flushes : 0,
+          float(stats.readbacks) / m_statsFrames);
+
+    m_stream->resetStats();
+    m_statsFrames = 0;
+}
+
 GLEncoder *HostConnection::glEncoder()
 {
     if (!m_glEnc) {
         m_glEnc = new GLEncoder(m_stream, checksumHelper());
         DBG("HostConnection::glEncoder new encoder %p, tid %d", m_glEnc, gettid());
         m_glEnc->setContextAccessor(s_getGLContext);
+        m_glEnc->setDeferHostErrors(m_deferGLErrors);
     }
     return m_glEnc;
 }
@@ -124,6 +200,7 @@ GL2Encoder *HostConnection::gl2Encoder()
         m_gl2Enc = new GL2Encoder(m_stream, checksumHelper());
         DBG("HostConnection::gl2Encoder new encoder %p, tid %d", m_gl2Enc, gettid());
         m_gl2Enc->setContextAccessor(s_getGL2Context);
+        m_gl2Enc->setDeferHostErrors(m_deferGLErrors);
     }
     return m_gl2Enc;
 }
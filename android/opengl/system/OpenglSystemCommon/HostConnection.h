@@ -42,6 +42,11 @@ public:
         }
     }
 
+    // Flush point at the end of a frame. When the debug.anbox.gl.stream_stats
+    // property is set this also periodically logs how the command stream
+    // was committed to the host.
+    void frameDone();
+
 private:
     HostConnection();
     static gl_client_context_t  *s_getGLContext();
@@ -49,6 +54,7 @@ private:
     // setProtocol initilizes GL communication protocol for checksums
     // should be called when m_rcEnc is created
     void setChecksumHelper(renderControl_encoder_context_t *rcEnc);
+    static bool deferGLErrors(const char *prop);
 
 private:
     IOStream *m_stream;
@@ -56,6 +62,9 @@ private:
     GL2Encoder  *m_gl2Enc;
     renderControl_encoder_context_t *m_rcEnc;
     ChecksumCalculator m_checksumHelper;
+    bool m_logStreamStats;
+    unsigned int m_statsFrames;
+    bool m_deferGLErrors;
 };
 
 #endif
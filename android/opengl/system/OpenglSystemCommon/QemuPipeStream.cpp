@@ -20,12 +20,15 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <sys/uio.h>
 
 QemuPipeStream::QemuPipeStream(size_t bufSize) :
     IOStream(bufSize),
     m_sock(-1),
     m_bufsize(bufSize),
-    m_buf(NULL)
+    m_buf(NULL),
+    m_defaultBufsize(bufSize),
+    m_idleAllocs(0)
 {
 }
 
@@ -33,7 +36,9 @@ QemuPipeStream::QemuPipeStream(int sock, size_t bufSize) :
     IOStream(bufSize),
     m_sock(sock),
     m_bufsize(bufSize),
-    m_buf(NULL)
+    m_buf(NULL),
+    m_defaultBufsize(bufSize),
+    m_idleAllocs(0)
 {
 }
 
@@ -58,20 +63,40 @@ int QemuPipeStream::connect(void)
 
 void *QemuPipeStream::allocBuffer(size_t minSize)
 {
-    size_t allocSize = (m_bufsize < minSize ? minSize : m_bufsize);
-    if (!m_buf) {
-        m_buf = (unsigned char *)malloc(allocSize);
+    size_t allocSize = m_bufsize;
+    if (!m_buf || m_bufsize < minSize) {
+        // Grow geometrically so a series of growing commands doesn't
+        // reallocate and copy the buffer for each of them.
+        if (m_buf) {
+            allocSize *= 2;
+        }
+        if (allocSize < minSize) {
+            allocSize = minSize;
+        }
+        m_idleAllocs = 0;
+    }
+    else if (m_bufsize > m_defaultBufsize && minSize <= m_defaultBufsize) {
+        // Give the memory of a past spike back once it wasn't needed for
+        // a while.
+        if (++m_idleAllocs >= kShrinkAfterIdleAllocs) {
+            allocSize = m_defaultBufsize;
+            m_idleAllocs = 0;
+        }
     }
-    else if (m_bufsize < allocSize) {
+    else {
+        m_idleAllocs = 0;
+    }
+
+    if (!m_buf || allocSize != m_bufsize) {
         unsigned char *p = (unsigned char *)realloc(m_buf, allocSize);
         if (p != NULL) {
             m_buf = p;
             m_bufsize = allocSize;
         } else {
-            ERR("realloc (%d) failed\n", allocSize);
+            ERR("realloc (%zu) failed\n", allocSize);
             free(m_buf);
             m_buf = NULL;
-            m_bufsize = 0;
+            m_bufsize = m_defaultBufsize;
         }
     }
 
@@ -83,6 +108,54 @@ int QemuPipeStream::commitBuffer(size_t size)
     return writeFully(m_buf, size);
 }
 
+int QemuPipeStream::commitBufferWith(size_t size, const void *buf, size_t len)
+{
+    if (!valid()) return -1;
+    if (!buf && len > 0) {
+        ERR("QemuPipeStream::commitBufferWith failed, buf=NULL, len %zu,"
+                " lethal error, exiting", len);
+        abort();
+    }
+
+    // The payload is written from where the caller has it instead of
+    // being copied behind the pending commands first.
+    struct iovec iov[2];
+    iov[0].iov_base = m_buf;
+    iov[0].iov_len = size;
+    iov[1].iov_base = const_cast<void *>(buf);
+    iov[1].iov_len = len;
+
+    struct iovec *it = iov;
+    int count = 2;
+    while (count > 0) {
+        ssize_t stat = ::writev(m_sock, it, count);
+        if (stat > 0) {
+            size_t written = stat;
+            while (count > 0 && written >= it->iov_len) {
+                written -= it->iov_len;
+                it++;
+                count--;
+            }
+            if (count > 0) {
+                it->iov_base = (char *)it->iov_base + written;
+                it->iov_len -= written;
+            }
+            continue;
+        }
+        if (stat == 0) { /* EOF */
+            ERR("QemuPipeStream::commitBufferWith failed: premature EOF\n");
+            return -1;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        ERR("QemuPipeStream::commitBufferWith failed: %s, lethal error, exiting.\n",
+                strerror(errno));
+        abort();
+    }
+    return 0;
+}
+
 int QemuPipeStream::writeFully(const void *buf, size_t len)
 {
     //DBG(">> QemuPipeStream::writeFully %d\n", len);
@@ -33,6 +33,7 @@ public:
 
     virtual void *allocBuffer(size_t minSize);
     virtual int commitBuffer(size_t size);
+    virtual int commitBufferWith(size_t size, const void *buf, size_t len);
     virtual const unsigned char *readFully( void *buf, size_t len);
     virtual const unsigned char *read( void *buf, size_t *inout_len);
 
@@ -42,9 +43,15 @@ public:
     virtual int writeFully(const void *buf, size_t len);
 
 private:
+    // Number of buffers in a row which would have fit into the default
+    // size after which a grown buffer is shrunk again.
+    static const unsigned int kShrinkAfterIdleAllocs = 64;
+
     int m_sock;
     size_t m_bufsize;
     unsigned char *m_buf;
+    const size_t m_defaultBufsize;
+    unsigned int m_idleAllocs;
     QemuPipeStream(int sock, size_t bufSize);
 };
 
@@ -22,6 +22,22 @@
 #include <cutils/native_handle.h>
 
 #define BUFFER_HANDLE_MAGIC ((int)0xabfabfab)
+
+//
+// What the host is told a color buffer is used for, it only allocates the
+// storage these uses need.
+// NOTE: Keep in sync with ColorBuffer::Usage on the host.
+//
+enum {
+    CB_USAGE_RENDER    = 1 << 0,   // rendered into by GL
+    CB_USAGE_SAMPLE    = 1 << 1,   // sampled by GL
+    CB_USAGE_CPU_WRITE = 1 << 2,
+    CB_USAGE_CPU_READ  = 1 << 3,
+    CB_USAGE_YV12      = 1 << 4,   // video frames uploaded as YV12 planes
+    CB_USAGE_NV21      = 1 << 5,   // video frames uploaded as NV21 planes
+    CB_USAGE_COMPOSE   = 1 << 6,   // composed by the host
+};
+
 #define CB_HANDLE_NUM_INTS(nfds) (int)((sizeof(cb_handle_t) - (nfds)*sizeof(int)) / sizeof(int))
 
 //
@@ -49,7 +65,8 @@ struct cb_handle_t : public native_handle {
         lockedTop(0),
         lockedWidth(0),
         lockedHeight(0),
-        hostHandle(0)
+        hostHandle(0),
+        hostMemoryShared(0)
     {
         version = sizeof(native_handle);
         numFds = 0;
@@ -108,6 +125,7 @@ struct cb_handle_t : public native_handle {
     int lockedWidth;
     int lockedHeight;
     uint32_t hostHandle;
+    int hostMemoryShared;   // host uploads s/w writes straight from the ashmem region
 };
 
 
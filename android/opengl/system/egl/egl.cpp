@@ -19,6 +19,7 @@
 #include "eglDisplay.h"
 #include "egl_ftable.h"
 #include <cutils/log.h>
+#include <pthread.h>
 #include "gralloc_cb.h"
 #include "GLClientState.h"
 #include "GLSharedGroup.h"
@@ -138,11 +139,6 @@ EGLContext_t::EGLContext_t(EGLDisplay dpy, EGLConfig config, EGLContext_t* share
     draw(EGL_NO_SURFACE),
     shareCtx(shareCtx),
     rcContext(0),
-    versionString(NULL),
-    vendorString(NULL),
-    rendererString(NULL),
-    shaderVersionString(NULL),
-    extensionString(NULL),
     deletePending(0)
 {
     flags = 0;
@@ -157,11 +153,6 @@ EGLContext_t::EGLContext_t(EGLDisplay dpy, EGLConfig config, EGLContext_t* share
 EGLContext_t::~EGLContext_t()
 {
     delete clientState;
-    delete [] versionString;
-    delete [] vendorString;
-    delete [] rendererString;
-    delete [] shaderVersionString;
-    delete [] extensionString;
 }
 
 // ----------------------------------------------------------------------------
@@ -407,6 +398,32 @@ egl_pbuffer_surface_t* egl_pbuffer_surface_t::create(EGLDisplay dpy,
     return pb;
 }
 
+// GL strings only depend on the host and on the client API version of the
+// context they're queried for, so they're fetched once per process and
+// shared by all contexts of the same version afterwards.
+static pthread_mutex_t s_glStringLock = PTHREAD_MUTEX_INITIALIZER;
+static const char *s_glStrings[2][5];
+
+// Most strings fit into this, which saves the round trip for querying the
+// size first.
+#define GL_STRING_INITIAL_SIZE 4096
+
+static char *queryHostGLString(renderControl_encoder_context_t *rcEnc, int glEnum)
+{
+    char *hostStr = new char[GL_STRING_INITIAL_SIZE];
+    int n = rcEnc->rcGetGLString(rcEnc, glEnum, hostStr, GL_STRING_INITIAL_SIZE);
+    if (n < 0) {
+        delete [] hostStr;
+        hostStr = new char[-n+1];
+        n = rcEnc->rcGetGLString(rcEnc, glEnum, hostStr, -n);
+    }
+    if (n <= 0) {
+        delete [] hostStr;
+        hostStr = NULL;
+    }
+    return hostStr;
+}
+
 static const char *getGLString(int glEnum)
 {
     EGLThreadInfo *tInfo = getEGLThreadInfo();
@@ -414,63 +431,71 @@ static const char *getGLString(int glEnum)
         return NULL;
     }
 
-    const char** strPtr = NULL;
-
 #define GL_VENDOR                         0x1F00
 #define GL_RENDERER                       0x1F01
 #define GL_VERSION                        0x1F02
 #define GL_SHADING_LANGUAGE_VERSION       0x8B8C
 #define GL_EXTENSIONS                     0x1F03
 
+    int index = -1;
     switch(glEnum) {
         case GL_VERSION:
-            strPtr = &tInfo->currentContext->versionString;
+            index = 0;
             break;
         case GL_VENDOR:
-            strPtr = &tInfo->currentContext->vendorString;
+            index = 1;
             break;
         case GL_RENDERER:
-            strPtr = &tInfo->currentContext->rendererString;
+            index = 2;
             break;
         case GL_SHADING_LANGUAGE_VERSION:
-            strPtr = &tInfo->currentContext->shaderVersionString;
+            index = 3;
             break;
         case GL_EXTENSIONS:
-            strPtr = &tInfo->currentContext->extensionString;
+            index = 4;
             break;
     }
 
-    if (!strPtr) {
+    if (index < 0) {
         return NULL;
     }
 
-    if (*strPtr != NULL) {
+    const char **strPtr =
+            &s_glStrings[tInfo->currentContext->version > 1 ? 1 : 0][index];
+
+    pthread_mutex_lock(&s_glStringLock);
+    const char *str = *strPtr;
+    pthread_mutex_unlock(&s_glStringLock);
+
+    if (str != NULL) {
         //
         // string is already cached
         //
-        return *strPtr;
+        return str;
     }
 
     //
     // first query of that string - need to query host
     //
     DEFINE_AND_VALIDATE_HOST_CONNECTION(NULL);
-    char *hostStr = NULL;
-    int n = rcEnc->rcGetGLString(rcEnc, glEnum, NULL, 0);
-    if (n < 0) {
-        hostStr = new char[-n+1];
-        n = rcEnc->rcGetGLString(rcEnc, glEnum, hostStr, -n);
-        if (n <= 0) {
-            delete [] hostStr;
-            hostStr = NULL;
-        }
+    char *hostStr = queryHostGLString(rcEnc, glEnum);
+    if (!hostStr) {
+        return NULL;
     }
 
     //
-    // keep the string in the context and return its value
+    // keep the string for the rest of the process lifetime, possibly
+    // dropping ours if another thread was faster
     //
-    *strPtr = hostStr;
-    return hostStr;
+    pthread_mutex_lock(&s_glStringLock);
+    if (*strPtr == NULL) {
+        *strPtr = hostStr;
+    } else {
+        delete [] hostStr;
+    }
+    str = *strPtr;
+    pthread_mutex_unlock(&s_glStringLock);
+    return str;
 }
 
 // ----------------------------------------------------------------------------
@@ -1174,7 +1199,17 @@ EGLBoolean eglSwapBuffers(EGLDisplay dpy, EGLSurface eglSurface)
     // post the surface
     d->swapBuffers();
 
-    hostCon->flush();
+    // Deferred GL errors are picked up once a frame at the latest.
+    EGLThreadInfo *tInfo = getEGLThreadInfo();
+    if (tInfo && tInfo->currentContext) {
+        if (tInfo->currentContext->version == 2) {
+            hostCon->gl2Encoder()->syncHostError();
+        } else {
+            hostCon->glEncoder()->syncHostError();
+        }
+    }
+
+    hostCon->frameDone();
     return EGL_TRUE;
 }
 
@@ -1300,14 +1335,16 @@ EGLBoolean eglDestroyImageKHR(EGLDisplay dpy, EGLImageKHR img)
 
 #define FENCE_SYNC_HANDLE (EGLSyncKHR)0xFE4CE
 
+// A fence living on the host. Hosts without KHR_fence_sync return no
+// handle, in that case we finish right away and hand out
+// FENCE_SYNC_HANDLE which is always signaled.
+struct EGLSync_t {
+    uint32_t host_sync;
+};
+
 EGLSyncKHR eglCreateSyncKHR(EGLDisplay dpy, EGLenum type,
         const EGLint *attrib_list)
 {
-    // TODO: This implementation could be faster. We should require the host EGL
-    // to support KHR_fence_sync, or at least pipe the fence command to the host
-    // and wait for it (probably involving a glFinish on the host) in
-    // eglClientWaitSyncKHR.
-
     VALIDATE_DISPLAY(dpy, EGL_NO_SYNC_KHR);
 
     if (type != EGL_SYNC_FENCE_KHR ||
@@ -1320,6 +1357,16 @@ EGLSyncKHR eglCreateSyncKHR(EGLDisplay dpy, EGLenum type,
         setErrorReturn(EGL_BAD_MATCH, EGL_NO_SYNC_KHR);
     }
 
+    DEFINE_AND_VALIDATE_HOST_CONNECTION(EGL_NO_SYNC_KHR);
+    // The GL commands of this thread go through the same stream so the
+    // host fence comes after all of them.
+    uint32_t host_sync = rcEnc->rcCreateSyncKHR(rcEnc);
+    if (host_sync) {
+        EGLSync_t *sync = new EGLSync_t;
+        sync->host_sync = host_sync;
+        return (EGLSyncKHR)sync;
+    }
+
     if (tInfo->currentContext->version == 2) {
         s_display.gles2_iface()->finish();
     } else {
@@ -1333,33 +1380,48 @@ EGLBoolean eglDestroySyncKHR(EGLDisplay dpy, EGLSyncKHR sync)
 {
     (void)dpy;
 
-    if (sync != FENCE_SYNC_HANDLE) {
+    if (sync == EGL_NO_SYNC_KHR) {
         setErrorReturn(EGL_BAD_PARAMETER, EGL_FALSE);
     }
 
-    return EGL_TRUE;
+    if (sync == FENCE_SYNC_HANDLE) {
+        return EGL_TRUE;
+    }
+
+    EGLSync_t *s = (EGLSync_t *)sync;
+    uint32_t host_sync = s->host_sync;
+    delete s;
+    DEFINE_AND_VALIDATE_HOST_CONNECTION(EGL_FALSE);
+    return rcEnc->rcDestroySyncKHR(rcEnc, host_sync);
 }
 
 EGLint eglClientWaitSyncKHR(EGLDisplay dpy, EGLSyncKHR sync, EGLint flags,
         EGLTimeKHR timeout)
 {
     (void)dpy;
-    (void)flags;
-    (void)timeout;
 
-    if (sync != FENCE_SYNC_HANDLE) {
+    if (sync == EGL_NO_SYNC_KHR) {
         setErrorReturn(EGL_BAD_PARAMETER, EGL_FALSE);
     }
 
-    return EGL_CONDITION_SATISFIED_KHR;
+    if (sync == FENCE_SYNC_HANDLE) {
+        return EGL_CONDITION_SATISFIED_KHR;
+    }
+
+    DEFINE_AND_VALIDATE_HOST_CONNECTION(EGL_FALSE);
+    EGLint ret = rcEnc->rcClientWaitSyncKHR(rcEnc,
+            ((EGLSync_t *)sync)->host_sync, flags,
+            (uint32_t)(timeout >> 32), (uint32_t)timeout);
+    if (ret == EGL_FALSE) {
+        setErrorReturn(EGL_BAD_PARAMETER, EGL_FALSE);
+    }
+    return ret;
 }
 
 EGLBoolean eglGetSyncAttribKHR(EGLDisplay dpy, EGLSyncKHR sync,
         EGLint attribute, EGLint *value)
 {
-    (void)dpy;
-
-    if (sync != FENCE_SYNC_HANDLE) {
+    if (sync == EGL_NO_SYNC_KHR) {
         setErrorReturn(EGL_BAD_PARAMETER, EGL_FALSE);
     }
 
@@ -1368,7 +1430,13 @@ EGLBoolean eglGetSyncAttribKHR(EGLDisplay dpy, EGLSyncKHR sync,
         *value = EGL_SYNC_FENCE_KHR;
         return EGL_TRUE;
     case EGL_SYNC_STATUS_KHR:
-        *value = EGL_SIGNALED_KHR;
+        // A wait without timeout only polls the host fence.
+        if (sync != FENCE_SYNC_HANDLE &&
+                eglClientWaitSyncKHR(dpy, sync, 0, 0) == EGL_TIMEOUT_EXPIRED_KHR) {
+            *value = EGL_UNSIGNALED_KHR;
+        } else {
+            *value = EGL_SIGNALED_KHR;
+        }
         return EGL_TRUE;
     case EGL_SYNC_CONDITION_KHR:
         *value = EGL_SYNC_PRIOR_COMMANDS_COMPLETE_KHR;
@@ -36,11 +36,6 @@ struct EGLContext_t {
     EGLContext_t    *   shareCtx;
     EGLint                version;
     uint32_t             rcContext;
-    const char*         versionString;
-    const char*         vendorString;
-    const char*         rendererString;
-    const char*         shaderVersionString;
-    const char*         extensionString;
     EGLint              deletePending;
     GLClientState * getClientState(){ return clientState; }
     GLSharedGroupPtr getSharedGroup(){ return sharedGroup; }
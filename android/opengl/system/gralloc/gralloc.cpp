@@ -21,6 +21,8 @@
 #include <errno.h>
 #include <dlfcn.h>
 #include <sys/mman.h>
+#include <sys/socket.h>
+#include <hardware/qemu_pipe.h>
 #include "gralloc_cb.h"
 #include "HostConnection.h"
 #include "glUtils.h"
@@ -60,11 +62,23 @@ static pthread_once_t     sFallbackOnce = PTHREAD_ONCE_INIT;
 static void fallback_init(void);  // forward
 
 
-typedef struct _alloc_list_node {
-    buffer_handle_t handle;
-    _alloc_list_node *next;
-    _alloc_list_node *prev;
-} AllocListNode;
+// Every buffer we allocate is its own node of the allocated list so that
+// gralloc_free unlinks it without searching the list. Only the cb_handle_t
+// part goes to other processes, numInts doesn't cover the links.
+struct AllocListNode : public cb_handle_t {
+    AllocListNode(int p_fd, int p_ashmemSize, int p_usage,
+                  int p_width, int p_height, int p_frameworkFormat,
+                  int p_format, int p_glFormat, int p_glType) :
+        cb_handle_t(p_fd, p_ashmemSize, p_usage, p_width, p_height,
+                    p_frameworkFormat, p_format, p_glFormat, p_glType),
+        next(NULL),
+        prev(NULL)
+    {
+    }
+
+    AllocListNode *next;
+    AllocListNode *prev;
+};
 
 //
 // Our gralloc device structure (alloc interface)
@@ -102,6 +116,120 @@ static int map_buffer(cb_handle_t *cb, void **vaddr)
     return 0;
 }
 
+//
+// Hand the ashmem region of a buffer to the host so that it can upload
+// s/w written content straight from the shared memory and only the dirty
+// rectangle has to go through the pipe. This only works when the pipe is
+// a unix socket able to carry file descriptors, i.e. when running in a
+// container sharing the kernel with the host. The host side lives in
+// src/anbox/qemu/pipe_connection_creator.cpp.
+//
+static bool sShareBufferMemory = true;
+
+static bool share_buffer_memory(cb_handle_t *cb)
+{
+    if (!sShareBufferMemory) {
+        return false;
+    }
+
+    int sock = qemu_pipe_open("anbox:gralloc-memory");
+    if (sock < 0) {
+        return false;
+    }
+
+    struct {
+        uint32_t colorBuffer;
+        uint32_t size;
+    } request = { cb->hostHandle, (uint32_t) cb->ashmemSize };
+
+    struct iovec iov;
+    iov.iov_base = &request;
+    iov.iov_len = sizeof(request);
+
+    char control[CMSG_SPACE(sizeof(int))];
+    memset(control, 0, sizeof(control));
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    memcpy(CMSG_DATA(cmsg), &cb->fd, sizeof(int));
+
+    int32_t result = -EIO;
+    if (sendmsg(sock, &msg, MSG_NOSIGNAL) == (ssize_t) sizeof(request)) {
+        if (read(sock, &result, sizeof(result)) != sizeof(result)) {
+            result = -EIO;
+        }
+    }
+    close(sock);
+
+    if (result == -ENOSYS) {
+        // The host has the feature disabled, don't ask again.
+        sShareBufferMemory = false;
+    }
+
+    D("share_buffer_memory colorbuffer=0x%x result=%d\n", cb->hostHandle, result);
+    return result == 0;
+}
+
+//
+// Tell the host what a buffer is used for so it can skip storage the
+// buffer never needs, see gralloc_cb.h.
+//
+static uint32_t host_usage(int usage, int format)
+{
+    uint32_t hostUsage = 0;
+    if (usage & (GRALLOC_USAGE_HW_RENDER | GRALLOC_USAGE_HW_2D |
+                 GRALLOC_USAGE_HW_FB)) {
+        hostUsage |= CB_USAGE_RENDER;
+    }
+    if (usage & (GRALLOC_USAGE_HW_TEXTURE | GRALLOC_USAGE_HW_2D)) {
+        hostUsage |= CB_USAGE_SAMPLE;
+    }
+    if (usage & (GRALLOC_USAGE_HW_COMPOSER | GRALLOC_USAGE_HW_FB)) {
+        hostUsage |= CB_USAGE_COMPOSE;
+    }
+    if (usage & (GRALLOC_USAGE_SW_WRITE_MASK | GRALLOC_USAGE_HW_CAMERA_WRITE)) {
+        hostUsage |= CB_USAGE_CPU_WRITE;
+    }
+    if (usage & GRALLOC_USAGE_SW_READ_MASK) {
+        hostUsage |= CB_USAGE_CPU_READ;
+    }
+    if (format == HAL_PIXEL_FORMAT_YV12) {
+        hostUsage |= CB_USAGE_YV12;
+    } else if (format == HAL_PIXEL_FORMAT_YCrCb_420_SP) {
+        hostUsage |= CB_USAGE_NV21;
+    }
+    return hostUsage;
+}
+
+//
+// Video frames go to the host as one luminance image holding all planes
+// back to back, as wide as the Y plane. Returns the number of its rows.
+//
+static int yuv_upload_rows(int format, int width, int height, int *yStride)
+{
+    int size;
+    if (format == HAL_PIXEL_FORMAT_YV12) {
+        int stride = (width + 15) & ~15;
+        int uvStride = (stride / 2 + 15) & ~15;
+        size = stride * height + 2 * (height / 2) * uvStride;
+        *yStride = stride;
+    } else {
+        // NV21 chroma rows hold interleaved V and U samples.
+        size = width * height + (height / 2) * width;
+        *yStride = width;
+    }
+    return (size + *yStride - 1) / *yStride;
+}
+
 #define DEFINE_HOST_CONNECTION \
     HostConnection *hostCon = HostConnection::get(); \
     renderControl_encoder_context_t *rcEnc = (hostCon ? hostCon->rcEncoder() : NULL)
@@ -118,6 +246,37 @@ static int map_buffer(cb_handle_t *cb, void **vaddr)
         return -EIO; \
     }
 
+//
+// Whether the host keeps BGRA buffers as BGRA, so that their pixels go
+// back and forth without swapping channels. Without it they are stored
+// as RGBA. Asked once per process.
+//
+static bool sHostHasBgra = false;
+static pthread_once_t sHostHasBgraOnce = PTHREAD_ONCE_INIT;
+
+static void query_host_bgra(void)
+{
+    DEFINE_HOST_CONNECTION;
+    if (!rcEnc) {
+        return;
+    }
+
+    int size = rcEnc->rcGetGLString(rcEnc, GL_EXTENSIONS, NULL, 0);
+    if (size >= 0) {
+        return;
+    }
+    char *extensions = new char[-size];
+    if (rcEnc->rcGetGLString(rcEnc, GL_EXTENSIONS, extensions, -size) > 0) {
+        sHostHasBgra = strstr(extensions, "GL_ANBOX_bgra_color_buffer") != NULL;
+    }
+    delete[] extensions;
+}
+
+static bool host_has_bgra(void)
+{
+    pthread_once(&sHostHasBgraOnce, query_host_bgra);
+    return sHostHasBgra;
+}
 
 //
 // gralloc device functions (alloc interface)
@@ -173,15 +332,10 @@ static int gralloc_alloc(alloc_device_t* dev,
             return -EINVAL;
         }
     } else if (format == HAL_PIXEL_FORMAT_YCbCr_420_888) {
-        // Flexible framework-accessible YUV format; map to NV21 for now
-        if (usage & GRALLOC_USAGE_HW_CAMERA_WRITE) {
-            format = HAL_PIXEL_FORMAT_YCrCb_420_SP;
-        }
-        if (format == HAL_PIXEL_FORMAT_YCbCr_420_888) {
-            ALOGE("gralloc_alloc: Requested YCbCr_420_888, but no known "
-                    "specific format for this usage: %d x %d, usage %x",
-                    w, h, usage);
-        }
+        // Flexible framework-accessible YUV format, e.g. from video
+        // decoders. Laid out as NV21 which both gralloc_lock_ycbcr() and
+        // the host understand.
+        format = HAL_PIXEL_FORMAT_YCrCb_420_SP;
     }
     bool yuv_format = false;
 
@@ -196,11 +350,17 @@ static int gralloc_alloc(alloc_device_t* dev,
     switch (format) {
         case HAL_PIXEL_FORMAT_RGBA_8888:
         case HAL_PIXEL_FORMAT_RGBX_8888:
-        case HAL_PIXEL_FORMAT_BGRA_8888:
             bpp = 4;
             glFormat = GL_RGBA;
             glType = GL_UNSIGNED_BYTE;
             break;
+        case HAL_PIXEL_FORMAT_BGRA_8888:
+            bpp = 4;
+            // Not every host can render into BGRA textures, only buffers
+            // written by the CPU or sampled are kept as they are.
+            glFormat = (!hw_write && host_has_bgra()) ? GL_BGRA_EXT : GL_RGBA;
+            glType = GL_UNSIGNED_BYTE;
+            break;
         case HAL_PIXEL_FORMAT_RGB_888:
             bpp = 3;
             glFormat = GL_RGB;
@@ -263,6 +423,13 @@ static int gralloc_alloc(alloc_device_t* dev,
             size_t uvStride = (yStride / 2 + (align - 1)) & ~(align-1);
             size_t uvHeight = h / 2;
             ashmem_size += yStride * h + 2 * (uvHeight * uvStride);
+            // Leave room for whole rows of the Y plane, which is how the
+            // planes are uploaded.
+            int uploadStride = 0;
+            int uploadRows = yuv_upload_rows(format, w, h, &uploadStride);
+            if (uploadRows * uploadStride > ashmem_size) {
+                ashmem_size = uploadRows * uploadStride;
+            }
             stride = yStride / bpp;
         } else {
             size_t bpr = (w*bpp + (align-1)) & ~(align-1);
@@ -290,9 +457,9 @@ static int gralloc_alloc(alloc_device_t* dev,
         }
     }
 
-    cb_handle_t *cb = new cb_handle_t(fd, ashmem_size, usage,
-                                      w, h, frameworkFormat, format,
-                                      glFormat, glType);
+    AllocListNode *cb = new AllocListNode(fd, ashmem_size, usage,
+                                          w, h, frameworkFormat, format,
+                                          glFormat, glType);
 
     if (ashmem_size > 0) {
         //
@@ -316,12 +483,21 @@ static int gralloc_alloc(alloc_device_t* dev,
     // rendering will still happen on the host but we also need to be able to
     // read back from the color buffer, which requires that there is a buffer
     //
-    if (usage & (GRALLOC_USAGE_HW_TEXTURE | GRALLOC_USAGE_HW_RENDER |
-                    GRALLOC_USAGE_HW_2D | GRALLOC_USAGE_HW_COMPOSER |
-                    GRALLOC_USAGE_HW_FB | GRALLOC_USAGE_SW_READ_MASK) ) {
+    // Video frames only get one if the GPU samples them. The host keeps
+    // them as RGBA converted from the planes we send, s/w reads are served
+    // from the planes in guest memory.
+    //
+    bool needs_host_buffer = yuv_format ?
+            (usage & (GRALLOC_USAGE_HW_TEXTURE | GRALLOC_USAGE_HW_2D |
+                      GRALLOC_USAGE_HW_COMPOSER)) :
+            (usage & (GRALLOC_USAGE_HW_TEXTURE | GRALLOC_USAGE_HW_RENDER |
+                      GRALLOC_USAGE_HW_2D | GRALLOC_USAGE_HW_COMPOSER |
+                      GRALLOC_USAGE_HW_FB | GRALLOC_USAGE_SW_READ_MASK));
+    if (needs_host_buffer) {
         DEFINE_HOST_CONNECTION;
         if (hostCon && rcEnc) {
-            cb->hostHandle = rcEnc->rcCreateColorBuffer(rcEnc, w, h, glFormat);
+            cb->hostHandle = rcEnc->rcCreateColorBufferWithUsage(rcEnc, w, h,
+                    yuv_format ? GL_RGBA : glFormat, host_usage(usage, format));
             D("Created host ColorBuffer 0x%x\n", cb->hostHandle);
         }
 
@@ -331,20 +507,23 @@ static int gralloc_alloc(alloc_device_t* dev,
            delete cb;
            return -EIO;
         }
+
+        // Buffers which can be posted keep their post counter in front of
+        // the pixels, so only plain s/w written buffers are shared.
+        if (sw_write && !yuv_format && !cb->canBePosted() && fd >= 0) {
+            cb->hostMemoryShared = share_buffer_memory(cb) ? 1 : 0;
+        }
     }
 
     //
     // alloc succeeded - insert the allocated handle to the allocated list
     //
-    AllocListNode *node = new AllocListNode();
     pthread_mutex_lock(&grdev->lock);
-    node->handle = cb;
-    node->next =  grdev->allocListHead;
-    node->prev =  NULL;
+    cb->next = grdev->allocListHead;
     if (grdev->allocListHead) {
-        grdev->allocListHead->prev = node;
+        grdev->allocListHead->prev = cb;
     }
-    grdev->allocListHead = node;
+    grdev->allocListHead = cb;
     pthread_mutex_unlock(&grdev->lock);
 
     *pHandle = cb;
@@ -383,28 +562,21 @@ static int gralloc_free(alloc_device_t* dev,
 
     // remove it from the allocated list
     gralloc_device_t *grdev = (gralloc_device_t *)dev;
+    // Only buffers we allocated ourselves are handed back to us here.
+    AllocListNode *n = static_cast<AllocListNode *>(const_cast<cb_handle_t *>(cb));
     pthread_mutex_lock(&grdev->lock);
-    AllocListNode *n = grdev->allocListHead;
-    while( n && n->handle != cb ) {
-        n = n->next;
-    }
-    if (n) {
-       // buffer found on list - remove it from list
-       if (n->next) {
-           n->next->prev = n->prev;
-       }
-       if (n->prev) {
-           n->prev->next = n->next;
-       }
-       else {
-           grdev->allocListHead = n->next;
-       }
-
-       delete n;
+    if (n->next) {
+        n->next->prev = n->prev;
+    }
+    if (n->prev) {
+        n->prev->next = n->next;
+    }
+    else {
+        grdev->allocListHead = n->next;
     }
     pthread_mutex_unlock(&grdev->lock);
 
-    delete cb;
+    delete n;
 
     return 0;
 }
@@ -416,7 +588,7 @@ static int gralloc_device_close(struct hw_device_t *dev)
 
         // free still allocated buffers
         while( d->allocListHead != NULL ) {
-            gralloc_free(&d->device, d->allocListHead->handle);
+            gralloc_free(&d->device, d->allocListHead);
         }
 
         // free device
@@ -685,7 +857,7 @@ static int gralloc_lock(gralloc_module_t const* module,
             return -EBUSY;
         }
 
-        if (sw_read) {
+        if (sw_read && cb->glFormat) {
             D("gralloc_lock read back color buffer %d %d\n", cb->width, cb->height);
             rcEnc->rcReadColorBuffer(rcEnc, cb->hostHandle,
                     0, 0, cb->width, cb->height, GL_RGBA, GL_UNSIGNED_BYTE, cpu_addr);
@@ -745,7 +917,26 @@ static int gralloc_unlock(gralloc_module_t const* module,
             cpu_addr = (void *)(cb->ashmemBase);
         }
 
-        if (cb->lockedWidth < cb->width || cb->lockedHeight < cb->height) {
+        if (!cb->glFormat) {
+            // Video frames are sent as a whole, and only when written to.
+            if (cb->lockedWidth > 0 && cb->ashmemBase) {
+                int yStride = 0;
+                int rows = yuv_upload_rows(cb->format, cb->width,
+                                           cb->height, &yStride);
+                rcEnc->rcUpdateColorBuffer(rcEnc, cb->hostHandle, 0, 0,
+                                           yStride, rows,
+                                           GL_LUMINANCE, GL_UNSIGNED_BYTE,
+                                           cpu_addr);
+            }
+        }
+        else if (cb->hostMemoryShared &&
+            rcEnc->rcUpdateSharedColorBuffer(rcEnc, cb->hostHandle,
+                                             cb->lockedLeft, cb->lockedTop,
+                                             cb->lockedWidth, cb->lockedHeight,
+                                             cb->glFormat, cb->glType) == 0) {
+            // The host read the pixels out of the shared memory already.
+        }
+        else if (cb->lockedWidth < cb->width || cb->lockedHeight < cb->height) {
             int bpp = glUtilsPixelBitSize(cb->glFormat, cb->glType) >> 3;
             char *tmpBuf = new char[cb->lockedWidth * cb->lockedHeight * bpp];
 
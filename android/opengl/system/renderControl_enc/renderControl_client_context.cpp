@@ -47,6 +47,14 @@ int renderControl_client_context_t::initDispatchByName(void *(*getProc)(const ch
 	rcGetDisplayVsyncPeriod = (rcGetDisplayVsyncPeriod_client_proc_t) getProc("rcGetDisplayVsyncPeriod", userData);
 	rcPostLayer = (rcPostLayer_client_proc_t) getProc("rcPostLayer", userData);
 	rcPostAllLayersDone = (rcPostAllLayersDone_client_proc_t) getProc("rcPostAllLayersDone", userData);
+	rcGetDisplayVsyncPhase = (rcGetDisplayVsyncPhase_client_proc_t) getProc("rcGetDisplayVsyncPhase", userData);
+	rcUpdateSharedColorBuffer = (rcUpdateSharedColorBuffer_client_proc_t) getProc("rcUpdateSharedColorBuffer", userData);
+	rcPostAllLayersDone2 = (rcPostAllLayersDone2_client_proc_t) getProc("rcPostAllLayersDone2", userData);
+	rcCreateSyncKHR = (rcCreateSyncKHR_client_proc_t) getProc("rcCreateSyncKHR", userData);
+	rcClientWaitSyncKHR = (rcClientWaitSyncKHR_client_proc_t) getProc("rcClientWaitSyncKHR", userData);
+	rcDestroySyncKHR = (rcDestroySyncKHR_client_proc_t) getProc("rcDestroySyncKHR", userData);
+	rcPostLayers = (rcPostLayers_client_proc_t) getProc("rcPostLayers", userData);
+	rcCreateColorBufferWithUsage = (rcCreateColorBufferWithUsage_client_proc_t) getProc("rcCreateColorBufferWithUsage", userData);
 	return 0;
 }
 
@@ -47,6 +47,14 @@ struct renderControl_client_context_t {
 	rcGetDisplayVsyncPeriod_client_proc_t rcGetDisplayVsyncPeriod;
 	rcPostLayer_client_proc_t rcPostLayer;
 	rcPostAllLayersDone_client_proc_t rcPostAllLayersDone;
+	rcGetDisplayVsyncPhase_client_proc_t rcGetDisplayVsyncPhase;
+	rcUpdateSharedColorBuffer_client_proc_t rcUpdateSharedColorBuffer;
+	rcPostAllLayersDone2_client_proc_t rcPostAllLayersDone2;
+	rcCreateSyncKHR_client_proc_t rcCreateSyncKHR;
+	rcClientWaitSyncKHR_client_proc_t rcClientWaitSyncKHR;
+	rcDestroySyncKHR_client_proc_t rcDestroySyncKHR;
+	rcPostLayers_client_proc_t rcPostLayers;
+	rcCreateColorBufferWithUsage_client_proc_t rcCreateColorBufferWithUsage;
 	 virtual ~renderControl_client_context_t() {}
 
 	typedef renderControl_client_context_t *CONTEXT_ACCESSOR_TYPE(void);
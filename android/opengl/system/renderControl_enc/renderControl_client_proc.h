@@ -47,6 +47,14 @@ typedef int (renderControl_APIENTRY *rcGetDisplayDpiY_client_proc_t) (void * ctx
 typedef int (renderControl_APIENTRY *rcGetDisplayVsyncPeriod_client_proc_t) (void * ctx, uint32_t);
 typedef void (renderControl_APIENTRY *rcPostLayer_client_proc_t) (void * ctx, const char*, uint32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t);
 typedef void (renderControl_APIENTRY *rcPostAllLayersDone_client_proc_t) (void * ctx);
+typedef int (renderControl_APIENTRY *rcGetDisplayVsyncPhase_client_proc_t) (void * ctx, uint32_t);
+typedef int (renderControl_APIENTRY *rcUpdateSharedColorBuffer_client_proc_t) (void * ctx, uint32_t, GLint, GLint, GLint, GLint, GLenum, GLenum);
+typedef void (renderControl_APIENTRY *rcPostAllLayersDone2_client_proc_t) (void * ctx, uint32_t, uint32_t);
+typedef uint32_t (renderControl_APIENTRY *rcCreateSyncKHR_client_proc_t) (void * ctx);
+typedef EGLint (renderControl_APIENTRY *rcClientWaitSyncKHR_client_proc_t) (void * ctx, uint32_t, EGLint, uint32_t, uint32_t);
+typedef EGLint (renderControl_APIENTRY *rcDestroySyncKHR_client_proc_t) (void * ctx, uint32_t);
+typedef void (renderControl_APIENTRY *rcPostLayers_client_proc_t) (void * ctx, const void*, uint32_t);
+typedef uint32_t (renderControl_APIENTRY *rcCreateColorBufferWithUsage_client_proc_t) (void * ctx, uint32_t, uint32_t, GLenum, uint32_t);
 
 
 #endif
@@ -43,6 +43,14 @@ extern "C" {
 	int rcGetDisplayVsyncPeriod(uint32_t displayId);
 	void rcPostLayer(const char* name, uint32_t colorBuffer, int32_t sourceCropLeft, int32_t sourceCropTop, int32_t sourceCropRight, int32_t sourceCropBottom, int32_t displayFrameLeft, int32_t displayFrameTop, int32_t displayFrameRight, int32_t displayFrameBottom);
 	void rcPostAllLayersDone();
+	int rcGetDisplayVsyncPhase(uint32_t displayId);
+	int rcUpdateSharedColorBuffer(uint32_t colorbuffer, GLint x, GLint y, GLint width, GLint height, GLenum format, GLenum type);
+	void rcPostAllLayersDone2(uint32_t submitTimeHi, uint32_t submitTimeLo);
+	uint32_t rcCreateSyncKHR();
+	EGLint rcClientWaitSyncKHR(uint32_t sync, EGLint flags, uint32_t timeoutHi, uint32_t timeoutLo);
+	EGLint rcDestroySyncKHR(uint32_t sync);
+	void rcPostLayers(const void* layers, uint32_t layersSize);
+	uint32_t rcCreateColorBufferWithUsage(uint32_t width, uint32_t height, GLenum internalFormat, uint32_t usage);
 };
 
 #endif
@@ -274,3 +282,51 @@ void rcPostAllLayersDone()
 	ctx->rcPostAllLayersDone(ctx);
 }
 
+int rcGetDisplayVsyncPhase(uint32_t displayId)
+{
+	GET_CONTEXT;
+	return ctx->rcGetDisplayVsyncPhase(ctx, displayId);
+}
+
+int rcUpdateSharedColorBuffer(uint32_t colorbuffer, GLint x, GLint y, GLint width, GLint height, GLenum format, GLenum type)
+{
+	GET_CONTEXT;
+	return ctx->rcUpdateSharedColorBuffer(ctx, colorbuffer, x, y, width, height, format, type);
+}
+
+void rcPostAllLayersDone2(uint32_t submitTimeHi, uint32_t submitTimeLo)
+{
+	GET_CONTEXT;
+	ctx->rcPostAllLayersDone2(ctx, submitTimeHi, submitTimeLo);
+}
+
+uint32_t rcCreateSyncKHR()
+{
+	GET_CONTEXT;
+	return ctx->rcCreateSyncKHR(ctx);
+}
+
+EGLint rcClientWaitSyncKHR(uint32_t sync, EGLint flags, uint32_t timeoutHi, uint32_t timeoutLo)
+{
+	GET_CONTEXT;
+	return ctx->rcClientWaitSyncKHR(ctx, sync, flags, timeoutHi, timeoutLo);
+}
+
+EGLint rcDestroySyncKHR(uint32_t sync)
+{
+	GET_CONTEXT;
+	return ctx->rcDestroySyncKHR(ctx, sync);
+}
+
+void rcPostLayers(const void* layers, uint32_t layersSize)
+{
+	GET_CONTEXT;
+	ctx->rcPostLayers(ctx, layers, layersSize);
+}
+
+uint32_t rcCreateColorBufferWithUsage(uint32_t width, uint32_t height, GLenum internalFormat, uint32_t usage)
+{
+	GET_CONTEXT;
+	return ctx->rcCreateColorBufferWithUsage(ctx, width, height, internalFormat, usage);
+}
+
@@ -45,6 +45,14 @@ static const struct _renderControl_funcs_by_name {
 	{"rcGetDisplayVsyncPeriod", (void*)rcGetDisplayVsyncPeriod},
 	{"rcPostLayer", (void*)rcPostLayer},
 	{"rcPostAllLayersDone", (void*)rcPostAllLayersDone},
+	{"rcGetDisplayVsyncPhase", (void*)rcGetDisplayVsyncPhase},
+	{"rcUpdateSharedColorBuffer", (void*)rcUpdateSharedColorBuffer},
+	{"rcPostAllLayersDone2", (void*)rcPostAllLayersDone2},
+	{"rcCreateSyncKHR", (void*)rcCreateSyncKHR},
+	{"rcClientWaitSyncKHR", (void*)rcClientWaitSyncKHR},
+	{"rcDestroySyncKHR", (void*)rcDestroySyncKHR},
+	{"rcPostLayers", (void*)rcPostLayers},
+	{"rcCreateColorBufferWithUsage", (void*)rcCreateColorBufferWithUsage},
 };
 static const int renderControl_num_funcs = sizeof(renderControl_funcs_by_name) / sizeof(struct _renderControl_funcs_by_name);
 
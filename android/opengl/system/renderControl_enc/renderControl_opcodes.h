@@ -40,7 +40,15 @@
 #define OP_rcGetDisplayVsyncPeriod 					10034
 #define OP_rcPostLayer 					10035
 #define OP_rcPostAllLayersDone 					10036
-#define OP_last 					10037
+#define OP_rcGetDisplayVsyncPhase 					10037
+#define OP_rcUpdateSharedColorBuffer 					10038
+#define OP_rcPostAllLayersDone2 					10039
+#define OP_rcCreateSyncKHR 					10040
+#define OP_rcClientWaitSyncKHR 					10041
+#define OP_rcDestroySyncKHR 					10042
+#define OP_rcPostLayers 					10043
+#define OP_rcCreateColorBufferWithUsage 					10044
+#define OP_last 					10045
 
 
 #endif
@@ -50,7 +50,7 @@
 /** SENSOR IDS AND NAMES
  **/
 
-#define MAX_NUM_SENSORS 8
+#define MAX_NUM_SENSORS 9
 
 #define SUPPORTED_SENSORS  ((1<<MAX_NUM_SENSORS)-1)
 
@@ -63,6 +63,7 @@
 #define  ID_LIGHT          (ID_BASE+5)
 #define  ID_PRESSURE       (ID_BASE+6)
 #define  ID_HUMIDITY       (ID_BASE+7)
+#define  ID_GYROSCOPE      (ID_BASE+8)
 
 #define  SENSORS_ACCELERATION    (1 << ID_ACCELERATION)
 #define  SENSORS_MAGNETIC_FIELD  (1 << ID_MAGNETIC_FIELD)
@@ -72,6 +73,7 @@
 #define  SENSORS_LIGHT           (1 << ID_LIGHT)
 #define  SENSORS_PRESSURE        (1 << ID_PRESSURE)
 #define  SENSORS_HUMIDITY        (1 << ID_HUMIDITY)
+#define  SENSORS_GYROSCOPE       (1 << ID_GYROSCOPE)
 
 #define  ID_CHECK(x)  ((unsigned)((x) - ID_BASE) < MAX_NUM_SENSORS)
 
@@ -83,7 +85,8 @@
     SENSOR_(PROXIMITY,"proximity") \
     SENSOR_(LIGHT, "light") \
     SENSOR_(PRESSURE, "pressure") \
-    SENSOR_(HUMIDITY, "humidity")
+    SENSOR_(HUMIDITY, "humidity") \
+    SENSOR_(GYROSCOPE, "gyroscope")
 
 static const struct {
     const char*  name;
@@ -266,7 +269,7 @@ static int sensor_device_poll_event_locked(SensorDevice* dev)
         pthread_mutex_unlock(&dev->lock);
 
         /* read the next event */
-        char buff[256];
+        char buff[1024];
         int len = qemud_channel_recv(fd, buff, sizeof(buff) - 1U);
         /* re-acquire the lock to modify the device state. */
         pthread_mutex_lock(&dev->lock);
@@ -281,105 +284,128 @@ static int sensor_device_poll_event_locked(SensorDevice* dev)
         D("%s(fd=%d): received [%s]", __FUNCTION__, fd, buff);
 
 
-        /* "wake" is sent from the emulator to exit this loop. */
-        /* TODO(digit): Is it still needed? */
-        if (!strcmp((const char*)buff, "wake")) {
-            ret = 0x7FFFFFFF;
-            break;
-        }
+        /* A message carries one or more events separated by newlines,
+         * usually all samples taken at once followed by their sync. */
+        char* next;
+        char* line;
+        for (line = buff; line != NULL; line = next) {
+            next = strchr(line, '\n');
+            if (next != NULL) {
+                *next++ = 0;
+            }
 
-        float params[3];
+            /* "wake" is sent from the emulator to exit this loop. */
+            /* TODO(digit): Is it still needed? */
+            if (!strcmp((const char*)line, "wake")) {
+                ret = 0x7FFFFFFF;
+                goto out;
+            }
 
-        /* "acceleration:<x>:<y>:<z>" corresponds to an acceleration event */
-        if (sscanf(buff, "acceleration:%g:%g:%g", params+0, params+1, params+2)
-                == 3) {
-            new_sensors |= SENSORS_ACCELERATION;
-            events[ID_ACCELERATION].acceleration.x = params[0];
-            events[ID_ACCELERATION].acceleration.y = params[1];
-            events[ID_ACCELERATION].acceleration.z = params[2];
-            events[ID_ACCELERATION].type = SENSOR_TYPE_ACCELEROMETER;
-            continue;
-        }
+            float params[3];
+
+            /* "acceleration:<x>:<y>:<z>" corresponds to an acceleration event */
+            if (sscanf(line, "acceleration:%g:%g:%g", params+0, params+1, params+2)
+                    == 3) {
+                new_sensors |= SENSORS_ACCELERATION;
+                events[ID_ACCELERATION].acceleration.x = params[0];
+                events[ID_ACCELERATION].acceleration.y = params[1];
+                events[ID_ACCELERATION].acceleration.z = params[2];
+                events[ID_ACCELERATION].type = SENSOR_TYPE_ACCELEROMETER;
+                continue;
+            }
 
-        /* "orientation:<azimuth>:<pitch>:<roll>" is sent when orientation
-         * changes */
-        if (sscanf(buff, "orientation:%g:%g:%g", params+0, params+1, params+2)
-                == 3) {
-            new_sensors |= SENSORS_ORIENTATION;
-            events[ID_ORIENTATION].orientation.azimuth = params[0];
-            events[ID_ORIENTATION].orientation.pitch   = params[1];
-            events[ID_ORIENTATION].orientation.roll    = params[2];
-            events[ID_ORIENTATION].orientation.status  =
-                    SENSOR_STATUS_ACCURACY_HIGH;
-            events[ID_ORIENTATION].type = SENSOR_TYPE_ORIENTATION;
-            continue;
-        }
+            /* "orientation:<azimuth>:<pitch>:<roll>" is sent when orientation
+             * changes */
+            if (sscanf(line, "orientation:%g:%g:%g", params+0, params+1, params+2)
+                    == 3) {
+                new_sensors |= SENSORS_ORIENTATION;
+                events[ID_ORIENTATION].orientation.azimuth = params[0];
+                events[ID_ORIENTATION].orientation.pitch   = params[1];
+                events[ID_ORIENTATION].orientation.roll    = params[2];
+                events[ID_ORIENTATION].orientation.status  =
+                        SENSOR_STATUS_ACCURACY_HIGH;
+                events[ID_ORIENTATION].type = SENSOR_TYPE_ORIENTATION;
+                continue;
+            }
 
-        /* "magnetic:<x>:<y>:<z>" is sent for the params of the magnetic
-         * field */
-        if (sscanf(buff, "magnetic:%g:%g:%g", params+0, params+1, params+2)
-                == 3) {
-            new_sensors |= SENSORS_MAGNETIC_FIELD;
-            events[ID_MAGNETIC_FIELD].magnetic.x = params[0];
-            events[ID_MAGNETIC_FIELD].magnetic.y = params[1];
-            events[ID_MAGNETIC_FIELD].magnetic.z = params[2];
-            events[ID_MAGNETIC_FIELD].magnetic.status =
-                    SENSOR_STATUS_ACCURACY_HIGH;
-            events[ID_MAGNETIC_FIELD].type = SENSOR_TYPE_MAGNETIC_FIELD;
-            continue;
-        }
+            /* "magnetic:<x>:<y>:<z>" is sent for the params of the magnetic
+             * field */
+            if (sscanf(line, "magnetic:%g:%g:%g", params+0, params+1, params+2)
+                    == 3) {
+                new_sensors |= SENSORS_MAGNETIC_FIELD;
+                events[ID_MAGNETIC_FIELD].magnetic.x = params[0];
+                events[ID_MAGNETIC_FIELD].magnetic.y = params[1];
+                events[ID_MAGNETIC_FIELD].magnetic.z = params[2];
+                events[ID_MAGNETIC_FIELD].magnetic.status =
+                        SENSOR_STATUS_ACCURACY_HIGH;
+                events[ID_MAGNETIC_FIELD].type = SENSOR_TYPE_MAGNETIC_FIELD;
+                continue;
+            }
 
-        /* "temperature:<celsius>" */
-        if (sscanf(buff, "temperature:%g", params+0) == 1) {
-            new_sensors |= SENSORS_TEMPERATURE;
-            events[ID_TEMPERATURE].temperature = params[0];
-            events[ID_TEMPERATURE].type = SENSOR_TYPE_TEMPERATURE;
-            continue;
-        }
+            /* "temperature:<celsius>" */
+            if (sscanf(line, "temperature:%g", params+0) == 1) {
+                new_sensors |= SENSORS_TEMPERATURE;
+                events[ID_TEMPERATURE].temperature = params[0];
+                events[ID_TEMPERATURE].type = SENSOR_TYPE_TEMPERATURE;
+                continue;
+            }
  
-        /* "proximity:<value>" */
-        if (sscanf(buff, "proximity:%g", params+0) == 1) {
-            new_sensors |= SENSORS_PROXIMITY;
-            events[ID_PROXIMITY].distance = params[0];
-            events[ID_PROXIMITY].type = SENSOR_TYPE_PROXIMITY;
-            continue;
-        }
-        /* "light:<lux>" */
-        if (sscanf(buff, "light:%g", params+0) == 1) {
-            new_sensors |= SENSORS_LIGHT;
-            events[ID_LIGHT].light = params[0];
-            events[ID_LIGHT].type = SENSOR_TYPE_LIGHT;
-            continue;
-        }
+            /* "proximity:<value>" */
+            if (sscanf(line, "proximity:%g", params+0) == 1) {
+                new_sensors |= SENSORS_PROXIMITY;
+                events[ID_PROXIMITY].distance = params[0];
+                events[ID_PROXIMITY].type = SENSOR_TYPE_PROXIMITY;
+                continue;
+            }
+            /* "light:<lux>" */
+            if (sscanf(line, "light:%g", params+0) == 1) {
+                new_sensors |= SENSORS_LIGHT;
+                events[ID_LIGHT].light = params[0];
+                events[ID_LIGHT].type = SENSOR_TYPE_LIGHT;
+                continue;
+            }
 
-        /* "pressure:<hpa>" */
-        if (sscanf(buff, "pressure:%g", params+0) == 1) {
-            new_sensors |= SENSORS_PRESSURE;
-            events[ID_PRESSURE].pressure = params[0];
-            events[ID_PRESSURE].type = SENSOR_TYPE_PRESSURE;
-            continue;
-        }
+            /* "pressure:<hpa>" */
+            if (sscanf(line, "pressure:%g", params+0) == 1) {
+                new_sensors |= SENSORS_PRESSURE;
+                events[ID_PRESSURE].pressure = params[0];
+                events[ID_PRESSURE].type = SENSOR_TYPE_PRESSURE;
+                continue;
+            }
 
-        /* "humidity:<percent>" */
-        if (sscanf(buff, "humidity:%g", params+0) == 1) {
-            new_sensors |= SENSORS_HUMIDITY;
-            events[ID_HUMIDITY].relative_humidity = params[0];
-            events[ID_HUMIDITY].type = SENSOR_TYPE_RELATIVE_HUMIDITY;
-            continue;
-        }
+            /* "humidity:<percent>" */
+            if (sscanf(line, "humidity:%g", params+0) == 1) {
+                new_sensors |= SENSORS_HUMIDITY;
+                events[ID_HUMIDITY].relative_humidity = params[0];
+                events[ID_HUMIDITY].type = SENSOR_TYPE_RELATIVE_HUMIDITY;
+                continue;
+            }
 
-        /* "sync:<time>" is sent after a series of sensor events.
-         * where 'time' is expressed in micro-seconds and corresponds
-         * to the VM time when the real poll occured.
-         */
-        if (sscanf(buff, "sync:%lld", &event_time) == 1) {
-            if (new_sensors) {
-                goto out;
+            /* "gyroscope:<x>:<y>:<z>" in rad/s */
+            if (sscanf(line, "gyroscope:%g:%g:%g", params+0, params+1, params+2)
+                    == 3) {
+                new_sensors |= SENSORS_GYROSCOPE;
+                events[ID_GYROSCOPE].gyro.x = params[0];
+                events[ID_GYROSCOPE].gyro.y = params[1];
+                events[ID_GYROSCOPE].gyro.z = params[2];
+                events[ID_GYROSCOPE].gyro.status = SENSOR_STATUS_ACCURACY_HIGH;
+                events[ID_GYROSCOPE].type = SENSOR_TYPE_GYROSCOPE;
+                continue;
             }
-            D("huh ? sync without any sensor data ?");
-            continue;
+
+            /* "sync:<time>" is sent after a series of sensor events.
+             * where 'time' is expressed in micro-seconds and corresponds
+             * to the VM time when the real poll occured.
+             */
+            if (sscanf(line, "sync:%lld", &event_time) == 1) {
+                if (new_sensors) {
+                    goto out;
+                }
+                D("huh ? sync without any sensor data ?");
+                continue;
+            }
+            D("huh ? unsupported command");
         }
-        D("huh ? unsupported command");
     }
 out:
     if (new_sensors) {
@@ -649,6 +675,17 @@ static const struct sensor_t sSensorListInit[] = {
           .resolution = 1.0f,
           .power      = 20.0f,
           .reserved   = {}
+        },
+
+        { .name       = "Goldfish 3-axis Gyroscope",
+          .vendor     = "The Android Open Source Project",
+          .version    = 1,
+          .handle     = ID_GYROSCOPE,
+          .type       = SENSOR_TYPE_GYROSCOPE,
+          .maxRange   = 35.0f,
+          .resolution = 1.0f/1000.0f,
+          .power      = 6.1f,
+          .reserved   = {}
         }
 };
 
@@ -18,6 +18,7 @@
 #define LOG_TAG "Anboxd"
 
 #include "android/service/android_api_skeleton.h"
+#include "android/service/icon_store.h"
 
 #include "anbox_rpc.pb.h"
 #include "anbox_bridge.pb.h"
@@ -38,7 +39,8 @@ std::map<std::string,std::string> common_env = {
 }
 
 namespace anbox {
-AndroidApiSkeleton::AndroidApiSkeleton() {
+AndroidApiSkeleton::AndroidApiSkeleton(const std::shared_ptr<IconStore> &icons) :
+    icons_(icons) {
 }
 
 AndroidApiSkeleton::~AndroidApiSkeleton() {
@@ -55,12 +57,14 @@ void AndroidApiSkeleton::wait_for_process(core::posix::ChildProcess &process,
     }
 }
 
-void AndroidApiSkeleton::connect_services() {
+android::sp<android::BpActivityManager> AndroidApiSkeleton::connect_services() {
+    std::lock_guard<std::mutex> l(services_mutex_);
     if (!activity_manager_.get()) {
         auto am = android::defaultServiceManager()->getService(android::String16("activity"));
         if (am.get())
             activity_manager_ = new android::BpActivityManager(am);
     }
+    return activity_manager_;
 }
 
 void AndroidApiSkeleton::launch_application(anbox::protobuf::bridge::LaunchApplication const *request,
@@ -133,10 +137,10 @@ void AndroidApiSkeleton::launch_application(anbox::protobuf::bridge::LaunchAppli
 void AndroidApiSkeleton::set_focused_task(anbox::protobuf::bridge::SetFocusedTask const *request,
                                           anbox::protobuf::rpc::Void *response,
                                           google::protobuf::Closure *done) {
-    connect_services();
+    auto activity_manager = connect_services();
 
-    if (activity_manager_.get())
-        activity_manager_->setFocusedTask(request->id());
+    if (activity_manager.get())
+        activity_manager->setFocusedTask(request->id());
     else
         response->set_error("ActivityManager is not available");
 
@@ -146,10 +150,10 @@ void AndroidApiSkeleton::set_focused_task(anbox::protobuf::bridge::SetFocusedTas
 void AndroidApiSkeleton::remove_task(anbox::protobuf::bridge::RemoveTask const *request,
                                      anbox::protobuf::rpc::Void *response,
                                      google::protobuf::Closure *done) {
-  connect_services();
+  auto activity_manager = connect_services();
 
-  if (activity_manager_.get())
-    activity_manager_->removeTask(request->id());
+  if (activity_manager.get())
+    activity_manager->removeTask(request->id());
   else
     response->set_error("ActivityManager is not available");
 
@@ -160,17 +164,89 @@ void AndroidApiSkeleton::remove_task(anbox::protobuf::bridge::RemoveTask const *
 void AndroidApiSkeleton::resize_task(anbox::protobuf::bridge::ResizeTask const *request,
                                      anbox::protobuf::rpc::Void *response,
                                      google::protobuf::Closure *done) {
-  connect_services();
+  auto activity_manager = connect_services();
 
-  if (activity_manager_.get()) {
+  if (activity_manager.get()) {
     auto r = request->rect();
-    activity_manager_->resizeTask(request->id(),
-                                  anbox::graphics::Rect{r.left(), r.top(), r.right(), r.bottom()},
-                                  request->resize_mode());
+    activity_manager->resizeTask(request->id(),
+                                 anbox::graphics::Rect{r.left(), r.top(), r.right(), r.bottom()},
+                                 request->resize_mode());
   } else {
     response->set_error("ActivityManager is not available");
   }
 
   done->Run();
 }
+
+void AndroidApiSkeleton::set_display_metrics(anbox::protobuf::bridge::SetDisplayMetrics const *request,
+                                             anbox::protobuf::rpc::Void *response,
+                                             google::protobuf::Closure *done) {
+    const auto reset = request->width() <= 0 || request->height() <= 0 || request->density() <= 0;
+
+    // The window manager scales the forced size to the display, so apps
+    // render at the lower resolution while the display stays the same.
+    std::vector<std::string> size = {"/system/bin/wm", "size"};
+    std::vector<std::string> density = {"/system/bin/wm", "density"};
+    if (reset) {
+        size.push_back("reset");
+        density.push_back("reset");
+    } else {
+        size.push_back(std::to_string(request->width()) + "x" + std::to_string(request->height()));
+        density.push_back(std::to_string(request->density()));
+    }
+
+    for (const auto &argv : {size, density}) {
+        auto process = core::posix::exec("/system/bin/sh", argv, common_env, core::posix::StandardStream::empty);
+        wait_for_process(process, response);
+    }
+
+    done->Run();
+}
+
+void AndroidApiSkeleton::get_application_icons(anbox::protobuf::bridge::ApplicationIconsRequest const *request,
+                                               anbox::protobuf::bridge::ApplicationIcons *response,
+                                               google::protobuf::Closure *done) {
+  std::vector<int8_t> data;
+  for (int n = 0; n < request->hashes_size(); n++) {
+    if (!icons_->find(request->hashes(n), data))
+      continue;
+
+    auto icon = response->add_icons();
+    icon->set_hash(request->hashes(n));
+    icon->set_data(data.data(), data.size());
+  }
+
+  done->Run();
+}
+
+void AndroidApiSkeleton::clipboard_changed(anbox::protobuf::rpc::Void const *request,
+                                           anbox::protobuf::rpc::Void *response,
+                                           google::protobuf::Closure *done) {
+  (void) request;
+  (void) response;
+
+  if (clipboard_changed_)
+    clipboard_changed_();
+
+  done->Run();
+}
+
+void AndroidApiSkeleton::register_clipboard_changed_handler(const std::function<void()> &handler) {
+  clipboard_changed_ = handler;
+}
+
+void AndroidApiSkeleton::set_frame_statistics_reporting(anbox::protobuf::bridge::SetFrameStatisticsReporting const *request,
+                                                        anbox::protobuf::rpc::Void *response,
+                                                        google::protobuf::Closure *done) {
+    (void) response;
+
+    if (frame_statistics_reporting_)
+        frame_statistics_reporting_(request->enabled());
+
+    done->Run();
+}
+
+void AndroidApiSkeleton::register_frame_statistics_reporting_handler(const std::function<void(bool)> &handler) {
+    frame_statistics_reporting_ = handler;
+}
 } // namespace anbox
@@ -20,6 +20,10 @@
 
 #include "android/service/activity_manager_interface.h"
 
+#include <functional>
+#include <memory>
+#include <mutex>
+
 namespace google {
 namespace protobuf {
 class Closure;
@@ -35,20 +39,25 @@ class ChildProcess;
 namespace anbox {
 namespace protobuf {
 namespace bridge {
+class ApplicationIcons;
+class ApplicationIconsRequest;
 class InstallApplication;
 class LaunchApplication;
 class SetDnsServers;
 class SetFocusedTask;
 class RemoveTask;
 class ResizeTask;
+class SetDisplayMetrics;
+class SetFrameStatisticsReporting;
 } // namespace bridge
 namespace rpc {
 class Void;
 } // namespace rpc
 } // namespace protobuf
+class IconStore;
 class AndroidApiSkeleton {
 public:
-    AndroidApiSkeleton();
+    AndroidApiSkeleton(const std::shared_ptr<IconStore> &icons);
     ~AndroidApiSkeleton();
 
     void launch_application(anbox::protobuf::bridge::LaunchApplication const *request,
@@ -67,13 +76,39 @@ public:
                      anbox::protobuf::rpc::Void *response,
                      google::protobuf::Closure *done);
 
+    void set_display_metrics(anbox::protobuf::bridge::SetDisplayMetrics const *request,
+                             anbox::protobuf::rpc::Void *response,
+                             google::protobuf::Closure *done);
+
+    void get_application_icons(anbox::protobuf::bridge::ApplicationIconsRequest const *request,
+                               anbox::protobuf::bridge::ApplicationIcons *response,
+                               google::protobuf::Closure *done);
+
+    void clipboard_changed(anbox::protobuf::rpc::Void const *request,
+                           anbox::protobuf::rpc::Void *response,
+                           google::protobuf::Closure *done);
+
+    void register_clipboard_changed_handler(const std::function<void()> &handler);
+
+    void set_frame_statistics_reporting(anbox::protobuf::bridge::SetFrameStatisticsReporting const *request,
+                                        anbox::protobuf::rpc::Void *response,
+                                        google::protobuf::Closure *done);
+
+    // |handler| is told whether the host wants frame statistics.
+    void register_frame_statistics_reporting_handler(const std::function<void(bool)> &handler);
+
 private:
     void wait_for_process(core::posix::ChildProcess &process,
                           anbox::protobuf::rpc::Void *response);
 
-    void connect_services();
+    // Requests run on several workers at the same time.
+    android::sp<android::BpActivityManager> connect_services();
 
+    std::mutex services_mutex_;
     android::sp<android::BpActivityManager> activity_manager_;
+    std::shared_ptr<IconStore> icons_;
+    std::function<void()> clipboard_changed_;
+    std::function<void(bool)> frame_statistics_reporting_;
 };
 } // namespace anbox
 
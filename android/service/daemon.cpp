@@ -15,8 +15,12 @@
  *
  */
 
+#define LOG_TAG "Anboxd"
+
 #include "android/service/daemon.h"
+#include "android/service/frame_statistics_reporter.h"
 #include "android/service/host_connector.h"
+#include "android/service/memory_pressure_listener.h"
 #include "android/service/platform_service.h"
 
 #include "core/posix/signal.h"
@@ -29,6 +33,30 @@
 #include <binder/ProcessState.h>
 #include <binder/IServiceManager.h>
 
+#include <cutils/log.h>
+#include <cutils/properties.h>
+
+namespace {
+constexpr const char *binder_threads_property{"anbox.service.binder_threads"};
+
+// The binder threads only serve calls to the platform service, requests
+// from the host run on the workers of the host connector. Without the
+// property the default of libbinder is used.
+void configure_binder_threads() {
+    char value[PROPERTY_VALUE_MAX];
+    if (property_get(binder_threads_property, value, nullptr) <= 0)
+        return;
+
+    const auto threads = std::atoi(value);
+    if (threads <= 0) {
+        ALOGW("Ignoring invalid %s=%s", binder_threads_property, value);
+        return;
+    }
+
+    android::ProcessState::self()->setThreadPoolMaxThreadCount(threads);
+}
+} // namespace
+
 namespace anbox {
 Daemon::Daemon() {
 }
@@ -44,12 +72,32 @@ int Daemon::run() {
     });
 
     auto host_connector = std::make_shared<HostConnector>();
+
+    // Only runs while the host serves the statistics, it asks for them
+    // every time it connects.
+    auto frame_statistics_reporter = std::make_shared<FrameStatisticsReporter>(
+                host_connector->platform_api_stub());
+    std::weak_ptr<FrameStatisticsReporter> weak_reporter = frame_statistics_reporter;
+    host_connector->register_frame_statistics_reporting_handler([weak_reporter](bool enabled) {
+        auto reporter = weak_reporter.lock();
+        if (!reporter)
+            return;
+        if (enabled)
+            reporter->start();
+        else
+            reporter->stop();
+    });
+
     host_connector->start();
 
+    auto memory_pressure_listener = std::make_shared<MemoryPressureListener>();
+    memory_pressure_listener->start();
+
     android::defaultServiceManager()->addService(
                 android::String16(android::PlatformService::service_name()),
                 new android::PlatformService(host_connector->platform_api_stub()));
 
+    configure_binder_threads();
     android::ProcessState::self()->startThreadPool();
 
     trap->run();
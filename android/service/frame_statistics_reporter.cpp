@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#define LOG_TAG "Anboxd"
+
+#include "android/service/frame_statistics_reporter.h"
+#include "android/service/platform_api_stub.h"
+#include "anbox/bridge/guest_frame_statistics.h"
+
+#include <functional>
+
+#include <cstdio>
+
+#include <cutils/log.h>
+
+namespace {
+// Without arguments it dumps the statistics of all processes which have
+// rendered something.
+constexpr const char *gfxinfo_command{"/system/bin/dumpsys gfxinfo 2> /dev/null"};
+} // namespace
+
+namespace anbox {
+constexpr std::chrono::seconds FrameStatisticsReporter::report_interval;
+
+FrameStatisticsReporter::FrameStatisticsReporter(const std::shared_ptr<PlatformApiStub> &platform_api_stub) :
+    platform_api_stub_(platform_api_stub),
+    running_(false) {
+}
+
+FrameStatisticsReporter::~FrameStatisticsReporter() {
+    stop();
+}
+
+void FrameStatisticsReporter::start() {
+    std::lock_guard<std::mutex> control(control_mutex_);
+    std::lock_guard<std::mutex> l(mutex_);
+    if (running_)
+        return;
+
+    running_ = true;
+    thread_ = std::thread(std::bind(&FrameStatisticsReporter::main_loop, this));
+}
+
+void FrameStatisticsReporter::stop() {
+    std::lock_guard<std::mutex> control(control_mutex_);
+    {
+        std::lock_guard<std::mutex> l(mutex_);
+        if (!running_)
+            return;
+        running_ = false;
+    }
+    stopped_.notify_all();
+    thread_.join();
+}
+
+void FrameStatisticsReporter::main_loop() {
+    bridge::GuestFrameStatistics statistics;
+    std::uint64_t reported_frames = 0;
+    bool reported = false;
+
+    std::unique_lock<std::mutex> l(mutex_);
+    while (!stopped_.wait_for(l, report_interval, [&]() { return !running_; })) {
+        l.unlock();
+
+        std::string gfxinfo;
+        if (!read_gfxinfo(gfxinfo)) {
+            ALOGW("Failed to get frame statistics, not reporting them anymore");
+            return;
+        }
+
+        // Nothing rendered means nothing new to tell.
+        if (statistics.update(gfxinfo) &&
+            (!reported || statistics.totals().frames != reported_frames)) {
+            platform_api_stub_->report_frame_statistics(statistics);
+            reported_frames = statistics.totals().frames;
+            reported = true;
+        }
+
+        l.lock();
+    }
+}
+
+bool FrameStatisticsReporter::read_gfxinfo(std::string &gfxinfo) {
+    auto out = ::popen(gfxinfo_command, "r");
+    if (!out)
+        return false;
+
+    char buffer[4096];
+    size_t size = 0;
+    while ((size = ::fread(buffer, 1, sizeof(buffer), out)) > 0)
+        gfxinfo.append(buffer, size);
+
+    return ::pclose(out) == 0;
+}
+} // namespace anbox
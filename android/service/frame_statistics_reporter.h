@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_ANDROID_FRAME_STATISTICS_REPORTER_H_
+#define ANBOX_ANDROID_FRAME_STATISTICS_REPORTER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace anbox {
+class PlatformApiStub;
+// Collects the frame and jank counters Android keeps for every app, see
+// bridge::GuestFrameStatistics, and reports them to the host every
+// |report_interval| while apps render. The host puts them next to its
+// own frame statistics, which tells whether a slow frame was slow in
+// Android already or only on the way to the host display.
+//
+// Only started when the host asks for the statistics, as every report
+// runs dumpsys.
+class FrameStatisticsReporter {
+public:
+    static constexpr std::chrono::seconds report_interval{5};
+
+    FrameStatisticsReporter(const std::shared_ptr<PlatformApiStub> &platform_api_stub);
+    ~FrameStatisticsReporter();
+
+    // Both may be called from any thread.
+    void start();
+    void stop();
+
+private:
+    void main_loop();
+    bool read_gfxinfo(std::string &gfxinfo);
+
+    std::shared_ptr<PlatformApiStub> platform_api_stub_;
+    // Held by start() and stop() for as long as they take.
+    std::mutex control_mutex_;
+    std::mutex mutex_;
+    std::condition_variable stopped_;
+    bool running_;
+    std::thread thread_;
+};
+} // namespace anbox
+
+#endif
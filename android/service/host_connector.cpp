@@ -15,26 +15,46 @@
  *
  */
 
+#define LOG_TAG "Anboxd"
+
 #include "android/service/host_connector.h"
 #include "android/service/local_socket_connection.h"
 #include "android/service/message_processor.h"
 #include "android/service/android_api_skeleton.h"
+#include "android/service/icon_store.h"
 #include "android/service/platform_api_stub.h"
+#include "android/service/worker_pool.h"
 
 #include "anbox/rpc/channel.h"
 
 #include <functional>
 #include <array>
+#include <chrono>
+
+#include <cutils/log.h>
+
+namespace {
+// How often we look for a new host while the previous one is gone.
+constexpr std::chrono::seconds reconnect_interval{1};
+}
 
 namespace anbox {
 HostConnector::HostConnector() :
     socket_(std::make_shared<LocalSocketConnection>("/dev/anbox_bridge")),
     pending_calls_(std::make_shared<rpc::PendingCallCache>()),
-    android_api_skeleton_(std::make_shared<AndroidApiSkeleton>()),
-    message_processor_(std::make_shared<MessageProcessor>(socket_, pending_calls_, android_api_skeleton_)),
-    rpc_channel_(std::make_shared<rpc::Channel>(pending_calls_, socket_)),
-    platform_api_stub_(std::make_shared<PlatformApiStub>(rpc_channel_)),
+    framing_(std::make_shared<rpc::Framing>()),
+    icons_(std::make_shared<IconStore>()),
+    android_api_skeleton_(std::make_shared<AndroidApiSkeleton>(icons_)),
+    message_processor_(std::make_shared<MessageProcessor>(socket_, pending_calls_, android_api_skeleton_, framing_,
+                                                          WorkerPool::configured_workers())),
+    rpc_channel_(std::make_shared<rpc::Channel>(pending_calls_, socket_, framing_)),
+    platform_api_stub_(std::make_shared<PlatformApiStub>(rpc_channel_, icons_)),
     running_(false) {
+    std::weak_ptr<PlatformApiStub> weak_stub = platform_api_stub_;
+    android_api_skeleton_->register_clipboard_changed_handler([weak_stub]() {
+        if (auto stub = weak_stub.lock())
+            stub->clipboard_changed();
+    });
 }
 
 HostConnector::~HostConnector() {
@@ -45,6 +65,7 @@ void HostConnector::start() {
         return;
 
     running_.exchange(true);
+    rpc_channel_->send_protocol_version();
     thread_ = std::thread(std::bind(&HostConnector::main_loop, this));
 }
 
@@ -59,21 +80,37 @@ void HostConnector::main_loop() {
     while (running_) {
         std::array<std::uint8_t, 8192> buffer;
         const auto bytes_read = socket_->read_all(buffer.data(), buffer.size());
-        if (bytes_read == 0)
-            break;
-
-        // MessageProcessor wants an vector so give it what it wants until
-        // we refactor this.
-        std::vector<std::uint8_t> data;
-        for (unsigned n = 0; n < bytes_read; n++)
-            data.push_back(buffer[n]);
+        if (bytes_read <= 0) {
+            if (!reconnect())
+                break;
+            continue;
+        }
 
-        if (!message_processor_->process_data(data))
+        if (!message_processor_->process_data(buffer.data(), bytes_read))
             break;
     }
 }
 
+bool HostConnector::reconnect() {
+    // The session manager may come back and continue with us instead of
+    // booting another Android, it listens on the same socket then.
+    ALOGW("Lost connection to the host, waiting for it to come back");
+    while (running_) {
+        if (socket_->reconnect()) {
+            ALOGI("Reconnected to the host");
+            rpc_channel_->send_protocol_version();
+            return true;
+        }
+        std::this_thread::sleep_for(reconnect_interval);
+    }
+    return false;
+}
+
 std::shared_ptr<anbox::PlatformApiStub> HostConnector::platform_api_stub() const {
     return platform_api_stub_;
 }
+
+void HostConnector::register_frame_statistics_reporting_handler(const std::function<void(bool)> &handler) {
+    android_api_skeleton_->register_frame_statistics_reporting_handler(handler);
+}
 } // namespace anbox
@@ -18,6 +18,7 @@
 #ifndef ANBOX_ANDROID_HOST_CONNECTOR_H_
 #define ANBOX_ANDROID_HOST_CONNECTOR_H_
 
+#include <functional>
 #include <memory>
 #include <thread>
 #include <atomic>
@@ -26,10 +27,12 @@ namespace anbox {
 namespace rpc {
 class PendingCallCache;
 class Channel;
+class Framing;
 } // namespace rpc
 class LocalSocketConnection;
 class MessageProcessor;
 class AndroidApiSkeleton;
+class IconStore;
 class PlatformApiStub;
 class HostConnector {
 public:
@@ -41,11 +44,18 @@ public:
 
     std::shared_ptr<anbox::PlatformApiStub> platform_api_stub() const;
 
+    // |handler| is told whether the host wants frame statistics each
+    // time it connects. Has to be registered before start().
+    void register_frame_statistics_reporting_handler(const std::function<void(bool)> &handler);
+
 private:
     void main_loop();
+    bool reconnect();
 
     std::shared_ptr<LocalSocketConnection> socket_;
     std::shared_ptr<rpc::PendingCallCache> pending_calls_;
+    std::shared_ptr<rpc::Framing> framing_;
+    std::shared_ptr<IconStore> icons_;
     std::shared_ptr<AndroidApiSkeleton> android_api_skeleton_;
     std::shared_ptr<MessageProcessor> message_processor_;
     std::shared_ptr<rpc::Channel> rpc_channel_;
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "android/service/icon_store.h"
+
+#include <stdio.h>
+
+namespace anbox {
+std::string IconStore::hash(const std::vector<int8_t> &icon) {
+    // FNV-1a, the host keeps icons by this between runs.
+    std::uint64_t h = 0xcbf29ce484222325ULL;
+    for (const auto c : icon) {
+        h ^= static_cast<std::uint8_t>(c);
+        h *= 0x100000001b3ULL;
+    }
+
+    char str[17];
+    snprintf(str, sizeof(str), "%016llx", static_cast<unsigned long long>(h));
+    return std::string(str);
+}
+
+std::vector<std::string> IconStore::replace(const std::vector<std::vector<int8_t>> &icons) {
+    std::map<std::string, std::vector<int8_t>> new_icons;
+    std::vector<std::string> hashes;
+    for (const auto &icon : icons) {
+        const auto h = hash(icon);
+        hashes.push_back(h);
+        new_icons[h] = icon;
+    }
+
+    std::lock_guard<std::mutex> l(mutex_);
+    icons_.swap(new_icons);
+    return hashes;
+}
+
+bool IconStore::find(const std::string &hash, std::vector<int8_t> &icon) const {
+    std::lock_guard<std::mutex> l(mutex_);
+    auto iter = icons_.find(hash);
+    if (iter == icons_.end())
+        return false;
+    icon = iter->second;
+    return true;
+}
+} // namespace anbox
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_ANDROID_ICON_STORE_H_
+#define ANBOX_ANDROID_ICON_STORE_H_
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace anbox {
+// Icons of the applications we told the host about, by the hash of their
+// content. The host fetches only those it doesn't have cached already.
+class IconStore {
+public:
+    // Replaces all icons with the given ones and returns their hashes in
+    // the same order.
+    std::vector<std::string> replace(const std::vector<std::vector<int8_t>> &icons);
+
+    bool find(const std::string &hash, std::vector<int8_t> &icon) const;
+
+    static std::string hash(const std::vector<int8_t> &icon);
+
+private:
+    mutable std::mutex mutex_;
+    std::map<std::string, std::vector<int8_t>> icons_;
+};
+} // namespace anbox
+
+#endif
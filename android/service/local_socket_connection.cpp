@@ -34,34 +34,54 @@ bool socket_error_is_transient(int error_code) {
 
 namespace anbox {
 LocalSocketConnection::LocalSocketConnection(const std::string &path) :
-    fd_(Fd::invalid) {
+    path_(path),
+    fd_(connect()) {
+    if (fd_ < 0)
+        throw std::runtime_error("Failed to connect to server socket");
+}
+
+LocalSocketConnection::~LocalSocketConnection() {
+}
 
+Fd LocalSocketConnection::connect() const {
     struct sockaddr_un socket_address;
     memset(&socket_address, 0, sizeof(socket_address));
 
     socket_address.sun_family = AF_UNIX;
-    memcpy(socket_address.sun_path, path.data(), path.size());
+    memcpy(socket_address.sun_path, path_.data(), path_.size());
 
-    fd_ = Fd{socket(AF_UNIX, SOCK_STREAM, 0)};
-    if (connect(fd_, reinterpret_cast<sockaddr*>(&socket_address), sizeof(socket_address)) < 0)
-        throw std::runtime_error("Failed to connect to server socket");
+    Fd fd{socket(AF_UNIX, SOCK_STREAM, 0)};
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&socket_address), sizeof(socket_address)) < 0)
+        return Fd{};
+    return fd;
 }
 
-LocalSocketConnection::~LocalSocketConnection() {
-    if (fd_ > 0)
-        ::close(fd_);
+Fd LocalSocketConnection::fd() const {
+    std::lock_guard<std::mutex> l(lock_);
+    return fd_;
+}
+
+bool LocalSocketConnection::reconnect() {
+    auto fd = connect();
+    if (fd < 0)
+        return false;
+
+    std::lock_guard<std::mutex> l(lock_);
+    fd_ = fd;
+    return true;
 }
 
 ssize_t LocalSocketConnection::read_all(std::uint8_t *buffer, const size_t &size) {
-    ssize_t bytes_read = ::recv(fd_, reinterpret_cast<void*>(buffer), size, 0);
+    ssize_t bytes_read = ::recv(fd(), reinterpret_cast<void*>(buffer), size, 0);
     return bytes_read;
 }
 
 void LocalSocketConnection::send(char const* data, size_t length) {
+    const auto fd = this->fd();
     size_t bytes_written{0};
 
     while(bytes_written < length) {
-        ssize_t const result = ::send(fd_,
+        ssize_t const result = ::send(fd,
                                       data + bytes_written,
                                       length - bytes_written,
                                       MSG_NOSIGNAL);
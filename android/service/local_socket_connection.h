@@ -18,6 +18,7 @@
 #ifndef ANBOX_ANDROID_LOCAL_SOCKET_CONNECTION_H_
 #define ANBOX_ANDROID_LOCAL_SOCKET_CONNECTION_H_
 
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -34,7 +35,16 @@ public:
     void send(char const* data, size_t length) override;
     ssize_t send_raw(char const* data, size_t length) override;
 
+    // Connects again, e.g. when the host went away and a new one listens
+    // on the same socket. Returns false if nobody accepts the connection.
+    bool reconnect();
+
 private:
+    Fd connect() const;
+    Fd fd() const;
+
+    const std::string path_;
+    mutable std::mutex lock_;
     Fd fd_;
 };
 } // namespace anbox
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#define LOG_TAG "Anboxd"
+
+#include "android/service/memory_pressure_listener.h"
+
+#include <functional>
+
+#include <cstdlib>
+
+#include <cutils/log.h>
+#include <cutils/properties.h>
+#include <hardware/qemud.h>
+
+#include <unistd.h>
+
+namespace {
+constexpr const char *service_name{"hw-control"};
+constexpr const char *level_prefix{"memory:pressure:"};
+constexpr const char *level_property{"anbox.memory.pressure"};
+} // namespace
+
+namespace anbox {
+constexpr std::chrono::seconds MemoryPressureListener::kill_interval;
+
+MemoryPressureListener::MemoryPressureListener() :
+    running_(false) {
+}
+
+MemoryPressureListener::~MemoryPressureListener() {
+    stop();
+}
+
+void MemoryPressureListener::start() {
+    if (running_.exchange(true))
+        return;
+
+    thread_ = std::thread(std::bind(&MemoryPressureListener::main_loop, this));
+}
+
+void MemoryPressureListener::stop() {
+    if (!running_.exchange(false))
+        return;
+
+    thread_.join();
+}
+
+void MemoryPressureListener::main_loop() {
+    const auto fd = qemud_channel_open(service_name);
+    if (fd < 0) {
+        ALOGW("Failed to connect to %s, not listening for memory pressure", service_name);
+        return;
+    }
+
+    const std::string listen = std::string(level_prefix) + "listen";
+    if (qemud_channel_send(fd, listen.c_str(), listen.size()) < 0) {
+        ALOGW("Failed to ask for memory pressure updates");
+        ::close(fd);
+        return;
+    }
+
+    while (running_) {
+        char buffer[64];
+        const auto size = qemud_channel_recv(fd, buffer, sizeof(buffer) - 1);
+        if (size <= 0)
+            break;
+
+        const std::string message(buffer, size);
+        if (message.compare(0, std::string(level_prefix).size(), level_prefix) == 0)
+            handle_level(message.substr(std::string(level_prefix).size()));
+    }
+
+    ::close(fd);
+}
+
+void MemoryPressureListener::handle_level(const std::string &level) {
+    ALOGI("Host memory pressure is %s", level.c_str());
+    property_set(level_property, level.c_str());
+
+    if (level != "medium" && level != "critical")
+        return;
+
+    const auto now = std::chrono::steady_clock::now();
+    if (now - last_kill_ < kill_interval)
+        return;
+    last_kill_ = now;
+
+    // The activity manager knows which processes are in the background and
+    // lets them save their state before they go.
+    if (std::system("/system/bin/am kill-all > /dev/null 2>&1") != 0)
+        ALOGW("Failed to kill background processes");
+}
+} // namespace anbox
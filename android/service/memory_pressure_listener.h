@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_ANDROID_MEMORY_PRESSURE_LISTENER_H_
+#define ANBOX_ANDROID_MEMORY_PRESSURE_LISTENER_H_
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+namespace anbox {
+// Gets the memory pressure of the host through the hw-control service and
+// makes room before the host starts to thrash: whenever the pressure rises
+// to medium or critical all background processes get killed, but not more
+// often than once every |kill_interval|. The current level is available to
+// everyone else as the anbox.memory.pressure property.
+class MemoryPressureListener {
+public:
+    static constexpr std::chrono::seconds kill_interval{10};
+
+    MemoryPressureListener();
+    ~MemoryPressureListener();
+
+    void start();
+    void stop();
+
+private:
+    void main_loop();
+    void handle_level(const std::string &level);
+
+    std::thread thread_;
+    std::atomic<bool> running_;
+    std::chrono::steady_clock::time_point last_kill_;
+};
+} // namespace anbox
+
+#endif
@@ -25,26 +25,59 @@
 #include "anbox_rpc.pb.h"
 #include "anbox_bridge.pb.h"
 
+#include <cutils/log.h>
+
 namespace anbox {
 MessageProcessor::MessageProcessor(const std::shared_ptr<network::MessageSender> &sender,
                                    const std::shared_ptr<rpc::PendingCallCache> &pending_calls,
-                                   const std::shared_ptr<AndroidApiSkeleton> &platform_api) :
-    rpc::MessageProcessor(sender, pending_calls),
-    platform_api_(platform_api) {
+                                   const std::shared_ptr<AndroidApiSkeleton> &platform_api,
+                                   const std::shared_ptr<rpc::Framing> &framing,
+                                   std::size_t workers) :
+    rpc::MessageProcessor(sender, pending_calls, framing),
+    platform_api_(platform_api),
+    workers_(new WorkerPool(workers)) {
 }
 
 MessageProcessor::~MessageProcessor() {
 }
 
+template <typename Function>
+void MessageProcessor::post(WorkerPool::Priority priority, rpc::Invocation const &invocation,
+                            Function function) {
+  // The invocation only refers to a message which is gone once we return.
+  auto raw_invocation = std::make_shared<protobuf::rpc::Invocation>();
+  raw_invocation->set_id(invocation.id());
+  raw_invocation->set_method_name(invocation.method_name());
+  raw_invocation->set_parameters(invocation.parameters());
+
+  workers_->post(priority, [this, raw_invocation, function]() {
+    try {
+      invoke(this, platform_api_.get(), function, rpc::Invocation(*raw_invocation));
+    } catch (std::exception const &err) {
+      ALOGE("Failed to process %s: %s", raw_invocation->method_name().c_str(), err.what());
+    }
+  });
+}
+
 void MessageProcessor::dispatch(rpc::Invocation const& invocation) {
+  // Focus and resize changes are what the user waits for, so they never
+  // queue up behind application launches.
   if (invocation.method_name() == "launch_application")
-    invoke(this, platform_api_.get(), &AndroidApiSkeleton::launch_application, invocation);
+    post(WorkerPool::Priority::Normal, invocation, &AndroidApiSkeleton::launch_application);
   else if (invocation.method_name() == "set_focused_task")
-    invoke(this, platform_api_.get(), &AndroidApiSkeleton::set_focused_task, invocation);
+    post(WorkerPool::Priority::High, invocation, &AndroidApiSkeleton::set_focused_task);
   else if (invocation.method_name() == "remove_task")
-    invoke(this, platform_api_.get(), &AndroidApiSkeleton::remove_task, invocation);
+    post(WorkerPool::Priority::High, invocation, &AndroidApiSkeleton::remove_task);
   else if (invocation.method_name() == "resize_task")
-    invoke(this, platform_api_.get(), &AndroidApiSkeleton::resize_task, invocation);
+    post(WorkerPool::Priority::High, invocation, &AndroidApiSkeleton::resize_task);
+  else if (invocation.method_name() == "set_display_metrics")
+    post(WorkerPool::Priority::Normal, invocation, &AndroidApiSkeleton::set_display_metrics);
+  else if (invocation.method_name() == "get_application_icons")
+    post(WorkerPool::Priority::Normal, invocation, &AndroidApiSkeleton::get_application_icons);
+  else if (invocation.method_name() == "clipboard_changed")
+    post(WorkerPool::Priority::High, invocation, &AndroidApiSkeleton::clipboard_changed);
+  else if (invocation.method_name() == "set_frame_statistics_reporting")
+    post(WorkerPool::Priority::Normal, invocation, &AndroidApiSkeleton::set_frame_statistics_reporting);
 }
 
 void MessageProcessor::process_event_sequence(const std::string&) {
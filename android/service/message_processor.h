@@ -18,6 +18,8 @@
 #ifndef ANBOX_ANDROID_MESSAGE_PROCESSOR_H_
 #define ANBOX_ANDROID_MESSAGE_PROCESSOR_H_
 
+#include "android/service/worker_pool.h"
+
 #include "anbox/rpc/message_processor.h"
 
 namespace anbox {
@@ -26,14 +28,23 @@ class MessageProcessor : public rpc::MessageProcessor {
 public:
     MessageProcessor(const std::shared_ptr<network::MessageSender> &sender,
                      const std::shared_ptr<rpc::PendingCallCache> &pending_calls,
-                     const std::shared_ptr<AndroidApiSkeleton> &platform_api);
+                     const std::shared_ptr<AndroidApiSkeleton> &platform_api,
+                     const std::shared_ptr<rpc::Framing> &framing,
+                     std::size_t workers = WorkerPool::default_workers);
     ~MessageProcessor();
 
     void dispatch(rpc::Invocation const& invocation) override;
     void process_event_sequence(const std::string &event) override;
 
 private:
+    // Runs |function| on one of the workers which replies once it is done.
+    template <typename Function>
+    void post(WorkerPool::Priority priority, rpc::Invocation const &invocation,
+              Function function);
+
     std::shared_ptr<AndroidApiSkeleton> platform_api_;
+    // Last so the workers are gone before anything they use.
+    std::unique_ptr<WorkerPool> workers_;
 };
 } // namespace network
 
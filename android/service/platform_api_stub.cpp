@@ -16,12 +16,19 @@
  */
 
 #include "android/service/platform_api_stub.h"
+#include "android/service/icon_store.h"
+#include "anbox/bridge/guest_frame_statistics.h"
+#include "anbox/bridge/window_state_encoder.h"
+#include "anbox/bridge/window_state_frame.h"
 #include "anbox/rpc/channel.h"
+#include "anbox/rpc/constants.h"
 
 #include "anbox_rpc.pb.h"
 #include "anbox_bridge.pb.h"
 
+#include <algorithm>
 #include <fstream>
+#include <functional>
 
 #include <sys/stat.h>
 
@@ -30,11 +37,52 @@
 
 namespace {
 constexpr const char *first_boot_marker_path{"/data/.anbox_initialized"};
+
+void merge_application_list(anbox::PlatformApiStub::ApplicationListUpdate &pending,
+                            const anbox::PlatformApiStub::ApplicationListUpdate &update) {
+    auto &apps = pending.applications;
+    auto &removed = pending.removed_applications;
+
+    for (const auto &a : update.applications) {
+        removed.erase(std::remove(removed.begin(), removed.end(), a.package), removed.end());
+        auto existing = std::find_if(apps.begin(), apps.end(), [&](const anbox::PlatformApiStub::ApplicationListUpdate::Application &other) {
+            return other.package == a.package;
+        });
+        if (existing != apps.end())
+            *existing = a;
+        else
+            apps.push_back(a);
+    }
+
+    for (const auto &package : update.removed_applications) {
+        apps.erase(std::remove_if(apps.begin(), apps.end(), [&](const anbox::PlatformApiStub::ApplicationListUpdate::Application &a) {
+            return a.package == package;
+        }), apps.end());
+        if (std::find(removed.begin(), removed.end(), package) == removed.end())
+            removed.push_back(package);
+    }
+}
 }
 
 namespace anbox {
-PlatformApiStub::PlatformApiStub(const std::shared_ptr<rpc::Channel> &rpc_channel) :
-    rpc_channel_(rpc_channel) {
+constexpr std::chrono::milliseconds PlatformApiStub::event_coalescing_delay;
+
+PlatformApiStub::PlatformApiStub(const std::shared_ptr<rpc::Channel> &rpc_channel,
+                                 const std::shared_ptr<IconStore> &icons) :
+    rpc_channel_(rpc_channel),
+    icons_(icons),
+    window_state_encoder_(new bridge::WindowStateEncoder),
+    running_(true) {
+    event_thread_ = std::thread(std::bind(&PlatformApiStub::event_loop, this));
+}
+
+PlatformApiStub::~PlatformApiStub() {
+    {
+        std::lock_guard<std::mutex> l(events_mutex_);
+        running_ = false;
+    }
+    events_changed_.notify_all();
+    event_thread_.join();
 }
 
 void PlatformApiStub::boot_finished() {
@@ -51,88 +99,163 @@ void PlatformApiStub::boot_finished() {
 }
 
 void PlatformApiStub::update_window_state(const WindowStateUpdate &state) {
-    protobuf::bridge::EventSequence seq;
-    auto event = seq.mutable_window_state_update();
-
-    auto convert_window = [](WindowStateUpdate::Window in, anbox::protobuf::bridge::WindowStateUpdateEvent_WindowState *out) {
-        out->set_display_id(in.display_id);
-        out->set_has_surface(in.has_surface);
-        out->set_package_name(in.package_name);
-        out->set_frame_left(in.frame.left);
-        out->set_frame_top(in.frame.top);
-        out->set_frame_right(in.frame.right);
-        out->set_frame_bottom(in.frame.bottom);
-        out->set_task_id(in.task_id);
-        out->set_stack_id(in.stack_id);
-    };
-
-    for (const auto &window : state.updated_windows) {
-        auto w = event->add_windows();
-        convert_window(window, w);
-    }
+    // Every update reports all windows so the last one supersedes any
+    // other still waiting to be sent.
+    std::lock_guard<std::mutex> l(events_mutex_);
+    pending_.windows = state;
+    pending_.has_windows = true;
+    schedule_events_locked();
+}
 
-    for (const auto &window : state.removed_windows) {
-        auto w = event->add_removed_windows();
-        convert_window(window, w);
-    }
+void PlatformApiStub::update_application_list(const ApplicationListUpdate &update) {
+    std::lock_guard<std::mutex> l(events_mutex_);
+    merge_application_list(pending_.applications, update);
+    pending_.has_applications = true;
+    schedule_events_locked();
+}
 
+void PlatformApiStub::report_frame_statistics(const bridge::GuestFrameStatistics &statistics) {
+    protobuf::bridge::EventSequence seq;
+    statistics.write(*seq.mutable_guest_frame_statistics());
     rpc_channel_->send_event(seq);
 }
 
-void PlatformApiStub::update_application_list(const ApplicationListUpdate &update) {
+void PlatformApiStub::schedule_events_locked() {
+    if (events_pending_)
+        return;
+
+    events_pending_ = true;
+    events_due_ = std::chrono::steady_clock::now() + event_coalescing_delay;
+    events_changed_.notify_all();
+}
+
+void PlatformApiStub::event_loop() {
+    std::unique_lock<std::mutex> l(events_mutex_);
+    while (true) {
+        events_changed_.wait(l, [&]() { return !running_ || events_pending_; });
+        if (!events_pending_)
+            break;
+
+        // Whatever else comes in until then goes out together with it.
+        events_changed_.wait_until(l, events_due_, [&]() { return !running_; });
+
+        PendingEvents events;
+        std::swap(events, pending_);
+        events_pending_ = false;
+
+        l.unlock();
+        send_events(events);
+        l.lock();
+    }
+}
+
+void PlatformApiStub::send_events(const PendingEvents &events) {
     protobuf::bridge::EventSequence seq;
-    auto event = seq.mutable_application_list_update();
 
-    for (const auto &a : update.applications) {
-        auto app = event->add_applications();
-        app->set_name(a.name);
-        app->set_package(a.package);
-
-        auto launch_intent = app->mutable_launch_intent();
-        launch_intent->set_action(a.launch_intent.action);
-        launch_intent->set_uri(a.launch_intent.uri);
-        launch_intent->set_type(a.launch_intent.type);
-        launch_intent->set_package(a.launch_intent.package);
-        launch_intent->set_component(a.launch_intent.component);
-        for (const auto &category : a.launch_intent.categories) {
-            auto c = launch_intent->add_categories();
-            *c = category;
+    if (events.has_windows) {
+        auto convert_window = [](const WindowStateUpdate::Window &in, anbox::protobuf::bridge::WindowStateUpdateEvent_WindowState *out) {
+            out->set_display_id(in.display_id);
+            out->set_has_surface(in.has_surface);
+            out->set_package_name(in.package_name);
+            out->set_frame_left(in.frame.left);
+            out->set_frame_top(in.frame.top);
+            out->set_frame_right(in.frame.right);
+            out->set_frame_bottom(in.frame.bottom);
+            out->set_task_id(in.task_id);
+            out->set_stack_id(in.stack_id);
+        };
+
+        // All windows are reported every time. The host only gets what changed
+        // since, which while a window is dragged is its frame and nothing else.
+        protobuf::bridge::WindowStateUpdateEvent full;
+        for (const auto &window : events.windows.updated_windows) {
+            auto w = full.add_windows();
+            convert_window(window, w);
         }
 
-        app->set_icon(a.icon.data(), a.icon.size());
+        protobuf::bridge::WindowStateUpdateEvent delta;
+        if (window_state_encoder_->encode(full, delta)) {
+            // Hosts which can read them in place get these as raw event.
+            if (delta.incremental() &&
+                rpc_channel_->peer_protocol_version() >= rpc::raw_event_protocol_version) {
+                rpc_channel_->send_raw_event(
+                    bridge::WindowStateFrame::kind, bridge::WindowStateFrame::size(delta),
+                    [&](std::uint8_t *out) { bridge::WindowStateFrame::write(delta, out); });
+            } else {
+                seq.mutable_window_state_update()->Swap(&delta);
+            }
+        }
     }
 
-    for (const auto &package : update.removed_applications) {
-      auto app = event->add_removed_applications();
-      app->set_name("unknown");
-      app->set_package(package);
+    if (events.has_applications) {
+        const auto &update = events.applications;
+        auto event = seq.mutable_application_list_update();
+
+        // The icons make up most of the update and barely ever change, the host
+        // asks for those it doesn't know yet.
+        std::vector<std::vector<int8_t>> icons;
+        for (const auto &a : update.applications)
+            icons.push_back(a.icon);
+        const auto icon_hashes = icons_->replace(icons);
+
+        for (std::size_t n = 0; n < update.applications.size(); n++) {
+            const auto &a = update.applications[n];
+            auto app = event->add_applications();
+            app->set_name(a.name);
+            app->set_package(a.package);
+
+            auto launch_intent = app->mutable_launch_intent();
+            launch_intent->set_action(a.launch_intent.action);
+            launch_intent->set_uri(a.launch_intent.uri);
+            launch_intent->set_type(a.launch_intent.type);
+            launch_intent->set_package(a.launch_intent.package);
+            launch_intent->set_component(a.launch_intent.component);
+            for (const auto &category : a.launch_intent.categories) {
+                auto c = launch_intent->add_categories();
+                *c = category;
+            }
+
+            if (!a.icon.empty())
+                app->set_icon_hash(icon_hashes[n]);
+        }
+
+        for (const auto &package : update.removed_applications) {
+          auto app = event->add_removed_applications();
+          app->set_name("unknown");
+          app->set_package(package);
+        }
     }
 
+    if (!seq.has_window_state_update() && !seq.has_application_list_update())
+        return;
+
     rpc_channel_->send_event(seq);
 }
 
-void PlatformApiStub::on_clipboard_data_set(Request<protobuf::rpc::Void> *request) {
-    request->wh.result_received();
+void PlatformApiStub::on_clipboard_data_sent(Request<protobuf::rpc::Void> *request) {
+    if (request->response->has_error())
+        ALOGE("Failed to set clipboard data: %s", request->response->error().c_str());
+    delete request;
 }
 
 void PlatformApiStub::set_clipboard_data(const ClipboardData &data) {
-    auto c = std::make_shared<Request<protobuf::rpc::Void>>();
+    {
+        std::lock_guard<decltype(clipboard_mutex_)> lock(clipboard_mutex_);
+        if (clipboard_valid_ && clipboard_.text == data.text)
+            return;
+        clipboard_ = data;
+        clipboard_valid_ = clipboard_changes_pushed_;
+        clipboard_generation_++;
+    }
+
+    auto c = new Request<protobuf::rpc::Void>;
 
     protobuf::bridge::ClipboardData message;
     message.set_text(data.text);
 
-    {
-      std::lock_guard<decltype(mutex_)> lock(mutex_);
-      c->wh.expect_result();
-    }
-
     rpc_channel_->call_method("set_clipboard_data", &message, c->response.get(),
                               google::protobuf::NewCallback(
-                                  this, &PlatformApiStub::on_clipboard_data_set, c.get()));
-
-    c->wh.wait_for_all();
-
-    if (c->response->has_error()) throw std::runtime_error(c->response->error());
+                                  this, &PlatformApiStub::on_clipboard_data_sent, c));
 }
 
 void PlatformApiStub::on_clipboard_data_get(Request<protobuf::bridge::ClipboardData> *request) {
@@ -140,12 +263,18 @@ void PlatformApiStub::on_clipboard_data_get(Request<protobuf::bridge::ClipboardD
 }
 
 PlatformApiStub::ClipboardData PlatformApiStub::get_clipboard_data() {
+    std::uint64_t generation = 0;
+    {
+        std::lock_guard<decltype(clipboard_mutex_)> lock(clipboard_mutex_);
+        if (clipboard_valid_)
+            return clipboard_;
+        generation = clipboard_generation_;
+    }
+
     auto c = std::make_shared<Request<protobuf::bridge::ClipboardData>>();
 
     protobuf::rpc::Void message;
 
-    received_clipboard_data_ = ClipboardData{};
-
     {
       std::lock_guard<decltype(mutex_)> lock(mutex_);
       c->wh.expect_result();
@@ -159,6 +288,25 @@ PlatformApiStub::ClipboardData PlatformApiStub::get_clipboard_data() {
 
     if (c->response->has_error()) throw std::runtime_error(c->response->error());
 
-    return ClipboardData{c->response->text()};
+    const ClipboardData data{c->response->text()};
+
+    {
+        std::lock_guard<decltype(clipboard_mutex_)> lock(clipboard_mutex_);
+        // Only keep it when the host will tell us about the next change and
+        // nothing changed while we were asking.
+        if (clipboard_changes_pushed_ && generation == clipboard_generation_) {
+            clipboard_ = data;
+            clipboard_valid_ = true;
+        }
+    }
+
+    return data;
+}
+
+void PlatformApiStub::clipboard_changed() {
+    std::lock_guard<decltype(clipboard_mutex_)> lock(clipboard_mutex_);
+    clipboard_changes_pushed_ = true;
+    clipboard_valid_ = false;
+    clipboard_generation_++;
 }
 } // namespace anbox
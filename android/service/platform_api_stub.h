@@ -20,9 +20,14 @@
 
 #include "anbox/common/wait_handle.h"
 
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <vector>
 #include <string>
+#include <thread>
 
 namespace anbox {
 namespace protobuf {
@@ -36,9 +41,21 @@ class ClipboardData;
 namespace rpc {
 class Channel;
 } // namespace rpc
+namespace bridge {
+class GuestFrameStatistics;
+class WindowStateEncoder;
+} // namespace bridge
+class IconStore;
 class PlatformApiStub {
 public:
-    PlatformApiStub(const std::shared_ptr<rpc::Channel> &rpc_channel);
+    // Window and application list updates come in bursts, e.g. while
+    // switching tasks. Those arriving within this delay of each other
+    // are sent to the host together.
+    static constexpr std::chrono::milliseconds event_coalescing_delay{16};
+
+    PlatformApiStub(const std::shared_ptr<rpc::Channel> &rpc_channel,
+                    const std::shared_ptr<IconStore> &icons);
+    ~PlatformApiStub();
 
     void boot_finished();
 
@@ -84,12 +101,19 @@ public:
 
     void update_application_list(const ApplicationListUpdate &update);
 
+    // Sent right away, the statistics are only collected every few seconds.
+    void report_frame_statistics(const bridge::GuestFrameStatistics &statistics);
+
     struct ClipboardData {
         std::string text;
     };
 
+    // Setting the clipboard doesn't wait for the host. Reading it only asks
+    // the host when the content changed since we last asked, which the host
+    // tells us about through clipboard_changed().
     void set_clipboard_data(const ClipboardData &data);
     ClipboardData get_clipboard_data();
+    void clipboard_changed();
 
 private:
     template<typename Response>
@@ -100,13 +124,43 @@ private:
         common::WaitHandle wh;
     };
 
-    void on_clipboard_data_set(Request<protobuf::rpc::Void> *request);
+    void on_clipboard_data_sent(Request<protobuf::rpc::Void> *request);
     void on_clipboard_data_get(Request<protobuf::bridge::ClipboardData> *request);
 
     mutable std::mutex mutex_;
     std::shared_ptr<rpc::Channel> rpc_channel_;
 
-    ClipboardData received_clipboard_data_;
+    std::mutex clipboard_mutex_;
+    ClipboardData clipboard_;
+    bool clipboard_valid_ = false;
+    // Until the host told us about a change once it might not support
+    // sending them, so we keep asking it every time.
+    bool clipboard_changes_pushed_ = false;
+    std::uint64_t clipboard_generation_ = 0;
+
+    std::shared_ptr<IconStore> icons_;
+
+    struct PendingEvents {
+        bool has_windows = false;
+        WindowStateUpdate windows;
+        bool has_applications = false;
+        ApplicationListUpdate applications;
+    };
+
+    void schedule_events_locked();
+    void event_loop();
+    void send_events(const PendingEvents &events);
+
+    // Only used by the event thread.
+    std::unique_ptr<bridge::WindowStateEncoder> window_state_encoder_;
+
+    std::mutex events_mutex_;
+    std::condition_variable events_changed_;
+    PendingEvents pending_;
+    bool events_pending_ = false;
+    std::chrono::steady_clock::time_point events_due_;
+    bool running_;
+    std::thread event_thread_;
 };
 } // namespace anbox
 
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#define LOG_TAG "Anboxd"
+
+#include "android/service/worker_pool.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <cutils/log.h>
+#include <cutils/properties.h>
+
+namespace {
+constexpr const char *workers_property{"anbox.service.workers"};
+} // namespace
+
+namespace anbox {
+constexpr std::size_t WorkerPool::default_workers;
+
+std::size_t WorkerPool::configured_workers() {
+    char value[PROPERTY_VALUE_MAX];
+    if (property_get(workers_property, value, nullptr) <= 0)
+        return default_workers;
+
+    const auto workers = std::atoi(value);
+    if (workers < 2) {
+        ALOGW("Ignoring %s=%s, need at least two workers", workers_property, value);
+        return default_workers;
+    }
+    return static_cast<std::size_t>(workers);
+}
+
+WorkerPool::WorkerPool(std::size_t workers) :
+    max_normal_(std::max<std::size_t>(workers, 2) - 1) {
+    for (std::size_t n = 0; n <= max_normal_; n++)
+        threads_.push_back(std::thread(std::bind(&WorkerPool::worker_loop, this)));
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> l(mutex_);
+        stopped_ = true;
+    }
+    changed_.notify_all();
+
+    for (auto &thread : threads_)
+        thread.join();
+}
+
+void WorkerPool::post(Priority priority, const std::function<void()> &task) {
+    {
+        std::lock_guard<std::mutex> l(mutex_);
+        if (priority == Priority::High)
+            high_.push_back(task);
+        else
+            normal_.push_back(task);
+    }
+    changed_.notify_one();
+}
+
+bool WorkerPool::next_task(std::function<void()> &task, bool &normal) {
+    if (!high_.empty() && !running_high_) {
+        task = std::move(high_.front());
+        high_.pop_front();
+        normal = false;
+        running_high_ = true;
+        return true;
+    }
+
+    if (!normal_.empty() && running_normal_ < max_normal_) {
+        task = std::move(normal_.front());
+        normal_.pop_front();
+        normal = true;
+        running_normal_++;
+        return true;
+    }
+
+    return false;
+}
+
+void WorkerPool::worker_loop() {
+    std::unique_lock<std::mutex> l(mutex_);
+    while (true) {
+        std::function<void()> task;
+        bool normal = false;
+        changed_.wait(l, [&]() { return stopped_ || next_task(task, normal); });
+        if (stopped_)
+            break;
+
+        l.unlock();
+        task();
+        // Drop whatever the task holds on to before we wait again.
+        task = nullptr;
+        l.lock();
+
+        if (normal)
+            running_normal_--;
+        else
+            running_high_ = false;
+    }
+}
+} // namespace anbox
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_ANDROID_WORKER_POOL_H_
+#define ANBOX_ANDROID_WORKER_POOL_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace anbox {
+// Runs the requests we get from the host so that a slow one, e.g. an
+// application launch waiting for the activity manager, doesn't hold up
+// the connection or the others. High priority tasks always run first and
+// one worker is kept for them only so they never wait for normal ones.
+// They also run one after another in the order they were posted, which
+// matters as e.g. the last resize of a task has to win.
+class WorkerPool {
+public:
+    enum class Priority { High, Normal };
+
+    static constexpr std::size_t default_workers{3};
+
+    // Uses the anbox.service.workers property and falls back to
+    // |default_workers| when it isn't set. At least two workers are used.
+    static std::size_t configured_workers();
+
+    explicit WorkerPool(std::size_t workers);
+    ~WorkerPool();
+
+    // Tasks not started yet when the pool goes away are dropped.
+    void post(Priority priority, const std::function<void()> &task);
+
+private:
+    void worker_loop();
+    // Needs |mutex_| to be held.
+    bool next_task(std::function<void()> &task, bool &normal);
+
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::deque<std::function<void()>> high_;
+    std::deque<std::function<void()>> normal_;
+    std::size_t max_normal_;
+    std::size_t running_normal_ = 0;
+    bool running_high_ = false;
+    bool stopped_ = false;
+    std::vector<std::thread> threads_;
+};
+} // namespace anbox
+
+#endif
@@ -22,6 +22,14 @@
 #define ETC1_RGB8_OES 0x8D64
 #endif
 
+#ifndef GL_COMPRESSED_RGB8_ETC2
+#define GL_COMPRESSED_RGB8_ETC2 0x9274
+#endif
+
+#ifndef GL_COMPRESSED_RGBA8_ETC2_EAC
+#define GL_COMPRESSED_RGBA8_ETC2_EAC 0x9278
+#endif
+
 typedef unsigned char etc1_byte;
 typedef int etc1_bool;
 typedef unsigned int etc1_uint32;
@@ -79,6 +87,35 @@ int etc1_decode_image(const etc1_byte* pIn, etc1_byte* pOut,
         etc1_uint32 width, etc1_uint32 height,
         etc1_uint32 pixelSize, etc1_uint32 stride);
 
+// Decode a block of ETC2 RGB8 pixels. Same as etc1_decode_block, but also
+// handles the T, H and planar modes added by ETC2.
+
+void etc2_decode_block(const etc1_byte* pIn, etc1_byte* pOut);
+
+// Decode a block of EAC alpha values.
+//
+// pOut is a pointer to a 16 byte array, byte (x + 4 * y) is the alpha value
+// of pixel (x, y).
+
+void etc2_decode_alpha_block(const etc1_byte* pIn, etc1_byte* pOut);
+
+// Return the size of the encoded ETC2 RGB8 image data, or of the RGBA8 EAC
+// image data if hasAlpha is set.
+
+etc1_uint32 etc2_get_encoded_data_size(etc1_uint32 width, etc1_uint32 height,
+        etc1_bool hasAlpha);
+
+// Decode an entire ETC2 RGB8 image, or RGBA8 EAC image if hasAlpha is set.
+// pIn - pointer to encoded data.
+// pOut - pointer to the image data. Will be written such that
+//        pixel (x,y) is at pOut + pixelSize * x + stride * y, where
+//        pixelSize is 4 for images with alpha and 3 otherwise.
+// returns non-zero if there is an error.
+
+int etc2_decode_image(const etc1_byte* pIn, etc1_byte* pOut,
+        etc1_uint32 width, etc1_uint32 height,
+        etc1_bool hasAlpha, etc1_uint32 stride);
+
 // Size of a PKM header, in bytes.
 
 #define ETC_PKM_HEADER_SIZE 16
@@ -10,6 +10,15 @@
 #define LIST_RENDER_EGL_EXTENSIONS_FUNCTIONS(X) \
   X(EGLImageKHR, eglCreateImageKHR, (EGLDisplay display, EGLContext context, EGLenum target, EGLClientBuffer buffer, const EGLint* attrib_list)) \
   X(EGLBoolean, eglDestroyImageKHR, (EGLDisplay display, EGLImageKHR image)) \
+  X(EGLDisplay, eglGetPlatformDisplayEXT, (EGLenum platform, void* native_display, const EGLint* attrib_list)) \
+  X(EGLBoolean, eglExportDMABUFImageQueryMESA, (EGLDisplay display, EGLImageKHR image, int* fourcc, int* num_planes, EGLuint64KHR* modifiers)) \
+  X(EGLBoolean, eglExportDMABUFImageMESA, (EGLDisplay display, EGLImageKHR image, int* fds, EGLint* strides, EGLint* offsets)) \
+  X(EGLSyncKHR, eglCreateSyncKHR, (EGLDisplay display, EGLenum type, const EGLint* attrib_list)) \
+  X(EGLBoolean, eglDestroySyncKHR, (EGLDisplay display, EGLSyncKHR sync)) \
+  X(EGLint, eglClientWaitSyncKHR, (EGLDisplay display, EGLSyncKHR sync, EGLint flags, EGLTimeKHR timeout)) \
+  X(EGLint, eglWaitSyncKHR, (EGLDisplay display, EGLSyncKHR sync, EGLint flags)) \
+  X(EGLBoolean, eglQueryDevicesEXT, (EGLint max_devices, EGLDeviceEXT* devices, EGLint* num_devices)) \
+  X(const char*, eglQueryDeviceStringEXT, (EGLDeviceEXT device, EGLint name)) \
 
 
 #endif  // RENDER_EGL_EXTENSIONS_FUNCTIONS_H
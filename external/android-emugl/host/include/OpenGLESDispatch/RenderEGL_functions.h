@@ -25,6 +25,8 @@
   X(EGLContext, eglGetCurrentContext, ()) \
   X(EGLSurface, eglGetCurrentSurface, (EGLint readdraw)) \
   X(EGLBoolean, eglSwapBuffers, (EGLDisplay display, EGLSurface surface)) \
+  X(EGLBoolean, eglSwapInterval, (EGLDisplay display, EGLint interval)) \
+  X(EGLBoolean, eglQuerySurface, (EGLDisplay display, EGLSurface surface, EGLint attribute, EGLint* value)) \
   X(void*, eglGetProcAddress, (const char* function_name)) \
 
 
@@ -4,10 +4,22 @@
 #ifndef GLES2_EXTENSIONS_FUNCTIONS_H
 #define GLES2_EXTENSIONS_FUNCTIONS_H
 
+#include <GLES/gl.h>
+
+// Used to avoid adding GLES2/gl2ext.h to our headers.
+#ifndef GL_PROGRAM_BINARY_LENGTH_OES
+#define GL_PROGRAM_BINARY_LENGTH_OES  0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS_OES
+#define GL_NUM_PROGRAM_BINARY_FORMATS_OES  0x87FE
+#endif
+
 #define LIST_GLES2_EXTENSIONS_FUNCTIONS(X) \
   X(void, glGetShaderPrecisionFormat, (GLenum shadertype, GLenum precisiontype, GLint* range, GLint* precision), (shadertype, precisiontype, range, precision)) \
   X(void, glReleaseShaderCompiler, (), ()) \
   X(void, glShaderBinary, (GLsizei n, const GLuint* shaders, GLenum binaryformat, const GLvoid* binary, GLsizei length), (n, shaders, binaryformat, binary, length)) \
+  X(void, glGetProgramBinaryOES, (GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, GLvoid* binary), (program, bufSize, length, binaryFormat, binary)) \
+  X(void, glProgramBinaryOES, (GLuint program, GLenum binaryFormat, const GLvoid* binary, GLint length), (program, binaryFormat, binary, length)) \
 
 
 #endif  // GLES2_EXTENSIONS_FUNCTIONS_H
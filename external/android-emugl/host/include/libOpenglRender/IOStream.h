@@ -32,6 +32,18 @@ public:
     virtual const unsigned char *read(void *buf, size_t *inout_len) = 0;
     virtual void forceStop() = 0;
 
+    // Optional zero-copy read interface. Streams which buffer incoming
+    // data themselves can hand out a pointer to the next contiguous chunk
+    // of it so that the caller can decode it in place instead of copying
+    // it out with read() first. peek() blocks until data is available and
+    // returns NULL if the stream doesn't support this or got stopped. Data
+    // returned by peek() is only released by a following consume().
+    virtual const unsigned char *peek(size_t *out_len) {
+        *out_len = 0;
+        return NULL;
+    }
+    virtual void consume(size_t len) { (void)len; }
+
     virtual ~IOStream() {
         // NOTE: m_buf is 'owned' by the child class thus we expect it to be released by it
     }
@@ -19,6 +19,9 @@
 #include <GLES/gl.h>
 #include <GLES/glext.h>
 
+#include <memory>
+#include <mutex>
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -27,6 +30,12 @@ static inline void* SafePointerFromUInt(GLuint value) {
   return (void*)(uintptr_t)value;
 }
 
+// See GLESv2Decoder, resolved once for all render threads.
+static std::mutex s_dispatchLock;
+static std::unique_ptr<gles1_server_context_t> s_dispatch;
+static GLESv1Decoder::get_proc_func_t s_dispatchGetProc = NULL;
+static void *s_dispatchGetProcData = NULL;
+
 GLESv1Decoder::GLESv1Decoder()
 {
     m_contextData = NULL;
@@ -43,7 +52,17 @@ GLESv1Decoder::~GLESv1Decoder()
 
 int GLESv1Decoder::initGL(get_proc_func_t getProcFunc, void *getProcFuncData)
 {
-    this->initDispatchByName(getProcFunc, getProcFuncData);
+    {
+        std::lock_guard<std::mutex> lock(s_dispatchLock);
+        if (!s_dispatch || s_dispatchGetProc != getProcFunc ||
+            s_dispatchGetProcData != getProcFuncData) {
+            s_dispatch.reset(new gles1_server_context_t);
+            s_dispatch->initDispatchByName(getProcFunc, getProcFuncData);
+            s_dispatchGetProc = getProcFunc;
+            s_dispatchGetProcData = getProcFuncData;
+        }
+        static_cast<gles1_server_context_t &>(*this) = *s_dispatch;
+    }
 
     glGetCompressedTextureFormats = s_glGetCompressedTextureFormats;
     glVertexPointerOffset = s_glVertexPointerOffset;
@@ -15,19 +15,75 @@
 */
 
 #include "GLESv2Decoder.h"
+#include "SharedBufferMemory.h"
+#include "glUtils.h"
 
 #include <EGL/egl.h>
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
 
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <string.h>
+
+// Guests which never fetch what they asked for can't make us hold on to
+// more than this many readbacks.
+static const size_t kMaxPendingReads = 4;
+
+// Bound for waiting on a readback before we consider the GPU to be stuck.
+static const unsigned long long kReadFenceTimeoutNs = 1000000000ULL;
+
+#ifndef GL_PIXEL_PACK_BUFFER
+#define GL_PIXEL_PACK_BUFFER 0x88EB
+#endif
+#ifndef GL_STREAM_READ
+#define GL_STREAM_READ 0x88E1
+#endif
+#ifndef GL_MAP_READ_BIT
+#define GL_MAP_READ_BIT 0x0001
+#endif
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+#ifndef GL_SYNC_FLUSH_COMMANDS_BIT
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#endif
+#ifndef GL_TIMEOUT_EXPIRED
+#define GL_TIMEOUT_EXPIRED 0x911B
+#endif
+#ifndef GL_WAIT_FAILED
+#define GL_WAIT_FAILED 0x911D
+#endif
+
 static inline void* SafePointerFromUInt(GLuint value) {
   return (void*)(uintptr_t)value;
 }
 
+// Every render thread has its own decoder but they all end up with the
+// same entry points, which take a few hundred symbol lookups to resolve.
+static std::mutex s_dispatchLock;
+static std::unique_ptr<gles2_server_context_t> s_dispatch;
+static GLESv2Decoder::get_proc_func_t s_dispatchGetProc = NULL;
+static void *s_dispatchGetProcData = NULL;
+
 GLESv2Decoder::GLESv2Decoder()
 {
     m_contextData = NULL;
     m_GL2library = NULL;
+    m_pboSupport = PBO_UNKNOWN;
+    m_getProcFunc = NULL;
+    m_getProcFuncData = NULL;
+    m_glMapBufferRange = NULL;
+    m_glUnmapBuffer = NULL;
+    m_glFenceSync = NULL;
+    m_glClientWaitSync = NULL;
+    m_glDeleteSync = NULL;
+    m_error = GL_NO_ERROR;
+    m_glGetError = NULL;
+    m_sharedMemoryOwner = 0;
 }
 
 GLESv2Decoder::~GLESv2Decoder()
@@ -55,20 +111,58 @@ void *GLESv2Decoder::s_getProc(const char *name, void *userData)
 
 int GLESv2Decoder::initGL(get_proc_func_t getProcFunc, void *getProcFuncData)
 {
-    this->initDispatchByName(getProcFunc, getProcFuncData);
+    {
+        std::lock_guard<std::mutex> lock(s_dispatchLock);
+        if (!s_dispatch || s_dispatchGetProc != getProcFunc ||
+            s_dispatchGetProcData != getProcFuncData) {
+            s_dispatch.reset(new gles2_server_context_t);
+            s_dispatch->initDispatchByName(getProcFunc, getProcFuncData);
+            s_dispatchGetProc = getProcFunc;
+            s_dispatchGetProcData = getProcFuncData;
+        }
+        static_cast<gles2_server_context_t &>(*this) = *s_dispatch;
+    }
+    m_getProcFunc = getProcFunc;
+    m_getProcFuncData = getProcFuncData;
 
+    m_glGetError = (GLenum (gles2_APIENTRY *)(void))getProcFunc("glGetError", getProcFuncData);
+    glGetError = s_glGetError;
     glGetCompressedTextureFormats = s_glGetCompressedTextureFormats;
     glVertexAttribPointerData = s_glVertexAttribPointerData;
     glVertexAttribPointerOffset = s_glVertexAttribPointerOffset;
 
     glDrawElementsOffset = s_glDrawElementsOffset;
     glDrawElementsData = s_glDrawElementsData;
+    glDrawElementsInstancedOffsetANBOX = s_glDrawElementsInstancedOffsetANBOX;
+    glDrawElementsInstancedDataANBOX = s_glDrawElementsInstancedDataANBOX;
+    glBufferDataSharedANBOX = s_glBufferDataSharedANBOX;
+    glBufferSubDataSharedANBOX = s_glBufferSubDataSharedANBOX;
     glShaderString = s_glShaderString;
     glFinishRoundTrip = s_glFinishRoundTrip;
+    glGetLinkedProgramInfo = s_glGetLinkedProgramInfo;
+    glReadPixelsAsyncANBOX = s_glReadPixelsAsyncANBOX;
+    glFetchReadPixelsANBOX = s_glFetchReadPixelsANBOX;
     return 0;
 
 }
 
+void GLESv2Decoder::setError(GLenum error)
+{
+    if (m_error == GL_NO_ERROR)
+        m_error = error;
+}
+
+GLenum GLESv2Decoder::s_glGetError(void *self)
+{
+    GLESv2Decoder *ctx = (GLESv2Decoder *)self;
+    if (ctx->m_error != GL_NO_ERROR) {
+        const GLenum error = ctx->m_error;
+        ctx->m_error = GL_NO_ERROR;
+        return error;
+    }
+    return ctx->m_glGetError ? ctx->m_glGetError() : GL_NO_ERROR;
+}
+
 int GLESv2Decoder::s_glFinishRoundTrip(void *self)
 {
     GLESv2Decoder *ctx = (GLESv2Decoder *)self;
@@ -122,8 +216,276 @@ void GLESv2Decoder::s_glDrawElementsOffset(void *self, GLenum mode, GLsizei coun
     ctx->glDrawElements(mode, count, type, SafePointerFromUInt(offset));
 }
 
+void GLESv2Decoder::s_glDrawElementsInstancedDataANBOX(void *self, GLenum mode, GLsizei count, GLenum type, void * data, GLuint datalen, GLsizei primcount)
+{
+    GLESv2Decoder *ctx = (GLESv2Decoder *)self;
+    ctx->glDrawElementsInstancedEXT(mode, count, type, data, primcount);
+}
+
+void GLESv2Decoder::s_glDrawElementsInstancedOffsetANBOX(void *self, GLenum mode, GLsizei count, GLenum type, GLuint offset, GLsizei primcount)
+{
+    GLESv2Decoder *ctx = (GLESv2Decoder *)self;
+    ctx->glDrawElementsInstancedEXT(mode, count, type, SafePointerFromUInt(offset), primcount);
+}
+
+// The guest wrote the data to memory it shared with us through the
+// "pipe:anbox:buffer-memory" connection, so only the range comes through
+// the stream. It waits for |sequence| before it writes there again.
+void GLESv2Decoder::s_glBufferDataSharedANBOX(void *self, GLenum target, GLsizeiptr size, GLenum usage, GLuint memory, GLuint sequence)
+{
+    GLESv2Decoder *ctx = (GLESv2Decoder *)self;
+    const auto shared = SharedBufferMemory::get(memory, ctx->m_sharedMemoryOwner);
+    if (!shared) {
+        fprintf(stderr, "%s: unknown shared buffer memory %u\n", __FUNCTION__, memory);
+        ctx->setError(GL_INVALID_OPERATION);
+        return;
+    }
+    if (size < 0 || static_cast<size_t>(size) > shared->size()) {
+        fprintf(stderr, "%s: size %ld exceeds shared buffer memory %u\n", __FUNCTION__,
+                static_cast<long>(size), memory);
+        ctx->setError(GL_INVALID_OPERATION);
+        // The guest still waits for the update before reusing the memory.
+        shared->consume(sequence);
+        return;
+    }
+    ctx->glBufferData(target, size, shared->data(), usage);
+    shared->consume(sequence);
+}
+
+void GLESv2Decoder::s_glBufferSubDataSharedANBOX(void *self, GLenum target, GLintptr offset, GLsizeiptr size, GLuint memory, GLuint sequence)
+{
+    GLESv2Decoder *ctx = (GLESv2Decoder *)self;
+    const auto shared = SharedBufferMemory::get(memory, ctx->m_sharedMemoryOwner);
+    if (!shared) {
+        fprintf(stderr, "%s: unknown shared buffer memory %u\n", __FUNCTION__, memory);
+        ctx->setError(GL_INVALID_OPERATION);
+        return;
+    }
+    if (offset < 0 || size < 0 ||
+        static_cast<size_t>(offset) > shared->size() ||
+        static_cast<size_t>(size) > shared->size() - static_cast<size_t>(offset)) {
+        fprintf(stderr, "%s: range %ld+%ld exceeds shared buffer memory %u\n", __FUNCTION__,
+                static_cast<long>(offset), static_cast<long>(size), memory);
+        ctx->setError(GL_INVALID_OPERATION);
+        shared->consume(sequence);
+        return;
+    }
+    ctx->glBufferSubData(target, offset, size, shared->data() + offset);
+    shared->consume(sequence);
+}
+
 void GLESv2Decoder::s_glShaderString(void *self, GLuint shader, const GLchar* string, GLsizei len)
 {
     GLESv2Decoder *ctx = (GLESv2Decoder *)self;
     ctx->glShaderSource(shader, 1, &string, NULL);
 }
+
+// Packs everything the guest needs to know about a program after linking
+// it into |info| so it doesn't have to query each uniform on its own.
+//
+//   info[0]  link status
+//   info[1]  number of active uniforms, 0 if linking failed
+//   info[2]  number of GLints the complete info takes
+//
+// followed by size, type, location and name length of each uniform and
+// its zero terminated name padded to a multiple of a GLint. If |bufSize|
+// bytes aren't enough only the first three values are filled in.
+void GLESv2Decoder::s_glGetLinkedProgramInfo(void *self, GLuint program, GLsizei bufSize, GLint *info)
+{
+    GLESv2Decoder *ctx = (GLESv2Decoder *)self;
+
+    std::vector<GLint> packed(3, 0);
+    ctx->glGetProgramiv(program, GL_LINK_STATUS, &packed[0]);
+    if (packed[0]) {
+        GLint numUniforms = 0;
+        ctx->glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &numUniforms);
+        GLint maxLength = 0;
+        ctx->glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+        std::vector<GLchar> name(maxLength + 1);
+        for (GLint i = 0; i < numUniforms; i++) {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            ctx->glGetActiveUniform(program, i, name.size(), &length, &size, &type, &name[0]);
+            name[length] = '\0';
+
+            packed.push_back(size);
+            packed.push_back(type);
+            packed.push_back(ctx->glGetUniformLocation(program, &name[0]));
+            packed.push_back(length);
+
+            const size_t offset = packed.size();
+            packed.resize(offset + (length + sizeof(GLint)) / sizeof(GLint), 0);
+            memcpy(&packed[offset], &name[0], length);
+        }
+        packed[1] = numUniforms;
+    }
+    packed[2] = packed.size();
+
+    const size_t available = bufSize > 0 ? bufSize / sizeof(GLint) : 0;
+    const size_t count = packed.size() <= available ? packed.size() : std::min<size_t>(3, available);
+    if (count > 0)
+        memcpy(info, &packed[0], count * sizeof(GLint));
+}
+
+// Pixel pack buffers need a GLES 3.x context, which we only know for sure
+// once a context is current.
+bool GLESv2Decoder::hasPixelPackBuffers()
+{
+    if (m_pboSupport != PBO_UNKNOWN)
+        return m_pboSupport == PBO_SUPPORTED;
+
+    m_pboSupport = PBO_UNSUPPORTED;
+    const char *version = (const char *)glGetString(GL_VERSION);
+    if (!version || !m_getProcFunc)
+        return false;
+
+    // GLES reports "OpenGL ES N.M ..." while desktop GL reports "N.M ...".
+    static const char prefix[] = "OpenGL ES ";
+    if (strncmp(version, prefix, sizeof(prefix) - 1) == 0)
+        version += sizeof(prefix) - 1;
+    if (version[0] < '3' || version[0] > '9')
+        return false;
+
+    m_glMapBufferRange = (void *(gles2_APIENTRY *)(GLenum, GLintptr, GLsizeiptr, GLbitfield))
+            m_getProcFunc("glMapBufferRange", m_getProcFuncData);
+    m_glUnmapBuffer = (GLboolean (gles2_APIENTRY *)(GLenum))
+            m_getProcFunc("glUnmapBuffer", m_getProcFuncData);
+    m_glFenceSync = (void *(gles2_APIENTRY *)(GLenum, GLbitfield))
+            m_getProcFunc("glFenceSync", m_getProcFuncData);
+    m_glClientWaitSync = (GLenum (gles2_APIENTRY *)(void *, GLbitfield, unsigned long long))
+            m_getProcFunc("glClientWaitSync", m_getProcFuncData);
+    m_glDeleteSync = (void (gles2_APIENTRY *)(void *))
+            m_getProcFunc("glDeleteSync", m_getProcFuncData);
+    if (!m_glMapBufferRange || !m_glUnmapBuffer || !m_glFenceSync ||
+        !m_glClientWaitSync || !m_glDeleteSync)
+        return false;
+
+    m_pboSupport = PBO_SUPPORTED;
+    return true;
+}
+
+size_t GLESv2Decoder::readPixelsSize(GLsizei width, GLsizei height, GLenum format, GLenum type)
+{
+    const int bits = glUtilsPixelBitSize(format, type);
+    if (bits <= 0)
+        return 0;
+
+    GLint alignment = 4;
+    glGetIntegerv(GL_PACK_ALIGNMENT, &alignment);
+    if (alignment <= 0)
+        alignment = 1;
+
+    // The last row isn't padded to the alignment.
+    const size_t row = ((size_t)width * bits + 7) / 8;
+    const size_t stride = (row + alignment - 1) / alignment * alignment;
+    return stride * (height - 1) + row;
+}
+
+void GLESv2Decoder::releasePendingRead(PendingRead &read)
+{
+    if (read.fence) {
+        m_glDeleteSync(read.fence);
+        read.fence = NULL;
+    }
+    if (read.buffer) {
+        glDeleteBuffers(1, &read.buffer);
+        read.buffer = 0;
+    }
+    read.pixels.clear();
+}
+
+// The guest doesn't wait for the pixels here, the decoder runs ahead of it.
+// With pixel pack buffers the read is only queued behind the pending GPU
+// work, otherwise it's done right away. Either way by the time the guest
+// asks for the pixels with glFetchReadPixelsANBOX only the transfer back is
+// left. Both calls have to be made with the same context current.
+void GLESv2Decoder::s_glReadPixelsAsyncANBOX(void *self, GLuint token, GLint x, GLint y,
+                                           GLsizei width, GLsizei height, GLenum format,
+                                           GLenum type, GLsizei bufSize)
+{
+    GLESv2Decoder *ctx = (GLESv2Decoder *)self;
+    if (bufSize <= 0)
+        return;
+
+    // Without a pixel pack buffer the host writes the pixels straight into
+    // memory we allocate from |bufSize|, so it has to fit what the guest
+    // asks for. The size of a pack buffer is checked by the host itself.
+    const bool pbo = ctx->hasPixelPackBuffers();
+    if (!pbo && width > 0 && height > 0) {
+        const size_t needed = ctx->readPixelsSize(width, height, format, type);
+        if (needed == 0) {
+            ctx->setError(GL_INVALID_ENUM);
+            return;
+        }
+        if (needed > static_cast<size_t>(bufSize)) {
+            fprintf(stderr, "%s: %d bytes are too small for %dx%d pixels\n", __FUNCTION__,
+                    bufSize, width, height);
+            ctx->setError(GL_INVALID_OPERATION);
+            return;
+        }
+    }
+
+    std::map<GLuint, PendingRead>::iterator it = ctx->m_pendingReads.find(token);
+    if (it == ctx->m_pendingReads.end()) {
+        if (ctx->m_pendingReads.size() >= kMaxPendingReads) {
+            ctx->releasePendingRead(ctx->m_pendingReads.begin()->second);
+            ctx->m_pendingReads.erase(ctx->m_pendingReads.begin());
+        }
+        PendingRead read = { 0, 0, NULL, std::vector<unsigned char>() };
+        it = ctx->m_pendingReads.insert(std::make_pair(token, read)).first;
+    } else {
+        ctx->releasePendingRead(it->second);
+    }
+    PendingRead &read = it->second;
+    read.size = bufSize;
+
+    if (pbo) {
+        ctx->glGenBuffers(1, &read.buffer);
+        ctx->glBindBuffer(GL_PIXEL_PACK_BUFFER, read.buffer);
+        ctx->glBufferData(GL_PIXEL_PACK_BUFFER, bufSize, NULL, GL_STREAM_READ);
+        ctx->glReadPixels(x, y, width, height, format, type, NULL);
+        ctx->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        read.fence = ctx->m_glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        return;
+    }
+
+    read.pixels.assign(bufSize, 0);
+    ctx->glReadPixels(x, y, width, height, format, type, &read.pixels[0]);
+}
+
+void GLESv2Decoder::s_glFetchReadPixelsANBOX(void *self, GLuint token, GLsizei bufSize, GLvoid *pixels)
+{
+    GLESv2Decoder *ctx = (GLESv2Decoder *)self;
+    if (bufSize <= 0)
+        return;
+
+    memset(pixels, 0, bufSize);
+
+    std::map<GLuint, PendingRead>::iterator it = ctx->m_pendingReads.find(token);
+    if (it == ctx->m_pendingReads.end())
+        return;
+    PendingRead &read = it->second;
+    const GLsizei size = std::min(bufSize, read.size);
+
+    if (read.buffer) {
+        const GLenum result = ctx->m_glClientWaitSync(read.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                                      kReadFenceTimeoutNs);
+        if (result != GL_WAIT_FAILED && result != GL_TIMEOUT_EXPIRED) {
+            ctx->glBindBuffer(GL_PIXEL_PACK_BUFFER, read.buffer);
+            const void *src = ctx->m_glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size,
+                                                      GL_MAP_READ_BIT);
+            if (src) {
+                memcpy(pixels, src, size);
+                ctx->m_glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            }
+            ctx->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+    } else if (!read.pixels.empty()) {
+        memcpy(pixels, &read.pixels[0], size);
+    }
+
+    ctx->releasePendingRead(read);
+    ctx->m_pendingReads.erase(it);
+}
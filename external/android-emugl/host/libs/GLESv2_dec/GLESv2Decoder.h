@@ -21,6 +21,11 @@
 #include "GLDecoderContextData.h"
 #include "emugl/common/shared_library.h"
 
+#include <sys/types.h>
+
+#include <map>
+#include <vector>
+
 class GLESv2Decoder : public gles2_decoder_context_t
 {
 public:
@@ -29,6 +34,12 @@ public:
     ~GLESv2Decoder();
     int initGL(get_proc_func_t getProcFunc, void *getProcFuncData);
     void setContextData(GLDecoderContextData *contextData) { m_contextData = contextData; }
+    // Drops the asynchronous reads of a client which is gone. Their buffers
+    // and fences went away together with its contexts.
+    void forgetPendingReads() { m_pendingReads.clear(); }
+    // Only buffer memory the guest process |owner| shared can be used by
+    // the glBuffer(Sub)DataSharedANBOX commands, see SharedBufferMemory.
+    void setSharedMemoryOwner(pid_t owner) { m_sharedMemoryOwner = owner; }
 private:
     GLDecoderContextData *m_contextData;
     emugl::SharedLibrary* m_GL2library;
@@ -42,7 +53,54 @@ private:
 
     static void gles2_APIENTRY s_glDrawElementsOffset(void *self, GLenum mode, GLsizei count, GLenum type, GLuint offset);
     static void gles2_APIENTRY s_glDrawElementsData(void *self, GLenum mode, GLsizei count, GLenum type, void * data, GLuint datalen);
+    static void gles2_APIENTRY s_glDrawElementsInstancedOffsetANBOX(void *self, GLenum mode, GLsizei count, GLenum type, GLuint offset, GLsizei primcount);
+    static void gles2_APIENTRY s_glDrawElementsInstancedDataANBOX(void *self, GLenum mode, GLsizei count, GLenum type, void * data, GLuint datalen, GLsizei primcount);
+    static void gles2_APIENTRY s_glBufferDataSharedANBOX(void *self, GLenum target, GLsizeiptr size, GLenum usage, GLuint memory, GLuint sequence);
+    static void gles2_APIENTRY s_glBufferSubDataSharedANBOX(void *self, GLenum target, GLintptr offset, GLsizeiptr size, GLuint memory, GLuint sequence);
     static void gles2_APIENTRY s_glShaderString(void *self, GLuint shader, const GLchar* string, GLsizei len);
     static int  gles2_APIENTRY s_glFinishRoundTrip(void *self);
+    static void gles2_APIENTRY s_glGetLinkedProgramInfo(void *self, GLuint program, GLsizei bufSize, GLint *info);
+    static void gles2_APIENTRY s_glReadPixelsAsyncANBOX(void *self, GLuint token, GLint x, GLint y,
+                                      GLsizei width, GLsizei height, GLenum format, GLenum type, GLsizei bufSize);
+    static void gles2_APIENTRY s_glFetchReadPixelsANBOX(void *self, GLuint token, GLsizei bufSize, GLvoid *pixels);
+    static GLenum gles2_APIENTRY s_glGetError(void *self);
+
+    // Errors of the calls we decode ourselves, handed out by glGetError
+    // before those of the host. Like GL we only keep the first one.
+    void setError(GLenum error);
+    // Bytes glReadPixels writes for the given rectangle with the current
+    // pack alignment, 0 if it doesn't know |format| and |type|.
+    size_t readPixelsSize(GLsizei width, GLsizei height, GLenum format, GLenum type);
+
+    // A glReadPixelsAsyncANBOX result the guest didn't fetch yet. It is
+    // either queued into a pixel pack buffer guarded by |fence| or, if the
+    // host context can't do that, already read into |pixels|.
+    struct PendingRead {
+        GLuint buffer;
+        GLsizei size;
+        void *fence;
+        std::vector<unsigned char> pixels;
+    };
+
+    bool hasPixelPackBuffers();
+    void releasePendingRead(PendingRead &read);
+
+    std::map<GLuint, PendingRead> m_pendingReads;
+
+    // GLES 3.x entry points used for the pixel pack buffers, resolved when
+    // the first asynchronous read is started.
+    enum { PBO_UNKNOWN, PBO_SUPPORTED, PBO_UNSUPPORTED } m_pboSupport;
+    get_proc_func_t m_getProcFunc;
+    void *m_getProcFuncData;
+    void *(gles2_APIENTRY *m_glMapBufferRange)(GLenum, GLintptr, GLsizeiptr, GLbitfield);
+    GLboolean (gles2_APIENTRY *m_glUnmapBuffer)(GLenum);
+    void *(gles2_APIENTRY *m_glFenceSync)(GLenum, GLbitfield);
+    GLenum (gles2_APIENTRY *m_glClientWaitSync)(void *, GLbitfield, unsigned long long);
+    void (gles2_APIENTRY *m_glDeleteSync)(void *);
+
+    GLenum m_error;
+    GLenum (gles2_APIENTRY *m_glGetError)(void);
+
+    pid_t m_sharedMemoryOwner;
 };
 #endif
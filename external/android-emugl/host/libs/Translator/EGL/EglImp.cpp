@@ -215,6 +215,27 @@ static __translator_getGLESIfaceFunc loadIfaces(const char* libName,
 #define LIB_GLES_CM_NAME EMUGL_LIBNAME("GLES_CM_translator")
 #define LIB_GLES_V2_NAME EMUGL_LIBNAME("GLES_V2_translator")
 
+static const GLESiface* getOrLoadIface(GLESVersion version) {
+    if (version != GLES_1_1) {
+        return g_eglInfo->getIface(version);
+    }
+
+    emugl::Mutex::AutoLock mutex(s_eglLock);
+    if (!g_eglInfo->getIface(GLES_1_1)) {
+        char error[256];
+        __translator_getGLESIfaceFunc func =
+                loadIfaces(LIB_GLES_CM_NAME, error, sizeof(error));
+        if (!func) {
+            fprintf(stderr, "%s: Could not find ifaces for GLES CM 1.1 [%s]\n",
+                    __FUNCTION__, error);
+            return NULL;
+        }
+        g_eglInfo->setIface(func(&s_eglIface), GLES_1_1);
+        initGLESx(GLES_1_1);
+    }
+    return g_eglInfo->getIface(GLES_1_1);
+}
+
 EGLAPI EGLBoolean EGLAPIENTRY eglInitialize(EGLDisplay display, EGLint *major, EGLint *minor) {
 
     initGlobalInfo();
@@ -230,18 +251,9 @@ EGLAPI EGLBoolean EGLAPIENTRY eglInitialize(EGLDisplay display, EGLint *major, E
     __translator_getGLESIfaceFunc func  = NULL;
     int renderableType = EGL_OPENGL_ES_BIT;
 
+    // GLES 1.1 is only loaded once a context asks for it, most clients
+    // never do, see getOrLoadIface().
     char error[256];
-    if(!g_eglInfo->getIface(GLES_1_1)) {
-        func  = loadIfaces(LIB_GLES_CM_NAME, error, sizeof(error));
-        if (func) {
-            g_eglInfo->setIface(func(&s_eglIface),GLES_1_1);
-        } else {
-           fprintf(stderr, "%s: Could not find ifaces for GLES CM 1.1 [%s]\n",
-                   __FUNCTION__, error);
-           return EGL_FALSE;
-        }
-        initGLESx(GLES_1_1);
-    }
     if(!g_eglInfo->getIface(GLES_2_0)) {
         func  = loadIfaces(LIB_GLES_V2_NAME, error, sizeof(error));
         if (func) {
@@ -653,7 +665,7 @@ EGLAPI EGLContext EGLAPIENTRY eglCreateContext(EGLDisplay display, EGLConfig con
             i+=2;
         }
     }
-    const GLESiface* iface = g_eglInfo->getIface(version);
+    const GLESiface* iface = getOrLoadIface(version);
     GLEScontext* glesCtx = NULL;
     if(iface) {
         glesCtx = iface->createGLESContext();
@@ -948,6 +960,13 @@ EGLAPI EGLImageKHR EGLAPIENTRY eglCreateImageKHR(EGLDisplay display, EGLContext
     ThreadInfo* thread  = getThreadInfo();
     ShareGroupPtr sg = thread->shareGroup;
     if (sg.Ptr() != NULL) {
+        // Drawing to the image must not change other textures.
+        const GLESiface* iface = thread->eglContext.Ptr() ?
+                g_eglInfo->getIface(thread->eglContext->version()) : NULL;
+        if (iface && iface->unshareTexture) {
+            iface->unshareTexture(SafeUIntFromPointer(buffer));
+        }
+
         unsigned int globalTexName = sg->getGlobalName(TEXTURE, SafeUIntFromPointer(buffer));
         if (!globalTexName) return EGL_NO_IMAGE_KHR;
 
@@ -16,34 +16,42 @@
 #include "EglThreadInfo.h"
 #include "EglOsApi.h"
 
-#include "emugl/common/lazy_instance.h"
-#include "emugl/common/thread_store.h"
+#include <stddef.h>
 
 namespace {
 
-class EglThreadInfoStore : public emugl::ThreadStore {
-public:
-    EglThreadInfoStore() : emugl::ThreadStore(&destructor) {}
-private:
-    static void destructor(void* value) {
-        delete static_cast<EglThreadInfo*>(value);
+// Looked up on every EGL call. The translator is loaded with dlopen() so
+// this keeps the default TLS model, which still beats
+// pthread_getspecific(). The holder deletes the info when the thread
+// exits.
+thread_local EglThreadInfo* s_threadInfo = NULL;
+
+struct EglThreadInfoHolder {
+    ~EglThreadInfoHolder() {
+        if (s_threadInfo == info) {
+            s_threadInfo = NULL;
+        }
+        delete info;
+        info = NULL;
     }
+
+    EglThreadInfo* info = NULL;
 };
 
+thread_local EglThreadInfoHolder s_holder;
+
 }  // namespace
 
 EglThreadInfo::EglThreadInfo() :
         m_err(EGL_SUCCESS), m_api(EGL_OPENGL_ES_API) {}
 
-static emugl::LazyInstance<EglThreadInfoStore> s_tls = LAZY_INSTANCE_INIT;
-
 EglThreadInfo* EglThreadInfo::get(void)
 {
-    EglThreadInfo *ti = static_cast<EglThreadInfo*>(s_tls->get());
+    EglThreadInfo *ti = s_threadInfo;
     if (!ti) {
         ti = new EglThreadInfo();
-        s_tls->set(ti);
+        s_holder.info = ti;
+        s_threadInfo = ti;
     }
     return ti;
 }
-
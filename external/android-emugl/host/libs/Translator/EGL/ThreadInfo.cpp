@@ -16,9 +16,6 @@
 
 #include "ThreadInfo.h"
 
-#include "emugl/common/lazy_instance.h"
-#include "emugl/common/thread_store.h"
-
 #include <stdio.h>
 
 // Set TRACE_THREADINFO to 1 to debug creation/destruction of ThreadInfo
@@ -33,28 +30,29 @@
 
 namespace {
 
-class ThreadInfoStore : public ::emugl::ThreadStore {
-public:
-    ThreadInfoStore() : ::emugl::ThreadStore(&destructor) {}
-
-    size_t getInstanceCount() const { return mNumInstances; }
-
-private:
-    static void destructor(void* value) {
-        LOG_THREADINFO("%s: EFL %p (%d instances)\n", __FUNCTION__,
-                       value, mNumInstances);
-        delete static_cast<ThreadInfo*>(value);
-        mNumInstances--;
+// Every GL call looks up the current context through getThreadInfo(), so
+// the pointer is a plain thread_local. The translator is loaded with
+// dlopen() and thus keeps the default TLS model. The holder only
+// deletes the info when the thread exits.
+thread_local ThreadInfo* s_threadInfo = NULL;
+
+struct ThreadInfoHolder {
+    ~ThreadInfoHolder() {
+        LOG_THREADINFO("%s: EGL %p\n", __FUNCTION__, info);
+        if (s_threadInfo == info) {
+            s_threadInfo = NULL;
+        }
+        delete info;
+        info = NULL;
     }
 
-    static size_t mNumInstances;
+    ThreadInfo* info = NULL;
 };
 
-size_t ThreadInfoStore::mNumInstances = 0;
+thread_local ThreadInfoHolder s_holder;
 
 }  // namespace
 
-
 void ThreadInfo::updateInfo(ContextPtr eglCtx,
                             EglDisplay* dpy,
                             GLEScontext* glesCtx,
@@ -68,16 +66,14 @@ void ThreadInfo::updateInfo(ContextPtr eglCtx,
     objManager  = manager;
 }
 
-static ::emugl::LazyInstance<ThreadInfoStore> s_tls = LAZY_INSTANCE_INIT;
-
 ThreadInfo *getThreadInfo()
 {
-    ThreadInfo *ti = static_cast<ThreadInfo*>(s_tls->get());
+    ThreadInfo *ti = s_threadInfo;
     if (!ti) {
         ti = new ThreadInfo();
-        s_tls->set(ti);
-        LOG_THREADINFO("%s: EGL %p (%d instances)\n", __FUNCTION__,
-                       ti, (int)ThreadInfoStore::getInstanceCount());
+        s_holder.info = ti;
+        s_threadInfo = ti;
+        LOG_THREADINFO("%s: EGL %p\n", __FUNCTION__, ti);
     }
     return ti;
 }
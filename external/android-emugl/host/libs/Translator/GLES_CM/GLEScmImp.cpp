@@ -63,7 +63,8 @@ static GLESiface  s_glesIface = {
     .flush             = (FUNCPTR)glFlush,
     .finish            = (FUNCPTR)glFinish,
     .setShareGroup     = setShareGroup,
-    .getProcAddress    = getProcAddress
+    .getProcAddress    = getProcAddress,
+    .unshareTexture    = NULL
 };
 
 #include <GLcommon/GLESmacros.h>
@@ -145,7 +145,8 @@ bool GLESv2Context::needConvert(GLESConversionArrays& cArrs,GLint first,GLsizei
 void GLESv2Context::initExtensionString() {
     *s_glExtensions = "GL_OES_EGL_image GL_OES_EGL_image_external GL_OES_depth24 GL_OES_depth32 GL_OES_element_index_uint "
                       "GL_OES_texture_float GL_OES_texture_float_linear "
-                      "GL_OES_compressed_paletted_texture GL_OES_compressed_ETC1_RGB8_texture GL_OES_depth_texture ";
+                      "GL_OES_compressed_paletted_texture GL_OES_compressed_ETC1_RGB8_texture GL_OES_depth_texture "
+                      "GL_OES_compressed_ETC2_RGB8_texture GL_OES_compressed_ETC2_RGBA8_texture ";
     if (s_glSupport.GL_ARB_HALF_FLOAT_PIXEL || s_glSupport.GL_NV_HALF_FLOAT)
         *s_glExtensions+="GL_OES_texture_half_float GL_OES_texture_half_float_linear ";
     if (s_glSupport.GL_EXT_PACKED_DEPTH_STENCIL)
@@ -159,6 +160,8 @@ void GLESv2Context::initExtensionString() {
     if (s_glSupport.GL_OES_RGB8_RGBA8) {
         *s_glExtensions+="GL_OES_rgb8_rgba8 ";
     }
+    if (s_glSupport.GL_ARB_INSTANCED_ARRAYS)
+        *s_glExtensions+="GL_EXT_instanced_arrays ";
 }
 
 int GLESv2Context::getMaxTexUnits() {
@@ -30,6 +30,7 @@
 #include "GLESv2Validate.h"
 #include "ShaderParser.h"
 #include "ProgramData.h"
+#include <GLcommon/TextureCache.h>
 #include <GLcommon/TextureUtils.h>
 #include <GLcommon/FramebufferData.h>
 
@@ -44,6 +45,7 @@ static void deleteGLESContext(GLEScontext* ctx);
 static void setShareGroup(GLEScontext* ctx,ShareGroupPtr grp);
 static GLEScontext* createGLESContext();
 static __translatorMustCastToProperFunctionPointerType getProcAddress(const char* procName);
+static void unshareTexture(unsigned int tex);
 
 }
 
@@ -62,7 +64,8 @@ static GLESiface  s_glesIface = {
     .flush             = (FUNCPTR)glFlush,
     .finish            = (FUNCPTR)glFinish,
     .setShareGroup     = setShareGroup,
-    .getProcAddress    = getProcAddress
+    .getProcAddress    = getProcAddress,
+    .unshareTexture    = unshareTexture
 };
 
 #include <GLcommon/GLESmacros.h>
@@ -107,6 +110,9 @@ static __translatorMustCastToProperFunctionPointerType getProcAddress(const char
             s_glesExtensions->clear();
         (*s_glesExtensions)["glEGLImageTargetTexture2DOES"] = (__translatorMustCastToProperFunctionPointerType)glEGLImageTargetTexture2DOES;
         (*s_glesExtensions)["glEGLImageTargetRenderbufferStorageOES"]=(__translatorMustCastToProperFunctionPointerType)glEGLImageTargetRenderbufferStorageOES;
+        (*s_glesExtensions)["glVertexAttribDivisorEXT"]=(__translatorMustCastToProperFunctionPointerType)glVertexAttribDivisorEXT;
+        (*s_glesExtensions)["glDrawArraysInstancedEXT"]=(__translatorMustCastToProperFunctionPointerType)glDrawArraysInstancedEXT;
+        (*s_glesExtensions)["glDrawElementsInstancedEXT"]=(__translatorMustCastToProperFunctionPointerType)glDrawElementsInstancedEXT;
     }
     __translatorMustCastToProperFunctionPointerType ret=NULL;
     ProcTableMap::iterator val = s_glesExtensions->find(procName);
@@ -171,6 +177,53 @@ static TextureData* getTextureTargetData(GLenum target){
     return getTextureData(TextureLocalName(target,tex));
 }
 
+// Smaller textures aren't worth hashing.
+static const GLsizei kMinCachedTexturePixels = 32 * 32;
+
+// Has to be called before anything changes the content or the sampling
+// state of the texture bound to |target|, see TextureCache. |copy| may
+// only be false if the first level is about to be replaced as a whole.
+static void unshareTargetTexture(GLenum target, bool copy) {
+    GET_CTX();
+    if (!TextureCache::get() || !ctx->shareGroup().Ptr()) return;
+    const ObjectLocalName tex = TextureLocalName(target,ctx->getBindedTexture(target));
+    ObjectDataPtr objData = ctx->shareGroup()->getObjectData(TEXTURE,tex);
+    TextureCache::unshareTexture(ctx, tex, (TextureData*)objData.Ptr(), copy);
+}
+
+static void unshareTexture(unsigned int tex) {
+    GET_CTX();
+    if (!TextureCache::get() || !ctx->shareGroup().Ptr()) return;
+    ObjectDataPtr objData = ctx->shareGroup()->getObjectData(TEXTURE,tex);
+    TextureCache::unshareTexture(ctx, tex, (TextureData*)objData.Ptr(), true);
+}
+
+// The sampling state is shared along with the content of a texture, so
+// changing it unshares the texture as does setting any other parameter.
+static void setTextureParameter(GLenum target, GLenum pname, GLint param) {
+    GET_CTX();
+    if (!TextureCache::get() || !ctx->shareGroup().Ptr() || target != GL_TEXTURE_2D) return;
+    TextureData* texData = getTextureTargetData(target);
+    if (!texData) return;
+
+    GLint* state = NULL;
+    switch (pname) {
+    case GL_TEXTURE_MIN_FILTER: state = &texData->minFilter; break;
+    case GL_TEXTURE_MAG_FILTER: state = &texData->magFilter; break;
+    case GL_TEXTURE_WRAP_S: state = &texData->wrapS; break;
+    case GL_TEXTURE_WRAP_T: state = &texData->wrapT; break;
+    default: break;
+    }
+    // Apps often set it after the upload, nothing has to be copied while
+    // the texture doesn't share its storage yet.
+    if (!state || (*state != param &&
+                   !(texData->cachedGlobal &&
+                     TextureCache::get()->updateSampling(texData->cachedGlobal, pname, param)))) {
+        unshareTargetTexture(target, true);
+    }
+    if (state) *state = param;
+}
+
 GL_APICALL void  GL_APIENTRY glActiveTexture(GLenum texture){
     GET_CTX_V2();
     SET_ERROR_IF (!GLESv2Validate::textureEnum(texture,ctx->getMaxCombinedTexUnits()),GL_INVALID_ENUM);
@@ -423,12 +476,14 @@ GL_APICALL void  GL_APIENTRY glCopyTexImage2D(GLenum target, GLint level, GLenum
     SET_ERROR_IF(!(GLESv2Validate::pixelFrmt(ctx,internalformat) && GLESv2Validate::textureTargetEx(target)),GL_INVALID_ENUM);
     SET_ERROR_IF((GLESv2Validate::textureIsCubeMap(target) && width != height), GL_INVALID_VALUE);
     SET_ERROR_IF(border != 0,GL_INVALID_VALUE);
+    unshareTargetTexture(target, level != 0);
     ctx->dispatcher().glCopyTexImage2D(target,level,internalformat,x,y,width,height,border);
 }
 
 GL_APICALL void  GL_APIENTRY glCopyTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint x, GLint y, GLsizei width, GLsizei height){
     GET_CTX();
     SET_ERROR_IF(!GLESv2Validate::textureTargetEx(target),GL_INVALID_ENUM);
+    unshareTargetTexture(target, true);
     ctx->dispatcher().glCopyTexSubImage2D(target,level,xoffset,yoffset,x,y,width,height);
 }
 
@@ -534,8 +589,14 @@ GL_APICALL void  GL_APIENTRY glDeleteTextures(GLsizei n, const GLuint* textures)
             if (textures[i]!=0) {
                 TextureData* tData = getTextureData(textures[i]);
                 // delete the underlying OpenGL texture but only if this
-                // texture is not a target of EGLImage.
-                if (!tData || tData->sourceEGLImage == 0) {
+                // texture is not a target of EGLImage and nothing else
+                // shares it.
+                if (tData && tData->cachedGlobal) {
+                    const GLuint sharedTextureName = tData->cachedGlobal;
+                    tData->cachedGlobal = 0;
+                    if (TextureCache::get()->release(sharedTextureName))
+                        ctx->dispatcher().glDeleteTextures(1,&sharedTextureName);
+                } else if (!tData || tData->sourceEGLImage == 0) {
                     const GLuint globalTextureName = ctx->shareGroup()->getGlobalName(TEXTURE,textures[i]);
                     ctx->dispatcher().glDeleteTextures(1,&globalTextureName);
                 }
@@ -789,6 +850,8 @@ GL_APICALL void  GL_APIENTRY glFramebufferTexture2D(GLenum target, GLenum attach
             ctx->shareGroup()->genName(TEXTURE,texture);
         }
         ObjectLocalName texname = TextureLocalName(textarget,texture);
+        // Rendering to it changes its content.
+        unshareTexture(texname);
         globalTextureName = ctx->shareGroup()->getGlobalName(TEXTURE,texname);
     }
 
@@ -825,6 +888,7 @@ GL_APICALL void  GL_APIENTRY glGenBuffers(GLsizei n, GLuint* buffers){
 GL_APICALL void  GL_APIENTRY glGenerateMipmap(GLenum target){
     GET_CTX();
     SET_ERROR_IF(!GLESvalidate::textureTarget(target), GL_INVALID_ENUM);
+    unshareTargetTexture(target, true);
     ctx->dispatcher().glGenerateMipmapEXT(target);
 }
 
@@ -1909,8 +1973,14 @@ GL_APICALL void  GL_APIENTRY glTexImage2D(GLenum target, GLint level, GLint inte
     SET_ERROR_IF(!(GLESv2Validate::pixelOp(format,type) && internalformat == ((GLint)format)),GL_INVALID_OPERATION);
     SET_ERROR_IF(border != 0,GL_INVALID_VALUE);
 
+    TextureCache* cache = TextureCache::get();
+    TextureCache::Key key;
+    TextureData *texData = NULL;
+    bool cacheable = false;
     if (ctx->shareGroup().Ptr()){
-        TextureData *texData = getTextureTargetData(target);
+        texData = getTextureTargetData(target);
+        // Other levels change what would be shared.
+        unshareTargetTexture(target, level != 0);
         if(texData) {
             texData->width = width;
             texData->height = height;
@@ -1937,6 +2007,41 @@ GL_APICALL void  GL_APIENTRY glTexImage2D(GLenum target, GLint level, GLint inte
                 texData->oldGlobal = 0;
             }
         }
+
+        // Only complete uploads of formats we can copy with the GPU once
+        // the texture is changed are shared.
+        const unsigned int tex = ctx->getBindedTexture(target);
+        cacheable = cache && texData && tex != 0 && target == GL_TEXTURE_2D &&
+                    level == 0 && pixels && type == GL_UNSIGNED_BYTE &&
+                    (format == GL_RGBA || format == GL_RGB) &&
+                    width * height >= kMinCachedTexturePixels;
+        if (cacheable) {
+            const size_t rowSize = width * (format == GL_RGBA ? 4 : 3);
+            const size_t align = ctx->getUnpackAlignment();
+            key.width = width;
+            key.height = height;
+            key.format = format;
+            key.type = type;
+            key.minFilter = texData->minFilter;
+            key.magFilter = texData->magFilter;
+            key.wrapS = texData->wrapS;
+            key.wrapT = texData->wrapT;
+            TextureCache::hashPixels(&key, pixels, rowSize,
+                                     (rowSize + align - 1) / align * align, height);
+
+            // Whatever other levels the texture had go away along with
+            // its own storage, apps generate or upload them after the
+            // first one anyway.
+            const GLuint shared = cache->acquire(key);
+            if (shared) {
+                const GLuint own = ctx->shareGroup()->getGlobalName(TEXTURE, tex);
+                ctx->dispatcher().glDeleteTextures(1, &own);
+                ctx->shareGroup()->replaceGlobalName(TEXTURE, tex, shared);
+                ctx->dispatcher().glBindTexture(GL_TEXTURE_2D, shared);
+                texData->cachedGlobal = shared;
+                return;
+            }
+        }
     }
 
     if (type==GL_HALF_FLOAT_OES)
@@ -1946,27 +2051,37 @@ GL_APICALL void  GL_APIENTRY glTexImage2D(GLenum target, GLint level, GLint inte
     if (type == GL_FLOAT)
         internalformat = (format == GL_RGBA) ? GL_RGBA32F : GL_RGB32F;
     ctx->dispatcher().glTexImage2D(target,level,internalformat,width,height,border,format,type,pixels);
+
+    if (cacheable) {
+        const GLuint own = ctx->shareGroup()->getGlobalName(TEXTURE, ctx->getBindedTexture(target));
+        if (cache->add(key, own))
+            texData->cachedGlobal = own;
+    }
 }
 
 
 GL_APICALL void  GL_APIENTRY glTexParameterf(GLenum target, GLenum pname, GLfloat param){
     GET_CTX();
     SET_ERROR_IF(!(GLESv2Validate::textureTarget(target) && GLESv2Validate::textureParams(pname)),GL_INVALID_ENUM);
+    setTextureParameter(target,pname,(GLint)param);
     ctx->dispatcher().glTexParameterf(target,pname,param);
 }
 GL_APICALL void  GL_APIENTRY glTexParameterfv(GLenum target, GLenum pname, const GLfloat* params){
     GET_CTX();
     SET_ERROR_IF(!(GLESv2Validate::textureTarget(target) && GLESv2Validate::textureParams(pname)),GL_INVALID_ENUM);
+    setTextureParameter(target,pname,(GLint)params[0]);
     ctx->dispatcher().glTexParameterfv(target,pname,params);
 }
 GL_APICALL void  GL_APIENTRY glTexParameteri(GLenum target, GLenum pname, GLint param){
     GET_CTX();
     SET_ERROR_IF(!(GLESv2Validate::textureTarget(target) && GLESv2Validate::textureParams(pname)),GL_INVALID_ENUM);
+    setTextureParameter(target,pname,param);
     ctx->dispatcher().glTexParameteri(target,pname,param);
 }
 GL_APICALL void  GL_APIENTRY glTexParameteriv(GLenum target, GLenum pname, const GLint* params){
     GET_CTX();
     SET_ERROR_IF(!(GLESv2Validate::textureTarget(target) && GLESv2Validate::textureParams(pname)),GL_INVALID_ENUM);
+    setTextureParameter(target,pname,params[0]);
     ctx->dispatcher().glTexParameteriv(target,pname,params);
 }
 
@@ -1981,6 +2096,7 @@ GL_APICALL void  GL_APIENTRY glTexSubImage2D(GLenum target, GLint level, GLint x
     if (type==GL_HALF_FLOAT_OES)
         type = GL_HALF_FLOAT_NV;
 
+    unshareTargetTexture(target, true);
     ctx->dispatcher().glTexSubImage2D(target,level,xoffset,yoffset,width,height,format,type,pixels);
 
 }
@@ -2204,6 +2320,7 @@ GL_APICALL void GL_APIENTRY glEGLImageTargetTexture2DOES(GLenum target, GLeglIma
         // current binded texture object to the existing global object.
         if (ctx->shareGroup().Ptr()) {
             ObjectLocalName tex = TextureLocalName(target,ctx->getBindedTexture(target));
+            unshareTargetTexture(target, false);
             unsigned int oldGlobal = ctx->shareGroup()->getGlobalName(TEXTURE, tex);
             // Delete old texture object but only if it is not a target of a EGLImage
             if (oldGlobal) {
@@ -2275,3 +2392,78 @@ GL_APICALL void GL_APIENTRY glEGLImageTargetRenderbufferStorageOES(GLenum target
         }
     }
 }
+
+GL_APICALL void GL_APIENTRY glVertexAttribDivisorEXT(GLuint index, GLuint divisor)
+{
+    GET_CTX();
+    SET_ERROR_IF(!ctx->getCaps()->GL_ARB_INSTANCED_ARRAYS,GL_INVALID_OPERATION);
+    SET_ERROR_IF(!GLESv2Validate::arrayIndex(ctx,index),GL_INVALID_VALUE);
+    ctx->dispatcher().glVertexAttribDivisor(index,divisor);
+}
+
+GL_APICALL void GL_APIENTRY glDrawArraysInstancedEXT(GLenum mode, GLint first, GLsizei count, GLsizei primcount)
+{
+    GET_CTX_V2();
+    SET_ERROR_IF(!ctx->getCaps()->GL_ARB_INSTANCED_ARRAYS,GL_INVALID_OPERATION);
+    SET_ERROR_IF(count < 0 || primcount < 0,GL_INVALID_VALUE)
+    SET_ERROR_IF(!GLESv2Validate::drawMode(mode),GL_INVALID_ENUM);
+
+    ctx->drawValidate();
+
+    GLESConversionArrays tmpArrs;
+    ctx->setupArraysPointers(tmpArrs,first,count,0,NULL,true);
+
+    ctx->validateAtt0PreDraw(count);
+
+    //See glDrawArrays
+    if (mode==GL_POINTS) {
+        ctx->dispatcher().glEnable(GL_POINT_SPRITE);
+        ctx->dispatcher().glEnable(GL_VERTEX_PROGRAM_POINT_SIZE);
+    }
+
+    ctx->dispatcher().glDrawArraysInstanced(mode,first,count,primcount);
+
+    if (mode==GL_POINTS) {
+        ctx->dispatcher().glDisable(GL_VERTEX_PROGRAM_POINT_SIZE);
+        ctx->dispatcher().glDisable(GL_POINT_SPRITE);
+    }
+
+    ctx->validateAtt0PostDraw();
+}
+
+GL_APICALL void GL_APIENTRY glDrawElementsInstancedEXT(GLenum mode, GLsizei count, GLenum type, const void *elementsIndices, GLsizei primcount)
+{
+    GET_CTX_V2();
+    SET_ERROR_IF(!ctx->getCaps()->GL_ARB_INSTANCED_ARRAYS,GL_INVALID_OPERATION);
+    SET_ERROR_IF(count < 0 || primcount < 0,GL_INVALID_VALUE)
+    SET_ERROR_IF(!(GLESv2Validate::drawMode(mode) && GLESv2Validate::drawType(type)),GL_INVALID_ENUM);
+
+    ctx->drawValidate();
+
+    //See glDrawElements
+    const GLvoid* indices = elementsIndices;
+    if(ctx->isBindedBuffer(GL_ELEMENT_ARRAY_BUFFER)) {
+        const unsigned char* buf = static_cast<unsigned char *>(ctx->getBindedBuffer(GL_ELEMENT_ARRAY_BUFFER));
+        indices = buf + SafeUIntFromPointer(elementsIndices);
+    }
+
+    GLESConversionArrays tmpArrs;
+    ctx->setupArraysPointers(tmpArrs,0,count,type,indices,false);
+
+    unsigned int maxIndex = ctx->findMaxIndex(count, type, indices);
+    ctx->validateAtt0PreDraw(maxIndex);
+
+    if (mode==GL_POINTS) {
+        ctx->dispatcher().glEnable(GL_POINT_SPRITE);
+        ctx->dispatcher().glEnable(GL_VERTEX_PROGRAM_POINT_SIZE);
+    }
+
+    ctx->dispatcher().glDrawElementsInstanced(mode,count,type,indices,primcount);
+
+    if (mode==GL_POINTS) {
+        ctx->dispatcher().glDisable(GL_VERTEX_PROGRAM_POINT_SIZE);
+        ctx->dispatcher().glDisable(GL_POINT_SPRITE);
+    }
+
+    ctx->validateAtt0PostDraw();
+}
@@ -15,8 +15,69 @@
 */
 
 #include "ShaderParser.h"
+#include "emugl/common/mutex.h"
 #include <stdlib.h>
 #include <string.h>
+#include <list>
+#include <unordered_map>
+
+namespace {
+
+// Budget for keeping translated shader sources around, counting both the
+// original and the translated source.
+const size_t kTranslationCacheMaxSize = 4 * 1024 * 1024;
+
+// Applications compile the same shaders again on every launch and after
+// losing their context, all while the host keeps running. Recent
+// translations are kept with the source they came from, so the same
+// source only costs a lookup instead of another parse. As the
+// translation is deterministic the host driver gets the same source as
+// before too, which its own shader cache can serve.
+class TranslationCache {
+public:
+    TranslationCache() : m_size(0) {}
+
+    bool find(const std::string& src, std::string& translated) {
+        emugl::Mutex::AutoLock lock(m_lock);
+        auto it = m_index.find(src);
+        if (it == m_index.end()) return false;
+
+        // Move to the front to evict the least recently used first.
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        translated = it->second->second;
+        return true;
+    }
+
+    void insert(const std::string& src, const std::string& translated) {
+        const size_t size = src.size() + translated.size();
+        if (size > kTranslationCacheMaxSize) return;
+
+        emugl::Mutex::AutoLock lock(m_lock);
+        if (m_index.find(src) != m_index.end()) return;
+
+        m_entries.push_front(Entry(src, translated));
+        m_index[src] = m_entries.begin();
+        m_size += size;
+
+        while (m_size > kTranslationCacheMaxSize) {
+            const Entry& last = m_entries.back();
+            m_size -= last.first.size() + last.second.size();
+            m_index.erase(last.first);
+            m_entries.pop_back();
+        }
+    }
+
+private:
+    typedef std::pair<std::string, std::string> Entry;
+    emugl::Mutex m_lock;
+    std::list<Entry> m_entries;
+    std::unordered_map<std::string, std::list<Entry>::iterator> m_index;
+    size_t m_size;
+};
+
+TranslationCache s_translationCache;
+
+}  // namespace
 
 ShaderParser::ShaderParser():ObjectData(SHADER_DATA),
                              m_type(0),
@@ -51,6 +112,9 @@ void ShaderParser::setSrc(const Version& ver,GLsizei count,const GLchar* const*
 
     clearParsedSrc();
 
+    if (s_translationCache.find(m_src, m_parsedSrc))
+        return;
+
     // parseGLSLversion must be called first since #version should be the
     // first token in the shader source.
     parseGLSLversion();
@@ -73,6 +137,9 @@ void ShaderParser::setSrc(const Version& ver,GLsizei count,const GLchar* const*
 #endif
     parseLineNumbers();
     parseOriginalSrc();
+
+    // The parsers above blanked out parts of m_src.
+    s_translationCache.insert(m_originalSrc, m_parsedSrc);
 }
 const GLchar** ShaderParser::parsedLines() {
       m_parsedLines = (GLchar*)m_parsedSrc.c_str();
@@ -8,6 +8,7 @@ host_common_SRC_FILES :=     \
      GLESpointer.cpp         \
      GLESbuffer.cpp          \
      RangeManip.cpp          \
+     TextureCache.cpp        \
      TextureUtils.cpp        \
      PaletteTexture.cpp      \
      etc1.cpp                \
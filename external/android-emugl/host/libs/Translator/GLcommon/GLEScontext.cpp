@@ -26,6 +26,12 @@
 #include <strings.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
 //decleration
 static void convertFixedDirectLoop(const char* dataIn,unsigned int strideIn,void* dataOut,unsigned int nBytes,unsigned int strideOut,int attribSize);
 static void convertFixedIndirectLoop(const char* dataIn,unsigned int strideIn,void* dataOut,GLsizei count,GLenum indices_type,const GLvoid* indices,unsigned int strideOut,int attribSize);
@@ -293,8 +299,59 @@ const GLESpointer* GLEScontext::getPointer(GLenum arrType) {
     return NULL;
 }
 
+// Converts |count| tightly packed values at once. SSE2 and NEON are part
+// of the base instruction set of x86_64 and arm64 so there is nothing to
+// detect at runtime. Scaling by 1/65536 is exact just like dividing so the
+// results match X2F().
+static void convertFixedPacked(const GLfixed* in,GLfloat* out,unsigned int count) {
+    unsigned int i = 0;
+#if defined(__SSE2__)
+    const __m128 scale = _mm_set1_ps(1.0f / 65536.0f);
+    for(; i + 4 <= count; i += 4) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        _mm_storeu_ps(out + i,_mm_mul_ps(_mm_cvtepi32_ps(x),scale));
+    }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    const float32x4_t scale = vdupq_n_f32(1.0f / 65536.0f);
+    for(; i + 4 <= count; i += 4) {
+        vst1q_f32(out + i,vmulq_f32(vcvtq_f32_s32(vld1q_s32(in + i)),scale));
+    }
+#endif
+    for(; i < count; i++) {
+        out[i] = X2F(in[i]);
+    }
+}
+
+static void convertBytePacked(const GLbyte* in,GLshort* out,unsigned int count) {
+    unsigned int i = 0;
+#if defined(__SSE2__)
+    for(; i + 16 <= count; i += 16) {
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        // Interleaving the bytes with themselves and shifting back keeps
+        // their sign.
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                         _mm_srai_epi16(_mm_unpacklo_epi8(b,b),8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8),
+                         _mm_srai_epi16(_mm_unpackhi_epi8(b,b),8));
+    }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    for(; i + 8 <= count; i += 8) {
+        vst1q_s16(out + i,vmovl_s8(vld1_s8(in + i)));
+    }
+#endif
+    for(; i < count; i++) {
+        out[i] = B2S(in[i]);
+    }
+}
+
 static void convertFixedDirectLoop(const char* dataIn,unsigned int strideIn,void* dataOut,unsigned int nBytes,unsigned int strideOut,int attribSize) {
 
+    // Arrays without gaps between their elements are converted as a whole.
+    if(strideIn == strideOut) {
+        convertFixedPacked(reinterpret_cast<const GLfixed*>(dataIn),static_cast<GLfloat*>(dataOut),nBytes / sizeof(GLfloat));
+        return;
+    }
+
     for(unsigned int i = 0; i < nBytes;i+=strideOut) {
         const GLfixed* fixed_data = (const GLfixed *)dataIn;
         //filling attrib
@@ -320,6 +377,11 @@ static void convertFixedIndirectLoop(const char* dataIn,unsigned int strideIn,vo
 
 static void convertByteDirectLoop(const char* dataIn,unsigned int strideIn,void* dataOut,unsigned int nBytes,unsigned int strideOut,int attribSize) {
 
+    if(strideIn * sizeof(GLshort) == strideOut) {
+        convertBytePacked(reinterpret_cast<const GLbyte*>(dataIn),static_cast<GLshort*>(dataOut),nBytes / sizeof(GLshort));
+        return;
+    }
+
     for(unsigned int i = 0; i < nBytes;i+=strideOut) {
         const GLbyte* byte_data = (const GLbyte *)dataIn;
         //filling attrib
@@ -642,6 +704,13 @@ void GLEScontext::initCapsLocked(const GLubyte * extensionString)
     if (!(Version((const char*)glVersion) < Version("3.0")) || strstr(cstring,"GL_OES_rgb8_rgba8")!=NULL)
         s_glSupport.GL_OES_RGB8_RGBA8 = true;
 
+    // The instanced drawing functions are only looked up by the names they
+    // have in core GL 3.3.
+    if (!(Version((const char*)glVersion) < Version("3.3")) &&
+        s_glDispatch.glVertexAttribDivisor && s_glDispatch.glDrawArraysInstanced &&
+        s_glDispatch.glDrawElementsInstanced)
+        s_glSupport.GL_ARB_INSTANCED_ARRAYS = true;
+
 }
 
 void GLEScontext::buildStrings(const char* baseVendor,
@@ -0,0 +1,196 @@
+/*
+* Copyright (C) 2016 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <GLcommon/TextureCache.h>
+#include <GLcommon/GLEScontext.h>
+#include <GLcommon/TranslatorIfaces.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <tuple>
+
+namespace {
+
+// Mixes in 8 bytes at a time into two independent lanes so an accidental
+// collision of both is practically impossible.
+const uint64_t kPrime1 = 0x9e3779b185ebca87ULL;
+const uint64_t kPrime2 = 0xc2b2ae3d27d4eb4fULL;
+
+inline uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+inline void mix(uint64_t* hash, uint64_t word) {
+    hash[0] = rotl(hash[0] ^ (word * kPrime2), 31) * kPrime1;
+    hash[1] = rotl(hash[1] + (word ^ hash[0]), 27) * kPrime2 + kPrime1;
+}
+
+}  // namespace
+
+bool TextureCache::Key::operator<(const Key& other) const {
+    return std::tie(hash[0], hash[1], width, height, format, type,
+                    minFilter, magFilter, wrapS, wrapT) <
+           std::tie(other.hash[0], other.hash[1], other.width, other.height,
+                    other.format, other.type, other.minFilter,
+                    other.magFilter, other.wrapS, other.wrapT);
+}
+
+TextureCache* TextureCache::get() {
+    static TextureCache* s_cache =
+            ::getenv("ANBOX_GL_TEXTURE_CACHE") ? new TextureCache() : NULL;
+    return s_cache;
+}
+
+void TextureCache::hashPixels(Key* key, const void* pixels, size_t rowSize,
+                              size_t rowPitch, GLsizei rows) {
+    key->hash[0] = rowSize;
+    key->hash[1] = rows;
+    const uint8_t* row = static_cast<const uint8_t*>(pixels);
+    for (GLsizei y = 0; y < rows; y++, row += rowPitch) {
+        size_t x = 0;
+        for (; x + sizeof(uint64_t) <= rowSize; x += sizeof(uint64_t)) {
+            uint64_t word;
+            memcpy(&word, row + x, sizeof(word));
+            mix(key->hash, word);
+        }
+        if (x < rowSize) {
+            uint64_t word = 0;
+            memcpy(&word, row + x, rowSize - x);
+            mix(key->hash, word);
+        }
+    }
+}
+
+GLuint TextureCache::acquire(const Key& key) {
+    emugl::Mutex::AutoLock lock(m_lock);
+    Entries::iterator entry = m_entries.find(key);
+    if (entry == m_entries.end()) {
+        return 0;
+    }
+    entry->second.refs++;
+    return entry->second.texture;
+}
+
+bool TextureCache::add(const Key& key, GLuint texture) {
+    emugl::Mutex::AutoLock lock(m_lock);
+    Entry entry = { texture, 1 };
+    std::pair<Entries::iterator, bool> added =
+            m_entries.insert(std::make_pair(key, entry));
+    if (!added.second) {
+        return false;
+    }
+    m_textures[texture] = added.first;
+    return true;
+}
+
+bool TextureCache::detach(GLuint texture) {
+    emugl::Mutex::AutoLock lock(m_lock);
+    std::map<GLuint, Entries::iterator>::iterator it = m_textures.find(texture);
+    if (it == m_textures.end() || it->second->second.refs > 1) {
+        return false;
+    }
+    m_entries.erase(it->second);
+    m_textures.erase(it);
+    return true;
+}
+
+bool TextureCache::updateSampling(GLuint texture, GLenum pname, GLint param) {
+    emugl::Mutex::AutoLock lock(m_lock);
+    std::map<GLuint, Entries::iterator>::iterator it = m_textures.find(texture);
+    if (it == m_textures.end() || it->second->second.refs > 1) {
+        return false;
+    }
+
+    Key key = it->second->first;
+    switch (pname) {
+    case GL_TEXTURE_MIN_FILTER: key.minFilter = param; break;
+    case GL_TEXTURE_MAG_FILTER: key.magFilter = param; break;
+    case GL_TEXTURE_WRAP_S: key.wrapS = param; break;
+    case GL_TEXTURE_WRAP_T: key.wrapT = param; break;
+    default: return false;
+    }
+    if (m_entries.count(key)) {
+        return false;
+    }
+
+    const Entry entry = it->second->second;
+    m_entries.erase(it->second);
+    it->second = m_entries.insert(std::make_pair(key, entry)).first;
+    return true;
+}
+
+bool TextureCache::release(GLuint texture) {
+    emugl::Mutex::AutoLock lock(m_lock);
+    std::map<GLuint, Entries::iterator>::iterator it = m_textures.find(texture);
+    if (it == m_textures.end()) {
+        return false;
+    }
+    if (--it->second->second.refs > 0) {
+        return false;
+    }
+    m_entries.erase(it->second);
+    m_textures.erase(it);
+    return true;
+}
+
+void TextureCache::unshareTexture(GLEScontext* ctx, ObjectLocalName tex,
+                                  TextureData* texData, bool copy) {
+    if (!texData || !texData->cachedGlobal) {
+        return;
+    }
+
+    TextureCache* cache = get();
+    const GLuint shared = texData->cachedGlobal;
+    texData->cachedGlobal = 0;
+    if (cache->detach(shared)) {
+        return;
+    }
+
+    GLDispatch& dispatcher = ctx->dispatcher();
+    GLuint own = 0;
+    dispatcher.glGenTextures(1, &own);
+    dispatcher.glBindTexture(GL_TEXTURE_2D, own);
+    dispatcher.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, texData->minFilter);
+    dispatcher.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, texData->magFilter);
+    dispatcher.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, texData->wrapS);
+    dispatcher.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, texData->wrapT);
+
+    // Only formats which can be rendered to are cached, so the content can
+    // be copied without a roundtrip through our memory.
+    if (copy) {
+        GLint previousFramebuffer = 0;
+        dispatcher.glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+        GLuint framebuffer = 0;
+        dispatcher.glGenFramebuffersEXT(1, &framebuffer);
+        dispatcher.glBindFramebufferEXT(GL_FRAMEBUFFER, framebuffer);
+        dispatcher.glFramebufferTexture2DEXT(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                             GL_TEXTURE_2D, shared, 0);
+        dispatcher.glCopyTexImage2D(GL_TEXTURE_2D, 0, texData->internalFormat, 0, 0,
+                                    texData->width, texData->height, 0);
+        dispatcher.glBindFramebufferEXT(GL_FRAMEBUFFER, previousFramebuffer);
+        dispatcher.glDeleteFramebuffersEXT(1, &framebuffer);
+    }
+
+    ctx->shareGroup()->replaceGlobalName(TEXTURE, tex, own);
+    if (cache->release(shared)) {
+        dispatcher.glDeleteTextures(1, &shared);
+    }
+
+    // Whatever is bound might just have gotten a new global name.
+    const unsigned int bound = ctx->getBindedTexture(GL_TEXTURE_2D);
+    dispatcher.glBindTexture(GL_TEXTURE_2D, ctx->shareGroup()->getGlobalName(
+            TEXTURE, bound ? bound : ctx->getDefaultTextureName(GL_TEXTURE_2D)));
+}
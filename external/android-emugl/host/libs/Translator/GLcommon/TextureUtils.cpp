@@ -17,8 +17,238 @@
 #include <GLcommon/GLESmacros.h>
 #include <GLcommon/GLDispatch.h>
 #include <GLcommon/GLESvalidate.h>
+#include "emugl/common/mutex.h"
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
 #include <cmath>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Images decoding to at least this many bytes are split into bands of
+// block rows which are decoded by multiple threads.
+const size_t kParallelDecodeMinSize = 256 * 256 * 3;
+const long kMaxDecodeThreads = 4;
+
+// Budget for keeping decoded ETC images around. Only images which are
+// expensive enough to decode are kept.
+const size_t kEtc1CacheMinSize = 128 * 128 * 3;
+const size_t kEtc1CacheMaxSize = 64 * 1024 * 1024;
+
+bool etcHasAlpha(GLenum format) {
+    return format == GL_COMPRESSED_RGBA8_ETC2_EAC;
+}
+
+int decodeEtcBlocks(GLenum format, const etc1_byte* in, etc1_byte* out,
+                    etc1_uint32 width, etc1_uint32 height, etc1_uint32 stride) {
+    if (format == GL_ETC1_RGB8_OES)
+        return etc1_decode_image(in, out, width, height, 3, stride);
+    return etc2_decode_image(in, out, width, height, etcHasAlpha(format), stride);
+}
+
+struct Etc1Band {
+    GLenum format;
+    const etc1_byte* in;
+    etc1_byte* out;
+    etc1_uint32 width;
+    etc1_uint32 height;
+    etc1_uint32 stride;
+    int result;
+
+    void decode() {
+        result = decodeEtcBlocks(format, in, out, width, height, stride);
+    }
+};
+
+// Decodes bands on threads which are started with the first large image
+// and then kept around. Starting threads for every upload would cost
+// more than decoding in parallel saves.
+class Etc1DecodePool {
+public:
+    static Etc1DecodePool& instance() {
+        // Never destroyed, its workers wait for bands until the process
+        // exits.
+        static Etc1DecodePool* pool = new Etc1DecodePool();
+        return *pool;
+    }
+
+    // Threads decoding bands besides the calling one.
+    size_t workers() const { return m_workers.size(); }
+
+    // Decodes all |bands|, the calling thread takes its share as well.
+    void decode(std::vector<Etc1Band>& bands) {
+        Batch batch(bands);
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            for (size_t n = 1; n < bands.size() && n <= m_workers.size(); n++)
+                m_queue.push_back(&batch);
+        }
+        m_wake.notify_all();
+
+        batch.run();
+
+        // Workers which didn't get to the batch yet must not anymore.
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_queue.remove(&batch);
+        m_done.wait(lock, [&batch]() { return batch.active == 0; });
+    }
+
+private:
+    struct Batch {
+        explicit Batch(std::vector<Etc1Band>& bands) :
+                bands(bands), next(0), active(0) {}
+
+        void run() {
+            size_t n;
+            while ((n = next.fetch_add(1)) < bands.size()) bands[n].decode();
+        }
+
+        std::vector<Etc1Band>& bands;
+        std::atomic<size_t> next;
+        // Workers running the batch, guarded by m_lock.
+        size_t active;
+    };
+
+    Etc1DecodePool() {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        if (cpus > kMaxDecodeThreads) cpus = kMaxDecodeThreads;
+        for (long n = 1; n < cpus; n++) {
+            try {
+                m_workers.push_back(std::thread(&Etc1DecodePool::work, this));
+            } catch (const std::system_error&) {
+                break;
+            }
+        }
+    }
+
+    void work() {
+        std::unique_lock<std::mutex> lock(m_lock);
+        while (true) {
+            m_wake.wait(lock, [this]() { return !m_queue.empty(); });
+            Batch* batch = m_queue.front();
+            m_queue.pop_front();
+            batch->active++;
+
+            lock.unlock();
+            batch->run();
+            lock.lock();
+
+            if (--batch->active == 0) m_done.notify_all();
+        }
+    }
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_lock;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    std::list<Batch*> m_queue;
+};
+
+// Block rows of an ETC1 or ETC2 image are independent of each other, so
+// large images are cut into horizontal bands that are decoded concurrently.
+int decodeEtc1Image(GLenum format, const etc1_byte* in, etc1_byte* out,
+                    etc1_uint32 width, etc1_uint32 height, etc1_uint32 stride) {
+    const etc1_uint32 blockRows = (height + 3) / 4;
+    if (blockRows < 2 || (size_t)stride * height < kParallelDecodeMinSize) {
+        return decodeEtcBlocks(format, in, out, width, height, stride);
+    }
+
+    Etc1DecodePool& pool = Etc1DecodePool::instance();
+    etc1_uint32 numBands = pool.workers() + 1;
+    if (numBands < 2) {
+        return decodeEtcBlocks(format, in, out, width, height, stride);
+    }
+    if (numBands > blockRows) numBands = blockRows;
+
+    const etc1_uint32 rowsPerBand = (blockRows + numBands - 1) / numBands;
+    const size_t encodedRowSize = ((width + 3) / 4) * ETC1_ENCODED_BLOCK_SIZE *
+                                  (etcHasAlpha(format) ? 2 : 1);
+
+    std::vector<Etc1Band> bands;
+    for (etc1_uint32 row = 0; row < blockRows; row += rowsPerBand) {
+        const etc1_uint32 y = row * 4;
+        etc1_uint32 bandHeight = rowsPerBand * 4;
+        if (bandHeight > height - y) bandHeight = height - y;
+        Etc1Band band = { format, in + row * encodedRowSize, out + (size_t)y * stride,
+                          width, bandHeight, stride, 0 };
+        bands.push_back(band);
+    }
+
+    pool.decode(bands);
+
+    for (size_t n = 0; n < bands.size(); n++) {
+        if (bands[n].result != 0) return bands[n].result;
+    }
+    return 0;
+}
+
+struct Etc1Image {
+    GLenum format;
+    std::vector<etc1_byte> encoded;
+    std::vector<etc1_byte> decoded;
+    etc1_uint32 width;
+    etc1_uint32 height;
+    etc1_uint32 stride;
+};
+
+// Games tend to upload the same compressed atlases over and over again,
+// e.g. when switching between levels. Recently decoded images are kept
+// with the content they were decoded from, so uploading them again only
+// costs a comparison instead of another decode.
+class Etc1Cache {
+public:
+    Etc1Cache() : m_size(0) {}
+
+    std::shared_ptr<const Etc1Image> find(GLenum format,
+                                          const etc1_byte* encoded, size_t encodedSize,
+                                          etc1_uint32 width, etc1_uint32 height,
+                                          etc1_uint32 stride) {
+        emugl::Mutex::AutoLock lock(m_lock);
+        for (auto it = m_images.begin(); it != m_images.end(); ++it) {
+            const Etc1Image& image = **it;
+            if (image.format != format || image.width != width || image.height != height ||
+                image.stride != stride || image.encoded.size() != encodedSize ||
+                memcmp(image.encoded.data(), encoded, encodedSize) != 0)
+                continue;
+
+            // Move to the front to evict the least recently used first.
+            m_images.splice(m_images.begin(), m_images, it);
+            return m_images.front();
+        }
+        return std::shared_ptr<const Etc1Image>();
+    }
+
+    void insert(const std::shared_ptr<const Etc1Image>& image) {
+        const size_t size = image->encoded.size() + image->decoded.size();
+        if (size > kEtc1CacheMaxSize / 4) return;
+
+        emugl::Mutex::AutoLock lock(m_lock);
+        m_images.push_front(image);
+        m_size += size;
+        while (m_size > kEtc1CacheMaxSize) {
+            const Etc1Image& last = *m_images.back();
+            m_size -= last.encoded.size() + last.decoded.size();
+            m_images.pop_back();
+        }
+    }
+
+private:
+    emugl::Mutex m_lock;
+    std::list<std::shared_ptr<const Etc1Image> > m_images;
+    size_t m_size;
+};
+
+Etc1Cache s_etc1Cache;
+
+}  // namespace
 
 int getCompressedFormats(int* formats){
     if(formats){
@@ -35,6 +265,8 @@ int getCompressedFormats(int* formats){
         formats[9] = GL_PALETTE8_R5_G6_B5_OES;
         //ETC
         formats[MAX_SUPPORTED_PALETTE] = GL_ETC1_RGB8_OES;
+        formats[MAX_SUPPORTED_PALETTE + 1] = GL_COMPRESSED_RGB8_ETC2;
+        formats[MAX_SUPPORTED_PALETTE + 2] = GL_COMPRESSED_RGBA8_ETC2_EAC;
     }
     return MAX_SUPPORTED_PALETTE + MAX_ETC_SUPPORTED;
 }
@@ -52,22 +284,53 @@ void  doCompressedTexImage2D(GLEScontext * ctx, GLenum target, GLint level,
 
     switch (internalformat) {
         case GL_ETC1_RGB8_OES:
+        case GL_COMPRESSED_RGB8_ETC2:
+        case GL_COMPRESSED_RGBA8_ETC2_EAC:
             {
-                GLint format = GL_RGB;
+                // ETC2 is not available on every host GL, so it is decoded
+                // on the CPU just like ETC1.
+                const bool hasAlpha = etcHasAlpha(internalformat);
+                GLint format = hasAlpha ? GL_RGBA : GL_RGB;
                 GLint type = GL_UNSIGNED_BYTE;
+                const int32_t pixelSize = hasAlpha ? 4 : 3;
 
-                GLsizei compressedSize = etc1_get_encoded_data_size(width, height);
+                GLsizei compressedSize = internalformat == GL_ETC1_RGB8_OES ?
+                        etc1_get_encoded_data_size(width, height) :
+                        etc2_get_encoded_data_size(width, height, hasAlpha);
                 SET_ERROR_IF((compressedSize > imageSize), GL_INVALID_VALUE);
 
                 const int32_t align = ctx->getUnpackAlignment()-1;
-                const int32_t bpr = ((width * 3) + align) & ~align;
+                const int32_t bpr = ((width * pixelSize) + align) & ~align;
                 const size_t size = bpr * height;
 
-                etc1_byte* pOut = new etc1_byte[size];
-                int res = etc1_decode_image((const etc1_byte*)data, pOut, width, height, 3, bpr);
-                SET_ERROR_IF(res!=0, GL_INVALID_VALUE);
-                glTexImage2DPtr(target,level,format,width,height,border,format,type,pOut);
-                delete [] pOut;
+                const etc1_byte* pIn = (const etc1_byte*)data;
+                if (size < kEtc1CacheMinSize) {
+                    etc1_byte* pOut = new etc1_byte[size];
+                    int res = decodeEtc1Image(internalformat, pIn, pOut, width, height, bpr);
+                    if (res == 0)
+                        glTexImage2DPtr(target,level,format,width,height,border,format,type,pOut);
+                    delete [] pOut;
+                    SET_ERROR_IF(res!=0, GL_INVALID_VALUE);
+                    break;
+                }
+
+                std::shared_ptr<const Etc1Image> image =
+                        s_etc1Cache.find(internalformat, pIn, compressedSize, width, height, bpr);
+                if (!image) {
+                    std::shared_ptr<Etc1Image> decoded(new Etc1Image);
+                    decoded->format = internalformat;
+                    decoded->encoded.assign(pIn, pIn + compressedSize);
+                    decoded->decoded.resize(size);
+                    decoded->width = width;
+                    decoded->height = height;
+                    decoded->stride = bpr;
+                    int res = decodeEtc1Image(internalformat, pIn, decoded->decoded.data(),
+                                              width, height, bpr);
+                    SET_ERROR_IF(res!=0, GL_INVALID_VALUE);
+                    s_etc1Cache.insert(decoded);
+                    image = decoded;
+                }
+                glTexImage2DPtr(target,level,format,width,height,border,format,type,image->decoded.data());
             }
             break;
             
@@ -230,6 +230,168 @@ void etc1_decode_block(const etc1_byte* pIn, etc1_byte* pOut) {
     decode_subblock(pOut, r2, g2, b2, tableB, low, true, flipped);
 }
 
+// ETC2 adds three modes to ETC1 which are selected by differential blocks
+// whose second base color would overflow: T mode (red overflows), H mode
+// (green overflows) and planar mode (blue overflows). Blocks which don't
+// overflow are decoded exactly like ETC1 blocks.
+
+static const int kEtc2DistanceTable[8] = { 3, 6, 11, 16, 23, 32, 41, 64 };
+
+static const int kEacModifierTable[16][8] = {
+    { -3, -6,  -9, -15, 2, 5, 8, 14 },
+    { -3, -7, -10, -13, 2, 6, 9, 12 },
+    { -2, -5,  -8, -13, 1, 4, 7, 12 },
+    { -2, -4,  -6, -13, 1, 3, 5, 12 },
+    { -3, -6,  -8, -12, 2, 5, 7, 11 },
+    { -3, -7,  -9, -11, 2, 6, 8, 10 },
+    { -4, -7,  -8, -11, 3, 6, 7, 10 },
+    { -3, -5,  -8, -11, 2, 4, 7, 10 },
+    { -2, -6,  -8, -10, 1, 5, 7,  9 },
+    { -2, -5,  -8, -10, 1, 4, 7,  9 },
+    { -2, -4,  -8, -10, 1, 3, 7,  9 },
+    { -2, -5,  -7, -10, 1, 4, 6,  9 },
+    { -3, -4,  -7, -10, 2, 3, 6,  9 },
+    { -1, -2,  -3, -10, 0, 1, 2,  9 },
+    { -4, -6,  -8,  -9, 3, 5, 7,  8 },
+    { -3, -5,  -7,  -9, 2, 4, 6,  8 } };
+
+static
+inline int convert7To8(int b) {
+    int c = b & 0x7f;
+    return (c << 1) | (c >> 6);
+}
+
+static
+inline bool outOf5BitRange(int base, int diff) {
+    int c = (0x1f & base) + kLookup[0x7 & diff];
+    return c < 0 || c > 31;
+}
+
+// Writes one of four paint colors to each pixel of the block, as used by
+// the T and H modes.
+
+static
+void decode_paint_colors(etc1_byte* pOut, const int paint[4][3], etc1_uint32 low) {
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            int k = y + (x * 4);
+            int offset = ((low >> k) & 1) | ((low >> (k + 15)) & 2);
+            etc1_byte* q = pOut + 3 * (x + 4 * y);
+            *q++ = clamp(paint[offset][0]);
+            *q++ = clamp(paint[offset][1]);
+            *q++ = clamp(paint[offset][2]);
+        }
+    }
+}
+
+static
+void decode_t_mode(etc1_uint32 high, etc1_uint32 low, etc1_byte* pOut) {
+    int r1 = convert4To8((((high >> 27) & 3) << 2) | ((high >> 24) & 3));
+    int g1 = convert4To8(high >> 20);
+    int b1 = convert4To8(high >> 16);
+    int r2 = convert4To8(high >> 12);
+    int g2 = convert4To8(high >> 8);
+    int b2 = convert4To8(high >> 4);
+    int d = kEtc2DistanceTable[((high >> 1) & 6) | (high & 1)];
+    const int paint[4][3] = {
+        { r1, g1, b1 },
+        { r2 + d, g2 + d, b2 + d },
+        { r2, g2, b2 },
+        { r2 - d, g2 - d, b2 - d } };
+    decode_paint_colors(pOut, paint, low);
+}
+
+static
+void decode_h_mode(etc1_uint32 high, etc1_uint32 low, etc1_byte* pOut) {
+    int r1 = (high >> 27) & 0xf;
+    int g1 = (((high >> 24) & 7) << 1) | ((high >> 20) & 1);
+    int b1 = (((high >> 19) & 1) << 3) | ((high >> 15) & 7);
+    int r2 = (high >> 11) & 0xf;
+    int g2 = (high >> 7) & 0xf;
+    int b2 = (high >> 3) & 0xf;
+    // The lowest bit of the distance index is implied by the order of the
+    // two base colors.
+    int order = ((r1 << 8) | (g1 << 4) | b1) >= ((r2 << 8) | (g2 << 4) | b2);
+    int d = kEtc2DistanceTable[(high & 4) | ((high & 1) << 1) | order];
+    r1 = convert4To8(r1);
+    g1 = convert4To8(g1);
+    b1 = convert4To8(b1);
+    r2 = convert4To8(r2);
+    g2 = convert4To8(g2);
+    b2 = convert4To8(b2);
+    const int paint[4][3] = {
+        { r1 + d, g1 + d, b1 + d },
+        { r1 - d, g1 - d, b1 - d },
+        { r2 + d, g2 + d, b2 + d },
+        { r2 - d, g2 - d, b2 - d } };
+    decode_paint_colors(pOut, paint, low);
+}
+
+static
+void decode_planar_mode(etc1_uint32 high, etc1_uint32 low, etc1_byte* pOut) {
+    int ro = convert6To8(high >> 25);
+    int go = convert7To8((((high >> 24) & 1) << 6) | ((high >> 17) & 0x3f));
+    int bo = convert6To8((((high >> 16) & 1) << 5) | (((high >> 11) & 3) << 3) |
+            ((high >> 7) & 7));
+    int rh = convert6To8((((high >> 2) & 0x1f) << 1) | (high & 1));
+    int gh = convert7To8(low >> 25);
+    int bh = convert6To8(low >> 19);
+    int rv = convert6To8(low >> 13);
+    int gv = convert7To8(low >> 6);
+    int bv = convert6To8(low);
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            etc1_byte* q = pOut + 3 * (x + 4 * y);
+            *q++ = clamp((x * (rh - ro) + y * (rv - ro) + 4 * ro + 2) >> 2);
+            *q++ = clamp((x * (gh - go) + y * (gv - go) + 4 * go + 2) >> 2);
+            *q++ = clamp((x * (bh - bo) + y * (bv - bo) + 4 * bo + 2) >> 2);
+        }
+    }
+}
+
+// Input is an ETC2 RGB8 compressed version of the data.
+// Output is a 4 x 4 square of 3-byte pixels in form R, G, B
+
+void etc2_decode_block(const etc1_byte* pIn, etc1_byte* pOut) {
+    etc1_uint32 high = (pIn[0] << 24) | (pIn[1] << 16) | (pIn[2] << 8) | pIn[3];
+    etc1_uint32 low = (pIn[4] << 24) | (pIn[5] << 16) | (pIn[6] << 8) | pIn[7];
+    if (high & 2) {
+        if (outOf5BitRange(high >> 27, high >> 24)) {
+            decode_t_mode(high, low, pOut);
+            return;
+        }
+        if (outOf5BitRange(high >> 19, high >> 16)) {
+            decode_h_mode(high, low, pOut);
+            return;
+        }
+        if (outOf5BitRange(high >> 11, high >> 8)) {
+            decode_planar_mode(high, low, pOut);
+            return;
+        }
+    }
+    etc1_decode_block(pIn, pOut);
+}
+
+// Input is an EAC compressed alpha channel.
+// Output is a 4 x 4 square of alpha values, byte (x + 4 * y) is the alpha
+// value of pixel (x, y).
+
+void etc2_decode_alpha_block(const etc1_byte* pIn, etc1_byte* pOut) {
+    int base = pIn[0];
+    int multiplier = pIn[1] >> 4;
+    const int* table = kEacModifierTable[pIn[1] & 0xf];
+    unsigned long long indices = 0;
+    for (int i = 2; i < 8; i++) {
+        indices = (indices << 8) | pIn[i];
+    }
+    for (int i = 0; i < 16; i++) {
+        int x = i >> 2;
+        int y = i & 3;
+        int offset = (int) ((indices >> (45 - 3 * i)) & 7);
+        pOut[x + 4 * y] = clamp(base + table[offset] * multiplier);
+    }
+}
+
 typedef struct {
     etc1_uint32 high;
     etc1_uint32 low;
@@ -609,6 +771,64 @@ int etc1_decode_image(const etc1_byte* pIn, etc1_byte* pOut,
     return 0;
 }
 
+etc1_uint32 etc2_get_encoded_data_size(etc1_uint32 width, etc1_uint32 height,
+        etc1_bool hasAlpha) {
+    etc1_uint32 size = etc1_get_encoded_data_size(width, height);
+    return hasAlpha ? size * 2 : size;
+}
+
+// Decode an entire ETC2 RGB8 or RGBA8 EAC image.
+// pIn - pointer to encoded data.
+// pOut - pointer to the image data. Pixels are written as R, G, B when
+//        hasAlpha is false and as R, G, B, A otherwise, pixel (x,y) is at
+//        pOut + pixelSize * x + stride * y.
+
+int etc2_decode_image(const etc1_byte* pIn, etc1_byte* pOut,
+        etc1_uint32 width, etc1_uint32 height,
+        etc1_bool hasAlpha, etc1_uint32 stride) {
+    etc1_byte block[ETC1_DECODED_BLOCK_SIZE];
+    etc1_byte alpha[16];
+    const etc1_uint32 pixelSize = hasAlpha ? 4 : 3;
+
+    etc1_uint32 encodedWidth = (width + 3) & ~3;
+    etc1_uint32 encodedHeight = (height + 3) & ~3;
+
+    for (etc1_uint32 y = 0; y < encodedHeight; y += 4) {
+        etc1_uint32 yEnd = height - y;
+        if (yEnd > 4) {
+            yEnd = 4;
+        }
+        for (etc1_uint32 x = 0; x < encodedWidth; x += 4) {
+            etc1_uint32 xEnd = width - x;
+            if (xEnd > 4) {
+                xEnd = 4;
+            }
+            if (hasAlpha) {
+                etc2_decode_alpha_block(pIn, alpha);
+                pIn += ETC1_ENCODED_BLOCK_SIZE;
+            }
+            etc2_decode_block(pIn, block);
+            pIn += ETC1_ENCODED_BLOCK_SIZE;
+            for (etc1_uint32 cy = 0; cy < yEnd; cy++) {
+                const etc1_byte* q = block + (cy * 4) * 3;
+                etc1_byte* p = pOut + pixelSize * x + stride * (y + cy);
+                if (!hasAlpha) {
+                    memcpy(p, q, xEnd * 3);
+                } else {
+                    const etc1_byte* a = alpha + cy * 4;
+                    for (etc1_uint32 cx = 0; cx < xEnd; cx++) {
+                        *p++ = *q++;
+                        *p++ = *q++;
+                        *p++ = *q++;
+                        *p++ = *a++;
+                    }
+                }
+            }
+        }
+    }
+    return 0;
+}
+
 static const char kMagic[] = { 'P', 'K', 'M', ' ', '1', '0' };
 
 static const etc1_uint32 ETC1_PKM_FORMAT_OFFSET = 6;
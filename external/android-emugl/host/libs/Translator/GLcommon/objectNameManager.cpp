@@ -26,11 +26,11 @@ NameSpace::NameSpace(NamedObjectType p_type,
 
 NameSpace::~NameSpace()
 {
-    for (NamesMap::iterator n = m_localToGlobalMap.begin();
-         n != m_localToGlobalMap.end();
-         n++) {
-        m_globalNameSpace->deleteName(m_type, (*n).second);
-    }
+    m_localToGlobalMap.forEach(
+            [this](ObjectLocalName, unsigned int globalName) {
+                m_globalNameSpace->deleteName(m_type, globalName);
+                return false;
+            });
 }
 
 ObjectLocalName
@@ -42,13 +42,12 @@ NameSpace::genName(ObjectLocalName p_localName,
         do {
             localName = ++m_nextName;
         } while(localName == 0 ||
-                m_localToGlobalMap.find(localName) !=
-                        m_localToGlobalMap.end() );
+                m_localToGlobalMap.find(localName) != NULL);
     }
 
     if (genGlobal) {
         unsigned int globalName = m_globalNameSpace->genName(m_type);
-        m_localToGlobalMap[localName] = globalName;
+        m_localToGlobalMap.insert(localName, globalName) = globalName;
     }
 
     return localName;
@@ -64,10 +63,10 @@ NameSpace::genGlobalName(void)
 unsigned int
 NameSpace::getGlobalName(ObjectLocalName p_localName)
 {
-    NamesMap::iterator n( m_localToGlobalMap.find(p_localName) );
-    if (n != m_localToGlobalMap.end()) {
+    unsigned int *globalName = m_localToGlobalMap.find(p_localName);
+    if (globalName) {
         // object found - return its global name map
-        return (*n).second;
+        return *globalName;
     }
 
     // object does not exist;
@@ -77,23 +76,24 @@ NameSpace::getGlobalName(ObjectLocalName p_localName)
 ObjectLocalName
 NameSpace::getLocalName(unsigned int p_globalName)
 {
-    for(NamesMap::iterator it = m_localToGlobalMap.begin(); it != m_localToGlobalMap.end();it++){
-        if((*it).second == p_globalName){
-            // object found - return its local name
-            return (*it).first;
-        }
-    }
+    ObjectLocalName localName = 0;
+    m_localToGlobalMap.forEach(
+            [&](ObjectLocalName name, unsigned int globalName) {
+                if (globalName != p_globalName) return false;
+                // object found - return its local name
+                localName = name;
+                return true;
+            });
 
-    // object does not exist;
-    return 0;
+    return localName;
 }
 
 void
 NameSpace::deleteName(ObjectLocalName p_localName)
 {
-    NamesMap::iterator n( m_localToGlobalMap.find(p_localName) );
-    if (n != m_localToGlobalMap.end()) {
-        m_globalNameSpace->deleteName(m_type, (*n).second);
+    unsigned int *globalName = m_localToGlobalMap.find(p_localName);
+    if (globalName) {
+        m_globalNameSpace->deleteName(m_type, *globalName);
         m_localToGlobalMap.erase(p_localName);
     }
 }
@@ -101,16 +101,16 @@ NameSpace::deleteName(ObjectLocalName p_localName)
 bool
 NameSpace::isObject(ObjectLocalName p_localName)
 {
-    return (m_localToGlobalMap.find(p_localName) != m_localToGlobalMap.end() );
+    return m_localToGlobalMap.find(p_localName) != NULL;
 }
 
 void
 NameSpace::replaceGlobalName(ObjectLocalName p_localName, unsigned int p_globalName)
 {
-    NamesMap::iterator n( m_localToGlobalMap.find(p_localName) );
-    if (n != m_localToGlobalMap.end()) {
-        m_globalNameSpace->deleteName(m_type, (*n).second);
-        (*n).second = p_globalName;
+    unsigned int *globalName = m_localToGlobalMap.find(p_localName);
+    if (globalName) {
+        m_globalNameSpace->deleteName(m_type, *globalName);
+        *globalName = p_globalName;
     }
 }
 
@@ -151,15 +151,10 @@ GlobalNameSpace::deleteName(NamedObjectType p_type, unsigned int p_name)
 {
 }
 
-typedef std::pair<NamedObjectType, ObjectLocalName> ObjectIDPair;
-typedef std::map<ObjectIDPair, ObjectDataPtr> ObjectDataMap;
-
 ShareGroup::ShareGroup(GlobalNameSpace *globalNameSpace) : m_lock() {
     for (int i=0; i < NUM_OBJECT_TYPES; i++) {
         m_nameSpace[i] = new NameSpace((NamedObjectType)i, globalNameSpace);
     }
-
-    m_objectsData = NULL;
 }
 
 ShareGroup::~ShareGroup()
@@ -168,8 +163,6 @@ ShareGroup::~ShareGroup()
     for (int t = 0; t < NUM_OBJECT_TYPES; t++) {
         delete m_nameSpace[t];
     }
-
-    delete (ObjectDataMap *)m_objectsData;
 }
 
 ObjectLocalName
@@ -221,10 +214,7 @@ ShareGroup::deleteName(NamedObjectType p_type, ObjectLocalName p_localName)
 
     emugl::Mutex::AutoLock _lock(m_lock);
     m_nameSpace[p_type]->deleteName(p_localName);
-    ObjectDataMap *map = (ObjectDataMap *)m_objectsData;
-    if (map) {
-        map->erase( ObjectIDPair(p_type, p_localName) );
-    }
+    m_objectsData[p_type].erase(p_localName);
 }
 
 bool
@@ -255,15 +245,7 @@ ShareGroup::setObjectData(NamedObjectType p_type,
     if (p_type >= NUM_OBJECT_TYPES) return;
 
     emugl::Mutex::AutoLock _lock(m_lock);
-
-    ObjectDataMap *map = (ObjectDataMap *)m_objectsData;
-    if (!map) {
-        map = new ObjectDataMap();
-        m_objectsData = map;
-    }
-
-    ObjectIDPair id( p_type, p_localName );
-    map->insert( std::pair<ObjectIDPair, ObjectDataPtr>(id, data) );
+    m_objectsData[p_type].insert(p_localName, data);
 }
 
 ObjectDataPtr
@@ -276,12 +258,8 @@ ShareGroup::getObjectData(NamedObjectType p_type,
 
     emugl::Mutex::AutoLock _lock(m_lock);
 
-    ObjectDataMap *map = (ObjectDataMap *)m_objectsData;
-    if (map) {
-        ObjectDataMap::iterator i =
-                map->find( ObjectIDPair(p_type, p_localName) );
-        if (i != map->end()) ret = (*i).second;
-    }
+    ObjectDataPtr *data = m_objectsData[p_type].find(p_localName);
+    if (data) ret = *data;
     return ret;
 }
 
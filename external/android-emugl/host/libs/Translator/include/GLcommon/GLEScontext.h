@@ -61,7 +61,8 @@ struct GLSupport {
                 GL_ARB_HALF_FLOAT_PIXEL(false), GL_NV_HALF_FLOAT(false), \
                 GL_ARB_HALF_FLOAT_VERTEX(false),GL_SGIS_GENERATE_MIPMAP(false),
                 GL_ARB_ES2_COMPATIBILITY(false),GL_OES_STANDARD_DERIVATIVES(false),
-                GL_OES_TEXTURE_NPOT(false), GL_OES_RGB8_RGBA8(false) {} ;
+                GL_OES_TEXTURE_NPOT(false), GL_OES_RGB8_RGBA8(false),
+                GL_ARB_INSTANCED_ARRAYS(false) {} ;
     int  maxLights;
     int  maxVertexAttribs;
     int  maxClipPlane;
@@ -84,6 +85,7 @@ struct GLSupport {
     bool GL_OES_STANDARD_DERIVATIVES;
     bool GL_OES_TEXTURE_NPOT;
     bool GL_OES_RGB8_RGBA8;
+    bool GL_ARB_INSTANCED_ARRAYS;
 
 };
 
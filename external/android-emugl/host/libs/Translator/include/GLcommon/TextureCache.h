@@ -0,0 +1,101 @@
+/*
+* Copyright (C) 2016 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _TEXTURE_CACHE_H
+#define _TEXTURE_CACHE_H
+
+#include <GLES/gl.h>
+
+#include "emugl/common/mutex.h"
+#include "GLcommon/objectNameManager.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+
+class GLEScontext;
+class TextureData;
+
+// Lets textures of all contexts with identical content share one host
+// texture. Many guest processes upload the same bitmaps, like the assets
+// of the system UI or launcher icons.
+//
+// A texture only shares what it got through a complete upload of its
+// first level together with its sampling state. Anything about to change
+// either of them has to call unshareTexture() first, which gives the
+// texture a copy of its own unless nothing else shares it.
+//
+// The cache is only used with ANBOX_GL_TEXTURE_CACHE set.
+class TextureCache {
+public:
+    struct Key {
+        uint64_t hash[2];
+        GLsizei width;
+        GLsizei height;
+        GLenum format;
+        GLenum type;
+        GLint minFilter;
+        GLint magFilter;
+        GLint wrapS;
+        GLint wrapT;
+
+        bool operator<(const Key& other) const;
+    };
+
+    // Returns NULL if the cache is disabled.
+    static TextureCache* get();
+
+    // Hashes |rows| rows of |rowSize| bytes which are |rowPitch| bytes
+    // apart into |key|.
+    static void hashPixels(Key* key, const void* pixels, size_t rowSize,
+                           size_t rowPitch, GLsizei rows);
+
+    // Takes a reference on the texture cached under |key| and returns its
+    // global name, 0 if there is none.
+    GLuint acquire(const Key& key);
+    // Caches the global texture |texture| under |key| with a single
+    // reference. Returns false if |key| is cached already.
+    bool add(const Key& key, GLuint texture);
+    // Removes |texture| from the cache if the caller holds its only
+    // reference, the caller owns it on its own then.
+    bool detach(GLuint texture);
+    // Moves |texture| to the key with its sampling parameter |pname| set to
+    // |param| if the caller holds its only reference. Returns false if the
+    // texture is used elsewhere or the new key is cached already.
+    bool updateSampling(GLuint texture, GLenum pname, GLint param);
+    // Drops a reference on |texture| and returns true if it was the last
+    // one, the caller has to delete the texture then.
+    bool release(GLuint texture);
+
+    // Gives the texture |tex| of the share group of |ctx| a host texture of
+    // its own again if it shares one. With |copy| set the content of the
+    // first level is copied over.
+    static void unshareTexture(GLEScontext* ctx, ObjectLocalName tex,
+                               TextureData* texData, bool copy);
+
+private:
+    struct Entry {
+        GLuint texture;
+        unsigned int refs;
+    };
+    typedef std::map<Key, Entry> Entries;
+
+    emugl::Mutex m_lock;
+    Entries m_entries;
+    std::map<GLuint, Entries::iterator> m_textures;
+};
+
+#endif
@@ -17,6 +17,7 @@
 #define TRANSLATOR_IFACES_H
 
 #include "GLcommon/objectNameManager.h"
+#include "GLcommon/TextureCache.h"
 
 #include <GLES/gl.h>
 #include <string.h>
@@ -38,6 +39,9 @@ class TextureData : public ObjectData
 public:
     ~TextureData() {
         if (sourceEGLImage && eglImageDetach) (*eglImageDetach)(sourceEGLImage);
+        // Like all other textures of a share group going away the texture
+        // itself is left alone.
+        if (cachedGlobal) TextureCache::get()->release(cachedGlobal);
     }
     TextureData():  ObjectData(TEXTURE_DATA),
                     width(0),
@@ -48,7 +52,12 @@ public:
                     wasBound(false),
                     requiresAutoMipmap(false),
                     target(0),
-                    oldGlobal(0) {
+                    oldGlobal(0),
+                    cachedGlobal(0),
+                    minFilter(GL_NEAREST_MIPMAP_LINEAR),
+                    magFilter(GL_LINEAR),
+                    wrapS(GL_REPEAT),
+                    wrapT(GL_REPEAT) {
         memset(crop_rect,0,4*sizeof(int));
     };
 
@@ -63,6 +72,14 @@ public:
     void (*eglImageDetach)(unsigned int imageId);
     GLenum target;
     GLuint oldGlobal;
+    // Global name of the texture shared through the TextureCache, 0 if the
+    // texture has one of its own.
+    GLuint cachedGlobal;
+    // Sampling state of the texture, shared along with its content.
+    GLint minFilter;
+    GLint magFilter;
+    GLint wrapS;
+    GLint wrapT;
 };
 
 struct EglImage
@@ -90,6 +107,9 @@ typedef struct {
     void                                            (*finish)();
     void                                            (*setShareGroup)(GLEScontext*,ShareGroupPtr);
     __translatorMustCastToProperFunctionPointerType (*getProcAddress)(const char*);
+    // Gives texture |tex| of the current context storage of its own if it
+    // shares it through the TextureCache. May be NULL.
+    void                                            (*unshareTexture)(unsigned int tex);
 }GLESiface;
 
 class GlLibrary;
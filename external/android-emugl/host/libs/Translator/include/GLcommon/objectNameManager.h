@@ -17,6 +17,8 @@
 #define _OBJECT_NAME_MANAGER_H
 
 #include <map>
+#include <unordered_map>
+#include <vector>
 #include "emugl/common/mutex.h"
 #include "emugl/common/smart_ptr.h"
 
@@ -49,7 +51,86 @@ private:
 };
 typedef emugl::SmartPtr<ObjectData> ObjectDataPtr;
 typedef unsigned long long ObjectLocalName;
-typedef std::map<ObjectLocalName, unsigned int> NamesMap;
+
+//
+// NameTable - maps object names to values. Names are usually handed out
+//             sequentially starting at 1, so all but unusually large ones
+//             are kept in an array indexed by the name itself. Names which
+//             don't fit go to a hash table.
+//
+template <typename T>
+class NameTable
+{
+public:
+    NameTable() : m_denseCount(0) {}
+
+    // find - returns a pointer to the value of p_name or NULL.
+    T* find(ObjectLocalName p_name) {
+        if (p_name < kMaxDenseName) {
+            if (p_name >= m_dense.size() || !m_dense[p_name].used) return NULL;
+            return &m_dense[p_name].value;
+        }
+        typename SparseMap::iterator it = m_sparse.find(p_name);
+        return it != m_sparse.end() ? &it->second : NULL;
+    }
+
+    // insert - adds p_name unless it exists already, returns its value.
+    T& insert(ObjectLocalName p_name, const T& p_value) {
+        if (p_name < kMaxDenseName) {
+            if (p_name >= m_dense.size()) m_dense.resize(p_name + 1);
+            Slot& slot = m_dense[p_name];
+            if (!slot.used) {
+                slot.used = true;
+                slot.value = p_value;
+                m_denseCount++;
+            }
+            return slot.value;
+        }
+        return m_sparse.insert(std::make_pair(p_name, p_value)).first->second;
+    }
+
+    void erase(ObjectLocalName p_name) {
+        if (p_name < kMaxDenseName) {
+            if (p_name < m_dense.size() && m_dense[p_name].used) {
+                m_dense[p_name] = Slot();
+                m_denseCount--;
+            }
+            return;
+        }
+        m_sparse.erase(p_name);
+    }
+
+    // forEach - calls p_func(name, value) for all entries, stops as soon
+    //           as it returns true. Returns whether it was stopped.
+    template <typename F>
+    bool forEach(F p_func) {
+        for (size_t n = 0; m_denseCount > 0 && n < m_dense.size(); n++) {
+            if (m_dense[n].used && p_func(ObjectLocalName(n), m_dense[n].value))
+                return true;
+        }
+        for (typename SparseMap::iterator it = m_sparse.begin();
+             it != m_sparse.end(); ++it) {
+            if (p_func(it->first, it->second)) return true;
+        }
+        return false;
+    }
+
+private:
+    static const ObjectLocalName kMaxDenseName = 1 << 16;
+
+    struct Slot {
+        Slot() : used(false), value() {}
+        bool used;
+        T value;
+    };
+    typedef std::unordered_map<ObjectLocalName, T> SparseMap;
+
+    std::vector<Slot> m_dense;
+    size_t m_denseCount;
+    SparseMap m_sparse;
+};
+
+typedef NameTable<unsigned int> NamesMap;
 
 //
 // Class NameSpace - this class manages allocations and deletions of objects
@@ -206,7 +287,7 @@ private:
 private:
     emugl::Mutex m_lock;
     NameSpace *m_nameSpace[NUM_OBJECT_TYPES];
-    void *m_objectsData;
+    NameTable<ObjectDataPtr> m_objectsData[NUM_OBJECT_TYPES];
 };
 
 typedef emugl::SmartPtr<ShareGroup> ShareGroupPtr;
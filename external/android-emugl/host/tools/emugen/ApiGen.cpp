@@ -25,6 +25,8 @@
  * that instructs the encoder to send large data buffers by a direct
  * write through the pipe (i.e. without copying it into a temporary
  * buffer. This has definite performance benefits when using a QEMU Pipe.
+ * Payloads below IOStream::kDirectWriteThreshold are still copied so
+ * that they don't force a flush of the command buffer.
  *
  * Set to 0 otherwise.
  */
@@ -425,7 +427,7 @@ static void writeVarLargeEncodingExpression(Var& var, FILE* fp)
 {
     const char* varname = var.name().c_str();
 
-    fprintf(fp, "\tstream->writeFully(&__size_%s,4);\n", varname);
+    fprintf(fp, "\tstream->writeLarge(&__size_%s,4);\n", varname);
     fprintf(fp, "\tif (useChecksum) checksumCalculator->addBuffer(&__size_%s,4);\n", varname);
     if (var.nullAllowed()) {
         fprintf(fp, "\tif (%s != NULL) {\n", varname);
@@ -433,7 +435,7 @@ static void writeVarLargeEncodingExpression(Var& var, FILE* fp)
     if (var.writeExpression() != "") {
         fprintf(fp, "%s", var.writeExpression().c_str());
     } else {
-        fprintf(fp, "\t\tstream->writeFully(%s, __size_%s);\n", varname, varname);
+        fprintf(fp, "\t\tstream->writeLarge(%s, __size_%s);\n", varname, varname);
         fprintf(fp, "\t\tif (useChecksum) checksumCalculator->addBuffer(%s, __size_%s);\n", varname, varname);
     }
     if (var.nullAllowed()) fprintf(fp, "\t}\n");
@@ -612,10 +614,8 @@ int ApiGen::genEncoderImpl(const std::string &filename)
                 }
 
                 fprintf(fp, "\n\tif (useChecksum) checksumCalculator->addBuffer(buf, ptr-buf);\n");
-                // Ensure the fragment is commited if it is followed by a large variable
-                if (j < maxvars) {
-                    fprintf(fp, "\tstream->flush();\n");
-                }
+                // No need to commit the fragment before a large variable,
+                // IOStream::writeLarge() takes care of the ordering.
             }
 
             // If we have one or more large variables, write them directly.
@@ -763,6 +763,18 @@ int ApiGen::genDecoderHeader(const std::string &filename)
     fprintf(fp, "struct %s : public %s_%s_context_t {\n\n",
             classname.c_str(), m_basename.c_str(), sideString(SERVER_SIDE));
     fprintf(fp, "\tsize_t decode(void *buf, size_t bufsize, IOStream *stream);\n");
+    fprintf(fp, "\n\t// Opcodes handled by decode() are in [firstOpcode, endOpcode).\n");
+    fprintf(fp, "\t// Callers can use this to pick the decoder for a command directly.\n");
+    fprintf(fp, "\tstatic const unsigned int firstOpcode = %u;\n",
+            (unsigned int)m_baseOpcode);
+    fprintf(fp, "\tstatic const unsigned int endOpcode = %u;\n",
+            (unsigned int)(m_baseOpcode + size()));
+    fprintf(fp, "\tstatic bool handlesOpcode(unsigned int opcode) {\n");
+    fprintf(fp, "\t\treturn opcode >= firstOpcode && opcode < endOpcode;\n");
+    fprintf(fp, "\t}\n");
+    fprintf(fp, "\n\t// Name of the entry point behind |opcode| or NULL if it is not handled\n");
+    fprintf(fp, "\t// by this decoder. Used to label profiling and trace output.\n");
+    fprintf(fp, "\tstatic const char *opcodeName(unsigned int opcode);\n");
     fprintf(fp, "\n};\n\n");
     fprintf(fp, "#endif  // GUARD_%s\n", classname.c_str());
 
@@ -823,7 +835,14 @@ int ApiGen::genDecoderImpl(const std::string &filename)
     fprintf(fp, "typedef unsigned int tsize_t; // Target \"size_t\", which is 32-bit for now. It may or may not be the same as host's size_t when emugen is compiled.\n\n");
 
     // helper macros
-    fprintf(fp, "#  define DEBUG(...) do { if (emugl_cxt_logger) { emugl_cxt_logger(LogLevel::TRACE, __VA_ARGS__); } } while(0)\n\n");
+    // Tracing every call costs a call into the logger per command even
+    // when the trace level is off, only trace builds have it.
+    fprintf(fp,
+            "#ifdef OPENGL_DEBUG_PRINTOUT\n"
+            "#  define DEBUG(...) do { if (emugl_cxt_logger) { emugl_cxt_logger(LogLevel::TRACE, __VA_ARGS__); } } while(0)\n"
+            "#else\n"
+            "#  define DEBUG(...)  ((void)0)\n"
+            "#endif\n\n");
 
     fprintf(fp,
             "#ifdef CHECK_GLERROR\n"
@@ -1171,7 +1190,9 @@ int ApiGen::genDecoderImpl(const std::string &filename)
     fprintf(fp, "\t\t} //switch\n");
     if (strstr(m_basename.c_str(), "gl")) {
         fprintf(fp, "#ifdef CHECK_GL_ERROR\n");
-        fprintf(fp, "\tint err = lastCall[0] ? this->glGetError() : GL_NO_ERROR;\n");
+        EntryPoint *getError = findEntryByName("glGetError");
+        fprintf(fp, "\tint err = lastCall[0] ? this->glGetError(%s) : GL_NO_ERROR;\n",
+                getError && getError->customDecoder() ? "this" : "");
         fprintf(fp, "\tif (err) fprintf(stderr, \"%s Error: 0x%%X in %%s\\n\", err, lastCall);\n", m_basename.c_str());
         fprintf(fp, "#endif\n");
     }
@@ -1184,6 +1205,15 @@ int ApiGen::genDecoderImpl(const std::string &filename)
     fprintf(fp, "\treturn pos;\n");
     fprintf(fp, "}\n");
 
+    fprintf(fp, "\nconst char *%s::opcodeName(unsigned int opcode)\n{\n", classname.c_str());
+    fprintf(fp, "\tstatic const char *const names[] = {\n");
+    for (size_t i = 0; i < n; i++) {
+        fprintf(fp, "\t\t\"%s\",\n", at(i).name().c_str());
+    }
+    fprintf(fp, "\t};\n");
+    fprintf(fp, "\treturn handlesOpcode(opcode) ? names[opcode - firstOpcode] : NULL;\n");
+    fprintf(fp, "}\n");
+
     fclose(fp);
     return 0;
 }
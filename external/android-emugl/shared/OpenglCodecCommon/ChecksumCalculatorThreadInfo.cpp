@@ -17,8 +17,6 @@
 #include "ChecksumCalculatorThreadInfo.h"
 
 #include "emugl/common/crash_reporter.h"
-#include "emugl/common/lazy_instance.h"
-#include "emugl/common/thread_store.h"
 
 #include <stdio.h>
 #include <atomic>
@@ -26,36 +24,33 @@
 
 namespace {
 
-class ChecksumCalculatorThreadStore : public ::emugl::ThreadStore {
-public:
-    ChecksumCalculatorThreadStore() : ::emugl::ThreadStore(NULL) {}
-};
-
 #ifdef TRACE_CHECKSUMHELPER
 std::atomic<size_t> sNumInstances(0);
 #endif  // TRACE_CHECKSUMHELPER
 
-}
+// The decoders query the protocol for every single command they decode, so
+// this is a plain thread local pointer rather than an emugl::ThreadStore
+// which costs a pthread_getspecific() call per lookup.
+thread_local ChecksumCalculatorThreadInfo* s_current = NULL;
 
-static ::emugl::LazyInstance<ChecksumCalculatorThreadStore> s_tls =
-        LAZY_INSTANCE_INIT;
+}
 
 static ChecksumCalculatorThreadInfo* getChecksumCalculatorThreadInfo() {
-    return static_cast<ChecksumCalculatorThreadInfo*>(s_tls->get());
+    return s_current;
 }
 
 ChecksumCalculatorThreadInfo::ChecksumCalculatorThreadInfo() {
     LOG_CHECKSUMHELPER(
         "%s: Checksum thread created (%u instances)\n", __FUNCTION__,
         (size_t)sNumInstances);
-    s_tls->set(this);
+    s_current = this;
 }
 
 ChecksumCalculatorThreadInfo::~ChecksumCalculatorThreadInfo() {
     LOG_CHECKSUMHELPER(
         "%s: GLprotocol destroyed (%u instances)\n", __FUNCTION__,
         (size_t)sNumInstances);
-    s_tls->set(NULL);
+    s_current = NULL;
 }
 
 uint32_t ChecksumCalculatorThreadInfo::getVersion() {
@@ -0,0 +1,110 @@
+/*
+* Copyright (C) 2016 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "SharedBufferMemory.h"
+
+#include "emugl/common/mutex.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <map>
+
+namespace {
+
+struct Entry {
+    std::shared_ptr<SharedBufferMemory> memory;
+    pid_t owner;
+};
+
+emugl::Mutex s_lock;
+std::map<uint32_t, Entry> s_memories;
+uint32_t s_nextHandle = 1;
+
+}  // namespace
+
+SharedBufferMemory::SharedBufferMemory(uint8_t* data, size_t size) :
+        m_data(data), m_size(size) {}
+
+SharedBufferMemory::~SharedBufferMemory() {
+    ::munmap(m_data, sizeof(Header) + m_size);
+}
+
+std::shared_ptr<SharedBufferMemory> SharedBufferMemory::map(int fd, size_t size) {
+    if (fd < 0 || size == 0) {
+        return nullptr;
+    }
+
+    // Touching pages of a regular file beyond its end raises SIGBUS, see
+    // Renderer::attachColorBufferMemory().
+    const size_t total = sizeof(Header) + size;
+    struct stat st;
+    if (::fstat(fd, &st) != 0 ||
+        (S_ISREG(st.st_mode) && static_cast<size_t>(st.st_size) < total)) {
+        return nullptr;
+    }
+
+    // We write the header, the guest waits for it before it touches the
+    // content again.
+    void* addr = ::mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        return nullptr;
+    }
+
+    return std::shared_ptr<SharedBufferMemory>(
+            new SharedBufferMemory(static_cast<uint8_t*>(addr), size));
+}
+
+uint32_t SharedBufferMemory::add(const std::shared_ptr<SharedBufferMemory>& memory,
+                                 pid_t owner) {
+    emugl::Mutex::AutoLock lock(s_lock);
+    uint32_t handle = s_nextHandle++;
+    // Zero is what the guest sends when it has no memory.
+    if (handle == 0) {
+        handle = s_nextHandle++;
+    }
+    s_memories[handle] = Entry{memory, owner};
+    return handle;
+}
+
+std::shared_ptr<SharedBufferMemory> SharedBufferMemory::get(uint32_t handle,
+                                                            pid_t owner) {
+    emugl::Mutex::AutoLock lock(s_lock);
+    const auto entry = s_memories.find(handle);
+    if (entry == s_memories.end() || entry->second.owner != owner) {
+        return nullptr;
+    }
+    return entry->second.memory;
+}
+
+void SharedBufferMemory::remove(uint32_t handle) {
+    std::shared_ptr<SharedBufferMemory> memory;
+    {
+        emugl::Mutex::AutoLock lock(s_lock);
+        const auto it = s_memories.find(handle);
+        if (it == s_memories.end()) {
+            return;
+        }
+        // Unmapped outside of the lock.
+        memory = it->second.memory;
+        s_memories.erase(it);
+    }
+}
+
+void SharedBufferMemory::consume(uint32_t sequence) {
+    __atomic_store_n(&reinterpret_cast<Header*>(m_data)->consumed, sequence,
+                     __ATOMIC_RELEASE);
+}
@@ -0,0 +1,64 @@
+/*
+* Copyright (C) 2016 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <memory>
+
+// Memory a guest process shares with us to stream the content of a GL
+// buffer object through. Instead of the data itself the guest only sends
+// the range it touched, which we then read from the mapping.
+//
+// The region starts with a Header and the buffer content follows it. The
+// guest must not write to the region again before we stored the sequence
+// number of its last update in the header, see consume().
+class SharedBufferMemory {
+public:
+    struct Header {
+        uint32_t consumed;
+        uint32_t reserved[15];
+    };
+
+    ~SharedBufferMemory();
+
+    // Maps |fd| which has to hold a Header and |size| bytes of content.
+    // Returns NULL on failure.
+    static std::shared_ptr<SharedBufferMemory> map(int fd, size_t size);
+
+    // Registered memory is looked up by the decoders through the handle
+    // the guest got when sharing it. Only GL clients of the process |owner|
+    // which shared it can look it up, handles of other processes are as
+    // unknown to them as ones never handed out.
+    static uint32_t add(const std::shared_ptr<SharedBufferMemory>& memory, pid_t owner);
+    static std::shared_ptr<SharedBufferMemory> get(uint32_t handle, pid_t owner);
+    static void remove(uint32_t handle);
+
+    const uint8_t* data() const { return m_data + sizeof(Header); }
+    size_t size() const { return m_size; }
+
+    // Tells the guest the update with |sequence| was read.
+    void consume(uint32_t sequence);
+
+private:
+    SharedBufferMemory(uint8_t* data, size_t size);
+
+    uint8_t* m_data;
+    size_t m_size;
+};
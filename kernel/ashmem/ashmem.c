@@ -31,6 +31,8 @@
 #include <linux/uaccess.h>
 #include <linux/personality.h>
 #include <linux/bitops.h>
+#include <linux/kref.h>
+#include <linux/list_lru.h>
 #include <linux/mutex.h>
 #include <linux/shmem_fs.h>
 #include <linux/version.h>
@@ -47,9 +49,13 @@
  * @file:		The shmem-based backing file
  * @size:		The size of the mapping, in bytes
  * @prot_mask:		The allowed protection bits, as vm_flags
+ * @mutex:		Protects the area and its unpinned ranges
+ * @ref:		Held by the parent file and by the shrinker while it
+ *			purges one of the ranges
  *
  * The lifecycle of this structure is from our parent file's open() until
- * its release(). It is also protected by 'ashmem_mutex'
+ * its release() or until the shrinker is done with it, whichever comes
+ * last. It is protected by its 'mutex'
  *
  * Warning: Mappings do NOT pin this structure; It dies on close()
  */
@@ -59,6 +65,8 @@ struct ashmem_area {
 	struct file *file;
 	size_t size;
 	unsigned long prot_mask;
+	struct mutex mutex;
+	struct kref ref;
 };
 
 /**
@@ -71,7 +79,8 @@ struct ashmem_area {
  * @purged:	         The purge status (ASHMEM_NOT or ASHMEM_WAS_PURGED)
  *
  * The lifecycle of this structure is from unpin to pin.
- * It is protected by 'ashmem_mutex'
+ * It is protected by the mutex of its area. Ranges are charged to the
+ * memory cgroup of the task unpinning them.
  */
 struct ashmem_range {
 	struct list_head lru;
@@ -82,22 +91,24 @@ struct ashmem_range {
 	unsigned int purged;
 };
 
-/* LRU list of unpinned pages, protected by ashmem_mutex */
-static LIST_HEAD(ashmem_lru_list);
-
 /*
- * long lru_count - The count of pages on our LRU list.
+ * LRU of unpinned ranges. It keeps a list per memory cgroup the ranges are
+ * charged to, so that reclaim in one cgroup, e.g. a container hitting its
+ * memory limit, only purges what the processes of that cgroup unpinned
+ * instead of the caches of every other container.
  *
- * This is protected by ashmem_mutex.
+ * Lock Ordering: asma->mutex -> lru lock, asma->mutex -> i_mutex ->
+ * i_alloc_sem. The shrinker only ever trylocks areas under the lru lock.
  */
-static unsigned long lru_count;
+static struct list_lru ashmem_lru;
+
+/* Set once the shrinker may use ashmem_lru */
+static bool ashmem_lru_ready;
 
 /*
- * ashmem_mutex - protects the list of and each individual ashmem_area
- *
- * Lock Ordering: ashmex_mutex -> i_mutex -> i_alloc_sem
+ * long lru_count - The count of pages on our LRU, over all cgroups.
  */
-static DEFINE_MUTEX(ashmem_mutex);
+static atomic_long_t lru_count = ATOMIC_LONG_INIT(0);
 
 static struct kmem_cache *ashmem_area_cachep __read_mostly;
 static struct kmem_cache *ashmem_range_cachep __read_mostly;
@@ -126,6 +137,12 @@ static struct kmem_cache *ashmem_range_cachep __read_mostly;
 
 #define PROT_MASK		(PROT_EXEC | PROT_READ | PROT_WRITE)
 
+#ifdef SLAB_ACCOUNT
+#define ASHMEM_RANGE_CACHE_FLAGS	SLAB_ACCOUNT
+#else
+#define ASHMEM_RANGE_CACHE_FLAGS	0
+#endif
+
 /**
  * lru_add() - Adds a range of memory to the LRU list
  * @range:     The memory range being added.
@@ -135,8 +152,8 @@ static struct kmem_cache *ashmem_range_cachep __read_mostly;
  */
 static inline void lru_add(struct ashmem_range *range)
 {
-	list_add_tail(&range->lru, &ashmem_lru_list);
-	lru_count += range_size(range);
+	list_lru_add(&ashmem_lru, &range->lru);
+	atomic_long_add(range_size(range), &lru_count);
 }
 
 /**
@@ -148,8 +165,8 @@ static inline void lru_add(struct ashmem_range *range)
  */
 static inline void lru_del(struct ashmem_range *range)
 {
-	list_del(&range->lru);
-	lru_count -= range_size(range);
+	list_lru_del(&ashmem_lru, &range->lru);
+	atomic_long_sub(range_size(range), &lru_count);
 }
 
 /**
@@ -160,7 +177,7 @@ static inline void lru_del(struct ashmem_range *range)
  * @start:	   The starting page (inclusive)
  * @end:	   The ending page (inclusive)
  *
- * This function is protected by ashmem_mutex.
+ * Caller must hold asma->mutex.
  *
  * Return: 0 if successful, or -ENOMEM if there is an error
  */
@@ -220,7 +237,7 @@ static inline void range_shrink(struct ashmem_range *range,
 	range->pgend = end;
 
 	if (range_on_lru(range))
-		lru_count -= pre - range_size(range);
+		atomic_long_sub(pre - range_size(range), &lru_count);
 }
 
 /**
@@ -247,6 +264,8 @@ static int ashmem_open(struct inode *inode, struct file *file)
 		return -ENOMEM;
 
 	INIT_LIST_HEAD(&asma->unpinned_list);
+	mutex_init(&asma->mutex);
+	kref_init(&asma->ref);
 	memcpy(asma->name, ASHMEM_NAME_PREFIX, ASHMEM_NAME_PREFIX_LEN);
 	asma->prot_mask = PROT_MASK;
 	file->private_data = asma;
@@ -254,6 +273,15 @@ static int ashmem_open(struct inode *inode, struct file *file)
 	return 0;
 }
 
+static void ashmem_area_free(struct kref *ref)
+{
+	struct ashmem_area *asma = container_of(ref, struct ashmem_area, ref);
+
+	if (asma->file)
+		fput(asma->file);
+	kmem_cache_free(ashmem_area_cachep, asma);
+}
+
 /**
  * ashmem_release() - Releases an Anonymous Shared Memory structure
  * @ignored:	      The backing file's Index Node(?) - It is ignored here.
@@ -267,14 +295,12 @@ static int ashmem_release(struct inode *ignored, struct file *file)
 	struct ashmem_area *asma = file->private_data;
 	struct ashmem_range *range, *next;
 
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->mutex);
 	list_for_each_entry_safe(range, next, &asma->unpinned_list, unpinned)
 		range_del(range);
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->mutex);
 
-	if (asma->file)
-		fput(asma->file);
-	kmem_cache_free(ashmem_area_cachep, asma);
+	kref_put(&asma->ref, ashmem_area_free);
 
 	return 0;
 }
@@ -294,7 +320,7 @@ static ssize_t ashmem_read(struct file *file, char __user *buf,
 	struct ashmem_area *asma = file->private_data;
 	int ret = 0;
 
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->mutex);
 
 	/* If size is not set, or set to 0, always return EOF. */
 	if (asma->size == 0)
@@ -305,7 +331,7 @@ static ssize_t ashmem_read(struct file *file, char __user *buf,
 		goto out_unlock;
 	}
 
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->mutex);
 
 	/*
 	 * asma and asma->file are used outside the lock here.  We assume
@@ -320,7 +346,7 @@ static ssize_t ashmem_read(struct file *file, char __user *buf,
 	return ret;
 
 out_unlock:
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->mutex);
 	return ret;
 }
 
@@ -329,7 +355,7 @@ static loff_t ashmem_llseek(struct file *file, loff_t offset, int origin)
 	struct ashmem_area *asma = file->private_data;
 	int ret;
 
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->mutex);
 
 	if (asma->size == 0) {
 		ret = -EINVAL;
@@ -349,7 +375,7 @@ static loff_t ashmem_llseek(struct file *file, loff_t offset, int origin)
 	file->f_pos = asma->file->f_pos;
 
 out:
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->mutex);
 	return ret;
 }
 
@@ -365,7 +391,7 @@ static int ashmem_mmap(struct file *file, struct vm_area_struct *vma)
 	struct ashmem_area *asma = file->private_data;
 	int ret = 0;
 
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->mutex);
 
 	/* user needs to SET_SIZE before mapping */
 	if (unlikely(!asma->size)) {
@@ -420,10 +446,51 @@ static int ashmem_mmap(struct file *file, struct vm_area_struct *vma)
 	vma->vm_file = asma->file;
 
 out:
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->mutex);
 	return ret;
 }
 
+/*
+ * ashmem_lru_isolate - purges a single range off our LRU
+ *
+ * Called with the lock of the LRU list the range is on held. Areas being
+ * pinned, unpinned or released right now are skipped: those hold their
+ * mutex while they take the lru lock, and they might be what got us into
+ * reclaim in the first place.
+ */
+static enum lru_status
+ashmem_lru_isolate(struct list_head *item, struct list_lru_one *list,
+		   spinlock_t *lock, void *arg)
+{
+	struct ashmem_range *range = container_of(item, struct ashmem_range,
+						  lru);
+	struct ashmem_area *asma = range->asma;
+	loff_t start = range->pgstart * PAGE_SIZE;
+	loff_t end = (range->pgend + 1) * PAGE_SIZE;
+
+	if (!mutex_trylock(&asma->mutex))
+		return LRU_SKIP;
+
+	/*
+	 * The area can't be released before its ranges are off the LRU, which
+	 * takes our lock. Once we drop it ashmem_release() only waits for the
+	 * mutex, so keep the area alive until we are done unlocking it.
+	 */
+	kref_get(&asma->ref);
+	list_lru_isolate(list, item);
+	range->purged = ASHMEM_WAS_PURGED;
+	atomic_long_sub(range_size(range), &lru_count);
+
+	spin_unlock(lock);
+	vfs_fallocate(asma->file, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+		      start, end - start);
+	mutex_unlock(&asma->mutex);
+	kref_put(&asma->ref, ashmem_area_free);
+	spin_lock(lock);
+
+	return LRU_REMOVED_RETRY;
+}
+
 /*
  * ashmem_shrink - our cache shrinker, called from mm/vmscan.c
  *
@@ -436,51 +503,40 @@ out:
  *
  * We approximate LRU via least-recently-unpinned, jettisoning unpinned partial
  * chunks of ashmem regions LRU-wise one-at-a-time until we hit 'nr_to_scan'
- * pages freed.
+ * of them. Only the ranges of the cgroup and node under pressure are
+ * considered.
  */
 static unsigned long
 ashmem_shrink_scan(struct shrinker *shrink, struct shrink_control *sc)
 {
-	struct ashmem_range *range, *next;
-	unsigned long freed = 0;
-
 	/* We might recurse into filesystem code, so bail out if necessary */
 	if (!(sc->gfp_mask & __GFP_FS))
 		return SHRINK_STOP;
 
-	mutex_lock(&ashmem_mutex);
-	list_for_each_entry_safe(range, next, &ashmem_lru_list, lru) {
-		loff_t start = range->pgstart * PAGE_SIZE;
-		loff_t end = (range->pgend + 1) * PAGE_SIZE;
-
-		vfs_fallocate(range->asma->file,
-			      FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
-			      start, end - start);
-		range->purged = ASHMEM_WAS_PURGED;
-		lru_del(range);
+	if (!smp_load_acquire(&ashmem_lru_ready))
+		return SHRINK_STOP;
 
-		freed += range_size(range);
-		if (--sc->nr_to_scan <= 0)
-			break;
-	}
-	mutex_unlock(&ashmem_mutex);
-	return freed;
+	return list_lru_shrink_walk(&ashmem_lru, sc, ashmem_lru_isolate, NULL);
 }
 
 static unsigned long
 ashmem_shrink_count(struct shrinker *shrink, struct shrink_control *sc)
 {
 	/*
-	 * note that lru_count is count of pages on the lru, not a count of
-	 * objects on the list. This means the scan function needs to return the
-	 * number of pages freed, not the number of objects scanned.
+	 * The objects we count are the unpinned ranges of the cgroup and node
+	 * under pressure, the scan function returns the number of ranges it
+	 * purged accordingly.
 	 */
-	return lru_count;
+	if (!smp_load_acquire(&ashmem_lru_ready))
+		return 0;
+
+	return list_lru_shrink_count(&ashmem_lru, sc);
 }
 
 static struct shrinker ashmem_shrinker = {
 	.count_objects = ashmem_shrink_count,
 	.scan_objects = ashmem_shrink_scan,
+	.flags = SHRINKER_NUMA_AWARE | SHRINKER_MEMCG_AWARE,
 	/*
 	 * XXX (dchinner): I wish people would comment on why they need on
 	 * significant changes to the default value here
@@ -492,7 +548,7 @@ static int set_prot_mask(struct ashmem_area *asma, unsigned long prot)
 {
 	int ret = 0;
 
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->mutex);
 
 	/* the user can only remove, not add, protection bits */
 	if (unlikely((asma->prot_mask & prot) != prot)) {
@@ -507,7 +563,7 @@ static int set_prot_mask(struct ashmem_area *asma, unsigned long prot)
 	asma->prot_mask = prot;
 
 out:
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->mutex);
 	return ret;
 }
 
@@ -518,10 +574,10 @@ static int set_name(struct ashmem_area *asma, void __user *name)
 	char local_name[ASHMEM_NAME_LEN];
 
 	/*
-	 * Holding the ashmem_mutex while doing a copy_from_user might cause
+	 * Holding the area's mutex while doing a copy_from_user might cause
 	 * an data abort which would try to access mmap_sem. If another
 	 * thread has invoked ashmem_mmap then it will be holding the
-	 * semaphore and will be waiting for ashmem_mutex, there by leading to
+	 * semaphore and will be waiting for the mutex, there by leading to
 	 * deadlock. We'll release the mutex  and take the name to a local
 	 * variable that does not need protection and later copy the local
 	 * variable to the structure member with lock held.
@@ -531,14 +587,14 @@ static int set_name(struct ashmem_area *asma, void __user *name)
 		return len;
 	if (len == ASHMEM_NAME_LEN)
 		local_name[ASHMEM_NAME_LEN - 1] = '\0';
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->mutex);
 	/* cannot change an existing mapping's name */
 	if (unlikely(asma->file))
 		ret = -EINVAL;
 	else
 		strcpy(asma->name + ASHMEM_NAME_PREFIX_LEN, local_name);
 
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->mutex);
 	return ret;
 }
 
@@ -554,7 +610,7 @@ static int get_name(struct ashmem_area *asma, void __user *name)
 	 */
 	char local_name[ASHMEM_NAME_LEN];
 
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->mutex);
 	if (asma->name[ASHMEM_NAME_PREFIX_LEN] != '\0') {
 		/*
 		 * Copying only `len', instead of ASHMEM_NAME_LEN, bytes
@@ -566,7 +622,7 @@ static int get_name(struct ashmem_area *asma, void __user *name)
 		len = sizeof(ASHMEM_NAME_DEF);
 		memcpy(local_name, ASHMEM_NAME_DEF, len);
 	}
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->mutex);
 
 	/*
 	 * Now we are just copying from the stack variable to userland
@@ -581,7 +637,7 @@ static int get_name(struct ashmem_area *asma, void __user *name)
  * ashmem_pin - pin the given ashmem region, returning whether it was
  * previously purged (ASHMEM_WAS_PURGED) or not (ASHMEM_NOT_PURGED).
  *
- * Caller must hold ashmem_mutex.
+ * Caller must hold asma->mutex.
  */
 static int ashmem_pin(struct ashmem_area *asma, size_t pgstart, size_t pgend)
 {
@@ -648,7 +704,7 @@ static int ashmem_pin(struct ashmem_area *asma, size_t pgstart, size_t pgend)
 /*
  * ashmem_unpin - unpin the given range of pages. Returns zero on success.
  *
- * Caller must hold ashmem_mutex.
+ * Caller must hold asma->mutex.
  */
 static int ashmem_unpin(struct ashmem_area *asma, size_t pgstart, size_t pgend)
 {
@@ -683,7 +739,7 @@ restart:
  * ashmem_get_pin_status - Returns ASHMEM_IS_UNPINNED if _any_ pages in the
  * given interval are unpinned and ASHMEM_IS_PINNED otherwise.
  *
- * Caller must hold ashmem_mutex.
+ * Caller must hold asma->mutex.
  */
 static int ashmem_get_pin_status(struct ashmem_area *asma, size_t pgstart,
 				 size_t pgend)
@@ -732,7 +788,7 @@ static int ashmem_pin_unpin(struct ashmem_area *asma, unsigned long cmd,
 	pgstart = pin.offset / PAGE_SIZE;
 	pgend = pgstart + (pin.len / PAGE_SIZE) - 1;
 
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->mutex);
 
 	switch (cmd) {
 	case ASHMEM_PIN:
@@ -746,7 +802,7 @@ static int ashmem_pin_unpin(struct ashmem_area *asma, unsigned long cmd,
 		break;
 	}
 
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->mutex);
 
 	return ret;
 }
@@ -787,12 +843,10 @@ static long ashmem_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 	case ASHMEM_PURGE_ALL_CACHES:
 		ret = -EPERM;
 		if (capable(CAP_SYS_ADMIN)) {
-			struct shrink_control sc = {
-				.gfp_mask = GFP_KERNEL,
-				.nr_to_scan = LONG_MAX,
-			};
-			ret = ashmem_shrink_count(&ashmem_shrinker, &sc);
-			ashmem_shrink_scan(&ashmem_shrinker, &sc);
+			/* Purges the ranges of all cgroups */
+			ret = atomic_long_read(&lru_count);
+			list_lru_walk(&ashmem_lru, ashmem_lru_isolate, NULL,
+				      ULONG_MAX);
 		}
 		break;
 	}
@@ -848,31 +902,60 @@ static int __init ashmem_init(void)
 		return -ENOMEM;
 	}
 
+	/*
+	 * Ranges have to be charged to the cgroup unpinning them as that is
+	 * what puts them on the LRU list of that cgroup.
+	 */
 	ashmem_range_cachep = kmem_cache_create("ashmem_range_cache",
 						sizeof(struct ashmem_range),
-						0, 0, NULL);
+						0, ASHMEM_RANGE_CACHE_FLAGS,
+						NULL);
 	if (unlikely(!ashmem_range_cachep)) {
 		pr_err("failed to create slab cache\n");
 		return -ENOMEM;
 	}
 
+	/*
+	 * Since 4.19 the per cgroup lists of the LRU need the id the shrinker
+	 * gets when it is registered. Until the LRU is set up the shrinker
+	 * has nothing to do.
+	 */
+	ret = register_shrinker(&ashmem_shrinker);
+	if (unlikely(ret)) {
+		pr_err("failed to register shrinker!\n");
+		return ret;
+	}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 19, 0)
+	ret = list_lru_init_memcg(&ashmem_lru, &ashmem_shrinker);
+#else
+	ret = list_lru_init_memcg(&ashmem_lru);
+#endif
+	if (unlikely(ret)) {
+		pr_err("failed to set up LRU!\n");
+		unregister_shrinker(&ashmem_shrinker);
+		return ret;
+	}
+	smp_store_release(&ashmem_lru_ready, true);
+
 	ret = misc_register(&ashmem_misc);
 	if (unlikely(ret)) {
 		pr_err("failed to register misc device!\n");
+		unregister_shrinker(&ashmem_shrinker);
+		list_lru_destroy(&ashmem_lru);
 		return ret;
 	}
 
-	register_shrinker(&ashmem_shrinker);
-
 	return 0;
 }
 
 static void __exit ashmem_exit(void)
 {
-	unregister_shrinker(&ashmem_shrinker);
-
 	misc_deregister(&ashmem_misc);
 
+	unregister_shrinker(&ashmem_shrinker);
+	list_lru_destroy(&ashmem_lru);
+
 	kmem_cache_destroy(ashmem_range_cachep);
 	kmem_cache_destroy(ashmem_area_cachep);
 }
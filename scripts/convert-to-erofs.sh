@@ -0,0 +1,26 @@
+#!/bin/bash
+
+# Converts a squashfs Android image into an EROFS one compressed with
+# LZ4HC. Android reads /system mostly at random which LZ4 decompresses a
+# lot faster than gzip or xz. The container manager tells both kinds of
+# images apart on its own, the host kernel needs EROFS support though.
+
+set -ex
+
+input=$1
+output=$2
+
+if [ -z "$input" ] || [ -z "$output" ]; then
+	echo "Usage: $0 <squashfs image> <EROFS image>"
+	exit 1
+fi
+
+workdir=`mktemp -d`
+
+# Ownership was already shifted when the image was created and has to
+# stay as it is.
+sudo unsquashfs -d $workdir/rootfs $input
+sudo mkfs.erofs -zlz4hc -x-1 $output $workdir/rootfs
+sudo chown $USER:$USER $output
+
+sudo rm -rf $workdir
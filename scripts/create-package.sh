@@ -4,9 +4,10 @@ set -ex
 
 ramdisk=$1
 system=$2
+format=${3:-squashfs}
 
 if [ -z "$ramdisk" ] || [ -z "$system" ]; then
-	echo "Usage: $0 <ramdisk> <system image>"
+	echo "Usage: $0 <ramdisk> <system image> [squashfs|erofs]"
 	exit 1
 fi
 
@@ -29,7 +30,19 @@ sudo $workdir/uidmapshift -b $rootfs 0 100000 65536
 # FIXME
 sudo chmod +x $rootfs/anbox-init.sh
 
-sudo mksquashfs $rootfs android.img -comp xz -no-xattrs
+case "$format" in
+	squashfs)
+		sudo mksquashfs $rootfs android.img -comp xz -no-xattrs
+		;;
+	erofs)
+		# Decompresses much faster on the random reads Android does.
+		sudo mkfs.erofs -zlz4hc -x-1 android.img $rootfs
+		;;
+	*)
+		echo "Unknown image format $format"
+		exit 1
+		;;
+esac
 sudo chown $USER:$USER android.img
 
 sudo rm -rf $workdir
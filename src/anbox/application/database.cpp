@@ -16,23 +16,41 @@
  */
 
 #include "anbox/application/database.h"
+#include "anbox/application/icon_cache.h"
 #include "anbox/application/launcher_storage.h"
 #include "anbox/config.h"
 #include "anbox/logger.h"
 
+#include <sstream>
+
 namespace anbox {
 namespace application {
 const Database::Item Database::Unknown{};
 
 Database::Database() :
-  storage_(std::make_shared<LauncherStorage>(SystemConfiguration::instance().application_item_dir())) {
-  storage_->reset();
-}
+  Database(SystemConfiguration::instance().application_item_dir(),
+           boost::filesystem::path(SystemConfiguration::instance().cache_dir()) / "icons") {}
+
+Database::Database(const boost::filesystem::path &launcher_path,
+                   const boost::filesystem::path &icon_cache_path) :
+  storage_(std::make_shared<LauncherStorage>(launcher_path)),
+  icons_(std::make_shared<IconCache>(icon_cache_path)) {}
 
 Database::~Database() {}
 
 void Database::store_or_update(const Item &item) {
-  storage_->add_or_update(item);
+  std::lock_guard<std::mutex> l(mutex_);
+  if (item.icon.empty() && !item.icon_hash.empty()) {
+    if (icons_->contains(item.icon_hash)) {
+      storage_->add_or_update(item, icons_->path_for(item.icon_hash));
+    } else {
+      auto without_icon = item;
+      without_icon.icon_hash.clear();
+      storage_->add_or_update(without_icon);
+    }
+  } else {
+    storage_->add_or_update(item);
+  }
   items_[item.package] = item;
 
   // We don't need to store the icon data anymore at this point as the
@@ -41,18 +59,86 @@ void Database::store_or_update(const Item &item) {
 }
 
 void Database::remove(const Item &item) {
-  auto iter = items_.find(item.package);
-  if (iter == items_.end())
-    return;
+  std::lock_guard<std::mutex> l(mutex_);
+  // The launcher entry might still be around from an earlier session even
+  // when we didn't hear about the application in this one.
   storage_->remove(item);
-  items_.erase(iter);
+  items_.erase(item.package);
+}
+
+void Database::remove_stale() {
+  std::lock_guard<std::mutex> l(mutex_);
+  for (const auto &package : storage_->packages()) {
+    if (items_.find(package) != items_.end())
+      continue;
+
+    Item item;
+    item.package = package;
+    storage_->remove(item);
+  }
+}
+
+bool Database::has_icon(const std::string &hash) const {
+  std::lock_guard<std::mutex> l(mutex_);
+  return icons_->contains(hash);
+}
+
+void Database::store_icon(const std::string &hash, const std::vector<char> &data) {
+  std::lock_guard<std::mutex> l(mutex_);
+  icons_->store(hash, data);
+}
+
+void Database::flush() {
+  // LauncherStorage has its own locking; holding ours while waiting for
+  // the disk would only stall everybody else.
+  storage_->flush();
 }
 
-const Database::Item& Database::find_by_package(const std::string &package) const {
+Database::Item Database::find_by_package(const std::string &package) const {
+  std::lock_guard<std::mutex> l(mutex_);
   auto iter = items_.find(package);
   if (iter == items_.end())
     return Unknown;
   return iter->second;
 }
+
+void Database::set_frame_rate_caps(const std::string &package, const wm::FrameRateCaps &caps) {
+  std::lock_guard<std::mutex> l(mutex_);
+  frame_rate_caps_[package] = caps;
+}
+
+void Database::set_default_frame_rate_caps(const wm::FrameRateCaps &caps) {
+  std::lock_guard<std::mutex> l(mutex_);
+  default_frame_rate_caps_ = caps;
+}
+
+wm::FrameRateCaps Database::frame_rate_caps_for(const std::string &package) const {
+  std::lock_guard<std::mutex> l(mutex_);
+  auto iter = frame_rate_caps_.find(package);
+  if (iter == frame_rate_caps_.end())
+    return default_frame_rate_caps_;
+  return iter->second;
+}
+
+void Database::read_frame_rate_caps(std::istream &in) {
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    std::istringstream fields(line);
+    std::string package;
+    wm::FrameRateCaps caps;
+    if (!(fields >> package >> caps.focused >> caps.unfocused)) {
+      WARNING("Ignoring invalid frame rate caps: %s", line);
+      continue;
+    }
+
+    if (package == "*")
+      set_default_frame_rate_caps(caps);
+    else
+      set_frame_rate_caps(package, caps);
+  }
+}
 }  // namespace application
 }  // namespace anbox
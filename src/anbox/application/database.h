@@ -19,14 +19,23 @@
 #define ANBOX_APPLICATION_DATABASE_H_
 
 #include "anbox/android/intent.h"
+#include "anbox/wm/frame_rate_caps.h"
 
+#include <istream>
 #include <string>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
 
 namespace anbox {
 namespace application {
+class IconCache;
 class LauncherStorage;
+// Safe to use from several threads; icons fetched from Android complete on
+// whatever thread the bridge delivers them on.
 class Database {
  public:
   struct Item {
@@ -34,6 +43,8 @@ class Database {
     std::string package;
     android::Intent launch_intent;
     std::vector<char> icon;
+    // Android sends icons it sent before by their hash only, see IconCache.
+    std::string icon_hash;
 
     bool valid() const { return package.length() > 0; }
   };
@@ -41,16 +52,41 @@ class Database {
   static const Item Unknown;
 
   Database();
+  Database(const boost::filesystem::path &launcher_path,
+           const boost::filesystem::path &icon_cache_path);
   ~Database();
 
+  // An item which refers to an icon we don't have is stored without one.
   void store_or_update(const Item &item);
   void remove(const Item &item);
 
-  const Item& find_by_package(const std::string &package) const;
+  // Launcher entries are kept between sessions. This drops those of all
+  // applications Android didn't tell us about in this session.
+  void remove_stale();
+
+  bool has_icon(const std::string &hash) const;
+  void store_icon(const std::string &hash, const std::vector<char> &data);
+
+  // Blocks until all launcher entries are written.
+  void flush();
+
+  Item find_by_package(const std::string &package) const;
+
+  // Packages without caps of their own get the default ones.
+  void set_frame_rate_caps(const std::string &package, const wm::FrameRateCaps &caps);
+  void set_default_frame_rate_caps(const wm::FrameRateCaps &caps);
+  wm::FrameRateCaps frame_rate_caps_for(const std::string &package) const;
+  // Takes one "<package> <focused fps> <unfocused fps>" line per package,
+  // with "*" as package for the default caps.
+  void read_frame_rate_caps(std::istream &in);
 
  private:
+  mutable std::mutex mutex_;
   std::shared_ptr<LauncherStorage> storage_;
+  std::shared_ptr<IconCache> icons_;
   std::map<std::string,Item> items_;
+  std::map<std::string,wm::FrameRateCaps> frame_rate_caps_;
+  wm::FrameRateCaps default_frame_rate_caps_;
 };
 }  // namespace application
 }  // namespace anbox
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/application/icon_cache.h"
+#include "anbox/logger.h"
+
+#include <cctype>
+#include <fstream>
+
+namespace fs = boost::filesystem;
+
+namespace {
+constexpr const char *icon_extension{".png"};
+constexpr std::size_t max_hash_length{64};
+}
+
+namespace anbox {
+namespace application {
+IconCache::IconCache(const fs::path &path) : path_(path) {
+  boost::system::error_code err;
+  if (!fs::is_directory(path_, err))
+    return;
+
+  for (fs::directory_iterator iter(path_, err), end; !err && iter != end; iter.increment(err)) {
+    const auto &p = iter->path();
+    if (p.extension() != icon_extension)
+      continue;
+    const auto hash = p.stem().string();
+    if (valid_hash(hash))
+      hashes_.insert(hash);
+  }
+}
+
+IconCache::~IconCache() {}
+
+bool IconCache::valid_hash(const std::string &hash) {
+  if (hash.empty() || hash.length() > max_hash_length)
+    return false;
+  for (const auto c : hash) {
+    if (!std::isxdigit(static_cast<unsigned char>(c)))
+      return false;
+  }
+  return true;
+}
+
+bool IconCache::contains(const std::string &hash) const {
+  return hashes_.find(hash) != hashes_.end();
+}
+
+fs::path IconCache::path_for(const std::string &hash) const {
+  return path_ / (hash + icon_extension);
+}
+
+bool IconCache::store(const std::string &hash, const std::vector<char> &data) {
+  if (!valid_hash(hash))
+    return false;
+
+  boost::system::error_code err;
+  fs::create_directories(path_, err);
+
+  // Written under a temporary name first, a partially written icon must
+  // never be picked up by a later session.
+  const auto path = path_for(hash);
+  const auto tmp_path = fs::path(path.string() + ".tmp");
+  {
+    std::ofstream out(tmp_path.string(), std::ios::binary);
+    if (!out || !out.write(data.data(), data.size())) {
+      ERROR("Failed to write icon %s", hash);
+      return false;
+    }
+  }
+
+  fs::rename(tmp_path, path, err);
+  if (err) {
+    ERROR("Failed to store icon %s: %s", hash, err.message());
+    return false;
+  }
+
+  hashes_.insert(hash);
+  return true;
+}
+}  // namespace application
+}  // namespace anbox
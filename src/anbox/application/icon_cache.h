@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_APPLICATION_ICON_CACHE_H_
+#define ANBOX_APPLICATION_ICON_CACHE_H_
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+namespace anbox {
+namespace application {
+// Application icons on disk by the hash Android gave them, so that we only
+// have to fetch icons over the bridge we never saw before.
+class IconCache {
+ public:
+  explicit IconCache(const boost::filesystem::path &path);
+  ~IconCache();
+
+  // Whether |hash| is something Android might give us. As it ends up as
+  // part of a path we're strict about it.
+  static bool valid_hash(const std::string &hash);
+
+  bool contains(const std::string &hash) const;
+  boost::filesystem::path path_for(const std::string &hash) const;
+  bool store(const std::string &hash, const std::vector<char> &data);
+
+ private:
+  boost::filesystem::path path_;
+  std::set<std::string> hashes_;
+};
+}  // namespace application
+}  // namespace anbox
+
+#endif
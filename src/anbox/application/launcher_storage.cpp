@@ -22,6 +22,7 @@
 #include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 
 namespace fs = boost::filesystem;
 
@@ -29,18 +30,34 @@ namespace {
 // This will always point us to the right executable when we're running within
 // a snap environment.
 constexpr const char *snap_exe_path{"/snap/bin/anbox"};
+constexpr const char *index_name{"anbox-launcher-index"};
+
+// FNV-1a, as it needs to stay stable between runs and builds.
+std::uint64_t hash(std::uint64_t h, const char *data, std::size_t size) {
+  for (std::size_t n = 0; n < size; n++) {
+    h ^= static_cast<unsigned char>(data[n]);
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
 }
 
 namespace anbox {
 namespace application {
 LauncherStorage::LauncherStorage(const fs::path &path) :
-  path_(path) {}
-
-LauncherStorage::~LauncherStorage() {}
+  path_(path), writing_(false), running_(true) {
+  load_index();
+  writer_ = std::thread(&LauncherStorage::process_writes, this);
+}
 
-void LauncherStorage::reset() {
-  if (fs::exists(path_))
-    fs::remove_all(path_);
+LauncherStorage::~LauncherStorage() {
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    running_ = false;
+    changed_.notify_all();
+  }
+  // Whatever is still queued gets written before the thread exits.
+  writer_.join();
 }
 
 std::string LauncherStorage::clean_package_name(const std::string &package_name) {
@@ -57,11 +74,59 @@ fs::path LauncherStorage::path_for_item_icon(const std::string &package_name) {
   return path_ / utils::string_format("anbox-%s.png", package_name);
 }
 
-void LauncherStorage::add_or_update(const Database::Item &item) {
-  if (!fs::exists(path_)) fs::create_directories(path_);
+fs::path LauncherStorage::path_for_index() const {
+  return path_ / index_name;
+}
+
+void LauncherStorage::load_index() {
+  std::ifstream in(path_for_index().string());
+  if (!in)
+    return;
+
+  std::string line;
+  while (std::getline(in, line)) {
+    const auto sep = line.find(' ');
+    if (sep == std::string::npos)
+      continue;
+
+    const auto package = line.substr(sep + 1);
+    // Somebody might have cleaned up the directory behind our back in
+    // which case the entry has to be written again.
+    const auto package_name = clean_package_name(package);
+    if (!fs::exists(path_for_item(package_name)) || !fs::exists(path_for_item_icon(package_name)))
+      continue;
+
+    try {
+      hashes_[package] = std::stoull(line.substr(0, sep), nullptr, 16);
+    } catch (const std::exception &) {
+      continue;
+    }
+  }
+}
+
+void LauncherStorage::write_index(const std::map<std::string, std::uint64_t> &hashes) {
+  // Write to a temporary file first so that a crash leaves us with either
+  // the old or the new index but never half of one.
+  const auto path = path_for_index();
+  const auto tmp_path = fs::path(path.string() + ".tmp");
+  {
+    std::ofstream out(tmp_path.string());
+    if (!out) {
+      ERROR("Failed to write launcher index %s", tmp_path.string());
+      return;
+    }
+    for (const auto &h : hashes)
+      out << utils::string_format("%016x", h.second) << " " << h.first << std::endl;
+  }
 
-  auto package_name = item.package;
-  std::replace(package_name.begin(), package_name.end(), '.', '-');
+  boost::system::error_code err;
+  fs::rename(tmp_path, path, err);
+  if (err)
+    ERROR("Failed to replace launcher index: %s", err.message());
+}
+
+void LauncherStorage::add_or_update(const Database::Item &item, const fs::path &icon_file) {
+  auto package_name = clean_package_name(item.package);
 
   auto exe_path = utils::process_get_exe_path(getpid());
   if (utils::get_env_value("SNAP").length() > 0)
@@ -85,34 +150,134 @@ void LauncherStorage::add_or_update(const Database::Item &item) {
     exec += utils::string_format("--component=%s ", item.launch_intent.component);
 
   const auto item_icon_path = path_for_item_icon(package_name);
-  if (auto desktop_item = std::ofstream(path_for_item(package_name).string())) {
-    desktop_item << "[Desktop Entry]" << std::endl
-                 << "Name=" << item.name << std::endl
-                 << "Exec=" << exec << std::endl
-                 << "Terminal=false" << std::endl
-                 << "Type=Application" << std::endl
-                 << "Icon=" << item_icon_path.string() << std::endl;
-  } else {
-    BOOST_THROW_EXCEPTION(std::runtime_error("Failed to create desktop item"));
-  }
+  std::stringstream desktop_item;
+  desktop_item << "[Desktop Entry]" << std::endl
+               << "Name=" << item.name << std::endl
+               << "Exec=" << exec << std::endl
+               << "Terminal=false" << std::endl
+               << "Type=Application" << std::endl
+               << "Icon=" << item_icon_path.string() << std::endl;
+
+  Entry entry;
+  entry.desktop_item = desktop_item.str();
+  entry.hash = hash(0xcbf29ce484222325ULL, entry.desktop_item.data(), entry.desktop_item.size());
+  // Cached icons are named by the hash of their content already.
+  if (icon_file.empty())
+    entry.hash = hash(entry.hash, item.icon.data(), item.icon.size());
+  else
+    entry.hash = hash(entry.hash, item.icon_hash.data(), item.icon_hash.size());
 
-  if (auto icon = std::ofstream(item_icon_path.string()))
-    icon.write(item.icon.data(), item.icon.size());
+  std::lock_guard<std::mutex> l(mutex_);
+  auto h = hashes_.find(item.package);
+  if (h != hashes_.end() && h->second == entry.hash)
+    return;
+
+  hashes_[item.package] = entry.hash;
+  if (icon_file.empty())
+    entry.icon = item.icon;
   else
-    BOOST_THROW_EXCEPTION(std::runtime_error("Failed to write icon"));
+    entry.icon_file = icon_file;
+  pending_[item.package] = std::move(entry);
+  changed_.notify_all();
 }
 
 void LauncherStorage::remove(const Database::Item &item) {
-  auto package_name = clean_package_name(item.package);
+  std::lock_guard<std::mutex> l(mutex_);
+  hashes_.erase(item.package);
+  pending_[item.package] = Entry{0, std::string(), std::vector<char>(), fs::path()};
+  changed_.notify_all();
+}
 
-  const auto item_path = path_for_item(package_name);
-  if (fs::exists(item_path))
-    fs::remove(item_path);
+std::set<std::string> LauncherStorage::packages() const {
+  std::lock_guard<std::mutex> l(mutex_);
+  std::set<std::string> packages;
+  for (const auto &h : hashes_)
+    packages.insert(h.first);
+  return packages;
+}
 
+void LauncherStorage::flush() {
+  std::unique_lock<std::mutex> l(mutex_);
+  changed_.wait(l, [&]() { return pending_.empty() && !writing_; });
+}
+
+bool LauncherStorage::write_entry(const std::string &package, const Entry &entry) {
+  const auto package_name = clean_package_name(package);
+  const auto item_path = path_for_item(package_name);
   const auto item_icon_path = path_for_item_icon(package_name);
-  if (fs::exists(item_icon_path))
-    fs::remove(item_icon_path);
+
+  if (entry.desktop_item.empty()) {
+    boost::system::error_code err;
+    fs::remove(item_path, err);
+    fs::remove(item_icon_path, err);
+    return true;
+  }
+
+  if (auto desktop_item = std::ofstream(item_path.string())) {
+    desktop_item << entry.desktop_item;
+  } else {
+    ERROR("Failed to create desktop item for %s", package);
+    return false;
+  }
+
+  if (!entry.icon_file.empty()) {
+    boost::system::error_code err;
+    fs::remove(item_icon_path, err);
+    fs::copy_file(entry.icon_file, item_icon_path, err);
+    if (err) {
+      ERROR("Failed to copy icon for %s: %s", package, err.message());
+      return false;
+    }
+  } else if (auto icon = std::ofstream(item_icon_path.string())) {
+    icon.write(entry.icon.data(), entry.icon.size());
+  } else {
+    ERROR("Failed to write icon for %s", package);
+    return false;
+  }
+
+  return true;
 }
 
+void LauncherStorage::process_writes() {
+  std::unique_lock<std::mutex> l(mutex_);
+  while (true) {
+    changed_.wait(l, [&]() { return !pending_.empty() || !running_; });
+    if (pending_.empty())
+      break;
+
+    auto entries = std::move(pending_);
+    pending_.clear();
+    auto hashes = hashes_;
+    writing_ = true;
+    l.unlock();
+
+    // Whatever we didn't get to because something threw failed too.
+    std::set<std::string> failed;
+    for (const auto &entry : entries)
+      failed.insert(entry.first);
+    try {
+      if (!fs::exists(path_)) fs::create_directories(path_);
+      for (const auto &entry : entries) {
+        if (write_entry(entry.first, entry.second))
+          failed.erase(entry.first);
+      }
+      // Entries we failed to write are tried again with the next update.
+      for (const auto &package : failed)
+        hashes.erase(package);
+      write_index(hashes);
+    } catch (const std::exception &err) {
+      ERROR("Failed to update launcher entries: %s", err.what());
+    }
+
+    l.lock();
+    for (const auto &package : failed) {
+      auto h = hashes_.find(package);
+      if (h != hashes_.end() && h->second == entries[package].hash)
+        hashes_.erase(h);
+    }
+    writing_ = false;
+    changed_.notify_all();
+  }
+}
 }  // namespace application
 }  // namespace anbox
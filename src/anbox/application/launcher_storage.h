@@ -21,28 +21,72 @@
 #include "anbox/application/database.h"
 #include "anbox/android/intent.h"
 
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <boost/filesystem.hpp>
 
 namespace anbox {
 namespace application {
+// Keeps a desktop entry and an icon for every application on disk.
+//
+// The entries stay around between sessions. An index next to them holds a
+// hash of what we wrote for each package so that an update with the same
+// content doesn't touch the disk at all. Everything else is written by a
+// background thread; the caller only renders the entry.
 class LauncherStorage {
  public:
   LauncherStorage(const boost::filesystem::path &path);
   ~LauncherStorage();
 
-  void reset();
-  void add_or_update(const Database::Item &item);
+  // The icon is copied from |icon_file| when given instead of taken from
+  // the item.
+  void add_or_update(const Database::Item &item,
+                     const boost::filesystem::path &icon_file = boost::filesystem::path());
   void remove(const Database::Item &item);
 
+  // Packages we have entries on disk for, including those written by
+  // earlier sessions.
+  std::set<std::string> packages() const;
+
+  // Blocks until everything queued so far is on disk.
+  void flush();
+
  private:
+  struct Entry {
+    std::uint64_t hash;
+    // Empty when the entry is to be removed.
+    std::string desktop_item;
+    std::vector<char> icon;
+    boost::filesystem::path icon_file;
+  };
+
   std::string clean_package_name(const std::string &package_name);
   boost::filesystem::path path_for_item(const std::string &package_name);
   boost::filesystem::path path_for_item_icon(const std::string &package_name);
+  boost::filesystem::path path_for_index() const;
+
+  void load_index();
+  void write_index(const std::map<std::string, std::uint64_t> &hashes);
+  bool write_entry(const std::string &package, const Entry &entry);
+  void process_writes();
 
   boost::filesystem::path path_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable changed_;
+  // Hashes of the entries as they will be once all writes are done.
+  std::map<std::string, std::uint64_t> hashes_;
+  std::map<std::string, Entry> pending_;
+  bool writing_;
+  bool running_;
+  std::thread writer_;
 };
 }  // namespace application
 }  // namespace anbox
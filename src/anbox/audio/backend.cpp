@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/audio/backend.h"
+
+#include <boost/throw_exception.hpp>
+
+#include <istream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+namespace anbox {
+namespace audio {
+std::istream &operator>>(std::istream &in, Backend &backend) {
+  std::string str(std::istreambuf_iterator<char>(in), {});
+  if (str.empty() || str == "sdl")
+    backend = Backend::SDL;
+  else if (str == "pulseaudio")
+    backend = Backend::PulseAudio;
+  else
+    BOOST_THROW_EXCEPTION(std::runtime_error("Invalid audio backend value provided"));
+  return in;
+}
+}  // namespace audio
+}  // namespace anbox
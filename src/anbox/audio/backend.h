@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_AUDIO_BACKEND_H_
+#define ANBOX_AUDIO_BACKEND_H_
+
+#include <iosfwd>
+
+namespace anbox {
+namespace audio {
+// How guest audio reaches the host.
+enum class Backend {
+  // An SDL audio device per guest stream.
+  SDL,
+  // All guest streams mixed into one stream of the PulseAudio server,
+  // which PipeWire provides as well.
+  PulseAudio,
+};
+
+std::istream &operator>>(std::istream &in, Backend &backend);
+}  // namespace audio
+}  // namespace anbox
+
+#endif
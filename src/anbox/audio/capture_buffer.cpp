@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/audio/capture_buffer.h"
+
+namespace anbox {
+namespace audio {
+constexpr std::size_t CaptureBuffer::default_chunk_frames;
+constexpr std::size_t CaptureBuffer::default_buffer_frames;
+
+CaptureBuffer::CaptureBuffer(const Config &config, std::size_t frame_size)
+    : frame_size_(frame_size),
+      ring_(config.buffer_frames * frame_size) {
+  config_.chunk_frames = config.chunk_frames;
+  config_.buffer_frames = ring_.capacity() / frame_size_;
+}
+
+bool CaptureBuffer::write(const std::uint8_t *data, std::size_t size) {
+  if (ring_.is_closed())
+    return false;
+
+  // Only we make the free space smaller, so once there is room the write
+  // below doesn't wait.
+  if (ring_.capacity() - ring_.available() < size) {
+    overruns_++;
+    return false;
+  }
+  return ring_.write(data, size) == size;
+}
+
+std::size_t CaptureBuffer::read(std::uint8_t *buffer, std::size_t size) {
+  // Frames are never split in the ring as all writes are whole frames
+  // and its size is a multiple of the frame size.
+  return ring_.read(buffer, size - size % frame_size_, true);
+}
+
+void CaptureBuffer::close() {
+  ring_.close();
+}
+
+std::size_t CaptureBuffer::buffered_frames() const {
+  return ring_.available() / frame_size_;
+}
+
+CaptureBuffer::Statistics CaptureBuffer::statistics() const {
+  return Statistics{overruns_.load()};
+}
+}  // namespace audio
+}  // namespace anbox
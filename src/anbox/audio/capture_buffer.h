@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_AUDIO_CAPTURE_BUFFER_H_
+#define ANBOX_AUDIO_CAPTURE_BUFFER_H_
+
+#include "anbox/graphics/ring_buffer.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace anbox {
+namespace audio {
+// Queues captured PCM data between the realtime callback of the audio
+// device and the connection it is sent to the guest on.
+//
+// The mirror image of PlaybackBuffer: the device callback never waits
+// for the reader and rather drops what doesn't fit, the reader waits
+// for the device.
+class CaptureBuffer {
+ public:
+  // 20 ms at the 8 kHz recording rate of the guest.
+  static constexpr std::size_t default_chunk_frames{160};
+  static constexpr std::size_t default_buffer_frames{4096};
+
+  struct Config {
+    // Frames the guest gets at once and the device captures at once.
+    std::size_t chunk_frames;
+    // Frames queued at most while the reader falls behind. Rounded up
+    // so that the buffer size in bytes is a power of two.
+    std::size_t buffer_frames;
+  };
+
+  struct Statistics {
+    // Writes dropped as the reader fell too far behind.
+    std::uint64_t overruns;
+  };
+
+  // |frame_size| has to be a power of two.
+  CaptureBuffer(const Config &config, std::size_t frame_size);
+
+  const Config &config() const { return config_; }
+  std::size_t frame_size() const { return frame_size_; }
+
+  // Queues all of |size| bytes if there is room for them and drops them
+  // otherwise. Never blocks.
+  bool write(const std::uint8_t *data, std::size_t size);
+
+  // Waits until data is available and copies whole frames of it, up to
+  // |size| bytes. Returns 0 once the buffer was closed and drained.
+  std::size_t read(std::uint8_t *buffer, std::size_t size);
+
+  // Wakes up and fails a reader waiting for data.
+  void close();
+
+  std::size_t buffered_frames() const;
+
+  Statistics statistics() const;
+
+ private:
+  Config config_;
+  std::size_t frame_size_;
+  graphics::RingBuffer ring_;
+  std::atomic<std::uint64_t> overruns_{0};
+};
+}  // namespace audio
+}  // namespace anbox
+
+#endif
@@ -18,6 +18,8 @@
 #ifndef ANBOX_AUDIO_CLIENT_INFO_H_
 #define ANBOX_AUDIO_CLIENT_INFO_H_
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
 
 namespace anbox {
@@ -28,8 +30,62 @@ struct ClientInfo {
     Recording = 1,
     Max = 2,
   };
+  // Sample formats, always interleaved and in host byte order.
+  enum class Format : std::uint8_t {
+    S16 = 0,
+    Float = 1,
+  };
+  // Transport options, granted by the server only if it echoes them back.
+  enum Flags : std::uint8_t {
+    // Playback data goes through a SharedRing the server passes over
+    // the socket after the StreamInfo.
+    SharedMemory = 1 << 0,
+  };
+
   Type type;
+  // The client asks for the format it produces and the server answers
+  // with the one it accepted, which the client has to use from then on.
+  Format format;
+  std::uint8_t channels;
+  std::uint8_t flags;
+  std::uint32_t sample_rate;
+
+  std::size_t frame_size() const {
+    return channels * (format == Format::Float ? sizeof(float) : sizeof(std::int16_t));
+  }
+};
+
+// Sent by the server right after approving a client.
+struct StreamInfo {
+  // Time it takes at most until written data is played or until captured
+  // data arrives at the client.
+  std::uint32_t latency_ms;
+  // Bytes the client should write at once or gets at once. Zero if it
+  // doesn't matter.
+  std::uint32_t period_size;
+};
+
+// Header of the memory a playback client writes its data into when the
+// SharedMemory transport was granted, directly followed by |size| bytes
+// of data. Positions grow forever and wrap around at 2^32; |size| is a
+// power of two so that they map onto the data with a simple mask.
+//
+// The socket then only carries notifications: the client sends its write
+// position after writing and before waiting for room, the server sends
+// its read position after consuming if |writer_waiting| is set.
+struct SharedRing {
+  std::uint32_t size;
+  std::uint32_t reserved;
+  // Only written by the client.
+  std::atomic<std::uint32_t> write_pos;
+  // Only written by the server.
+  std::atomic<std::uint32_t> read_pos;
+  std::atomic<std::uint32_t> writer_waiting;
+
+  std::uint8_t *data() { return reinterpret_cast<std::uint8_t *>(this + 1); }
 };
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t),
+              "SharedRing positions have to be plain memory both sides agree on");
 } // namespace audio
 } // namespace anbox
 
@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/audio/mixer.h"
+#include "anbox/audio/resampler.h"
+#include "anbox/audio/sink.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace anbox {
+namespace audio {
+constexpr std::size_t Mixer::channels;
+constexpr std::size_t Mixer::frame_size;
+constexpr std::uint32_t Mixer::default_sample_rate;
+
+class Mixer::Stream : public Sink {
+ public:
+  Stream(const ClientInfo &info, std::uint32_t sample_rate, const PlaybackBuffer::Config &config)
+      : info_(info),
+        period_size_(config.period_frames * info.frame_size()),
+        buffer_(config, sample_rate, Mixer::frame_size) {
+    if (info.sample_rate != sample_rate)
+      resampler_.reset(new Resampler(info.format, info.channels, info.sample_rate, sample_rate));
+  }
+
+  ~Stream() {
+    buffer_.close();
+  }
+
+  void write_data(const std::uint8_t *data, size_t size) override {
+    if (resampler_) {
+      const auto &resampled = resampler_->process(data, size);
+      convert(resampled.data(), resampled.size());
+    } else {
+      convert(data, size);
+    }
+    buffer_.write(reinterpret_cast<const std::uint8_t *>(converted_.data()),
+                  converted_.size() * sizeof(float));
+  }
+
+  std::chrono::microseconds latency() const override { return buffer_.latency(); }
+  size_t period_size() const override { return period_size_; }
+
+  void read(float *out, std::size_t frames) {
+    buffer_.read(reinterpret_cast<std::uint8_t *>(out), frames * Mixer::frame_size);
+  }
+
+ private:
+  // Turns whole frames of |data| into the mix format.
+  void convert(const std::uint8_t *data, std::size_t size) {
+    const auto sample_size = info_.frame_size() / info_.channels;
+    const auto samples = size / info_.frame_size() * info_.channels;
+
+    samples_.resize(samples);
+    if (info_.format == ClientInfo::Format::Float) {
+      std::memcpy(samples_.data(), data, samples * sizeof(float));
+    } else {
+      std::int16_t sample = 0;
+      for (std::size_t n = 0; n < samples; n++) {
+        std::memcpy(&sample, data + n * sample_size, sizeof(sample));
+        samples_[n] = sample / 32768.0f;
+      }
+    }
+
+    if (info_.channels == Mixer::channels) {
+      converted_.swap(samples_);
+      return;
+    }
+
+    // Only mono is left.
+    converted_.resize(samples * Mixer::channels);
+    for (std::size_t n = 0; n < samples; n++) {
+      converted_[n * 2] = samples_[n];
+      converted_[n * 2 + 1] = samples_[n];
+    }
+  }
+
+  const ClientInfo info_;
+  const size_t period_size_;
+  PlaybackBuffer buffer_;
+  std::unique_ptr<Resampler> resampler_;
+  std::vector<float> samples_;
+  std::vector<float> converted_;
+};
+
+Mixer::Mixer(std::uint32_t sample_rate, const PlaybackBuffer::Config &config)
+    : sample_rate_(sample_rate), config_(config), closed_(false) {}
+
+std::shared_ptr<Sink> Mixer::create_stream(const ClientInfo &info) {
+  auto stream = std::make_shared<Stream>(info, sample_rate_, config_);
+  std::lock_guard<std::mutex> l(lock_);
+  streams_.push_back(stream);
+  streams_changed_.notify_all();
+  return stream;
+}
+
+std::size_t Mixer::mix(float *out, std::size_t frames) {
+  std::vector<std::shared_ptr<Stream>> streams;
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    auto it = streams_.begin();
+    while (it != streams_.end()) {
+      auto stream = it->lock();
+      if (!stream) {
+        it = streams_.erase(it);
+        continue;
+      }
+      streams.push_back(stream);
+      ++it;
+    }
+  }
+
+  const auto samples = frames * channels;
+  std::fill(out, out + samples, 0.0f);
+  scratch_.resize(samples);
+  for (const auto &stream : streams) {
+    stream->read(scratch_.data(), frames);
+    for (std::size_t n = 0; n < samples; n++)
+      out[n] += scratch_[n];
+  }
+
+  // Several loud streams together can exceed full scale.
+  if (streams.size() > 1) {
+    for (std::size_t n = 0; n < samples; n++)
+      out[n] = std::min(1.0f, std::max(-1.0f, out[n]));
+  }
+
+  return streams.size();
+}
+
+bool Mixer::wait_for_streams() {
+  std::unique_lock<std::mutex> l(lock_);
+  streams_changed_.wait(l, [&]() { return closed_ || !streams_.empty(); });
+  return !closed_;
+}
+
+void Mixer::close() {
+  std::lock_guard<std::mutex> l(lock_);
+  closed_ = true;
+  streams_changed_.notify_all();
+}
+}  // namespace audio
+}  // namespace anbox
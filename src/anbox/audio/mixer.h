@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_AUDIO_MIXER_H_
+#define ANBOX_AUDIO_MIXER_H_
+
+#include "anbox/audio/client_info.h"
+#include "anbox/audio/playback_buffer.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace anbox {
+namespace audio {
+class Sink;
+
+// Mixes any number of guest playback streams into a single one, for
+// backends which keep one stream open with the host sound server rather
+// than one per guest connection.
+//
+// Each stream gets its own PlaybackBuffer in the mix format, float
+// stereo at the mix rate. Converting and resampling happens on the
+// writing side, once per stream, so that mixing a period is only a sum
+// over all buffers.
+class Mixer {
+ public:
+  static constexpr std::size_t channels{2};
+  static constexpr std::size_t frame_size{channels * sizeof(float)};
+  // What sound servers run at by default these days.
+  static constexpr std::uint32_t default_sample_rate{48000};
+
+  Mixer(std::uint32_t sample_rate, const PlaybackBuffer::Config &config);
+
+  std::uint32_t sample_rate() const { return sample_rate_; }
+  const PlaybackBuffer::Config &config() const { return config_; }
+
+  // Returns a sink taking data in the format of |info| which is mixed in
+  // until the sink is gone.
+  std::shared_ptr<Sink> create_stream(const ClientInfo &info);
+
+  // Mixes |frames| frames of all streams into |out|. Streams with not
+  // enough data queued contribute silence. Returns the number of streams
+  // mixed.
+  std::size_t mix(float *out, std::size_t frames);
+
+  // Blocks until there is at least one stream. Returns false once the
+  // mixer was closed.
+  bool wait_for_streams();
+
+  void close();
+
+ private:
+  class Stream;
+
+  const std::uint32_t sample_rate_;
+  const PlaybackBuffer::Config config_;
+
+  std::mutex lock_;
+  std::condition_variable streams_changed_;
+  std::vector<std::weak_ptr<Stream>> streams_;
+  bool closed_;
+
+  // Only touched by the thread mixing.
+  std::vector<float> scratch_;
+};
+}  // namespace audio
+}  // namespace anbox
+
+#endif
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/audio/playback_buffer.h"
+
+#include <cstring>
+
+namespace anbox {
+namespace audio {
+constexpr std::uint32_t PlaybackBuffer::default_sample_rate;
+constexpr std::size_t PlaybackBuffer::default_frame_size;
+constexpr std::size_t PlaybackBuffer::default_period_frames;
+constexpr std::size_t PlaybackBuffer::default_buffer_frames;
+
+PlaybackBuffer::PlaybackBuffer(const Config &config, std::uint32_t sample_rate,
+                               std::size_t frame_size)
+    : sample_rate_(sample_rate),
+      frame_size_(frame_size),
+      ring_(config.buffer_frames * frame_size) {
+  config_.period_frames = config.period_frames;
+  config_.buffer_frames = ring_.capacity() / frame_size_;
+}
+
+bool PlaybackBuffer::write(const std::uint8_t *data, std::size_t size) {
+  if (ring_.capacity() - ring_.available() < size)
+    overruns_++;
+
+  return ring_.write(data, size) == size;
+}
+
+void PlaybackBuffer::read(std::uint8_t *buffer, std::size_t size) {
+  const auto count = ring_.read(buffer, size, false);
+  if (count < size) {
+    std::memset(buffer + count, 0, size - count);
+    // Running dry in the middle of a stream is audible, a guest which
+    // simply stopped playing isn't.
+    if (playing_ || count > 0)
+      underruns_++;
+  }
+  playing_ = count == size;
+}
+
+void PlaybackBuffer::close() {
+  ring_.close();
+}
+
+std::size_t PlaybackBuffer::buffered_frames() const {
+  return ring_.available() / frame_size_;
+}
+
+std::chrono::microseconds PlaybackBuffer::latency() const {
+  const auto frames = config_.buffer_frames + config_.period_frames;
+  return std::chrono::microseconds{frames * 1000000 / sample_rate_};
+}
+
+PlaybackBuffer::Statistics PlaybackBuffer::statistics() const {
+  return Statistics{underruns_.load(), overruns_.load()};
+}
+}  // namespace audio
+}  // namespace anbox
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_AUDIO_PLAYBACK_BUFFER_H_
+#define ANBOX_AUDIO_PLAYBACK_BUFFER_H_
+
+#include "anbox/graphics/ring_buffer.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace anbox {
+namespace audio {
+// Queues the PCM data a guest plays between the connection it arrives
+// on and the realtime callback of the audio device.
+//
+// Data goes through a lock-free ring so the device callback never waits
+// for the writer. A writer finding the ring full waits for room which
+// paces the guest to the device and keeps the latency bounded by the
+// buffer size.
+class PlaybackBuffer {
+ public:
+  // What the guest played before it could ask for anything else:
+  // 44.1 kHz, signed 16 bit, stereo.
+  static constexpr std::uint32_t default_sample_rate{44100};
+  static constexpr std::size_t default_frame_size{4};
+
+  static constexpr std::size_t default_period_frames{512};
+  static constexpr std::size_t default_buffer_frames{2048};
+
+  struct Config {
+    // Frames the audio device asks for at once.
+    std::size_t period_frames;
+    // Frames queued at most. Rounded up so that the buffer size in bytes
+    // is a power of two.
+    std::size_t buffer_frames;
+  };
+
+  struct Statistics {
+    // Device periods which ran out of data in the middle of a stream.
+    std::uint64_t underruns;
+    // Writes which had to wait for the device as the buffer was full.
+    std::uint64_t overruns;
+  };
+
+  // |frame_size| has to be a power of two, which all the formats we
+  // support have.
+  explicit PlaybackBuffer(const Config &config,
+                          std::uint32_t sample_rate = default_sample_rate,
+                          std::size_t frame_size = default_frame_size);
+
+  const Config &config() const { return config_; }
+  std::uint32_t sample_rate() const { return sample_rate_; }
+  std::size_t frame_size() const { return frame_size_; }
+
+  // Queues all of |size| bytes, waiting for room if needed. Returns false
+  // once the buffer was closed.
+  bool write(const std::uint8_t *data, std::size_t size);
+
+  // Fills |size| bytes of |buffer| without ever blocking. Whatever isn't
+  // queued yet is filled with silence.
+  void read(std::uint8_t *buffer, std::size_t size);
+
+  // Wakes up and fails a writer waiting for room.
+  void close();
+
+  std::size_t buffered_frames() const;
+
+  // Time it takes at most until queued data is played: a full buffer
+  // plus the period the device is currently playing.
+  std::chrono::microseconds latency() const;
+
+  Statistics statistics() const;
+
+ private:
+  Config config_;
+  std::uint32_t sample_rate_;
+  std::size_t frame_size_;
+  graphics::RingBuffer ring_;
+  // Only touched by the reader.
+  bool playing_ = false;
+  std::atomic<std::uint64_t> underruns_{0};
+  std::atomic<std::uint64_t> overruns_{0};
+};
+}  // namespace audio
+}  // namespace anbox
+
+#endif
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/audio/resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+constexpr float s16_scale{32768.0f};
+}  // namespace
+
+namespace anbox {
+namespace audio {
+Resampler::Resampler(const ClientInfo::Format &format, std::size_t channels,
+                     std::uint32_t in_rate, std::uint32_t out_rate)
+    : format_(format),
+      channels_(channels),
+      in_rate_(in_rate),
+      out_rate_(out_rate),
+      // Starts with a silent frame to interpolate the first one against.
+      in_(channels, 0.0f),
+      position_(0),
+      phase_(0) {}
+
+const std::vector<std::uint8_t> &Resampler::process(const std::uint8_t *data, std::size_t size) {
+  const auto sample_size = format_ == ClientInfo::Format::Float ? sizeof(float) : sizeof(std::int16_t);
+  const auto frames = size / (sample_size * channels_);
+  const auto total = frames + 1;
+
+  in_.resize(total * channels_);
+  load(data, frames * channels_);
+
+  std::size_t count = 0;
+  if (position_ + 1 < total) {
+    const auto remaining = static_cast<std::uint64_t>(total - 1 - position_);
+    count = static_cast<std::size_t>((remaining * out_rate_ + in_rate_ - 1) / in_rate_ + 1);
+  }
+  out_.resize(count * channels_);
+
+  std::size_t n = 0;
+  while (position_ + 1 < total) {
+    const auto t = static_cast<float>(phase_) / out_rate_;
+    const float *a = &in_[position_ * channels_];
+    const float *b = a + channels_;
+    float *out = &out_[n * channels_];
+    for (std::size_t c = 0; c < channels_; c++)
+      out[c] = a[c] + (b[c] - a[c]) * t;
+    n++;
+
+    phase_ += in_rate_;
+    position_ += phase_ / out_rate_;
+    phase_ %= out_rate_;
+  }
+
+  // The last frame is where the next call continues from.
+  position_ -= total - 1;
+  std::copy(in_.end() - channels_, in_.end(), in_.begin());
+
+  store(n * channels_);
+  return result_;
+}
+
+void Resampler::load(const std::uint8_t *data, std::size_t samples) {
+  auto in = in_.data() + channels_;
+  if (format_ == ClientInfo::Format::Float) {
+    std::memcpy(in, data, samples * sizeof(float));
+    return;
+  }
+
+  std::int16_t sample = 0;
+  for (std::size_t n = 0; n < samples; n++) {
+    std::memcpy(&sample, data + n * sizeof(sample), sizeof(sample));
+    in[n] = sample / s16_scale;
+  }
+}
+
+void Resampler::store(std::size_t samples) {
+  if (format_ == ClientInfo::Format::Float) {
+    result_.resize(samples * sizeof(float));
+    std::memcpy(result_.data(), out_.data(), result_.size());
+    return;
+  }
+
+  result_.resize(samples * sizeof(std::int16_t));
+  for (std::size_t n = 0; n < samples; n++) {
+    // Interpolating never leaves the range of the two input samples so
+    // this can't overflow.
+    const auto sample = static_cast<std::int16_t>(std::floor(out_[n] * s16_scale + 0.5f));
+    std::memcpy(result_.data() + n * sizeof(sample), &sample, sizeof(sample));
+  }
+}
+}  // namespace audio
+}  // namespace anbox
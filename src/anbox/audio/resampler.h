@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_AUDIO_RESAMPLER_H_
+#define ANBOX_AUDIO_RESAMPLER_H_
+
+#include "anbox/audio/client_info.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace anbox {
+namespace audio {
+// Converts a stream of interleaved frames from one sample rate to another
+// by linear interpolation.
+//
+// Only used when the audio device can't run at the rate the guest plays
+// at, so that the data gets resampled exactly once on its way. Frames of
+// one call are interpolated against the last one of the call before, so a
+// stream can be fed in pieces of any size.
+class Resampler {
+ public:
+  Resampler(const ClientInfo::Format &format, std::size_t channels,
+            std::uint32_t in_rate, std::uint32_t out_rate);
+
+  // Resamples |size| bytes of whole frames. The result stays valid until
+  // the next call.
+  const std::vector<std::uint8_t> &process(const std::uint8_t *data, std::size_t size);
+
+ private:
+  void load(const std::uint8_t *data, std::size_t samples);
+  void store(std::size_t samples);
+
+  const ClientInfo::Format format_;
+  const std::size_t channels_;
+  const std::uint32_t in_rate_;
+  const std::uint32_t out_rate_;
+
+  // The previous call's last frame followed by the current input.
+  std::vector<float> in_;
+  std::vector<float> out_;
+  std::vector<std::uint8_t> result_;
+
+  // Position of the next output frame in |in_|: the frame index plus a
+  // fraction in units of 1 / |out_rate_|. Kept as integers so it never
+  // drifts however long the stream is.
+  std::size_t position_;
+  std::uint32_t phase_;
+};
+}  // namespace audio
+}  // namespace anbox
+
+#endif
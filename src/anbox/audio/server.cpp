@@ -16,45 +16,189 @@
  */
 
 #include "anbox/audio/server.h"
+#include "anbox/audio/playback_buffer.h"
+#include "anbox/audio/shared_playback_ring.h"
 #include "anbox/audio/sink.h"
+#include "anbox/audio/source.h"
 #include "anbox/network/published_socket_connector.h"
 #include "anbox/network/delegate_connection_creator.h"
 #include "anbox/network/local_socket_messenger.h"
 #include "anbox/network/message_processor.h"
+#include "anbox/network/fd_socket_transmission.h"
+#include "anbox/network/handshake.h"
 #include "anbox/common/type_traits.h"
 #include "anbox/config.h"
 #include "anbox/utils.h"
 #include "anbox/logger.h"
 
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#include <unistd.h>
+
 using namespace std::placeholders;
 
 namespace {
+constexpr std::uint32_t min_sample_rate{8000};
+constexpr std::uint32_t max_sample_rate{192000};
+
+// Accepts every playback format the host can play natively and falls
+// back to the one all guests can produce otherwise.
+anbox::audio::ClientInfo negotiate_playback(const anbox::audio::ClientInfo &requested) {
+  using anbox::audio::ClientInfo;
+
+  const auto supported =
+      (requested.format == ClientInfo::Format::S16 ||
+       requested.format == ClientInfo::Format::Float) &&
+      (requested.channels == 1 || requested.channels == 2) &&
+      requested.sample_rate >= min_sample_rate &&
+      requested.sample_rate <= max_sample_rate;
+  if (supported)
+    return requested;
+
+  ClientInfo accepted = requested;
+  accepted.format = ClientInfo::Format::S16;
+  accepted.channels = 2;
+  accepted.sample_rate = anbox::audio::PlaybackBuffer::default_sample_rate;
+  return accepted;
+}
+
+// Microphones rarely deliver more than that, and the guest only records
+// S16.
+anbox::audio::ClientInfo negotiate_recording(const anbox::audio::ClientInfo &requested) {
+  using anbox::audio::ClientInfo;
+
+  const auto supported =
+      requested.format == ClientInfo::Format::S16 &&
+      (requested.channels == 1 || requested.channels == 2) &&
+      requested.sample_rate >= min_sample_rate &&
+      requested.sample_rate <= 48000;
+  if (supported)
+    return requested;
+
+  ClientInfo accepted = requested;
+  accepted.format = ClientInfo::Format::S16;
+  accepted.channels = 1;
+  accepted.sample_rate = min_sample_rate;
+  return accepted;
+}
+
 class AudioForwarder : public anbox::network::MessageProcessor {
  public:
   AudioForwarder(const std::shared_ptr<anbox::audio::Sink> &sink) :
     sink_(sink) {
   }
 
-  bool process_data(const std::vector<std::uint8_t> &data) override {
-    sink_->write_data(data);
+  bool process_data(const std::uint8_t *data, size_t size) override {
+    sink_->write_data(data, size);
+    return true;
+  }
+
+ private:
+  std::shared_ptr<anbox::audio::Sink> sink_;
+};
+
+// Plays what the client writes into shared memory. All the client sends
+// us are notifications that there is new data.
+class SharedAudioForwarder : public anbox::network::MessageProcessor {
+ public:
+  SharedAudioForwarder(const std::shared_ptr<anbox::audio::Sink> &sink,
+                       const std::shared_ptr<anbox::audio::SharedPlaybackRing> &ring,
+                       const std::shared_ptr<anbox::network::MessageSender> &sender) :
+    sink_(sink),
+    ring_(ring),
+    sender_(sender) {
+  }
+
+  bool process_data(const std::uint8_t *data, size_t size) override {
+    (void)data;
+    (void)size;
+
+    ring_->consume([&](const std::uint8_t *piece, size_t length) {
+      sink_->write_data(piece, length);
+    });
+
+    if (ring_->writer_waiting()) {
+      const auto read_pos = ring_->read_position();
+      sender_->send(reinterpret_cast<const char*>(&read_pos), sizeof(read_pos));
+    }
     return true;
   }
 
  private:
   std::shared_ptr<anbox::audio::Sink> sink_;
+  std::shared_ptr<anbox::audio::SharedPlaybackRing> ring_;
+  std::shared_ptr<anbox::network::MessageSender> sender_;
+};
+
+// Sends everything a source captures to the client in chunks of the
+// source's size. The client never sends anything but we still read from
+// it to notice when it goes away, which stops the recording.
+class AudioRecorder : public anbox::network::MessageProcessor {
+ public:
+  AudioRecorder(const std::shared_ptr<anbox::audio::Source> &source,
+                const std::shared_ptr<anbox::network::MessageSender> &sender) :
+    source_(source),
+    sender_(sender),
+    thread_(&AudioRecorder::run, this) {
+  }
+
+  ~AudioRecorder() {
+    source_->close();
+    thread_.join();
+  }
+
+  bool process_data(const std::uint8_t *data, size_t size) override {
+    (void)data;
+    (void)size;
+    return true;
+  }
+
+ private:
+  void run() {
+    std::vector<std::uint8_t> chunk;
+    try {
+      while (source_->read_data(chunk))
+        sender_->send(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+    } catch (const std::exception &err) {
+      DEBUG("Stopped recording: %s", err.what());
+    }
+  }
+
+  std::shared_ptr<anbox::audio::Source> source_;
+  std::shared_ptr<anbox::network::MessageSender> sender_;
+  std::thread thread_;
 };
+
+anbox::audio::StreamInfo stream_info(const std::chrono::microseconds &latency, size_t period_size) {
+  return anbox::audio::StreamInfo{
+      static_cast<std::uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(latency).count()),
+      static_cast<std::uint32_t>(period_size)};
+}
 }
 
 namespace anbox {
 namespace audio {
-Server::Server(const std::shared_ptr<Runtime>& rt, const std::shared_ptr<platform::Policy> &platform_policy) :
+Server::Server(const std::shared_ptr<Runtime>& rt, const std::shared_ptr<platform::Policy> &platform_policy,
+               bool shared_memory, const Fd &socket) :
+  runtime_(rt),
   platform_policy_(platform_policy),
+  shared_memory_(shared_memory),
   socket_file_(utils::string_format("%s/anbox_audio", SystemConfiguration::instance().socket_dir())),
-  connector_(std::make_shared<network::PublishedSocketConnector>(
-             socket_file_, rt,
-             std::make_shared<network::DelegateConnectionCreator<boost::asio::local::stream_protocol>>(std::bind(&Server::create_connection_for, this, _1)))),
   connections_(std::make_shared<network::Connections<network::SocketConnection>>()),
   next_id_(0) {
+  const auto connection_creator =
+      std::make_shared<network::DelegateConnectionCreator<boost::asio::local::stream_protocol>>(
+          std::bind(&Server::create_connection_for, this, _1));
+  if (socket != Fd::invalid)
+    connector_ = std::make_shared<network::PublishedSocketConnector>(socket, socket_file_, rt,
+                                                                     connection_creator,
+                                                                     Runtime::Subsystem::Audio);
+  else
+    connector_ = std::make_shared<network::PublishedSocketConnector>(socket_file_, rt,
+                                                                     connection_creator,
+                                                                     Runtime::Subsystem::Audio);
 
   // FIXME: currently creating the socket creates it with the rights of
   // the user we're running as. As this one is mapped into the container
@@ -63,40 +207,106 @@ Server::Server(const std::shared_ptr<Runtime>& rt, const std::shared_ptr<platfor
 
 Server::~Server() {}
 
+Fd Server::socket() const {
+  return connector_->socket();
+}
+
 void Server::create_connection_for(std::shared_ptr<boost::asio::basic_stream_socket<boost::asio::local::stream_protocol>> const& socket) {
+  // We have to read the client info first before we can continue
+  // processing the actual commands. It's read asynchronously so that a
+  // client which is slow to send it doesn't hold up the runtime.
+  network::Handshake::read(
+      runtime_->service(), socket, sizeof(ClientInfo),
+      [this, socket](const boost::system::error_code &err, const std::string &data,
+                     const std::vector<Fd> &) {
+        if (err) {
+          ERROR("Failed to read client info: %s", err.message());
+          return;
+        }
+
+        ClientInfo client_info;
+        std::memcpy(&client_info, data.data(), sizeof(client_info));
+        setup_connection(socket, client_info);
+      });
+}
+
+void Server::setup_connection(std::shared_ptr<boost::asio::basic_stream_socket<boost::asio::local::stream_protocol>> const& socket,
+                              ClientInfo client_info) {
   auto const messenger =
       std::make_shared<network::LocalSocketMessenger>(socket);
 
-  // We have to read the client flags first before we can continue
-  // processing the actual commands
-  ClientInfo client_info;
-  auto err = messenger->receive_msg(
-      boost::asio::buffer(&client_info, sizeof(ClientInfo)));
-  if (err) {
-    ERROR("Failed to read client info: %s", err.message());
-    return;
-  }
-
+  // Clients we can't serve see the connection being closed.
   std::shared_ptr<network::MessageProcessor> processor;
+  // Lets the client report our latency to its users and write or read in
+  // chunks we handle without waiting.
+  StreamInfo info{0, 0};
+  std::shared_ptr<SharedPlaybackRing> ring;
 
   switch (client_info.type) {
-  case ClientInfo::Type::Playback:
-    processor = std::make_shared<AudioForwarder>(platform_policy_->create_audio_sink());
+  case ClientInfo::Type::Playback: {
+    client_info = negotiate_playback(client_info);
+    auto sink = platform_policy_->create_audio_sink(client_info);
+    if (!sink) {
+      WARNING("No audio sink available, rejecting playback client");
+      return;
+    }
+    info = stream_info(sink->latency(), sink->period_size());
+
+    if (shared_memory_ && (client_info.flags & ClientInfo::SharedMemory)) {
+      try {
+        // Room for two periods so the client can write the next one
+        // while we still forward the last one.
+        ring = std::make_shared<SharedPlaybackRing>(std::max<size_t>(4096, 2 * sink->period_size()));
+        info.latency_ms += static_cast<std::uint32_t>(
+            ring->size() * 1000 / (client_info.frame_size() * client_info.sample_rate));
+      } catch (const std::exception &err) {
+        WARNING("Falling back to send audio over the socket: %s", err.what());
+      }
+    }
+    client_info.flags = ring ? ClientInfo::SharedMemory : 0;
+
+    if (ring)
+      processor = std::make_shared<SharedAudioForwarder>(sink, ring, messenger);
+    else
+      processor = std::make_shared<AudioForwarder>(sink);
     break;
-  case ClientInfo::Type::Recording:
+  }
+  case ClientInfo::Type::Recording: {
+    client_info = negotiate_recording(client_info);
+    client_info.flags = 0;
+    auto source = platform_policy_->create_audio_source(client_info);
+    if (!source) {
+      WARNING("No audio source available, rejecting recording client");
+      return;
+    }
+    info = stream_info(source->latency(), source->chunk_size());
+    processor = std::make_shared<AudioRecorder>(source, messenger);
     break;
+  }
   default:
     ERROR("Invalid client type %d", static_cast<int>(client_info.type));
     return;
   }
 
-  // Everything ok, so approve the client by sending the requesting client
-  // info back. Once we have more things to negotiate we will send a modified
-  // client info struct back.
+  // Everything ok, so approve the client by sending the client info back
+  // with the format we accepted. A client which asked for something else
+  // has to reconnect with that one.
   messenger->send(reinterpret_cast<char*>(&client_info), sizeof(client_info));
+  messenger->send(reinterpret_cast<char*>(&info), sizeof(info));
+
+  if (ring) {
+    try {
+      send_fds(Fd{::dup(socket->native_handle())}, {ring->fd()});
+    } catch (const std::exception &err) {
+      ERROR("Failed to pass shared audio memory: %s", err.what());
+      return;
+    }
+  }
 
   auto connection = std::make_shared<network::SocketConnection>(
         messenger, messenger, next_id(), connections_, processor);
+  connection->set_name("audio");
+  connection->set_handler_statistics(runtime_->handler_statistics());
   connections_->add(connection);
 
   connection->read_next_message();
@@ -20,6 +20,7 @@
 
 #include "anbox/runtime.h"
 #include "anbox/audio/client_info.h"
+#include "anbox/common/fd.h"
 #include "anbox/network/socket_messenger.h"
 #include "anbox/network/socket_connection.h"
 #include "anbox/platform/policy.h"
@@ -33,18 +34,29 @@ class PublishedSocketConnector;
 namespace audio {
 class Server {
  public:
-  Server(const std::shared_ptr<Runtime>& rt, const std::shared_ptr<platform::Policy> &platform_policy);
+  // With |shared_memory| playback clients asking for it get their data
+  // to us through shared memory instead of the socket. A valid |socket|
+  // already listens on our socket file and is accepted on instead.
+  Server(const std::shared_ptr<Runtime>& rt, const std::shared_ptr<platform::Policy> &platform_policy,
+         bool shared_memory = false, const Fd &socket = Fd{});
   ~Server();
 
   std::string socket_file() const { return socket_file_; }
+  // A copy of the socket we accept on.
+  Fd socket() const;
 
  private:
   void create_connection_for(std::shared_ptr<boost::asio::basic_stream_socket<
                              boost::asio::local::stream_protocol>> const& socket);
+  void setup_connection(std::shared_ptr<boost::asio::basic_stream_socket<
+                        boost::asio::local::stream_protocol>> const& socket,
+                        ClientInfo client_info);
 
   int next_id();
 
+  std::shared_ptr<Runtime> runtime_;
   std::shared_ptr<platform::Policy> platform_policy_;
+  bool shared_memory_;
   std::string socket_file_;
   std::shared_ptr<network::PublishedSocketConnector> connector_;
   std::shared_ptr<network::Connections<network::SocketConnection>> const connections_;
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/audio/shared_playback_ring.h"
+
+#include <boost/throw_exception.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+std::size_t next_power_of_two(std::size_t value) {
+  std::size_t result = 1;
+  while (result < value) result <<= 1;
+  return result;
+}
+
+int create_memfd(const char *name) {
+  // Not every libc we build against wraps it yet.
+  return static_cast<int>(::syscall(__NR_memfd_create, name, 0));
+}
+}  // namespace
+
+namespace anbox {
+namespace audio {
+SharedPlaybackRing::SharedPlaybackRing(std::size_t size)
+    : size_(next_power_of_two(size)),
+      mapped_size_(sizeof(SharedRing) + size_),
+      ring_(nullptr) {
+  const auto fd = create_memfd("anbox-audio");
+  if (fd < 0)
+    BOOST_THROW_EXCEPTION(std::runtime_error("Failed to create shared audio memory: " +
+                                             std::string(std::strerror(errno))));
+  fd_ = Fd{fd};
+
+  if (::ftruncate(fd_, static_cast<off_t>(mapped_size_)) != 0)
+    BOOST_THROW_EXCEPTION(std::runtime_error("Failed to size shared audio memory: " +
+                                             std::string(std::strerror(errno))));
+
+  auto addr = ::mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (addr == MAP_FAILED)
+    BOOST_THROW_EXCEPTION(std::runtime_error("Failed to map shared audio memory: " +
+                                             std::string(std::strerror(errno))));
+
+  // A new memfd is all zeros, which is an empty ring already.
+  ring_ = static_cast<SharedRing *>(addr);
+  ring_->size = static_cast<std::uint32_t>(size_);
+}
+
+SharedPlaybackRing::~SharedPlaybackRing() {
+  ::munmap(ring_, mapped_size_);
+}
+
+std::size_t SharedPlaybackRing::available() const {
+  const auto available = ring_->write_pos.load() - ring_->read_pos.load(std::memory_order_relaxed);
+  return std::min<std::size_t>(available, size_);
+}
+
+std::size_t SharedPlaybackRing::consume(
+    const std::function<void(const std::uint8_t *, std::size_t)> &consumer) {
+  auto count = available();
+  std::size_t consumed = 0;
+  while (count > 0) {
+    const auto read_pos = ring_->read_pos.load(std::memory_order_relaxed);
+    const auto offset = read_pos & (size_ - 1);
+    const auto chunk = std::min(count, size_ - offset);
+    consumer(ring_->data() + offset, chunk);
+    ring_->read_pos.store(read_pos + static_cast<std::uint32_t>(chunk));
+    count -= chunk;
+    consumed += chunk;
+  }
+  return consumed;
+}
+
+std::uint32_t SharedPlaybackRing::read_position() const {
+  return ring_->read_pos.load();
+}
+
+bool SharedPlaybackRing::writer_waiting() const {
+  return ring_->writer_waiting.load() != 0;
+}
+}  // namespace audio
+}  // namespace anbox
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_AUDIO_SHARED_PLAYBACK_RING_H_
+#define ANBOX_AUDIO_SHARED_PLAYBACK_RING_H_
+
+#include "anbox/audio/client_info.h"
+#include "anbox/common/fd.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace anbox {
+namespace audio {
+// The server side of a SharedRing: creates the memory in a memfd which
+// is passed to the client and reads what the client writes into it.
+//
+// Nothing the client wrote into the shared memory is trusted, positions
+// pointing outside of the data are clamped.
+class SharedPlaybackRing {
+ public:
+  // Room for |size| bytes, rounded up to a power of two. Throws
+  // std::runtime_error if the memory can't be created.
+  explicit SharedPlaybackRing(std::size_t size);
+  ~SharedPlaybackRing();
+
+  SharedPlaybackRing(const SharedPlaybackRing &) = delete;
+  SharedPlaybackRing &operator=(const SharedPlaybackRing &) = delete;
+
+  const Fd &fd() const { return fd_; }
+  std::size_t size() const { return size_; }
+
+  // Number of bytes the client wrote which weren't consumed yet.
+  std::size_t available() const;
+
+  // Hands everything the client wrote so far to |consumer|, in at most
+  // two contiguous pieces, each released once |consumer| returns.
+  // Returns the number of bytes consumed.
+  std::size_t consume(const std::function<void(const std::uint8_t *, std::size_t)> &consumer);
+
+  std::uint32_t read_position() const;
+  bool writer_waiting() const;
+
+ private:
+  Fd fd_;
+  std::size_t size_;
+  std::size_t mapped_size_;
+  SharedRing *ring_;
+};
+}  // namespace audio
+}  // namespace anbox
+
+#endif
@@ -18,16 +18,24 @@
 #ifndef ANBOX_AUDIO_SINK_H_
 #define ANBOX_AUDIO_SINK_H_
 
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
 
-#include <vector>
-
 namespace anbox {
 namespace audio {
 class Sink {
  public:
   virtual ~Sink() {}
-  virtual void write_data(const std::vector<std::uint8_t> &data) = 0;
+  virtual void write_data(const std::uint8_t *data, size_t size) = 0;
+
+  // Time from writing data until it is played at most, zero if unknown.
+  virtual std::chrono::microseconds latency() const {
+    return std::chrono::microseconds{0};
+  }
+
+  // Bytes the sink consumes at once, zero if it doesn't care.
+  virtual size_t period_size() const { return 0; }
 };
 } // namespace audio
 } // namespace anbox
@@ -18,6 +18,8 @@
 #ifndef ANBOX_AUDIO_SOURCE_H_
 #define ANBOX_AUDIO_SOURCE_H_
 
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
 
 #include <vector>
@@ -28,7 +30,20 @@ class Source {
  public:
   virtual ~Source() {}
 
-  virtual void read_data(std::vector<std::uint8_t> &data) = 0;
+  // Blocks until |data| holds the next chunk of captured data. Returns
+  // false once the source was closed.
+  virtual bool read_data(std::vector<std::uint8_t> &data) = 0;
+
+  // Wakes up and fails a reader waiting for data.
+  virtual void close() = 0;
+
+  // Time from capturing data until it is read at most, zero if unknown.
+  virtual std::chrono::microseconds latency() const {
+    return std::chrono::microseconds{0};
+  }
+
+  // Bytes read_data returns at once.
+  virtual size_t chunk_size() const = 0;
 };
 } // namespace audio
 } // namespace anbox
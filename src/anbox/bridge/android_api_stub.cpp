@@ -19,6 +19,7 @@
 #include "anbox/config.h"
 #include "anbox/logger.h"
 #include "anbox/rpc/channel.h"
+#include "anbox/runtime.h"
 #include "anbox/utils.h"
 #include "anbox/wm/stack.h"
 
@@ -27,11 +28,21 @@
 
 #include <boost/filesystem.hpp>
 
+#include <algorithm>
+#include <future>
+
 namespace fs = boost::filesystem;
 
+namespace {
+// Android answers all of our calls right away so if we don't hear back
+// within this time something went wrong and we shouldn't block forever.
+constexpr const std::chrono::seconds call_timeout{10};
+}
+
 namespace anbox {
 namespace bridge {
-AndroidApiStub::AndroidApiStub() {}
+AndroidApiStub::AndroidApiStub(const std::shared_ptr<Runtime> &rt)
+    : expiry_timer_(rt->service()) {}
 
 AndroidApiStub::~AndroidApiStub() {}
 
@@ -42,23 +53,149 @@ void AndroidApiStub::set_rpc_channel(
 
 void AndroidApiStub::reset_rpc_channel() { channel_.reset(); }
 
-void AndroidApiStub::ensure_rpc_channel() {
-  if (!channel_) throw std::runtime_error("No remote client connected");
+void AndroidApiStub::call(const std::string &method,
+                          const google::protobuf::MessageLite &message,
+                          const Completion &done) {
+  auto response = std::make_shared<protobuf::rpc::Void>();
+  call(method, message, response, [response]() {
+    return response->has_error() ? response->error() : std::string();
+  }, done);
 }
 
-void AndroidApiStub::launch(const android::Intent &intent,
-                            const graphics::Rect &launch_bounds,
-                            const wm::Stack::Id &stack) {
-  ensure_rpc_channel();
+void AndroidApiStub::call(const std::string &method,
+                          const google::protobuf::MessageLite &message,
+                          const std::shared_ptr<google::protobuf::MessageLite> &response,
+                          const std::function<std::string()> &error,
+                          const Completion &done) {
+  if (!channel_) {
+    done("No remote client connected");
+    return;
+  }
 
-  auto c = std::make_shared<Request<protobuf::rpc::Void>>();
-  protobuf::bridge::LaunchApplication message;
+  expire_calls();
+
+  auto c = std::make_shared<PendingCall>();
+  c->response = response;
+  c->error = error;
+  c->method = method;
+  c->done = done;
+  c->deadline = std::chrono::steady_clock::now() + call_timeout;
+
+  // The closure holds on to the call until it ran or got cancelled. The
+  // reply can arrive before we know the id of the call.
+  const auto call_id = channel_->call_method(
+      method, &message, c->response.get(),
+      google::protobuf::NewCallback(this, &AndroidApiStub::call_completed, c));
+
+  std::lock_guard<decltype(mutex_)> lock(mutex_);
+  c->id = call_id;
+  if (!c->finished) {
+    in_flight_.push_back(c);
+    schedule_expiry_locked();
+  }
+}
 
+void AndroidApiStub::call_completed(std::shared_ptr<PendingCall> call) {
+  finish(call, call->error());
+}
+
+void AndroidApiStub::finish(const std::shared_ptr<PendingCall> &call, const std::string &error) {
+  {
+    std::lock_guard<decltype(mutex_)> lock(mutex_);
+    if (call->finished)
+      return;
+    call->finished = true;
+    in_flight_.erase(std::remove(in_flight_.begin(), in_flight_.end(), call), in_flight_.end());
+  }
+
+  if (call->done)
+    call->done(error);
+}
+
+void AndroidApiStub::expire_calls() {
+  const auto now = std::chrono::steady_clock::now();
+
+  std::vector<std::shared_ptr<PendingCall>> expired;
   {
     std::lock_guard<decltype(mutex_)> lock(mutex_);
-    launch_wait_handle_.expect_result();
+    for (const auto &c : in_flight_) {
+      if (c->deadline <= now)
+        expired.push_back(c);
+    }
   }
 
+  // Android answers all of our calls right away, so whatever is left
+  // behind here won't ever be answered. A call we fail to cancel is being
+  // completed right now. Without a channel nothing will complete them.
+  for (const auto &c : expired) {
+    if (!channel_ || channel_->cancel_call(c->id))
+      finish(c, utils::string_format("Timed out waiting for %s to complete", c->method));
+  }
+}
+
+void AndroidApiStub::schedule_expiry_locked() {
+  if (expiry_scheduled_ || in_flight_.empty())
+    return;
+
+  auto deadline = in_flight_.front()->deadline;
+  for (const auto &c : in_flight_)
+    deadline = std::min(deadline, c->deadline);
+  const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+      deadline - std::chrono::steady_clock::now());
+
+  // Nobody might ever call us again, so the timer is what cancels calls
+  // Android left unanswered.
+  auto wp = std::weak_ptr<AndroidApiStub>(shared_from_this());
+  expiry_timer_.expires_from_now(
+      boost::posix_time::milliseconds(std::max<std::int64_t>(wait.count(), 0)));
+  expiry_timer_.async_wait([wp](const boost::system::error_code &err) {
+    if (auto stub = wp.lock())
+      stub->on_expiry(err);
+  });
+  expiry_scheduled_ = true;
+}
+
+void AndroidApiStub::on_expiry(const boost::system::error_code &err) {
+  {
+    std::lock_guard<decltype(mutex_)> lock(mutex_);
+    expiry_scheduled_ = false;
+  }
+  if (err)
+    return;
+
+  expire_calls();
+
+  // Calls which went on after the timer was armed are due later.
+  std::lock_guard<decltype(mutex_)> lock(mutex_);
+  schedule_expiry_locked();
+}
+
+void AndroidApiStub::wait_for(const std::function<void(const Completion &)> &start) {
+  auto result = std::make_shared<std::promise<std::string>>();
+  auto error = result->get_future();
+  start([result](const std::string &e) { result->set_value(e); });
+
+  if (error.wait_for(call_timeout) != std::future_status::ready) {
+    expire_calls();
+    error.wait();
+  }
+
+  const auto message = error.get();
+  if (!message.empty()) throw std::runtime_error(message);
+}
+
+void AndroidApiStub::launch(const android::Intent &intent,
+                            const graphics::Rect &launch_bounds,
+                            const wm::Stack::Id &stack) {
+  wait_for([&](const Completion &done) { launch_async(intent, launch_bounds, stack, done); });
+}
+
+void AndroidApiStub::launch_async(const android::Intent &intent,
+                                  const graphics::Rect &launch_bounds,
+                                  const wm::Stack::Id &stack,
+                                  const Completion &done) {
+  protobuf::bridge::LaunchApplication message;
+
   switch (stack) {
   case wm::Stack::Id::Default:
     message.set_stack(::anbox::protobuf::bridge::LaunchApplication_Stack_DEFAULT);
@@ -75,10 +212,10 @@ void AndroidApiStub::launch(const android::Intent &intent,
 
   if (launch_bounds != graphics::Rect::Invalid) {
     auto rect = message.mutable_launch_bounds();
-    rect->set_left(launch_bounds_.left());
-    rect->set_top(launch_bounds_.top());
-    rect->set_right(launch_bounds_.right());
-    rect->set_bottom(launch_bounds_.bottom());
+    rect->set_left(launch_bounds.left());
+    rect->set_top(launch_bounds.top());
+    rect->set_right(launch_bounds.right());
+    rect->set_bottom(launch_bounds.bottom());
   }
 
   auto launch_intent = message.mutable_intent();
@@ -98,87 +235,82 @@ void AndroidApiStub::launch(const android::Intent &intent,
     *c = category;
   }
 
-  channel_->call_method(
-      "launch_application", &message, c->response.get(),
-      google::protobuf::NewCallback(this, &AndroidApiStub::application_launched,
-                                    c.get()));
-
-  launch_wait_handle_.wait_for_all();
-
-  if (c->response->has_error()) throw std::runtime_error(c->response->error());
+  call("launch_application", message, done);
 }
 
 core::Property<bool>& AndroidApiStub::ready() {
   return ready_;
 }
 
-void AndroidApiStub::application_launched(
-    Request<protobuf::rpc::Void> *request) {
-  (void)request;
-  launch_wait_handle_.result_received();
-}
-
 void AndroidApiStub::set_focused_task(const std::int32_t &id) {
-  ensure_rpc_channel();
-
-  auto c = std::make_shared<Request<protobuf::rpc::Void>>();
+  wait_for([&](const Completion &done) { set_focused_task_async(id, done); });
+}
 
+void AndroidApiStub::set_focused_task_async(const std::int32_t &id, const Completion &done) {
   protobuf::bridge::SetFocusedTask message;
   message.set_id(id);
-
-  {
-    std::lock_guard<decltype(mutex_)> lock(mutex_);
-    set_focused_task_handle_.expect_result();
-  }
-
-  channel_->call_method("set_focused_task", &message, c->response.get(),
-                        google::protobuf::NewCallback(
-                            this, &AndroidApiStub::focused_task_set, c.get()));
-
-  set_focused_task_handle_.wait_for_all();
-
-  if (c->response->has_error()) throw std::runtime_error(c->response->error());
-}
-
-void AndroidApiStub::focused_task_set(Request<protobuf::rpc::Void> *request) {
-  (void)request;
-  set_focused_task_handle_.result_received();
+  call("set_focused_task", message, done);
 }
 
 void AndroidApiStub::remove_task(const std::int32_t &id) {
-  ensure_rpc_channel();
-
-  auto c = std::make_shared<Request<protobuf::rpc::Void>>();
+  wait_for([&](const Completion &done) { remove_task_async(id, done); });
+}
 
+void AndroidApiStub::remove_task_async(const std::int32_t &id, const Completion &done) {
   protobuf::bridge::RemoveTask message;
   message.set_id(id);
+  call("remove_task", message, done);
+}
 
-  {
-    std::lock_guard<decltype(mutex_)> lock(mutex_);
-    remove_task_handle_.expect_result();
-  }
-
-  channel_->call_method("remove_task", &message, c->response.get(),
-                        google::protobuf::NewCallback(
-                            this, &AndroidApiStub::task_removed, c.get()));
+void AndroidApiStub::clipboard_changed_async(const Completion &done) {
+  protobuf::rpc::Void message;
+  call("clipboard_changed", message, done);
+}
 
-  remove_task_handle_.wait_for_all();
+void AndroidApiStub::set_display_metrics_async(const std::int32_t &width,
+                                               const std::int32_t &height,
+                                               const std::int32_t &density,
+                                               const Completion &done) {
+  protobuf::bridge::SetDisplayMetrics message;
+  message.set_width(width);
+  message.set_height(height);
+  message.set_density(density);
+  call("set_display_metrics", message, done);
+}
 
-  if (c->response->has_error()) throw std::runtime_error(c->response->error());
+void AndroidApiStub::set_frame_statistics_reporting_async(bool enabled, const Completion &done) {
+  protobuf::bridge::SetFrameStatisticsReporting message;
+  message.set_enabled(enabled);
+  call("set_frame_statistics_reporting", message, done);
 }
 
-void AndroidApiStub::task_removed(Request<protobuf::rpc::Void> *request) {
-  (void)request;
-  remove_task_handle_.result_received();
+void AndroidApiStub::get_application_icons_async(const std::vector<std::string> &hashes,
+                                                 const std::function<void(const Icons &icons)> &done) {
+  protobuf::bridge::ApplicationIconsRequest message;
+  for (const auto &hash : hashes)
+    message.add_hashes(hash);
+
+  auto response = std::make_shared<protobuf::bridge::ApplicationIcons>();
+  call("get_application_icons", message, response, [response]() {
+         return response->has_error() ? response->error() : std::string();
+       },
+       [response, done](const std::string &error) {
+    Icons icons;
+    if (!error.empty()) {
+      WARNING("Failed to get application icons: %s", error);
+    } else {
+      for (int n = 0; n < response->icons_size(); n++) {
+        const auto &icon = response->icons(n);
+        icons[icon.hash()] = std::vector<char>(icon.data().begin(), icon.data().end());
+      }
+    }
+    done(icons);
+  });
 }
 
 void AndroidApiStub::resize_task(const std::int32_t &id,
                                  const anbox::graphics::Rect &rect,
                                  const std::int32_t &resize_mode) {
-  ensure_rpc_channel();
-
-  auto c = std::make_shared<Request<protobuf::rpc::Void>>();
-
   protobuf::bridge::ResizeTask message;
   message.set_id(id);
   message.set_resize_mode(resize_mode);
@@ -189,23 +321,10 @@ void AndroidApiStub::resize_task(const std::int32_t &id,
   r->set_right(rect.right());
   r->set_bottom(rect.bottom());
 
-  {
-    std::lock_guard<decltype(mutex_)> lock(mutex_);
-    resize_task_handle_.expect_result();
-  }
-
-  channel_->call_method("resize_task", &message, c->response.get(),
-                        google::protobuf::NewCallback(
-                            this, &AndroidApiStub::task_resized, c.get()));
-
-  resize_task_handle_.wait_for_all();
-
-  if (c->response->has_error()) throw std::runtime_error(c->response->error());
-}
-
-void AndroidApiStub::task_resized(Request<protobuf::rpc::Void> *request) {
-  (void)request;
-  resize_task_handle_.result_received();
+  call("resize_task", message, [](const std::string &error) {
+    if (!error.empty())
+      WARNING("Failed to resize task: %s", error);
+  });
 }
 }  // namespace bridge
 }  // namespace anbox
@@ -19,63 +19,119 @@
 #define ANBOX_BRIDGE_ANDROID_API_STUB_H_
 
 #include "anbox/application/manager.h"
-#include "anbox/common/wait_handle.h"
 #include "anbox/graphics/rect.h"
 
+#include <boost/asio/deadline_timer.hpp>
+
+#include <chrono>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 
+namespace google {
+namespace protobuf {
+class MessageLite;
+}  // namespace protobuf
+}  // namespace google
+
 namespace anbox {
+class Runtime;
 namespace protobuf {
 namespace rpc {
 class Void;
-}  // namespace bridge
+}  // namespace rpc
 }  // namespace protobuf
 namespace rpc {
 class Channel;
 }  // namespace rpc
 namespace bridge {
-class AndroidApiStub : public anbox::application::Manager {
+class AndroidApiStub : public anbox::application::Manager,
+                       public std::enable_shared_from_this<AndroidApiStub> {
  public:
-  AndroidApiStub();
+  // Calls Android doesn't answer in time are cancelled on |rt|.
+  explicit AndroidApiStub(const std::shared_ptr<Runtime> &rt);
   ~AndroidApiStub();
 
   void set_rpc_channel(const std::shared_ptr<rpc::Channel> &channel);
   void reset_rpc_channel();
 
+  // The blocking calls give up after a while and throw when the call
+  // failed. The asynchronous ones report the outcome to |done| once Android
+  // answered, the call timed out or the channel went away.
   void set_focused_task(const std::int32_t &id);
+  void set_focused_task_async(const std::int32_t &id, const Completion &done);
   void remove_task(const std::int32_t &id);
+  void remove_task_async(const std::int32_t &id, const Completion &done);
+  // Icons Android has for the given hashes. Those it doesn't know are left
+  // out, on failure none are given.
+  typedef std::map<std::string, std::vector<char>> Icons;
+  void get_application_icons_async(const std::vector<std::string> &hashes,
+                                   const std::function<void(const Icons &icons)> &done);
+  // Tells Android to fetch the clipboard again the next time it needs it.
+  void clipboard_changed_async(const Completion &done);
+  // Doesn't wait for Android to apply the new size, see wm::TaskResizer.
   void resize_task(const std::int32_t &id, const anbox::graphics::Rect &rect,
                    const std::int32_t &resize_mode);
 
+  // Lets Android render at a different resolution and density than it had
+  // at boot, which are restored when all of them are zero. The display
+  // keeps its size, everything is scaled to it.
+  void set_display_metrics_async(const std::int32_t &width, const std::int32_t &height,
+                                 const std::int32_t &density, const Completion &done);
+
+  // Lets Android report the frame statistics of its apps, see
+  // bridge::GuestFrameStatistics. It doesn't collect them otherwise.
+  void set_frame_statistics_reporting_async(bool enabled, const Completion &done);
+
   void launch(const android::Intent &intent,
               const graphics::Rect &launch_bounds = graphics::Rect::Invalid,
               const wm::Stack::Id &stack = wm::Stack::Id::Default) override;
+  void launch_async(const android::Intent &intent,
+                    const graphics::Rect &launch_bounds,
+                    const wm::Stack::Id &stack,
+                    const Completion &done) override;
 
   core::Property<bool>& ready() override;
 
  private:
-  void ensure_rpc_channel();
-
-  template <typename Response>
-  struct Request {
-    Request() : response(std::make_shared<Response>()), success(true) {}
-    std::shared_ptr<Response> response;
-    bool success;
+  struct PendingCall {
+    std::shared_ptr<google::protobuf::MessageLite> response;
+    // Extracts the error from the response.
+    std::function<std::string()> error;
+    std::string method;
+    Completion done;
+    std::uint32_t id = 0;
+    bool finished = false;
+    std::chrono::steady_clock::time_point deadline;
   };
 
-  void application_launched(Request<protobuf::rpc::Void> *request);
-  void focused_task_set(Request<protobuf::rpc::Void> *request);
-  void task_removed(Request<protobuf::rpc::Void> *request);
-  void task_resized(Request<protobuf::rpc::Void> *request);
+  void call(const std::string &method,
+            const google::protobuf::MessageLite &message,
+            const Completion &done);
+  void call(const std::string &method,
+            const google::protobuf::MessageLite &message,
+            const std::shared_ptr<google::protobuf::MessageLite> &response,
+            const std::function<std::string()> &error,
+            const Completion &done);
+  void call_completed(std::shared_ptr<PendingCall> call);
+  void finish(const std::shared_ptr<PendingCall> &call, const std::string &error);
+  // Cancels all calls which are past their deadline.
+  void expire_calls();
+  // Arms expiry_timer_ for the earliest deadline of the calls in flight
+  // unless it is armed already. Needs mutex_ to be held.
+  void schedule_expiry_locked();
+  void on_expiry(const boost::system::error_code &err);
+  // Runs an asynchronous call and blocks until it completed.
+  void wait_for(const std::function<void(const Completion &)> &start);
 
   mutable std::mutex mutex_;
   std::shared_ptr<rpc::Channel> channel_;
-  common::WaitHandle launch_wait_handle_;
-  common::WaitHandle set_focused_task_handle_;
-  common::WaitHandle remove_task_handle_;
-  common::WaitHandle resize_task_handle_;
-  graphics::Rect launch_bounds_ = graphics::Rect::Invalid;
+  std::vector<std::shared_ptr<PendingCall>> in_flight_;
+  boost::asio::deadline_timer expiry_timer_;
+  bool expiry_scheduled_ = false;
   core::Property<bool> ready_;
 };
 }  // namespace bridge
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/bridge/guest_frame_statistics.h"
+
+#include "anbox_bridge.pb.h"
+
+#include <sstream>
+
+namespace {
+constexpr const char *process_header{"** Graphics info for pid "};
+
+bool starts_with(const std::string &line, const std::string &prefix) {
+  return line.compare(0, prefix.size(), prefix) == 0;
+}
+
+// Reads the number following |prefix|, ignoring units or percentages
+// after it.
+template<typename T>
+bool read_value(const std::string &line, const std::string &prefix, T &value) {
+  if (!starts_with(line, prefix))
+    return false;
+  std::istringstream in(line.substr(prefix.size()));
+  in >> value;
+  return true;
+}
+
+std::uint64_t since(std::uint64_t now, std::uint64_t before) {
+  return now >= before ? now - before : now;
+}
+}  // namespace
+
+namespace anbox {
+namespace bridge {
+std::map<int, GuestFrameStatistics::Process> GuestFrameStatistics::parse(const std::string &gfxinfo) {
+  std::map<int, Process> processes;
+  Process *process = nullptr;
+
+  std::istringstream in(gfxinfo);
+  std::string line;
+  while (std::getline(in, line)) {
+    const auto start = line.find_first_not_of(' ');
+    if (start == std::string::npos)
+      continue;
+    line.erase(0, start);
+
+    // ** Graphics info for pid 1234 [com.example.app] **
+    if (starts_with(line, process_header)) {
+      std::istringstream header(line.substr(std::string(process_header).size()));
+      int pid = 0;
+      std::string package;
+      if (!(header >> pid >> package) || package.size() < 2) {
+        process = nullptr;
+        continue;
+      }
+      process = &processes[pid];
+      process->package = package.substr(1, package.size() - 2);
+      process->frame_times.package = process->package;
+      continue;
+    }
+    if (!process)
+      continue;
+
+    auto &c = process->counters;
+    auto &t = process->frame_times;
+    read_value(line, "Total frames rendered: ", c.frames) ||
+        read_value(line, "Janky frames: ", c.janky_frames) ||
+        read_value(line, "Number Missed Vsync: ", c.missed_vsync) ||
+        read_value(line, "Number High input latency: ", c.high_input_latency) ||
+        read_value(line, "Number Slow UI thread: ", c.slow_ui_thread) ||
+        read_value(line, "Number Slow bitmap uploads: ", c.slow_bitmap_uploads) ||
+        read_value(line, "Number Slow issue draw commands: ", c.slow_draw_commands) ||
+        read_value(line, "50th percentile: ", t.p50_ms) ||
+        read_value(line, "90th percentile: ", t.p90_ms) ||
+        read_value(line, "95th percentile: ", t.p95_ms) ||
+        read_value(line, "99th percentile: ", t.p99_ms);
+  }
+  return processes;
+}
+
+bool GuestFrameStatistics::update(const std::string &gfxinfo) {
+  auto processes = parse(gfxinfo);
+  if (processes.empty())
+    return false;
+
+  std::uint64_t busiest_frames = 0;
+  for (const auto &p : processes) {
+    // A process we don't know yet, one which reused the pid of another or
+    // whose statistics were reset counts from zero.
+    Counters before;
+    const auto previous = processes_.find(p.first);
+    if (previous != processes_.end() && previous->second.package == p.second.package &&
+        previous->second.counters.frames <= p.second.counters.frames)
+      before = previous->second.counters;
+
+    const auto &now = p.second.counters;
+    const auto frames = since(now.frames, before.frames);
+    totals_.frames += frames;
+    totals_.janky_frames += since(now.janky_frames, before.janky_frames);
+    totals_.missed_vsync += since(now.missed_vsync, before.missed_vsync);
+    totals_.high_input_latency += since(now.high_input_latency, before.high_input_latency);
+    totals_.slow_ui_thread += since(now.slow_ui_thread, before.slow_ui_thread);
+    totals_.slow_bitmap_uploads += since(now.slow_bitmap_uploads, before.slow_bitmap_uploads);
+    totals_.slow_draw_commands += since(now.slow_draw_commands, before.slow_draw_commands);
+
+    if (frames > busiest_frames) {
+      busiest_frames = frames;
+      frame_times_ = p.second.frame_times;
+    }
+  }
+
+  processes_.swap(processes);
+  return true;
+}
+
+void GuestFrameStatistics::write(protobuf::bridge::GuestFrameStatisticsEvent &event) const {
+  event.set_frames(totals_.frames);
+  event.set_janky_frames(totals_.janky_frames);
+  event.set_missed_vsync(totals_.missed_vsync);
+  event.set_high_input_latency(totals_.high_input_latency);
+  event.set_slow_ui_thread(totals_.slow_ui_thread);
+  event.set_slow_bitmap_uploads(totals_.slow_bitmap_uploads);
+  event.set_slow_draw_commands(totals_.slow_draw_commands);
+  if (frame_times_.package.empty())
+    return;
+  event.set_package(frame_times_.package);
+  event.set_frame_time_p50_ms(frame_times_.p50_ms);
+  event.set_frame_time_p90_ms(frame_times_.p90_ms);
+  event.set_frame_time_p95_ms(frame_times_.p95_ms);
+  event.set_frame_time_p99_ms(frame_times_.p99_ms);
+}
+
+void GuestFrameStatistics::read(const protobuf::bridge::GuestFrameStatisticsEvent &event) {
+  totals_.frames = event.frames();
+  totals_.janky_frames = event.janky_frames();
+  totals_.missed_vsync = event.missed_vsync();
+  totals_.high_input_latency = event.high_input_latency();
+  totals_.slow_ui_thread = event.slow_ui_thread();
+  totals_.slow_bitmap_uploads = event.slow_bitmap_uploads();
+  totals_.slow_draw_commands = event.slow_draw_commands();
+  frame_times_.package = event.package();
+  frame_times_.p50_ms = event.frame_time_p50_ms();
+  frame_times_.p90_ms = event.frame_time_p90_ms();
+  frame_times_.p95_ms = event.frame_time_p95_ms();
+  frame_times_.p99_ms = event.frame_time_p99_ms();
+}
+}  // namespace bridge
+}  // namespace anbox
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_BRIDGE_GUEST_FRAME_STATISTICS_H_
+#define ANBOX_BRIDGE_GUEST_FRAME_STATISTICS_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace anbox {
+namespace protobuf {
+namespace bridge {
+class GuestFrameStatisticsEvent;
+}  // namespace bridge
+}  // namespace protobuf
+namespace bridge {
+// Frame and jank counters of all apps running in Android, as the guest
+// reports them with a GuestFrameStatisticsEvent.
+//
+// Android tracks them per process and forgets them together with the
+// process, so the guest looks at the output of `dumpsys gfxinfo` every
+// now and then and adds up what each process rendered since the last
+// time. The totals only ever grow for as long as Android runs.
+class GuestFrameStatistics {
+ public:
+  struct Counters {
+    std::uint64_t frames = 0;
+    std::uint64_t janky_frames = 0;
+    std::uint64_t missed_vsync = 0;
+    std::uint64_t high_input_latency = 0;
+    std::uint64_t slow_ui_thread = 0;
+    std::uint64_t slow_bitmap_uploads = 0;
+    std::uint64_t slow_draw_commands = 0;
+  };
+
+  // Percentiles of the frame times of |package|, the app which rendered
+  // most frames since the previous update or before that, when nothing
+  // was rendered in between. Android only has them with a
+  // resolution of a millisecond.
+  struct FrameTimes {
+    std::string package;
+    std::uint32_t p50_ms = 0;
+    std::uint32_t p90_ms = 0;
+    std::uint32_t p95_ms = 0;
+    std::uint32_t p99_ms = 0;
+  };
+
+  // Adds what the processes in |gfxinfo| rendered since the previous
+  // update. Returns false when it holds no process at all.
+  bool update(const std::string &gfxinfo);
+
+  const Counters &totals() const { return totals_; }
+  const FrameTimes &frame_times() const { return frame_times_; }
+
+  void write(protobuf::bridge::GuestFrameStatisticsEvent &event) const;
+  void read(const protobuf::bridge::GuestFrameStatisticsEvent &event);
+
+ private:
+  struct Process {
+    std::string package;
+    Counters counters;
+    FrameTimes frame_times;
+  };
+
+  static std::map<int, Process> parse(const std::string &gfxinfo);
+
+  std::map<int, Process> processes_;
+  Counters totals_;
+  FrameTimes frame_times_;
+};
+}  // namespace bridge
+}  // namespace anbox
+
+#endif
@@ -16,7 +16,13 @@
  */
 
 #include "anbox/bridge/platform_api_skeleton.h"
+#include "anbox/bridge/guest_frame_statistics.h"
+#include "anbox/bridge/window_state_decoder.h"
 #include "anbox/application/database.h"
+#include "anbox/application/icon_cache.h"
+#include "anbox/common/boot_timeline.h"
+#include "anbox/common/latency_samples.h"
+#include "anbox/common/metrics.h"
 #include "anbox/platform/policy.h"
 #include "anbox/wm/manager.h"
 #include "anbox/wm/window_state.h"
@@ -24,8 +30,52 @@
 
 #include "anbox_bridge.pb.h"
 
+#include <algorithm>
+#include <mutex>
+
 namespace anbox {
 namespace bridge {
+// Shared with the metrics collector which may run after we are gone.
+struct PlatformApiSkeleton::GuestFrames {
+  mutable std::mutex lock;
+  bool reported = false;
+  GuestFrameStatistics statistics;
+
+  void write_prometheus(std::ostream &out) const {
+    std::lock_guard<std::mutex> l(lock);
+    if (!reported)
+      return;
+
+    const auto &totals = statistics.totals();
+    out << "# HELP anbox_guest_frames_total Frames rendered by apps in Android.\n"
+        << "# TYPE anbox_guest_frames_total counter\n"
+        << "anbox_guest_frames_total " << totals.frames << "\n"
+        << "# HELP anbox_guest_janky_frames_total Frames Android considers janky.\n"
+        << "# TYPE anbox_guest_janky_frames_total counter\n"
+        << "anbox_guest_janky_frames_total " << totals.janky_frames << "\n"
+        << "# HELP anbox_guest_jank_causes_total Causes Android found for janky frames.\n"
+        << "# TYPE anbox_guest_jank_causes_total counter\n"
+        << "anbox_guest_jank_causes_total{cause=\"missed_vsync\"} " << totals.missed_vsync << "\n"
+        << "anbox_guest_jank_causes_total{cause=\"high_input_latency\"} " << totals.high_input_latency << "\n"
+        << "anbox_guest_jank_causes_total{cause=\"slow_ui_thread\"} " << totals.slow_ui_thread << "\n"
+        << "anbox_guest_jank_causes_total{cause=\"slow_bitmap_uploads\"} " << totals.slow_bitmap_uploads << "\n"
+        << "anbox_guest_jank_causes_total{cause=\"slow_draw_commands\"} " << totals.slow_draw_commands << "\n";
+
+    const auto &times = statistics.frame_times();
+    if (times.package.empty())
+      return;
+    // Labelled like the host's own anbox_frame_time_seconds so both sides
+    // of a frame line up.
+    const auto label = "{window=\"" + common::escape_prometheus_label(times.package) + "\",quantile=\"";
+    out << "# HELP anbox_guest_frame_time_seconds Time Android spent on the frames of the busiest app.\n"
+        << "# TYPE anbox_guest_frame_time_seconds gauge\n"
+        << "anbox_guest_frame_time_seconds" << label << "0.5\"} " << times.p50_ms / 1000.0 << "\n"
+        << "anbox_guest_frame_time_seconds" << label << "0.9\"} " << times.p90_ms / 1000.0 << "\n"
+        << "anbox_guest_frame_time_seconds" << label << "0.95\"} " << times.p95_ms / 1000.0 << "\n"
+        << "anbox_guest_frame_time_seconds" << label << "0.99\"} " << times.p99_ms / 1000.0 << "\n";
+  }
+};
+
 PlatformApiSkeleton::PlatformApiSkeleton(
     const std::shared_ptr<rpc::PendingCallCache> &pending_calls,
     const std::shared_ptr<platform::Policy> &platform_policy,
@@ -34,9 +84,21 @@ PlatformApiSkeleton::PlatformApiSkeleton(
     : pending_calls_(pending_calls),
       platform_policy_(platform_policy),
       window_manager_(window_manager),
-      app_db_(app_db) {}
+      app_db_(app_db),
+      window_states_(new WindowStateDecoder),
+      guest_frames_(std::make_shared<GuestFrames>()) {
+  if (auto metrics = common::Metrics::instance()) {
+    const auto guest_frames = guest_frames_;
+    metrics->add_collector("guest_frames", [guest_frames](std::ostream &out) {
+      guest_frames->write_prometheus(out);
+    });
+  }
+}
 
-PlatformApiSkeleton::~PlatformApiSkeleton() {}
+PlatformApiSkeleton::~PlatformApiSkeleton() {
+  if (auto metrics = common::Metrics::instance())
+    metrics->remove_collector("guest_frames");
+}
 
 
 void PlatformApiSkeleton::set_clipboard_data(anbox::protobuf::bridge::ClipboardData const *request,
@@ -63,35 +125,29 @@ void PlatformApiSkeleton::get_clipboard_data(anbox::protobuf::rpc::Void const *r
 }
 
 void PlatformApiSkeleton::handle_boot_finished_event(const anbox::protobuf::bridge::BootFinishedEvent&) {
+  common::BootTimeline::instance().finish();
   if (boot_finished_handler_)
     boot_finished_handler_();
 }
 
 void PlatformApiSkeleton::handle_window_state_update_event(const anbox::protobuf::bridge::WindowStateUpdateEvent &event) {
-  auto convert_window_state = [](
-      const ::anbox::protobuf::bridge::WindowStateUpdateEvent_WindowState
-          &window) {
-    return wm::WindowState(
-        wm::Display::Id(window.display_id()), window.has_surface(),
-        graphics::Rect(window.frame_left(), window.frame_top(),
-                       window.frame_right(), window.frame_bottom()),
-        window.package_name(), wm::Task::Id(window.task_id()),
-        wm::Stack::Id(window.stack_id()));
-  };
-
-  wm::WindowState::List updated;
-  for (int n = 0; n < event.windows_size(); n++) {
-    const auto window = event.windows(n);
-    updated.push_back(convert_window_state(window));
-  }
+  if (!window_states_->apply(event))
+    WARNING("Got window state update which doesn't match the windows we know about");
 
-  wm::WindowState::List removed;
-  for (int n = 0; n < event.removed_windows_size(); n++) {
-    const auto window = event.removed_windows(n);
-    removed.push_back(convert_window_state(window));
-  }
+  window_manager_->apply_window_state_update(window_states_->windows(), window_states_->removed());
+}
+
+void PlatformApiSkeleton::handle_window_state_frame(const std::uint8_t *data, std::size_t size) {
+  if (!window_states_->apply(WindowStateFrame(data, size)))
+    WARNING("Got window state frame which doesn't match the windows we know about");
 
-  window_manager_->apply_window_state_update(updated, removed);
+  window_manager_->apply_window_state_update(window_states_->windows(), window_states_->removed());
+}
+
+void PlatformApiSkeleton::handle_guest_frame_statistics_event(const anbox::protobuf::bridge::GuestFrameStatisticsEvent &event) {
+  std::lock_guard<std::mutex> l(guest_frames_->lock);
+  guest_frames_->statistics.read(event);
+  guest_frames_->reported = true;
 }
 
 void PlatformApiSkeleton::handle_application_list_update_event(const anbox::protobuf::bridge::ApplicationListUpdateEvent &event) {
@@ -107,6 +163,9 @@ void PlatformApiSkeleton::handle_application_list_update_event(const anbox::prot
     app_db_->remove(item);
   }
 
+  std::vector<application::Database::Item> without_icon;
+  std::vector<std::string> missing_icons;
+
   for (int n = 0; n < event.applications_size(); n++) {
     application::Database::Item item;
 
@@ -125,16 +184,47 @@ void PlatformApiSkeleton::handle_application_list_update_event(const anbox::prot
       item.launch_intent.categories.push_back(li.categories(m));
 
     item.icon = std::vector<char>(app.icon().begin(), app.icon().end());
+    if (application::IconCache::valid_hash(app.icon_hash()))
+      item.icon_hash = app.icon_hash();
 
     if (item.package.empty())
       continue;
 
+    // Items whose icon we have to fetch first are stored once it arrived.
+    if (item.icon.empty() && !item.icon_hash.empty() &&
+        !app_db_->has_icon(item.icon_hash) && icon_fetcher_) {
+      if (std::find(missing_icons.begin(), missing_icons.end(), item.icon_hash) == missing_icons.end())
+        missing_icons.push_back(item.icon_hash);
+      without_icon.push_back(item);
+      continue;
+    }
+
     app_db_->store_or_update(item);
   }
+
+  if (missing_icons.empty()) {
+    // Android always sends us all of its applications at once.
+    if (event.applications_size() > 0)
+      app_db_->remove_stale();
+    return;
+  }
+
+  auto app_db = app_db_;
+  icon_fetcher_(missing_icons, [app_db, without_icon](const Icons &icons) {
+    for (const auto &icon : icons)
+      app_db->store_icon(icon.first, icon.second);
+    for (const auto &item : without_icon)
+      app_db->store_or_update(item);
+    app_db->remove_stale();
+  });
 }
 
 void PlatformApiSkeleton::register_boot_finished_handler(const std::function<void()> &action) {
   boot_finished_handler_ = action;
 }
+
+void PlatformApiSkeleton::register_icon_fetcher(const IconFetcher &fetcher) {
+  icon_fetcher_ = fetcher;
+}
 }  // namespace bridge
 }  // namespace anbox
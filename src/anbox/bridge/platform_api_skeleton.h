@@ -18,7 +18,12 @@
 #ifndef ANBOX_BRIDGE_PLATFORM_SERVER_H_
 #define ANBOX_BRIDGE_PLATFORM_SERVER_H_
 
+#include <cstdint>
+#include <functional>
+#include <map>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace google {
 namespace protobuf {
@@ -36,6 +41,7 @@ class ClipboardData;
 class BootFinishedEvent;
 class WindowStateUpdateEvent;
 class ApplicationListUpdateEvent;
+class GuestFrameStatisticsEvent;
 }  // namespace bridge
 }  // namespace protobuf
 namespace platform {
@@ -51,6 +57,7 @@ namespace application {
 class Database;
 }  // namespace application
 namespace bridge {
+class WindowStateDecoder;
 class PlatformApiSkeleton {
  public:
   PlatformApiSkeleton(
@@ -71,17 +78,34 @@ class PlatformApiSkeleton {
       const anbox::protobuf::bridge::BootFinishedEvent &event);
   void handle_window_state_update_event(
       const anbox::protobuf::bridge::WindowStateUpdateEvent &event);
+  void handle_window_state_frame(const std::uint8_t *data, std::size_t size);
   void handle_application_list_update_event(
       const anbox::protobuf::bridge::ApplicationListUpdateEvent &event);
+  // With metrics enabled the frame statistics of the guest are reported
+  // next to those the host collects itself.
+  void handle_guest_frame_statistics_event(
+      const anbox::protobuf::bridge::GuestFrameStatisticsEvent &event);
 
   void register_boot_finished_handler(const std::function<void()> &action);
 
+  // Fetches icons we don't have cached from Android, see
+  // bridge::AndroidApiStub::get_application_icons_async.
+  typedef std::map<std::string, std::vector<char>> Icons;
+  typedef std::function<void(const std::vector<std::string> &hashes,
+                             const std::function<void(const Icons &icons)> &done)> IconFetcher;
+  void register_icon_fetcher(const IconFetcher &fetcher);
+
  private:
+  struct GuestFrames;
+
   std::shared_ptr<rpc::PendingCallCache> pending_calls_;
   std::shared_ptr<platform::Policy> platform_policy_;
   std::shared_ptr<wm::Manager> window_manager_;
   std::shared_ptr<application::Database> app_db_;
+  std::unique_ptr<WindowStateDecoder> window_states_;
   std::function<void()> boot_finished_handler_;
+  IconFetcher icon_fetcher_;
+  std::shared_ptr<GuestFrames> guest_frames_;
 };
 }  // namespace bridge
 }  // namespace anbox
@@ -17,6 +17,7 @@
 
 #include "anbox/bridge/platform_message_processor.h"
 #include "anbox/bridge/platform_api_skeleton.h"
+#include "anbox/bridge/window_state_frame.h"
 #include "anbox/logger.h"
 #include "anbox/rpc/template_message_processor.h"
 
@@ -27,8 +28,9 @@ namespace bridge {
 PlatformMessageProcessor::PlatformMessageProcessor(
     const std::shared_ptr<network::MessageSender> &sender,
     const std::shared_ptr<PlatformApiSkeleton> &server,
-    const std::shared_ptr<rpc::PendingCallCache> &pending_calls)
-    : rpc::MessageProcessor(sender, pending_calls), server_(server) {}
+    const std::shared_ptr<rpc::PendingCallCache> &pending_calls,
+    const std::shared_ptr<rpc::Framing> &framing)
+    : rpc::MessageProcessor(sender, pending_calls, framing), server_(server) {}
 
 PlatformMessageProcessor::~PlatformMessageProcessor() {}
 
@@ -53,9 +55,21 @@ void PlatformMessageProcessor::process_event_sequence(
   if (seq.has_window_state_update())
     server_->handle_window_state_update_event(seq.window_state_update());
 
+  if (seq.has_guest_frame_statistics())
+    server_->handle_guest_frame_statistics_event(seq.guest_frame_statistics());
+
   if (seq.has_application_list_update())
     server_->handle_application_list_update_event(
         seq.application_list_update());
 }
+
+void PlatformMessageProcessor::process_raw_event(std::uint16_t kind,
+                                                 const std::uint8_t *data,
+                                                 size_t size) {
+  if (kind == WindowStateFrame::kind)
+    server_->handle_window_state_frame(data, size);
+  else
+    WARNING("Ignoring raw event of unknown kind %d", kind);
+}
 }  // namespace anbox
 }  // namespace network
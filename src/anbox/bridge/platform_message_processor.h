@@ -28,11 +28,14 @@ class PlatformMessageProcessor : public rpc::MessageProcessor {
   PlatformMessageProcessor(
       const std::shared_ptr<network::MessageSender> &sender,
       const std::shared_ptr<PlatformApiSkeleton> &server,
-      const std::shared_ptr<rpc::PendingCallCache> &pending_calls);
+      const std::shared_ptr<rpc::PendingCallCache> &pending_calls,
+      const std::shared_ptr<rpc::Framing> &framing);
   ~PlatformMessageProcessor();
 
   void dispatch(rpc::Invocation const &invocation) override;
   void process_event_sequence(const std::string &event) override;
+  void process_raw_event(std::uint16_t kind, const std::uint8_t *data,
+                         size_t size) override;
 
  private:
   std::shared_ptr<PlatformApiSkeleton> server_;
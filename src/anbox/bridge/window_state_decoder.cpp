@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/bridge/window_state_decoder.h"
+
+#include "anbox_bridge.pb.h"
+
+namespace {
+typedef anbox::protobuf::bridge::WindowStateUpdateEvent Event;
+
+anbox::wm::WindowState to_window_state(const Event::WindowState &window) {
+  return anbox::wm::WindowState(
+      anbox::wm::Display::Id(window.display_id()), window.has_surface(),
+      anbox::graphics::Rect(window.frame_left(), window.frame_top(),
+                            window.frame_right(), window.frame_bottom()),
+      window.package_name(), anbox::wm::Task::Id(window.task_id()),
+      anbox::wm::Stack::Id(window.stack_id()));
+}
+
+bool is_valid(const anbox::wm::WindowState &window) {
+  return window.display() != anbox::wm::Display::Invalid;
+}
+}  // namespace
+
+namespace anbox {
+namespace bridge {
+constexpr std::size_t WindowStateDecoder::max_windows;
+constexpr std::size_t WindowStateDecoder::max_packages;
+
+bool WindowStateDecoder::apply(const Event &event) {
+  removed_.clear();
+
+  if (event.incremental())
+    return apply_incremental(event);
+
+  // Older versions of Android send all of their windows every time.
+  windows_.resize(static_cast<std::size_t>(event.windows_size()));
+  for (int n = 0; n < event.windows_size(); n++)
+    windows_[n] = to_window_state(event.windows(n));
+
+  removed_.resize(static_cast<std::size_t>(event.removed_windows_size()));
+  for (int n = 0; n < event.removed_windows_size(); n++)
+    removed_[n] = to_window_state(event.removed_windows(n));
+
+  return true;
+}
+
+bool WindowStateDecoder::apply(const WindowStateFrame &frame) {
+  removed_.clear();
+  if (!frame.valid())
+    return false;
+
+  if (frame.reset())
+    reset();
+  if (!add_packages(frame.package_count()))
+    return false;
+  frame.append_packages(packages_);
+
+  for (std::uint32_t n = 0; n < frame.removed_count(); n++) {
+    if (!remove(frame.removed(n)))
+      return false;
+  }
+  for (std::uint32_t n = 0; n < frame.changed_count(); n++) {
+    if (!apply_change(frame.changed(n)))
+      return false;
+  }
+  return true;
+}
+
+bool WindowStateDecoder::apply_incremental(const Event &event) {
+  if (event.reset())
+    reset();
+
+  if (!add_packages(static_cast<std::size_t>(event.packages_size())))
+    return false;
+  for (const auto &package : event.packages())
+    packages_.push_back(package);
+
+  for (const auto id : event.removed_window_ids()) {
+    if (!remove(id))
+      return false;
+  }
+
+  for (int n = 0; n < event.changed_windows_size(); n++) {
+    if (!apply_change(WindowStateFrame::to_change(event, n)))
+      return false;
+  }
+
+  return true;
+}
+
+void WindowStateDecoder::reset() {
+  for (const auto &window : windows_) {
+    if (is_valid(window))
+      removed_.push_back(window);
+  }
+  windows_.clear();
+  packages_.clear();
+}
+
+bool WindowStateDecoder::remove(std::uint32_t id) {
+  if (id >= windows_.size() || !is_valid(windows_[id]))
+    return false;
+  removed_.push_back(windows_[id]);
+  windows_[id] = wm::WindowState();
+  return true;
+}
+
+bool WindowStateDecoder::add_packages(std::size_t count) {
+  return count <= max_packages - packages_.size();
+}
+
+bool WindowStateDecoder::apply_change(const WindowStateFrame::Change &change) {
+  const auto has = [&](WindowStateFrame::Field field) {
+    return (change.fields & field) != 0;
+  };
+
+  const auto id = static_cast<std::size_t>(change.id);
+  if (id >= max_windows)
+    return false;
+  if (id >= windows_.size())
+    windows_.resize(id + 1);
+  auto &window = windows_[id];
+
+  if (!is_valid(window)) {
+    // New windows come with everything.
+    if ((change.fields & WindowStateFrame::all_fields) != WindowStateFrame::all_fields ||
+        change.package >= packages_.size())
+      return false;
+
+    window = wm::WindowState(
+        wm::Display::Id(change.display_id), change.has_surface != 0,
+        graphics::Rect(change.frame_left, change.frame_top, change.frame_right,
+                       change.frame_bottom),
+        packages_[change.package], wm::Task::Id(change.task_id),
+        wm::Stack::Id(change.stack_id));
+    return true;
+  }
+
+  const auto frame = window.frame();
+  const graphics::Rect new_frame(
+      has(WindowStateFrame::frame_left_field) ? change.frame_left : frame.left(),
+      has(WindowStateFrame::frame_top_field) ? change.frame_top : frame.top(),
+      has(WindowStateFrame::frame_right_field) ? change.frame_right : frame.right(),
+      has(WindowStateFrame::frame_bottom_field) ? change.frame_bottom : frame.bottom());
+
+  if ((change.fields & ~WindowStateFrame::frame_fields) == 0) {
+    window.set_frame(new_frame);
+    return true;
+  }
+
+  if (has(WindowStateFrame::package_field) && change.package >= packages_.size())
+    return false;
+
+  window = wm::WindowState(
+      has(WindowStateFrame::display_id_field) ? wm::Display::Id(change.display_id) : window.display(),
+      has(WindowStateFrame::has_surface_field) ? change.has_surface != 0 : window.has_surface(),
+      new_frame,
+      has(WindowStateFrame::package_field) ? packages_[change.package] : window.package_name(),
+      has(WindowStateFrame::task_id_field) ? wm::Task::Id(change.task_id) : window.task(),
+      has(WindowStateFrame::stack_id_field) ? wm::Stack::Id(change.stack_id) : window.stack());
+  return true;
+}
+}  // namespace bridge
+}  // namespace anbox
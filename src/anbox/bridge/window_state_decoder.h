@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_BRIDGE_WINDOW_STATE_DECODER_H_
+#define ANBOX_BRIDGE_WINDOW_STATE_DECODER_H_
+
+#include "anbox/bridge/window_state_frame.h"
+#include "anbox/wm/window_state.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace anbox {
+namespace protobuf {
+namespace bridge {
+class WindowStateUpdateEvent;
+}  // namespace bridge
+}  // namespace protobuf
+namespace bridge {
+// Keeps the window states Android reported so far, the counterpart of
+// WindowStateEncoder. Both full and incremental events are applied in
+// place: once the tables grew to the number of windows and packages in use
+// an event which only moves windows around doesn't allocate anything.
+class WindowStateDecoder {
+ public:
+  // The guest reuses the ids of windows which are gone and only forgets
+  // packages on a reset, so anything beyond these is not a guest we want
+  // to allocate tables for.
+  static constexpr std::size_t max_windows{4096};
+  static constexpr std::size_t max_packages{16384};
+
+  // Returns false when |event| doesn't fit what we got before, e.g. refers
+  // to an unknown window. Everything up to that point is applied then.
+  bool apply(const protobuf::bridge::WindowStateUpdateEvent &event);
+  bool apply(const WindowStateFrame &frame);
+
+  // All windows, indexed by their id for incremental events. Slots of
+  // windows which are gone hold an invalid default state.
+  const wm::WindowState::List &windows() const { return windows_; }
+  // The windows the last event removed.
+  const wm::WindowState::List &removed() const { return removed_; }
+
+ private:
+  bool apply_incremental(const protobuf::bridge::WindowStateUpdateEvent &event);
+  void reset();
+  bool remove(std::uint32_t id);
+  bool add_packages(std::size_t count);
+  bool apply_change(const WindowStateFrame::Change &change);
+
+  wm::WindowState::List windows_;
+  wm::WindowState::List removed_;
+  std::vector<std::string> packages_;
+};
+}  // namespace bridge
+}  // namespace anbox
+
+#endif
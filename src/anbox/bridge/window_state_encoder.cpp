@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/bridge/window_state_encoder.h"
+
+namespace anbox {
+namespace bridge {
+WindowStateEncoder::WindowStateEncoder() : started_(false), next_id_(0) {}
+
+bool WindowStateEncoder::encode(const Event &full, Event &delta) {
+  delta.Clear();
+  delta.set_incremental(true);
+
+  bool changed = false;
+  if (!started_) {
+    // The host may still know windows of a previous instance of us.
+    delta.set_reset(true);
+    started_ = true;
+    changed = true;
+  }
+
+  std::map<Identity, std::uint32_t> counts;
+  std::map<Key, Entry> current;
+  for (const auto &window : full.windows()) {
+    const Identity identity{window.display_id(), window.task_id(), window.stack_id(),
+                            window.package_name()};
+    const Key key{identity, counts[identity]++};
+
+    auto previous = windows_.find(key);
+    if (previous == windows_.end()) {
+      auto change = delta.add_changed_windows();
+      const auto id = allocate_id();
+      change->set_id(id);
+      change->set_display_id(window.display_id());
+      change->set_has_surface(window.has_surface());
+      change->set_package(package_index(window.package_name(), delta));
+      change->set_frame_left(window.frame_left());
+      change->set_frame_top(window.frame_top());
+      change->set_frame_right(window.frame_right());
+      change->set_frame_bottom(window.frame_bottom());
+      change->set_task_id(window.task_id());
+      change->set_stack_id(window.stack_id());
+      current.insert({key, Entry{id, window}});
+      changed = true;
+      continue;
+    }
+
+    const auto &last = previous->second.state;
+    if (last.has_surface() != window.has_surface() ||
+        last.frame_left() != window.frame_left() || last.frame_top() != window.frame_top() ||
+        last.frame_right() != window.frame_right() ||
+        last.frame_bottom() != window.frame_bottom()) {
+      auto change = delta.add_changed_windows();
+      change->set_id(previous->second.id);
+      if (last.has_surface() != window.has_surface())
+        change->set_has_surface(window.has_surface());
+      if (last.frame_left() != window.frame_left())
+        change->set_frame_left(window.frame_left());
+      if (last.frame_top() != window.frame_top())
+        change->set_frame_top(window.frame_top());
+      if (last.frame_right() != window.frame_right())
+        change->set_frame_right(window.frame_right());
+      if (last.frame_bottom() != window.frame_bottom())
+        change->set_frame_bottom(window.frame_bottom());
+      changed = true;
+    }
+
+    current.insert({key, Entry{previous->second.id, window}});
+    windows_.erase(previous);
+  }
+
+  // Whatever is left is gone. Ids are only reused with the next event so
+  // that a removal and a new window never share one.
+  for (const auto &window : windows_) {
+    delta.add_removed_window_ids(window.second.id);
+    changed = true;
+  }
+  for (const auto &window : windows_)
+    free_ids_.push_back(window.second.id);
+
+  windows_.swap(current);
+  return changed;
+}
+
+std::uint32_t WindowStateEncoder::package_index(const std::string &package, Event &delta) {
+  auto known = packages_.find(package);
+  if (known != packages_.end())
+    return known->second;
+
+  const auto index = static_cast<std::uint32_t>(packages_.size());
+  packages_.insert({package, index});
+  delta.add_packages(package);
+  return index;
+}
+
+std::uint32_t WindowStateEncoder::allocate_id() {
+  // Keeping ids small keeps the table on the host side small too.
+  if (free_ids_.empty())
+    return next_id_++;
+  const auto id = free_ids_.back();
+  free_ids_.pop_back();
+  return id;
+}
+}  // namespace bridge
+}  // namespace anbox
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_BRIDGE_WINDOW_STATE_ENCODER_H_
+#define ANBOX_BRIDGE_WINDOW_STATE_ENCODER_H_
+
+#include "anbox_bridge.pb.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace anbox {
+namespace bridge {
+// Turns the full window states Android reports into incremental
+// WindowStateUpdateEvents. Used on the Android side.
+//
+// Android doesn't give windows an identity, so a window is whatever has the
+// same display, task, stack and package as one of the last event, counted
+// in the order they come in when there are several of them. That leaves its
+// frame and whether it has a surface as the only things which can change;
+// anything else makes it a different window.
+class WindowStateEncoder {
+ public:
+  typedef protobuf::bridge::WindowStateUpdateEvent Event;
+
+  WindowStateEncoder();
+
+  // Writes the changes between the windows of the previous call and all
+  // |windows| of |full| to |delta|. Returns false if there are none.
+  bool encode(const Event &full, Event &delta);
+
+ private:
+  typedef std::tuple<std::int32_t, std::int32_t, std::int32_t, std::string> Identity;
+  typedef std::tuple<Identity, std::uint32_t> Key;
+  struct Entry {
+    std::uint32_t id;
+    Event::WindowState state;
+  };
+
+  std::uint32_t package_index(const std::string &package, Event &delta);
+  std::uint32_t allocate_id();
+
+  bool started_;
+  std::map<Key, Entry> windows_;
+  std::map<std::string, std::uint32_t> packages_;
+  std::vector<std::uint32_t> free_ids_;
+  std::uint32_t next_id_;
+};
+}  // namespace bridge
+}  // namespace anbox
+
+#endif
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "anbox/bridge/window_state_frame.h"
+
+#include "anbox_bridge.pb.h"
+
+#include <cstring>
+
+namespace {
+static_assert(sizeof(anbox::bridge::WindowStateFrame::Header) == 16, "Header is part of the protocol");
+static_assert(sizeof(anbox::bridge::WindowStateFrame::Change) == 44, "Change is part of the protocol");
+
+std::size_t padded(std::size_t size) {
+  return (size + 3) & ~std::size_t{3};
+}
+}  // namespace
+
+namespace anbox {
+namespace bridge {
+constexpr std::uint16_t WindowStateFrame::kind;
+
+WindowStateFrame::Change WindowStateFrame::to_change(
+    const protobuf::bridge::WindowStateUpdateEvent &event, int n) {
+  const auto &c = event.changed_windows(n);
+  Change change;
+  std::memset(&change, 0, sizeof(change));
+  change.id = c.id();
+  const auto set = [&](bool has, Field field) {
+    if (has)
+      change.fields |= field;
+  };
+  set(c.has_display_id(), display_id_field);
+  set(c.has_has_surface(), has_surface_field);
+  set(c.has_package(), package_field);
+  set(c.has_frame_left(), frame_left_field);
+  set(c.has_frame_top(), frame_top_field);
+  set(c.has_frame_right(), frame_right_field);
+  set(c.has_frame_bottom(), frame_bottom_field);
+  set(c.has_task_id(), task_id_field);
+  set(c.has_stack_id(), stack_id_field);
+  change.display_id = c.display_id();
+  change.has_surface = c.has_surface() ? 1 : 0;
+  change.package = c.package();
+  change.frame_left = c.frame_left();
+  change.frame_top = c.frame_top();
+  change.frame_right = c.frame_right();
+  change.frame_bottom = c.frame_bottom();
+  change.task_id = c.task_id();
+  change.stack_id = c.stack_id();
+  return change;
+}
+
+std::size_t WindowStateFrame::size(const protobuf::bridge::WindowStateUpdateEvent &event) {
+  auto size = sizeof(Header) +
+              sizeof(std::uint32_t) * static_cast<std::size_t>(event.removed_window_ids_size()) +
+              sizeof(Change) * static_cast<std::size_t>(event.changed_windows_size());
+  for (const auto &package : event.packages())
+    size += sizeof(std::uint32_t) + padded(package.size());
+  return size;
+}
+
+void WindowStateFrame::write(const protobuf::bridge::WindowStateUpdateEvent &event,
+                             std::uint8_t *out) {
+  const Header header{event.reset() ? static_cast<std::uint32_t>(reset_flag) : 0u,
+                      static_cast<std::uint32_t>(event.removed_window_ids_size()),
+                      static_cast<std::uint32_t>(event.changed_windows_size()),
+                      static_cast<std::uint32_t>(event.packages_size())};
+  std::memcpy(out, &header, sizeof(header));
+  out += sizeof(header);
+
+  for (const auto id : event.removed_window_ids()) {
+    std::memcpy(out, &id, sizeof(id));
+    out += sizeof(id);
+  }
+
+  for (int n = 0; n < event.changed_windows_size(); n++) {
+    const auto change = to_change(event, n);
+    std::memcpy(out, &change, sizeof(change));
+    out += sizeof(change);
+  }
+
+  for (const auto &package : event.packages()) {
+    const auto length = static_cast<std::uint32_t>(package.size());
+    std::memcpy(out, &length, sizeof(length));
+    out += sizeof(length);
+    std::memcpy(out, package.data(), package.size());
+    std::memset(out + package.size(), 0, padded(package.size()) - package.size());
+    out += padded(package.size());
+  }
+}
+
+WindowStateFrame::WindowStateFrame(const std::uint8_t *data, std::size_t size)
+    : data_(data), valid_(false) {
+  std::memset(&header_, 0, sizeof(header_));
+  if (size < sizeof(Header))
+    return;
+  std::memcpy(&header_, data, sizeof(header_));
+
+  // Counts are checked one by one so that huge ones can't overflow.
+  std::size_t offset = sizeof(Header);
+  if (header_.removed > (size - offset) / sizeof(std::uint32_t))
+    return;
+  offset += sizeof(std::uint32_t) * header_.removed;
+  if (header_.changed > (size - offset) / sizeof(Change))
+    return;
+  offset += sizeof(Change) * header_.changed;
+
+  for (std::uint32_t n = 0; n < header_.packages; n++) {
+    std::uint32_t length = 0;
+    if (size - offset < sizeof(length))
+      return;
+    std::memcpy(&length, data + offset, sizeof(length));
+    offset += sizeof(length);
+    if (padded(length) > size - offset)
+      return;
+    offset += padded(length);
+  }
+
+  valid_ = offset == size;
+}
+
+std::uint32_t WindowStateFrame::removed(std::uint32_t n) const {
+  std::uint32_t id = 0;
+  std::memcpy(&id, data_ + sizeof(Header) + n * sizeof(id), sizeof(id));
+  return id;
+}
+
+WindowStateFrame::Change WindowStateFrame::changed(std::uint32_t n) const {
+  Change change;
+  std::memcpy(&change,
+              data_ + sizeof(Header) + header_.removed * sizeof(std::uint32_t) + n * sizeof(change),
+              sizeof(change));
+  return change;
+}
+
+void WindowStateFrame::append_packages(std::vector<std::string> &packages) const {
+  auto offset = sizeof(Header) + header_.removed * sizeof(std::uint32_t) +
+                header_.changed * sizeof(Change);
+  for (std::uint32_t n = 0; n < header_.packages; n++) {
+    std::uint32_t length = 0;
+    std::memcpy(&length, data_ + offset, sizeof(length));
+    offset += sizeof(length);
+    packages.emplace_back(reinterpret_cast<const char *>(data_ + offset), length);
+    offset += padded(length);
+  }
+}
+}  // namespace bridge
+}  // namespace anbox
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef ANBOX_BRIDGE_WINDOW_STATE_FRAME_H_
+#define ANBOX_BRIDGE_WINDOW_STATE_FRAME_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace anbox {
+namespace protobuf {
+namespace bridge {
+class WindowStateUpdateEvent;
+}  // namespace bridge
+}  // namespace protobuf
+namespace bridge {
+// Incremental window state updates sent as raw event, see
+// rpc::MessageType::raw_event. They are sent for every frame a window is
+// dragged, so the host reads them in place instead of parsing them into
+// a WindowStateUpdateEvent first. Peers which don't speak
+// rpc::raw_event_protocol_version get the WindowStateUpdateEvent.
+//
+// A frame is a Header followed by the ids of the removed windows, one
+// Change per changed window and the names of the new packages, each as
+// its 32 bit length and its bytes padded to a multiple of four.
+class WindowStateFrame {
+ public:
+  static constexpr std::uint16_t kind{1};
+
+  enum Flags : std::uint32_t {
+    // The guest forgot all windows and packages before this frame.
+    reset_flag = 1 << 0,
+  };
+
+  struct Header {
+    std::uint32_t flags;
+    std::uint32_t removed;
+    std::uint32_t changed;
+    std::uint32_t packages;
+  };
+
+  // Which fields of a Change are set.
+  enum Field : std::uint32_t {
+    display_id_field = 1 << 0,
+    has_surface_field = 1 << 1,
+    package_field = 1 << 2,
+    frame_left_field = 1 << 3,
+    frame_top_field = 1 << 4,
+    frame_right_field = 1 << 5,
+    frame_bottom_field = 1 << 6,
+    task_id_field = 1 << 7,
+    stack_id_field = 1 << 8,
+    all_fields = (1 << 9) - 1,
+    frame_fields = frame_left_field | frame_top_field | frame_right_field | frame_bottom_field,
+  };
+
+  // Same as WindowStateUpdateEvent::WindowChange.
+  struct Change {
+    std::uint32_t id;
+    std::uint32_t fields;
+    std::int32_t display_id;
+    std::uint32_t has_surface;
+    std::uint32_t package;
+    std::int32_t frame_left;
+    std::int32_t frame_top;
+    std::int32_t frame_right;
+    std::int32_t frame_bottom;
+    std::int32_t task_id;
+    std::int32_t stack_id;
+  };
+
+  // Converts the changes of an incremental |event|, as the guest has them
+  // from WindowStateEncoder.
+  static Change to_change(const protobuf::bridge::WindowStateUpdateEvent &event, int n);
+  // Bytes write() needs for |event|.
+  static std::size_t size(const protobuf::bridge::WindowStateUpdateEvent &event);
+  static void write(const protobuf::bridge::WindowStateUpdateEvent &event, std::uint8_t *out);
+
+  // Checks that the |size| bytes at |data| make up a frame. The frame
+  // doesn't copy them.
+  WindowStateFrame(const std::uint8_t *data, std::size_t size);
+
+  bool valid() const { return valid_; }
+  bool reset() const { return (header_.flags & reset_flag) != 0; }
+
+  std::uint32_t removed_count() const { return header_.removed; }
+  std::uint32_t removed(std::uint32_t n) const;
+  std::uint32_t changed_count() const { return header_.changed; }
+  Change changed(std::uint32_t n) const;
+  std::uint32_t package_count() const { return header_.packages; }
+  // Appends the new packages to |packages|.
+  void append_packages(std::vector<std::string> &packages) const;
+
+ private:
+  const std::uint8_t *data_;
+  Header header_;
+  bool valid_;
+};
+}  // namespace bridge
+}  // namespace anbox
+
+#endif
@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "anbox/camera/frame_converter.h"
+#include "anbox/camera/yuv_rows.h"
+
+#include <cstring>
+#include <vector>
+
+#include <linux/videodev2.h>
+
+namespace {
+// Where the samples of a 4:2:0 subsampled frame are. The chroma planes
+// have one sample per 2x2 block of pixels; formats with more chroma, like
+// YUYV, use only the one of every second row.
+template <typename Byte>
+struct Planes {
+  Byte *y;
+  Byte *u;
+  Byte *v;
+  std::size_t y_step;
+  std::size_t y_stride;
+  std::size_t uv_step;
+  std::size_t uv_stride;
+};
+
+template <typename Byte>
+bool planes_for(std::uint32_t format, Byte *frame, std::size_t width, std::size_t height,
+                Planes<Byte> &planes) {
+  const auto luma = width * height;
+  switch (format) {
+    case V4L2_PIX_FMT_YUYV:
+      planes = {frame, frame + 1, frame + 3, 2, width * 2, 4, width * 4};
+      return true;
+    case V4L2_PIX_FMT_YUV420:
+      planes = {frame, frame + luma, frame + luma + luma / 4, 1, width, 1, width / 2};
+      return true;
+    case V4L2_PIX_FMT_YVU420:
+      planes = {frame, frame + luma + luma / 4, frame + luma, 1, width, 1, width / 2};
+      return true;
+    case V4L2_PIX_FMT_NV12:
+      planes = {frame, frame + luma, frame + luma + 1, 1, width, 2, width};
+      return true;
+    case V4L2_PIX_FMT_NV21:
+      planes = {frame, frame + luma + 1, frame + luma, 1, width, 2, width};
+      return true;
+    default:
+      break;
+  }
+  return false;
+}
+
+void copy_yuv(const Planes<const std::uint8_t> &src, const Planes<std::uint8_t> &dst,
+              std::size_t width, std::size_t height) {
+  for (std::size_t row = 0; row < height; row++) {
+    const auto from = src.y + row * src.y_stride;
+    const auto to = dst.y + row * dst.y_stride;
+    if (src.y_step == 1 && dst.y_step == 1) {
+      std::memcpy(to, from, width);
+      continue;
+    }
+    for (std::size_t col = 0; col < width; col++)
+      to[col * dst.y_step] = from[col * src.y_step];
+  }
+
+  for (std::size_t row = 0; row < height / 2; row++) {
+    const auto from_u = src.u + row * src.uv_stride;
+    const auto from_v = src.v + row * src.uv_stride;
+    const auto to_u = dst.u + row * dst.uv_stride;
+    const auto to_v = dst.v + row * dst.uv_stride;
+    // Planar to semi planar, which is what Android mostly asks for.
+    if (src.uv_step == 1 && dst.uv_step == 2) {
+      if (to_u < to_v)
+        anbox::camera::interleave_row(from_u, from_v, to_u, width / 2);
+      else
+        anbox::camera::interleave_row(from_v, from_u, to_v, width / 2);
+      continue;
+    }
+    for (std::size_t col = 0; col < width / 2; col++) {
+      to_u[col * dst.uv_step] = from_u[col * src.uv_step];
+      to_v[col * dst.uv_step] = from_v[col * src.uv_step];
+    }
+  }
+}
+
+// BT.601 with video range, like the converters on the Android side.
+void yuv_to_rgb32(const Planes<const std::uint8_t> &src, std::uint8_t *dst,
+                  std::size_t width, std::size_t height) {
+  // Packed formats are split into planar rows first.
+  std::vector<std::uint8_t> y_row, u_row, v_row;
+  if (src.y_step != 1) {
+    y_row.resize(width);
+    u_row.resize(width / 2);
+    v_row.resize(width / 2);
+  }
+
+  for (std::size_t row = 0; row < height; row++) {
+    auto y = src.y + row * src.y_stride;
+    auto u = src.u + (row / 2) * src.uv_stride;
+    auto v = src.v + (row / 2) * src.uv_stride;
+    auto uv_step = src.uv_step;
+    if (src.y_step != 1) {
+      for (std::size_t col = 0; col < width; col++)
+        y_row[col] = y[col * src.y_step];
+      for (std::size_t col = 0; col < width / 2; col++) {
+        u_row[col] = u[col * src.uv_step];
+        v_row[col] = v[col * src.uv_step];
+      }
+      y = y_row.data();
+      u = u_row.data();
+      v = v_row.data();
+      uv_step = 1;
+    }
+    anbox::camera::yuv_row_to_rgb32(y, u, v, uv_step, dst + row * width * 4, width);
+  }
+}
+}  // namespace
+
+namespace anbox {
+namespace camera {
+std::size_t frame_size(std::uint32_t format, std::uint32_t width, std::uint32_t height) {
+  if (width % 2 != 0 || height % 2 != 0)
+    return 0;
+
+  const std::size_t pixels = std::size_t{width} * height;
+  switch (format) {
+    case V4L2_PIX_FMT_YUYV:
+      return pixels * 2;
+    case V4L2_PIX_FMT_YUV420:
+    case V4L2_PIX_FMT_YVU420:
+    case V4L2_PIX_FMT_NV12:
+    case V4L2_PIX_FMT_NV21:
+      return pixels + pixels / 2;
+    case V4L2_PIX_FMT_RGB32:
+      return pixels * 4;
+    default:
+      break;
+  }
+  return 0;
+}
+
+bool is_source_format(std::uint32_t format) {
+  return format == V4L2_PIX_FMT_YUYV || format == V4L2_PIX_FMT_YUV420;
+}
+
+bool is_target_format(std::uint32_t format) {
+  return format != V4L2_PIX_FMT_YUYV && frame_size(format, 2, 2) > 0;
+}
+
+bool convert_frame(std::uint32_t src_format, const std::uint8_t *src, std::uint32_t dst_format,
+                   std::uint8_t *dst, std::uint32_t width, std::uint32_t height) {
+  if (!is_source_format(src_format) || !is_target_format(dst_format) ||
+      frame_size(src_format, width, height) == 0)
+    return false;
+
+  if (src_format == dst_format) {
+    std::memcpy(dst, src, frame_size(src_format, width, height));
+    return true;
+  }
+
+  Planes<const std::uint8_t> from;
+  planes_for(src_format, src, width, height, from);
+
+  if (dst_format == V4L2_PIX_FMT_RGB32) {
+    yuv_to_rgb32(from, dst, width, height);
+    return true;
+  }
+
+  Planes<std::uint8_t> to;
+  planes_for(dst_format, dst, width, height, to);
+  copy_yuv(from, to, width, height);
+  return true;
+}
+
+bool fill_black(std::uint32_t format, std::uint8_t *dst, std::uint32_t width, std::uint32_t height) {
+  const auto size = frame_size(format, width, height);
+  if (!is_target_format(format) || size == 0)
+    return false;
+
+  if (format == V4L2_PIX_FMT_RGB32) {
+    for (std::size_t n = 0; n < size; n += 4) {
+      dst[n] = dst[n + 1] = dst[n + 2] = 0;
+      dst[n + 3] = 0xff;
+    }
+    return true;
+  }
+
+  Planes<std::uint8_t> planes;
+  planes_for(format, dst, width, height, planes);
+  for (std::size_t row = 0; row < height; row++) {
+    for (std::size_t col = 0; col < width; col++)
+      planes.y[row * planes.y_stride + col * planes.y_step] = 16;
+  }
+  for (std::size_t row = 0; row < height / 2; row++) {
+    for (std::size_t col = 0; col < width / 2; col++) {
+      planes.u[row * planes.uv_stride + col * planes.uv_step] = 128;
+      planes.v[row * planes.uv_stride + col * planes.uv_step] = 128;
+    }
+  }
+  return true;
+}
+}  // namespace camera
+}  // namespace anbox
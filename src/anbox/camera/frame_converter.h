@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef ANBOX_CAMERA_FRAME_CONVERTER_H_
+#define ANBOX_CAMERA_FRAME_CONVERTER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace anbox {
+namespace camera {
+// Pixel formats are given as V4L2 fourcc codes, which is what the Android
+// camera HAL uses too.
+
+// Returns the number of bytes a frame in |format| takes or 0 if we can't
+// convert to or from it. Width and height have to be even.
+std::size_t frame_size(std::uint32_t format, std::uint32_t width, std::uint32_t height);
+
+// Formats we can convert from, i.e. what we capture in: YUYV and YUV420.
+bool is_source_format(std::uint32_t format);
+// Formats we can convert to: YUV420, YVU420, NV12, NV21 and RGB32. RGB32
+// is what Android wants the preview in and is laid out as R, G, B, X.
+bool is_target_format(std::uint32_t format);
+
+// Converts the |width| x |height| frame |src| into |dst| which needs to
+// have room for frame_size(dst_format, width, height) bytes. Returns false
+// if one of the formats isn't supported.
+bool convert_frame(std::uint32_t src_format, const std::uint8_t *src, std::uint32_t dst_format,
+                   std::uint8_t *dst, std::uint32_t width, std::uint32_t height);
+
+// Fills |dst|, in one of the formats we convert to, with a black frame.
+bool fill_black(std::uint32_t format, std::uint8_t *dst, std::uint32_t width, std::uint32_t height);
+}  // namespace camera
+}  // namespace anbox
+
+#endif
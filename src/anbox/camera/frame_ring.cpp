@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "anbox/camera/frame_ring.h"
+
+#include <boost/throw_exception.hpp>
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+int create_memfd(const char *name) {
+  // Not every libc we build against wraps it yet.
+  return static_cast<int>(::syscall(__NR_memfd_create, name, 0));
+}
+}  // namespace
+
+namespace anbox {
+namespace camera {
+constexpr std::size_t FrameRing::slot_count;
+
+FrameRing::FrameRing(std::size_t slot_size)
+    : slot_size_(slot_size), memory_(nullptr), writing_(0), newest_(0), lent_(0) {
+  const auto fd = create_memfd("anbox-camera");
+  if (fd < 0)
+    BOOST_THROW_EXCEPTION(std::runtime_error("Failed to create shared camera memory: " +
+                                             std::string(std::strerror(errno))));
+  fd_ = Fd{fd};
+
+  const auto size = slot_count * slot_size_;
+  if (::ftruncate(fd_, static_cast<off_t>(size)) != 0)
+    BOOST_THROW_EXCEPTION(std::runtime_error("Failed to size shared camera memory: " +
+                                             std::string(std::strerror(errno))));
+
+  auto addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (addr == MAP_FAILED)
+    BOOST_THROW_EXCEPTION(std::runtime_error("Failed to map shared camera memory: " +
+                                             std::string(std::strerror(errno))));
+  memory_ = static_cast<std::uint8_t *>(addr);
+}
+
+FrameRing::~FrameRing() {
+  ::munmap(memory_, slot_count * slot_size_);
+}
+
+std::uint8_t *FrameRing::begin_write() {
+  std::lock_guard<std::mutex> l(lock_);
+  writing_ = 0;
+  while (writing_ == newest_ || writing_ == lent_)
+    writing_++;
+  return memory_ + writing_ * slot_size_;
+}
+
+void FrameRing::end_write() {
+  std::lock_guard<std::mutex> l(lock_);
+  newest_ = writing_;
+}
+
+std::size_t FrameRing::lend_newest() {
+  std::lock_guard<std::mutex> l(lock_);
+  lent_ = newest_;
+  return lent_;
+}
+}  // namespace camera
+}  // namespace anbox
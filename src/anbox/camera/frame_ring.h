@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef ANBOX_CAMERA_FRAME_RING_H_
+#define ANBOX_CAMERA_FRAME_RING_H_
+
+#include "anbox/common/fd.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace anbox {
+namespace camera {
+// Frames shared with Android through a memfd, slot after slot without any
+// header. The capture thread writes into a free slot while Android reads
+// the one lent to it last, so neither has to copy frames out of the way.
+//
+// With three slots there is always one free: besides the one lent out
+// only the newest frame is kept.
+class FrameRing {
+ public:
+  static constexpr std::size_t slot_count{3};
+
+  // Throws std::runtime_error if the memory can't be created.
+  explicit FrameRing(std::size_t slot_size);
+  ~FrameRing();
+
+  FrameRing(const FrameRing &) = delete;
+  FrameRing &operator=(const FrameRing &) = delete;
+
+  const Fd &fd() const { return fd_; }
+  std::size_t slot_size() const { return slot_size_; }
+
+  // Returns the slot the next frame can be written into. Only one frame
+  // can be written at a time.
+  std::uint8_t *begin_write();
+  // Makes the frame written since begin_write() the newest one.
+  void end_write();
+
+  // Lends the newest frame out until the next call and returns its slot.
+  std::size_t lend_newest();
+  const std::uint8_t *slot(std::size_t index) const { return memory_ + index * slot_size_; }
+
+ private:
+  Fd fd_;
+  std::size_t slot_size_;
+  std::uint8_t *memory_;
+  std::mutex lock_;
+  std::size_t writing_;
+  std::size_t newest_;
+  std::size_t lent_;
+};
+}  // namespace camera
+}  // namespace anbox
+
+#endif
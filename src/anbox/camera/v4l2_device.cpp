@@ -0,0 +1,284 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "anbox/camera/v4l2_device.h"
+#include "anbox/camera/frame_converter.h"
+#include "anbox/utils.h"
+
+#include <boost/throw_exception.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <linux/videodev2.h>
+
+namespace {
+constexpr unsigned int max_devices{64};
+constexpr unsigned int buffer_count{4};
+
+// Offered for devices which can capture any size in a range.
+const anbox::camera::V4l2Device::Size common_sizes[] = {
+    {1280, 720}, {640, 480}, {352, 288}, {320, 240}, {176, 144},
+};
+
+int xioctl(int fd, unsigned long request, void *arg) {
+  int ret = 0;
+  do {
+    ret = ::ioctl(fd, request, arg);
+  } while (ret < 0 && errno == EINTR);
+  return ret;
+}
+
+[[noreturn]] void throw_error(const std::string &what) {
+  BOOST_THROW_EXCEPTION(std::runtime_error(what + ": " + std::strerror(errno)));
+}
+
+bool can_capture(int fd, struct v4l2_capability &caps) {
+  std::memset(&caps, 0, sizeof(caps));
+  if (xioctl(fd, VIDIOC_QUERYCAP, &caps) < 0)
+    return false;
+  const auto capabilities = (caps.capabilities & V4L2_CAP_DEVICE_CAPS) ? caps.device_caps
+                                                                       : caps.capabilities;
+  return (capabilities & V4L2_CAP_VIDEO_CAPTURE) && (capabilities & V4L2_CAP_STREAMING);
+}
+
+std::uint32_t bytes_per_line(std::uint32_t format, std::uint32_t width) {
+  return format == V4L2_PIX_FMT_YUYV ? width * 2 : width;
+}
+}  // namespace
+
+namespace anbox {
+namespace camera {
+std::vector<std::string> V4l2Device::available_devices() {
+  std::vector<std::string> devices;
+  for (unsigned int n = 0; n < max_devices; n++) {
+    const auto path = utils::string_format("/dev/video%d", n);
+    const auto fd = ::open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC | O_NOCTTY);
+    if (fd < 0)
+      continue;
+    struct v4l2_capability caps;
+    if (can_capture(fd, caps))
+      devices.push_back(path);
+    ::close(fd);
+  }
+  return devices;
+}
+
+V4l2Device::V4l2Device(const std::string &path)
+    : format_(0), frame_size_(0), streaming_(false) {
+  const auto fd = ::open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC | O_NOCTTY);
+  if (fd < 0)
+    throw_error("Failed to open " + path);
+  fd_ = Fd{fd};
+
+  struct v4l2_capability caps;
+  if (!can_capture(fd_, caps))
+    BOOST_THROW_EXCEPTION(std::runtime_error(path + " can't capture video"));
+  name_ = reinterpret_cast<const char *>(caps.card);
+
+  struct v4l2_fmtdesc desc;
+  std::memset(&desc, 0, sizeof(desc));
+  desc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  while (xioctl(fd_, VIDIOC_ENUM_FMT, &desc) == 0) {
+    if (is_source_format(desc.pixelformat))
+      formats_.push_back(desc.pixelformat);
+    desc.index++;
+  }
+
+  // Planar frames only need their chroma rearranged for Android.
+  std::sort(formats_.begin(), formats_.end(), [](std::uint32_t a, std::uint32_t b) {
+    return a == V4L2_PIX_FMT_YUV420 && b != V4L2_PIX_FMT_YUV420;
+  });
+}
+
+V4l2Device::~V4l2Device() { stop(); }
+
+std::vector<V4l2Device::Size> V4l2Device::frame_sizes() const {
+  std::vector<Size> sizes;
+  const auto add = [&](std::uint32_t width, std::uint32_t height) {
+    if (width % 2 != 0 || height % 2 != 0)
+      return;
+    for (const auto &size : sizes) {
+      if (size.width == width && size.height == height)
+        return;
+    }
+    sizes.push_back(Size{width, height});
+  };
+
+  for (const auto format : formats_) {
+    struct v4l2_frmsizeenum frame_size;
+    std::memset(&frame_size, 0, sizeof(frame_size));
+    frame_size.pixel_format = format;
+    while (xioctl(fd_, VIDIOC_ENUM_FRAMESIZES, &frame_size) == 0) {
+      if (frame_size.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
+        add(frame_size.discrete.width, frame_size.discrete.height);
+      } else {
+        const auto &range = frame_size.stepwise;
+        for (const auto &size : common_sizes) {
+          if (size.width >= range.min_width && size.width <= range.max_width &&
+              size.height >= range.min_height && size.height <= range.max_height)
+            add(size.width, size.height);
+        }
+        // All other entries would be the same.
+        break;
+      }
+      frame_size.index++;
+    }
+  }
+
+  std::sort(sizes.begin(), sizes.end(), [](const Size &a, const Size &b) {
+    return a.width * a.height > b.width * b.height;
+  });
+  return sizes;
+}
+
+void V4l2Device::start(const Size &size) {
+  stop();
+
+  format_ = 0;
+  for (const auto format : formats_) {
+    struct v4l2_format fmt;
+    std::memset(&fmt, 0, sizeof(fmt));
+    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    fmt.fmt.pix.width = size.width;
+    fmt.fmt.pix.height = size.height;
+    fmt.fmt.pix.pixelformat = format;
+    fmt.fmt.pix.field = V4L2_FIELD_NONE;
+    if (xioctl(fd_, VIDIOC_S_FMT, &fmt) < 0)
+      continue;
+    // Drivers pick the closest they have, which we can't convert from
+    // when it isn't exactly what we asked for.
+    if (fmt.fmt.pix.pixelformat == format && fmt.fmt.pix.width == size.width &&
+        fmt.fmt.pix.height == size.height &&
+        fmt.fmt.pix.bytesperline == bytes_per_line(format, size.width)) {
+      format_ = format;
+      break;
+    }
+  }
+  if (format_ == 0)
+    BOOST_THROW_EXCEPTION(std::runtime_error(utils::string_format(
+        "%s can't capture %dx%d frames we can convert", name_, size.width, size.height)));
+  frame_size_ = static_cast<std::uint32_t>(frame_size(format_, size.width, size.height));
+
+  struct v4l2_requestbuffers request;
+  std::memset(&request, 0, sizeof(request));
+  request.count = buffer_count;
+  request.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  request.memory = V4L2_MEMORY_MMAP;
+  if (xioctl(fd_, VIDIOC_REQBUFS, &request) < 0)
+    throw_error("Failed to request capture buffers");
+
+  for (std::uint32_t n = 0; n < request.count; n++) {
+    struct v4l2_buffer buffer;
+    std::memset(&buffer, 0, sizeof(buffer));
+    buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buffer.memory = V4L2_MEMORY_MMAP;
+    buffer.index = n;
+    if (xioctl(fd_, VIDIOC_QUERYBUF, &buffer) < 0) {
+      unmap_buffers();
+      throw_error("Failed to query capture buffer");
+    }
+
+    auto addr = ::mmap(nullptr, buffer.length, PROT_READ, MAP_SHARED, fd_, buffer.m.offset);
+    if (addr == MAP_FAILED) {
+      unmap_buffers();
+      throw_error("Failed to map capture buffer");
+    }
+    buffers_.push_back(Buffer{addr, buffer.length});
+
+    if (xioctl(fd_, VIDIOC_QBUF, &buffer) < 0) {
+      unmap_buffers();
+      throw_error("Failed to queue capture buffer");
+    }
+  }
+
+  int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  if (xioctl(fd_, VIDIOC_STREAMON, &type) < 0) {
+    unmap_buffers();
+    throw_error("Failed to start streaming");
+  }
+  streaming_ = true;
+}
+
+void V4l2Device::stop() {
+  if (streaming_) {
+    int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    xioctl(fd_, VIDIOC_STREAMOFF, &type);
+    streaming_ = false;
+  }
+  unmap_buffers();
+}
+
+void V4l2Device::unmap_buffers() {
+  if (buffers_.empty())
+    return;
+
+  for (const auto &buffer : buffers_)
+    ::munmap(buffer.addr, buffer.length);
+  buffers_.clear();
+
+  // Frees the buffers in the driver so that the format can change.
+  struct v4l2_requestbuffers request;
+  std::memset(&request, 0, sizeof(request));
+  request.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  request.memory = V4L2_MEMORY_MMAP;
+  xioctl(fd_, VIDIOC_REQBUFS, &request);
+}
+
+bool V4l2Device::next_frame(const std::chrono::milliseconds &timeout,
+                            const FrameConsumer &consumer) {
+  if (!streaming_)
+    return false;
+
+  struct pollfd pfd{fd_, POLLIN, 0};
+  const auto ret = ::poll(&pfd, 1, static_cast<int>(timeout.count()));
+  if (ret < 0 && errno != EINTR)
+    throw_error("Failed to wait for frame");
+  if (ret <= 0)
+    return false;
+
+  struct v4l2_buffer buffer;
+  std::memset(&buffer, 0, sizeof(buffer));
+  buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  buffer.memory = V4L2_MEMORY_MMAP;
+  if (xioctl(fd_, VIDIOC_DQBUF, &buffer) < 0) {
+    if (errno == EAGAIN)
+      return false;
+    throw_error("Failed to dequeue frame");
+  }
+
+  // Frames the driver itself flagged as broken or which are short are
+  // better dropped than shown.
+  const auto &mapped = buffers_.at(buffer.index);
+  if (!(buffer.flags & V4L2_BUF_FLAG_ERROR) && buffer.bytesused >= frame_size_)
+    consumer(static_cast<const std::uint8_t *>(mapped.addr), frame_size_);
+
+  if (xioctl(fd_, VIDIOC_QBUF, &buffer) < 0)
+    throw_error("Failed to queue capture buffer");
+  return true;
+}
+}  // namespace camera
+}  // namespace anbox
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef ANBOX_CAMERA_V4L2_DEVICE_H_
+#define ANBOX_CAMERA_V4L2_DEVICE_H_
+
+#include "anbox/common/fd.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace anbox {
+namespace camera {
+// A host camera we capture from through memory mapped V4L2 buffers.
+// Frames are handed out while they're still in the buffer the driver
+// wrote them to.
+//
+// All errors are thrown as std::runtime_error.
+class V4l2Device {
+ public:
+  struct Size {
+    std::uint32_t width;
+    std::uint32_t height;
+  };
+
+  typedef std::function<void(const std::uint8_t *, std::size_t)> FrameConsumer;
+
+  // Paths of all devices on the host which can capture video.
+  static std::vector<std::string> available_devices();
+
+  explicit V4l2Device(const std::string &path);
+  ~V4l2Device();
+
+  V4l2Device(const V4l2Device &) = delete;
+  V4l2Device &operator=(const V4l2Device &) = delete;
+
+  std::string name() const { return name_; }
+
+  // Frame sizes the device captures in a format we can convert from,
+  // largest first.
+  std::vector<Size> frame_sizes() const;
+
+  // Starts streaming at |size| in the best format we can convert from.
+  void start(const Size &size);
+  void stop();
+
+  // Format the device streams in since start().
+  std::uint32_t format() const { return format_; }
+
+  // Waits up to |timeout| for the next frame and passes it to |consumer|.
+  // Returns false when no frame arrived in time.
+  bool next_frame(const std::chrono::milliseconds &timeout, const FrameConsumer &consumer);
+
+ private:
+  struct Buffer {
+    void *addr;
+    std::size_t length;
+  };
+
+  void unmap_buffers();
+
+  Fd fd_;
+  std::string name_;
+  std::vector<std::uint32_t> formats_;
+  std::uint32_t format_;
+  std::uint32_t frame_size_;
+  std::vector<Buffer> buffers_;
+  bool streaming_;
+};
+}  // namespace camera
+}  // namespace anbox
+
+#endif
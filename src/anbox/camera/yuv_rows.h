@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef ANBOX_CAMERA_YUV_ROWS_H_
+#define ANBOX_CAMERA_YUV_ROWS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+// Converts single rows of camera frames, with SSE2 or NEON when the target
+// has them. Both are part of the base instruction set of x86_64 and arm64
+// so there is nothing to detect at runtime there.
+//
+// Only depends on the standard library as the Android camera HAL shares it.
+namespace anbox {
+namespace camera {
+namespace detail {
+inline std::uint8_t clamp_color(int value) {
+  return static_cast<std::uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+// BT.601 with video range.
+inline void yuv_to_rgb32(int y, int u, int v, std::uint8_t *rgb) {
+  const int c = 298 * (y - 16);
+  const int d = u - 128;
+  const int e = v - 128;
+  rgb[0] = clamp_color((c + 409 * e + 128) >> 8);
+  rgb[1] = clamp_color((c - 100 * d - 208 * e + 128) >> 8);
+  rgb[2] = clamp_color((c + 516 * d + 128) >> 8);
+  rgb[3] = 0xff;
+}
+
+#if defined(__SSE2__)
+// Converts eight pixels sharing the four chroma samples in |u| and |v|.
+inline void yuv_to_rgb32_x8(const std::uint8_t *y, const std::uint8_t *u,
+                            const std::uint8_t *v, std::uint8_t *rgb) {
+  const __m128i zero = _mm_setzero_si128();
+  std::int32_t u4 = 0, v4 = 0;
+  std::memcpy(&u4, u, sizeof(u4));
+  std::memcpy(&v4, v, sizeof(v4));
+
+  // Every chroma sample belongs to two pixels.
+  __m128i uu = _mm_cvtsi32_si128(u4);
+  __m128i vv = _mm_cvtsi32_si128(v4);
+  uu = _mm_unpacklo_epi8(_mm_unpacklo_epi8(uu, uu), zero);
+  vv = _mm_unpacklo_epi8(_mm_unpacklo_epi8(vv, vv), zero);
+  const __m128i yy = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(y)), zero);
+
+  const __m128i c = _mm_sub_epi16(yy, _mm_set1_epi16(16));
+  const __m128i d = _mm_sub_epi16(uu, _mm_set1_epi16(128));
+  const __m128i e = _mm_sub_epi16(vv, _mm_set1_epi16(128));
+
+  // Pairs of 16 bit values multiplied and summed up into 32 bit keep the
+  // results exactly the same as the scalar ones.
+  const __m128i round = _mm_set1_epi32(128);
+  const __m128i k_r = _mm_set_epi16(409, 298, 409, 298, 409, 298, 409, 298);
+  const __m128i k_g = _mm_set_epi16(-100, 298, -100, 298, -100, 298, -100, 298);
+  const __m128i k_g_v = _mm_set_epi16(0, -208, 0, -208, 0, -208, 0, -208);
+  const __m128i k_b = _mm_set_epi16(516, 298, 516, 298, 516, 298, 516, 298);
+
+  const __m128i ce_lo = _mm_unpacklo_epi16(c, e), ce_hi = _mm_unpackhi_epi16(c, e);
+  const __m128i cd_lo = _mm_unpacklo_epi16(c, d), cd_hi = _mm_unpackhi_epi16(c, d);
+  const __m128i e_lo = _mm_unpacklo_epi16(e, zero), e_hi = _mm_unpackhi_epi16(e, zero);
+
+  const auto channel = [&](const __m128i &lo, const __m128i &hi) {
+    return _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(lo, round), 8),
+                           _mm_srai_epi32(_mm_add_epi32(hi, round), 8));
+  };
+  const __m128i r = channel(_mm_madd_epi16(ce_lo, k_r), _mm_madd_epi16(ce_hi, k_r));
+  const __m128i g = channel(_mm_add_epi32(_mm_madd_epi16(cd_lo, k_g), _mm_madd_epi16(e_lo, k_g_v)),
+                            _mm_add_epi32(_mm_madd_epi16(cd_hi, k_g), _mm_madd_epi16(e_hi, k_g_v)));
+  const __m128i b = channel(_mm_madd_epi16(cd_lo, k_b), _mm_madd_epi16(cd_hi, k_b));
+
+  const __m128i rg = _mm_unpacklo_epi8(_mm_packus_epi16(r, r), _mm_packus_epi16(g, g));
+  const __m128i ba = _mm_unpacklo_epi8(_mm_packus_epi16(b, b), _mm_set1_epi8(-1));
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(rgb), _mm_unpacklo_epi16(rg, ba));
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(rgb + 16), _mm_unpackhi_epi16(rg, ba));
+}
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+inline void yuv_to_rgb32_x8(const std::uint8_t *y, const std::uint8_t *u,
+                            const std::uint8_t *v, std::uint8_t *rgb) {
+  std::uint8_t u8[8], v8[8];
+  for (int n = 0; n < 4; n++) {
+    u8[2 * n] = u8[2 * n + 1] = u[n];
+    v8[2 * n] = v8[2 * n + 1] = v[n];
+  }
+
+  const int16x8_t c = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(y))), vdupq_n_s16(16));
+  const int16x8_t d = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(u8))), vdupq_n_s16(128));
+  const int16x8_t e = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(v8))), vdupq_n_s16(128));
+
+  const int32x4_t round = vdupq_n_s32(128);
+  const int32x4_t c_lo = vmlal_n_s16(round, vget_low_s16(c), 298);
+  const int32x4_t c_hi = vmlal_n_s16(round, vget_high_s16(c), 298);
+
+  const auto channel = [](const int32x4_t &lo, const int32x4_t &hi) {
+    return vqmovun_s16(vcombine_s16(vqmovn_s32(vshrq_n_s32(lo, 8)), vqmovn_s32(vshrq_n_s32(hi, 8))));
+  };
+
+  uint8x8x4_t out;
+  out.val[0] = channel(vmlal_n_s16(c_lo, vget_low_s16(e), 409),
+                       vmlal_n_s16(c_hi, vget_high_s16(e), 409));
+  out.val[1] = channel(vmlal_n_s16(vmlal_n_s16(c_lo, vget_low_s16(d), -100), vget_low_s16(e), -208),
+                       vmlal_n_s16(vmlal_n_s16(c_hi, vget_high_s16(d), -100), vget_high_s16(e), -208));
+  out.val[2] = channel(vmlal_n_s16(c_lo, vget_low_s16(d), 516),
+                       vmlal_n_s16(c_hi, vget_high_s16(d), 516));
+  out.val[3] = vdup_n_u8(0xff);
+  vst4_u8(rgb, out);
+}
+#endif
+}  // namespace detail
+
+// Converts |width| pixels to R, G, B, X. Chroma samples, one per two
+// pixels, are |uv_step| bytes apart, i.e. 1 for planar and 2 for semi
+// planar formats.
+inline void yuv_row_to_rgb32(const std::uint8_t *y, const std::uint8_t *u, const std::uint8_t *v,
+                             std::size_t uv_step, std::uint8_t *rgb, std::size_t width) {
+  std::size_t x = 0;
+#if defined(__SSE2__) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+  std::uint8_t u4[4], v4[4];
+  for (; x + 8 <= width; x += 8) {
+    const auto chroma = (x / 2) * uv_step;
+    if (uv_step == 1) {
+      detail::yuv_to_rgb32_x8(y + x, u + chroma, v + chroma, rgb + x * 4);
+      continue;
+    }
+    for (std::size_t n = 0; n < 4; n++) {
+      u4[n] = u[chroma + n * uv_step];
+      v4[n] = v[chroma + n * uv_step];
+    }
+    detail::yuv_to_rgb32_x8(y + x, u4, v4, rgb + x * 4);
+  }
+#endif
+  for (; x < width; x++) {
+    const auto chroma = (x / 2) * uv_step;
+    detail::yuv_to_rgb32(y[x], u[chroma], v[chroma], rgb + x * 4);
+  }
+}
+
+// Interleaves |count| samples of |first| and |second| into |dst|, as
+// needed for the chroma planes of NV12 and NV21.
+inline void interleave_row(const std::uint8_t *first, const std::uint8_t *second,
+                           std::uint8_t *dst, std::size_t count) {
+  std::size_t n = 0;
+#if defined(__SSE2__)
+  for (; n + 16 <= count; n += 16) {
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first + n));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(second + n));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 2 * n), _mm_unpacklo_epi8(a, b));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 2 * n + 16), _mm_unpackhi_epi8(a, b));
+  }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  for (; n + 16 <= count; n += 16) {
+    uint8x16x2_t out;
+    out.val[0] = vld1q_u8(first + n);
+    out.val[1] = vld1q_u8(second + n);
+    vst2q_u8(dst + 2 * n, out);
+  }
+#endif
+  for (; n < count; n++) {
+    dst[2 * n] = first[n];
+    dst[2 * n + 1] = second[n];
+  }
+}
+}  // namespace camera
+}  // namespace anbox
+
+#endif
@@ -16,8 +16,12 @@
  */
 
 #include "anbox/cmds/container_manager.h"
+#include "anbox/container/binder_tracer.h"
 #include "anbox/container/service.h"
-#include "anbox/common/loop_device_allocator.h"
+#include "anbox/container/reattach_pool.h"
+#include "anbox/container/standby_pool.h"
+#include "anbox/common/image_mount.h"
+#include "anbox/utils.h"
 #include "anbox/logger.h"
 #include "anbox/runtime.h"
 #include "anbox/config.h"
@@ -27,12 +31,39 @@
 #include <sys/mount.h>
 #include <linux/loop.h>
 #include <fcntl.h>
+#include <pwd.h>
+
+#include <boost/algorithm/string/trim.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <set>
 
 namespace fs = boost::filesystem;
 
 namespace {
-constexpr unsigned int unprivileged_user_id{100000};
+const boost::posix_time::seconds binder_statistics_interval{5};
+
+void write_binder_statistics(anbox::container::BinderStatistics &statistics,
+                             const std::string &path) {
+  // Scrapers must never see a partially written file.
+  const auto tmp_path = path + ".tmp";
+  {
+    std::ofstream out(tmp_path, std::ios::trunc);
+    statistics.write_prometheus(out);
+    if (!out) {
+      ERROR("Failed to write binder statistics to %s", tmp_path);
+      return;
+    }
+  }
+
+  boost::system::error_code err;
+  fs::rename(tmp_path, path, err);
+  if (err)
+    ERROR("Failed to write binder statistics to %s: %s", path, err.message());
 }
+}  // namespace
+
 
 anbox::cmds::ContainerManager::ContainerManager()
     : CommandWithFlagsAndAction{
@@ -48,6 +79,57 @@ anbox::cmds::ContainerManager::ContainerManager()
   flag(cli::make_flag(cli::Name{"privileged"},
                       cli::Description{"Run Android container in privileged mode"},
                       privileged_));
+  flag(cli::make_flag(cli::Name{"instances"},
+                      cli::Description{"Comma separated names of the Android instances to run. Each gets its own container, writable layer on top of the shared Android image, data and range of user ids"},
+                      instances_));
+  flag(cli::make_flag(cli::Name{"checkpoints"},
+                      cli::Description{"Checkpoint containers of booted sessions through CRIU when they are stopped and restore them at their next start instead of booting Android. CRIU has to be configured to dump external unix sockets"},
+                      checkpoints_));
+  flag(cli::make_flag(cli::Name{"keep-image-mounted"},
+                      cli::Description{"Leave the Android image mounted on exit so that the next start reuses it and finds it still in the page cache"},
+                      keep_image_mounted_));
+  flag(cli::make_flag(cli::Name{"readahead-profile"},
+                      cli::Description{"Record which parts of the Android image booting Android reads to the given file and read them ahead at the next start while the container is set up. The profile is recorded again once the image changes"},
+                      readahead_profile_path_));
+  flag(cli::make_flag(cli::Name{"standby-instances"},
+                      cli::Description{"Comma separated names of instances whose container is booted before a session connects and again once it is gone. Sessions started with --standby take one of them over right away"},
+                      standby_instances_));
+  flag(cli::make_flag(cli::Name{"standby-user"},
+                      cli::Description{"Name or id of the user running the sessions standby containers are booted for"},
+                      standby_user_));
+  flag(cli::make_flag(cli::Name{"reattach-timeout"},
+                      cli::Description{"Seconds to keep the container of a session which went away without stopping it, e.g. because it crashed, running for the next session of the same user to continue instead of booting Android again, 0 to stop it right away. Doesn't apply to standby instances"},
+                      reattach_timeout_));
+  flag(cli::make_flag(cli::Name{"cpu-max"},
+                      cli::Description{"Largest share of the CPUs each container may use in percent of a single one, 0 for no limit"},
+                      cpu_max_));
+  flag(cli::make_flag(cli::Name{"cpu-weight"},
+                      cli::Description{"CPU weight of each container between 1 and 10000. Everything not configured otherwise has a weight of 100"},
+                      cpu_weight_));
+  flag(cli::make_flag(cli::Name{"memory-high"},
+                      cli::Description{"Memory in MiB above which a container gets throttled and reclaimed from, 0 for no limit"},
+                      memory_high_));
+  flag(cli::make_flag(cli::Name{"memory-max"},
+                      cli::Description{"Memory in MiB at which a container gets killed, 0 for no limit"},
+                      memory_max_));
+  flag(cli::make_flag(cli::Name{"io-max"},
+                      cli::Description{"Semicolon separated IO limits per block device of each container in the format of the io.max cgroup file, e.g. '8:0 rbps=1048576 wiops=120'"},
+                      io_max_));
+  flag(cli::make_flag(cli::Name{"network-mode"},
+                      cli::Description{"How containers are connected to the network: 'bridge' through a veth pair on the bridge given by --network-link or anboxbr0, 'macvlan' with a device of their own on the network of --network-link, 'host' in the network namespace of the host or 'none'"},
+                      network_mode_));
+  flag(cli::make_flag(cli::Name{"network-link"},
+                      cli::Description{"Bridge or parent device of the container networks, see --network-mode"},
+                      network_link_));
+  flag(cli::make_flag(cli::Name{"veth-gro"},
+                      cli::Description{"Enable generic receive offload on both ends of the veth pairs of bridged containers"},
+                      veth_gro_));
+  flag(cli::make_flag(cli::Name{"veth-queues"},
+                      cli::Description{"Number of queues of both ends of the veth pairs of bridged containers, 0 to keep what the kernel creates them with"},
+                      veth_queues_));
+  flag(cli::make_flag(cli::Name{"binder-stats"},
+                      cli::Description{"Path to periodically write binder transaction rates and delivery latencies of all container processes to, in the Prometheus text format. Needs tracefs and the tracepoints of the binder driver"},
+                      binder_stats_path_));
 
   action([&](const cli::Command::Context&) {
     try {
@@ -61,11 +143,101 @@ anbox::cmds::ContainerManager::ContainerManager()
       if (!data_path_.empty())
         SystemConfiguration::instance().set_data_path(data_path_);
 
-      if (!setup_mounts())
+      const auto instances = container::Instance::parse(instances_);
+      if (!setup_mounts(instances))
         return EXIT_FAILURE;
 
+      std::set<std::string> standby_names;
+      for (const auto &name : utils::string_split(standby_instances_, ',')) {
+        if (name.empty())
+          continue;
+        if (std::find_if(instances.begin(), instances.end(), [&](const container::Instance &instance) {
+              return instance.name == name;
+            }) == instances.end()) {
+          ERROR("Standby instance %s is not one of the instances to run", name);
+          return EXIT_FAILURE;
+        }
+        standby_names.insert(name);
+      }
+
+      std::unique_ptr<network::Credentials> standby_creds;
+      if (!standby_names.empty()) {
+        if (standby_user_.empty()) {
+          ERROR("Standby containers need the user they are booted for");
+          return EXIT_FAILURE;
+        }
+        auto pw = ::getpwnam(standby_user_.c_str());
+        if (!pw && std::all_of(standby_user_.begin(), standby_user_.end(), ::isdigit))
+          pw = ::getpwuid(std::stoul(standby_user_));
+        if (!pw) {
+          ERROR("Unknown standby user %s", standby_user_);
+          return EXIT_FAILURE;
+        }
+        standby_creds.reset(new network::Credentials(0, pw->pw_uid, pw->pw_gid));
+      }
+
+      container::ResourceLimits resources;
+      resources.cpu_max = cpu_max_;
+      resources.cpu_weight = cpu_weight_;
+      resources.memory_high = memory_high_ * 1024 * 1024;
+      resources.memory_max = memory_max_ * 1024 * 1024;
+      for (const auto &line : utils::string_split(io_max_, ';')) {
+        const auto limit = boost::algorithm::trim_copy(line);
+        if (!limit.empty())
+          resources.io_max.push_back(limit);
+      }
+      resources.validate();
+
+      container::NetworkSettings network;
+      network.mode = container::NetworkSettings::parse_mode(network_mode_);
+      network.link = network_link_;
+      network.gro = veth_gro_;
+      network.queues = veth_queues_;
+      network.validate();
+
       auto rt = Runtime::create();
-      auto service = container::Service::create(rt, privileged_);
+      std::vector<std::shared_ptr<container::Service>> services;
+      std::vector<std::shared_ptr<container::Service>> standby_services;
+      std::vector<std::shared_ptr<container::Service>> reattach_services;
+      for (const auto &instance : instances) {
+        services.push_back(container::Service::create(rt, privileged_, instance, checkpoints_,
+                                                      resources, network));
+        if (standby_names.count(instance.name) > 0) {
+          services.back()->keep_standby(*standby_creds);
+          standby_services.push_back(services.back());
+        } else if (reattach_timeout_ > 0) {
+          services.back()->keep_detached(std::chrono::seconds{reattach_timeout_});
+          reattach_services.push_back(services.back());
+        }
+      }
+
+      std::shared_ptr<container::StandbyPool> standby_pool;
+      if (!standby_services.empty())
+        standby_pool = container::StandbyPool::create(rt, standby_services);
+
+      std::shared_ptr<container::ReattachPool> reattach_pool;
+      if (!reattach_services.empty())
+        reattach_pool = container::ReattachPool::create(rt, reattach_services);
+
+      auto binder_statistics = std::make_shared<container::BinderStatistics>();
+      std::unique_ptr<container::BinderTracer> binder_tracer;
+      boost::asio::deadline_timer binder_statistics_timer(rt->service());
+      std::function<void(const boost::system::error_code &)> write_statistics =
+          [&](const boost::system::error_code &err) {
+            if (err)
+              return;
+            write_binder_statistics(*binder_statistics, binder_stats_path_);
+            binder_statistics_timer.expires_from_now(binder_statistics_interval);
+            binder_statistics_timer.async_wait(write_statistics);
+          };
+      if (!binder_stats_path_.empty()) {
+        try {
+          binder_tracer.reset(new container::BinderTracer(binder_statistics));
+          write_statistics(boost::system::error_code{});
+        } catch (std::exception &err) {
+          WARNING("Not collecting binder statistics: %s", err.what());
+        }
+      }
 
       rt->start();
       trap->run();
@@ -81,7 +253,7 @@ anbox::cmds::ContainerManager::ContainerManager()
 
 anbox::cmds::ContainerManager::~ContainerManager() {}
 
-bool anbox::cmds::ContainerManager::setup_mounts() {
+bool anbox::cmds::ContainerManager::setup_mounts(const std::vector<container::Instance> &instances) {
   fs::path android_img_path = android_img_path_;
   if (android_img_path.empty())
     android_img_path = SystemConfiguration::instance().data_dir() / "android.img";
@@ -91,59 +263,93 @@ bool anbox::cmds::ContainerManager::setup_mounts() {
     return false;
   }
 
-  const auto android_rootfs_dir = SystemConfiguration::instance().rootfs_dir();
-  if (utils::is_mounted(android_rootfs_dir)) {
-    ERROR("Androd rootfs is already mounted!?");
-    return false;
+  // Reading ahead overlaps with everything else we do until Android
+  // reads the image itself.
+  if (!readahead_profile_path_.empty()) {
+    readahead_profile_.reset(new common::ReadaheadProfile(android_img_path, readahead_profile_path_));
+    readahead_profile_->start();
   }
 
+  // The image is only mounted once for all instances so that they share
+  // its pages in the page cache.
+  const auto android_rootfs_dir = SystemConfiguration::instance().image_dir();
   if (!fs::exists(android_rootfs_dir))
     fs::create_directory(android_rootfs_dir);
 
-  auto loop_device = common::LoopDeviceAllocator::new_device();
-  if (!loop_device)
+  image_mount_ = common::ImageMount::acquire(android_img_path, android_rootfs_dir);
+  if (!image_mount_) {
+    ERROR("Failed to mount Android rootfs");
     return false;
+  }
+  image_mount_->keep_mounted(keep_image_mounted_);
+  if (image_mount_->reused())
+    INFO("Reusing Android rootfs which is still mounted");
 
-  if (!loop_device->attach_file(android_img_path)) {
-    ERROR("Failed to attach Android rootfs image to loopback device");
-    return false;
+  for (const auto &instance : instances) {
+    if (!setup_instance_mounts(instance)) {
+      mounts_.clear();
+      image_mount_.reset();
+      return false;
+    }
   }
 
-  auto m = common::MountEntry::create(loop_device, android_rootfs_dir, "squashfs", MS_MGC_VAL | MS_RDONLY | MS_PRIVATE);
-  if (!m) {
-    ERROR("Failed to mount Android rootfs");
-    return false;
+  // Unmounting needs to happen in reverse order
+  std::reverse(mounts_.begin(), mounts_.end());
+
+  return true;
+}
+
+bool anbox::cmds::ContainerManager::setup_instance_mounts(const container::Instance &instance) {
+  const auto &config = SystemConfiguration::instance();
+  const auto instance_dir = config.instance_dir(instance.name);
+  const auto rootfs_dir = fs::path(config.rootfs_dir(instance.name));
+
+  // All other instances write to their own layer on top of the image so
+  // that they only pay for what they change.
+  if (instance.name != SystemConfiguration::default_instance) {
+    if (utils::is_mounted(rootfs_dir.string())) {
+      ERROR("Rootfs of instance %s is already mounted!?", instance.name);
+      return false;
+    }
+
+    const auto upper_dir = instance_dir / "rootfs-upper";
+    const auto work_dir = instance_dir / "rootfs-work";
+    utils::ensure_paths({rootfs_dir.string(), upper_dir.string(), work_dir.string()});
+
+    auto m = common::MountEntry::create(
+        "overlay", rootfs_dir, "overlay", MS_MGC_VAL,
+        utils::string_format("lowerdir=%s,upperdir=%s,workdir=%s", config.image_dir(),
+                             upper_dir.string(), work_dir.string()));
+    if (!m) {
+      ERROR("Failed to mount rootfs of instance %s", instance.name);
+      return false;
+    }
+    mounts_.push_back(m);
   }
-  mounts_.push_back(m);
 
   for (const auto &dir_name : std::vector<std::string>{"cache", "data"}) {
-    auto target_dir_path = fs::path(android_rootfs_dir) / dir_name;
-    auto src_dir_path = SystemConfiguration::instance().data_dir() / dir_name;
+    auto target_dir_path = rootfs_dir / dir_name;
+    auto src_dir_path = instance_dir / dir_name;
 
     if (!fs::exists(src_dir_path)) {
-      if (!fs::create_directory(src_dir_path)) {
-        ERROR("Failed to create Android %s directory", dir_name);
-        mounts_.clear();
+      if (!fs::create_directories(src_dir_path)) {
+        ERROR("Failed to create Android %s directory of instance %s", dir_name, instance.name);
         return false;
       }
-      if (::chown(src_dir_path.c_str(), unprivileged_user_id, unprivileged_user_id) != 0) {
-        ERROR("Failed to allow access for unprivileged user on %s directory of the rootfs", dir_name);
-        mounts_.clear();
+      if (::chown(src_dir_path.c_str(), instance.base_id, instance.base_id) != 0) {
+        ERROR("Failed to allow access for unprivileged user on %s directory of instance %s",
+              dir_name, instance.name);
         return false;
       }
     }
 
     auto m = common::MountEntry::create(src_dir_path, target_dir_path, "", MS_MGC_VAL | MS_BIND | MS_PRIVATE);
     if (!m) {
-      ERROR("Failed to mount Android %s directory", dir_name);
-      mounts_.clear();
+      ERROR("Failed to mount Android %s directory of instance %s", dir_name, instance.name);
       return false;
     }
     mounts_.push_back(m);
   }
 
-  // Unmounting needs to happen in reverse order
-  std::reverse(mounts_.begin(), mounts_.end());
-
   return true;
 }
@@ -23,9 +23,13 @@
 #include <memory>
 
 #include "anbox/cli.h"
+#include "anbox/config.h"
 
-#include "anbox/common/loop_device.h"
+#include "anbox/common/image_mount.h"
 #include "anbox/common/mount_entry.h"
+#include "anbox/common/readahead_profile.h"
+#include "anbox/container/instance.h"
+#include "anbox/container/resource_limits.h"
 
 namespace anbox {
 namespace cmds {
@@ -35,13 +39,33 @@ class ContainerManager : public cli::CommandWithFlagsAndAction {
   ~ContainerManager();
 
  private:
-  bool setup_mounts();
+  bool setup_mounts(const std::vector<container::Instance> &instances);
+  bool setup_instance_mounts(const container::Instance &instance);
 
   std::string android_img_path_;
   std::string data_path_;
-  std::shared_ptr<common::LoopDevice> android_img_loop_dev_;
+  std::string readahead_profile_path_;
+  std::unique_ptr<common::ReadaheadProfile> readahead_profile_;
+  // Declared before everything mounted on top of it so that it goes last.
+  std::shared_ptr<common::ImageMount> image_mount_;
   std::vector<std::shared_ptr<common::MountEntry>> mounts_;
   bool privileged_ = false;
+  bool keep_image_mounted_ = false;
+  bool checkpoints_ = false;
+  std::string instances_ = SystemConfiguration::default_instance;
+  std::string standby_instances_;
+  std::string standby_user_;
+  unsigned int reattach_timeout_ = 0;
+  unsigned int cpu_max_ = 0;
+  unsigned int cpu_weight_ = container::ResourceLimits::default_cpu_weight;
+  std::uint64_t memory_high_ = 0;
+  std::uint64_t memory_max_ = 0;
+  std::string io_max_;
+  std::string network_mode_ = "bridge";
+  std::string network_link_;
+  bool veth_gro_ = false;
+  unsigned int veth_queues_ = 0;
+  std::string binder_stats_path_;
 };
 }  // namespace cmds
 }  // namespace anbox
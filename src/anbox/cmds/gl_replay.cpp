@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "anbox/cmds/gl_replay.h"
+#include "anbox/graphics/command_profiler.h"
+#include "anbox/graphics/emugl/RenderControl.h"
+#include "anbox/graphics/emugl/RenderThread.h"
+#include "anbox/graphics/emugl/Renderer.h"
+#include "anbox/graphics/stream_replayer.h"
+#include "anbox/logger.h"
+
+#include <chrono>
+
+namespace {
+double to_seconds(const std::chrono::nanoseconds &d) {
+  return std::chrono::duration_cast<std::chrono::duration<double>>(d).count();
+}
+}  // namespace
+
+anbox::cmds::GlReplay::GlReplay()
+    : CommandWithFlagsAndAction{
+          cli::Name{"anbox-gl-replay"}, cli::Usage{"anbox-gl-replay"},
+          cli::Description{"Replay a captured GL stream against an offscreen renderer"}},
+      loops_{1},
+      gles_driver_{graphics::GLRendererServer::Config::Driver::Translator},
+      profile_{false} {
+  flag(cli::make_flag(cli::Name{"capture"},
+                      cli::Description{"Capture recorded with the --gl-capture option of the session manager"},
+                      capture_path_));
+  flag(cli::make_flag(cli::Name{"loops"},
+                      cli::Description{"How often the capture is replayed"},
+                      loops_));
+  flag(cli::make_flag(cli::Name{"gles-driver"},
+                      cli::Description{"Which GLES driver to use. Possible values are 'host' or 'translator'"},
+                      gles_driver_));
+  flag(cli::make_flag(cli::Name{"profile"},
+                      cli::Description{"Profile all replayed commands and print a summary at the end"},
+                      profile_));
+
+  action([this](const cli::Command::Context &ctxt) {
+    if (capture_path_.empty()) {
+      ctxt.cout << "No capture given" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    graphics::GLRendererServer::initialize_gl_libraries(gles_driver_);
+
+    std::shared_ptr<graphics::CommandProfiler> profiler;
+    if (profile_)
+      profiler = RenderThread::createCommandProfiler();
+
+    for (unsigned int n = 0; n < loops_; n++) {
+      // Every loop starts from scratch as the capture relies on the handles
+      // the renderer hands out from the beginning of a session.
+      auto renderer = std::make_shared<::Renderer>();
+      if (!renderer->initialize(0, true)) {
+        ERROR("Failed to initialize offscreen renderer");
+        return EXIT_FAILURE;
+      }
+      if (profiler)
+        renderer->setCommandProfiler(profiler);
+      registerRenderer(renderer);
+
+      graphics::StreamCapture::Reader reader(capture_path_);
+      const auto stats = graphics::StreamReplayer(renderer).replay(reader);
+
+      registerRenderer(nullptr);
+      renderer->finalize();
+
+      const auto elapsed = to_seconds(stats.elapsed);
+      ctxt.cout << "Loop " << n + 1 << ": replayed " << stats.bytes << " bytes of "
+                << stats.streams << " streams in " << elapsed << "s ("
+                << (elapsed > 0.0 ? stats.bytes / elapsed / (1024.0 * 1024.0) : 0.0)
+                << " MB/s), captured session took " << to_seconds(stats.captured) << "s"
+                << std::endl;
+    }
+
+    if (profiler)
+      profiler->write_summary(ctxt.cout);
+
+    return EXIT_SUCCESS;
+  });
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef ANBOX_CMDS_GL_REPLAY_H_
+#define ANBOX_CMDS_GL_REPLAY_H_
+
+#include <string>
+
+#include "anbox/cli.h"
+#include "anbox/graphics/gl_renderer_server.h"
+
+namespace anbox {
+namespace cmds {
+// Replays a GL stream capture recorded by the session manager against an
+// offscreen renderer as fast as possible to benchmark the host side of
+// the GL pipeline without any guest involved.
+class GlReplay : public cli::CommandWithFlagsAndAction {
+ public:
+  GlReplay();
+
+ private:
+  std::string capture_path_;
+  unsigned int loops_;
+  graphics::GLRendererServer::Config::Driver gles_driver_;
+  bool profile_;
+};
+}  // namespace cmds
+}  // namespace anbox
+
+#endif
@@ -28,24 +28,49 @@
 #include "anbox/bridge/platform_api_skeleton.h"
 #include "anbox/bridge/platform_message_processor.h"
 #include "anbox/cmds/session_manager.h"
+#include "anbox/common/async_logger.h"
+#include "anbox/common/boot_timeline.h"
 #include "anbox/common/dispatcher.h"
+#include "anbox/common/handler_statistics.h"
+#include "anbox/common/memory_usage.h"
+#include "anbox/common/metrics.h"
+#include "anbox/common/tracer.h"
 #include "anbox/config.h"
+#include "anbox/container/binder_device.h"
 #include "anbox/container/client.h"
+#include "anbox/container/instance.h"
+#include "anbox/container/reattach_pool.h"
+#include "anbox/container/standby_pool.h"
 #include "anbox/dbus/skeleton/service.h"
+#include "anbox/graphics/adaptive_resolution.h"
 #include "anbox/graphics/gl_renderer_server.h"
+#include "anbox/graphics/remote_gl_connection_creator.h"
+#include "anbox/input/latency_statistics.h"
 #include "anbox/input/manager.h"
 #include "anbox/logger.h"
+#include "anbox/network/deferred_connection_creator.h"
+#include "anbox/network/metrics_endpoint.h"
 #include "anbox/network/published_socket_connector.h"
+#include "anbox/network/tcp_socket_connector.h"
+#include "anbox/platform/headless_policy.h"
+#include "anbox/qemu/boot_properties.h"
 #include "anbox/qemu/pipe_connection_creator.h"
 #include "anbox/rpc/channel.h"
 #include "anbox/rpc/connection_creator.h"
 #include "anbox/runtime.h"
 #include "anbox/ubuntu/platform_policy.h"
 #include "anbox/wm/multi_window_manager.h"
+#include "anbox/wm/window_preparing_manager.h"
 #include "anbox/wm/single_window_manager.h"
 
 #include "external/xdg/xdg.h"
 
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <sstream>
+
 #include <sys/prctl.h>
 
 #include <core/dbus/asio/executor.h>
@@ -56,6 +81,7 @@ namespace fs = boost::filesystem;
 
 namespace {
 const anbox::graphics::Rect default_single_window_size{0, 0, 1024, 768};
+const boost::posix_time::seconds frame_statistics_interval{5};
 
 class NullConnectionCreator : public anbox::network::ConnectionCreator<
                                   boost::asio::local::stream_protocol> {
@@ -68,15 +94,29 @@ class NullConnectionCreator : public anbox::network::ConnectionCreator<
   }
 };
 
-std::istream& operator>>(std::istream& in, anbox::graphics::GLRendererServer::Config::Driver& driver) {
-  std::string str(std::istreambuf_iterator<char>(in), {});
-  if (str.empty() || str == "translator")
-    driver = anbox::graphics::GLRendererServer::Config::Driver::Translator;
-  else if (str == "host")
-    driver = anbox::graphics::GLRendererServer::Config::Driver::Host;
-  else
-   BOOST_THROW_EXCEPTION(std::runtime_error("Invalid GLES driver value provided"));
-  return in;
+// Parses <address>:<port> with an IPv4 address, or just <port> for the
+// loopback address.
+bool parse_endpoint(const std::string &endpoint, boost::asio::ip::address_v4 &address,
+                    unsigned short &port) {
+  const auto sep = endpoint.rfind(':');
+  if (sep == std::string::npos) {
+    address = boost::asio::ip::address_v4::loopback();
+  } else {
+    boost::system::error_code err;
+    address = boost::asio::ip::address_v4::from_string(endpoint.substr(0, sep), err);
+    if (err)
+      return false;
+  }
+
+  try {
+    const auto value = std::stoul(sep == std::string::npos ? endpoint : endpoint.substr(sep + 1));
+    if (value == 0 || value > 65535)
+      return false;
+    port = static_cast<unsigned short>(value);
+  } catch (const std::exception &) {
+    return false;
+  }
+  return true;
 }
 }
 
@@ -90,7 +130,8 @@ anbox::cmds::SessionManager::SessionManager(const BusFactory &bus_factory)
     : CommandWithFlagsAndAction{cli::Name{"session-manager"}, cli::Usage{"session-manager"},
                                 cli::Description{"Run the the anbox session manager"}},
       bus_factory_(bus_factory),
-      window_size_(default_single_window_size) {
+      window_size_(default_single_window_size),
+      display_size_(graphics::Rect::Invalid) {
   // Just for the purpose to allow QtMir (or unity8) to find this on our
   // /proc/*/cmdline
   // for proper confinement etc.
@@ -104,22 +145,242 @@ anbox::cmds::SessionManager::SessionManager(const BusFactory &bus_factory)
                       cli::Description{"Start in single window mode."},
                       single_window_));
   flag(cli::make_flag(cli::Name{"window-size"},
-                      cli::Description{"Size of the window in single window mode, e.g. --window-size=1024,768"},
+                      cli::Description{"Size of the window in single window mode or of the display in headless mode, e.g. --window-size=1024,768"},
                       window_size_));
+  flag(cli::make_flag(cli::Name{"display-size"},
+                      cli::Description{"Resolution Android renders at in single window mode, independent of the window which is scaled on the GPU and can be resized freely, e.g. --display-size=1280,720"},
+                      display_size_));
+  flag(cli::make_flag(cli::Name{"headless"},
+                      cli::Description{"Render all windows offscreen without connecting to a display server"},
+                      headless_));
+  flag(cli::make_flag(cli::Name{"gl-profile"},
+                      cli::Description{"Profile all GL commands of the guest and write a Chrome trace to the given file on SIGUSR2 and on exit"},
+                      gl_profile_path_));
+  flag(cli::make_flag(cli::Name{"frame-stats"},
+                      cli::Description{"Regularly write per window frame timing, per input device latency and runtime handler statistics in the Prometheus text format to the given file"},
+                      frame_stats_path_));
+  flag(cli::make_flag(cli::Name{"instance"},
+                      cli::Description{"Name of the Android instance of the container manager to run the session for"},
+                      instance_));
+  flag(cli::make_flag(cli::Name{"standby"},
+                      cli::Description{"Take over a standby container the container manager already booted instead of starting one. The session runs for the instance of that container"},
+                      standby_));
+  flag(cli::make_flag(cli::Name{"boot-timeline"},
+                      cli::Description{"Write when the steps of booting Android happened in the Prometheus text format to the given file once boot finished"},
+                      boot_timeline_path_));
+  flag(cli::make_flag(cli::Name{"gl-capture"},
+                      cli::Description{"Record the GL streams of all guest clients to the given file for replaying them with anbox-gl-replay"},
+                      gl_capture_path_));
+  flag(cli::make_flag(cli::Name{"trace"},
+                      cli::Description{"Trace socket reads, GL decoding, composition, audio and input across all threads and write a Chrome trace to the given file on SIGUSR2 and on exit"},
+                      trace_path_));
+  flag(cli::make_flag(cli::Name{"app-profiles"},
+                      cli::Description{"Profile the frames of each Android app in the given file and set up the windows of an app by its profile. The file is updated on SIGUSR2 and on exit"},
+                      app_profiles_path_));
+  flag(cli::make_flag(cli::Name{"remote-gl"},
+                      cli::Description{"Serve GL clients running on another machine on the given IPv4 <address>:<port>, or only on the loopback address with just <port>. Requires --remote-gl-token"},
+                      remote_gl_endpoint_));
+  flag(cli::make_flag(cli::Name{"remote-gl-token"},
+                      cli::Description{"Only serve remote GL clients which send the token in the given file, 64 hex digits. It is sent in the clear, so the port should still only be reachable from trusted machines"},
+                      remote_gl_token_path_));
+  flag(cli::make_flag(cli::Name{"frame-rate-caps"},
+                      cli::Description{"Cap how often the windows of Android apps are composed per second, read as one '<package> <focused fps> <unfocused fps>' line per app from the given file with '*' for all other apps. Zero means no cap. Android renders no faster than the visible window with the highest cap"},
+                      frame_rate_caps_path_));
+  flag(cli::make_flag(cli::Name{"frame-export"},
+                      cli::Description{"Publish the composed frames of all windows as dmabufs on the given socket, e.g. for a hardware video encoder. Requires --headless"},
+                      frame_export_path_));
+  flag(cli::make_flag(cli::Name{"compositor-nice"},
+                      cli::Description{"Nice value of the render threads serving the Android compositor. Raising their priority needs CAP_SYS_NICE"},
+                      thread_policy_.compositor.nice));
+  flag(cli::make_flag(cli::Name{"compositor-cpus"},
+                      cli::Description{"CPUs the render threads serving the Android compositor are pinned to, e.g. --compositor-cpus=0-1"},
+                      thread_policy_.compositor.cpus));
+  flag(cli::make_flag(cli::Name{"render-nice"},
+                      cli::Description{"Nice value of the render threads serving all other Android apps"},
+                      thread_policy_.clients.nice));
+  flag(cli::make_flag(cli::Name{"render-cpus"},
+                      cli::Description{"CPUs the render threads serving all other Android apps are pinned to, e.g. --render-cpus=2-7"},
+                      thread_policy_.clients.cpus));
+  flag(cli::make_flag(cli::Name{"gpu-soft-quota"},
+                      cli::Description{"GPU memory in MiB each Android app may allocate before cached buffers are freed for it"},
+                      gpu_soft_quota_));
+  flag(cli::make_flag(cli::Name{"gpu-hard-quota"},
+                      cli::Description{"GPU memory in MiB each Android app may allocate at most"},
+                      gpu_hard_quota_));
+  flag(cli::make_flag(cli::Name{"swap-policy"},
+                      cli::Description{"How composed frames are presented: 'fifo' waits for the vertical blank, 'mailbox' presents the latest frame from a separate thread, 'immediate' may tear"},
+                      swap_policy_));
+  flag(cli::make_flag(cli::Name{"gpu"},
+                      cli::Description{"GPU to render on, given by its render node, e.g. /dev/dri/renderD129, or its PCI slot. 'auto' picks the one with the least load and VRAM use its driver reports"},
+                      gpu_));
+  flag(cli::make_flag(cli::Name{"adaptive-resolution"},
+                      cli::Description{"Lower the resolution Android renders at while many frames miss the vsync and restore it once they make it again. The window keeps its size. Single window mode only"},
+                      adaptive_resolution_));
+  flag(cli::make_flag(cli::Name{"audio-period"},
+                      cli::Description{"Audio frames the audio device plays at once. Smaller periods lower the latency but risk dropouts"},
+                      audio_period_));
+  flag(cli::make_flag(cli::Name{"audio-buffer"},
+                      cli::Description{"Audio frames queued at most for playback, which bounds the audio latency"},
+                      audio_buffer_));
+  flag(cli::make_flag(cli::Name{"audio-capture-chunk"},
+                      cli::Description{"Audio frames recorded at once and sent to Android together. Smaller chunks lower the recording latency"},
+                      audio_capture_chunk_));
+  flag(cli::make_flag(cli::Name{"audio-backend"},
+                      cli::Description{"How Android audio is played: 'sdl' opens an SDL audio device per stream, 'pulseaudio' mixes all streams into one stream of the PulseAudio or PipeWire server"},
+                      audio_backend_));
+  flag(cli::make_flag(cli::Name{"audio-shared-memory"},
+                      cli::Description{"Let Android write played audio into memory shared with us instead of sending it over a socket"},
+                      audio_shared_memory_));
+  flag(cli::make_flag(cli::Name{"host-camera"},
+                      cli::Description{"Let Android capture from the V4L2 cameras of the host"},
+                      host_camera_));
+  flag(cli::make_flag(cli::Name{"host-sensors"},
+                      cli::Description{"Let Android read the accelerometer, gyroscope and light sensors of the host"},
+                      host_sensors_));
+  flag(cli::make_flag(cli::Name{"boot-properties"},
+                      cli::Description{"File with name=value lines overriding the system properties Android gets from us at boot, like ro.sf.lcd_density"},
+                      boot_properties_path_));
+  flag(cli::make_flag(cli::Name{"input-batch-window"},
+                      cli::Description{"Milliseconds mouse motion is held back at most to be merged with the following motion. With 0 only motion which queued up meanwhile is merged"},
+                      input_batch_window_));
+  flag(cli::make_flag(cli::Name{"metrics-socket"},
+                      cli::Description{"Serve all metrics in the Prometheus text format on the given socket, e.g. for curl --unix-socket <path> http://localhost/metrics"},
+                      metrics_socket_path_));
+  flag(cli::make_flag(cli::Name{"sync-logging"},
+                      cli::Description{"Write log messages on the thread issuing them instead of a background thread, e.g. to debug crashes"},
+                      sync_logging_));
+  flag(cli::make_flag(cli::Name{"gl-stream-buffer"},
+                      cli::Description{"KiB of GL commands buffered per Android GL client, rounded up to a power of two. Smaller buffers make clients uploading large textures wait for their render thread sooner"},
+                      gl_stream_buffer_));
+  flag(cli::make_flag(cli::Name{"idle-render-threads"},
+                      cli::Description{"Render threads kept around for the next Android GL clients. Fewer save memory but make starting GL clients slower"},
+                      gl_memory_.max_idle_render_threads));
+  flag(cli::make_flag(cli::Name{"buffer-pool-cache"},
+                      cli::Description{"KiB of released buffers kept per block size for reuse by the transport"},
+                      buffer_pool_cache_));
+  flag(cli::make_flag(cli::Name{"huge-pages"},
+                      cli::Description{"Back large GL transfer buffers with huge pages: 'off', 'transparent' marks them for transparent huge pages, 'reserved' takes them from the huge pages reserved through vm.nr_hugepages and falls back to transparent ones. Only applies to buffers of at least 2 MiB, e.g. with --gl-stream-buffer=2048"},
+                      huge_pages_));
+  flag(cli::make_flag(cli::Name{"fast-stop"},
+                      cli::Description{"Kill the container instead of shutting Android down and checkpointing it, and leave releasing GPU resources to the kernel on exit. Makes recycling a session near instant"},
+                      fast_stop_));
 
   action([this](const cli::Command::Context &) {
+    // Keeps writing log messages, which may be verbose, off the render and
+    // input threads. Set up before we start any other thread.
+    if (!sync_logging_)
+      SetLogger(std::make_shared<common::AsyncLogger>(GetLogger()));
+    struct FlushLog {
+      ~FlushLog() { Log().Flush(); }
+    } flush_log;
+
+    if (gl_stream_buffer_ == 0) {
+      ERROR("The GL stream buffer needs to hold at least 1 KiB");
+      return EXIT_FAILURE;
+    }
+    common::BlockPool::set_instance_max_cached_bytes(buffer_pool_cache_ * 1024);
+    gl_memory_.stream_buffer_size = gl_stream_buffer_ * 1024;
+    common::HugePageBuffer::set_mode(huge_pages_);
+
+    // Everything which records metrics looks the registry up when it is
+    // created, so it has to be there before anything else.
+    std::shared_ptr<common::Metrics> metrics;
+    if (!metrics_socket_path_.empty()) {
+      metrics = std::make_shared<common::Metrics>();
+      common::Metrics::set_instance(metrics);
+    }
+
+    auto &boot_timeline = common::BootTimeline::instance();
+    boot_timeline.set_report_path(boot_timeline_path_);
+    boot_timeline.mark("session_manager_started");
+
+    const auto trace_path = trace_path_;
+    const auto write_trace = [trace_path]() {
+      if (trace_path.empty())
+        return;
+      std::ofstream trace(trace_path, std::ios::trunc);
+      common::Tracer::instance().write_chrome_trace(trace);
+      if (!trace)
+        ERROR("Failed to write trace to %s", trace_path);
+    };
+    if (!trace_path_.empty())
+      common::Tracer::instance().enable();
+
     auto trap = core::posix::trap_signals_for_process(
-        {core::posix::Signal::sig_term, core::posix::Signal::sig_int});
-    trap->signal_raised().connect([trap](const core::posix::Signal &signal) {
+        {core::posix::Signal::sig_term, core::posix::Signal::sig_int,
+         core::posix::Signal::sig_usr2});
+    trap->signal_raised().connect([trap, write_trace](const core::posix::Signal &signal) {
+      // Only used to request a dump of the GL command profile, the trace
+      // and the memory usage.
+      if (signal == core::posix::Signal::sig_usr2) {
+        write_trace();
+        std::ostringstream memory;
+        common::MemoryUsage::write_summary(memory);
+        INFO("Memory usage: %s", memory.str());
+        return;
+      }
       INFO("Signal %i received. Good night.", static_cast<int>(signal));
       trap->stop();
     });
 
-    if (!fs::exists("/dev/binder") || !fs::exists("/dev/ashmem")) {
-      ERROR("Failed to start as either binder or ashmem kernel drivers are not loaded");
+    if (!container::BinderDevice::available()) {
+      ERROR("Failed to start as the binder kernel driver is not loaded");
+      return EXIT_FAILURE;
+    }
+
+    if (!fs::exists("/dev/ashmem"))
+      INFO("The ashmem kernel driver is not loaded, Android will use memfds instead");
+
+    if (!container::Instance::is_valid_name(instance_)) {
+      ERROR("Invalid instance name '%s'", instance_);
+      return EXIT_FAILURE;
+    }
+    SystemConfiguration::instance().set_instance_name(instance_);
+
+    if (!frame_export_path_.empty() && !headless_) {
+      ERROR("Exporting frames is only supported in headless mode");
+      return EXIT_FAILURE;
+    }
+
+    boost::asio::ip::address_v4 remote_gl_address;
+    unsigned short remote_gl_port = 0;
+    if (!remote_gl_endpoint_.empty() &&
+        !parse_endpoint(remote_gl_endpoint_, remote_gl_address, remote_gl_port)) {
+      ERROR("Invalid remote GL endpoint '%s', expected <address>:<port> or <port>", remote_gl_endpoint_);
+      return EXIT_FAILURE;
+    }
+
+    graphics::RemoteGlStream::Token remote_gl_token;
+    if (remote_gl_port != 0) {
+      std::ifstream token_file(remote_gl_token_path_);
+      std::string token;
+      if (remote_gl_token_path_.empty() || !(token_file >> token) ||
+          !graphics::RemoteGlStream::parse_token(token, remote_gl_token)) {
+        ERROR("Serving remote GL clients requires a token of %d hex digits given with --remote-gl-token",
+              2 * graphics::RemoteGlStream::token_size);
+        return EXIT_FAILURE;
+      }
+    }
+
+    if (audio_period_ == 0 || audio_period_ > 65535 || audio_buffer_ < audio_period_) {
+      ERROR("Audio period has to be between 1 and 65535 frames and can't be larger than the audio buffer");
+      return EXIT_FAILURE;
+    }
+
+    if (audio_capture_chunk_ == 0 || audio_capture_chunk_ > 65535 ||
+        audio_capture_chunk_ > audio::CaptureBuffer::default_buffer_frames) {
+      ERROR("Audio capture chunk has to be between 1 and %d frames",
+            audio::CaptureBuffer::default_buffer_frames);
       return EXIT_FAILURE;
     }
 
+#if !defined(PULSEAUDIO_SUPPORT)
+    if (audio_backend_ == audio::Backend::PulseAudio) {
+      ERROR("Anbox was built without PulseAudio support");
+      return EXIT_FAILURE;
+    }
+#endif
+
     // If we're running with the properietary nvidia driver we always
     // use the host EGL driver as our translation doesn't work here.
     if (fs::exists("/dev/nvidiactl")) {
@@ -127,6 +388,27 @@ anbox::cmds::SessionManager::SessionManager(const BusFactory &bus_factory)
       gles_driver_ = graphics::GLRendererServer::Config::Driver::Host;
     }
 
+    container::StandbyPool::Standby standby;
+    bool took_standby = false;
+    if (standby_) {
+      took_standby = container::StandbyPool::take_over(standby);
+      if (took_standby) {
+        INFO("Taking over standby container of instance %s", standby.instance);
+        SystemConfiguration::instance().set_instance_name(standby.instance);
+        SystemConfiguration::instance().set_runtime_dir(
+            SystemConfiguration::instance().standby_dir(standby.instance));
+      } else {
+        INFO("No standby container available, starting one");
+      }
+    }
+    // A previous session of ours may have left Android running, it only
+    // reaches us through the sockets it is already connected to.
+    if (!took_standby) {
+      standby.instance = SystemConfiguration::instance().instance_name();
+      if (container::ReattachPool::reattach(standby.instance, standby.sockets))
+        INFO("Reattaching to the running container of instance %s", standby.instance);
+    }
+
     utils::ensure_paths({
         SystemConfiguration::instance().socket_dir(),
         SystemConfiguration::instance().input_device_dir(),
@@ -135,6 +417,25 @@ anbox::cmds::SessionManager::SessionManager(const BusFactory &bus_factory)
     auto rt = Runtime::create();
     auto dispatcher = anbox::common::create_dispatcher_for_runtime(rt);
 
+    // Android of a standby or reattached container is already waiting for
+    // us on sockets we got handed over.
+    const auto standby_socket = [&](const std::string &name) {
+      const auto socket = standby.sockets.find(name);
+      return socket != standby.sockets.end() ? socket->second : Fd{};
+    };
+    const auto publish = [&](const std::string &socket_file, const std::string &name,
+                             const std::shared_ptr<network::ConnectionCreator<
+                                 boost::asio::local::stream_protocol>> &connection_creator,
+                             Runtime::Subsystem subsystem)
+        -> std::shared_ptr<network::PublishedSocketConnector> {
+      const auto socket = standby_socket(name);
+      if (socket != Fd::invalid)
+        return std::make_shared<network::PublishedSocketConnector>(socket, socket_file, rt,
+                                                                   connection_creator, subsystem);
+      return std::make_shared<network::PublishedSocketConnector>(socket_file, rt,
+                                                                 connection_creator, subsystem);
+    };
+
     container::Client container(rt);
     container.register_terminate_handler([&]() {
       WARNING("Lost connection to container manager, terminating.");
@@ -143,7 +444,23 @@ anbox::cmds::SessionManager::SessionManager(const BusFactory &bus_factory)
 
     auto input_manager = std::make_shared<input::Manager>(rt);
 
-    auto android_api_stub = std::make_shared<bridge::AndroidApiStub>();
+    auto android_api_stub = std::make_shared<bridge::AndroidApiStub>(rt);
+
+    // A restored Android doesn't tell us again that it finished booting. It
+    // is ready as soon as it is back on the bridge.
+    std::atomic<bool> container_restored{false};
+    std::atomic<bool> bridge_connected{false};
+    const auto ready_if_restored = [&]() {
+      if (!container_restored || !bridge_connected)
+        return;
+      DEBUG("Android was restored from a checkpoint");
+      boot_timeline.finish();
+      android_api_stub->ready().set(true);
+    };
+    container.register_restored_handler([&]() {
+      container_restored = true;
+      ready_if_restored();
+    });
 
     auto app_manager = std::static_pointer_cast<application::Manager>(android_api_stub);
     if (!single_window_) {
@@ -155,89 +472,310 @@ anbox::cmds::SessionManager::SessionManager(const BusFactory &bus_factory)
     }
 
     auto display_frame = graphics::Rect::Invalid;
-    if (single_window_)
+    if (single_window_ || headless_)
       display_frame = window_size_;
 
-    auto policy = std::make_shared<ubuntu::PlatformPolicy>(input_manager, display_frame, single_window_);
-    // FIXME this needs to be removed and solved differently behind the scenes
-    registerDisplayManager(policy);
+    // Android renders at a fixed resolution then and the compositor scales
+    // it to whatever size the window has, so the cost on the guest side
+    // doesn't grow with the window.
+    const auto scale_display = single_window_ && !headless_ && display_size_ != graphics::Rect::Invalid;
+    if (scale_display)
+      display_frame = display_size_;
+
+    std::shared_ptr<platform::Policy> policy;
+    std::shared_ptr<ubuntu::PlatformPolicy> ubuntu_policy;
+    std::shared_ptr<platform::HeadlessPolicy> headless_policy;
+    // FIXME registering the display manager needs to be removed and solved
+    // differently behind the scenes
+    if (headless_) {
+      headless_policy = std::make_shared<platform::HeadlessPolicy>(display_frame);
+      registerDisplayManager(headless_policy);
+      policy = headless_policy;
+    } else {
+      ubuntu_policy = std::make_shared<ubuntu::PlatformPolicy>(
+          input_manager, display_frame, single_window_,
+          std::chrono::milliseconds{input_batch_window_});
+      ubuntu_policy->set_audio_config({audio_period_, audio_buffer_});
+      ubuntu_policy->set_audio_capture_config({audio_capture_chunk_, audio::CaptureBuffer::default_buffer_frames});
+      ubuntu_policy->set_audio_backend(audio_backend_);
+      if (scale_display)
+        ubuntu_policy->enable_display_scaling();
+      registerDisplayManager(ubuntu_policy);
+      policy = ubuntu_policy;
+    }
 
     auto app_db = std::make_shared<application::Database>();
+    if (!frame_rate_caps_path_.empty()) {
+      std::ifstream caps(frame_rate_caps_path_);
+      if (!caps) {
+        ERROR("Failed to read frame rate caps from %s", frame_rate_caps_path_);
+        return EXIT_FAILURE;
+      }
+      app_db->read_frame_rate_caps(caps);
+    }
 
     std::shared_ptr<wm::Manager> window_manager;
-    if (single_window_)
-      window_manager = std::make_shared<wm::SingleWindowManager>(policy, display_frame, app_db);
-    else
-      window_manager = std::make_shared<wm::MultiWindowManager>(policy, android_api_stub, app_db);
-
-    auto gl_server = std::make_shared<graphics::GLRendererServer>(
-          graphics::GLRendererServer::Config{gles_driver_, single_window_}, window_manager);
+    if (single_window_) {
+      window_manager = std::make_shared<wm::SingleWindowManager>(policy, window_size_, app_db);
+    } else {
+      auto multi_window_manager = std::make_shared<wm::MultiWindowManager>(policy, android_api_stub, app_db);
+      // Windows of applications launched through us are set up while
+      // Android is still busy starting them.
+      app_manager = std::make_shared<wm::WindowPreparingManager>(app_manager, multi_window_manager);
+      window_manager = multi_window_manager;
+    }
 
-    policy->set_window_manager(window_manager);
-    policy->set_renderer(gl_server->renderer());
+    boot_timeline.mark("platform_policy_created");
+
+    // Loading the GL libraries and setting up the renderer is the slowest
+    // part of our startup and depends on nothing but the display manager
+    // registered above, so it runs while we get everything else ready and
+    // Android boots already. Connections which need the renderer are held
+    // back until it is there.
+    auto gl_server_initialized = std::async(std::launch::async, [&]() {
+      auto server = std::make_shared<graphics::GLRendererServer>(
+            graphics::GLRendererServer::Config{gles_driver_, single_window_,
+                                               gl_profile_path_, frame_stats_path_,
+                                               gl_capture_path_, headless_,
+                                               !frame_export_path_.empty(),
+                                               thread_policy_,
+                                               graphics::MemoryAccounting::Quota{
+                                                   gpu_soft_quota_ * 1024 * 1024,
+                                                   gpu_hard_quota_ * 1024 * 1024},
+                                               swap_policy_,
+                                               app_profiles_path_,
+                                               gpu_},
+            window_manager);
+      boot_timeline.mark("gl_renderer_server_initialized");
+      return server;
+    });
 
-    window_manager->setup();
+    std::shared_ptr<input::LatencyStatistics> input_statistics;
+    std::shared_ptr<common::HandlerStatistics> handler_statistics;
+    if (!frame_stats_path_.empty() || metrics) {
+      input_statistics = std::make_shared<input::LatencyStatistics>();
+      input_manager->set_latency_statistics(input_statistics);
+      handler_statistics = std::make_shared<common::HandlerStatistics>();
+      rt->set_handler_statistics(handler_statistics);
+    }
 
-    auto audio_server = std::make_shared<audio::Server>(rt, policy);
+    auto audio_server = std::make_shared<audio::Server>(rt, policy, audio_shared_memory_,
+                                                        standby_socket("anbox_audio"));
 
     const auto socket_path = SystemConfiguration::instance().socket_dir();
 
+    auto boot_properties = std::make_shared<qemu::BootProperties>(qemu::BootProperties::query_host());
+    if (!boot_properties_path_.empty())
+      boot_properties->load_overrides(boot_properties_path_);
+
     // The qemu pipe is used as a very fast communication channel between guest
     // and host for things like the GLES emulation/translation, the RIL or ADB.
+    auto qemu_pipe_creator = std::make_shared<
+        network::DeferredConnectionCreator<boost::asio::local::stream_protocol>>();
     auto qemu_pipe_connector =
-        std::make_shared<network::PublishedSocketConnector>(
-            utils::string_format("%s/qemu_pipe", socket_path), rt,
-            std::make_shared<qemu::PipeConnectionCreator>(gl_server->renderer(), rt));
-
-    auto bridge_connector = std::make_shared<network::PublishedSocketConnector>(
-        utils::string_format("%s/anbox_bridge", socket_path), rt,
-        std::make_shared<rpc::ConnectionCreator>(
-            rt, [&](const std::shared_ptr<network::MessageSender> &sender) {
-              auto pending_calls = std::make_shared<rpc::PendingCallCache>();
-              auto rpc_channel =
-                  std::make_shared<rpc::Channel>(pending_calls, sender);
-              // This is safe as long as we only support a single client. If we
-              // support
-              // more than one one day we need proper dispatching to the right
-              // one.
-              android_api_stub->set_rpc_channel(rpc_channel);
-
-              auto server = std::make_shared<bridge::PlatformApiSkeleton>(
-                  pending_calls, policy, window_manager, app_db);
-              server->register_boot_finished_handler([&]() {
-                DEBUG("Android successfully booted");
-                android_api_stub->ready().set(true);
-              });
-              return std::make_shared<bridge::PlatformMessageProcessor>(
-                  sender, server, pending_calls);
-            }));
-
-    container::Configuration container_configuration;
-    container_configuration.bind_mounts = {
-        {qemu_pipe_connector->socket_file(), "/dev/qemu_pipe"},
-        {bridge_connector->socket_file(), "/dev/anbox_bridge"},
-        {audio_server->socket_file(), "/dev/anbox_audio"},
-        {SystemConfiguration::instance().input_device_dir(), "/dev/input"},
-        {"/dev/binder", "/dev/binder"},
-        {"/dev/ashmem", "/dev/ashmem"},
-        {"/dev/fuse", "/dev/fuse"},
-    };
+        publish(utils::string_format("%s/qemu_pipe", socket_path), "qemu_pipe",
+                qemu_pipe_creator, Runtime::Subsystem::Graphics);
+
+    std::shared_ptr<network::PublishedSocketConnector> metrics_connector;
+    if (metrics) {
+      metrics->add_collector("boot", [&boot_timeline](std::ostream &out) {
+        boot_timeline.write_prometheus(out);
+      });
+      metrics->add_collector("memory", &common::MemoryUsage::write_prometheus);
+      metrics->add_collector("huge_pages", &common::HugePageBuffer::write_prometheus);
+      metrics_connector = std::make_shared<network::PublishedSocketConnector>(
+          metrics_socket_path_, rt, std::make_shared<network::MetricsEndpoint>(metrics));
+    }
 
-    dispatcher->dispatch([&]() { container.start(container_configuration); });
+    // Android keeps what it got from the clipboard until we tell it that
+    // the content changed instead of asking us every time.
+    policy->register_clipboard_changed_handler([android_api_stub]() {
+      android_api_stub->clipboard_changed_async([](const std::string &) {});
+    });
+
+    // Android creates windows through the bridge, which needs the renderer.
+    auto bridge_creator = std::make_shared<
+        network::DeferredConnectionCreator<boost::asio::local::stream_protocol>>();
+    auto bridge_connector = publish(
+        utils::string_format("%s/anbox_bridge", socket_path), "anbox_bridge",
+        bridge_creator, Runtime::Subsystem::Control);
+    boot_timeline.mark("sockets_published");
+
+    // A standby container only gets handed over as it is when we ask for
+    // exactly what it runs with.
+    const auto container_configuration = container::Configuration::for_session(
+        socket_path, SystemConfiguration::instance().input_device_dir());
+
+    dispatcher->dispatch([&]() {
+      container.start(container_configuration);
+      // Lets the next session continue the container in case we go away
+      // without stopping it.
+      if (!took_standby)
+        container::ReattachPool::park(SystemConfiguration::instance().instance_name(),
+                                      {{"qemu_pipe", qemu_pipe_connector->socket()},
+                                       {"anbox_bridge", bridge_connector->socket()},
+                                       {"anbox_audio", audio_server->socket()}});
+    });
 
     auto bus = bus_factory_();
     bus->install_executor(core::dbus::asio::make_executor(bus, rt->service()));
 
     auto skeleton = anbox::dbus::skeleton::Service::create_for_bus(bus, app_manager);
+    boot_timeline.mark("session_bus_connected");
 
+    // Starts the container while the renderer is still being initialized.
     rt->start();
+
+    auto gl_server = gl_server_initialized.get();
+
+    if (adaptive_resolution_ && !single_window_) {
+      WARNING("Adaptive resolution is only available in single window mode");
+    } else if (adaptive_resolution_) {
+      const auto density = std::atoi(boot_properties->get("ro.sf.lcd_density").c_str());
+      gl_server->set_adaptive_resolution(std::make_shared<graphics::AdaptiveResolution>(
+          [android_api_stub, display_frame, density](float scale) {
+            const auto done = [](const std::string &error) {
+              if (!error.empty())
+                WARNING("Failed to change the resolution Android renders at: %s", error);
+            };
+            if (scale >= 1.0f) {
+              android_api_stub->set_display_metrics_async(0, 0, 0, done);
+              return;
+            }
+            // Odd sizes don't go well with the chroma planes of video buffers.
+            const auto width = static_cast<std::int32_t>(display_frame.width() * scale) & ~1;
+            const auto height = static_cast<std::int32_t>(display_frame.height() * scale) & ~1;
+            android_api_stub->set_display_metrics_async(
+                width, height, static_cast<std::int32_t>(density * scale), done);
+          }));
+    }
+
+    std::weak_ptr<graphics::GLRendererServer> weak_gl_server = gl_server;
+    trap->signal_raised().connect([weak_gl_server](const core::posix::Signal &signal) {
+      if (signal != core::posix::Signal::sig_usr2)
+        return;
+      if (auto gl_server = weak_gl_server.lock()) {
+        gl_server->dump_command_profile();
+        gl_server->write_frame_statistics();
+        gl_server->save_app_profiles();
+      }
+    });
+
+    boost::asio::deadline_timer frame_statistics_timer(rt->service());
+    std::function<void(const boost::system::error_code &)> write_frame_statistics =
+        [&](const boost::system::error_code &err) {
+          if (err)
+            return;
+          gl_server->write_frame_statistics();
+          // The probes land in the next write.
+          rt->probe_queues();
+          frame_statistics_timer.expires_from_now(frame_statistics_interval);
+          frame_statistics_timer.async_wait(write_frame_statistics);
+        };
+    if (input_statistics) {
+      gl_server->set_input_statistics(input_statistics);
+      gl_server->set_handler_statistics(handler_statistics);
+      write_frame_statistics(boost::system::error_code{});
+    }
+
+    if (ubuntu_policy) {
+      ubuntu_policy->set_window_manager(window_manager);
+      ubuntu_policy->set_renderer(gl_server->renderer());
+    } else {
+      headless_policy->set_renderer(gl_server->renderer());
+    }
+
+    window_manager->setup();
+
+    if (metrics) {
+      std::weak_ptr<graphics::GLRendererServer> weak_server = gl_server;
+      metrics->add_collector("graphics", [weak_server](std::ostream &out) {
+        if (auto server = weak_server.lock())
+          server->write_metrics(out);
+      });
+    }
+
+    std::shared_ptr<network::PublishedSocketConnector> frame_export_connector;
+    if (gl_server->frame_exporter())
+      frame_export_connector = std::make_shared<network::PublishedSocketConnector>(
+          frame_export_path_, rt, gl_server->frame_exporter());
+
+    std::shared_ptr<network::TcpSocketConnector> remote_gl_connector;
+    if (remote_gl_port != 0) {
+      remote_gl_connector = std::make_shared<network::TcpSocketConnector>(
+          remote_gl_address, remote_gl_port, rt,
+          std::make_shared<graphics::RemoteGlConnectionCreator>(gl_server->renderer(), rt,
+                                                                remote_gl_token));
+      INFO("Serving remote GL clients on %s:%d", remote_gl_address.to_string(), remote_gl_port);
+    }
+
+    qemu_pipe_creator->set_creator(
+        std::make_shared<qemu::PipeConnectionCreator>(gl_server->renderer(), rt,
+                                                      gl_server->stream_capture(),
+                                                      host_camera_, host_sensors_,
+                                                      boot_properties, gl_memory_));
+
+    bridge_creator->set_creator(std::make_shared<rpc::ConnectionCreator>(
+        rt, [&](const std::shared_ptr<network::MessageSender> &sender) {
+          auto pending_calls = std::make_shared<rpc::PendingCallCache>();
+          auto framing = std::make_shared<rpc::Framing>();
+          auto rpc_channel =
+              std::make_shared<rpc::Channel>(pending_calls, sender, framing);
+          rpc_channel->send_protocol_version();
+          // This is safe as long as we only support a single client. If we
+          // support
+          // more than one one day we need proper dispatching to the right
+          // one.
+          android_api_stub->set_rpc_channel(rpc_channel);
+          // Whatever it has cached from a previous connection is stale
+          // and this also tells it that we report changes.
+          android_api_stub->clipboard_changed_async([](const std::string &) {});
+          // Collecting them costs Android a dumpsys every few seconds, so
+          // it only does while we serve them.
+          android_api_stub->set_frame_statistics_reporting_async(
+              metrics != nullptr, [](const std::string &) {});
+
+          bridge_connected = true;
+          ready_if_restored();
+
+          auto server = std::make_shared<bridge::PlatformApiSkeleton>(
+              pending_calls, policy, window_manager, app_db);
+          server->register_boot_finished_handler([&]() {
+            DEBUG("Android successfully booted");
+            android_api_stub->ready().set(true);
+          });
+          server->register_icon_fetcher([android_api_stub](
+              const std::vector<std::string> &hashes,
+              const std::function<void(const bridge::PlatformApiSkeleton::Icons &)> &done) {
+            android_api_stub->get_application_icons_async(hashes, done);
+          });
+          return std::make_shared<bridge::PlatformMessageProcessor>(
+              sender, server, pending_calls, framing);
+        }));
+    boot_timeline.mark("gl_renderer_server_attached");
+
     trap->run();
 
     // Stop the container which should close all open connections we have on
-    // our side and should terminate all services.
-    container.stop();
+    // our side and should terminate all services. A booted Android can be
+    // continued from where it is at the next start.
+    if (fast_stop_)
+      container.stop(false, true);
+    else
+      container.stop(android_api_stub->ready().get());
 
     rt->stop();
+    write_trace();
+
+    if (fast_stop_) {
+      // Tearing down every GL object one by one takes far longer than the
+      // kernel needs to release them along with our GPU file descriptors.
+      // Only what would otherwise be written on the way out is kept.
+      gl_server->dump_command_profile();
+      gl_server->save_app_profiles();
+      Log().Flush();
+      std::_Exit(EXIT_SUCCESS);
+    }
 
     return EXIT_SUCCESS;
   });
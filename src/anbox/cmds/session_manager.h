@@ -26,8 +26,15 @@
 
 #include <core/dbus/bus.h>
 
+#include "anbox/audio/backend.h"
+#include "anbox/audio/capture_buffer.h"
+#include "anbox/audio/playback_buffer.h"
+#include "anbox/common/block_pool.h"
+#include "anbox/common/huge_page_buffer.h"
+#include "anbox/config.h"
 #include "anbox/graphics/gl_renderer_server.h"
 #include "anbox/graphics/rect.h"
+#include "anbox/qemu/pipe_connection_creator.h"
 
 namespace anbox {
 namespace cmds {
@@ -44,7 +51,45 @@ class SessionManager : public cli::CommandWithFlagsAndAction {
   std::string desktop_file_hint_;
   graphics::GLRendererServer::Config::Driver gles_driver_;
   bool single_window_ = false;
+  bool headless_ = false;
+  bool adaptive_resolution_ = false;
   graphics::Rect window_size_;
+  graphics::Rect display_size_;
+  std::string gl_profile_path_;
+  std::string frame_stats_path_;
+  std::string metrics_socket_path_;
+  std::string gl_capture_path_;
+  std::string frame_export_path_;
+  std::string boot_properties_path_;
+  std::string boot_timeline_path_;
+  std::string trace_path_;
+  std::string app_profiles_path_;
+  std::string remote_gl_endpoint_;
+  std::string remote_gl_token_path_;
+  std::string frame_rate_caps_path_;
+  std::string gpu_;
+  std::string instance_ = SystemConfiguration::default_instance;
+  graphics::RenderThreadPolicy::Config thread_policy_;
+  std::size_t gpu_soft_quota_ = 0;
+  std::size_t gpu_hard_quota_ = 0;
+  graphics::GLRendererServer::Config::SwapPolicy swap_policy_ =
+      graphics::GLRendererServer::Config::SwapPolicy::Fifo;
+  std::size_t audio_period_ = audio::PlaybackBuffer::default_period_frames;
+  std::size_t audio_buffer_ = audio::PlaybackBuffer::default_buffer_frames;
+  std::size_t audio_capture_chunk_ = audio::CaptureBuffer::default_chunk_frames;
+  audio::Backend audio_backend_ = audio::Backend::SDL;
+  bool audio_shared_memory_ = false;
+  bool host_camera_ = false;
+  bool host_sensors_ = false;
+  bool standby_ = false;
+  bool sync_logging_ = false;
+  bool fast_stop_ = false;
+  unsigned int input_batch_window_ = 0;
+  qemu::GlClientMemory gl_memory_;
+  // In KiB.
+  std::size_t gl_stream_buffer_ = graphics::BufferedIOStream::default_in_buffer_size / 1024;
+  std::size_t buffer_pool_cache_ = common::BlockPool::default_max_cached_bytes / 1024;
+  common::HugePageBuffer::Mode huge_pages_ = common::HugePageBuffer::Mode::Off;
 };
 }  // namespace cmds
 }  // namespace anbox
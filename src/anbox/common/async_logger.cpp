@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/common/async_logger.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace {
+std::atomic<std::uint64_t> next_instance{0};
+}  // namespace
+
+namespace anbox {
+namespace common {
+constexpr std::size_t AsyncLogger::default_thread_capacity;
+constexpr std::chrono::milliseconds AsyncLogger::flush_interval;
+
+AsyncLogger::AsyncLogger(const std::shared_ptr<Logger> &sink, std::size_t thread_capacity)
+    : sink_(sink),
+      thread_capacity_(thread_capacity),
+      instance_(next_instance++),
+      severity_(Severity::kFatal) {
+  // Start out with what the sink was configured for but filter here from
+  // now on.
+  for (const auto severity : {Severity::kTrace, Severity::kDebug, Severity::kInfo,
+                              Severity::kWarning, Severity::kError}) {
+    if (sink_->IsEnabled(severity)) {
+      severity_ = severity;
+      break;
+    }
+  }
+  sink_->SetSeverity(Severity::kTrace);
+  flusher_ = std::thread(&AsyncLogger::flusher_main, this);
+}
+
+AsyncLogger::~AsyncLogger() {
+  {
+    std::lock_guard<std::mutex> l(wake_lock_);
+    stopping_ = true;
+  }
+  wake_.notify_one();
+  flusher_.join();
+}
+
+void AsyncLogger::Init(const Severity &severity) {
+  sink_->Init(Severity::kTrace);
+  sink_->SetSeverity(Severity::kTrace);
+  severity_ = severity;
+}
+
+void AsyncLogger::SetSeverity(const Severity &severity) {
+  severity_ = severity;
+}
+
+bool AsyncLogger::IsEnabled(Severity severity) const {
+  return severity >= severity_;
+}
+
+void AsyncLogger::Log(Severity severity, const std::string &message,
+                      const boost::optional<Location> &location) {
+  if (!IsEnabled(severity))
+    return;
+
+  auto &buffer = buffer_for_this_thread();
+  Entry entry{severity, std::chrono::steady_clock::now(),
+              std::chrono::system_clock::now(), message, location};
+  if (buffer.entries.try_push(std::move(entry)) == 0) {
+    if (severity >= Severity::kError)
+      wake_up();
+  } else if (severity >= Severity::kError) {
+    wake_up();
+    buffer.entries.push(std::move(entry));
+  } else {
+    dropped_++;
+    wake_up();
+  }
+
+  if (severity == Severity::kFatal)
+    Flush();
+}
+
+std::size_t AsyncLogger::thread_buffers() const {
+  std::lock_guard<std::mutex> l(buffers_lock_);
+  return buffers_.size();
+}
+
+void AsyncLogger::Flush() {
+  std::lock_guard<std::mutex> l(drain_lock_);
+  drain_locked();
+}
+
+AsyncLogger::ThreadBuffer &AsyncLogger::buffer_for_this_thread() {
+  // Only grows by one entry for each logger a thread ever logs to, of
+  // which there is usually just one.
+  thread_local std::unordered_map<std::uint64_t, std::shared_ptr<ThreadBuffer>> buffers;
+
+  auto &buffer = buffers[instance_];
+  if (!buffer) {
+    buffer = std::make_shared<ThreadBuffer>(thread_capacity_);
+    std::lock_guard<std::mutex> l(buffers_lock_);
+    buffers_.push_back(buffer);
+  }
+  return *buffer;
+}
+
+void AsyncLogger::wake_up() {
+  {
+    std::lock_guard<std::mutex> l(wake_lock_);
+    wake_requested_ = true;
+  }
+  wake_.notify_one();
+}
+
+void AsyncLogger::drain_locked() {
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+  {
+    std::lock_guard<std::mutex> l(buffers_lock_);
+    // Buffers only we hold on to belong to threads which are gone. They
+    // are told apart before the copy holds on to them as well, what they
+    // left behind is drained below for the last time.
+    const auto gone = std::partition(buffers_.begin(), buffers_.end(),
+                                     [](const std::shared_ptr<ThreadBuffer> &buffer) {
+                                       return buffer.use_count() > 1;
+                                     });
+    buffers = buffers_;
+    buffers_.erase(gone, buffers_.end());
+  }
+
+  Entry entry;
+  for (const auto &buffer : buffers) {
+    while (buffer->entries.try_pop(&entry) == 0)
+      batch_.push_back(std::move(entry));
+  }
+
+  // Every buffer is in order on its own, this restores the order between
+  // the threads.
+  std::stable_sort(batch_.begin(), batch_.end(), [](const Entry &lhs, const Entry &rhs) {
+    return lhs.issued < rhs.issued;
+  });
+  for (const auto &e : batch_)
+    sink_->LogAt(e.severity, e.message, e.location, e.timestamp);
+  batch_.clear();
+
+  const auto dropped = dropped_.load();
+  if (dropped != dropped_reported_) {
+    sink_->LogAt(Severity::kWarning,
+                 utils::string_format("Dropped %d log messages as they came in too fast",
+                                      dropped - dropped_reported_),
+                 boost::none, std::chrono::system_clock::now());
+    dropped_reported_ = dropped;
+  }
+}
+
+void AsyncLogger::flusher_main() {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> l(wake_lock_);
+      wake_.wait_for(l, flush_interval, [&]() { return wake_requested_ || stopping_; });
+      wake_requested_ = false;
+      if (stopping_)
+        break;
+    }
+    Flush();
+  }
+  Flush();
+}
+}  // namespace common
+}  // namespace anbox
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_COMMON_ASYNC_LOGGER_H_
+#define ANBOX_COMMON_ASYNC_LOGGER_H_
+
+#include "anbox/common/lock_free_queue.h"
+#include "anbox/logger.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace anbox {
+namespace common {
+// Takes writing log messages off the threads issuing them. Messages are
+// formatted by the caller, as the arguments may not outlive the call,
+// but only when their severity is enabled. They are then put into a
+// buffer of the calling thread, which no other producer touches, and a
+// background thread writes them to |sink| in the order they were issued.
+//
+// Callers never block on the sink. When the buffer of a thread is full
+// messages below errors are dropped and counted, errors and fatal
+// messages wait for space so that they are never lost. A fatal message
+// is flushed before the call returns as we're likely about to go down.
+class AsyncLogger : public Logger {
+ public:
+  static constexpr std::size_t default_thread_capacity{1024};
+  static constexpr std::chrono::milliseconds flush_interval{10};
+
+  explicit AsyncLogger(const std::shared_ptr<Logger> &sink,
+                       std::size_t thread_capacity = default_thread_capacity);
+  ~AsyncLogger();
+
+  void Init(const Severity &severity = Severity::kWarning) override;
+  void SetSeverity(const Severity &severity) override;
+  bool IsEnabled(Severity severity) const override;
+  void Log(Severity severity, const std::string &message,
+           const boost::optional<Location> &location) override;
+  void Flush() override;
+
+  std::uint64_t dropped() const { return dropped_.load(); }
+  // Threads a buffer is kept for. Those of exited threads are released
+  // by the next flush.
+  std::size_t thread_buffers() const;
+
+ private:
+  struct Entry {
+    Severity severity;
+    // Orders the messages of all threads, unlike the wall clock time we
+    // print which may jump.
+    std::chrono::steady_clock::time_point issued;
+    std::chrono::system_clock::time_point timestamp;
+    std::string message;
+    boost::optional<Location> location;
+  };
+
+  struct ThreadBuffer {
+    explicit ThreadBuffer(std::size_t capacity) : entries(capacity) {}
+    common::SpscQueue<Entry> entries;
+  };
+
+  ThreadBuffer &buffer_for_this_thread();
+  void wake_up();
+  // Writes everything buffered so far. Needs |drain_lock_| to be held as
+  // each buffer only has a single consumer.
+  void drain_locked();
+  void flusher_main();
+
+  const std::shared_ptr<Logger> sink_;
+  const std::size_t thread_capacity_;
+  // Tells the buffers of all our instances apart in the thread local
+  // storage of a thread.
+  const std::uint64_t instance_;
+  std::atomic<Severity> severity_;
+  std::atomic<std::uint64_t> dropped_{0};
+  std::uint64_t dropped_reported_ = 0;
+
+  mutable std::mutex buffers_lock_;
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+
+  std::mutex drain_lock_;
+  std::vector<Entry> batch_;
+
+  std::mutex wake_lock_;
+  std::condition_variable wake_;
+  bool wake_requested_ = false;
+  bool stopping_ = false;
+  std::thread flusher_;
+};
+}  // namespace common
+}  // namespace anbox
+
+#endif
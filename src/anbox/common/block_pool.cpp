@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/common/block_pool.h"
+#include "anbox/common/memory_usage.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+const std::size_t block_sizes[] = {anbox::common::BlockPool::small_block_size,
+                                   anbox::common::BlockPool::medium_block_size,
+                                   anbox::common::BlockPool::large_block_size};
+
+// Blocks released by destructors running after the cache of their thread
+// went away bypass it.
+thread_local bool thread_cache_gone = false;
+
+std::atomic<std::size_t> instance_max_cached_bytes{
+    anbox::common::BlockPool::default_max_cached_bytes};
+}  // namespace
+
+namespace anbox {
+namespace common {
+constexpr std::size_t BlockPool::small_block_size;
+constexpr std::size_t BlockPool::medium_block_size;
+constexpr std::size_t BlockPool::large_block_size;
+constexpr std::size_t BlockPool::default_max_cached_bytes;
+constexpr std::size_t BlockPool::thread_cache_bytes;
+constexpr std::size_t BlockPool::size_classes;
+
+struct BlockPool::ThreadCache {
+  BlockPool *pool = nullptr;
+  std::vector<void *> blocks[size_classes];
+
+  ~ThreadCache() {
+    thread_cache_gone = true;
+    if (!pool)
+      return;
+    for (std::size_t n = 0; n < size_classes; n++)
+      pool->give_shared(static_cast<int>(n), blocks[n], blocks[n].size());
+  }
+};
+
+BlockPool &BlockPool::instance() {
+  static BlockPool *pool = new BlockPool(instance_max_cached_bytes.load(), true);
+  return *pool;
+}
+
+void BlockPool::set_instance_max_cached_bytes(std::size_t max_cached_bytes) {
+  instance_max_cached_bytes.store(max_cached_bytes);
+}
+
+BlockPool::BlockPool(std::size_t max_cached_bytes, bool thread_caches)
+    : max_cached_bytes_(max_cached_bytes), thread_caches_(thread_caches) {}
+
+BlockPool::~BlockPool() {
+  for (auto &size_class : classes_) {
+    for (auto block : size_class.blocks)
+      std::free(block);
+  }
+  MemoryUsage::remove(MemoryUsage::Subsystem::Caches, cached_bytes_.load());
+}
+
+std::size_t BlockPool::capacity_for(std::size_t size) {
+  for (const auto block_size : block_sizes) {
+    if (size <= block_size)
+      return block_size;
+  }
+  return size;
+}
+
+int BlockPool::class_for(std::size_t capacity) {
+  for (std::size_t n = 0; n < size_classes; n++) {
+    if (capacity == block_sizes[n])
+      return static_cast<int>(n);
+  }
+  return -1;
+}
+
+std::size_t BlockPool::thread_cache_limit(int n) {
+  return std::max<std::size_t>(1, thread_cache_bytes / block_sizes[n]);
+}
+
+BlockPool::ThreadCache *BlockPool::thread_cache() {
+  if (!thread_caches_ || thread_cache_gone)
+    return nullptr;
+
+  thread_local ThreadCache cache;
+  // Only the shared pool, which is never destroyed, has thread caches.
+  cache.pool = this;
+  return &cache;
+}
+
+void BlockPool::take_shared(int n, std::vector<void *> &blocks, std::size_t count) {
+  auto &size_class = classes_[n];
+  if (size_class.available.load(std::memory_order_relaxed) == 0)
+    return;
+
+  std::lock_guard<std::mutex> l(size_class.lock);
+  shared_transfers_++;
+  while (count-- > 0 && !size_class.blocks.empty()) {
+    blocks.push_back(size_class.blocks.back());
+    size_class.blocks.pop_back();
+    cached_bytes_ -= block_sizes[n];
+    MemoryUsage::remove(MemoryUsage::Subsystem::Caches, block_sizes[n]);
+  }
+  size_class.available.store(size_class.blocks.size(), std::memory_order_relaxed);
+}
+
+void BlockPool::give_shared(int n, std::vector<void *> &blocks, std::size_t count) {
+  auto &size_class = classes_[n];
+  std::lock_guard<std::mutex> l(size_class.lock);
+  shared_transfers_++;
+  while (count-- > 0) {
+    auto block = blocks.back();
+    blocks.pop_back();
+    if ((size_class.blocks.size() + 1) * block_sizes[n] <= max_cached_bytes_) {
+      size_class.blocks.push_back(block);
+      cached_bytes_ += block_sizes[n];
+      MemoryUsage::add(MemoryUsage::Subsystem::Caches, block_sizes[n]);
+    } else {
+      std::free(block);
+    }
+  }
+  size_class.available.store(size_class.blocks.size(), std::memory_order_relaxed);
+}
+
+void *BlockPool::acquire(std::size_t size) {
+  const auto capacity = capacity_for(size);
+  const auto n = class_for(capacity);
+  if (n >= 0) {
+    void *block = nullptr;
+    if (auto cache = thread_cache()) {
+      auto &blocks = cache->blocks[n];
+      // Refill half of the cache at once.
+      if (blocks.empty())
+        take_shared(n, blocks, std::max<std::size_t>(1, thread_cache_limit(n) / 2));
+      if (!blocks.empty()) {
+        block = blocks.back();
+        blocks.pop_back();
+      }
+    } else {
+      std::vector<void *> taken;
+      take_shared(n, taken, 1);
+      if (!taken.empty())
+        block = taken.back();
+    }
+
+    if (block) {
+      reuses_++;
+      return block;
+    }
+  }
+
+  auto block = std::malloc(capacity);
+  if (!block)
+    std::abort();
+  allocations_++;
+  return block;
+}
+
+void BlockPool::release(void *block, std::size_t capacity) {
+  const auto n = class_for(capacity);
+  if (n < 0) {
+    std::free(block);
+    return;
+  }
+
+  if (auto cache = thread_cache()) {
+    auto &blocks = cache->blocks[n];
+    blocks.push_back(block);
+    // Threads which only ever release, like the writers of the GL
+    // streams, pass their blocks on in batches.
+    const auto limit = thread_cache_limit(n);
+    if (blocks.size() > limit)
+      give_shared(n, blocks, blocks.size() - limit / 2);
+    return;
+  }
+
+  std::vector<void *> blocks{block};
+  give_shared(n, blocks, 1);
+}
+
+BlockPool::Statistics BlockPool::statistics() const {
+  return Statistics{allocations_.load(), reuses_.load(), shared_transfers_.load(),
+                    cached_bytes_.load()};
+}
+}  // namespace common
+}  // namespace anbox
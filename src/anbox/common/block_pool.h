@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_COMMON_BLOCK_POOL_H_
+#define ANBOX_COMMON_BLOCK_POOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace anbox {
+namespace common {
+// Hands out memory in a few block sizes and keeps released blocks around
+// for the next request of the same size, so that buffers moving between
+// threads, like GL packets, don't go through malloc every time. Requests
+// above the largest size are passed through to malloc.
+//
+// Blocks may be released on another thread than they were acquired on.
+// The shared pool additionally keeps a few blocks of each size per thread
+// and only goes to the lists shared by all threads in batches, so threads
+// acquiring and releasing blocks at a high rate rarely contend.
+class BlockPool {
+ public:
+  static constexpr std::size_t small_block_size{4 * 1024};
+  static constexpr std::size_t medium_block_size{64 * 1024};
+  static constexpr std::size_t large_block_size{1024 * 1024};
+  // Per block size.
+  static constexpr std::size_t default_max_cached_bytes{4 * 1024 * 1024};
+  // Per block size and thread, but at least one block.
+  static constexpr std::size_t thread_cache_bytes{256 * 1024};
+
+  struct Statistics {
+    // Blocks which had to be allocated from the system.
+    std::uint64_t allocations;
+    // Blocks handed out again from what was released before.
+    std::uint64_t reuses;
+    // Times the lists shared by all threads were touched.
+    std::uint64_t shared_transfers;
+    // Bytes in the shared lists, not counting the thread caches.
+    std::size_t cached_bytes;
+  };
+
+  // The pool shared by everything which has no reason to use its own. It
+  // is never destroyed so blocks can be released until the very end.
+  static BlockPool &instance();
+  // Limits what the shared pool keeps per block size. Only has an effect
+  // before instance() is used the first time.
+  static void set_instance_max_cached_bytes(std::size_t max_cached_bytes);
+
+  // Thread caches are only available to pools which are never destroyed
+  // as the caches give their blocks back when their thread exits.
+  explicit BlockPool(std::size_t max_cached_bytes = default_max_cached_bytes,
+                     bool thread_caches = false);
+  ~BlockPool();
+
+  BlockPool(const BlockPool &) = delete;
+  BlockPool &operator=(const BlockPool &) = delete;
+
+  // Returns the size of the block backing a request for |size| bytes.
+  static std::size_t capacity_for(std::size_t size);
+
+  // Returns a block of capacity_for(|size|) bytes. Aborts when we're out
+  // of memory, like SmallVector does.
+  void *acquire(std::size_t size);
+  // |capacity| has to be what capacity_for() returned for the block.
+  void release(void *block, std::size_t capacity);
+
+  Statistics statistics() const;
+
+ private:
+  static constexpr std::size_t size_classes{3};
+
+  struct SizeClass {
+    std::mutex lock;
+    std::vector<void *> blocks;
+    // Lets threads which find nothing to take skip the lock.
+    std::atomic<std::size_t> available{0};
+  };
+
+  struct ThreadCache;
+
+  static int class_for(std::size_t capacity);
+  static std::size_t thread_cache_limit(int n);
+  ThreadCache *thread_cache();
+  // Moves |count| blocks of class |n| to |blocks| at most.
+  void take_shared(int n, std::vector<void *> &blocks, std::size_t count);
+  // Moves the last |count| of |blocks|, which all are of class |n|, back
+  // to the shared list or frees them when it is full.
+  void give_shared(int n, std::vector<void *> &blocks, std::size_t count);
+
+  const std::size_t max_cached_bytes_;
+  const bool thread_caches_;
+  SizeClass classes_[size_classes];
+  std::atomic<std::uint64_t> allocations_{0};
+  std::atomic<std::uint64_t> reuses_{0};
+  std::atomic<std::uint64_t> shared_transfers_{0};
+  std::atomic<std::size_t> cached_bytes_{0};
+};
+}  // namespace common
+}  // namespace anbox
+
+#endif
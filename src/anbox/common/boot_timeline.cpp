@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "anbox/common/boot_timeline.h"
+#include "anbox/common/latency_samples.h"
+#include "anbox/logger.h"
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <fstream>
+
+namespace {
+double seconds(const std::chrono::nanoseconds &ns) {
+  return std::chrono::duration<double>(ns).count();
+}
+}  // namespace
+
+namespace anbox {
+namespace common {
+constexpr const char *BootTimeline::boot_finished;
+
+BootTimeline &BootTimeline::instance() {
+  static BootTimeline timeline;
+  return timeline;
+}
+
+BootTimeline::BootTimeline() : start_(Clock::now()), finished_(false) {}
+
+void BootTimeline::mark(const std::string &name) {
+  if (finished_.load())
+    return;
+  mark(name, Clock::now());
+}
+
+void BootTimeline::mark(const std::string &name, const Clock::time_point &time) {
+  std::lock_guard<std::mutex> l(lock_);
+  if (finished_.load())
+    return;
+
+  const auto known = std::find_if(events_.begin(), events_.end(),
+                                  [&](const Event &event) { return event.name == name; });
+  if (known != events_.end())
+    return;
+
+  events_.push_back({name, std::chrono::duration_cast<std::chrono::nanoseconds>(time - start_)});
+}
+
+void BootTimeline::finish() {
+  finish(Clock::now());
+}
+
+void BootTimeline::finish(const Clock::time_point &time) {
+  const auto offset = std::chrono::duration_cast<std::chrono::nanoseconds>(time - start_);
+  std::string path;
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    if (finished_.load())
+      return;
+    events_.push_back({boot_finished, offset});
+    finished_ = true;
+    path = report_path_;
+  }
+
+  // Nothing changes anymore so we don't need the lock for reporting.
+  INFO("Android booted in %.3f s", seconds(offset));
+  report(events(), path);
+}
+
+void BootTimeline::set_report_path(const std::string &path) {
+  std::lock_guard<std::mutex> l(lock_);
+  report_path_ = path;
+}
+
+std::vector<BootTimeline::Event> BootTimeline::events() const {
+  std::vector<Event> events;
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    events = events_;
+  }
+  std::stable_sort(events.begin(), events.end(), [](const Event &a, const Event &b) {
+    return a.offset < b.offset;
+  });
+  return events;
+}
+
+void BootTimeline::write_prometheus(std::ostream &out) const {
+  write_prometheus(out, events());
+}
+
+void BootTimeline::write_prometheus(std::ostream &out, const std::vector<Event> &events) const {
+  out << "# HELP anbox_boot_event_seconds Time since the start of the session manager an event happened the first time.\n"
+      << "# TYPE anbox_boot_event_seconds gauge\n";
+  for (const auto &event : events)
+    out << "anbox_boot_event_seconds{event=\"" << escape_prometheus_label(event.name) << "\"} "
+        << seconds(event.offset) << "\n";
+}
+
+void BootTimeline::report(const std::vector<Event> &events, const std::string &path) const {
+  auto previous = std::chrono::nanoseconds{0};
+  for (const auto &event : events) {
+    INFO("  %8.3f s (+%.3f s) %s", seconds(event.offset), seconds(event.offset - previous),
+         event.name);
+    previous = event.offset;
+  }
+
+  if (path.empty())
+    return;
+
+  const auto tmp_path = path + ".tmp";
+  {
+    std::ofstream out(tmp_path, std::ios::trunc);
+    write_prometheus(out, events);
+    if (!out) {
+      ERROR("Failed to write boot timeline to %s", tmp_path);
+      return;
+    }
+  }
+
+  boost::system::error_code err;
+  boost::filesystem::rename(tmp_path, path, err);
+  if (err)
+    ERROR("Failed to write boot timeline to %s: %s", path, err.message());
+}
+}  // namespace common
+}  // namespace anbox
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef ANBOX_COMMON_BOOT_TIMELINE_H_
+#define ANBOX_COMMON_BOOT_TIMELINE_H_
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace anbox {
+namespace common {
+// Records when the steps on the way to a booted Android happened the first
+// time, from the start of the session manager until Android tells us it
+// finished booting, to find out which of them got slower.
+//
+// Marks can come from any thread. Once boot finished marking is a single
+// atomic load so it can stay on hot paths.
+class BootTimeline {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Event {
+    std::string name;
+    // Time since the timeline was created.
+    std::chrono::nanoseconds offset;
+  };
+
+  static constexpr const char *boot_finished{"boot_finished"};
+
+  // The timeline of this process, which starts the first time it is used.
+  static BootTimeline &instance();
+
+  BootTimeline();
+
+  // Only the first mark of every |name| is kept.
+  void mark(const std::string &name);
+  void mark(const std::string &name, const Clock::time_point &time);
+
+  // Marks boot_finished, stops recording and reports the timeline in the
+  // log and, if set, in the report file. Only the first call counts.
+  void finish();
+  void finish(const Clock::time_point &time);
+  bool finished() const { return finished_.load(); }
+
+  // The timeline is written to |path| in the Prometheus text format when
+  // boot finished.
+  void set_report_path(const std::string &path);
+
+  // Events in the order they happened.
+  std::vector<Event> events() const;
+  void write_prometheus(std::ostream &out) const;
+
+ private:
+  // Logs |events| and writes them to |path| if it isn't empty.
+  void report(const std::vector<Event> &events, const std::string &path) const;
+  void write_prometheus(std::ostream &out, const std::vector<Event> &events) const;
+
+  const Clock::time_point start_;
+  std::atomic<bool> finished_;
+  mutable std::mutex lock_;
+  std::vector<Event> events_;
+  std::string report_path_;
+};
+}  // namespace common
+}  // namespace anbox
+
+#endif
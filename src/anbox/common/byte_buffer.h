@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_COMMON_BYTE_BUFFER_H_
+#define ANBOX_COMMON_BYTE_BUFFER_H_
+
+#include "anbox/common/block_pool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+namespace anbox {
+namespace common {
+// A move-only buffer of bytes for data which is passed from one thread to
+// another, like the packets we exchange with the guest.
+//
+// Up to |InlineSize| bytes live inside of the object. Anything larger is
+// put into a block of a BlockPool, which makes allocating cheap once the
+// pool warmed up, and a move just passes the block on. Unlike
+// SmallVector, growing never initializes the new bytes.
+template <std::size_t InlineSize>
+class ByteBuffer {
+ public:
+  static constexpr std::size_t inline_size = InlineSize;
+
+  explicit ByteBuffer(BlockPool &pool = BlockPool::instance())
+      : pool_(&pool), data_(inline_), size_(0), capacity_(InlineSize) {}
+
+  ByteBuffer(const char *begin, const char *end, BlockPool &pool = BlockPool::instance())
+      : ByteBuffer(pool) {
+    resize_noinit(static_cast<std::size_t>(end - begin));
+    std::memcpy(data_, begin, size_);
+  }
+
+  ByteBuffer(ByteBuffer &&other) noexcept : ByteBuffer(*other.pool_) { take(other); }
+
+  ByteBuffer &operator=(ByteBuffer &&other) noexcept {
+    if (&other != this) {
+      release();
+      pool_ = other.pool_;
+      take(other);
+    }
+    return *this;
+  }
+
+  ByteBuffer(const ByteBuffer &) = delete;
+  ByteBuffer &operator=(const ByteBuffer &) = delete;
+
+  ~ByteBuffer() { release(); }
+
+  char *data() { return data_; }
+  const char *data() const { return data_; }
+  std::size_t size() const { return size_; }
+  std::size_t capacity() const { return capacity_; }
+  bool empty() const { return size_ == 0; }
+
+  // Returns true when the bytes live in a pool block.
+  bool isAllocated() const { return data_ != inline_; }
+
+  // Keeps the first |size| bytes. New bytes are not initialized.
+  void resize_noinit(std::size_t size) {
+    reserve(size);
+    size_ = size;
+  }
+
+  void reserve(std::size_t capacity) {
+    if (capacity <= capacity_)
+      return;
+
+    // Sizes above the largest pool block still grow by 1.5x.
+    const auto new_capacity = BlockPool::capacity_for(std::max(capacity, capacity_ + capacity_ / 2));
+    const auto block = static_cast<char *>(pool_->acquire(new_capacity));
+    std::memcpy(block, data_, size_);
+    release();
+    data_ = block;
+    capacity_ = new_capacity;
+  }
+
+  void push_back(char c) {
+    reserve(size_ + 1);
+    data_[size_++] = c;
+  }
+
+  // Replaces the content by |size| uninitialized bytes in storage which
+  // is just large enough, e.g. to give memory back after shrinking.
+  void reset(std::size_t size) {
+    release();
+    size_ = 0;
+    resize_noinit(size);
+  }
+
+  // Keeps the block, if any, for what comes next.
+  void clear() { size_ = 0; }
+
+ private:
+  void release() {
+    if (isAllocated())
+      pool_->release(data_, capacity_);
+    data_ = inline_;
+    capacity_ = InlineSize;
+  }
+
+  // Expects us to be empty and in-place.
+  void take(ByteBuffer &other) {
+    size_ = other.size_;
+    if (other.isAllocated()) {
+      data_ = other.data_;
+      capacity_ = other.capacity_;
+      other.data_ = other.inline_;
+      other.capacity_ = InlineSize;
+    } else {
+      std::memcpy(inline_, other.inline_, size_);
+    }
+    other.size_ = 0;
+  }
+
+  BlockPool *pool_;
+  char *data_;
+  std::size_t size_;
+  std::size_t capacity_;
+  char inline_[InlineSize > 0 ? InlineSize : 1];
+};
+
+template <std::size_t InlineSize>
+constexpr std::size_t ByteBuffer<InlineSize>::inline_size;
+}  // namespace common
+}  // namespace anbox
+
+#endif
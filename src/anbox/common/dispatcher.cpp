@@ -18,6 +18,7 @@
  */
 
 #include "anbox/common/dispatcher.h"
+#include "anbox/common/tracer.h"
 
 namespace {
 struct AsioStrandDispatcher : public anbox::common::Dispatcher {
@@ -25,7 +26,27 @@ struct AsioStrandDispatcher : public anbox::common::Dispatcher {
   AsioStrandDispatcher(const std::shared_ptr<anbox::Runtime>& rt)
       : rt{rt}, strand{rt->service()} {}
 
-  void dispatch(const Task& task) override { strand.post(task); }
+  void dispatch(const Task& task) override {
+    const auto statistics = rt->handler_statistics();
+    if (!statistics) {
+      strand.post([task]() {
+        ANBOX_TRACE_SPAN("runtime", "dispatcher");
+        task();
+      });
+      return;
+    }
+
+    const auto posted = anbox::common::HandlerStatistics::Clock::now();
+    strand.post([statistics, posted, task]() {
+      const auto started = anbox::common::HandlerStatistics::Clock::now();
+      {
+        ANBOX_TRACE_SPAN("runtime", "dispatcher");
+        task();
+      }
+      statistics->handler_executed("dispatcher", posted, started,
+                                   anbox::common::HandlerStatistics::Clock::now());
+    });
+  }
 
  private:
   std::shared_ptr<anbox::Runtime> rt;
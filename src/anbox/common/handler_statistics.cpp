@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/common/handler_statistics.h"
+
+namespace anbox {
+namespace common {
+constexpr std::size_t HandlerStatistics::max_samples;
+
+void HandlerStatistics::handler_executed(const std::string &tag, const Clock::time_point &posted,
+                                         const Clock::time_point &started,
+                                         const Clock::time_point &finished) {
+  std::lock_guard<std::mutex> l(lock_);
+  auto &t = tags_[tag];
+  t.handlers++;
+  if (posted != Clock::time_point{})
+    t.queued.add(started - posted);
+  t.execution.add(finished - started);
+}
+
+void HandlerStatistics::queue_probed(const std::string &service, const std::chrono::nanoseconds &delay) {
+  std::lock_guard<std::mutex> l(lock_);
+  auto &q = queues_[service];
+  q.probes++;
+  q.delay.add(delay);
+}
+
+std::vector<HandlerStatistics::Summary> HandlerStatistics::summary() const {
+  std::lock_guard<std::mutex> l(lock_);
+
+  std::vector<Summary> result;
+  for (const auto &t : tags_)
+    result.push_back(Summary{t.first, t.second.handlers, t.second.queued.percentiles(),
+                             t.second.execution.percentiles()});
+  return result;
+}
+
+std::vector<HandlerStatistics::QueueSummary> HandlerStatistics::queue_summary() const {
+  std::lock_guard<std::mutex> l(lock_);
+
+  std::vector<QueueSummary> result;
+  for (const auto &q : queues_)
+    result.push_back(QueueSummary{q.first, q.second.probes, q.second.delay.percentiles()});
+  return result;
+}
+
+void HandlerStatistics::write_prometheus(std::ostream &out) const {
+  const auto tags = summary();
+  const auto queues = queue_summary();
+
+  out << "# HELP anbox_runtime_handlers_total Handlers the runtime executed.\n"
+      << "# TYPE anbox_runtime_handlers_total counter\n";
+  for (const auto &s : tags)
+    out << "anbox_runtime_handlers_total{tag=\"" << escape_prometheus_label(s.tag) << "\"} "
+        << s.handlers << "\n";
+
+  out << "# HELP anbox_runtime_handler_seconds Time handlers waited to run and took to execute.\n"
+      << "# TYPE anbox_runtime_handler_seconds gauge\n";
+  for (const auto &s : tags) {
+    const auto tag = "tag=\"" + escape_prometheus_label(s.tag) + "\"";
+    write_prometheus_quantiles(out, "anbox_runtime_handler_seconds", tag + ",stage=\"queued\"", s.queued);
+    write_prometheus_quantiles(out, "anbox_runtime_handler_seconds", tag + ",stage=\"execution\"", s.execution);
+  }
+
+  out << "# HELP anbox_runtime_queue_delay_seconds Time a handler posted to a service of the runtime waited to run.\n"
+      << "# TYPE anbox_runtime_queue_delay_seconds gauge\n";
+  for (const auto &q : queues)
+    write_prometheus_quantiles(out, "anbox_runtime_queue_delay_seconds",
+                               "service=\"" + escape_prometheus_label(q.service) + "\"", q.delay);
+}
+}  // namespace common
+}  // namespace anbox
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_COMMON_HANDLER_STATISTICS_H_
+#define ANBOX_COMMON_HANDLER_STATISTICS_H_
+
+#include "anbox/common/latency_samples.h"
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace anbox {
+namespace common {
+// Tracks the handlers run by the runtime, per tag like the type of the
+// connection they serve, to see which subsystem keeps the runtime busy.
+//
+// For handlers we posted ourself we know how long they waited to run.
+// Completion handlers of I/O only come with their execution time, so the
+// queue delay of each service of the runtime is sampled separately by
+// posting probes to it.
+class HandlerStatistics {
+ public:
+  typedef std::chrono::steady_clock Clock;
+  typedef LatencySamples::Percentiles Percentiles;
+
+  struct Summary {
+    std::string tag;
+    std::uint64_t handlers;
+    // From posting a handler until it started. Only known for handlers
+    // we posted ourself.
+    Percentiles queued;
+    Percentiles execution;
+  };
+
+  struct QueueSummary {
+    std::string service;
+    std::uint64_t probes;
+    Percentiles delay;
+  };
+
+  static constexpr std::size_t max_samples{600};
+
+  // |posted| is the default value when it isn't known.
+  void handler_executed(const std::string &tag, const Clock::time_point &posted,
+                        const Clock::time_point &started, const Clock::time_point &finished);
+  void queue_probed(const std::string &service, const std::chrono::nanoseconds &delay);
+
+  std::vector<Summary> summary() const;
+  std::vector<QueueSummary> queue_summary() const;
+
+  // Writes summary() and queue_summary() in the Prometheus text
+  // exposition format.
+  void write_prometheus(std::ostream &out) const;
+
+ private:
+  struct Tag {
+    std::uint64_t handlers = 0;
+    LatencySamples queued{max_samples};
+    LatencySamples execution{max_samples};
+  };
+  struct Queue {
+    std::uint64_t probes = 0;
+    LatencySamples delay{max_samples};
+  };
+
+  mutable std::mutex lock_;
+  std::map<std::string, Tag> tags_;
+  std::map<std::string, Queue> queues_;
+};
+}  // namespace common
+}  // namespace anbox
+
+#endif
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/common/huge_page_buffer.h"
+
+#include <boost/throw_exception.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+#include <sys/mman.h>
+
+namespace {
+std::atomic<anbox::common::HugePageBuffer::Mode> current_mode{
+    anbox::common::HugePageBuffer::Mode::Off};
+std::atomic<std::uint64_t> reserved_buffers{0};
+std::atomic<std::uint64_t> transparent_buffers{0};
+std::atomic<std::uint64_t> fallback_buffers{0};
+
+void *map(std::size_t length, int flags) {
+  const auto addr = ::mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+  return addr == MAP_FAILED ? nullptr : addr;
+}
+}  // namespace
+
+namespace anbox {
+namespace common {
+constexpr std::size_t HugePageBuffer::huge_page_size;
+
+void HugePageBuffer::set_mode(Mode mode) { current_mode.store(mode); }
+
+HugePageBuffer::Mode HugePageBuffer::mode() { return current_mode.load(); }
+
+HugePageBuffer::Statistics HugePageBuffer::statistics() {
+  return Statistics{reserved_buffers.load(), transparent_buffers.load(), fallback_buffers.load()};
+}
+
+void HugePageBuffer::write_prometheus(std::ostream &out) {
+  const auto s = statistics();
+  out << "# HELP anbox_huge_page_buffers_total Large transfer buffers allocated with huge pages.\n"
+      << "# TYPE anbox_huge_page_buffers_total counter\n"
+      << "anbox_huge_page_buffers_total{kind=\"reserved\"} " << s.reserved << "\n"
+      << "anbox_huge_page_buffers_total{kind=\"transparent\"} " << s.transparent << "\n"
+      << "# HELP anbox_huge_page_fallbacks_total Large transfer buffers which got no reserved huge pages.\n"
+      << "# TYPE anbox_huge_page_fallbacks_total counter\n"
+      << "anbox_huge_page_fallbacks_total " << s.fallbacks << "\n";
+}
+
+HugePageBuffer::HugePageBuffer(std::size_t size) : size_(size) {
+  const auto m = mode();
+  if (m != Mode::Off && size >= huge_page_size) {
+    const auto length = (size + huge_page_size - 1) & ~(huge_page_size - 1);
+
+    void *addr = nullptr;
+    if (m == Mode::Reserved) {
+      addr = map(length, MAP_HUGETLB);
+      if (addr)
+        reserved_buffers++;
+      else
+        fallback_buffers++;
+    }
+    if (!addr) {
+      addr = map(length, 0);
+      if (addr && ::madvise(addr, length, MADV_HUGEPAGE) == 0)
+        transparent_buffers++;
+    }
+    if (addr) {
+      data_ = static_cast<std::uint8_t *>(addr);
+      mapped_ = length;
+      return;
+    }
+  }
+
+  data_ = static_cast<std::uint8_t *>(std::malloc(size));
+  if (!data_)
+    size_ = 0;
+}
+
+HugePageBuffer::~HugePageBuffer() { release(); }
+
+HugePageBuffer::HugePageBuffer(HugePageBuffer &&other) noexcept
+    : data_(other.data_), size_(other.size_), mapped_(other.mapped_) {
+  other.data_ = nullptr;
+  other.size_ = 0;
+  other.mapped_ = 0;
+}
+
+HugePageBuffer &HugePageBuffer::operator=(HugePageBuffer &&other) noexcept {
+  if (this != &other) {
+    release();
+    data_ = other.data_;
+    size_ = other.size_;
+    mapped_ = other.mapped_;
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.mapped_ = 0;
+  }
+  return *this;
+}
+
+void HugePageBuffer::release() {
+  if (mapped_ > 0)
+    ::munmap(data_, mapped_);
+  else
+    std::free(data_);
+  data_ = nullptr;
+  size_ = 0;
+  mapped_ = 0;
+}
+
+std::istream &operator>>(std::istream &in, HugePageBuffer::Mode &mode) {
+  std::string str(std::istreambuf_iterator<char>(in), {});
+  if (str.empty() || str == "off")
+    mode = HugePageBuffer::Mode::Off;
+  else if (str == "transparent")
+    mode = HugePageBuffer::Mode::Transparent;
+  else if (str == "reserved")
+    mode = HugePageBuffer::Mode::Reserved;
+  else
+    BOOST_THROW_EXCEPTION(std::runtime_error("Invalid huge page mode provided"));
+  return in;
+}
+}  // namespace common
+}  // namespace anbox
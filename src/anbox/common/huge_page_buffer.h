@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_COMMON_HUGE_PAGE_BUFFER_H_
+#define ANBOX_COMMON_HUGE_PAGE_BUFFER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+
+namespace anbox {
+namespace common {
+// Memory for large, long-lived buffers GL data passes through, like the
+// stream of a GL client and the buffers incomplete commands are collected
+// in. Filling them on texture uploads faults in one 4 KiB page after the
+// other and the TLB misses show up once the data is read.
+//
+// Unless huge pages are enabled, or the buffer is smaller than one, this
+// is plain malloc. Otherwise the buffer is either taken from the huge
+// pages reserved by the administrator or, if there are none left, marked
+// for transparent huge pages, which the kernel may or may not provide.
+class HugePageBuffer {
+ public:
+  enum class Mode {
+    Off,
+    // madvise(MADV_HUGEPAGE)
+    Transparent,
+    // MAP_HUGETLB, falling back to Transparent.
+    Reserved,
+  };
+
+  static constexpr std::size_t huge_page_size{2 * 1024 * 1024};
+
+  struct Statistics {
+    // Buffers backed by reserved huge pages.
+    std::uint64_t reserved;
+    // Buffers marked for transparent huge pages.
+    std::uint64_t transparent;
+    // Buffers which wanted reserved huge pages but got none.
+    std::uint64_t fallbacks;
+  };
+
+  // Applies to buffers allocated afterwards.
+  static void set_mode(Mode mode);
+  static Mode mode();
+
+  static Statistics statistics();
+  static void write_prometheus(std::ostream &out);
+
+  HugePageBuffer() = default;
+  // Leaves the buffer empty when we're out of memory, see valid().
+  explicit HugePageBuffer(std::size_t size);
+  ~HugePageBuffer();
+
+  HugePageBuffer(HugePageBuffer &&other) noexcept;
+  HugePageBuffer &operator=(HugePageBuffer &&other) noexcept;
+  HugePageBuffer(const HugePageBuffer &) = delete;
+  HugePageBuffer &operator=(const HugePageBuffer &) = delete;
+
+  std::uint8_t *data() const { return data_; }
+  std::size_t size() const { return size_; }
+  bool huge_pages() const { return mapped_ > 0; }
+  // False if the memory couldn't be allocated. The buffer is then empty
+  // and has no data.
+  bool valid() const { return data_ != nullptr; }
+
+ private:
+  void release();
+
+  std::uint8_t *data_ = nullptr;
+  std::size_t size_ = 0;
+  // Length of the mapping, zero if the buffer came from malloc.
+  std::size_t mapped_ = 0;
+};
+
+// Parses a mode as given on the command line: off, transparent or
+// reserved.
+std::istream &operator>>(std::istream &in, HugePageBuffer::Mode &mode);
+}  // namespace common
+}  // namespace anbox
+
+#endif
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "anbox/common/image_mount.h"
+#include "anbox/common/loop_device.h"
+#include "anbox/common/loop_device_allocator.h"
+#include "anbox/common/mount_entry.h"
+#include "anbox/logger.h"
+
+#include <boost/filesystem.hpp>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>
+
+#include <fcntl.h>
+#include <linux/loop.h>
+#include <mntent.h>
+#include <sys/ioctl.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = boost::filesystem;
+
+namespace {
+std::mutex registry_lock;
+std::map<std::string, std::weak_ptr<anbox::common::ImageMount>> registry;
+
+// Both are stored little endian.
+constexpr std::uint32_t squashfs_magic{0x73717368};
+constexpr off_t squashfs_magic_offset{0};
+constexpr std::uint32_t erofs_magic{0xe0f5e1e2};
+constexpr off_t erofs_magic_offset{1024};
+
+bool has_magic(int fd, off_t offset, std::uint32_t magic) {
+  std::uint8_t data[4];
+  if (::pread(fd, data, sizeof(data), offset) != sizeof(data))
+    return false;
+  const auto value = static_cast<std::uint32_t>(data[0]) |
+                     static_cast<std::uint32_t>(data[1]) << 8 |
+                     static_cast<std::uint32_t>(data[2]) << 16 |
+                     static_cast<std::uint32_t>(data[3]) << 24;
+  return value == magic;
+}
+
+bool is_image_type(const std::string &type) {
+  return type == "squashfs" || type == "erofs";
+}
+
+// Returns the device mounted at |target| and its file system type or an
+// empty device if nothing is mounted there.
+std::pair<std::string, std::string> mounted_at(const fs::path &target) {
+  std::pair<std::string, std::string> result;
+  auto mounts = ::setmntent("/proc/self/mounts", "r");
+  if (!mounts)
+    return result;
+
+  struct mntent *entry = nullptr;
+  while ((entry = ::getmntent(mounts)) != nullptr) {
+    // Later mounts hide earlier ones so the last one wins.
+    if (target == entry->mnt_dir)
+      result = {entry->mnt_fsname, entry->mnt_type};
+  }
+  ::endmntent(mounts);
+  return result;
+}
+
+// Whether the loop device at |device| is backed by the file |image| is
+// right now, rather than one which was replaced since then.
+bool is_backed_by(const std::string &device, const fs::path &image) {
+  struct stat image_stat;
+  if (::stat(image.c_str(), &image_stat) != 0)
+    return false;
+
+  const auto fd = ::open(device.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+
+  struct loop_info64 info;
+  const auto ret = ::ioctl(fd, LOOP_GET_STATUS64, &info);
+  ::close(fd);
+  return ret == 0 && info.lo_device == image_stat.st_dev && info.lo_inode == image_stat.st_ino;
+}
+}  // namespace
+
+namespace anbox {
+namespace common {
+std::shared_ptr<ImageMount> ImageMount::acquire(const fs::path &image, const fs::path &target) {
+  std::lock_guard<std::mutex> l(registry_lock);
+
+  boost::system::error_code err;
+  const auto canonical_target = fs::canonical(target, err);
+  if (err) {
+    ERROR("Failed to resolve mount point %s: %s", target, err.message());
+    return nullptr;
+  }
+
+  auto &known = registry[canonical_target.string()];
+  if (auto mount = known.lock())
+    return mount;
+
+  const auto type = filesystem_type(image);
+  if (type.empty()) {
+    ERROR("%s is neither a squashfs nor an EROFS image", image);
+    return nullptr;
+  }
+
+  const auto mounted = mounted_at(canonical_target);
+  if (!mounted.first.empty()) {
+    if (mounted.second == type && is_backed_by(mounted.first, image)) {
+      DEBUG("Reusing mount of %s at %s", image, canonical_target);
+      auto mount = std::shared_ptr<ImageMount>(new ImageMount(canonical_target, nullptr, true));
+      known = mount;
+      return mount;
+    }
+
+    // Most likely the image got updated while it was still mounted.
+    if (!is_image_type(mounted.second) || ::umount(canonical_target.c_str()) != 0) {
+      ERROR("Something else than %s is mounted at %s already", image, canonical_target);
+      return nullptr;
+    }
+  }
+
+  auto loop = LoopDeviceAllocator::new_device();
+  if (!loop || !loop->attach_file(image)) {
+    ERROR("Failed to attach %s to a loop device", image);
+    return nullptr;
+  }
+
+  if (::mount(loop->path().c_str(), canonical_target.c_str(), type.c_str(), MS_MGC_VAL | MS_RDONLY, nullptr) != 0) {
+    if (errno == ENODEV)
+      ERROR("Failed to mount %s at %s: the kernel doesn't support %s", image, canonical_target, type);
+    else
+      ERROR("Failed to mount %s at %s: %s", image, canonical_target, std::strerror(errno));
+    return nullptr;
+  }
+
+  // Changing the propagation type can't be combined with the mount itself.
+  if (::mount(nullptr, canonical_target.c_str(), nullptr, MS_PRIVATE, nullptr) != 0)
+    WARNING("Failed to make mount of %s private: %s", image, std::strerror(errno));
+
+  auto mount = std::shared_ptr<ImageMount>(new ImageMount(canonical_target, loop, false));
+  known = mount;
+  return mount;
+}
+
+std::string ImageMount::filesystem_type(const fs::path &image) {
+  const auto fd = ::open(image.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return std::string();
+
+  std::string type;
+  if (has_magic(fd, squashfs_magic_offset, squashfs_magic))
+    type = "squashfs";
+  else if (has_magic(fd, erofs_magic_offset, erofs_magic))
+    type = "erofs";
+  ::close(fd);
+  return type;
+}
+
+ImageMount::ImageMount(const fs::path &target, const std::shared_ptr<LoopDevice> &loop, bool reused)
+    : target_(target), loop_(loop), reused_(reused), keep_(false) {}
+
+ImageMount::~ImageMount() {
+  // Nobody may pick our mount up again until it is gone.
+  std::lock_guard<std::mutex> l(registry_lock);
+  auto known = registry.find(target_.string());
+  if (known != registry.end() && known->second.expired())
+    registry.erase(known);
+
+  // The loop device detaches itself once the image gets unmounted.
+  if (keep_)
+    return;
+
+  // Processes of a killed container may still be on their way out, the
+  // image is released once they are gone.
+  if (::umount(target_.c_str()) != 0 &&
+      (errno != EBUSY || !MountEntry::busy_mounts_detached() ||
+       ::umount2(target_.c_str(), MNT_DETACH) != 0))
+    WARNING("Failed to unmount %s: %s", target_, std::strerror(errno));
+}
+
+void ImageMount::keep_mounted(bool keep) {
+  keep_ = keep;
+}
+} // namespace common
+} // namespace anbox
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef ANBOX_COMMON_IMAGE_MOUNT_H_
+#define ANBOX_COMMON_IMAGE_MOUNT_H_
+
+#include <boost/filesystem/path.hpp>
+
+#include <memory>
+#include <string>
+
+namespace anbox {
+namespace common {
+class LoopDevice;
+// A read-only squashfs or EROFS image mounted through a loop device.
+//
+// Everybody asking for the same image at the same place shares one mount
+// which goes away with its last user. A mount an earlier run left behind
+// is taken over as long as it is still backed by the very same file, which
+// spares us attaching a loop device and keeps the pages of the image in
+// the page cache.
+class ImageMount {
+ public:
+  // Returns nullptr when |image| can't be mounted at |target| or something
+  // else is mounted there.
+  static std::shared_ptr<ImageMount> acquire(const boost::filesystem::path &image,
+                                             const boost::filesystem::path &target);
+
+  ~ImageMount();
+
+  // "squashfs" or "erofs" as told by the superblock of |image|, empty if
+  // it is neither.
+  static std::string filesystem_type(const boost::filesystem::path &image);
+
+  // With |keep| set the image stays mounted once the last user is gone so
+  // that the next run can take it over.
+  void keep_mounted(bool keep);
+
+  const boost::filesystem::path &target() const { return target_; }
+  // Whether we took over a mount of an earlier run.
+  bool reused() const { return reused_; }
+
+ private:
+  ImageMount(const boost::filesystem::path &target, const std::shared_ptr<LoopDevice> &loop,
+             bool reused);
+
+  boost::filesystem::path target_;
+  std::shared_ptr<LoopDevice> loop_;
+  bool reused_;
+  bool keep_;
+};
+} // namespace common
+} // namespace anbox
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "anbox/common/latency_samples.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+double seconds(const std::chrono::nanoseconds &ns) {
+  return std::chrono::duration<double>(ns).count();
+}
+}  // namespace
+
+namespace anbox {
+namespace common {
+LatencySamples::LatencySamples(std::size_t max_samples) : max_samples_(max_samples), next_(0) {}
+
+void LatencySamples::add(const std::chrono::nanoseconds &value) {
+  if (max_samples_ == 0)
+    return;
+
+  const auto sample = std::max<std::int64_t>(0, value.count());
+  if (values_.size() < max_samples_) {
+    if (values_.empty())
+      values_.reserve(max_samples_);
+    values_.push_back(sample);
+    return;
+  }
+  values_[next_] = sample;
+  next_ = (next_ + 1) % max_samples_;
+}
+
+LatencySamples::Percentiles LatencySamples::percentiles() const {
+  Percentiles p{};
+  if (values_.empty())
+    return p;
+
+  std::vector<std::int64_t> sorted(values_.begin(), values_.end());
+  std::sort(sorted.begin(), sorted.end());
+  const auto at = [&](unsigned int percent) {
+    // Nearest rank, so a percentile is always one of the samples.
+    const auto rank = (sorted.size() * percent + 99) / 100;
+    return std::chrono::nanoseconds{sorted[std::max<std::size_t>(rank, 1) - 1]};
+  };
+  p.p50 = at(50);
+  p.p90 = at(90);
+  p.p99 = at(99);
+  p.max = std::chrono::nanoseconds{sorted.back()};
+  return p;
+}
+
+std::string escape_prometheus_label(const std::string &value) {
+  std::string escaped;
+  for (const auto c : value) {
+    if (c == '\\' || c == '"')
+      escaped += '\\';
+    if (c == '\n') {
+      escaped += "\\n";
+      continue;
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+
+void write_prometheus_quantiles(std::ostream &out, const char *metric,
+                                const std::string &labels,
+                                const LatencySamples::Percentiles &p) {
+  out << metric << "{" << labels << ",quantile=\"0.5\"} " << seconds(p.p50) << "\n"
+      << metric << "{" << labels << ",quantile=\"0.9\"} " << seconds(p.p90) << "\n"
+      << metric << "{" << labels << ",quantile=\"0.99\"} " << seconds(p.p99) << "\n"
+      << metric << "{" << labels << ",quantile=\"1\"} " << seconds(p.max) << "\n";
+}
+}  // namespace common
+}  // namespace anbox
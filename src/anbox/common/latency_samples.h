@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef ANBOX_COMMON_LATENCY_SAMPLES_H_
+#define ANBOX_COMMON_LATENCY_SAMPLES_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace anbox {
+namespace common {
+// Keeps the most recent measurements of a duration to compute
+// percentiles over them. Once |max_samples| were added new ones replace
+// the oldest in place, so adding doesn't allocate anymore.
+class LatencySamples {
+ public:
+  struct Percentiles {
+    std::chrono::nanoseconds p50;
+    std::chrono::nanoseconds p90;
+    std::chrono::nanoseconds p99;
+    std::chrono::nanoseconds max;
+  };
+
+  explicit LatencySamples(std::size_t max_samples);
+
+  // Negative durations count as zero.
+  void add(const std::chrono::nanoseconds &value);
+  Percentiles percentiles() const;
+
+ private:
+  std::size_t max_samples_;
+  std::vector<std::int64_t> values_;
+  // Where the next sample goes once all |max_samples_| are in use.
+  std::size_t next_;
+};
+
+// Escapes |value| for use as a label value in the Prometheus text format.
+std::string escape_prometheus_label(const std::string &value);
+
+// Writes |p| as the quantiles of a Prometheus summary in seconds.
+void write_prometheus_quantiles(std::ostream &out, const char *metric,
+                                const std::string &labels,
+                                const LatencySamples::Percentiles &p);
+}  // namespace common
+}  // namespace anbox
+
+#endif
@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_COMMON_LOCK_FREE_QUEUE_H_
+#define ANBOX_COMMON_LOCK_FREE_QUEUE_H_
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace anbox {
+namespace common {
+constexpr std::size_t cache_line_size{64};
+
+// Lets a thread sleep until another one made progress without taking a
+// lock on the way. Waking costs an atomic load as long as nobody sleeps
+// and a futex call otherwise.
+//
+// A waiter calls prepare_wait(), checks its condition once more and then
+// either calls cancel_wait() or wait() with what prepare_wait() returned.
+// Anything which changes the condition calls notify() afterwards.
+class WaitEvent {
+ public:
+  std::uint32_t prepare_wait() {
+    waiters_.fetch_add(1);
+    return sequence_.load();
+  }
+
+  void cancel_wait() { waiters_.fetch_sub(1); }
+
+  void wait(std::uint32_t sequence) {
+    // Returns right away when notify() was called since prepare_wait().
+    ::syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&sequence_), FUTEX_WAIT_PRIVATE,
+              sequence, nullptr, nullptr, 0);
+    waiters_.fetch_sub(1);
+  }
+
+  void notify() {
+    // Orders the change of the condition before looking for waiters, which
+    // pairs with their increment of waiters_ before checking it.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_relaxed) == 0)
+      return;
+    sequence_.fetch_add(1);
+    ::syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&sequence_), FUTEX_WAKE_PRIVATE,
+              INT32_MAX, nullptr, nullptr, 0);
+  }
+
+ private:
+  std::atomic<std::uint32_t> sequence_{0};
+  std::atomic<std::uint32_t> waiters_{0};
+};
+
+// Implements the blocking calls of the queues below on top of their
+// non-blocking ones.
+template <typename Queue, typename T>
+class BlockingQueue {
+ public:
+  // Blocks while the queue is full. Returns -EIO once the queue is closed.
+  int push(T &&item) {
+    return block(not_full_, [&]() { return queue().try_push(std::move(item)); });
+  }
+
+  // Blocks while the queue is empty. Returns -EIO once the queue is
+  // closed and everything which was pushed before was popped.
+  int pop(T *item) {
+    return block(not_empty_, [&]() { return queue().try_pop(item); });
+  }
+
+  // Lets all pushes fail from now on and wakes everybody up.
+  void close() {
+    closed_.store(true);
+    not_full_.notify();
+    not_empty_.notify();
+  }
+
+  bool is_closed() const { return closed_.load(); }
+
+ protected:
+  template <typename Try>
+  int block(WaitEvent &event, const Try &attempt) {
+    while (true) {
+      auto result = attempt();
+      if (result != -EAGAIN)
+        return result;
+
+      const auto sequence = event.prepare_wait();
+      result = attempt();
+      if (result != -EAGAIN) {
+        event.cancel_wait();
+        return result;
+      }
+      event.wait(sequence);
+    }
+  }
+
+  Queue &queue() { return *static_cast<Queue *>(this); }
+
+  std::atomic<bool> closed_{false};
+  WaitEvent not_full_;
+  WaitEvent not_empty_;
+};
+
+// Bounded queue for exactly one producer and one consumer thread. Both
+// sides only touch their own index and an atomic load of the other one.
+//
+// All calls return 0 on success, -EAGAIN when they would have to block
+// and -EIO when the queue is closed, like graphics::BufferedIOStream
+// expects from its output queue.
+template <typename T>
+class SpscQueue : public BlockingQueue<SpscQueue<T>, T> {
+ public:
+  explicit SpscQueue(std::size_t capacity)
+      : capacity_(capacity), items_(new T[capacity]) {}
+
+  int try_push(T &&item) {
+    if (this->closed_.load(std::memory_order_acquire))
+      return -EIO;
+
+    const auto tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) >= capacity_)
+      return -EAGAIN;
+
+    items_[tail % capacity_] = std::move(item);
+    tail_.store(tail + 1, std::memory_order_release);
+    this->not_empty_.notify();
+    return 0;
+  }
+
+  int try_pop(T *item) {
+    const auto head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      if (!this->closed_.load(std::memory_order_acquire))
+        return -EAGAIN;
+      // What was pushed before closing still has to come out.
+      if (head == tail_.load(std::memory_order_acquire))
+        return -EIO;
+    }
+
+    *item = std::move(items_[head % capacity_]);
+    head_.store(head + 1, std::memory_order_release);
+    this->not_full_.notify();
+    return 0;
+  }
+
+ private:
+  const std::size_t capacity_;
+  std::unique_ptr<T[]> items_;
+  // Kept apart so that producer and consumer don't fight over a cache
+  // line. Padding instead of alignas as we can't rely on new honoring
+  // extended alignments before C++17.
+  char pad_head_[cache_line_size];
+  std::atomic<std::size_t> head_{0};
+  char pad_tail_[cache_line_size - sizeof(std::atomic<std::size_t>)];
+  std::atomic<std::size_t> tail_{0};
+};
+
+// Bounded queue for any number of producers and a single consumer. Every
+// slot carries a sequence number telling whether it is free to be written
+// or ready to be read for the current lap around the ring. Position |pos|
+// is free with sequence 2 * pos and filled with 2 * pos + 1, so that a
+// full slot never looks like a free one of the next lap, not even with a
+// capacity of one.
+//
+// Returns the same values as SpscQueue. Pushes racing with close() may
+// be dropped, everything pushed before it is popped.
+template <typename T>
+class MpscQueue : public BlockingQueue<MpscQueue<T>, T> {
+ public:
+  explicit MpscQueue(std::size_t capacity)
+      : capacity_(capacity), slots_(new Slot[capacity]) {
+    for (std::size_t n = 0; n < capacity_; n++)
+      slots_[n].sequence.store(2 * n, std::memory_order_relaxed);
+  }
+
+  int try_push(T &&item) {
+    if (this->closed_.load(std::memory_order_acquire))
+      return -EIO;
+
+    auto pos = tail_.load(std::memory_order_relaxed);
+    Slot *slot = nullptr;
+    while (true) {
+      slot = &slots_[pos % capacity_];
+      const auto sequence = slot->sequence.load(std::memory_order_acquire);
+      const auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(2 * pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        // The consumer didn't get to the slot one lap earlier yet.
+        return -EAGAIN;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+
+    slot->item = std::move(item);
+    slot->sequence.store(2 * pos + 1, std::memory_order_release);
+    this->not_empty_.notify();
+    return 0;
+  }
+
+  int try_pop(T *item) {
+    auto &slot = slots_[head_ % capacity_];
+    const auto filled = 2 * head_ + 1;
+    if (slot.sequence.load(std::memory_order_acquire) != filled) {
+      if (!this->closed_.load(std::memory_order_acquire))
+        return -EAGAIN;
+      if (slot.sequence.load(std::memory_order_acquire) != filled)
+        return -EIO;
+    }
+
+    *item = std::move(slot.item);
+    // Hands the slot to the producers of the next lap.
+    slot.sequence.store(2 * (head_ + capacity_), std::memory_order_release);
+    head_++;
+    this->not_full_.notify();
+    return 0;
+  }
+
+ private:
+  struct Slot {
+    std::atomic<std::size_t> sequence;
+    T item;
+  };
+
+  const std::size_t capacity_;
+  std::unique_ptr<Slot[]> slots_;
+  // Only ever touched by the consumer.
+  char pad_head_[cache_line_size];
+  std::size_t head_ = 0;
+  char pad_tail_[cache_line_size - sizeof(std::size_t)];
+  std::atomic<std::size_t> tail_{0};
+};
+}  // namespace common
+}  // namespace anbox
+
+#endif
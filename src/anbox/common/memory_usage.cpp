@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/common/memory_usage.h"
+
+#include <atomic>
+#include <fstream>
+#include <ostream>
+
+#include <unistd.h>
+
+namespace {
+constexpr std::size_t subsystem_count{4};
+
+struct Account {
+  const char *name;
+  std::atomic<std::int64_t> bytes;
+};
+
+// In the order of MemoryUsage::Subsystem.
+Account subsystems[subsystem_count] = {
+    {"transport_buffers", {0}},
+    {"gl_objects", {0}},
+    {"decoder_contexts", {0}},
+    {"caches", {0}},
+};
+}  // namespace
+
+namespace anbox {
+namespace common {
+void MemoryUsage::add(Subsystem subsystem, std::int64_t bytes) {
+  subsystems[static_cast<std::size_t>(subsystem)].bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+std::int64_t MemoryUsage::bytes(Subsystem subsystem) {
+  return subsystems[static_cast<std::size_t>(subsystem)].bytes.load(std::memory_order_relaxed);
+}
+
+std::size_t MemoryUsage::resident_bytes() {
+  // The second field is the resident set in pages.
+  std::ifstream statm("/proc/self/statm");
+  std::size_t size = 0, resident = 0;
+  if (!(statm >> size >> resident))
+    return 0;
+  return resident * static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+}
+
+void MemoryUsage::write_prometheus(std::ostream &out) {
+  out << "# HELP anbox_memory_bytes Memory taken by the larger allocations of a subsystem.\n"
+      << "# TYPE anbox_memory_bytes gauge\n";
+  for (const auto &s : subsystems)
+    out << "anbox_memory_bytes{subsystem=\"" << s.name << "\"} "
+        << s.bytes.load(std::memory_order_relaxed) << "\n";
+  out << "# HELP anbox_memory_resident_bytes Resident memory of the session manager.\n"
+      << "# TYPE anbox_memory_resident_bytes gauge\n"
+      << "anbox_memory_resident_bytes " << resident_bytes() << "\n";
+}
+
+void MemoryUsage::write_summary(std::ostream &out) {
+  out << "resident " << resident_bytes() / 1024 << " KiB";
+  for (const auto &s : subsystems)
+    out << ", " << s.name << " " << s.bytes.load(std::memory_order_relaxed) / 1024 << " KiB";
+}
+}  // namespace common
+}  // namespace anbox
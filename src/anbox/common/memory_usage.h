@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_COMMON_MEMORY_USAGE_H_
+#define ANBOX_COMMON_MEMORY_USAGE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+
+namespace anbox {
+namespace common {
+// Keeps count of the memory the larger allocations of the session manager
+// take, by the subsystem they belong to, to see where the resident memory
+// of a session goes.
+//
+// Counting is a relaxed atomic add and always on, the owners of the
+// allocations report them as they grow and shrink.
+class MemoryUsage {
+ public:
+  enum class Subsystem {
+    // Buffers commands and data from the guest pass through.
+    TransportBuffers,
+    // GPU memory of color buffers and window surfaces, see
+    // graphics::MemoryAccounting.
+    GlObjects,
+    // State of the render threads including their GL decoders.
+    DecoderContexts,
+    // Memory kept around to be reused.
+    Caches,
+  };
+
+  static void add(Subsystem subsystem, std::int64_t bytes);
+  static void remove(Subsystem subsystem, std::int64_t bytes) { add(subsystem, -bytes); }
+  static std::int64_t bytes(Subsystem subsystem);
+
+  // Resident memory of the whole process or zero if unknown.
+  static std::size_t resident_bytes();
+
+  // Writes the bytes of each subsystem and the resident memory in the
+  // Prometheus text format.
+  static void write_prometheus(std::ostream &out);
+  // Writes a single line for the log.
+  static void write_summary(std::ostream &out);
+};
+}  // namespace common
+}  // namespace anbox
+
+#endif
@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/common/metrics.h"
+#include "anbox/common/latency_samples.h"
+
+#include <boost/throw_exception.hpp>
+
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+std::shared_ptr<anbox::common::Metrics> installed_instance;
+
+std::string format_labels(const anbox::common::Metrics::Labels &labels) {
+  std::string formatted;
+  for (const auto &label : labels) {
+    if (!formatted.empty())
+      formatted += ",";
+    formatted += label.first + "=\"" + anbox::common::escape_prometheus_label(label.second) + "\"";
+  }
+  return formatted;
+}
+
+std::string with_braces(const std::string &labels) {
+  return labels.empty() ? std::string{} : "{" + labels + "}";
+}
+}  // namespace
+
+namespace anbox {
+namespace common {
+constexpr unsigned int Metrics::Histogram::sub_bucket_bits;
+constexpr std::size_t Metrics::Histogram::sub_buckets;
+constexpr std::size_t Metrics::Histogram::bucket_count;
+
+std::size_t Metrics::Histogram::bucket_for(std::uint64_t value) {
+  if (value < sub_buckets)
+    return static_cast<std::size_t>(value);
+
+  const unsigned int msb = 63 - static_cast<unsigned int>(__builtin_clzll(value));
+  const auto shift = msb - sub_bucket_bits;
+  return (shift + 1) * sub_buckets + static_cast<std::size_t>((value >> shift) - sub_buckets);
+}
+
+std::uint64_t Metrics::Histogram::lowest_value_of(std::size_t bucket) {
+  if (bucket < sub_buckets)
+    return bucket;
+
+  const auto shift = bucket / sub_buckets - 1;
+  return static_cast<std::uint64_t>(sub_buckets + bucket % sub_buckets) << shift;
+}
+
+std::uint64_t Metrics::Histogram::count() const {
+  std::uint64_t count = 0;
+  for (const auto &bucket : buckets_)
+    count += bucket.load(std::memory_order_relaxed);
+  return count;
+}
+
+std::uint64_t Metrics::Histogram::value_at(double quantile) const {
+  std::uint64_t counts[bucket_count];
+  std::uint64_t total = 0;
+  for (std::size_t n = 0; n < bucket_count; n++) {
+    counts[n] = buckets_[n].load(std::memory_order_relaxed);
+    total += counts[n];
+  }
+  if (total == 0)
+    return 0;
+
+  const auto rank = std::max<std::uint64_t>(
+      1, static_cast<std::uint64_t>(std::ceil(quantile * static_cast<double>(total))));
+  std::uint64_t seen = 0;
+  for (std::size_t n = 0; n < bucket_count; n++) {
+    seen += counts[n];
+    if (seen < rank)
+      continue;
+    const auto lowest = lowest_value_of(n);
+    const auto width = n + 1 < bucket_count ? lowest_value_of(n + 1) - lowest : lowest;
+    return lowest + (width - 1) / 2;
+  }
+  return 0;
+}
+
+std::shared_ptr<Metrics> Metrics::instance() {
+  return std::atomic_load(&installed_instance);
+}
+
+void Metrics::set_instance(const std::shared_ptr<Metrics> &metrics) {
+  std::atomic_store(&installed_instance, metrics);
+}
+
+Metrics::Family &Metrics::family_locked(const std::string &name, Type type,
+                                        const std::string &help, double scale) {
+  auto family = families_.find(name);
+  if (family == families_.end())
+    family = families_.insert({name, Family{type, help, scale, {}, {}, {}}}).first;
+  else if (family->second.type != type)
+    BOOST_THROW_EXCEPTION(std::runtime_error("Metric " + name + " already exists with another type"));
+  return family->second;
+}
+
+Metrics::Counter &Metrics::counter(const std::string &name, const std::string &help,
+                                   const Labels &labels) {
+  std::lock_guard<std::mutex> l(lock_);
+  auto &series = family_locked(name, Type::Counter, help, 1.0).counters[format_labels(labels)];
+  if (!series)
+    series.reset(new Counter);
+  return *series;
+}
+
+Metrics::Gauge &Metrics::gauge(const std::string &name, const std::string &help,
+                               const Labels &labels) {
+  std::lock_guard<std::mutex> l(lock_);
+  auto &series = family_locked(name, Type::Gauge, help, 1.0).gauges[format_labels(labels)];
+  if (!series)
+    series.reset(new Gauge);
+  return *series;
+}
+
+Metrics::Histogram &Metrics::histogram(const std::string &name, const std::string &help,
+                                       const Labels &labels, double scale) {
+  std::lock_guard<std::mutex> l(lock_);
+  auto &series = family_locked(name, Type::Histogram, help, scale).histograms[format_labels(labels)];
+  if (!series)
+    series.reset(new Histogram);
+  return *series;
+}
+
+void Metrics::add_collector(const std::string &name, const Collector &collector) {
+  std::lock_guard<std::mutex> l(lock_);
+  collectors_[name] = collector;
+}
+
+void Metrics::remove_collector(const std::string &name) {
+  std::lock_guard<std::mutex> l(lock_);
+  collectors_.erase(name);
+}
+
+void Metrics::write_prometheus(std::ostream &out) const {
+  std::map<std::string, Collector> collectors;
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    for (const auto &f : families_) {
+      const auto &name = f.first;
+      const auto &family = f.second;
+      const auto type = family.type == Type::Counter ? "counter"
+                        : family.type == Type::Gauge ? "gauge" : "summary";
+      out << "# HELP " << name << " " << family.help << "\n"
+          << "# TYPE " << name << " " << type << "\n";
+
+      for (const auto &series : family.counters)
+        out << name << with_braces(series.first) << " " << series.second->value() << "\n";
+      for (const auto &series : family.gauges)
+        out << name << with_braces(series.first) << " " << series.second->value() << "\n";
+
+      for (const auto &series : family.histograms) {
+        const auto &histogram = *series.second;
+        const auto separator = series.first.empty() ? "" : ",";
+        for (const auto quantile : {0.5, 0.9, 0.99, 1.0}) {
+          out << name << "{" << series.first << separator << "quantile=\"" << quantile << "\"} "
+              << static_cast<double>(histogram.value_at(quantile)) * family.scale << "\n";
+        }
+        out << name << "_sum" << with_braces(series.first) << " "
+            << static_cast<double>(histogram.sum()) * family.scale << "\n"
+            << name << "_count" << with_braces(series.first) << " " << histogram.count() << "\n";
+      }
+    }
+    collectors = collectors_;
+  }
+
+  // Collectors may take locks of their own, don't nest them into ours.
+  for (const auto &collector : collectors)
+    collector.second(out);
+}
+}  // namespace common
+}  // namespace anbox
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_COMMON_METRICS_H_
+#define ANBOX_COMMON_METRICS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace anbox {
+namespace common {
+// Registry of all metrics of the session manager, written out in the
+// Prometheus text format.
+//
+// Metrics are created by name and labels once and then updated through
+// the returned reference, which stays valid as long as the registry
+// lives. Updates are a few relaxed atomic operations and never take a
+// lock. Statistics which already know how to write themselves plug in
+// as collectors.
+//
+// Without an installed instance() nothing is recorded at all: code
+// looks the instance up once and keeps a null pointer around.
+class Metrics {
+ public:
+  typedef std::vector<std::pair<std::string, std::string>> Labels;
+  typedef std::function<void(std::ostream &)> Collector;
+
+  class Counter {
+   public:
+    void add(std::uint64_t value = 1) { value_.fetch_add(value, std::memory_order_relaxed); }
+    std::uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+   private:
+    std::atomic<std::uint64_t> value_{0};
+  };
+
+  class Gauge {
+   public:
+    void set(std::int64_t value) { value_.store(value, std::memory_order_relaxed); }
+    void add(std::int64_t value) { value_.fetch_add(value, std::memory_order_relaxed); }
+    std::int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+   private:
+    std::atomic<std::int64_t> value_{0};
+  };
+
+  // Counts values in buckets whose width grows with the value, like an
+  // HDR histogram: values below 8 are exact, all others land in one of 8
+  // buckets per power of two and are off by at most 12.5%.
+  class Histogram {
+   public:
+    static constexpr unsigned int sub_bucket_bits{3};
+    static constexpr std::size_t sub_buckets{1 << sub_bucket_bits};
+    static constexpr std::size_t bucket_count{(64 - sub_bucket_bits + 1) * sub_buckets};
+
+    void record(std::uint64_t value) {
+      buckets_[bucket_for(value)].fetch_add(1, std::memory_order_relaxed);
+      sum_.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    std::uint64_t count() const;
+    std::uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+    // Returns the middle of the bucket holding the value at |quantile| or
+    // zero without any values.
+    std::uint64_t value_at(double quantile) const;
+
+    static std::size_t bucket_for(std::uint64_t value);
+    static std::uint64_t lowest_value_of(std::size_t bucket);
+
+   private:
+    std::atomic<std::uint64_t> buckets_[bucket_count] = {};
+    std::atomic<std::uint64_t> sum_{0};
+  };
+
+  // Returns the installed registry or nullptr when metrics are disabled.
+  static std::shared_ptr<Metrics> instance();
+  static void set_instance(const std::shared_ptr<Metrics> &metrics);
+
+  // All series of a name have to be of the same type, otherwise
+  // std::runtime_error is thrown.
+  Counter &counter(const std::string &name, const std::string &help, const Labels &labels = {});
+  Gauge &gauge(const std::string &name, const std::string &help, const Labels &labels = {});
+  // Histogram values are written as a summary. They are multiplied by
+  // |scale| on the way out, e.g. 1e-9 for durations recorded in
+  // nanoseconds but reported in seconds.
+  Histogram &histogram(const std::string &name, const std::string &help,
+                       const Labels &labels = {}, double scale = 1.0);
+
+  // A collector with the same name replaces the previous one.
+  void add_collector(const std::string &name, const Collector &collector);
+  void remove_collector(const std::string &name);
+
+  void write_prometheus(std::ostream &out) const;
+
+ private:
+  enum class Type { Counter, Gauge, Histogram };
+
+  struct Family {
+    Type type;
+    std::string help;
+    double scale;
+    std::map<std::string, std::unique_ptr<Counter>> counters;
+    std::map<std::string, std::unique_ptr<Gauge>> gauges;
+    std::map<std::string, std::unique_ptr<Histogram>> histograms;
+  };
+
+  Family &family_locked(const std::string &name, Type type, const std::string &help, double scale);
+
+  mutable std::mutex lock_;
+  std::map<std::string, Family> families_;
+  std::map<std::string, Collector> collectors_;
+};
+}  // namespace common
+}  // namespace anbox
+
+#endif
@@ -18,17 +18,30 @@
 #include "anbox/common/mount_entry.h"
 #include "anbox/common/loop_device.h"
 
+#include <atomic>
+#include <cerrno>
+
 #include <sys/mount.h>
 
+namespace {
+std::atomic<bool> detach_busy{false};
+}  // namespace
+
 namespace anbox {
 namespace common {
+void MountEntry::detach_busy_mounts() { detach_busy.store(true); }
+
+bool MountEntry::busy_mounts_detached() { return detach_busy.load(); }
+
 std::shared_ptr<MountEntry> MountEntry::create(const boost::filesystem::path &src, const boost::filesystem::path &target,
-                                               const std::string &fs_type, unsigned long flags) {
+                                               const std::string &fs_type, unsigned long flags,
+                                               const std::string &data) {
   auto entry = std::shared_ptr<MountEntry>(new MountEntry(target));
   if (!entry)
     return nullptr;
 
-  if (::mount(src.c_str(), target.c_str(), !fs_type.empty() ? fs_type.c_str() : nullptr, flags, nullptr) != 0)
+  if (::mount(src.c_str(), target.c_str(), !fs_type.empty() ? fs_type.c_str() : nullptr, flags,
+              !data.empty() ? data.c_str() : nullptr) != 0)
     return nullptr;
 
   entry->active_ = true;
@@ -53,7 +66,9 @@ MountEntry::~MountEntry() {
   if (!active_)
     return;
 
-  ::umount(target_.c_str());
+  // Whatever still uses it, it goes away once that is done with it.
+  if (::umount(target_.c_str()) != 0 && errno == EBUSY && busy_mounts_detached())
+    ::umount2(target_.c_str(), MNT_DETACH);
 }
 } // namespace common
 } // namespace anbox
@@ -26,13 +26,20 @@ class LoopDevice;
 class MountEntry {
  public:
   static std::shared_ptr<MountEntry> create(const boost::filesystem::path &src, const boost::filesystem::path &target,
-                                            const std::string &fs_type = "", unsigned long flags = 0);
+                                            const std::string &fs_type = "", unsigned long flags = 0,
+                                            const std::string &data = "");
 
   static std::shared_ptr<MountEntry> create(const std::shared_ptr<LoopDevice> &loop, const boost::filesystem::path &target,
                                             const std::string &fs_type = "", unsigned long flags = 0);
 
   ~MountEntry();
 
+  // A mount which is still busy when released is left in place unless a
+  // container was killed, see Container::kill(). Processes of that one may
+  // still be on their way out, so its mounts are detached lazily instead.
+  static void detach_busy_mounts();
+  static bool busy_mounts_detached();
+
  private:
   MountEntry(const boost::filesystem::path &target);
 
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/common/readahead_profile.h"
+#include "anbox/logger.h"
+
+#include <boost/filesystem.hpp>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = boost::filesystem;
+
+namespace {
+const char *profile_header{"# anbox readahead profile"};
+}  // namespace
+
+namespace anbox {
+namespace common {
+constexpr unsigned int ReadaheadProfile::prefetch_threads;
+constexpr std::uint64_t ReadaheadProfile::prefetch_chunk_size;
+constexpr std::chrono::seconds ReadaheadProfile::sample_interval;
+constexpr std::uint64_t ReadaheadProfile::settled_bytes;
+
+ReadaheadProfile::Image ReadaheadProfile::Image::of(const fs::path &path) {
+  Image image;
+  struct stat st;
+  if (::stat(path.c_str(), &st) != 0)
+    return image;
+  image.size = static_cast<std::uint64_t>(st.st_size);
+  image.mtime = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+  return image;
+}
+
+ReadaheadProfile::ReadaheadProfile(const fs::path &image, const fs::path &profile)
+    : image_(image), profile_(profile), stop_(false) {}
+
+ReadaheadProfile::~ReadaheadProfile() {
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    stop_ = true;
+  }
+  stop_changed_.notify_all();
+
+  if (thread_.joinable())
+    thread_.join();
+}
+
+void ReadaheadProfile::start() {
+  Image recorded;
+  std::vector<Range> ranges;
+  std::ifstream in(profile_.string());
+  if (in && read(in, recorded, ranges) && recorded == Image::of(image_)) {
+    thread_ = std::thread(&ReadaheadProfile::prefetch, this, ranges);
+    return;
+  }
+
+  INFO("Recording which parts of %s Android reads while booting to %s", image_, profile_);
+  thread_ = std::thread(&ReadaheadProfile::record, this);
+}
+
+void ReadaheadProfile::prefetch(const std::vector<Range> &ranges) {
+  const auto fd = ::open(image_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    WARNING("Failed to open %s for reading ahead: %s", image_, std::strerror(errno));
+    return;
+  }
+
+  // Ranges are split up so that all threads get their share of large ones.
+  std::vector<Range> chunks;
+  std::uint64_t total = 0;
+  for (const auto &r : ranges) {
+    for (std::uint64_t offset = 0; offset < r.length; offset += prefetch_chunk_size)
+      chunks.push_back({r.offset + offset, std::min(prefetch_chunk_size, r.length - offset)});
+    total += r.length;
+  }
+
+  // Each advice blocks until the reads are queued, a few threads keep the
+  // device busy.
+  std::atomic<std::size_t> next{0};
+  const auto worker = [&]() {
+    for (auto n = next++; n < chunks.size(); n = next++) {
+      {
+        std::lock_guard<std::mutex> l(lock_);
+        if (stop_)
+          return;
+      }
+      ::posix_fadvise(fd, chunks[n].offset, chunks[n].length, POSIX_FADV_WILLNEED);
+    }
+  };
+
+  const auto started = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (unsigned int n = 0; n < prefetch_threads; n++)
+    workers.emplace_back(worker);
+  for (auto &w : workers)
+    w.join();
+  ::close(fd);
+
+  DEBUG("Queued reading %d KiB of %s ahead in %d ms", total / 1024, image_,
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - started).count());
+}
+
+void ReadaheadProfile::record() {
+  const auto image = Image::of(image_);
+  const auto resident_bytes = [](const std::vector<Range> &ranges) {
+    std::uint64_t bytes = 0;
+    for (const auto &r : ranges)
+      bytes += r.length;
+    return bytes;
+  };
+
+  auto last = resident_bytes(resident_ranges(image_));
+  bool reading = false;
+  while (wait(sample_interval)) {
+    const auto ranges = resident_ranges(image_);
+    const auto bytes = resident_bytes(ranges);
+    if (bytes >= last + settled_bytes) {
+      reading = true;
+    } else if (reading) {
+      if (save(image, ranges))
+        INFO("Recorded reading %d KiB of %s while booting", bytes / 1024, image_);
+      return;
+    }
+    last = bytes;
+  }
+}
+
+bool ReadaheadProfile::wait(const std::chrono::steady_clock::duration &duration) {
+  std::unique_lock<std::mutex> l(lock_);
+  return !stop_changed_.wait_for(l, duration, [&]() { return stop_; });
+}
+
+std::vector<ReadaheadProfile::Range> ReadaheadProfile::resident_ranges(const fs::path &path) {
+  std::vector<Range> ranges;
+  const auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return ranges;
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+    ::close(fd);
+    return ranges;
+  }
+
+  // Mapping the file doesn't read anything from it.
+  const auto size = static_cast<std::size_t>(st.st_size);
+  const auto data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED)
+    return ranges;
+
+  const auto page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+  std::vector<unsigned char> resident((size + page_size - 1) / page_size);
+  if (::mincore(data, size, resident.data()) == 0) {
+    for (std::size_t n = 0; n < resident.size(); n++) {
+      if (!(resident[n] & 1))
+        continue;
+      const std::uint64_t offset = n * page_size;
+      const auto length = std::min<std::uint64_t>(page_size, size - offset);
+      if (!ranges.empty() && ranges.back().offset + ranges.back().length == offset)
+        ranges.back().length += length;
+      else
+        ranges.push_back({offset, length});
+    }
+  }
+  ::munmap(data, size);
+  return ranges;
+}
+
+void ReadaheadProfile::write(std::ostream &out, const Image &image, const std::vector<Range> &ranges) {
+  out << profile_header << std::endl
+      << "image " << image.size << ' ' << image.mtime << std::endl;
+  for (const auto &r : ranges)
+    out << r.offset << ' ' << r.length << std::endl;
+}
+
+bool ReadaheadProfile::read(std::istream &in, Image &image, std::vector<Range> &ranges) {
+  std::string line;
+  if (!std::getline(in, line) || line != profile_header)
+    return false;
+
+  std::string keyword;
+  if (!std::getline(in, line) || !(std::istringstream(line) >> keyword >> image.size >> image.mtime) ||
+      keyword != "image")
+    return false;
+
+  ranges.clear();
+  while (std::getline(in, line)) {
+    Range range;
+    if (!(std::istringstream(line) >> range.offset >> range.length))
+      return false;
+    ranges.push_back(range);
+  }
+  return true;
+}
+
+bool ReadaheadProfile::save(const Image &image, const std::vector<Range> &ranges) const {
+  const auto tmp_path = profile_.string() + ".tmp";
+  {
+    std::ofstream out(tmp_path, std::ios::trunc);
+    write(out, image, ranges);
+    if (!out) {
+      ERROR("Failed to write readahead profile to %s", tmp_path);
+      return false;
+    }
+  }
+
+  boost::system::error_code err;
+  fs::rename(tmp_path, profile_, err);
+  if (err) {
+    ERROR("Failed to write readahead profile to %s: %s", profile_, err.message());
+    return false;
+  }
+  return true;
+}
+} // namespace common
+} // namespace anbox
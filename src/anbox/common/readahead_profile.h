@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_COMMON_READAHEAD_PROFILE_H_
+#define ANBOX_COMMON_READAHEAD_PROFILE_H_
+
+#include <boost/filesystem/path.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+namespace anbox {
+namespace common {
+// Remembers which parts of the Android image booting Android reads and
+// reads them ahead at the next start, while the container is still being
+// set up. Android reads its image mostly at random which the kernel
+// can't predict.
+//
+// The parts read are found by sampling which pages of the image are in
+// the page cache. Once the container started reading them and then
+// stopped doing so for a while, Android is taken to be booted and the
+// profile is written. A profile is only recorded when there is none for
+// the image as it is now.
+class ReadaheadProfile {
+ public:
+  struct Range {
+    std::uint64_t offset;
+    std::uint64_t length;
+  };
+
+  // Tells whether a profile was recorded for the image as it is now.
+  struct Image {
+    std::uint64_t size = 0;
+    std::int64_t mtime = 0;
+
+    static Image of(const boost::filesystem::path &path);
+    bool operator==(const Image &other) const {
+      return size == other.size && mtime == other.mtime;
+    }
+  };
+
+  static constexpr unsigned int prefetch_threads{4};
+  static constexpr std::uint64_t prefetch_chunk_size{2 * 1024 * 1024};
+  static constexpr std::chrono::seconds sample_interval{2};
+  // Booting counts as done once less than this was read in between two
+  // samples.
+  static constexpr std::uint64_t settled_bytes{1024 * 1024};
+
+  ReadaheadProfile(const boost::filesystem::path &image,
+                   const boost::filesystem::path &profile);
+  ~ReadaheadProfile();
+
+  // Either starts reading ahead or recording in the background.
+  void start();
+
+  // Parts of |path| which are in the page cache.
+  static std::vector<Range> resident_ranges(const boost::filesystem::path &path);
+
+  static void write(std::ostream &out, const Image &image, const std::vector<Range> &ranges);
+  // Returns false if |in| holds no valid profile.
+  static bool read(std::istream &in, Image &image, std::vector<Range> &ranges);
+
+ private:
+  void prefetch(const std::vector<Range> &ranges);
+  void record();
+  bool save(const Image &image, const std::vector<Range> &ranges) const;
+  // Returns false once we are asked to stop.
+  bool wait(const std::chrono::steady_clock::duration &duration);
+
+  const boost::filesystem::path image_;
+  const boost::filesystem::path profile_;
+  std::mutex lock_;
+  std::condition_variable stop_changed_;
+  bool stop_;
+  std::thread thread_;
+};
+} // namespace common
+} // namespace anbox
+
+#endif
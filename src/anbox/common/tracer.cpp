@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/common/tracer.h"
+
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <string>
+
+namespace {
+void write_microseconds(std::ostream &out, std::int64_t ns) {
+  const auto fill = out.fill('0');
+  out << ns / 1000 << '.' << std::setw(3) << ns % 1000;
+  out.fill(fill);
+}
+
+void write_escaped(std::ostream &out, const std::string &str) {
+  for (const auto c : str) {
+    if (c == '"' || c == '\\')
+      out << '\\' << c;
+    else if (static_cast<unsigned char>(c) >= 0x20)
+      out << c;
+  }
+}
+}  // namespace
+
+namespace anbox {
+namespace common {
+constexpr std::size_t Tracer::default_capacity;
+constexpr std::size_t Tracer::max_retired_threads;
+
+// Only the thread owning a buffer writes to it. Events are atomic as the
+// trace may be written out at any time, an event overwritten while doing so
+// might come out garbled but never crashes.
+class Tracer::Buffer {
+ public:
+  struct Event {
+    std::atomic<const char*> category;
+    std::atomic<const char*> name;
+    std::atomic<std::int64_t> start_ns;
+    std::atomic<std::int64_t> duration_ns;
+  };
+
+  explicit Buffer(std::size_t capacity)
+      : thread_id(static_cast<pid_t>(::syscall(SYS_gettid))),
+        capacity(capacity),
+        events(new Event[capacity]),
+        num_events(0) {
+    char name[16] = {0};
+    if (::pthread_getname_np(::pthread_self(), name, sizeof(name)) == 0)
+      thread_name = name;
+  }
+
+  void add(const char *category, const char *name,
+           std::int64_t start_ns, std::int64_t duration_ns) {
+    const auto n = num_events.load(std::memory_order_relaxed);
+    auto &event = events[n % capacity];
+    event.category.store(category, std::memory_order_relaxed);
+    event.name.store(name, std::memory_order_relaxed);
+    event.start_ns.store(start_ns, std::memory_order_relaxed);
+    event.duration_ns.store(duration_ns, std::memory_order_relaxed);
+    num_events.store(n + 1, std::memory_order_release);
+  }
+
+  const pid_t thread_id;
+  std::string thread_name;
+  const std::size_t capacity;
+  std::unique_ptr<Event[]> events;
+  std::atomic<std::uint64_t> num_events;
+};
+
+// Hands the buffer over to the tracer once its thread is gone.
+struct Tracer::ThreadBuffer {
+  ~ThreadBuffer() {
+    if (buffer)
+      Tracer::instance().retire(buffer);
+  }
+
+  std::shared_ptr<Buffer> buffer;
+};
+
+Tracer &Tracer::instance() {
+  static Tracer tracer;
+  return tracer;
+}
+
+Tracer::Tracer()
+    : start_(Clock::now()), enabled_(false), capacity_(default_capacity) {}
+
+void Tracer::enable(std::size_t capacity) {
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    capacity_ = std::max<std::size_t>(capacity, 1);
+  }
+  enabled_.store(true, std::memory_order_relaxed);
+}
+
+void Tracer::disable() {
+  enabled_.store(false, std::memory_order_relaxed);
+}
+
+void Tracer::record(const char *category, const char *name,
+                    const Clock::time_point &start, const Clock::time_point &end) {
+  const auto buffer = buffer_for_current_thread();
+  if (!buffer)
+    return;
+
+  const auto since_start = std::chrono::duration_cast<std::chrono::nanoseconds>(start - start_);
+  const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
+  buffer->add(category, name, since_start.count(), duration.count());
+}
+
+std::shared_ptr<Tracer::Buffer> Tracer::buffer_for_current_thread() {
+  static thread_local ThreadBuffer thread_buffer;
+  if (thread_buffer.buffer)
+    return thread_buffer.buffer;
+
+  std::lock_guard<std::mutex> l(lock_);
+  thread_buffer.buffer = std::make_shared<Buffer>(capacity_);
+  buffers_.push_back(thread_buffer.buffer);
+  return thread_buffer.buffer;
+}
+
+void Tracer::retire(const std::shared_ptr<Buffer> &buffer) {
+  std::lock_guard<std::mutex> l(lock_);
+  buffers_.erase(std::remove(buffers_.begin(), buffers_.end(), buffer), buffers_.end());
+  // Threads which never recorded anything don't push out the ones which
+  // did.
+  if (buffer->num_events.load() == 0)
+    return;
+  retired_.push_back(buffer);
+  while (retired_.size() > max_retired_threads)
+    retired_.pop_front();
+}
+
+void Tracer::write_chrome_trace(std::ostream &out) const {
+  const auto pid = ::getpid();
+
+  std::vector<std::shared_ptr<Buffer>> buffers;
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    buffers.insert(buffers.end(), retired_.begin(), retired_.end());
+    buffers.insert(buffers.end(), buffers_.begin(), buffers_.end());
+  }
+
+  out << "{\"traceEvents\":[";
+  bool first = true;
+  const auto separate = [&]() {
+    if (!first) out << ',';
+    first = false;
+    out << '\n';
+  };
+
+  for (const auto &buffer : buffers) {
+    separate();
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+        << ",\"tid\":" << buffer->thread_id << ",\"args\":{\"name\":\"";
+    write_escaped(out, buffer->thread_name.empty() ? std::to_string(buffer->thread_id) : buffer->thread_name);
+    out << "\"}}";
+
+    const auto num_events = buffer->num_events.load(std::memory_order_acquire);
+    const auto begin = num_events > buffer->capacity ? num_events - buffer->capacity : 0;
+    for (auto n = begin; n < num_events; n++) {
+      const auto &event = buffer->events[n % buffer->capacity];
+      separate();
+      out << "{\"name\":\"" << event.name.load(std::memory_order_relaxed)
+          << "\",\"cat\":\"" << event.category.load(std::memory_order_relaxed)
+          << "\",\"ph\":\"X\",\"ts\":";
+      write_microseconds(out, event.start_ns.load(std::memory_order_relaxed));
+      out << ",\"dur\":";
+      write_microseconds(out, event.duration_ns.load(std::memory_order_relaxed));
+      out << ",\"pid\":" << pid << ",\"tid\":" << buffer->thread_id << "}";
+    }
+  }
+
+  out << "\n],\"displayTimeUnit\":\"ns\"}" << std::endl;
+}
+
+Tracer::Span::Span(const char *category, const char *name)
+    : category_(nullptr), name_(name) {
+  if (!Tracer::instance().enabled())
+    return;
+  category_ = category;
+  start_ = Clock::now();
+}
+
+Tracer::Span::~Span() {
+  if (category_)
+    Tracer::instance().record(category_, name_, start_, Clock::now());
+}
+}  // namespace common
+}  // namespace anbox
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_COMMON_TRACER_H_
+#define ANBOX_COMMON_TRACER_H_
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace anbox {
+namespace common {
+// Records spans of work on all threads of the process, like reading from a
+// socket, decoding GL commands or composing a frame, into a timeline which
+// chrome://tracing and Perfetto load. Unlike the GL command profile it
+// follows work across subsystems.
+//
+// Every thread records the most recent spans into a ring buffer of its
+// own, so recording needs no locks. While tracing isn't enabled a span
+// costs an atomic load. Building without ANBOX_TRACING compiles all spans
+// out.
+class Tracer {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  // Spans kept per thread.
+  static constexpr std::size_t default_capacity{16 * 1024};
+  // Spans of threads which are gone are kept for the next dump but only
+  // of this many threads.
+  static constexpr std::size_t max_retired_threads{16};
+
+  // Measures the scope it lives in. |category| and |name| have to be
+  // string literals.
+  class Span {
+   public:
+    Span(const char *category, const char *name);
+    ~Span();
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+   private:
+    const char *category_;
+    const char *name_;
+    Clock::time_point start_;
+  };
+
+  // The tracer of this process.
+  static Tracer &instance();
+
+  // Spans recorded before are kept. |capacity| only applies to threads
+  // recording their first span afterwards.
+  void enable(std::size_t capacity = default_capacity);
+  void disable();
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  void record(const char *category, const char *name,
+              const Clock::time_point &start, const Clock::time_point &end);
+
+  // Writes the recorded spans of all threads in the Chrome trace event
+  // format.
+  void write_chrome_trace(std::ostream &out) const;
+
+ private:
+  class Buffer;
+  struct ThreadBuffer;
+
+  Tracer();
+
+  std::shared_ptr<Buffer> buffer_for_current_thread();
+  void retire(const std::shared_ptr<Buffer> &buffer);
+
+  const Clock::time_point start_;
+  std::atomic<bool> enabled_;
+  std::size_t capacity_;
+
+  mutable std::mutex lock_;
+  std::vector<std::shared_ptr<Buffer>> buffers_;
+  std::deque<std::shared_ptr<Buffer>> retired_;
+};
+}  // namespace common
+}  // namespace anbox
+
+#if defined(ANBOX_TRACING)
+#define ANBOX_TRACE_CONCAT_IMPL(a, b) a##b
+#define ANBOX_TRACE_CONCAT(a, b) ANBOX_TRACE_CONCAT_IMPL(a, b)
+#define ANBOX_TRACE_SPAN(category, name) \
+  ::anbox::common::Tracer::Span ANBOX_TRACE_CONCAT(anbox_trace_span_, __LINE__) { category, name }
+#else
+#define ANBOX_TRACE_SPAN(category, name) \
+  do {                                    \
+  } while (false)
+#endif
+
+#endif
@@ -49,6 +49,26 @@ void WaitHandle::wait_for_all()  // wait for all results you expect
   expecting = 0;
 }
 
+bool WaitHandle::wait_for_all(std::chrono::milliseconds limit) {
+  std::unique_lock<std::mutex> lock(guard);
+
+  if (!wait_condition.wait_for(lock, limit,
+                               [&] { return received == expecting; }))
+    return false;
+
+  received = 0;
+  expecting = 0;
+
+  return true;
+}
+
+void WaitHandle::cancel_expected() {
+  std::lock_guard<std::mutex> lock(guard);
+
+  if (expecting > 0) expecting--;
+  wait_condition.notify_all();
+}
+
 void WaitHandle::wait_for_pending(std::chrono::milliseconds limit) {
   std::unique_lock<std::mutex> lock(guard);
 
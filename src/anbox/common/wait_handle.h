@@ -34,6 +34,11 @@ struct WaitHandle {
   void expect_result();
   void result_received();
   void wait_for_all();
+  // Returns false if not all results arrived within |limit|. The expected
+  // results stay pending in that case.
+  bool wait_for_all(std::chrono::milliseconds limit);
+  // Stops expecting a result which will never arrive
+  void cancel_expected();
   void wait_for_one();
   void wait_for_pending(std::chrono::milliseconds limit);
 
@@ -35,20 +35,59 @@ static std::string runtime_dir() {
   }
   return path;
 }
+
+fs::path instance_runtime_dir(const std::string &instance) {
+  const auto dir = fs::path(runtime_dir()) / "anbox";
+  if (instance == anbox::SystemConfiguration::default_instance)
+    return dir;
+  return dir / instance;
+}
 }
 
+constexpr const char *anbox::SystemConfiguration::default_instance;
+
 void anbox::SystemConfiguration::set_data_path(const std::string &path) {
   data_path = path;
 }
 
+void anbox::SystemConfiguration::set_instance_name(const std::string &name) {
+  current_instance = name;
+}
+
+std::string anbox::SystemConfiguration::instance_name() const {
+  return current_instance;
+}
+
 fs::path anbox::SystemConfiguration::data_dir() const {
   return data_path;
 }
 
-std::string anbox::SystemConfiguration::rootfs_dir() const {
+fs::path anbox::SystemConfiguration::instance_dir(const std::string &instance) const {
+  if (instance == default_instance)
+    return data_path;
+  return data_path / "instances" / instance;
+}
+
+std::string anbox::SystemConfiguration::image_dir() const {
   return (data_path / "rootfs").string();
 }
 
+std::string anbox::SystemConfiguration::rootfs_dir() const {
+  return rootfs_dir(current_instance);
+}
+
+std::string anbox::SystemConfiguration::rootfs_dir(const std::string &instance) const {
+  // The default instance runs straight from the image and has no layer of
+  // its own to write to.
+  if (instance == default_instance)
+    return image_dir();
+  return (instance_dir(instance) / "rootfs").string();
+}
+
+std::string anbox::SystemConfiguration::checkpoint_dir(const std::string &instance) const {
+  return (instance_dir(instance) / "checkpoint").string();
+}
+
 std::string anbox::SystemConfiguration::log_dir() const {
   return (data_path / "logs").string();
 }
@@ -58,17 +97,41 @@ std::string anbox::SystemConfiguration::container_config_dir() const {
 }
 
 std::string anbox::SystemConfiguration::container_socket_path() const {
-  return "/run/anbox-container.socket";
+  return container_socket_path(current_instance);
+}
+
+std::string anbox::SystemConfiguration::container_socket_path(const std::string &instance) const {
+  if (instance == default_instance)
+    return "/run/anbox-container.socket";
+  return anbox::utils::string_format("/run/anbox-container-%s.socket", instance);
 }
 
 std::string anbox::SystemConfiguration::socket_dir() const {
-  static std::string dir = anbox::utils::string_format("%s/anbox/sockets", runtime_dir());
-  return dir;
+  if (!runtime_dir_override.empty())
+    return (runtime_dir_override / "sockets").string();
+  return (instance_runtime_dir(current_instance) / "sockets").string();
 }
 
 std::string anbox::SystemConfiguration::input_device_dir() const {
-  static std::string dir = anbox::utils::string_format("%s/anbox/input", runtime_dir());
-  return dir;
+  if (!runtime_dir_override.empty())
+    return (runtime_dir_override / "input").string();
+  return (instance_runtime_dir(current_instance) / "input").string();
+}
+
+void anbox::SystemConfiguration::set_runtime_dir(const fs::path &dir) {
+  runtime_dir_override = dir;
+}
+
+std::string anbox::SystemConfiguration::standby_dir(const std::string &instance) const {
+  return (fs::path("/run/anbox-standby") / instance).string();
+}
+
+std::string anbox::SystemConfiguration::standby_socket_path() const {
+  return "/run/anbox-standby.socket";
+}
+
+std::string anbox::SystemConfiguration::reattach_socket_path() const {
+  return "/run/anbox-reattach.socket";
 }
 
 std::string anbox::SystemConfiguration::application_item_dir() const {
@@ -76,6 +139,11 @@ std::string anbox::SystemConfiguration::application_item_dir() const {
   return dir.string();
 }
 
+std::string anbox::SystemConfiguration::cache_dir() const {
+  static auto dir = xdg::cache().home() / "anbox";
+  return dir.string();
+}
+
 anbox::SystemConfiguration& anbox::SystemConfiguration::instance() {
   static SystemConfiguration config;
   return config;
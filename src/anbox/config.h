@@ -28,23 +28,51 @@ class SystemConfiguration {
  public:
   static SystemConfiguration& instance();
 
+  // The instance which keeps the paths used before there were several.
+  static constexpr const char *default_instance{"default"};
+
   virtual ~SystemConfiguration() = default;
 
   void set_data_path(const std::string &path);
 
+  // Selects the Android instance all instance specific paths without an
+  // explicit instance are for.
+  void set_instance_name(const std::string &name);
+  std::string instance_name() const;
+
   boost::filesystem::path data_dir() const;
+  // Where everything of |instance| but its sockets is stored.
+  boost::filesystem::path instance_dir(const std::string &instance) const;
+  // Mount point of the read-only Android image all instances share.
+  std::string image_dir() const;
   std::string rootfs_dir() const;
+  std::string rootfs_dir(const std::string &instance) const;
+  std::string checkpoint_dir(const std::string &instance) const;
   std::string log_dir() const;
   std::string socket_dir() const;
   std::string container_config_dir() const;
   std::string container_socket_path() const;
+  std::string container_socket_path(const std::string &instance) const;
   std::string input_device_dir() const;
+  // Where the sockets and input devices of the current instance are kept
+  // instead of the runtime directory of the user, e.g. the ones of a
+  // standby container the container manager keeps for it.
+  void set_runtime_dir(const boost::filesystem::path &dir);
+  // Sockets and input devices for a standby container of |instance|.
+  std::string standby_dir(const std::string &instance) const;
+  std::string standby_socket_path() const;
+  // Where sessions hand their sockets to the container manager and pick
+  // them up again, see container::ReattachPool.
+  std::string reattach_socket_path() const;
   std::string application_item_dir() const;
+  std::string cache_dir() const;
 
  protected:
   SystemConfiguration() = default;
 
   boost::filesystem::path data_path = "/var/lib/anbox";
+  std::string current_instance = default_instance;
+  boost::filesystem::path runtime_dir_override;
 
 };
 }  // namespace anbox
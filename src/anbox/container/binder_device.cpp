@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/container/binder_device.h"
+#include "anbox/common/fd.h"
+#include "anbox/logger.h"
+#include "anbox/utils.h"
+
+#include <boost/filesystem.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <linux/android/binderfs.h>
+#include <sys/ioctl.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = boost::filesystem;
+
+namespace {
+constexpr const char *filesystems_path{"/proc/filesystems"};
+}  // namespace
+
+namespace anbox {
+namespace container {
+constexpr const char *BinderDevice::binderfs_path;
+constexpr const char *BinderDevice::shared_path;
+
+bool BinderDevice::available() {
+  if (fs::exists(shared_path) || fs::exists(fs::path(binderfs_path) / "binder-control"))
+    return true;
+  std::ifstream filesystems(filesystems_path);
+  return lists_binderfs(filesystems);
+}
+
+bool BinderDevice::lists_binderfs(std::istream &filesystems) {
+  // Lines are the filesystem type, optionally preceded by "nodev".
+  std::string line;
+  while (std::getline(filesystems, line)) {
+    std::istringstream fields(line);
+    std::string type;
+    while (fields >> type) {
+      if (type == "binder")
+        return true;
+    }
+  }
+  return false;
+}
+
+BinderDevice::BinderDevice(const Instance &instance)
+    : path_(shared_path), allocated_(false) {
+  const auto name = "anbox-" + instance.name;
+  if (allocate(name)) {
+    INFO("Instance %s uses its own binder device %s", instance.name, path_);
+    return;
+  }
+  INFO("Instance %s shares %s with all other instances", instance.name, path_);
+}
+
+BinderDevice::~BinderDevice() {
+  if (allocated_)
+    ::unlink(path_.c_str());
+}
+
+bool BinderDevice::allocate(const std::string &name) {
+  const auto control_path = fs::path(binderfs_path) / "binder-control";
+  if (!fs::exists(control_path)) {
+    std::ifstream filesystems(filesystems_path);
+    if (!lists_binderfs(filesystems))
+      return false;
+
+    utils::ensure_paths({binderfs_path});
+    if (::mount("binder", binderfs_path, "binder", 0, nullptr) != 0) {
+      WARNING("Failed to mount binderfs at %s: %s", binderfs_path, std::strerror(errno));
+      return false;
+    }
+  }
+
+  Fd control{::open(control_path.c_str(), O_RDWR | O_CLOEXEC)};
+  if (control < 0) {
+    WARNING("Failed to open %s: %s", control_path.string(), std::strerror(errno));
+    return false;
+  }
+
+  binderfs_device device;
+  std::memset(&device, 0, sizeof(device));
+  std::strncpy(device.name, name.c_str(), BINDERFS_MAX_NAME);
+  // A container manager which didn't get to clean up leaves the device
+  // behind, nothing uses it anymore so we take it over.
+  if (::ioctl(control, BINDER_CTL_ADD, &device) < 0 && errno != EEXIST) {
+    WARNING("Failed to allocate binder device %s: %s", name, std::strerror(errno));
+    return false;
+  }
+
+  const auto path = (fs::path(binderfs_path) / name).string();
+  // Devices are only accessible by root by default but the users of
+  // Android are mapped to unprivileged ones on the host.
+  if (::chmod(path.c_str(), 0666) != 0) {
+    WARNING("Failed to make binder device %s accessible: %s", path, std::strerror(errno));
+    ::unlink(path.c_str());
+    return false;
+  }
+
+  path_ = path;
+  allocated_ = true;
+  return true;
+}
+}  // namespace container
+}  // namespace anbox
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_CONTAINER_BINDER_DEVICE_H_
+#define ANBOX_CONTAINER_BINDER_DEVICE_H_
+
+#include "anbox/container/instance.h"
+
+#include <istream>
+#include <string>
+
+namespace anbox {
+namespace container {
+// The binder device Android of one instance talks through. With binderfs
+// every instance gets a device of its own, so the Androids of different
+// instances neither see each others services nor contend on the locks of
+// one binder context. Without it all of them share /dev/binder.
+class BinderDevice {
+ public:
+  // Where we mount binderfs if the host didn't already.
+  static constexpr const char *binderfs_path{"/dev/binderfs"};
+  // What instances share without binderfs.
+  static constexpr const char *shared_path{"/dev/binder"};
+
+  // Whether Android can get a binder device on this host at all.
+  static bool available();
+  // Whether |filesystems|, formatted like /proc/filesystems, lists
+  // binderfs.
+  static bool lists_binderfs(std::istream &filesystems);
+
+  // Has to be called as root. Never throws, if a device can't be
+  // allocated we fall back to the shared one.
+  explicit BinderDevice(const Instance &instance);
+  ~BinderDevice();
+
+  // Device on the host to bind to /dev/binder in the container.
+  std::string path() const { return path_; }
+
+ private:
+  bool allocate(const std::string &name);
+
+  std::string path_;
+  bool allocated_;
+};
+}  // namespace container
+}  // namespace anbox
+
+#endif
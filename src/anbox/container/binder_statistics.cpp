@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/container/binder_statistics.h"
+#include "anbox/utils.h"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace {
+const std::string transaction_event{" binder_transaction: "};
+const std::string received_event{" binder_transaction_received: "};
+
+// Extracts the value of |key|=<value> out of the fields of a tracepoint.
+bool field(const std::string &fields, const std::string &key, long &value) {
+  const auto pos = fields.find(key + "=");
+  if (pos == std::string::npos || (pos > 0 && fields[pos - 1] != ' '))
+    return false;
+  try {
+    value = std::stol(fields.substr(pos + key.size() + 1));
+  } catch (...) {
+    return false;
+  }
+  return true;
+}
+
+// The timestamp is the last thing in front of the event name, e.g.
+// "  surfaceflinger-123   [001] d..1  5678.123456: binder_transaction: ..."
+bool timestamp(const std::string &line, std::size_t event_pos, std::chrono::microseconds &time) {
+  if (event_pos == 0 || line[event_pos - 1] != ':')
+    return false;
+  const auto head = line.substr(0, event_pos - 1);
+  const auto text = head.substr(head.rfind(' ') + 1);
+  const auto dot = text.find('.');
+  if (dot == std::string::npos || text.size() - dot - 1 != 6)
+    return false;
+  try {
+    std::size_t end = 0;
+    const auto seconds = std::stoll(text.substr(0, dot));
+    const auto micros = std::stoll(text.substr(dot + 1), &end);
+    if (end != 6)
+      return false;
+    time = std::chrono::seconds{seconds} + std::chrono::microseconds{micros};
+  } catch (...) {
+    return false;
+  }
+  return true;
+}
+
+std::string read_first_line(const std::string &path) {
+  std::ifstream in(path);
+  std::string line;
+  std::getline(in, line);
+  return line;
+}
+}  // namespace
+
+namespace anbox {
+namespace container {
+constexpr std::size_t BinderStatistics::max_samples;
+constexpr std::size_t BinderStatistics::max_pending;
+
+bool BinderStatistics::parse_trace_line(const std::string &line, TraceEvent &event) {
+  auto pos = line.find(transaction_event);
+  if (pos != std::string::npos) {
+    const auto fields = line.substr(pos + transaction_event.size());
+    long transaction = 0, dest_proc = 0, reply = 0;
+    if (!field(fields, "transaction", transaction) || !field(fields, "dest_proc", dest_proc) ||
+        !field(fields, "reply", reply) || !timestamp(line, pos, event.time))
+      return false;
+    event.type = TraceEvent::Type::transaction;
+    event.transaction = static_cast<int>(transaction);
+    event.dest_proc = static_cast<pid_t>(dest_proc);
+    event.reply = reply != 0;
+    return true;
+  }
+
+  pos = line.find(received_event);
+  if (pos != std::string::npos) {
+    long transaction = 0;
+    if (!field(line.substr(pos + received_event.size()), "transaction", transaction) ||
+        !timestamp(line, pos, event.time))
+      return false;
+    event.type = TraceEvent::Type::received;
+    event.transaction = static_cast<int>(transaction);
+    event.dest_proc = 0;
+    event.reply = false;
+    return true;
+  }
+
+  return false;
+}
+
+bool BinderStatistics::resolve_process(pid_t pid, Process &process) {
+  process.name = read_first_line(utils::string_format("/proc/%d/comm", pid));
+  if (process.name.empty())
+    return false;
+
+  // LXC puts every container into a cgroup named after it, e.g.
+  // "0::/lxc.payload.default" or "4:cpu:/lxc/default".
+  process.container.clear();
+  std::ifstream in(utils::string_format("/proc/%d/cgroup", pid));
+  std::string line;
+  while (process.container.empty() && std::getline(in, line)) {
+    for (const auto &prefix : {"/lxc.payload.", "/lxc.payload/", "/lxc/"}) {
+      const auto pos = line.find(prefix);
+      if (pos == std::string::npos)
+        continue;
+      const auto name = line.substr(pos + std::strlen(prefix));
+      process.container = name.substr(0, name.find('/'));
+      break;
+    }
+  }
+  return true;
+}
+
+void BinderStatistics::add(const TraceEvent &event) {
+  std::lock_guard<std::mutex> l(lock_);
+
+  if (event.type == TraceEvent::Type::transaction) {
+    auto &counters = processes_[event.dest_proc];
+    if (event.reply)
+      counters.replies++;
+    else
+      counters.calls++;
+
+    if (pending_.size() >= max_pending)
+      pending_.clear();
+    pending_[event.transaction] = Pending{event.time, event.dest_proc};
+    return;
+  }
+
+  const auto pending = pending_.find(event.transaction);
+  if (pending == pending_.end())
+    return;
+
+  const auto process = processes_.find(pending->second.dest_proc);
+  if (process != processes_.end())
+    process->second.latency.add(event.time - pending->second.time);
+  pending_.erase(pending);
+}
+
+std::vector<BinderStatistics::Summary> BinderStatistics::summary() const {
+  std::lock_guard<std::mutex> l(lock_);
+  std::vector<Summary> summary;
+  for (const auto &process : processes_)
+    summary.push_back(Summary{process.first, process.second.calls, process.second.replies,
+                              process.second.latency.percentiles()});
+  return summary;
+}
+
+void BinderStatistics::remove(pid_t pid) {
+  std::lock_guard<std::mutex> l(lock_);
+  processes_.erase(pid);
+}
+
+void BinderStatistics::write_prometheus(std::ostream &out, const ProcessResolver &resolver) {
+  std::vector<std::pair<Summary, std::string>> processes;
+  for (const auto &s : summary()) {
+    Process process;
+    if (!resolver(s.pid, process)) {
+      remove(s.pid);
+      continue;
+    }
+    std::stringstream labels;
+    labels << "container=\"" << common::escape_prometheus_label(process.container) << "\","
+           << "process=\"" << common::escape_prometheus_label(process.name) << "\","
+           << "pid=\"" << s.pid << "\"";
+    processes.push_back({s, labels.str()});
+  }
+
+  out << "# HELP anbox_binder_transactions_total Binder transactions received by a process.\n"
+      << "# TYPE anbox_binder_transactions_total counter\n";
+  for (const auto &p : processes) {
+    out << "anbox_binder_transactions_total{" << p.second << ",kind=\"call\"} " << p.first.calls << "\n"
+        << "anbox_binder_transactions_total{" << p.second << ",kind=\"reply\"} " << p.first.replies << "\n";
+  }
+
+  out << "# HELP anbox_binder_delivery_latency_seconds Time binder transactions waited for a thread of the receiving process.\n"
+      << "# TYPE anbox_binder_delivery_latency_seconds gauge\n";
+  for (const auto &p : processes)
+    common::write_prometheus_quantiles(out, "anbox_binder_delivery_latency_seconds", p.second,
+                                       p.first.latency);
+}
+}  // namespace container
+}  // namespace anbox
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_CONTAINER_BINDER_STATISTICS_H_
+#define ANBOX_CONTAINER_BINDER_STATISTICS_H_
+
+#include "anbox/common/latency_samples.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace anbox {
+namespace container {
+// Counts the binder transactions every process receives and how long they
+// waited for a thread of it to pick them up, from the binder_transaction
+// and binder_transaction_received tracepoints of the binder driver.
+class BinderStatistics {
+ public:
+  static constexpr std::size_t max_samples{1024};
+  // Transactions we never see being received, e.g. as their target died,
+  // must not pile up.
+  static constexpr std::size_t max_pending{4096};
+
+  struct TraceEvent {
+    enum class Type { transaction, received };
+    Type type;
+    // Time of the trace clock.
+    std::chrono::microseconds time;
+    int transaction;
+    // Only set for Type::transaction.
+    pid_t dest_proc;
+    bool reply;
+  };
+
+  struct Summary {
+    pid_t pid;
+    std::uint64_t calls;
+    std::uint64_t replies;
+    common::LatencySamples::Percentiles latency;
+  };
+
+  // Tells which container a process belongs to and its name.
+  struct Process {
+    std::string container;
+    std::string name;
+  };
+  typedef std::function<bool(pid_t pid, Process &process)> ProcessResolver;
+
+  // Parses a line of the trace_pipe of ftrace. Returns false for anything
+  // but the two tracepoints we're after.
+  static bool parse_trace_line(const std::string &line, TraceEvent &event);
+
+  // Looks |pid| up in /proc. Fails once the process is gone.
+  static bool resolve_process(pid_t pid, Process &process);
+
+  void add(const TraceEvent &event);
+
+  // Sorted by pid.
+  std::vector<Summary> summary() const;
+  void remove(pid_t pid);
+
+  // Writes all processes |resolver| knows about, in the Prometheus text
+  // format, and forgets about all others as they are gone.
+  void write_prometheus(std::ostream &out, const ProcessResolver &resolver = resolve_process);
+
+ private:
+  struct Pending {
+    std::chrono::microseconds time;
+    pid_t dest_proc;
+  };
+
+  struct Counters {
+    Counters() : calls{0}, replies{0}, latency{max_samples} {}
+    std::uint64_t calls;
+    std::uint64_t replies;
+    common::LatencySamples latency;
+  };
+
+  mutable std::mutex lock_;
+  std::unordered_map<int, Pending> pending_;
+  std::map<pid_t, Counters> processes_;
+};
+}  // namespace container
+}  // namespace anbox
+
+#endif
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/container/binder_tracer.h"
+#include "anbox/logger.h"
+#include "anbox/utils.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/throw_exception.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+namespace fs = boost::filesystem;
+
+namespace {
+constexpr const char *instance_name{"anbox-binder"};
+constexpr const char *events[] = {"binder_transaction", "binder_transaction_received"};
+// How long we wait for trace data before checking whether we should stop.
+constexpr int poll_timeout_ms{250};
+
+std::string tracefs_dir() {
+  for (const auto &dir : {"/sys/kernel/tracing", "/sys/kernel/debug/tracing"}) {
+    if (fs::exists(fs::path(dir) / "instances"))
+      return dir;
+  }
+  BOOST_THROW_EXCEPTION(std::runtime_error("tracefs is not mounted"));
+}
+}  // namespace
+
+namespace anbox {
+namespace container {
+BinderTracer::BinderTracer(const std::shared_ptr<BinderStatistics> &statistics)
+    : statistics_(statistics),
+      instance_dir_((fs::path(tracefs_dir()) / "instances" / instance_name).string()),
+      running_(true) {
+  boost::system::error_code err;
+  fs::create_directory(instance_dir_, err);
+  if (err)
+    BOOST_THROW_EXCEPTION(std::runtime_error("Failed to create ftrace instance: " + err.message()));
+
+  try {
+    enable_events(true);
+  } catch (...) {
+    fs::remove(instance_dir_, err);
+    throw;
+  }
+
+  thread_ = std::thread(&BinderTracer::run, this);
+}
+
+BinderTracer::~BinderTracer() {
+  running_ = false;
+  if (thread_.joinable())
+    thread_.join();
+
+  try {
+    enable_events(false);
+  } catch (std::exception &err) {
+    WARNING("%s", err.what());
+  }
+
+  // The kernel removes what's inside an instance together with it.
+  if (::rmdir(instance_dir_.c_str()) != 0)
+    WARNING("Failed to remove ftrace instance %s: %s", instance_dir_, std::strerror(errno));
+}
+
+void BinderTracer::enable_events(bool enable) {
+  for (const auto &event : events) {
+    const auto path = utils::string_format("%s/events/binder/%s/enable", instance_dir_, event);
+    std::ofstream out(path);
+    out << (enable ? "1" : "0");
+    out.flush();
+    if (!out)
+      BOOST_THROW_EXCEPTION(std::runtime_error(
+          utils::string_format("Failed to %s tracepoint %s, is the binder driver loaded?",
+                               enable ? "enable" : "disable", event)));
+  }
+}
+
+void BinderTracer::run() {
+  const auto path = instance_dir_ + "/trace_pipe";
+  const int fd = ::open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) {
+    ERROR("Failed to open %s: %s", path, std::strerror(errno));
+    return;
+  }
+
+  std::string pending;
+  char buffer[16 * 1024];
+  BinderStatistics::TraceEvent event;
+  while (running_) {
+    pollfd pfd{fd, POLLIN, 0};
+    if (::poll(&pfd, 1, poll_timeout_ms) <= 0)
+      continue;
+
+    const auto bytes_read = ::read(fd, buffer, sizeof(buffer));
+    if (bytes_read <= 0)
+      continue;
+    pending.append(buffer, static_cast<std::size_t>(bytes_read));
+
+    std::size_t start = 0, end = 0;
+    while ((end = pending.find('\n', start)) != std::string::npos) {
+      if (BinderStatistics::parse_trace_line(pending.substr(start, end - start), event))
+        statistics_->add(event);
+      start = end + 1;
+    }
+    pending.erase(0, start);
+  }
+
+  ::close(fd);
+}
+}  // namespace container
+}  // namespace anbox
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_CONTAINER_BINDER_TRACER_H_
+#define ANBOX_CONTAINER_BINDER_TRACER_H_
+
+#include "anbox/container/binder_statistics.h"
+#include "anbox/do_not_copy_or_move.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace anbox {
+namespace container {
+// Feeds the binder tracepoints into |statistics|. They're traced into an
+// ftrace instance of our own so that we neither see nor disturb what
+// anybody else traces.
+class BinderTracer : public DoNotCopyOrMove {
+ public:
+  // Throws std::runtime_error when tracefs isn't available or the binder
+  // driver has no tracepoints.
+  explicit BinderTracer(const std::shared_ptr<BinderStatistics> &statistics);
+  ~BinderTracer();
+
+ private:
+  void enable_events(bool enable);
+  void run();
+
+  std::shared_ptr<BinderStatistics> statistics_;
+  std::string instance_dir_;
+  std::atomic<bool> running_;
+  std::thread thread_;
+};
+}  // namespace container
+}  // namespace anbox
+
+#endif
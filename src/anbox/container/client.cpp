@@ -16,6 +16,7 @@
  */
 
 #include "anbox/container/client.h"
+#include "anbox/common/boot_timeline.h"
 #include "anbox/config.h"
 #include "anbox/container/management_api_stub.h"
 #include "anbox/logger.h"
@@ -33,18 +34,25 @@ Client::Client(const std::shared_ptr<Runtime> &rt)
     : messenger_(std::make_shared<network::LocalSocketMessenger>(
           SystemConfiguration::instance().container_socket_path(), rt)),
       pending_calls_(std::make_shared<rpc::PendingCallCache>()),
-      rpc_channel_(std::make_shared<rpc::Channel>(pending_calls_, messenger_)),
+      framing_(std::make_shared<rpc::Framing>()),
+      rpc_channel_(std::make_shared<rpc::Channel>(pending_calls_, messenger_,
+                                                  framing_)),
       management_api_(std::make_shared<ManagementApiStub>(rpc_channel_)),
-      processor_(
-          std::make_shared<rpc::MessageProcessor>(messenger_, pending_calls_)) {
+      processor_(std::make_shared<rpc::MessageProcessor>(
+          messenger_, pending_calls_, framing_)) {
+  rpc_channel_->send_protocol_version();
   read_next_message();
 }
 
 Client::~Client() {}
 
 void Client::start(const Configuration &configuration) {
+  common::BootTimeline::instance().mark("container_start_requested");
   try {
-    management_api_->start_container(configuration);
+    const auto restored = management_api_->start_container(configuration);
+    common::BootTimeline::instance().mark(restored ? "container_restored" : "container_started");
+    if (restored && restored_callback_)
+      restored_callback_();
   } catch (const std::exception &e) {
     ERROR("Failed to start container: %s", e.what());
     if (terminate_callback_)
@@ -52,14 +60,18 @@ void Client::start(const Configuration &configuration) {
   }
 }
 
-void Client::stop() {
-  management_api_->stop_container();
+void Client::stop(bool checkpoint, bool force) {
+  management_api_->stop_container(checkpoint, force);
 }
 
 void Client::register_terminate_handler(const TerminateCallback &callback) {
   terminate_callback_ = callback;
 }
 
+void Client::register_restored_handler(const RestoredCallback &callback) {
+  restored_callback_ = callback;
+}
+
 void Client::read_next_message() {
   auto callback = std::bind(&Client::on_read_size, this, std::placeholders::_1,
                             std::placeholders::_2);
@@ -74,10 +86,7 @@ void Client::on_read_size(const boost::system::error_code &error,
     return;
   }
 
-  std::vector<std::uint8_t> data(bytes_read);
-  std::copy(buffer_.data(), buffer_.data() + bytes_read, data.data());
-
-  if (processor_->process_data(data)) read_next_message();
+  if (processor_->process_data(buffer_.data(), bytes_read)) read_next_message();
 }
 }  // namespace container
 }  // namespace anbox
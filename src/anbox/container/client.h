@@ -24,6 +24,7 @@
 namespace anbox {
 namespace rpc {
 class PendingCallCache;
+class Framing;
 class Channel;
 class MessageProcessor;
 }  // namespace rpc
@@ -35,14 +36,21 @@ class ManagementApiStub;
 class Client {
  public:
   typedef std::function<void()> TerminateCallback;
+  typedef std::function<void()> RestoredCallback;
 
   Client(const std::shared_ptr<Runtime> &rt);
   ~Client();
 
   void start(const Configuration &configuration);
-  void stop();
+  // With |checkpoint| set the container is restored from where it stopped
+  // at its next start, if the container manager supports it. With |force|
+  // set it is killed right away instead.
+  void stop(bool checkpoint = false, bool force = false);
 
   void register_terminate_handler(const TerminateCallback &callback);
+  // Called when the container was restored from a checkpoint, which means
+  // Android won't tell us again that it finished booting.
+  void register_restored_handler(const RestoredCallback &callback);
 
  private:
   void read_next_message();
@@ -51,11 +59,13 @@ class Client {
 
   std::shared_ptr<network::LocalSocketMessenger> messenger_;
   std::shared_ptr<rpc::PendingCallCache> pending_calls_;
+  std::shared_ptr<rpc::Framing> framing_;
   std::shared_ptr<rpc::Channel> rpc_channel_;
   std::shared_ptr<ManagementApiStub> management_api_;
   std::shared_ptr<rpc::MessageProcessor> processor_;
   std::array<std::uint8_t, 8192> buffer_;
   TerminateCallback terminate_callback_;
+  RestoredCallback restored_callback_;
 };
 }  // namespace container
 }  // namespace anbox
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/container/configuration.h"
+#include "anbox/utils.h"
+
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace anbox {
+namespace container {
+const std::vector<std::string> Configuration::session_sockets{"qemu_pipe", "anbox_bridge",
+                                                              "anbox_audio"};
+
+Configuration Configuration::for_session(const std::string &socket_dir,
+                                         const std::string &input_device_dir) {
+  Configuration configuration;
+  for (const auto &name : session_sockets)
+    configuration.bind_mounts.insert(
+        {utils::string_format("%s/%s", socket_dir, name), "/dev/" + name});
+  configuration.bind_mounts.insert({input_device_dir, "/dev/input"});
+  configuration.bind_mounts.insert({"/dev/binder", "/dev/binder"});
+  // Without the ashmem module Android falls back to memfds, see
+  // android/ashmem/ashmem_memfd.c
+  if (fs::exists("/dev/ashmem"))
+    configuration.bind_mounts.insert({"/dev/ashmem", "/dev/ashmem"});
+  configuration.bind_mounts.insert({"/dev/fuse", "/dev/fuse"});
+  return configuration;
+}
+}  // namespace container
+}  // namespace anbox
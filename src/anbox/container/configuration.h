@@ -18,13 +18,31 @@
 #ifndef ANBOX_CONTAINER_CONFIGURATION_H_
 #define ANBOX_CONTAINER_CONFIGURATION_H_
 
+#include "anbox/container/network_settings.h"
+#include "anbox/container/resource_limits.h"
+
 #include <map>
 #include <string>
+#include <vector>
 
 namespace anbox {
 namespace container {
 struct Configuration {
+  // Names of the socket files a session publishes for Android. Each one is
+  // bound to /dev/<name> inside the container.
+  static const std::vector<std::string> session_sockets;
+
+  // What a session with its sockets in |socket_dir| and its input devices
+  // in |input_device_dir| makes available to Android.
+  static Configuration for_session(const std::string &socket_dir,
+                                   const std::string &input_device_dir);
+
   std::map<std::string, std::string> bind_mounts;
+  ResourceLimits resources;
+  NetworkSettings network;
+  // Host device bound to /dev/binder in place of what |bind_mounts| binds
+  // there, see BinderDevice. Left to the client if empty.
+  std::string binder_device;
 };
 }  // namespace container
 }  // namespace anbox
@@ -40,6 +40,18 @@ class Container {
   // Stop a running container
   virtual void stop() = 0;
 
+  // Stop a running container as fast as possible, without giving anything
+  // in it a chance to shut down.
+  virtual void kill() = 0;
+
+  // Stop a running container and keep its state so that the next start can
+  // continue from there instead of booting. Throws std::runtime_error when
+  // that fails, leaving the container running.
+  virtual void checkpoint() = 0;
+
+  // Whether the running container was restored rather than booted.
+  virtual bool restored() = 0;
+
   // Get the current container state
   virtual State state() = 0;
 };
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "anbox/container/instance.h"
+#include "anbox/config.h"
+#include "anbox/utils.h"
+
+#include <boost/throw_exception.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+constexpr std::size_t max_name_size{32};
+}  // namespace
+
+namespace anbox {
+namespace container {
+constexpr unsigned int Instance::first_id;
+constexpr unsigned int Instance::ids_per_instance;
+
+std::vector<Instance> Instance::parse(const std::string &names) {
+  auto parsed = utils::string_split(names, ',');
+  parsed.erase(std::remove(parsed.begin(), parsed.end(), ""), parsed.end());
+  if (parsed.empty())
+    BOOST_THROW_EXCEPTION(std::invalid_argument("No instances given"));
+
+  for (auto it = parsed.begin(); it != parsed.end(); ++it) {
+    if (!is_valid_name(*it))
+      BOOST_THROW_EXCEPTION(std::invalid_argument("Invalid instance name '" + *it + "'"));
+    if (std::find(parsed.begin(), it, *it) != it)
+      BOOST_THROW_EXCEPTION(std::invalid_argument("Instance '" + *it + "' given more than once"));
+  }
+
+  std::stable_partition(parsed.begin(), parsed.end(), [](const std::string &name) {
+    return name == SystemConfiguration::default_instance;
+  });
+
+  std::vector<Instance> instances;
+  for (const auto &name : parsed)
+    instances.push_back({name, first_id + static_cast<unsigned int>(instances.size()) * ids_per_instance});
+  return instances;
+}
+
+bool Instance::is_valid_name(const std::string &name) {
+  if (name.empty() || name.size() > max_name_size || name[0] == '-')
+    return false;
+  return std::all_of(name.begin(), name.end(), [](char c) {
+    return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == '_';
+  });
+}
+}  // namespace container
+}  // namespace anbox
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef ANBOX_CONTAINER_INSTANCE_H_
+#define ANBOX_CONTAINER_INSTANCE_H_
+
+#include <string>
+#include <vector>
+
+namespace anbox {
+namespace container {
+// One of the Android containers running side by side on a host. Each has
+// its own LXC container, writable layer on top of the shared Android
+// image, data, sockets and range of host ids its users and groups map to.
+struct Instance {
+  // First host id containers map their ids to.
+  static constexpr unsigned int first_id{100000};
+  // Ids every container maps, see LxcContainer::setup_id_maps().
+  static constexpr unsigned int ids_per_instance{65536};
+
+  // Parses a comma separated list of instance names. Ranges of ids are
+  // handed out in the given order but the default instance always gets the
+  // first one so that its existing data keeps belonging to it. Throws
+  // std::invalid_argument for an empty list, invalid or duplicate names.
+  static std::vector<Instance> parse(const std::string &names);
+
+  // Names end up in paths and LXC container names so we only allow
+  // characters which are safe for both.
+  static bool is_valid_name(const std::string &name);
+
+  std::string name;
+  unsigned int base_id;
+};
+}  // namespace container
+}  // namespace anbox
+
+#endif
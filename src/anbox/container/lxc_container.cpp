@@ -16,27 +16,44 @@
  */
 
 #include "anbox/container/lxc_container.h"
+#include "anbox/common/mount_entry.h"
 #include "anbox/config.h"
 #include "anbox/logger.h"
 #include "anbox/utils.h"
 
+#include <fstream>
+#include <iterator>
 #include <map>
+#include <sstream>
 #include <stdexcept>
 
 #include <boost/filesystem.hpp>
 #include <boost/throw_exception.hpp>
 
+#include <signal.h>
+
 #include <sys/capability.h>
 #include <sys/prctl.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 
 namespace fs = boost::filesystem;
 
+namespace {
+constexpr const char *checkpoint_stamp_name{"anbox-stamp"};
+// Next to the LXC config, all items it was generated from
+constexpr const char *config_cache_name{"anbox-config-items"};
+// How long a killed container may take to go away before LXC stops it.
+constexpr int kill_timeout_seconds{5};
+}  // namespace
+
 namespace anbox {
 namespace container {
-LxcContainer::LxcContainer(bool privileged, const network::Credentials &creds)
-    : state_(State::inactive), container_(nullptr),  privileged_(privileged), creds_(creds) {
+LxcContainer::LxcContainer(bool privileged, const network::Credentials &creds,
+                           const Instance &instance, bool checkpoints)
+    : state_(State::inactive), container_(nullptr),  privileged_(privileged), creds_(creds),
+      instance_(instance), checkpoints_(checkpoints), restored_(false) {
   utils::ensure_paths({
       SystemConfiguration::instance().container_config_dir(),
       SystemConfiguration::instance().log_dir(),
@@ -48,109 +65,100 @@ LxcContainer::~LxcContainer() {
   if (container_) lxc_container_put(container_);
 }
 
-void LxcContainer::setup_id_maps() {
-  // FIXME make these id sets configurable
-  const auto base_id = 100000;
-  const auto max_id = 65536;
+std::string LxcContainer::host_interface() const {
+  // Interface names are too short for instance names.
+  const auto index = (instance_.base_id - Instance::first_id) / Instance::ids_per_instance;
+  return utils::string_format("anboxveth%d", index);
+}
+
+void LxcContainer::add_id_maps(ConfigItems &items) const {
+  // Every instance maps to its own range of host ids so that they can't
+  // touch each others files.
+  const auto base_id = instance_.base_id;
+  const auto max_id = Instance::ids_per_instance;
 
-  set_config_item("lxc.id_map",
-                  utils::string_format("u 0 %d %d", base_id, creds_.uid() - 1));
-  set_config_item("lxc.id_map",
-                  utils::string_format("g 0 %d %d", base_id, creds_.gid() - 1));
+  items.push_back({"lxc.id_map",
+                   utils::string_format("u 0 %d %d", base_id, creds_.uid() - 1)});
+  items.push_back({"lxc.id_map",
+                   utils::string_format("g 0 %d %d", base_id, creds_.gid() - 1)});
 
   // We need to bind the user id for the one running the client side
   // process as he is the owner of various socket files we bind mount
   // into the container.
-  set_config_item("lxc.id_map",
-                  utils::string_format("u %d %d 1", creds_.uid(), creds_.uid()));
-  set_config_item("lxc.id_map",
-                  utils::string_format("g %d %d 1", creds_.gid(), creds_.gid()));
-
-  set_config_item("lxc.id_map",
-                  utils::string_format("u %d %d %d", creds_.uid() + 1,
-                                       base_id + creds_.uid() + 1,
-                                       max_id - creds_.uid() - 1));
-  set_config_item("lxc.id_map",
-                  utils::string_format("g %d %d %d", creds_.uid() + 1,
-                                       base_id + creds_.gid() + 1,
-                                       max_id - creds_.gid() - 1));
+  items.push_back({"lxc.id_map",
+                   utils::string_format("u %d %d 1", creds_.uid(), creds_.uid())});
+  items.push_back({"lxc.id_map",
+                   utils::string_format("g %d %d 1", creds_.gid(), creds_.gid())});
+
+  items.push_back({"lxc.id_map",
+                   utils::string_format("u %d %d %d", creds_.uid() + 1,
+                                        base_id + creds_.uid() + 1,
+                                        max_id - creds_.uid() - 1)});
+  items.push_back({"lxc.id_map",
+                   utils::string_format("g %d %d %d", creds_.uid() + 1,
+                                        base_id + creds_.gid() + 1,
+                                        max_id - creds_.gid() - 1)});
 }
 
-void LxcContainer::start(const Configuration &configuration) {
-  if (getuid() != 0)
-    BOOST_THROW_EXCEPTION(std::runtime_error("You have to start the container as root"));
-
-  if (container_ && container_->is_running(container_)) {
-    WARNING("Container already started, stopping it now");
-    container_->stop(container_);
-  }
-
-  if (!container_) {
-    const auto container_config_dir = SystemConfiguration::instance().container_config_dir();
-    DEBUG("Containers are stored in %s", container_config_dir);
-
-    // Remove container config to be be able to rewrite it
-    ::unlink(utils::string_format("%s/default/config", container_config_dir).c_str());
-
-    container_ = lxc_container_new("default", container_config_dir.c_str());
-    if (!container_)
-      BOOST_THROW_EXCEPTION(std::runtime_error("Failed to create LXC container instance"));
-
-    // If container is still running (for example after a crash) we stop it here
-    // to ensure
-    // its configuration is synchronized.
-    if (container_->is_running(container_)) container_->stop(container_);
-  }
+LxcContainer::ConfigItems LxcContainer::config_items(const Configuration &configuration) const {
+  ConfigItems items;
 
   // We can mount proc/sys as rw here as we will run the container unprivileged
   // in the end
-  set_config_item("lxc.mount.auto", "proc:mixed sys:mixed cgroup:mixed");
+  items.push_back({"lxc.mount.auto", "proc:mixed sys:mixed cgroup:mixed"});
 
-  set_config_item("lxc.autodev", "1");
-  set_config_item("lxc.pts", "1024");
-  set_config_item("lxc.tty", "0");
-  set_config_item("lxc.utsname", "anbox");
+  items.push_back({"lxc.autodev", "1"});
+  items.push_back({"lxc.pts", "1024"});
+  items.push_back({"lxc.tty", "0"});
+  items.push_back({"lxc.utsname", "anbox"});
 
-  set_config_item("lxc.group.devices.deny", "");
-  set_config_item("lxc.group.devices.allow", "");
+  items.push_back({"lxc.group.devices.deny", ""});
+  items.push_back({"lxc.group.devices.allow", ""});
 
   // We can't move bind-mounts, so don't use /dev/lxc/
-  set_config_item("lxc.devttydir", "");
+  items.push_back({"lxc.devttydir", ""});
 
-  set_config_item("lxc.environment",
-                  "PATH=/system/bin:/system/sbin:/system/xbin");
+  items.push_back({"lxc.environment",
+                   "PATH=/system/bin:/system/sbin:/system/xbin"});
 
-  set_config_item("lxc.init_cmd", "/anbox-init.sh");
-  set_config_item("lxc.rootfs.backend", "dir");
+  items.push_back({"lxc.init_cmd", "/anbox-init.sh"});
+  items.push_back({"lxc.rootfs.backend", "dir"});
 
-  const auto rootfs_path = SystemConfiguration::instance().rootfs_dir();
-  DEBUG("Using rootfs path %s", rootfs_path);
-  set_config_item("lxc.rootfs", rootfs_path);
+  const auto rootfs_path = SystemConfiguration::instance().rootfs_dir(instance_.name);
+  items.push_back({"lxc.rootfs", rootfs_path});
 
-  set_config_item("lxc.loglevel", "0");
+  items.push_back({"lxc.loglevel", "0"});
   const auto log_path = SystemConfiguration::instance().log_dir();
-  set_config_item("lxc.logfile", utils::string_format("%s/container.log", log_path).c_str());
-
-  if (fs::exists("/sys/class/net/anboxbr0")) {
-    set_config_item("lxc.network.type", "veth");
-    set_config_item("lxc.network.flags", "up");
-    set_config_item("lxc.network.link", "anboxbr0");
+  const auto log_name = instance_.name == SystemConfiguration::default_instance
+                            ? std::string("container.log")
+                            : utils::string_format("container-%s.log", instance_.name);
+  items.push_back({"lxc.logfile", utils::string_format("%s/%s", log_path, log_name)});
+
+  // Without the bridge the container gets whatever LXC defaults to.
+  const auto &network = configuration.network;
+  if (network.mode != NetworkSettings::Mode::bridge ||
+      fs::exists("/sys/class/net/" + network.link_or_default())) {
+    for (const auto &item : network.lxc_config_items(host_interface()))
+      items.push_back(item);
   }
 
 #if 0
     // Android uses namespaces as well so we have to allow nested namespaces for LXC
     // which are otherwise forbidden by AppArmor.
-    set_config_item("lxc.aa_profile", "lxc-container-default-with-nesting");
+    items.push_back({"lxc.aa_profile", "lxc-container-default-with-nesting"});
 #else
   // FIXME: when using the nested profile we still get various denials from
   // things Android tries to do but isn't allowed to. We need to look into
   // those and see how we can switch back to a confined way of running the
   // container.
-  set_config_item("lxc.aa_profile", "unconfined");
+  items.push_back({"lxc.aa_profile", "unconfined"});
 #endif
 
+  for (const auto &item : configuration.resources.lxc_config_items(ResourceLimits::unified_hierarchy()))
+    items.push_back(item);
+
   if (!privileged_)
-    setup_id_maps();
+    add_id_maps(items);
 
   auto bind_mounts = configuration.bind_mounts;
 
@@ -163,6 +171,16 @@ void LxcContainer::start(const Configuration &configuration) {
   bind_mounts.insert({"/dev/urandom", "dev/urandom"});
   bind_mounts.insert({"/dev/zero", "dev/zero"});
 
+  if (!configuration.binder_device.empty()) {
+    for (auto it = bind_mounts.begin(); it != bind_mounts.end();) {
+      if (it->second == "/dev/binder" || it->second == "dev/binder")
+        it = bind_mounts.erase(it);
+      else
+        ++it;
+    }
+    bind_mounts.insert({configuration.binder_device, "/dev/binder"});
+  }
+
   for (const auto &bind_mount : bind_mounts) {
     std::string create_type = "file";
 
@@ -176,20 +194,101 @@ void LxcContainer::start(const Configuration &configuration) {
       target_path = std::string("/") + target_path;
     target_path = rootfs_path + target_path;
 
-    set_config_item(
-        "lxc.mount.entry",
-        utils::string_format("%s %s none bind,create=%s,optional 0 0",
-                             bind_mount.first, target_path, create_type));
+    items.push_back({"lxc.mount.entry",
+                     utils::string_format("%s %s none bind,create=%s,optional 0 0",
+                                          bind_mount.first, target_path, create_type)});
+  }
+
+  return items;
+}
+
+void LxcContainer::start(const Configuration &configuration) {
+  if (getuid() != 0)
+    BOOST_THROW_EXCEPTION(std::runtime_error("You have to start the container as root"));
+
+  if (container_ && container_->is_running(container_)) {
+    WARNING("Container already started, stopping it now");
+    container_->stop(container_);
+  }
+
+  // Building the items is cheap. Feeding them one by one through LXC and
+  // writing the config out again isn't, so we only do that when they
+  // changed since the config was saved the last time.
+  std::string items_text;
+  const auto items = config_items(configuration);
+  for (const auto &item : items)
+    items_text += item.first + " = " + item.second + "\n";
+
+  const auto container_config_dir = SystemConfiguration::instance().container_config_dir();
+  const auto config_path = utils::string_format("%s/%s/config", container_config_dir, instance_.name);
+  const auto cache_path = utils::string_format("%s/%s/%s", container_config_dir, instance_.name,
+                                               config_cache_name);
+
+  // The handle holds every item we set on it so far in memory.
+  if (container_ && items_text != config_items_) {
+    lxc_container_put(container_);
+    container_ = nullptr;
+  }
+
+  if (!container_) {
+    DEBUG("Containers are stored in %s", container_config_dir);
+
+    std::string cached_items;
+    {
+      std::ifstream in(cache_path);
+      cached_items.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    if (cached_items == items_text && fs::exists(config_path)) {
+      config_items_ = items_text;
+    } else {
+      // Remove container config to be be able to rewrite it
+      ::unlink(config_path.c_str());
+      ::unlink(cache_path.c_str());
+      config_items_.clear();
+    }
+
+    container_ = lxc_container_new(instance_.name.c_str(), container_config_dir.c_str());
+    if (!container_)
+      BOOST_THROW_EXCEPTION(std::runtime_error("Failed to create LXC container instance"));
+
+    // If container is still running (for example after a crash) we stop it here
+    // to ensure
+    // its configuration is synchronized.
+    if (container_->is_running(container_)) container_->stop(container_);
   }
 
-  if (!container_->save_config(container_, nullptr))
-    BOOST_THROW_EXCEPTION(
-        std::runtime_error("Failed to save container configuration"));
+  if (config_items_ != items_text) {
+    for (const auto &item : items)
+      set_config_item(item.first, item.second);
+
+    if (!container_->save_config(container_, nullptr))
+      BOOST_THROW_EXCEPTION(
+          std::runtime_error("Failed to save container configuration"));
+
+    std::ofstream out(cache_path);
+    out << items_text;
+    if (!out)
+      WARNING("Failed to cache the container configuration");
+    config_items_ = items_text;
+  } else {
+    DEBUG("Container configuration is unchanged, using the saved one");
+  }
+
+  stamp_ = checkpoint_stamp(configuration);
+  restored_ = checkpoints_ && restore(stamp_);
+  if (restored_) {
+    state_ = Container::State::running;
+    configuration.network.tune(host_interface(), container_->init_pid(container_));
+    DEBUG("Container successfully restored");
+    return;
+  }
 
   if (not container_->start(container_, 0, nullptr))
     BOOST_THROW_EXCEPTION(std::runtime_error("Failed to start container"));
 
   state_ = Container::State::running;
+  configuration.network.tune(host_interface(), container_->init_pid(container_));
 
   DEBUG("Container successfully started");
 }
@@ -206,6 +305,115 @@ void LxcContainer::stop() {
   DEBUG("Container successfully stopped");
 }
 
+void LxcContainer::kill() {
+  if (not container_ || not container_->is_running(container_))
+    return;
+
+  // Frozen, nothing in the container can respawn what was killed or keep
+  // writing while it goes down. Killing its init takes every other process
+  // of its PID namespace along, they only die once thawed again though.
+  const auto frozen = container_->freeze(container_);
+  const auto pid = container_->init_pid(container_);
+  // Its processes may still hold on to the image and bind mounts for a
+  // moment when we release them.
+  common::MountEntry::detach_busy_mounts();
+  if (pid > 0)
+    ::kill(pid, SIGKILL);
+  if (frozen)
+    container_->unfreeze(container_);
+
+  if (pid <= 0 || not container_->wait(container_, "STOPPED", kill_timeout_seconds)) {
+    WARNING("Container did not go away when killed, stopping it");
+    stop();
+    return;
+  }
+
+  state_ = Container::State::inactive;
+
+  DEBUG("Container successfully killed");
+}
+
+void LxcContainer::checkpoint() {
+  if (!checkpoints_)
+    BOOST_THROW_EXCEPTION(std::runtime_error("Checkpoints are disabled"));
+  if (not container_ || not container_->is_running(container_))
+    BOOST_THROW_EXCEPTION(std::runtime_error("Container is not running"));
+
+  const auto dir = fs::path(SystemConfiguration::instance().checkpoint_dir(instance_.name));
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+
+  // The container is stopped once its state is dumped. On failure the CRIU
+  // logs stay in the checkpoint directory but without a stamp nobody tries
+  // to restore from it.
+  auto path = dir.string();
+  if (not container_->checkpoint(container_, &path[0], true, false))
+    BOOST_THROW_EXCEPTION(std::runtime_error("Failed to checkpoint container, see " + path));
+
+  std::ofstream out((dir / checkpoint_stamp_name).string());
+  out << stamp_;
+  if (!out)
+    WARNING("Failed to write stamp of the container checkpoint");
+
+  state_ = Container::State::inactive;
+  restored_ = false;
+
+  DEBUG("Container successfully checkpointed");
+}
+
+bool LxcContainer::restored() { return restored_; }
+
+bool LxcContainer::restore(const std::string &stamp) {
+  const auto dir = fs::path(SystemConfiguration::instance().checkpoint_dir(instance_.name));
+  const auto stamp_path = dir / checkpoint_stamp_name;
+  if (!fs::exists(stamp_path))
+    return false;
+
+  std::string checkpoint_stamp;
+  {
+    std::ifstream in(stamp_path.string());
+    checkpoint_stamp.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+
+  // The data of the container moves on from here so the checkpoint can't
+  // be used a second time.
+  fs::remove(stamp_path);
+
+  if (checkpoint_stamp != stamp) {
+    INFO("Booting container as its checkpoint was taken with a different configuration");
+    return false;
+  }
+
+  auto path = dir.string();
+  if (not container_->restore(container_, &path[0], false)) {
+    WARNING("Failed to restore container, booting it instead. See %s for details", path);
+    if (container_->is_running(container_))
+      container_->stop(container_);
+    return false;
+  }
+
+  return true;
+}
+
+std::string LxcContainer::checkpoint_stamp(const Configuration &configuration) const {
+  std::stringstream stamp;
+  stamp << "uid " << creds_.uid() << "\n"
+        << "gid " << creds_.gid() << "\n";
+  for (const auto &bind_mount : configuration.bind_mounts)
+    stamp << "bind " << bind_mount.first << " " << bind_mount.second << "\n";
+  stamp << "binder " << configuration.binder_device << "\n";
+  stamp << "network " << static_cast<int>(configuration.network.mode) << " "
+        << configuration.network.link_or_default() << "\n";
+
+  // Restoring on top of a different Android image won't end well.
+  struct stat build_prop;
+  const auto build_prop_path = fs::path(SystemConfiguration::instance().rootfs_dir(instance_.name)) /
+                               "system" / "build.prop";
+  if (::stat(build_prop_path.c_str(), &build_prop) == 0)
+    stamp << "image " << build_prop.st_ino << " " << build_prop.st_mtime << "\n";
+  return stamp.str();
+}
+
 void LxcContainer::set_config_item(const std::string &key,
                                    const std::string &value) {
   if (!container_->set_config_item(container_, key.c_str(), value.c_str()))
@@ -19,9 +19,12 @@
 #define ANBOX_CONTAINER_LXC_CONTAINER_H_
 
 #include "anbox/container/container.h"
+#include "anbox/container/instance.h"
 #include "anbox/network/credentials.h"
 
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <lxc/lxccontainer.h>
 
@@ -29,21 +32,44 @@ namespace anbox {
 namespace container {
 class LxcContainer : public Container {
  public:
-  LxcContainer(bool privileged, const network::Credentials &creds);
+  // With |checkpoints| set the container can be checkpointed through CRIU
+  // and the next start restores it once.
+  LxcContainer(bool privileged, const network::Credentials &creds, const Instance &instance,
+               bool checkpoints = false);
   ~LxcContainer();
 
   void start(const Configuration &configuration) override;
   void stop() override;
+  void kill() override;
+  void checkpoint() override;
+  bool restored() override;
   State state() override;
 
  private:
+  typedef std::vector<std::pair<std::string, std::string>> ConfigItems;
+
   void set_config_item(const std::string &key, const std::string &value);
-  void setup_id_maps();
+  // All LXC config items for |configuration|, in the order they are set.
+  ConfigItems config_items(const Configuration &configuration) const;
+  void add_id_maps(ConfigItems &items) const;
+  // Name of the host end of the veth pair of the container.
+  std::string host_interface() const;
+  // Restores the container from its checkpoint if there is one taken with
+  // |stamp|. Any checkpoint is gone afterwards.
+  bool restore(const std::string &stamp);
+  // Describes everything a checkpoint depends on besides the container.
+  std::string checkpoint_stamp(const Configuration &configuration) const;
 
   State state_;
   lxc_container *container_;
   bool privileged_;
   network::Credentials creds_;
+  Instance instance_;
+  bool checkpoints_;
+  bool restored_;
+  std::string stamp_;
+  // The items the config of |container_| holds.
+  std::string config_items_;
 };
 }  // namespace container
 }  // namespace anbox
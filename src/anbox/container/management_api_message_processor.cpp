@@ -27,8 +27,9 @@ namespace container {
 ManagementApiMessageProcessor::ManagementApiMessageProcessor(
     const std::shared_ptr<network::MessageSender> &sender,
     const std::shared_ptr<rpc::PendingCallCache> &pending_calls,
-    const std::shared_ptr<ManagementApiSkeleton> &server)
-    : rpc::MessageProcessor(sender, pending_calls), server_(server) {}
+    const std::shared_ptr<ManagementApiSkeleton> &server,
+    const std::shared_ptr<rpc::Framing> &framing)
+    : rpc::MessageProcessor(sender, pending_calls, framing), server_(server) {}
 
 ManagementApiMessageProcessor::~ManagementApiMessageProcessor() {}
 
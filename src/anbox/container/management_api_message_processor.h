@@ -28,7 +28,8 @@ class ManagementApiMessageProcessor : public rpc::MessageProcessor {
   ManagementApiMessageProcessor(
       const std::shared_ptr<network::MessageSender> &sender,
       const std::shared_ptr<rpc::PendingCallCache> &pending_calls,
-      const std::shared_ptr<ManagementApiSkeleton> &server);
+      const std::shared_ptr<ManagementApiSkeleton> &server,
+      const std::shared_ptr<rpc::Framing> &framing);
   ~ManagementApiMessageProcessor();
 
   void dispatch(rpc::Invocation const &invocation) override;
@@ -29,14 +29,16 @@ namespace anbox {
 namespace container {
 ManagementApiSkeleton::ManagementApiSkeleton(
     const std::shared_ptr<rpc::PendingCallCache> &pending_calls,
-    const std::shared_ptr<Container> &container)
-    : pending_calls_(pending_calls), container_(container) {}
+    const std::shared_ptr<Container> &container, const ResourceLimits &resources,
+    const NetworkSettings &network, const std::string &binder_device)
+    : pending_calls_(pending_calls), container_(container), resources_(resources),
+      network_(network), binder_device_(binder_device) {}
 
 ManagementApiSkeleton::~ManagementApiSkeleton() {}
 
 void ManagementApiSkeleton::start_container(
     anbox::protobuf::container::StartContainer const *request,
-    anbox::protobuf::rpc::Void *response, google::protobuf::Closure *done) {
+    anbox::protobuf::container::ContainerStarted *response, google::protobuf::Closure *done) {
   if (container_->state() == Container::State::running) {
     response->set_error("Container is already running");
     done->Run();
@@ -44,6 +46,9 @@ void ManagementApiSkeleton::start_container(
   }
 
   Configuration container_configuration;
+  container_configuration.resources = resources_;
+  container_configuration.network = network_;
+  container_configuration.binder_device = binder_device_;
 
   const auto configuration = request->configuration();
   for (int n = 0; n < configuration.bind_mounts_size(); n++) {
@@ -54,6 +59,7 @@ void ManagementApiSkeleton::start_container(
 
   try {
     container_->start(container_configuration);
+    response->set_restored(container_->restored());
   } catch (std::exception &err) {
     response->set_error(utils::string_format("Failed to start container: %s", err.what()));
   }
@@ -65,16 +71,27 @@ void ManagementApiSkeleton::stop_container(
     anbox::protobuf::container::StopContainer const *request,
     anbox::protobuf::rpc::Void *response, google::protobuf::Closure *done) {
 
-  (void)request;
-
   if (container_->state() != Container::State::running) {
     response->set_error("Container is not running");
     done->Run();
     return;
   }
 
+  if (request->checkpoint() && !request->force()) {
+    try {
+      container_->checkpoint();
+      done->Run();
+      return;
+    } catch (std::exception &err) {
+      WARNING("Stopping container without a checkpoint: %s", err.what());
+    }
+  }
+
   try {
-    container_->stop();
+    if (request->force())
+      container_->kill();
+    else
+      container_->stop();
   } catch (std::exception &err) {
     response->set_error(utils::string_format("Failed to stop container: %s", err.what()));
   }
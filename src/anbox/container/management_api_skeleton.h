@@ -18,7 +18,11 @@
 #ifndef ANBOX_CONTAINER_MANAGEMENT_API_SKELETON_H_
 #define ANBOX_CONTAINER_MANAGEMENT_API_SKELETON_H_
 
+#include "anbox/container/network_settings.h"
+#include "anbox/container/resource_limits.h"
+
 #include <memory>
+#include <string>
 
 namespace google {
 namespace protobuf {
@@ -32,6 +36,7 @@ namespace rpc {
 class Void;
 }  // namespace rpc
 namespace container {
+class ContainerStarted;
 class StartContainer;
 class StopContainer;
 }  // namespace container
@@ -43,14 +48,19 @@ namespace container {
 class Container;
 class ManagementApiSkeleton {
  public:
+  // Containers always get |resources|, |network| and |binder_device|, no
+  // matter what a client asks for.
   ManagementApiSkeleton(
       const std::shared_ptr<rpc::PendingCallCache> &pending_calls,
-      const std::shared_ptr<Container> &container);
+      const std::shared_ptr<Container> &container,
+      const ResourceLimits &resources = ResourceLimits{},
+      const NetworkSettings &network = NetworkSettings{},
+      const std::string &binder_device = std::string());
   ~ManagementApiSkeleton();
 
   void start_container(
       anbox::protobuf::container::StartContainer const *request,
-      anbox::protobuf::rpc::Void *response, google::protobuf::Closure *done);
+      anbox::protobuf::container::ContainerStarted *response, google::protobuf::Closure *done);
 
   void stop_container(
       anbox::protobuf::container::StopContainer const *request,
@@ -59,6 +69,9 @@ class ManagementApiSkeleton {
  private:
   std::shared_ptr<rpc::PendingCallCache> pending_calls_;
   std::shared_ptr<Container> container_;
+  ResourceLimits resources_;
+  NetworkSettings network_;
+  std::string binder_device_;
 };
 }  // namespace container
 }  // namespace anbox
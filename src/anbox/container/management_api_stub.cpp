@@ -30,8 +30,8 @@ ManagementApiStub::ManagementApiStub(
 
 ManagementApiStub::~ManagementApiStub() {}
 
-void ManagementApiStub::start_container(const Configuration &configuration) {
-  auto c = std::make_shared<Request<protobuf::rpc::Void>>();
+bool ManagementApiStub::start_container(const Configuration &configuration) {
+  auto c = std::make_shared<Request<protobuf::container::ContainerStarted>>();
 
   protobuf::container::StartContainer message;
   auto message_configuration = new protobuf::container::Configuration;
@@ -55,17 +55,20 @@ void ManagementApiStub::start_container(const Configuration &configuration) {
   c->wh.wait_for_all();
 
   if (c->response->has_error()) throw std::runtime_error(c->response->error());
+
+  return c->response->restored();
 }
 
-void ManagementApiStub::container_started(Request<protobuf::rpc::Void> *request) {
+void ManagementApiStub::container_started(Request<protobuf::container::ContainerStarted> *request) {
   request->wh.result_received();
 }
 
-void ManagementApiStub::stop_container() {
+void ManagementApiStub::stop_container(bool checkpoint, bool force) {
   auto c = std::make_shared<Request<protobuf::rpc::Void>>();
 
   protobuf::container::StopContainer message;
-  message.set_force(false);
+  message.set_force(force);
+  message.set_checkpoint(checkpoint);
 
   {
     std::lock_guard<decltype(mutex_)> lock(mutex_);
@@ -29,6 +29,9 @@ namespace protobuf {
 namespace rpc {
 class Void;
 }  // namespace rpc
+namespace container {
+class ContainerStarted;
+}  // namespace container
 }  // namespace protobuf
 namespace rpc {
 class Channel;
@@ -39,8 +42,13 @@ class ManagementApiStub : public DoNotCopyOrMove {
   ManagementApiStub(const std::shared_ptr<rpc::Channel> &channel);
   ~ManagementApiStub();
 
-  void start_container(const Configuration &configuration);
-  void stop_container();
+  // Returns whether the container was restored from a checkpoint.
+  bool start_container(const Configuration &configuration);
+  // With |checkpoint| set the container manager is asked to keep the state
+  // of the container for the next start. With |force| set it kills the
+  // container instead of stopping it, which isn't combined with a
+  // checkpoint.
+  void stop_container(bool checkpoint = false, bool force = false);
 
  private:
   template <typename Response>
@@ -51,7 +59,7 @@ class ManagementApiStub : public DoNotCopyOrMove {
     common::WaitHandle wh;
   };
 
-  void container_started(Request<protobuf::rpc::Void> *request);
+  void container_started(Request<protobuf::container::ContainerStarted> *request);
   void container_stopped(Request<protobuf::rpc::Void> *request);
 
   mutable std::mutex mutex_;
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/container/memory_pressure.h"
+#include "anbox/utils.h"
+
+#include <boost/filesystem.hpp>
+
+#include <sstream>
+
+namespace fs = boost::filesystem;
+
+namespace {
+constexpr const char *host_pressure_path{"/proc/pressure/memory"};
+
+// Reads the avg10 value of a "some avg10=0.00 avg60=0.00 ..." line.
+bool parse_avg10(std::istringstream &line, double &value) {
+  std::string field;
+  while (line >> field) {
+    if (!anbox::utils::string_starts_with(field, "avg10="))
+      continue;
+    try {
+      value = std::stod(field.substr(6));
+    } catch (const std::exception &) {
+      return false;
+    }
+    return true;
+  }
+  return false;
+}
+}  // namespace
+
+namespace anbox {
+namespace container {
+constexpr double MemoryPressure::low_some_avg10;
+constexpr double MemoryPressure::medium_some_avg10;
+constexpr double MemoryPressure::medium_full_avg10;
+constexpr double MemoryPressure::critical_full_avg10;
+
+bool MemoryPressure::parse(const std::string &text, MemoryPressure &pressure) {
+  bool some = false;
+  // Kernels before 5.13 don't report 'full' for the host.
+  pressure.full_avg10 = 0.0;
+
+  std::istringstream in(text);
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    std::string kind;
+    fields >> kind;
+    if (kind == "some")
+      some = parse_avg10(fields, pressure.some_avg10);
+    else if (kind == "full" && !parse_avg10(fields, pressure.full_avg10))
+      return false;
+  }
+  return some;
+}
+
+std::string MemoryPressure::path_for(const std::string &instance) {
+  // Depending on the LXC version, see also BinderStatistics::resolve_process
+  for (const auto &format : {"/sys/fs/cgroup/lxc.payload.%s/memory.pressure",
+                             "/sys/fs/cgroup/lxc.payload/%s/memory.pressure",
+                             "/sys/fs/cgroup/lxc/%s/memory.pressure"}) {
+    const auto path = utils::string_format(format, instance);
+    if (fs::exists(path))
+      return path;
+  }
+  if (fs::exists(host_pressure_path))
+    return host_pressure_path;
+  return "";
+}
+
+MemoryPressure::Level MemoryPressure::level() const {
+  if (full_avg10 >= critical_full_avg10)
+    return Level::critical;
+  if (full_avg10 >= medium_full_avg10 || some_avg10 >= medium_some_avg10)
+    return Level::medium;
+  if (some_avg10 >= low_some_avg10)
+    return Level::low;
+  return Level::none;
+}
+
+std::string to_string(MemoryPressure::Level level) {
+  switch (level) {
+    case MemoryPressure::Level::low:
+      return "low";
+    case MemoryPressure::Level::medium:
+      return "medium";
+    case MemoryPressure::Level::critical:
+      return "critical";
+    default:
+      break;
+  }
+  return "none";
+}
+}  // namespace container
+}  // namespace anbox
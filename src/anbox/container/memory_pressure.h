@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_CONTAINER_MEMORY_PRESSURE_H_
+#define ANBOX_CONTAINER_MEMORY_PRESSURE_H_
+
+#include <string>
+
+namespace anbox {
+namespace container {
+// Pressure stall information (PSI) for memory as the kernel reports it for
+// a cgroup in memory.pressure or for the whole host in /proc/pressure/memory.
+struct MemoryPressure {
+  // Modeled after the levels Android's lowmemorykiller daemon knows.
+  enum class Level { none, low, medium, critical };
+
+  // Share of the last 10 seconds in percent some or all tasks were stalled
+  // waiting for memory.
+  double some_avg10;
+  double full_avg10;
+
+  static constexpr double low_some_avg10{5.0};
+  static constexpr double medium_some_avg10{20.0};
+  static constexpr double medium_full_avg10{2.0};
+  static constexpr double critical_full_avg10{10.0};
+
+  // Returns false when |text| isn't in the PSI format.
+  static bool parse(const std::string &text, MemoryPressure &pressure);
+
+  // Returns the PSI file of the cgroup LXC runs the container |instance| in,
+  // the one of the host if it isn't there or an empty string if the kernel
+  // has no PSI support at all.
+  static std::string path_for(const std::string &instance);
+
+  Level level() const;
+};
+
+std::string to_string(MemoryPressure::Level level);
+}  // namespace container
+}  // namespace anbox
+
+#endif
@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/container/network_settings.h"
+#include "anbox/logger.h"
+
+#include <boost/throw_exception.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <linux/ethtool.h>
+#include <linux/sockios.h>
+#include <net/if.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+// Returns 0 or the errno of the first setting which failed. Only makes
+// system calls as it also runs in a child forked off a threaded process.
+int apply_offloads(const char *interface, bool gro, unsigned int queues) {
+  const int sock = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (sock < 0)
+    return errno;
+
+  ifreq ifr;
+  std::memset(&ifr, 0, sizeof(ifr));
+  std::strncpy(ifr.ifr_name, interface, IFNAMSIZ - 1);
+
+  int err = 0;
+  if (gro) {
+    ethtool_value value;
+    value.cmd = ETHTOOL_SGRO;
+    value.data = 1;
+    ifr.ifr_data = reinterpret_cast<char*>(&value);
+    if (::ioctl(sock, SIOCETHTOOL, &ifr) < 0)
+      err = errno;
+  }
+
+  if (queues > 0 && err == 0) {
+    ethtool_channels channels;
+    std::memset(&channels, 0, sizeof(channels));
+    channels.cmd = ETHTOOL_GCHANNELS;
+    ifr.ifr_data = reinterpret_cast<char*>(&channels);
+    if (::ioctl(sock, SIOCETHTOOL, &ifr) < 0) {
+      err = errno;
+    } else {
+      // veth has separate rx and tx queues, limited by what the pair was
+      // created with.
+      channels.cmd = ETHTOOL_SCHANNELS;
+      channels.rx_count = std::min(queues, channels.max_rx);
+      channels.tx_count = std::min(queues, channels.max_tx);
+      if (::ioctl(sock, SIOCETHTOOL, &ifr) < 0)
+        err = errno;
+    }
+  }
+
+  ::close(sock);
+  return err;
+}
+
+// Same as apply_offloads() but inside the network namespace of |pid|.
+int apply_offloads_in(pid_t pid, const char *interface, bool gro, unsigned int queues) {
+  char ns_path[64];
+  std::snprintf(ns_path, sizeof(ns_path), "/proc/%d/ns/net", pid);
+
+  const auto child = ::fork();
+  if (child < 0)
+    return errno;
+  if (child == 0) {
+    const int ns = ::open(ns_path, O_RDONLY | O_CLOEXEC);
+    if (ns < 0 || ::setns(ns, CLONE_NEWNET) < 0)
+      ::_exit(errno & 0xff);
+    ::_exit(apply_offloads(interface, gro, queues) & 0xff);
+  }
+
+  int status = 0;
+  if (::waitpid(child, &status, 0) < 0)
+    return errno;
+  if (!WIFEXITED(status))
+    return ECHILD;
+  return WEXITSTATUS(status);
+}
+}  // namespace
+
+namespace anbox {
+namespace container {
+constexpr const char *NetworkSettings::default_bridge;
+constexpr const char *NetworkSettings::container_interface;
+
+NetworkSettings::Mode NetworkSettings::parse_mode(const std::string &name) {
+  if (name == "bridge")
+    return Mode::bridge;
+  if (name == "macvlan")
+    return Mode::macvlan;
+  if (name == "host")
+    return Mode::host;
+  if (name == "none")
+    return Mode::none;
+  BOOST_THROW_EXCEPTION(std::invalid_argument("Unknown network mode '" + name + "'"));
+}
+
+void NetworkSettings::validate() const {
+  if (mode == Mode::macvlan && link.empty())
+    BOOST_THROW_EXCEPTION(std::invalid_argument("A macvlan network needs the device to put it on"));
+  if ((mode == Mode::host || mode == Mode::none) && !link.empty())
+    BOOST_THROW_EXCEPTION(std::invalid_argument("Only bridge and macvlan networks use a link"));
+  if (mode != Mode::bridge && (gro || queues > 0))
+    BOOST_THROW_EXCEPTION(std::invalid_argument("Offloads can only be tuned for bridge networks"));
+}
+
+std::string NetworkSettings::link_or_default() const {
+  if (mode == Mode::bridge && link.empty())
+    return default_bridge;
+  return link;
+}
+
+NetworkSettings::ConfigItems NetworkSettings::lxc_config_items(const std::string &host_interface) const {
+  validate();
+
+  ConfigItems items;
+  switch (mode) {
+    case Mode::bridge:
+      items.push_back({"lxc.network.type", "veth"});
+      items.push_back({"lxc.network.flags", "up"});
+      items.push_back({"lxc.network.link", link_or_default()});
+      // Only needed to find the host end again for tuning it.
+      if (gro || queues > 0)
+        items.push_back({"lxc.network.veth.pair", host_interface});
+      break;
+    case Mode::macvlan:
+      items.push_back({"lxc.network.type", "macvlan"});
+      items.push_back({"lxc.network.flags", "up"});
+      items.push_back({"lxc.network.link", link});
+      // Lets the containers of several instances on the same device talk
+      // to each other.
+      items.push_back({"lxc.network.macvlan.mode", "bridge"});
+      items.push_back({"lxc.network.name", container_interface});
+      break;
+    case Mode::host:
+      items.push_back({"lxc.network.type", "none"});
+      break;
+    case Mode::none:
+      items.push_back({"lxc.network.type", "empty"});
+      break;
+  }
+  return items;
+}
+
+void NetworkSettings::tune(const std::string &host_interface, pid_t pid) const {
+  if (mode != Mode::bridge || (!gro && queues == 0))
+    return;
+
+  auto err = apply_offloads(host_interface.c_str(), gro, queues);
+  if (err != 0)
+    WARNING("Failed to tune offloads of %s: %s", host_interface, std::strerror(err));
+
+  err = apply_offloads_in(pid, container_interface, gro, queues);
+  if (err != 0)
+    WARNING("Failed to tune offloads of %s in the container: %s", container_interface,
+            std::strerror(err));
+}
+}  // namespace container
+}  // namespace anbox
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_CONTAINER_NETWORK_SETTINGS_H_
+#define ANBOX_CONTAINER_NETWORK_SETTINGS_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace anbox {
+namespace container {
+// How a container is connected to the network of the host.
+struct NetworkSettings {
+  enum class Mode {
+    // A veth pair with the host end attached to |link|, if that exists.
+    // Traffic passes the bridge and is NATed by the host.
+    bridge,
+    // A macvlan device on |link|, Android shows up on the network of the
+    // host with an address of its own and skips the bridge and NAT.
+    macvlan,
+    // Android uses the network namespace of the host.
+    host,
+    // Nothing but loopback.
+    none,
+  };
+
+  // Bridge set up by scripts/anbox-bridge.sh.
+  static constexpr const char *default_bridge{"anboxbr0"};
+  // What the network device is called inside the container.
+  static constexpr const char *container_interface{"eth0"};
+
+  typedef std::vector<std::pair<std::string, std::string>> ConfigItems;
+
+  // Throws std::invalid_argument for unknown modes.
+  static Mode parse_mode(const std::string &name);
+
+  // Throws std::invalid_argument for settings which don't fit the mode.
+  void validate() const;
+
+  // |link| or the default for the mode.
+  std::string link_or_default() const;
+
+  // The LXC configuration items setting up the network, with
+  // |host_interface| as the name of the host end of a veth pair.
+  ConfigItems lxc_config_items(const std::string &host_interface) const;
+
+  // Applies the offload settings to both ends of the veth pair of a
+  // started container with |pid| as its init process. Failures are only
+  // logged, the container works without them.
+  void tune(const std::string &host_interface, pid_t pid) const;
+
+  Mode mode = Mode::bridge;
+  // Bridge or parent device, see Mode.
+  std::string link;
+  // Let both ends of the veth pair aggregate packets before passing them
+  // up the stack.
+  bool gro = false;
+  // Queues of each end of the veth pair, 0 to leave them alone. More
+  // queues spread the traffic over more CPUs.
+  unsigned int queues = 0;
+};
+}  // namespace container
+}  // namespace anbox
+
+#endif
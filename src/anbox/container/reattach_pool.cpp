@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/container/reattach_pool.h"
+#include "anbox/config.h"
+#include "anbox/logger.h"
+#include "anbox/network/delegate_connection_creator.h"
+#include "anbox/network/fd_channel.h"
+#include "anbox/network/local_socket_messenger.h"
+
+#include <cstring>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+namespace {
+// Clients send what they have right after connecting, we don't wait for
+// one which doesn't, however slowly it trickles in.
+constexpr int client_timeout_seconds{1};
+// Clients served at the same time at most.
+constexpr int max_clients{8};
+
+anbox::Fd connect_to_pool() {
+  const auto path = anbox::SystemConfiguration::instance().reattach_socket_path();
+
+  anbox::Fd socket{::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)};
+  sockaddr_un addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+  if (socket < 0 || ::connect(socket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+    DEBUG("Container manager keeps no containers for reattaching: %s", std::strerror(errno));
+    return anbox::Fd{};
+  }
+  return socket;
+}
+}  // namespace
+
+namespace anbox {
+namespace container {
+std::shared_ptr<ReattachPool> ReattachPool::create(
+    const std::shared_ptr<Runtime> &rt, const std::vector<std::shared_ptr<Service>> &services) {
+  auto sp = std::shared_ptr<ReattachPool>(new ReattachPool(rt, services));
+
+  auto wp = std::weak_ptr<ReattachPool>(sp);
+  auto delegate_connector = std::make_shared<network::DelegateConnectionCreator<boost::asio::local::stream_protocol>>(
+      [wp](std::shared_ptr<boost::asio::local::stream_protocol::socket> const &socket) {
+        if (auto pool = wp.lock())
+          pool->new_client(socket);
+  });
+
+  const auto socket_path = SystemConfiguration::instance().reattach_socket_path();
+  sp->connector_ = std::make_shared<network::PublishedSocketConnector>(socket_path, rt, delegate_connector);
+  ::chmod(socket_path.c_str(), S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
+
+  return sp;
+}
+
+ReattachPool::ReattachPool(const std::shared_ptr<Runtime> &rt,
+                           const std::vector<std::shared_ptr<Service>> &services)
+    : runtime_(rt), services_(services), clients_(std::make_shared<std::atomic<int>>(0)) {}
+
+void ReattachPool::new_client(
+    std::shared_ptr<boost::asio::local::stream_protocol::socket> const &socket) {
+  try {
+    const auto creds = network::LocalSocketMessenger(socket).creds();
+
+    if (clients_->fetch_add(1) >= max_clients) {
+      clients_->fetch_sub(1);
+      BOOST_THROW_EXCEPTION(std::runtime_error("Too many clients at once"));
+    }
+
+    Fd fd{::dup(socket->native_handle())};
+    timeval timeout{client_timeout_seconds, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    // The timeout above only bounds a single read. Shutting the socket
+    // down makes whichever read the thread is blocked in fail.
+    const auto deadline = std::make_shared<boost::asio::deadline_timer>(
+        runtime_->service(), boost::posix_time::seconds(client_timeout_seconds));
+    deadline->async_wait([fd](const boost::system::error_code &err) {
+      if (!err)
+        ::shutdown(fd, SHUT_RDWR);
+    });
+
+    const auto rt = runtime_;
+    const auto services = services_;
+    const auto clients = clients_;
+    try {
+      std::thread([rt, services, clients, fd, creds, deadline]() {
+        serve_client(services, fd, creds);
+        // The timer keeps the socket open until it is gone.
+        rt->service().post([deadline]() { deadline->cancel(); });
+        clients->fetch_sub(1);
+      }).detach();
+    } catch (...) {
+      deadline->cancel();
+      clients_->fetch_sub(1);
+      throw;
+    }
+  } catch (std::exception &err) {
+    WARNING("Failed to serve session sockets: %s", err.what());
+  }
+
+  // The thread serves the client through its own descriptor.
+  boost::system::error_code err;
+  socket->close(err);
+}
+
+void ReattachPool::serve_client(const std::vector<std::shared_ptr<Service>> &services,
+                                const Fd &socket, const network::Credentials &creds) {
+  try {
+    network::FdChannel channel{socket};
+    std::string instance;
+    std::vector<Fd> sockets;
+    channel.receive(instance, sockets);
+
+    for (const auto &service : services) {
+      if (service->instance_name() != instance)
+        continue;
+
+      if (!sockets.empty()) {
+        if (!service->park_sockets(creds, sockets))
+          WARNING("Pid %d doesn't run the container of instance %s", creds.pid(), instance);
+      } else if (service->take_detached(creds, sockets)) {
+        INFO("Handing sockets of instance %s over to pid %d", instance, creds.pid());
+        channel.send(instance, sockets);
+      }
+      break;
+    }
+  } catch (std::exception &err) {
+    WARNING("Failed to serve session sockets: %s", err.what());
+  }
+}
+
+bool ReattachPool::park(const std::string &instance, const std::map<std::string, Fd> &sockets) {
+  std::vector<Fd> fds;
+  for (const auto &name : Configuration::session_sockets) {
+    const auto socket = sockets.find(name);
+    if (socket == sockets.end() || socket->second == Fd::invalid)
+      return false;
+    fds.push_back(socket->second);
+  }
+
+  const auto socket = connect_to_pool();
+  if (socket == Fd::invalid)
+    return false;
+
+  try {
+    network::FdChannel{socket}.send(instance, fds);
+  } catch (std::exception &err) {
+    WARNING("Failed to hand sockets to the container manager: %s", err.what());
+    return false;
+  }
+  return true;
+}
+
+bool ReattachPool::reattach(const std::string &instance, std::map<std::string, Fd> &sockets) {
+  const auto socket = connect_to_pool();
+  if (socket == Fd::invalid)
+    return false;
+
+  std::vector<Fd> fds;
+  std::string payload;
+  try {
+    network::FdChannel channel{socket};
+    channel.send(instance, fds);
+    channel.receive(payload, fds);
+  } catch (std::exception &err) {
+    // That's also how the container manager tells us it has nothing for us.
+    DEBUG("No container to reattach to: %s", err.what());
+    return false;
+  }
+
+  if (payload != instance || fds.size() != Configuration::session_sockets.size()) {
+    WARNING("Container manager handed over sockets of something else");
+    return false;
+  }
+
+  sockets.clear();
+  for (std::size_t n = 0; n < fds.size(); n++)
+    sockets.insert({Configuration::session_sockets[n], fds[n]});
+  return true;
+}
+}  // namespace container
+}  // namespace anbox
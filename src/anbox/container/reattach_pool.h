@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_CONTAINER_REATTACH_POOL_H_
+#define ANBOX_CONTAINER_REATTACH_POOL_H_
+
+#include "anbox/common/fd.h"
+#include "anbox/container/service.h"
+#include "anbox/network/credentials.h"
+#include "anbox/network/published_socket_connector.h"
+#include "anbox/runtime.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace anbox {
+namespace container {
+// Keeps the listening sockets of sessions, which Android is connected to,
+// for the next session of the same instance through a socket of its own.
+// The sockets are bind mounted into the container, so only they reach a
+// container a session left running. A session connecting to it either
+// parks its sockets, named by the instance they belong to, or asks for the
+// ones of its instance and gets disconnected right away if there are none
+// for it.
+//
+// The socket is open to everyone. Each client is served on a thread of its
+// own so that the runtime never waits for one, and gets cut off once it
+// didn't complete its request in time.
+class ReattachPool : public std::enable_shared_from_this<ReattachPool> {
+ public:
+  static std::shared_ptr<ReattachPool> create(const std::shared_ptr<Runtime> &rt,
+                                              const std::vector<std::shared_ptr<Service>> &services);
+
+  // Parks copies of the listening |sockets|, by the name of their file,
+  // of the calling process which runs the container of |instance|.
+  static bool park(const std::string &instance, const std::map<std::string, Fd> &sockets);
+
+  // Takes over the sockets of a container of |instance| a previous session
+  // left running. Returns false if the container manager has none for the
+  // calling process.
+  static bool reattach(const std::string &instance, std::map<std::string, Fd> &sockets);
+
+ private:
+  ReattachPool(const std::shared_ptr<Runtime> &rt,
+               const std::vector<std::shared_ptr<Service>> &services);
+
+  void new_client(std::shared_ptr<boost::asio::local::stream_protocol::socket> const &socket);
+  // Runs on the thread of the client on |socket|.
+  static void serve_client(const std::vector<std::shared_ptr<Service>> &services,
+                           const Fd &socket, const network::Credentials &creds);
+
+  std::shared_ptr<Runtime> runtime_;
+  std::shared_ptr<network::PublishedSocketConnector> connector_;
+  std::vector<std::shared_ptr<Service>> services_;
+  // Clients currently served, shared with their threads.
+  std::shared_ptr<std::atomic<int>> clients_;
+};
+}  // namespace container
+}  // namespace anbox
+
+#endif
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/container/reattachable_container.h"
+#include "anbox/logger.h"
+
+namespace anbox {
+namespace container {
+ReattachableContainer::ReattachableContainer(const std::shared_ptr<Container> &container,
+                                             const Configuration &configuration,
+                                             const ReleasedCallback &released)
+    : container_(container), configuration_(configuration), released_(released),
+      started_(false), reattached_(false) {}
+
+ReattachableContainer::~ReattachableContainer() {
+  if (!released_)
+    return;
+  if (container_->state() == State::running)
+    released_(container_, configuration_);
+  else
+    released_(nullptr, configuration_);
+}
+
+void ReattachableContainer::start(const Configuration &configuration) {
+  if (!started_ && container_->state() == State::running &&
+      configuration.bind_mounts == configuration_.bind_mounts) {
+    DEBUG("Reattaching to running container");
+    started_ = true;
+    reattached_ = true;
+    return;
+  }
+
+  container_->start(configuration);
+  configuration_ = configuration;
+  started_ = true;
+  reattached_ = false;
+}
+
+void ReattachableContainer::stop() { container_->stop(); }
+
+void ReattachableContainer::kill() { container_->kill(); }
+
+void ReattachableContainer::checkpoint() { container_->checkpoint(); }
+
+bool ReattachableContainer::restored() {
+  return started_ && (reattached_ || container_->restored());
+}
+
+Container::State ReattachableContainer::state() {
+  if (!started_)
+    return State::inactive;
+  return container_->state();
+}
+}  // namespace container
+}  // namespace anbox
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_CONTAINER_REATTACHABLE_CONTAINER_H_
+#define ANBOX_CONTAINER_REATTACHABLE_CONTAINER_H_
+
+#include "anbox/container/container.h"
+
+#include <functional>
+#include <memory>
+
+namespace anbox {
+namespace container {
+// Keeps the container of a session running when the session goes away
+// without stopping it, e.g. because it crashed, so that the next session
+// can reattach to Android instead of booting it again. A container left
+// running looks stopped to the next session until it gets started with
+// the configuration it ran with, which continues it as it is and reports
+// it as restored. Any other configuration restarts it with that one.
+class ReattachableContainer : public Container {
+ public:
+  // Gets the container and what it was started with once the session is
+  // done with it, or nullptr if it isn't running anymore.
+  typedef std::function<void(const std::shared_ptr<Container> &container,
+                             const Configuration &configuration)> ReleasedCallback;
+
+  // |container| is either a fresh one or one a previous session left
+  // running with |configuration|.
+  ReattachableContainer(const std::shared_ptr<Container> &container,
+                        const Configuration &configuration,
+                        const ReleasedCallback &released);
+  ~ReattachableContainer();
+
+  void start(const Configuration &configuration) override;
+  void stop() override;
+  void kill() override;
+  void checkpoint() override;
+  bool restored() override;
+  State state() override;
+
+ private:
+  std::shared_ptr<Container> container_;
+  Configuration configuration_;
+  ReleasedCallback released_;
+  bool started_;
+  bool reattached_;
+};
+}  // namespace container
+}  // namespace anbox
+
+#endif
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/container/resource_limits.h"
+#include "anbox/utils.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/throw_exception.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <stdexcept>
+
+namespace fs = boost::filesystem;
+
+namespace {
+constexpr std::uint64_t cpu_period_us{100000};
+
+// io.max keys and the blkio files doing the same with cgroup v1.
+const std::map<std::string, std::string> io_max_keys{
+    {"rbps", "blkio.throttle.read_bps_device"},
+    {"wbps", "blkio.throttle.write_bps_device"},
+    {"riops", "blkio.throttle.read_iops_device"},
+    {"wiops", "blkio.throttle.write_iops_device"},
+};
+
+bool is_number(const std::string &text) {
+  return !text.empty() && std::all_of(text.begin(), text.end(), ::isdigit);
+}
+
+bool is_device(const std::string &text) {
+  const auto numbers = anbox::utils::string_split(text, ':');
+  return numbers.size() == 2 && is_number(numbers[0]) && is_number(numbers[1]);
+}
+}  // namespace
+
+namespace anbox {
+namespace container {
+constexpr unsigned int ResourceLimits::kernel_cpu_weight;
+constexpr unsigned int ResourceLimits::default_cpu_weight;
+
+bool ResourceLimits::unified_hierarchy() {
+  return fs::exists("/sys/fs/cgroup/cgroup.controllers");
+}
+
+void ResourceLimits::validate() const {
+  if (cpu_weight < 1 || cpu_weight > 10000)
+    BOOST_THROW_EXCEPTION(std::invalid_argument("CPU weight has to be between 1 and 10000"));
+
+  if (memory_high > 0 && memory_max > 0 && memory_high > memory_max)
+    BOOST_THROW_EXCEPTION(std::invalid_argument("Memory high can't be above memory max"));
+
+  for (const auto &line : io_max) {
+    const auto fields = utils::string_split(line, ' ');
+    if (fields.size() < 2 || !is_device(fields[0]))
+      BOOST_THROW_EXCEPTION(std::invalid_argument("Invalid IO limit '" + line + "'"));
+
+    for (std::size_t n = 1; n < fields.size(); n++) {
+      const auto limit = utils::string_split(fields[n], '=');
+      if (limit.size() != 2 || io_max_keys.count(limit[0]) == 0 ||
+          (limit[1] != "max" && !is_number(limit[1])))
+        BOOST_THROW_EXCEPTION(std::invalid_argument("Invalid IO limit '" + line + "'"));
+    }
+  }
+}
+
+ResourceLimits::ConfigItems ResourceLimits::lxc_config_items(bool unified) const {
+  validate();
+
+  ConfigItems items;
+  if (unified) {
+    if (cpu_max > 0)
+      items.push_back({"lxc.cgroup2.cpu.max",
+                       std::to_string(cpu_max * cpu_period_us / 100) + " " +
+                           std::to_string(cpu_period_us)});
+    if (cpu_weight != kernel_cpu_weight)
+      items.push_back({"lxc.cgroup2.cpu.weight", std::to_string(cpu_weight)});
+    if (memory_high > 0)
+      items.push_back({"lxc.cgroup2.memory.high", std::to_string(memory_high)});
+    if (memory_max > 0)
+      items.push_back({"lxc.cgroup2.memory.max", std::to_string(memory_max)});
+    for (const auto &line : io_max)
+      items.push_back({"lxc.cgroup2.io.max", line});
+    return items;
+  }
+
+  if (cpu_max > 0) {
+    items.push_back({"lxc.cgroup.cpu.cfs_period_us", std::to_string(cpu_period_us)});
+    items.push_back({"lxc.cgroup.cpu.cfs_quota_us", std::to_string(cpu_max * cpu_period_us / 100)});
+  }
+  // The default of 1024 shares is what a weight of 100 is for cgroup v2.
+  if (cpu_weight != kernel_cpu_weight)
+    items.push_back({"lxc.cgroup.cpu.shares",
+                     std::to_string(std::max(2u, cpu_weight * 1024 / kernel_cpu_weight))});
+  if (memory_high > 0)
+    items.push_back({"lxc.cgroup.memory.soft_limit_in_bytes", std::to_string(memory_high)});
+  if (memory_max > 0)
+    items.push_back({"lxc.cgroup.memory.limit_in_bytes", std::to_string(memory_max)});
+  for (const auto &line : io_max) {
+    const auto fields = utils::string_split(line, ' ');
+    for (std::size_t n = 1; n < fields.size(); n++) {
+      const auto limit = utils::string_split(fields[n], '=');
+      // There's nothing to set for no limit.
+      if (limit[1] == "max")
+        continue;
+      items.push_back({"lxc.cgroup." + io_max_keys.at(limit[0]), fields[0] + " " + limit[1]});
+    }
+  }
+  return items;
+}
+}  // namespace container
+}  // namespace anbox
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_CONTAINER_RESOURCE_LIMITS_H_
+#define ANBOX_CONTAINER_RESOURCE_LIMITS_H_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace anbox {
+namespace container {
+// What a container may take from the host, enforced through its cgroup.
+// Zero values and no io_max lines leave the respective resource alone.
+struct ResourceLimits {
+  // What cgroups get from the kernel unless told otherwise.
+  static constexpr unsigned int kernel_cpu_weight{100};
+  // Android competes with half of that against its siblings so that host
+  // side rendering next to it wins when the CPUs are busy.
+  static constexpr unsigned int default_cpu_weight{50};
+
+  typedef std::vector<std::pair<std::string, std::string>> ConfigItems;
+
+  // Whether cgroups are managed with the unified (v2) hierarchy only.
+  static bool unified_hierarchy();
+
+  // Throws std::invalid_argument for values the kernel won't take.
+  void validate() const;
+
+  // The LXC configuration items enforcing the limits, with the cgroup v1
+  // equivalents of the cgroup v2 controls when the host has no |unified|
+  // hierarchy.
+  ConfigItems lxc_config_items(bool unified) const;
+
+  // Largest share of the CPUs in percent of a single one, e.g. 250 for two
+  // and a half.
+  unsigned int cpu_max = 0;
+  // Between 1 and 10000.
+  unsigned int cpu_weight = default_cpu_weight;
+  // Bytes of memory at which the container gets throttled and reclaimed
+  // from, and at which it gets OOM killed.
+  std::uint64_t memory_high = 0;
+  std::uint64_t memory_max = 0;
+  // Throttles per block device in the format of io.max, e.g.
+  // "8:0 rbps=1048576 wiops=120".
+  std::vector<std::string> io_max;
+};
+}  // namespace container
+}  // namespace anbox
+
+#endif
@@ -20,6 +20,8 @@
 #include "anbox/container/lxc_container.h"
 #include "anbox/container/management_api_message_processor.h"
 #include "anbox/container/management_api_skeleton.h"
+#include "anbox/container/reattachable_container.h"
+#include "anbox/container/standby_container.h"
 #include "anbox/logger.h"
 #include "anbox/network/delegate_connection_creator.h"
 #include "anbox/network/delegate_message_processor.h"
@@ -27,11 +29,52 @@
 #include "anbox/qemu/null_message_processor.h"
 #include "anbox/rpc/channel.h"
 #include "anbox/rpc/pending_call_cache.h"
+#include "anbox/utils.h"
+
+#include <boost/throw_exception.hpp>
+
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace fs = boost::filesystem;
+
+namespace {
+anbox::Fd listen_on(const std::string &path) {
+  sockaddr_un addr;
+  if (path.size() >= sizeof(addr.sun_path))
+    BOOST_THROW_EXCEPTION(std::runtime_error("Socket path is too long: " + path));
+
+  anbox::Fd socket{::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)};
+  if (socket < 0)
+    BOOST_THROW_EXCEPTION(std::runtime_error(std::string("Failed to create socket: ") +
+                                             std::strerror(errno)));
+
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+  ::unlink(path.c_str());
+  if (::bind(socket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+      ::listen(socket, SOMAXCONN) < 0)
+    BOOST_THROW_EXCEPTION(std::runtime_error(anbox::utils::string_format(
+        "Failed to listen on %s: %s", path, std::strerror(errno))));
+
+  // Android connects with its own users.
+  ::chmod(path.c_str(), 0777);
+  return socket;
+}
+}  // namespace
 
 namespace anbox {
 namespace container {
-std::shared_ptr<Service> Service::create(const std::shared_ptr<Runtime> &rt, bool privileged) {
-  auto sp = std::shared_ptr<Service>(new Service(rt, privileged));
+std::shared_ptr<Service> Service::create(const std::shared_ptr<Runtime> &rt, bool privileged,
+                                         const Instance &instance, bool checkpoints,
+                                         const ResourceLimits &resources,
+                                         const NetworkSettings &network) {
+  auto sp = std::shared_ptr<Service>(
+      new Service(rt, privileged, instance, checkpoints, resources, network));
 
   auto wp = std::weak_ptr<Service>(sp);
   auto delegate_connector = std::make_shared<network::DelegateConnectionCreator<boost::asio::local::stream_protocol>>(
@@ -40,22 +83,32 @@ std::shared_ptr<Service> Service::create(const std::shared_ptr<Runtime> &rt, boo
           service->new_client(socket);
   });
 
-  const auto container_socket_path = SystemConfiguration::instance().container_socket_path();
+  const auto container_socket_path = SystemConfiguration::instance().container_socket_path(instance.name);
   sp->connector_ = std::make_shared<network::PublishedSocketConnector>(container_socket_path, rt, delegate_connector);
 
   // Make sure others can connect to our socket
   ::chmod(container_socket_path.c_str(), S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
 
-  DEBUG("Everything setup. Waiting for incoming connections.");
+  DEBUG("Everything setup for instance %s. Waiting for incoming connections.", instance.name);
 
   return sp;
 }
 
-Service::Service(const std::shared_ptr<Runtime> &rt, bool privileged)
+Service::Service(const std::shared_ptr<Runtime> &rt, bool privileged, const Instance &instance,
+                 bool checkpoints, const ResourceLimits &resources,
+                 const NetworkSettings &network)
     : dispatcher_(anbox::common::create_dispatcher_for_runtime(rt)),
       next_connection_id_(0),
       connections_(std::make_shared<network::Connections<network::SocketConnection>>()),
-      privileged_(privileged) {
+      privileged_(privileged),
+      instance_(instance),
+      checkpoints_(checkpoints),
+      resources_(resources),
+      network_(network),
+      binder_device_(instance),
+      session_connected_(false),
+      detach_timeout_(0),
+      detached_timer_(rt->service()) {
 }
 
 Service::~Service() {
@@ -64,6 +117,160 @@ Service::~Service() {
 
 int Service::next_id() { return next_connection_id_++; }
 
+void Service::keep_standby(const network::Credentials &creds) {
+  {
+    std::lock_guard<std::mutex> l(standby_lock_);
+    standby_creds_.reset(new network::Credentials(creds));
+  }
+  boot_standby();
+}
+
+bool Service::is_standby_user(const network::Credentials &creds) const {
+  return standby_creds_ && standby_creds_->uid() == creds.uid() &&
+         standby_creds_->gid() == creds.gid();
+}
+
+bool Service::take_standby(const network::Credentials &creds, std::vector<Fd> &sockets) {
+  std::lock_guard<std::mutex> l(standby_lock_);
+  if (!standby_ || standby_sockets_.empty() || !is_standby_user(creds))
+    return false;
+
+  // Our copies go now so that Android sees the sockets closed once the
+  // session is gone.
+  sockets = std::move(standby_sockets_);
+  standby_sockets_.clear();
+  return true;
+}
+
+Configuration Service::standby_configuration() const {
+  const auto dir = fs::path(SystemConfiguration::instance().standby_dir(instance_.name));
+  auto configuration =
+      Configuration::for_session((dir / "sockets").string(), (dir / "input").string());
+  configuration.resources = resources_;
+  configuration.network = network_;
+  configuration.binder_device = binder_device_.path();
+  return configuration;
+}
+
+void Service::session_gone() {
+  {
+    std::lock_guard<std::mutex> l(standby_lock_);
+    session_connected_ = false;
+  }
+  boot_standby();
+}
+
+void Service::keep_detached(const std::chrono::seconds &timeout) {
+  std::lock_guard<std::mutex> l(detached_lock_);
+  detach_timeout_ = timeout;
+}
+
+bool Service::park_sockets(const network::Credentials &creds, const std::vector<Fd> &sockets) {
+  std::lock_guard<std::mutex> l(detached_lock_);
+  if (detach_timeout_.count() == 0 || !session_creds_ || session_creds_->pid() != creds.pid() ||
+      sockets.size() != Configuration::session_sockets.size())
+    return false;
+
+  parked_sockets_ = sockets;
+  return true;
+}
+
+bool Service::take_detached(const network::Credentials &creds, std::vector<Fd> &sockets) {
+  std::lock_guard<std::mutex> l(detached_lock_);
+  if (!detached_ || parked_sockets_.empty() || session_creds_->uid() != creds.uid() ||
+      session_creds_->gid() != creds.gid())
+    return false;
+
+  // The next session parks them again once it listens on them.
+  sockets = std::move(parked_sockets_);
+  parked_sockets_.clear();
+  return true;
+}
+
+void Service::session_detached(const std::shared_ptr<Container> &container,
+                               const Configuration &configuration) {
+  std::lock_guard<std::mutex> l(detached_lock_);
+  // Without its sockets nothing could reach Android anymore.
+  if (!container || parked_sockets_.empty()) {
+    parked_sockets_.clear();
+    return;
+  }
+
+  WARNING("Session of instance %s went away, keeping its container running for %d seconds",
+          instance_.name, detach_timeout_.count());
+  detached_ = container;
+  detached_configuration_ = configuration;
+
+  auto wp = std::weak_ptr<Service>(shared_from_this());
+  detached_timer_.expires_from_now(boost::posix_time::seconds(detach_timeout_.count()));
+  detached_timer_.async_wait([wp](const boost::system::error_code &err) {
+    if (auto service = wp.lock())
+      service->drop_detached(err);
+  });
+}
+
+void Service::drop_detached(const boost::system::error_code &err) {
+  if (err)
+    return;
+
+  std::shared_ptr<Container> container;
+  {
+    std::lock_guard<std::mutex> l(detached_lock_);
+    if (!detached_)
+      return;
+    INFO("No session came back for instance %s, stopping its container", instance_.name);
+    container = std::move(detached_);
+    detached_.reset();
+    parked_sockets_.clear();
+  }
+  // Stopping takes a while, not while holding the lock.
+  container.reset();
+}
+
+void Service::boot_standby() {
+  auto wp = std::weak_ptr<Service>(shared_from_this());
+  dispatcher_->dispatch([wp]() {
+    auto service = wp.lock();
+    if (!service)
+      return;
+
+    std::lock_guard<std::mutex> l(service->standby_lock_);
+    if (service->session_connected_ || service->standby_ || !service->standby_creds_)
+      return;
+
+    const auto &name = service->instance_.name;
+    const auto &creds = *service->standby_creds_;
+    try {
+      // Android gets the same paths for every standby container so that its
+      // session can ask for exactly what is running.
+      const auto dir = fs::path(SystemConfiguration::instance().standby_dir(name));
+      const auto socket_dir = dir / "sockets";
+      const auto input_device_dir = dir / "input";
+      fs::remove_all(input_device_dir);
+      utils::ensure_paths({socket_dir.string(), input_device_dir.string()});
+      // The session creates its input devices in here.
+      if (::chown(input_device_dir.c_str(), creds.uid(), creds.gid()) != 0)
+        BOOST_THROW_EXCEPTION(std::runtime_error("Failed to hand input device directory to user"));
+
+      std::vector<Fd> sockets;
+      for (const auto &socket : Configuration::session_sockets)
+        sockets.push_back(listen_on((socket_dir / socket).string()));
+
+      // A checkpoint would continue Android with connections to the session
+      // it was taken of.
+      auto container = std::make_shared<LxcContainer>(service->privileged_, creds,
+                                                      service->instance_);
+      container->start(service->standby_configuration());
+
+      service->standby_ = container;
+      service->standby_sockets_ = std::move(sockets);
+      INFO("Standby container of instance %s booted", name);
+    } catch (std::exception &err) {
+      ERROR("Failed to boot standby container of instance %s: %s", name, err.what());
+    }
+  });
+}
+
 void Service::new_client(std::shared_ptr<boost::asio::local::stream_protocol::socket> const
         &socket) {
   if (connections_->size() >= 1) {
@@ -76,11 +283,72 @@ void Service::new_client(std::shared_ptr<boost::asio::local::stream_protocol::so
   DEBUG("Got connection from pid %d", messenger->creds().pid());
 
   auto pending_calls = std::make_shared<rpc::PendingCallCache>();
-  auto rpc_channel = std::make_shared<rpc::Channel>(pending_calls, messenger);
-  auto server = std::make_shared<container::ManagementApiSkeleton>(
-      pending_calls, std::make_shared<LxcContainer>(privileged_, messenger->creds()));
+  auto framing = std::make_shared<rpc::Framing>();
+  auto rpc_channel =
+      std::make_shared<rpc::Channel>(pending_calls, messenger, framing);
+  rpc_channel->send_protocol_version();
+
+  std::shared_ptr<Container> container;
+  bool standby = false;
+  {
+    std::lock_guard<std::mutex> l(standby_lock_);
+    if (standby_creds_) {
+      // A session of another user can't use the standby container but still
+      // needs the instance for itself.
+      container = std::move(standby_);
+      standby_sockets_.clear();
+      if (!is_standby_user(messenger->creds()))
+        container.reset();
+      session_connected_ = true;
+      standby = true;
+    }
+  }
+
+  Configuration detached_configuration;
+  std::shared_ptr<Container> dropped;
+  bool reattachable = false;
+  if (!standby) {
+    std::lock_guard<std::mutex> l(detached_lock_);
+    reattachable = detach_timeout_.count() > 0;
+    detached_timer_.cancel();
+    // Another user never gets what a session of someone else left running.
+    if (detached_ && session_creds_->uid() == messenger->creds().uid() &&
+        session_creds_->gid() == messenger->creds().gid()) {
+      container = std::move(detached_);
+      detached_configuration = detached_configuration_;
+    } else {
+      dropped = std::move(detached_);
+      parked_sockets_.clear();
+    }
+    detached_.reset();
+    session_creds_.reset(new network::Credentials(messenger->creds()));
+  }
+  dropped.reset();
+
+  if (!container)
+    container = std::make_shared<LxcContainer>(privileged_, messenger->creds(), instance_,
+                                               checkpoints_);
+  if (reattachable) {
+    auto wp = std::weak_ptr<Service>(shared_from_this());
+    container = std::make_shared<ReattachableContainer>(
+        container, detached_configuration,
+        [wp](const std::shared_ptr<Container> &container, const Configuration &configuration) {
+          if (auto service = wp.lock())
+            service->session_detached(container, configuration);
+        });
+  }
+  if (standby) {
+    auto wp = std::weak_ptr<Service>(shared_from_this());
+    container = std::make_shared<StandbyContainer>(container, standby_configuration(), [wp]() {
+      if (auto service = wp.lock())
+        service->session_gone();
+    });
+  }
+
+  auto server = std::make_shared<container::ManagementApiSkeleton>(pending_calls, container, resources_,
+                                                                   network_, binder_device_.path());
   auto processor = std::make_shared<container::ManagementApiMessageProcessor>(
-      messenger, pending_calls, server);
+      messenger, pending_calls, server, framing);
 
   auto const &connection = std::make_shared<network::SocketConnection>(
       messenger, messenger, next_id(), connections_, processor);
@@ -19,25 +19,80 @@
 #define ANBOX_CONTAINER_SERVICE_H_
 
 #include "anbox/common/dispatcher.h"
+#include "anbox/common/fd.h"
+#include "anbox/container/binder_device.h"
 #include "anbox/container/container.h"
+#include "anbox/container/instance.h"
+#include "anbox/container/network_settings.h"
+#include "anbox/container/resource_limits.h"
 #include "anbox/network/connections.h"
 #include "anbox/network/credentials.h"
 #include "anbox/network/published_socket_connector.h"
 #include "anbox/network/socket_connection.h"
 #include "anbox/runtime.h"
 
+#include <boost/asio/deadline_timer.hpp>
+
+#include <chrono>
+#include <mutex>
+
 namespace anbox {
 namespace container {
 class Service : public std::enable_shared_from_this<Service> {
  public:
-  static std::shared_ptr<Service> create(const std::shared_ptr<Runtime> &rt, bool privileged);
+  // Serves the container of |instance| on its own socket. With
+  // |checkpoints| set clients can ask to checkpoint the container. The
+  // container never gets more than |resources| and is connected as
+  // |network| says.
+  static std::shared_ptr<Service> create(const std::shared_ptr<Runtime> &rt, bool privileged,
+                                         const Instance &instance, bool checkpoints = false,
+                                         const ResourceLimits &resources = ResourceLimits{},
+                                         const NetworkSettings &network = NetworkSettings{});
 
   ~Service();
 
+  // Keeps the container booted for sessions of |creds| before one connects
+  // and boots it again in the background once a session is gone. Android
+  // connects to sockets we listen on meanwhile, which the session takes
+  // over through take_standby().
+  void keep_standby(const network::Credentials &creds);
+
+  // Hands the sockets of the booted standby container over to a session of
+  // |creds|, in the order of Configuration::session_sockets. Returns false
+  // if there is none for it.
+  bool take_standby(const network::Credentials &creds, std::vector<Fd> &sockets);
+
+  // Keeps the container of a session which goes away without stopping it
+  // running for |timeout|, so that the next session of the same user
+  // continues it instead of booting Android again. Sessions park the
+  // sockets Android is connected to with us through park_sockets() for the
+  // next one to take them over through take_detached(). Doesn't apply to
+  // instances keeping a standby container.
+  void keep_detached(const std::chrono::seconds &timeout);
+
+  // Keeps |sockets| of the session of |creds|, in the order of
+  // Configuration::session_sockets. Returns false if that session isn't
+  // the one running the container.
+  bool park_sockets(const network::Credentials &creds, const std::vector<Fd> &sockets);
+
+  // Hands the sockets of a container a session left running over to the
+  // next session of |creds|. Returns false if there is none for it.
+  bool take_detached(const network::Credentials &creds, std::vector<Fd> &sockets);
+
+  std::string instance_name() const { return instance_.name; }
+
  private:
-  Service(const std::shared_ptr<Runtime> &rt, bool privileged);
+  Service(const std::shared_ptr<Runtime> &rt, bool privileged, const Instance &instance,
+          bool checkpoints, const ResourceLimits &resources, const NetworkSettings &network);
 
   int next_id();
+  void boot_standby();
+  void session_gone();
+  void session_detached(const std::shared_ptr<Container> &container,
+                        const Configuration &configuration);
+  void drop_detached(const boost::system::error_code &err);
+  Configuration standby_configuration() const;
+  bool is_standby_user(const network::Credentials &creds) const;
   void new_client(std::shared_ptr<
                   boost::asio::local::stream_protocol::socket> const &socket);
 
@@ -47,6 +102,25 @@ class Service : public std::enable_shared_from_this<Service> {
   std::shared_ptr<network::Connections<network::SocketConnection>> connections_;
   std::shared_ptr<Container> backend_;
   bool privileged_;
+  Instance instance_;
+  bool checkpoints_;
+  ResourceLimits resources_;
+  NetworkSettings network_;
+  BinderDevice binder_device_;
+
+  std::mutex standby_lock_;
+  std::unique_ptr<network::Credentials> standby_creds_;
+  std::shared_ptr<Container> standby_;
+  std::vector<Fd> standby_sockets_;
+  bool session_connected_;
+
+  std::mutex detached_lock_;
+  std::chrono::seconds detach_timeout_;
+  std::unique_ptr<network::Credentials> session_creds_;
+  std::vector<Fd> parked_sockets_;
+  std::shared_ptr<Container> detached_;
+  Configuration detached_configuration_;
+  boost::asio::deadline_timer detached_timer_;
 };
 }  // namespace container
 }  // namespace anbox
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/container/standby_container.h"
+#include "anbox/logger.h"
+
+namespace anbox {
+namespace container {
+StandbyContainer::StandbyContainer(const std::shared_ptr<Container> &container,
+                                   const Configuration &configuration,
+                                   const std::function<void()> &released)
+    : container_(container), configuration_(configuration), released_(released),
+      started_(false) {}
+
+StandbyContainer::~StandbyContainer() {
+  // The container has to be stopped before anybody boots the next one.
+  container_.reset();
+  if (released_)
+    released_();
+}
+
+void StandbyContainer::start(const Configuration &configuration) {
+  if (!started_ && container_->state() == State::running &&
+      configuration.bind_mounts == configuration_.bind_mounts) {
+    DEBUG("Handing over standby container");
+    started_ = true;
+    return;
+  }
+
+  container_->start(configuration);
+  started_ = true;
+}
+
+void StandbyContainer::stop() { container_->stop(); }
+
+void StandbyContainer::kill() { container_->kill(); }
+
+void StandbyContainer::checkpoint() { container_->checkpoint(); }
+
+bool StandbyContainer::restored() { return started_ && container_->restored(); }
+
+Container::State StandbyContainer::state() {
+  if (!started_)
+    return State::inactive;
+  return container_->state();
+}
+}  // namespace container
+}  // namespace anbox
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_CONTAINER_STANDBY_CONTAINER_H_
+#define ANBOX_CONTAINER_STANDBY_CONTAINER_H_
+
+#include "anbox/container/container.h"
+
+#include <functional>
+#include <memory>
+
+namespace anbox {
+namespace container {
+// Hands a container which was booted before its session connected over to
+// that session. It looks stopped to the session until it gets started with
+// the configuration it was booted with, which leaves it running as it is.
+// Any other configuration restarts it with that one.
+class StandbyContainer : public Container {
+ public:
+  // |released| is called once the session is done with |container| and it
+  // is gone.
+  StandbyContainer(const std::shared_ptr<Container> &container,
+                   const Configuration &configuration,
+                   const std::function<void()> &released);
+  ~StandbyContainer();
+
+  void start(const Configuration &configuration) override;
+  void stop() override;
+  void kill() override;
+  void checkpoint() override;
+  bool restored() override;
+  State state() override;
+
+ private:
+  std::shared_ptr<Container> container_;
+  Configuration configuration_;
+  std::function<void()> released_;
+  bool started_;
+};
+}  // namespace container
+}  // namespace anbox
+
+#endif
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/container/standby_pool.h"
+#include "anbox/config.h"
+#include "anbox/logger.h"
+#include "anbox/network/delegate_connection_creator.h"
+#include "anbox/network/fd_channel.h"
+#include "anbox/network/local_socket_messenger.h"
+
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace {
+// Instance names are much shorter, see Instance::is_valid_name.
+constexpr std::size_t max_instance_name_size{64};
+}  // namespace
+
+namespace anbox {
+namespace container {
+std::shared_ptr<StandbyPool> StandbyPool::create(
+    const std::shared_ptr<Runtime> &rt, const std::vector<std::shared_ptr<Service>> &services) {
+  auto sp = std::shared_ptr<StandbyPool>(new StandbyPool(services));
+
+  auto wp = std::weak_ptr<StandbyPool>(sp);
+  auto delegate_connector = std::make_shared<network::DelegateConnectionCreator<boost::asio::local::stream_protocol>>(
+      [wp](std::shared_ptr<boost::asio::local::stream_protocol::socket> const &socket) {
+        if (auto pool = wp.lock())
+          pool->new_client(socket);
+  });
+
+  const auto socket_path = SystemConfiguration::instance().standby_socket_path();
+  sp->connector_ = std::make_shared<network::PublishedSocketConnector>(socket_path, rt, delegate_connector);
+  ::chmod(socket_path.c_str(), S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
+
+  for (const auto &service : services)
+    DEBUG("Keeping standby container of instance %s", service->instance_name());
+
+  return sp;
+}
+
+StandbyPool::StandbyPool(const std::vector<std::shared_ptr<Service>> &services)
+    : services_(services) {}
+
+void StandbyPool::new_client(
+    std::shared_ptr<boost::asio::local::stream_protocol::socket> const &socket) {
+  try {
+    const auto creds = network::LocalSocketMessenger(socket).creds();
+
+    for (const auto &service : services_) {
+      std::vector<Fd> sockets;
+      if (!service->take_standby(creds, sockets))
+        continue;
+
+      INFO("Handing standby container of instance %s over to pid %d",
+           service->instance_name(), creds.pid());
+
+      // The sockets go over together with the instance they belong to.
+      network::FdChannel channel{Fd{::dup(socket->native_handle())}};
+      channel.send(service->instance_name(), sockets);
+      break;
+    }
+  } catch (std::exception &err) {
+    WARNING("Failed to hand over standby container: %s", err.what());
+  }
+
+  boost::system::error_code err;
+  socket->close(err);
+}
+
+bool StandbyPool::take_over(Standby &standby) {
+  const auto path = SystemConfiguration::instance().standby_socket_path();
+
+  Fd socket{::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)};
+  sockaddr_un addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+  if (socket < 0 || ::connect(socket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+    DEBUG("Container manager keeps no standby containers: %s", std::strerror(errno));
+    return false;
+  }
+
+  std::vector<Fd> sockets;
+  std::string instance;
+  try {
+    network::FdChannel{socket}.receive(instance, sockets);
+  } catch (std::exception &err) {
+    // That's also how the container manager tells us it has nothing for us.
+    DEBUG("Didn't get a standby container: %s", err.what());
+    return false;
+  }
+
+  if (instance.empty() || instance.size() > max_instance_name_size) {
+    WARNING("Container manager didn't tell which standby container we got");
+    return false;
+  }
+  if (sockets.size() != Configuration::session_sockets.size()) {
+    WARNING("Container manager handed over %d instead of %d sockets", sockets.size(),
+            Configuration::session_sockets.size());
+    return false;
+  }
+
+  standby.instance = instance;
+  standby.sockets.clear();
+  for (std::size_t n = 0; n < sockets.size(); n++)
+    standby.sockets.insert({Configuration::session_sockets[n], sockets[n]});
+  return true;
+}
+}  // namespace container
+}  // namespace anbox
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_CONTAINER_STANDBY_POOL_H_
+#define ANBOX_CONTAINER_STANDBY_POOL_H_
+
+#include "anbox/common/fd.h"
+#include "anbox/container/service.h"
+#include "anbox/network/published_socket_connector.h"
+#include "anbox/runtime.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace anbox {
+namespace container {
+// Hands the standby containers of several instances over to sessions
+// through a socket of its own. A session connecting to it gets the name of
+// the instance and the listening sockets Android of a booted standby
+// container already connected to, or gets disconnected right away if
+// there's none for its user.
+class StandbyPool : public std::enable_shared_from_this<StandbyPool> {
+ public:
+  struct Standby {
+    std::string instance;
+    // Listening sockets by the name of their file.
+    std::map<std::string, Fd> sockets;
+  };
+
+  static std::shared_ptr<StandbyPool> create(const std::shared_ptr<Runtime> &rt,
+                                             const std::vector<std::shared_ptr<Service>> &services);
+
+  // Takes over a standby container for the calling process. Returns false
+  // if the container manager has none for it.
+  static bool take_over(Standby &standby);
+
+ private:
+  explicit StandbyPool(const std::vector<std::shared_ptr<Service>> &services);
+
+  void new_client(std::shared_ptr<boost::asio::local::stream_protocol::socket> const &socket);
+
+  std::shared_ptr<network::PublishedSocketConnector> connector_;
+  std::vector<std::shared_ptr<Service>> services_;
+};
+}  // namespace container
+}  // namespace anbox
+
+#endif
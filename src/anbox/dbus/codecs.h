@@ -18,6 +18,9 @@
 #ifndef ANBOX_DBUS_CODECS_H_
 #define ANBOX_DBUS_CODECS_H_
 
+#include "anbox/android/intent.h"
+#include "anbox/dbus/interface.h"
+#include "anbox/graphics/rect.h"
 #include "anbox/wm/stack.h"
 
 #include <core/dbus/codec.h>
@@ -44,4 +47,34 @@ struct Codec<anbox::wm::Stack::Id> {
 } // namespace dbus
 } // namespace core
 
+namespace anbox {
+namespace dbus {
+inline interface::ApplicationManager::LaunchRequest encode_launch_request(
+    const android::Intent &intent, const graphics::Rect &launch_bounds, const wm::Stack::Id &stack) {
+  std::stringstream ss;
+  ss << stack;
+  return std::make_tuple(intent.action, intent.uri, intent.type, std::int32_t{intent.flags},
+                         intent.package, intent.component, launch_bounds.left(),
+                         launch_bounds.top(), launch_bounds.right(), launch_bounds.bottom(),
+                         ss.str());
+}
+
+inline void decode_launch_request(const interface::ApplicationManager::LaunchRequest &request,
+                                  android::Intent &intent, graphics::Rect &launch_bounds,
+                                  wm::Stack::Id &stack) {
+  intent.action = std::get<0>(request);
+  intent.uri = std::get<1>(request);
+  intent.type = std::get<2>(request);
+  intent.flags = std::get<3>(request);
+  intent.package = std::get<4>(request);
+  intent.component = std::get<5>(request);
+  launch_bounds = graphics::Rect{std::get<6>(request), std::get<7>(request),
+                                 std::get<8>(request), std::get<9>(request)};
+  stack = wm::Stack::Id::Default;
+  std::stringstream ss{std::get<10>(request)};
+  ss >> stack;
+}
+}  // namespace dbus
+}  // namespace anbox
+
 #endif
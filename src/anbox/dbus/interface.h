@@ -22,7 +22,10 @@
 #include <core/dbus/property.h>
 
 #include <chrono>
+#include <cstdint>
 #include <string>
+#include <tuple>
+#include <vector>
 
 namespace anbox {
 namespace dbus {
@@ -33,19 +36,43 @@ struct Service {
 };
 struct ApplicationManager {
   static inline std::string name() { return "org.anbox.ApplicationManager"; }
+
+  // A single launch within LaunchBatch: action, uri, type, flags, package,
+  // component, the launch bounds (left, top, right, bottom) and the stack.
+  typedef std::tuple<std::string, std::string, std::string, std::int32_t,
+                     std::string, std::string, std::int32_t, std::int32_t,
+                     std::int32_t, std::int32_t, std::string> LaunchRequest;
+
   struct Methods {
+    // Replies once Android started the activity, which can take a while
+    // when it has to spin up the process for it first.
     struct Launch {
       static inline std::string name() { return "Launch"; }
       typedef anbox::dbus::interface::ApplicationManager Interface;
       typedef void ResultType;
       static inline std::chrono::milliseconds default_timeout() {
-        return std::chrono::seconds{1};
+        return std::chrono::seconds{15};
+      }
+    };
+    // Starts all activities at once and replies when the last one was
+    // started, with an error message per launch which is empty on success.
+    struct LaunchBatch {
+      static inline std::string name() { return "LaunchBatch"; }
+      typedef anbox::dbus::interface::ApplicationManager Interface;
+      typedef std::vector<std::string> ResultType;
+      static inline std::chrono::milliseconds default_timeout() {
+        return std::chrono::seconds{30};
       }
     };
   };
   struct Properties {
     DBUS_CPP_READABLE_PROPERTY_DEF(Ready, ApplicationManager, bool)
   };
+  struct Signals {
+    // Carries the new value of Ready so clients can wait for Android to
+    // boot without polling the property.
+    DBUS_CPP_SIGNAL_DEF(ReadyChanged, ApplicationManager, bool)
+  };
 };
 }  // namespace interface
 }  // namespace dbus
@@ -23,6 +23,8 @@
 
 #include <core/property.h>
 
+#include <mutex>
+
 namespace anbox {
 namespace dbus {
 namespace skeleton {
@@ -31,7 +33,8 @@ ApplicationManager::ApplicationManager(
     const std::shared_ptr<anbox::application::Manager> &impl)
     : bus_(bus), object_(object), impl_(impl),
       properties_{ object_->get_property<anbox::dbus::interface::ApplicationManager::Properties::Ready>() },
-      signals_{ object_->get_signal<core::dbus::interfaces::Properties::Signals::PropertiesChanged>() } {
+      signals_{ object_->get_signal<core::dbus::interfaces::Properties::Signals::PropertiesChanged>(),
+                object_->get_signal<anbox::dbus::interface::ApplicationManager::Signals::ReadyChanged>() } {
 
   object_->install_method_handler<anbox::dbus::interface::ApplicationManager::Methods::Launch>(
       [this](const core::dbus::Message::Ptr &msg) {
@@ -55,17 +58,65 @@ ApplicationManager::ApplicationManager(
         wm::Stack::Id stack = wm::Stack::Id::Default;
         reader >> stack;
 
-        core::dbus::Message::Ptr reply;
+        // Android answers on its own thread, the reply is sent from there
+        // so that the bus isn't blocked while the application starts.
+        auto bus = bus_;
+        impl_->launch_async(intent, launch_bounds, stack, [bus, msg](const std::string &error) {
+          core::dbus::Message::Ptr reply;
+          if (error.empty())
+            reply = core::dbus::Message::make_method_return(msg);
+          else
+            reply = core::dbus::Message::make_error(msg, "org.anbox.Error.Failed", error);
+          bus->send(reply);
+        });
+      });
 
-        try {
-          launch(intent, launch_bounds, stack);
-          reply = core::dbus::Message::make_method_return(msg);
-        } catch (std::exception const &err) {
-          reply = core::dbus::Message::make_error(msg, "org.anbox.Error.Failed",
-                                                  err.what());
+  object_->install_method_handler<anbox::dbus::interface::ApplicationManager::Methods::LaunchBatch>(
+      [this](const core::dbus::Message::Ptr &msg) {
+        std::vector<anbox::dbus::interface::ApplicationManager::LaunchRequest> requests;
+        auto reader = msg->reader();
+        reader >> requests;
+
+        // All launches go to Android at once so a script starting several
+        // applications doesn't wait for each of them in turn.
+        struct Batch {
+          std::mutex lock;
+          std::vector<std::string> errors;
+          std::size_t pending;
+        };
+        auto batch = std::make_shared<Batch>();
+        batch->errors.resize(requests.size());
+        batch->pending = requests.size();
+
+        auto bus = bus_;
+        const auto reply = [bus, msg, batch]() {
+          auto reply = core::dbus::Message::make_method_return(msg);
+          reply->writer() << batch->errors;
+          bus->send(reply);
+        };
+
+        if (requests.empty()) {
+          reply();
+          return;
         }
 
-        bus_->send(reply);
+        for (std::size_t n = 0; n < requests.size(); n++) {
+          android::Intent intent;
+          graphics::Rect launch_bounds;
+          wm::Stack::Id stack;
+          decode_launch_request(requests[n], intent, launch_bounds, stack);
+
+          impl_->launch_async(intent, launch_bounds, stack, [batch, n, reply](const std::string &error) {
+            bool done = false;
+            {
+              std::lock_guard<std::mutex> l(batch->lock);
+              batch->errors[n] = error;
+              done = --batch->pending == 0;
+            }
+            if (done)
+              reply();
+          });
+        }
       });
 
   // Forward AndroidApi status to our dbus property
@@ -73,6 +124,7 @@ ApplicationManager::ApplicationManager(
   impl_->ready().changed().connect([&](bool value) {
     properties_.ready->set(value);
     on_property_value_changed<anbox::dbus::interface::ApplicationManager::Properties::Ready>(value);
+    signals_.ready_changed->emit(value);
   });
 }
 
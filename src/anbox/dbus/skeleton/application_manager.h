@@ -57,6 +57,8 @@ class ApplicationManager : public anbox::application::Manager {
   struct {
     core::dbus::Signal<core::dbus::interfaces::Properties::Signals::PropertiesChanged,
                        core::dbus::interfaces::Properties::Signals::PropertiesChanged::ArgumentType>::Ptr properties_changed;
+    core::dbus::Signal<anbox::dbus::interface::ApplicationManager::Signals::ReadyChanged,
+                       anbox::dbus::interface::ApplicationManager::Signals::ReadyChanged::ArgumentType>::Ptr ready_changed;
   } signals_;
 };
 }  // namespace skeleton
@@ -33,11 +33,13 @@ ApplicationManager::ApplicationManager(const core::dbus::Bus::Ptr &bus,
                                        const core::dbus::Service::Ptr &service,
                                        const core::dbus::Object::Ptr &object)
     : bus_(bus), service_(service), object_(object),
-      properties_{ object_->get_property<anbox::dbus::interface::ApplicationManager::Properties::Ready>() } {
+      properties_{ object_->get_property<anbox::dbus::interface::ApplicationManager::Properties::Ready>() },
+      signals_{ object_->get_signal<anbox::dbus::interface::ApplicationManager::Signals::ReadyChanged>() } {
 
   // Forward changes on the dbus property to our users
   ready_.install([&]() { return properties_.ready->get(); });
   properties_.ready->changed().connect([&](bool value) { ready_.set(value); });
+  signals_.ready_changed->connect([&](const bool &value) { ready_.set(value); });
 }
 
 ApplicationManager::~ApplicationManager() {}
@@ -55,6 +57,19 @@ void ApplicationManager::launch(const android::Intent &intent,
   if (result.is_error()) throw std::runtime_error(result.error().print());
 }
 
+std::vector<std::string> ApplicationManager::launch_batch(const std::vector<LaunchRequest> &requests) {
+  std::vector<anbox::dbus::interface::ApplicationManager::LaunchRequest> encoded;
+  for (const auto &r : requests)
+    encoded.push_back(encode_launch_request(r.intent, r.launch_bounds, r.stack));
+
+  auto result = object_->invoke_method_synchronously<
+      anbox::dbus::interface::ApplicationManager::Methods::LaunchBatch,
+      anbox::dbus::interface::ApplicationManager::Methods::LaunchBatch::ResultType>(encoded);
+
+  if (result.is_error()) throw std::runtime_error(result.error().print());
+  return result.value();
+}
+
 core::Property<bool>& ApplicationManager::ready() {
   return ready_;
 }
@@ -43,6 +43,16 @@ class ApplicationManager : public anbox::application::Manager {
               const graphics::Rect &launch_bounds = graphics::Rect::Invalid,
               const wm::Stack::Id &stack = wm::Stack::Id::Default) override;
 
+  struct LaunchRequest {
+    android::Intent intent;
+    graphics::Rect launch_bounds = graphics::Rect::Invalid;
+    wm::Stack::Id stack = wm::Stack::Id::Default;
+  };
+
+  // Launches all of |requests| at once and returns an error message for
+  // each of them which is empty when the launch succeeded.
+  std::vector<std::string> launch_batch(const std::vector<LaunchRequest> &requests);
+
   core::Property<bool>& ready() override;
 
  private:
@@ -53,6 +63,10 @@ class ApplicationManager : public anbox::application::Manager {
   struct {
     std::shared_ptr<core::dbus::Property<anbox::dbus::interface::ApplicationManager::Properties::Ready>> ready;
   } properties_;
+  struct {
+    core::dbus::Signal<anbox::dbus::interface::ApplicationManager::Signals::ReadyChanged,
+                       anbox::dbus::interface::ApplicationManager::Signals::ReadyChanged::ArgumentType>::Ptr ready_changed;
+  } signals_;
 };
 }  // namespace stub
 }  // namespace dbus
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "anbox/graphics/adaptive_resolution.h"
+#include "anbox/logger.h"
+
+#include <algorithm>
+
+namespace anbox {
+namespace graphics {
+constexpr std::uint64_t AdaptiveResolution::period_frames;
+constexpr float AdaptiveResolution::min_scale;
+constexpr float AdaptiveResolution::scale_step;
+constexpr unsigned int AdaptiveResolution::overloaded_periods;
+constexpr unsigned int AdaptiveResolution::min_relaxed_periods;
+constexpr unsigned int AdaptiveResolution::max_relaxed_periods;
+
+AdaptiveResolution::AdaptiveResolution(const ScaleChanged &scale_changed)
+    : scale_changed_(scale_changed),
+      scale_(1.0f),
+      frames_(0),
+      late_frames_(0),
+      overloaded_(0),
+      relaxed_(0),
+      relaxed_periods_(min_relaxed_periods),
+      raised_(false) {}
+
+void AdaptiveResolution::frame_presented(bool late) {
+  float scale;
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    frames_++;
+    if (late)
+      late_frames_++;
+    if (frames_ < period_frames)
+      return;
+
+    const auto previous = scale_;
+    end_period();
+    if (scale_ == previous)
+      return;
+    scale = scale_;
+  }
+
+  INFO("Rendering at %d%% of the display resolution", static_cast<int>(scale * 100.0f + 0.5f));
+  if (scale_changed_)
+    scale_changed_(scale);
+}
+
+void AdaptiveResolution::end_period() {
+  // Same threshold as for presenting through a mailbox, see AppProfiles.
+  const auto overloaded = late_frames_ * 4 > frames_;
+  const auto relaxed = late_frames_ == 0;
+  frames_ = 0;
+  late_frames_ = 0;
+
+  if (overloaded) {
+    relaxed_ = 0;
+    if (++overloaded_ < overloaded_periods || scale_ <= min_scale)
+      return;
+    overloaded_ = 0;
+    if (raised_)
+      relaxed_periods_ = std::min(relaxed_periods_ * 2, max_relaxed_periods);
+    scale_ = std::max(min_scale, scale_ - scale_step);
+    raised_ = false;
+    return;
+  }
+
+  overloaded_ = 0;
+  if (!relaxed) {
+    relaxed_ = 0;
+    return;
+  }
+  if (++relaxed_ < relaxed_periods_)
+    return;
+  relaxed_ = 0;
+  // The last raise held for as long as we waited for it.
+  if (raised_) {
+    relaxed_periods_ = std::max(relaxed_periods_ / 2, min_relaxed_periods);
+    raised_ = false;
+  }
+  if (scale_ >= 1.0f)
+    return;
+  scale_ = std::min(1.0f, scale_ + scale_step);
+  raised_ = true;
+}
+
+float AdaptiveResolution::scale() const {
+  std::lock_guard<std::mutex> l(lock_);
+  return scale_;
+}
+}  // namespace graphics
+}  // namespace anbox
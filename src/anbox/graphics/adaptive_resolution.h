@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef ANBOX_GRAPHICS_ADAPTIVE_RESOLUTION_H_
+#define ANBOX_GRAPHICS_ADAPTIVE_RESOLUTION_H_
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+namespace anbox {
+namespace graphics {
+// Picks the fraction of the display resolution Android renders at from how
+// many of the presented frames miss the vsync, see FrameStatistics. When
+// the GPU can't keep up the resolution is lowered step by step and raised
+// again once frames make it in time. The compositor scales whatever
+// Android renders to the window, so only the sharpness changes.
+//
+// Frames are judged in periods of period_frames. A resolution which didn't
+// hold when it was raised is kept longer before it is tried again, so the
+// resolution doesn't keep going up and down with a load right at the edge.
+class AdaptiveResolution {
+ public:
+  static constexpr std::uint64_t period_frames{120};
+  static constexpr float min_scale{0.5f};
+  static constexpr float scale_step{0.125f};
+  // Periods in a row with too many late frames before the resolution is
+  // lowered.
+  static constexpr unsigned int overloaded_periods{2};
+  // Periods in a row without late frames before the resolution is raised,
+  // doubled each time raising it didn't hold.
+  static constexpr unsigned int min_relaxed_periods{4};
+  static constexpr unsigned int max_relaxed_periods{64};
+
+  // Called with the new scale whenever it changes, from whoever presents
+  // the frames.
+  typedef std::function<void(float scale)> ScaleChanged;
+
+  explicit AdaptiveResolution(const ScaleChanged &scale_changed);
+
+  void frame_presented(bool late);
+
+  float scale() const;
+
+ private:
+  void end_period();
+
+  const ScaleChanged scale_changed_;
+  mutable std::mutex lock_;
+  float scale_;
+  std::uint64_t frames_;
+  std::uint64_t late_frames_;
+  unsigned int overloaded_;
+  unsigned int relaxed_;
+  unsigned int relaxed_periods_;
+  // Whether the last change raised the resolution.
+  bool raised_;
+};
+}  // namespace graphics
+}  // namespace anbox
+
+#endif
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/app_profiles.h"
+#include "anbox/logger.h"
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <sstream>
+
+namespace anbox {
+namespace graphics {
+constexpr std::uint64_t AppProfiles::min_frames;
+constexpr std::uint64_t AppProfiles::max_frames;
+
+AppProfiles::AppProfiles(const std::string &path) : path_(path) {
+  if (path_.empty())
+    return;
+
+  std::ifstream in(path_);
+  if (in)
+    read(in);
+}
+
+void AppProfiles::frame_presented(const std::string &package,
+                                  const std::chrono::nanoseconds &compose_time,
+                                  bool late) {
+  if (package.empty())
+    return;
+
+  std::lock_guard<std::mutex> l(lock_);
+  auto &profile = profiles_[package];
+  profile.presented_frames++;
+  if (late)
+    profile.late_frames++;
+  profile.compose_time += std::chrono::duration_cast<std::chrono::microseconds>(compose_time);
+  decay(profile);
+}
+
+void AppProfiles::frame_dropped(const std::string &package) {
+  if (package.empty())
+    return;
+
+  std::lock_guard<std::mutex> l(lock_);
+  profiles_[package].dropped_frames++;
+}
+
+void AppProfiles::decay(Profile &profile) {
+  if (profile.presented_frames < max_frames)
+    return;
+  profile.presented_frames /= 2;
+  profile.dropped_frames /= 2;
+  profile.late_frames /= 2;
+  profile.compose_time /= 2;
+}
+
+AppProfiles::Profile AppProfiles::profile(const std::string &package) const {
+  std::lock_guard<std::mutex> l(lock_);
+  const auto profile = profiles_.find(package);
+  if (profile == profiles_.end())
+    return Profile{};
+  return profile->second;
+}
+
+AppProfiles::Settings AppProfiles::settings_for(const std::string &package) const {
+  const auto p = profile(package);
+
+  Settings settings;
+  if (p.presented_frames < min_frames)
+    return settings;
+
+  // Apps missing the vsync for a good part of their frames get stuck
+  // behind the swap of the previous one as well. Without waiting for the
+  // display they at least present what they have right away.
+  settings.mailbox = p.late_frames * 4 > p.presented_frames;
+  return settings;
+}
+
+bool AppProfiles::save() const {
+  if (path_.empty())
+    return false;
+
+  const auto tmp_path = path_ + ".tmp";
+  {
+    std::ofstream out(tmp_path, std::ios::trunc);
+    write(out);
+    if (!out) {
+      ERROR("Failed to write app profiles to %s", tmp_path);
+      return false;
+    }
+  }
+
+  boost::system::error_code err;
+  boost::filesystem::rename(tmp_path, path_, err);
+  if (err) {
+    ERROR("Failed to write app profiles to %s: %s", path_, err.message());
+    return false;
+  }
+  return true;
+}
+
+void AppProfiles::read(std::istream &in) {
+  std::map<std::string, Profile> profiles;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    std::istringstream fields(line);
+    std::string package;
+    Profile profile;
+    std::uint64_t compose_us = 0;
+    if (!(fields >> package >> profile.presented_frames >> profile.dropped_frames >>
+          profile.late_frames >> compose_us)) {
+      WARNING("Ignoring invalid app profile: %s", line);
+      continue;
+    }
+    profile.compose_time = std::chrono::microseconds{compose_us};
+    decay(profile);
+    profiles[package] = profile;
+  }
+
+  std::lock_guard<std::mutex> l(lock_);
+  profiles_.swap(profiles);
+}
+
+void AppProfiles::write(std::ostream &out) const {
+  std::lock_guard<std::mutex> l(lock_);
+  out << "# package presented_frames dropped_frames late_frames compose_us" << std::endl;
+  for (const auto &p : profiles_) {
+    out << p.first << ' ' << p.second.presented_frames << ' '
+        << p.second.dropped_frames << ' ' << p.second.late_frames << ' '
+        << p.second.compose_time.count() << std::endl;
+  }
+}
+}  // namespace graphics
+}  // namespace anbox
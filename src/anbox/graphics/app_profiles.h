@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_GRAPHICS_APP_PROFILES_H_
+#define ANBOX_GRAPHICS_APP_PROFILES_H_
+
+#include <chrono>
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+namespace anbox {
+namespace graphics {
+// Remembers how the windows of each Android package fared in the
+// compositor across sessions and picks the settings its windows are set
+// up with the next time the package is launched.
+//
+// Profiles are stored as one line per package with the counters of
+// Profile in their declaration order, so they can be looked at and
+// edited with any text editor.
+class AppProfiles {
+ public:
+  struct Profile {
+    std::uint64_t presented_frames = 0;
+    std::uint64_t dropped_frames = 0;
+    // Frames which missed at least one vsync, see FrameStatistics.
+    std::uint64_t late_frames = 0;
+    // Spent on composing and swapping all presented frames.
+    std::chrono::microseconds compose_time{0};
+  };
+
+  struct Settings {
+    // Present through a swap chain so composing the frames of the app
+    // never waits for the vertical blank of the display.
+    bool mailbox = false;
+  };
+
+  // Settings are only derived from profiles with this many frames.
+  static constexpr std::uint64_t min_frames{600};
+  // Profiles are halved once they reach this many frames so they follow
+  // how an app behaves after an update.
+  static constexpr std::uint64_t max_frames{100000};
+
+  explicit AppProfiles(const std::string &path = std::string());
+
+  void frame_presented(const std::string &package,
+                       const std::chrono::nanoseconds &compose_time, bool late);
+  void frame_dropped(const std::string &package);
+
+  Profile profile(const std::string &package) const;
+  Settings settings_for(const std::string &package) const;
+
+  // Atomically replaces the file the profiles were loaded from.
+  bool save() const;
+
+  void read(std::istream &in);
+  void write(std::ostream &out) const;
+
+ private:
+  static void decay(Profile &profile);
+
+  const std::string path_;
+  mutable std::mutex lock_;
+  std::map<std::string, Profile> profiles_;
+};
+}  // namespace graphics
+}  // namespace anbox
+
+#endif
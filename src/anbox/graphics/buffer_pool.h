@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_GRAPHICS_BUFFER_POOL_H_
+#define ANBOX_GRAPHICS_BUFFER_POOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <map>
+#include <tuple>
+
+namespace anbox {
+namespace graphics {
+// Keeps buffers which are not used anymore around so that a later
+// allocation with the same dimensions and format can reuse them instead
+// of creating a new one. Buffers are evicted in least recently released
+// order once the pool holds more than its memory cap.
+//
+// The pool does no locking on its own; callers have to serialize access.
+template <typename Buffer>
+class BufferPool {
+ public:
+  struct Key {
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t format;
+    // Buffers allocated for different uses can differ in their storage.
+    std::uint32_t usage;
+
+    inline bool operator<(const Key &rhs) const {
+      return std::tie(width, height, format, usage) <
+             std::tie(rhs.width, rhs.height, rhs.format, rhs.usage);
+    }
+  };
+
+  struct Statistics {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t evictions = 0;
+    std::size_t buffers = 0;
+    std::size_t bytes = 0;
+  };
+
+  explicit BufferPool(std::size_t max_bytes) : max_bytes_(max_bytes) {}
+
+  // Takes a buffer matching |key| out of the pool. Returns false if
+  // there is none.
+  bool acquire(const Key &key, Buffer &buffer) {
+    auto entry = index_.find(key);
+    if (entry == index_.end()) {
+      stats_.misses++;
+      return false;
+    }
+
+    auto iter = entry->second;
+    buffer = iter->buffer;
+    remove(entry);
+    stats_.hits++;
+    return true;
+  }
+
+  // Hands |buffer| which occupies |bytes| of memory over to the pool.
+  void release(const Key &key, const Buffer &buffer, std::size_t bytes) {
+    // Buffers which alone exceed the cap would be evicted right away.
+    if (bytes > max_bytes_) return;
+
+    entries_.push_front(Entry{key, buffer, bytes});
+    index_.insert({key, entries_.begin()});
+    stats_.buffers++;
+    stats_.bytes += bytes;
+
+    while (stats_.bytes > max_bytes_)
+      evict_oldest();
+  }
+
+  // Evicts the least recently released buffers until at least |bytes| of
+  // memory were freed or the pool is empty.
+  void evict(std::size_t bytes) {
+    const auto target = stats_.bytes > bytes ? stats_.bytes - bytes : 0;
+    while (stats_.bytes > target)
+      evict_oldest();
+  }
+
+  void clear() {
+    entries_.clear();
+    index_.clear();
+    stats_.buffers = 0;
+    stats_.bytes = 0;
+  }
+
+  const Statistics& statistics() const { return stats_; }
+
+ private:
+  struct Entry {
+    Key key;
+    Buffer buffer;
+    std::size_t bytes;
+  };
+  typedef std::list<Entry> EntryList;
+  typedef std::multimap<Key, typename EntryList::iterator> Index;
+
+  void evict_oldest() {
+    auto oldest = std::prev(entries_.end());
+    auto range = index_.equal_range(oldest->key);
+    for (auto entry = range.first; entry != range.second; ++entry) {
+      if (entry->second != oldest) continue;
+      remove(entry);
+      break;
+    }
+    stats_.evictions++;
+  }
+
+  void remove(typename Index::iterator entry) {
+    stats_.buffers--;
+    stats_.bytes -= entry->second->bytes;
+    entries_.erase(entry->second);
+    index_.erase(entry);
+  }
+
+  std::size_t max_bytes_;
+  // Most recently released buffers come first.
+  EntryList entries_;
+  Index index_;
+  Statistics stats_;
+};
+}  // namespace graphics
+}  // namespace anbox
+
+#endif
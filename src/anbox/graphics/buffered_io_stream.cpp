@@ -18,15 +18,23 @@
 #include "anbox/graphics/buffered_io_stream.h"
 #include "anbox/logger.h"
 
+namespace {
+constexpr const size_t max_out_queue_size{16};
+// How long we wait at once for the guest to drain the socket before we
+// check whether we're still wanted.
+constexpr const std::chrono::milliseconds write_wait_timeout{100};
+}
+
 namespace anbox {
 namespace graphics {
 BufferedIOStream::BufferedIOStream(
     const std::shared_ptr<anbox::network::SocketMessenger> &messenger,
-    size_t buffer_size)
+    size_t buffer_size, size_t max_write_batch_size, size_t in_buffer_size)
     : IOStream(buffer_size),
       messenger_(messenger),
-      in_queue_(1024U),
-      out_queue_(16U),
+      in_buffer_(in_buffer_size),
+      out_queue_(max_out_queue_size),
+      max_write_batch_size_(max_write_batch_size),
       worker_thread_(&BufferedIOStream::thread_main, this) {
   write_buffer_.resize_noinit(buffer_size);
 }
@@ -34,104 +42,144 @@ BufferedIOStream::BufferedIOStream(
 BufferedIOStream::~BufferedIOStream() {
   forceStop();
   if (worker_thread_.joinable()) worker_thread_.join();
+
+  DEBUG("Received %llu bytes (%llu decoded in place, %llu copied)",
+        static_cast<unsigned long long>(bytes_copied_ + bytes_in_place_),
+        static_cast<unsigned long long>(bytes_in_place_),
+        static_cast<unsigned long long>(bytes_copied_));
 }
 
 void *BufferedIOStream::allocBuffer(size_t min_size) {
-  std::unique_lock<std::mutex> l(out_lock_);
-  if (write_buffer_.size() < min_size) write_buffer_.resize_noinit(min_size);
+  // Whatever is in there was committed already, so growing doesn't have
+  // to keep it.
+  write_buffer_.clear();
+  write_buffer_.resize_noinit(min_size);
   return write_buffer_.data();
 }
 
 size_t BufferedIOStream::commitBuffer(size_t size) {
-  std::unique_lock<std::mutex> l(out_lock_);
   assert(size <= write_buffer_.size());
   if (write_buffer_.isAllocated()) {
-    write_buffer_.resize(size);
-    out_queue_.push_locked(std::move(write_buffer_), l);
+    // Hands the pool block over without copying.
+    write_buffer_.resize_noinit(size);
+    out_queue_.push(std::move(write_buffer_));
   } else {
-    out_queue_.push_locked(
-        Buffer{write_buffer_.data(), write_buffer_.data() + size}, l);
+    out_queue_.push(Buffer{write_buffer_.data(), write_buffer_.data() + size});
   }
   return size;
 }
 
 const unsigned char *BufferedIOStream::read(void *buf, size_t *inout_len) {
-  std::unique_lock<std::mutex> l(lock_);
-  size_t wanted = *inout_len;
-  size_t count = 0U;
-  auto dst = static_cast<uint8_t *>(buf);
-  while (count < wanted) {
-    if (read_buffer_left_ > 0) {
-      size_t avail = std::min<size_t>(wanted - count, read_buffer_left_);
-      memcpy(dst + count,
-             read_buffer_.data() + (read_buffer_.size() - read_buffer_left_),
-             avail);
-      count += avail;
-      read_buffer_left_ -= avail;
-      continue;
-    }
-
-    bool blocking = (count == 0);
-    auto result = -EIO;
-    if (blocking)
-      result = in_queue_.pop_locked(&read_buffer_, l);
-    else
-      result = in_queue_.try_pop_locked(&read_buffer_);
-
-    if (result == 0) {
-      read_buffer_left_ = read_buffer_.size();
-      continue;
-    }
-
-    if (count > 0) break;
-
+  // We only block until the first byte is available and then return
+  // with whatever we have.
+  const auto count = in_buffer_.read(buf, *inout_len, true);
+  if (count == 0)
     // If we end up here something went wrong and we couldn't read
     // any valid data.
     return nullptr;
-  }
 
+  bytes_copied_ += count;
   *inout_len = count;
   return static_cast<const unsigned char *>(buf);
 }
 
+const unsigned char *BufferedIOStream::peek(size_t *out_len) {
+  return in_buffer_.peek(out_len);
+}
+
+void BufferedIOStream::consume(size_t len) {
+  in_buffer_.consume(len);
+  bytes_in_place_ += len;
+}
+
 void BufferedIOStream::forceStop() {
-  std::lock_guard<std::mutex> l(lock_);
-  in_queue_.close_locked();
-  out_queue_.close_locked();
+  in_buffer_.close();
+  out_queue_.close();
+}
+
+void BufferedIOStream::post_data(const std::uint8_t *data, size_t size) {
+  in_buffer_.write(data, size);
 }
 
 void BufferedIOStream::post_data(Buffer &&data) {
-  std::unique_lock<std::mutex> l(lock_);
-  in_queue_.push_locked(std::move(data), l);
+  post_data(reinterpret_cast<const std::uint8_t *>(data.data()), data.size());
 }
 
 bool BufferedIOStream::needs_data() {
-  std::unique_lock<std::mutex> l(lock_);
-  return !in_queue_.can_pop_locked();
+  return in_buffer_.available() == 0;
 }
 
 void BufferedIOStream::thread_main() {
-  while (true) {
-    std::unique_lock<std::mutex> l(out_lock_);
+  std::vector<Buffer> batch;
+  batch.reserve(max_out_queue_size);
 
+  while (true) {
     Buffer buffer;
-    const auto result = out_queue_.pop_locked(&buffer, l);
-    if (result != 0 && result != -EAGAIN) break;
-
-    auto bytes_left = buffer.size();
-    while (bytes_left > 0) {
-      const auto written = messenger_->send_raw(
-          buffer.data() + (buffer.size() - bytes_left), bytes_left);
-      if (written < 0) {
-        if (errno != EINTR && errno != EAGAIN) {
-          ERROR("Failed to write data: %s", std::strerror(errno));
-          break;
-        }
-        // Socket is busy, lets try again
-      } else
-        bytes_left -= written;
+    if (out_queue_.pop(&buffer) != 0) break;
+
+    // Collect everything else which is already queued up until we hit
+    // our byte budget so that we can submit all of it at once. The render
+    // thread keeps refilling the queue meanwhile, so the number of buffers
+    // has to be limited as well to fit into the iovec of write_batch().
+    auto batch_size = buffer.size();
+    batch.push_back(std::move(buffer));
+    while (batch_size < max_write_batch_size_ &&
+           batch.size() < max_out_queue_size &&
+           out_queue_.try_pop(&buffer) == 0) {
+      batch_size += buffer.size();
+      batch.push_back(std::move(buffer));
+    }
+
+    if (!write_batch(batch)) break;
+
+    batch.clear();
+  }
+}
+
+bool BufferedIOStream::write_batch(std::vector<Buffer> &batch) {
+  struct iovec iov[max_out_queue_size];
+  size_t count = 0;
+  for (auto &buffer : batch) {
+    if (buffer.empty()) continue;
+    iov[count].iov_base = buffer.data();
+    iov[count].iov_len = buffer.size();
+    count++;
+  }
+
+  size_t first = 0;
+  while (first < count) {
+    const auto written = messenger_->send_raw_vectored(&iov[first], count - first);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        ERROR("Failed to write data: %s", std::strerror(errno));
+        return false;
+      }
+      // Socket is full. Sleep until the guest has read some of it rather
+      // than spinning on it. Once we're stopped nobody will wait for the
+      // rest anymore.
+      if (!messenger_->wait_writable(write_wait_timeout) && out_queue_.is_closed()) {
+        WARNING("Dropping replies the guest doesn't read anymore");
+        return false;
+      }
+      continue;
+    }
+
+    // Skip over everything which was written out completely and adjust
+    // the buffer we stopped in.
+    auto bytes_left = static_cast<size_t>(written);
+    while (first < count && bytes_left >= iov[first].iov_len) {
+      bytes_left -= iov[first].iov_len;
+      first++;
+    }
+    if (first < count) {
+      iov[first].iov_base = static_cast<char *>(iov[first].iov_base) + bytes_left;
+      iov[first].iov_len -= bytes_left;
     }
   }
+
+  return true;
 }
 }  // namespace graphics
 }  // namespace anbox
@@ -20,43 +20,69 @@
 
 #include "external/android-emugl/host/include/libOpenglRender/IOStream.h"
 
-#include "anbox/graphics/buffer_queue.h"
+#include "anbox/common/byte_buffer.h"
+#include "anbox/common/lock_free_queue.h"
+#include "anbox/graphics/ring_buffer.h"
 #include "anbox/network/socket_messenger.h"
 
+#include <atomic>
 #include <memory>
 #include <thread>
+#include <vector>
 
 namespace anbox {
 namespace graphics {
+// Most replies of the render thread are a few bytes and stay in-place,
+// larger ones come from the shared block pool.
+using Buffer = anbox::common::ByteBuffer<512>;
+
 class BufferedIOStream : public IOStream {
  public:
   static const size_t default_buffer_size{384};
+  static const size_t default_in_buffer_size{1024 * 1024};
+  static const size_t default_max_write_batch_size{64 * 1024};
 
+  // |max_write_batch_size| limits how many bytes of queued replies the
+  // writer thread collects to submit them with a single system call.
+  // Up to |in_buffer_size| bytes of commands wait for the render thread
+  // before post_data() blocks.
   explicit BufferedIOStream(
       const std::shared_ptr<anbox::network::SocketMessenger> &messenger,
-      size_t buffer_size = default_buffer_size);
+      size_t buffer_size = default_buffer_size,
+      size_t max_write_batch_size = default_max_write_batch_size,
+      size_t in_buffer_size = default_in_buffer_size);
 
   virtual ~BufferedIOStream();
 
   void *allocBuffer(size_t min_size) override;
   size_t commitBuffer(size_t size) override;
   const unsigned char *read(void *buf, size_t *inout_len) override;
+  const unsigned char *peek(size_t *out_len) override;
+  void consume(size_t len) override;
   void forceStop() override;
+  void post_data(const std::uint8_t *data, size_t size);
   void post_data(Buffer &&data);
 
   bool needs_data();
 
+  // Number of incoming bytes which had to be copied out of the stream
+  // versus the ones which got decoded directly from its buffer.
+  std::uint64_t bytes_copied() const { return bytes_copied_; }
+  std::uint64_t bytes_decoded_in_place() const { return bytes_in_place_; }
+
  private:
   void thread_main();
+  bool write_batch(std::vector<Buffer> &batch);
 
   std::shared_ptr<anbox::network::SocketMessenger> messenger_;
-  std::mutex lock_;
-  std::mutex out_lock_;
+  // Only used by the render thread.
   Buffer write_buffer_;
-  Buffer read_buffer_;
-  size_t read_buffer_left_ = 0;
-  BufferQueue in_queue_;
-  BufferQueue out_queue_;
+  RingBuffer in_buffer_;
+  // Replies go from the render thread to our writer thread.
+  common::SpscQueue<Buffer> out_queue_;
+  size_t max_write_batch_size_;
+  std::atomic<std::uint64_t> bytes_copied_{0};
+  std::atomic<std::uint64_t> bytes_in_place_{0};
   std::thread worker_thread_;
 };
 }  // namespace graphics
@@ -0,0 +1,301 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/command_profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+
+#include <unistd.h>
+
+namespace {
+std::uint64_t bucket_upper_bound(std::size_t bucket) {
+  return (std::uint64_t{2} << bucket) - 1;
+}
+
+std::chrono::nanoseconds percentile(const std::uint64_t *buckets,
+                                    std::size_t num_buckets,
+                                    std::uint64_t count, unsigned int percent,
+                                    std::uint64_t max_ns) {
+  // Smallest number of commands which have to be at or below the result.
+  const auto rank = std::max<std::uint64_t>(1, (count * percent + 99) / 100);
+  std::uint64_t seen = 0;
+  for (std::size_t n = 0; n < num_buckets; n++) {
+    seen += buckets[n];
+    if (seen >= rank)
+      return std::chrono::nanoseconds{std::min(bucket_upper_bound(n), max_ns)};
+  }
+  return std::chrono::nanoseconds{max_ns};
+}
+
+void write_microseconds(std::ostream &out, std::int64_t ns) {
+  const auto fill = out.fill('0');
+  out << ns / 1000 << '.' << std::setw(3) << ns % 1000;
+  out.fill(fill);
+}
+}  // namespace
+
+namespace anbox {
+namespace graphics {
+constexpr std::size_t CommandProfiler::num_buckets;
+constexpr std::size_t CommandProfiler::default_trace_capacity;
+constexpr std::size_t CommandProfiler::max_retired_recorders;
+
+CommandProfiler::Recorder::Recorder(const CommandProfiler &profiler,
+                                    std::uint32_t thread_id)
+    : profiler_(profiler),
+      thread_id_(thread_id),
+      counters_(new Counters[profiler.num_opcodes_]()),
+      events_(new Event[profiler.trace_capacity_]()) {}
+
+void CommandProfiler::Recorder::increment(std::atomic<std::uint64_t> &value,
+                                          std::uint64_t by) {
+  // We're the only writer so there is no need for an atomic addition,
+  // the atomics only keep concurrent readers well defined.
+  value.store(value.load(std::memory_order_relaxed) + by,
+              std::memory_order_relaxed);
+}
+
+void CommandProfiler::Recorder::record(std::uint32_t opcode,
+                                       std::uint32_t bytes,
+                                       const Clock::time_point &start,
+                                       const Clock::time_point &end) {
+  std::size_t index = 0;
+  if (!profiler_.index_for_opcode(opcode, index))
+    return;
+
+  const auto elapsed =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  const std::uint64_t ns = elapsed > 0 ? elapsed : 0;
+
+  auto &counters = counters_[index];
+  increment(counters.count, 1);
+  increment(counters.bytes, bytes);
+  increment(counters.total_ns, ns);
+  increment(counters.buckets[bucket_for_duration(ns)], 1);
+  if (ns > counters.max_ns.load(std::memory_order_relaxed))
+    counters.max_ns.store(ns, std::memory_order_relaxed);
+
+  if (profiler_.trace_capacity_ == 0)
+    return;
+
+  const auto n = num_events_.load(std::memory_order_relaxed);
+  auto &event = events_[n % profiler_.trace_capacity_];
+  event.start_ns.store(profiler_.since_start(start), std::memory_order_relaxed);
+  event.duration_ns.store(ns, std::memory_order_relaxed);
+  event.command.store((std::uint64_t{static_cast<std::uint32_t>(index)} << 32) | bytes,
+                      std::memory_order_relaxed);
+  num_events_.store(n + 1, std::memory_order_release);
+}
+
+std::size_t CommandProfiler::bucket_for_duration(std::uint64_t ns) {
+  std::size_t bucket = 0;
+  while (ns > 1 && bucket < num_buckets - 1) {
+    ns >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+CommandProfiler::CommandProfiler(const std::vector<OpcodeRange> &ranges,
+                                 std::size_t trace_capacity)
+    : num_opcodes_(0),
+      trace_capacity_(trace_capacity),
+      start_(Clock::now()),
+      next_thread_id_(1) {
+  for (const auto &range : ranges) {
+    if (range.end <= range.first)
+      continue;
+    ranges_.push_back(IndexedRange{range, num_opcodes_});
+    num_opcodes_ += range.end - range.first;
+  }
+}
+
+bool CommandProfiler::index_for_opcode(std::uint32_t opcode,
+                                       std::size_t &index) const {
+  for (const auto &r : ranges_) {
+    if (opcode >= r.range.first && opcode < r.range.end) {
+      index = r.offset + (opcode - r.range.first);
+      return true;
+    }
+  }
+  return false;
+}
+
+void CommandProfiler::describe(std::size_t index, std::uint32_t &opcode,
+                               std::string &name,
+                               std::string &category) const {
+  for (const auto &r : ranges_) {
+    if (index >= r.offset + (r.range.end - r.range.first))
+      continue;
+
+    opcode = r.range.first + (index - r.offset);
+    category = r.range.category;
+    const char *resolved = r.range.name ? r.range.name(opcode) : nullptr;
+    name = resolved ? resolved : category + "#" + std::to_string(opcode);
+    return;
+  }
+}
+
+std::int64_t CommandProfiler::since_start(const Clock::time_point &time) const {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(time - start_)
+      .count();
+}
+
+std::shared_ptr<CommandProfiler::Recorder> CommandProfiler::register_thread() {
+  std::lock_guard<std::mutex> l(recorders_lock_);
+
+  // Drop the oldest recorders nobody records into anymore so that a guest
+  // reconnecting all the time doesn't let us grow without bounds.
+  std::size_t retired = 0;
+  for (const auto &recorder : recorders_)
+    if (recorder.use_count() == 1) retired++;
+  for (auto it = recorders_.begin();
+       it != recorders_.end() && retired >= max_retired_recorders;) {
+    if (it->use_count() == 1) {
+      it = recorders_.erase(it);
+      retired--;
+    } else {
+      ++it;
+    }
+  }
+
+  auto recorder = std::make_shared<Recorder>(*this, next_thread_id_++);
+  recorders_.push_back(recorder);
+  return recorder;
+}
+
+std::vector<CommandProfiler::Summary> CommandProfiler::summary() const {
+  struct Totals {
+    std::uint64_t count;
+    std::uint64_t bytes;
+    std::uint64_t total_ns;
+    std::uint64_t max_ns;
+    std::uint64_t buckets[num_buckets];
+  };
+  std::vector<Totals> totals(num_opcodes_, Totals());
+
+  {
+    std::lock_guard<std::mutex> l(recorders_lock_);
+    for (const auto &recorder : recorders_) {
+      for (std::size_t n = 0; n < num_opcodes_; n++) {
+        const auto &c = recorder->counters_[n];
+        auto &t = totals[n];
+        t.count += c.count.load(std::memory_order_relaxed);
+        t.bytes += c.bytes.load(std::memory_order_relaxed);
+        t.total_ns += c.total_ns.load(std::memory_order_relaxed);
+        t.max_ns = std::max(t.max_ns, c.max_ns.load(std::memory_order_relaxed));
+        for (std::size_t b = 0; b < num_buckets; b++)
+          t.buckets[b] += c.buckets[b].load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  std::vector<Summary> result;
+  for (std::size_t n = 0; n < num_opcodes_; n++) {
+    const auto &t = totals[n];
+    if (t.count == 0)
+      continue;
+
+    Summary s;
+    describe(n, s.opcode, s.name, s.category);
+    s.count = t.count;
+    s.bytes = t.bytes;
+    s.total = std::chrono::nanoseconds{t.total_ns};
+    s.max = std::chrono::nanoseconds{t.max_ns};
+    s.p50 = percentile(t.buckets, num_buckets, t.count, 50, t.max_ns);
+    s.p99 = percentile(t.buckets, num_buckets, t.count, 99, t.max_ns);
+    result.push_back(s);
+  }
+
+  std::sort(result.begin(), result.end(),
+            [](const Summary &lhs, const Summary &rhs) {
+              if (lhs.total != rhs.total) return lhs.total > rhs.total;
+              return lhs.opcode < rhs.opcode;
+            });
+  return result;
+}
+
+void CommandProfiler::write_summary(std::ostream &out) const {
+  const auto entries = summary();
+
+  out << std::left << std::setw(36) << "command" << std::right
+      << std::setw(12) << "count" << std::setw(14) << "bytes"
+      << std::setw(12) << "total ms" << std::setw(10) << "avg us"
+      << std::setw(10) << "p50 us" << std::setw(10) << "p99 us"
+      << std::setw(10) << "max us" << std::endl;
+
+  for (const auto &s : entries) {
+    const auto us = [](const std::chrono::nanoseconds &ns) {
+      return std::chrono::duration_cast<std::chrono::microseconds>(ns).count();
+    };
+    out << std::left << std::setw(36) << s.name << std::right
+        << std::setw(12) << s.count << std::setw(14) << s.bytes
+        << std::setw(12)
+        << std::chrono::duration_cast<std::chrono::milliseconds>(s.total).count()
+        << std::setw(10) << us(s.total) / static_cast<std::int64_t>(s.count)
+        << std::setw(10) << us(s.p50) << std::setw(10) << us(s.p99)
+        << std::setw(10) << us(s.max) << std::endl;
+  }
+}
+
+void CommandProfiler::write_chrome_trace(std::ostream &out) const {
+  const auto pid = ::getpid();
+
+  out << "{\"traceEvents\":[";
+  bool first = true;
+  const auto separate = [&]() {
+    if (!first) out << ',';
+    first = false;
+    out << '\n';
+  };
+
+  std::lock_guard<std::mutex> l(recorders_lock_);
+  for (const auto &recorder : recorders_) {
+    separate();
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+        << ",\"tid\":" << recorder->thread_id_
+        << ",\"args\":{\"name\":\"RenderThread " << recorder->thread_id_
+        << "\"}}";
+
+    const auto num_events = recorder->num_events_.load(std::memory_order_acquire);
+    const auto begin =
+        num_events > trace_capacity_ ? num_events - trace_capacity_ : 0;
+    for (auto n = begin; n < num_events; n++) {
+      const auto &event = recorder->events_[n % trace_capacity_];
+      const auto command = event.command.load(std::memory_order_relaxed);
+
+      std::uint32_t opcode = 0;
+      std::string name, category;
+      describe(command >> 32, opcode, name, category);
+
+      separate();
+      out << "{\"name\":\"" << name << "\",\"cat\":\"" << category
+          << "\",\"ph\":\"X\",\"ts\":";
+      write_microseconds(out, event.start_ns.load(std::memory_order_relaxed));
+      out << ",\"dur\":";
+      write_microseconds(out, event.duration_ns.load(std::memory_order_relaxed));
+      out << ",\"pid\":" << pid << ",\"tid\":" << recorder->thread_id_
+          << ",\"args\":{\"opcode\":" << opcode
+          << ",\"bytes\":" << (command & 0xffffffff) << "}}";
+    }
+  }
+
+  out << "\n],\"displayTimeUnit\":\"ns\"}" << std::endl;
+}
+}  // namespace graphics
+}  // namespace anbox
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_GRAPHICS_COMMAND_PROFILER_H_
+#define ANBOX_GRAPHICS_COMMAND_PROFILER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace anbox {
+namespace graphics {
+// Collects how often each guest command got decoded, how many bytes it
+// carried and how long its execution took on the host.
+//
+// Every decoding thread records into its own Recorder which it is the only
+// one writing to, so recording needs neither locks nor atomic
+// read-modify-write operations. Readers merge the recorders of all threads
+// they find registered and may see a command or two being added while they
+// do so. Besides the per-command latency histograms each recorder keeps the
+// most recent commands as a ring buffer for the Chrome trace export.
+class CommandProfiler {
+ public:
+  typedef std::chrono::steady_clock Clock;
+  typedef std::function<const char*(std::uint32_t)> NameResolver;
+
+  // A contiguous set of opcodes [first, end) owned by a single decoder.
+  struct OpcodeRange {
+    std::string category;
+    std::uint32_t first;
+    std::uint32_t end;
+    NameResolver name;
+  };
+
+  // Bucket n counts commands taking between 2^n and 2^(n+1) - 1 ns, the
+  // last one everything above.
+  static constexpr std::size_t num_buckets{32};
+  static constexpr std::size_t default_trace_capacity{64 * 1024};
+  // Recorders of threads which are gone are kept around for the next dump
+  // but only up to this number.
+  static constexpr std::size_t max_retired_recorders{16};
+
+  struct Summary {
+    std::uint32_t opcode;
+    std::string name;
+    std::string category;
+    std::uint64_t count;
+    std::uint64_t bytes;
+    std::chrono::nanoseconds total;
+    std::chrono::nanoseconds max;
+    // Upper bounds of the histogram buckets the median and the 99th
+    // percentile fall into.
+    std::chrono::nanoseconds p50;
+    std::chrono::nanoseconds p99;
+  };
+
+  class Recorder {
+   public:
+    Recorder(const CommandProfiler &profiler, std::uint32_t thread_id);
+
+    // Must only be called from the thread owning the recorder. Opcodes
+    // outside of all ranges of the profiler are ignored.
+    void record(std::uint32_t opcode, std::uint32_t bytes,
+                const Clock::time_point &start, const Clock::time_point &end);
+
+   private:
+    friend class CommandProfiler;
+
+    struct Counters {
+      std::atomic<std::uint64_t> count;
+      std::atomic<std::uint64_t> bytes;
+      std::atomic<std::uint64_t> total_ns;
+      std::atomic<std::uint64_t> max_ns;
+      std::atomic<std::uint64_t> buckets[num_buckets];
+    };
+
+    struct Event {
+      std::atomic<std::int64_t> start_ns;
+      std::atomic<std::uint64_t> duration_ns;
+      // Index of the opcode in the upper and size of the command in the
+      // lower 32 bit.
+      std::atomic<std::uint64_t> command;
+    };
+
+    static void increment(std::atomic<std::uint64_t> &value, std::uint64_t by);
+
+    const CommandProfiler &profiler_;
+    const std::uint32_t thread_id_;
+    std::unique_ptr<Counters[]> counters_;
+    std::unique_ptr<Event[]> events_;
+    std::atomic<std::uint64_t> num_events_{0};
+  };
+
+  static std::size_t bucket_for_duration(std::uint64_t ns);
+
+  explicit CommandProfiler(const std::vector<OpcodeRange> &ranges,
+                           std::size_t trace_capacity = default_trace_capacity);
+
+  // Creates the recorder for the calling thread. The profiler keeps a
+  // reference so that the statistics stay available after the thread
+  // released its recorder.
+  std::shared_ptr<Recorder> register_thread();
+
+  // Returns the statistics of all commands which were seen at least once,
+  // most expensive ones in total first.
+  std::vector<Summary> summary() const;
+
+  // Human readable table of summary().
+  void write_summary(std::ostream &out) const;
+
+  // Writes the recent commands of all threads in the Chrome trace event
+  // format which can be loaded by chrome://tracing or Perfetto.
+  void write_chrome_trace(std::ostream &out) const;
+
+ private:
+  // Maps |opcode| to its index in the counters of a recorder or returns
+  // false if no range contains it.
+  bool index_for_opcode(std::uint32_t opcode, std::size_t &index) const;
+  void describe(std::size_t index, std::uint32_t &opcode, std::string &name,
+                std::string &category) const;
+  std::int64_t since_start(const Clock::time_point &time) const;
+
+  struct IndexedRange {
+    OpcodeRange range;
+    std::size_t offset;
+  };
+
+  std::vector<IndexedRange> ranges_;
+  std::size_t num_opcodes_;
+  const std::size_t trace_capacity_;
+  const Clock::time_point start_;
+
+  mutable std::mutex recorders_lock_;
+  std::vector<std::shared_ptr<Recorder>> recorders_;
+  std::uint32_t next_thread_id_;
+};
+}  // namespace graphics
+}  // namespace anbox
+
+#endif
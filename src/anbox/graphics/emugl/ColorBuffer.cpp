@@ -16,16 +16,30 @@
 #include "ColorBuffer.h"
 
 #include "DispatchTables.h"
+#include "PixelStream.h"
 #include "RenderThreadInfo.h"
 #include "TextureDraw.h"
 #include "TextureResize.h"
 
 #include "OpenGLESDispatch/EGLDispatch.h"
 
+#include "anbox/graphics/program_family.h"
 #include "anbox/logger.h"
 
 #include <stdio.h>
 
+#include <string>
+#include <utility>
+
+// Not all EGL headers we build against know about dma-buf imports yet.
+#ifndef EGL_LINUX_DMA_BUF_EXT
+#define EGL_LINUX_DMA_BUF_EXT 0x3270
+#define EGL_LINUX_DRM_FOURCC_EXT 0x3271
+#define EGL_DMA_BUF_PLANE0_FD_EXT 0x3272
+#define EGL_DMA_BUF_PLANE0_OFFSET_EXT 0x3273
+#define EGL_DMA_BUF_PLANE0_PITCH_EXT 0x3274
+#endif
+
 namespace {
 
 // <EGL/egl.h> defines many types as 'void*' while they're really
@@ -80,6 +94,59 @@ bool bindFbo(GLuint* fbo, GLuint tex) {
 
 void unbindFbo() { s_gles2.glBindFramebuffer(GL_FRAMEBUFFER, 0); }
 
+const char kYuvVertexShaderSource[] =
+    "attribute vec2 aPosition;\n"
+
+    "void main() {\n"
+    "  gl_Position = vec4(aPosition, 0, 1);\n"
+    "}\n";
+
+const char kYuvFragmentShaderSource[] =
+    "#ifdef GL_FRAGMENT_PRECISION_HIGH\n"
+    "precision highp float;\n"
+    "#else\n"
+    "precision mediump float;\n"
+    "#endif\n";
+
+const char kYuvConvertShaderSource[] =
+    "void main() {\n"
+    "  gl_FragColor = sampleYuv(gl_FragCoord.xy);\n"
+    "}\n";
+
+const float kYuvVertexData[] = {-1, -1, 3, -1, -1, 3};
+
+struct YuvProgram {
+  GLuint program;
+  GLint aPosition;
+  GLint uPlanes;
+  GLint uPlaneSize;
+  GLint uFrameSize;
+  GLint uStrides;
+  GLint uChroma;
+};
+
+// The family keeps the program once it is built, so looking it up for
+// every frame is cheap. Returns false if it can't be built.
+bool getYuvProgram(anbox::graphics::ProgramFamily& family, YuvProgram* p) {
+  static const std::string fragmentShader =
+      std::string(kYuvFragmentShaderSource) + ColorBuffer::yuvSamplerSource +
+      kYuvConvertShaderSource;
+  try {
+    p->program = family.add_program(kYuvVertexShaderSource,
+                                    fragmentShader.c_str());
+  } catch (const std::exception& err) {
+    ERROR("Failed to create YUV conversion program: %s", err.what());
+    return false;
+  }
+  p->aPosition = s_gles2.glGetAttribLocation(p->program, "aPosition");
+  p->uPlanes = s_gles2.glGetUniformLocation(p->program, "uPlanes");
+  p->uPlaneSize = s_gles2.glGetUniformLocation(p->program, "uPlaneSize");
+  p->uFrameSize = s_gles2.glGetUniformLocation(p->program, "uFrameSize");
+  p->uStrides = s_gles2.glGetUniformLocation(p->program, "uStrides");
+  p->uChroma = s_gles2.glGetUniformLocation(p->program, "uChroma");
+  return true;
+}
+
 // Helper class to use a ColorBuffer::Helper context.
 // Usage is pretty simple:
 //
@@ -116,10 +183,61 @@ class ScopedHelperContext {
 
 }  // namespace
 
+// Reads the planes straight from the luminance texture holding the frame
+// as the guest laid it out, so both layouts share one upload and one
+// shader. Offsets into the frame are turned into texel positions, which
+// needs highp to be exact for frames of more than a few hundred KiB.
+// The planes are filtered bilinearly by hand as the texture can't do it.
+// Colors are converted as BT.601 limited range like the Android camera and
+// software decoders produce them.
+const char* const ColorBuffer::yuvSamplerSource =
+    "uniform sampler2D uPlanes;\n"
+    "uniform vec2 uPlaneSize;\n"
+    "uniform vec2 uFrameSize;\n"
+    "uniform vec2 uStrides;\n"
+    "uniform vec3 uChroma;\n"
+
+    "float yuvFetch(float offset) {\n"
+    "  float row = floor((offset + 0.5) / uPlaneSize.x);\n"
+    "  vec2 pos = vec2(offset - row * uPlaneSize.x, row);\n"
+    "  return texture2D(uPlanes, (pos + 0.5) / uPlaneSize).r;\n"
+    "}\n"
+
+    // |plane| holds the offset of its first sample, its stride and the
+    // distance between two samples of a row.
+    "float yuvTexel(vec2 pos, vec3 plane) {\n"
+    "  return yuvFetch(plane.x + pos.y * plane.y + pos.x * plane.z);\n"
+    "}\n"
+
+    "float yuvBilinear(vec2 pos, vec2 size, vec3 plane) {\n"
+    "  vec2 p = clamp(pos - 0.5, vec2(0.0), size - 1.0);\n"
+    "  vec2 i = floor(p);\n"
+    "  vec2 j = min(i + 1.0, size - 1.0);\n"
+    "  vec2 f = p - i;\n"
+    "  return mix(mix(yuvTexel(i, plane), yuvTexel(vec2(j.x, i.y), plane), f.x),\n"
+    "             mix(yuvTexel(vec2(i.x, j.y), plane), yuvTexel(j, plane), f.x),\n"
+    "             f.y);\n"
+    "}\n"
+
+    "vec4 sampleYuv(vec2 pos) {\n"
+    "  vec2 chromaSize = floor(uFrameSize / 2.0);\n"
+    "  float y = yuvBilinear(pos, uFrameSize, vec3(0.0, uStrides.x, 1.0));\n"
+    "  float v = yuvBilinear(pos / 2.0, chromaSize,\n"
+    "                        vec3(uChroma.x, uStrides.y, uChroma.z));\n"
+    "  float u = yuvBilinear(pos / 2.0, chromaSize,\n"
+    "                        vec3(uChroma.y, uStrides.y, uChroma.z));\n"
+    "  y = 1.164 * (y - 0.0625);\n"
+    "  v -= 0.5;\n"
+    "  u -= 0.5;\n"
+    "  return vec4(y + 1.596 * v, y - 0.813 * v - 0.391 * u, y + 2.018 * u,\n"
+    "              1.0);\n"
+    "}\n";
+
 // static
 ColorBuffer* ColorBuffer::create(EGLDisplay p_display, int p_width,
                                  int p_height, GLenum p_internalFormat,
-                                 bool has_eglimage_texture_2d, Helper* helper) {
+                                 bool has_eglimage_texture_2d, Helper* helper,
+                                 uint32_t usage) {
   GLenum texInternalFormat = 0;
 
   switch (p_internalFormat) {
@@ -134,6 +252,12 @@ ColorBuffer* ColorBuffer::create(EGLDisplay p_display, int p_width,
       texInternalFormat = GL_RGBA;
       break;
 
+    // Stored as it is, GL_EXT_texture_format_BGRA8888 takes it as internal
+    // format as well. Only asked for when the host supports that.
+    case GL_BGRA_EXT:
+      texInternalFormat = GL_BGRA_EXT;
+      break;
+
     default:
       return NULL;
       break;
@@ -145,50 +269,24 @@ ColorBuffer* ColorBuffer::create(EGLDisplay p_display, int p_width,
   }
 
   ColorBuffer* cb = new ColorBuffer(p_display, helper);
-
-  s_gles2.glGenTextures(1, &cb->m_tex);
-  s_gles2.glBindTexture(GL_TEXTURE_2D, cb->m_tex);
-
-  int nComp = (texInternalFormat == GL_RGB ? 3 : 4);
-
-  char* zBuff = static_cast<char*>(::calloc(nComp * p_width * p_height, 1));
-  s_gles2.glTexImage2D(GL_TEXTURE_2D, 0, texInternalFormat, p_width, p_height,
-                       0, texInternalFormat, GL_UNSIGNED_BYTE, zBuff);
-  ::free(zBuff);
-
-  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-  //
-  // create another texture for that colorbuffer for blit
-  //
-  s_gles2.glGenTextures(1, &cb->m_blitTex);
-  s_gles2.glBindTexture(GL_TEXTURE_2D, cb->m_blitTex);
-  s_gles2.glTexImage2D(GL_TEXTURE_2D, 0, texInternalFormat, p_width, p_height,
-                       0, texInternalFormat, GL_UNSIGNED_BYTE, NULL);
-
-  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
   cb->m_width = p_width;
   cb->m_height = p_height;
   cb->m_internalFormat = texInternalFormat;
+  cb->m_usage = usage;
+  cb->m_hasEglImageTexture2d = has_eglimage_texture_2d;
 
-  if (has_eglimage_texture_2d) {
-    cb->m_eglImage = s_egl.eglCreateImageKHR(
-        p_display, s_egl.eglGetCurrentContext(), EGL_GL_TEXTURE_2D_KHR,
-        reinterpret_cast<EGLClientBuffer>(SafePointerFromUInt(cb->m_tex)), NULL);
-
-    cb->m_blitEGLImage = s_egl.eglCreateImageKHR(
-        p_display, s_egl.eglGetCurrentContext(), EGL_GL_TEXTURE_2D_KHR,
-        reinterpret_cast<EGLClientBuffer>(SafePointerFromUInt(cb->m_blitTex)), NULL);
+  // Video frames are kept as the planes they arrive in. The RGBA texture
+  // is only created if something else than the compositor wants them.
+  if (!cb->isYuv()) {
+    cb->createTexture();
   }
 
-  cb->m_resizer = new TextureResize(p_width, p_height);
+  // Only buffers guest contexts render into are ever blitted into. Doing
+  // without the second full size texture for all others keeps buffers the
+  // guest writes with the CPU or the compositor only reads cheap.
+  if (usage & USAGE_RENDER) {
+    cb->createBlitImage();
+  }
 
   return cb;
 }
@@ -196,12 +294,20 @@ ColorBuffer* ColorBuffer::create(EGLDisplay p_display, int p_width,
 ColorBuffer::ColorBuffer(EGLDisplay display, Helper* helper)
     : m_tex(0),
       m_blitTex(0),
+      m_yuvTex(0),
+      m_yuvWidth(0),
+      m_yuvHeight(0),
       m_eglImage(NULL),
       m_blitEGLImage(NULL),
       m_fbo(0),
       m_internalFormat(0),
+      m_usage(0),
+      m_hasEglImageTexture2d(false),
+      m_rgbaStale(false),
+      m_externalStorage(false),
       m_display(display),
-      m_helper(helper) {}
+      m_helper(helper),
+      m_resizer(NULL) {}
 
 ColorBuffer::~ColorBuffer() {
   ScopedHelperContext context(m_helper);
@@ -217,23 +323,93 @@ ColorBuffer::~ColorBuffer() {
     s_gles2.glDeleteFramebuffers(1, &m_fbo);
   }
 
-  GLuint tex[2] = {m_tex, m_blitTex};
-  s_gles2.glDeleteTextures(2, tex);
+  GLuint tex[3] = {m_tex, m_blitTex, m_yuvTex};
+  s_gles2.glDeleteTextures(3, tex);
 
   delete m_resizer;
 }
 
+void ColorBuffer::createTexture() {
+  s_gles2.glGenTextures(1, &m_tex);
+  s_gles2.glBindTexture(GL_TEXTURE_2D, m_tex);
+
+  int nComp = (m_internalFormat == GL_RGB ? 3 : 4);
+
+  char* zBuff = static_cast<char*>(::calloc(nComp * m_width * m_height, 1));
+  s_gles2.glTexImage2D(GL_TEXTURE_2D, 0, m_internalFormat, m_width, m_height,
+                       0, m_internalFormat, GL_UNSIGNED_BYTE, zBuff);
+  ::free(zBuff);
+
+  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+  if (m_hasEglImageTexture2d) {
+    m_eglImage = s_egl.eglCreateImageKHR(
+        m_display, s_egl.eglGetCurrentContext(), EGL_GL_TEXTURE_2D_KHR,
+        reinterpret_cast<EGLClientBuffer>(SafePointerFromUInt(m_tex)), NULL);
+  }
+}
+
+bool ColorBuffer::updateRgba() {
+  if (m_tex && !m_rgbaStale) {
+    return true;
+  }
+
+  ScopedHelperContext context(m_helper);
+  if (!context.isOk()) {
+    return false;
+  }
+
+  if (!m_tex) {
+    createTexture();
+  }
+  if (m_rgbaStale) {
+    convertYuv();
+    m_rgbaStale = false;
+  }
+  return true;
+}
+
+void ColorBuffer::waitForWrites() {
+  if (m_writeFence) m_writeFence->wait();
+}
+
+void ColorBuffer::waitForReads() {
+  if (m_readFence) m_readFence->wait();
+}
+
 void ColorBuffer::readPixels(int x, int y, int width, int height,
                              GLenum p_format, GLenum p_type, void* pixels) {
   ScopedHelperContext context(m_helper);
-  if (!context.isOk()) {
+  if (!context.isOk() || !updateRgba()) {
     return;
   }
 
+  waitForWrites();
+
+  // Without GL_EXT_read_format_bgra the driver hands out RGBA only and we
+  // swap the channels ourselves.
+  const bool swapRedBlue = p_format == GL_BGRA_EXT && !m_helper->canReadBgra();
+  if (swapRedBlue) {
+    p_format = GL_RGBA;
+  }
+
   if (bindFbo(&m_fbo, m_tex)) {
-    s_gles2.glReadPixels(x, y, width, height, p_format, p_type, pixels);
+    PixelStream* stream = m_helper->getPixelStream();
+    if (!stream ||
+        !stream->download(x, y, width, height, p_format, p_type, pixels))
+      s_gles2.glReadPixels(x, y, width, height, p_format, p_type, pixels);
     unbindFbo();
   }
+
+  if (swapRedBlue && p_type == GL_UNSIGNED_BYTE) {
+    unsigned char* p = static_cast<unsigned char*>(pixels);
+    for (int n = 0; n < width * height; n++, p += 4) {
+      std::swap(p[0], p[2]);
+    }
+  }
 }
 
 void ColorBuffer::subUpdate(int x, int y, int width, int height,
@@ -243,10 +419,28 @@ void ColorBuffer::subUpdate(int x, int y, int width, int height,
     return;
   }
 
+  waitForReads();
+
+  if (isYuv() && p_format == GL_LUMINANCE) {
+    updateFromYuv(width, height, pixels);
+    m_writeFence = FenceSync::create();
+    return;
+  }
+
+  if (!updateRgba()) {
+    return;
+  }
   s_gles2.glBindTexture(GL_TEXTURE_2D, m_tex);
-  s_gles2.glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-  s_gles2.glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, p_format,
-                          p_type, pixels);
+
+  PixelStream* stream = m_helper->getPixelStream();
+  if (!stream ||
+      !stream->upload(x, y, width, height, p_format, p_type, pixels)) {
+    s_gles2.glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    s_gles2.glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, p_format,
+                            p_type, pixels);
+  }
+
+  m_writeFence = FenceSync::create();
 }
 
 bool ColorBuffer::blitFromCurrentReadBuffer() {
@@ -256,6 +450,24 @@ bool ColorBuffer::blitFromCurrentReadBuffer() {
     return false;
   }
 
+  // Whatever the guest renders replaces the video frame.
+  m_rgbaStale = false;
+  if (!updateRgba()) {
+    return false;
+  }
+
+  if (tInfo->currContext->isGL2() && m_eglImage &&
+      m_helper->canBlitFramebuffer() && blitIntoTexture()) {
+    return true;
+  }
+
+  if (!m_blitEGLImage && !createBlitImage()) {
+    return false;
+  }
+
+  // The last blit has to be done reading m_blitTex before we replace it.
+  waitForWrites();
+
   // Copy the content of the current read surface into m_blitEGLImage.
   // This is done by creating a temporary texture, bind it to the EGLImage
   // then call glCopyTexSubImage2D().
@@ -280,12 +492,16 @@ bool ColorBuffer::blitFromCurrentReadBuffer() {
     s_gles1.glDeleteTextures(1, &tmpTex);
     s_gles1.glBindTexture(GL_TEXTURE_2D, currTexBind);
   }
+  const auto copied = FenceSync::create();
 
   ScopedHelperContext context(m_helper);
   if (!context.isOk()) {
     return false;
   }
 
+  if (copied) copied->wait();
+  waitForReads();
+
   if (!bindFbo(&m_fbo, m_tex)) {
     return false;
   }
@@ -304,17 +520,97 @@ bool ColorBuffer::blitFromCurrentReadBuffer() {
   s_gles2.glViewport(vport[0], vport[1], vport[2], vport[3]);
   unbindFbo();
 
+  m_writeFence = FenceSync::create();
+
   return true;
 }
 
-bool ColorBuffer::bindToTexture() {
+bool ColorBuffer::createBlitImage() {
+  // Without EGLImages there is nothing the current context could copy into.
   if (!m_eglImage) {
     return false;
   }
+
+  ScopedHelperContext context(m_helper);
+  if (!context.isOk()) {
+    return false;
+  }
+
+  s_gles2.glGenTextures(1, &m_blitTex);
+  s_gles2.glBindTexture(GL_TEXTURE_2D, m_blitTex);
+  s_gles2.glTexImage2D(GL_TEXTURE_2D, 0, m_internalFormat, m_width, m_height,
+                       0, m_internalFormat, GL_UNSIGNED_BYTE, NULL);
+
+  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+  m_blitEGLImage = s_egl.eglCreateImageKHR(
+      m_display, s_egl.eglGetCurrentContext(), EGL_GL_TEXTURE_2D_KHR,
+      reinterpret_cast<EGLClientBuffer>(SafePointerFromUInt(m_blitTex)), NULL);
+  return m_blitEGLImage != NULL;
+}
+
+bool ColorBuffer::blitIntoTexture() {
+  // A multisampled read buffer can only be resolved without flipping it.
+  GLint sampleBuffers = 0;
+  s_gles2.glGetIntegerv(GL_SAMPLE_BUFFERS, &sampleBuffers);
+  if (sampleBuffers > 0) {
+    return false;
+  }
+
+  waitForWrites();
+  waitForReads();
+
+  GLint currTexBind = 0;
+  GLint currDrawFbo = 0;
+  s_gles2.glGetIntegerv(GL_TEXTURE_BINDING_2D, &currTexBind);
+  s_gles2.glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &currDrawFbo);
+
+  // Framebuffer objects aren't shared between contexts, so the guest
+  // context gets a temporary one targeting our EGLImage.
+  GLuint tmpTex = 0;
+  GLuint tmpFbo = 0;
+  s_gles2.glGenTextures(1, &tmpTex);
+  s_gles2.glBindTexture(GL_TEXTURE_2D, tmpTex);
+  s_gles2.glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, m_eglImage);
+  s_gles2.glGenFramebuffers(1, &tmpFbo);
+  s_gles2.glBindFramebuffer(GL_DRAW_FRAMEBUFFER, tmpFbo);
+  s_gles2.glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                 GL_TEXTURE_2D, tmpTex, 0);
+
+  const bool complete = s_gles2.glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) ==
+                        GL_FRAMEBUFFER_COMPLETE;
+  if (complete) {
+    const GLboolean scissor = s_gles2.glIsEnabled(GL_SCISSOR_TEST);
+    if (scissor) s_gles2.glDisable(GL_SCISSOR_TEST);
+
+    // Flip the rows on the way, like the draw in the fallback path does.
+    s_gles2.glBlitFramebuffer(0, 0, m_width, m_height, 0, m_height, m_width, 0,
+                              GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+    if (scissor) s_gles2.glEnable(GL_SCISSOR_TEST);
+  }
+
+  s_gles2.glBindFramebuffer(GL_DRAW_FRAMEBUFFER, currDrawFbo);
+  s_gles2.glDeleteFramebuffers(1, &tmpFbo);
+  s_gles2.glDeleteTextures(1, &tmpTex);
+  s_gles2.glBindTexture(GL_TEXTURE_2D, currTexBind);
+
+  if (complete) m_writeFence = FenceSync::create();
+  return complete;
+}
+
+bool ColorBuffer::bindToTexture() {
+  if (!updateRgba() || !m_eglImage) {
+    return false;
+  }
   RenderThreadInfo* tInfo = RenderThreadInfo::get();
   if (!tInfo->currContext.Ptr()) {
     return false;
   }
+  waitForWrites();
   if (tInfo->currContext->isGL2()) {
     s_gles2.glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, m_eglImage);
   } else {
@@ -324,13 +620,17 @@ bool ColorBuffer::bindToTexture() {
 }
 
 bool ColorBuffer::bindToRenderbuffer() {
-  if (!m_eglImage) {
+  if (!updateRgba() || !m_eglImage) {
     return false;
   }
   RenderThreadInfo* tInfo = RenderThreadInfo::get();
   if (!tInfo->currContext.Ptr()) {
     return false;
   }
+  // The guest renders into the buffer from now on without telling us
+  // when it is done, so we can only keep it from overwriting a frame
+  // still being composed.
+  waitForReads();
   if (tInfo->currContext->isGL2()) {
     s_gles2.glEGLImageTargetRenderbufferStorageOES(GL_RENDERBUFFER_OES,
                                                    m_eglImage);
@@ -343,9 +643,10 @@ bool ColorBuffer::bindToRenderbuffer() {
 
 void ColorBuffer::readback(unsigned char* img) {
   ScopedHelperContext context(m_helper);
-  if (!context.isOk()) {
+  if (!context.isOk() || !updateRgba()) {
     return;
   }
+  waitForWrites();
   if (bindFbo(&m_fbo, m_tex)) {
     s_gles2.glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE,
                          img);
@@ -353,7 +654,171 @@ void ColorBuffer::readback(unsigned char* img) {
   }
 }
 
+bool ColorBuffer::importDmaBuf(int fd, uint32_t fourcc, uint32_t stride) {
+  ScopedHelperContext context(m_helper);
+  if (!context.isOk()) {
+    return false;
+  }
+
+  const EGLint attribs[] = {
+      EGL_WIDTH, static_cast<EGLint>(m_width),
+      EGL_HEIGHT, static_cast<EGLint>(m_height),
+      EGL_LINUX_DRM_FOURCC_EXT, static_cast<EGLint>(fourcc),
+      EGL_DMA_BUF_PLANE0_FD_EXT, fd,
+      EGL_DMA_BUF_PLANE0_OFFSET_EXT, 0,
+      EGL_DMA_BUF_PLANE0_PITCH_EXT, static_cast<EGLint>(stride),
+      EGL_NONE,
+  };
+
+  if (!m_tex) {
+    createTexture();
+  }
+
+  // The driver keeps its own reference to the buffer so |fd| can be
+  // closed by the caller afterwards.
+  EGLImageKHR image = s_egl.eglCreateImageKHR(
+      m_display, EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT, NULL, attribs);
+  if (image == EGL_NO_IMAGE_KHR) {
+    return false;
+  }
+
+  // Re-specify our texture with the imported image. Everything referring
+  // to the texture name (our FBO, the resizer) follows automatically.
+  while (s_gles2.glGetError() != GL_NO_ERROR) {
+  }
+  s_gles2.glBindTexture(GL_TEXTURE_2D, m_tex);
+  s_gles2.glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, image);
+  if (s_gles2.glGetError() != GL_NO_ERROR) {
+    // The texture keeps its previous storage in this case.
+    s_egl.eglDestroyImageKHR(m_display, image);
+    return false;
+  }
+
+  // Guest contexts binding this ColorBuffer have to see the new storage.
+  if (m_eglImage) {
+    s_egl.eglDestroyImageKHR(m_display, m_eglImage);
+  }
+  m_eglImage = image;
+  m_externalStorage = true;
+
+  return true;
+}
+
+void ColorBuffer::getYuvLayout(YuvLayout* layout) const {
+  const bool yv12 = (m_usage & USAGE_YV12) != 0;
+  const GLuint yStride = yv12 ? (m_width + 15) & ~15 : m_width;
+  const GLuint cStride = yv12 ? (yStride / 2 + 15) & ~15 : m_width;
+  const GLuint cHeight = m_height / 2;
+  const GLuint vOffset = yStride * m_height;
+
+  layout->planeSize[0] = yStride;
+  layout->planeSize[1] =
+      (vOffset + (yv12 ? 2 * cStride : cStride) * cHeight + yStride - 1) /
+      yStride;
+  layout->frameSize[0] = m_width;
+  layout->frameSize[1] = m_height;
+  layout->strides[0] = yStride;
+  layout->strides[1] = cStride;
+  layout->chroma[0] = vOffset;
+  layout->chroma[1] = yv12 ? vOffset + cStride * cHeight : vOffset + 1;
+  layout->chroma[2] = yv12 ? 1 : 2;
+}
+
+void ColorBuffer::updateFromYuv(int width, int height, void* pixels) {
+  // The planes have to fit the layout the stride of the Y plane implies.
+  YuvLayout layout;
+  getYuvLayout(&layout);
+  if (width != layout.planeSize[0] || height < layout.planeSize[1]) {
+    ERROR("Invalid %dx%d video frame for %dx%d color buffer", width, height,
+          m_width, m_height);
+    return;
+  }
+
+  if (!m_yuvTex || m_yuvWidth != static_cast<GLuint>(width) ||
+      m_yuvHeight != static_cast<GLuint>(height)) {
+    if (!m_yuvTex) {
+      s_gles2.glGenTextures(1, &m_yuvTex);
+    }
+    s_gles2.glBindTexture(GL_TEXTURE_2D, m_yuvTex);
+    s_gles2.glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, width, height, 0,
+                         GL_LUMINANCE, GL_UNSIGNED_BYTE, NULL);
+    s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    m_yuvWidth = width;
+    m_yuvHeight = height;
+  } else {
+    s_gles2.glBindTexture(GL_TEXTURE_2D, m_yuvTex);
+  }
+
+  PixelStream* stream = m_helper->getPixelStream();
+  if (!stream || !stream->upload(0, 0, width, height, GL_LUMINANCE,
+                                 GL_UNSIGNED_BYTE, pixels)) {
+    s_gles2.glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    s_gles2.glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height,
+                            GL_LUMINANCE, GL_UNSIGNED_BYTE, pixels);
+  }
+
+  // The compositor samples the planes directly. Guest contexts and CPU
+  // reads need RGBA, which is only converted once they ask for it.
+  m_rgbaStale = true;
+}
+
+void ColorBuffer::convertYuv() {
+  YuvProgram yuv;
+  if (!m_yuvTex || !getYuvProgram(m_helper->getProgramFamily(), &yuv)) {
+    return;
+  }
+
+  if (!bindFbo(&m_fbo, m_tex)) {
+    return;
+  }
+
+  GLint vport[4] = {
+      0,
+  };
+  s_gles2.glGetIntegerv(GL_VIEWPORT, vport);
+  s_gles2.glViewport(0, 0, m_width, m_height);
+
+  YuvLayout layout;
+  getYuvLayout(&layout);
+
+  s_gles2.glUseProgram(yuv.program);
+  s_gles2.glActiveTexture(GL_TEXTURE0);
+  s_gles2.glBindTexture(GL_TEXTURE_2D, m_yuvTex);
+  s_gles2.glUniform1i(yuv.uPlanes, 0);
+  s_gles2.glUniform2fv(yuv.uPlaneSize, 1, layout.planeSize);
+  s_gles2.glUniform2fv(yuv.uFrameSize, 1, layout.frameSize);
+  s_gles2.glUniform2fv(yuv.uStrides, 1, layout.strides);
+  s_gles2.glUniform3fv(yuv.uChroma, 1, layout.chroma);
+
+  s_gles2.glBindBuffer(GL_ARRAY_BUFFER, 0);
+  s_gles2.glEnableVertexAttribArray(yuv.aPosition);
+  s_gles2.glVertexAttribPointer(yuv.aPosition, 2, GL_FLOAT, GL_FALSE, 0,
+                                kYuvVertexData);
+  s_gles2.glDrawArrays(GL_TRIANGLES, 0, 3);
+  s_gles2.glDisableVertexAttribArray(yuv.aPosition);
+  s_gles2.glUseProgram(0);
+
+  s_gles2.glViewport(vport[0], vport[1], vport[2], vport[3]);
+  unbindFbo();
+
+  m_writeFence = FenceSync::create();
+}
+
 void ColorBuffer::bind() {
+  // The compositor converts video frames itself, see getYuvLayout().
+  if (isYuv()) {
+    s_gles2.glBindTexture(GL_TEXTURE_2D, m_yuvTex);
+    return;
+  }
+
+  // Only buffers which are composed ever need to be scaled down.
+  if (!m_resizer) {
+    m_resizer = new TextureResize(m_width, m_height,
+                                  m_helper->getProgramFamily());
+  }
   const auto id = m_resizer->update(m_tex);
   s_gles2.glBindTexture(GL_TEXTURE_2D, id);
 }
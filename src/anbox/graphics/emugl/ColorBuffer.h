@@ -19,13 +19,23 @@
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
 #include <GLES/gl.h>
+#include "FenceSync.h"
 #include "emugl/common/smart_ptr.h"
 
 #include <memory>
 
+#include <stdint.h>
+
+class PixelStream;
 class TextureDraw;
 class TextureResize;
 
+namespace anbox {
+namespace graphics {
+class ProgramFamily;
+}  // namespace graphics
+}  // namespace anbox
+
 // A class used to model a guest color buffer, and used to implement several
 // related things:
 //
@@ -65,8 +75,52 @@ class ColorBuffer {
     virtual bool setupContext() = 0;
     virtual void teardownContext() = 0;
     virtual TextureDraw* getTextureDraw() const = 0;
+    // Returns NULL when pixel transfers have to be done synchronously.
+    virtual PixelStream* getPixelStream() const = 0;
+    // Returns true when GLES 2 contexts can use glBlitFramebuffer().
+    virtual bool canBlitFramebuffer() const = 0;
+    // Returns true when glReadPixels() takes GL_BGRA_EXT.
+    virtual bool canReadBgra() const = 0;
+    // Owner of the programs used for drawing and scaling color buffers.
+    virtual anbox::graphics::ProgramFamily& getProgramFamily() const = 0;
+  };
+
+  // What the guest is going to do with a ColorBuffer, derived from the
+  // gralloc usage bits. It decides which storage gets allocated up front.
+  // NOTE: Keep in sync with the guest's gralloc_cb.h.
+  enum Usage : uint32_t {
+    // Guest contexts render into the buffer.
+    USAGE_RENDER = 1 << 0,
+    // Guest contexts sample from the buffer.
+    USAGE_SAMPLE = 1 << 1,
+    USAGE_CPU_WRITE = 1 << 2,
+    USAGE_CPU_READ = 1 << 3,
+    // Video frames the guest writes as YV12 or NV21 planes, see
+    // subUpdate(). These are kept as they are and only converted to RGBA
+    // for whoever can't sample them directly.
+    USAGE_YV12 = 1 << 4,
+    USAGE_NV21 = 1 << 5,
+    // The host composes the buffer.
+    USAGE_COMPOSE = 1 << 6,
+
+    USAGE_ALL = USAGE_RENDER | USAGE_SAMPLE | USAGE_CPU_WRITE |
+                USAGE_CPU_READ | USAGE_COMPOSE,
   };
 
+  // Where the planes of a video frame are found in the texture bind()
+  // binds for them, as uniforms for yuvSamplerSource.
+  struct YuvLayout {
+    GLfloat planeSize[2];
+    GLfloat frameSize[2];
+    GLfloat strides[2];
+    GLfloat chroma[3];
+  };
+
+  // GLSL defining vec4 sampleYuv(vec2 pos), which returns the RGBA color
+  // of a video frame at |pos| given in pixels. Needs the uniforms
+  // uPlanes, uPlaneSize, uFrameSize, uStrides and uChroma, see YuvLayout.
+  static const char* const yuvSamplerSource;
+
   // Create a new ColorBuffer instance.
   // |p_display| is the host EGLDisplay handle.
   // |p_width| and |p_height| are the buffer's dimensions in pixels.
@@ -75,10 +129,13 @@ class ColorBuffer {
   // Implementation is free to use something else though.
   // |has_eglimage_texture_2d| should be true iff the display supports
   // the EGL_KHR_gl_texture_2D_image extension.
+  // |usage| is a combination of Usage bits. Storage only some uses need is
+  // otherwise created once it is needed for the first time.
   // Returns NULL on failure.
   static ColorBuffer* create(EGLDisplay p_display, int p_width, int p_height,
                              GLenum p_internalFormat,
-                             bool has_eglimage_texture_2d, Helper* helper);
+                             bool has_eglimage_texture_2d, Helper* helper,
+                             uint32_t usage = USAGE_ALL);
 
   // Destructor.
   ~ColorBuffer();
@@ -86,12 +143,22 @@ class ColorBuffer {
   // Return ColorBuffer width and height in pixels
   GLuint getWidth() const { return m_width; }
   GLuint getHeight() const { return m_height; }
+  uint32_t getUsage() const { return m_usage; }
+
+  // Returns true if the buffer holds video frames. Binding it for the
+  // compositor binds their planes, to be sampled with yuvSamplerSource.
+  bool isYuv() const { return (m_usage & (USAGE_YV12 | USAGE_NV21)) != 0; }
+  void getYuvLayout(YuvLayout* layout) const;
 
   // Read the ColorBuffer instance's pixel values into host memory.
   void readPixels(int x, int y, int width, int height, GLenum p_format,
                   GLenum p_type, void* pixels);
 
   // Update the ColorBuffer instance's pixel values from host memory.
+  // Buffers created with USAGE_YV12 or USAGE_NV21 also take whole video
+  // frames as GL_LUMINANCE bytes: all planes back to back, |width| being
+  // the stride of the Y plane and |height| the rows needed to hold all
+  // planes. These are kept as they are and converted on the GPU.
   void subUpdate(int x, int y, int width, int height, GLenum p_format,
                  GLenum p_type, void* pixels);
 
@@ -116,23 +183,82 @@ class ColorBuffer {
 
   void bind();
 
+  // Replace the storage of this ColorBuffer with the dma-buf |fd| holding
+  // a ColorBuffer sized image in the DRM |fourcc| format with rows |stride|
+  // bytes apart. The content is then sampled straight from that memory.
+  // Requires EGL_EXT_image_dma_buf_import. Returns false and leaves the
+  // ColorBuffer untouched on failure.
+  bool importDmaBuf(int fd, uint32_t fourcc, uint32_t stride);
+
+  // Returns true if the content lives in imported memory.
+  bool hasExternalStorage() const { return m_externalStorage; }
+
+  // Make the current context wait until all writes to the buffer we issued
+  // so far were executed before it samples from the buffer.
+  void waitForWrites();
+
+  // Remember |fence| as the point after which the current context is done
+  // reading from the buffer. Further writes wait for it to signal.
+  void setReadFence(const std::shared_ptr<FenceSync>& fence) {
+    m_readFence = fence;
+  }
+
  private:
   ColorBuffer();  // no default constructor.
 
   explicit ColorBuffer(EGLDisplay display, Helper* helper);
 
+  // Copy the current read buffer into the texture with a single
+  // glBlitFramebuffer() on the current context. Returns false if that isn't
+  // possible and nothing was copied.
+  bool blitIntoTexture();
+
+  // Create the texture and EGLImage the fallback path of
+  // blitFromCurrentReadBuffer() copies through.
+  bool createBlitImage();
+
+  // Create m_tex and the EGLImage for it.
+  void createTexture();
+
+  // Make sure m_tex exists and holds the current video frame. Returns
+  // false if that isn't possible.
+  bool updateRgba();
+
+  // Upload the planes of a video frame.
+  void updateFromYuv(int width, int height, void* pixels);
+
+  // Convert the planes of the last video frame into m_tex.
+  void convertYuv();
+
+  // Make the current context wait until all reads of the buffer are done
+  // before it writes into it.
+  void waitForReads();
+
  private:
   GLuint m_tex;
   GLuint m_blitTex;
+  // Planes of the last video frame, see subUpdate().
+  GLuint m_yuvTex;
+  GLuint m_yuvWidth;
+  GLuint m_yuvHeight;
   EGLImageKHR m_eglImage;
   EGLImageKHR m_blitEGLImage;
   GLuint m_width;
   GLuint m_height;
   GLuint m_fbo;
   GLenum m_internalFormat;
+  uint32_t m_usage;
+  bool m_hasEglImageTexture2d;
+  // m_tex is behind the planes in m_yuvTex.
+  bool m_rgbaStale;
+  bool m_externalStorage;
   EGLDisplay m_display;
   Helper* m_helper;
   TextureResize* m_resizer;
+  // Signal once the last write to and the last read from the buffer
+  // were executed; NULL if there was none or fences aren't supported.
+  std::shared_ptr<FenceSync> m_writeFence;
+  std::shared_ptr<FenceSync> m_readFence;
 };
 
 typedef emugl::SmartPtr<ColorBuffer> ColorBufferPtr;
@@ -0,0 +1,72 @@
+/*
+* Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "CurrentContext.h"
+
+#include "OpenGLESDispatch/EGLDispatch.h"
+
+#include <atomic>
+
+namespace {
+const CurrentContext::Binding s_noBinding{EGL_NO_DISPLAY, EGL_NO_SURFACE,
+                                          EGL_NO_SURFACE, EGL_NO_CONTEXT};
+
+thread_local CurrentContext::Binding s_current
+    __attribute__((tls_model("initial-exec"))) = s_noBinding;
+std::atomic<std::uint64_t> s_switches{0};
+
+bool sameBinding(const CurrentContext::Binding& a,
+                 const CurrentContext::Binding& b) {
+  // Without a context nothing is current, no matter the display.
+  if (a.context == EGL_NO_CONTEXT && b.context == EGL_NO_CONTEXT)
+    return a.draw == EGL_NO_SURFACE && b.draw == EGL_NO_SURFACE &&
+           a.read == EGL_NO_SURFACE && b.read == EGL_NO_SURFACE;
+  return a.display == b.display && a.draw == b.draw && a.read == b.read &&
+         a.context == b.context;
+}
+}  // namespace
+
+const CurrentContext::Binding& CurrentContext::get() { return s_current; }
+
+bool CurrentContext::makeCurrent(const Binding& binding) {
+  if (sameBinding(s_current, binding))
+    return true;
+
+  s_switches.fetch_add(1, std::memory_order_relaxed);
+  if (!s_egl.eglMakeCurrent(binding.display, binding.draw, binding.read,
+                            binding.context)) {
+    // A failed switch may or may not have left the previous binding in
+    // place, so we better ask from here on.
+    s_current = Binding{binding.display, s_egl.eglGetCurrentSurface(EGL_DRAW),
+                        s_egl.eglGetCurrentSurface(EGL_READ),
+                        s_egl.eglGetCurrentContext()};
+    return false;
+  }
+
+  s_current = binding;
+  return true;
+}
+
+bool CurrentContext::makeCurrent(EGLDisplay display, EGLSurface draw,
+                                 EGLSurface read, EGLContext context) {
+  return makeCurrent(Binding{display, draw, read, context});
+}
+
+void CurrentContext::released() { s_current = s_noBinding; }
+
+std::uint64_t CurrentContext::switches() {
+  return s_switches.load(std::memory_order_relaxed);
+}
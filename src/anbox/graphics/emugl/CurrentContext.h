@@ -0,0 +1,59 @@
+/*
+* Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef ANBOX_GRAPHICS_EMUGL_CURRENT_CONTEXT_H_
+#define ANBOX_GRAPHICS_EMUGL_CURRENT_CONTEXT_H_
+
+#include <EGL/egl.h>
+
+#include <cstdint>
+
+// Remembers what is current on the calling thread so that looking it up
+// doesn't need to ask EGL and making current what already is current
+// doesn't reach EGL at all. With GLX behind the translator every switch
+// is costly, and binding the helper context while it is already bound
+// happens a lot, e.g. when a color buffer sets up its context from within
+// a renderer call which did so already.
+//
+// This only works as long as all of the host switches contexts through
+// here.
+class CurrentContext {
+ public:
+  struct Binding {
+    EGLDisplay display;
+    EGLSurface draw;
+    EGLSurface read;
+    EGLContext context;
+  };
+
+  // What makeCurrent() made current on the calling thread last.
+  static const Binding& get();
+
+  // Equivalent of eglMakeCurrent() which does nothing when |binding| is
+  // current already.
+  static bool makeCurrent(const Binding& binding);
+  static bool makeCurrent(EGLDisplay display, EGLSurface draw,
+                          EGLSurface read, EGLContext context);
+
+  // Has to be called once the calling thread released its EGL state.
+  static void released();
+
+  // Number of eglMakeCurrent() calls which reached EGL so far, on all
+  // threads.
+  static std::uint64_t switches();
+};
+
+#endif
@@ -20,3 +20,7 @@
 
 extern GLESv2Dispatch s_gles2;
 extern GLESv1Dispatch s_gles1;
+
+// Loads s_gles1 when called first and tells whether it is usable. Has to
+// be called before using s_gles1 the first time.
+bool ensureGLESv1Dispatch();
@@ -22,12 +22,19 @@ std::shared_ptr<DisplayManager> display_mgr;
 
 class NullDisplayManager : public DisplayManager {
  public:
-  DisplayInfo display_info() const override { return {1280, 720}; }
+  DisplayInfo display_info() const override { return {1280, 720, 60, 0}; }
 };
 }
 
 DisplayManager::~DisplayManager() {}
 
+anbox::wm::Display::List DisplayManager::displays() const {
+  const auto info = display_info();
+  return {anbox::wm::Display{anbox::wm::Display::Default,
+                             {info.horizontal_resolution, info.vertical_resolution},
+                             info.refresh_rate, info.dpi}};
+}
+
 std::shared_ptr<DisplayManager> DisplayManager::get() {
   if (!display_mgr) display_mgr = std::make_shared<NullDisplayManager>();
   return display_mgr;
@@ -18,6 +18,8 @@
 #ifndef DISPLAY_MANAGER_H_
 #define DISPLAY_MANAGER_H_
 
+#include "anbox/wm/display.h"
+
 #include <memory>
 
 class DisplayManager {
@@ -27,10 +29,20 @@ class DisplayManager {
   struct DisplayInfo {
     int horizontal_resolution;
     int vertical_resolution;
+    // Refresh rate in Hz of the host display or zero if it isn't known.
+    int refresh_rate;
+    // Pixel density of the host display in dots per inch or zero if it
+    // isn't known.
+    int dpi;
   };
 
+  // The single display the guest sees which spans all host displays.
   virtual DisplayInfo display_info() const = 0;
 
+  // The host displays making up the one from display_info(). Platforms
+  // which don't know better have a single one of the same size.
+  virtual anbox::wm::Display::List displays() const;
+
   static std::shared_ptr<DisplayManager> get();
 };
 
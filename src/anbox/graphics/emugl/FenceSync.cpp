@@ -0,0 +1,64 @@
+/*
+* Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "FenceSync.h"
+
+#include "OpenGLESDispatch/EGLDispatch.h"
+
+#include "anbox/logger.h"
+
+namespace {
+EGLDisplay s_display = EGL_NO_DISPLAY;
+bool s_serverWait = false;
+}  // namespace
+
+void FenceSync::initialize(EGLDisplay display, bool serverWait) {
+  s_display = display;
+  s_serverWait = serverWait;
+}
+
+std::shared_ptr<FenceSync> FenceSync::create() {
+  if (s_display == EGL_NO_DISPLAY ||
+      s_egl.eglGetCurrentContext() == EGL_NO_CONTEXT)
+    return nullptr;
+
+  EGLSyncKHR sync = s_egl.eglCreateSyncKHR(s_display, EGL_SYNC_FENCE_KHR, NULL);
+  if (sync == EGL_NO_SYNC_KHR) {
+    ERROR("Failed to create fence: error=0x%x", s_egl.eglGetError());
+    return nullptr;
+  }
+
+  // A fence which is still queued up in this context would never signal
+  // for the others. Flushing through EGL works for all GLES versions.
+  s_egl.eglClientWaitSyncKHR(s_display, sync, EGL_SYNC_FLUSH_COMMANDS_BIT_KHR, 0);
+
+  return std::shared_ptr<FenceSync>(new FenceSync(sync));
+}
+
+FenceSync::FenceSync(EGLSyncKHR sync) : m_sync(sync) {}
+
+FenceSync::~FenceSync() { s_egl.eglDestroySyncKHR(s_display, m_sync); }
+
+void FenceSync::wait() {
+  if (s_serverWait && s_egl.eglWaitSyncKHR(s_display, m_sync, 0) == EGL_TRUE)
+    return;
+
+  clientWait(0, EGL_FOREVER_KHR);
+}
+
+EGLint FenceSync::clientWait(EGLint flags, EGLTimeKHR timeout) {
+  return s_egl.eglClientWaitSyncKHR(s_display, m_sync, flags, timeout);
+}
@@ -0,0 +1,67 @@
+/*
+* Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef ANBOX_GRAPHICS_EMUGL_FENCE_SYNC_H_
+#define ANBOX_GRAPHICS_EMUGL_FENCE_SYNC_H_
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <memory>
+
+// An EGL fence marking a point in the command stream of the context it was
+// created in.
+//
+// Color buffers are written and read by different contexts: the ones of
+// the guest, the helper context updates are done in and the one windows
+// are composed with. Nothing but a glFinish() orders their commands, so
+// without fences a context could sample a buffer before the commands
+// writing it ran on the GPU. Waiting for a fence lets the GPU do the
+// ordering without blocking the calling thread where the driver supports
+// EGL_KHR_wait_sync.
+class FenceSync {
+ public:
+  // Has to be called once with the display all fences belong to. Without
+  // EGL_KHR_fence_sync no fences are created at all and every user falls
+  // back to its unsynchronized behaviour.
+  static void initialize(EGLDisplay display, bool serverWait);
+
+  // Insert a fence into the command stream of the current context and
+  // flush it so that other contexts can wait for it. Returns NULL when
+  // fences are not supported or there is no current context.
+  static std::shared_ptr<FenceSync> create();
+
+  ~FenceSync();
+
+  FenceSync(const FenceSync&) = delete;
+  FenceSync& operator=(const FenceSync&) = delete;
+
+  // Make the current context wait for the fence to signal before it
+  // executes any commands issued afterwards.
+  void wait();
+
+  // Block the calling thread until the fence signaled or |timeout|
+  // nanoseconds passed. Returns EGL_CONDITION_SATISFIED_KHR,
+  // EGL_TIMEOUT_EXPIRED_KHR or EGL_FALSE on error.
+  EGLint clientWait(EGLint flags, EGLTimeKHR timeout);
+
+ private:
+  explicit FenceSync(EGLSyncKHR sync);
+
+  EGLSyncKHR m_sync;
+};
+
+#endif
@@ -0,0 +1,192 @@
+/*
+* Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "PixelStream.h"
+
+#include "DispatchTables.h"
+
+#include "glUtils.h"
+
+#include "anbox/logger.h"
+
+#include <GLES2/gl2.h>
+
+#include <string.h>
+
+namespace {
+// Bound for waiting on a fence before we consider the GPU to be stuck and
+// give up on the transfer.
+const GLuint64 fenceTimeoutNs = 1000000000ULL;
+
+bool versionAtLeast3(const char* version) {
+  if (!version) return false;
+
+  // GLES reports "OpenGL ES N.M ..." while desktop GL reports "N.M ...".
+  static const char prefix[] = "OpenGL ES ";
+  if (strncmp(version, prefix, sizeof(prefix) - 1) == 0)
+    version += sizeof(prefix) - 1;
+
+  return version[0] >= '3' && version[0] <= '9';
+}
+
+size_t rowBytes(int width, GLenum format, GLenum type, int alignment) {
+  const int bits = glUtilsPixelBitSize(format, type);
+  if (bits <= 0) return 0;
+
+  const size_t bytes = (static_cast<size_t>(width) * bits + 7) / 8;
+  if (alignment <= 1) return bytes;
+  return (bytes + alignment - 1) / alignment * alignment;
+}
+}  // namespace
+
+// static
+PixelStream* PixelStream::create() {
+  if (!s_gles2.glMapBufferRange || !s_gles2.glUnmapBuffer ||
+      !s_gles2.glFenceSync || !s_gles2.glClientWaitSync ||
+      !s_gles2.glDeleteSync)
+    return NULL;
+
+  const char* version =
+      reinterpret_cast<const char*>(s_gles2.glGetString(GL_VERSION));
+  if (!versionAtLeast3(version)) return NULL;
+
+  return new PixelStream();
+}
+
+PixelStream::PixelStream() : m_nextUploadSlot(0) {
+  for (unsigned int n = 0; n < numUploadSlots; n++)
+    m_uploadSlots[n] = Slot{0, 0, NULL};
+  m_downloadSlot = Slot{0, 0, NULL};
+}
+
+PixelStream::~PixelStream() {
+  for (unsigned int n = 0; n < numUploadSlots; n++)
+    destroySlot(m_uploadSlots[n]);
+  destroySlot(m_downloadSlot);
+}
+
+bool PixelStream::upload(int x, int y, int width, int height, GLenum format,
+                         GLenum type, const void* pixels) {
+  const size_t stride = rowBytes(width, format, type, 1);
+  if (stride == 0 || height <= 0 || !pixels) return false;
+
+  const size_t size = stride * height;
+
+  Slot& slot = m_uploadSlots[m_nextUploadSlot];
+  if (!waitForSlot(slot) ||
+      !prepareSlot(slot, GL_PIXEL_UNPACK_BUFFER, GL_STREAM_DRAW, size))
+    return false;
+
+  void* dst = s_gles2.glMapBufferRange(
+      GL_PIXEL_UNPACK_BUFFER, 0, size,
+      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  if (!dst) {
+    s_gles2.glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return false;
+  }
+
+  ::memcpy(dst, pixels, size);
+
+  if (!s_gles2.glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER)) {
+    // The buffer content got lost while mapped, e.g. on a mode switch.
+    s_gles2.glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return false;
+  }
+
+  s_gles2.glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  s_gles2.glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, format, type,
+                          NULL);
+  s_gles2.glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  slot.fence = s_gles2.glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  m_nextUploadSlot = (m_nextUploadSlot + 1) % numUploadSlots;
+  return true;
+}
+
+bool PixelStream::download(int x, int y, int width, int height, GLenum format,
+                           GLenum type, void* pixels) {
+  GLint alignment = 4;
+  s_gles2.glGetIntegerv(GL_PACK_ALIGNMENT, &alignment);
+
+  const size_t stride = rowBytes(width, format, type, alignment);
+  if (stride == 0 || height <= 0 || !pixels) return false;
+
+  // The last row is not padded up to the alignment in client memory.
+  const size_t size = stride * (height - 1) + rowBytes(width, format, type, 1);
+
+  Slot& slot = m_downloadSlot;
+  if (!waitForSlot(slot) ||
+      !prepareSlot(slot, GL_PIXEL_PACK_BUFFER, GL_STREAM_READ, stride * height))
+    return false;
+
+  s_gles2.glReadPixels(x, y, width, height, format, type, NULL);
+  slot.fence = s_gles2.glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+  bool success = false;
+  if (waitForSlot(slot)) {
+    const void* src = s_gles2.glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size,
+                                               GL_MAP_READ_BIT);
+    if (src) {
+      ::memcpy(pixels, src, size);
+      success = s_gles2.glUnmapBuffer(GL_PIXEL_PACK_BUFFER) == GL_TRUE;
+    }
+  }
+
+  s_gles2.glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  return success;
+}
+
+bool PixelStream::prepareSlot(Slot& slot, GLenum target, GLenum usage,
+                              size_t size) {
+  if (!slot.buffer) {
+    s_gles2.glGenBuffers(1, &slot.buffer);
+    if (!slot.buffer) return false;
+  }
+
+  s_gles2.glBindBuffer(target, slot.buffer);
+  if (slot.size < size) {
+    s_gles2.glBufferData(target, size, NULL, usage);
+    slot.size = size;
+  }
+  return true;
+}
+
+bool PixelStream::waitForSlot(Slot& slot) {
+  if (!slot.fence) return true;
+
+  const GLenum result = s_gles2.glClientWaitSync(
+      slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, fenceTimeoutNs);
+  s_gles2.glDeleteSync(slot.fence);
+  slot.fence = NULL;
+
+  if (result == GL_WAIT_FAILED || result == GL_TIMEOUT_EXPIRED) {
+    WARNING("Pixel buffer fence did not signal (result %#x)", result);
+    return false;
+  }
+  return true;
+}
+
+void PixelStream::destroySlot(Slot& slot) {
+  if (slot.fence) {
+    s_gles2.glDeleteSync(slot.fence);
+    slot.fence = NULL;
+  }
+  if (slot.buffer) {
+    s_gles2.glDeleteBuffers(1, &slot.buffer);
+    slot.buffer = 0;
+  }
+  slot.size = 0;
+}
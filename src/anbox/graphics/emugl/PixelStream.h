@@ -0,0 +1,82 @@
+/*
+* Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef ANBOX_GRAPHICS_EMUGL_PIXEL_STREAM_H_
+#define ANBOX_GRAPHICS_EMUGL_PIXEL_STREAM_H_
+
+#include "OpenGLESDispatch/GLESv2Dispatch.h"
+
+#include <stddef.h>
+
+// Streams pixel data between host memory and textures through pixel buffer
+// objects instead of client memory.
+//
+// Uploads go through two buffers used in turns. The guest pixels are copied
+// into a mapped buffer and the texture update is sourced from it, so the
+// driver performs the actual transfer asynchronously while we return to
+// decoding. A fence placed after each upload guards the buffer against being
+// overwritten before the GPU consumed it.
+//
+// Readbacks are queued into a pack buffer behind the pending GPU work and
+// only the mapping of the result waits for their fence, instead of forcing
+// the whole pipeline to drain like glReadPixels() into client memory does.
+//
+// All methods must be called with the same GL context (or one sharing with
+// it) current. Instances are only created when the host GL context provides
+// the required GLES 3.x entry points.
+class PixelStream {
+ public:
+  // Returns a new instance or NULL when the current context does not
+  // support pixel buffer objects.
+  static PixelStream* create();
+
+  // Release all buffers and fences. Requires the context to be current.
+  ~PixelStream();
+
+  // Update a region of the texture currently bound to GL_TEXTURE_2D with
+  // |pixels|. Rows are expected to be tightly packed. Returns false when
+  // nothing was submitted and the caller has to fall back to a regular
+  // upload.
+  bool upload(int x, int y, int width, int height, GLenum format, GLenum type,
+              const void* pixels);
+
+  // Read a region of the currently bound read framebuffer into |pixels|,
+  // honouring the current GL_PACK_ALIGNMENT. Returns false when nothing was
+  // read and the caller has to fall back to a regular glReadPixels().
+  bool download(int x, int y, int width, int height, GLenum format,
+                GLenum type, void* pixels);
+
+ private:
+  struct Slot {
+    GLuint buffer;
+    size_t size;
+    GLsync fence;
+  };
+
+  static const unsigned int numUploadSlots = 2;
+
+  PixelStream();
+
+  bool prepareSlot(Slot& slot, GLenum target, GLenum usage, size_t size);
+  bool waitForSlot(Slot& slot);
+  void destroySlot(Slot& slot);
+
+  Slot m_uploadSlots[numUploadSlots];
+  unsigned int m_nextUploadSlot;
+  Slot m_downloadSlot;
+};
+
+#endif
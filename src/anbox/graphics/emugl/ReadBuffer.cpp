@@ -18,43 +18,68 @@
 #include <limits.h>
 #include <string.h>
 
-#include "anbox/logger.h"
+#include <utility>
 
-ReadBuffer::ReadBuffer(size_t bufsize) {
-  m_size = bufsize;
-  m_buf = static_cast<unsigned char*>(malloc(m_size * sizeof(unsigned char)));
-  m_validData = 0;
-  m_readPtr = m_buf;
-}
+#include "anbox/common/memory_usage.h"
+
+using anbox::common::MemoryUsage;
 
-ReadBuffer::~ReadBuffer() { free(m_buf); }
+ReadBuffer::ReadBuffer(size_t bufsize)
+    : m_readPtr(nullptr),
+      m_initialSize(bufsize),
+      m_size(0),
+      m_validData(0) {}
+
+ReadBuffer::~ReadBuffer() {
+  MemoryUsage::remove(MemoryUsage::Subsystem::TransportBuffers, m_size);
+}
 
 int ReadBuffer::getData(IOStream* stream) {
   if (stream == NULL) return -1;
-  if ((m_validData > 0) && (m_readPtr > m_buf)) {
-    memmove(m_buf, m_readPtr, m_validData);
+
+  if (m_validData == 0 && m_size > m_initialSize) {
+    m_buf = anbox::common::HugePageBuffer();
+    MemoryUsage::remove(MemoryUsage::Subsystem::TransportBuffers, m_size);
+    m_size = 0;
+  }
+
+  if (!m_buf.valid()) {
+    m_buf = anbox::common::HugePageBuffer(m_initialSize);
+    if (!m_buf.valid()) return -1;
+    m_size = m_initialSize;
+    MemoryUsage::add(MemoryUsage::Subsystem::TransportBuffers, m_size);
+    m_readPtr = m_buf.data();
   }
-  // get fresh data into the buffer;
-  size_t len = m_size - m_validData;
+
+  if (m_validData == 0) m_readPtr = m_buf.data();
+
+  // Data only moves to the front once there is no room left behind it.
+  size_t len = m_size - (m_readPtr - m_buf.data()) - m_validData;
+  if (len == 0 && m_readPtr > m_buf.data()) {
+    memmove(m_buf.data(), m_readPtr, m_validData);
+    m_readPtr = m_buf.data();
+    len = m_size - m_validData;
+  }
+
   if (len == 0) {
     // we need to inc our buffer
     size_t new_size = m_size * 2;
-    unsigned char* new_buf;
     if (new_size < m_size) {  // overflow check
       new_size = INT_MAX;
     }
 
-    new_buf = static_cast<unsigned char*>(realloc(m_buf, new_size));
-    if (!new_buf) {
-      ERROR("Failed to alloc %zu bytes for ReadBuffer", new_size);
-      return -1;
-    }
+    // Everything left is at the front by now.
+    anbox::common::HugePageBuffer new_buf(new_size);
+    if (!new_buf.valid()) return -1;
+    memcpy(new_buf.data(), m_buf.data(), m_validData);
+    MemoryUsage::add(MemoryUsage::Subsystem::TransportBuffers, new_size - m_size);
     m_size = new_size;
-    m_buf = new_buf;
+    m_buf = std::move(new_buf);
+    m_readPtr = m_buf.data();
     len = m_size - m_validData;
   }
-  m_readPtr = m_buf;
-  if (NULL != stream->read(m_buf + m_validData, &len)) {
+
+  if (NULL != stream->read(m_readPtr + m_validData, &len)) {
     m_validData += len;
     return len;
   }
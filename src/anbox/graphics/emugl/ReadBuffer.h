@@ -18,6 +18,14 @@
 
 #include "IOStream.h"
 
+#include "anbox/common/huge_page_buffer.h"
+
+// Holds commands which arrived incomplete until the rest of them did.
+// Memory is only allocated once needed, starting with |bufSize| bytes and
+// growing with the largest incomplete command. Once drained a grown
+// buffer is released again so a single large upload doesn't pin memory
+// for the lifetime of the render thread. Grown buffers may be backed by
+// huge pages, see anbox::common::HugePageBuffer.
 class ReadBuffer {
  public:
   ReadBuffer(size_t bufSize);
@@ -28,9 +36,11 @@ class ReadBuffer {
     return m_validData;
   }                             // return the amount of valid data in readptr
   void consume(size_t amount);  // notify that 'amount' data has been consumed;
+  void discard() { m_validData = 0; }  // drop what is left, e.g. of a client which is gone
  private:
-  unsigned char *m_buf;
+  anbox::common::HugePageBuffer m_buf;
   unsigned char *m_readPtr;
+  size_t m_initialSize;
   size_t m_size;
   size_t m_validData;
 };
@@ -24,6 +24,9 @@
 
 #include "emugl/common/crash_reporter.h"
 
+#include <mutex>
+#include <string>
+
 #include <string.h>
 
 GLESv2Dispatch s_gles2;
@@ -33,6 +36,16 @@ namespace {
 constexpr const char *default_egl_lib{"libEGL.so.1"};
 constexpr const char *default_glesv1_lib{"libGLESv1_CM.so.1"};
 constexpr const char *default_glesv2_lib{"libGLESv2.so.2"};
+
+std::mutex gles1_lock;
+std::string gles1_path;
+}
+
+bool ensureGLESv1Dispatch() {
+  std::lock_guard<std::mutex> l(gles1_lock);
+  if (!s_gles1.initialized && !gles1_path.empty())
+    gles1_dispatch_init(gles1_path.c_str(), &s_gles1);
+  return s_gles1.initialized;
 }
 
 namespace anbox {
@@ -63,10 +76,13 @@ bool initialize(const std::vector<GLLibrary> &libs, emugl_logger_struct *log_fun
       if (!init_egl_dispatch(path))
         return false;
       break;
-    case GLLibrary::Type::GLESv1:
-      if (!gles1_dispatch_init(path, &s_gles1))
-        return false;
+    case GLLibrary::Type::GLESv1: {
+      // Only a few guest apps still use GLES 1.1, the library is loaded
+      // with the first context asking for it, see ensureGLESv1Dispatch().
+      std::lock_guard<std::mutex> l(gles1_lock);
+      gles1_path = lib.path.string();
       break;
+    }
     case GLLibrary::Type::GLESv2:
       if (!gles2_dispatch_init(path, &s_gles2))
         return false;
@@ -76,7 +92,7 @@ bool initialize(const std::vector<GLLibrary> &libs, emugl_logger_struct *log_fun
     }
   }
 
-  if (!s_egl.initialized || !s_gles1.initialized || !s_gles2.initialized)
+  if (!s_egl.initialized || gles1_path.empty() || !s_gles2.initialized)
     return false;
 
   return true;
@@ -24,10 +24,17 @@
 
 #include "OpenGLESDispatch/EGLDispatch.h"
 
+#include "anbox/common/boot_timeline.h"
 #include "anbox/graphics/layer_composer.h"
+#include "anbox/graphics/posted_layers.h"
+#include "anbox/graphics/vsync_clock.h"
 #include "anbox/logger.h"
+#include "anbox/utils.h"
 
+#include <atomic>
+#include <chrono>
 #include <map>
+#include <mutex>
 #include <string>
 
 static const GLint rendererVersion = 1;
@@ -45,6 +52,11 @@ void registerRenderer(const std::shared_ptr<Renderer> &r) {
 
 static GLint rcGetRendererVersion() { return rendererVersion; }
 
+static std::chrono::nanoseconds vsync_period() {
+  return anbox::graphics::VsyncClock::period_for_refresh_rate(
+      DisplayManager::get()->display_info().refresh_rate);
+}
+
 static EGLint rcGetEGLVersion(EGLint *major, EGLint *minor) {
   if (!renderer)
     return EGL_FALSE;
@@ -90,19 +102,9 @@ static EGLint rcQueryEGLString(EGLenum name, void *buffer, EGLint bufferSize) {
   return len;
 }
 
-static EGLint rcGetGLString(EGLenum name, void *buffer, EGLint bufferSize) {
-  RenderThreadInfo *tInfo = RenderThreadInfo::get();
+static std::string approvedGLString(EGLenum name, const char *str) {
   std::string result;
-
-  if (tInfo && tInfo->currContext) {
-    const char *str = nullptr;
-    if (tInfo->currContext->isGL2())
-      str = reinterpret_cast<const char *>(s_gles2.glGetString(name));
-    else
-      str = reinterpret_cast<const char *>(s_gles1.glGetString(name));
-
-    if (str) result += str;
-  }
+  if (str) result += str;
 
   // We're forcing version 2.0 no matter what the host provides as
   // our emulation layer isn't prepared for anything newer (yet).
@@ -127,13 +129,68 @@ static EGLint rcGetGLString(EGLenum name, void *buffer, EGLint bufferSize) {
     }
 
     result = approved_extensions;
+
+    // Tells gralloc that it can create BGRA color buffers instead of
+    // handing us BGRA pixels as RGBA. Queried without a current context.
+    if (renderer && renderer->getCaps().has_bgra_texture)
+      result += " GL_ANBOX_bgra_color_buffer";
+
+    // Guests only checksum their command stream when we advertise support
+    // for it. Our transports never leave the local machine, so verifying
+    // every packet buys nothing but per-command work on both ends; keep it
+    // as an opt-in for debugging protocol corruption.
+    static const bool checksums_enabled =
+        anbox::utils::is_env_set("ANBOX_GL_CHECKSUMS");
+    if (checksums_enabled) {
+      result += " ";
+      result += ChecksumCalculatorThreadInfo::getMaxVersionString();
+    }
   }
 
-  int nextBufferSize = result.size() + 1;
+  return result;
+}
+
+// The strings only depend on the host GL implementation and the client API
+// version, so they're built once and served from a cache afterwards. Every
+// guest process queries them while setting up its first context.
+static const std::string &cachedGLString(bool isGL2, EGLenum name) {
+  static std::mutex cache_lock;
+  static std::map<std::pair<bool, EGLenum>, std::string> cache;
+
+  std::lock_guard<std::mutex> lock(cache_lock);
+  const auto key = std::make_pair(isGL2, name);
+  auto it = cache.find(key);
+  if (it != cache.end()) return it->second;
+
+  const char *str = nullptr;
+  if (isGL2)
+    str = reinterpret_cast<const char *>(s_gles2.glGetString(name));
+  else
+    str = reinterpret_cast<const char *>(s_gles1.glGetString(name));
+
+  std::string result = approvedGLString(name, str);
+  // Implemented by our GLESv2 decoder rather than by the host GL.
+  if (isGL2 && name == GL_EXTENSIONS)
+    result += " GL_ANBOX_async_read_pixels";
+
+  return cache.emplace(key, result).first->second;
+}
+
+static EGLint rcGetGLString(EGLenum name, void *buffer, EGLint bufferSize) {
+  RenderThreadInfo *tInfo = RenderThreadInfo::get();
+
+  std::string uncached;
+  const std::string *result = &uncached;
+  if (tInfo && tInfo->currContext)
+    result = &cachedGLString(tInfo->currContext->isGL2(), name);
+  else
+    uncached = approvedGLString(name, nullptr);
+
+  int nextBufferSize = result->size() + 1;
 
   if (!buffer || nextBufferSize > bufferSize) return -nextBufferSize;
 
-  snprintf(static_cast<char *>(buffer), nextBufferSize, "%s", result.c_str());
+  memcpy(buffer, result->c_str(), nextBufferSize);
   return nextBufferSize;
 }
 
@@ -181,7 +238,7 @@ static EGLint rcGetFBParam(EGLint param) {
       ret = 72;  // XXX: should be implemented
       break;
     case FB_FPS:
-      ret = 60;
+      ret = 1000000000 / vsync_period().count();
       break;
     case FB_MIN_SWAP_INTERVAL:
       ret = 1;  // XXX: should be implemented
@@ -238,6 +295,15 @@ static uint32_t rcCreateColorBuffer(uint32_t width, uint32_t height,
   return renderer->createColorBuffer(width, height, internalFormat);
 }
 
+static uint32_t rcCreateColorBufferWithUsage(uint32_t width, uint32_t height,
+                                             GLenum internalFormat,
+                                             uint32_t usage) {
+  if (!renderer)
+    return 0;
+
+  return renderer->createColorBuffer(width, height, internalFormat, usage);
+}
+
 static int rcOpenColorBuffer2(uint32_t colorbuffer) {
   if (!renderer)
     return -1;
@@ -288,8 +354,11 @@ static EGLint rcMakeCurrent(uint32_t context, uint32_t drawSurf,
 
 static void rcFBPost(uint32_t) { WARNING("Not implemented"); }
 
-static void rcFBSetSwapInterval(EGLint) {
-  // XXX: TBD - should be implemented
+static void rcFBSetSwapInterval(EGLint interval) {
+  if (!renderer)
+    return;
+
+  renderer->setSwapInterval(interval);
 }
 
 static void rcBindTexture(uint32_t colorBuffer) {
@@ -331,6 +400,19 @@ static int rcUpdateColorBuffer(uint32_t colorBuffer, GLint x, GLint y,
   return 0;
 }
 
+static int rcUpdateSharedColorBuffer(uint32_t colorBuffer, GLint x, GLint y,
+                                     GLint width, GLint height, GLenum format,
+                                     GLenum type) {
+  if (!renderer)
+    return -1;
+
+  if (!renderer->updateSharedColorBuffer(colorBuffer, x, y, width, height,
+                                         format, type))
+    return -1;
+
+  return 0;
+}
+
 static uint32_t rcCreateClientImage(uint32_t context, EGLenum target,
                                     GLuint buffer) {
   if (!renderer)
@@ -350,11 +432,19 @@ static void rcSelectChecksumCalculator(uint32_t protocol, uint32_t) {
   ChecksumCalculatorThreadInfo::setVersion(protocol);
 }
 
+// Used while the host doesn't tell us the density of its displays.
+static constexpr int default_display_dpi{120};
+
+static int display_dpi() {
+  const auto dpi = DisplayManager::get()->display_info().dpi;
+  return dpi > 0 ? dpi : default_display_dpi;
+}
+
 int rcGetNumDisplays() {
-  // For now we only support a single display but that single display
-  // will contain more than one display so that we simply spawn up a big
-  // virtual display which should match the real display arrangement
-  // in most cases.
+  // Android places the windows of all its tasks on a single display so
+  // the guest gets a big virtual one spanning all host displays. Which
+  // host display a window actually shows up on only matters for its
+  // composition, see LayerComposer::set_displays.
   return 1;
 }
 
@@ -370,20 +460,30 @@ int rcGetDisplayHeight(uint32_t display_id) {
 
 int rcGetDisplayDpiX(uint32_t display_id) {
   (void)display_id;
-  return 120;
+  return display_dpi();
 }
 
 int rcGetDisplayDpiY(uint32_t display_id) {
   (void)display_id;
-  return 120;
+  return display_dpi();
 }
 
 int rcGetDisplayVsyncPeriod(uint32_t display_id) {
   (void)display_id;
-  return 1;
+  // The guest renders on each vsync we give it, a slower one keeps it
+  // from rendering frames we wouldn't compose anyway.
+  if (composer)
+    return composer->guest_frame_period(vsync_period()).count();
+  return vsync_period().count();
 }
 
-static std::vector<Renderable> frame_layers;
+int rcGetDisplayVsyncPhase(uint32_t display_id) {
+  (void)display_id;
+  if (!renderer)
+    return 0;
+
+  return renderer->vsyncClock().phase(vsync_period()).count();
+}
 
 bool is_layer_blacklisted(const std::string &name) {
   static std::vector<std::string> blacklist = {
@@ -396,25 +496,81 @@ bool is_layer_blacklisted(const std::string &name) {
   return std::find(blacklist.begin(), blacklist.end(), name) != blacklist.end();
 }
 
+void mark_first_layer_posted() {
+  static std::atomic<bool> first_layer_posted{false};
+  if (!first_layer_posted.exchange(true))
+    anbox::common::BootTimeline::instance().mark("first_layer_posted");
+}
+
 void rcPostLayer(const char *name, uint32_t color_buffer,
                  int32_t sourceCropLeft, int32_t sourceCropTop,
                  int32_t sourceCropRight, int32_t sourceCropBottom,
                  int32_t displayFrameLeft, int32_t displayFrameTop,
                  int32_t displayFrameRight, int32_t displayFrameBottom) {
   Renderable r{
-      name,
+      anbox::graphics::LayerName{name},
       color_buffer,
       {displayFrameLeft, displayFrameTop, displayFrameRight, displayFrameBottom},
       {sourceCropLeft, sourceCropTop, sourceCropRight, sourceCropBottom}};
-  frame_layers.push_back(r);
+  RenderThreadInfo::get()->m_frameLayers.push_back(r);
+  mark_first_layer_posted();
 }
 
-void rcPostAllLayersDone() {
-  if (composer) composer->submit_layers(frame_layers);
+void rcPostLayers(const void *layers, uint32_t layers_size) {
+  auto &frame_layers = RenderThreadInfo::get()->m_frameLayers;
+  const auto count = frame_layers.size();
+  // What was decoded before a broken record is still shown.
+  if (!anbox::graphics::decode_posted_layers(layers, layers_size, frame_layers))
+    ERROR("Guest posted malformed layers");
+  if (frame_layers.size() > count)
+    mark_first_layer_posted();
+}
+
+void postAllLayers(const anbox::graphics::FrameStatistics::Clock::time_point &submitted) {
+  auto &frame_layers = RenderThreadInfo::get()->m_frameLayers;
+  if (renderer) {
+    if (auto policy = renderer->threadPolicy())
+      policy->layers_posted();
+  }
+
+  if (composer) composer->submit_layers(frame_layers, submitted);
 
   frame_layers.clear();
 }
 
+void rcPostAllLayersDone() {
+  postAllLayers({});
+}
+
+void rcPostAllLayersDone2(uint32_t submitTimeHi, uint32_t submitTimeLo) {
+  const auto guest_ns = (static_cast<uint64_t>(submitTimeHi) << 32) | submitTimeLo;
+  postAllLayers(anbox::graphics::FrameStatistics::guest_time(
+      guest_ns, anbox::graphics::FrameStatistics::Clock::now()));
+}
+
+uint32_t rcCreateSyncKHR() {
+  if (!renderer)
+    return 0;
+
+  return renderer->createSync();
+}
+
+EGLint rcClientWaitSyncKHR(uint32_t sync, EGLint flags, uint32_t timeoutHi,
+                           uint32_t timeoutLo) {
+  if (!renderer)
+    return EGL_FALSE;
+
+  const auto timeout = (static_cast<EGLTimeKHR>(timeoutHi) << 32) | timeoutLo;
+  return renderer->clientWaitSync(sync, flags, timeout);
+}
+
+EGLint rcDestroySyncKHR(uint32_t sync) {
+  if (!renderer)
+    return EGL_FALSE;
+
+  return renderer->destroySync(sync);
+}
+
 void initRenderControlContext(renderControl_decoder_context_t *dec) {
   dec->rcGetRendererVersion = rcGetRendererVersion;
   dec->rcGetEGLVersion = rcGetEGLVersion;
@@ -441,6 +597,7 @@ void initRenderControlContext(renderControl_decoder_context_t *dec) {
   dec->rcColorBufferCacheFlush = rcColorBufferCacheFlush;
   dec->rcReadColorBuffer = rcReadColorBuffer;
   dec->rcUpdateColorBuffer = rcUpdateColorBuffer;
+  dec->rcUpdateSharedColorBuffer = rcUpdateSharedColorBuffer;
   dec->rcOpenColorBuffer2 = rcOpenColorBuffer2;
   dec->rcCreateClientImage = rcCreateClientImage;
   dec->rcDestroyClientImage = rcDestroyClientImage;
@@ -451,6 +608,13 @@ void initRenderControlContext(renderControl_decoder_context_t *dec) {
   dec->rcGetDisplayDpiX = rcGetDisplayDpiX;
   dec->rcGetDisplayDpiY = rcGetDisplayDpiY;
   dec->rcGetDisplayVsyncPeriod = rcGetDisplayVsyncPeriod;
+  dec->rcGetDisplayVsyncPhase = rcGetDisplayVsyncPhase;
   dec->rcPostLayer = rcPostLayer;
   dec->rcPostAllLayersDone = rcPostAllLayersDone;
+  dec->rcPostAllLayersDone2 = rcPostAllLayersDone2;
+  dec->rcCreateSyncKHR = rcCreateSyncKHR;
+  dec->rcClientWaitSyncKHR = rcClientWaitSyncKHR;
+  dec->rcDestroySyncKHR = rcDestroySyncKHR;
+  dec->rcPostLayers = rcPostLayers;
+  dec->rcCreateColorBufferWithUsage = rcCreateColorBufferWithUsage;
 }
@@ -15,9 +15,11 @@
 */
 #include "RenderThread.h"
 
+#include "DispatchTables.h"
 #include "ReadBuffer.h"
 #include "RenderControl.h"
 #include "RenderThreadInfo.h"
+#include "RenderThreadPool.h"
 #include "Renderer.h"
 #include "TimeUtils.h"
 
@@ -26,66 +28,205 @@
 #include "OpenGLESDispatch/GLESv1Dispatch.h"
 #include "OpenGLESDispatch/GLESv2Dispatch.h"
 
+#include "anbox/common/tracer.h"
 #include "anbox/logger.h"
 
-#define STREAM_BUFFER_SIZE 4 * 1024 * 1024
+#include <string.h>
 
-RenderThread::RenderThread(const std::shared_ptr<Renderer> &renderer, IOStream *stream, emugl::Mutex *lock)
-    : emugl::Thread(), renderer_(renderer), m_lock(lock), m_stream(stream) {}
+// Only what the stream can't hand us in place goes through the read buffer,
+// larger commands grow it as needed.
+#define STREAM_BUFFER_SIZE 256 * 1024
+
+namespace {
+// Opcode and total size of a command.
+constexpr size_t commandHeaderSize = 8;
+
+enum class Decoder { None, GLESv1, GLESv2, RenderControl };
+
+// emugen assigns each decoder a disjoint opcode range, so the owner of a
+// command follows directly from its opcode. GLESv2 commands are by far the
+// most frequent ones and checked first.
+Decoder decoderForOpcode(uint32_t opcode) {
+  if (gles2_decoder_context_t::handlesOpcode(opcode)) return Decoder::GLESv2;
+  if (renderControl_decoder_context_t::handlesOpcode(opcode))
+    return Decoder::RenderControl;
+  if (gles1_decoder_context_t::handlesOpcode(opcode)) return Decoder::GLESv1;
+  return Decoder::None;
+}
+}  // namespace
+
+// static
+std::shared_ptr<anbox::graphics::CommandProfiler> RenderThread::createCommandProfiler() {
+  typedef anbox::graphics::CommandProfiler::OpcodeRange Range;
+  return std::make_shared<anbox::graphics::CommandProfiler>(std::vector<Range>{
+      Range{"gles1", gles1_decoder_context_t::firstOpcode,
+            gles1_decoder_context_t::endOpcode, gles1_decoder_context_t::opcodeName},
+      Range{"gles2", gles2_decoder_context_t::firstOpcode,
+            gles2_decoder_context_t::endOpcode, gles2_decoder_context_t::opcodeName},
+      Range{"renderControl", renderControl_decoder_context_t::firstOpcode,
+            renderControl_decoder_context_t::endOpcode,
+            renderControl_decoder_context_t::opcodeName},
+  });
+}
+
+RenderThread::RenderThread(const std::shared_ptr<Renderer> &renderer, IOStream *stream,
+                           emugl::Mutex *lock, RenderThreadPool *pool)
+    : emugl::Thread(), renderer_(renderer), m_lock(lock), m_stream(stream), m_owner(0),
+      m_pool(pool), m_skippedCommands(false) {}
 
 RenderThread::~RenderThread() {
   forceStop();
 }
 
 RenderThread *RenderThread::create(const std::shared_ptr<Renderer> &renderer, IOStream *stream, emugl::Mutex *lock) {
-  return new RenderThread(renderer, stream, lock);
+  return new RenderThread(renderer, stream, lock, nullptr);
 }
 
-void RenderThread::forceStop() { m_stream->forceStop(); }
+void RenderThread::forceStop() {
+  // A pooled thread has no stream while it waits for a client.
+  if (m_stream) m_stream->forceStop();
+}
+
+size_t RenderThread::decode(RenderThreadInfo &threadInfo, unsigned char *buf, size_t len) {
+  ANBOX_TRACE_SPAN("gl", "decode");
+  size_t consumed = 0;
+  // Every command starts with its opcode and total size. Looking at the
+  // opcode lets us hand each run of commands straight to the decoder which
+  // knows it instead of probing all of them until one makes progress.
+  while (len - consumed >= commandHeaderSize) {
+    uint32_t opcode = 0;
+    ::memcpy(&opcode, buf + consumed, sizeof(opcode));
+
+    // Limiting the decoders to the current command makes them return after
+    // it which is what we need to time it on its own.
+    size_t available = len - consumed;
+    if (m_recorder) {
+      uint32_t packetLen = 0;
+      ::memcpy(&packetLen, buf + consumed + sizeof(opcode), sizeof(packetLen));
+      if (packetLen >= commandHeaderSize && packetLen <= available)
+        available = packetLen;
+    }
+
+    if (m_lock) m_lock->lock();
+    const auto start = m_recorder ? anbox::graphics::CommandProfiler::Clock::now()
+                                  : anbox::graphics::CommandProfiler::Clock::time_point();
+    size_t last = 0;
+    switch (decoderForOpcode(opcode)) {
+      case Decoder::GLESv1:
+        // Contexts can be made current on any render thread, so the
+        // decoder is set up with the first GLES 1.1 command it sees.
+        if (!threadInfo.m_glDecInitialized && ensureGLESv1Dispatch()) {
+          threadInfo.m_glDec.initGL(gles1_dispatch_get_proc_func, NULL);
+          threadInfo.m_glDecInitialized = true;
+        }
+        if (threadInfo.m_glDecInitialized)
+          last = threadInfo.m_glDec.decode(buf + consumed, available, m_stream);
+        else
+          last = skipCommand(buf + consumed, len - consumed);
+        break;
+      case Decoder::GLESv2:
+        last = threadInfo.m_gl2Dec.decode(buf + consumed, available, m_stream);
+        break;
+      case Decoder::RenderControl:
+        last = threadInfo.m_rcDec.decode(buf + consumed, available, m_stream);
+        break;
+      case Decoder::None:
+        break;
+    }
+    if (m_recorder && last > 0)
+      m_recorder->record(opcode, last, start,
+                         anbox::graphics::CommandProfiler::Clock::now());
+    if (m_lock) m_lock->unlock();
+
+    // Either the command isn't complete yet or no decoder knows it.
+    if (last == 0)
+      break;
+
+    consumed += last;
+  }
+
+  return consumed;
+}
+
+size_t RenderThread::skipCommand(const unsigned char *buf, size_t len) {
+  uint32_t opcode = 0;
+  uint32_t packetLen = 0;
+  ::memcpy(&opcode, buf, sizeof(opcode));
+  ::memcpy(&packetLen, buf + sizeof(opcode), sizeof(packetLen));
+
+  // Nothing after it could be decoded.
+  if (packetLen < commandHeaderSize) {
+    ERROR("Invalid size %u of command %u, closing the stream", packetLen, opcode);
+    m_stream->forceStop();
+    return 0;
+  }
+  if (packetLen > len)
+    return 0;
+
+  if (!m_skippedCommands)
+    ERROR("GLES 1.1 isn't available, dropping the commands of the client");
+  m_skippedCommands = true;
+  return packetLen;
+}
 
 intptr_t RenderThread::main() {
   RenderThreadInfo threadInfo;
-  ChecksumCalculatorThreadInfo threadChecksumInfo;
 
-  threadInfo.m_glDec.initGL(gles1_dispatch_get_proc_func, NULL);
+  // Resolving all GL functions of the decoders is what makes starting a
+  // thread expensive. A pooled thread does it once for all its clients.
+  // The GLESv1 decoder is only set up once a client uses it, see decode().
   threadInfo.m_gl2Dec.initGL(gles2_dispatch_get_proc_func, NULL);
   initRenderControlContext(&threadInfo.m_rcDec);
 
+  if (auto profiler = renderer_->commandProfiler())
+    m_recorder = profiler->register_thread();
+
   ReadBuffer readBuf(STREAM_BUFFER_SIZE);
 
-  while (true) {
-    int stat = readBuf.getData(m_stream);
-    if (stat <= 0)
-      break;
+  if (m_pool) {
+    bool reusable = true;
+    while (m_pool->nextClient(this, reusable))
+      reusable = serve(threadInfo, readBuf);
+  } else {
+    serve(threadInfo, readBuf);
+  }
 
-    bool progress;
-    do {
-      progress = false;
+  m_recorder.reset();
 
-      m_lock->lock();
-      size_t last =
-          threadInfo.m_glDec.decode(readBuf.buf(), readBuf.validData(), m_stream);
-      if (last > 0) {
-        progress = true;
-        readBuf.consume(last);
-      }
+  return 0;
+}
 
-      last =
-          threadInfo.m_gl2Dec.decode(readBuf.buf(), readBuf.validData(), m_stream);
-      if (last > 0) {
-        progress = true;
-        readBuf.consume(last);
-      }
+bool RenderThread::serve(RenderThreadInfo &threadInfo, ReadBuffer &readBuf) {
+  // Every client negotiates the checksum protocol again.
+  ChecksumCalculatorThreadInfo threadChecksumInfo;
+  threadInfo.m_gl2Dec.setSharedMemoryOwner(m_owner);
+  m_skippedCommands = false;
+
+  const auto policy = renderer_->threadPolicy();
+  if (policy) policy->thread_started();
 
-      last = threadInfo.m_rcDec.decode(readBuf.buf(), readBuf.validData(), m_stream);
-      if (last > 0) {
-        readBuf.consume(last);
-        progress = true;
+  while (true) {
+    // If the stream allows it we decode directly from its buffer and
+    // only fall back to copying into our own buffer when we're left
+    // with an incomplete command.
+    if (readBuf.validData() == 0) {
+      size_t len = 0;
+      auto data = const_cast<unsigned char*>(m_stream->peek(&len));
+      if (data) {
+        const auto consumed = decode(threadInfo, data, len);
+        if (consumed > 0) {
+          m_stream->consume(consumed);
+          continue;
+        }
       }
+    }
 
-      m_lock->unlock();
+    int stat = readBuf.getData(m_stream);
+    if (stat <= 0)
+      break;
 
-    } while (progress);
+    const auto consumed = decode(threadInfo, readBuf.buf(), readBuf.validData());
+    readBuf.consume(consumed);
   }
 
   // Release references to the current thread's context/surfaces if any
@@ -95,6 +236,16 @@ intptr_t RenderThread::main() {
 
   renderer_->drainWindowSurface();
   renderer_->drainRenderContext();
+  renderer_->drainClientImages();
+  renderer_->drainSyncs();
 
-  return 0;
+  readBuf.discard();
+  threadInfo.nextClient();
+
+  // The compositor's thread keeps its scheduling, so it can't serve an app
+  // afterwards.
+  const auto reusable = !policy || !policy->serves_compositor();
+  if (policy) policy->thread_stopped();
+
+  return reusable;
 }
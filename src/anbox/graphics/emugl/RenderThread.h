@@ -21,9 +21,16 @@
 #include "emugl/common/mutex.h"
 #include "emugl/common/thread.h"
 
+#include "anbox/graphics/command_profiler.h"
+
+#include <sys/types.h>
+
 #include <memory>
 
+class ReadBuffer;
 class Renderer;
+class RenderThreadPool;
+struct RenderThreadInfo;
 
 // A class used to model a thread of the RenderServer. Each one of them
 // handles a single guest client / protocol byte stream.
@@ -33,11 +40,15 @@ class RenderThread : public emugl::Thread {
   // |stream| is an input stream that will be read from the thread,
   // and deleted by it when it exits.
   // |mutex| is a pointer to a shared mutex used to serialize
-  // decoding operations between all threads.
-  // TODO(digit): Why is this needed here? Shouldn't this be handled
-  //              by the decoders themselves or at a lower-level?
+  // decoding operations between all threads. If it is NULL the thread
+  // decodes and executes in parallel with all other render threads and
+  // only the Renderer serializes access to its shared state.
   static RenderThread* create(const std::shared_ptr<Renderer>& renderer, IOStream* stream, emugl::Mutex* mutex);
 
+  // Create a profiler covering the opcodes of all decoders a render thread
+  // dispatches to. See Renderer::setCommandProfiler().
+  static std::shared_ptr<anbox::graphics::CommandProfiler> createCommandProfiler();
+
   // Destructor.
   virtual ~RenderThread();
 
@@ -49,15 +60,42 @@ class RenderThread : public emugl::Thread {
   void forceStop();
 
  private:
+  friend class RenderThreadPool;
+
   RenderThread();  // No default constructor
 
-  RenderThread(const std::shared_ptr<Renderer>& renderer, IOStream* stream, emugl::Mutex* mutex);
+  // A thread of |pool| gets its clients from it, one after the other.
+  RenderThread(const std::shared_ptr<Renderer>& renderer, IOStream* stream,
+               emugl::Mutex* mutex, RenderThreadPool* pool);
 
   virtual intptr_t main();
 
+  // Serves the client on |m_stream| until its stream ends and releases
+  // everything it left behind. Returns false if the thread must not serve
+  // any other client afterwards.
+  bool serve(RenderThreadInfo& threadInfo, ReadBuffer& readBuf);
+
+  // Decodes all complete commands in |buf|, dispatching each run of them
+  // to the decoder owning their opcodes, and returns the number of bytes
+  // consumed.
+  size_t decode(RenderThreadInfo& threadInfo, unsigned char* buf, size_t len);
+
+  // Drops the command at the start of |buf| which no decoder can handle
+  // and returns its size, 0 if it isn't complete yet. A command with an
+  // invalid size stops the stream.
+  size_t skipCommand(const unsigned char* buf, size_t len);
+
   std::shared_ptr<Renderer> renderer_;
   emugl::Mutex* m_lock;
   IOStream* m_stream;
+  // Guest process whose shared buffer memory the client may use.
+  pid_t m_owner;
+  RenderThreadPool* m_pool;
+  // Only set while profiling. Commands are then decoded one at a time so
+  // that each one can be timed on its own.
+  std::shared_ptr<anbox::graphics::CommandProfiler::Recorder> m_recorder;
+  // Whether commands of the current client were dropped already.
+  bool m_skippedCommands;
 };
 
 #endif
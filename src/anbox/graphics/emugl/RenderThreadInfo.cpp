@@ -16,22 +16,39 @@
 
 #include "RenderThreadInfo.h"
 
-#include "emugl/common/lazy_instance.h"
-#include "emugl/common/thread_store.h"
+#include "anbox/common/memory_usage.h"
+
+#include <atomic>
+
+using anbox::common::MemoryUsage;
 
 namespace {
-class ThreadInfoStore : public ::emugl::ThreadStore {
- public:
-  ThreadInfoStore() : ::emugl::ThreadStore(NULL) {}
-};
-}
+// Looked up for every command a render thread decodes. anbox-core is only
+// linked into executables so the pointer can live in their static TLS
+// block instead of going through pthread_getspecific.
+thread_local RenderThreadInfo* s_current
+    __attribute__((tls_model("initial-exec"))) = nullptr;
+}  // namespace
 
-static ::emugl::LazyInstance<ThreadInfoStore> s_tls = LAZY_INSTANCE_INIT;
+static std::atomic<uint32_t> s_nextId{1};
 
-RenderThreadInfo::RenderThreadInfo() { s_tls->set(this); }
+RenderThreadInfo::RenderThreadInfo() : m_id(s_nextId++) {
+  s_current = this;
+  // The decoders are most of it.
+  MemoryUsage::add(MemoryUsage::Subsystem::DecoderContexts, sizeof(*this));
+}
 
-RenderThreadInfo::~RenderThreadInfo() { s_tls->set(NULL); }
+RenderThreadInfo::~RenderThreadInfo() {
+  s_current = nullptr;
+  MemoryUsage::remove(MemoryUsage::Subsystem::DecoderContexts, sizeof(*this));
+}
+
+void RenderThreadInfo::nextClient() {
+  m_id = s_nextId++;
+  m_frameLayers.clear();
+  m_gl2Dec.forgetPendingReads();
+}
 
 RenderThreadInfo* RenderThreadInfo::get() {
-  return static_cast<RenderThreadInfo*>(s_tls->get());
+  return s_current;
 }
@@ -19,6 +19,7 @@
 #include "GLESv1Decoder.h"
 #include "GLESv2Decoder.h"
 #include "RenderContext.h"
+#include "Renderable.h"
 #include "WindowSurface.h"
 #include "renderControl_dec.h"
 
@@ -27,6 +28,8 @@
 typedef uint32_t HandleType;
 typedef std::set<HandleType> ThreadContextSet;
 typedef std::set<HandleType> WindowSurfaceSet;
+typedef std::set<HandleType> ClientImageSet;
+typedef std::set<HandleType> FenceSyncSet;
 
 // A class used to model the state of each RenderThread related
 struct RenderThreadInfo {
@@ -41,6 +44,14 @@ struct RenderThreadInfo {
   // Return the current thread's instance, if any, or NULL.
   static RenderThreadInfo* get();
 
+  // Forget the client served so far to serve the next one. Everything
+  // the client created has to be released already.
+  void nextClient();
+
+  // Unique id of the client the render thread serves, never reused. GPU
+  // memory the client allocates is accounted to it.
+  uint32_t m_id;
+
   // Current EGL context, draw surface and read surface.
   RenderContextPtr currContext;
   WindowSurfacePtr currDrawSurf;
@@ -48,6 +59,8 @@ struct RenderThreadInfo {
 
   // Decoder states.
   GLESv1Decoder m_glDec;
+  // Whether m_glDec resolved its GL functions yet.
+  bool m_glDecInitialized = false;
   GLESv2Decoder m_gl2Dec;
   renderControl_decoder_context_t m_rcDec;
 
@@ -55,6 +68,13 @@ struct RenderThreadInfo {
   ThreadContextSet m_contextSet;
   // all the window surfaces that are created by this render thread
   WindowSurfaceSet m_windowSet;
+  // all the client images that are created by this render thread
+  ClientImageSet m_imageSet;
+  // all the fence syncs that are created by this render thread
+  FenceSyncSet m_syncSet;
+
+  // layers posted by this render thread for the next composition
+  RenderableList m_frameLayers;
 };
 
 #endif
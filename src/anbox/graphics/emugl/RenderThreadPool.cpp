@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "RenderThreadPool.h"
+#include "RenderThread.h"
+
+#include "anbox/logger.h"
+
+#include <algorithm>
+
+struct RenderThreadPool::Client {
+  IOStream* stream;
+  emugl::Mutex* lock;
+  pid_t owner;
+  bool done;
+};
+
+RenderThreadPool::RenderThreadPool(const std::shared_ptr<Renderer>& renderer,
+                                   size_t maxIdle)
+    : m_renderer(renderer), m_maxIdle(maxIdle), m_idle(0), m_stopping(false) {}
+
+RenderThreadPool::~RenderThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_stopping = true;
+    // No thread picks them up anymore.
+    for (const auto& client : m_waiting)
+      client->done = true;
+    m_waiting.clear();
+  }
+  m_clientWaiting.notify_all();
+  m_clientDone.notify_all();
+
+  for (const auto& thread : m_threads)
+    thread->wait(nullptr);
+}
+
+void RenderThreadPool::prewarm(size_t count) {
+  std::lock_guard<std::mutex> lock(m_lock);
+  for (size_t n = 0; n < count; n++) {
+    if (!startThreadLocked())
+      break;
+  }
+}
+
+std::shared_ptr<RenderThreadPool::Client> RenderThreadPool::serve(
+    IOStream* stream, emugl::Mutex* lock, pid_t owner) {
+  auto client = std::make_shared<Client>(Client{stream, lock, owner, false});
+
+  std::lock_guard<std::mutex> l(m_lock);
+  reapLocked();
+
+  // Idle threads which got notified already but didn't pick up their
+  // client yet still count as idle.
+  m_waiting.push_back(client);
+  if (m_waiting.size() <= m_idle) {
+    m_clientWaiting.notify_one();
+  } else if (!startThreadLocked()) {
+    m_waiting.pop_back();
+    return nullptr;
+  }
+  return client;
+}
+
+void RenderThreadPool::stop(const std::shared_ptr<Client>& client) {
+  client->stream->forceStop();
+
+  std::unique_lock<std::mutex> lock(m_lock);
+  // A client no thread picked up yet is done once it is dropped.
+  const auto waiting = std::find(m_waiting.begin(), m_waiting.end(), client);
+  if (waiting != m_waiting.end()) {
+    m_waiting.erase(waiting);
+    client->done = true;
+    return;
+  }
+  m_clientDone.wait(lock, [&]() { return client->done; });
+}
+
+bool RenderThreadPool::nextClient(RenderThread* thread, bool reusable) {
+  std::unique_lock<std::mutex> lock(m_lock);
+
+  const auto served = m_serving.find(thread);
+  if (served != m_serving.end()) {
+    served->second->done = true;
+    m_serving.erase(served);
+    thread->m_stream = nullptr;
+    thread->m_lock = nullptr;
+    thread->m_owner = 0;
+    m_clientDone.notify_all();
+  }
+
+  if (m_stopping || !reusable || (m_waiting.empty() && m_idle >= m_maxIdle)) {
+    m_exited.push_back(thread);
+    return false;
+  }
+
+  m_idle++;
+  m_clientWaiting.wait(lock, [&]() { return m_stopping || !m_waiting.empty(); });
+  m_idle--;
+
+  if (m_stopping)
+    return false;
+
+  const auto client = m_waiting.front();
+  m_waiting.pop_front();
+  m_serving[thread] = client;
+  thread->m_stream = client->stream;
+  thread->m_lock = client->lock;
+  thread->m_owner = client->owner;
+  return true;
+}
+
+bool RenderThreadPool::startThreadLocked() {
+  std::unique_ptr<RenderThread> thread(
+      new RenderThread(m_renderer, nullptr, nullptr, this));
+  if (!thread->start()) {
+    ERROR("Failed to start render thread");
+    return false;
+  }
+  m_threads.push_back(std::move(thread));
+  return true;
+}
+
+void RenderThreadPool::reapLocked() {
+  for (const auto exited : m_exited) {
+    const auto thread = std::find_if(
+        m_threads.begin(), m_threads.end(),
+        [exited](const std::unique_ptr<RenderThread>& t) { return t.get() == exited; });
+    if (thread == m_threads.end())
+      continue;
+    // It only has to return from its main() still.
+    (*thread)->wait(nullptr);
+    m_threads.erase(thread);
+  }
+  m_exited.clear();
+}
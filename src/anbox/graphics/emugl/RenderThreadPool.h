@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_GRAPHICS_EMUGL_RENDER_THREAD_POOL_H_
+#define ANBOX_GRAPHICS_EMUGL_RENDER_THREAD_POOL_H_
+
+#include "emugl/common/mutex.h"
+
+#include <sys/types.h>
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class IOStream;
+class RenderThread;
+class Renderer;
+
+// Keeps render threads around once their client is gone to serve the next
+// one. A new render thread has to resolve all GL functions for its
+// decoders first, which apps creating and destroying GL threads all the
+// time would pay for again and again.
+class RenderThreadPool {
+ public:
+  // A client served by the pool.
+  struct Client;
+
+  // At most |maxIdle| threads wait for a client, all others exit once
+  // their client is gone.
+  RenderThreadPool(const std::shared_ptr<Renderer>& renderer, size_t maxIdle);
+  // All clients have to be stopped before.
+  ~RenderThreadPool();
+
+  RenderThreadPool(const RenderThreadPool&) = delete;
+  RenderThreadPool& operator=(const RenderThreadPool&) = delete;
+
+  // Start |count| threads before any client arrives.
+  void prewarm(size_t count);
+
+  // Serve the client on |stream| on an idle thread or on a new one if none
+  // is idle. |lock| is used as described for RenderThread::create(). The
+  // client can use the buffer memory the guest process |owner| shared, see
+  // SharedBufferMemory, 0 if it can't share any.
+  // Returns NULL if no thread could be started.
+  std::shared_ptr<Client> serve(IOStream* stream, emugl::Mutex* lock, pid_t owner = 0);
+
+  // Force the stream of |client| to stop and wait until its thread is done
+  // with it.
+  void stop(const std::shared_ptr<Client>& client);
+
+ private:
+  friend class RenderThread;
+
+  // Called by a thread of the pool whenever it's done with a client,
+  // and once before its first one. Returns false if the thread has to
+  // exit, otherwise it serves the next client.
+  bool nextClient(RenderThread* thread, bool reusable);
+
+  bool startThreadLocked();
+  // Joins threads which exited on their own.
+  void reapLocked();
+
+  const std::shared_ptr<Renderer> m_renderer;
+  const size_t m_maxIdle;
+
+  std::mutex m_lock;
+  std::condition_variable m_clientWaiting;
+  std::condition_variable m_clientDone;
+  std::deque<std::shared_ptr<Client>> m_waiting;
+  std::map<RenderThread*, std::shared_ptr<Client>> m_serving;
+  std::vector<std::unique_ptr<RenderThread>> m_threads;
+  std::vector<RenderThread*> m_exited;
+  size_t m_idle;
+  bool m_stopping;
+};
+
+#endif
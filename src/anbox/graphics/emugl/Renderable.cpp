@@ -16,37 +16,28 @@
 
 #include "Renderable.h"
 
-Renderable::Renderable(const std::string &name, const std::uint32_t &buffer,
+Renderable::Renderable(const anbox::graphics::LayerName &name,
+                       const std::uint32_t &buffer,
                        const anbox::graphics::Rect &screen_position,
                        const anbox::graphics::Rect &crop,
-                       const glm::mat4 &transformation, const float &alpha)
+                       const glm::mat4 &transformation, const float &alpha,
+                       const Blending &blending)
     : name_(name),
       buffer_(buffer),
       screen_position_(screen_position),
       crop_(crop),
-      transformation_(transformation),
-      alpha_(alpha) {}
-
-Renderable::~Renderable() {}
-
-std::string Renderable::name() const { return name_; }
-
-std::uint32_t Renderable::buffer() const { return buffer_; }
-
-anbox::graphics::Rect Renderable::screen_position() const {
-  return screen_position_;
-}
-
-anbox::graphics::Rect Renderable::crop() const { return crop_; }
+      alpha_(alpha),
+      blending_(blending),
+      identity_(transformation == glm::mat4()),
+      transformation_(transformation) {}
 
-glm::mat4 Renderable::transformation() const { return transformation_; }
-
-float Renderable::alpha() const { return alpha_; }
-
-void Renderable::set_screen_position(
-    const anbox::graphics::Rect &screen_position) {
-  screen_position_ = screen_position;
-}
+Renderable::Renderable(const std::string &name, const std::uint32_t &buffer,
+                       const anbox::graphics::Rect &screen_position,
+                       const anbox::graphics::Rect &crop,
+                       const glm::mat4 &transformation, const float &alpha,
+                       const Blending &blending)
+    : Renderable(anbox::graphics::LayerName{name}, buffer, screen_position,
+                 crop, transformation, alpha, blending) {}
 
 std::ostream &operator<<(std::ostream &out, const Renderable &r) {
   return out << "{ name " << r.name() << " buffer " << r.buffer()
@@ -17,6 +17,7 @@
 #ifndef ANBOX_GRAPHICS_EMUGL_RENDERABLE_H_
 #define ANBOX_GRAPHICS_EMUGL_RENDERABLE_H_
 
+#include "anbox/graphics/layer_name.h"
 #include "anbox/graphics/rect.h"
 
 #include <string>
@@ -26,27 +27,54 @@
 
 #include <glm/glm.hpp>
 
+// A single layer of a frame. Renderables are created for every layer of
+// every frame the guest posts, so they only hold plain values and an
+// interned name and can be copied without any heap allocation.
 class Renderable {
  public:
+  // How the layer is combined with what is below it.
+  enum class Blending : std::uint8_t {
+    // Replaces it, the alpha channel of the buffer is ignored.
+    None,
+    // The buffer holds premultiplied alpha.
+    Premultiplied,
+    // The buffer holds straight alpha.
+    Coverage,
+  };
+
+  Renderable(const anbox::graphics::LayerName &name,
+             const std::uint32_t &buffer,
+             const anbox::graphics::Rect &screen_position,
+             const anbox::graphics::Rect &crop = {},
+             const glm::mat4 &transformation = {}, const float &alpha = 1.0f,
+             const Blending &blending = Blending::Premultiplied);
   Renderable(const std::string &name, const std::uint32_t &buffer,
              const anbox::graphics::Rect &screen_position,
              const anbox::graphics::Rect &crop = {},
-             const glm::mat4 &transformation = {}, const float &alpha = 1.0f);
-  ~Renderable();
+             const glm::mat4 &transformation = {}, const float &alpha = 1.0f,
+             const Blending &blending = Blending::Premultiplied);
 
-  std::string name() const;
-  std::uint32_t buffer() const;
-  anbox::graphics::Rect screen_position() const;
-  anbox::graphics::Rect crop() const;
-  glm::mat4 transformation() const;
-  float alpha() const;
+  const std::string &name() const { return name_.str(); }
+  const anbox::graphics::LayerName &layer_name() const { return name_; }
+  std::uint32_t buffer() const { return buffer_; }
+  const anbox::graphics::Rect &screen_position() const { return screen_position_; }
+  const anbox::graphics::Rect &crop() const { return crop_; }
+  const glm::mat4 &transformation() const { return transformation_; }
+  // Lets the common case skip any matrix math or comparisons.
+  bool has_identity_transformation() const { return identity_; }
+  float alpha() const { return alpha_; }
+  Blending blending() const { return blending_; }
 
-  void set_screen_position(const anbox::graphics::Rect &screen_position);
+  void set_screen_position(const anbox::graphics::Rect &screen_position) {
+    screen_position_ = screen_position;
+  }
 
   inline bool operator==(const Renderable &rhs) const {
-    return (name_ == rhs.name() && buffer_ == rhs.buffer() &&
-            screen_position_ == rhs.screen_position() && crop_ == rhs.crop() &&
-            transformation_ == rhs.transformation() && alpha_ == rhs.alpha());
+    return (name_ == rhs.name_ && buffer_ == rhs.buffer_ &&
+            screen_position_ == rhs.screen_position_ && crop_ == rhs.crop_ &&
+            identity_ == rhs.identity_ &&
+            (identity_ || transformation_ == rhs.transformation_) &&
+            alpha_ == rhs.alpha_ && blending_ == rhs.blending_);
   }
 
   inline bool operator!=(const Renderable &rhs) const {
@@ -54,12 +82,14 @@ class Renderable {
   }
 
  private:
-  std::string name_;
+  anbox::graphics::LayerName name_;
   std::uint32_t buffer_;
   anbox::graphics::Rect screen_position_;
   anbox::graphics::Rect crop_;
-  glm::mat4 transformation_;
   float alpha_;
+  Blending blending_;
+  bool identity_;
+  glm::mat4 transformation_;
 };
 
 std::ostream &operator<<(std::ostream &out, const Renderable &r);
@@ -18,22 +18,84 @@
 
 #include "DispatchTables.h"
 #include "RenderThreadInfo.h"
+#include "SwapChain.h"
 #include "TimeUtils.h"
 #include "gles2_dec.h"
+#include "glUtils.h"
 
 #include "OpenGLESDispatch/EGLDispatch.h"
 
+#include "anbox/common/tracer.h"
+#include "anbox/config.h"
 #include "anbox/graphics/gl_extensions.h"
+#include "anbox/graphics/layer_occlusion.h"
 
 #include "anbox/logger.h"
 
+#include <algorithm>
+#include <string>
+
+#include <errno.h>
+#include <stddef.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/transform.hpp>
 
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+#ifndef EGL_PLATFORM_DEVICE_EXT
+#define EGL_PLATFORM_DEVICE_EXT 0x313F
+#endif
+#ifndef EGL_DRM_RENDER_NODE_FILE_EXT
+#define EGL_DRM_RENDER_NODE_FILE_EXT 0x3377
+#endif
+
 namespace {
+// Buffers exported per window. With three the window renders into one
+// while a consumer still works on the frame before and another one is
+// ready to be picked up.
+constexpr size_t exportBuffersPerWindow = 3;
+
+// DRM_FORMAT_ABGR8888 from drm_fourcc.h, the layout of GL_RGBA pixels.
+constexpr uint32_t drmFormatAbgr8888 = 'A' | ('B' << 8) | ('2' << 16) | ('4' << 24);
+// DRM_FORMAT_ARGB8888, the layout of GL_BGRA_EXT pixels.
+constexpr uint32_t drmFormatArgb8888 = 'A' | ('R' << 8) | ('2' << 16) | ('4' << 24);
+
+size_t colorBufferBytes(int width, int height, GLenum internalFormat,
+                        uint32_t usage) {
+  // Video frames are kept as planes of 12 bits per pixel. Only buffers
+  // sampled by guest contexts get converted to RGBA in addition.
+  if (usage & (ColorBuffer::USAGE_YV12 | ColorBuffer::USAGE_NV21)) {
+    size_t bytes = static_cast<size_t>(width) * height * 3 / 2;
+    if (usage & ColorBuffer::USAGE_SAMPLE)
+      bytes += static_cast<size_t>(width) * height * 4;
+    return bytes;
+  }
+
+  size_t bytes_per_pixel = 4;
+  switch (internalFormat) {
+    case GL_RGB565:
+    case GL_RGB5_A1:
+    case GL_RGBA4:
+      bytes_per_pixel = 2;
+      break;
+    default:
+      break;
+  }
+  return static_cast<size_t>(width) * height * bytes_per_pixel;
+}
+
+// Only an estimate as we don't look at the color, depth and stencil
+// sizes of the config the Pbuffer was created with.
+size_t windowSurfaceBytes(unsigned int width, unsigned int height) {
+  return static_cast<size_t>(width) * height * 4;
+}
 
 // Helper class to call the bind_locked() / unbind_locked() properly.
 class ScopedBind {
@@ -77,25 +139,93 @@ class ColorBufferHelper : public ColorBuffer::Helper {
 
   virtual TextureDraw *getTextureDraw() const { return mFb->getTextureDraw(); }
 
+  virtual PixelStream *getPixelStream() const { return mFb->getPixelStream(); }
+
+  virtual bool canBlitFramebuffer() const { return mFb->canBlitFramebuffer(); }
+
+  virtual bool canReadBgra() const { return mFb->getCaps().has_bgra_read; }
+
+  virtual anbox::graphics::ProgramFamily &getProgramFamily() const {
+    return mFb->getProgramFamily();
+  }
+
  private:
   Renderer *mFb;
 };
 }  // namespace
 
-HandleType Renderer::s_nextHandle = 0;
+const size_t Renderer::colorBufferPoolMaxBytes = 64 * 1024 * 1024;
 
 void Renderer::finalize() {
+  // Every color buffer binds our context to release its texture. With it
+  // bound once for all of them here that doesn't switch contexts for each.
+  const auto bound = bind_locked();
+  if (bound && m_composeVbo != 0) {
+    s_gles2.glDeleteBuffers(1, &m_composeVbo);
+    m_composeVbo = 0;
+    m_composeVboSize = 0;
+    m_composeVboWindow = nullptr;
+  }
+  if (bound) {
+    delete m_pixelStream;
+    m_pixelStream = nullptr;
+  }
+
   m_colorbuffers.clear();
+
+  const auto &stats = m_colorBufferPool.statistics();
+  DEBUG("Color buffer pool: %llu hits %llu misses %llu evictions",
+        static_cast<unsigned long long>(stats.hits),
+        static_cast<unsigned long long>(stats.misses),
+        static_cast<unsigned long long>(stats.evictions));
+  m_colorBufferPool.clear();
+
   m_windows.clear();
+  if (bound)
+    unbind_locked();
   m_contexts.clear();
-  s_egl.eglMakeCurrent(m_eglDisplay, NULL, NULL, NULL);
+  CurrentContext::makeCurrent(m_eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                              EGL_NO_CONTEXT);
   s_egl.eglDestroyContext(m_eglDisplay, m_eglContext);
   s_egl.eglDestroyContext(m_eglDisplay, m_pbufContext);
   s_egl.eglDestroySurface(m_eglDisplay, m_pbufSurface);
 }
 
-bool Renderer::initialize(EGLNativeDisplayType nativeDisplay) {
-  m_eglDisplay = s_egl.eglGetDisplay(nativeDisplay);
+bool Renderer::initialize(EGLNativeDisplayType nativeDisplay, bool headless,
+                          const std::string &renderNode) {
+  m_eglDisplay = EGL_NO_DISPLAY;
+  if (headless && s_egl.eglGetPlatformDisplayEXT) {
+    // Client extensions are only reported by implementations supporting
+    // them, others return NULL here.
+    const auto client_extensions = s_egl.eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    const anbox::graphics::GLExtensions extensions{client_extensions ? client_extensions : ""};
+    if (!renderNode.empty() && extensions.support("EGL_EXT_platform_device") &&
+        s_egl.eglQueryDevicesEXT && s_egl.eglQueryDeviceStringEXT) {
+      EGLint numDevices = 0;
+      if (s_egl.eglQueryDevicesEXT(0, nullptr, &numDevices) && numDevices > 0) {
+        std::vector<EGLDeviceEXT> devices(numDevices);
+        s_egl.eglQueryDevicesEXT(numDevices, devices.data(), &numDevices);
+        for (EGLint n = 0; n < numDevices && m_eglDisplay == EGL_NO_DISPLAY; n++) {
+          const auto node = s_egl.eglQueryDeviceStringEXT(devices[n], EGL_DRM_RENDER_NODE_FILE_EXT);
+          if (!node || renderNode != node)
+            continue;
+          DEBUG("Using the EGL device of %s", renderNode);
+          m_eglDisplay = s_egl.eglGetPlatformDisplayEXT(EGL_PLATFORM_DEVICE_EXT, devices[n], nullptr);
+        }
+      }
+      if (m_eglDisplay == EGL_NO_DISPLAY)
+        WARNING("EGL has no device for %s", renderNode);
+    }
+
+    if (m_eglDisplay == EGL_NO_DISPLAY && extensions.support("EGL_MESA_platform_surfaceless")) {
+      DEBUG("Using the surfaceless EGL platform");
+      m_eglDisplay = s_egl.eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA,
+                                                    EGL_DEFAULT_DISPLAY, nullptr);
+    }
+  }
+
+  if (m_eglDisplay == EGL_NO_DISPLAY)
+    m_eglDisplay = s_egl.eglGetDisplay(nativeDisplay);
   if (m_eglDisplay == EGL_NO_DISPLAY) {
     ERROR("Failed to Initialize backend EGL display");
     return false;
@@ -115,7 +245,9 @@ bool Renderer::initialize(EGLNativeDisplayType nativeDisplay) {
   s_egl.eglBindAPI(EGL_OPENGL_ES_API);
 
   // Create EGL context for framebuffer post rendering.
-  GLint surfaceType = EGL_WINDOW_BIT | EGL_PBUFFER_BIT;
+  // Without native windows we don't need their support which the
+  // surfaceless platform doesn't have anyway.
+  GLint surfaceType = headless ? EGL_PBUFFER_BIT : EGL_WINDOW_BIT | EGL_PBUFFER_BIT;
   const GLint configAttribs[] = {EGL_RED_SIZE, 1,
                                  EGL_GREEN_SIZE, 1,
                                  EGL_BLUE_SIZE, 1,
@@ -178,11 +310,33 @@ bool Renderer::initialize(EGLNativeDisplayType nativeDisplay) {
   if (gl_extensions.support("GL_OES_EGL_image")) {
     m_caps.has_eglimage_texture_2d = egl_extensions.support("EGL_KHR_gl_texture_2D_image");
     m_caps.has_eglimage_renderbuffer = egl_extensions.support("EGL_KHR_gl_renderbuffer_image");
+    m_caps.has_dma_buf_import = egl_extensions.support("EGL_EXT_image_dma_buf_import");
+    m_caps.has_dma_buf_export = egl_extensions.support("EGL_MESA_image_dma_buf_export") &&
+                                s_egl.eglExportDMABUFImageQueryMESA &&
+                                s_egl.eglExportDMABUFImageMESA;
   } else {
     m_caps.has_eglimage_texture_2d = false;
     m_caps.has_eglimage_renderbuffer = false;
+    m_caps.has_dma_buf_import = false;
+    m_caps.has_dma_buf_export = false;
   }
 
+  m_caps.has_fence_sync = egl_extensions.support("EGL_KHR_fence_sync") &&
+                          s_egl.eglCreateSyncKHR && s_egl.eglDestroySyncKHR &&
+                          s_egl.eglClientWaitSyncKHR;
+  m_caps.has_wait_sync = m_caps.has_fence_sync &&
+                         egl_extensions.support("EGL_KHR_wait_sync") &&
+                         s_egl.eglWaitSyncKHR;
+  // Many guest and host sources produce BGRA. Stored as such uploading
+  // and reading it back doesn't need swapping channels.
+  m_caps.has_bgra_texture = gl_extensions.support("GL_EXT_texture_format_BGRA8888");
+  m_caps.has_bgra_read = gl_extensions.support("GL_EXT_read_format_bgra");
+
+  if (m_caps.has_fence_sync)
+    FenceSync::initialize(m_eglDisplay, m_caps.has_wait_sync);
+  else
+    DEBUG("EGL_KHR_fence_sync not supported, color buffer accesses are not fenced");
+
   // Fail initialization if not all of the following extensions
   // exist:
   //     EGL_KHR_gl_texture_2d_image
@@ -234,15 +388,32 @@ bool Renderer::initialize(EGLNativeDisplayType nativeDisplay) {
   m_glRenderer = reinterpret_cast<const char *>(s_gles2.glGetString(GL_RENDERER));
   m_glVersion = reinterpret_cast<const char *>(s_gles2.glGetString(GL_VERSION));
 
-  m_textureDraw = new TextureDraw(m_eglDisplay);
+  // Compositor programs are loaded from their cached binaries when possible
+  // to avoid compiling all shaders again on every start.
+  const boost::filesystem::path cache_dir =
+      anbox::SystemConfiguration::instance().cache_dir();
+  m_family.enable_binary_cache(cache_dir / "programs");
+
+  m_textureDraw = new TextureDraw(m_eglDisplay, m_family);
   if (!m_textureDraw) {
     ERROR("Failed: creation of TextureDraw instance");
     bind.release();
     return false;
   }
 
+  m_pixelStream = PixelStream::create();
+  if (m_pixelStream)
+    DEBUG("Streaming color buffer updates through pixel buffer objects");
+
+  // Guest contexts are created just like ours, so they get a GLES 3.x
+  // context whenever we did.
+  m_canBlitFramebuffer = m_pixelStream && s_gles2.glBlitFramebuffer;
+
   m_defaultProgram = m_family.add_program(vshader, defaultFShader);
   m_alphaProgram = m_family.add_program(vshader, alphaFShader);
+  m_yuvProgram = m_family.add_program(
+      vshader, (std::string(yuvFShader) + ColorBuffer::yuvSamplerSource +
+                yuvMainFShader).c_str());
 
   bind.release();
 
@@ -256,13 +427,17 @@ Renderer::Program::Program(GLuint program_id) {
   position_attr = s_gles2.glGetAttribLocation(id, "position");
   texcoord_attr = s_gles2.glGetAttribLocation(id, "texcoord");
   tex_uniform = s_gles2.glGetUniformLocation(id, "tex");
-  center_uniform = s_gles2.glGetUniformLocation(id, "centre");
+  center_uniform = s_gles2.glGetUniformLocation(id, "center");
   display_transform_uniform =
       s_gles2.glGetUniformLocation(id, "display_transform");
   transform_uniform = s_gles2.glGetUniformLocation(id, "transform");
   screen_to_gl_coords_uniform =
       s_gles2.glGetUniformLocation(id, "screen_to_gl_coords");
   alpha_uniform = s_gles2.glGetUniformLocation(id, "alpha");
+  plane_size_uniform = s_gles2.glGetUniformLocation(id, "uPlaneSize");
+  frame_size_uniform = s_gles2.glGetUniformLocation(id, "uFrameSize");
+  strides_uniform = s_gles2.glGetUniformLocation(id, "uStrides");
+  chroma_uniform = s_gles2.glGetUniformLocation(id, "uChroma");
 }
 
 Renderer::Renderer()
@@ -271,9 +446,6 @@ Renderer::Renderer()
       m_colorBufferHelper(new ColorBufferHelper(this)),
       m_eglContext(EGL_NO_CONTEXT),
       m_pbufContext(EGL_NO_CONTEXT),
-      m_prevContext(EGL_NO_CONTEXT),
-      m_prevReadSurf(EGL_NO_SURFACE),
-      m_prevDrawSurf(EGL_NO_SURFACE),
       m_textureDraw(NULL),
       m_lastPostedColorBuffer(0),
       m_statsNumFrames(0),
@@ -293,29 +465,192 @@ Renderer::~Renderer() {
 struct RendererWindow {
   EGLNativeWindowType native_window = 0;
   EGLSurface surface = EGL_NO_SURFACE;
+  // Frame |screen_to_gl_coords| was computed for, empty until the first
+  // draw.
   anbox::graphics::Rect viewport;
   glm::mat4 screen_to_gl_coords;
   glm::mat4 display_transform;
+
+  // What the quads of the layers drawn last were tessellated from and
+  // their vertices. Layers rarely move or change their buffer so most
+  // frames neither tessellate nor upload anything.
+  struct Quad {
+    anbox::graphics::Rect buf_size;
+    anbox::graphics::Rect crop;
+    anbox::graphics::Rect screen_position;
+  };
+  std::vector<Quad> quads;
+  std::vector<anbox::graphics::Vertex> vertices;
+
+  // Buffers composed frames go to instead of |surface| when the window
+  // is exported. The surface is then only used to bind the context.
+  struct ExportBuffer {
+    GLuint texture = 0;
+    GLuint framebuffer = 0;
+    EGLImageKHR image = EGL_NO_IMAGE_KHR;
+  };
+  std::vector<ExportBuffer> export_buffers;
+  size_t next_export_buffer = 0;
+  uint32_t export_id = 0;
+
+  Renderer::SwapPolicy swap_policy = Renderer::SwapPolicy::Fifo;
+  // Interval the surface swaps with currently, -1 if never set.
+  int swap_interval = -1;
+  // Presents the frames of windows with SwapPolicy::Mailbox.
+  std::unique_ptr<SwapChain> swap_chain;
 };
 
 RendererWindow *Renderer::createNativeWindow(
-    EGLNativeWindowType native_window) {
-  m_lock.lock();
+    EGLNativeWindowType native_window, const std::string &package) {
+  emugl::Mutex::AutoLock mutex(m_lock);
 
-  auto window = new RendererWindow;
-  window->native_window = native_window;
-  window->surface = s_egl.eglCreateWindowSurface(
-      m_eglDisplay, m_eglConfig, window->native_window, nullptr);
-  if (window->surface == EGL_NO_SURFACE) {
-    delete window;
-    m_lock.unlock();
+  auto surface = s_egl.eglCreateWindowSurface(
+      m_eglDisplay, m_eglConfig, native_window, nullptr);
+  if (surface == EGL_NO_SURFACE)
     return nullptr;
+
+  // Profiles only ever relax waiting for the vertical blank, tearing is
+  // never something we pick for an app.
+  auto swap_policy = m_swapPolicy;
+  if (m_appProfiles && swap_policy == SwapPolicy::Fifo &&
+      m_appProfiles->settings_for(package).mailbox) {
+    INFO("Presenting windows of %s through a swap chain as it misses the vsync often",
+         package);
+    swap_policy = SwapPolicy::Mailbox;
+  }
+
+  auto window = addWindow_locked(native_window, surface);
+  if (!window || swap_policy != SwapPolicy::Mailbox) {
+    if (window) window->swap_policy = swap_policy;
+    return window;
+  }
+
+  window->swap_chain.reset(new SwapChain(m_eglDisplay, m_eglConfig, m_eglContext, surface));
+  if (window->swap_chain->composeSurface() == EGL_NO_SURFACE) {
+    WARNING("Falling back to swapping the window directly");
+    window->swap_chain.reset();
+    return window;
+  }
+  window->swap_policy = SwapPolicy::Mailbox;
+
+  return window;
+}
+
+RendererWindow *Renderer::createOffscreenWindow(
+    EGLNativeWindowType native_window, int width, int height) {
+  emugl::Mutex::AutoLock mutex(m_lock);
+
+  const EGLint attribs[] = {EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE};
+  auto surface = s_egl.eglCreatePbufferSurface(m_eglDisplay, m_eglConfig, attribs);
+  if (surface == EGL_NO_SURFACE) {
+    ERROR("Failed to create %dx%d offscreen window: error=0x%x",
+          width, height, s_egl.eglGetError());
+    return nullptr;
+  }
+
+  auto window = addWindow_locked(native_window, surface);
+  if (!window || !m_frameExporter)
+    return window;
+
+  if (!m_caps.has_dma_buf_export) {
+    WARNING("Can't export window as EGL doesn't support exporting dmabufs");
+    return window;
+  }
+
+  if (!bindWindow_locked(window))
+    return window;
+  if (!exportWindow_locked(window, width, height))
+    ERROR("Failed to export %dx%d offscreen window", width, height);
+  unbind_locked();
+
+  return window;
+}
+
+bool Renderer::exportWindow_locked(RendererWindow *window, int width, int height) {
+  window->export_id = m_nextExportedWindow++;
+
+  for (size_t n = 0; n < exportBuffersPerWindow; n++) {
+    window->export_buffers.push_back(RendererWindow::ExportBuffer{});
+    auto &buffer = window->export_buffers.back();
+
+    s_gles2.glGenTextures(1, &buffer.texture);
+    s_gles2.glBindTexture(GL_TEXTURE_2D, buffer.texture);
+    s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    s_gles2.glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
+                         GL_UNSIGNED_BYTE, nullptr);
+
+    s_gles2.glGenFramebuffers(1, &buffer.framebuffer);
+    s_gles2.glBindFramebuffer(GL_FRAMEBUFFER, buffer.framebuffer);
+    s_gles2.glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                   GL_TEXTURE_2D, buffer.texture, 0);
+    if (s_gles2.glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+      break;
+
+    buffer.image = s_egl.eglCreateImageKHR(
+        m_eglDisplay, m_eglContext, EGL_GL_TEXTURE_2D_KHR,
+        reinterpret_cast<EGLClientBuffer>(static_cast<uintptr_t>(buffer.texture)), nullptr);
+    if (buffer.image == EGL_NO_IMAGE_KHR)
+      break;
+
+    int format = 0, planes = 0;
+    EGLuint64KHR modifier = 0;
+    if (!s_egl.eglExportDMABUFImageQueryMESA(m_eglDisplay, buffer.image, &format,
+                                             &planes, &modifier) ||
+        planes != 1)
+      break;
+
+    int fd = -1;
+    EGLint stride = 0, offset = 0;
+    if (!s_egl.eglExportDMABUFImageMESA(m_eglDisplay, buffer.image, &fd, &stride, &offset))
+      break;
+
+    m_frameExporter->add_buffer(
+        window->export_id, static_cast<uint32_t>(n),
+        anbox::graphics::FrameExporter::Buffer{
+            anbox::Fd{fd}, static_cast<uint32_t>(width), static_cast<uint32_t>(height),
+            static_cast<uint32_t>(format), static_cast<uint32_t>(stride),
+            static_cast<uint32_t>(offset), static_cast<uint64_t>(modifier)});
+  }
+
+  s_gles2.glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  if (window->export_buffers.size() != exportBuffersPerWindow ||
+      window->export_buffers.back().image == EGL_NO_IMAGE_KHR) {
+    releaseExportBuffers_locked(window);
+    return false;
+  }
+
+  // Textures have their first row at the bottom; consumers expect frames
+  // to start at the top.
+  window->display_transform = glm::scale(glm::mat4(1.0f), glm::vec3{1.0f, -1.0f, 1.0f});
+  return true;
+}
+
+void Renderer::releaseExportBuffers_locked(RendererWindow *window) {
+  if (window->export_buffers.empty())
+    return;
+
+  for (const auto &buffer : window->export_buffers) {
+    if (buffer.image != EGL_NO_IMAGE_KHR)
+      s_egl.eglDestroyImageKHR(m_eglDisplay, buffer.image);
+    s_gles2.glDeleteFramebuffers(1, &buffer.framebuffer);
+    s_gles2.glDeleteTextures(1, &buffer.texture);
   }
+  window->export_buffers.clear();
+
+  m_frameExporter->remove_window(window->export_id);
+}
+
+RendererWindow *Renderer::addWindow_locked(EGLNativeWindowType native_window,
+                                           EGLSurface surface) {
+  auto window = new RendererWindow;
+  window->native_window = native_window;
+  window->surface = surface;
 
   if (!bindWindow_locked(window)) {
     s_egl.eglDestroySurface(m_eglDisplay, window->surface);
     delete window;
-    m_lock.unlock();
     return nullptr;
   }
 
@@ -327,50 +662,87 @@ RendererWindow *Renderer::createNativeWindow(
 
   m_nativeWindows.insert({native_window, window});
 
-  m_lock.unlock();
-
   return window;
 }
 
 void Renderer::destroyNativeWindow(EGLNativeWindowType native_window) {
+  m_lock.lock();
+
   auto w = m_nativeWindows.find(native_window);
-  if (w == m_nativeWindows.end()) return;
+  if (w == m_nativeWindows.end()) {
+    m_lock.unlock();
+    return;
+  }
 
-  m_lock.lock();
+  if (!w->second->export_buffers.empty() && bindWindow_locked(w->second)) {
+    releaseExportBuffers_locked(w->second);
+    unbind_locked();
+  }
 
-  s_egl.eglMakeCurrent(m_eglDisplay, nullptr, nullptr, nullptr);
+  if (w->second->swap_chain && bindWindow_locked(w->second)) {
+    w->second->swap_chain->releaseBuffers();
+    unbind_locked();
+  }
+
+  CurrentContext::makeCurrent(m_eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                              EGL_NO_CONTEXT);
+
+  // Stops presenting before the surface goes away.
+  w->second->swap_chain.reset();
 
   if (w->second->surface != EGL_NO_SURFACE)
     s_egl.eglDestroySurface(m_eglDisplay, w->second->surface);
 
+  if (m_composeVboWindow == w->second)
+    m_composeVboWindow = nullptr;
+
   delete w->second;
   m_nativeWindows.erase(w);
 
   m_lock.unlock();
 }
 
-HandleType Renderer::genHandle() {
-  HandleType id;
-  do {
-    id = ++s_nextHandle;
-  } while (id == 0 || m_contexts.find(id) != m_contexts.end() ||
-           m_windows.find(id) != m_windows.end());
-
-  return id;
-}
-
 HandleType Renderer::createColorBuffer(int p_width, int p_height,
-                                       GLenum p_internalFormat) {
+                                       GLenum p_internalFormat,
+                                       uint32_t p_usage) {
   emugl::Mutex::AutoLock mutex(m_lock);
   HandleType ret = 0;
 
-  ColorBufferPtr cb(ColorBuffer::create(
-      getDisplay(), p_width, p_height, p_internalFormat,
-      getCaps().has_eglimage_texture_2d, m_colorBufferHelper));
+  if (p_internalFormat == GL_BGRA_EXT && !m_caps.has_bgra_texture) {
+    ERROR("BGRA color buffers are not supported by the host");
+    return ret;
+  }
+
+  const auto bytes =
+      colorBufferBytes(p_width, p_height, p_internalFormat, p_usage);
+  if (!admitAllocation_locked(bytes)) {
+    ERROR("Refused to create %dx%d color buffer", p_width, p_height);
+    return ret;
+  }
+
+  ColorBufferPtr cb;
+  const ColorBufferPool::Key key{static_cast<uint32_t>(p_width),
+                                 static_cast<uint32_t>(p_height),
+                                 p_internalFormat, p_usage};
+  if (!m_colorBufferPool.acquire(key, cb)) {
+    cb = ColorBufferPtr(ColorBuffer::create(
+        getDisplay(), p_width, p_height, p_internalFormat,
+        getCaps().has_eglimage_texture_2d, m_colorBufferHelper, p_usage));
+  }
+
   if (cb.Ptr() != NULL) {
-    ret = genHandle();
-    m_colorbuffers[ret].cb = cb;
-    m_colorbuffers[ret].refcount = 1;
+    ColorBufferRef ref;
+    ref.cb = cb;
+    ref.refcount = 1;
+    ref.format = p_internalFormat;
+    ref.write_serial = ++m_writeSerial;
+    ref.untracked = false;
+    ret = m_colorbuffers.insert(ref);
+
+    RenderThreadInfo *tinfo = RenderThreadInfo::get();
+    if (ret && tinfo)
+      m_memoryAccounting.add(anbox::graphics::MemoryAccounting::Kind::ColorBuffer,
+                             ret, tinfo->m_id, bytes);
   }
   return ret;
 }
@@ -385,13 +757,18 @@ HandleType Renderer::createRenderContext(int p_config, HandleType p_share,
     return ret;
   }
 
+  if (!p_isGL2 && !ensureGLESv1Dispatch()) {
+    ERROR("Failed to load GLESv1 library");
+    return ret;
+  }
+
   RenderContextPtr share(NULL);
   if (p_share != 0) {
-    RenderContextMap::iterator s(m_contexts.find(p_share));
-    if (s == m_contexts.end()) {
+    RenderContextPtr *s = m_contexts.find(p_share);
+    if (!s) {
       return ret;
     }
-    share = (*s).second;
+    share = *s;
   }
   EGLContext sharedContext =
       share.Ptr() ? share->getEGLContext() : EGL_NO_CONTEXT;
@@ -399,10 +776,11 @@ HandleType Renderer::createRenderContext(int p_config, HandleType p_share,
   RenderContextPtr rctx(RenderContext::create(
       m_eglDisplay, config->getEglConfig(), sharedContext, p_isGL2));
   if (rctx.Ptr() != NULL) {
-    ret = genHandle();
-    m_contexts[ret] = rctx;
-    RenderThreadInfo *tinfo = RenderThreadInfo::get();
-    tinfo->m_contextSet.insert(ret);
+    ret = m_contexts.insert(rctx);
+    if (ret) {
+      RenderThreadInfo *tinfo = RenderThreadInfo::get();
+      tinfo->m_contextSet.insert(ret);
+    }
   }
   return ret;
 }
@@ -418,13 +796,22 @@ HandleType Renderer::createWindowSurface(int p_config, int p_width,
     return ret;
   }
 
+  const auto bytes = windowSurfaceBytes(p_width, p_height);
+  if (!admitAllocation_locked(bytes)) {
+    ERROR("Refused to create %dx%d window surface", p_width, p_height);
+    return ret;
+  }
+
   WindowSurfacePtr win(WindowSurface::create(
       getDisplay(), config->getEglConfig(), p_width, p_height));
   if (win.Ptr() != NULL) {
-    ret = genHandle();
-    m_windows[ret] = std::pair<WindowSurfacePtr, HandleType>(win, 0);
-    RenderThreadInfo *tinfo = RenderThreadInfo::get();
-    tinfo->m_windowSet.insert(ret);
+    ret = m_windows.insert(WindowSurfaceRef(win, 0));
+    if (ret) {
+      RenderThreadInfo *tinfo = RenderThreadInfo::get();
+      tinfo->m_windowSet.insert(ret);
+      m_memoryAccounting.add(anbox::graphics::MemoryAccounting::Kind::WindowSurface,
+                             ret, tinfo->m_id, bytes);
+    }
   }
 
   return ret;
@@ -449,22 +836,42 @@ void Renderer::drainWindowSurface() {
   for (std::set<HandleType>::iterator it = tinfo->m_windowSet.begin();
        it != tinfo->m_windowSet.end(); ++it) {
     HandleType windowHandle = *it;
-    if (m_windows.find(windowHandle) != m_windows.end()) {
-      HandleType oldColorBufferHandle = m_windows[windowHandle].second;
+    WindowSurfaceRef *w = m_windows.find(windowHandle);
+    if (w) {
+      HandleType oldColorBufferHandle = w->second;
       if (oldColorBufferHandle) {
-        ColorBufferMap::iterator cit(m_colorbuffers.find(oldColorBufferHandle));
-        if (cit != m_colorbuffers.end()) {
-          if (--(*cit).second.refcount == 0) {
-            m_colorbuffers.erase(cit);
+        ColorBufferRef *cit = m_colorbuffers.find(oldColorBufferHandle);
+        if (cit) {
+          if (--cit->refcount == 0) {
+            releaseColorBuffer_locked(oldColorBufferHandle, *cit);
           }
         }
       }
       m_windows.erase(windowHandle);
+      m_memoryAccounting.remove(anbox::graphics::MemoryAccounting::Kind::WindowSurface,
+                                windowHandle);
     }
   }
   tinfo->m_windowSet.clear();
 }
 
+void Renderer::drainClientImages() {
+  emugl::Mutex::AutoLock mutex(m_lock);
+  RenderThreadInfo *tinfo = RenderThreadInfo::get();
+  for (const auto &image : tinfo->m_imageSet) {
+    s_egl.eglDestroyImageKHR(m_eglDisplay, reinterpret_cast<EGLImageKHR>(image));
+    m_memoryAccounting.remove(anbox::graphics::MemoryAccounting::Kind::ClientImage, image);
+  }
+  tinfo->m_imageSet.clear();
+}
+
+void Renderer::drainSyncs() {
+  emugl::Mutex::AutoLock mutex(m_lock);
+  RenderThreadInfo *tinfo = RenderThreadInfo::get();
+  for (const auto &sync : tinfo->m_syncSet) m_syncs.erase(sync);
+  tinfo->m_syncSet.clear();
+}
+
 void Renderer::DestroyRenderContext(HandleType p_context) {
   emugl::Mutex::AutoLock mutex(m_lock);
   m_contexts.erase(p_context);
@@ -475,8 +882,9 @@ void Renderer::DestroyRenderContext(HandleType p_context) {
 
 void Renderer::DestroyWindowSurface(HandleType p_surface) {
   emugl::Mutex::AutoLock mutex(m_lock);
-  if (m_windows.find(p_surface) != m_windows.end()) {
-    m_windows.erase(p_surface);
+  if (m_windows.erase(p_surface)) {
+    m_memoryAccounting.remove(anbox::graphics::MemoryAccounting::Kind::WindowSurface,
+                              p_surface);
     RenderThreadInfo *tinfo = RenderThreadInfo::get();
     if (tinfo->m_windowSet.empty()) return;
     tinfo->m_windowSet.erase(p_surface);
@@ -485,45 +893,107 @@ void Renderer::DestroyWindowSurface(HandleType p_surface) {
 
 int Renderer::openColorBuffer(HandleType p_colorbuffer) {
   emugl::Mutex::AutoLock mutex(m_lock);
-  ColorBufferMap::iterator c(m_colorbuffers.find(p_colorbuffer));
-  if (c == m_colorbuffers.end()) {
+  ColorBufferRef *c = m_colorbuffers.find(p_colorbuffer);
+  if (!c) {
     // bad colorbuffer handle
     ERROR("FB: openColorBuffer cb handle %#x not found", p_colorbuffer);
     return -1;
   }
-  (*c).second.refcount++;
+  c->refcount++;
   return 0;
 }
 
 void Renderer::closeColorBuffer(HandleType p_colorbuffer) {
   emugl::Mutex::AutoLock mutex(m_lock);
-  ColorBufferMap::iterator c(m_colorbuffers.find(p_colorbuffer));
-  if (c == m_colorbuffers.end()) {
+  ColorBufferRef *c = m_colorbuffers.find(p_colorbuffer);
+  if (!c) {
     // This is harmless: it is normal for guest system to issue
     // closeColorBuffer command when the color buffer is already
     // garbage collected on the host. (we dont have a mechanism
     // to give guest a notice yet)
     return;
   }
-  if (--(*c).second.refcount == 0) {
-    m_colorbuffers.erase(c);
+  if (--c->refcount == 0) {
+    releaseColorBuffer_locked(p_colorbuffer, *c);
+  }
+}
+
+void Renderer::releaseColorBuffer_locked(HandleType p_colorbuffer,
+                                         const ColorBufferRef &ref) {
+  // We can only recycle buffers nobody else holds on to. A window surface
+  // may still have the buffer attached and buffers bound through an
+  // EGLImage can still be in use by textures of guest contexts. Buffers
+  // living in imported guest memory can't be handed to anyone else.
+  if (!ref.untracked && !ref.cb->hasExternalStorage() &&
+      ref.cb.getRefCount() == 1) {
+    const auto width = ref.cb->getWidth();
+    const auto height = ref.cb->getHeight();
+    m_colorBufferPool.release({width, height, ref.format, ref.cb->getUsage()},
+                              ref.cb,
+                              colorBufferBytes(width, height, ref.format,
+                                               ref.cb->getUsage()));
   }
+
+  m_colorbuffers.erase(p_colorbuffer);
+  m_memoryAccounting.remove(anbox::graphics::MemoryAccounting::Kind::ColorBuffer,
+                            p_colorbuffer);
+}
+
+Renderer::ColorBufferPool::Statistics Renderer::colorBufferPoolStatistics() {
+  emugl::Mutex::AutoLock mutex(m_lock);
+  return m_colorBufferPool.statistics();
+}
+
+bool Renderer::admitAllocation_locked(size_t bytes) {
+  RenderThreadInfo *tinfo = RenderThreadInfo::get();
+  if (!tinfo)
+    return true;
+
+  switch (m_memoryAccounting.admit(tinfo->m_id, bytes)) {
+    case anbox::graphics::MemoryAccounting::Admission::Denied:
+      return false;
+    case anbox::graphics::MemoryAccounting::Admission::AboveSoftQuota:
+      // The buffers sitting in the pool aren't used by anyone. Giving
+      // their memory back makes up for what the thread takes in addition.
+      m_colorBufferPool.evict(bytes);
+      break;
+    case anbox::graphics::MemoryAccounting::Admission::Granted:
+      break;
+  }
+  return true;
+}
+
+void Renderer::setMemoryQuota(const anbox::graphics::MemoryAccounting::Quota &quota) {
+  emugl::Mutex::AutoLock mutex(m_lock);
+  m_memoryAccounting.set_quota(quota);
+}
+
+anbox::graphics::MemoryAccounting::UsageMap Renderer::memoryUsage() {
+  emugl::Mutex::AutoLock mutex(m_lock);
+  return m_memoryAccounting.usage();
+}
+
+anbox::graphics::MemoryAccounting::Usage Renderer::memoryUsage(uint32_t renderThread) {
+  emugl::Mutex::AutoLock mutex(m_lock);
+  return m_memoryAccounting.usage(renderThread);
 }
 
 bool Renderer::flushWindowSurfaceColorBuffer(HandleType p_surface) {
   emugl::Mutex::AutoLock mutex(m_lock);
 
-  WindowSurfaceMap::iterator w(m_windows.find(p_surface));
-  if (w == m_windows.end()) {
+  WindowSurfaceRef *w = m_windows.find(p_surface);
+  if (!w) {
     ERROR("FB::flushWindowSurfaceColorBuffer: window handle %#x not found",
         p_surface);
     // bad surface handle
     return false;
   }
 
-  WindowSurface *surface = (*w).second.first.Ptr();
+  WindowSurface *surface = w->first.Ptr();
   surface->flushColorBuffer();
 
+  markColorBufferWritten_locked(w->second);
+
   return true;
 }
 
@@ -531,22 +1001,25 @@ bool Renderer::setWindowSurfaceColorBuffer(HandleType p_surface,
                                            HandleType p_colorbuffer) {
   emugl::Mutex::AutoLock mutex(m_lock);
 
-  WindowSurfaceMap::iterator w(m_windows.find(p_surface));
-  if (w == m_windows.end()) {
+  WindowSurfaceRef *w = m_windows.find(p_surface);
+  if (!w) {
     // bad surface handle
     ERROR("%s: bad window surface handle %#x", __FUNCTION__, p_surface);
     return false;
   }
 
-  ColorBufferMap::iterator c(m_colorbuffers.find(p_colorbuffer));
-  if (c == m_colorbuffers.end()) {
+  ColorBufferRef *c = m_colorbuffers.find(p_colorbuffer);
+  if (!c) {
     DEBUG("%s: bad color buffer handle %#x", __FUNCTION__, p_colorbuffer);
     // bad colorbuffer handle
     return false;
   }
 
-  (*w).second.first->setColorBuffer((*c).second.cb);
-  (*w).second.second = p_colorbuffer;
+  w->first->setColorBuffer(c->cb);
+  w->second = p_colorbuffer;
+  // The surface was resized to the buffer.
+  m_memoryAccounting.resize(anbox::graphics::MemoryAccounting::Kind::WindowSurface, p_surface,
+                            windowSurfaceBytes(w->first->getWidth(), w->first->getHeight()));
   return true;
 }
 
@@ -555,13 +1028,13 @@ void Renderer::readColorBuffer(HandleType p_colorbuffer, int x, int y,
                                GLenum type, void *pixels) {
   emugl::Mutex::AutoLock mutex(m_lock);
 
-  ColorBufferMap::iterator c(m_colorbuffers.find(p_colorbuffer));
-  if (c == m_colorbuffers.end()) {
+  ColorBufferRef *c = m_colorbuffers.find(p_colorbuffer);
+  if (!c) {
     // bad colorbuffer handle
     return;
   }
 
-  (*c).second.cb->readPixels(x, y, width, height, format, type, pixels);
+  c->cb->readPixels(x, y, width, height, format, type, pixels);
 }
 
 bool Renderer::updateColorBuffer(HandleType p_colorbuffer, int x, int y,
@@ -569,13 +1042,124 @@ bool Renderer::updateColorBuffer(HandleType p_colorbuffer, int x, int y,
                                  GLenum type, void *pixels) {
   emugl::Mutex::AutoLock mutex(m_lock);
 
-  ColorBufferMap::iterator c(m_colorbuffers.find(p_colorbuffer));
-  if (c == m_colorbuffers.end()) {
+  ColorBufferRef *c = m_colorbuffers.find(p_colorbuffer);
+  if (!c) {
+    // bad colorbuffer handle
+    return false;
+  }
+
+  c->cb->subUpdate(x, y, width, height, format, type, pixels);
+
+  markColorBufferWritten_locked(p_colorbuffer);
+
+  return true;
+}
+
+ColorBufferMemory::ColorBufferMemory(const uint8_t *data, size_t size)
+    : data(data), size(size) {}
+
+ColorBufferMemory::~ColorBufferMemory() {
+  ::munmap(const_cast<uint8_t *>(data), size);
+}
+
+bool Renderer::attachColorBufferMemory(HandleType p_colorbuffer, int fd,
+                                       size_t size) {
+  if (fd < 0 || size == 0) return false;
+
+  // Touching pages of a regular file (e.g. a memfd) beyond its end raises
+  // SIGBUS, so don't map more than the guest actually allocated. ashmem
+  // regions already refuse mappings larger than the region.
+  struct stat st;
+  if (::fstat(fd, &st) != 0) return false;
+  if (S_ISREG(st.st_mode) && static_cast<size_t>(st.st_size) < size) {
+    ERROR("Shared memory for color buffer %u is smaller than announced",
+          p_colorbuffer);
+    return false;
+  }
+
+  // ashmem regions and memfds are plain memory. Anything else may be a
+  // dma-buf the GPU can sample from directly, without any upload at all.
+  if (m_caps.has_dma_buf_import && !S_ISCHR(st.st_mode) &&
+      !S_ISREG(st.st_mode)) {
+    emugl::Mutex::AutoLock mutex(m_lock);
+
+    ColorBufferRef *c = m_colorbuffers.find(p_colorbuffer);
+    if (!c) {
+      // bad colorbuffer handle
+      return false;
+    }
+
+    // Only 32 bit buffers are unambiguous as gralloc creates both RGB565
+    // and RGB888 buffers as GL_RGB.
+    const auto width = c->cb->getWidth();
+    const auto fourcc = c->format == GL_BGRA_EXT ? drmFormatArgb8888 : drmFormatAbgr8888;
+    if ((c->format == GL_RGBA || c->format == GL_BGRA_EXT) &&
+        size >= static_cast<size_t>(width) * c->cb->getHeight() * 4 &&
+        c->cb->importDmaBuf(fd, fourcc, width * 4)) {
+      DEBUG("Imported color buffer %u as dma-buf", p_colorbuffer);
+      return true;
+    }
+  }
+
+  void *addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED) {
+    ERROR("Failed to map shared memory for color buffer %u: %s", p_colorbuffer,
+          strerror(errno));
+    return false;
+  }
+
+  auto memory = std::make_shared<ColorBufferMemory>(
+      static_cast<const uint8_t *>(addr), size);
+
+  emugl::Mutex::AutoLock mutex(m_lock);
+
+  ColorBufferRef *c = m_colorbuffers.find(p_colorbuffer);
+  if (!c) {
     // bad colorbuffer handle
     return false;
   }
 
-  (*c).second.cb->subUpdate(x, y, width, height, format, type, pixels);
+  c->memory = memory;
+  return true;
+}
+
+bool Renderer::updateSharedColorBuffer(HandleType p_colorbuffer, int x, int y,
+                                       int width, int height, GLenum format,
+                                       GLenum type) {
+  emugl::Mutex::AutoLock mutex(m_lock);
+
+  ColorBufferRef *c = m_colorbuffers.find(p_colorbuffer);
+  if (!c || (!c->memory && !c->cb->hasExternalStorage())) return false;
+
+  const int buffer_width = static_cast<int>(c->cb->getWidth());
+  const int buffer_height = static_cast<int>(c->cb->getHeight());
+  if (x < 0 || y < 0 || width < 0 || height < 0 ||
+      x + width > buffer_width || y + height > buffer_height)
+    return false;
+
+  if (width == 0 || height == 0) return true;
+
+  // An imported buffer is the guest memory itself, there is nothing to
+  // upload but the composer has to know about the new content.
+  if (c->cb->hasExternalStorage()) {
+    markColorBufferWritten_locked(p_colorbuffer);
+    return true;
+  }
+
+  const int bits = glUtilsPixelBitSize(format, type);
+  if (bits <= 0 || bits % 8 != 0) return false;
+
+  // GLES 2 can't upload a sub rectangle out of a larger image, so we
+  // upload complete rows which are contiguous in the guest memory.
+  const size_t stride = static_cast<size_t>(buffer_width) * (bits / 8);
+  const size_t offset = stride * y;
+  const size_t length = stride * height;
+  if (offset + length > c->memory->size) return false;
+
+  c->cb->subUpdate(0, y, buffer_width, height, format, type,
+                   const_cast<uint8_t *>(c->memory->data + offset));
+
+  markColorBufferWritten_locked(p_colorbuffer);
 
   return true;
 }
@@ -583,25 +1167,31 @@ bool Renderer::updateColorBuffer(HandleType p_colorbuffer, int x, int y,
 bool Renderer::bindColorBufferToTexture(HandleType p_colorbuffer) {
   emugl::Mutex::AutoLock mutex(m_lock);
 
-  ColorBufferMap::iterator c(m_colorbuffers.find(p_colorbuffer));
-  if (c == m_colorbuffers.end()) {
+  ColorBufferRef *c = m_colorbuffers.find(p_colorbuffer);
+  if (!c) {
     // bad colorbuffer handle
     return false;
   }
 
-  return (*c).second.cb->bindToTexture();
+  // Once bound the guest can modify the content through the texture
+  // without going through us so we can't track it anymore.
+  c->untracked = true;
+
+  return c->cb->bindToTexture();
 }
 
 bool Renderer::bindColorBufferToRenderbuffer(HandleType p_colorbuffer) {
   emugl::Mutex::AutoLock mutex(m_lock);
 
-  ColorBufferMap::iterator c(m_colorbuffers.find(p_colorbuffer));
-  if (c == m_colorbuffers.end()) {
+  ColorBufferRef *c = m_colorbuffers.find(p_colorbuffer);
+  if (!c) {
     // bad colorbuffer handle
     return false;
   }
 
-  return (*c).second.cb->bindToRenderbuffer();
+  c->untracked = true;
+
+  return c->cb->bindToRenderbuffer();
 }
 
 bool Renderer::bindContext(HandleType p_context, HandleType p_drawSurface,
@@ -615,36 +1205,36 @@ bool Renderer::bindContext(HandleType p_context, HandleType p_drawSurface,
   // if this is not an unbind operation - make sure all handles are good
   //
   if (p_context || p_drawSurface || p_readSurface) {
-    RenderContextMap::iterator r(m_contexts.find(p_context));
-    if (r == m_contexts.end()) {
+    RenderContextPtr *r = m_contexts.find(p_context);
+    if (!r) {
       // bad context handle
       return false;
     }
 
-    ctx = (*r).second;
-    WindowSurfaceMap::iterator w(m_windows.find(p_drawSurface));
-    if (w == m_windows.end()) {
+    ctx = *r;
+    WindowSurfaceRef *w = m_windows.find(p_drawSurface);
+    if (!w) {
       // bad surface handle
       return false;
     }
-    draw = (*w).second.first;
+    draw = w->first;
 
     if (p_readSurface != p_drawSurface) {
-      WindowSurfaceMap::iterator w(m_windows.find(p_readSurface));
-      if (w == m_windows.end()) {
+      WindowSurfaceRef *w = m_windows.find(p_readSurface);
+      if (!w) {
         // bad surface handle
         return false;
       }
-      read = (*w).second.first;
+      read = w->first;
     } else {
       read = draw;
     }
   }
 
-  if (!s_egl.eglMakeCurrent(m_eglDisplay,
-                            draw ? draw->getEGLSurface() : EGL_NO_SURFACE,
-                            read ? read->getEGLSurface() : EGL_NO_SURFACE,
-                            ctx ? ctx->getEGLContext() : EGL_NO_CONTEXT)) {
+  if (!CurrentContext::makeCurrent(
+          m_eglDisplay, draw ? draw->getEGLSurface() : EGL_NO_SURFACE,
+          read ? read->getEGLSurface() : EGL_NO_SURFACE,
+          ctx ? ctx->getEGLContext() : EGL_NO_CONTEXT)) {
     ERROR("eglMakeCurrent failed");
     return false;
   }
@@ -692,16 +1282,17 @@ bool Renderer::bindContext(HandleType p_context, HandleType p_drawSurface,
 
 HandleType Renderer::createClientImage(HandleType context, EGLenum target,
                                        GLuint buffer) {
+  emugl::Mutex::AutoLock mutex(m_lock);
   RenderContextPtr ctx(NULL);
 
   if (context) {
-    RenderContextMap::iterator r(m_contexts.find(context));
-    if (r == m_contexts.end()) {
+    RenderContextPtr *r = m_contexts.find(context);
+    if (!r) {
       // bad context handle
       return false;
     }
 
-    ctx = (*r).second;
+    ctx = *r;
   }
 
   EGLContext eglContext = ctx ? ctx->getEGLContext() : EGL_NO_CONTEXT;
@@ -709,61 +1300,94 @@ HandleType Renderer::createClientImage(HandleType context, EGLenum target,
       s_egl.eglCreateImageKHR(m_eglDisplay, eglContext, target,
                               reinterpret_cast<EGLClientBuffer>(buffer), NULL);
 
-  return static_cast<HandleType>(reinterpret_cast<uintptr_t>(image));
+  const auto handle = static_cast<HandleType>(reinterpret_cast<uintptr_t>(image));
+  RenderThreadInfo *tinfo = RenderThreadInfo::get();
+  if (image != EGL_NO_IMAGE_KHR && tinfo) {
+    tinfo->m_imageSet.insert(handle);
+    m_memoryAccounting.add(anbox::graphics::MemoryAccounting::Kind::ClientImage,
+                           handle, tinfo->m_id, 0);
+  }
+  return handle;
 }
 
 EGLBoolean Renderer::destroyClientImage(HandleType image) {
+  emugl::Mutex::AutoLock mutex(m_lock);
+  m_memoryAccounting.remove(anbox::graphics::MemoryAccounting::Kind::ClientImage, image);
+  if (RenderThreadInfo *tinfo = RenderThreadInfo::get())
+    tinfo->m_imageSet.erase(image);
   return s_egl.eglDestroyImageKHR(m_eglDisplay,
                                   reinterpret_cast<EGLImageKHR>(image));
 }
 
+HandleType Renderer::createSync() {
+  auto fence = FenceSync::create();
+  if (!fence) return 0;
+
+  emugl::Mutex::AutoLock mutex(m_lock);
+  const auto handle = m_syncs.insert(std::move(fence));
+  if (RenderThreadInfo *tinfo = RenderThreadInfo::get())
+    tinfo->m_syncSet.insert(handle);
+  return handle;
+}
+
+EGLint Renderer::clientWaitSync(HandleType sync, EGLint flags,
+                                EGLTimeKHR timeout) {
+  std::shared_ptr<FenceSync> fence;
+  {
+    emugl::Mutex::AutoLock mutex(m_lock);
+    auto *f = m_syncs.find(sync);
+    if (!f) return EGL_FALSE;
+    fence = *f;
+  }
+  // Waiting can take as long as the guest likes so it must not block
+  // other render threads.
+  return fence->clientWait(flags, timeout);
+}
+
+EGLBoolean Renderer::destroySync(HandleType sync) {
+  emugl::Mutex::AutoLock mutex(m_lock);
+  if (!m_syncs.erase(sync)) return EGL_FALSE;
+  if (RenderThreadInfo *tinfo = RenderThreadInfo::get())
+    tinfo->m_syncSet.erase(sync);
+  return EGL_TRUE;
+}
+
 //
 // The framebuffer lock should be held when calling this function !
 //
 bool Renderer::bind_locked() {
-  EGLContext prevContext = s_egl.eglGetCurrentContext();
-  EGLSurface prevReadSurf = s_egl.eglGetCurrentSurface(EGL_READ);
-  EGLSurface prevDrawSurf = s_egl.eglGetCurrentSurface(EGL_DRAW);
-
-  if (!s_egl.eglMakeCurrent(m_eglDisplay, m_pbufSurface, m_pbufSurface,
-                            m_pbufContext)) {
-    ERROR("eglMakeCurrent failed");
-    return false;
-  }
-
-  m_prevContext = prevContext;
-  m_prevReadSurf = prevReadSurf;
-  m_prevDrawSurf = prevDrawSurf;
-  return true;
+  return bind_locked(CurrentContext::Binding{m_eglDisplay, m_pbufSurface,
+                                             m_pbufSurface, m_pbufContext});
 }
 
 bool Renderer::bindWindow_locked(RendererWindow *window) {
-  EGLContext prevContext = s_egl.eglGetCurrentContext();
-  EGLSurface prevReadSurf = s_egl.eglGetCurrentSurface(EGL_READ);
-  EGLSurface prevDrawSurf = s_egl.eglGetCurrentSurface(EGL_DRAW);
+  // The window surface of a swap chain is current on its presenter.
+  const auto surface = window->swap_chain ? window->swap_chain->composeSurface()
+                                          : window->surface;
+  return bind_locked(
+      CurrentContext::Binding{m_eglDisplay, surface, surface, m_eglContext});
+}
 
-  if (!s_egl.eglMakeCurrent(m_eglDisplay, window->surface, window->surface,
-                            m_eglContext)) {
+bool Renderer::bind_locked(const CurrentContext::Binding &binding) {
+  const auto prev = CurrentContext::get();
+  if (!CurrentContext::makeCurrent(binding)) {
     ERROR("eglMakeCurrent failed");
     return false;
   }
 
-  m_prevContext = prevContext;
-  m_prevReadSurf = prevReadSurf;
-  m_prevDrawSurf = prevDrawSurf;
+  m_prevBindings.push_back(prev);
   return true;
 }
 
 bool Renderer::unbind_locked() {
-  if (!s_egl.eglMakeCurrent(m_eglDisplay, m_prevDrawSurf, m_prevReadSurf,
-                            m_prevContext)) {
+  if (m_prevBindings.empty())
     return false;
-  }
 
-  m_prevContext = EGL_NO_CONTEXT;
-  m_prevReadSurf = EGL_NO_SURFACE;
-  m_prevDrawSurf = EGL_NO_SURFACE;
-  return true;
+  auto prev = m_prevBindings.back();
+  m_prevBindings.pop_back();
+  // Releasing needs a valid display as well.
+  prev.display = m_eglDisplay;
+  return CurrentContext::makeCurrent(prev);
 }
 
 const GLchar *const Renderer::vshader = {
@@ -791,6 +1415,21 @@ const GLchar *const Renderer::alphaFShader = {
     "   gl_FragColor = alpha*frag;"
     "}"};
 
+// Followed by ColorBuffer::yuvSamplerSource and yuvMainFShader.
+const GLchar *const Renderer::yuvFShader = {
+    "#ifdef GL_FRAGMENT_PRECISION_HIGH\n"
+    "precision highp float;\n"
+    "#else\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "uniform float alpha;\n"
+    "varying vec2 v_texcoord;\n"};
+
+const GLchar *const Renderer::yuvMainFShader = {
+    "void main() {"
+    "   gl_FragColor = alpha*sampleYuv(v_texcoord * uFrameSize);"
+    "}"};
+
 const GLchar *const Renderer::defaultFShader =
     {  // This is the fastest fragment shader. Use it when you can.
         "precision mediump float;"
@@ -802,6 +1441,9 @@ const GLchar *const Renderer::defaultFShader =
 
 void Renderer::setupViewport(RendererWindow *window,
                              const anbox::graphics::Rect &rect) {
+  if (window->viewport == rect && rect != anbox::graphics::Rect::Empty)
+    return;
+
   /*
    * Here we provide a 3D perspective projection with a default 30 degrees
    * vertical field of view. This projection matrix is carefully designed
@@ -837,7 +1479,7 @@ void Renderer::setupViewport(RendererWindow *window,
   window->viewport = rect;
 }
 
-void Renderer::tessellate(std::vector<anbox::graphics::Primitive> &primitives,
+void Renderer::tessellate(anbox::graphics::Vertex *quad,
                           const anbox::graphics::Rect &buf_size,
                           const Renderable &renderable) {
   auto rect = renderable.screen_position();
@@ -846,10 +1488,6 @@ void Renderer::tessellate(std::vector<anbox::graphics::Primitive> &primitives,
   GLfloat top = rect.top();
   GLfloat bottom = rect.bottom();
 
-  anbox::graphics::Primitive rectangle;
-  rectangle.tex_id = 0;
-  rectangle.type = GL_TRIANGLE_STRIP;
-
   GLfloat tex_left =
       static_cast<GLfloat>(renderable.crop().left()) / buf_size.width();
   GLfloat tex_top =
@@ -859,81 +1497,214 @@ void Renderer::tessellate(std::vector<anbox::graphics::Primitive> &primitives,
   GLfloat tex_bottom =
       static_cast<GLfloat>(renderable.crop().bottom()) / buf_size.height();
 
-  auto &vertices = rectangle.vertices;
-  vertices[0] = {{left, top, 0.0f}, {tex_left, tex_top}};
-  vertices[1] = {{left, bottom, 0.0f}, {tex_left, tex_bottom}};
-  vertices[2] = {{right, top, 0.0f}, {tex_right, tex_top}};
-  vertices[3] = {{right, bottom, 0.0f}, {tex_right, tex_bottom}};
-
-  primitives.resize(1);
-  primitives[0] = rectangle;
+  // Each layer is a quad drawn as a triangle strip of four vertices.
+  quad[0] = {{left, top, 0.0f}, {tex_left, tex_top}};
+  quad[1] = {{left, bottom, 0.0f}, {tex_left, tex_bottom}};
+  quad[2] = {{right, top, 0.0f}, {tex_right, tex_top}};
+  quad[3] = {{right, bottom, 0.0f}, {tex_right, tex_bottom}};
 }
 
-void Renderer::draw(RendererWindow *window, const Renderable &renderable,
-                    const Program &prog) {
-  const auto &color_buffer = m_colorbuffers.find(renderable.buffer());
-  if (color_buffer == m_colorbuffers.end()) return;
-
-  const auto &cb = color_buffer->second.cb;
-
-  s_gles2.glUseProgram(prog.id);
-  s_gles2.glUniform1i(prog.tex_uniform, 0);
-  s_gles2.glUniformMatrix4fv(prog.display_transform_uniform, 1, GL_FALSE,
-                             glm::value_ptr(window->display_transform));
-  s_gles2.glUniformMatrix4fv(prog.screen_to_gl_coords_uniform, 1, GL_FALSE,
-                             glm::value_ptr(window->screen_to_gl_coords));
+void Renderer::drawLayers(RendererWindow *window, bool upload_vertices) {
+  if (m_composeVbo == 0) s_gles2.glGenBuffers(1, &m_composeVbo);
+
+  s_gles2.glBindBuffer(GL_ARRAY_BUFFER, m_composeVbo);
+
+  // Upload the vertices of all layers at once and only when they changed
+  // or the buffer holds those of another window. The buffer is only
+  // reallocated when a frame has more layers than any frame before.
+  if (upload_vertices || m_composeVboWindow != window) {
+    const auto &vertices = window->vertices;
+    const auto vertices_size = vertices.size() * sizeof(anbox::graphics::Vertex);
+    if (vertices_size > m_composeVboSize) {
+      s_gles2.glBufferData(GL_ARRAY_BUFFER, vertices_size, vertices.data(),
+                           GL_STREAM_DRAW);
+      m_composeVboSize = vertices_size;
+    } else {
+      s_gles2.glBufferSubData(GL_ARRAY_BUFFER, 0, vertices_size,
+                              vertices.data());
+    }
+    m_composeVboWindow = window;
+  }
 
+  // State shared by all layers is only set up once per frame.
   s_gles2.glActiveTexture(GL_TEXTURE0);
 
-  auto const &rect = renderable.screen_position();
-  GLfloat centerx = rect.left() + rect.width() / 2.0f;
-  GLfloat centery = rect.top() + rect.height() / 2.0f;
-  s_gles2.glUniform2f(prog.center_uniform, centerx, centery);
+  const Program *prog = nullptr;
+  // Blending is only switched when it changes between layers, which for
+  // most frames is never.
+  bool blending_set = false;
+  auto blending = Renderable::Blending::Premultiplied;
+  glm::mat4 transform;
+  glm::vec2 center;
+  float alpha = 0.0f;
+
+  for (size_t n = 0; n < m_layers.size(); n++) {
+    const auto &layer = m_layers[n];
+    const auto &renderable = *layer.renderable;
+
+    if (layer.prog != prog) {
+      if (prog) {
+        s_gles2.glDisableVertexAttribArray(prog->texcoord_attr);
+        s_gles2.glDisableVertexAttribArray(prog->position_attr);
+      }
 
-  s_gles2.glUniformMatrix4fv(prog.transform_uniform, 1, GL_FALSE,
-                             glm::value_ptr(renderable.transformation()));
+      prog = layer.prog;
+
+      s_gles2.glUseProgram(prog->id);
+      s_gles2.glUniform1i(prog->tex_uniform, 0);
+      s_gles2.glUniformMatrix4fv(prog->display_transform_uniform, 1, GL_FALSE,
+                                 glm::value_ptr(window->display_transform));
+      s_gles2.glUniformMatrix4fv(prog->screen_to_gl_coords_uniform, 1, GL_FALSE,
+                                 glm::value_ptr(window->screen_to_gl_coords));
+
+      s_gles2.glEnableVertexAttribArray(prog->position_attr);
+      s_gles2.glEnableVertexAttribArray(prog->texcoord_attr);
+      s_gles2.glVertexAttribPointer(
+          prog->position_attr, 3, GL_FLOAT, GL_FALSE,
+          sizeof(anbox::graphics::Vertex),
+          reinterpret_cast<const GLvoid *>(
+              offsetof(anbox::graphics::Vertex, position)));
+      s_gles2.glVertexAttribPointer(
+          prog->texcoord_attr, 2, GL_FLOAT, GL_FALSE,
+          sizeof(anbox::graphics::Vertex),
+          reinterpret_cast<const GLvoid *>(
+              offsetof(anbox::graphics::Vertex, texcoord)));
+
+      // The uniforms below belong to the program so they have to be
+      // set again when we switched to another one.
+      transform = renderable.transformation();
+      s_gles2.glUniformMatrix4fv(prog->transform_uniform, 1, GL_FALSE,
+                                 glm::value_ptr(transform));
+      center = glm::vec2{-1.0f};
+      alpha = -1.0f;
+    }
 
-  if (prog.alpha_uniform >= 0)
-    s_gles2.glUniform1f(prog.alpha_uniform, renderable.alpha());
+    if (renderable.transformation() != transform) {
+      transform = renderable.transformation();
+      s_gles2.glUniformMatrix4fv(prog->transform_uniform, 1, GL_FALSE,
+                                 glm::value_ptr(transform));
+    }
 
-  s_gles2.glEnableVertexAttribArray(prog.position_attr);
-  s_gles2.glEnableVertexAttribArray(prog.texcoord_attr);
+    // The center only matters for a non-identity transformation which
+    // lets us skip updating it for the common case.
+    glm::vec2 layer_center;
+    if (!renderable.has_identity_transformation()) {
+      auto const &rect = renderable.screen_position();
+      layer_center = glm::vec2{rect.left() + rect.width() / 2.0f,
+                               rect.top() + rect.height() / 2.0f};
+    }
+    if (layer_center != center) {
+      center = layer_center;
+      s_gles2.glUniform2f(prog->center_uniform, center.x, center.y);
+    }
 
-  m_primitives.clear();
-  tessellate(m_primitives, {
-             static_cast<int32_t>(cb->getWidth()),
-             static_cast<int32_t>(cb->getHeight())}, renderable);
+    if (prog->alpha_uniform >= 0 && renderable.alpha() != alpha) {
+      alpha = renderable.alpha();
+      s_gles2.glUniform1f(prog->alpha_uniform, alpha);
+    }
 
-  for (auto const &p : m_primitives) {
-    cb->bind();
+    // Opaque layers which are faded out still have to be blended.
+    auto layer_blending = renderable.blending();
+    if (layer_blending == Renderable::Blending::None && renderable.alpha() < 1.0f)
+      layer_blending = Renderable::Blending::Premultiplied;
+    if (!blending_set || layer_blending != blending) {
+      blending = layer_blending;
+      blending_set = true;
+      switch (blending) {
+        case Renderable::Blending::None:
+          s_gles2.glDisable(GL_BLEND);
+          break;
+        case Renderable::Blending::Premultiplied:
+          s_gles2.glEnable(GL_BLEND);
+          s_gles2.glBlendFuncSeparate(GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GL_ONE,
+                                      GL_ONE_MINUS_SRC_ALPHA);
+          break;
+        case Renderable::Blending::Coverage:
+          s_gles2.glEnable(GL_BLEND);
+          s_gles2.glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE,
+                                      GL_ONE_MINUS_SRC_ALPHA);
+          break;
+      }
+    }
 
-    s_gles2.glVertexAttribPointer(prog.position_attr, 3, GL_FLOAT, GL_FALSE,
-                                  sizeof(anbox::graphics::Vertex),
-                                  &p.vertices[0].position);
-    s_gles2.glVertexAttribPointer(prog.texcoord_attr, 2, GL_FLOAT, GL_FALSE,
-                                  sizeof(anbox::graphics::Vertex),
-                                  &p.vertices[0].texcoord);
+    layer.cb->bind();
+
+    if (prog->plane_size_uniform >= 0) {
+      ColorBuffer::YuvLayout yuv;
+      layer.cb->getYuvLayout(&yuv);
+      s_gles2.glUniform2fv(prog->plane_size_uniform, 1, yuv.planeSize);
+      s_gles2.glUniform2fv(prog->frame_size_uniform, 1, yuv.frameSize);
+      s_gles2.glUniform2fv(prog->strides_uniform, 1, yuv.strides);
+      s_gles2.glUniform3fv(prog->chroma_uniform, 1, yuv.chroma);
+    }
 
-    s_gles2.glEnable(GL_BLEND);
-    s_gles2.glBlendFuncSeparate(GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GL_ONE,
-                                GL_ONE_MINUS_SRC_ALPHA);
+    s_gles2.glDrawArrays(GL_TRIANGLE_STRIP, static_cast<GLint>(n * 4), 4);
+  }
 
-    s_gles2.glDrawArrays(p.type, 0, p.nvertices);
+  if (prog) {
+    s_gles2.glDisableVertexAttribArray(prog->texcoord_attr);
+    s_gles2.glDisableVertexAttribArray(prog->position_attr);
   }
 
-  s_gles2.glDisableVertexAttribArray(prog.texcoord_attr);
-  s_gles2.glDisableVertexAttribArray(prog.position_attr);
+  s_gles2.glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Renderer::markColorBufferWritten_locked(HandleType p_colorbuffer) {
+  ColorBufferRef *c = m_colorbuffers.find(p_colorbuffer);
+  if (!c) return;
+
+  c->write_serial = ++m_writeSerial;
+}
+
+std::uint64_t Renderer::content_serial(const RenderableList &renderables) {
+  emugl::Mutex::AutoLock mutex(m_lock);
+
+  // Every write to a color buffer gets a new and higher serial assigned
+  // so for an unchanged list of buffers the highest serial only changes
+  // when one of them was written to.
+  std::uint64_t serial = 0;
+  for (const auto &r : renderables) {
+    ColorBufferRef *c = m_colorbuffers.find(r.buffer());
+    if (!c) continue;
+
+    if (c->untracked) return ++m_writeSerial;
+
+    serial = std::max(serial, c->write_serial);
+  }
+  return serial;
 }
 
 bool Renderer::draw(EGLNativeWindowType native_window,
                     const anbox::graphics::Rect &window_frame,
                     const RenderableList &renderables) {
+  // Render threads are not necessarily serialized against each other
+  // anymore so we have to protect the window and color buffer maps
+  // and the shared composition context ourself.
+  emugl::Mutex::AutoLock mutex(m_lock);
+
   auto w = m_nativeWindows.find(native_window);
   if (w == m_nativeWindows.end()) return false;
 
-  if (!bindWindow_locked(w->second)) {
-    m_lock.unlock();
-    return false;
+  if (!bindWindow_locked(w->second)) return false;
+
+  const auto exported = !w->second->export_buffers.empty();
+  const auto export_buffer = w->second->next_export_buffer;
+  const auto swap_chain = w->second->swap_chain.get();
+  if (exported) {
+    s_gles2.glBindFramebuffer(GL_FRAMEBUFFER,
+                              w->second->export_buffers[export_buffer].framebuffer);
+  } else if (swap_chain) {
+    if (!swap_chain->beginFrame(window_frame.width(), window_frame.height())) {
+      unbind_locked();
+      return false;
+    }
+  } else {
+    const auto interval =
+        w->second->swap_policy == SwapPolicy::Immediate ? 0 : m_swapInterval;
+    if (w->second->swap_interval != interval && s_egl.eglSwapInterval) {
+      s_egl.eglSwapInterval(m_eglDisplay, interval);
+      w->second->swap_interval = interval;
+    }
   }
 
   setupViewport(w->second, window_frame);
@@ -942,16 +1713,117 @@ bool Renderer::draw(EGLNativeWindowType native_window,
   s_gles2.glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
   s_gles2.glClear(GL_COLOR_BUFFER_BIT);
 
-  for (const auto &r : renderables)
-    draw(w->second, r, r.alpha() < 1.0f ? m_alphaProgram : m_defaultProgram);
+  m_layers.clear();
+
+  // Layers without a buffer aren't drawn so they can't hide others.
+  m_drawable.clear();
+  m_drawableBuffers.clear();
+  for (const auto &r : renderables) {
+    if (auto c = m_colorbuffers.find(r.buffer())) {
+      m_drawable.push_back(r);
+      m_drawableBuffers.push_back(c->cb.Ptr());
+    }
+  }
+  anbox::graphics::find_visible_layers(m_drawable, m_visible);
+
+  auto &quads = w->second->quads;
+  auto &vertices = w->second->vertices;
+  bool vertices_changed = false;
+  for (size_t n = 0; n < m_drawable.size(); n++) {
+    // Neither sampled nor blended when nobody would see it.
+    if (!m_visible[n]) continue;
+
+    const auto &r = m_drawable[n];
+    const auto cb = m_drawableBuffers[n];
+
+    const RendererWindow::Quad quad{{static_cast<int32_t>(cb->getWidth()),
+                                     static_cast<int32_t>(cb->getHeight())},
+                                    r.crop(), r.screen_position()};
+    const auto index = m_layers.size();
+    if (index == quads.size()) {
+      quads.push_back(quad);
+      vertices.resize(vertices.size() + 4);
+      tessellate(&vertices[index * 4], quad.buf_size, r);
+      vertices_changed = true;
+    } else if (quads[index].buf_size != quad.buf_size ||
+               quads[index].crop != quad.crop ||
+               quads[index].screen_position != quad.screen_position) {
+      quads[index] = quad;
+      tessellate(&vertices[index * 4], quad.buf_size, r);
+      vertices_changed = true;
+    }
+
+    // Sample the buffer only once its last update went through.
+    cb->waitForWrites();
 
-  s_egl.eglSwapBuffers(m_eglDisplay, w->second->surface);
+    const Program *prog = &m_defaultProgram;
+    if (cb->isYuv())
+      prog = &m_yuvProgram;
+    else if (r.alpha() < 1.0f)
+      prog = &m_alphaProgram;
+    m_layers.push_back({cb, prog, &r});
+  }
+
+  // Layers which went away leave the quads of the remaining ones intact.
+  quads.resize(m_layers.size());
+  vertices.resize(m_layers.size() * 4);
+
+  if (!m_layers.empty()) {
+    drawLayers(w->second, vertices_changed);
+    // Updates of the buffers we just sampled must wait until the
+    // composition is done with them.
+    const auto composed = FenceSync::create();
+    if (composed)
+      for (const auto &layer : m_layers) layer.cb->setReadFence(composed);
+  }
+
+  if (exported) {
+    // Consumers access the buffer straight through its dmabuf so the
+    // frame has to be complete before we tell them about it.
+    s_gles2.glFinish();
+    s_gles2.glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    w->second->next_export_buffer = (export_buffer + 1) % w->second->export_buffers.size();
+    m_frameExporter->frame_ready(w->second->export_id, static_cast<uint32_t>(export_buffer),
+                                 static_cast<uint32_t>(window_frame.width()),
+                                 static_cast<uint32_t>(window_frame.height()),
+                                 std::chrono::steady_clock::now());
+  } else if (swap_chain) {
+    // Handing the frame over says nothing about when the display refreshes.
+    swap_chain->endFrame();
+  } else {
+    {
+      ANBOX_TRACE_SPAN("compositor", "swap_buffers");
+      s_egl.eglSwapBuffers(m_eglDisplay, w->second->surface);
+    }
+    m_vsyncClock.presented(anbox::graphics::VsyncClock::Clock::now());
+  }
 
   unbind_locked();
 
-  m_lock.lock();
+  if (m_fpsStats) {
+    // Context switches are counted for all threads as switching on a
+    // render thread costs as much as on the compositor.
+    const auto now = GetCurrentTimeMS();
+    const auto switches = CurrentContext::switches();
+    m_statsNumFrames++;
+    if (m_statsStartTime == 0) {
+      m_statsNumFrames = 0;
+      m_statsStartTime = now;
+      m_statsStartSwitches = switches;
+    } else if (now - m_statsStartTime >= 1000) {
+      INFO("%.1f fps, %.1f eglMakeCurrent calls per frame",
+           m_statsNumFrames * 1000.0 / (now - m_statsStartTime),
+           static_cast<double>(switches - m_statsStartSwitches) / m_statsNumFrames);
+      m_statsNumFrames = 0;
+      m_statsStartTime = now;
+      m_statsStartSwitches = switches;
+    }
+  }
 
-  m_lock.unlock();
+  return true;
+}
 
-  return false;
+void Renderer::setSwapInterval(int interval) {
+  emugl::Mutex::AutoLock mutex(m_lock);
+  m_swapInterval = std::max(interval, 0);
 }
@@ -17,6 +17,9 @@
 #define _LIBRENDER_FRAMEBUFFER_H
 
 #include "ColorBuffer.h"
+#include "CurrentContext.h"
+#include "FenceSync.h"
+#include "PixelStream.h"
 #include "RenderContext.h"
 #include "RendererConfig.h"
 #include "TextureDraw.h"
@@ -25,13 +28,24 @@
 
 #include "Renderable.h"
 
+#include "anbox/graphics/app_profiles.h"
+#include "anbox/graphics/buffer_pool.h"
+#include "anbox/graphics/command_profiler.h"
+#include "anbox/graphics/frame_exporter.h"
+#include "anbox/graphics/memory_accounting.h"
 #include "anbox/graphics/primitives.h"
 #include "anbox/graphics/program_family.h"
+#include "anbox/graphics/render_thread_policy.h"
 #include "anbox/graphics/renderer.h"
+#include "anbox/graphics/slot_map.h"
+#include "anbox/graphics/vsync_clock.h"
 
 #include <EGL/egl.h>
 
 #include <map>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include <stdint.h>
 
@@ -39,14 +53,32 @@
 // These are integers used to uniquely identify a resource of a given type.
 typedef uint32_t HandleType;
 
+// Read-only mapping of the guest memory backing a color buffer. The
+// mapping is released together with the last reference to it.
+struct ColorBufferMemory {
+  ColorBufferMemory(const uint8_t* data, size_t size);
+  ~ColorBufferMemory();
+
+  ColorBufferMemory(const ColorBufferMemory&) = delete;
+  ColorBufferMemory& operator=(const ColorBufferMemory&) = delete;
+
+  const uint8_t* data;
+  size_t size;
+};
+
 struct ColorBufferRef {
   ColorBufferPtr cb;
   uint32_t refcount;  // number of client-side references
+  GLenum format;  // internal format the guest asked for
+  uint64_t write_serial;  // value of the write serial at the last update
+  bool untracked;  // content can change without us noticing, e.g. via EGLImage
+  std::shared_ptr<ColorBufferMemory> memory;  // shared guest memory, if any
 };
-typedef std::map<HandleType, RenderContextPtr> RenderContextMap;
-typedef std::map<HandleType, std::pair<WindowSurfacePtr, HandleType>>
-    WindowSurfaceMap;
-typedef std::map<HandleType, ColorBufferRef> ColorBufferMap;
+typedef anbox::graphics::SlotMap<RenderContextPtr> RenderContextMap;
+typedef std::pair<WindowSurfacePtr, HandleType> WindowSurfaceRef;
+typedef anbox::graphics::SlotMap<WindowSurfaceRef> WindowSurfaceMap;
+typedef anbox::graphics::SlotMap<ColorBufferRef> ColorBufferMap;
+typedef anbox::graphics::SlotMap<std::shared_ptr<FenceSync>> FenceSyncMap;
 
 // A structure used to list the capabilities of the underlying EGL
 // implementation that the FrameBuffer instance depends on.
@@ -54,11 +86,23 @@ typedef std::map<HandleType, ColorBufferRef> ColorBufferMap;
 // extension is supported.
 // |has_eglimage_renderbuffer| is true iff the EGL_KHR_gl_renderbuffer_image
 // extension is supported.
+// |has_fence_sync| is true iff EGL_KHR_fence_sync is supported and color
+// buffer accesses are ordered with fences. |has_wait_sync| is true iff
+// EGL_KHR_wait_sync lets contexts wait for them without blocking.
+// |has_bgra_texture| is true iff GL_EXT_texture_format_BGRA8888 lets color
+// buffers be stored as BGRA and |has_bgra_read| iff GL_EXT_read_format_bgra
+// lets them be read back as such.
 // |eglMajor| and |eglMinor| are the major and minor version numbers of
 // the underlying EGL implementation.
 struct RendererCaps {
   bool has_eglimage_texture_2d;
   bool has_eglimage_renderbuffer;
+  bool has_dma_buf_import;
+  bool has_dma_buf_export;
+  bool has_fence_sync;
+  bool has_wait_sync;
+  bool has_bgra_texture;
+  bool has_bgra_read;
   EGLint eglMajor;
   EGLint eglMinor;
 };
@@ -74,6 +118,14 @@ struct RendererWindow;
 //
 class Renderer : public anbox::graphics::Renderer {
  public:
+  // How composed frames reach a native window.
+  // |Fifo| swaps the window surface with the interval the guest last asked
+  // for, which typically blocks composition until the next vertical blank.
+  // |Mailbox| composes offscreen and leaves presenting the latest frame to
+  // a thread of the window's own, see SwapChain.
+  // |Immediate| swaps without waiting for the vertical blank and may tear.
+  enum class SwapPolicy { Fifo, Mailbox, Immediate };
+
   Renderer();
   virtual ~Renderer();
 
@@ -84,7 +136,13 @@ class Renderer : public anbox::graphics::Renderer {
   // own sub-windows. If false, this means the caller will use
   // setPostCallback() instead to retrieve the content.
   // Returns true on success, false otherwise.
-  bool initialize(EGLNativeDisplayType nativeDisplay);
+  // With |headless| set no native window is ever used and all output
+  // goes to offscreen windows. When the host EGL supports it the display
+  // comes from the surfaceless platform then so no display server is
+  // needed at all. A headless renderer given a |renderNode| renders on
+  // that GPU if the host EGL can enumerate its devices.
+  bool initialize(EGLNativeDisplayType nativeDisplay, bool headless = false,
+                  const std::string &renderNode = std::string());
 
   // Finalize the instance.
   void finalize();
@@ -105,7 +163,15 @@ class Renderer : public anbox::graphics::Renderer {
     *version = m_glVersion;
   }
 
-  RendererWindow* createNativeWindow(EGLNativeWindowType native_window);
+  // |package| is the Android package the window shows. Its app profile
+  // may let it present frames differently than the swap policy says.
+  RendererWindow* createNativeWindow(EGLNativeWindowType native_window,
+                                     const std::string& package = std::string());
+  // Create a window which renders into a |width| x |height| pbuffer
+  // instead of a native window. |native_window| is only used as the key
+  // to find the window again in draw() and destroyNativeWindow().
+  RendererWindow* createOffscreenWindow(EGLNativeWindowType native_window,
+                                        int width, int height);
   void destroyNativeWindow(RendererWindow* window);
   void destroyNativeWindow(EGLNativeWindowType native_window);
 
@@ -127,11 +193,13 @@ class Renderer : public anbox::graphics::Renderer {
   // Create a new ColorBuffer instance from this display instance.
   // |p_width| and |p_height| are its dimensions in pixels.
   // |p_internalFormat| is the pixel format. See ColorBuffer::create() for
-  // list of valid values. Note that ColorBuffer instances are reference-
-  // counted. Use openColorBuffer / closeColorBuffer to operate on the
-  // internal count.
+  // list of valid values. |p_usage| is a combination of
+  // ColorBuffer::Usage bits telling what the guest does with the buffer.
+  // Note that ColorBuffer instances are reference-counted. Use
+  // openColorBuffer / closeColorBuffer to operate on the internal count.
   HandleType createColorBuffer(int p_width, int p_height,
-                               GLenum p_internalFormat);
+                               GLenum p_internalFormat,
+                               uint32_t p_usage = ColorBuffer::USAGE_ALL);
 
   // Call this function when a render thread terminates to destroy all
   // the remaining contexts it created. Necessary to avoid leaking host
@@ -143,6 +211,15 @@ class Renderer : public anbox::graphics::Renderer {
   // host buffers when a guest application crashes, for example.
   void drainWindowSurface();
 
+  // Call this function when a render thread terminates to destroy all
+  // remaining client images it created. Necessary to avoid leaking the
+  // buffers they keep alive when a guest application crashes, for example.
+  void drainClientImages();
+
+  // Call this function when a render thread terminates to destroy all
+  // remaining fence syncs it created.
+  void drainSyncs();
+
   // Destroy a given RenderContext instance. |p_context| is its handle
   // value as returned by createRenderContext().
   void DestroyRenderContext(HandleType p_context);
@@ -222,10 +299,48 @@ class Renderer : public anbox::graphics::Renderer {
   bool updateColorBuffer(HandleType p_colorbuffer, int x, int y, int width,
                          int height, GLenum format, GLenum type, void* pixels);
 
+  // Map the guest memory behind |fd| into the host read-only and attach
+  // it to the ColorBuffer |p_colorbuffer|. The guest keeps writing its
+  // pixels into that memory, tightly packed rows of the buffer's width,
+  // which lets updateSharedColorBuffer() upload from it without the
+  // pixels going through the pipe. If |fd| is a dma-buf and the host EGL
+  // can import it, the ColorBuffer uses it as storage directly and no
+  // upload is needed at all. |fd| is not consumed.
+  // Returns true on success, false otherwise.
+  bool attachColorBufferMemory(HandleType p_colorbuffer, int fd, size_t size);
+
+  // Upload the rows touched by the rectangle |x|, |y|, |width| and
+  // |height| from the guest memory attached to |p_colorbuffer|.
+  // Returns false if no memory is attached or the rectangle is outside
+  // of it, in which case the caller has to send the pixels itself.
+  bool updateSharedColorBuffer(HandleType p_colorbuffer, int x, int y,
+                               int width, int height, GLenum format,
+                               GLenum type);
+
   bool draw(EGLNativeWindowType native_window,
             const anbox::graphics::Rect& window_frame,
             const RenderableList& renderables) override;
 
+  std::uint64_t content_serial(const RenderableList& renderables) override;
+
+  // Return the clock tracking the vertical refresh of the host display
+  // which is derived from the times we presented composed frames.
+  const anbox::graphics::VsyncClock& vsyncClock() const { return m_vsyncClock; }
+
+  // Return hit/miss statistics of the pool color buffers are recycled with.
+  typedef anbox::graphics::BufferPool<ColorBufferPtr> ColorBufferPool;
+  ColorBufferPool::Statistics colorBufferPoolStatistics();
+
+  // Limit the GPU memory each render thread may allocate. Color buffers
+  // and window surfaces a thread would go above its hard quota with are
+  // not created; going above its soft quota evicts the color buffer pool.
+  void setMemoryQuota(const anbox::graphics::MemoryAccounting::Quota& quota);
+
+  // Return the GPU memory held by all render threads, keyed by the id of
+  // their RenderThreadInfo, or by a single one of them.
+  anbox::graphics::MemoryAccounting::UsageMap memoryUsage();
+  anbox::graphics::MemoryAccounting::Usage memoryUsage(uint32_t renderThread);
+
   // Return the host EGLDisplay used by this instance.
   EGLDisplay getDisplay() const { return m_eglDisplay; }
 
@@ -233,52 +348,140 @@ class Renderer : public anbox::graphics::Renderer {
   // and windows created by this instance.
   TextureDraw* getTextureDraw() const { return m_textureDraw; }
 
+  // Return the PixelStream used to transfer color buffer content or NULL
+  // when the host GL does not support pixel buffer objects.
+  PixelStream* getPixelStream() const { return m_pixelStream; }
+
+  // Return true if contexts can copy between framebuffers with
+  // glBlitFramebuffer().
+  bool canBlitFramebuffer() const { return m_canBlitFramebuffer; }
+
+  // Return the family owning all programs used for composition.
+  anbox::graphics::ProgramFamily& getProgramFamily() { return m_family; }
+
+  // Install the profiler render threads record the commands they decode
+  // into. Has to happen before the first render thread starts; without one
+  // commands are decoded without any instrumentation.
+  void setCommandProfiler(
+      const std::shared_ptr<anbox::graphics::CommandProfiler>& profiler) {
+    m_commandProfiler = profiler;
+  }
+  std::shared_ptr<anbox::graphics::CommandProfiler> commandProfiler() const {
+    return m_commandProfiler;
+  }
+
+  // Install the policy render threads are scheduled with. Has to happen
+  // before the first render thread starts; without one all of them keep
+  // the default scheduling.
+  void setThreadPolicy(
+      const std::shared_ptr<anbox::graphics::RenderThreadPolicy>& policy) {
+    m_threadPolicy = policy;
+  }
+  std::shared_ptr<anbox::graphics::RenderThreadPolicy> threadPolicy() const {
+    return m_threadPolicy;
+  }
+
+  // Install the exporter offscreen windows hand their composed frames to
+  // as dmabufs instead of presenting them. Only affects windows created
+  // afterwards and requires EGL_MESA_image_dma_buf_export.
+  void setFrameExporter(
+      const std::shared_ptr<anbox::graphics::FrameExporter>& exporter) {
+    m_frameExporter = exporter;
+  }
+
+  // Set how native windows created afterwards present their frames.
+  void setSwapPolicy(SwapPolicy policy) { m_swapPolicy = policy; }
+
+  // Install the profiles native windows created afterwards are set up by
+  // for the package they show.
+  void setAppProfiles(
+      const std::shared_ptr<anbox::graphics::AppProfiles>& profiles) {
+    m_appProfiles = profiles;
+  }
+
+  // Set the swap interval windows with SwapPolicy::Fifo swap with.
+  void setSwapInterval(int interval);
+
   HandleType createClientImage(HandleType context, EGLenum target,
                                GLuint buffer);
   EGLBoolean destroyClientImage(HandleType image);
 
+  // Insert a fence after all commands the current render thread issued so
+  // far and return its handle, or 0 when fences are not supported.
+  HandleType createSync();
+  // Block until the fence |sync| signaled or |timeout| nanoseconds passed.
+  // Returns EGL_CONDITION_SATISFIED_KHR, EGL_TIMEOUT_EXPIRED_KHR or
+  // EGL_FALSE for an unknown handle.
+  EGLint clientWaitSync(HandleType sync, EGLint flags, EGLTimeKHR timeout);
+  EGLBoolean destroySync(HandleType sync);
+
   // Used internally.
   bool bind_locked();
   bool unbind_locked();
 
  private:
-  HandleType genHandle();
-
+  void markColorBufferWritten_locked(HandleType p_colorbuffer);
+  // Return false if the current render thread may not allocate |bytes|
+  // more. Host allocations outside of any render thread are not limited.
+  bool admitAllocation_locked(size_t bytes);
+  void releaseColorBuffer_locked(HandleType p_colorbuffer,
+                                 const ColorBufferRef& ref);
+
+  RendererWindow* addWindow_locked(EGLNativeWindowType native_window,
+                                   EGLSurface surface);
   bool bindWindow_locked(RendererWindow* window);
+  bool bind_locked(const CurrentContext::Binding& binding);
+  bool exportWindow_locked(RendererWindow* window, int width, int height);
+  void releaseExportBuffers_locked(RendererWindow* window);
 
   void setupViewport(RendererWindow* window, const anbox::graphics::Rect& rect);
   struct Program;
-  void draw(RendererWindow* window, const Renderable& renderable,
-            const Program& prog);
-  void tessellate(std::vector<anbox::graphics::Primitive>& primitives,
+  struct Layer;
+  void drawLayers(RendererWindow* window, bool upload_vertices);
+  // Writes the four vertices of |renderable| to |quad|.
+  void tessellate(anbox::graphics::Vertex* quad,
                   const anbox::graphics::Rect& buf_size,
                   const Renderable& renderable);
 
  private:
   static Renderer* s_renderer;
-  static HandleType s_nextHandle;
   emugl::Mutex m_lock;
   RendererConfigList* m_configs;
   RendererCaps m_caps;
   EGLDisplay m_eglDisplay;
-  RenderContextMap m_contexts;
-  WindowSurfaceMap m_windows;
-  ColorBufferMap m_colorbuffers;
+  // Every map tags its handles differently so a handle of one kind is
+  // never mistaken for a live handle of another.
+  RenderContextMap m_contexts{1};
+  WindowSurfaceMap m_windows{2};
+  ColorBufferMap m_colorbuffers{3};
+  FenceSyncMap m_syncs{0};
   ColorBuffer::Helper* m_colorBufferHelper;
 
   EGLContext m_eglContext;
   EGLSurface m_pbufSurface;
   EGLContext m_pbufContext;
 
-  EGLContext m_prevContext;
-  EGLSurface m_prevReadSurf;
-  EGLSurface m_prevDrawSurf;
+  // What was current before each pending bind_locked() or
+  // bindWindow_locked(), innermost last. Nested binds of what is current
+  // already don't switch at all and neither do their unbinds.
+  std::vector<CurrentContext::Binding> m_prevBindings;
   TextureDraw* m_textureDraw;
+  PixelStream* m_pixelStream = nullptr;
+  bool m_canBlitFramebuffer = false;
   EGLConfig m_eglConfig;
   HandleType m_lastPostedColorBuffer;
+  uint64_t m_writeSerial = 0;
+  anbox::graphics::VsyncClock m_vsyncClock;
+
+  // Color buffers are recycled as the guest reallocates buffers of the
+  // same size a lot, e.g. when windows are resized or activities change.
+  static const size_t colorBufferPoolMaxBytes;
+  ColorBufferPool m_colorBufferPool{colorBufferPoolMaxBytes};
+  anbox::graphics::MemoryAccounting m_memoryAccounting;
 
   int m_statsNumFrames;
   long long m_statsStartTime;
+  uint64_t m_statsStartSwitches = 0;
   bool m_fpsStats;
 
   const char* m_glVendor;
@@ -288,6 +491,13 @@ class Renderer : public anbox::graphics::Renderer {
   std::map<EGLNativeWindowType, RendererWindow*> m_nativeWindows;
 
   anbox::graphics::ProgramFamily m_family;
+  std::shared_ptr<anbox::graphics::CommandProfiler> m_commandProfiler;
+  std::shared_ptr<anbox::graphics::FrameExporter> m_frameExporter;
+  std::shared_ptr<anbox::graphics::AppProfiles> m_appProfiles;
+  std::shared_ptr<anbox::graphics::RenderThreadPolicy> m_threadPolicy;
+  uint32_t m_nextExportedWindow = 1;
+  SwapPolicy m_swapPolicy = SwapPolicy::Fifo;
+  int m_swapInterval = 1;
   struct Program {
     GLuint id = 0;
     GLint tex_uniform = -1;
@@ -298,17 +508,42 @@ class Renderer : public anbox::graphics::Renderer {
     GLint transform_uniform = -1;
     GLint screen_to_gl_coords_uniform = -1;
     GLint alpha_uniform = -1;
+    // Only used by the program composing video frames.
+    GLint plane_size_uniform = -1;
+    GLint frame_size_uniform = -1;
+    GLint strides_uniform = -1;
+    GLint chroma_uniform = -1;
     mutable long long last_used_frameno = 0;
 
     Program(GLuint program_id);
     Program() {}
   };
-  Program m_defaultProgram, m_alphaProgram;
-
-  std::vector<anbox::graphics::Primitive> m_primitives;
+  Program m_defaultProgram, m_alphaProgram, m_yuvProgram;
+
+  // A single layer of a composed frame. The layers of a frame are drawn
+  // in the order they were handed to us (painter's order) as blended
+  // layers may overlap. All of them share one vertex buffer so the
+  // per-layer work is limited to the state which really changes.
+  struct Layer {
+    ColorBuffer* cb;
+    const Program* prog;
+    const Renderable* renderable;
+  };
+  std::vector<Layer> m_layers;
+  // The layers of the frame we have a buffer for, their buffers and which
+  // of them aren't hidden behind an opaque one, reused from frame to frame.
+  RenderableList m_drawable;
+  std::vector<ColorBuffer*> m_drawableBuffers;
+  std::vector<bool> m_visible;
+  GLuint m_composeVbo = 0;
+  size_t m_composeVboSize = 0;
+  // Window whose vertices the compose buffer holds.
+  const RendererWindow* m_composeVboWindow = nullptr;
 
   static const GLchar* const vshader;
   static const GLchar* const defaultFShader;
   static const GLchar* const alphaFShader;
+  static const GLchar* const yuvFShader;
+  static const GLchar* const yuvMainFShader;
 };
 #endif
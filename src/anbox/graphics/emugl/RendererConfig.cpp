@@ -19,6 +19,8 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <algorithm>
+
 #include "anbox/logger.h"
 
 namespace {
@@ -43,6 +45,10 @@ const GLuint kConfigAttributes[] = {
 const size_t kConfigAttributesLen =
     sizeof(kConfigAttributes) / sizeof(kConfigAttributes[0]);
 
+// Guests only ever use a handful of attribute sets, this only protects
+// against one going wild.
+const size_t kMaxChosenAttributeSets = 64;
+
 bool isCompatibleHostConfig(EGLConfig config, EGLDisplay display) {
   // Filter out configs which do not support pbuffers, since they
   // are used to implement window surfaces.
@@ -106,6 +112,7 @@ RendererConfigList::RendererConfigList(EGLDisplay display)
       continue;
     }
     mConfigs[mCount] = new RendererConfig(hostConfigs[i], display);
+    mGuestIds[hostConfigs[i]] = mCount;
     mCount++;
   }
 
@@ -121,10 +128,50 @@ RendererConfigList::~RendererConfigList() {
 
 int RendererConfigList::chooseConfig(const EGLint* attribs, EGLint* configs,
                                      EGLint configsSize) const {
+  int numAttribs = 0;
+  while (attribs[numAttribs] != EGL_NONE) {
+    numAttribs += 2;
+  }
+
+  // Guests ask for the same few attribute sets again and again, e.g. for
+  // every surface they create, and the host answers them the same way.
+  const std::vector<EGLint> key(attribs, attribs + numAttribs);
+  std::vector<EGLint> guestIds;
+  bool cached = false;
+  {
+    std::lock_guard<std::mutex> lock(mChosenLock);
+    const auto chosen = mChosen.find(key);
+    if (chosen != mChosen.end()) {
+      guestIds = chosen->second;
+      cached = true;
+    }
+  }
+
+  if (!cached && chooseHostConfigs(attribs, numAttribs, &guestIds)) {
+    std::lock_guard<std::mutex> lock(mChosenLock);
+    if (mChosen.size() >= kMaxChosenAttributeSets) {
+      mChosen.clear();
+    }
+    mChosen.emplace(key, guestIds);
+  }
+
+  int result = static_cast<int>(guestIds.size());
+  // Don't count or write more than |configsSize| items if |configs|
+  // is not NULL.
+  if (configs && configsSize > 0) {
+    result = std::min(result, static_cast<int>(configsSize));
+    std::copy(guestIds.begin(), guestIds.begin() + result, configs);
+  }
+  return result;
+}
+
+bool RendererConfigList::chooseHostConfigs(const EGLint* attribs,
+                                           int numAttribs,
+                                           std::vector<EGLint>* guestIds) const {
   EGLint numHostConfigs = 0;
   if (!s_egl.eglGetConfigs(mDisplay, NULL, 0, &numHostConfigs)) {
     ERROR("Could not get number of host EGL configs");
-    return 0;
+    return false;
   }
 
   EGLConfig* matchedConfigs = new EGLConfig[numHostConfigs];
@@ -135,15 +182,13 @@ int RendererConfigList::chooseConfig(const EGLint* attribs, EGLint* configs,
   // the rewrite of |attribs| into a new array.
   bool hasSurfaceType = false;
   bool mustReplaceSurfaceType = false;
-  int numAttribs = 0;
-  while (attribs[numAttribs] != EGL_NONE) {
-    if (attribs[numAttribs] == EGL_SURFACE_TYPE) {
+  for (int n = 0; n < numAttribs; n += 2) {
+    if (attribs[n] == EGL_SURFACE_TYPE) {
       hasSurfaceType = true;
-      if (attribs[numAttribs + 1] != EGL_PBUFFER_BIT) {
+      if (attribs[n + 1] != EGL_PBUFFER_BIT) {
         mustReplaceSurfaceType = true;
       }
     }
-    numAttribs += 2;
   }
 
   EGLint* newAttribs = NULL;
@@ -169,44 +214,23 @@ int RendererConfigList::chooseConfig(const EGLint* attribs, EGLint* configs,
     newAttribs[numAttribs + 2] = EGL_NONE;
   }
 
-  if (!s_egl.eglChooseConfig(mDisplay, newAttribs ? newAttribs : attribs,
-                             matchedConfigs, numHostConfigs, &numHostConfigs)) {
-    numHostConfigs = 0;
-  }
+  const bool chosen = s_egl.eglChooseConfig(mDisplay, newAttribs ? newAttribs : attribs,
+                                            matchedConfigs, numHostConfigs, &numHostConfigs);
 
   delete[] newAttribs;
 
-  int result = 0;
-  for (int n = 0; n < numHostConfigs; ++n) {
-    // Don't count or write more than |configsSize| items if |configs|
-    // is not NULL.
-    if (configs && configsSize > 0 && result >= configsSize) {
-      break;
-    }
-    // Skip incompatible host configs.
-    if (!isCompatibleHostConfig(matchedConfigs[n], mDisplay)) {
-      continue;
-    }
-    // Find the FbConfig with the same EGL_CONFIG_ID
-    EGLint hostConfigId;
-    s_egl.eglGetConfigAttrib(mDisplay, matchedConfigs[n], EGL_CONFIG_ID,
-                             &hostConfigId);
-    for (int k = 0; k < mCount; ++k) {
-      int guestConfigId = mConfigs[k]->getConfigId();
-      if (guestConfigId == hostConfigId) {
-        // There is a match. Write it to |configs| if it is not NULL.
-        if (configs && result < configsSize) {
-          configs[result] = static_cast<uint32_t>(k);
-        }
-        result++;
-        break;
-      }
+  guestIds->clear();
+  for (int n = 0; chosen && n < numHostConfigs; ++n) {
+    // Incompatible host configs aren't known to the guest.
+    const auto guestId = mGuestIds.find(matchedConfigs[n]);
+    if (guestId != mGuestIds.end()) {
+      guestIds->push_back(guestId->second);
     }
   }
 
   delete[] matchedConfigs;
 
-  return result;
+  return chosen;
 }
 
 void RendererConfigList::getPackInfo(EGLint* numConfigs,
@@ -20,6 +20,11 @@
 
 #include <stddef.h>
 
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
 // A class used to model a guest EGL config.
 // This really wraps a host EGLConfig handle, and provides a few cached
 // attributes that can be retrieved through direct accessors, like
@@ -134,6 +139,9 @@ class RendererConfigList {
   // |configsSize| is the number of entries in the |configs| array. The
   // function will never write more than |configsSize| entries into
   // |configsSize|.
+  //
+  // The host is only asked the first time a set of attributes is seen,
+  // later requests for it are answered from a cache.
   EGLint chooseConfig(const EGLint* attribs, EGLint* configs,
                       EGLint configsSize) const;
 
@@ -154,9 +162,19 @@ class RendererConfigList {
   RendererConfigList();
   RendererConfigList(const RendererConfigList& other);
 
+  // Asks the host for the configs matching |attribs| and stores their
+  // guest IDs in |guestIds|. Returns false if the host failed to answer.
+  bool chooseHostConfigs(const EGLint* attribs, int numAttribs,
+                         std::vector<EGLint>* guestIds) const;
+
   int mCount;
   RendererConfig** mConfigs;
   EGLDisplay mDisplay;
+  // Host configs which aren't in here are incompatible ones.
+  std::unordered_map<EGLConfig, EGLint> mGuestIds;
+
+  mutable std::mutex mChosenLock;
+  mutable std::map<std::vector<EGLint>, std::vector<EGLint>> mChosen;
 };
 
 #endif  // _LIBRENDER_FB_CONFIG_H
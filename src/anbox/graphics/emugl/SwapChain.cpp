@@ -0,0 +1,192 @@
+/*
+* Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "SwapChain.h"
+
+#include "CurrentContext.h"
+#include "DispatchTables.h"
+#include "TextureDraw.h"
+
+#include "OpenGLESDispatch/EGLDispatch.h"
+
+#include "anbox/graphics/program_family.h"
+#include "anbox/logger.h"
+
+constexpr size_t SwapChain::numBuffers;
+
+SwapChain::SwapChain(EGLDisplay display, EGLConfig config, EGLContext share,
+                     EGLSurface surface)
+    : m_display(display), m_config(config), m_share(share), m_surface(surface) {
+  // Binding the composing context needs some surface. A tiny one is
+  // cheaper than figuring out whether we can go without one.
+  static const EGLint attribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+  m_composeSurface = s_egl.eglCreatePbufferSurface(m_display, m_config, attribs);
+  if (m_composeSurface == EGL_NO_SURFACE)
+    ERROR("Failed to create compose surface: error=0x%x", s_egl.eglGetError());
+
+  m_presenter = std::thread(&SwapChain::presenterMain, this);
+}
+
+SwapChain::~SwapChain() {
+  stop();
+  if (m_composeSurface != EGL_NO_SURFACE)
+    s_egl.eglDestroySurface(m_display, m_composeSurface);
+}
+
+void SwapChain::stop() {
+  {
+    std::lock_guard<std::mutex> l(m_lock);
+    m_running = false;
+  }
+  m_readyChanged.notify_all();
+  if (m_presenter.joinable())
+    m_presenter.join();
+}
+
+bool SwapChain::beginFrame(int width, int height) {
+  auto& buffer = m_buffers[m_back];
+
+  // The presenter may still sample the buffer.
+  if (buffer.presented) {
+    buffer.presented->wait();
+    buffer.presented.reset();
+  }
+
+  if (buffer.width != width || buffer.height != height) {
+    if (!buffer.texture)
+      s_gles2.glGenTextures(1, &buffer.texture);
+    s_gles2.glBindTexture(GL_TEXTURE_2D, buffer.texture);
+    s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    s_gles2.glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
+                         GL_UNSIGNED_BYTE, nullptr);
+
+    if (!buffer.framebuffer)
+      s_gles2.glGenFramebuffers(1, &buffer.framebuffer);
+    s_gles2.glBindFramebuffer(GL_FRAMEBUFFER, buffer.framebuffer);
+    s_gles2.glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                   GL_TEXTURE_2D, buffer.texture, 0);
+    if (s_gles2.glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+      ERROR("Failed to create %dx%d swap chain buffer", width, height);
+      s_gles2.glBindFramebuffer(GL_FRAMEBUFFER, 0);
+      buffer.width = buffer.height = 0;
+      return false;
+    }
+
+    buffer.width = width;
+    buffer.height = height;
+    return true;
+  }
+
+  s_gles2.glBindFramebuffer(GL_FRAMEBUFFER, buffer.framebuffer);
+  return true;
+}
+
+void SwapChain::endFrame() {
+  auto composed = FenceSync::create();
+  if (!composed)
+    s_gles2.glFinish();
+  s_gles2.glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  {
+    std::lock_guard<std::mutex> l(m_lock);
+    m_buffers[m_back].composed = std::move(composed);
+    std::swap(m_back, m_ready);
+    m_readyIsNew = true;
+  }
+  m_readyChanged.notify_one();
+}
+
+void SwapChain::releaseBuffers() {
+  stop();
+
+  for (auto& buffer : m_buffers) {
+    s_gles2.glDeleteFramebuffers(1, &buffer.framebuffer);
+    s_gles2.glDeleteTextures(1, &buffer.texture);
+    buffer = Buffer{};
+  }
+}
+
+void SwapChain::presenterMain() {
+  static const EGLint contextAttribs[] = {EGL_CONTEXT_CLIENT_VERSION, 2,
+                                          EGL_NONE};
+  EGLContext context =
+      s_egl.eglCreateContext(m_display, m_config, m_share, contextAttribs);
+  if (context == EGL_NO_CONTEXT) {
+    ERROR("Failed to create presenter context: error=0x%x", s_egl.eglGetError());
+    return;
+  }
+
+  if (!CurrentContext::makeCurrent(m_display, m_surface, m_surface, context)) {
+    ERROR("Failed to bind presenter context: error=0x%x", s_egl.eglGetError());
+    s_egl.eglDestroyContext(m_display, context);
+    return;
+  }
+
+  if (s_egl.eglSwapInterval)
+    s_egl.eglSwapInterval(m_display, 1);
+
+  {
+    // Own program family as the renderer one is only used with its lock
+    // held. Both need the context to go away.
+    anbox::graphics::ProgramFamily family;
+    TextureDraw textureDraw(m_display, family);
+
+    while (true) {
+      Buffer* buffer = nullptr;
+      {
+        std::unique_lock<std::mutex> l(m_lock);
+        m_readyChanged.wait(l, [&]() { return !m_running || m_readyIsNew; });
+        if (!m_running)
+          break;
+
+        std::swap(m_front, m_ready);
+        m_readyIsNew = false;
+        buffer = &m_buffers[m_front];
+      }
+
+      if (buffer->composed) {
+        buffer->composed->wait();
+        buffer->composed.reset();
+      }
+
+      EGLint width = 0, height = 0;
+      s_egl.eglQuerySurface(m_display, m_surface, EGL_WIDTH, &width);
+      s_egl.eglQuerySurface(m_display, m_surface, EGL_HEIGHT, &height);
+      s_gles2.glViewport(0, 0, width, height);
+      textureDraw.draw(buffer->texture);
+
+      auto presented = FenceSync::create();
+      if (!presented)
+        s_gles2.glFinish();
+      {
+        std::lock_guard<std::mutex> l(m_lock);
+        buffer->presented = std::move(presented);
+      }
+
+      // Blocks until the next vertical blank but nobody waits for us.
+      s_egl.eglSwapBuffers(m_display, m_surface);
+    }
+  }
+
+  CurrentContext::makeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                              EGL_NO_CONTEXT);
+  s_egl.eglDestroyContext(m_display, context);
+  s_egl.eglReleaseThread();
+  CurrentContext::released();
+}
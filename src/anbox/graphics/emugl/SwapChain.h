@@ -0,0 +1,102 @@
+/*
+* Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef ANBOX_GRAPHICS_EMUGL_SWAP_CHAIN_H_
+#define ANBOX_GRAPHICS_EMUGL_SWAP_CHAIN_H_
+
+#include "FenceSync.h"
+
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Presents the frames composed for a window from a thread of its own.
+//
+// Frames are composed into one of three offscreen buffers instead of the
+// window surface. A finished frame replaces the one waiting to be
+// presented, if any, and the presenter thread blits the latest frame to
+// the surface and swaps with an interval of one. Composing thus never
+// blocks on the host display while the display still never tears.
+class SwapChain {
+ public:
+  static constexpr size_t numBuffers = 3;
+
+  // |share| is the context frames are composed with. The window surface
+  // must not be current on any thread anymore.
+  SwapChain(EGLDisplay display, EGLConfig config, EGLContext share,
+            EGLSurface surface);
+  // Stops presenting. Call releaseBuffers() before.
+  ~SwapChain();
+
+  SwapChain(const SwapChain&) = delete;
+  SwapChain& operator=(const SwapChain&) = delete;
+
+  // Return a surface the composing context can be bound with while the
+  // window surface is current on the presenter thread.
+  EGLSurface composeSurface() const { return m_composeSurface; }
+
+  // Bind the framebuffer of a |width|x|height| buffer the next frame is
+  // composed into. The composing context has to be current.
+  bool beginFrame(int width, int height);
+
+  // Queue the frame composed since beginFrame() for presentation.
+  void endFrame();
+
+  // Stop the presenter and free all buffers. The composing context has to
+  // be current.
+  void releaseBuffers();
+
+ private:
+  struct Buffer {
+    GLuint texture = 0;
+    GLuint framebuffer = 0;
+    int width = 0;
+    int height = 0;
+    // Signal once composing into and presenting the buffer are done. If
+    // fences are not supported both sides finish instead.
+    std::shared_ptr<FenceSync> composed;
+    std::shared_ptr<FenceSync> presented;
+  };
+
+  void stop();
+  void presenterMain();
+
+  EGLDisplay m_display;
+  EGLConfig m_config;
+  EGLContext m_share;
+  EGLSurface m_surface;
+  EGLSurface m_composeSurface = EGL_NO_SURFACE;
+
+  Buffer m_buffers[numBuffers];
+  // Only touched by the composing side.
+  size_t m_back = 0;
+  // Exchanged with |m_back| and |m_front| under |m_lock|.
+  size_t m_ready = 1;
+  bool m_readyIsNew = false;
+  // Only touched by the presenter.
+  size_t m_front = 2;
+
+  std::mutex m_lock;
+  std::condition_variable m_readyChanged;
+  bool m_running = true;
+  std::thread m_presenter;
+};
+
+#endif
@@ -31,32 +31,6 @@
 
 namespace {
 
-// Helper function to create a new shader.
-// |shaderType| is the shader type (e.g. GL_VERTEX_SHADER).
-// |shaderText| is a 0-terminated C string for the shader source to use.
-// On success, return the handle of the new compiled shader, or 0 on failure.
-GLuint createShader(GLint shaderType, const char* shaderText) {
-  // Create new shader handle and attach source.
-  GLuint shader = s_gles2.glCreateShader(shaderType);
-  if (!shader) {
-    return 0;
-  }
-  const GLchar* text = static_cast<const GLchar*>(shaderText);
-  const GLint textLen = ::strlen(shaderText);
-  s_gles2.glShaderSource(shader, 1, &text, &textLen);
-
-  // Compiler the shader.
-  GLint success;
-  s_gles2.glCompileShader(shader);
-  s_gles2.glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-  if (success == GL_FALSE) {
-    s_gles2.glDeleteShader(shader);
-    return 0;
-  }
-
-  return shader;
-}
-
 // No scaling / projection since we want to fill the whole viewport with
 // the texture, hence a trivial vertex shader.
 const char kVertexShaderSource[] =
@@ -97,33 +71,23 @@ const GLint kIndicesLen = sizeof(kIndices) / sizeof(kIndices[0]);
 
 }  // namespace
 
-TextureDraw::TextureDraw(EGLDisplay display)
+TextureDraw::TextureDraw(EGLDisplay display,
+                         anbox::graphics::ProgramFamily& family)
     : mDisplay(display),
-      mVertexShader(0),
-      mFragmentShader(0),
       mProgram(0),
       mPositionSlot(-1),
       mInCoordSlot(-1),
       mTextureSlot(-1),
       mRotationSlot(-1),
-      mTranslationSlot(-1) {
-  // Create shaders and program.
-  mVertexShader = createShader(GL_VERTEX_SHADER, kVertexShaderSource);
-  mFragmentShader = createShader(GL_FRAGMENT_SHADER, kFragmentShaderSource);
-
-  mProgram = s_gles2.glCreateProgram();
-  s_gles2.glAttachShader(mProgram, mVertexShader);
-  s_gles2.glAttachShader(mProgram, mFragmentShader);
-
-  GLint success;
-  s_gles2.glLinkProgram(mProgram);
-  s_gles2.glGetProgramiv(mProgram, GL_LINK_STATUS, &success);
-  if (success == GL_FALSE) {
-    GLchar messages[256];
-    s_gles2.glGetProgramInfoLog(mProgram, sizeof(messages), 0, &messages[0]);
-    ERROR("Could not create/link program: %s", messages);
-    s_gles2.glDeleteProgram(mProgram);
-    mProgram = 0;
+      mTranslationSlot(-1),
+      mVertexBuffer(0),
+      mIndexBuffer(0) {
+  // The program is owned by the family, which also shares it with other
+  // users and may load it from its binary cache.
+  try {
+    mProgram = family.add_program(kVertexShaderSource, kFragmentShaderSource);
+  } catch (const std::exception& err) {
+    ERROR("Could not create/link program: %s", err.what());
     return;
   }
 
@@ -224,11 +188,4 @@ bool TextureDraw::draw(GLuint texture) {
 TextureDraw::~TextureDraw() {
   s_gles2.glDeleteBuffers(1, &mIndexBuffer);
   s_gles2.glDeleteBuffers(1, &mVertexBuffer);
-
-  if (mFragmentShader) {
-    s_gles2.glDeleteShader(mFragmentShader);
-  }
-  if (mVertexShader) {
-    s_gles2.glDeleteShader(mVertexShader);
-  }
 }
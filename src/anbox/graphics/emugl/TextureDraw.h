@@ -18,10 +18,13 @@
 #include <EGL/egl.h>
 #include <GLES2/gl2.h>
 
+#include "anbox/graphics/program_family.h"
+
 // Helper class used to draw a simple texture to the current framebuffer.
 // Usage is pretty simple:
 //
-//   1) Create a TextureDraw instance, passing the current EGLDisplay to it.
+//   1) Create a TextureDraw instance, passing the current EGLDisplay and the
+//      ProgramFamily owning its program to it.
 //
 //   2) Each time you want to draw a texture, call draw(texture, rotation),
 //      where |texture| is the name of a GLES 2.x texture object, and
@@ -32,7 +35,7 @@
 class TextureDraw {
  public:
   // Create a new instance.
-  TextureDraw(EGLDisplay display);
+  TextureDraw(EGLDisplay display, anbox::graphics::ProgramFamily& family);
 
   // Destructor
   ~TextureDraw();
@@ -43,8 +46,6 @@ class TextureDraw {
 
  private:
   EGLDisplay mDisplay;
-  GLuint mVertexShader;
-  GLuint mFragmentShader;
   GLuint mProgram;
   GLint mPositionSlot;
   GLint mInCoordSlot;
@@ -26,6 +26,12 @@
 
 #define MAX_FACTOR_POWER 4
 
+// Up to this factor all FACTOR x FACTOR texels of an output pixel are
+// read in a single pass. That saves the intermediate float texture and a
+// draw. For larger factors the number of reads per pixel grows too much
+// and the separable two pass downscale is cheaper.
+#define MAX_SINGLE_PASS_FACTOR 4
+
 static const char kCommonShaderSource[] =
     "precision mediump float;\n"
     "varying vec2 vUV00, vUV01;\n"
@@ -41,53 +47,54 @@ static const char kCommonShaderSource[] =
 
 static const char kVertexShaderSource[] =
     "attribute vec2 aPosition;\n"
+    "uniform vec2 uDimension;\n"
 
     "void main() {\n"
     "  gl_Position = vec4(aPosition, 0, 1);\n"
-    "  vec2 uv = ((aPosition + 1.0) / 2.0) + 0.5 / kDimension;\n"
+    "  vec2 uv = ((aPosition + 1.0) / 2.0) + 0.5 / uDimension;\n"
     "  vUV00 = uv;\n"
     "  #ifdef HORIZONTAL\n"
-    "  vUV01 = uv + vec2( 1.0 / kDimension.x, 0);\n"
+    "  vUV01 = uv + vec2( 1.0 / uDimension.x, 0);\n"
     "  #if FACTOR > 2\n"
-    "  vUV02 = uv + vec2( 2.0 / kDimension.x, 0);\n"
-    "  vUV03 = uv + vec2( 3.0 / kDimension.x, 0);\n"
+    "  vUV02 = uv + vec2( 2.0 / uDimension.x, 0);\n"
+    "  vUV03 = uv + vec2( 3.0 / uDimension.x, 0);\n"
     "  #if FACTOR > 4\n"
-    "  vUV04 = uv + vec2( 4.0 / kDimension.x, 0);\n"
-    "  vUV05 = uv + vec2( 5.0 / kDimension.x, 0);\n"
-    "  vUV06 = uv + vec2( 6.0 / kDimension.x, 0);\n"
-    "  vUV07 = uv + vec2( 7.0 / kDimension.x, 0);\n"
+    "  vUV04 = uv + vec2( 4.0 / uDimension.x, 0);\n"
+    "  vUV05 = uv + vec2( 5.0 / uDimension.x, 0);\n"
+    "  vUV06 = uv + vec2( 6.0 / uDimension.x, 0);\n"
+    "  vUV07 = uv + vec2( 7.0 / uDimension.x, 0);\n"
     "  #if FACTOR > 8\n"
-    "  vUV08 = uv + vec2( 8.0 / kDimension.x, 0);\n"
-    "  vUV09 = uv + vec2( 9.0 / kDimension.x, 0);\n"
-    "  vUV10 = uv + vec2(10.0 / kDimension.x, 0);\n"
-    "  vUV11 = uv + vec2(11.0 / kDimension.x, 0);\n"
-    "  vUV12 = uv + vec2(12.0 / kDimension.x, 0);\n"
-    "  vUV13 = uv + vec2(13.0 / kDimension.x, 0);\n"
-    "  vUV14 = uv + vec2(14.0 / kDimension.x, 0);\n"
-    "  vUV15 = uv + vec2(15.0 / kDimension.x, 0);\n"
+    "  vUV08 = uv + vec2( 8.0 / uDimension.x, 0);\n"
+    "  vUV09 = uv + vec2( 9.0 / uDimension.x, 0);\n"
+    "  vUV10 = uv + vec2(10.0 / uDimension.x, 0);\n"
+    "  vUV11 = uv + vec2(11.0 / uDimension.x, 0);\n"
+    "  vUV12 = uv + vec2(12.0 / uDimension.x, 0);\n"
+    "  vUV13 = uv + vec2(13.0 / uDimension.x, 0);\n"
+    "  vUV14 = uv + vec2(14.0 / uDimension.x, 0);\n"
+    "  vUV15 = uv + vec2(15.0 / uDimension.x, 0);\n"
     "  #endif\n"  // FACTOR > 8
     "  #endif\n"  // FACTOR > 4
     "  #endif\n"  // FACTOR > 2
 
     "  #else\n"
-    "  vUV01 = uv + vec2(0,  1.0 / kDimension.y);\n"
+    "  vUV01 = uv + vec2(0,  1.0 / uDimension.y);\n"
     "  #if FACTOR > 2\n"
-    "  vUV02 = uv + vec2(0,  2.0 / kDimension.y);\n"
-    "  vUV03 = uv + vec2(0,  3.0 / kDimension.y);\n"
+    "  vUV02 = uv + vec2(0,  2.0 / uDimension.y);\n"
+    "  vUV03 = uv + vec2(0,  3.0 / uDimension.y);\n"
     "  #if FACTOR > 4\n"
-    "  vUV04 = uv + vec2(0,  4.0 / kDimension.y);\n"
-    "  vUV05 = uv + vec2(0,  5.0 / kDimension.y);\n"
-    "  vUV06 = uv + vec2(0,  6.0 / kDimension.y);\n"
-    "  vUV07 = uv + vec2(0,  7.0 / kDimension.y);\n"
+    "  vUV04 = uv + vec2(0,  4.0 / uDimension.y);\n"
+    "  vUV05 = uv + vec2(0,  5.0 / uDimension.y);\n"
+    "  vUV06 = uv + vec2(0,  6.0 / uDimension.y);\n"
+    "  vUV07 = uv + vec2(0,  7.0 / uDimension.y);\n"
     "  #if FACTOR > 8\n"
-    "  vUV08 = uv + vec2(0,  8.0 / kDimension.y);\n"
-    "  vUV09 = uv + vec2(0,  9.0 / kDimension.y);\n"
-    "  vUV10 = uv + vec2(0, 10.0 / kDimension.y);\n"
-    "  vUV11 = uv + vec2(0, 11.0 / kDimension.y);\n"
-    "  vUV12 = uv + vec2(0, 12.0 / kDimension.y);\n"
-    "  vUV13 = uv + vec2(0, 13.0 / kDimension.y);\n"
-    "  vUV14 = uv + vec2(0, 14.0 / kDimension.y);\n"
-    "  vUV15 = uv + vec2(0, 15.0 / kDimension.y);\n"
+    "  vUV08 = uv + vec2(0,  8.0 / uDimension.y);\n"
+    "  vUV09 = uv + vec2(0,  9.0 / uDimension.y);\n"
+    "  vUV10 = uv + vec2(0, 10.0 / uDimension.y);\n"
+    "  vUV11 = uv + vec2(0, 11.0 / uDimension.y);\n"
+    "  vUV12 = uv + vec2(0, 12.0 / uDimension.y);\n"
+    "  vUV13 = uv + vec2(0, 13.0 / uDimension.y);\n"
+    "  vUV14 = uv + vec2(0, 14.0 / uDimension.y);\n"
+    "  vUV15 = uv + vec2(0, 15.0 / uDimension.y);\n"
     "  #endif\n"  // FACTOR > 8
     "  #endif\n"  // FACTOR > 4
     "  #endif\n"  // FACTOR > 2
@@ -124,92 +131,102 @@ const char kFragmentShaderSource[] =
     "  gl_FragColor = sum;\n"
     "}\n";
 
-static const float kVertexData[] = {-1, -1, 3, -1, -1, 3};
+static const char kSinglePassVertexShaderSource[] =
+    "attribute vec2 aPosition;\n"
+    "uniform vec2 uDimension;\n"
+    "varying vec2 vUV;\n"
 
-static void detachShaders(GLuint program) {
-  GLuint shaders[2] = {};
-  GLsizei count = 0;
-  s_gles2.glGetAttachedShaders(program, 2, &count, shaders);
-  if (s_gles2.glGetError() == GL_NO_ERROR) {
-    for (GLsizei i = 0; i < count; i++) {
-      s_gles2.glDetachShader(program, shaders[i]);
-      s_gles2.glDeleteShader(shaders[i]);
-    }
-  }
-}
+    "void main() {\n"
+    "  gl_Position = vec4(aPosition, 0, 1);\n"
+    "  vUV = ((aPosition + 1.0) / 2.0) + 0.5 / uDimension;\n"
+    "}\n";
 
-static GLuint createShader(GLenum type,
-                           const std::initializer_list<const char*>& source) {
-  GLint success, infoLength;
-
-  GLuint shader = s_gles2.glCreateShader(type);
-  if (shader) {
-    s_gles2.glShaderSource(shader, source.size(), source.begin(), nullptr);
-    s_gles2.glCompileShader(shader);
-    s_gles2.glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (success == GL_FALSE) {
-      s_gles2.glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLength);
-      std::string infoLog(infoLength + 1, '\0');
-      s_gles2.glGetShaderInfoLog(shader, infoLength, nullptr, &infoLog[0]);
-      ERROR("%s shader compile failed: %s", (type == GL_VERTEX_SHADER) ? "Vertex" : "Fragment", infoLog.c_str());
-      s_gles2.glDeleteShader(shader);
-      shader = 0;
-    }
-  }
-  return shader;
-}
+// Same filter as the two passes, i.e. a gamma correct box filter, just
+// with all reads done at once.
+static const char kSinglePassFragmentShaderSource[] =
+    "#ifdef GL_FRAGMENT_PRECISION_HIGH\n"
+    "precision highp float;\n"
+    "#else\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "uniform sampler2D uTexture;\n"
+    "uniform vec2 uDimension;\n"
+    "varying vec2 vUV;\n"
+
+    "void main() {\n"
+    "  vec4 sum = vec4(0.0);\n"
+    "  for (int y = 0; y < FACTOR; y++) {\n"
+    "    for (int x = 0; x < FACTOR; x++) {\n"
+    "      vec4 r = texture2D(uTexture, vUV + vec2(float(x), float(y)) / uDimension);\n"
+    "      r.rgb = pow(r.rgb, vec3(2.2));\n"
+    "      sum += r;\n"
+    "    }\n"
+    "  }\n"
+    "  sum /= float(FACTOR * FACTOR);\n"
+    "  sum.rgb = pow(sum.rgb, vec3(1.0 / 2.2));\n"
+    "  gl_FragColor = sum;\n"
+    "}\n";
 
-static void attachShaders(TextureResize::Framebuffer* fb,
-                          const char* factorDefine, const char* dimensionDefine,
-                          GLuint width, GLuint height) {
-  std::ostringstream dimensionConst;
-  dimensionConst << "const vec2 kDimension = vec2(" << width << ", " << height
-                 << ");\n";
-
-  GLuint vShader = createShader(
-      GL_VERTEX_SHADER, {factorDefine, dimensionDefine, kCommonShaderSource,
-                         dimensionConst.str().c_str(), kVertexShaderSource});
-  GLuint fShader = createShader(
-      GL_FRAGMENT_SHADER, {factorDefine, dimensionDefine, kCommonShaderSource,
-                           kFragmentShaderSource});
-
-  if (!vShader || !fShader) {
+static const float kVertexData[] = {-1, -1, 3, -1, -1, 3};
+
+// The programs only depend on the factor and the direction, the size of the
+// source texture is passed in through a uniform. Building them through the
+// family lets all color buffers share them and keeps them in its binary
+// cache.
+static void attachProgram(anbox::graphics::ProgramFamily& family,
+                          TextureResize::Framebuffer* fb,
+                          const std::string& vShader,
+                          const std::string& fShader) {
+  try {
+    fb->program = family.add_program(vShader.c_str(), fShader.c_str());
+  } catch (const std::exception& err) {
+    ERROR("Failed to create resize program: %s", err.what());
+    fb->program = 0;
     return;
   }
 
-  s_gles2.glAttachShader(fb->program, vShader);
-  s_gles2.glAttachShader(fb->program, fShader);
-  s_gles2.glLinkProgram(fb->program);
-
-  s_gles2.glUseProgram(fb->program);
   fb->aPosition = s_gles2.glGetAttribLocation(fb->program, "aPosition");
   fb->uTexture = s_gles2.glGetUniformLocation(fb->program, "uTexture");
+  fb->uDimension = s_gles2.glGetUniformLocation(fb->program, "uDimension");
 }
 
-TextureResize::TextureResize(GLuint width, GLuint height)
-    : mWidth(width),
-      mHeight(height),
-      mFactor(1) {
-  s_gles2.glGenTextures(1, &mFBWidth.texture);
-  s_gles2.glBindTexture(GL_TEXTURE_2D, mFBWidth.texture);
-  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+static void attachTwoPassProgram(anbox::graphics::ProgramFamily& family,
+                                 TextureResize::Framebuffer* fb,
+                                 const std::string& factorDefine,
+                                 const char* dimensionDefine) {
+  const std::string common =
+      factorDefine + dimensionDefine + kCommonShaderSource;
+  attachProgram(family, fb, common + kVertexShaderSource,
+                common + kFragmentShaderSource);
+}
 
-  s_gles2.glGenTextures(1, &mFBHeight.texture);
-  s_gles2.glBindTexture(GL_TEXTURE_2D, mFBHeight.texture);
-  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+static void createTarget(TextureResize::Framebuffer* fb, GLuint width,
+                         GLuint height, GLenum type, GLint filter) {
+  s_gles2.glGenTextures(1, &fb->texture);
+  s_gles2.glBindTexture(GL_TEXTURE_2D, fb->texture);
+  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
   s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
   s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  s_gles2.glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
+                       type, nullptr);
 
-  s_gles2.glGenFramebuffers(1, &mFBWidth.framebuffer);
-  s_gles2.glGenFramebuffers(1, &mFBHeight.framebuffer);
+  s_gles2.glGenFramebuffers(1, &fb->framebuffer);
+  s_gles2.glBindFramebuffer(GL_FRAMEBUFFER, fb->framebuffer);
+  s_gles2.glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                 GL_TEXTURE_2D, fb->texture, 0);
+}
 
-  mFBWidth.program = s_gles2.glCreateProgram();
-  mFBHeight.program = s_gles2.glCreateProgram();
+static void destroyTarget(const TextureResize::Framebuffer& fb) {
+  if (fb.framebuffer) s_gles2.glDeleteFramebuffers(1, &fb.framebuffer);
+  if (fb.texture) s_gles2.glDeleteTextures(1, &fb.texture);
+}
 
+TextureResize::TextureResize(GLuint width, GLuint height,
+                             anbox::graphics::ProgramFamily& family)
+    : mFamily(family),
+      mWidth(width),
+      mHeight(height) {
   s_gles2.glGenBuffers(1, &mVertexBuffer);
   s_gles2.glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
   s_gles2.glBufferData(GL_ARRAY_BUFFER, sizeof(kVertexData), kVertexData,
@@ -217,14 +234,10 @@ TextureResize::TextureResize(GLuint width, GLuint height)
 }
 
 TextureResize::~TextureResize() {
-  GLuint fb[2] = {mFBWidth.framebuffer, mFBHeight.framebuffer};
-  s_gles2.glDeleteFramebuffers(2, fb);
-
-  GLuint tex[2] = {mFBWidth.texture, mFBHeight.texture};
-  s_gles2.glDeleteTextures(2, tex);
-
-  s_gles2.glDeleteProgram(mFBWidth.program);
-  s_gles2.glDeleteProgram(mFBHeight.program);
+  for (const auto& chain : mChains) {
+    destroyTarget(chain.second.horizontal);
+    destroyTarget(chain.second.output);
+  }
 
   s_gles2.glDeleteBuffers(1, &mVertexBuffer);
 }
@@ -256,8 +269,11 @@ GLuint TextureResize::update(GLuint texture) {
   }
 
   s_gles2.glGetError();  // Clear any GL errors.
-  setupFramebuffers(factor);
-  resize(texture);
+  const auto chain = setupChain(factor);
+  if (!chain) {
+    return texture;
+  }
+  resize(*chain, factor, texture);
   s_gles2.glViewport(vport[0], vport[1], vport[2],
                      vport[3]);  // Restore the viewport.
 
@@ -268,56 +284,61 @@ GLuint TextureResize::update(GLuint texture) {
     return texture;
   }
 
-  return mFBHeight.texture;
+  return chain->output.texture;
 }
 
-void TextureResize::setupFramebuffers(unsigned int factor) {
-  if (factor == mFactor) {
-    // The factor hasn't changed, no need to update the framebuffers.
-    return;
+const TextureResize::Chain* TextureResize::setupChain(unsigned int factor) {
+  auto existing = mChains.find(factor);
+  if (existing != mChains.end()) {
+    if (!existing->second.output.program) return nullptr;
+    return &existing->second;
   }
 
-  // Update the framebuffer sizes to match the new factor.
-  s_gles2.glBindTexture(GL_TEXTURE_2D, mFBWidth.texture);
-  s_gles2.glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, mWidth / factor, mHeight, 0,
-                       GL_RGBA, GL_FLOAT, nullptr);
-  s_gles2.glBindFramebuffer(GL_FRAMEBUFFER, mFBWidth.framebuffer);
-  s_gles2.glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-                                 GL_TEXTURE_2D, mFBWidth.texture, 0);
+  // Failures are remembered as well so we don't try again on every frame.
+  auto& chain = mChains[factor];
 
-  s_gles2.glBindTexture(GL_TEXTURE_2D, mFBHeight.texture);
-  s_gles2.glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, mWidth / factor,
-                       mHeight / factor, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-  s_gles2.glBindFramebuffer(GL_FRAMEBUFFER, mFBHeight.framebuffer);
-  s_gles2.glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-                                 GL_TEXTURE_2D, mFBHeight.texture, 0);
-
-  // Update the shaders to the new factor. First detach the old shaders...
-  detachShaders(mFBWidth.program);
-  detachShaders(mFBHeight.program);
-
-  // ... then attach the new ones.
   std::ostringstream factorDefine;
   factorDefine << "#define FACTOR " << factor << "\n";
-  attachShaders(&mFBWidth, factorDefine.str().c_str(), "#define HORIZONTAL\n",
-                mWidth, mHeight);
-  attachShaders(&mFBHeight, factorDefine.str().c_str(), "#define VERTICAL\n",
-                mWidth, mHeight);
 
-  mFactor = factor;
+  chain.singlePass = factor <= MAX_SINGLE_PASS_FACTOR;
+  if (chain.singlePass) {
+    attachProgram(mFamily, &chain.output,
+                  factorDefine.str() + kSinglePassVertexShaderSource,
+                  factorDefine.str() + kSinglePassFragmentShaderSource);
+  } else {
+    createTarget(&chain.horizontal, mWidth / factor, mHeight, GL_FLOAT,
+                 GL_NEAREST);
+    attachTwoPassProgram(mFamily, &chain.horizontal, factorDefine.str(),
+                         "#define HORIZONTAL\n");
+    attachTwoPassProgram(mFamily, &chain.output, factorDefine.str(),
+                         "#define VERTICAL\n");
+    if (!chain.horizontal.program) chain.output.program = 0;
+  }
+
+  createTarget(&chain.output, mWidth / factor, mHeight / factor,
+               GL_UNSIGNED_BYTE, GL_LINEAR);
+  s_gles2.glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  if (!chain.output.program) return nullptr;
+  return &chain;
 }
 
-void TextureResize::resize(GLuint texture) {
+void TextureResize::resize(const Chain& chain, unsigned int factor,
+                           GLuint texture) {
   s_gles2.glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
   s_gles2.glActiveTexture(GL_TEXTURE0);
 
-  // First scale the horizontal dimension by rendering the input texture to a
-  // scaled framebuffer.
-  s_gles2.glBindFramebuffer(GL_FRAMEBUFFER, mFBWidth.framebuffer);
-  s_gles2.glViewport(0, 0, mWidth / mFactor, mHeight);
-  s_gles2.glUseProgram(mFBWidth.program);
-  s_gles2.glEnableVertexAttribArray(mFBWidth.aPosition);
-  s_gles2.glVertexAttribPointer(mFBWidth.aPosition, 2, GL_FLOAT, GL_FALSE, 0,
+  // The first pass reads the input texture, either straight into the
+  // output or scaling only the horizontal dimension into an intermediate
+  // framebuffer.
+  const auto& first = chain.singlePass ? chain.output : chain.horizontal;
+  s_gles2.glBindFramebuffer(GL_FRAMEBUFFER, first.framebuffer);
+  s_gles2.glViewport(0, 0, mWidth / factor,
+                     chain.singlePass ? mHeight / factor : mHeight);
+  s_gles2.glUseProgram(first.program);
+  s_gles2.glUniform2f(first.uDimension, mWidth, mHeight);
+  s_gles2.glEnableVertexAttribArray(first.aPosition);
+  s_gles2.glVertexAttribPointer(first.aPosition, 2, GL_FLOAT, GL_FALSE, 0,
                                 0);
   s_gles2.glBindTexture(GL_TEXTURE_2D, texture);
 
@@ -329,7 +350,7 @@ void TextureResize::resize(GLuint texture) {
                               &min_filter);
   s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
   s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  s_gles2.glUniform1i(mFBWidth.uTexture, 0);
+  s_gles2.glUniform1i(first.uTexture, 0);
   s_gles2.glDrawArrays(GL_TRIANGLES, 0,
                        sizeof(kVertexData) / (2 * sizeof(float)));
 
@@ -337,17 +358,20 @@ void TextureResize::resize(GLuint texture) {
   s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mag_filter);
   s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter);
 
-  // Secondly, scale the vertical dimension using the second framebuffer.
-  s_gles2.glBindFramebuffer(GL_FRAMEBUFFER, mFBHeight.framebuffer);
-  s_gles2.glViewport(0, 0, mWidth / mFactor, mHeight / mFactor);
-  s_gles2.glUseProgram(mFBHeight.program);
-  s_gles2.glEnableVertexAttribArray(mFBHeight.aPosition);
-  s_gles2.glVertexAttribPointer(mFBHeight.aPosition, 2, GL_FLOAT, GL_FALSE, 0,
-                                0);
-  s_gles2.glBindTexture(GL_TEXTURE_2D, mFBWidth.texture);
-  s_gles2.glUniform1i(mFBHeight.uTexture, 0);
-  s_gles2.glDrawArrays(GL_TRIANGLES, 0,
-                       sizeof(kVertexData) / (2 * sizeof(float)));
+  if (!chain.singlePass) {
+    // Secondly, scale the vertical dimension using the second framebuffer.
+    s_gles2.glBindFramebuffer(GL_FRAMEBUFFER, chain.output.framebuffer);
+    s_gles2.glViewport(0, 0, mWidth / factor, mHeight / factor);
+    s_gles2.glUseProgram(chain.output.program);
+    s_gles2.glUniform2f(chain.output.uDimension, mWidth, mHeight);
+    s_gles2.glEnableVertexAttribArray(chain.output.aPosition);
+    s_gles2.glVertexAttribPointer(chain.output.aPosition, 2, GL_FLOAT,
+                                  GL_FALSE, 0, 0);
+    s_gles2.glBindTexture(GL_TEXTURE_2D, chain.horizontal.texture);
+    s_gles2.glUniform1i(chain.output.uTexture, 0);
+    s_gles2.glDrawArrays(GL_TRIANGLES, 0,
+                         sizeof(kVertexData) / (2 * sizeof(float)));
+  }
 
   // Clear the bindings.
   s_gles2.glBindBuffer(GL_ARRAY_BUFFER, 0);
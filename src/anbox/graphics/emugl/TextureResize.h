@@ -18,9 +18,16 @@
 
 #include <GLES2/gl2.h>
 
+#include <map>
+
+#include "anbox/graphics/program_family.h"
+
 class TextureResize {
  public:
-  TextureResize(GLuint width, GLuint height);
+  // The programs used for scaling are owned by |family|, which has to
+  // outlive the instance.
+  TextureResize(GLuint width, GLuint height,
+                anbox::graphics::ProgramFamily& family);
   ~TextureResize();
 
   // Scales the given texture for the current viewport and returns the scaled
@@ -33,18 +40,30 @@ class TextureResize {
     GLuint program = 0;
     GLuint aPosition = 0;
     GLuint uTexture = 0;
+    GLuint uDimension = 0;
+  };
+
+  // Everything needed to scale down by one factor. Built the first time
+  // the factor is needed and kept afterwards as windows keep going back
+  // and forth between the same few sizes while they are resized.
+  struct Chain {
+    // Intermediate target of the horizontal pass. Unused when the whole
+    // downscale happens in a single pass.
+    Framebuffer horizontal;
+    // Holds the scaled texture.
+    Framebuffer output;
+    bool singlePass = false;
   };
 
  private:
-  void setupFramebuffers(unsigned int factor);
-  void resize(GLuint texture);
+  const Chain* setupChain(unsigned int factor);
+  void resize(const Chain& chain, unsigned int factor, GLuint texture);
 
  private:
+  anbox::graphics::ProgramFamily& mFamily;
   GLuint mWidth;
   GLuint mHeight;
-  unsigned int mFactor;
-  Framebuffer mFBWidth;
-  Framebuffer mFBHeight;
+  std::map<unsigned int, Chain> mChains;
   GLuint mVertexBuffer;
 };
 
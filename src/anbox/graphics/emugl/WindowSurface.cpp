@@ -14,6 +14,7 @@
 * limitations under the License.
 */
 #include "WindowSurface.h"
+#include "CurrentContext.h"
 #include "RendererConfig.h"
 
 #include "OpenGLESDispatch/EGLDispatch.h"
@@ -103,13 +104,12 @@ bool WindowSurface::flushColorBuffer() {
     return false;
   }
 
-  // Make the surface current
-  EGLContext prevContext = s_egl.eglGetCurrentContext();
-  EGLSurface prevReadSurf = s_egl.eglGetCurrentSurface(EGL_READ);
-  EGLSurface prevDrawSurf = s_egl.eglGetCurrentSurface(EGL_DRAW);
+  // Make the surface current, which it usually is already as the guest
+  // flushes what it just rendered to.
+  const auto prev = CurrentContext::get();
 
-  if (!s_egl.eglMakeCurrent(mDisplay, mSurface, mSurface,
-                            mDrawContext->getEGLContext())) {
+  if (!CurrentContext::makeCurrent(mDisplay, mSurface, mSurface,
+                                   mDrawContext->getEGLContext())) {
     ERROR("Failed to make draw context current");
     return false;
   }
@@ -117,7 +117,7 @@ bool WindowSurface::flushColorBuffer() {
   mAttachedColorBuffer->blitFromCurrentReadBuffer();
 
   // restore current context/surface
-  s_egl.eglMakeCurrent(mDisplay, prevDrawSurf, prevReadSurf, prevContext);
+  CurrentContext::makeCurrent(mDisplay, prev.draw, prev.read, prev.context);
 
   return true;
 }
@@ -128,16 +128,17 @@ bool WindowSurface::resize(unsigned int p_width, unsigned int p_height) {
     return true;
   }
 
-  EGLContext prevContext = s_egl.eglGetCurrentContext();
-  EGLSurface prevReadSurf = s_egl.eglGetCurrentSurface(EGL_READ);
-  EGLSurface prevDrawSurf = s_egl.eglGetCurrentSurface(EGL_DRAW);
+  const auto prev = CurrentContext::get();
+  EGLContext prevContext = prev.context;
+  EGLSurface prevReadSurf = prev.read;
+  EGLSurface prevDrawSurf = prev.draw;
   EGLSurface prevPbuf = mSurface;
   bool needRebindContext =
       mSurface && (prevReadSurf == mSurface || prevDrawSurf == mSurface);
 
   if (needRebindContext) {
-    s_egl.eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE,
-                         EGL_NO_CONTEXT);
+    CurrentContext::makeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                                EGL_NO_CONTEXT);
   }
 
   if (mSurface) {
@@ -161,7 +162,7 @@ bool WindowSurface::resize(unsigned int p_width, unsigned int p_height) {
   mHeight = p_height;
 
   if (needRebindContext) {
-    s_egl.eglMakeCurrent(
+    CurrentContext::makeCurrent(
         mDisplay, (prevDrawSurf == prevPbuf) ? mSurface : prevDrawSurf,
         (prevReadSurf == prevPbuf) ? mSurface : prevReadSurf, prevContext);
   }
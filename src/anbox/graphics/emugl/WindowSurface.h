@@ -42,6 +42,10 @@ class WindowSurface {
   // Retrieve the host EGLSurface of the WindowSurface's Pbuffer.
   EGLSurface getEGLSurface() const { return mSurface; }
 
+  // Current size of the Pbuffer.
+  GLuint getWidth() const { return mWidth; }
+  GLuint getHeight() const { return mHeight; }
+
   // Attach a ColorBuffer to this WindowSurface.
   // Once attached, calling flushColorBuffer() will copy the Pbuffer's
   // pixels to the color buffer.
@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "anbox/graphics/frame_exporter.h"
+#include "anbox/logger.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <sys/socket.h>
+
+namespace anbox {
+namespace graphics {
+FrameExporter::FrameExporter() : statistics_{0, 0} {}
+
+FrameExporter::~FrameExporter() {}
+
+void FrameExporter::create_connection_for(
+    std::shared_ptr<boost::asio::local::stream_protocol::socket> const &socket) {
+  std::lock_guard<std::mutex> l(lock_);
+
+  // Late clients still need all buffers of the existing windows.
+  for (const auto &window : windows_) {
+    for (std::uint32_t n = 0; n < window.second.size(); n++) {
+      const auto &buffer = window.second[n];
+      if (send_message(socket, buffer_message(window.first, n, buffer), buffer.fd) !=
+          SendResult::Sent) {
+        WARNING("Failed to send buffers to new frame export client");
+        return;
+      }
+    }
+  }
+
+  DEBUG("New frame export client connected");
+  clients_.push_back(socket);
+}
+
+void FrameExporter::add_buffer(std::uint32_t window, std::uint32_t index,
+                               const Buffer &buffer) {
+  std::lock_guard<std::mutex> l(lock_);
+
+  auto &buffers = windows_[window];
+  if (buffers.size() <= index)
+    buffers.resize(index + 1);
+  buffers[index] = buffer;
+
+  // Clients can't make any sense of frames in a buffer they don't know.
+  // Losing a buffer message is therefore the same as losing the client.
+  const auto message = buffer_message(window, index, buffer);
+  for (auto iter = clients_.begin(); iter != clients_.end();) {
+    if (send_message(*iter, message, buffer.fd) != SendResult::Sent) {
+      WARNING("Frame export client is not taking any more buffers; dropping it");
+      iter = clients_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+}
+
+void FrameExporter::frame_ready(std::uint32_t window, std::uint32_t index,
+                                std::uint32_t width, std::uint32_t height,
+                                const std::chrono::steady_clock::time_point &composed) {
+  Message message;
+  std::memset(&message, 0, sizeof(message));
+  message.type = MessageType::Frame;
+  message.window = window;
+  message.buffer = index;
+  message.width = width;
+  message.height = height;
+  message.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             composed.time_since_epoch()).count();
+
+  std::lock_guard<std::mutex> l(lock_);
+  const auto dropped = broadcast_locked(message);
+  statistics_.frames_sent += clients_.size() - dropped;
+  statistics_.frames_dropped += dropped;
+}
+
+void FrameExporter::remove_window(std::uint32_t window) {
+  Message message;
+  std::memset(&message, 0, sizeof(message));
+  message.type = MessageType::WindowRemoved;
+  message.window = window;
+
+  std::lock_guard<std::mutex> l(lock_);
+  windows_.erase(window);
+  if (broadcast_locked(message) > 0)
+    WARNING("Frame export client missed removal of window %d", window);
+}
+
+FrameExporter::Statistics FrameExporter::statistics() {
+  std::lock_guard<std::mutex> l(lock_);
+  return statistics_;
+}
+
+FrameExporter::Message FrameExporter::buffer_message(std::uint32_t window,
+                                                     std::uint32_t index,
+                                                     const Buffer &buffer) {
+  Message message;
+  std::memset(&message, 0, sizeof(message));
+  message.type = MessageType::Buffer;
+  message.window = window;
+  message.buffer = index;
+  message.width = buffer.width;
+  message.height = buffer.height;
+  message.format = buffer.format;
+  message.stride = buffer.stride;
+  message.offset = buffer.offset;
+  message.modifier = buffer.modifier;
+  return message;
+}
+
+std::size_t FrameExporter::broadcast_locked(const Message &message, int fd) {
+  std::size_t would_block = 0;
+  for (auto iter = clients_.begin(); iter != clients_.end();) {
+    const auto result = send_message(*iter, message, fd);
+    if (result == SendResult::Failed) {
+      DEBUG("Frame export client disconnected");
+      iter = clients_.erase(iter);
+      continue;
+    }
+    if (result == SendResult::WouldBlock)
+      would_block++;
+    ++iter;
+  }
+  return would_block;
+}
+
+FrameExporter::SendResult FrameExporter::send_message(const Socket &socket,
+                                                      const Message &message,
+                                                      int fd) {
+  struct iovec iov;
+  iov.iov_base = const_cast<Message *>(&message);
+  iov.iov_len = sizeof(message);
+
+  char control[CMSG_SPACE(sizeof(int))];
+  std::memset(control, 0, sizeof(control));
+
+  struct msghdr header;
+  std::memset(&header, 0, sizeof(header));
+  header.msg_iov = &iov;
+  header.msg_iovlen = 1;
+  if (fd != Fd::invalid) {
+    header.msg_control = control;
+    header.msg_controllen = sizeof(control);
+
+    auto cmsg = CMSG_FIRSTHDR(&header);
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+  }
+
+  // We're called from the compositor which must never wait for clients.
+  ssize_t sent = 0;
+  do {
+    sent = ::sendmsg(socket->native_handle(), &header, MSG_NOSIGNAL | MSG_DONTWAIT);
+  } while (sent < 0 && errno == EINTR);
+
+  if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    return SendResult::WouldBlock;
+
+  // Messages are tiny so a partial write means the client stopped reading
+  // for a long time already. We can't continue the stream without the
+  // rest of the message in any case.
+  if (sent != static_cast<ssize_t>(sizeof(message)))
+    return SendResult::Failed;
+
+  return SendResult::Sent;
+}
+}  // namespace graphics
+}  // namespace anbox
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef ANBOX_GRAPHICS_FRAME_EXPORTER_H_
+#define ANBOX_GRAPHICS_FRAME_EXPORTER_H_
+
+#include "anbox/common/fd.h"
+#include "anbox/network/connection_creator.h"
+
+#include <boost/asio/local/stream_protocol.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace anbox {
+namespace graphics {
+// Hands the composed output of offscreen windows to external processes,
+// e.g. a hardware video encoder, without copying any pixels. Every window
+// renders into a small set of buffers which are exported as dmabufs; the
+// file descriptors of those are passed once to each connected client and
+// afterwards we only tell them which buffer holds a new frame.
+//
+// Clients receive a stream of Message structs in host byte order. Messages
+// of type Buffer carry the dmabuf as SCM_RIGHTS ancillary data. A buffer is
+// rendered into again once the window went through all its other buffers
+// so clients have to be done with a frame by then. The pixel rows of a
+// frame start at the top of the window.
+class FrameExporter
+    : public network::ConnectionCreator<boost::asio::local::stream_protocol> {
+ public:
+  enum class MessageType : std::uint32_t { Buffer = 0, Frame = 1, WindowRemoved = 2 };
+
+  struct Message {
+    MessageType type;
+    std::uint32_t window;
+    std::uint32_t buffer;
+    // Size, DRM fourcc format and layout of the buffer for Buffer
+    // messages. For Frame messages width and height are the part of the
+    // buffer covered by the window, the layout fields are zero.
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t format;
+    std::uint32_t stride;
+    std::uint32_t offset;
+    std::uint64_t modifier;
+    // Time the frame was composed at on the steady clock.
+    std::uint64_t timestamp_ns;
+  } __attribute__((packed));
+  // Clients read the layout above byte for byte, nothing may pad it. All
+  // messages are zeroed before they are filled in all the same.
+  static_assert(sizeof(Message) == 48, "Unexpected frame export message layout");
+
+  struct Buffer {
+    Fd fd;
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t format;
+    std::uint32_t stride;
+    std::uint32_t offset;
+    std::uint64_t modifier;
+  };
+
+  struct Statistics {
+    std::uint64_t frames_sent;
+    // Frames not sent to a client because it didn't keep up.
+    std::uint64_t frames_dropped;
+  };
+
+  FrameExporter();
+  ~FrameExporter();
+
+  void create_connection_for(
+      std::shared_ptr<boost::asio::local::stream_protocol::socket> const &socket) override;
+
+  // Called by the renderer for every buffer of a window when it is
+  // created, before it announces any frame in it.
+  void add_buffer(std::uint32_t window, std::uint32_t index, const Buffer &buffer);
+  // Never blocks; clients which can't take a frame right now miss it.
+  void frame_ready(std::uint32_t window, std::uint32_t index,
+                   std::uint32_t width, std::uint32_t height,
+                   const std::chrono::steady_clock::time_point &composed);
+  void remove_window(std::uint32_t window);
+
+  Statistics statistics();
+
+ private:
+  typedef std::shared_ptr<boost::asio::local::stream_protocol::socket> Socket;
+
+  enum class SendResult { Sent, WouldBlock, Failed };
+  static SendResult send_message(const Socket &socket, const Message &message,
+                                 int fd = Fd::invalid);
+  static Message buffer_message(std::uint32_t window, std::uint32_t index,
+                                const Buffer &buffer);
+  // Sends |message| to all clients and drops those we failed to send to.
+  // Returns the number of clients which would have blocked.
+  std::size_t broadcast_locked(const Message &message, int fd = Fd::invalid);
+
+  std::mutex lock_;
+  std::vector<Socket> clients_;
+  std::map<std::uint32_t, std::vector<Buffer>> windows_;
+  Statistics statistics_;
+};
+}  // namespace graphics
+}  // namespace anbox
+
+#endif
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/frame_statistics.h"
+
+#include <algorithm>
+
+namespace {
+// Guest timestamps further in the past than this are not taken as coming
+// from our clock.
+constexpr std::chrono::seconds max_transfer_time{10};
+}  // namespace
+
+namespace anbox {
+namespace graphics {
+constexpr std::size_t FrameStatistics::max_samples;
+
+FrameStatistics::FrameStatistics(const std::chrono::nanoseconds &refresh_period)
+    : refresh_period_(refresh_period) {}
+
+FrameStatistics::Clock::time_point FrameStatistics::guest_time(
+    std::uint64_t guest_ns, const Clock::time_point &fallback) {
+  if (guest_ns == 0 ||
+      guest_ns > static_cast<std::uint64_t>(Clock::duration::max().count()))
+    return fallback;
+
+  const auto submitted = Clock::time_point{
+      std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds{guest_ns})};
+  if (submitted > fallback || fallback - submitted > max_transfer_time)
+    return fallback;
+  return submitted;
+}
+
+void FrameStatistics::frame_dropped(const std::string &window) {
+  std::lock_guard<std::mutex> l(lock_);
+  windows_[window].dropped_frames++;
+}
+
+void FrameStatistics::set_presented_callback(const PresentedCallback &callback) {
+  std::lock_guard<std::mutex> l(lock_);
+  presented_callback_ = callback;
+}
+
+bool FrameStatistics::frame_presented(const std::string &window,
+                                      const Timestamps &timestamps) {
+  PresentedCallback callback;
+  bool late = false;
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    late = add_presented(windows_[window], timestamps);
+    callback = presented_callback_;
+  }
+  if (callback)
+    callback(timestamps.presented);
+  return late;
+}
+
+bool FrameStatistics::add_presented(Window &w, const Timestamps &timestamps) {
+  const auto has_previous = w.presented_frames > 0;
+  w.presented_frames++;
+
+  w.transfer.add(timestamps.decoded - timestamps.submitted);
+  w.queued.add(timestamps.compose_started - timestamps.decoded);
+  w.compose.add(timestamps.presented - timestamps.compose_started);
+  w.latency.add(timestamps.presented - timestamps.submitted);
+
+  // A frame can't be shown before the previous one was, wherefore the
+  // earliest it could have made it is whatever was later.
+  auto earliest = timestamps.decoded;
+  if (has_previous) {
+    w.frame_time.add(timestamps.presented - w.last_presented);
+    earliest = std::max(earliest, w.last_presented);
+  }
+  const auto late = timestamps.presented - earliest > 2 * refresh_period_;
+  if (late)
+    w.late_frames++;
+
+  w.last_presented = timestamps.presented;
+  return late;
+}
+
+void FrameStatistics::remove(const std::string &window) {
+  std::lock_guard<std::mutex> l(lock_);
+  windows_.erase(window);
+}
+
+std::vector<FrameStatistics::Summary> FrameStatistics::summary() const {
+  std::lock_guard<std::mutex> l(lock_);
+
+  std::vector<Summary> result;
+  for (const auto &w : windows_) {
+    Summary s;
+    s.window = w.first;
+    s.presented_frames = w.second.presented_frames;
+    s.dropped_frames = w.second.dropped_frames;
+    s.late_frames = w.second.late_frames;
+    s.transfer = w.second.transfer.percentiles();
+    s.queued = w.second.queued.percentiles();
+    s.compose = w.second.compose.percentiles();
+    s.latency = w.second.latency.percentiles();
+    s.frame_time = w.second.frame_time.percentiles();
+    result.push_back(s);
+  }
+  return result;
+}
+
+void FrameStatistics::write_prometheus(std::ostream &out) const {
+  const auto windows = summary();
+
+  const auto counter = [&](const char *metric, const char *help,
+                           std::uint64_t Summary::*value) {
+    out << "# HELP " << metric << " " << help << "\n"
+        << "# TYPE " << metric << " counter\n";
+    for (const auto &s : windows)
+      out << metric << "{window=\"" << common::escape_prometheus_label(s.window) << "\"} "
+          << s.*value << "\n";
+  };
+
+  counter("anbox_frames_presented_total", "Frames presented on the host display.",
+          &Summary::presented_frames);
+  counter("anbox_frames_dropped_total", "Frames replaced by a newer one before being composed.",
+          &Summary::dropped_frames);
+  counter("anbox_frames_late_total", "Frames which missed at least one vsync.",
+          &Summary::late_frames);
+
+  out << "# HELP anbox_frame_latency_seconds Time frames spent in each stage from guest submission to presentation.\n"
+      << "# TYPE anbox_frame_latency_seconds gauge\n";
+  for (const auto &s : windows) {
+    const auto window = "window=\"" + common::escape_prometheus_label(s.window) + "\"";
+    common::write_prometheus_quantiles(out, "anbox_frame_latency_seconds", window + ",stage=\"transfer\"", s.transfer);
+    common::write_prometheus_quantiles(out, "anbox_frame_latency_seconds", window + ",stage=\"queued\"", s.queued);
+    common::write_prometheus_quantiles(out, "anbox_frame_latency_seconds", window + ",stage=\"compose\"", s.compose);
+    common::write_prometheus_quantiles(out, "anbox_frame_latency_seconds", window + ",stage=\"total\"", s.latency);
+  }
+
+  out << "# HELP anbox_frame_time_seconds Time between two presented frames.\n"
+      << "# TYPE anbox_frame_time_seconds gauge\n";
+  for (const auto &s : windows)
+    common::write_prometheus_quantiles(out, "anbox_frame_time_seconds",
+                      "window=\"" + common::escape_prometheus_label(s.window) + "\"", s.frame_time);
+}
+}  // namespace graphics
+}  // namespace anbox
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_GRAPHICS_FRAME_STATISTICS_H_
+#define ANBOX_GRAPHICS_FRAME_STATISTICS_H_
+
+#include "anbox/common/latency_samples.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace anbox {
+namespace graphics {
+// Tracks how long frames take from the guest posting them until they are
+// on the host display, per window.
+//
+// Every frame carries the time the guest composer submitted it, when we
+// decoded it, when its composition started and when the buffer swap
+// presenting it returned. As the container shares the kernel with us the
+// guest timestamps come from the same monotonic clock as ours.
+class FrameStatistics {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Timestamps {
+    Clock::time_point submitted;
+    Clock::time_point decoded;
+    Clock::time_point compose_started;
+    Clock::time_point presented;
+  };
+
+  typedef common::LatencySamples::Percentiles Percentiles;
+
+  struct Summary {
+    std::string window;
+    std::uint64_t presented_frames;
+    // Frames replaced by a newer one before they were composed.
+    std::uint64_t dropped_frames;
+    // Frames presented more than two refresh cycles after they could have
+    // been, i.e. which missed at least one vsync.
+    std::uint64_t late_frames;
+    // From the guest submitting a frame until we decoded it.
+    Percentiles transfer;
+    // From decoding a frame until the compositor picked it up.
+    Percentiles queued;
+    // Composition and buffer swap.
+    Percentiles compose;
+    // All of the above.
+    Percentiles latency;
+    // Time between two presentations.
+    Percentiles frame_time;
+  };
+
+  // Percentiles are computed from this many recent frames per window.
+  static constexpr std::size_t max_samples{600};
+
+  explicit FrameStatistics(const std::chrono::nanoseconds &refresh_period);
+
+  // Returns the time a guest submitted a frame at given its monotonic
+  // clock reading |guest_ns|. Readings which can't come from the same
+  // clock as ours yield |fallback|.
+  static Clock::time_point guest_time(std::uint64_t guest_ns,
+                                      const Clock::time_point &fallback);
+
+  // Called with the time of every presented frame.
+  typedef std::function<void(const Clock::time_point &)> PresentedCallback;
+  void set_presented_callback(const PresentedCallback &callback);
+
+  void frame_dropped(const std::string &window);
+  // Returns whether the frame missed at least one vsync.
+  bool frame_presented(const std::string &window, const Timestamps &timestamps);
+
+  // Forget everything about |window|.
+  void remove(const std::string &window);
+
+  std::vector<Summary> summary() const;
+
+  // Writes summary() in the Prometheus text exposition format so it can be
+  // picked up by a node exporter or any other scraper.
+  void write_prometheus(std::ostream &out) const;
+
+ private:
+  struct Window {
+    std::uint64_t presented_frames = 0;
+    std::uint64_t dropped_frames = 0;
+    std::uint64_t late_frames = 0;
+    Clock::time_point last_presented;
+    common::LatencySamples transfer{max_samples};
+    common::LatencySamples queued{max_samples};
+    common::LatencySamples compose{max_samples};
+    common::LatencySamples latency{max_samples};
+    common::LatencySamples frame_time{max_samples};
+  };
+
+  bool add_presented(Window &w, const Timestamps &timestamps);
+
+  const std::chrono::nanoseconds refresh_period_;
+  mutable std::mutex lock_;
+  std::map<std::string, Window> windows_;
+  PresentedCallback presented_callback_;
+};
+}  // namespace graphics
+}  // namespace anbox
+
+#endif
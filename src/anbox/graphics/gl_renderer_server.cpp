@@ -16,69 +16,111 @@
  */
 
 #include "anbox/graphics/gl_renderer_server.h"
+#include "anbox/common/handler_statistics.h"
+#include "anbox/common/latency_samples.h"
+#include "anbox/graphics/emugl/DisplayManager.h"
 #include "anbox/graphics/emugl/RenderApi.h"
 #include "anbox/graphics/emugl/RenderControl.h"
+#include "anbox/graphics/emugl/RenderThread.h"
 #include "anbox/graphics/emugl/Renderer.h"
+#include "anbox/graphics/app_profiles.h"
+#include "anbox/graphics/frame_exporter.h"
 #include "anbox/graphics/layer_composer.h"
 #include "anbox/graphics/multi_window_composer_strategy.h"
 #include "anbox/graphics/single_window_composer_strategy.h"
+#include "anbox/graphics/stream_capture.h"
+#include "anbox/input/latency_statistics.h"
 #include "anbox/logger.h"
 #include "anbox/wm/manager.h"
 
 #include <boost/throw_exception.hpp>
 #include <boost/filesystem.hpp>
 #include <cstdarg>
+#include <fstream>
+#include <iterator>
+#include <sstream>
 #include <stdexcept>
 
 namespace {
 void logger_write(const emugl::LogLevel &level, const char *format, ...) {
-  (void)level;
-
-  char message[2048];
-  va_list args;
-
-  va_start(args, format);
-  vsnprintf(message, sizeof(message) - 1, format, args);
-  va_end(args);
-
+  anbox::Logger::Severity severity;
   switch (level) {
   case emugl::LogLevel::WARNING:
-    WARNING("%s", message);
+    severity = anbox::Logger::Severity::kWarning;
     break;
   case emugl::LogLevel::ERROR:
-    ERROR("%s", message);
+    severity = anbox::Logger::Severity::kError;
     break;
   case emugl::LogLevel::FATAL:
-    FATAL("%s", message);
+    severity = anbox::Logger::Severity::kFatal;
     break;
   case emugl::LogLevel::DEBUG:
-    DEBUG("%s", message);
+    severity = anbox::Logger::Severity::kDebug;
     break;
   case emugl::LogLevel::TRACE:
-    TRACE("%s", message);
+    severity = anbox::Logger::Severity::kTrace;
     break;
   default:
-    break;
+    return;
+  }
+
+  // Render threads call us a lot with verbose messages, don't format them
+  // when they are dropped anyway.
+  if (static_cast<int>(severity) < ANBOX_LOG_MIN_SEVERITY || !anbox::Log().IsEnabled(severity))
+    return;
+
+  char message[2048];
+  va_list args;
+
+  va_start(args, format);
+  vsnprintf(message, sizeof(message) - 1, format, args);
+  va_end(args);
+
+  anbox::Log().Log(severity, message, boost::none);
+}
+
+::Renderer::SwapPolicy swap_policy(const anbox::graphics::GLRendererServer::Config::SwapPolicy &policy) {
+  switch (policy) {
+  case anbox::graphics::GLRendererServer::Config::SwapPolicy::Mailbox:
+    return ::Renderer::SwapPolicy::Mailbox;
+  case anbox::graphics::GLRendererServer::Config::SwapPolicy::Immediate:
+    return ::Renderer::SwapPolicy::Immediate;
+  default:
+    return ::Renderer::SwapPolicy::Fifo;
   }
 }
 }
 
 namespace anbox {
 namespace graphics {
-GLRendererServer::GLRendererServer(const Config &config, const std::shared_ptr<wm::Manager> &wm)
-    : renderer_(std::make_shared<::Renderer>()) {
-
-  std::shared_ptr<LayerComposer::Strategy> composer_strategy;
-  if (config.single_window)
-    composer_strategy = std::make_shared<SingleWindowComposerStrategy>(wm);
+std::istream &operator>>(std::istream &in, GLRendererServer::Config::Driver &driver) {
+  std::string str(std::istreambuf_iterator<char>(in), {});
+  if (str.empty() || str == "translator")
+    driver = GLRendererServer::Config::Driver::Translator;
+  else if (str == "host")
+    driver = GLRendererServer::Config::Driver::Host;
   else
-    composer_strategy = std::make_shared<MultiWindowComposerStrategy>(wm);
+    BOOST_THROW_EXCEPTION(std::runtime_error("Invalid GLES driver value provided"));
+  return in;
+}
 
-  composer_ = std::make_shared<LayerComposer>(renderer_, composer_strategy);
+std::istream &operator>>(std::istream &in, GLRendererServer::Config::SwapPolicy &policy) {
+  std::string str(std::istreambuf_iterator<char>(in), {});
+  if (str.empty() || str == "fifo")
+    policy = GLRendererServer::Config::SwapPolicy::Fifo;
+  else if (str == "mailbox")
+    policy = GLRendererServer::Config::SwapPolicy::Mailbox;
+  else if (str == "immediate")
+    policy = GLRendererServer::Config::SwapPolicy::Immediate;
+  else
+    BOOST_THROW_EXCEPTION(std::runtime_error("Invalid swap policy value provided"));
+  return in;
+}
 
+void GLRendererServer::initialize_gl_libraries(const Config::Driver &driver) {
   auto gl_libs = emugl::default_gl_libraries(true);
 
-  if (config.driver == Config::Driver::Translator) {
+  if (driver == Config::Driver::Translator) {
     DEBUG("Using GLES-to-GL translator for rendering");
     boost::filesystem::path translator_dir = utils::prefix_dir_from_env(TRANSLATOR_INSTALL_DIR, "SNAP");
     gl_libs.push_back(emugl::GLLibrary{emugl::GLLibrary::Type::EGL, (translator_dir / "libEGL_translator.so")});
@@ -92,13 +134,164 @@ GLRendererServer::GLRendererServer(const Config &config, const std::shared_ptr<w
 
   if (!emugl::initialize(gl_libs, &log_funcs, nullptr))
     BOOST_THROW_EXCEPTION(std::runtime_error("Failed to initialize OpenGL renderer"));
+}
+
+GLRendererServer::GLRendererServer(const Config &config, const std::shared_ptr<wm::Manager> &wm)
+    : renderer_(std::make_shared<::Renderer>()),
+      frame_statistics_path_(config.frame_statistics_path) {
+
+  std::shared_ptr<LayerComposer::Strategy> composer_strategy;
+  if (config.single_window)
+    composer_strategy = std::make_shared<SingleWindowComposerStrategy>(wm);
+  else
+    composer_strategy = std::make_shared<MultiWindowComposerStrategy>(wm);
+
+  if (!config.thread_policy.empty()) {
+    thread_policy_ = std::make_shared<RenderThreadPolicy>(config.thread_policy);
+    renderer_->setThreadPolicy(thread_policy_);
+  }
+
+  // Composition happens on its own thread so that posting a frame from
+  // the guest doesn't block its render thread on our buffer swaps.
+  composer_ = std::make_shared<LayerComposer>(renderer_, composer_strategy,
+                                              LayerComposer::Mode::Threaded,
+                                              LayerComposer::default_frame_interval,
+                                              thread_policy_);
+  composer_->set_displays(DisplayManager::get()->displays());
+
+  if (!config.gpu.empty()) {
+    gpu_ = GpuDevice::select(GpuDevice::enumerate(), config.gpu);
+    INFO("Rendering on GPU %s (%s, driver %s)", gpu_.render_node,
+         gpu_.pci_slot.empty() ? "no PCI slot" : gpu_.pci_slot,
+         gpu_.driver.empty() ? "unknown" : gpu_.driver);
+    // Headless renderers pick their device through EGL but Mesa only
+    // listens to DRI_PRIME for anything else. It is read when the
+    // display is initialized.
+    const auto tag = gpu_.dri_prime_tag();
+    if (!tag.empty())
+      ::setenv("DRI_PRIME", tag.c_str(), 1);
+  }
+
+  initialize_gl_libraries(config.driver);
+
+  renderer_->initialize(0, config.headless, gpu_.render_node);
+  renderer_->setMemoryQuota(config.memory_quota);
+  renderer_->setSwapPolicy(swap_policy(config.swap_policy));
+
+  if (!config.command_profile_path.empty()) {
+    INFO("Profiling GL commands; send SIGUSR2 to write a trace to %s",
+         config.command_profile_path);
+    command_profiler_ = RenderThread::createCommandProfiler();
+    command_profile_path_ = config.command_profile_path;
+    renderer_->setCommandProfiler(command_profiler_);
+  }
 
-  renderer_->initialize(0);
+  if (!config.capture_path.empty()) {
+    INFO("Capturing GL streams of all clients to %s", config.capture_path);
+    capture_ = std::make_shared<StreamCapture>(config.capture_path);
+  }
+
+  if (config.frame_export) {
+    frame_exporter_ = std::make_shared<FrameExporter>();
+    renderer_->setFrameExporter(frame_exporter_);
+  }
+
+  if (!config.app_profiles_path.empty()) {
+    app_profiles_ = std::make_shared<AppProfiles>(config.app_profiles_path);
+    renderer_->setAppProfiles(app_profiles_);
+    composer_->set_app_profiles(app_profiles_);
+  }
 
   registerRenderer(renderer_);
   registerLayerComposer(composer_);
 }
 
-GLRendererServer::~GLRendererServer() { renderer_->finalize(); }
+GLRendererServer::~GLRendererServer() {
+  dump_command_profile();
+  save_app_profiles();
+
+  // The compositor thread has to be gone before the renderer is torn down.
+  registerLayerComposer(nullptr);
+  composer_.reset();
+
+  renderer_->finalize();
+}
+
+void GLRendererServer::dump_command_profile() {
+  if (!command_profiler_)
+    return;
+
+  std::stringstream summary;
+  command_profiler_->write_summary(summary);
+  INFO("GL command profile:\n%s", summary.str());
+
+  std::ofstream trace(command_profile_path_, std::ios::trunc);
+  command_profiler_->write_chrome_trace(trace);
+  if (!trace)
+    ERROR("Failed to write GL command trace to %s", command_profile_path_);
+}
+
+void GLRendererServer::set_input_statistics(
+    const std::shared_ptr<input::LatencyStatistics> &statistics) {
+  std::atomic_store(&input_statistics_, statistics);
+
+  std::weak_ptr<input::LatencyStatistics> weak_statistics = statistics;
+  composer_->statistics()->set_presented_callback(
+      [weak_statistics](const FrameStatistics::Clock::time_point &presented) {
+        if (auto statistics = weak_statistics.lock())
+          statistics->frame_presented(presented);
+      });
+}
+
+void GLRendererServer::set_handler_statistics(
+    const std::shared_ptr<common::HandlerStatistics> &statistics) {
+  std::atomic_store(&handler_statistics_, statistics);
+}
+
+void GLRendererServer::set_adaptive_resolution(
+    const std::shared_ptr<AdaptiveResolution> &resolution) {
+  composer_->set_adaptive_resolution(resolution);
+}
+
+void GLRendererServer::write_frame_statistics() {
+  if (frame_statistics_path_.empty())
+    return;
+
+  std::lock_guard<std::mutex> lock(frame_statistics_lock_);
+
+  // Scrapers must never see a partially written file.
+  const auto tmp_path = frame_statistics_path_ + ".tmp";
+  {
+    std::ofstream out(tmp_path, std::ios::trunc);
+    write_metrics(out);
+    if (!out) {
+      ERROR("Failed to write frame statistics to %s", tmp_path);
+      return;
+    }
+  }
+
+  boost::system::error_code err;
+  boost::filesystem::rename(tmp_path, frame_statistics_path_, err);
+  if (err)
+    ERROR("Failed to write frame statistics to %s: %s", frame_statistics_path_, err.message());
+}
+
+void GLRendererServer::save_app_profiles() {
+  if (app_profiles_)
+    app_profiles_->save();
+}
+
+void GLRendererServer::write_metrics(std::ostream &out) const {
+  composer_->statistics()->write_prometheus(out);
+  MemoryAccounting::write_prometheus(out, renderer_->memoryUsage());
+  if (auto input_statistics = std::atomic_load(&input_statistics_))
+    input_statistics->write_prometheus(out);
+  if (auto handler_statistics = std::atomic_load(&handler_statistics_))
+    handler_statistics->write_prometheus(out);
+  if (!gpu_.render_node.empty())
+    out << "anbox_gpu_info{render_node=\"" << common::escape_prometheus_label(gpu_.render_node)
+        << "\",pci_slot=\"" << common::escape_prometheus_label(gpu_.pci_slot)
+        << "\",driver=\"" << common::escape_prometheus_label(gpu_.driver) << "\"} 1\n";
+}
 }  // namespace graphics
 }  // namespace anbox
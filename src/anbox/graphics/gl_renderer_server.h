@@ -18,39 +18,137 @@
 #ifndef ANBOX_GRAPHICS_GL_RENDERER_SERVER_H_
 #define ANBOX_GRAPHICS_GL_RENDERER_SERVER_H_
 
+#include "anbox/graphics/gpu_device.h"
+#include "anbox/graphics/memory_accounting.h"
+#include "anbox/graphics/render_thread_policy.h"
+
+#include <iosfwd>
 #include <memory>
+#include <mutex>
 #include <string>
 
 class Renderer;
 
 namespace anbox {
+namespace common {
+class HandlerStatistics;
+}  // namespace common
 namespace input {
+class LatencyStatistics;
 class Manager;
 }  // namespace input
 namespace wm {
 class Manager;
 }  // namespace wm
 namespace graphics {
+class AdaptiveResolution;
+class AppProfiles;
+class CommandProfiler;
+class FrameExporter;
 class LayerComposer;
+class StreamCapture;
 class GLRendererServer {
  public:
   struct Config {
     enum class Driver { Translator, Host };
     Driver driver;
     bool single_window;
+    // When not empty every command the guest sends is profiled and
+    // dump_command_profile() writes a Chrome trace to this path.
+    std::string command_profile_path;
+    // When not empty write_frame_statistics() stores the frame timing
+    // statistics and the GPU memory usage at this path.
+    std::string frame_statistics_path;
+    // When not empty the GL streams of all guest clients are recorded into
+    // this file for a later replay with anbox-gl-replay.
+    std::string capture_path;
+    // Render all windows offscreen without needing a display server.
+    bool headless;
+    // When set the composed frames of offscreen windows are exported as
+    // dmabufs through frame_exporter() instead of being presented.
+    bool frame_export;
+    // How render threads are scheduled. All of them keep the default
+    // scheduling when empty.
+    RenderThreadPolicy::Config thread_policy;
+    // GPU memory each guest connection may allocate.
+    MemoryAccounting::Quota memory_quota;
+    // How composed frames are presented on native windows, see
+    // Renderer::SwapPolicy.
+    enum class SwapPolicy { Fifo, Mailbox, Immediate };
+    SwapPolicy swap_policy;
+    // When not empty the frames of each Android package are profiled in
+    // this file and the windows of a package are set up by its profile.
+    std::string app_profiles_path;
+    // GPU to render on as understood by GpuDevice::select(), e.g.
+    // "auto" for the least loaded one. The default one of the host EGL
+    // when empty.
+    std::string gpu;
   };
 
+  // Loads the host EGL and GLES libraries of |driver| all GL calls are
+  // dispatched to. Throws if they are not usable. Done by the constructor
+  // already, only needed by users of the renderer without a server.
+  static void initialize_gl_libraries(const Config::Driver &driver);
+
   GLRendererServer(const Config &config, const std::shared_ptr<wm::Manager> &wm);
   ~GLRendererServer();
 
   std::shared_ptr<Renderer> renderer() const { return renderer_; }
+  std::shared_ptr<StreamCapture> stream_capture() const { return capture_; }
+  std::shared_ptr<FrameExporter> frame_exporter() const { return frame_exporter_; }
+
+  // Logs the per command statistics collected so far and writes the
+  // recent commands as Chrome trace. Does nothing unless the server was
+  // configured with a command_profile_path.
+  void dump_command_profile();
+
+  // Atomically replaces the file at the configured frame_statistics_path
+  // with the current frame timing statistics and GPU memory usage in the
+  // Prometheus text format.
+  // Safe to call from several threads.
+  void write_frame_statistics();
+
+  // Writes what write_frame_statistics() stores to |out|, e.g. for
+  // common::Metrics to collect.
+  void write_metrics(std::ostream &out) const;
+
+  // Lets |statistics| see when frames are presented and adds it to what
+  // write_frame_statistics() writes.
+  void set_input_statistics(const std::shared_ptr<input::LatencyStatistics> &statistics);
+
+  // Adds |statistics| to what write_frame_statistics() writes.
+  void set_handler_statistics(const std::shared_ptr<common::HandlerStatistics> &statistics);
+
+  // Lets |resolution| pick the resolution Android renders at from how
+  // the presented frames fare.
+  void set_adaptive_resolution(const std::shared_ptr<AdaptiveResolution> &resolution);
+
+  // Stores the app profiles at the configured app_profiles_path. Done on
+  // destruction as well.
+  void save_app_profiles();
 
  private:
   std::shared_ptr<Renderer> renderer_;
   std::shared_ptr<wm::Manager> wm_;
   std::shared_ptr<LayerComposer> composer_;
+  std::shared_ptr<CommandProfiler> command_profiler_;
+  std::string command_profile_path_;
+  std::string frame_statistics_path_;
+  // Writers share the temporary file next to frame_statistics_path_.
+  std::mutex frame_statistics_lock_;
+  std::shared_ptr<input::LatencyStatistics> input_statistics_;
+  std::shared_ptr<common::HandlerStatistics> handler_statistics_;
+  std::shared_ptr<StreamCapture> capture_;
+  std::shared_ptr<FrameExporter> frame_exporter_;
+  std::shared_ptr<RenderThreadPolicy> thread_policy_;
+  std::shared_ptr<AppProfiles> app_profiles_;
+  // The selected one, empty if the host EGL picked it.
+  GpuDevice gpu_;
 };
 
+// Parses a driver name as given on the command line: host or translator.
+std::istream &operator>>(std::istream &in, GLRendererServer::Config::Driver &driver);
+std::istream &operator>>(std::istream &in, GLRendererServer::Config::SwapPolicy &policy);
 }  // namespace graphics
 }  // namespace anbox
 
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/gpu_device.h"
+#include "anbox/utils.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/throw_exception.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace fs = boost::filesystem;
+
+namespace {
+constexpr const char *render_node_prefix{"renderD"};
+constexpr const char *render_node_dir{"/dev/dri"};
+
+std::uint64_t free_vram(const anbox::graphics::GpuDevice &device) {
+  return device.vram_total - std::min(device.vram_used, device.vram_total);
+}
+
+template <typename T>
+bool read_value(const fs::path &path, T &value) {
+  std::ifstream in(path.string());
+  return static_cast<bool>(in >> value);
+}
+}  // namespace
+
+namespace anbox {
+namespace graphics {
+constexpr const char *GpuDevice::auto_select;
+
+std::vector<GpuDevice> GpuDevice::enumerate(const std::string &drm_dir) {
+  std::vector<GpuDevice> devices;
+
+  boost::system::error_code err;
+  for (fs::directory_iterator it(drm_dir, err), end; !err && it != end; it.increment(err)) {
+    const auto name = it->path().filename().string();
+    if (!utils::string_starts_with(name, render_node_prefix))
+      continue;
+
+    GpuDevice device;
+    device.render_node = (fs::path(render_node_dir) / name).string();
+
+    const auto device_dir = it->path() / "device";
+    boost::system::error_code ignored;
+    const auto bus_path = fs::canonical(device_dir / "subsystem", ignored);
+    if (!ignored && bus_path.filename() == "pci")
+      device.pci_slot = fs::canonical(device_dir, ignored).filename().string();
+    device.driver = fs::canonical(device_dir / "driver", ignored).filename().string();
+    if (ignored)
+      device.driver.clear();
+
+    read_value(device_dir / "mem_info_vram_total", device.vram_total);
+    read_value(device_dir / "mem_info_vram_used", device.vram_used);
+    read_value(device_dir / "gpu_busy_percent", device.busy_percent);
+
+    devices.push_back(device);
+  }
+
+  // Node numbers have the same number of digits, see drm_minor_alloc().
+  std::sort(devices.begin(), devices.end(), [](const GpuDevice &a, const GpuDevice &b) {
+    return a.render_node < b.render_node;
+  });
+  return devices;
+}
+
+GpuDevice GpuDevice::select(const std::vector<GpuDevice> &devices, const std::string &name) {
+  if (name == auto_select) {
+    const auto device = std::min_element(devices.begin(), devices.end(),
+        [](const GpuDevice &a, const GpuDevice &b) {
+          if (a.load() != b.load())
+            return a.load() < b.load();
+          return free_vram(a) > free_vram(b);
+        });
+    if (device == devices.end())
+      BOOST_THROW_EXCEPTION(std::runtime_error("No GPU with a render node found"));
+    return *device;
+  }
+
+  for (const auto &device : devices) {
+    if (device.render_node == name || fs::path(device.render_node).filename() == name ||
+        (!device.pci_slot.empty() && device.pci_slot == name))
+      return device;
+  }
+  BOOST_THROW_EXCEPTION(std::runtime_error("No GPU " + name + " found"));
+}
+
+double GpuDevice::load() const {
+  double load = 0.0;
+  if (busy_percent > 0)
+    load += busy_percent / 100.0;
+  if (vram_total > 0)
+    load += static_cast<double>(std::min(vram_used, vram_total)) / vram_total;
+  return load;
+}
+
+std::string GpuDevice::dri_prime_tag() const {
+  if (pci_slot.empty())
+    return std::string();
+  auto tag = "pci-" + pci_slot;
+  std::replace(tag.begin(), tag.end(), ':', '_');
+  std::replace(tag.begin(), tag.end(), '.', '_');
+  return tag;
+}
+}  // namespace graphics
+}  // namespace anbox
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_GRAPHICS_GPU_DEVICE_H_
+#define ANBOX_GRAPHICS_GPU_DEVICE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace anbox {
+namespace graphics {
+// A GPU of the host with what its driver tells about its load, found
+// through its DRM render node in sysfs.
+struct GpuDevice {
+  // Selects the least loaded GPU for select().
+  static constexpr const char *auto_select{"auto"};
+
+  // All GPUs with a render node below |drm_dir|, ordered by their node.
+  static std::vector<GpuDevice> enumerate(const std::string &drm_dir = "/sys/class/drm");
+
+  // The GPU of |devices| that |name| refers to, either by render node,
+  // e.g. /dev/dri/renderD129 or renderD129, or by PCI slot, e.g.
+  // 0000:03:00.0. With auto_select the one with the least load() and
+  // the most free VRAM among equally loaded ones. Throws
+  // std::runtime_error if there is none.
+  static GpuDevice select(const std::vector<GpuDevice> &devices, const std::string &name);
+
+  // Between 0 for idle and 2 for busy and out of VRAM. Load the driver
+  // doesn't report counts as none.
+  double load() const;
+
+  // How Mesa's DRI_PRIME refers to the GPU, empty if it isn't a PCI one.
+  std::string dri_prime_tag() const;
+
+  std::string render_node;
+  std::string pci_slot;
+  std::string driver;
+  // Only reported by some drivers, e.g. amdgpu. Zero or -1 otherwise.
+  std::uint64_t vram_total = 0;
+  std::uint64_t vram_used = 0;
+  int busy_percent = -1;
+};
+}  // namespace graphics
+}  // namespace anbox
+
+#endif
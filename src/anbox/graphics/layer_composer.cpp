@@ -16,24 +16,287 @@
  */
 
 #include "anbox/graphics/layer_composer.h"
+#include "anbox/common/tracer.h"
 #include "anbox/graphics/emugl/Renderer.h"
+#include "anbox/graphics/render_thread_policy.h"
+#include "anbox/graphics/vsync_clock.h"
 #include "anbox/logger.h"
 #include "anbox/wm/manager.h"
+#include "anbox/wm/window.h"
 
 namespace anbox {
 namespace graphics {
-LayerComposer::LayerComposer(const std::shared_ptr<Renderer> renderer, const std::shared_ptr<Strategy> &strategy)
-    : renderer_(renderer), strategy_(strategy) {}
+constexpr std::chrono::microseconds LayerComposer::default_frame_interval;
+constexpr std::chrono::milliseconds LayerComposer::shown_poll_interval;
+constexpr std::chrono::milliseconds LayerComposer::hidden_guest_frame_period;
 
-LayerComposer::~LayerComposer() {}
+LayerComposer::LayerComposer(const std::shared_ptr<Renderer> renderer, const std::shared_ptr<Strategy> &strategy,
+                             Mode mode, const std::chrono::microseconds &frame_interval,
+                             const std::shared_ptr<RenderThreadPolicy> &thread_policy)
+    : renderer_(renderer),
+      strategy_(strategy),
+      statistics_(std::make_shared<FrameStatistics>(
+          VsyncClock::period_for_refresh_rate(VsyncClock::default_refresh_rate))),
+      mode_(mode),
+      frame_interval_(frame_interval),
+      thread_policy_(thread_policy) {
+  if (mode_ == Mode::Threaded)
+    compositor_thread_ = std::thread(&LayerComposer::compositor_main, this);
+}
+
+LayerComposer::~LayerComposer() {
+  {
+    std::lock_guard<std::mutex> l(mailbox_lock_);
+    running_ = false;
+  }
+  mailbox_changed_.notify_all();
+
+  if (compositor_thread_.joinable())
+    compositor_thread_.join();
+}
+
+void LayerComposer::submit_layers(const RenderableList &renderables,
+                                  const FrameStatistics::Clock::time_point &submitted) {
+  FrameStatistics::Timestamps timestamps;
+  timestamps.decoded = FrameStatistics::Clock::now();
+  timestamps.submitted = submitted == FrameStatistics::Clock::time_point{}
+                             ? timestamps.decoded : submitted;
+
+  PendingFrames frames;
+  for (auto &w : strategy_->process_layers(renderables))
+    frames[w.first] = PendingFrame{std::move(w.second), timestamps};
+
+  if (mode_ == Mode::Synchronous) {
+    take_shown_frames(frames);
+    compose(frames);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> l(mailbox_lock_);
+    // A frame which wasn't presented yet is simply replaced by the new
+    // one for the same window.
+    const auto app_profiles = std::atomic_load(&app_profiles_);
+  const auto adaptive_resolution = std::atomic_load(&adaptive_resolution_);
+    for (auto &f : frames) {
+      auto &pending = mailbox_[f.first];
+      if (!pending.renderables.empty()) {
+        statistics_->frame_dropped(f.first->title());
+        if (app_profiles)
+          app_profiles->frame_dropped(f.first->package());
+      }
+      pending = std::move(f.second);
+    }
+  }
+  mailbox_changed_.notify_one();
+}
+
+void LayerComposer::set_app_profiles(const std::shared_ptr<AppProfiles> &profiles) {
+  std::atomic_store(&app_profiles_, profiles);
+}
+
+void LayerComposer::set_adaptive_resolution(const std::shared_ptr<AdaptiveResolution> &resolution) {
+  std::atomic_store(&adaptive_resolution_, resolution);
+}
+
+void LayerComposer::set_displays(const wm::Display::List &displays) {
+  {
+    std::lock_guard<std::mutex> l(mailbox_lock_);
+    displays_ = displays;
+  }
+  mailbox_changed_.notify_one();
+}
+
+const wm::Display *LayerComposer::display_for_locked(const std::shared_ptr<wm::Window> &window) const {
+  return wm::Display::find(displays_, window->frame());
+}
+
+std::chrono::microseconds LayerComposer::frame_interval_for(const wm::Display *display) const {
+  if (!display || display->refresh_rate() <= 0)
+    return frame_interval_;
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      VsyncClock::period_for_refresh_rate(display->refresh_rate()));
+}
+
+void LayerComposer::compositor_main() {
+  if (thread_policy_)
+    thread_policy_->compositor_thread_started();
+
+  // When the windows of each display are due to be composed again.
+  // Everything outside of the known displays shares the invalid one.
+  std::map<wm::Display::Id, std::chrono::steady_clock::time_point> next_frames;
+  // When windows with a frame rate cap may be composed again.
+  std::map<std::weak_ptr<wm::Window>, std::chrono::steady_clock::time_point,
+           std::owner_less<std::weak_ptr<wm::Window>>> next_window_frames;
+
+  const auto due_at = [&](const std::shared_ptr<wm::Window> &window) {
+    const auto display = display_for_locked(window);
+    auto due = next_frames[display ? display->id() : wm::Display::Invalid];
+    const auto w = next_window_frames.find(window);
+    if (w != next_window_frames.end())
+      due = std::max(due, w->second);
+    return due;
+  };
+
+  while (true) {
+    PendingFrames frames;
+    {
+      std::unique_lock<std::mutex> l(mailbox_lock_);
+      const auto have_frames = [&]() { return !running_ || !mailbox_.empty(); };
+      if (hidden_frames_.empty())
+        mailbox_changed_.wait(l, have_frames);
+      else
+        mailbox_changed_.wait_for(l, shown_poll_interval, have_frames);
+
+      // Give the guest the chance to submit more frames until the next
+      // one for any display is due. Only the latest of them will be
+      // presented. New frames may be for a display which is due earlier
+      // so we have to look again whenever we get one.
+      auto now = std::chrono::steady_clock::now();
+      while (running_ && !mailbox_.empty()) {
+        auto next_frame = std::chrono::steady_clock::time_point::max();
+        for (const auto &f : mailbox_)
+          next_frame = std::min(next_frame, due_at(f.first));
+        if (next_frame <= now)
+          break;
+
+        mailbox_changed_.wait_until(l, next_frame);
+        now = std::chrono::steady_clock::now();
+      }
+      if (!running_)
+        break;
+
+      // Swapping buffers typically blocks until the next vertical blank
+      // of the host display already. The frame interval additionally caps
+      // the rate for drivers which don't do that.
+      std::map<wm::Display::Id, std::chrono::microseconds> due;
+      for (auto iter = mailbox_.begin(); iter != mailbox_.end();) {
+        if (due_at(iter->first) > now) {
+          ++iter;
+          continue;
+        }
+
+        const auto display = display_for_locked(iter->first);
+        due[display ? display->id() : wm::Display::Invalid] = frame_interval_for(display);
+        const auto window_interval = iter->first->frame_interval();
+        if (window_interval.count() > 0)
+          next_window_frames[iter->first] = now + window_interval;
+        else
+          next_window_frames.erase(iter->first);
+
+        frames.insert(std::move(*iter));
+        iter = mailbox_.erase(iter);
+      }
+
+      for (const auto &d : due)
+        next_frames[d.first] = now + d.second;
+
+      for (auto iter = next_window_frames.begin(); iter != next_window_frames.end();) {
+        if (iter->first.expired())
+          iter = next_window_frames.erase(iter);
+        else
+          ++iter;
+      }
+    }
+
+    take_shown_frames(frames);
+    compose(frames);
+  }
+}
+
+void LayerComposer::take_shown_frames(PendingFrames &frames) {
+  for (auto iter = hidden_frames_.begin(); iter != hidden_frames_.end();) {
+    const auto window = iter->first.lock();
+    if (window && !window->visible()) {
+      ++iter;
+      continue;
+    }
+    // Anything newer submitted for the window wins.
+    if (window)
+      frames.insert({window, std::move(iter->second)});
+    iter = hidden_frames_.erase(iter);
+  }
+}
+
+void LayerComposer::compose(const PendingFrames &frames) {
+  ANBOX_TRACE_SPAN("compositor", "compose");
+  const auto app_profiles = std::atomic_load(&app_profiles_);
+  const auto adaptive_resolution = std::atomic_load(&adaptive_resolution_);
+  for (auto &f : frames) {
+    const auto &window = f.first;
+    if (!window->visible()) {
+      hidden_frames_[window] = f.second;
+      continue;
+    }
+    const auto &renderables = f.second.renderables;
+    auto timestamps = f.second.timestamps;
+    timestamps.compose_started = FrameStatistics::Clock::now();
+
+    const auto frame = Rect{0, 0, window->frame().width(), window->frame().height()};
+    const auto content_serial = renderer_->content_serial(renderables);
+
+    auto last = last_frames_.find(window);
+    if (last != last_frames_.end()) {
+      // A serial of zero means the renderer can't tell us whether the
+      // buffer content changed so we have to draw.
+      if (content_serial != 0 &&
+          last->second.content_serial == content_serial &&
+          last->second.frame == frame &&
+          last->second.renderables == renderables)
+        continue;
+
+      last->second = WindowFrame{frame, renderables, content_serial, window->title()};
+    } else {
+      last_frames_.insert({window, WindowFrame{frame, renderables, content_serial, window->title()}});
+    }
+
+    // Drawing returns once the buffers were swapped.
+    if (renderer_->draw(window->native_handle(), frame, renderables)) {
+      timestamps.presented = FrameStatistics::Clock::now();
+      const auto late = statistics_->frame_presented(window->title(), timestamps);
+      if (app_profiles)
+        app_profiles->frame_presented(window->package(),
+                                      timestamps.presented - timestamps.compose_started, late);
+      if (adaptive_resolution)
+        adaptive_resolution->frame_presented(late);
+    }
+  }
+
+  // Forget about windows which are gone so we don't keep state around
+  // for them forever.
+  for (auto iter = last_frames_.begin(); iter != last_frames_.end();) {
+    if (iter->first.expired()) {
+      statistics_->remove(iter->second.title);
+      iter = last_frames_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+
+  std::vector<std::weak_ptr<wm::Window>> windows;
+  windows.reserve(last_frames_.size() + hidden_frames_.size());
+  for (const auto &f : last_frames_)
+    windows.push_back(f.first);
+  for (const auto &f : hidden_frames_)
+    windows.push_back(f.first);
+  std::lock_guard<std::mutex> l(windows_lock_);
+  windows_.swap(windows);
+}
 
-void LayerComposer::submit_layers(const RenderableList &renderables) {
-  auto win_layers = strategy_->process_layers(renderables);
-  for (auto &w : win_layers) {
-    renderer_->draw(w.first->native_handle(),
-                    Rect{0, 0, w.first->frame().width(), w.first->frame().height()},
-                    w.second);
+std::chrono::nanoseconds LayerComposer::guest_frame_period(const std::chrono::nanoseconds &display_period) const {
+  std::lock_guard<std::mutex> l(windows_lock_);
+  bool have_windows = false;
+  std::chrono::nanoseconds period = hidden_guest_frame_period;
+  for (const auto &w : windows_) {
+    const auto window = w.lock();
+    if (!window)
+      continue;
+    have_windows = true;
+    if (window->visible())
+      period = std::min<std::chrono::nanoseconds>(
+          period, std::max<std::chrono::nanoseconds>(display_period, window->frame_interval()));
   }
+  return have_windows ? period : display_period;
 }
 }  // namespace graphics
 }  // namespace anbox
@@ -18,10 +18,21 @@
 #ifndef ANBOX_GRAPHICS_LAYER_COMPOSER_H_
 #define ANBOX_GRAPHICS_LAYER_COMPOSER_H_
 
+#include "anbox/graphics/adaptive_resolution.h"
+#include "anbox/graphics/app_profiles.h"
+#include "anbox/graphics/frame_statistics.h"
 #include "anbox/graphics/renderer.h"
+#include "anbox/wm/display.h"
 
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <memory>
 #include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace anbox {
 namespace wm {
@@ -29,6 +40,7 @@ class Manager;
 class Window;
 }  // namespace wm
 namespace graphics {
+class RenderThreadPolicy;
 class LayerComposer {
  public:
   class Strategy {
@@ -39,15 +51,108 @@ class LayerComposer {
     virtual WindowRenderableList process_layers(const RenderableList &renderables) = 0;
   };
 
+  // With Mode::Synchronous the layers are composed by the thread
+  // submitting them. Mode::Threaded hands them over to a dedicated
+  // compositor thread instead which only ever presents the most
+  // recent frame submitted for a window.
+  enum class Mode { Synchronous, Threaded };
+
+  // Shortest time between two compositions of a display in
+  // Mode::Threaded. Frames submitted in between are collapsed into the
+  // latest one. Displays with a known refresh rate are composed at that
+  // rate instead.
+  static constexpr std::chrono::microseconds default_frame_interval{16667};
+
+  // Frames of hidden windows are kept back until the window is shown
+  // again. Mode::Threaded looks for windows shown again this often,
+  // Mode::Synchronous whenever layers are submitted.
+  static constexpr std::chrono::milliseconds shown_poll_interval{100};
+
+  // Guest frames are paced no slower than this while all windows are
+  // hidden, it still has to get its work done.
+  static constexpr std::chrono::milliseconds hidden_guest_frame_period{250};
+
   LayerComposer(const std::shared_ptr<Renderer> renderer,
-                const std::shared_ptr<Strategy> &strategy);
+                const std::shared_ptr<Strategy> &strategy,
+                Mode mode = Mode::Synchronous,
+                const std::chrono::microseconds &frame_interval = default_frame_interval,
+                const std::shared_ptr<RenderThreadPolicy> &thread_policy = nullptr);
   ~LayerComposer();
 
-  void submit_layers(const RenderableList &renderables);
+  // |submitted| is when the guest submitted the frame. Without it the
+  // frame is taken to be submitted when we got it.
+  void submit_layers(const RenderableList &renderables,
+                     const FrameStatistics::Clock::time_point &submitted = {});
+
+  // Windows are paced by the host display showing the largest part of
+  // them so that each display is composed at its own rate. Windows on
+  // none of |displays| are paced by the frame interval.
+  void set_displays(const wm::Display::List &displays);
+
+  // Timing of the frames presented so far, per window.
+  std::shared_ptr<FrameStatistics> statistics() const { return statistics_; }
+
+  // Vsync period for the guest so that it renders no faster than the
+  // visible window with the highest frame rate cap is composed. Windows
+  // are capped in Mode::Threaded only.
+  std::chrono::nanoseconds guest_frame_period(const std::chrono::nanoseconds &display_period) const;
+
+  // Adds the frames of windows showing a single package to its profile.
+  void set_app_profiles(const std::shared_ptr<AppProfiles> &profiles);
+
+  // Lets |resolution| see which of the presented frames were late.
+  void set_adaptive_resolution(const std::shared_ptr<AdaptiveResolution> &resolution);
 
  private:
+  struct PendingFrame {
+    RenderableList renderables;
+    FrameStatistics::Timestamps timestamps;
+  };
+  typedef std::map<std::shared_ptr<wm::Window>, PendingFrame> PendingFrames;
+
+  void compose(const PendingFrames &frames);
+  void take_shown_frames(PendingFrames &frames);
+  const wm::Display *display_for_locked(const std::shared_ptr<wm::Window> &window) const;
+  std::chrono::microseconds frame_interval_for(const wm::Display *display) const;
+  void compositor_main();
+
+  // What we presented the last time for a window. If neither the layers
+  // nor the content of their buffers changed since then we don't have
+  // to compose the window again.
+  struct WindowFrame {
+    Rect frame;
+    RenderableList renderables;
+    std::uint64_t content_serial;
+    // Lets us drop the statistics of the window once it is gone.
+    std::string title;
+  };
+
   std::shared_ptr<Renderer> renderer_;
   std::shared_ptr<Strategy> strategy_;
+  std::shared_ptr<FrameStatistics> statistics_;
+  std::shared_ptr<AppProfiles> app_profiles_;
+  std::shared_ptr<AdaptiveResolution> adaptive_resolution_;
+  std::map<std::weak_ptr<wm::Window>, WindowFrame,
+           std::owner_less<std::weak_ptr<wm::Window>>> last_frames_;
+  // The latest frame of each hidden window. Only touched by whoever
+  // composes, like last_frames_.
+  std::map<std::weak_ptr<wm::Window>, PendingFrame,
+           std::owner_less<std::weak_ptr<wm::Window>>> hidden_frames_;
+  // All windows we know of, for guest_frame_period().
+  mutable std::mutex windows_lock_;
+  std::vector<std::weak_ptr<wm::Window>> windows_;
+
+  Mode mode_;
+  std::chrono::microseconds frame_interval_;
+  // The compositor thread works for the guest compositor and is scheduled
+  // like its render thread.
+  std::shared_ptr<RenderThreadPolicy> thread_policy_;
+  std::mutex mailbox_lock_;
+  std::condition_variable mailbox_changed_;
+  PendingFrames mailbox_;
+  wm::Display::List displays_;
+  bool running_ = true;
+  std::thread compositor_thread_;
 };
 }  // namespace graphics
 }  // namespace anbox
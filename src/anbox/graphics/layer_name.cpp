@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/layer_name.h"
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+// Points either to the name we're looking up or to one we already stored,
+// so that lookups don't have to construct a std::string first.
+struct Key {
+  const char *data;
+  std::size_t size;
+};
+
+struct KeyHash {
+  std::size_t operator()(const Key &key) const {
+    // FNV-1a
+    std::size_t h = 2166136261u;
+    for (std::size_t n = 0; n < key.size; n++) {
+      h ^= static_cast<unsigned char>(key.data[n]);
+      h *= 16777619u;
+    }
+    return h;
+  }
+};
+
+struct KeyEqual {
+  bool operator()(const Key &lhs, const Key &rhs) const {
+    return lhs.size == rhs.size && std::memcmp(lhs.data, rhs.data, lhs.size) == 0;
+  }
+};
+
+}  // namespace
+
+namespace anbox {
+namespace graphics {
+struct LayerName::Entry {
+  explicit Entry(const char *data, std::size_t size) : name(data, size), refs(1) {}
+
+  const std::string name;
+  // Only drops to zero, and only gets above it again, with the table lock
+  // held, see release().
+  std::atomic<std::size_t> refs;
+};
+
+struct LayerName::Table {
+  std::mutex lock;
+  // Keys point into the names of the entries.
+  std::unordered_map<Key, Entry*, KeyHash, KeyEqual> index;
+};
+
+LayerName::Table &LayerName::table() {
+  // Never destroyed as names may still be referenced by other static
+  // objects during shutdown.
+  static auto t = new Table;
+  return *t;
+}
+
+LayerName::LayerName() : entry_(nullptr) {}
+
+LayerName::LayerName(const char *name) : entry_(intern(name, std::strlen(name))) {}
+
+LayerName::LayerName(const std::string &name) : entry_(intern(name.data(), name.size())) {}
+
+LayerName::LayerName(const LayerName &other) : entry_(other.entry_) {
+  // We already hold a reference through |other|.
+  if (entry_)
+    entry_->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+LayerName::LayerName(LayerName &&other) : entry_(other.entry_) {
+  other.entry_ = nullptr;
+}
+
+LayerName &LayerName::operator=(const LayerName &other) {
+  if (entry_ != other.entry_) {
+    if (other.entry_)
+      other.entry_->refs.fetch_add(1, std::memory_order_relaxed);
+    release(entry_);
+    entry_ = other.entry_;
+  }
+  return *this;
+}
+
+LayerName &LayerName::operator=(LayerName &&other) {
+  if (this != &other) {
+    release(entry_);
+    entry_ = other.entry_;
+    other.entry_ = nullptr;
+  }
+  return *this;
+}
+
+LayerName::~LayerName() { release(entry_); }
+
+const std::string &LayerName::str() const {
+  static const std::string empty;
+  return entry_ ? entry_->name : empty;
+}
+
+std::size_t LayerName::interned() {
+  auto &t = table();
+  std::lock_guard<std::mutex> l(t.lock);
+  return t.index.size();
+}
+
+LayerName::Entry *LayerName::intern(const char *name, std::size_t size) {
+  if (size == 0)
+    return nullptr;
+
+  auto &t = table();
+  std::lock_guard<std::mutex> l(t.lock);
+
+  auto it = t.index.find(Key{name, size});
+  if (it != t.index.end()) {
+    it->second->refs.fetch_add(1, std::memory_order_relaxed);
+    return it->second;
+  }
+
+  auto entry = new Entry(name, size);
+  t.index.insert({Key{entry->name.data(), entry->name.size()}, entry});
+  return entry;
+}
+
+void LayerName::release(Entry *entry) {
+  if (!entry)
+    return;
+
+  // Dropping any but the last reference doesn't need the lock.
+  auto refs = entry->refs.load(std::memory_order_relaxed);
+  while (refs > 1) {
+    if (entry->refs.compare_exchange_weak(refs, refs - 1, std::memory_order_acq_rel))
+      return;
+  }
+
+  // intern() can't hand the entry out again while we hold the lock.
+  auto &t = table();
+  std::lock_guard<std::mutex> l(t.lock);
+  if (entry->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+    return;
+  t.index.erase(Key{entry->name.data(), entry->name.size()});
+  delete entry;
+}
+}  // namespace graphics
+}  // namespace anbox
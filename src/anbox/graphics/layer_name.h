@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_GRAPHICS_LAYER_NAME_H_
+#define ANBOX_GRAPHICS_LAYER_NAME_H_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+namespace anbox {
+namespace graphics {
+// An interned layer name. The guest sends the same few names with every
+// frame, so each distinct name is stored once for as long as a LayerName
+// refers to it and a LayerName only points to it. Copying and comparing
+// names is therefore as cheap as for a pointer and interning a name which
+// is still in use doesn't allocate. Names of layers which are gone are
+// dropped with their last LayerName, so apps creating surfaces with new
+// names all the time don't grow the table.
+class LayerName {
+ public:
+  struct Hash {
+    std::size_t operator()(const LayerName &name) const {
+      return std::hash<const void*>()(name.entry_);
+    }
+  };
+
+  // The empty name.
+  LayerName();
+  explicit LayerName(const char *name);
+  explicit LayerName(const std::string &name);
+
+  LayerName(const LayerName &other);
+  LayerName(LayerName &&other);
+  LayerName &operator=(const LayerName &other);
+  LayerName &operator=(LayerName &&other);
+  ~LayerName();
+
+  const std::string &str() const;
+
+  inline bool operator==(const LayerName &rhs) const { return entry_ == rhs.entry_; }
+  inline bool operator!=(const LayerName &rhs) const { return entry_ != rhs.entry_; }
+
+  // Number of distinct names currently interned.
+  static std::size_t interned();
+
+ private:
+  struct Entry;
+  struct Table;
+
+  static Table &table();
+  static Entry *intern(const char *name, std::size_t size);
+  static void release(Entry *entry);
+
+  // nullptr for the empty name.
+  Entry *entry_;
+};
+}  // namespace graphics
+}  // namespace anbox
+
+#endif
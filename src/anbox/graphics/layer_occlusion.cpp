@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "anbox/graphics/layer_occlusion.h"
+
+namespace {
+bool contains(const anbox::graphics::Rect &outer, const anbox::graphics::Rect &inner) {
+  return inner.left() >= outer.left() && inner.top() >= outer.top() &&
+         inner.right() <= outer.right() && inner.bottom() <= outer.bottom();
+}
+}  // namespace
+
+namespace anbox {
+namespace graphics {
+bool is_opaque(const Renderable &layer) {
+  // Transformed layers may not cover their screen position anymore.
+  return layer.blending() == Renderable::Blending::None && layer.alpha() >= 1.0f &&
+         layer.has_identity_transformation();
+}
+
+std::size_t find_visible_layers(const RenderableList &layers, std::vector<bool> &visible) {
+  visible.assign(layers.size(), true);
+
+  // Frames rarely have more than a handful of layers and even fewer are
+  // opaque, so simply checking against each of them is fine.
+  std::size_t hidden = 0;
+  for (std::size_t n = layers.size(); n-- > 0;) {
+    if (!is_opaque(layers[n]))
+      continue;
+    const auto &cover = layers[n].screen_position();
+    for (std::size_t below = 0; below < n; below++) {
+      if (visible[below] && contains(cover, layers[below].screen_position())) {
+        visible[below] = false;
+        hidden++;
+      }
+    }
+  }
+  return hidden;
+}
+}  // namespace graphics
+}  // namespace anbox
@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef ANBOX_GRAPHICS_LAYER_OCCLUSION_H_
+#define ANBOX_GRAPHICS_LAYER_OCCLUSION_H_
+
+#include "anbox/graphics/emugl/Renderable.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace anbox {
+namespace graphics {
+// Whether |layer| replaces everything in its screen position when drawn.
+bool is_opaque(const Renderable &layer);
+
+// Sets |visible| to whether each of |layers|, drawn in order, can be seen
+// at all. A layer is hidden when a single opaque layer above it covers
+// all of its screen position, which for a fullscreen app is everything
+// below it. Returns the number of hidden layers.
+std::size_t find_visible_layers(const RenderableList &layers, std::vector<bool> &visible);
+}  // namespace graphics
+}  // namespace anbox
+
+#endif
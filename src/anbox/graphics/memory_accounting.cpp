@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/memory_accounting.h"
+#include "anbox/common/memory_usage.h"
+#include "anbox/logger.h"
+
+#include <ostream>
+
+namespace {
+constexpr auto gl_objects = anbox::common::MemoryUsage::Subsystem::GlObjects;
+}  // namespace
+
+namespace anbox {
+namespace graphics {
+MemoryAccounting::MemoryAccounting() : quota_{0, 0} {}
+
+MemoryAccounting::~MemoryAccounting() {
+  for (const auto &allocation : allocations_)
+    common::MemoryUsage::remove(gl_objects, allocation.second.bytes);
+}
+
+MemoryAccounting::Allocations &MemoryAccounting::allocations(Usage &usage, Kind kind) {
+  switch (kind) {
+    case Kind::ColorBuffer:
+      return usage.color_buffers;
+    case Kind::WindowSurface:
+      return usage.window_surfaces;
+    case Kind::ClientImage:
+      break;
+  }
+  return usage.client_images;
+}
+
+MemoryAccounting::Admission MemoryAccounting::admit(std::uint32_t owner, std::size_t bytes) {
+  const auto total = usage(owner).bytes() + bytes;
+
+  if (quota_.hard > 0 && total > quota_.hard) {
+    if (above_hard_quota_.insert(owner).second)
+      WARNING("Refusing GPU memory allocations of render thread %d as it reached its hard quota of %d bytes",
+              owner, quota_.hard);
+    return Admission::Denied;
+  }
+
+  if (quota_.soft > 0 && total > quota_.soft) {
+    if (above_soft_quota_.insert(owner).second)
+      WARNING("Render thread %d uses %d bytes of GPU memory and is above its soft quota of %d bytes",
+              owner, total, quota_.soft);
+    return Admission::AboveSoftQuota;
+  }
+
+  return Admission::Granted;
+}
+
+void MemoryAccounting::add(Kind kind, std::uint32_t handle, std::uint32_t owner, std::size_t bytes) {
+  // Handles get reused once released, so anything still known under the
+  // same one is stale.
+  remove(kind, handle);
+
+  allocations_[Key{kind, handle}] = Allocation{owner, bytes};
+  auto &a = allocations(usage_[owner], kind);
+  a.count++;
+  a.bytes += bytes;
+  common::MemoryUsage::add(gl_objects, bytes);
+}
+
+void MemoryAccounting::resize(Kind kind, std::uint32_t handle, std::size_t bytes) {
+  auto allocation = allocations_.find(Key{kind, handle});
+  if (allocation == allocations_.end())
+    return;
+
+  auto &a = allocations(usage_[allocation->second.owner], kind);
+  a.bytes = a.bytes - allocation->second.bytes + bytes;
+  common::MemoryUsage::add(gl_objects, static_cast<std::int64_t>(bytes) -
+                                           static_cast<std::int64_t>(allocation->second.bytes));
+  allocation->second.bytes = bytes;
+}
+
+void MemoryAccounting::remove(Kind kind, std::uint32_t handle) {
+  auto allocation = allocations_.find(Key{kind, handle});
+  if (allocation == allocations_.end())
+    return;
+
+  const auto owner = allocation->second.owner;
+  auto &usage = usage_[owner];
+  auto &a = allocations(usage, kind);
+  a.count--;
+  a.bytes -= allocation->second.bytes;
+  common::MemoryUsage::remove(gl_objects, allocation->second.bytes);
+  allocations_.erase(allocation);
+
+  // Report crossing a quota again if the connection gets there a second
+  // time.
+  if (quota_.hard == 0 || usage.bytes() <= quota_.hard)
+    above_hard_quota_.erase(owner);
+  if (quota_.soft == 0 || usage.bytes() <= quota_.soft)
+    above_soft_quota_.erase(owner);
+
+  if (usage.color_buffers.count == 0 && usage.window_surfaces.count == 0 &&
+      usage.client_images.count == 0)
+    usage_.erase(owner);
+}
+
+MemoryAccounting::Usage MemoryAccounting::usage(std::uint32_t owner) const {
+  auto usage = usage_.find(owner);
+  if (usage == usage_.end())
+    return Usage{};
+  return usage->second;
+}
+
+void MemoryAccounting::write_prometheus(std::ostream &out, const UsageMap &usage) {
+  const auto gauge = [&](const char *metric, const char *help,
+                         std::size_t Allocations::*value) {
+    out << "# HELP " << metric << " " << help << "\n"
+        << "# TYPE " << metric << " gauge\n";
+    for (const auto &u : usage) {
+      const auto labels = "{render_thread=\"" + std::to_string(u.first) + "\",kind=\"";
+      out << metric << labels << "color_buffer\"} " << u.second.color_buffers.*value << "\n"
+          << metric << labels << "window_surface\"} " << u.second.window_surfaces.*value << "\n"
+          << metric << labels << "client_image\"} " << u.second.client_images.*value << "\n";
+    }
+  };
+
+  gauge("anbox_gpu_memory_bytes", "GPU memory held by each guest connection.",
+        &Allocations::bytes);
+  gauge("anbox_gpu_allocations", "GPU allocations held by each guest connection.",
+        &Allocations::count);
+}
+}  // namespace graphics
+}  // namespace anbox
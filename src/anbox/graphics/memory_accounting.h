@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_GRAPHICS_MEMORY_ACCOUNTING_H_
+#define ANBOX_GRAPHICS_MEMORY_ACCOUNTING_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <set>
+#include <tuple>
+
+namespace anbox {
+namespace graphics {
+// Keeps track of how much GPU memory each guest connection holds so that
+// a single leaking app can't take all of it away from the others.
+//
+// Every allocation is charged to the connection whose render thread made
+// it, even if other connections use it later on, e.g. a buffer an app
+// rendered into and the compositor samples from. Connections are known by
+// the id of their render thread.
+//
+// Like the buffer pool, this does no locking on its own; callers have to
+// serialize access.
+class MemoryAccounting {
+ public:
+  enum class Kind { ColorBuffer, WindowSurface, ClientImage };
+
+  struct Allocations {
+    std::size_t count = 0;
+    std::size_t bytes = 0;
+  };
+
+  struct Usage {
+    Allocations color_buffers;
+    Allocations window_surfaces;
+    // EGL doesn't tell us how large the buffer behind an image is, so
+    // client images are only counted.
+    Allocations client_images;
+
+    std::size_t bytes() const {
+      return color_buffers.bytes + window_surfaces.bytes + client_images.bytes;
+    }
+  };
+  typedef std::map<std::uint32_t, Usage> UsageMap;
+
+  // Limits per connection, in bytes. Zero means no limit.
+  struct Quota {
+    // Going above it is allowed but makes us free cached memory.
+    std::size_t soft;
+    // Allocations which would go above it are refused.
+    std::size_t hard;
+  };
+
+  enum class Admission { Granted, AboveSoftQuota, Denied };
+
+  MemoryAccounting();
+  ~MemoryAccounting();
+
+  // Only affects allocations made afterwards.
+  void set_quota(const Quota &quota) { quota_ = quota; }
+
+  // Tells whether connection |owner| may allocate |bytes| more. Reports
+  // going above the soft quota and refusing an allocation once every time
+  // a connection gets there.
+  Admission admit(std::uint32_t owner, std::size_t bytes);
+
+  // Charges the allocation |handle| of |kind| to |owner|.
+  void add(Kind kind, std::uint32_t handle, std::uint32_t owner, std::size_t bytes);
+  // Updates the size of an allocation, e.g. a window surface resized to
+  // the buffer attached to it.
+  void resize(Kind kind, std::uint32_t handle, std::size_t bytes);
+  void remove(Kind kind, std::uint32_t handle);
+
+  // Returns an empty usage for connections without any allocations.
+  Usage usage(std::uint32_t owner) const;
+  const UsageMap &usage() const { return usage_; }
+
+  // Writes |usage| in the Prometheus text format.
+  static void write_prometheus(std::ostream &out, const UsageMap &usage);
+
+ private:
+  struct Allocation {
+    std::uint32_t owner;
+    std::size_t bytes;
+  };
+  typedef std::tuple<Kind, std::uint32_t> Key;
+
+  static Allocations &allocations(Usage &usage, Kind kind);
+
+  Quota quota_;
+  std::map<Key, Allocation> allocations_;
+  UsageMap usage_;
+  // Connections we already warned about being above their quotas.
+  std::set<std::uint32_t> above_soft_quota_;
+  std::set<std::uint32_t> above_hard_quota_;
+};
+}  // namespace graphics
+}  // namespace anbox
+
+#endif
@@ -16,38 +16,59 @@
  */
 
 #include "anbox/graphics/multi_window_composer_strategy.h"
+#include "anbox/graphics/single_window_composer_strategy.h"
 #include "anbox/wm/manager.h"
 #include "anbox/utils.h"
 
+namespace {
+// Guards against unbounded growth when the guest keeps creating layers
+// with new names while the set of windows stays the same.
+constexpr std::size_t max_routes{256};
+}  // namespace
+
 namespace anbox {
 namespace graphics {
 MultiWindowComposerStrategy::MultiWindowComposerStrategy(const std::shared_ptr<wm::Manager> &wm) : wm_(wm) {}
 
+std::shared_ptr<wm::Window> MultiWindowComposerStrategy::window_for_layer(const LayerName &name) {
+  const auto generation = wm_->generation();
+  if (generation != routes_generation_ || routes_.size() >= max_routes) {
+    routes_.clear();
+    routes_generation_ = generation;
+    for (auto s = settled_sizes_.begin(); s != settled_sizes_.end();) {
+      if (s->first.expired())
+        s = settled_sizes_.erase(s);
+      else
+        ++s;
+    }
+  }
+
+  auto route = routes_.find(name);
+  if (route != routes_.end())
+    return route->second.lock();
+
+  std::shared_ptr<wm::Window> w;
+  wm::Task::Id task_id = 0;
+  // Ignore all surfaces which are not meant for a task
+  if (utils::string_starts_with(name.str(), "org.anbox.surface.") &&
+      sscanf(name.str().c_str(), "org.anbox.surface.%d", &task_id) == 1 && task_id)
+    w = wm_->find_window_for_task(task_id);
+
+  routes_.insert({name, w});
+  return w;
+}
+
 std::map<std::shared_ptr<wm::Window>, RenderableList> MultiWindowComposerStrategy::process_layers(const RenderableList &renderables) {
   WindowRenderableList win_layers;
   for (const auto &renderable : renderables) {
-    // Ignore all surfaces which are not meant for a task
-    if (!utils::string_starts_with(renderable.name(), "org.anbox.surface."))
-      continue;
-
-    wm::Task::Id task_id = 0;
-    if (sscanf(renderable.name().c_str(), "org.anbox.surface.%d", &task_id) != 1 || !task_id)
-      continue;
-
-    auto w = wm_->find_window_for_task(task_id);
+    auto w = window_for_layer(renderable.layer_name());
     if (!w) continue;
 
-    if (win_layers.find(w) == win_layers.end()) {
-      win_layers.insert({w, {renderable}});
-      continue;
-    }
-
     win_layers[w].push_back(renderable);
   }
 
   for (auto &w : win_layers) {
-    const auto &renderables = w.second;
-    RenderableList final_renderables;
+    auto &renderables = w.second;
     auto new_window_frame = Rect::Invalid;
     auto max_layer_area = -1;
 
@@ -72,12 +93,29 @@ std::map<std::shared_ptr<wm::Window>, RenderableList> MultiWindowComposerStrateg
           r.screen_position().right() - new_window_frame.left() + r.crop().left(),
           r.screen_position().bottom() - new_window_frame.top() + r.crop().top()};
 
-      auto new_renderable = r;
-      new_renderable.set_screen_position(rect);
-      final_renderables.push_back(new_renderable);
+      r.set_screen_position(rect);
     }
 
-    w.second = final_renderables;
+    // While a window is resized Android keeps rendering at the size it
+    // had until it got to lay the task out again. That is stretched to the
+    // window instead of leaving a gap or cutting it off. Content which
+    // never had the size of the window, like a task showing just a
+    // dialog, stays as it is.
+    const auto window_width = w.first->frame().width();
+    const auto window_height = w.first->frame().height();
+    const auto content = Rect{0, 0, new_window_frame.width(), new_window_frame.height()};
+    if (content.width() == window_width && content.height() == window_height) {
+      settled_sizes_[w.first] = content;
+      continue;
+    }
+    const auto settled = settled_sizes_.find(w.first);
+    if (settled == settled_sizes_.end() || settled->second != content ||
+        content.width() <= 0 || content.height() <= 0)
+      continue;
+    for (auto &r : renderables)
+      r.set_screen_position(SingleWindowComposerStrategy::scale(
+          r.screen_position(), content.width(), content.height(),
+          window_width, window_height));
   }
 
   return win_layers;
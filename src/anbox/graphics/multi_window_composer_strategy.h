@@ -20,7 +20,10 @@
 
 #include "anbox/graphics/layer_composer.h"
 
+#include <cstdint>
+#include <map>
 #include <memory>
+#include <unordered_map>
 
 namespace anbox {
 namespace graphics {
@@ -32,7 +35,19 @@ class MultiWindowComposerStrategy : public LayerComposer::Strategy {
   WindowRenderableList process_layers(const RenderableList &renderables) override;
 
 private:
+  std::shared_ptr<wm::Window> window_for_layer(const LayerName &name);
+
   std::shared_ptr<wm::Manager> wm_;
+  // Window each layer name is routed to, resolved once when a layer shows
+  // up first. Layers which don't belong to any window map to an expired
+  // pointer. Dropped whenever the set of windows changes.
+  std::unordered_map<LayerName, std::weak_ptr<wm::Window>, LayerName::Hash> routes_;
+  std::uint64_t routes_generation_ = 0;
+  // Size of what Android rendered for each window the last time it
+  // matched the window. Content of that size in a window of another one
+  // is from before a resize and gets scaled to the window.
+  std::map<std::weak_ptr<wm::Window>, Rect,
+           std::owner_less<std::weak_ptr<wm::Window>>> settled_sizes_;
 };
 }  // namespace graphics
 }  // namespace anbox
@@ -18,10 +18,12 @@
 #include "anbox/graphics/opengles_message_processor.h"
 #include "anbox/common/small_vector.h"
 #include "anbox/graphics/buffered_io_stream.h"
-#include "anbox/graphics/emugl/RenderThread.h"
+#include "anbox/graphics/stream_capture.h"
+#include "anbox/graphics/emugl/RenderThreadPool.h"
 #include "anbox/logger.h"
 #include "anbox/network/connections.h"
 #include "anbox/network/delegate_message_processor.h"
+#include "anbox/utils.h"
 
 #include <condition_variable>
 #include <functional>
@@ -32,33 +34,48 @@ namespace graphics {
 emugl::Mutex OpenGlesMessageProcessor::global_lock{};
 
 OpenGlesMessageProcessor::OpenGlesMessageProcessor(
-    const std::shared_ptr<Renderer> &renderer,
-    const std::shared_ptr<network::SocketMessenger> &messenger)
+    const std::shared_ptr<RenderThreadPool> &render_threads,
+    const std::shared_ptr<network::SocketMessenger> &messenger,
+    const std::shared_ptr<StreamCapture> &capture,
+    std::size_t stream_buffer_size, pid_t owner)
     : messenger_(messenger),
-      stream_(std::make_shared<BufferedIOStream>(messenger_)) {
-  // We have to read the client flags first before we can continue
-  // processing the actual commands
-  unsigned int client_flags = 0;
-  auto err = messenger_->receive_msg(
-      boost::asio::buffer(&client_flags, sizeof(unsigned int)));
-  if (err) ERROR("%s", err.message());
+      stream_(std::make_shared<BufferedIOStream>(messenger_, BufferedIOStream::default_buffer_size,
+                                                 BufferedIOStream::default_max_write_batch_size,
+                                                 stream_buffer_size)),
+      render_threads_(render_threads),
+      capture_(capture),
+      capture_stream_(0) {
+  // By default all render threads decode and execute in parallel and only
+  // the operations touching shared renderer state are serialized. Setting
+  // ANBOX_GL_SERIALIZED_DECODING restores the old behaviour where all
+  // threads are serialized by a single global lock.
+  auto lock = utils::is_env_set("ANBOX_GL_SERIALIZED_DECODING") ? &global_lock : nullptr;
 
-  render_thread_.reset(RenderThread::create(renderer, stream_.get(), &global_lock));
-  if (!render_thread_->start())
+  // The client flags were read off the socket before we got created and
+  // are not part of the captured stream as a replay doesn't need them.
+  if (capture_)
+    capture_stream_ = capture_->open_stream();
+
+  render_client_ = render_threads_->serve(stream_.get(), lock, owner);
+  if (!render_client_)
     BOOST_THROW_EXCEPTION(
         std::runtime_error("Failed to start renderer thread"));
 }
 
 OpenGlesMessageProcessor::~OpenGlesMessageProcessor() {
-  render_thread_->forceStop();
-  render_thread_->wait(nullptr);
+  render_threads_->stop(render_client_);
+
+  if (capture_)
+    capture_->close_stream(capture_stream_);
 }
 
-bool OpenGlesMessageProcessor::process_data(
-    const std::vector<std::uint8_t> &data) {
+bool OpenGlesMessageProcessor::process_data(const std::uint8_t *data,
+                                            size_t size) {
+  if (capture_)
+    capture_->data(capture_stream_, data, size);
+
   auto stream = std::static_pointer_cast<BufferedIOStream>(stream_);
-  Buffer buffer{data.data(), data.data() + data.size()};
-  stream->post_data(std::move(buffer));
+  stream->post_data(data, size);
   return true;
 }
 }  // namespace graphics
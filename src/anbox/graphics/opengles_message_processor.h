@@ -26,30 +26,42 @@
 #include "anbox/network/socket_connection.h"
 #include "anbox/network/socket_messenger.h"
 #include "anbox/runtime.h"
+#include "anbox/graphics/buffered_io_stream.h"
+#include "anbox/graphics/emugl/RenderThreadPool.h"
 
 #include "external/android-emugl/shared/emugl/common/mutex.h"
 
 class IOStream;
-class RenderThread;
-class Renderer;
+class RenderThreadPool;
 
 namespace anbox {
 namespace graphics {
+class StreamCapture;
 class OpenGlesMessageProcessor : public network::MessageProcessor {
  public:
+  // Up to |stream_buffer_size| bytes of commands are buffered for the
+  // render thread. The commands can use the buffer memory the guest
+  // process |owner| shared, see RenderThreadPool::serve().
   OpenGlesMessageProcessor(
-      const std::shared_ptr<Renderer> &renderer,
-      const std::shared_ptr<network::SocketMessenger> &messenger);
+      const std::shared_ptr<RenderThreadPool> &render_threads,
+      const std::shared_ptr<network::SocketMessenger> &messenger,
+      const std::shared_ptr<StreamCapture> &capture = nullptr,
+      std::size_t stream_buffer_size = BufferedIOStream::default_in_buffer_size,
+      pid_t owner = 0);
   ~OpenGlesMessageProcessor();
 
-  bool process_data(const std::vector<std::uint8_t> &data) override;
+  bool process_data(const std::uint8_t *data, size_t size) override;
 
  private:
   static emugl::Mutex global_lock;
 
   std::shared_ptr<network::SocketMessenger> messenger_;
   std::shared_ptr<IOStream> stream_;
-  std::shared_ptr<RenderThread> render_thread_;
+  std::shared_ptr<RenderThreadPool> render_threads_;
+  std::shared_ptr<RenderThreadPool::Client> render_client_;
+  // All data the guest sends us is copied into the capture if there is one.
+  std::shared_ptr<StreamCapture> capture_;
+  std::uint32_t capture_stream_;
 };
 }  // namespace graphics
 }  // namespace anbox
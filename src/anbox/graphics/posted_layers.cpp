@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "anbox/graphics/posted_layers.h"
+#include "anbox/logger.h"
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include <cstring>
+
+namespace {
+// From hardware/hwcomposer_defs.h
+constexpr std::uint32_t hwc_transform_flip_h{0x01};
+constexpr std::uint32_t hwc_transform_flip_v{0x02};
+constexpr std::uint32_t hwc_transform_rot_90{0x04};
+constexpr std::uint32_t hwc_blending_none{0x0100};
+constexpr std::uint32_t hwc_blending_premult{0x0105};
+constexpr std::uint32_t hwc_blending_coverage{0x0405};
+
+constexpr std::size_t max_name_size{256};
+
+Renderable::Blending blending_for(std::uint32_t blending) {
+  switch (blending) {
+    case hwc_blending_none:
+      return Renderable::Blending::None;
+    case hwc_blending_coverage:
+      return Renderable::Blending::Coverage;
+    case hwc_blending_premult:
+    default:
+      return Renderable::Blending::Premultiplied;
+  }
+}
+}  // namespace
+
+namespace anbox {
+namespace graphics {
+bool decode_posted_layers(const void *data, std::size_t size, RenderableList &layers) {
+  auto ptr = static_cast<const std::uint8_t *>(data);
+  const auto end = ptr + size;
+
+  while (ptr < end) {
+    PostedLayer layer;
+    if (static_cast<std::size_t>(end - ptr) < sizeof(layer)) {
+      WARNING("Posted layers end with a truncated layer");
+      return false;
+    }
+    std::memcpy(&layer, ptr, sizeof(layer));
+    ptr += sizeof(layer);
+
+    const auto padded_name_size = (static_cast<std::size_t>(layer.name_size) + 3) & ~std::size_t{3};
+    if (layer.name_size == 0 || layer.name_size > max_name_size ||
+        static_cast<std::size_t>(end - ptr) < padded_name_size ||
+        ptr[layer.name_size - 1] != '\0') {
+      WARNING("Posted layer has an invalid name");
+      return false;
+    }
+    const auto name = reinterpret_cast<const char *>(ptr);
+    ptr += padded_name_size;
+
+    Rect screen_position{layer.display_frame[0], layer.display_frame[1],
+                         layer.display_frame[2], layer.display_frame[3]};
+    const auto transformation = transformation_for(layer.transform, screen_position);
+    layers.push_back(Renderable{
+        LayerName{name},
+        layer.color_buffer,
+        screen_position,
+        {layer.source_crop[0], layer.source_crop[1], layer.source_crop[2], layer.source_crop[3]},
+        transformation,
+        std::min<std::uint32_t>(layer.plane_alpha, 255) / 255.0f,
+        blending_for(layer.blending)});
+  }
+  return true;
+}
+
+glm::mat4 transformation_for(std::uint32_t transform, Rect &screen_position) {
+  glm::mat4 transformation{1.0f};
+  if (transform == 0)
+    return transformation;
+
+  // Android flips first and rotates the result clockwise afterwards.
+  if (transform & hwc_transform_rot_90) {
+    transformation = glm::rotate(transformation, glm::half_pi<float>(), glm::vec3{0.0f, 0.0f, 1.0f});
+
+    // The buffer is drawn with its sides swapped, centered on where it
+    // ends up, so that the rotation moves it right into place.
+    const auto width = screen_position.width();
+    const auto height = screen_position.height();
+    const auto left = screen_position.left() + (width - height) / 2;
+    const auto top = screen_position.top() + (height - width) / 2;
+    screen_position = Rect{left, top, left + height, top + width};
+  }
+  if (transform & hwc_transform_flip_v)
+    transformation = glm::scale(transformation, glm::vec3{1.0f, -1.0f, 1.0f});
+  if (transform & hwc_transform_flip_h)
+    transformation = glm::scale(transformation, glm::vec3{-1.0f, 1.0f, 1.0f});
+  return transformation;
+}
+}  // namespace graphics
+}  // namespace anbox
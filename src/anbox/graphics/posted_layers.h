@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef ANBOX_GRAPHICS_POSTED_LAYERS_H_
+#define ANBOX_GRAPHICS_POSTED_LAYERS_H_
+
+#include "anbox/graphics/emugl/Renderable.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace anbox {
+namespace graphics {
+// The layers of a frame as the guest composer submits them with a single
+// rcPostLayers call: one record per layer, each followed by the zero
+// terminated name of the layer padded to a multiple of four bytes.
+//
+// NOTE: If you modify this struct you have to modify the version on the
+// Android side too. See android/hwcomposer/hwcomposer.cpp
+struct PostedLayer {
+  std::uint32_t color_buffer;
+  std::int32_t source_crop[4];
+  std::int32_t display_frame[4];
+  // HWC_TRANSFORM_* flags.
+  std::uint32_t transform;
+  // HWC_BLENDING_* value.
+  std::uint32_t blending;
+  // 0 is fully transparent and 255 fully opaque.
+  std::uint32_t plane_alpha;
+  // Including the terminator but not the padding.
+  std::uint32_t name_size;
+};
+
+// Appends the |size| bytes of records at |data| to |layers|. Returns false
+// if they're malformed, in which case everything up to the first broken
+// record was appended.
+bool decode_posted_layers(const void *data, std::size_t size, RenderableList &layers);
+
+// Maps the HWC_TRANSFORM_* flags |transform| to the transformation the
+// renderer applies around the center of |screen_position|. For rotations
+// by 90 and 270 degrees |screen_position| is changed to the rectangle the
+// buffer has to be drawn into before it is rotated into place.
+glm::mat4 transformation_for(std::uint32_t transform, Rect &screen_position);
+}  // namespace graphics
+}  // namespace anbox
+
+#endif
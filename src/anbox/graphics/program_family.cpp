@@ -17,9 +17,60 @@
  */
 
 #include "anbox/graphics/program_family.h"
+#include "anbox/logger.h"
 
 #include "anbox/graphics/emugl/DispatchTables.h"
 
+#include <boost/filesystem.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace fs = boost::filesystem;
+
+namespace {
+// Written in front of every cached binary. The version has to be bumped
+// whenever the layout of the cache files changes.
+struct BinaryHeader {
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint32_t format;
+  std::uint32_t length;
+};
+constexpr std::uint32_t binary_magic{0x42504e41};  // "ANPB"
+constexpr std::uint32_t binary_version{1};
+// Anything larger than this is certainly not one of our programs.
+constexpr std::uint32_t max_binary_length{16 * 1024 * 1024};
+
+// FNV-1a, as it needs to stay stable between runs and builds.
+std::uint64_t hash(std::uint64_t h, std::string const& data) {
+  for (auto c : data) {
+    h ^= static_cast<unsigned char>(c);
+    h *= 0x100000001b3ULL;
+  }
+  // Terminate each string so that moving characters between them changes
+  // the hash.
+  h ^= 0xff;
+  h *= 0x100000001b3ULL;
+  return h;
+}
+
+bool has_extension(const char* extensions, const char* name) {
+  if (!extensions) return false;
+
+  const auto len = std::strlen(name);
+  for (auto p = std::strstr(extensions, name); p;
+       p = std::strstr(p + len, name)) {
+    if ((p == extensions || p[-1] == ' ') && (p[len] == ' ' || p[len] == '\0'))
+      return true;
+  }
+  return false;
+}
+}  // namespace
+
 namespace anbox {
 namespace graphics {
 void ProgramFamily::Shader::init(GLenum type, const GLchar* src) {
@@ -61,32 +112,146 @@ ProgramFamily::~ProgramFamily() noexcept {
   }
 }
 
+void ProgramFamily::enable_binary_cache(fs::path const& cache_dir) {
+  if (!s_gles2.glGetProgramBinaryOES || !s_gles2.glProgramBinaryOES) return;
+
+  const auto extensions =
+      reinterpret_cast<const char*>(s_gles2.glGetString(GL_EXTENSIONS));
+  if (!has_extension(extensions, "GL_OES_get_program_binary")) return;
+
+  // Some drivers advertise the extension without supporting any format.
+  GLint formats = 0;
+  s_gles2.glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &formats);
+  if (formats <= 0) return;
+
+  boost::system::error_code err;
+  fs::create_directories(cache_dir, err);
+  if (err) {
+    WARNING("Not caching program binaries, failed to create %s: %s",
+            cache_dir.string(), err.message());
+    return;
+  }
+
+  const auto renderer =
+      reinterpret_cast<const char*>(s_gles2.glGetString(GL_RENDERER));
+  const auto version =
+      reinterpret_cast<const char*>(s_gles2.glGetString(GL_VERSION));
+
+  binary_dir = cache_dir;
+  binary_key = std::string(renderer ? renderer : "") + "\n" +
+               std::string(version ? version : "");
+}
+
+fs::path ProgramFamily::binary_path(SourcePair const& sources) const {
+  auto h = hash(0xcbf29ce484222325ULL, binary_key);
+  h = hash(h, sources.first);
+  h = hash(h, sources.second);
+
+  char name[32];
+  std::snprintf(name, sizeof name, "%016llx.bin",
+                static_cast<unsigned long long>(h));
+  return binary_dir / name;
+}
+
+GLuint ProgramFamily::load_binary(fs::path const& path) const {
+  std::ifstream in(path.string(), std::ios::binary);
+  if (!in) return 0;
+
+  BinaryHeader header;
+  if (!in.read(reinterpret_cast<char*>(&header), sizeof header) ||
+      header.magic != binary_magic || header.version != binary_version ||
+      header.length == 0 || header.length > max_binary_length)
+    return 0;
+
+  std::vector<char> data(header.length);
+  if (!in.read(data.data(), data.size())) return 0;
+
+  auto id = s_gles2.glCreateProgram();
+  s_gles2.glProgramBinaryOES(id, header.format, data.data(), header.length);
+
+  // The driver is free to reject binaries it produced itself, e.g. after an
+  // update of some component the renderer string doesn't reflect.
+  GLint ok = GL_FALSE;
+  s_gles2.glGetProgramiv(id, GL_LINK_STATUS, &ok);
+  if (!ok) {
+    s_gles2.glDeleteProgram(id);
+    boost::system::error_code err;
+    fs::remove(path, err);
+    return 0;
+  }
+
+  return id;
+}
+
+void ProgramFamily::store_binary(GLuint id, fs::path const& path) const {
+  GLint length = 0;
+  s_gles2.glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+  if (length <= 0 || static_cast<std::uint32_t>(length) > max_binary_length)
+    return;
+
+  std::vector<char> data(length);
+  GLsizei written = 0;
+  GLenum format = 0;
+  s_gles2.glGetProgramBinaryOES(id, length, &written, &format, data.data());
+  if (written <= 0) return;
+
+  const BinaryHeader header{binary_magic, binary_version, format,
+                            static_cast<std::uint32_t>(written)};
+
+  // Write to a temporary file first so that concurrently starting sessions
+  // never observe a partially written binary.
+  auto tmp_path = path;
+  tmp_path += ".tmp";
+  {
+    std::ofstream out(tmp_path.string(), std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof header);
+    out.write(data.data(), written);
+    if (!out) {
+      WARNING("Failed to write program binary %s", tmp_path.string());
+      return;
+    }
+  }
+
+  boost::system::error_code err;
+  fs::rename(tmp_path, path, err);
+  if (err) fs::remove(tmp_path, err);
+}
+
 GLuint ProgramFamily::add_program(const GLchar* const vshader_src,
                                   const GLchar* const fshader_src) {
+  auto& p = program[{vshader_src, fshader_src}];
+  if (p.id) return p.id;
+
+  fs::path cached;
+  if (!binary_dir.empty()) {
+    cached = binary_path({vshader_src, fshader_src});
+    p.id = load_binary(cached);
+    if (p.id) return p.id;
+  }
+
   auto& v = vshader[vshader_src];
   if (!v.id) v.init(GL_VERTEX_SHADER, vshader_src);
 
   auto& f = fshader[fshader_src];
   if (!f.id) f.init(GL_FRAGMENT_SHADER, fshader_src);
 
-  auto& p = program[{v.id, f.id}];
-  if (!p.id) {
-    p.id = s_gles2.glCreateProgram();
-    s_gles2.glAttachShader(p.id, v.id);
-    s_gles2.glAttachShader(p.id, f.id);
-    s_gles2.glLinkProgram(p.id);
-    GLint ok;
-    s_gles2.glGetProgramiv(p.id, GL_LINK_STATUS, &ok);
-    if (!ok) {
-      GLchar log[1024];
-      s_gles2.glGetProgramInfoLog(p.id, sizeof log - 1, NULL, log);
-      log[sizeof log - 1] = '\0';
-      s_gles2.glDeleteShader(p.id);
-      p.id = 0;
-      throw std::runtime_error(std::string("Link failed: ") + log);
-    }
+  p.id = s_gles2.glCreateProgram();
+  s_gles2.glAttachShader(p.id, v.id);
+  s_gles2.glAttachShader(p.id, f.id);
+  s_gles2.glLinkProgram(p.id);
+  GLint ok;
+  s_gles2.glGetProgramiv(p.id, GL_LINK_STATUS, &ok);
+  if (!ok) {
+    GLchar log[1024];
+    s_gles2.glGetProgramInfoLog(p.id, sizeof log - 1, NULL, log);
+    log[sizeof log - 1] = '\0';
+    s_gles2.glDeleteProgram(p.id);
+    p.id = 0;
+    throw std::runtime_error(std::string("Link failed: ") + log);
   }
 
+  if (!cached.empty()) store_binary(p.id, cached);
+
   return p.id;
 }
 }  // namespace graphics
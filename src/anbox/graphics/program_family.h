@@ -20,20 +20,25 @@
 #define ANBOX_GRAPHICS_PROGRAM_FAMILY_H_
 
 #include <map>
+#include <string>
 #include <unordered_map>
 #include <utility>
 
 #include <GLES2/gl2.h>
 
+#include <boost/filesystem/path.hpp>
+
 namespace anbox {
 namespace graphics {
 /**
  * ProgramFamily represents a set of GLSL programs that are closely
- * related. Programs which point to the same shader source strings will be
+ * related. Programs which use the same shader source strings will be
  * made to share the same compiled shader objects.
  *   A secondary intention is that this class may be extended to allow the
  * different programs within the family to share common patterns of uniform
  * usage too.
+ *   Optionally the linked programs are persisted as program binaries, so
+ * later instances can load them instead of compiling the shaders again.
  */
 class ProgramFamily {
  public:
@@ -42,22 +47,37 @@ class ProgramFamily {
   ProgramFamily& operator=(ProgramFamily const&) = delete;
   ~ProgramFamily() noexcept;
 
-  GLuint add_program(const GLchar* const static_vshader_src,
-                     const GLchar* const static_fshader_src);
+  /**
+   * Keep program binaries (GL_OES_get_program_binary) in cache_dir. They
+   * are keyed by the GL renderer and version strings and the shader sources,
+   * so a driver update or a shader change results in a fresh compile. Does
+   * nothing if the current context can't provide program binaries.
+   */
+  void enable_binary_cache(boost::filesystem::path const& cache_dir);
+
+  GLuint add_program(const GLchar* const vshader_src,
+                     const GLchar* const fshader_src);
 
  private:
   struct Shader {
     GLuint id = 0;
     void init(GLenum type, const GLchar* src);
   };
-  typedef std::unordered_map<const GLchar*, Shader> ShaderMap;
+  typedef std::unordered_map<std::string, Shader> ShaderMap;
   ShaderMap vshader, fshader;
 
-  typedef std::pair<GLuint, GLuint> ShaderPair;
+  typedef std::pair<std::string, std::string> SourcePair;
   struct Program {
     GLuint id = 0;
   };
-  std::map<ShaderPair, Program> program;
+  std::map<SourcePair, Program> program;
+
+  boost::filesystem::path binary_path(SourcePair const& sources) const;
+  GLuint load_binary(boost::filesystem::path const& path) const;
+  void store_binary(GLuint id, boost::filesystem::path const& path) const;
+
+  boost::filesystem::path binary_dir;
+  std::string binary_key;
 };
 }  // namespace graphics
 }  // namespace anbox
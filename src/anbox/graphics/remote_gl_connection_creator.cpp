@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/remote_gl_connection_creator.h"
+#include "anbox/graphics/emugl/RenderThreadPool.h"
+#include "anbox/graphics/opengles_message_processor.h"
+#include "anbox/logger.h"
+#include "anbox/network/tcp_socket_messenger.h"
+
+namespace {
+constexpr std::size_t max_idle_render_threads{2};
+}  // namespace
+
+namespace anbox {
+namespace graphics {
+RemoteGlConnectionCreator::RemoteGlConnectionCreator(const std::shared_ptr<Renderer> &renderer,
+                                                     const std::shared_ptr<Runtime> &rt,
+                                                     const RemoteGlStream::Token &token)
+    : render_threads_(std::make_shared<RenderThreadPool>(renderer, max_idle_render_threads)),
+      runtime_(rt),
+      token_(token),
+      next_connection_id_(0),
+      connections_(std::make_shared<network::Connections<network::SocketConnection>>()) {}
+
+RemoteGlConnectionCreator::~RemoteGlConnectionCreator() noexcept {
+  connections_->clear();
+}
+
+void RemoteGlConnectionCreator::create_connection_for(
+    std::shared_ptr<boost::asio::ip::tcp::socket> const &socket) {
+  // Clients flush whenever they wait for a reply, those must not sit in
+  // the kernel waiting for more.
+  boost::system::error_code err;
+  socket->set_option(boost::asio::ip::tcp::no_delay(true), err);
+  if (err)
+    WARNING("Failed to disable Nagle's algorithm for remote GL client: %s", err.message());
+
+  const auto id = next_connection_id_.fetch_add(1);
+  const auto name = "remote-gl-" + std::to_string(id);
+  auto const messenger = std::make_shared<network::TcpSocketMessenger>(socket);
+
+  // Clients only get a render thread once they sent the right token.
+  const auto render_threads = render_threads_;
+  auto const processor = std::make_shared<RemoteGlStream>(
+      [render_threads, messenger]() {
+        return std::make_shared<OpenGlesMessageProcessor>(render_threads, messenger);
+      },
+      name, token_);
+
+  auto const connection = std::make_shared<network::SocketConnection>(
+      messenger, messenger, id, connections_, processor);
+  connection->set_name(name);
+  connection->set_handler_statistics(runtime_->handler_statistics());
+  // Sized like the buffers of local GL clients, texture uploads still
+  // come in megabytes when they don't compress well.
+  connection->set_receive_buffer_policy({256 * 1024, 64 * 1024, 4 * 1024 * 1024});
+  connections_->add(connection);
+  connection->read_next_message();
+
+  INFO("Remote GL client %s connected", name);
+}
+}  // namespace graphics
+}  // namespace anbox
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_GRAPHICS_REMOTE_GL_CONNECTION_CREATOR_H_
+#define ANBOX_GRAPHICS_REMOTE_GL_CONNECTION_CREATOR_H_
+
+#include "anbox/graphics/remote_gl_stream.h"
+#include "anbox/network/connection_creator.h"
+#include "anbox/network/connections.h"
+#include "anbox/network/socket_connection.h"
+#include "anbox/runtime.h"
+
+#include <boost/asio/ip/tcp.hpp>
+
+#include <atomic>
+#include <memory>
+
+class Renderer;
+class RenderThreadPool;
+
+namespace anbox {
+namespace graphics {
+// Serves GL clients running on another machine, e.g. when the container
+// runs somewhere without a GPU. Every connection carries the command
+// stream of a single client as described by RemoteGlStream.
+//
+// Clients have to know the token we were given, which they send in the
+// clear. The port should still only be reachable from machines trusted
+// to run GL clients.
+class RemoteGlConnectionCreator
+    : public network::ConnectionCreator<boost::asio::ip::tcp> {
+ public:
+  RemoteGlConnectionCreator(const std::shared_ptr<Renderer> &renderer,
+                            const std::shared_ptr<Runtime> &rt,
+                            const RemoteGlStream::Token &token);
+  ~RemoteGlConnectionCreator() noexcept;
+
+  void create_connection_for(
+      std::shared_ptr<boost::asio::ip::tcp::socket> const &socket) override;
+
+ private:
+  std::shared_ptr<RenderThreadPool> render_threads_;
+  std::shared_ptr<Runtime> runtime_;
+  RemoteGlStream::Token token_;
+  std::atomic<int> next_connection_id_;
+  std::shared_ptr<network::Connections<network::SocketConnection>> const connections_;
+};
+}  // namespace graphics
+}  // namespace anbox
+
+#endif
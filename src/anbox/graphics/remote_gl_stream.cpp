@@ -0,0 +1,345 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/remote_gl_stream.h"
+#include "anbox/common/latency_samples.h"
+#include "anbox/common/memory_usage.h"
+#include "anbox/common/metrics.h"
+#include "anbox/logger.h"
+
+#include <cstring>
+
+namespace {
+static_assert(sizeof(anbox::graphics::RemoteGlStream::Hello) == 48, "Hello is part of the protocol");
+static_assert(sizeof(anbox::graphics::RemoteGlStream::FrameHeader) == 16, "FrameHeader is part of the protocol");
+
+// Inflated data is handed on in chunks of this size.
+constexpr std::size_t inflate_chunk_size{64 * 1024};
+
+constexpr auto caches = anbox::common::MemoryUsage::Subsystem::Caches;
+}  // namespace
+
+namespace anbox {
+namespace graphics {
+constexpr std::uint32_t RemoteGlStream::magic;
+constexpr std::uint16_t RemoteGlStream::version;
+constexpr std::size_t RemoteGlStream::token_size;
+constexpr std::uint32_t RemoteGlStream::max_cache_size;
+
+// Shared with the metrics collector which may run after we are gone.
+struct RemoteGlStream::Counters {
+  const std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+  std::atomic<std::uint64_t> received_bytes{0};
+  std::atomic<std::uint64_t> decompressed_bytes{0};
+  std::atomic<std::uint64_t> command_bytes{0};
+  std::atomic<std::uint64_t> cache_hits{0};
+
+  Statistics statistics() const {
+    Statistics s;
+    s.received_bytes = received_bytes.load(std::memory_order_relaxed);
+    s.decompressed_bytes = decompressed_bytes.load(std::memory_order_relaxed);
+    s.command_bytes = command_bytes.load(std::memory_order_relaxed);
+    s.cache_hits = cache_hits.load(std::memory_order_relaxed);
+    s.elapsed = std::chrono::steady_clock::now() - started;
+    return s;
+  }
+};
+
+double RemoteGlStream::Statistics::compression_ratio() const {
+  if (received_bytes == 0)
+    return 0.0;
+  return static_cast<double>(command_bytes) / received_bytes;
+}
+
+double RemoteGlStream::Statistics::throughput() const {
+  const auto seconds = std::chrono::duration<double>(elapsed).count();
+  if (seconds <= 0.0)
+    return 0.0;
+  return command_bytes / seconds;
+}
+
+bool RemoteGlStream::parse_token(const std::string &hex, Token &token) {
+  if (hex.size() != 2 * token_size)
+    return false;
+
+  for (std::size_t n = 0; n < token_size; n++) {
+    std::uint8_t byte = 0;
+    for (const auto c : hex.substr(2 * n, 2)) {
+      byte <<= 4;
+      if (c >= '0' && c <= '9')
+        byte |= c - '0';
+      else if (c >= 'a' && c <= 'f')
+        byte |= c - 'a' + 10;
+      else if (c >= 'A' && c <= 'F')
+        byte |= c - 'A' + 10;
+      else
+        return false;
+    }
+    token[n] = byte;
+  }
+  return true;
+}
+
+RemoteGlStream::RemoteGlStream(const ProcessorFactory &create_processor, const std::string &name,
+                               const Token &token)
+    : create_processor_(create_processor),
+      name_(name),
+      token_(token),
+      counters_(std::make_shared<Counters>()),
+      deflate_(false),
+      inflater_initialized_(false),
+      remaining_(0),
+      cache_size_(0),
+      cache_capacity_(0) {
+  std::memset(&inflater_, 0, sizeof(inflater_));
+  std::memset(&frame_, 0, sizeof(frame_));
+
+  if (auto metrics = common::Metrics::instance()) {
+    const auto counters = counters_;
+    const auto label = "{connection=\"" + common::escape_prometheus_label(name_) + "\"}";
+    metrics->add_collector("remote_gl_" + name_, [counters, label](std::ostream &out) {
+      const auto s = counters->statistics();
+      out << "anbox_remote_gl_received_bytes" << label << " " << s.received_bytes << "\n"
+          << "anbox_remote_gl_command_bytes" << label << " " << s.command_bytes << "\n"
+          << "anbox_remote_gl_cache_hits" << label << " " << s.cache_hits << "\n"
+          << "anbox_remote_gl_compression_ratio" << label << " " << s.compression_ratio() << "\n"
+          << "anbox_remote_gl_throughput_bytes_per_second" << label << " " << s.throughput() << "\n";
+    });
+  }
+}
+
+RemoteGlStream::~RemoteGlStream() {
+  if (auto metrics = common::Metrics::instance())
+    metrics->remove_collector("remote_gl_" + name_);
+
+  if (inflater_initialized_)
+    inflateEnd(&inflater_);
+  common::MemoryUsage::remove(caches, cache_size_);
+
+  const auto s = statistics();
+  INFO("Remote GL client %s sent %d bytes for %d bytes of commands (ratio %.2f, %.1f KiB/s, %d cache hits)",
+       name_, s.received_bytes, s.command_bytes, s.compression_ratio(),
+       s.throughput() / 1024.0, s.cache_hits);
+}
+
+RemoteGlStream::Statistics RemoteGlStream::statistics() const {
+  return counters_->statistics();
+}
+
+bool RemoteGlStream::process_data(const std::uint8_t *data, size_t size) {
+  counters_->received_bytes.fetch_add(size, std::memory_order_relaxed);
+
+  if (hello_.size() < sizeof(Hello) && !process_hello(data, size))
+    return false;
+  if (size == 0)
+    return true;
+
+  if (deflate_)
+    return inflate_data(data, size);
+
+  counters_->decompressed_bytes.fetch_add(size, std::memory_order_relaxed);
+  return process_frames(data, size);
+}
+
+bool RemoteGlStream::process_hello(const std::uint8_t *&data, size_t &size) {
+  const auto needed = std::min(size, sizeof(Hello) - hello_.size());
+  hello_.insert(hello_.end(), data, data + needed);
+  data += needed;
+  size -= needed;
+  if (hello_.size() < sizeof(Hello))
+    return true;
+
+  Hello hello;
+  std::memcpy(&hello, hello_.data(), sizeof(hello));
+  if (hello.magic != magic || hello.version != version) {
+    ERROR("Remote GL client %s speaks an unknown protocol", name_);
+    return false;
+  }
+  // Compared in constant time so that the time it takes doesn't tell how
+  // much of a guess was right.
+  std::uint8_t mismatch = 0;
+  for (std::size_t n = 0; n < token_size; n++)
+    mismatch |= hello.token[n] ^ token_[n];
+  if (mismatch != 0) {
+    ERROR("Remote GL client %s didn't send the right token", name_);
+    return false;
+  }
+  if (hello.cache_size > max_cache_size) {
+    ERROR("Remote GL client %s asked for a cache of %d bytes, at most %d are possible",
+          name_, hello.cache_size, max_cache_size);
+    return false;
+  }
+  cache_capacity_ = hello.cache_size;
+
+  switch (static_cast<Compression>(hello.compression)) {
+    case Compression::None:
+      break;
+    case Compression::Deflate:
+      if (inflateInit(&inflater_) != Z_OK) {
+        ERROR("Failed to set up decompression for remote GL client %s", name_);
+        return false;
+      }
+      inflater_initialized_ = true;
+      deflate_ = true;
+      inflated_.resize(inflate_chunk_size);
+      break;
+    default:
+      ERROR("Remote GL client %s uses unknown compression %d", name_, hello.compression);
+      return false;
+  }
+
+  try {
+    processor_ = create_processor_();
+  } catch (const std::exception &err) {
+    ERROR("Failed to set up remote GL client %s: %s", name_, err.what());
+    return false;
+  }
+  return processor_ != nullptr;
+}
+
+bool RemoteGlStream::inflate_data(const std::uint8_t *data, size_t size) {
+  inflater_.next_in = const_cast<Bytef*>(data);
+  inflater_.avail_in = static_cast<uInt>(size);
+
+  // Keep going while zlib fills the whole buffer, it may hold back output
+  // even when all input is consumed.
+  do {
+    inflater_.next_out = inflated_.data();
+    inflater_.avail_out = static_cast<uInt>(inflated_.size());
+
+    const auto result = inflate(&inflater_, Z_NO_FLUSH);
+    if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+      ERROR("Failed to decompress data of remote GL client %s: %s", name_,
+            inflater_.msg ? inflater_.msg : "unknown error");
+      return false;
+    }
+
+    const auto inflated = inflated_.size() - inflater_.avail_out;
+    counters_->decompressed_bytes.fetch_add(inflated, std::memory_order_relaxed);
+    if (inflated > 0 && !process_frames(inflated_.data(), inflated))
+      return false;
+
+    if (result == Z_STREAM_END) {
+      if (inflater_.avail_in > 0) {
+        ERROR("Remote GL client %s sent data after the end of its stream", name_);
+        return false;
+      }
+      break;
+    }
+    if (result == Z_BUF_ERROR)
+      break;
+  } while (inflater_.avail_out == 0 || inflater_.avail_in > 0);
+
+  return true;
+}
+
+bool RemoteGlStream::process_frames(const std::uint8_t *data, size_t size) {
+  while (size > 0) {
+    if (header_.size() < sizeof(FrameHeader)) {
+      const auto needed = std::min(size, sizeof(FrameHeader) - header_.size());
+      header_.insert(header_.end(), data, data + needed);
+      data += needed;
+      size -= needed;
+      if (header_.size() < sizeof(FrameHeader))
+        return true;
+      if (!begin_frame())
+        return false;
+    }
+
+    // Payloads are handed on as they come, only the ones to be cached
+    // are collected.
+    const auto chunk = std::min(size, remaining_);
+    if (static_cast<FrameType>(frame_.type) == FrameType::CachePut)
+      put_.insert(put_.end(), data, data + chunk);
+    if (chunk > 0 && !forward(data, chunk))
+      return false;
+    data += chunk;
+    size -= chunk;
+    remaining_ -= chunk;
+
+    if (remaining_ > 0)
+      continue;
+
+    if (static_cast<FrameType>(frame_.type) == FrameType::CachePut) {
+      while (cache_size_ + put_.size() > cache_capacity_) {
+        cache_size_ -= cache_.back().second.size();
+        common::MemoryUsage::remove(caches, cache_.back().second.size());
+        cache_index_.erase(cache_.back().first);
+        cache_.pop_back();
+      }
+      cache_size_ += put_.size();
+      common::MemoryUsage::add(caches, put_.size());
+      cache_.emplace_front(frame_.key, std::move(put_));
+      cache_index_[frame_.key] = cache_.begin();
+      put_.clear();
+    }
+    header_.clear();
+  }
+  return true;
+}
+
+bool RemoteGlStream::begin_frame() {
+  std::memcpy(&frame_, header_.data(), sizeof(frame_));
+  remaining_ = frame_.size;
+
+  switch (static_cast<FrameType>(frame_.type)) {
+    case FrameType::Data:
+      return true;
+    case FrameType::CachePut: {
+      if (frame_.size > cache_capacity_) {
+        ERROR("Remote GL client %s wants to cache more than its cache holds", name_);
+        return false;
+      }
+      // A key put again replaces what it referred to.
+      const auto entry = cache_index_.find(frame_.key);
+      if (entry != cache_index_.end()) {
+        cache_size_ -= entry->second->second.size();
+        common::MemoryUsage::remove(caches, entry->second->second.size());
+        cache_.erase(entry->second);
+        cache_index_.erase(entry);
+      }
+      put_.reserve(frame_.size);
+      return true;
+    }
+    case FrameType::CacheRef: {
+      const auto entry = cache_index_.find(frame_.key);
+      if (frame_.size != 0 || entry == cache_index_.end()) {
+        ERROR("Remote GL client %s referred to data which isn't cached", name_);
+        return false;
+      }
+      cache_.splice(cache_.begin(), cache_, entry->second);
+      counters_->cache_hits.fetch_add(1, std::memory_order_relaxed);
+      const auto &cached = cache_.front().second;
+      if (!forward(cached.data(), cached.size()))
+        return false;
+      header_.clear();
+      return true;
+    }
+    default:
+      break;
+  }
+
+  ERROR("Remote GL client %s sent an unknown frame", name_);
+  return false;
+}
+
+bool RemoteGlStream::forward(const std::uint8_t *data, size_t size) {
+  counters_->command_bytes.fetch_add(size, std::memory_order_relaxed);
+  return processor_->process_data(data, size);
+}
+}  // namespace graphics
+}  // namespace anbox
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_GRAPHICS_REMOTE_GL_STREAM_H_
+#define ANBOX_GRAPHICS_REMOTE_GL_STREAM_H_
+
+#include "anbox/network/message_processor.h"
+
+#include <zlib.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace anbox {
+namespace graphics {
+// Turns what a GL client on another machine sends over TCP back into the
+// plain command stream a local client writes to its qemu pipe and hands
+// that to |processor|.
+//
+// The client starts with a Hello which carries the token the session
+// manager was given, nothing else a client sends is looked at before it
+// matches. Everything after the Hello may be compressed
+// as one deflate stream, which the client flushes whenever it waits for
+// a reply. The stream consists of frames, each a FrameHeader followed by
+// its payload:
+//  - Data frames carry commands.
+//  - CachePut frames carry commands as well and additionally store them
+//    under their key, which is how clients send texture data they expect
+//    to send again.
+//  - CacheRef frames have no payload, the commands stored under their key
+//    are used instead.
+// The cache is limited to the size the client asked for and evicts the
+// least recently put or referenced entries first, so that clients can
+// tell what is still cached by tracking the same.
+//
+// Replies are sent uncompressed, they are tiny compared to the commands.
+class RemoteGlStream : public network::MessageProcessor {
+ public:
+  static constexpr std::uint32_t magic{0x524c4741};  // "AGLR"
+  static constexpr std::uint16_t version{2};
+  static constexpr std::size_t token_size{32};
+  // Largest cache a client may ask for.
+  static constexpr std::uint32_t max_cache_size{64 * 1024 * 1024};
+
+  enum class Compression : std::uint16_t { None = 0, Deflate = 1 };
+  enum class FrameType : std::uint8_t { Data = 0, CachePut = 1, CacheRef = 2 };
+
+  struct Hello {
+    std::uint32_t magic;
+    std::uint16_t version;
+    std::uint16_t compression;
+    std::uint32_t cache_size;
+    // What a local client sends as its flags.
+    std::uint32_t flags;
+    std::uint8_t token[token_size];
+  };
+
+  typedef std::array<std::uint8_t, token_size> Token;
+  typedef std::function<std::shared_ptr<network::MessageProcessor>()> ProcessorFactory;
+
+  struct FrameHeader {
+    std::uint8_t type;
+    std::uint8_t reserved[3];
+    std::uint32_t size;
+    std::uint64_t key;
+  };
+
+  struct Statistics {
+    // As they came off the socket.
+    std::uint64_t received_bytes = 0;
+    // After inflating them.
+    std::uint64_t decompressed_bytes = 0;
+    // Command stream after expanding cache references.
+    std::uint64_t command_bytes = 0;
+    std::uint64_t cache_hits = 0;
+    std::chrono::steady_clock::duration elapsed{0};
+
+    // Command bytes per byte sent, including cache hits.
+    double compression_ratio() const;
+    // Command bytes per second since the client connected.
+    double throughput() const;
+  };
+
+  // Reads a token written as 2 * token_size hex digits.
+  static bool parse_token(const std::string &hex, Token &token);
+
+  // The processor commands are handed to is only created once the client
+  // sent |token|. With metrics enabled the statistics are reported
+  // labelled with |name|.
+  RemoteGlStream(const ProcessorFactory &create_processor, const std::string &name,
+                 const Token &token);
+  ~RemoteGlStream();
+
+  bool process_data(const std::uint8_t *data, size_t size) override;
+
+  Statistics statistics() const;
+
+ private:
+  struct Counters;
+
+  bool process_hello(const std::uint8_t *&data, size_t &size);
+  bool inflate_data(const std::uint8_t *data, size_t size);
+  bool process_frames(const std::uint8_t *data, size_t size);
+  bool begin_frame();
+  bool forward(const std::uint8_t *data, size_t size);
+
+  ProcessorFactory create_processor_;
+  std::shared_ptr<network::MessageProcessor> processor_;
+  const std::string name_;
+  const Token token_;
+  std::shared_ptr<Counters> counters_;
+
+  std::vector<std::uint8_t> hello_;
+  bool deflate_;
+  z_stream inflater_;
+  bool inflater_initialized_;
+  std::vector<std::uint8_t> inflated_;
+
+  // The frame we are in and how much of its payload is still to come.
+  std::vector<std::uint8_t> header_;
+  FrameHeader frame_;
+  std::size_t remaining_;
+  std::vector<std::uint8_t> put_;
+
+  typedef std::list<std::pair<std::uint64_t, std::vector<std::uint8_t>>> CacheEntries;
+  CacheEntries cache_;
+  std::unordered_map<std::uint64_t, CacheEntries::iterator> cache_index_;
+  std::size_t cache_size_;
+  std::size_t cache_capacity_;
+};
+}  // namespace graphics
+}  // namespace anbox
+
+#endif
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/render_thread_policy.h"
+#include "anbox/logger.h"
+#include "anbox/utils.h"
+
+#include <boost/lexical_cast.hpp>
+#include <boost/throw_exception.hpp>
+
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+
+namespace {
+pid_t current_thread() {
+  static thread_local pid_t thread = static_cast<pid_t>(::syscall(SYS_gettid));
+  return thread;
+}
+
+unsigned int parse_cpu(const std::string &str) {
+  // lexical_cast happily wraps negative numbers around.
+  if (str.empty() || str[0] == '-' || str[0] == '+')
+    BOOST_THROW_EXCEPTION(std::runtime_error("Invalid CPU " + str));
+
+  unsigned int cpu = 0;
+  try {
+    cpu = boost::lexical_cast<unsigned int>(str);
+  } catch (const boost::bad_lexical_cast &) {
+    BOOST_THROW_EXCEPTION(std::runtime_error("Invalid CPU " + str));
+  }
+
+  if (cpu >= CPU_SETSIZE)
+    BOOST_THROW_EXCEPTION(std::runtime_error("CPU " + str + " is out of range"));
+  return cpu;
+}
+}  // namespace
+
+namespace anbox {
+namespace graphics {
+std::istream &operator>>(std::istream &in, RenderThreadPolicy::CpuSet &cpus) {
+  std::string str(std::istreambuf_iterator<char>(in), {});
+  for (const auto &range : utils::string_split(str, ',')) {
+    const auto dash = range.find('-', 1);
+    if (dash == std::string::npos) {
+      cpus.add(parse_cpu(range));
+      continue;
+    }
+
+    const auto first = parse_cpu(range.substr(0, dash));
+    const auto last = parse_cpu(range.substr(dash + 1));
+    if (first > last)
+      BOOST_THROW_EXCEPTION(std::runtime_error("Invalid CPU range " + range));
+    for (auto cpu = first; cpu <= last; cpu++)
+      cpus.add(cpu);
+  }
+  return in;
+}
+
+std::ostream &operator<<(std::ostream &out, const RenderThreadPolicy::CpuSet &cpus) {
+  bool first = true;
+  for (const auto &cpu : cpus.cpus()) {
+    out << (first ? "" : ",") << cpu;
+    first = false;
+  }
+  return out;
+}
+
+RenderThreadPolicy::RenderThreadPolicy(const Config &config)
+    : config_(config), compositor_(0), warned_(false) {}
+
+void RenderThreadPolicy::thread_started() {
+  std::lock_guard<std::mutex> l(lock_);
+  const auto thread = current_thread();
+  clients_.insert(thread);
+  if (compositor_ != 0)
+    apply_locked(thread, config_.clients);
+}
+
+void RenderThreadPolicy::thread_stopped() {
+  std::lock_guard<std::mutex> l(lock_);
+  const auto thread = current_thread();
+  clients_.erase(thread);
+  if (compositor_ == thread)
+    compositor_ = 0;
+}
+
+bool RenderThreadPolicy::serves_compositor() const {
+  return compositor_ == current_thread();
+}
+
+void RenderThreadPolicy::layers_posted() {
+  if (compositor_ != 0)
+    return;
+
+  std::lock_guard<std::mutex> l(lock_);
+  if (compositor_ != 0)
+    return;
+
+  const auto thread = current_thread();
+  compositor_ = thread;
+  DEBUG("Render thread %d serves the compositor", thread);
+
+  apply_locked(thread, config_.compositor);
+  for (const auto &client : clients_) {
+    if (client != thread)
+      apply_locked(client, config_.clients);
+  }
+}
+
+void RenderThreadPolicy::compositor_thread_started() {
+  std::lock_guard<std::mutex> l(lock_);
+  apply_locked(current_thread(), config_.compositor);
+}
+
+void RenderThreadPolicy::apply_locked(pid_t thread, const Scheduling &scheduling) {
+  // Only the first failure is reported as all others have the same cause.
+  // Raising the priority typically needs CAP_SYS_NICE.
+  if (scheduling.nice && ::setpriority(PRIO_PROCESS, thread, *scheduling.nice) < 0 && !warned_) {
+    WARNING("Failed to set nice value of thread %d to %d: %s", thread,
+            *scheduling.nice, std::strerror(errno));
+    warned_ = true;
+  }
+
+  if (scheduling.cpus.empty())
+    return;
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (const auto &cpu : scheduling.cpus.cpus())
+    CPU_SET(cpu, &set);
+
+  if (::sched_setaffinity(thread, sizeof(set), &set) < 0 && !warned_) {
+    WARNING("Failed to pin thread %d to CPUs %s: %s", thread, scheduling.cpus,
+            std::strerror(errno));
+    warned_ = true;
+  }
+}
+}  // namespace graphics
+}  // namespace anbox
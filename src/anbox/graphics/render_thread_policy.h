@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_GRAPHICS_RENDER_THREAD_POLICY_H_
+#define ANBOX_GRAPHICS_RENDER_THREAD_POLICY_H_
+
+#include <boost/optional.hpp>
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <iosfwd>
+#include <mutex>
+#include <set>
+
+namespace anbox {
+namespace graphics {
+// Decides how the host threads working for the guest are scheduled.
+//
+// The guest compositor has to get its frames out within every refresh
+// cycle while the render threads of apps can wait a bit without anybody
+// noticing. When a render thread starts we don't know yet which guest
+// client it serves, so the first one posting layers, which only ever
+// SurfaceFlinger does, is taken to be the compositor. All other render
+// threads keep their scheduling until then and are switched over to the
+// one for clients once the compositor is known. That way the compositor
+// never has to raise its priority again after it got lowered.
+class RenderThreadPolicy {
+ public:
+  // Set of CPUs as given on the command line, e.g. 0-3,6.
+  class CpuSet {
+   public:
+    bool empty() const { return cpus_.empty(); }
+    bool contains(unsigned int cpu) const { return cpus_.count(cpu) > 0; }
+    void add(unsigned int cpu) { cpus_.insert(cpu); }
+    const std::set<unsigned int> &cpus() const { return cpus_; }
+
+   private:
+    std::set<unsigned int> cpus_;
+  };
+
+  struct Scheduling {
+    // Nice value of the threads. Left alone when not set.
+    boost::optional<int> nice;
+    // CPUs the threads are pinned to. Left alone when empty.
+    CpuSet cpus;
+
+    bool empty() const { return !nice && cpus.empty(); }
+  };
+
+  struct Config {
+    // Render threads of the guest compositor and the host threads
+    // presenting its frames.
+    Scheduling compositor;
+    // Render threads of all other guest clients.
+    Scheduling clients;
+
+    bool empty() const { return compositor.empty() && clients.empty(); }
+  };
+
+  explicit RenderThreadPolicy(const Config &config);
+
+  // Called by every render thread from the thread itself.
+  void thread_started();
+  void thread_stopped();
+
+  // Called by a render thread whenever its client posted layers. Cheap
+  // for all calls but the first one of the compositor.
+  void layers_posted();
+
+  // Called by host threads working for the compositor from the thread
+  // itself, e.g. the one presenting its frames.
+  void compositor_thread_started();
+
+  // Id of the render thread taken to serve the compositor or 0 while not
+  // known. Picked again once that thread stopped, e.g. because the guest
+  // compositor got restarted.
+  pid_t compositor() const { return compositor_; }
+
+  // Whether the calling render thread is the one serving the compositor.
+  bool serves_compositor() const;
+
+ private:
+  void apply_locked(pid_t thread, const Scheduling &scheduling);
+
+  const Config config_;
+  std::mutex lock_;
+  std::atomic<pid_t> compositor_;
+  std::set<pid_t> clients_;
+  bool warned_;
+};
+
+// Parses a list of CPUs and ranges of them, e.g. 0-3,6.
+std::istream &operator>>(std::istream &in, RenderThreadPolicy::CpuSet &cpus);
+std::ostream &operator<<(std::ostream &out, const RenderThreadPolicy::CpuSet &cpus);
+}  // namespace graphics
+}  // namespace anbox
+
+#endif
@@ -22,6 +22,8 @@
 
 #include <EGL/egl.h>
 
+#include <cstdint>
+
 namespace anbox {
 namespace graphics {
 class Renderer {
@@ -31,6 +33,14 @@ class Renderer {
   virtual bool draw(EGLNativeWindowType native_window,
                     const anbox::graphics::Rect& window_frame,
                     const RenderableList& renderables) = 0;
+
+  // Returns a serial which changes whenever the content of one of the
+  // buffers referenced by |renderables| changes. Renderers which can't
+  // track buffer content return 0 which lets every frame be redrawn.
+  virtual std::uint64_t content_serial(const RenderableList& renderables) {
+    (void)renderables;
+    return 0;
+  }
 };
 }  // namespace graphics
 }  // namespace anbox
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/ring_buffer.h"
+#include "anbox/common/memory_usage.h"
+
+#include <boost/throw_exception.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace {
+size_t next_power_of_two(size_t value) {
+  size_t result = 1;
+  while (result < value) result <<= 1;
+  return result;
+}
+}
+
+namespace anbox {
+namespace graphics {
+RingBuffer::RingBuffer(size_t capacity)
+    : capacity_(next_power_of_two(capacity)),
+      mask_(capacity_ - 1),
+      data_(capacity_) {
+  if (!data_.valid())
+    BOOST_THROW_EXCEPTION(std::bad_alloc());
+  common::MemoryUsage::add(common::MemoryUsage::Subsystem::TransportBuffers, capacity_);
+}
+
+RingBuffer::~RingBuffer() {
+  common::MemoryUsage::remove(common::MemoryUsage::Subsystem::TransportBuffers, capacity_);
+}
+
+size_t RingBuffer::available() const {
+  return write_pos_.load() - read_pos_.load();
+}
+
+size_t RingBuffer::write(const void *data, size_t size) {
+  auto src = static_cast<const std::uint8_t *>(data);
+  size_t written = 0;
+
+  while (written < size) {
+    const auto write_pos = write_pos_.load(std::memory_order_relaxed);
+    auto space = capacity_ - (write_pos - read_pos_.load());
+    if (space == 0) {
+      std::unique_lock<std::mutex> l(mutex_);
+      writer_waiting_ = true;
+      while (!closed_ && capacity_ == write_pos - read_pos_.load())
+        can_write_.wait(l);
+      writer_waiting_ = false;
+      if (closed_) break;
+      continue;
+    }
+
+    if (closed_) break;
+
+    const auto offset = write_pos & mask_;
+    const auto chunk = std::min({size - written, space, capacity_ - offset});
+    ::memcpy(data_.data() + offset, src + written, chunk);
+    written += chunk;
+    write_pos_.store(write_pos + chunk);
+
+    if (reader_waiting_) {
+      std::lock_guard<std::mutex> l(mutex_);
+      can_read_.notify_one();
+    }
+  }
+
+  return written;
+}
+
+bool RingBuffer::wait_for_data() {
+  if (write_pos_.load() != read_pos_.load(std::memory_order_relaxed))
+    return true;
+
+  std::unique_lock<std::mutex> l(mutex_);
+  reader_waiting_ = true;
+  while (!closed_ && write_pos_.load() == read_pos_.load(std::memory_order_relaxed))
+    can_read_.wait(l);
+  reader_waiting_ = false;
+
+  // A closed ring still hands out everything which was written before.
+  return write_pos_.load() != read_pos_.load(std::memory_order_relaxed);
+}
+
+size_t RingBuffer::read(void *data, size_t size, bool blocking) {
+  if (blocking && !wait_for_data()) return 0;
+
+  auto dst = static_cast<std::uint8_t *>(data);
+  size_t count = 0;
+  while (count < size) {
+    size_t region = 0;
+    const auto read_pos = read_pos_.load(std::memory_order_relaxed);
+    if (write_pos_.load() == read_pos) break;
+
+    const auto src = peek(&region);
+    const auto chunk = std::min(size - count, region);
+    ::memcpy(dst + count, src, chunk);
+    count += chunk;
+    consume(chunk);
+  }
+
+  return count;
+}
+
+const std::uint8_t *RingBuffer::peek(size_t *size) {
+  if (!wait_for_data()) {
+    *size = 0;
+    return nullptr;
+  }
+
+  const auto read_pos = read_pos_.load(std::memory_order_relaxed);
+  const auto offset = read_pos & mask_;
+  *size = std::min(write_pos_.load() - read_pos, capacity_ - offset);
+  return data_.data() + offset;
+}
+
+void RingBuffer::consume(size_t size) {
+  read_pos_.store(read_pos_.load(std::memory_order_relaxed) + size);
+
+  if (writer_waiting_) {
+    std::lock_guard<std::mutex> l(mutex_);
+    can_write_.notify_one();
+  }
+}
+
+void RingBuffer::close() {
+  std::lock_guard<std::mutex> l(mutex_);
+  closed_ = true;
+  can_read_.notify_all();
+  can_write_.notify_all();
+}
+}  // namespace graphics
+}  // namespace anbox
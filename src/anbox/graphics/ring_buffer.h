@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_GRAPHICS_RING_BUFFER_H_
+#define ANBOX_GRAPHICS_RING_BUFFER_H_
+
+#include "anbox/common/huge_page_buffer.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace anbox {
+namespace graphics {
+// A single-producer/single-consumer byte ring. Producer and consumer only
+// synchronize through the atomic read and write positions; the mutex and
+// condition variables are only touched when one side has to wait for the
+// other one.
+class RingBuffer {
+ public:
+  // |capacity| is rounded up to the next power of two. Throws
+  // std::bad_alloc if the memory for it can't be allocated.
+  explicit RingBuffer(size_t capacity);
+  ~RingBuffer();
+
+  RingBuffer(const RingBuffer &) = delete;
+  RingBuffer &operator=(const RingBuffer &) = delete;
+
+  size_t capacity() const { return capacity_; }
+
+  // Number of bytes ready to be consumed.
+  size_t available() const;
+
+  // Copies all of |size| bytes into the ring and blocks whenever it is
+  // full. Returns the number of bytes written which is only less than
+  // |size| when the ring got closed.
+  size_t write(const void *data, size_t size);
+
+  // Copies up to |size| bytes out of the ring. If |blocking| is true it
+  // waits until at least one byte is available. Returns 0 if nothing
+  // could be read which for a blocking read means the ring is closed.
+  size_t read(void *data, size_t size, bool blocking);
+
+  // Waits until data is available and returns a pointer to the longest
+  // contiguous readable region starting at the current read position.
+  // |size| is set to the length of that region. The data stays in the
+  // ring until consume() is called. Returns nullptr once the ring is
+  // closed and drained.
+  const std::uint8_t *peek(size_t *size);
+
+  // Releases |size| bytes previously returned by peek().
+  void consume(size_t size);
+
+  // Closes the ring. Writers fail from now on and readers drain what is
+  // left before they fail too.
+  void close();
+  bool is_closed() const { return closed_.load(); }
+
+ private:
+  bool wait_for_data();
+
+  size_t capacity_;
+  size_t mask_;
+  common::HugePageBuffer data_;
+
+  std::atomic<size_t> read_pos_{0};
+  std::atomic<size_t> write_pos_{0};
+  std::atomic<bool> closed_{false};
+
+  std::mutex mutex_;
+  std::atomic<bool> reader_waiting_{false};
+  std::atomic<bool> writer_waiting_{false};
+  std::condition_variable can_read_;
+  std::condition_variable can_write_;
+};
+}  // namespace graphics
+}  // namespace anbox
+
+#endif
@@ -16,6 +16,7 @@
  */
 
 #include "anbox/graphics/single_window_composer_strategy.h"
+#include "anbox/graphics/emugl/DisplayManager.h"
 #include "anbox/wm/manager.h"
 #include "anbox/utils.h"
 #include "anbox/logger.h"
@@ -26,6 +27,18 @@ const constexpr char *sprite_name{"Sprite"};
 
 namespace anbox {
 namespace graphics {
+Rect SingleWindowComposerStrategy::scale(const Rect &rect, std::int32_t from_width, std::int32_t from_height,
+                                         std::int32_t to_width, std::int32_t to_height) {
+  const auto x = [&](std::int32_t v) {
+    return static_cast<std::int32_t>(static_cast<std::int64_t>(v) * to_width / from_width);
+  };
+  const auto y = [&](std::int32_t v) {
+    return static_cast<std::int32_t>(static_cast<std::int64_t>(v) * to_height / from_height);
+  };
+  // Both edges are scaled so that adjacent layers stay adjacent.
+  return Rect{x(rect.left()), y(rect.top()), x(rect.right()), y(rect.bottom())};
+}
+
 SingleWindowComposerStrategy::SingleWindowComposerStrategy(const std::shared_ptr<wm::Manager> &wm) : wm_(wm) {}
 
 std::map<std::shared_ptr<wm::Window>, RenderableList> SingleWindowComposerStrategy::process_layers(const RenderableList &renderables) {
@@ -34,6 +47,20 @@ std::map<std::shared_ptr<wm::Window>, RenderableList> SingleWindowComposerStrate
   // doesn't matter which task
   auto window = wm_->find_window_for_task(0);
 
+  // Android might render at a different resolution than the window has in
+  // which case we scale all layers to the window here. Sampling the layers
+  // is filtered already so this is basically for free.
+  const auto display = DisplayManager::get();
+  auto display_width = 0, display_height = 0;
+  if (window && display) {
+    const auto info = display->display_info();
+    if (info.horizontal_resolution != window->frame().width() ||
+        info.vertical_resolution != window->frame().height()) {
+      display_width = info.horizontal_resolution;
+      display_height = info.vertical_resolution;
+    }
+  }
+
   // Filter out any unwanted layers like the one responsible for the mouse
   // cursor which we don't want to render.
   RenderableList final_renderables;
@@ -41,6 +68,10 @@ std::map<std::shared_ptr<wm::Window>, RenderableList> SingleWindowComposerStrate
     if (r.name() == sprite_name)
       continue;
     final_renderables.push_back(r);
+    if (display_width > 0 && display_height > 0)
+      final_renderables.back().set_screen_position(
+          scale(r.screen_position(), display_width, display_height,
+                window->frame().width(), window->frame().height()));
   }
 
   win_layers.insert({window, final_renderables});
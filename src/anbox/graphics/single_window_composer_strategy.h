@@ -20,6 +20,7 @@
 
 #include "anbox/graphics/layer_composer.h"
 
+#include <cstdint>
 #include <memory>
 
 namespace anbox {
@@ -31,6 +32,10 @@ class SingleWindowComposerStrategy : public LayerComposer::Strategy {
 
   WindowRenderableList process_layers(const RenderableList &renderables) override;
 
+  // Maps |rect| from a display of the first size to one of the second.
+  static Rect scale(const Rect &rect, std::int32_t from_width, std::int32_t from_height,
+                    std::int32_t to_width, std::int32_t to_height);
+
 private:
   std::shared_ptr<wm::Manager> wm_;
 };
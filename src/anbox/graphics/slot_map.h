@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_GRAPHICS_SLOT_MAP_H_
+#define ANBOX_GRAPHICS_SLOT_MAP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+namespace anbox {
+namespace graphics {
+// Stores objects in a flat array of slots and hands out handles which
+// encode the slot index together with a generation counter of the
+// slot. Looking up an object is a single array access and a handle
+// becomes invalid once its object is erased, even if the slot got
+// reused in the meantime.
+//
+//  bit 31      always zero so handles stay positive as signed integers
+//  bits 29-30  tag of the map, keeps handles of different maps apart
+//  bits 16-28  generation of the slot
+//  bits 0-15   slot index
+//
+// Slots are allocated in chunks which never move so a pointer returned
+// by find() stays valid until the object is erased. Modifications have
+// to be serialized by the caller.
+template <typename T>
+class SlotMap {
+ public:
+  typedef std::uint32_t Handle;
+
+  static constexpr unsigned int index_bits = 16;
+  static constexpr unsigned int generation_bits = 13;
+  static constexpr unsigned int tag_bits = 2;
+  static constexpr std::size_t max_size = std::size_t{1} << index_bits;
+
+  explicit SlotMap(std::uint32_t tag = 0) : tag_(tag & ((1u << tag_bits) - 1)) {}
+
+  SlotMap(const SlotMap&) = delete;
+  SlotMap& operator=(const SlotMap&) = delete;
+
+  // Stores |value| and returns the handle for it. Returns 0 which is
+  // never a valid handle if all slots are in use.
+  Handle insert(const T &value) {
+    if (free_.empty() && !grow()) return 0;
+
+    const auto index = free_.front();
+    free_.pop_front();
+
+    auto &s = slot(index);
+    s.value = value;
+    s.used = true;
+    size_++;
+
+    return make_handle(index, s.generation);
+  }
+
+  T* find(Handle handle) {
+    auto s = lookup(handle);
+    return s ? &s->value : nullptr;
+  }
+
+  const T* find(Handle handle) const {
+    return const_cast<SlotMap*>(this)->find(handle);
+  }
+
+  bool erase(Handle handle) {
+    auto s = lookup(handle);
+    if (!s) return false;
+
+    release(index_of(handle), *s);
+    return true;
+  }
+
+  void clear() {
+    for (std::size_t index = 0; index < capacity_; index++) {
+      auto &s = slot(index);
+      if (s.used) release(index, s);
+    }
+  }
+
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+ private:
+  static constexpr std::size_t chunk_size = 256;
+  static constexpr std::size_t max_chunks = max_size / chunk_size;
+  static constexpr std::uint32_t generation_mask = (1u << generation_bits) - 1;
+
+  struct Slot {
+    std::uint32_t generation = 1;
+    bool used = false;
+    T value;
+  };
+
+  Handle make_handle(std::size_t index, std::uint32_t generation) const {
+    return static_cast<Handle>(index) | (generation << index_bits) |
+           (tag_ << (index_bits + generation_bits));
+  }
+
+  static std::size_t index_of(Handle handle) {
+    return handle & (max_size - 1);
+  }
+
+  Slot& slot(std::size_t index) {
+    return chunks_[index / chunk_size][index % chunk_size];
+  }
+
+  Slot* lookup(Handle handle) {
+    if ((handle >> (index_bits + generation_bits)) != tag_) return nullptr;
+
+    const auto index = index_of(handle);
+    if (index >= capacity_) return nullptr;
+
+    auto &s = slot(index);
+    const auto generation = (handle >> index_bits) & generation_mask;
+    if (!s.used || s.generation != generation) return nullptr;
+
+    return &s;
+  }
+
+  void release(std::size_t index, Slot &s) {
+    s.value = T{};
+    s.used = false;
+    // Generation 0 is skipped so that no handle of tag 0 is ever 0.
+    s.generation = (s.generation + 1) & generation_mask;
+    if (s.generation == 0) s.generation = 1;
+    size_--;
+
+    // Slots are reused in FIFO order which keeps it unlikely that a slot
+    // wraps around its generation while a stale handle is still in use.
+    free_.push_back(static_cast<std::uint32_t>(index));
+  }
+
+  bool grow() {
+    const auto chunk = capacity_ / chunk_size;
+    if (chunk >= max_chunks) return false;
+
+    chunks_[chunk].reset(new Slot[chunk_size]);
+    for (std::size_t n = 0; n < chunk_size; n++)
+      free_.push_back(static_cast<std::uint32_t>(capacity_ + n));
+    capacity_ += chunk_size;
+    return true;
+  }
+
+  std::uint32_t tag_;
+  std::unique_ptr<Slot[]> chunks_[max_chunks];
+  std::size_t capacity_ = 0;
+  std::size_t size_ = 0;
+  std::deque<std::uint32_t> free_;
+};
+
+template <typename T> constexpr std::size_t SlotMap<T>::max_size;
+}  // namespace graphics
+}  // namespace anbox
+
+#endif
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/stream_capture.h"
+#include "anbox/logger.h"
+
+#include <boost/throw_exception.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+constexpr std::size_t file_buffer_size{1024 * 1024};
+
+struct EventHeader {
+  std::uint32_t stream;
+  std::uint32_t type;
+  std::uint64_t timestamp_ns;
+  std::uint32_t size;
+} __attribute__((packed));
+
+struct FileHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t reserved;
+} __attribute__((packed));
+}  // namespace
+
+namespace anbox {
+namespace graphics {
+constexpr char StreamCapture::magic[8];
+constexpr std::uint32_t StreamCapture::version;
+constexpr std::uint32_t StreamCapture::max_event_size;
+
+StreamCapture::Reader::Reader(const std::string &path)
+    : file_(std::fopen(path.c_str(), "rb")) {
+  if (!file_)
+    BOOST_THROW_EXCEPTION(std::runtime_error("Failed to open capture " + path));
+
+  FileHeader header;
+  if (std::fread(&header, sizeof(header), 1, file_) != 1 ||
+      std::memcmp(header.magic, magic, sizeof(magic)) != 0) {
+    std::fclose(file_);
+    BOOST_THROW_EXCEPTION(std::runtime_error(path + " is not a GL stream capture"));
+  }
+
+  if (header.version != version) {
+    std::fclose(file_);
+    BOOST_THROW_EXCEPTION(std::runtime_error(
+        "Unsupported GL stream capture version " + std::to_string(header.version)));
+  }
+}
+
+StreamCapture::Reader::~Reader() { std::fclose(file_); }
+
+bool StreamCapture::Reader::next(Event &event) {
+  EventHeader header;
+  if (std::fread(&header, sizeof(header), 1, file_) != 1)
+    return false;
+
+  if (header.type > static_cast<std::uint32_t>(EventType::Closed) ||
+      header.size > max_event_size) {
+    WARNING("Capture ends with an invalid event");
+    return false;
+  }
+
+  event.type = static_cast<EventType>(header.type);
+  event.stream = header.stream;
+  event.timestamp = std::chrono::nanoseconds{header.timestamp_ns};
+  event.data.resize(header.size);
+  if (header.size > 0 &&
+      std::fread(event.data.data(), header.size, 1, file_) != 1) {
+    WARNING("Capture ends with an incomplete event");
+    return false;
+  }
+  return true;
+}
+
+StreamCapture::StreamCapture(const std::string &path)
+    : file_(std::fopen(path.c_str(), "wb")),
+      file_buffer_(file_buffer_size),
+      start_(std::chrono::steady_clock::now()),
+      next_stream_(1) {
+  if (!file_)
+    BOOST_THROW_EXCEPTION(std::runtime_error("Failed to create capture " + path));
+
+  // Most of the data arrives in small pieces so we better don't hit the
+  // file system for every one of them.
+  std::setvbuf(file_, file_buffer_.data(), _IOFBF, file_buffer_.size());
+
+  FileHeader header;
+  std::memcpy(header.magic, magic, sizeof(magic));
+  header.version = version;
+  header.reserved = 0;
+  if (std::fwrite(&header, sizeof(header), 1, file_) != 1)
+    ERROR("Failed to write GL stream capture header");
+}
+
+StreamCapture::~StreamCapture() {
+  std::fclose(file_);
+}
+
+std::uint32_t StreamCapture::open_stream() {
+  std::uint32_t stream = 0;
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    stream = next_stream_++;
+  }
+  write_event(EventType::Opened, stream, nullptr, 0);
+  return stream;
+}
+
+void StreamCapture::data(std::uint32_t stream, const std::uint8_t *data,
+                         std::size_t size) {
+  do {
+    const auto chunk = std::min<std::size_t>(size, max_event_size);
+    write_event(EventType::Data, stream, data, chunk);
+    data += chunk;
+    size -= chunk;
+  } while (size > 0);
+}
+
+void StreamCapture::close_stream(std::uint32_t stream) {
+  write_event(EventType::Closed, stream, nullptr, 0);
+  // Make sure a session which ends by getting killed leaves us with
+  // everything up to its last client at least.
+  std::lock_guard<std::mutex> l(lock_);
+  std::fflush(file_);
+}
+
+void StreamCapture::write_event(EventType type, std::uint32_t stream,
+                                const std::uint8_t *data, std::size_t size) {
+  EventHeader header;
+  header.stream = stream;
+  header.type = static_cast<std::uint32_t>(type);
+  header.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - start_).count();
+  header.size = static_cast<std::uint32_t>(size);
+
+  std::lock_guard<std::mutex> l(lock_);
+  if (std::fwrite(&header, sizeof(header), 1, file_) != 1 ||
+      (size > 0 && std::fwrite(data, size, 1, file_) != 1))
+    ERROR("Failed to write to GL stream capture");
+}
+}  // namespace graphics
+}  // namespace anbox
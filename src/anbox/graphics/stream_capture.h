@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_GRAPHICS_STREAM_CAPTURE_H_
+#define ANBOX_GRAPHICS_STREAM_CAPTURE_H_
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace anbox {
+namespace graphics {
+// Records the raw command streams all guest GL clients send us into a
+// single file, in the order we received them, so that a session can be
+// replayed later on without any guest.
+//
+// A capture starts with a header (magic, version) followed by events.
+// Each event is made of the stream it belongs to, its type, the time it
+// happened at relative to the start of the capture, the size of its
+// payload and the payload itself. All values are in host byte order.
+class StreamCapture {
+ public:
+  static constexpr char magic[8] = {'A', 'N', 'B', 'X', 'G', 'L', 'C', 'P'};
+  static constexpr std::uint32_t version{1};
+  // Payload of a single event at most. Larger data is recorded as several
+  // events, a reader takes a larger size as a corrupted capture.
+  static constexpr std::uint32_t max_event_size{16 * 1024 * 1024};
+
+  enum class EventType : std::uint32_t { Opened = 0, Data = 1, Closed = 2 };
+
+  struct Event {
+    EventType type;
+    std::uint32_t stream;
+    std::chrono::nanoseconds timestamp;
+    std::vector<std::uint8_t> data;
+  };
+
+  // Reads back a capture. Throws std::runtime_error when the file can't be
+  // opened or isn't a capture.
+  class Reader {
+   public:
+    explicit Reader(const std::string &path);
+    ~Reader();
+
+    // Returns false once all events were read. A truncated last event,
+    // e.g. because the session got killed, counts as end of the capture.
+    // An event of an unknown type or larger than max_event_size ends it
+    // too, without anything being allocated for it.
+    bool next(Event &event);
+
+   private:
+    std::FILE *file_;
+  };
+
+  // Throws std::runtime_error when |path| can't be written.
+  explicit StreamCapture(const std::string &path);
+  ~StreamCapture();
+
+  // Returns the id of a new stream whose data is recorded with data().
+  std::uint32_t open_stream();
+  void data(std::uint32_t stream, const std::uint8_t *data, std::size_t size);
+  void close_stream(std::uint32_t stream);
+
+ private:
+  void write_event(EventType type, std::uint32_t stream,
+                   const std::uint8_t *data, std::size_t size);
+
+  std::mutex lock_;
+  std::FILE *file_;
+  std::vector<char> file_buffer_;
+  const std::chrono::steady_clock::time_point start_;
+  std::uint32_t next_stream_;
+};
+}  // namespace graphics
+}  // namespace anbox
+
+#endif
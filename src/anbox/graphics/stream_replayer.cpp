@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/stream_replayer.h"
+#include "anbox/graphics/emugl/RenderThread.h"
+#include "anbox/logger.h"
+
+#include <cstring>
+#include <map>
+
+namespace {
+constexpr std::size_t out_buffer_size{16 * 1024};
+}  // namespace
+
+namespace anbox {
+namespace graphics {
+ReplayStream::ReplayStream()
+    : IOStream(out_buffer_size), in_offset_(0), waiting_(false), stopped_(false) {}
+
+ReplayStream::~ReplayStream() {}
+
+void *ReplayStream::allocBuffer(size_t min_size) {
+  if (out_.size() < min_size)
+    out_.resize(min_size);
+  return out_.data();
+}
+
+size_t ReplayStream::commitBuffer(size_t size) {
+  // Nobody is waiting for the replies.
+  return size;
+}
+
+bool ReplayStream::wait_for_data(std::unique_lock<std::mutex> &l) {
+  if (available() == 0 && !stopped_) {
+    waiting_ = true;
+    changed_.notify_all();
+    changed_.wait(l, [&]() { return available() > 0 || stopped_; });
+    waiting_ = false;
+  }
+  return !stopped_;
+}
+
+const unsigned char *ReplayStream::read(void *buf, size_t *inout_len) {
+  std::unique_lock<std::mutex> l(lock_);
+  if (!wait_for_data(l))
+    return nullptr;
+
+  const auto count = std::min(*inout_len, available());
+  std::memcpy(buf, in_.data() + in_offset_, count);
+  in_offset_ += count;
+  *inout_len = count;
+  return static_cast<const unsigned char *>(buf);
+}
+
+const unsigned char *ReplayStream::peek(size_t *out_len) {
+  std::unique_lock<std::mutex> l(lock_);
+  if (!wait_for_data(l)) {
+    *out_len = 0;
+    return nullptr;
+  }
+
+  // The data stays where it is until we're fed again which only happens
+  // once the reader consumed all of it.
+  *out_len = available();
+  return in_.data() + in_offset_;
+}
+
+void ReplayStream::consume(size_t len) {
+  std::lock_guard<std::mutex> l(lock_);
+  in_offset_ += std::min(len, available());
+}
+
+void ReplayStream::forceStop() {
+  std::lock_guard<std::mutex> l(lock_);
+  stopped_ = true;
+  changed_.notify_all();
+}
+
+void ReplayStream::feed(const std::uint8_t *data, std::size_t size) {
+  std::lock_guard<std::mutex> l(lock_);
+  in_.erase(in_.begin(), in_.begin() + in_offset_);
+  in_offset_ = 0;
+  in_.insert(in_.end(), data, data + size);
+  changed_.notify_all();
+}
+
+void ReplayStream::wait_until_idle() {
+  std::unique_lock<std::mutex> l(lock_);
+  changed_.wait(l, [&]() { return (waiting_ && available() == 0) || stopped_; });
+}
+
+StreamReplayer::StreamReplayer(const std::shared_ptr<::Renderer> &renderer)
+    : renderer_(renderer) {}
+
+StreamReplayer::Statistics StreamReplayer::replay(StreamCapture::Reader &reader) {
+  struct Client {
+    std::unique_ptr<ReplayStream> stream;
+    std::unique_ptr<RenderThread> thread;
+
+    void stop() {
+      stream->forceStop();
+      thread->wait(nullptr);
+      // The thread has to go before the stream it reads from.
+      thread.reset();
+    }
+  };
+  std::map<std::uint32_t, Client> clients;
+
+  Statistics stats{0, 0, std::chrono::nanoseconds{0}, std::chrono::nanoseconds{0}};
+  const auto start = std::chrono::steady_clock::now();
+
+  StreamCapture::Event event;
+  while (reader.next(event)) {
+    stats.captured = event.timestamp;
+
+    if (event.type == StreamCapture::EventType::Opened) {
+      Client client;
+      client.stream.reset(new ReplayStream);
+      client.thread.reset(RenderThread::create(renderer_, client.stream.get(), nullptr));
+      if (!client.thread->start()) {
+        ERROR("Failed to start render thread for stream %d", event.stream);
+        continue;
+      }
+      clients[event.stream] = std::move(client);
+      stats.streams++;
+      continue;
+    }
+
+    auto client = clients.find(event.stream);
+    if (client == clients.end()) {
+      WARNING("Skipping event of unknown stream %d", event.stream);
+      continue;
+    }
+
+    if (event.type == StreamCapture::EventType::Closed) {
+      client->second.stop();
+      clients.erase(client);
+    } else if (event.type == StreamCapture::EventType::Data) {
+      client->second.stream->feed(event.data.data(), event.data.size());
+      client->second.stream->wait_until_idle();
+      stats.bytes += event.data.size();
+    }
+  }
+
+  for (auto &client : clients)
+    client.second.stop();
+  clients.clear();
+
+  stats.elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start);
+  return stats;
+}
+}  // namespace graphics
+}  // namespace anbox
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_GRAPHICS_STREAM_REPLAYER_H_
+#define ANBOX_GRAPHICS_STREAM_REPLAYER_H_
+
+#include "anbox/graphics/stream_capture.h"
+
+#include "external/android-emugl/host/include/libOpenglRender/IOStream.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class Renderer;
+
+namespace anbox {
+namespace graphics {
+// Input stream a render thread decodes captured data from. Everything the
+// render thread replies is dropped.
+class ReplayStream : public IOStream {
+ public:
+  ReplayStream();
+  ~ReplayStream();
+
+  void *allocBuffer(size_t min_size) override;
+  size_t commitBuffer(size_t size) override;
+  const unsigned char *read(void *buf, size_t *inout_len) override;
+  const unsigned char *peek(size_t *out_len) override;
+  void consume(size_t len) override;
+  void forceStop() override;
+
+  // Hands |size| more bytes to the reader. Must only be called when the
+  // reader is idle.
+  void feed(const std::uint8_t *data, std::size_t size);
+
+  // Blocks until the reader is done with all data it got and waits for
+  // more, i.e. everything fed so far was decoded and executed.
+  void wait_until_idle();
+
+ private:
+  // Waits for data with |lock_| held and returns false once stopped.
+  bool wait_for_data(std::unique_lock<std::mutex> &l);
+  std::size_t available() const { return in_.size() - in_offset_; }
+
+  std::mutex lock_;
+  std::condition_variable changed_;
+  std::vector<std::uint8_t> in_;
+  std::size_t in_offset_;
+  bool waiting_;
+  bool stopped_;
+  std::vector<std::uint8_t> out_;
+};
+
+// Feeds a capture through render threads and all decoders into a renderer
+// as fast as possible.
+//
+// Data is handed to the render thread of the stream it was captured for
+// and only once it was completely executed we move on to the next event.
+// This keeps the order between the clients the same as during the capture
+// which matters as handles created by one client are used by others. As
+// a side effect the replay is fully deterministic.
+class StreamReplayer {
+ public:
+  struct Statistics {
+    std::uint64_t streams;
+    std::uint64_t bytes;
+    std::chrono::nanoseconds elapsed;
+    // Duration of the captured session.
+    std::chrono::nanoseconds captured;
+  };
+
+  explicit StreamReplayer(const std::shared_ptr<::Renderer> &renderer);
+
+  Statistics replay(StreamCapture::Reader &reader);
+
+ private:
+  std::shared_ptr<::Renderer> renderer_;
+};
+}  // namespace graphics
+}  // namespace anbox
+
+#endif
@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/vsync_clock.h"
+
+namespace anbox {
+namespace graphics {
+constexpr int VsyncClock::default_refresh_rate;
+
+std::chrono::nanoseconds VsyncClock::period_for_refresh_rate(int refresh_rate) {
+  if (refresh_rate <= 0)
+    refresh_rate = default_refresh_rate;
+  return std::chrono::nanoseconds{std::chrono::seconds{1}} / refresh_rate;
+}
+
+void VsyncClock::presented(const Clock::time_point &timestamp) {
+  last_presentation_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           timestamp.time_since_epoch()).count();
+}
+
+std::chrono::nanoseconds VsyncClock::phase(const std::chrono::nanoseconds &period) const {
+  if (period.count() <= 0)
+    return std::chrono::nanoseconds{0};
+  return std::chrono::nanoseconds{last_presentation_.load() % period.count()};
+}
+}  // namespace graphics
+}  // namespace anbox
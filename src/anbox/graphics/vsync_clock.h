@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_GRAPHICS_VSYNC_CLOCK_H_
+#define ANBOX_GRAPHICS_VSYNC_CLOCK_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace anbox {
+namespace graphics {
+// Keeps track of when the host display refreshes. Frames are presented
+// with a blocking buffer swap which returns right after the vertical
+// blank so the time of the last presentation gives us the phase of the
+// host vsync. As the container shares the kernel with us the guest can
+// use that phase directly together with its monotonic clock.
+class VsyncClock {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  static constexpr int default_refresh_rate{60};
+
+  // Returns the duration of a single refresh cycle for a display with
+  // |refresh_rate| Hz. Unknown rates fall back to default_refresh_rate.
+  static std::chrono::nanoseconds period_for_refresh_rate(int refresh_rate);
+
+  void presented(const Clock::time_point &timestamp);
+
+  // Offset of the host vsync within a refresh cycle of |period|,
+  // measured from the epoch of Clock. Returns zero as long as nothing
+  // was presented yet.
+  std::chrono::nanoseconds phase(const std::chrono::nanoseconds &period) const;
+
+ private:
+  std::atomic<std::int64_t> last_presentation_{0};
+};
+}  // namespace graphics
+}  // namespace anbox
+
+#endif
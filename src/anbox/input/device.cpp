@@ -16,16 +16,49 @@
  */
 
 #include "anbox/input/device.h"
+#include "anbox/common/tracer.h"
+#include "anbox/input/latency_statistics.h"
 #include "anbox/logger.h"
 #include "anbox/network/delegate_connection_creator.h"
 #include "anbox/network/delegate_message_processor.h"
 #include "anbox/network/local_socket_messenger.h"
-#include "anbox/qemu/null_message_processor.h"
+#include "anbox/network/message_processor.h"
 
-#include <time.h>
+#include <cstring>
+
+#include <unistd.h>
 
 namespace anbox {
 namespace input {
+// Collects the events Android writes back, which may arrive split up.
+class Device::FeedbackProcessor : public network::MessageProcessor {
+ public:
+  explicit FeedbackProcessor(const std::weak_ptr<Device> &device)
+      : device_(device), buffered_(0) {}
+
+  bool process_data(const std::uint8_t *data, size_t size) override {
+    while (size > 0) {
+      const auto count = std::min(size, sizeof(event_) - buffered_);
+      std::memcpy(reinterpret_cast<std::uint8_t *>(&event_) + buffered_, data, count);
+      buffered_ += count;
+      data += count;
+      size -= count;
+      if (buffered_ < sizeof(event_))
+        break;
+
+      buffered_ = 0;
+      if (auto device = device_.lock())
+        device->process_feedback(event_);
+    }
+    return true;
+  }
+
+ private:
+  std::weak_ptr<Device> device_;
+  CompatEvent event_;
+  std::size_t buffered_;
+};
+
 std::shared_ptr<Device> Device::create(
     const std::string &path, const std::shared_ptr<Runtime> &runtime) {
   auto sp = std::make_shared<Device>();
@@ -36,7 +69,9 @@ std::shared_ptr<Device> Device::create(
                &socket) { sp->new_client(socket); });
 
   sp->connector_ = std::make_shared<network::PublishedSocketConnector>(
-      path, runtime, delegate_connector);
+      path, runtime, delegate_connector, Runtime::Subsystem::Input);
+  sp->socket_path_ = sp->connector_->socket_file();
+  sp->runtime_ = runtime;
 
   return sp;
 }
@@ -51,39 +86,82 @@ Device::Device()
 Device::~Device() {}
 
 void Device::send_events(const std::vector<Event> &events) {
-  struct CompatEvent {
-    // NOTE: A bit dirty but as we're running currently a 64 bit container
-    // struct input_event has a different size. We rebuild the struct here
-    // to reach the correct size.
-    std::uint64_t sec;
-    std::uint64_t usec;
-    std::uint16_t type;
-    std::uint16_t code;
-    std::uint32_t value;
-  };
-
-  struct timespec spec;
-  clock_gettime(CLOCK_MONOTONIC, &spec);
-
-  auto data = new CompatEvent[events.size()];
-  int n = 0;
-  for (const auto &event : events) {
-    data[n].sec = spec.tv_sec;
-    data[n].usec = spec.tv_nsec / 1000;
-    data[n].type = event.type;
-    data[n].code = event.code;
-    data[n].value = event.value;
-    n++;
+  send_events(events, std::chrono::steady_clock::now());
+}
+
+void Device::send_events(const std::vector<Event> &events,
+                         const std::chrono::steady_clock::time_point &time) {
+  send_events(events.data(), events.size(), time);
+}
+
+void Device::send_events(const Event *events, std::size_t count,
+                         const std::chrono::steady_clock::time_point &time) {
+  ANBOX_TRACE_SPAN("input", "send_events");
+  // The steady clock is CLOCK_MONOTONIC which is what Android expects
+  // input events to be stamped with.
+  const auto since_boot = std::chrono::duration_cast<std::chrono::microseconds>(
+      time.time_since_epoch()).count();
+  const std::uint64_t sec = since_boot / 1000000;
+  const std::uint64_t usec = since_boot % 1000000;
+
+  std::lock_guard<std::mutex> l(send_lock_);
+  send_buffer_.resize(count);
+  for (std::size_t n = 0; n < count; n++) {
+    send_buffer_[n].sec = sec;
+    send_buffer_[n].usec = usec;
+    send_buffer_[n].type = events[n].type;
+    send_buffer_[n].code = events[n].code;
+    send_buffer_[n].value = events[n].value;
   }
 
-  for (unsigned n = 0; n < connections_->size(); n++) {
-    connections_->at(n)->send(reinterpret_cast<const char *>(data),
-                              events.size() * sizeof(struct CompatEvent));
+  const auto receivers = connections_->broadcast(
+      reinterpret_cast<const char *>(send_buffer_.data()),
+      send_buffer_.size() * sizeof(CompatEvent));
+
+  if (statistics_ && receivers > 0)
+    statistics_->events_sent(name_, time, std::chrono::steady_clock::now());
+}
+
+void Device::set_latency_statistics(const std::shared_ptr<LatencyStatistics> &statistics) {
+  std::lock_guard<std::mutex> l(send_lock_);
+  statistics_ = statistics;
+}
+
+void Device::set_rumble_handler(const RumbleHandler &handler) {
+  std::lock_guard<std::mutex> l(send_lock_);
+  rumble_handler_ = handler;
+}
+
+void Device::process_feedback(const CompatEvent &event) {
+  const auto time = std::chrono::seconds{event.sec} + std::chrono::microseconds{event.usec};
+
+  std::shared_ptr<LatencyStatistics> statistics;
+  RumbleHandler rumble_handler;
+  {
+    std::lock_guard<std::mutex> l(send_lock_);
+    statistics = statistics_;
+    rumble_handler = rumble_handler_;
+  }
+
+  if (event.type == EV_SYN && event.code == SYN_REPORT) {
+    if (!statistics)
+      return;
+    const LatencyStatistics::Clock::time_point stamped{
+        std::chrono::duration_cast<LatencyStatistics::Clock::duration>(time)};
+    statistics->events_received(name_, stamped,
+                                stamped + std::chrono::microseconds{event.value});
+  } else if (event.type == EV_FF && event.code == FF_RUMBLE) {
+    if (!rumble_handler)
+      return;
+    rumble_handler(Rumble{static_cast<std::uint16_t>(event.value >> 16),
+                          static_cast<std::uint16_t>(event.value & 0xffff),
+                          std::chrono::duration_cast<std::chrono::milliseconds>(time)});
   }
 }
 
 void Device::set_name(const std::string &name) {
   snprintf(info_.name, 80, "%s", name.c_str());
+  name_ = info_.name;
 }
 
 void Device::set_driver_version(const int &version) {
@@ -145,7 +223,25 @@ void Device::set_unique_id(const std::string &unique_id) {
   snprintf(info_.unique_id, 80, "%s", unique_id.c_str());
 }
 
-std::string Device::socket_path() const { return connector_->socket_file(); }
+std::string Device::socket_path() const { return socket_path_; }
+
+void Device::close() {
+  // The connector keeps us alive through the connection creator.
+  connector_.reset();
+
+  std::vector<std::weak_ptr<network::SocketMessenger>> messengers;
+  {
+    std::lock_guard<std::mutex> l(send_lock_);
+    messengers.swap(messengers_);
+  }
+  // Connections go away on their own once their pending read fails.
+  for (const auto &weak_messenger : messengers) {
+    if (auto messenger = weak_messenger.lock())
+      messenger->close();
+  }
+
+  ::unlink(socket_path_.c_str());
+}
 
 int Device::next_id() { return next_connection_id_++; }
 
@@ -156,13 +252,21 @@ void Device::new_client(
       std::make_shared<network::LocalSocketMessenger>(socket);
   auto const &connection = std::make_shared<network::SocketConnection>(
       messenger, messenger, next_id(), connections_,
-      std::make_shared<qemu::NullMessageProcessor>());
+      std::make_shared<FeedbackProcessor>(shared_from_this()));
   connection->set_name("input-device");
+  if (auto runtime = runtime_.lock())
+    connection->set_handler_statistics(runtime->handler_statistics());
   connections_->add(connection);
+  {
+    std::lock_guard<std::mutex> l(send_lock_);
+    messengers_.push_back(messenger);
+  }
 
   // Send all necessary information about our device so that the remote
   // side can properly configure itself for this input device
   connection->send(reinterpret_cast<char const *>(&info_), sizeof(info_));
+
+  connection->read_next_message();
 }
 }  // namespace input
 }  // namespace anbox
@@ -21,14 +21,20 @@
 #include "anbox/network/connections.h"
 #include "anbox/network/published_socket_connector.h"
 #include "anbox/network/socket_connection.h"
+#include "anbox/network/socket_messenger.h"
 #include "anbox/runtime.h"
 
+#include <chrono>
+#include <functional>
+#include <mutex>
 #include <vector>
 
 #include <linux/input.h>
 
 namespace anbox {
 namespace input {
+class LatencyStatistics;
+
 struct Event {
   std::uint16_t type;
   std::uint16_t code;
@@ -37,6 +43,21 @@ struct Event {
 
 class Device : public std::enable_shared_from_this<Device> {
  public:
+  // Android writes events back in the same layout we send them in:
+  //
+  // - {EV_SYN, SYN_REPORT} confirms reading a batch. It carries the time
+  //   the batch was stamped with and as value the microseconds it took
+  //   until it was read.
+  // - {EV_FF, FF_RUMBLE} asks for rumble with the strong magnitude in the
+  //   upper and the weak one in the lower 16 bits of the value. The time
+  //   is how long it should last. A value of zero stops it.
+  struct Rumble {
+    std::uint16_t strong;
+    std::uint16_t weak;
+    std::chrono::milliseconds duration;
+  };
+  typedef std::function<void(const Rumble &)> RumbleHandler;
+
   static std::shared_ptr<Device> create(
       const std::string &path, const std::shared_ptr<Runtime> &runtime);
 
@@ -44,6 +65,13 @@ class Device : public std::enable_shared_from_this<Device> {
   ~Device();
 
   void send_events(const std::vector<Event> &events);
+  // Stamps the events with |time| instead of the time they're sent at.
+  void send_events(const std::vector<Event> &events,
+                   const std::chrono::steady_clock::time_point &time);
+  // Doesn't allocate once the device sent a batch of |count| events
+  // before, e.g. for an EventBatch.
+  void send_events(const Event *events, std::size_t count,
+                   const std::chrono::steady_clock::time_point &time);
   void send_event(const std::uint16_t &code, const std::uint16_t &event,
                   const std::int32_t &value);
 
@@ -65,7 +93,18 @@ class Device : public std::enable_shared_from_this<Device> {
 
   std::string socket_path() const;
 
+  // Stops accepting connections, disconnects Android and removes the
+  // socket so that Android drops the device.
+  void close();
+
+  // Records the latency of all events sent from now on.
+  void set_latency_statistics(const std::shared_ptr<LatencyStatistics> &statistics);
+  // Called from the runtime for force feedback Android plays on us.
+  void set_rumble_handler(const RumbleHandler &handler);
+
  private:
+  class FeedbackProcessor;
+
   int next_id();
   void new_client(std::shared_ptr<
                   boost::asio::local::stream_protocol::socket> const &socket);
@@ -92,10 +131,33 @@ class Device : public std::enable_shared_from_this<Device> {
 
   void set_bit(std::uint8_t *array, const std::uint64_t &bit);
 
+  struct CompatEvent {
+    // NOTE: A bit dirty but as we're running currently a 64 bit container
+    // struct input_event has a different size. We rebuild the struct here
+    // to reach the correct size.
+    std::uint64_t sec;
+    std::uint64_t usec;
+    std::uint16_t type;
+    std::uint16_t code;
+    std::uint32_t value;
+  };
+
+  void process_feedback(const CompatEvent &event);
+
   std::shared_ptr<network::PublishedSocketConnector> connector_;
+  std::weak_ptr<Runtime> runtime_;
+  std::string socket_path_;
+  std::vector<std::weak_ptr<network::SocketMessenger>> messengers_;
   std::atomic<int> next_connection_id_;
   std::shared_ptr<network::Connections<network::SocketConnection>> connections_;
   Info info_;
+  // Same as the one in |info_|, kept around for the latency statistics.
+  std::string name_;
+  std::mutex send_lock_;
+  // Reused for every batch of events we send.
+  std::vector<CompatEvent> send_buffer_;
+  std::shared_ptr<LatencyStatistics> statistics_;
+  RumbleHandler rumble_handler_;
 };
 }  // namespace input
 }  // namespace anbox
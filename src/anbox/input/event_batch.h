@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_INPUT_EVENT_BATCH_H_
+#define ANBOX_INPUT_EVENT_BATCH_H_
+
+#include "anbox/input/device.h"
+
+#include <array>
+#include <cstddef>
+
+namespace anbox {
+namespace input {
+// Events translated from a single host event, which are never more than
+// a handful. It lives on the stack so that translating input doesn't
+// touch the heap.
+class EventBatch {
+ public:
+  static constexpr std::size_t capacity{16};
+
+  // Returns false and drops |event| when the batch is full already.
+  bool push_back(const Event &event) {
+    if (size_ == capacity)
+      return false;
+    events_[size_++] = event;
+    return true;
+  }
+
+  void clear() { size_ = 0; }
+
+  const Event *data() const { return events_.data(); }
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+ private:
+  std::array<Event, capacity> events_;
+  std::size_t size_ = 0;
+};
+}  // namespace input
+}  // namespace anbox
+
+#endif
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "anbox/input/event_batcher.h"
+
+namespace anbox {
+namespace input {
+constexpr std::chrono::milliseconds EventBatcher::default_window;
+
+EventBatcher::EventBatcher(const Sender &sender, const std::chrono::milliseconds &window)
+    : sender_(sender),
+      window_(window),
+      frame_start_(0),
+      frame_is_motion_(true),
+      motion_frame_start_(0),
+      has_motion_frame_(false) {}
+
+bool EventBatcher::is_motion(const Event &event) const {
+  return event.type == EV_ABS || event.type == EV_REL;
+}
+
+void EventBatcher::queue(const Event &event, const Clock::time_point &time) {
+  if (events_.empty())
+    first_queued_ = time;
+  last_queued_ = time;
+
+  events_.push_back(event);
+
+  if (event.type == EV_SYN && event.code == SYN_REPORT) {
+    end_frame();
+    return;
+  }
+
+  if (!is_motion(event))
+    frame_is_motion_ = false;
+}
+
+void EventBatcher::end_frame() {
+  if (!frame_is_motion_) {
+    flush();
+    return;
+  }
+
+  if (has_motion_frame_) {
+    merge_frame();
+  } else {
+    motion_frame_start_ = frame_start_;
+    has_motion_frame_ = true;
+  }
+  frame_start_ = events_.size();
+}
+
+void EventBatcher::merge_frame() {
+  // As any other frame flushes the queue the one to merge with is the
+  // last complete one and ends with the SYN_REPORT before the new frame.
+  frame_.assign(events_.begin() + frame_start_, events_.end() - 1);
+  events_.resize(frame_start_);
+
+  for (const auto &event : frame_) {
+    bool merged = false;
+    for (auto n = motion_frame_start_; n < events_.size() - 1; n++) {
+      auto &previous = events_[n];
+      if (previous.type != event.type || previous.code != event.code)
+        continue;
+      if (event.type == EV_REL)
+        previous.value += event.value;
+      else
+        previous.value = event.value;
+      merged = true;
+      break;
+    }
+    if (!merged)
+      events_.insert(events_.end() - 1, event);
+  }
+}
+
+void EventBatcher::flush_if_due(const Clock::time_point &now) {
+  if (!events_.empty() && now >= deadline())
+    flush();
+}
+
+void EventBatcher::flush() {
+  if (!events_.empty())
+    sender_(events_, last_queued_);
+
+  // Keeps the memory for the next batch.
+  events_.clear();
+  frame_start_ = 0;
+  frame_is_motion_ = true;
+  has_motion_frame_ = false;
+}
+}  // namespace input
+}  // namespace anbox
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef ANBOX_INPUT_EVENT_BATCHER_H_
+#define ANBOX_INPUT_EVENT_BATCHER_H_
+
+#include "anbox/input/device.h"
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace anbox {
+namespace input {
+// Collects the events of a device and sends them in batches, one write
+// for everything that piled up instead of one per frame.
+//
+// Frames, i.e. events up to a SYN_REPORT, made of nothing but motion are
+// held back for at most |window| and merged with the motion frame queued
+// before them: absolute axes take the latest value and relative ones add
+// up. Anything else, like a button press, flushes the queue immediately
+// so it isn't delayed and keeps its order with the motion around it.
+class EventBatcher {
+ public:
+  typedef std::chrono::steady_clock Clock;
+  // Gets the events together with the time the last of them happened.
+  typedef std::function<void(const std::vector<Event> &, const Clock::time_point &)> Sender;
+
+  // Only coalesces what queued up until the next flush.
+  static constexpr std::chrono::milliseconds default_window{0};
+
+  EventBatcher(const Sender &sender,
+               const std::chrono::milliseconds &window = default_window);
+
+  // |time| is when the event happened.
+  void queue(const Event &event, const Clock::time_point &time = Clock::now());
+
+  // Sends what is queued once it was held back for the whole window.
+  void flush_if_due(const Clock::time_point &now = Clock::now());
+  void flush();
+
+  bool empty() const { return events_.empty(); }
+  // When the queued events have to be sent at the latest. Only valid
+  // when not empty.
+  Clock::time_point deadline() const { return first_queued_ + window_; }
+
+ private:
+  bool is_motion(const Event &event) const;
+  void end_frame();
+  void merge_frame();
+
+  Sender sender_;
+  std::chrono::milliseconds window_;
+  // Complete frames followed by the frame currently being queued,
+  // which starts at |frame_start_|.
+  std::vector<Event> events_;
+  std::size_t frame_start_;
+  // Scratch space for merging frames.
+  std::vector<Event> frame_;
+  bool frame_is_motion_;
+  // Where the last complete frame starts if it can be merged with.
+  std::size_t motion_frame_start_;
+  bool has_motion_frame_;
+  Clock::time_point first_queued_;
+  Clock::time_point last_queued_;
+};
+}  // namespace input
+}  // namespace anbox
+
+#endif
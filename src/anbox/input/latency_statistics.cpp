@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "anbox/input/latency_statistics.h"
+
+namespace anbox {
+namespace input {
+constexpr std::size_t LatencyStatistics::max_samples;
+constexpr std::chrono::seconds LatencyStatistics::max_photon_latency;
+
+void LatencyStatistics::events_sent(const std::string &device,
+                                    const Clock::time_point &happened,
+                                    const Clock::time_point &sent) {
+  std::lock_guard<std::mutex> l(lock_);
+  auto &d = devices_[device];
+  d.sent_batches++;
+  d.queued.add(sent - happened);
+  if (!d.has_pending) {
+    d.pending = happened;
+    d.has_pending = true;
+  }
+}
+
+void LatencyStatistics::events_received(const std::string &device,
+                                        const Clock::time_point &happened,
+                                        const Clock::time_point &received) {
+  std::lock_guard<std::mutex> l(lock_);
+  auto &d = devices_[device];
+  d.received_batches++;
+  d.delivery.add(received - happened);
+}
+
+void LatencyStatistics::frame_presented(const Clock::time_point &presented) {
+  std::lock_guard<std::mutex> l(lock_);
+  for (auto &device : devices_) {
+    auto &d = device.second;
+    if (!d.has_pending || d.pending > presented)
+      continue;
+    if (presented - d.pending <= max_photon_latency)
+      d.photon.add(presented - d.pending);
+    d.has_pending = false;
+  }
+}
+
+std::vector<LatencyStatistics::Summary> LatencyStatistics::summary() const {
+  std::lock_guard<std::mutex> l(lock_);
+
+  std::vector<Summary> result;
+  for (const auto &d : devices_) {
+    Summary s;
+    s.device = d.first;
+    s.sent_batches = d.second.sent_batches;
+    s.received_batches = d.second.received_batches;
+    s.queued = d.second.queued.percentiles();
+    s.delivery = d.second.delivery.percentiles();
+    s.photon = d.second.photon.percentiles();
+    result.push_back(s);
+  }
+  return result;
+}
+
+void LatencyStatistics::write_prometheus(std::ostream &out) const {
+  const auto devices = summary();
+
+  const auto counter = [&](const char *metric, const char *help,
+                           std::uint64_t Summary::*value) {
+    out << "# HELP " << metric << " " << help << "\n"
+        << "# TYPE " << metric << " counter\n";
+    for (const auto &s : devices)
+      out << metric << "{device=\"" << common::escape_prometheus_label(s.device) << "\"} "
+          << s.*value << "\n";
+  };
+
+  counter("anbox_input_batches_sent_total", "Batches of input events sent to Android.",
+          &Summary::sent_batches);
+  counter("anbox_input_batches_received_total", "Batches of input events Android confirmed reading.",
+          &Summary::received_batches);
+
+  out << "# HELP anbox_input_latency_seconds Time from an input event happening until it was sent, read by Android and until the next frame was presented.\n"
+      << "# TYPE anbox_input_latency_seconds gauge\n";
+  for (const auto &s : devices) {
+    const auto device = "device=\"" + common::escape_prometheus_label(s.device) + "\"";
+    common::write_prometheus_quantiles(out, "anbox_input_latency_seconds", device + ",stage=\"queued\"", s.queued);
+    common::write_prometheus_quantiles(out, "anbox_input_latency_seconds", device + ",stage=\"delivery\"", s.delivery);
+    common::write_prometheus_quantiles(out, "anbox_input_latency_seconds", device + ",stage=\"photon\"", s.photon);
+  }
+}
+}  // namespace input
+}  // namespace anbox
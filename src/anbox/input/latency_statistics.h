@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef ANBOX_INPUT_LATENCY_STATISTICS_H_
+#define ANBOX_INPUT_LATENCY_STATISTICS_H_
+
+#include "anbox/common/latency_samples.h"
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace anbox {
+namespace input {
+// Tracks how long input takes per device from the host seeing an event
+// until Android read it and until the next frame was presented.
+//
+// The latter is what a user perceives as input latency as long as the
+// input caused a visible change. Input for which no frame follows within
+// max_photon_latency is not counted.
+class LatencyStatistics {
+ public:
+  typedef std::chrono::steady_clock Clock;
+  typedef common::LatencySamples::Percentiles Percentiles;
+
+  struct Summary {
+    std::string device;
+    std::uint64_t sent_batches;
+    // Batches Android told us it read.
+    std::uint64_t received_batches;
+    // From the event happening until we sent it.
+    Percentiles queued;
+    // From the event happening until Android read it.
+    Percentiles delivery;
+    // From the event happening until the next frame was presented.
+    Percentiles photon;
+  };
+
+  static constexpr std::size_t max_samples{600};
+  static constexpr std::chrono::seconds max_photon_latency{1};
+
+  void events_sent(const std::string &device, const Clock::time_point &happened,
+                   const Clock::time_point &sent);
+  void events_received(const std::string &device, const Clock::time_point &happened,
+                       const Clock::time_point &received);
+  void frame_presented(const Clock::time_point &presented);
+
+  std::vector<Summary> summary() const;
+
+  // Writes summary() in the Prometheus text exposition format.
+  void write_prometheus(std::ostream &out) const;
+
+ private:
+  struct Device {
+    std::uint64_t sent_batches = 0;
+    std::uint64_t received_batches = 0;
+    common::LatencySamples queued{max_samples};
+    common::LatencySamples delivery{max_samples};
+    common::LatencySamples photon{max_samples};
+    // Earliest input not followed by a frame yet.
+    bool has_pending = false;
+    Clock::time_point pending;
+  };
+
+  mutable std::mutex lock_;
+  std::map<std::string, Device> devices_;
+};
+}  // namespace input
+}  // namespace anbox
+
+#endif
@@ -35,10 +35,28 @@ std::shared_ptr<Device> Manager::create_device() {
   const auto id = next_id();
   const auto path = build_device_path(id);
   auto device = Device::create(path, runtime_);
+  if (statistics_)
+    device->set_latency_statistics(statistics_);
   devices_.insert({id, device});
   return device;
 }
 
+void Manager::remove_device(const std::shared_ptr<Device> &device) {
+  for (auto iter = devices_.begin(); iter != devices_.end(); ++iter) {
+    if (iter->second == device) {
+      device->close();
+      devices_.erase(iter);
+      break;
+    }
+  }
+}
+
+void Manager::set_latency_statistics(const std::shared_ptr<LatencyStatistics> &statistics) {
+  statistics_ = statistics;
+  for (const auto &device : devices_)
+    device.second->set_latency_statistics(statistics);
+}
+
 std::uint32_t Manager::next_id() {
   static std::uint32_t next_id = 0;
   return next_id++;
@@ -18,19 +18,27 @@
 #ifndef ANBOX_INPUT_MANAGER_H_
 #define ANBOX_INPUT_MANAGER_H_
 
+#include <cstdint>
 #include <map>
 #include <memory>
+#include <string>
 
 namespace anbox {
 class Runtime;
 namespace input {
 class Device;
+class LatencyStatistics;
 class Manager {
  public:
   Manager(const std::shared_ptr<Runtime> &runtime);
   ~Manager();
 
   std::shared_ptr<Device> create_device();
+  // Takes |device| away from Android again.
+  void remove_device(const std::shared_ptr<Device> &device);
+
+  // Records the latency of the events of all devices.
+  void set_latency_statistics(const std::shared_ptr<LatencyStatistics> &statistics);
 
  private:
   std::uint32_t next_id();
@@ -38,6 +46,7 @@ class Manager {
 
   std::shared_ptr<Runtime> runtime_;
   std::map<std::uint32_t, std::shared_ptr<Device>> devices_;
+  std::shared_ptr<LatencyStatistics> statistics_;
 };
 }  // namespace input
 }  // namespace anbox
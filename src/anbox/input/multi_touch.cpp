@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "anbox/input/multi_touch.h"
+
+namespace anbox {
+namespace input {
+constexpr std::size_t MultiTouch::max_slots;
+constexpr std::int32_t MultiTouch::max_tracking_id;
+
+MultiTouch::MultiTouch(const Sender &sender)
+    : sender_(sender), next_tracking_id_(0), current_slot_(-1), touching_(false) {
+  for (auto &slot : slots_)
+    slot = Slot{0, false, false, false, -1, 0, 0};
+}
+
+int MultiTouch::find_slot(std::int64_t finger) const {
+  for (std::size_t n = 0; n < slots_.size(); n++) {
+    if (slots_[n].down && slots_[n].finger == finger)
+      return n;
+  }
+  return -1;
+}
+
+bool MultiTouch::changed(const Slot &slot) const {
+  return slot.down != slot.reported || (slot.down && slot.moved);
+}
+
+void MultiTouch::down(std::int64_t finger, std::int32_t x, std::int32_t y,
+                      const Clock::time_point &time) {
+  if (find_slot(finger) >= 0)
+    return move(finger, x, y, time);
+
+  // A slot the guest still thinks is in use can only be taken over
+  // once it was told the finger went up.
+  int free_slot = -1;
+  for (std::size_t n = 0; n < slots_.size() && free_slot < 0; n++) {
+    if (!slots_[n].down && !slots_[n].reported)
+      free_slot = n;
+  }
+  if (free_slot < 0) {
+    for (std::size_t n = 0; n < slots_.size() && free_slot < 0; n++) {
+      if (!slots_[n].down)
+        free_slot = n;
+    }
+    if (free_slot < 0)
+      return;
+    flush();
+  }
+
+  auto &slot = slots_[free_slot];
+  slot.finger = finger;
+  slot.down = true;
+  slot.moved = true;
+  slot.tracking_id = next_tracking_id_;
+  slot.x = x;
+  slot.y = y;
+  next_tracking_id_ = (next_tracking_id_ + 1) & max_tracking_id;
+  last_change_ = time;
+}
+
+void MultiTouch::move(std::int64_t finger, std::int32_t x, std::int32_t y,
+                      const Clock::time_point &time) {
+  const auto n = find_slot(finger);
+  if (n < 0)
+    return;
+
+  auto &slot = slots_[n];
+  slot.moved = true;
+  slot.x = x;
+  slot.y = y;
+  last_change_ = time;
+}
+
+void MultiTouch::up(std::int64_t finger, const Clock::time_point &time) {
+  const auto n = find_slot(finger);
+  if (n < 0)
+    return;
+
+  // Going down and up again within a single frame would never reach
+  // the guest, so the down goes out first.
+  if (!slots_[n].reported)
+    flush();
+
+  slots_[n].down = false;
+  last_change_ = time;
+}
+
+bool MultiTouch::pending() const {
+  for (const auto &slot : slots_) {
+    if (changed(slot))
+      return true;
+  }
+  return false;
+}
+
+void MultiTouch::flush() {
+  events_.clear();
+
+  bool touching = false;
+  for (std::size_t n = 0; n < slots_.size(); n++) {
+    auto &slot = slots_[n];
+    touching |= slot.down;
+    if (!changed(slot))
+      continue;
+
+    if (current_slot_ != static_cast<int>(n)) {
+      events_.push_back({EV_ABS, ABS_MT_SLOT, static_cast<std::int32_t>(n)});
+      current_slot_ = n;
+    }
+
+    if (slot.down) {
+      if (!slot.reported)
+        events_.push_back({EV_ABS, ABS_MT_TRACKING_ID, slot.tracking_id});
+      events_.push_back({EV_ABS, ABS_MT_POSITION_X, slot.x});
+      events_.push_back({EV_ABS, ABS_MT_POSITION_Y, slot.y});
+    } else {
+      events_.push_back({EV_ABS, ABS_MT_TRACKING_ID, -1});
+    }
+
+    slot.reported = slot.down;
+    slot.moved = false;
+  }
+
+  if (events_.empty())
+    return;
+
+  if (touching != touching_) {
+    events_.push_back({EV_KEY, BTN_TOUCH, touching ? 1 : 0});
+    touching_ = touching;
+  }
+  events_.push_back({EV_SYN, SYN_REPORT, 0});
+  sender_(events_, last_change_);
+}
+}  // namespace input
+}  // namespace anbox
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef ANBOX_INPUT_MULTI_TOUCH_H_
+#define ANBOX_INPUT_MULTI_TOUCH_H_
+
+#include "anbox/input/device.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace anbox {
+namespace input {
+// Turns finger events into frames following the multi-touch protocol
+// (type B) of the Linux kernel, see Documentation/input/multi-touch-protocol.txt.
+//
+// Fingers get a slot assigned when they go down. Their changes are
+// collected until flush() which sends all slots which changed in a
+// single frame.
+class MultiTouch {
+ public:
+  typedef std::chrono::steady_clock Clock;
+  // Gets the events together with the time the last change happened.
+  typedef std::function<void(const std::vector<Event> &, const Clock::time_point &)> Sender;
+
+  static constexpr std::size_t max_slots{10};
+  static constexpr std::int32_t max_tracking_id{0xffff};
+
+  explicit MultiTouch(const Sender &sender);
+
+  // |finger| identifies the finger for as long as it's down. Fingers
+  // beyond max_slots are ignored. |time| is when the change happened.
+  void down(std::int64_t finger, std::int32_t x, std::int32_t y,
+            const Clock::time_point &time = Clock::now());
+  void move(std::int64_t finger, std::int32_t x, std::int32_t y,
+            const Clock::time_point &time = Clock::now());
+  void up(std::int64_t finger, const Clock::time_point &time = Clock::now());
+
+  void flush();
+
+  // Whether there are changes which weren't sent yet.
+  bool pending() const;
+
+ private:
+  struct Slot {
+    std::int64_t finger;
+    // What the guest knows about.
+    bool reported;
+    // What we got since the last frame.
+    bool down;
+    bool moved;
+    std::int32_t tracking_id;
+    std::int32_t x;
+    std::int32_t y;
+  };
+
+  int find_slot(std::int64_t finger) const;
+  bool changed(const Slot &slot) const;
+
+  Sender sender_;
+  std::array<Slot, max_slots> slots_;
+  std::int32_t next_tracking_id_;
+  int current_slot_;
+  bool touching_;
+  Clock::time_point last_change_;
+  // Reused for every frame.
+  std::vector<Event> events_;
+};
+}  // namespace input
+}  // namespace anbox
+
+#endif
@@ -15,6 +15,7 @@
  *
  */
 
+#include <atomic>
 #include <thread>
 
 #define BOOST_LOG_DYN_LINK
@@ -36,7 +37,7 @@ BOOST_LOG_ATTRIBUTE_KEYWORD(Timestamp, "Timestamp", boost::posix_time::ptime)
 }
 
 struct BoostLogLogger : public anbox::Logger {
-  BoostLogLogger() : initialized_(false) {}
+  BoostLogLogger() : severity_(Severity::kWarning), initialized_(false) {}
 
   void Init(const anbox::Logger::Severity& severity = anbox::Logger::Severity::kWarning) override {
     if (initialized_) return;
@@ -64,7 +65,16 @@ struct BoostLogLogger : public anbox::Logger {
     severity_ = severity;
   }
 
+  bool IsEnabled(Severity severity) const override {
+    return severity >= severity_;
+  }
+
   void Log(Severity severity, const std::string& message, const boost::optional<Location>& loc) override {
+    LogAt(severity, message, loc, std::chrono::system_clock::now());
+  }
+
+  void LogAt(Severity severity, const std::string& message, const boost::optional<Location>& loc,
+             const std::chrono::system_clock::time_point& timestamp) override {
     if (!initialized_) Init();
 
     // FIXME somehow set_filter doesn't work with the trivial logger. If
@@ -74,10 +84,14 @@ struct BoostLogLogger : public anbox::Logger {
     if (severity < severity_)
       return;
 
+    const auto since_epoch = std::chrono::duration_cast<std::chrono::microseconds>(
+        timestamp.time_since_epoch());
+    const boost::posix_time::ptime epoch{boost::gregorian::date{1970, 1, 1}};
+
     if (auto rec = boost::log::trivial::logger::get().open_record()) {
       boost::log::record_ostream out{rec};
       out << boost::log::add_value(attrs::Severity, severity)
-          << boost::log::add_value(attrs::Timestamp, boost::posix_time::microsec_clock::universal_time())
+          << boost::log::add_value(attrs::Timestamp, epoch + boost::posix_time::microseconds(since_epoch.count()))
           << message;
 
       if (loc) {
@@ -92,7 +106,7 @@ struct BoostLogLogger : public anbox::Logger {
   }
 
  private:
-  Severity severity_;
+  std::atomic<Severity> severity_;
   bool initialized_;
 };
 
@@ -125,6 +139,12 @@ bool Logger::SetSeverityFromString(const std::string& severity) {
   return true;
 }
 
+void Logger::LogAt(Severity severity, const std::string& message,
+                   const boost::optional<Location>& location,
+                   const std::chrono::system_clock::time_point&) {
+  Log(severity, message, location);
+}
+
 void Logger::Trace(const std::string& message,
                    const boost::optional<Location>& location) {
   Log(Severity::kTrace, message, location);
@@ -185,4 +205,6 @@ Logger& Log() { return *MutableInstance(); }
 
 void SetLogger(const std::shared_ptr<Logger>& logger) { SetInstance(logger); }
 
+std::shared_ptr<Logger> GetLogger() { return MutableInstance(); }
+
 }  // namespace anbox
@@ -20,6 +20,7 @@
 
 #include <boost/optional.hpp>
 
+#include <chrono>
 #include <memory.h>
 #include <string>
 
@@ -52,9 +53,22 @@ class Logger : public DoNotCopyOrMove {
   bool SetSeverityFromString(const std::string &severity);
   virtual void SetSeverity(const Severity& severity) = 0;
 
+  // IsEnabled returns false when messages of severity are dropped anyway,
+  // which spares formatting them.
+  virtual bool IsEnabled(Severity) const { return true; }
+
   virtual void Log(Severity severity, const std::string& message,
                    const boost::optional<Location>& location) = 0;
 
+  // LogAt logs a message which was issued at timestamp, e.g. by a thread
+  // which handed it over to us. Ignores timestamp by default.
+  virtual void LogAt(Severity severity, const std::string& message,
+                     const boost::optional<Location>& location,
+                     const std::chrono::system_clock::time_point& timestamp);
+
+  // Flush returns once all messages logged so far were written.
+  virtual void Flush() {}
+
   virtual void Trace(
       const std::string& message,
       const boost::optional<Location>& location = boost::optional<Location>{});
@@ -77,36 +91,42 @@ class Logger : public DoNotCopyOrMove {
   template <typename... T>
   void Tracef(const boost::optional<Location>& location,
               const std::string& pattern, T&&... args) {
+    if (!IsEnabled(Severity::kTrace)) return;
     Trace(utils::string_format(pattern, std::forward<T>(args)...), location);
   }
 
   template <typename... T>
   void Debugf(const boost::optional<Location>& location,
               const std::string& pattern, T&&... args) {
+    if (!IsEnabled(Severity::kDebug)) return;
     Debug(utils::string_format(pattern, std::forward<T>(args)...), location);
   }
 
   template <typename... T>
   void Infof(const boost::optional<Location>& location,
              const std::string& pattern, T&&... args) {
+    if (!IsEnabled(Severity::kInfo)) return;
     Info(utils::string_format(pattern, std::forward<T>(args)...), location);
   }
 
   template <typename... T>
   void Warningf(const boost::optional<Location>& location,
                 const std::string& pattern, T&&... args) {
+    if (!IsEnabled(Severity::kWarning)) return;
     Warning(utils::string_format(pattern, std::forward<T>(args)...), location);
   }
 
   template <typename... T>
   void Errorf(const boost::optional<Location>& location,
               const std::string& pattern, T&&... args) {
+    if (!IsEnabled(Severity::kError)) return;
     Error(utils::string_format(pattern, std::forward<T>(args)...), location);
   }
 
   template <typename... T>
   void Fatalf(const boost::optional<Location>& location,
               const std::string& pattern, T&&... args) {
+    if (!IsEnabled(Severity::kFatal)) return;
     Fatal(utils::string_format(pattern, std::forward<T>(args)...), location);
   }
 
@@ -125,25 +145,51 @@ std::ostream& operator<<(std::ostream& out, const Logger::Location& location);
 Logger& Log();
 // SetLog installs the given logger as mcs-wide default logger.
 void SetLogger(const std::shared_ptr<Logger>& logger);
+// GetLogger returns the installed logger, e.g. to wrap it.
+std::shared_ptr<Logger> GetLogger();
 }
 
-#define TRACE(...)     \
-  anbox::Log().Tracef( \
-      anbox::Logger::Location{__FILE__, __FUNCTION__, __LINE__}, __VA_ARGS__)
-#define DEBUG(...)     \
-  anbox::Log().Debugf( \
-      anbox::Logger::Location{__FILE__, __FUNCTION__, __LINE__}, __VA_ARGS__)
-#define INFO(...)     \
-  anbox::Log().Infof( \
-      anbox::Logger::Location{__FILE__, __FUNCTION__, __LINE__}, __VA_ARGS__)
-#define WARNING(...)     \
-  anbox::Log().Warningf( \
-      anbox::Logger::Location{__FILE__, __FUNCTION__, __LINE__}, __VA_ARGS__)
-#define ERROR(...)     \
-  anbox::Log().Errorf( \
-      anbox::Logger::Location{__FILE__, __FUNCTION__, __LINE__}, __VA_ARGS__)
-#define FATAL(...)     \
-  anbox::Log().Fatalf( \
-      anbox::Logger::Location{__FILE__, __FUNCTION__, __LINE__}, __VA_ARGS__)
+// Messages below ANBOX_LOG_MIN_SEVERITY (0 = trace ... 5 = fatal) are
+// compiled out, including the evaluation of their arguments.
+#ifndef ANBOX_LOG_MIN_SEVERITY
+#define ANBOX_LOG_MIN_SEVERITY 0
+#endif
+
+#define TRACE(...)                                                         \
+  ((ANBOX_LOG_MIN_SEVERITY > 0)                                            \
+       ? static_cast<void>(0)                                              \
+       : anbox::Log().Tracef(                                              \
+             anbox::Logger::Location{__FILE__, __FUNCTION__, __LINE__},    \
+             __VA_ARGS__))
+#define DEBUG(...)                                                         \
+  ((ANBOX_LOG_MIN_SEVERITY > 1)                                            \
+       ? static_cast<void>(0)                                              \
+       : anbox::Log().Debugf(                                              \
+             anbox::Logger::Location{__FILE__, __FUNCTION__, __LINE__},    \
+             __VA_ARGS__))
+#define INFO(...)                                                          \
+  ((ANBOX_LOG_MIN_SEVERITY > 2)                                            \
+       ? static_cast<void>(0)                                              \
+       : anbox::Log().Infof(                                               \
+             anbox::Logger::Location{__FILE__, __FUNCTION__, __LINE__},    \
+             __VA_ARGS__))
+#define WARNING(...)                                                       \
+  ((ANBOX_LOG_MIN_SEVERITY > 3)                                            \
+       ? static_cast<void>(0)                                              \
+       : anbox::Log().Warningf(                                            \
+             anbox::Logger::Location{__FILE__, __FUNCTION__, __LINE__},    \
+             __VA_ARGS__))
+#define ERROR(...)                                                         \
+  ((ANBOX_LOG_MIN_SEVERITY > 4)                                            \
+       ? static_cast<void>(0)                                              \
+       : anbox::Log().Errorf(                                              \
+             anbox::Logger::Location{__FILE__, __FUNCTION__, __LINE__},    \
+             __VA_ARGS__))
+#define FATAL(...)                                                         \
+  ((ANBOX_LOG_MIN_SEVERITY > 5)                                            \
+       ? static_cast<void>(0)                                              \
+       : anbox::Log().Fatalf(                                              \
+             anbox::Logger::Location{__FILE__, __FUNCTION__, __LINE__},    \
+             __VA_ARGS__))
 
 #endif
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/network/adaptive_buffer_size.h"
+
+#include <algorithm>
+
+namespace {
+// Number of consecutive reads using less than a quarter of the buffer
+// before we shrink it. Keeps us from oscillating on bursty clients.
+constexpr const unsigned int small_reads_before_shrink{32};
+}
+
+namespace anbox {
+namespace network {
+AdaptiveBufferSize::Policy AdaptiveBufferSize::default_policy() {
+  return {8192, 4096, 64 * 1024};
+}
+
+AdaptiveBufferSize::AdaptiveBufferSize(const Policy &policy)
+    : policy_(policy),
+      current_(std::min(std::max(policy.initial_size, policy.min_size),
+                        policy.max_size)),
+      small_reads_(0) {}
+
+bool AdaptiveBufferSize::update(size_t bytes_read) {
+  if (bytes_read >= current_) {
+    small_reads_ = 0;
+    if (current_ >= policy_.max_size) return false;
+    current_ = std::min(current_ * 2, policy_.max_size);
+    return true;
+  }
+
+  if (bytes_read >= current_ / 4 || current_ <= policy_.min_size) {
+    small_reads_ = 0;
+    return false;
+  }
+
+  if (++small_reads_ < small_reads_before_shrink) return false;
+
+  small_reads_ = 0;
+  current_ = std::max(current_ / 2, policy_.min_size);
+  return true;
+}
+}  // namespace network
+}  // namespace anbox
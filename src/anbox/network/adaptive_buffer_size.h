@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_NETWORK_ADAPTIVE_BUFFER_SIZE_H_
+#define ANBOX_NETWORK_ADAPTIVE_BUFFER_SIZE_H_
+
+#include <cstddef>
+
+namespace anbox {
+namespace network {
+// Tracks the sizes of completed reads and suggests a receive buffer size
+// for the next one. The size doubles whenever a read fills the whole
+// buffer and halves again after a run of reads which used only a small
+// part of it.
+class AdaptiveBufferSize {
+ public:
+  struct Policy {
+    size_t initial_size;
+    size_t min_size;
+    size_t max_size;
+  };
+
+  static Policy default_policy();
+
+  explicit AdaptiveBufferSize(const Policy &policy = default_policy());
+
+  size_t current() const { return current_; }
+
+  // Accounts a read of |bytes_read| bytes into a buffer of current() size
+  // and returns true when current() has changed.
+  bool update(size_t bytes_read);
+
+ private:
+  Policy policy_;
+  size_t current_;
+  unsigned int small_reads_;
+};
+}  // namespace network
+}  // namespace anbox
+
+#endif
@@ -17,24 +17,21 @@
  */
 
 #include "anbox/network/base_socket_messenger.h"
-#include "anbox/common/variable_length_array.h"
 #include "anbox/logger.h"
 
 #include <boost/throw_exception.hpp>
 
 #include <errno.h>
+#include <limits.h>
+#include <poll.h>
 #include <string.h>
 
+#include <algorithm>
 #include <stdexcept>
 
 namespace bs = boost::system;
 namespace ba = boost::asio;
 
-namespace {
-/// Buffers need to be big enough to support messages
-unsigned int const serialization_buffer_size = 2048;
-}
-
 namespace anbox {
 namespace network {
 template <typename stream_protocol>
@@ -76,32 +73,85 @@ Credentials BaseSocketMessenger<stream_protocol>::creds() const {
 template <typename stream_protocol>
 ssize_t BaseSocketMessenger<stream_protocol>::send_raw(char const* data,
                                                        size_t length) {
-  VariableLengthArray<serialization_buffer_size> whole_message{length};
-  std::copy(data, data + length, whole_message.data());
-
   std::unique_lock<std::mutex> lg(message_lock);
   return ::send(socket_fd, data, length, MSG_NOSIGNAL);
 }
 
+template <typename stream_protocol>
+ssize_t BaseSocketMessenger<stream_protocol>::send_raw_vectored(
+    const struct iovec* iov, size_t count) {
+  struct msghdr msg;
+  ::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = const_cast<struct iovec*>(iov);
+  msg.msg_iovlen = std::min<size_t>(count, IOV_MAX);
+
+  std::unique_lock<std::mutex> lg(message_lock);
+  return ::sendmsg(socket_fd, &msg, MSG_NOSIGNAL);
+}
+
 template <typename stream_protocol>
 void BaseSocketMessenger<stream_protocol>::send(char const* data,
                                                 size_t length) {
-  VariableLengthArray<serialization_buffer_size> whole_message{length};
-  std::copy(data, data + length, whole_message.data());
-
-  for (;;) {
-    try {
-      std::unique_lock<std::mutex> lg(message_lock);
-      ba::write(*socket, ba::buffer(whole_message.data(), whole_message.size()),
-                boost::asio::transfer_all());
-    } catch (const boost::system::system_error& err) {
-      if (err.code() == boost::asio::error::try_again) continue;
-      throw;
+  struct iovec iov;
+  iov.iov_base = const_cast<char*>(data);
+  iov.iov_len = length;
+  send_vectored(&iov, 1);
+}
+
+template <typename stream_protocol>
+void BaseSocketMessenger<stream_protocol>::send_vectored(
+    const struct iovec* iov, size_t count) {
+  std::unique_lock<std::mutex> lg(message_lock);
+
+  // Offset into the first buffer when we had a partial write before
+  size_t offset = 0;
+  while (count > 0) {
+    struct iovec head;
+    struct msghdr msg;
+    ::memset(&msg, 0, sizeof(msg));
+    if (offset > 0) {
+      head.iov_base = static_cast<char*>(iov->iov_base) + offset;
+      head.iov_len = iov->iov_len - offset;
+      msg.msg_iov = &head;
+      msg.msg_iovlen = 1;
+    } else {
+      msg.msg_iov = const_cast<struct iovec*>(iov);
+      msg.msg_iovlen = std::min<size_t>(count, IOV_MAX);
+    }
+
+    const auto written = ::sendmsg(socket_fd, &msg, MSG_NOSIGNAL);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        struct pollfd pfd{socket_fd, POLLOUT, 0};
+        ::poll(&pfd, 1, -1);
+        continue;
+      }
+      BOOST_THROW_EXCEPTION(bs::system_error(errno, bs::system_category(),
+                                             "Failed to send message"));
     }
-    break;
+
+    auto bytes_left = static_cast<size_t>(written);
+    while (count > 0 && bytes_left >= iov->iov_len - offset) {
+      bytes_left -= iov->iov_len - offset;
+      offset = 0;
+      iov++;
+      count--;
+    }
+    offset += bytes_left;
   }
 }
 
+template <typename stream_protocol>
+bool BaseSocketMessenger<stream_protocol>::wait_writable(
+    const std::chrono::milliseconds& timeout) {
+  // Not holding |message_lock| so other senders can go on meanwhile.
+  struct pollfd pfd{socket_fd, POLLOUT, 0};
+  const auto ret = ::poll(&pfd, 1, static_cast<int>(timeout.count()));
+  // Errors and hangups are reported by the next send.
+  return ret != 0;
+}
+
 template <typename stream_protocol>
 void BaseSocketMessenger<stream_protocol>::async_receive_msg(
     AnboxReadHandler const& handler, ba::mutable_buffers_1 const& buffer) {
@@ -40,6 +40,9 @@ class BaseSocketMessenger : public SocketMessenger {
 
   void send(char const* data, size_t length) override;
   ssize_t send_raw(char const* data, size_t length) override;
+  ssize_t send_raw_vectored(const struct iovec* iov, size_t count) override;
+  void send_vectored(const struct iovec* iov, size_t count) override;
+  bool wait_writable(const std::chrono::milliseconds& timeout) override;
   void async_receive_msg(AnboxReadHandler const& handle,
                          boost::asio::mutable_buffers_1 const& buffer) override;
   boost::system::error_code receive_msg(
@@ -19,48 +19,102 @@
 #ifndef ANBOX_NETWORK_CONNECTIONS_H_
 #define ANBOX_NETWORK_CONNECTIONS_H_
 
-#include <map>
 #include <memory>
 #include <mutex>
+#include <unordered_map>
+#include <vector>
 
 namespace anbox {
 namespace network {
+// Keeps track of all connections of a server.
+//
+// Readers get an immutable snapshot of all connections without taking any
+// lock, so fanning out a message to every connection never waits for
+// connections coming or going. Changes copy the list under a lock and
+// publish the copy. Finding a connection by its id is a hash lookup and
+// removing one moves the last connection into its place, so besides the
+// copy, which is cheap for the handful of connections we ever have,
+// changes take constant time.
 template <class Connection>
 class Connections {
  public:
-  Connections() {}
+  typedef std::vector<std::shared_ptr<Connection>> List;
+  typedef std::shared_ptr<const List> Snapshot;
+
+  Connections() : connections(std::make_shared<const List>()) {}
   ~Connections() { clear(); }
 
+  // Adding a connection whose id is already known does nothing.
   void add(std::shared_ptr<Connection> const& connection) {
     std::unique_lock<std::mutex> lock(mutex);
-    connections.insert({connection->id(), connection});
+    if (positions.find(connection->id()) != positions.end())
+      return;
+
+    auto next = std::make_shared<List>(*connections);
+    positions.insert({connection->id(), next->size()});
+    next->push_back(connection);
+    publish(next, lock);
   }
 
   void remove(int id) {
     std::unique_lock<std::mutex> lock(mutex);
-    connections.erase(id);
+    auto position = positions.find(id);
+    if (position == positions.end())
+      return;
+
+    auto next = std::make_shared<List>(*connections);
+    const auto n = position->second;
+    positions.erase(position);
+    if (n + 1 < next->size()) {
+      (*next)[n] = std::move(next->back());
+      positions[(*next)[n]->id()] = n;
+    }
+    next->pop_back();
+    publish(next, lock);
   }
 
   bool includes(int id) const {
     std::unique_lock<std::mutex> lock(mutex);
-    return connections.find(id) != connections.end();
+    return positions.find(id) != positions.end();
   }
 
   void clear() {
     std::unique_lock<std::mutex> lock(mutex);
-    connections.clear();
+    positions.clear();
+    publish(std::make_shared<List>(), lock);
   }
 
-  size_t size() { return connections.size(); }
+  // Returns all connections at the time of the call in no particular
+  // order. Connections removed afterwards stay alive as long as the
+  // snapshot is around.
+  Snapshot snapshot() const { return std::atomic_load(&connections); }
 
-  std::shared_ptr<Connection> at(size_t n) { return connections.at(n); }
+  size_t size() const { return snapshot()->size(); }
+
+  // Sends |data| to all current connections and returns how many it went
+  // to.
+  size_t broadcast(char const* data, size_t length) const {
+    const auto receivers = snapshot();
+    for (const auto& connection : *receivers)
+      connection->send(data, length);
+    return receivers->size();
+  }
 
  private:
   Connections(Connections const&) = delete;
   Connections& operator=(Connections const&) = delete;
 
-  std::mutex mutex;
-  std::map<int, std::shared_ptr<Connection>> connections;
+  void publish(const std::shared_ptr<List>& next, std::unique_lock<std::mutex>& lock) {
+    auto previous = std::atomic_exchange(&connections, Snapshot{next});
+    // The last reference to a removed connection may go with the previous
+    // list and destroying it must not happen with our lock held.
+    lock.unlock();
+    previous.reset();
+  }
+
+  mutable std::mutex mutex;
+  std::unordered_map<int, size_t> positions;
+  Snapshot connections;
 };
 }  // namespace anbox
 }  // namespace network
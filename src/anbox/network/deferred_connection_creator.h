@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_NETWORK_DEFERRED_CONNECTION_CREATOR_H_
+#define ANBOX_NETWORK_DEFERRED_CONNECTION_CREATOR_H_
+
+#include <boost/asio.hpp>
+#include "anbox/network/connection_creator.h"
+
+#include <mutex>
+#include <vector>
+
+namespace anbox {
+namespace network {
+// Holds back connections accepted before the creator serving them is
+// available, e.g. while the renderer is still being initialized, and hands
+// them over once it is set.
+template <typename stream_protocol>
+class DeferredConnectionCreator : public ConnectionCreator<stream_protocol> {
+ public:
+  typedef boost::asio::basic_stream_socket<stream_protocol> Socket;
+
+  void set_creator(const std::shared_ptr<ConnectionCreator<stream_protocol>> &creator) {
+    std::vector<std::shared_ptr<Socket>> pending;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      creator_ = creator;
+      pending.swap(pending_);
+    }
+    for (const auto &socket : pending)
+      creator->create_connection_for(socket);
+  }
+
+  void create_connection_for(std::shared_ptr<Socket> const& socket) override {
+    std::shared_ptr<ConnectionCreator<stream_protocol>> creator;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!creator_) {
+        pending_.push_back(socket);
+        return;
+      }
+      creator = creator_;
+    }
+    creator->create_connection_for(socket);
+  }
+
+ private:
+  std::mutex mutex_;
+  std::shared_ptr<ConnectionCreator<stream_protocol>> creator_;
+  std::vector<std::shared_ptr<Socket>> pending_;
+};
+}  // namespace network
+}  // namespace anbox
+
+#endif
@@ -25,11 +25,14 @@ DelegateMessageProcessor::DelegateMessageProcessor(
 
 DelegateMessageProcessor::~DelegateMessageProcessor() {}
 
-bool DelegateMessageProcessor::process_data(
-    const std::vector<std::uint8_t> &data) {
+bool DelegateMessageProcessor::process_data(const std::uint8_t *data,
+                                            size_t size) {
   if (!process_data_) return false;
 
-  return process_data_(data);
+  // The delegate takes an owned vector so we keep one around and refill
+  // it to avoid allocating a new one for every chunk of data.
+  buffer_.assign(data, data + size);
+  return process_data_(buffer_);
 }
 }  // namespace network
 }  // namespace anbox
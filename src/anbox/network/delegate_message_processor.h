@@ -30,10 +30,11 @@ class DelegateMessageProcessor : public MessageProcessor {
       std::function<bool(const std::vector<std::uint8_t> &)> process_data);
   ~DelegateMessageProcessor();
 
-  bool process_data(const std::vector<std::uint8_t> &data) override;
+  bool process_data(const std::uint8_t *data, size_t size) override;
 
  private:
   std::function<bool(const std::vector<std::uint8_t> &)> process_data_;
+  std::vector<std::uint8_t> buffer_;
 };
 }  // namespace network
 }  // namespace anbox
@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/network/fd_channel.h"
+#include "anbox/common/variable_length_array.h"
+#include "anbox/network/fd_socket_transmission.h"
+
+#include <boost/throw_exception.hpp>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+
+namespace {
+enum class MessageType : std::uint32_t {
+  batch = 1,
+  release = 2,
+};
+
+struct Header {
+  std::uint32_t type;
+  // Ids following the header, one per descriptor of a batch or the ones
+  // released.
+  std::uint32_t ids;
+  // Descriptors attached to the message, the ones passed the first time.
+  std::uint32_t new_fds;
+  std::uint32_t payload_size;
+};
+
+// Set for the ids of descriptors passed the first time, they are attached
+// in the order of their ids.
+constexpr std::uint32_t new_fd_flag{1u << 31};
+
+// Payloads describe the descriptors, they are never bulk data.
+constexpr std::uint32_t max_payload_size{64 * 1024};
+
+std::pair<dev_t, ino_t> inode_of(const anbox::Fd &fd) {
+  struct stat st;
+  if (::fstat(fd, &st) < 0)
+    BOOST_THROW_EXCEPTION(std::runtime_error("Failed to stat fd: " + std::string(std::strerror(errno))));
+  return {st.st_dev, st.st_ino};
+}
+
+void send_message(const anbox::Fd &socket, const Header &header,
+                  const std::vector<std::uint32_t> &ids, const std::string &payload,
+                  const std::vector<int> &fds) {
+  struct iovec iov[3];
+  iov[0].iov_base = const_cast<Header*>(&header);
+  iov[0].iov_len = sizeof(header);
+  iov[1].iov_base = const_cast<std::uint32_t*>(ids.data());
+  iov[1].iov_len = ids.size() * sizeof(std::uint32_t);
+  iov[2].iov_base = const_cast<char*>(payload.data());
+  iov[2].iov_len = payload.size();
+
+  static auto const builtin_n_fds = 5;
+  static auto const builtin_cmsg_space = CMSG_SPACE(builtin_n_fds * sizeof(int));
+  auto const fds_bytes = fds.size() * sizeof(int);
+  anbox::VariableLengthArray<builtin_cmsg_space> control{fds.empty() ? 0 : CMSG_SPACE(fds_bytes)};
+  memset(control.data(), 0, control.size());
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = 3;
+  if (!fds.empty()) {
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_len = CMSG_LEN(fds_bytes);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    memcpy(CMSG_DATA(cmsg), fds.data(), fds_bytes);
+  }
+
+  // The descriptors go with the first chunk, whatever a signal cut off is
+  // sent on its own.
+  while (true) {
+    const auto sent = ::sendmsg(socket, &msg, MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (anbox::socket_error_is_transient(errno))
+        continue;
+      BOOST_THROW_EXCEPTION(std::runtime_error("Failed to send fds: " + std::string(std::strerror(errno))));
+    }
+
+    msg.msg_control = nullptr;
+    msg.msg_controllen = 0;
+
+    auto left = static_cast<std::size_t>(sent);
+    while (msg.msg_iovlen > 0 && left >= msg.msg_iov[0].iov_len) {
+      left -= msg.msg_iov[0].iov_len;
+      msg.msg_iov++;
+      msg.msg_iovlen--;
+    }
+    if (msg.msg_iovlen == 0)
+      return;
+    msg.msg_iov[0].iov_base = static_cast<std::uint8_t*>(msg.msg_iov[0].iov_base) + left;
+    msg.msg_iov[0].iov_len -= left;
+  }
+}
+}  // namespace
+
+namespace anbox {
+namespace network {
+constexpr std::size_t FdChannel::max_fds_per_batch;
+
+FdChannel::FdChannel(const Fd &socket) : socket_(socket), next_id_(0) {}
+
+void FdChannel::send(const std::string &payload, const std::vector<Fd> &fds) {
+  if (fds.size() > max_fds_per_batch)
+    BOOST_THROW_EXCEPTION(std::length_error("Too many fds for a single batch"));
+  if (payload.size() > max_payload_size)
+    BOOST_THROW_EXCEPTION(std::length_error("Payload too large"));
+
+  std::vector<std::uint32_t> ids;
+  std::vector<int> new_fds;
+  // Only kept once the batch went out.
+  std::map<Inode, SentFd> added;
+  for (const auto &fd : fds) {
+    const auto inode = inode_of(fd);
+    auto sent = sent_.find(inode);
+    if (sent == sent_.end()) {
+      sent = added.find(inode);
+      if (sent == added.end()) {
+        sent = added.insert({inode, SentFd{next_id_++ & ~new_fd_flag, fd}}).first;
+        ids.push_back(sent->second.id | new_fd_flag);
+        new_fds.push_back(fd);
+        continue;
+      }
+    }
+    ids.push_back(sent->second.id);
+  }
+
+  const Header header{static_cast<std::uint32_t>(MessageType::batch),
+                      static_cast<std::uint32_t>(ids.size()),
+                      static_cast<std::uint32_t>(new_fds.size()),
+                      static_cast<std::uint32_t>(payload.size())};
+  send_message(socket_, header, ids, payload, new_fds);
+
+  sent_.insert(added.begin(), added.end());
+}
+
+void FdChannel::release(const Fd &fd) {
+  const auto sent = sent_.find(inode_of(fd));
+  if (sent == sent_.end())
+    return;
+
+  const Header header{static_cast<std::uint32_t>(MessageType::release), 1, 0, 0};
+  send_message(socket_, header, {sent->second.id}, std::string{}, {});
+  sent_.erase(sent);
+}
+
+void FdChannel::receive(std::string &payload, std::vector<Fd> &fds) {
+  while (true) {
+    Header header;
+
+    // Descriptors are attached to the first byte of a message, so there
+    // has to be room for as many as a batch can have when reading its
+    // header.
+    struct iovec iov;
+    iov.iov_base = &header;
+    iov.iov_len = sizeof(header);
+
+    static auto const max_cmsg_space = CMSG_SPACE(max_fds_per_batch * sizeof(int));
+    VariableLengthArray<max_cmsg_space> control{max_cmsg_space};
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+
+    ssize_t result = 0;
+    do {
+      result = ::recvmsg(socket_, &msg, MSG_WAITALL | MSG_CMSG_CLOEXEC);
+    } while (result < 0 && socket_error_is_transient(errno));
+    if (result == 0)
+      BOOST_THROW_EXCEPTION(socket_disconnected_error("Peer closed the fd channel"));
+    if (result < 0)
+      BOOST_THROW_EXCEPTION(socket_error("Failed to receive from fd channel"));
+
+    // Owned right away so they get closed whatever goes wrong.
+    std::vector<Fd> attached;
+    for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+        continue;
+      const auto count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      const auto data = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
+      for (std::size_t n = 0; n < count; n++)
+        attached.push_back(Fd{IntOwnedFd{data[n]}});
+    }
+
+    if (msg.msg_flags & MSG_CTRUNC)
+      BOOST_THROW_EXCEPTION(fd_reception_error("Received more fds than a batch can have"));
+    if (static_cast<std::size_t>(result) < sizeof(header))
+      receive_exactly(reinterpret_cast<std::uint8_t*>(&header) + result, sizeof(header) - result);
+
+    if (header.ids > max_fds_per_batch || header.new_fds != attached.size() ||
+        header.payload_size > max_payload_size)
+      BOOST_THROW_EXCEPTION(fd_reception_error("Invalid fd channel message"));
+
+    std::vector<std::uint32_t> ids(header.ids);
+    receive_exactly(ids.data(), ids.size() * sizeof(std::uint32_t));
+    std::string data(header.payload_size, '\0');
+    receive_exactly(&data[0], data.size());
+
+    if (header.type == static_cast<std::uint32_t>(MessageType::release)) {
+      for (const auto id : ids)
+        received_.erase(id);
+      continue;
+    }
+    if (header.type != static_cast<std::uint32_t>(MessageType::batch))
+      BOOST_THROW_EXCEPTION(fd_reception_error("Unknown fd channel message"));
+
+    std::vector<Fd> batch;
+    std::size_t next_new_fd = 0;
+    for (const auto id : ids) {
+      if (id & new_fd_flag) {
+        if (next_new_fd == attached.size())
+          BOOST_THROW_EXCEPTION(fd_reception_error("Batch refers to more new fds than it has"));
+        received_[id & ~new_fd_flag] = attached[next_new_fd++];
+      }
+      const auto fd = received_.find(id & ~new_fd_flag);
+      if (fd == received_.end())
+        BOOST_THROW_EXCEPTION(fd_reception_error("Batch refers to an unknown fd"));
+      batch.push_back(fd->second);
+    }
+
+    fds.swap(batch);
+    payload.swap(data);
+    return;
+  }
+}
+
+void FdChannel::receive_exactly(void *data, std::size_t size) {
+  std::size_t received = 0;
+  while (received < size) {
+    const auto result = ::recv(socket_, static_cast<std::uint8_t*>(data) + received,
+                               size - received, MSG_WAITALL);
+    if (result == 0)
+      BOOST_THROW_EXCEPTION(socket_disconnected_error("Peer closed the fd channel"));
+    if (result < 0) {
+      if (socket_error_is_transient(errno))
+        continue;
+      BOOST_THROW_EXCEPTION(socket_error("Failed to receive from fd channel"));
+    }
+    received += result;
+  }
+}
+}  // namespace network
+}  // namespace anbox
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_NETWORK_FD_CHANNEL_H_
+#define ANBOX_NETWORK_FD_CHANNEL_H_
+
+#include "anbox/common/fd.h"
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace anbox {
+namespace network {
+// Passes batches of file descriptors together with a payload describing
+// them over a blocking local stream socket, one message per batch.
+//
+// A descriptor only crosses the socket the first time it is sent. Both
+// ends keep it under an id from then on and later batches only refer to
+// that id. Descriptors are taken to be the same when they refer to the
+// same inode, as they do for shared memory passed around again and again.
+// The sender keeps every descriptor it passed open, so its inode can't be
+// reused for another one, until it releases it. The receiver closes its
+// copy then, apart from the ones handed out already.
+class FdChannel {
+ public:
+  // Descriptors passed in a single batch at most.
+  static constexpr std::size_t max_fds_per_batch{253};
+
+  explicit FdChannel(const Fd &socket);
+
+  // Throws if the batch couldn't be sent.
+  void send(const std::string &payload, const std::vector<Fd> &fds);
+
+  // Lets both ends close |fd|. A later batch with it passes it again.
+  void release(const Fd &fd);
+
+  // Blocks until the next batch arrives and throws if the socket got
+  // closed or the peer sent garbage.
+  void receive(std::string &payload, std::vector<Fd> &fds);
+
+  // Number of descriptors this end keeps open for the peer or got from it.
+  std::size_t sent_fds() const { return sent_.size(); }
+  std::size_t received_fds() const { return received_.size(); }
+
+ private:
+  typedef std::pair<dev_t, ino_t> Inode;
+
+  struct SentFd {
+    std::uint32_t id;
+    Fd fd;
+  };
+
+  void receive_exactly(void *data, std::size_t size);
+
+  Fd socket_;
+  std::uint32_t next_id_;
+  std::map<Inode, SentFd> sent_;
+  std::map<std::uint32_t, Fd> received_;
+};
+}  // namespace network
+}  // namespace anbox
+
+#endif
@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "anbox/network/handshake.h"
+
+#include <cstring>
+
+#include <errno.h>
+#include <sys/socket.h>
+
+namespace {
+constexpr std::size_t max_fds{4};
+
+// Returns the bytes read, 0 if nothing is available right now and -1 with
+// |err| set on failure. File descriptors are only collected into |fds| if
+// it is set.
+ssize_t receive(int socket, char *buffer, std::size_t size, int flags,
+                std::vector<anbox::Fd> *fds, boost::system::error_code &err) {
+  struct iovec iov;
+  iov.iov_base = buffer;
+  iov.iov_len = size;
+
+  char control[CMSG_SPACE(max_fds * sizeof(int))];
+  struct msghdr header;
+  std::memset(&header, 0, sizeof(header));
+  header.msg_iov = &iov;
+  header.msg_iovlen = 1;
+  if (fds) {
+    header.msg_control = control;
+    header.msg_controllen = sizeof(control);
+  }
+
+  ssize_t result = 0;
+  do {
+    result = ::recvmsg(socket, &header, flags | MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+  } while (result < 0 && errno == EINTR);
+
+  if (result < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK)
+      return 0;
+    err = boost::system::error_code(errno, boost::system::system_category());
+    return -1;
+  }
+  if (result == 0) {
+    err = boost::asio::error::eof;
+    return -1;
+  }
+
+  if (fds) {
+    for (auto cmsg = CMSG_FIRSTHDR(&header); cmsg; cmsg = CMSG_NXTHDR(&header, cmsg)) {
+      if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+        continue;
+      const auto count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      for (std::size_t n = 0; n < count; n++) {
+        int fd = -1;
+        std::memcpy(&fd, CMSG_DATA(cmsg) + n * sizeof(int), sizeof(int));
+        fds->push_back(anbox::Fd{fd});
+      }
+    }
+  }
+  return result;
+}
+}  // namespace
+
+namespace anbox {
+namespace network {
+const boost::posix_time::time_duration Handshake::default_timeout{boost::posix_time::seconds(10)};
+
+void Handshake::read(boost::asio::io_service &service, const std::shared_ptr<Socket> &socket,
+                     std::size_t size, const Handler &handler,
+                     const boost::posix_time::time_duration &timeout) {
+  std::shared_ptr<Handshake> handshake(new Handshake(service, socket, size, false, 0, handler));
+  handshake->start(timeout);
+}
+
+void Handshake::read_until(boost::asio::io_service &service,
+                           const std::shared_ptr<Socket> &socket, char terminator,
+                           std::size_t max_size, const Handler &handler,
+                           const boost::posix_time::time_duration &timeout) {
+  std::shared_ptr<Handshake> handshake(new Handshake(service, socket, max_size, true, terminator, handler));
+  handshake->start(timeout);
+}
+
+Handshake::Handshake(boost::asio::io_service &service, const std::shared_ptr<Socket> &socket,
+                     std::size_t size, bool terminated, char terminator,
+                     const Handler &handler)
+    : socket_(socket),
+      timer_(service),
+      size_(size),
+      terminated_(terminated),
+      terminator_(terminator),
+      handler_(handler),
+      done_(false) {}
+
+void Handshake::start(const boost::posix_time::time_duration &timeout) {
+  auto self = shared_from_this();
+
+  std::unique_lock<std::mutex> l(lock_);
+  if (!terminated_ && size_ == 0) {
+    finish(l, boost::system::error_code{});
+    return;
+  }
+
+  timer_.expires_from_now(timeout);
+  timer_.async_wait([self](const boost::system::error_code &err) {
+    if (err == boost::asio::error::operation_aborted)
+      return;
+    std::unique_lock<std::mutex> l(self->lock_);
+    self->finish(l, boost::asio::error::timed_out);
+  });
+
+  wait_readable();
+}
+
+void Handshake::wait_readable() {
+  auto self = shared_from_this();
+  socket_->async_read_some(boost::asio::null_buffers(),
+                           [self](const boost::system::error_code &err, std::size_t) {
+                             if (!err) {
+                               self->read_available();
+                               return;
+                             }
+                             std::unique_lock<std::mutex> l(self->lock_);
+                             self->finish(l, err);
+                           });
+}
+
+void Handshake::read_available() {
+  std::unique_lock<std::mutex> l(lock_);
+  if (done_)
+    return;
+
+  const auto socket = socket_->native_handle();
+  boost::system::error_code err;
+  char buffer[256];
+  // A terminated handshake may be |size_| bytes long plus its terminator.
+  auto wanted = static_cast<ssize_t>(
+      std::min(sizeof(buffer), size_ - data_.size() + (terminated_ ? 1 : 0)));
+
+  bool terminated = false;
+  if (terminated_) {
+    // Look ahead so that we don't consume past the terminator.
+    wanted = receive(socket, buffer, wanted, MSG_PEEK, nullptr, err);
+    if (wanted > 0) {
+      const auto end = static_cast<const char *>(std::memchr(buffer, terminator_, wanted));
+      if (end) {
+        wanted = end - buffer + 1;
+        terminated = true;
+      }
+    }
+  }
+
+  const auto received = wanted > 0 ? receive(socket, buffer, wanted, 0, &fds_, err) : wanted;
+  if (received < 0) {
+    finish(l, err);
+    return;
+  }
+  data_.append(buffer, received);
+
+  if (terminated_ && terminated && received == wanted) {
+    data_.pop_back();
+    finish(l, boost::system::error_code{});
+  } else if (terminated_ && data_.size() > size_) {
+    finish(l, boost::asio::error::message_size);
+  } else if (!terminated_ && data_.size() == size_) {
+    finish(l, boost::system::error_code{});
+  } else {
+    wait_readable();
+  }
+}
+
+void Handshake::finish(std::unique_lock<std::mutex> &l, const boost::system::error_code &err) {
+  if (done_)
+    return;
+  done_ = true;
+
+  boost::system::error_code ignored;
+  timer_.cancel(ignored);
+  if (err)
+    socket_->cancel(ignored);
+
+  const auto handler = std::move(handler_);
+  l.unlock();
+  handler(err, data_, fds_);
+}
+}  // namespace network
+}  // namespace anbox
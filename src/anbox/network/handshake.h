@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef ANBOX_NETWORK_HANDSHAKE_H_
+#define ANBOX_NETWORK_HANDSHAKE_H_
+
+#include "anbox/common/fd.h"
+
+#include <boost/asio.hpp>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace anbox {
+namespace network {
+// Reads what a client has to send before its connection can be set up,
+// without blocking a thread of the runtime. The socket is only read from
+// when it became readable, so a slow or stuck client never holds a
+// thread, and the handshake fails once it didn't complete in time.
+//
+// Only the handshake itself is consumed; whatever the client sends right
+// after it stays in the socket for its connection.
+class Handshake : public std::enable_shared_from_this<Handshake> {
+ public:
+  typedef boost::asio::local::stream_protocol::socket Socket;
+  // Called once with the data read and the file descriptors which came
+  // with it. Fails with boost::asio::error::timed_out if the client took
+  // too long, eof if it went away and message_size if a terminated
+  // handshake got too long.
+  typedef std::function<void(const boost::system::error_code &err, const std::string &data,
+                             const std::vector<Fd> &fds)> Handler;
+
+  static const boost::posix_time::time_duration default_timeout;
+
+  // Reads exactly |size| bytes. The timeout runs on |service|.
+  static void read(boost::asio::io_service &service, const std::shared_ptr<Socket> &socket,
+                   std::size_t size, const Handler &handler,
+                   const boost::posix_time::time_duration &timeout = default_timeout);
+
+  // Reads up to and including |terminator| which isn't part of the data
+  // passed to |handler|.
+  static void read_until(boost::asio::io_service &service, const std::shared_ptr<Socket> &socket,
+                         char terminator, std::size_t max_size, const Handler &handler,
+                         const boost::posix_time::time_duration &timeout = default_timeout);
+
+ private:
+  Handshake(boost::asio::io_service &service, const std::shared_ptr<Socket> &socket,
+            std::size_t size, bool terminated, char terminator, const Handler &handler);
+
+  void start(const boost::posix_time::time_duration &timeout);
+  // Both expect |lock_| to be held.
+  void wait_readable();
+  void finish(std::unique_lock<std::mutex> &l, const boost::system::error_code &err);
+  void read_available();
+
+  std::shared_ptr<Socket> socket_;
+  boost::asio::deadline_timer timer_;
+  const std::size_t size_;
+  const bool terminated_;
+  const char terminator_;
+  Handler handler_;
+
+  std::mutex lock_;
+  bool done_;
+  std::string data_;
+  std::vector<Fd> fds_;
+};
+}  // namespace network
+}  // namespace anbox
+
+#endif
@@ -18,6 +18,7 @@
 #ifndef ANBOX_NETWORK_MESSAGE_PROCESSOR_H
 #define ANBOX_NETWORK_MESSAGE_PROCESSOR_H
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
@@ -26,7 +27,14 @@ namespace network {
 class MessageProcessor {
  public:
   virtual ~MessageProcessor() {}
-  virtual bool process_data(const std::vector<std::uint8_t> &data) = 0;
+  // Processes |size| bytes starting at |data|. The memory is owned by the
+  // caller and only valid for the duration of the call so processors which
+  // need to keep the data around have to copy it.
+  virtual bool process_data(const std::uint8_t *data, size_t size) = 0;
+
+  bool process_data(const std::vector<std::uint8_t> &data) {
+    return process_data(data.data(), data.size());
+  }
 };
 }  // namespace network
 }  // namespace anbox
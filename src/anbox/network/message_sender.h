@@ -20,6 +20,9 @@
 #define ANBOX_NETWORK_MESSAGE_SENDER_H_
 
 #include <sys/types.h>
+#include <sys/uio.h>
+
+#include <chrono>
 #include <cstddef>
 
 namespace anbox {
@@ -29,6 +32,39 @@ class MessageSender {
   virtual void send(char const* data, size_t length) = 0;
   virtual ssize_t send_raw(char const* data, size_t length) = 0;
 
+  // Scatter-gather variant of send_raw(). Writes as much as possible of
+  // the |count| buffers in |iov| in order and returns the number of bytes
+  // written or a negative value on error. Implementations should submit
+  // all buffers with a single system call; the default falls back to one
+  // send_raw() per buffer.
+  virtual ssize_t send_raw_vectored(const struct iovec* iov, size_t count) {
+    ssize_t total = 0;
+    for (size_t n = 0; n < count; n++) {
+      const auto written = send_raw(static_cast<char const*>(iov[n].iov_base), iov[n].iov_len);
+      if (written < 0) return total > 0 ? total : written;
+      total += written;
+      if (static_cast<size_t>(written) < iov[n].iov_len) break;
+    }
+    return total;
+  }
+
+  // Blocks until a send_raw() has a chance to write something again
+  // after it failed with EAGAIN, or |timeout| passed. Returns false on
+  // timeout. Senders which can't wait return right away and leave it to
+  // the caller to retry.
+  virtual bool wait_writable(const std::chrono::milliseconds& timeout) {
+    (void)timeout;
+    return true;
+  }
+
+  // Sends all |count| buffers in |iov| back to back without staging them
+  // in an intermediate buffer. Blocks until everything is written like
+  // send() does.
+  virtual void send_vectored(const struct iovec* iov, size_t count) {
+    for (size_t n = 0; n < count; n++)
+      send(static_cast<char const*>(iov[n].iov_base), iov[n].iov_len);
+  }
+
  protected:
   MessageSender() = default;
   virtual ~MessageSender() = default;
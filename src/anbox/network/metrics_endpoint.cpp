@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/network/metrics_endpoint.h"
+
+#include <boost/asio/write.hpp>
+
+#include <array>
+#include <sstream>
+
+namespace {
+typedef boost::asio::local::stream_protocol::socket Socket;
+
+// Reads until the client goes away, which only then releases the socket.
+void drain(const std::shared_ptr<Socket> &socket) {
+  auto buffer = std::make_shared<std::array<char, 1024>>();
+  socket->async_read_some(boost::asio::buffer(*buffer),
+                          [socket, buffer](const boost::system::error_code &err, std::size_t) {
+                            if (!err)
+                              drain(socket);
+                          });
+}
+}  // namespace
+
+namespace anbox {
+namespace network {
+MetricsEndpoint::MetricsEndpoint(const std::shared_ptr<common::Metrics> &metrics)
+    : metrics_(metrics) {}
+
+void MetricsEndpoint::create_connection_for(std::shared_ptr<Socket> const &socket) {
+  std::stringstream body;
+  metrics_->write_prometheus(body);
+  const auto text = body.str();
+
+  auto response = std::make_shared<std::string>(
+      "HTTP/1.0 200 OK\r\n"
+      "Content-Type: text/plain; version=0.0.4\r\n"
+      "Content-Length: " + std::to_string(text.size()) + "\r\n"
+      "Connection: close\r\n"
+      "\r\n" + text);
+
+  boost::asio::async_write(*socket, boost::asio::buffer(*response),
+                           [socket, response](const boost::system::error_code &err, std::size_t) {
+                             if (err)
+                               return;
+                             boost::system::error_code ignored;
+                             socket->shutdown(Socket::shutdown_send, ignored);
+                             drain(socket);
+                           });
+}
+}  // namespace network
+}  // namespace anbox
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_NETWORK_METRICS_ENDPOINT_H_
+#define ANBOX_NETWORK_METRICS_ENDPOINT_H_
+
+#include "anbox/common/metrics.h"
+#include "anbox/network/connection_creator.h"
+
+#include <boost/asio/local/stream_protocol.hpp>
+
+namespace anbox {
+namespace network {
+// Answers every client with all metrics in the Prometheus text format
+// wrapped into a minimal HTTP response, so both scrapers and tools like
+// `curl --unix-socket <path> http://localhost/metrics` can read it. What
+// the client sends is never looked at.
+class MetricsEndpoint : public ConnectionCreator<boost::asio::local::stream_protocol> {
+ public:
+  explicit MetricsEndpoint(const std::shared_ptr<common::Metrics> &metrics);
+
+  void create_connection_for(
+      std::shared_ptr<boost::asio::local::stream_protocol::socket> const &socket) override;
+
+ private:
+  std::shared_ptr<common::Metrics> metrics_;
+};
+}  // namespace network
+}  // namespace anbox
+
+#endif
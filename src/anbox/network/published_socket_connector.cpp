@@ -20,23 +20,44 @@
 #include "anbox/network/socket_helper.h"
 #include "anbox/logger.h"
 
+#include <unistd.h>
+
 namespace anbox {
 namespace network {
 PublishedSocketConnector::PublishedSocketConnector(
     const std::string& socket_file, const std::shared_ptr<Runtime>& rt,
     const std::shared_ptr<ConnectionCreator<
-        boost::asio::local::stream_protocol>>& connection_creator)
+        boost::asio::local::stream_protocol>>& connection_creator,
+    Runtime::Subsystem subsystem)
     : socket_file_(remove_socket_if_stale(socket_file)),
       runtime_(rt),
+      subsystem_(subsystem),
       connection_creator_(connection_creator),
       acceptor_(rt->service(), socket_file_) {
   start_accept();
 }
 
+PublishedSocketConnector::PublishedSocketConnector(
+    const Fd& socket, const std::string& socket_file, const std::shared_ptr<Runtime>& rt,
+    const std::shared_ptr<ConnectionCreator<
+        boost::asio::local::stream_protocol>>& connection_creator,
+    Runtime::Subsystem subsystem)
+    : socket_file_(socket_file),
+      runtime_(rt),
+      subsystem_(subsystem),
+      connection_creator_(connection_creator),
+      acceptor_(rt->service(), boost::asio::local::stream_protocol(), ::dup(socket)) {
+  start_accept();
+}
+
 PublishedSocketConnector::~PublishedSocketConnector() {}
 
+Fd PublishedSocketConnector::socket() {
+  return Fd{::dup(acceptor_.native_handle())};
+}
+
 void PublishedSocketConnector::start_accept() {
-  auto socket = std::make_shared<boost::asio::local::stream_protocol::socket>(runtime_->service());
+  auto socket = std::make_shared<boost::asio::local::stream_protocol::socket>(runtime_->service(subsystem_));
 
   acceptor_.async_accept(*socket,
                          [this, socket](boost::system::error_code const& err) {
@@ -20,6 +20,7 @@
 
 #include <boost/asio/local/stream_protocol.hpp>
 
+#include "anbox/common/fd.h"
 #include "anbox/do_not_copy_or_move.h"
 #include "anbox/runtime.h"
 
@@ -28,15 +29,27 @@
 
 namespace anbox {
 namespace network {
+// Accepted connections are pinned to a service of |subsystem| and all of
+// their work runs there.
 class PublishedSocketConnector : public DoNotCopyOrMove, public Connector {
  public:
   explicit PublishedSocketConnector(
       const std::string& socket_file, const std::shared_ptr<Runtime>& rt,
       const std::shared_ptr<ConnectionCreator<
-          boost::asio::local::stream_protocol>>& connection_creator);
+          boost::asio::local::stream_protocol>>& connection_creator,
+      Runtime::Subsystem subsystem = Runtime::Subsystem::Control);
+  // Accepts on |socket| which already listens on |socket_file|, e.g. because
+  // another process created it and handed it over to us.
+  PublishedSocketConnector(
+      const Fd& socket, const std::string& socket_file, const std::shared_ptr<Runtime>& rt,
+      const std::shared_ptr<ConnectionCreator<
+          boost::asio::local::stream_protocol>>& connection_creator,
+      Runtime::Subsystem subsystem = Runtime::Subsystem::Control);
   ~PublishedSocketConnector() noexcept;
 
   std::string socket_file() const { return socket_file_; }
+  // A copy of the socket we accept on, e.g. to hand it to another process.
+  Fd socket();
 
  private:
   void start_accept();
@@ -46,6 +59,7 @@ class PublishedSocketConnector : public DoNotCopyOrMove, public Connector {
 
   const std::string socket_file_;
   std::shared_ptr<Runtime> runtime_;
+  Runtime::Subsystem subsystem_;
   std::shared_ptr<ConnectionCreator<boost::asio::local::stream_protocol>>
       connection_creator_;
   boost::asio::local::stream_protocol::acceptor acceptor_;
@@ -16,6 +16,7 @@
  * Authored by: Alan Griffiths <alan@octopull.co.uk>
  */
 
+#include "anbox/common/tracer.h"
 #include "anbox/logger.h"
 
 #include "anbox/network/message_receiver.h"
@@ -44,17 +45,35 @@ SocketConnection::SocketConnection(
       message_sender_(message_sender),
       id_(id_),
       connections_(connections),
-      processor_(processor) {}
+      processor_(processor),
+      buffer_() {
+  buffer_.reset(buffer_size_.current());
+}
 
 SocketConnection::~SocketConnection() noexcept {}
 
+void SocketConnection::set_name(const std::string& name) {
+  name_ = name;
+  metrics_ = common::Metrics::instance();
+  if (metrics_)
+    received_bytes_ = &metrics_->counter("anbox_connection_received_bytes_total",
+                                         "Bytes received from Android per connection",
+                                         {{"connection", name_}});
+}
+
+void SocketConnection::set_receive_buffer_policy(
+    const AdaptiveBufferSize::Policy& policy) {
+  buffer_size_ = AdaptiveBufferSize{policy};
+  buffer_.reset(buffer_size_.current());
+}
+
 void SocketConnection::send(char const* data, size_t length) {
   message_sender_->send(data, length);
 }
 
 void SocketConnection::read_next_message() {
   auto callback = std::bind(&SocketConnection::on_read_size, this, std::placeholders::_1, std::placeholders::_2);
-  message_receiver_->async_receive_msg(callback, ba::buffer(buffer_));
+  message_receiver_->async_receive_msg(callback, ba::buffer(buffer_.data(), buffer_.size()));
 }
 
 void SocketConnection::on_read_size(const boost::system::error_code& error, std::size_t bytes_read) {
@@ -63,10 +82,31 @@ void SocketConnection::on_read_size(const boost::system::error_code& error, std:
     return;
   }
 
-  std::vector<std::uint8_t> data(bytes_read);
-  std::copy(buffer_.data(), buffer_.data() + bytes_read, data.data());
+  if (received_bytes_)
+    received_bytes_->add(bytes_read);
+
+  const auto started = handler_statistics_ ? common::HandlerStatistics::Clock::now()
+                                           : common::HandlerStatistics::Clock::time_point{};
+  bool keep_reading = false;
+  {
+    ANBOX_TRACE_SPAN("network", "process_data");
+    keep_reading = processor_->process_data(
+        reinterpret_cast<const std::uint8_t*>(buffer_.data()), bytes_read);
+  }
+  if (handler_statistics_)
+    handler_statistics_->handler_executed(name_, {}, started,
+                                          common::HandlerStatistics::Clock::now());
+
+  // The processor is done with the data now so we can replace the buffer
+  // without preserving its content. It comes from the shared block pool
+  // so this is cheap.
+  if (buffer_size_.update(bytes_read)) {
+    DEBUG("Receive buffer of connection %s (%d) is now %d bytes", name_, id_,
+          buffer_size_.current());
+    buffer_.reset(buffer_size_.current());
+  }
 
-  if (processor_->process_data(data))
+  if (keep_reading)
     read_next_message();
   else
       connections_->remove(id());
@@ -19,6 +19,10 @@
 #ifndef ANBOX_NETWORK_SOCKET_CONNECTION_H_
 #define ANBOX_NETWORK_SOCKET_CONNECTION_H_
 
+#include "anbox/common/byte_buffer.h"
+#include "anbox/common/handler_statistics.h"
+#include "anbox/common/metrics.h"
+#include "anbox/network/adaptive_buffer_size.h"
 #include "anbox/network/connections.h"
 #include "anbox/network/message_processor.h"
 #include "anbox/network/message_receiver.h"
@@ -40,7 +44,20 @@ class SocketConnection {
 
   ~SocketConnection() noexcept;
 
-  void set_name(const std::string& name) { name_ = name; }
+  // Also decides which series of anbox_connection_received_bytes_total
+  // the received data counts towards.
+  void set_name(const std::string& name);
+
+  // Records how long processing received data takes, tagged with the name
+  // of the connection. Needs to be called before the first
+  // read_next_message().
+  void set_handler_statistics(const std::shared_ptr<common::HandlerStatistics>& statistics) {
+    handler_statistics_ = statistics;
+  }
+
+  // Needs to be called before the first read_next_message()
+  void set_receive_buffer_policy(const AdaptiveBufferSize::Policy& policy);
+  size_t receive_buffer_size() const { return buffer_.size(); }
 
   int id() const { return id_; }
 
@@ -56,8 +73,12 @@ class SocketConnection {
   int id_;
   std::shared_ptr<Connections<SocketConnection>> const connections_;
   std::shared_ptr<MessageProcessor> processor_;
-  std::array<std::uint8_t, 8192> buffer_;
+  AdaptiveBufferSize buffer_size_;
+  common::ByteBuffer<0> buffer_;
   std::string name_;
+  std::shared_ptr<common::HandlerStatistics> handler_statistics_;
+  std::shared_ptr<common::Metrics> metrics_;
+  common::Metrics::Counter* received_bytes_ = nullptr;
 };
 }  // namespace anbox
 }  // namespace network
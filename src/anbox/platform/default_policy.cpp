@@ -48,12 +48,14 @@ DefaultPolicy::ClipboardData DefaultPolicy::get_clipboard_data() {
   return ClipboardData{};
 }
 
-std::shared_ptr<audio::Sink> DefaultPolicy::create_audio_sink() {
+std::shared_ptr<audio::Sink> DefaultPolicy::create_audio_sink(const audio::ClientInfo &info) {
+  (void)info;
   ERROR("Not implemented");
   return nullptr;
 }
 
-std::shared_ptr<audio::Source> DefaultPolicy::create_audio_source() {
+std::shared_ptr<audio::Source> DefaultPolicy::create_audio_source(const audio::ClientInfo &info) {
+  (void)info;
   ERROR("Not implemented");
   return nullptr;
 }
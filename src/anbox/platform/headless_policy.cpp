@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "anbox/platform/headless_policy.h"
+#include "anbox/audio/sink.h"
+#include "anbox/graphics/emugl/Renderer.h"
+#include "anbox/logger.h"
+#include "anbox/wm/window.h"
+
+namespace {
+constexpr int refresh_rate{60};
+
+class OffscreenWindow : public anbox::wm::Window {
+ public:
+  OffscreenWindow(const std::shared_ptr<Renderer> &renderer,
+                  const anbox::wm::Task::Id &task,
+                  const anbox::graphics::Rect &frame,
+                  const anbox::graphics::Rect &display_frame,
+                  const std::string &title)
+      : anbox::wm::Window(renderer, task, frame, title),
+        renderer_(renderer),
+        display_frame_(display_frame),
+        attached_(false) {}
+
+  ~OffscreenWindow() {
+    if (attached_)
+      renderer_->destroyNativeWindow(native_handle());
+  }
+
+  bool attach() override {
+    // Windows can be moved and resized anywhere on the display so their
+    // surface is as big as the display to never lose any content.
+    attached_ = renderer_->createOffscreenWindow(
+        native_handle(), display_frame_.width(), display_frame_.height());
+    return attached_;
+  }
+
+  // There is no native window so we only need something unique to tell
+  // our surfaces apart in the renderer.
+  EGLNativeWindowType native_handle() const override {
+    return reinterpret_cast<EGLNativeWindowType>(this);
+  }
+
+ private:
+  std::shared_ptr<Renderer> renderer_;
+  anbox::graphics::Rect display_frame_;
+  bool attached_;
+};
+
+class NullSink : public anbox::audio::Sink {
+ public:
+  void write_data(const std::uint8_t *data, size_t size) override {
+    (void)data;
+    (void)size;
+  }
+};
+}  // namespace
+
+namespace anbox {
+namespace platform {
+HeadlessPolicy::HeadlessPolicy(const graphics::Rect &display_frame)
+    : display_frame_(display_frame) {}
+
+void HeadlessPolicy::set_renderer(const std::shared_ptr<Renderer> &renderer) {
+  renderer_ = renderer;
+}
+
+std::shared_ptr<wm::Window> HeadlessPolicy::create_window(
+    const anbox::wm::Task::Id &task, const anbox::graphics::Rect &frame, const std::string &title) {
+  if (!renderer_) {
+    ERROR("Can't create window without a renderer set");
+    return nullptr;
+  }
+  return std::make_shared<::OffscreenWindow>(renderer_, task, frame, display_frame_, title);
+}
+
+void HeadlessPolicy::set_clipboard_data(const ClipboardData &data) {
+  std::lock_guard<std::mutex> l(clipboard_lock_);
+  clipboard_data_ = data;
+}
+
+HeadlessPolicy::ClipboardData HeadlessPolicy::get_clipboard_data() {
+  std::lock_guard<std::mutex> l(clipboard_lock_);
+  return clipboard_data_;
+}
+
+std::shared_ptr<audio::Sink> HeadlessPolicy::create_audio_sink(const audio::ClientInfo &info) {
+  (void)info;
+  // Nobody is listening but the guest still has to get rid of its data.
+  return std::make_shared<::NullSink>();
+}
+
+std::shared_ptr<audio::Source> HeadlessPolicy::create_audio_source(const audio::ClientInfo &info) {
+  (void)info;
+  ERROR("Not implemented");
+  return nullptr;
+}
+
+DisplayManager::DisplayInfo HeadlessPolicy::display_info() const {
+  return {display_frame_.width(), display_frame_.height(), refresh_rate, 0};
+}
+}  // namespace platform
+}  // namespace anbox
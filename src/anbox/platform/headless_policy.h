@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef ANBOX_PLATFORM_HEADLESS_POLICY_H_
+#define ANBOX_PLATFORM_HEADLESS_POLICY_H_
+
+#include "anbox/platform/policy.h"
+
+#include "anbox/graphics/emugl/DisplayManager.h"
+
+#include <mutex>
+
+class Renderer;
+
+namespace anbox {
+namespace platform {
+// Platform without any display server, input or audio devices. Windows
+// are rendered into offscreen surfaces of the renderer which has to be
+// initialized in headless mode. Used to run sessions on machines without
+// a display, e.g. for benchmarking or on servers.
+class HeadlessPolicy : public Policy, public DisplayManager {
+ public:
+  explicit HeadlessPolicy(const graphics::Rect &display_frame);
+
+  void set_renderer(const std::shared_ptr<Renderer> &renderer);
+
+  std::shared_ptr<wm::Window> create_window(
+      const anbox::wm::Task::Id &task,
+      const anbox::graphics::Rect &frame,
+      const std::string &title) override;
+
+  void set_clipboard_data(const ClipboardData &data) override;
+  ClipboardData get_clipboard_data() override;
+
+  std::shared_ptr<audio::Sink> create_audio_sink(const audio::ClientInfo &info) override;
+  std::shared_ptr<audio::Source> create_audio_source(const audio::ClientInfo &info) override;
+
+  DisplayInfo display_info() const override;
+
+ private:
+  std::shared_ptr<Renderer> renderer_;
+  graphics::Rect display_frame_;
+  std::mutex clipboard_lock_;
+  ClipboardData clipboard_data_;
+};
+}  // namespace platform
+}  // namespace anbox
+
+#endif
@@ -20,5 +20,7 @@
 namespace anbox {
 namespace platform {
 Policy::~Policy() {}
+
+void Policy::register_clipboard_changed_handler(const std::function<void()> &) {}
 }  // namespace wm
 }  // namespace anbox
@@ -21,10 +21,12 @@
 #include "anbox/graphics/rect.h"
 #include "anbox/wm/window_state.h"
 
+#include <functional>
 #include <memory>
 
 namespace anbox {
 namespace audio {
+struct ClientInfo;
 class Sink;
 class Source;
 } // namespace audio
@@ -44,9 +46,14 @@ class Policy {
 
   virtual void set_clipboard_data(const ClipboardData &data) = 0;
   virtual ClipboardData get_clipboard_data() = 0;
-
-  virtual std::shared_ptr<audio::Sink> create_audio_sink() = 0;
-  virtual std::shared_ptr<audio::Source> create_audio_source() = 0;
+  // |handler| is called whenever the clipboard content changed. Policies
+  // which can't tell never call it.
+  virtual void register_clipboard_changed_handler(const std::function<void()> &handler);
+
+  // |info| describes the format of the stream the sink will play.
+  virtual std::shared_ptr<audio::Sink> create_audio_sink(const audio::ClientInfo &info) = 0;
+  // |info| describes the format of the stream the source will capture.
+  virtual std::shared_ptr<audio::Source> create_audio_source(const audio::ClientInfo &info) = 0;
 };
 }  // namespace wm
 }  // namespace anbox
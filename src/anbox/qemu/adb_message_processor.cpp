@@ -21,9 +21,15 @@
 #include "anbox/network/delegate_message_processor.h"
 #include "anbox/network/tcp_socket_messenger.h"
 
+#include <cstring>
+#include <deque>
 #include <fstream>
 #include <functional>
 
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
 namespace {
 const unsigned short default_adb_client_port{5037};
 const unsigned short default_host_listen_port{6664};
@@ -32,7 +38,17 @@ const std::string ok_command{"ok"};
 const std::string ko_command{"ko"};
 const std::string start_command{"start"};
 const boost::posix_time::seconds default_adb_wait_time{1};
-static std::mutex active_instance;
+// Installs and pushes of large packages are what this has to be fast for.
+constexpr int splice_pipe_size{1024 * 1024};
+constexpr std::size_t splice_chunk_size{256 * 1024};
+
+// The container directly starts a second connection once the first one is
+// established but will not use it until the active one is closed.
+struct {
+  std::mutex lock;
+  bool taken = false;
+  std::deque<std::weak_ptr<anbox::qemu::AdbMessageProcessor>> waiting;
+} host_slot;
 }
 
 using namespace std::placeholders;
@@ -41,34 +57,84 @@ namespace anbox {
 namespace qemu {
 AdbMessageProcessor::AdbMessageProcessor(
     const std::shared_ptr<Runtime> &rt,
-    const std::shared_ptr<network::SocketMessenger> &messenger)
+    const std::shared_ptr<network::SocketMessenger> &messenger,
+    const Fd &socket)
     : runtime_(rt),
       state_(waiting_for_guest_accept_command),
       expected_command_(accept_command),
       messenger_(messenger),
+      socket_(socket),
+      splice_(false),
+      pending_to_guest_(0),
+      guest_socket_(rt->service()),
+      holds_host_slot_(false),
+      bytes_to_host_(0),
+      bytes_to_guest_(0),
       host_notify_timer_(rt->service()) {}
 
 AdbMessageProcessor::~AdbMessageProcessor() {
+  if (state_ == proxying_data) {
+    const auto seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - proxy_start_).count();
+    DEBUG("Forwarded %d bytes to the host (%.1f MiB/s) and %d bytes to Android (%.1f MiB/s)",
+          bytes_to_host_, bytes_to_host_ / seconds / (1024 * 1024),
+          bytes_to_guest_, bytes_to_guest_ / seconds / (1024 * 1024));
+  }
+
   state_ = closed_by_host;
   host_connector_.reset();
-  active_instance.unlock();
+  release_host_slot();
+}
+
+bool AdbMessageProcessor::acquire_host_slot() {
+  std::lock_guard<std::mutex> l(host_slot.lock);
+  if (!host_slot.taken) {
+    host_slot.taken = true;
+    holds_host_slot_ = true;
+    return true;
+  }
+  host_slot.waiting.push_back(shared_from_this());
+  return false;
+}
+
+void AdbMessageProcessor::release_host_slot() {
+  std::shared_ptr<AdbMessageProcessor> next;
+  {
+    std::lock_guard<std::mutex> l(host_slot.lock);
+    if (!holds_host_slot_)
+      return;
+    holds_host_slot_ = false;
+
+    // Processors whose connection went away in the meantime are skipped.
+    while (!next && !host_slot.waiting.empty()) {
+      next = host_slot.waiting.front().lock();
+      host_slot.waiting.pop_front();
+    }
+    host_slot.taken = next != nullptr;
+    if (next)
+      next->holds_host_slot_ = true;
+  }
+
+  if (next)
+    runtime_->service().post([next]() { next->on_host_slot_granted(); });
+}
+
+void AdbMessageProcessor::on_host_slot_granted() {
+  if (state_ == closed_by_host) {
+    host_connector_.reset();
+    return;
+  }
+
+  wait_for_host_connection();
 }
 
 void AdbMessageProcessor::advance_state() {
   switch (state_) {
     case waiting_for_guest_accept_command:
-      // Try to get a lock here as if we already have another processor
-      // running we don't have to do anything here until that one is done.
-      // The container directly starts a second connection once the first
-      // one is established but will not use it until the active one is closed.
-      active_instance.lock();
-
-      if (state_ == closed_by_host) {
-        host_connector_.reset();
-        return;
-      }
-
-      wait_for_host_connection();
+      // If we already have another processor running we don't have to do
+      // anything here until that one is done.
+      if (acquire_host_slot())
+        on_host_slot_granted();
       break;
     case waiting_for_host_connection:
       messenger_->send(reinterpret_cast<const char *>(ok_command.data()),
@@ -77,8 +143,7 @@ void AdbMessageProcessor::advance_state() {
       expected_command_ = start_command;
       break;
     case waiting_for_guest_start_command:
-      state_ = proxying_data;
-      read_next_host_message();
+      start_proxying();
       break;
     case proxying_data:
       break;
@@ -130,6 +195,7 @@ void AdbMessageProcessor::wait_for_host_connection() {
 
 void AdbMessageProcessor::on_host_connection(std::shared_ptr<boost::asio::basic_stream_socket<boost::asio::ip::tcp>> const &socket) {
   host_messenger_ = std::make_shared<network::TcpSocketMessenger>(socket);
+  host_socket_ = socket;
 
   // set_no_delay() reduces the latency of sending data, at the cost
   // of creating more TCP packets on the connection. It's useful when
@@ -146,7 +212,36 @@ void AdbMessageProcessor::on_host_connection(std::shared_ptr<boost::asio::basic_
   expected_command_ = start_command;
 }
 
+void AdbMessageProcessor::start_proxying() {
+  state_ = proxying_data;
+  proxy_start_ = std::chrono::steady_clock::now();
+
+  int fds[2];
+  if (::pipe2(fds, O_CLOEXEC) == 0) {
+    pipe_read_ = Fd{fds[0]};
+    pipe_write_ = Fd{fds[1]};
+    // The default of 64 KiB only moves a few segments per call. Failing to
+    // grow it only costs throughput.
+    ::fcntl(pipe_write_, F_SETPIPE_SZ, splice_pipe_size);
+
+    const auto guest_socket = ::fcntl(socket_, F_DUPFD_CLOEXEC, 0);
+    if (guest_socket >= 0) {
+      guest_socket_.assign(guest_socket);
+      splice_ = true;
+    }
+  }
+
+  read_next_host_message();
+}
+
 void AdbMessageProcessor::read_next_host_message() {
+  if (splice_) {
+    host_socket_->async_read_some(
+        boost::asio::null_buffers(),
+        std::bind(&AdbMessageProcessor::on_host_readable, this, _1));
+    return;
+  }
+
   auto callback = std::bind(&AdbMessageProcessor::on_host_read_size, this, _1, _2);
   host_messenger_->async_receive_msg(callback,
                                      boost::asio::buffer(host_buffer_));
@@ -160,21 +255,98 @@ void AdbMessageProcessor::on_host_read_size(
   }
 
   messenger_->send(reinterpret_cast<const char *>(host_buffer_.data()), bytes_read);
+  bytes_to_guest_ += bytes_read;
+  read_next_host_message();
+}
+
+void AdbMessageProcessor::on_host_readable(const boost::system::error_code &error) {
+  if (error) {
+    state_ = closed_by_host;
+    BOOST_THROW_EXCEPTION(std::runtime_error(error.message()));
+  }
+
+  for (;;) {
+    const auto moved = ::splice(host_socket_->native_handle(), nullptr, pipe_write_, nullptr,
+                                splice_chunk_size, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (moved == 0) {
+      state_ = closed_by_host;
+      BOOST_THROW_EXCEPTION(std::runtime_error("Host adb closed the connection"));
+    }
+    if (moved < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN)
+        break;
+      if (bytes_to_guest_ == 0 && (errno == EINVAL || errno == ENOSYS)) {
+        WARNING("Can't splice adb data, copying it instead");
+        splice_ = false;
+        break;
+      }
+      state_ = closed_by_host;
+      BOOST_THROW_EXCEPTION(std::runtime_error(
+          utils::string_format("Failed to splice adb data: %s", std::strerror(errno))));
+    }
+
+    pending_to_guest_ = static_cast<std::size_t>(moved);
+    if (!forward_to_guest())
+      return;
+  }
+
   read_next_host_message();
 }
 
-bool AdbMessageProcessor::process_data(const std::vector<std::uint8_t> &data) {
+bool AdbMessageProcessor::forward_to_guest() {
+  while (pending_to_guest_ > 0) {
+    const auto moved = ::splice(pipe_read_, nullptr, socket_, nullptr, pending_to_guest_,
+                                SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (moved < 0) {
+      if (errno == EINTR)
+        continue;
+      // The pipe socket is non-blocking, so wait until Android caught up.
+      if (errno == EAGAIN) {
+        std::weak_ptr<AdbMessageProcessor> weak_self = shared_from_this();
+        guest_socket_.async_write_some(
+            boost::asio::null_buffers(),
+            [weak_self](const boost::system::error_code &error, std::size_t) {
+              if (auto self = weak_self.lock())
+                self->on_guest_writable(error);
+            });
+        return false;
+      }
+      state_ = closed_by_container;
+      BOOST_THROW_EXCEPTION(std::runtime_error(
+          utils::string_format("Failed to forward adb data: %s", std::strerror(errno))));
+    }
+    pending_to_guest_ -= static_cast<std::size_t>(moved);
+    bytes_to_guest_ += static_cast<std::uint64_t>(moved);
+  }
+  return true;
+}
+
+void AdbMessageProcessor::on_guest_writable(const boost::system::error_code &error) {
+  if (error) {
+    state_ = closed_by_container;
+    BOOST_THROW_EXCEPTION(std::runtime_error(error.message()));
+  }
+
+  if (forward_to_guest())
+    read_next_host_message();
+}
+
+bool AdbMessageProcessor::process_data(const std::uint8_t *data,
+                                       size_t size) {
   if (state_ == proxying_data) {
-    host_messenger_->send(reinterpret_cast<const char *>(data.data()),
-                          data.size());
+    host_messenger_->send(reinterpret_cast<const char *>(data), size);
+    bytes_to_host_ += size;
     return true;
   }
 
-  for (const auto &byte : data) buffer_.push_back(byte);
+  buffer_.insert(buffer_.end(), data, data + size);
 
   if (expected_command_.size() > 0 &&
       buffer_.size() >= expected_command_.size()) {
-    if (::memcmp(buffer_.data(), expected_command_.data(), data.size()) != 0) {
+    if (::memcmp(buffer_.data(), expected_command_.data(),
+                 expected_command_.size()) != 0) {
       // We got not the command we expected and will terminate here
       return false;
     }
@@ -183,6 +355,14 @@ bool AdbMessageProcessor::process_data(const std::vector<std::uint8_t> &data) {
     expected_command_.clear();
 
     advance_state();
+
+    // Android doesn't wait for us before it sends the first data after
+    // the start command.
+    if (state_ == proxying_data && !buffer_.empty()) {
+      host_messenger_->send(reinterpret_cast<const char *>(buffer_.data()), buffer_.size());
+      bytes_to_host_ += buffer_.size();
+      buffer_.clear();
+    }
   }
 
   return true;
@@ -18,6 +18,7 @@
 #ifndef ANBOX_QEMU_ADBD_MESSAGE_PROCESSOR_H_
 #define ANBOX_QEMU_ADBD_MESSAGE_PROCESSOR_H_
 
+#include "anbox/common/fd.h"
 #include "anbox/network/message_processor.h"
 #include "anbox/network/socket_connection.h"
 #include "anbox/network/socket_messenger.h"
@@ -27,16 +28,31 @@
 
 #include <boost/asio.hpp>
 
+#include <chrono>
+#include <memory>
+
 namespace anbox {
 namespace qemu {
-class AdbMessageProcessor : public network::MessageProcessor {
+// Bridges adbd in the container with the adb server of the host.
+//
+// Once both sides are connected data from the host is spliced into the
+// pipe socket through a kernel pipe without ever being copied to us, and
+// data from Android goes out to the host straight from the buffer it was
+// received into.
+//
+// Only one processor talks to the host at a time, the others wait for
+// their turn without holding up the thread they run on.
+class AdbMessageProcessor : public network::MessageProcessor,
+                            public std::enable_shared_from_this<AdbMessageProcessor> {
  public:
+  // |socket| is the pipe socket |messenger| writes to.
   AdbMessageProcessor(
       const std::shared_ptr<Runtime> &rt,
-      const std::shared_ptr<network::SocketMessenger> &messenger);
+      const std::shared_ptr<network::SocketMessenger> &messenger,
+      const Fd &socket);
   ~AdbMessageProcessor();
 
-  bool process_data(const std::vector<std::uint8_t> &data) override;
+  bool process_data(const std::uint8_t *data, size_t size) override;
 
  private:
   enum State {
@@ -50,21 +66,49 @@ class AdbMessageProcessor : public network::MessageProcessor {
 
   void advance_state();
 
+  // Returns whether we may talk to the host right away. Otherwise we get
+  // on_host_slot_granted() called once the active processor is gone.
+  bool acquire_host_slot();
+  void release_host_slot();
+  void on_host_slot_granted();
+
   void wait_for_host_connection();
   void on_host_connection(std::shared_ptr<boost::asio::basic_stream_socket<
                               boost::asio::ip::tcp>> const &socket);
+  void start_proxying();
   void read_next_host_message();
   void on_host_read_size(const boost::system::error_code &error,
                          std::size_t bytes_read);
+  void on_host_readable(const boost::system::error_code &error);
+  // Moves what is left in |pipe_read_| into the pipe socket. Returns false
+  // when Android has to catch up first, forwarding continues in
+  // on_guest_writable() then.
+  bool forward_to_guest();
+  void on_guest_writable(const boost::system::error_code &error);
 
   std::shared_ptr<Runtime> runtime_;
   State state_ = waiting_for_guest_accept_command;
   std::string expected_command_;
   std::shared_ptr<network::SocketMessenger> const messenger_;
+  Fd socket_;
   std::vector<std::uint8_t> buffer_;
   std::shared_ptr<network::TcpSocketConnector> host_connector_;
   std::shared_ptr<network::TcpSocketMessenger> host_messenger_;
+  std::shared_ptr<boost::asio::ip::tcp::socket> host_socket_;
   std::array<std::uint8_t, 8192> host_buffer_;
+  // Kernel pipe host data is spliced through. Without splice support we
+  // copy through |host_buffer_|.
+  bool splice_;
+  Fd pipe_read_;
+  Fd pipe_write_;
+  std::size_t pending_to_guest_;
+  // Our own descriptor of the pipe socket to wait on until it is writable.
+  boost::asio::posix::stream_descriptor guest_socket_;
+  bool holds_host_slot_;
+
+  std::chrono::steady_clock::time_point proxy_start_;
+  std::uint64_t bytes_to_host_;
+  std::uint64_t bytes_to_guest_;
   boost::asio::deadline_timer host_notify_timer_;
 };
 }  // namespace graphics
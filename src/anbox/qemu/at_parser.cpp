@@ -19,58 +19,81 @@
 #include "anbox/logger.h"
 #include "anbox/utils.h"
 
+#include <algorithm>
+
 namespace anbox {
 namespace qemu {
-AtParser::AtParser() {}
+AtParser::AtParser() : nodes_(1) {}
 
 void AtParser::register_command(const std::string &command,
                                 CommandHandler handler) {
-  handlers_.insert({command, handler});
+  std::size_t node = 0;
+  for (const auto c : command) {
+    auto &children = nodes_[node].children;
+    auto child = std::lower_bound(
+        children.begin(), children.end(), c,
+        [](const std::pair<char, std::size_t> &entry, char value) { return entry.first < value; });
+    if (child == children.end() || child->first != c) {
+      child = children.insert(child, {c, nodes_.size()});
+      nodes_.emplace_back();
+    }
+    node = child->second;
+  }
+
+  // The first registration wins.
+  if (!nodes_[node].handler)
+    nodes_[node].handler = handler;
+}
+
+AtParser::CommandHandler AtParser::find_handler(const std::string &command,
+                                                std::size_t offset) const {
+  std::size_t node = 0;
+  if (nodes_[node].handler)
+    return nodes_[node].handler;
+
+  for (auto n = offset; n < command.size(); n++) {
+    const auto &children = nodes_[node].children;
+    const auto c = command[n];
+    auto child = std::lower_bound(
+        children.begin(), children.end(), c,
+        [](const std::pair<char, std::size_t> &entry, char value) { return entry.first < value; });
+    if (child == children.end() || child->first != c)
+      return nullptr;
+
+    node = child->second;
+    if (nodes_[node].handler)
+      return nodes_[node].handler;
+  }
+  return nullptr;
 }
 
 void AtParser::process_data(std::vector<std::uint8_t> &data) {
-  size_t bytes_processed = 0;
-  for (size_t pos = 0; pos < data.size();) {
-    const auto byte = data.at(pos);
-    if (byte == '\n' || byte == '\r') {
-      std::string command;
-      command.insert(
-          0, reinterpret_cast<const char *>(data.data()) + bytes_processed,
-          pos - bytes_processed);
-      bytes_processed += (pos - bytes_processed) + 1;
-      processs_command(command);
-    }
-    pos++;
+  const auto is_terminator = [](std::uint8_t c) { return c == '\n' || c == '\r'; };
+
+  auto begin = data.begin();
+  for (auto end = std::find_if(begin, data.end(), is_terminator); end != data.end();
+       end = std::find_if(begin, data.end(), is_terminator)) {
+    process_command(std::string(begin, end));
+    begin = end + 1;
   }
 
-  data.erase(data.begin(), data.begin() + bytes_processed);
+  data.erase(data.begin(), begin);
 }
 
-void AtParser::processs_command(const std::string &command) {
+void AtParser::process_command(const std::string &command) {
   if (!utils::string_starts_with(command, "AT")) {
     WARNING("Invalid AT command: '%s'", command);
     return;
   }
 
-  // Strip AT prefix from command
-  auto real_command = command.substr(2, command.length() - 2);
-
-  DEBUG("command: %s", real_command);
-
-  CommandHandler handler = nullptr;
-  for (const auto &iter : handlers_) {
-    if (utils::string_starts_with(real_command, iter.first)) {
-      handler = iter.second;
-      break;
-    }
-  }
-
+  // The AT prefix isn't part of the registered commands.
+  const auto handler = find_handler(command, 2);
   if (!handler) {
-    WARNING("No handler for command '%s' available", real_command);
+    WARNING("No handler for command '%s' available", command.substr(2));
     return;
   }
 
-  handler(real_command);
+  handler(command.substr(2));
 }
 }  // namespace qemu
 }  // namespace anbox
@@ -18,7 +18,7 @@
 #ifndef ANBOX_QEMU_AT_PARSER_H_
 #define ANBOX_QEMU_AT_PARSER_H_
 
-#include <map>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -27,6 +27,10 @@
 
 namespace anbox {
 namespace qemu {
+// Dispatches AT commands to the handler registered for the shortest
+// prefix of the command. Registered prefixes are kept in a trie so that
+// resolving a command only walks its characters once, however many
+// commands are registered.
 class AtParser {
  public:
   typedef std::function<void(const std::string &)> CommandHandler;
@@ -35,12 +39,23 @@ class AtParser {
 
   void register_command(const std::string &command, CommandHandler handler);
 
+  // Handles all complete lines of |data| and removes them from it.
   void process_data(std::vector<std::uint8_t> &data);
+  // Handles a single line without its terminator.
+  void process_command(const std::string &command);
 
  private:
-  void processs_command(const std::string &command);
 
-  std::map<std::string, CommandHandler> handlers_;
+  struct Node {
+    // Sorted by character.
+    std::vector<std::pair<char, std::size_t>> children;
+    CommandHandler handler;
+  };
+
+  CommandHandler find_handler(const std::string &command, std::size_t offset) const;
+
+  // The root is the first node.
+  std::vector<Node> nodes_;
 };
 }  // namespace qemu
 }  // namespace anbox
@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "anbox/qemu/boot_properties.h"
+#include "anbox/graphics/emugl/DisplayManager.h"
+#include "anbox/logger.h"
+
+#include <boost/throw_exception.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+#include <unistd.h>
+
+namespace {
+// Limits of the guest including the terminating NUL byte. Anything longer
+// makes it stop reading the remaining properties.
+constexpr std::size_t max_name_size{32};
+constexpr std::size_t max_value_size{92};
+
+constexpr int medium_density_dpi{96};
+constexpr std::uint64_t gib{1024 * 1024 * 1024};
+
+// What Android ships for devices with as much memory, see
+// frameworks/native/build/phone-xhdpi-*-dalvik-heap.mk.
+struct HeapConfig {
+  std::uint64_t min_memory;
+  const char *start_size;
+  const char *growth_limit;
+  const char *size;
+};
+constexpr HeapConfig heap_configs[] = {
+    {4 * gib, "16m", "256m", "512m"},
+    {2 * gib, "8m", "192m", "512m"},
+    {0, "8m", "96m", "256m"},
+};
+
+// We always tell the guest we run OpenGL ES 2.0, see approvedGLString()
+// in the render control.
+constexpr int opengles_version{0x00020000};
+
+std::string trim(const std::string &s) {
+  const auto begin = s.find_first_not_of(" \t");
+  if (begin == std::string::npos)
+    return "";
+  const auto end = s.find_last_not_of(" \t");
+  return s.substr(begin, end - begin + 1);
+}
+}  // namespace
+
+namespace anbox {
+namespace qemu {
+BootProperties::Host BootProperties::query_host() {
+  Host host;
+  host.dpi = DisplayManager::get()->display_info().dpi;
+  host.cpus = std::max(1u, std::thread::hardware_concurrency());
+
+  const auto pages = sysconf(_SC_PHYS_PAGES);
+  const auto page_size = sysconf(_SC_PAGE_SIZE);
+  host.memory = (pages > 0 && page_size > 0)
+                    ? static_cast<std::uint64_t>(pages) * static_cast<std::uint64_t>(page_size)
+                    : 0;
+  return host;
+}
+
+graphics::DensityType BootProperties::density_for(int dpi) {
+  static const graphics::DensityType buckets[] = {
+      graphics::DensityType::low,   graphics::DensityType::medium,
+      graphics::DensityType::tv,    graphics::DensityType::high,
+      graphics::DensityType::xhigh, graphics::DensityType::xxhigh,
+  };
+
+  if (dpi <= 0)
+    return graphics::DensityType::medium;
+
+  // Densities in between the buckets would make Android scale all of its
+  // bitmaps when they are loaded and every surface drawn with them.
+  const auto density = dpi * static_cast<int>(graphics::DensityType::medium) / medium_density_dpi;
+  auto best = buckets[0];
+  for (const auto &bucket : buckets) {
+    if (std::abs(static_cast<int>(bucket) - density) <
+        std::abs(static_cast<int>(best) - density))
+      best = bucket;
+  }
+  return best;
+}
+
+BootProperties::BootProperties(const Host &host) {
+  set("ro.sf.lcd_density", std::to_string(static_cast<int>(density_for(host.dpi))));
+  set("ro.opengles.version", std::to_string(opengles_version));
+
+  const auto threads = std::to_string(host.cpus);
+  set("dalvik.vm.dex2oat-threads", threads);
+  set("dalvik.vm.boot-dex2oat-threads", threads);
+
+  for (const auto &config : heap_configs) {
+    if (host.memory < config.min_memory)
+      continue;
+    set("dalvik.vm.heapstartsize", config.start_size);
+    set("dalvik.vm.heapgrowthlimit", config.growth_limit);
+    set("dalvik.vm.heapsize", config.size);
+    break;
+  }
+}
+
+void BootProperties::load_overrides(const std::string &path) {
+  std::ifstream in(path);
+  if (!in)
+    BOOST_THROW_EXCEPTION(std::runtime_error("Failed to open boot properties " + path));
+
+  std::string line;
+  while (std::getline(in, line)) {
+    line = trim(line);
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    const auto separator = line.find('=');
+    if (separator == std::string::npos || separator == 0) {
+      WARNING("Ignoring invalid boot property '%s' in %s", line, path);
+      continue;
+    }
+    set(trim(line.substr(0, separator)), trim(line.substr(separator + 1)));
+  }
+}
+
+void BootProperties::set(const std::string &name, const std::string &value) {
+  if (name.size() >= max_name_size || value.size() >= max_value_size) {
+    WARNING("Ignoring boot property %s as it is too long for Android", name);
+    return;
+  }
+
+  auto property = std::find_if(properties_.begin(), properties_.end(),
+                               [&](const std::pair<std::string, std::string> &p) {
+                                 return p.first == name;
+                               });
+  if (property != properties_.end())
+    property->second = value;
+  else
+    properties_.emplace_back(name, value);
+
+  update_reply();
+}
+
+std::string BootProperties::get(const std::string &name) const {
+  for (const auto &property : properties_) {
+    if (property.first == name)
+      return property.second;
+  }
+  return "";
+}
+
+void BootProperties::update_reply() {
+  reply_.clear();
+  for (const auto &property : properties_) {
+    const auto message = property.first + "=" + property.second;
+    char header[5];
+    std::snprintf(header, sizeof(header), "%04zx", message.size());
+    reply_ += header;
+    reply_ += message;
+  }
+  reply_.push_back('\0');
+}
+}  // namespace qemu
+}  // namespace anbox
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef ANBOX_QEMU_BOOT_PROPERTIES_H_
+#define ANBOX_QEMU_BOOT_PROPERTIES_H_
+
+#include "anbox/graphics/density.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace anbox {
+namespace qemu {
+// System properties Android sets from what we tell it right after it
+// started, derived from the host we're running on.
+//
+// The properties are computed once and kept, together with the reply for
+// the guest, so that all it costs to hand them out is a single write.
+// Everything has to be set up before the properties are shared with other
+// threads.
+class BootProperties {
+ public:
+  struct Host {
+    // Pixel density of the display in dots per inch or zero if unknown.
+    int dpi;
+    unsigned int cpus;
+    // Physical memory in bytes.
+    std::uint64_t memory;
+  };
+
+  // Queries the display manager and the kernel.
+  static Host query_host();
+
+  // Maps the pixel density of a host display to the closest density bucket
+  // Android has resources for. Displays with 96 dpi are what Android calls
+  // medium density as they are looked at from about twice the distance of
+  // a phone.
+  static graphics::DensityType density_for(int dpi);
+
+  explicit BootProperties(const Host &host);
+
+  // Reads lines of the form name=value from |path| which replace or add to
+  // the properties we derived. Empty lines and lines starting with # are
+  // skipped. Throws std::runtime_error when |path| can't be read.
+  void load_overrides(const std::string &path);
+  void set(const std::string &name, const std::string &value);
+  // Returns an empty string for properties we don't have.
+  std::string get(const std::string &name) const;
+
+  // All properties framed as qemud messages followed by the terminating
+  // NUL byte, as the guest expects them as reply to its list command.
+  const std::string &reply() const { return reply_; }
+
+ private:
+  void update_reply();
+
+  std::vector<std::pair<std::string, std::string>> properties_;
+  std::string reply_;
+};
+}  // namespace qemu
+}  // namespace anbox
+
+#endif
@@ -16,14 +16,13 @@
  */
 
 #include "anbox/qemu//boot_properties_message_processor.h"
-#include "anbox/graphics/density.h"
-#include "anbox/utils.h"
 
 namespace anbox {
 namespace qemu {
 BootPropertiesMessageProcessor::BootPropertiesMessageProcessor(
-    const std::shared_ptr<network::SocketMessenger> &messenger)
-    : QemudMessageProcessor(messenger) {}
+    const std::shared_ptr<network::SocketMessenger> &messenger,
+    const std::shared_ptr<const BootProperties> &properties)
+    : QemudMessageProcessor(messenger), properties_(properties) {}
 
 BootPropertiesMessageProcessor::~BootPropertiesMessageProcessor() {}
 
@@ -33,20 +32,8 @@ void BootPropertiesMessageProcessor::handle_command(
 }
 
 void BootPropertiesMessageProcessor::list_properties() {
-  std::vector<std::string> properties = {
-      // TODO(morphis): Using HDPI here for now but should be adjusted to the
-      // device
-      // we're running on.
-      utils::string_format("ro.sf.lcd_density=%d",
-                           static_cast<int>(graphics::DensityType::medium)),
-  };
-
-  for (const auto &prop : properties) {
-    send_header(prop.length());
-    messenger_->send(prop.c_str(), prop.length());
-  }
-
-  finish_message();
+  const auto &reply = properties_->reply();
+  messenger_->send(reply.data(), reply.size());
 }
 }  // namespace qemu
 }  // namespace anbox
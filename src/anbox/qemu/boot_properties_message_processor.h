@@ -19,13 +19,15 @@
 #define ANBOX_QEMU_BOOT_PROPERTIES_MESSAGE_PROCESSOR_H_
 
 #include "anbox/qemu//qemud_message_processor.h"
+#include "anbox/qemu/boot_properties.h"
 
 namespace anbox {
 namespace qemu {
 class BootPropertiesMessageProcessor : public QemudMessageProcessor {
  public:
   BootPropertiesMessageProcessor(
-      const std::shared_ptr<network::SocketMessenger> &messenger);
+      const std::shared_ptr<network::SocketMessenger> &messenger,
+      const std::shared_ptr<const BootProperties> &properties);
   ~BootPropertiesMessageProcessor();
 
  protected:
@@ -33,6 +35,8 @@ class BootPropertiesMessageProcessor : public QemudMessageProcessor {
 
  private:
   void list_properties();
+
+  std::shared_ptr<const BootProperties> properties_;
 };
 }  // namespace graphics
 }  // namespace anbox
@@ -18,10 +18,31 @@
 #include "anbox/qemu//bootanimation_message_processor.h"
 #include "anbox/logger.h"
 
-#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <mutex>
 
 namespace anbox {
 namespace qemu {
+struct BootAnimationMessageProcessor::Icon {
+  ~Icon() {
+    if (data)
+      ::munmap(data, size);
+  }
+
+  std::string path;
+  dev_t device = 0;
+  ino_t inode = 0;
+  struct timespec mtime {};
+  std::size_t size = 0;
+  void *data = nullptr;
+};
+
 BootAnimationMessageProcessor::BootAnimationMessageProcessor(
     const std::shared_ptr<network::SocketMessenger> &messenger,
     const std::string &icon_path)
@@ -33,16 +54,62 @@ void BootAnimationMessageProcessor::handle_command(const std::string &command) {
   if (command == "retrieve-icon") retrieve_icon();
 }
 
-void BootAnimationMessageProcessor::retrieve_icon() {
-  std::ifstream icon_file(icon_path_, std::ifstream::binary);
-  std::array<char, 1024> buffer;
+std::shared_ptr<const BootAnimationMessageProcessor::Icon>
+BootAnimationMessageProcessor::load_icon(const std::string &path) {
+  static std::mutex lock;
+  static std::shared_ptr<const Icon> cached;
+
+  const auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    ERROR("Failed to open boot animation icon %s: %s", path, std::strerror(errno));
+    return nullptr;
+  }
 
-  while (icon_file.read(buffer.data(), buffer.size())) {
-    const auto bytes_read = icon_file.gcount();
-    messenger_->send(buffer.data(), bytes_read);
-    DEBUG("Sending %d bytes", bytes_read);
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    ERROR("Failed to query boot animation icon %s: %s", path, std::strerror(errno));
+    ::close(fd);
+    return nullptr;
   }
+
+  std::lock_guard<std::mutex> l(lock);
+  if (cached && cached->path == path && cached->device == st.st_dev &&
+      cached->inode == st.st_ino && cached->size == static_cast<std::size_t>(st.st_size) &&
+      cached->mtime.tv_sec == st.st_mtim.tv_sec && cached->mtime.tv_nsec == st.st_mtim.tv_nsec) {
+    ::close(fd);
+    return cached;
+  }
+
+  auto icon = std::make_shared<Icon>();
+  icon->path = path;
+  icon->device = st.st_dev;
+  icon->inode = st.st_ino;
+  icon->mtime = st.st_mtim;
+  icon->size = static_cast<std::size_t>(st.st_size);
+  if (icon->size > 0) {
+    const auto data = ::mmap(nullptr, icon->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      ERROR("Failed to map boot animation icon %s: %s", path, std::strerror(errno));
+      ::close(fd);
+      return nullptr;
+    }
+    icon->data = data;
+  }
+  ::close(fd);
+
+  cached = icon;
+  return cached;
 }
 
+void BootAnimationMessageProcessor::retrieve_icon() {
+  const auto icon = load_icon(icon_path_);
+  if (!icon || icon->size == 0)
+    return;
+
+  // Straight from the page cache and in one go, the messenger doesn't
+  // stage what it sends.
+  messenger_->send(static_cast<const char*>(icon->data), icon->size);
+  DEBUG("Sent %d bytes of boot animation icon", icon->size);
+}
 }  // namespace qemu
 }  // namespace anbox
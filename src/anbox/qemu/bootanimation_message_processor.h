@@ -20,6 +20,9 @@
 
 #include "anbox/qemu//qemud_message_processor.h"
 
+#include <memory>
+#include <string>
+
 namespace anbox {
 namespace qemu {
 class BootAnimationMessageProcessor : public QemudMessageProcessor {
@@ -33,6 +36,12 @@ class BootAnimationMessageProcessor : public QemudMessageProcessor {
   void handle_command(const std::string &command) override;
 
  private:
+  struct Icon;
+
+  // The icon stays mapped as long as it doesn't change, every instance of
+  // Android asks for it again when it boots.
+  static std::shared_ptr<const Icon> load_icon(const std::string &path);
+
   void retrieve_icon();
 
   std::string icon_path_;
@@ -16,49 +16,325 @@
  */
 
 #include "anbox/qemu/camera_message_processor.h"
+#include "anbox/camera/frame_converter.h"
+#include "anbox/camera/frame_ring.h"
+#include "anbox/camera/v4l2_device.h"
 #include "anbox/logger.h"
+#include "anbox/network/fd_socket_transmission.h"
+#include "anbox/utils.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/uio.h>
+
+#include <linux/videodev2.h>
+
+namespace {
+constexpr const char *device_name_param{"name="};
+constexpr std::chrono::milliseconds capture_timeout{100};
+
+std::uint32_t to_number(const std::map<std::string, std::string> &params,
+                        const std::string &key) {
+  const auto param = params.find(key);
+  if (param == params.end())
+    return 0;
+  return static_cast<std::uint32_t>(std::strtoul(param->second.c_str(), nullptr, 10));
+}
+
+bool is_host_camera(const std::string &path) {
+  const auto devices = anbox::camera::V4l2Device::available_devices();
+  return std::find(devices.begin(), devices.end(), path) != devices.end();
+}
+}  // namespace
 
 namespace anbox {
 namespace qemu {
 CameraMessageProcessor::CameraMessageProcessor(
-    const std::shared_ptr<network::SocketMessenger> &messenger)
-    : messenger_(messenger) {}
+    const std::shared_ptr<network::SocketMessenger> &messenger,
+    const Fd &socket, const std::string &arguments, bool host_cameras)
+    : messenger_(messenger),
+      socket_(socket),
+      host_cameras_(host_cameras),
+      framer_(MessageFramer::Framing::NullTerminated),
+      width_(0),
+      height_(0),
+      pixel_format_(0),
+      video_size_(0),
+      preview_size_(0),
+      capturing_(false) {
+  if (utils::string_starts_with(arguments, device_name_param))
+    device_name_ = arguments.substr(std::strlen(device_name_param));
+}
 
-CameraMessageProcessor::~CameraMessageProcessor() {}
+CameraMessageProcessor::~CameraMessageProcessor() { stop_capture(); }
 
-bool CameraMessageProcessor::process_data(
-    const std::vector<std::uint8_t> &data) {
-  for (const auto &byte : data) buffer_.push_back(byte);
+bool CameraMessageProcessor::process_data(const std::uint8_t *data,
+                                          size_t size) {
+  framer_.append(data, size);
 
-  process_commands();
+  std::string command;
+  while (framer_.next(command))
+    handle_command(command);
+
+  if (framer_.overflowed()) {
+    WARNING("Dropping client sending a message of more than %d bytes",
+            MessageFramer::default_max_message_size);
+    return false;
+  }
 
   return true;
 }
 
-void CameraMessageProcessor::process_commands() {
-  while (buffer_.size() > 0) {
-    size_t size = 0;
-    while (size < buffer_.size()) {
-      if (buffer_.at(size) == 0x0) break;
-      size++;
+void CameraMessageProcessor::handle_command(const std::string &command) {
+  // Queries are a name followed by parameters like 'dim=640x480'.
+  const auto tokens = utils::string_split(command, ' ');
+  if (tokens.empty()) return;
+
+  std::map<std::string, std::string> params;
+  for (std::size_t n = 1; n < tokens.size(); n++) {
+    const auto sep = tokens[n].find('=');
+    if (sep == std::string::npos)
+      params[tokens[n]] = "";
+    else
+      params[tokens[n].substr(0, sep)] = tokens[n].substr(sep + 1);
+  }
+
+  const auto &name = tokens[0];
+  if (name == "list")
+    list();
+  else if (name == "connect")
+    connect();
+  else if (name == "disconnect")
+    disconnect();
+  else if (name == "start")
+    start(params);
+  else if (name == "stop")
+    stop();
+  else if (name == "ring")
+    ring();
+  else if (name == "frame")
+    frame(params);
+  else
+    reply(false, "Unknown query");
+}
+
+void CameraMessageProcessor::list() {
+  // Every camera is described on a line of its own.
+  std::string list;
+  if (host_cameras_) {
+    for (const auto &path : camera::V4l2Device::available_devices()) {
+      try {
+        camera::V4l2Device device(path);
+        std::string dims;
+        for (const auto &size : device.frame_sizes()) {
+          if (!dims.empty()) dims += ",";
+          dims += utils::string_format("%dx%d", size.width, size.height);
+        }
+        if (dims.empty()) continue;
+
+        // Without knowing better the first one is most likely the one
+        // built into the screen of a laptop.
+        list += utils::string_format("name=%s framedims=%s dir=%s\n", path, dims,
+                                     list.empty() ? "front" : "back");
+      } catch (std::exception &err) {
+        WARNING("Not exposing camera %s: %s", path, err.what());
+      }
     }
+  }
 
-    std::string command;
-    command.insert(0, reinterpret_cast<const char *>(buffer_.data()), size);
-    buffer_.erase(buffer_.begin(), buffer_.begin() + size + 1);
+  // A single EOL is what Android takes as an empty list.
+  reply(true, list.empty() ? "\n" : list);
+}
 
-    handle_command(command);
+void CameraMessageProcessor::connect() {
+  if (device_name_.empty()) {
+    reply(false, "Not connected to a camera");
+    return;
+  }
+
+  // The name comes from the guest, only cameras list() offers may be
+  // opened.
+  if (!host_cameras_ || !is_host_camera(device_name_)) {
+    WARNING("Refusing to open %s as camera", device_name_);
+    reply(false, "Unknown camera");
+    return;
   }
+
+  if (!device_) {
+    try {
+      device_.reset(new camera::V4l2Device(device_name_));
+    } catch (std::exception &err) {
+      ERROR("Failed to open camera %s: %s", device_name_, err.what());
+      reply(false, err.what());
+      return;
+    }
+  }
+  reply(true);
 }
 
-void CameraMessageProcessor::handle_command(const std::string &command) {
-  if (command == "list") list();
+void CameraMessageProcessor::disconnect() {
+  stop_capture();
+  device_.reset();
+  reply(true);
 }
 
-void CameraMessageProcessor::list() {
-  char buf[5];
-  snprintf(buf, 5, "\n");
-  messenger_->send(buf, strlen(buf));
+void CameraMessageProcessor::start(const std::map<std::string, std::string> &params) {
+  if (!device_) {
+    reply(false, "Camera is not connected");
+    return;
+  }
+
+  stop_capture();
+
+  const auto dim = params.find("dim");
+  if (dim == params.end() ||
+      std::sscanf(dim->second.c_str(), "%ux%u", &width_, &height_) != 2) {
+    reply(false, "Invalid frame dimensions");
+    return;
+  }
+
+  pixel_format_ = to_number(params, "pix");
+  video_size_ = camera::frame_size(pixel_format_, width_, height_);
+  preview_size_ = camera::frame_size(V4L2_PIX_FMT_RGB32, width_, height_);
+  if (!camera::is_target_format(pixel_format_) || video_size_ == 0) {
+    reply(false, "Unsupported pixel format or frame dimensions");
+    return;
+  }
+
+  try {
+    device_->start(camera::V4l2Device::Size{width_, height_});
+    ring_.reset(new camera::FrameRing(video_size_ + preview_size_));
+  } catch (std::exception &err) {
+    ERROR("Failed to start camera %s: %s", device_name_, err.what());
+    device_->stop();
+    reply(false, err.what());
+    return;
+  }
+
+  // Android asks for a frame right away, which is black until the camera
+  // delivered its first one.
+  auto slot = ring_->begin_write();
+  camera::fill_black(pixel_format_, slot, width_, height_);
+  camera::fill_black(V4L2_PIX_FMT_RGB32, slot + video_size_, width_, height_);
+  ring_->end_write();
+
+  capturing_ = true;
+  capture_thread_ = std::thread(&CameraMessageProcessor::capture_frames, this);
+  reply(true);
+}
+
+void CameraMessageProcessor::stop() {
+  stop_capture();
+  reply(true);
+}
+
+void CameraMessageProcessor::stop_capture() {
+  capturing_ = false;
+  if (capture_thread_.joinable())
+    capture_thread_.join();
+  if (device_)
+    device_->stop();
+  ring_.reset();
+}
+
+void CameraMessageProcessor::ring() {
+  if (!ring_) {
+    reply(false, "Camera is not started");
+    return;
+  }
+
+  reply(true, utils::string_format("slots=%d size=%d video=%d preview=%d",
+                                   camera::FrameRing::slot_count, ring_->slot_size(),
+                                   video_size_, preview_size_));
+  try {
+    send_fds(socket_, {ring_->fd()});
+  } catch (std::exception &err) {
+    ERROR("Failed to pass shared camera memory: %s", err.what());
+  }
+}
+
+void CameraMessageProcessor::frame(const std::map<std::string, std::string> &params) {
+  if (!ring_) {
+    reply(false, "Camera is not started");
+    return;
+  }
+
+  // White balance and exposure compensation are left to the host camera.
+  const auto video_size = to_number(params, "video");
+  const auto preview_size = to_number(params, "preview");
+  if ((video_size > 0 && video_size != video_size_) ||
+      (preview_size > 0 && preview_size != preview_size_)) {
+    reply(false, "Frame sizes don't match the started ones");
+    return;
+  }
+
+  // The capture thread leaves the slot alone until the next query, which
+  // is enough time to read it as Android only asks once the last frame
+  // was read.
+  const auto slot = ring_->lend_newest();
+  if (params.count("shm") > 0) {
+    reply(true, utils::string_format("slot=%d", slot));
+    return;
+  }
+
+  const auto frame = ring_->slot(slot);
+  reply_frame(frame, video_size, frame + video_size_, preview_size);
+}
+
+void CameraMessageProcessor::capture_frames() {
+  while (capturing_) {
+    try {
+      device_->next_frame(capture_timeout, [&](const std::uint8_t *data, std::size_t) {
+        auto slot = ring_->begin_write();
+        camera::convert_frame(device_->format(), data, pixel_format_, slot, width_, height_);
+        camera::convert_frame(device_->format(), data, V4L2_PIX_FMT_RGB32,
+                              slot + video_size_, width_, height_);
+        ring_->end_write();
+      });
+    } catch (std::exception &err) {
+      // Android keeps getting the last frame we captured.
+      ERROR("Failed to capture from camera %s: %s", device_name_, err.what());
+      break;
+    }
+  }
+}
+
+void CameraMessageProcessor::reply(bool ok, const std::string &data) {
+  // The status is followed by ':' if there is data and is always zero
+  // terminated.
+  std::string payload = ok ? "ok" : "ko";
+  if (!data.empty())
+    payload += ":" + data;
+  payload.push_back('\0');
+
+  const auto header = utils::string_format("%08x", payload.size());
+  struct iovec iov[2];
+  iov[0].iov_base = const_cast<char *>(header.data());
+  iov[0].iov_len = header.size();
+  iov[1].iov_base = const_cast<char *>(payload.data());
+  iov[1].iov_len = payload.size();
+  messenger_->send_vectored(iov, 2);
+}
+
+void CameraMessageProcessor::reply_frame(const std::uint8_t *video, std::size_t video_size,
+                                         const std::uint8_t *preview, std::size_t preview_size) {
+  static constexpr const char status[] = "ok:";
+  const auto header = utils::string_format(
+      "%08x", std::strlen(status) + video_size + preview_size);
+
+  // Straight from the ring into the socket.
+  struct iovec iov[4];
+  iov[0].iov_base = const_cast<char *>(header.data());
+  iov[0].iov_len = header.size();
+  iov[1].iov_base = const_cast<char *>(status);
+  iov[1].iov_len = std::strlen(status);
+  iov[2].iov_base = const_cast<std::uint8_t *>(video);
+  iov[2].iov_len = video_size;
+  iov[3].iov_base = const_cast<std::uint8_t *>(preview);
+  iov[3].iov_len = preview_size;
+  messenger_->send_vectored(iov, 4);
 }
 }  // namespace qemu
 }  // namespace anbox
@@ -18,29 +18,75 @@
 #ifndef ANBOX_QEMU_CAMERA_MESSAGE_PROCESSOR_H_
 #define ANBOX_QEMU_CAMERA_MESSAGE_PROCESSOR_H_
 
+#include "anbox/common/fd.h"
 #include "anbox/network/message_processor.h"
 #include "anbox/network/socket_messenger.h"
+#include "anbox/qemu/message_framer.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
 
 namespace anbox {
+namespace camera {
+class FrameRing;
+class V4l2Device;
+}  // namespace camera
 namespace qemu {
+// Implements the camera service of the Android emulator. Connected
+// without arguments it's the factory listing the host cameras, connected
+// with 'name=<device>' it streams from that camera.
+//
+// Every query is a zero terminated string and every reply is prefixed
+// with its size as eight hex digits. Besides the emulator queries we
+// support 'ring' which passes the memory frames are captured into so
+// that 'frame ... shm' only has to reply with the slot to read.
 class CameraMessageProcessor : public network::MessageProcessor {
  public:
+  // Host cameras are only listed if |host_cameras| is set.
   CameraMessageProcessor(
-      const std::shared_ptr<network::SocketMessenger> &messenger);
+      const std::shared_ptr<network::SocketMessenger> &messenger,
+      const Fd &socket, const std::string &arguments, bool host_cameras);
   ~CameraMessageProcessor();
 
-  bool process_data(const std::vector<std::uint8_t> &data) override;
+  bool process_data(const std::uint8_t *data, size_t size) override;
 
  private:
-  void process_commands();
-
   void handle_command(const std::string &command);
   void list();
+  void connect();
+  void disconnect();
+  void start(const std::map<std::string, std::string> &params);
+  void stop();
+  void ring();
+  void frame(const std::map<std::string, std::string> &params);
+
+  void stop_capture();
+  void capture_frames();
+
+  void reply(bool ok, const std::string &data = "");
+  void reply_frame(const std::uint8_t *video, std::size_t video_size,
+                   const std::uint8_t *preview, std::size_t preview_size);
 
   std::shared_ptr<network::SocketMessenger> messenger_;
-  std::vector<std::uint8_t> buffer_;
+  Fd socket_;
+  std::string device_name_;
+  bool host_cameras_;
+  MessageFramer framer_;
+
+  std::unique_ptr<camera::V4l2Device> device_;
+  std::unique_ptr<camera::FrameRing> ring_;
+  std::uint32_t width_;
+  std::uint32_t height_;
+  std::uint32_t pixel_format_;
+  std::size_t video_size_;
+  std::size_t preview_size_;
+  std::thread capture_thread_;
+  std::atomic<bool> capturing_;
 };
-}  // namespace graphics
+}  // namespace qemu
 }  // namespace anbox
 
 #endif
@@ -31,11 +31,7 @@ void FingerprintMessageProcessor::handle_command(const std::string &command) {
 }
 
 void FingerprintMessageProcessor::listen() {
-  char buf[12];
-  snprintf(buf, sizeof(buf), "off");
-  send_header(strlen(buf));
-  messenger_->send(buf, strlen(buf));
-  finish_message();
+  send_reply("off");
 }
 }  // namespace qemu
 }  // namespace anbox
@@ -19,8 +19,7 @@
 #include "anbox/logger.h"
 #include "anbox/qemu/at_parser.h"
 
-#include <algorithm>
-#include <functional>
+#include <cstdlib>
 
 using namespace std::placeholders;
 
@@ -28,7 +27,11 @@ namespace anbox {
 namespace qemu {
 GsmMessageProcessor::GsmMessageProcessor(
     const std::shared_ptr<network::SocketMessenger> &messenger)
-    : messenger_(messenger), parser_(std::make_shared<AtParser>()) {
+    : messenger_(messenger),
+      framer_(MessageFramer::Framing::Line),
+      parser_(std::make_shared<AtParser>()),
+      creg_mode_(0),
+      cgreg_mode_(0) {
   auto ok_reply = [&](const std::string &) { send_reply("OK"); };
 
   parser_->register_command("E0Q0V1", ok_reply);
@@ -54,30 +57,88 @@ GsmMessageProcessor::GsmMessageProcessor(
       "+CGREG", std::bind(&GsmMessageProcessor::handle_cgreg, this, _1));
   parser_->register_command(
       "+CFUN", std::bind(&GsmMessageProcessor::handle_cfun, this, _1));
+  parser_->register_command(
+      "+CSQ", std::bind(&GsmMessageProcessor::handle_csq, this, _1));
 }
 
 GsmMessageProcessor::~GsmMessageProcessor() {}
 
-bool GsmMessageProcessor::process_data(const std::vector<std::uint8_t> &data) {
-  for (const auto &byte : data) buffer_.push_back(byte);
+bool GsmMessageProcessor::process_data(const std::uint8_t *data,
+                                       size_t size) {
+  framer_.append(data, size);
+
+  std::string command;
+  while (framer_.next(command))
+    parser_->process_command(command);
+
+  if (framer_.overflowed()) {
+    WARNING("Dropping client sending a message of more than %d bytes",
+            MessageFramer::default_max_message_size);
+    return false;
+  }
 
-  parser_->process_data(buffer_);
   return true;
 }
 
+void GsmMessageProcessor::set_network_state(const NetworkState &state) {
+  std::vector<std::string> unsolicited;
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    const auto old = state_;
+    if (old.status == state.status && old.tech == state.tech &&
+        old.signal_strength == state.signal_strength)
+      return;
+
+    state_ = state;
+    replies_.clear();
+
+    if (old.status != state.status) {
+      if (creg_mode_ > 0)
+        unsolicited.push_back(utils::string_format("+CREG: %d", static_cast<int>(state.status)));
+      if (cgreg_mode_ > 0)
+        unsolicited.push_back(utils::string_format("+CGREG: %d", static_cast<int>(state.status)));
+    }
+    if (old.tech != state.tech)
+      unsolicited.push_back(utils::string_format("+CTEC: %d", static_cast<int>(state.tech)));
+    if (old.signal_strength != state.signal_strength)
+      unsolicited.push_back(utils::string_format("+CSQ: %d,99", state.signal_strength));
+  }
+
+  for (const auto &message : unsolicited)
+    send_unsolicited(message);
+}
+
 void GsmMessageProcessor::send_reply(const std::string &message) {
-  auto reply = utils::string_format("%s\rOK\n", message);
-  std::vector<std::uint8_t> data;
-  std::copy(reply.begin(), reply.end(), std::back_inserter(data));
-  messenger_->send(reinterpret_cast<const char *>(data.data()), data.size());
+  const auto reply = utils::string_format("%s\rOK\n", message);
+  messenger_->send(reply.data(), reply.size());
+}
+
+void GsmMessageProcessor::send_state_reply(
+    const std::string &command,
+    const std::function<std::string(const NetworkState &)> &format) {
+  std::string reply;
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    auto &cached = replies_[command];
+    if (cached.empty())
+      cached = utils::string_format("%s\rOK\n", format(state_));
+    reply = cached;
+  }
+  messenger_->send(reply.data(), reply.size());
+}
+
+void GsmMessageProcessor::send_unsolicited(const std::string &message) {
+  const auto data = utils::string_format("%s\r\n", message);
+  messenger_->send(data.data(), data.size());
 }
 
 void GsmMessageProcessor::handle_ctec(const std::string &command) {
   if (command == "+CTEC=?")
     send_reply("+CTEC: 0,1,2,3");
   else if (command == "+CTEC?")
-    send_reply(utils::string_format(
-        "+CTEC: %d,%x", static_cast<unsigned int>(technology::gsm), 0x0f));
+    send_state_reply(command, [](const NetworkState &state) {
+      return utils::string_format("+CTEC: %d,%x", static_cast<unsigned int>(state.tech), 0x0f);
+    });
 }
 
 void GsmMessageProcessor::handle_cmgf(const std::string &command) {
@@ -85,21 +146,37 @@ void GsmMessageProcessor::handle_cmgf(const std::string &command) {
 }
 
 void GsmMessageProcessor::handle_creg(const std::string &command) {
-  if (command == "+CREG=?")
+  if (command == "+CREG=?") {
     send_reply("+CREG: (0-2)");
-  else if (command == "+CREG?")
-    send_reply(utils::string_format("+CREF: %d,%d", 0, 0));
-  else if (utils::string_starts_with(command, "+CREG="))
+  } else if (command == "+CREG?") {
+    send_state_reply(command, [this](const NetworkState &state) {
+      return utils::string_format("+CREG: %d,%d", creg_mode_, static_cast<int>(state.status));
+    });
+  } else if (utils::string_starts_with(command, "+CREG=")) {
+    {
+      std::lock_guard<std::mutex> l(lock_);
+      creg_mode_ = std::atoi(command.c_str() + 6);
+      replies_.erase("+CREG?");
+    }
     send_reply("");
+  }
 }
 
 void GsmMessageProcessor::handle_cgreg(const std::string &command) {
-  if (command == "+CGREG=?")
+  if (command == "+CGREG=?") {
     send_reply("+CGREG: (0-2)");
-  else if (command == "+CGREG?")
-    send_reply(utils::string_format("+CGREG: %d,%d", 0, 0));
-  else if (utils::string_starts_with(command, "+CGREG="))
+  } else if (command == "+CGREG?") {
+    send_state_reply(command, [this](const NetworkState &state) {
+      return utils::string_format("+CGREG: %d,%d", cgreg_mode_, static_cast<int>(state.status));
+    });
+  } else if (utils::string_starts_with(command, "+CGREG=")) {
+    {
+      std::lock_guard<std::mutex> l(lock_);
+      cgreg_mode_ = std::atoi(command.c_str() + 7);
+      replies_.erase("+CGREG?");
+    }
     send_reply("");
+  }
 }
 
 void GsmMessageProcessor::handle_cfun(const std::string &command) {
@@ -108,5 +185,12 @@ void GsmMessageProcessor::handle_cfun(const std::string &command) {
   else if (utils::string_starts_with(command, "+CFUN="))
     send_reply("");
 }
+
+void GsmMessageProcessor::handle_csq(const std::string &command) {
+  if (command == "+CSQ")
+    send_state_reply(command, [](const NetworkState &state) {
+      return utils::string_format("+CSQ: %d,99", state.signal_strength);
+    });
+}
 }  // namespace qemu
 }  // namespace anbox
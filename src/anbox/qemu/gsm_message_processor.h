@@ -20,19 +20,23 @@
 
 #include "anbox/network/message_processor.h"
 #include "anbox/network/socket_messenger.h"
+#include "anbox/qemu/message_framer.h"
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 
 namespace anbox {
 namespace qemu {
 class AtParser;
+// Answers the AT commands the guest RIL sends. It polls registration
+// and signal state all the time while that barely ever changes, so the
+// replies to queries are kept until set_network_state() changes what
+// they report. Changes are also sent unsolicited, as far as the guest
+// asked for them, so that it can poll less often.
 class GsmMessageProcessor : public network::MessageProcessor {
  public:
-  GsmMessageProcessor(
-      const std::shared_ptr<network::SocketMessenger> &messenger);
-  ~GsmMessageProcessor();
-
-  bool process_data(const std::vector<std::uint8_t> &data) override;
-
- private:
   enum class technology {
     gsm = 0,
     wcdm,
@@ -42,17 +46,58 @@ class GsmMessageProcessor : public network::MessageProcessor {
     unknown,
   };
 
+  // As 3GPP TS 27.007 defines them for +CREG and +CGREG.
+  enum class registration {
+    not_registered = 0,
+    home = 1,
+    searching = 2,
+    denied = 3,
+    unknown = 4,
+    roaming = 5,
+  };
+
+  struct NetworkState {
+    registration status = registration::not_registered;
+    technology tech = technology::gsm;
+    // As +CSQ reports it, 0 to 31 or 99 when not known.
+    int signal_strength = 99;
+  };
+
+  GsmMessageProcessor(
+      const std::shared_ptr<network::SocketMessenger> &messenger);
+  ~GsmMessageProcessor();
+
+  bool process_data(const std::uint8_t *data, size_t size) override;
+
+  // Safe to call from any thread.
+  void set_network_state(const NetworkState &state);
+
+ private:
   void send_reply(const std::string &message);
+  // Replies to |command| with what |format| returns for the current
+  // state, which is only asked for after the state changed.
+  void send_state_reply(const std::string &command,
+                        const std::function<std::string(const NetworkState &)> &format);
+  void send_unsolicited(const std::string &message);
 
   void handle_ctec(const std::string &command);
   void handle_cmgf(const std::string &command);
   void handle_creg(const std::string &command);
   void handle_cgreg(const std::string &command);
   void handle_cfun(const std::string &command);
+  void handle_csq(const std::string &command);
 
   std::shared_ptr<network::SocketMessenger> messenger_;
-  std::vector<std::uint8_t> buffer_;
+  MessageFramer framer_;
   std::shared_ptr<AtParser> parser_;
+
+  std::mutex lock_;
+  NetworkState state_;
+  // What +CREG= and +CGREG= asked for, 0 means no unsolicited results.
+  int creg_mode_;
+  int cgreg_mode_;
+  // Complete replies by the command they answer.
+  std::unordered_map<std::string, std::string> replies_;
 };
 }  // namespace graphics
 }  // namespace anbox
@@ -16,17 +16,50 @@
  */
 
 #include "anbox/qemu/hwcontrol_message_processor.h"
+#include "anbox/container/memory_pressure.h"
+#include "anbox/config.h"
 #include "anbox/logger.h"
 
+#include <fstream>
+#include <iterator>
+
 namespace anbox {
 namespace qemu {
+constexpr std::chrono::milliseconds HwControlMessageProcessor::pressure_period;
+
 HwControlMessageProcessor::HwControlMessageProcessor(
     const std::shared_ptr<network::SocketMessenger> &messenger)
-    : QemudMessageProcessor(messenger) {}
+    : QemudMessageProcessor(messenger), running_(false) {}
 
-HwControlMessageProcessor::~HwControlMessageProcessor() {}
+HwControlMessageProcessor::~HwControlMessageProcessor() {
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    running_ = false;
+    changed_.notify_all();
+  }
+  if (reporter_.joinable())
+    reporter_.join();
+}
 
 void HwControlMessageProcessor::handle_command(const std::string &command) {
+  if (command == "memory:pressure:listen") {
+    std::lock_guard<std::mutex> l(lock_);
+    if (running_)
+      return;
+
+    const auto path = container::MemoryPressure::path_for(
+        SystemConfiguration::instance().instance_name());
+    if (path.empty()) {
+      WARNING("Host kernel doesn't report memory pressure, Android won't know about it");
+      return;
+    }
+    DEBUG("Reporting memory pressure from %s", path);
+
+    running_ = true;
+    reporter_ = std::thread(&HwControlMessageProcessor::report_memory_pressure, this, path);
+    return;
+  }
+
 #if 0
     if (command == "power:screen_state:wake")
         DEBUG("Got screen wake command");
@@ -40,5 +73,44 @@ void HwControlMessageProcessor::handle_command(const std::string &command) {
   (void)command;
 #endif
 }
+
+void HwControlMessageProcessor::report_memory_pressure(const std::string &path) {
+  bool reported = false;
+  auto last_level = container::MemoryPressure::Level::none;
+
+  std::unique_lock<std::mutex> l(lock_);
+  while (running_) {
+    l.unlock();
+
+    std::string text;
+    {
+      std::ifstream in(path);
+      text.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    container::MemoryPressure pressure;
+    if (!container::MemoryPressure::parse(text, pressure)) {
+      WARNING("Failed to read memory pressure from %s", path);
+      l.lock();
+      break;
+    }
+
+    const auto level = pressure.level();
+    if (!reported || level != last_level) {
+      try {
+        send_message("memory:pressure:" + container::to_string(level));
+      } catch (const std::exception &err) {
+        ERROR("Failed to send memory pressure: %s", err.what());
+        l.lock();
+        break;
+      }
+      reported = true;
+      last_level = level;
+    }
+
+    l.lock();
+    changed_.wait_for(l, pressure_period, [&]() { return !running_; });
+  }
+}
 }  // namespace qemu
 }  // namespace anbox
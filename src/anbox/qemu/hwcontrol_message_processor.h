@@ -20,16 +20,38 @@
 
 #include "anbox/qemu/qemud_message_processor.h"
 
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 namespace anbox {
 namespace qemu {
+// Besides the commands of the power and lights HALs, which we ignore, this
+// tells Android about memory pressure on the host.
+//
+// Once a client sent 'memory:pressure:listen' the PSI of the cgroup the
+// container runs in is sampled every |pressure_period| and every change of
+// its level is sent as 'memory:pressure:<none|low|medium|critical>', the
+// first one right away.
 class HwControlMessageProcessor : public QemudMessageProcessor {
  public:
+  static constexpr std::chrono::milliseconds pressure_period{1000};
+
   HwControlMessageProcessor(
       const std::shared_ptr<network::SocketMessenger> &messenger);
   ~HwControlMessageProcessor();
 
  protected:
   void handle_command(const std::string &command) override;
+
+ private:
+  void report_memory_pressure(const std::string &path);
+
+  std::mutex lock_;
+  std::condition_variable changed_;
+  bool running_;
+  std::thread reporter_;
 };
 }  // namespace graphics
 }  // namespace anbox
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "anbox/qemu/message_framer.h"
+#include "anbox/logger.h"
+
+#include <algorithm>
+
+namespace {
+constexpr std::size_t qemud_header_size{4};
+
+int hex_value(std::uint8_t c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+}  // namespace
+
+namespace anbox {
+namespace qemu {
+constexpr std::size_t MessageFramer::default_max_message_size;
+
+MessageFramer::MessageFramer(Framing framing, std::size_t max_message_size)
+    : framing_(framing), max_message_size_(max_message_size), offset_(0), scanned_(0) {}
+
+void MessageFramer::append(const std::uint8_t *data, std::size_t size) {
+  compact();
+  buffer_.insert(buffer_.end(), data, data + size);
+}
+
+bool MessageFramer::next(std::string &message) {
+  if (framing_ == Framing::Qemud)
+    return next_qemud(message);
+  return next_terminated(message);
+}
+
+bool MessageFramer::next_qemud(std::string &message) {
+  if (pending() < qemud_header_size)
+    return false;
+
+  std::size_t size = 0;
+  for (std::size_t n = 0; n < qemud_header_size; n++) {
+    const auto value = hex_value(buffer_[offset_ + n]);
+    if (value < 0) {
+      WARNING("Dropping %d bytes after malformed qemud header", pending());
+      buffer_.clear();
+      offset_ = 0;
+      return false;
+    }
+    size = (size << 4) | static_cast<std::size_t>(value);
+  }
+
+  if (pending() - qemud_header_size < size)
+    return false;
+
+  const auto begin = buffer_.data() + offset_ + qemud_header_size;
+  message.assign(reinterpret_cast<const char *>(begin), size);
+  offset_ += qemud_header_size + size;
+  return true;
+}
+
+bool MessageFramer::next_terminated(std::string &message) {
+  const auto is_terminator = [&](std::uint8_t c) {
+    if (framing_ == Framing::NullTerminated) return c == 0;
+    return c == '\n' || c == '\r';
+  };
+
+  const auto begin = buffer_.begin() + std::max(offset_, scanned_);
+  const auto end = std::find_if(begin, buffer_.end(), is_terminator);
+  if (end == buffer_.end()) {
+    scanned_ = buffer_.size();
+    return false;
+  }
+
+  const auto size = static_cast<std::size_t>(end - buffer_.begin()) - offset_;
+  message.assign(reinterpret_cast<const char *>(buffer_.data() + offset_), size);
+  offset_ += size + 1;
+  scanned_ = offset_;
+  return true;
+}
+
+void MessageFramer::compact() {
+  if (offset_ == 0)
+    return;
+
+  if (offset_ == buffer_.size()) {
+    buffer_.clear();
+  } else if (offset_ >= buffer_.size() / 2) {
+    buffer_.erase(buffer_.begin(), buffer_.begin() + offset_);
+    scanned_ -= std::min(scanned_, offset_);
+  } else {
+    return;
+  }
+  offset_ = 0;
+  if (buffer_.empty())
+    scanned_ = 0;
+}
+}  // namespace qemu
+}  // namespace anbox
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef ANBOX_QEMU_MESSAGE_FRAMER_H_
+#define ANBOX_QEMU_MESSAGE_FRAMER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace anbox {
+namespace qemu {
+// Splits what a qemu pipe client sends into messages.
+//
+// Consumed messages are only skipped over with a cursor and the data
+// behind it is moved to the front once it makes up less than half of the
+// buffer, so every byte is copied a constant number of times no matter
+// how many messages a single read carried. Terminators are searched for
+// only in data which wasn't searched before.
+class MessageFramer {
+ public:
+  enum class Framing {
+    // Prefixed with the size of the message as four hex digits.
+    Qemud,
+    // Terminated by a zero byte.
+    NullTerminated,
+    // Terminated by '\n' or '\r'.
+    Line,
+  };
+
+  // Larger than any message of the qemu services. The size of a qemud
+  // message can't exceed it anyway.
+  static constexpr std::size_t default_max_message_size{64 * 1024};
+
+  explicit MessageFramer(Framing framing,
+                         std::size_t max_message_size = default_max_message_size);
+
+  void append(const std::uint8_t *data, std::size_t size);
+
+  // Returns false if there is no complete message left. A malformed qemud
+  // header drops everything received as we can't find the next message
+  // anymore.
+  bool next(std::string &message);
+
+  // Bytes received which aren't part of a returned message yet.
+  std::size_t pending() const { return buffer_.size() - offset_; }
+
+  // Whether the incomplete message left once next() returned false got
+  // larger than the limit. Its end won't be found without buffering
+  // whatever the client sends, so the client has to be dropped.
+  bool overflowed() const { return pending() > max_message_size_; }
+
+ private:
+  bool next_qemud(std::string &message);
+  bool next_terminated(std::string &message);
+  void compact();
+
+  Framing framing_;
+  std::size_t max_message_size_;
+  std::vector<std::uint8_t> buffer_;
+  std::size_t offset_;
+  // Where the search for the next terminator continues.
+  std::size_t scanned_;
+};
+}  // namespace qemu
+}  // namespace anbox
+
+#endif
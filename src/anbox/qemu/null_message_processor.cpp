@@ -27,8 +27,10 @@ NullMessageProcessor::NullMessageProcessor() {}
 
 NullMessageProcessor::~NullMessageProcessor() {}
 
-bool NullMessageProcessor::process_data(const std::vector<std::uint8_t> &data) {
+bool NullMessageProcessor::process_data(const std::uint8_t *data,
+                                        size_t size) {
   (void)data;
+  (void)size;
   return true;
 }
 }  // namespace qemu
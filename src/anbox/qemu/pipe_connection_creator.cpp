@@ -15,12 +15,19 @@
  *
  */
 
+#include <algorithm>
+#include <cstring>
 #include <string>
 
+#include "anbox/common/boot_timeline.h"
 #include "anbox/graphics/opengles_message_processor.h"
 #include "anbox/logger.h"
+#include "anbox/graphics/emugl/Renderer.h"
+#include "anbox/graphics/emugl/RenderThreadPool.h"
+#include "anbox/network/handshake.h"
 #include "anbox/network/local_socket_messenger.h"
 #include "anbox/qemu/adb_message_processor.h"
+#include "anbox/qemu/boot_properties.h"
 #include "anbox/qemu/boot_properties_message_processor.h"
 #include "anbox/qemu/bootanimation_message_processor.h"
 #include "anbox/qemu/camera_message_processor.h"
@@ -30,10 +37,19 @@
 #include "anbox/qemu/null_message_processor.h"
 #include "anbox/qemu/pipe_connection_creator.h"
 #include "anbox/qemu/sensors_message_processor.h"
+#include "anbox/utils.h"
 
-namespace ba = boost::asio;
+#include "SharedBufferMemory.h"
+
+#include <sys/socket.h>
 
 namespace {
+constexpr std::size_t max_header_size{4096};
+
+// Android connects a few GL clients right away while booting and apps keep
+// creating and destroying GL threads later on.
+constexpr std::size_t prewarmed_render_threads{2};
+
 std::string client_type_to_string(
     const anbox::qemu::PipeConnectionCreator::client_type &type) {
   switch (type) {
@@ -55,6 +71,10 @@ std::string client_type_to_string(
       return "adb";
     case anbox::qemu::PipeConnectionCreator::client_type::bootanimation:
       return "boot-animation";
+    case anbox::qemu::PipeConnectionCreator::client_type::gralloc_memory:
+      return "gralloc-memory";
+    case anbox::qemu::PipeConnectionCreator::client_type::buffer_memory:
+      return "buffer-memory";
     case anbox::qemu::PipeConnectionCreator::client_type::invalid:
       break;
     default:
@@ -62,15 +82,51 @@ std::string client_type_to_string(
   }
   return "unknown";
 }
+
+anbox::network::AdaptiveBufferSize::Policy receive_buffer_policy_for(
+    const anbox::qemu::PipeConnectionCreator::client_type &type) {
+  switch (type) {
+    case anbox::qemu::PipeConnectionCreator::client_type::opengles:
+      // Texture uploads and vertex data easily come in multiple megabytes
+      return {256 * 1024, 64 * 1024, 4 * 1024 * 1024};
+    case anbox::qemu::PipeConnectionCreator::client_type::qemud_sensors:
+      // Sensor clients only ever send short commands
+      return {1024, 512, 4096};
+    case anbox::qemu::PipeConnectionCreator::client_type::qemud_adb:
+      // adb push streams whole packages
+      return {64 * 1024, 16 * 1024, 1024 * 1024};
+    default:
+      break;
+  }
+  return anbox::network::AdaptiveBufferSize::default_policy();
+}
 }
 namespace anbox {
 namespace qemu {
-PipeConnectionCreator::PipeConnectionCreator(const std::shared_ptr<Renderer> &renderer, const std::shared_ptr<Runtime> &rt)
+constexpr std::size_t GlClientMemory::default_max_idle_render_threads;
+
+PipeConnectionCreator::PipeConnectionCreator(const std::shared_ptr<Renderer> &renderer, const std::shared_ptr<Runtime> &rt,
+                                             const std::shared_ptr<graphics::StreamCapture> &capture,
+                                             bool host_cameras, bool host_sensors,
+                                             const std::shared_ptr<const BootProperties> &boot_properties,
+                                             const GlClientMemory &gl_memory)
     : renderer_(renderer),
+      render_threads_(std::make_shared<RenderThreadPool>(renderer, gl_memory.max_idle_render_threads)),
       runtime_(rt),
+      capture_(capture),
       next_connection_id_(0),
+      // Uploading straight from guest memory is opt-in until it got more
+      // exposure with the different host drivers.
+      shared_buffers_enabled_(utils::is_env_set("ANBOX_GL_SHARED_BUFFERS")),
+      host_cameras_(host_cameras),
+      host_sensors_(host_sensors),
+      boot_properties_(boot_properties
+                           ? boot_properties
+                           : std::make_shared<BootProperties>(BootProperties::query_host())),
+      gl_memory_(gl_memory),
       connections_(
           std::make_shared<network::Connections<network::SocketConnection>>()) {
+  render_threads_->prewarm(std::min(prewarmed_render_threads, gl_memory_.max_idle_render_threads));
 }
 
 PipeConnectionCreator::~PipeConnectionCreator() {
@@ -80,34 +136,75 @@ PipeConnectionCreator::~PipeConnectionCreator() {
 void PipeConnectionCreator::create_connection_for(
     std::shared_ptr<boost::asio::local::stream_protocol::socket> const
         &socket) {
+  // The client will identify itself as first thing by writing a string
+  // in the format 'pipe:<name>[:<arguments>]\0' to the channel. Like all
+  // other handshake steps it is read asynchronously so that slow clients
+  // don't hold up the runtime.
+  network::Handshake::read_until(
+      runtime_->service(), socket, 0, max_header_size,
+      [this, socket](const boost::system::error_code &err, const std::string &header,
+                     const std::vector<Fd> &) {
+        if (err) {
+          WARNING("Failed to read qemu pipe client header: %s", err.message());
+          return;
+        }
+
+        std::string arguments;
+        const auto type = identify_client(header, arguments);
+        if (type == client_type::gralloc_memory) {
+          attach_color_buffer_memory(socket);
+          return;
+        } else if (type == client_type::buffer_memory) {
+          attach_buffer_memory(socket);
+          return;
+        }
+
+        if (type != client_type::opengles) {
+          setup_connection(socket, type, arguments);
+          return;
+        }
+
+        // GL clients send their flags before any command. We don't need
+        // them but they are not part of the command stream.
+        network::Handshake::read(
+            runtime_->service(), socket, sizeof(std::uint32_t),
+            [this, socket, type](const boost::system::error_code &err, const std::string &,
+                                 const std::vector<Fd> &) {
+              if (err) {
+                ERROR("Failed to read GL client flags: %s", err.message());
+                return;
+              }
+              setup_connection(socket, type, "");
+            });
+      });
+}
+
+void PipeConnectionCreator::setup_connection(
+    std::shared_ptr<boost::asio::local::stream_protocol::socket> const &socket,
+    const client_type &type, const std::string &arguments) {
   auto const messenger = std::make_shared<network::LocalSocketMessenger>(socket);
-  const auto type = identify_client(messenger);
-  auto const processor = create_processor(type, messenger);
-  if (!processor)
-    BOOST_THROW_EXCEPTION(std::runtime_error("Unhandled client type"));
+
+  std::shared_ptr<network::MessageProcessor> processor;
+  try {
+    processor = create_processor(type, arguments, socket, messenger);
+  } catch (const std::exception &err) {
+    ERROR("Failed to set up %s client: %s", client_type_to_string(type), err.what());
+    return;
+  }
 
   auto const &connection = std::make_shared<network::SocketConnection>(
       messenger, messenger, next_id(), connections_, processor);
   connection->set_name(client_type_to_string(type));
+  connection->set_handler_statistics(runtime_->handler_statistics());
+  connection->set_receive_buffer_policy(receive_buffer_policy_for(type));
   connections_->add(connection);
   connection->read_next_message();
+
+  common::BootTimeline::instance().mark("qemu_pipe_" + client_type_to_string(type) + "_connected");
 }
 
 PipeConnectionCreator::client_type PipeConnectionCreator::identify_client(
-    std::shared_ptr<network::SocketMessenger> const &messenger) {
-  // The client will identify itself as first thing by writing a string
-  // in the format 'pipe:<name>[:<arguments>]\0' to the channel.
-  std::vector<char> buffer;
-  for (;;) {
-    unsigned char byte[1] = {0};
-    const auto err = messenger->receive_msg(ba::buffer(byte, 1));
-    if (err) break;
-    buffer.push_back(byte[0]);
-    if (byte[0] == 0x0) break;
-  }
-
-  std::string identifier_and_args = buffer.data();
-
+    const std::string &identifier_and_args, std::string &arguments) {
   if (utils::string_starts_with(identifier_and_args, "pipe:opengles"))
     return client_type::opengles;
   // Even if 'boot-properties' is an argument to the service 'qemud' here we
@@ -120,8 +217,13 @@ PipeConnectionCreator::client_type PipeConnectionCreator::identify_client(
     return client_type::qemud_hw_control;
   else if (utils::string_starts_with(identifier_and_args, "pipe:qemud:sensors"))
     return client_type::qemud_sensors;
-  else if (utils::string_starts_with(identifier_and_args, "pipe:qemud:camera"))
+  else if (utils::string_starts_with(identifier_and_args, "pipe:qemud:camera")) {
+    // Cameras are connected to as 'pipe:qemud:camera:name=<device>'.
+    const auto sep = identifier_and_args.find(':', std::strlen("pipe:qemud:camera"));
+    if (sep != std::string::npos)
+      arguments = identifier_and_args.substr(sep + 1);
     return client_type::qemud_camera;
+  }
   else if (utils::string_starts_with(identifier_and_args,
                                      "pipe:qemud:fingerprintlisten"))
     return client_type::qemud_fingerprint;
@@ -130,6 +232,12 @@ PipeConnectionCreator::client_type PipeConnectionCreator::identify_client(
   else if (utils::string_starts_with(identifier_and_args,
                                      "pipe:anbox:bootanimation"))
     return client_type::bootanimation;
+  else if (utils::string_starts_with(identifier_and_args,
+                                     "pipe:anbox:gralloc-memory"))
+    return client_type::gralloc_memory;
+  else if (utils::string_starts_with(identifier_and_args,
+                                     "pipe:anbox:buffer-memory"))
+    return client_type::buffer_memory;
   else if (utils::string_starts_with(identifier_and_args, "pipe:qemud:adb"))
     return client_type::qemud_adb;
 
@@ -138,28 +246,149 @@ PipeConnectionCreator::client_type PipeConnectionCreator::identify_client(
 
 std::shared_ptr<network::MessageProcessor>
 PipeConnectionCreator::create_processor(
-    const client_type &type,
+    const client_type &type, const std::string &arguments,
+    std::shared_ptr<boost::asio::local::stream_protocol::socket> const &socket,
     const std::shared_ptr<network::SocketMessenger> &messenger) {
   if (type == client_type::opengles)
-    return std::make_shared<graphics::OpenGlesMessageProcessor>(renderer_, messenger);
+    return std::make_shared<graphics::OpenGlesMessageProcessor>(render_threads_, messenger, capture_,
+                                                                gl_memory_.stream_buffer_size,
+                                                                messenger->creds().pid());
   else if (type == client_type::qemud_boot_properties)
-    return std::make_shared<qemu::BootPropertiesMessageProcessor>(messenger);
+    return std::make_shared<qemu::BootPropertiesMessageProcessor>(messenger, boot_properties_);
   else if (type == client_type::qemud_hw_control)
     return std::make_shared<qemu::HwControlMessageProcessor>(messenger);
   else if (type == client_type::qemud_sensors)
-    return std::make_shared<qemu::SensorsMessageProcessor>(messenger);
+    return std::make_shared<qemu::SensorsMessageProcessor>(messenger, host_sensors_);
   else if (type == client_type::qemud_camera)
-    return std::make_shared<qemu::CameraMessageProcessor>(messenger);
+    // The socket stays owned by asio.
+    return std::make_shared<qemu::CameraMessageProcessor>(
+        messenger, Fd{IntOwnedFd{socket->native_handle()}}, arguments, host_cameras_);
   else if (type == client_type::qemud_fingerprint)
     return std::make_shared<qemu::FingerprintMessageProcessor>(messenger);
   else if (type == client_type::qemud_gsm)
     return std::make_shared<qemu::GsmMessageProcessor>(messenger);
   else if (type == client_type::qemud_adb)
-    return std::make_shared<qemu::AdbMessageProcessor>(runtime_, messenger);
+    // The socket stays owned by asio.
+    return std::make_shared<qemu::AdbMessageProcessor>(
+        runtime_, messenger, Fd{IntOwnedFd{socket->native_handle()}});
 
   return std::make_shared<qemu::NullMessageProcessor>();
 }
 
+void PipeConnectionCreator::attach_color_buffer_memory(
+    std::shared_ptr<boost::asio::local::stream_protocol::socket> const
+        &socket) {
+  // The gralloc module sends a single request with the file descriptor of
+  // the memory backing a color buffer attached and waits for our answer
+  // before it closes the connection again. See share_buffer_memory() in
+  // android/opengl/system/gralloc/gralloc.cpp for the other side.
+  struct Request {
+    std::uint32_t color_buffer;
+    std::uint32_t size;
+  };
+
+  network::Handshake::read(
+      runtime_->service(), socket, sizeof(Request),
+      [this, socket](const boost::system::error_code &err, const std::string &data,
+                     const std::vector<Fd> &fds) {
+        if (err) {
+          ERROR("Failed to receive shared color buffer memory: %s", err.message());
+          return;
+        } else if (fds.size() != 1) {
+          ERROR("Failed to receive shared color buffer memory: got %d file descriptors instead of 1",
+                fds.size());
+          return;
+        }
+
+        Request request;
+        std::memcpy(&request, data.data(), sizeof(request));
+
+        std::int32_t result = -ENOSYS;
+        if (shared_buffers_enabled_)
+          result = renderer_->attachColorBufferMemory(request.color_buffer, fds[0],
+                                                      request.size)
+                       ? 0
+                       : -EINVAL;
+
+        if (::send(socket->native_handle(), &result, sizeof(result), MSG_NOSIGNAL) !=
+            sizeof(result))
+          WARNING("Failed to reply to shared color buffer request");
+      });
+}
+
+void PipeConnectionCreator::attach_buffer_memory(
+    std::shared_ptr<boost::asio::local::stream_protocol::socket> const
+        &socket) {
+  // GL clients share the memory they stream the content of a buffer object
+  // through with a single request. Unlike for color buffers the connection
+  // stays open for as long as the memory is in use, once the client closes
+  // it the decoders can't look up the memory anymore. See
+  // SharedBufferMemory.cpp in android/opengl/shared/OpenglCodecCommon for
+  // the other side.
+  struct Request {
+    std::uint32_t size;
+  };
+  struct Reply {
+    std::int32_t result;
+    std::uint32_t handle;
+  };
+
+  network::Handshake::read(
+      runtime_->service(), socket, sizeof(Request),
+      [this, socket](const boost::system::error_code &err, const std::string &data,
+                     const std::vector<Fd> &fds) {
+        if (err) {
+          ERROR("Failed to receive shared buffer memory: %s", err.message());
+          return;
+        } else if (fds.size() != 1) {
+          ERROR("Failed to receive shared buffer memory: got %d file descriptors instead of 1",
+                fds.size());
+          return;
+        }
+
+        Request request;
+        std::memcpy(&request, data.data(), sizeof(request));
+
+        // Only GL clients of the process sharing the memory can use it.
+        pid_t owner = 0;
+        try {
+          owner = network::LocalSocketMessenger(socket).creds().pid();
+        } catch (const std::exception &err) {
+          ERROR("Failed to query shared buffer memory owner: %s", err.what());
+        }
+
+        Reply reply{-ENOSYS, 0};
+        if (shared_buffers_enabled_ && owner <= 0) {
+          reply.result = -EPERM;
+        } else if (shared_buffers_enabled_) {
+          const auto memory = SharedBufferMemory::map(fds[0], request.size);
+          if (memory) {
+            reply.result = 0;
+            reply.handle = SharedBufferMemory::add(memory, owner);
+          } else {
+            reply.result = -EINVAL;
+          }
+        }
+
+        if (::send(socket->native_handle(), &reply, sizeof(reply), MSG_NOSIGNAL) !=
+            sizeof(reply))
+          WARNING("Failed to reply to shared buffer memory request");
+
+        if (reply.handle == 0)
+          return;
+
+        // The client never sends anything else, so whatever completes the
+        // read means it is done with the memory.
+        const auto handle = reply.handle;
+        auto byte = std::make_shared<char>(0);
+        socket->async_read_some(
+            boost::asio::buffer(byte.get(), 1),
+            [socket, byte, handle](const boost::system::error_code &, std::size_t) {
+              SharedBufferMemory::remove(handle);
+            });
+      });
+}
+
 int PipeConnectionCreator::next_id() {
   return next_connection_id_.fetch_add(1);
 }
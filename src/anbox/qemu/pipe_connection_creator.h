@@ -23,6 +23,7 @@
 #include <memory>
 
 #include "anbox/do_not_copy_or_move.h"
+#include "anbox/graphics/buffered_io_stream.h"
 #include "anbox/network/connection_creator.h"
 #include "anbox/network/connections.h"
 #include "anbox/network/socket_connection.h"
@@ -30,13 +31,38 @@
 #include "anbox/runtime.h"
 
 class Renderer;
+class RenderThreadPool;
 
 namespace anbox {
+namespace graphics {
+class StreamCapture;
+}  // namespace graphics
 namespace qemu {
+class BootProperties;
+
+// What memory the GL clients of a PipeConnectionCreator may keep around.
+struct GlClientMemory {
+  static constexpr std::size_t default_max_idle_render_threads{4};
+
+  // Commands of a client buffered for its render thread.
+  std::size_t stream_buffer_size = graphics::BufferedIOStream::default_in_buffer_size;
+  // Render threads kept around for the next clients, each holding on to
+  // its decoders.
+  std::size_t max_idle_render_threads = default_max_idle_render_threads;
+};
+
 class PipeConnectionCreator
     : public network::ConnectionCreator<boost::asio::local::stream_protocol> {
  public:
-  PipeConnectionCreator(const std::shared_ptr<Renderer> &renderer, const std::shared_ptr<Runtime> &rt);
+  // If |capture| is set the GL streams of all clients are recorded in it.
+  // Android only sees the cameras of the host with |host_cameras| set and
+  // its sensors with |host_sensors| set. Without |boot_properties| they are
+  // derived from the host right away.
+  PipeConnectionCreator(const std::shared_ptr<Renderer> &renderer, const std::shared_ptr<Runtime> &rt,
+                        const std::shared_ptr<graphics::StreamCapture> &capture = nullptr,
+                        bool host_cameras = false, bool host_sensors = false,
+                        const std::shared_ptr<const BootProperties> &boot_properties = nullptr,
+                        const GlClientMemory &gl_memory = GlClientMemory{});
   ~PipeConnectionCreator() noexcept;
 
   void create_connection_for(
@@ -54,20 +80,40 @@ class PipeConnectionCreator
     qemud_gsm,
     qemud_adb,
     bootanimation,
+    gralloc_memory,
+    buffer_memory,
   };
 
  private:
   int next_id();
 
-  client_type identify_client(
-      std::shared_ptr<network::SocketMessenger> const &messenger);
+  // Stores what follows the name of the service in the client's |header|
+  // in |arguments|.
+  client_type identify_client(const std::string &header, std::string &arguments);
+  void setup_connection(
+      std::shared_ptr<boost::asio::local::stream_protocol::socket> const &socket,
+      const client_type &type, const std::string &arguments);
   std::shared_ptr<network::MessageProcessor> create_processor(
-      const client_type &type,
+      const client_type &type, const std::string &arguments,
+      std::shared_ptr<boost::asio::local::stream_protocol::socket> const &socket,
       const std::shared_ptr<network::SocketMessenger> &messenger);
+  void attach_color_buffer_memory(
+      std::shared_ptr<boost::asio::local::stream_protocol::socket> const
+          &socket);
+  void attach_buffer_memory(
+      std::shared_ptr<boost::asio::local::stream_protocol::socket> const
+          &socket);
 
   std::shared_ptr<Renderer> renderer_;
+  std::shared_ptr<RenderThreadPool> render_threads_;
   std::shared_ptr<Runtime> runtime_;
+  std::shared_ptr<graphics::StreamCapture> capture_;
   std::atomic<int> next_connection_id_;
+  bool shared_buffers_enabled_;
+  bool host_cameras_;
+  bool host_sensors_;
+  std::shared_ptr<const BootProperties> boot_properties_;
+  GlClientMemory gl_memory_;
   std::shared_ptr<network::Connections<network::SocketConnection>> const connections_;
 };
 }  // namespace qemu
@@ -20,6 +20,7 @@
 #include "anbox/utils.h"
 
 #include <string.h>
+#include <sys/uio.h>
 
 namespace {
 static constexpr const long header_size{4};
@@ -29,55 +30,53 @@ namespace anbox {
 namespace qemu {
 QemudMessageProcessor::QemudMessageProcessor(
     const std::shared_ptr<network::SocketMessenger> &messenger)
-    : messenger_(messenger) {}
+    : messenger_(messenger), framer_(MessageFramer::Framing::Qemud) {}
 
 QemudMessageProcessor::~QemudMessageProcessor() {}
 
-bool QemudMessageProcessor::process_data(
-    const std::vector<std::uint8_t> &data) {
-  for (const auto &byte : data) buffer_.push_back(byte);
-
-  process_commands();
-
-  return true;
-}
-
-void QemudMessageProcessor::process_commands() {
-  while (true) {
-    if (buffer_.size() < header_size) break;
-
-    char header[header_size] = {0};
-    ::memcpy(header, buffer_.data(), header_size);
-
-    unsigned int body_size = 0;
-    ::sscanf(header, "%04x", &body_size);
-    if (body_size != buffer_.size() - header_size) break;
-
-    std::string command;
-    // Make sure we only copy as much bytes as we have to and not more
-    command.insert(0,
-                   reinterpret_cast<const char *>(buffer_.data()) + header_size,
-                   body_size);
+bool QemudMessageProcessor::process_data(const std::uint8_t *data,
+                                         size_t size) {
+  framer_.append(data, size);
 
+  std::string command;
+  while (framer_.next(command))
     handle_command(command);
 
-    const auto consumed = header_size + body_size;
-    buffer_.erase(buffer_.begin(), buffer_.begin() + consumed);
-
-    const auto remaining = buffer_.size() - consumed;
-    if (remaining <= 0) break;
+  if (framer_.overflowed()) {
+    WARNING("Dropping client sending a message of more than %d bytes",
+            MessageFramer::default_max_message_size);
+    return false;
   }
+
+  return true;
 }
 
-void QemudMessageProcessor::send_header(const size_t &size) {
+void QemudMessageProcessor::send_message(const std::string &message) {
   char header[header_size + 1];
-  std::snprintf(header, header_size + 1, "%04lx", size);
-  messenger_->send(header, header_size);
+  std::snprintf(header, header_size + 1, "%04lx", message.size());
+
+  struct iovec iov[2];
+  iov[0].iov_base = header;
+  iov[0].iov_len = header_size;
+  iov[1].iov_base = const_cast<char *>(message.data());
+  iov[1].iov_len = message.size();
+  messenger_->send_vectored(iov, 2);
 }
 
-void QemudMessageProcessor::finish_message() {
-  // Send terminating NULL byte
-  messenger_->send(static_cast<const char *>(""), 1);
+void QemudMessageProcessor::send_reply(const std::string &message) {
+  char header[header_size + 1];
+  std::snprintf(header, header_size + 1, "%04lx", message.size());
+
+  // The terminating zero byte isn't covered by the header.
+  static const char terminator = '\0';
+  struct iovec iov[3];
+  iov[0].iov_base = header;
+  iov[0].iov_len = header_size;
+  iov[1].iov_base = const_cast<char *>(message.data());
+  iov[1].iov_len = message.size();
+  iov[2].iov_base = const_cast<char *>(&terminator);
+  iov[2].iov_len = 1;
+  messenger_->send_vectored(iov, 3);
 }
 }  // namespace qemu
 }  // namespace anbox
@@ -20,6 +20,7 @@
 
 #include "anbox/network/message_processor.h"
 #include "anbox/network/socket_messenger.h"
+#include "anbox/qemu/message_framer.h"
 
 namespace anbox {
 namespace qemu {
@@ -29,20 +30,22 @@ class QemudMessageProcessor : public network::MessageProcessor {
       const std::shared_ptr<network::SocketMessenger> &messenger);
   ~QemudMessageProcessor();
 
-  bool process_data(const std::vector<std::uint8_t> &data) override;
+  bool process_data(const std::uint8_t *data, size_t size) override;
 
  protected:
   virtual void handle_command(const std::string &command) = 0;
 
-  void send_header(const size_t &size);
-  void finish_message();
+  // Sends |message| with its header at once so that it can be used from
+  // other threads than the one commands are handled on.
+  void send_message(const std::string &message);
+  // Like send_message() but followed by the zero byte replies to commands
+  // end with, all in a single write.
+  void send_reply(const std::string &message);
 
   std::shared_ptr<network::SocketMessenger> messenger_;
 
  private:
-  void process_commands();
-
-  std::vector<std::uint8_t> buffer_;
+  MessageFramer framer_;
 };
 }  // namespace graphics
 }  // namespace anbox
@@ -15,29 +15,167 @@
  *
  */
 
+
 #include "anbox/qemu/sensors_message_processor.h"
+#include "anbox/sensors/iio_sensor.h"
 #include "anbox/logger.h"
+#include "anbox/utils.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+constexpr std::chrono::milliseconds default_delay{200};
+}  // namespace
 
 namespace anbox {
 namespace qemu {
+constexpr std::chrono::milliseconds SensorsMessageProcessor::min_delay;
+
 SensorsMessageProcessor::SensorsMessageProcessor(
-    const std::shared_ptr<network::SocketMessenger> &messenger)
-    : QemudMessageProcessor(messenger) {}
+    const std::shared_ptr<network::SocketMessenger> &messenger,
+    bool host_sensors)
+    : QemudMessageProcessor(messenger), delay_(default_delay), running_(true) {
+  if (!host_sensors)
+    return;
+
+  // Only the first sensor of each type is used.
+  for (const auto &sensor : sensors::IioSensor::find_all()) {
+    Id id = Id::Acceleration;
+    switch (sensor->type()) {
+      case sensors::IioSensor::Type::Accelerometer:
+        id = Id::Acceleration;
+        break;
+      case sensors::IioSensor::Type::Gyroscope:
+        id = Id::Gyroscope;
+        break;
+      case sensors::IioSensor::Type::Light:
+        id = Id::Light;
+        break;
+    }
+    sensors_.insert({id, sensor});
+  }
+}
 
-SensorsMessageProcessor::~SensorsMessageProcessor() {}
+SensorsMessageProcessor::~SensorsMessageProcessor() {
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    running_ = false;
+    changed_.notify_all();
+  }
+  if (reader_.joinable())
+    reader_.join();
+}
+
+std::string SensorsMessageProcessor::format_event(const sensors::IioSensor &sensor,
+                                                  const std::array<float, 3> &values) {
+  switch (sensor.type()) {
+    case sensors::IioSensor::Type::Accelerometer:
+      return utils::string_format("acceleration:%g:%g:%g", values[0], values[1], values[2]);
+    case sensors::IioSensor::Type::Gyroscope:
+      return utils::string_format("gyroscope:%g:%g:%g", values[0], values[1], values[2]);
+    case sensors::IioSensor::Type::Light:
+      return utils::string_format("light:%g", values[0]);
+  }
+  return "";
+}
 
 void SensorsMessageProcessor::handle_command(const std::string &command) {
-  if (command == "list-sensors") list_sensors();
+  if (command == "list-sensors") {
+    list_sensors();
+  } else if (utils::string_starts_with(command, "set:")) {
+    // set:<name>:<0|1>
+    const auto sep = command.rfind(':');
+    set_enabled(command.substr(4, sep - 4), command.substr(sep + 1) == "1");
+  } else if (utils::string_starts_with(command, "set-delay:")) {
+    set_delay(std::chrono::milliseconds{std::atoi(command.c_str() + 10)});
+  }
 }
 
 void SensorsMessageProcessor::list_sensors() {
-  // We don't support sensors yet so we mark all as disabled
   int mask = 0;
-  char buf[12];
-  snprintf(buf, sizeof(buf), "%d", mask);
-  send_header(strlen(buf));
-  messenger_->send(buf, strlen(buf));
-  finish_message();
+  for (const auto &sensor : sensors_)
+    mask |= 1 << static_cast<int>(sensor.first);
+
+  send_reply(std::to_string(mask));
+}
+
+void SensorsMessageProcessor::set_enabled(const std::string &name, bool enabled) {
+  Id id = Id::Acceleration;
+  if (name == "acceleration")
+    id = Id::Acceleration;
+  else if (name == "light")
+    id = Id::Light;
+  else if (name == "gyroscope")
+    id = Id::Gyroscope;
+  else
+    return;
+
+  if (sensors_.find(id) == sensors_.end())
+    return;
+
+  std::lock_guard<std::mutex> l(lock_);
+  if (enabled)
+    enabled_.insert(id);
+  else
+    enabled_.erase(id);
+
+  if (!reader_.joinable() && !enabled_.empty())
+    reader_ = std::thread(&SensorsMessageProcessor::read_sensors, this);
+  changed_.notify_all();
+}
+
+void SensorsMessageProcessor::set_delay(const std::chrono::milliseconds &delay) {
+  std::lock_guard<std::mutex> l(lock_);
+  delay_ = std::max(delay, min_delay);
+  changed_.notify_all();
+}
+
+void SensorsMessageProcessor::read_sensors() {
+  std::unique_lock<std::mutex> l(lock_);
+  auto next = std::chrono::steady_clock::now();
+  while (running_) {
+    if (enabled_.empty()) {
+      changed_.wait(l, [&]() { return !running_ || !enabled_.empty(); });
+      next = std::chrono::steady_clock::now();
+      continue;
+    }
+
+    if (changed_.wait_until(l, next, [&]() { return !running_; }))
+      break;
+
+    // After a stall we go on from now rather than catching up with a
+    // burst of samples.
+    const auto now = std::chrono::steady_clock::now();
+    next = std::max(next + delay_, now);
+    const auto enabled = enabled_;
+    l.unlock();
+
+    std::string batch;
+    std::array<float, 3> values;
+    for (const auto id : enabled) {
+      const auto &sensor = sensors_.at(id);
+      if (!sensor->read(values))
+        continue;
+      batch += format_event(*sensor, values);
+      batch += '\n';
+    }
+
+    if (!batch.empty()) {
+      const auto time = std::chrono::duration_cast<std::chrono::microseconds>(
+          now.time_since_epoch());
+      batch += utils::string_format("sync:%lld", static_cast<long long>(time.count()));
+      try {
+        send_message(batch);
+      } catch (const std::exception &err) {
+        ERROR("Failed to send sensor events: %s", err.what());
+        break;
+      }
+    }
+
+    l.lock();
+  }
 }
 }  // namespace qemu
 }  // namespace anbox
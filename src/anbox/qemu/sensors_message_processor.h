@@ -15,26 +15,71 @@
  *
  */
 
+
 #ifndef ANBOX_QEMU_SENSORS_MESSAGE_PROCESSOR_H_
 #define ANBOX_QEMU_SENSORS_MESSAGE_PROCESSOR_H_
 
 #include "anbox/qemu/qemud_message_processor.h"
 
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
 namespace anbox {
+namespace sensors {
+class IioSensor;
+}  // namespace sensors
 namespace qemu {
+// Implements the sensors service of the Android emulator with the IIO
+// sensors of the host.
+//
+// Android enables sensors with 'set:<name>:<0|1>' and picks the rate with
+// 'set-delay:<ms>'. A reader thread then samples all enabled sensors once
+// per period and sends them as a single message, one '<name>:<values>'
+// line per sensor followed by 'sync:<time>', instead of a message for
+// each of them.
 class SensorsMessageProcessor : public QemudMessageProcessor {
  public:
+  // Sampled at most this often however fast Android asks for.
+  static constexpr std::chrono::milliseconds min_delay{5};
+
+  // Android only sees the sensors of the host with |host_sensors| set.
   SensorsMessageProcessor(
-      const std::shared_ptr<network::SocketMessenger> &messenger);
+      const std::shared_ptr<network::SocketMessenger> &messenger,
+      bool host_sensors = false);
   ~SensorsMessageProcessor();
 
+  // Returns the message reporting the |values| of |sensor| as the guest
+  // parses it, without the trailing newline.
+  static std::string format_event(const sensors::IioSensor &sensor,
+                                  const std::array<float, 3> &values);
+
  protected:
   void handle_command(const std::string &command) override;
 
  private:
+  // Sensor ids as used by the Android sensors HAL.
+  enum class Id { Acceleration = 0, Light = 5, Gyroscope = 8 };
+
   void list_sensors();
+  void set_enabled(const std::string &name, bool enabled);
+  void set_delay(const std::chrono::milliseconds &delay);
+  void read_sensors();
+
+  std::map<Id, std::shared_ptr<sensors::IioSensor>> sensors_;
+
+  std::mutex lock_;
+  std::condition_variable changed_;
+  std::set<Id> enabled_;
+  std::chrono::milliseconds delay_;
+  bool running_;
+  std::thread reader_;
 };
-}  // namespace graphics
+}  // namespace qemu
 }  // namespace anbox
 
 #endif
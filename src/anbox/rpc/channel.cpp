@@ -18,76 +18,71 @@
  */
 
 #include "anbox/rpc/channel.h"
-#include "anbox/common/variable_length_array.h"
 #include "anbox/network/message_sender.h"
 #include "anbox/rpc/constants.h"
 #include "anbox/rpc/pending_call_cache.h"
 
-#include "anbox_rpc.pb.h"
+#include <stdexcept>
 
 namespace anbox {
 namespace rpc {
 Channel::Channel(const std::shared_ptr<PendingCallCache> &pending_calls,
-                 const std::shared_ptr<network::MessageSender> &sender)
-    : pending_calls_(pending_calls), sender_(sender) {}
+                 const std::shared_ptr<network::MessageSender> &sender,
+                 const std::shared_ptr<Framing> &framing)
+    : pending_calls_(pending_calls),
+      sender_(sender),
+      framing_(framing),
+      next_id_(0) {}
 
 Channel::~Channel() {}
 
-void Channel::call_method(std::string const &method_name,
-                          google::protobuf::MessageLite const *parameters,
-                          google::protobuf::MessageLite *response,
-                          google::protobuf::Closure *complete) {
-  auto const &invocation = invocation_for(method_name, parameters);
-  pending_calls_->save_completion_details(invocation, response, complete);
-  send_message(MessageType::invocation, invocation);
+std::uint32_t Channel::call_method(
+    std::string const &method_name,
+    google::protobuf::MessageLite const *parameters,
+    google::protobuf::MessageLite *response,
+    google::protobuf::Closure *complete) {
+  std::unique_lock<std::mutex> lock(write_mutex_);
+  const auto id = next_id();
+  send_buffer_.write_invocation(*framing_, id, method_name, *parameters);
+  pending_calls_->save_completion_details(id, response, complete);
+  flush_send_buffer(lock);
+  return id;
 }
 
-void Channel::send_event(google::protobuf::MessageLite const &event) {
-  VariableLengthArray<2048> buffer{static_cast<size_t>(event.ByteSize())};
-  event.SerializeWithCachedSizesToArray(buffer.data());
-
-  anbox::protobuf::rpc::Result response;
-  response.add_events(buffer.data(), buffer.size());
-
-  send_message(MessageType::response, response);
+bool Channel::cancel_call(std::uint32_t id) {
+  return pending_calls_->cancel(id);
 }
 
-protobuf::rpc::Invocation Channel::invocation_for(
-    std::string const &method_name,
-    google::protobuf::MessageLite const *request) {
-  anbox::VariableLengthArray<2048> buffer{
-      static_cast<size_t>(request->ByteSize())};
-
-  request->SerializeWithCachedSizesToArray(buffer.data());
-
-  anbox::protobuf::rpc::Invocation invoke;
-
-  invoke.set_id(next_id());
-  invoke.set_method_name(method_name);
-  invoke.set_parameters(buffer.data(), buffer.size());
-  invoke.set_protocol_version(1);
+void Channel::send_event(google::protobuf::MessageLite const &event) {
+  std::unique_lock<std::mutex> lock(write_mutex_);
+  send_buffer_.write_event(*framing_, event);
+  flush_send_buffer(lock);
+}
 
-  return invoke;
+void Channel::send_raw_event(std::uint16_t kind, size_t size,
+                             const std::function<void(std::uint8_t *)> &write) {
+  std::unique_lock<std::mutex> lock(write_mutex_);
+  write(send_buffer_.write_raw_event(*framing_, kind, size));
+  flush_send_buffer(lock);
 }
 
-void Channel::send_message(const std::uint8_t &type,
-                           google::protobuf::MessageLite const &message) {
-  const size_t size = message.ByteSize();
-  const unsigned char header_bytes[header_size] = {
-      static_cast<unsigned char>((size >> 8) & 0xff),
-      static_cast<unsigned char>((size >> 0) & 0xff), type,
-  };
+void Channel::send_protocol_version() {
+  std::unique_lock<std::mutex> lock(write_mutex_);
+  send_buffer_.write_protocol_version(*framing_, protocol_version);
+  flush_send_buffer(lock);
+}
 
-  std::vector<std::uint8_t> send_buffer(sizeof(header_bytes) + size);
-  std::copy(header_bytes, header_bytes + sizeof(header_bytes),
-            send_buffer.begin());
-  message.SerializeToArray(send_buffer.data() + sizeof(header_bytes), size);
+SendBuffer::Statistics Channel::send_statistics() {
+  std::lock_guard<std::mutex> lock(write_mutex_);
+  return send_buffer_.statistics();
+}
 
+void Channel::flush_send_buffer(std::unique_lock<std::mutex> &lock) {
   try {
-    std::lock_guard<std::mutex> lock(write_mutex_);
-    sender_->send(reinterpret_cast<const char *>(send_buffer.data()),
-                  send_buffer.size());
+    sender_->send(reinterpret_cast<const char *>(send_buffer_.data()),
+                  send_buffer_.size());
   } catch (std::runtime_error const &) {
+    lock.unlock();
     notify_disconnected();
     throw;
   }
@@ -95,9 +90,6 @@ void Channel::send_message(const std::uint8_t &type,
 
 void Channel::notify_disconnected() { pending_calls_->force_completion(); }
 
-std::uint32_t Channel::next_id() {
-  static std::uint32_t next_message_id = 0;
-  return next_message_id++;
-}
+std::uint32_t Channel::next_id() { return next_id_.fetch_add(1); }
 }  // namespace rpc
 }  // namespace anbox
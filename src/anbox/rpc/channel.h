@@ -18,7 +18,11 @@
 #ifndef ANBOX_RPC_CHANNEL_H_
 #define ANBOX_RPC_CHANNEL_H_
 
+#include "anbox/rpc/framing.h"
+#include "anbox/rpc/send_buffer.h"
+
 #include <atomic>
+#include <functional>
 #include <memory>
 #include <mutex>
 
@@ -30,11 +34,6 @@ class MessageLite;
 }  // namespace google
 
 namespace anbox {
-namespace protobuf {
-namespace rpc {
-class Invocation;
-}  // namespace rpc
-}  // namespace protobuf
 namespace network {
 class MessageSender;
 }  // namespace network
@@ -43,28 +42,48 @@ class PendingCallCache;
 class Channel {
  public:
   Channel(const std::shared_ptr<PendingCallCache> &pending_calls,
-          const std::shared_ptr<network::MessageSender> &sender);
+          const std::shared_ptr<network::MessageSender> &sender,
+          const std::shared_ptr<Framing> &framing =
+              std::make_shared<Framing>());
   ~Channel();
 
-  void call_method(std::string const &method_name,
-                   google::protobuf::MessageLite const *parameters,
-                   google::protobuf::MessageLite *response,
-                   google::protobuf::Closure *complete);
+  // Returns the id of the call which can be used to cancel it
+  std::uint32_t call_method(std::string const &method_name,
+                            google::protobuf::MessageLite const *parameters,
+                            google::protobuf::MessageLite *response,
+                            google::protobuf::Closure *complete);
+
+  // Forgets about a pending call without running its completion. Returns
+  // false if the call already completed.
+  bool cancel_call(std::uint32_t id);
 
   void send_event(google::protobuf::MessageLite const &event);
+  // |write| fills in the |size| bytes of the event. Throws unless the
+  // remote side speaks raw_event_protocol_version.
+  void send_raw_event(std::uint16_t kind, size_t size,
+                      const std::function<void(std::uint8_t *)> &write);
+
+  std::uint32_t peer_protocol_version() const {
+    return framing_->peer_protocol_version();
+  }
+
+  // Tells the remote side which protocol version we speak. Uses the
+  // legacy framing so that older peers simply ignore it.
+  void send_protocol_version();
+
+  SendBuffer::Statistics send_statistics();
 
  private:
-  protobuf::rpc::Invocation invocation_for(
-      std::string const &method_name,
-      google::protobuf::MessageLite const *request);
-  void send_message(const std::uint8_t &type,
-                    google::protobuf::MessageLite const &message);
+  void flush_send_buffer(std::unique_lock<std::mutex> &lock);
   std::uint32_t next_id();
   void notify_disconnected();
 
   std::shared_ptr<PendingCallCache> pending_calls_;
   std::shared_ptr<network::MessageSender> sender_;
+  std::shared_ptr<Framing> framing_;
   std::mutex write_mutex_;
+  SendBuffer send_buffer_;
+  std::atomic<std::uint32_t> next_id_;
 };
 }  // namespace rpc
 }  // namespace anbox
@@ -55,6 +55,7 @@ void ConnectionCreator::create_connection_for(
   auto const& connection = std::make_shared<network::SocketConnection>(
       messenger, messenger, next_id(), connections_, processor);
   connection->set_name("rpc");
+  connection->set_handler_statistics(runtime_->handler_statistics());
   connections_->add(connection);
   connection->read_next_message();
 }
@@ -18,14 +18,37 @@
 #ifndef ANBOX_RPC_CONSTANTS_H_
 #define ANBOX_RPC_CONSTANTS_H_
 
+#include <cstddef>
+#include <cstdint>
+
 namespace anbox {
 namespace rpc {
+// Frames start with a 16 bit big endian length followed by the message
+// type. Once both sides speak protocol version 2 the type gets the
+// long_frame_flag set and a 32 bit big endian length follows instead.
 static constexpr const long header_size{3};
-static constexpr unsigned int const serialization_buffer_size{2048};
+static constexpr const long long_header_size{7};
+static constexpr const std::uint8_t long_frame_flag{0x80};
+static constexpr const size_t max_legacy_message_size{0xffff};
+static constexpr const size_t max_message_size{64 * 1024 * 1024};
+
+static constexpr const std::uint32_t legacy_protocol_version{1};
+// Long frames, see long_frame_flag.
+static constexpr const std::uint32_t long_frame_protocol_version{2};
+// Frames of MessageType::raw_event.
+static constexpr const std::uint32_t raw_event_protocol_version{3};
+static constexpr const std::uint32_t protocol_version{3};
+
+// Raw events start with their 16 bit kind in host byte order followed by
+// two reserved bytes. What follows is up to the kind and is handed to the
+// receiver as it came in, without going through protobuf. Both sides of a
+// connection run on the same machine so the byte order matches.
+static constexpr const size_t raw_event_header_size{4};
 
 enum MessageType {
   invocation = 0,
   response = 1,
+  raw_event = 2,
 };
 }  // namespace rpc
 }  // namespace network
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/rpc/framing.h"
+#include "anbox/rpc/constants.h"
+
+namespace anbox {
+namespace rpc {
+Framing::Framing() : peer_protocol_version_(legacy_protocol_version) {}
+
+void Framing::set_peer_protocol_version(std::uint32_t version) {
+  auto current = peer_protocol_version_.load();
+  while (version > current &&
+         !peer_protocol_version_.compare_exchange_weak(current, version)) {
+  }
+}
+
+std::uint32_t Framing::peer_protocol_version() const {
+  return peer_protocol_version_.load();
+}
+
+size_t Framing::write_header(std::uint8_t *header, std::uint8_t type,
+                             size_t size) const {
+  if (peer_protocol_version() < long_frame_protocol_version) {
+    if (size > max_legacy_message_size) return 0;
+
+    header[0] = static_cast<std::uint8_t>((size >> 8) & 0xff);
+    header[1] = static_cast<std::uint8_t>((size >> 0) & 0xff);
+    header[2] = type;
+    return header_size;
+  }
+
+  if (size > max_message_size) return 0;
+
+  header[0] = 0;
+  header[1] = 0;
+  header[2] = type | long_frame_flag;
+  header[3] = static_cast<std::uint8_t>((size >> 24) & 0xff);
+  header[4] = static_cast<std::uint8_t>((size >> 16) & 0xff);
+  header[5] = static_cast<std::uint8_t>((size >> 8) & 0xff);
+  header[6] = static_cast<std::uint8_t>((size >> 0) & 0xff);
+  return long_header_size;
+}
+}  // namespace rpc
+}  // namespace anbox
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_RPC_FRAMING_H_
+#define ANBOX_RPC_FRAMING_H_
+
+#include <atomic>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace anbox {
+namespace rpc {
+// Keeps track of the protocol version the remote side of a connection
+// understands and frames outgoing messages accordingly. One instance is
+// shared between the Channel and the MessageProcessor of a connection.
+class Framing {
+ public:
+  Framing();
+
+  // Only ever raises the version; a peer can't forget what it supports.
+  void set_peer_protocol_version(std::uint32_t version);
+  std::uint32_t peer_protocol_version() const;
+
+  // Writes the header for a message with |type| and |size| bytes into
+  // |header| which needs room for long_header_size bytes. Returns the
+  // number of header bytes or zero if the remote side can't receive a
+  // message of that size.
+  size_t write_header(std::uint8_t *header, std::uint8_t type,
+                      size_t size) const;
+
+ private:
+  std::atomic<std::uint32_t> peer_protocol_version_;
+};
+}  // namespace rpc
+}  // namespace anbox
+
+#endif
@@ -16,13 +16,14 @@
  */
 
 #include "anbox/rpc/message_processor.h"
-#include "anbox/common/variable_length_array.h"
 #include "anbox/rpc/constants.h"
 #include "anbox/rpc/make_protobuf_object.h"
 #include "anbox/rpc/template_message_processor.h"
 
 #include "anbox_rpc.pb.h"
 
+#include <cstring>
+
 namespace anbox {
 namespace rpc {
 const ::std::string &Invocation::method_name() const {
@@ -37,32 +38,62 @@ google::protobuf::uint32 Invocation::id() const { return invocation_.id(); }
 
 MessageProcessor::MessageProcessor(
     const std::shared_ptr<network::MessageSender> &sender,
-    const std::shared_ptr<PendingCallCache> &pending_calls)
-    : sender_(sender), pending_calls_(pending_calls) {}
+    const std::shared_ptr<PendingCallCache> &pending_calls,
+    const std::shared_ptr<Framing> &framing)
+    : sender_(sender), pending_calls_(pending_calls), framing_(framing) {}
 
 MessageProcessor::~MessageProcessor() {}
 
-bool MessageProcessor::process_data(const std::vector<std::uint8_t> &data) {
-  for (const auto &byte : data) buffer_.push_back(byte);
+bool MessageProcessor::process_data(const std::uint8_t *data, size_t size) {
+  buffer_.insert(buffer_.end(), data, data + size);
+
+  // Walk over all complete messages with a cursor and only drop the
+  // consumed bytes once at the end rather than after every message.
+  size_t offset = 0;
+  size_t pending_frame_size = 0;
+  while (buffer_.size() - offset >= header_size) {
+    const auto header = buffer_.data() + offset;
+    size_t message_size = (header[0] << 8) + header[1];
+    auto message_type = header[2];
+    size_t frame_header_size = header_size;
+
+    if (message_type & long_frame_flag) {
+      if (buffer_.size() - offset < long_header_size) break;
+
+      message_type &= ~long_frame_flag;
+      message_size = (static_cast<size_t>(header[3]) << 24) +
+                     (static_cast<size_t>(header[4]) << 16) +
+                     (static_cast<size_t>(header[5]) << 8) + header[6];
+      frame_header_size = long_header_size;
 
-  while (buffer_.size() > 0) {
-    const auto high = buffer_[0];
-    const auto low = buffer_[1];
-    size_t const message_size = (high << 8) + low;
-    const auto message_type = buffer_[2];
+      if (message_size > max_message_size) return false;
+
+      // Only peers speaking protocol version 2 send long frames
+      framing_->set_peer_protocol_version(long_frame_protocol_version);
+    }
 
     // If we don't have yet all bytes for a new message return and wait
     // until we have all.
-    if (buffer_.size() - header_size < message_size) break;
+    if (buffer_.size() - offset - frame_header_size < message_size) {
+      pending_frame_size = frame_header_size + message_size;
+      break;
+    }
+
+    const auto message = header + frame_header_size;
 
     if (message_type == MessageType::invocation) {
       anbox::protobuf::rpc::Invocation raw_invocation;
-      raw_invocation.ParseFromArray(buffer_.data() + header_size, message_size);
+      raw_invocation.ParseFromArray(message, message_size);
+
+      framing_->set_peer_protocol_version(raw_invocation.protocol_version());
 
       dispatch(Invocation(raw_invocation));
     } else if (message_type == MessageType::response) {
       auto result = make_protobuf_object<protobuf::rpc::Result>();
-      result->ParseFromArray(buffer_.data() + header_size, message_size);
+      result->ParseFromArray(message, message_size);
+
+      if (result->has_protocol_version())
+        framing_->set_peer_protocol_version(result->protocol_version());
 
       if (result->has_id()) {
         pending_calls_->populate_message_for_result(*result,
@@ -74,46 +105,39 @@ bool MessageProcessor::process_data(const std::vector<std::uint8_t> &data) {
 
       for (int n = 0; n < result->events_size(); n++)
         process_event_sequence(result->events(n));
+    } else if (message_type == MessageType::raw_event) {
+      if (message_size < raw_event_header_size) return false;
+
+      std::uint16_t kind = 0;
+      ::memcpy(&kind, message, sizeof(kind));
+      process_raw_event(kind, message + raw_event_header_size,
+                        message_size - raw_event_header_size);
     }
 
-    buffer_.erase(buffer_.begin(),
-                  buffer_.begin() + header_size + message_size);
+    offset += frame_header_size + message_size;
   }
 
+  buffer_.erase(buffer_.begin(), buffer_.begin() + offset);
+
+  // Make room for the rest of a partially received message right away so
+  // a large one doesn't make us grow the buffer over and over again.
+  if (pending_frame_size > buffer_.capacity())
+    buffer_.reserve(pending_frame_size);
+
   return true;
 }
 
 void MessageProcessor::send_response(::google::protobuf::uint32 id,
                                      google::protobuf::MessageLite *response) {
-  VariableLengthArray<serialization_buffer_size> send_response_buffer(
-      static_cast<size_t>(response->ByteSize()));
-
-  response->SerializeWithCachedSizesToArray(send_response_buffer.data());
-
-  anbox::protobuf::rpc::Result send_response_result;
-  send_response_result.set_id(id);
-  send_response_result.set_response(send_response_buffer.data(),
-                                    send_response_buffer.size());
-
-  send_response_buffer.resize(send_response_result.ByteSize());
-  send_response_result.SerializeWithCachedSizesToArray(
-      send_response_buffer.data());
-
-  const size_t size = send_response_buffer.size();
-  const unsigned char header_bytes[header_size] = {
-      static_cast<unsigned char>((size >> 8) & 0xff),
-      static_cast<unsigned char>((size >> 0) & 0xff), MessageType::response,
-  };
-
-  std::vector<std::uint8_t> send_buffer(sizeof(header_bytes) + size);
-  std::copy(header_bytes, header_bytes + sizeof(header_bytes),
-            send_buffer.begin());
-  std::copy(send_response_buffer.data(),
-            send_response_buffer.data() + send_response_buffer.size(),
-            send_buffer.begin() + sizeof(header_bytes));
-
-  sender_->send(reinterpret_cast<const char *>(send_buffer.data()),
-                send_buffer.size());
+  std::lock_guard<std::mutex> lock(send_mutex_);
+  send_buffer_.write_response(*framing_, id, *response);
+  sender_->send(reinterpret_cast<const char *>(send_buffer_.data()),
+                send_buffer_.size());
+}
+
+SendBuffer::Statistics MessageProcessor::send_statistics() {
+  std::lock_guard<std::mutex> lock(send_mutex_);
+  return send_buffer_.statistics();
 }
 }  // namespace anbox
 }  // namespace network
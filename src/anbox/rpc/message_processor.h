@@ -20,9 +20,12 @@
 
 #include "anbox/network/message_processor.h"
 #include "anbox/network/message_sender.h"
+#include "anbox/rpc/framing.h"
 #include "anbox/rpc/pending_call_cache.h"
+#include "anbox/rpc/send_buffer.h"
 
 #include <memory>
+#include <mutex>
 
 #include <google/protobuf/message_lite.h>
 #include <google/protobuf/stubs/common.h>
@@ -50,21 +53,36 @@ class Invocation {
 class MessageProcessor : public network::MessageProcessor {
  public:
   MessageProcessor(const std::shared_ptr<network::MessageSender>& sender,
-                   const std::shared_ptr<PendingCallCache>& pending_calls);
+                   const std::shared_ptr<PendingCallCache>& pending_calls,
+                   const std::shared_ptr<Framing>& framing =
+                       std::make_shared<Framing>());
   ~MessageProcessor();
 
-  bool process_data(const std::vector<std::uint8_t>& data) override;
+  bool process_data(const std::uint8_t* data, size_t size) override;
 
   void send_response(::google::protobuf::uint32 id,
                      google::protobuf::MessageLite* response);
 
+  SendBuffer::Statistics send_statistics();
+
   virtual void dispatch(Invocation const&) {}
   virtual void process_event_sequence(const std::string&) {}
+  // |data| points right into what we received and is only valid during
+  // the call.
+  virtual void process_raw_event(std::uint16_t kind, const std::uint8_t* data,
+                                 size_t size) {
+    (void)kind;
+    (void)data;
+    (void)size;
+  }
 
  private:
   std::shared_ptr<network::MessageSender> sender_;
   std::vector<std::uint8_t> buffer_;
   std::shared_ptr<PendingCallCache> pending_calls_;
+  std::shared_ptr<Framing> framing_;
+  std::mutex send_mutex_;
+  SendBuffer send_buffer_;
 };
 }  // namespace rpc
 }  // namespace anbox
@@ -20,53 +20,155 @@
 
 #include "anbox_rpc.pb.h"
 
+namespace {
+constexpr const size_t initial_shard_capacity{16};
+}
+
 namespace anbox {
 namespace rpc {
+PendingCallCache::Shard::Shard() : slots(initial_shard_capacity), count(0) {}
+
+size_t PendingCallCache::Shard::index_for(std::uint32_t id) const {
+  return (id / shard_count) & (slots.size() - 1);
+}
+
+PendingCallCache::Shard::Slot *PendingCallCache::Shard::find(
+    std::uint32_t id) {
+  const auto mask = slots.size() - 1;
+  for (auto n = index_for(id); slots[n].used; n = (n + 1) & mask) {
+    if (slots[n].id == id) return &slots[n];
+  }
+  return nullptr;
+}
+
+void PendingCallCache::Shard::insert(std::uint32_t id,
+                                     const PendingCall &call) {
+  if (auto slot = find(id)) {
+    slot->call = call;
+    return;
+  }
+
+  // Keep the load factor below one half so probe sequences stay short
+  if ((count + 1) * 2 > slots.size()) grow();
+
+  const auto mask = slots.size() - 1;
+  auto n = index_for(id);
+  while (slots[n].used) n = (n + 1) & mask;
+
+  slots[n].used = true;
+  slots[n].id = id;
+  slots[n].call = call;
+  count++;
+}
+
+void PendingCallCache::Shard::erase(Slot *slot) {
+  // Shift following entries of the same probe sequence back so lookups
+  // never need tombstones.
+  const auto mask = slots.size() - 1;
+  auto hole = static_cast<size_t>(slot - slots.data());
+  auto n = (hole + 1) & mask;
+  while (slots[n].used) {
+    const auto home = index_for(slots[n].id);
+    if (((n - home) & mask) >= ((n - hole) & mask)) {
+      slots[hole] = slots[n];
+      hole = n;
+    }
+    n = (n + 1) & mask;
+  }
+
+  slots[hole] = Slot{};
+  count--;
+}
+
+void PendingCallCache::Shard::grow() {
+  std::vector<Slot> old(slots.size() * 2);
+  old.swap(slots);
+  count = 0;
+  for (const auto &slot : old) {
+    if (slot.used) insert(slot.id, slot.call);
+  }
+}
+
 PendingCallCache::PendingCallCache() {}
 
+PendingCallCache::Shard &PendingCallCache::shard_for(std::uint32_t id) {
+  return shards_[id % shard_count];
+}
+
 void PendingCallCache::save_completion_details(
-    anbox::protobuf::rpc::Invocation const& invocation,
-    google::protobuf::MessageLite* response,
+    std::uint32_t id, google::protobuf::MessageLite* response,
     google::protobuf::Closure* complete) {
-  std::unique_lock<std::mutex> lock(mutex_);
-  pending_calls_[invocation.id()] = PendingCall(response, complete);
+  auto &shard = shard_for(id);
+  std::unique_lock<std::mutex> lock(shard.mutex);
+  shard.insert(id, PendingCall(response, complete));
 }
 
 void PendingCallCache::populate_message_for_result(
     anbox::protobuf::rpc::Result& result,
     std::function<void(google::protobuf::MessageLite*)> const& populator) {
-  std::unique_lock<std::mutex> lock(mutex_);
-  populator(pending_calls_.at(result.id()).response);
+  auto &shard = shard_for(result.id());
+  std::unique_lock<std::mutex> lock(shard.mutex);
+  // The call may have been cancelled already in which case nobody is
+  // interested in the result anymore.
+  auto slot = shard.find(result.id());
+  if (slot) populator(slot->call.response);
 }
 
 void PendingCallCache::complete_response(anbox::protobuf::rpc::Result& result) {
   PendingCall completion;
 
   {
-    std::unique_lock<std::mutex> lock(mutex_);
-    auto call = pending_calls_.find(result.id());
-    if (call != pending_calls_.end()) {
-      completion = call->second;
-      pending_calls_.erase(call);
+    auto &shard = shard_for(result.id());
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    auto slot = shard.find(result.id());
+    if (slot) {
+      completion = slot->call;
+      shard.erase(slot);
     }
   }
 
   if (completion.complete) completion.complete->Run();
 }
 
+bool PendingCallCache::cancel(std::uint32_t id) {
+  PendingCall call;
+
+  {
+    auto &shard = shard_for(id);
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    auto slot = shard.find(id);
+    if (!slot) return false;
+    call = slot->call;
+    shard.erase(slot);
+  }
+
+  delete call.complete;
+  return true;
+}
+
 void PendingCallCache::force_completion() {
-  std::unique_lock<std::mutex> lock(mutex_);
-  for (auto& call : pending_calls_) {
-    auto& completion = call.second;
-    completion.complete->Run();
+  std::vector<PendingCall> completions;
+
+  for (auto &shard : shards_) {
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    for (auto &slot : shard.slots) {
+      if (slot.used) completions.push_back(slot.call);
+      slot = Shard::Slot{};
+    }
+    shard.count = 0;
   }
 
-  pending_calls_.erase(pending_calls_.begin(), pending_calls_.end());
+  for (auto &completion : completions) {
+    if (completion.complete) completion.complete->Run();
+  }
 }
 
 bool PendingCallCache::empty() const {
-  std::unique_lock<std::mutex> lock(mutex_);
-  return pending_calls_.empty();
+  for (const auto &shard : shards_) {
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    if (shard.count > 0) return false;
+  }
+  return true;
 }
 }  // namespace rpc
 }  // namespace anbox
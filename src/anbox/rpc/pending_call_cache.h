@@ -19,9 +19,11 @@
 #ifndef ANBOX_RPC_PENDING_CALL_CACHE_
 #define ANBOX_RPC_PENDING_CALL_CACHE_
 
+#include <array>
+#include <cstdint>
 #include <functional>
-#include <map>
 #include <mutex>
+#include <vector>
 
 namespace google {
 namespace protobuf {
@@ -33,7 +35,6 @@ class MessageLite;
 namespace anbox {
 namespace protobuf {
 namespace rpc {
-class Invocation;
 class Result;
 }  // namespace rpc
 }  // namespace protobuf
@@ -43,13 +44,15 @@ class PendingCallCache {
   PendingCallCache();
 
   void save_completion_details(
-      anbox::protobuf::rpc::Invocation const &invocation,
-      google::protobuf::MessageLite *response,
+      std::uint32_t id, google::protobuf::MessageLite *response,
       google::protobuf::Closure *complete);
   void populate_message_for_result(
       anbox::protobuf::rpc::Result &result,
       std::function<void(google::protobuf::MessageLite *)> const &populator);
   void complete_response(anbox::protobuf::rpc::Result &result);
+  // Drops the call with |id| without running its completion. Returns false
+  // if the call isn't pending anymore, e.g. because it just completed.
+  bool cancel(std::uint32_t id);
   void force_completion();
   bool empty() const;
 
@@ -65,8 +68,34 @@ class PendingCallCache {
     google::protobuf::Closure *complete;
   };
 
-  std::mutex mutable mutex_;
-  std::map<int, PendingCall> pending_calls_;
+  // Open addressing table with linear probing. Call ids are handed out
+  // sequentially so they spread evenly over shards and slots.
+  struct Shard {
+    struct Slot {
+      Slot() : used(false), id(0) {}
+      bool used;
+      std::uint32_t id;
+      PendingCall call;
+    };
+
+    Shard();
+
+    size_t index_for(std::uint32_t id) const;
+    Slot *find(std::uint32_t id);
+    void insert(std::uint32_t id, const PendingCall &call);
+    void erase(Slot *slot);
+    void grow();
+
+    std::mutex mutable mutex;
+    std::vector<Slot> slots;
+    size_t count;
+  };
+
+  static constexpr const std::uint32_t shard_count{8};
+
+  Shard &shard_for(std::uint32_t id);
+
+  std::array<Shard, shard_count> shards_;
 };
 }  // namespace rpc
 }  // namespace anbox
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/rpc/send_buffer.h"
+#include "anbox/rpc/constants.h"
+#include "anbox/rpc/framing.h"
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/message_lite.h>
+
+#include <cstring>
+#include <stdexcept>
+
+using google::protobuf::io::CodedOutputStream;
+
+namespace {
+// We keep a buffer which was grown for a large message only as long as
+// we keep getting messages of at least this size.
+constexpr const size_t max_retained_size{1024 * 1024};
+
+constexpr std::uint32_t varint_tag(std::uint32_t field) {
+  return (field << 3) | 0;
+}
+
+constexpr std::uint32_t length_delimited_tag(std::uint32_t field) {
+  return (field << 3) | 2;
+}
+
+// Field numbers from anbox_rpc.proto
+constexpr const std::uint32_t invocation_id{1};
+constexpr const std::uint32_t invocation_method_name{2};
+constexpr const std::uint32_t invocation_parameters{3};
+constexpr const std::uint32_t invocation_protocol_version{4};
+constexpr const std::uint32_t result_id{1};
+constexpr const std::uint32_t result_response{2};
+constexpr const std::uint32_t result_events{3};
+constexpr const std::uint32_t result_protocol_version{4};
+
+size_t varint_field_size(std::uint32_t tag, std::uint32_t value) {
+  return CodedOutputStream::VarintSize32(tag) +
+         CodedOutputStream::VarintSize32(value);
+}
+
+size_t length_delimited_field_size(std::uint32_t tag, size_t length) {
+  return CodedOutputStream::VarintSize32(tag) +
+         CodedOutputStream::VarintSize32(static_cast<std::uint32_t>(length)) +
+         length;
+}
+
+std::uint8_t *write_varint_field(std::uint8_t *target, std::uint32_t tag,
+                                 std::uint32_t value) {
+  target = CodedOutputStream::WriteTagToArray(tag, target);
+  return CodedOutputStream::WriteVarint32ToArray(value, target);
+}
+
+std::uint8_t *write_string_field(std::uint8_t *target, std::uint32_t tag,
+                                 const std::string &value) {
+  target = CodedOutputStream::WriteTagToArray(tag, target);
+  target = CodedOutputStream::WriteVarint32ToArray(
+      static_cast<std::uint32_t>(value.size()), target);
+  ::memcpy(target, value.data(), value.size());
+  return target + value.size();
+}
+
+// The size of |message| needs to be cached already by calling ByteSize()
+std::uint8_t *write_message_field(std::uint8_t *target, std::uint32_t tag,
+                                  const google::protobuf::MessageLite &message,
+                                  size_t size) {
+  target = CodedOutputStream::WriteTagToArray(tag, target);
+  target = CodedOutputStream::WriteVarint32ToArray(
+      static_cast<std::uint32_t>(size), target);
+  return message.SerializeWithCachedSizesToArray(target);
+}
+}
+
+namespace anbox {
+namespace rpc {
+SendBuffer::SendBuffer() : size_(0), statistics_{0, 0} {}
+
+std::uint8_t *SendBuffer::prepare_frame(const Framing &framing,
+                                        std::uint8_t type,
+                                        size_t message_size) {
+  std::uint8_t header[long_header_size];
+  const auto header_length = framing.write_header(header, type, message_size);
+  if (header_length == 0)
+    throw std::runtime_error(
+        "Message is too large for the framing supported by the remote side");
+
+  size_ = header_length + message_size;
+  if (size_ > buffer_.capacity() ||
+      (buffer_.capacity() > max_retained_size && size_ <= max_retained_size)) {
+    buffer_.reset(size_);
+    statistics_.allocations++;
+  } else {
+    buffer_.resize_noinit(size_);
+  }
+  statistics_.messages++;
+
+  const auto frame = reinterpret_cast<std::uint8_t *>(buffer_.data());
+  ::memcpy(frame, header, header_length);
+  return frame + header_length;
+}
+
+void SendBuffer::write_invocation(
+    const Framing &framing, std::uint32_t id, const std::string &method_name,
+    const google::protobuf::MessageLite &parameters) {
+  const size_t parameters_size = parameters.ByteSize();
+  const size_t message_size =
+      varint_field_size(varint_tag(invocation_id), id) +
+      length_delimited_field_size(length_delimited_tag(invocation_method_name),
+                                  method_name.size()) +
+      length_delimited_field_size(length_delimited_tag(invocation_parameters),
+                                  parameters_size) +
+      varint_field_size(varint_tag(invocation_protocol_version),
+                        protocol_version);
+
+  auto target = prepare_frame(framing, MessageType::invocation, message_size);
+  target = write_varint_field(target, varint_tag(invocation_id), id);
+  target = write_string_field(
+      target, length_delimited_tag(invocation_method_name), method_name);
+  target = write_message_field(target,
+                               length_delimited_tag(invocation_parameters),
+                               parameters, parameters_size);
+  write_varint_field(target, varint_tag(invocation_protocol_version),
+                     protocol_version);
+}
+
+void SendBuffer::write_response(const Framing &framing, std::uint32_t id,
+                                const google::protobuf::MessageLite &response) {
+  const size_t response_size = response.ByteSize();
+  const size_t message_size =
+      varint_field_size(varint_tag(result_id), id) +
+      length_delimited_field_size(length_delimited_tag(result_response),
+                                  response_size);
+
+  auto target = prepare_frame(framing, MessageType::response, message_size);
+  target = write_varint_field(target, varint_tag(result_id), id);
+  write_message_field(target, length_delimited_tag(result_response), response,
+                      response_size);
+}
+
+void SendBuffer::write_event(const Framing &framing,
+                             const google::protobuf::MessageLite &event) {
+  const size_t event_size = event.ByteSize();
+  const size_t message_size = length_delimited_field_size(
+      length_delimited_tag(result_events), event_size);
+
+  auto target = prepare_frame(framing, MessageType::response, message_size);
+  write_message_field(target, length_delimited_tag(result_events), event,
+                      event_size);
+}
+
+void SendBuffer::write_protocol_version(const Framing &framing,
+                                        std::uint32_t version) {
+  const size_t message_size =
+      varint_field_size(varint_tag(result_protocol_version), version);
+
+  auto target = prepare_frame(framing, MessageType::response, message_size);
+  write_varint_field(target, varint_tag(result_protocol_version), version);
+}
+
+std::uint8_t *SendBuffer::write_raw_event(const Framing &framing,
+                                          std::uint16_t kind, size_t size) {
+  if (framing.peer_protocol_version() < raw_event_protocol_version)
+    throw std::runtime_error("Remote side doesn't take raw events");
+
+  auto target = prepare_frame(framing, MessageType::raw_event,
+                              raw_event_header_size + size);
+  ::memcpy(target, &kind, sizeof(kind));
+  ::memset(target + sizeof(kind), 0, raw_event_header_size - sizeof(kind));
+  return target + raw_event_header_size;
+}
+
+std::ostream &operator<<(std::ostream &out,
+                         const SendBuffer::Statistics &statistics) {
+  return out << "messages " << statistics.messages << " allocations "
+             << statistics.allocations;
+}
+}  // namespace rpc
+}  // namespace anbox
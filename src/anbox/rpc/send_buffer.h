@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_RPC_SEND_BUFFER_H_
+#define ANBOX_RPC_SEND_BUFFER_H_
+
+#include "anbox/common/byte_buffer.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace google {
+namespace protobuf {
+class MessageLite;
+}  // namespace protobuf
+}  // namespace google
+
+namespace anbox {
+namespace rpc {
+class Framing;
+// Reusable buffer holding one complete outgoing RPC frame. The Invocation
+// and Result envelopes are encoded by hand around the nested message so
+// that it is serialized exactly once, straight into its final place.
+// Not thread safe; owners have to serialize access.
+class SendBuffer {
+ public:
+  struct Statistics {
+    std::uint64_t messages;
+    std::uint64_t allocations;
+  };
+
+  SendBuffer();
+
+  // Each of these replaces the content of the buffer with a new frame and
+  // throws if the frame can't be sent with the given framing.
+  void write_invocation(const Framing &framing, std::uint32_t id,
+                        const std::string &method_name,
+                        const google::protobuf::MessageLite &parameters);
+  void write_response(const Framing &framing, std::uint32_t id,
+                      const google::protobuf::MessageLite &response);
+  void write_event(const Framing &framing,
+                   const google::protobuf::MessageLite &event);
+  void write_protocol_version(const Framing &framing,
+                              std::uint32_t version);
+  // Returns where the |size| bytes of the event go.
+  std::uint8_t *write_raw_event(const Framing &framing, std::uint16_t kind,
+                                size_t size);
+
+  const std::uint8_t *data() const {
+    return reinterpret_cast<const std::uint8_t *>(buffer_.data());
+  }
+  size_t size() const { return size_; }
+
+  Statistics statistics() const { return statistics_; }
+
+ private:
+  std::uint8_t *prepare_frame(const Framing &framing, std::uint8_t type,
+                              size_t message_size);
+
+  // Comes from the shared block pool so that growing and shrinking it
+  // doesn't go through malloc.
+  common::ByteBuffer<0> buffer_;
+  size_t size_;
+  Statistics statistics_;
+};
+
+std::ostream &operator<<(std::ostream &out,
+                         const SendBuffer::Statistics &statistics);
+}  // namespace rpc
+}  // namespace anbox
+
+#endif
@@ -15,6 +15,7 @@
  *
  */
 
+#include <algorithm>
 #include <iostream>
 
 #include "anbox/logger.h"
@@ -47,15 +48,28 @@ void exception_safe_run(boost::asio::io_service& service) {
 }
 namespace anbox {
 
+constexpr const std::uint32_t Runtime::control_threads;
+
+std::uint32_t Runtime::default_pool_size() {
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
 std::shared_ptr<Runtime> Runtime::create(std::uint32_t pool_size) {
   return std::shared_ptr<Runtime>(new Runtime(pool_size));
 }
 
+Runtime::Shard::Shard(const std::string &name, std::uint32_t threads)
+    : name{name}, threads{threads}, service{static_cast<int>(threads)}, keep_alive{service} {}
+
 Runtime::Runtime(std::uint32_t pool_size)
-    : pool_size_{pool_size},
-      service_{pool_size_},
-      strand_{service_},
-      keep_alive_{service_} {}
+    : control_{"control", control_threads},
+      audio_{"audio", 1},
+      input_{"input", 1},
+      next_graphics_shard_{0},
+      strand_{control_.service} {
+  for (std::uint32_t n = 0; n < std::max(1u, pool_size); n++)
+    graphics_.push_back(std::unique_ptr<Shard>(new Shard("graphics-" + std::to_string(n), 1)));
+}
 
 Runtime::~Runtime() {
   try {
@@ -66,12 +80,24 @@ Runtime::~Runtime() {
 }
 
 void Runtime::start() {
-  for (unsigned int i = 0; i < pool_size_; i++)
-    workers_.push_back(std::thread{exception_safe_run, std::ref(service_)});
+  const auto run = [this](Shard &shard) {
+    for (std::uint32_t n = 0; n < shard.threads; n++)
+      workers_.push_back(std::thread{exception_safe_run, std::ref(shard.service)});
+  };
+
+  run(control_);
+  run(audio_);
+  run(input_);
+  for (auto &shard : graphics_)
+    run(*shard);
 }
 
 void Runtime::stop() {
-  service_.stop();
+  control_.service.stop();
+  audio_.service.stop();
+  input_.service.stop();
+  for (auto &shard : graphics_)
+    shard->service.stop();
 
   for (auto& worker : workers_)
     if (worker.joinable())
@@ -85,6 +111,48 @@ std::function<void(std::function<void()>)> Runtime::to_dispatcher_functional() {
   return [sp](std::function<void()> task) { sp->strand_.post(task); };
 }
 
-boost::asio::io_service& Runtime::service() { return service_; }
+boost::asio::io_service& Runtime::service() { return control_.service; }
+
+void Runtime::set_handler_statistics(const std::shared_ptr<common::HandlerStatistics> &statistics) {
+  std::atomic_store(&handler_statistics_, statistics);
+}
+
+std::shared_ptr<common::HandlerStatistics> Runtime::handler_statistics() const {
+  return std::atomic_load(&handler_statistics_);
+}
+
+void Runtime::probe_queues() {
+  const auto statistics = handler_statistics();
+  if (!statistics)
+    return;
+
+  const auto probe = [statistics](Shard &shard) {
+    const auto posted = common::HandlerStatistics::Clock::now();
+    const auto name = shard.name;
+    shard.service.post([statistics, posted, name]() {
+      statistics->queue_probed(name, common::HandlerStatistics::Clock::now() - posted);
+    });
+  };
+
+  probe(control_);
+  probe(audio_);
+  probe(input_);
+  for (auto &shard : graphics_)
+    probe(*shard);
+}
+
+boost::asio::io_service& Runtime::service(Subsystem subsystem) {
+  switch (subsystem) {
+    case Subsystem::Graphics:
+      return graphics_[next_graphics_shard_++ % graphics_.size()]->service;
+    case Subsystem::Audio:
+      return audio_.service;
+    case Subsystem::Input:
+      return input_.service;
+    default:
+      break;
+  }
+  return control_.service;
+}
 
 }  // namespace anbox
@@ -20,10 +20,14 @@
 
 #include <boost/asio.hpp>
 
-#include <memory.h>
+#include <atomic>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <thread>
+#include <vector>
 
+#include "anbox/common/handler_statistics.h"
 #include "anbox/do_not_copy_or_move.h"
 
 namespace anbox {
@@ -31,22 +35,41 @@ namespace anbox {
 // We bundle our "global" runtime dependencies here, specifically
 // a dispatcher to decouple multiple in-process providers from one
 // another , forcing execution to a well known set of threads.
+//
+// The work is split up into shards, each with its own io_service and
+// threads, so that the data paths don't queue up behind one another or
+// behind slow control plane handlers. Control runs on a service shared
+// by several threads as its handlers may block. Every other subsystem
+// gets single threaded shards and the connections of a subsystem are
+// spread over its shards.
 class Runtime : public DoNotCopyOrMove,
                 public std::enable_shared_from_this<Runtime> {
  public:
-  // Our default concurrency setup.
-  static constexpr const std::uint32_t worker_threads = 8;
-
-  // create returns a Runtime instance with pool_size worker threads
-  // executing the underlying service.
+  enum class Subsystem {
+    // Bridge, container and D-Bus connections, timers and the dispatcher.
+    Control,
+    // The qemu pipes which carry the GL streams of the guest.
+    Graphics,
+    Audio,
+    Input,
+  };
+
+  // Threads executing the control service.
+  static constexpr const std::uint32_t control_threads = 4;
+
+  // Shards of the graphics subsystem when nothing else was asked for,
+  // one per core.
+  static std::uint32_t default_pool_size();
+
+  // create returns a Runtime instance with pool_size shards for the
+  // graphics subsystem.
   static std::shared_ptr<Runtime> create(
-      std::uint32_t pool_size = worker_threads);
+      std::uint32_t pool_size = default_pool_size());
 
   // Tears down the runtime, stopping all worker threads.
   ~Runtime() noexcept(true);
 
-  // start executes the underlying io_service on a thread pool with
-  // the size configured at creation time.
+  // start executes the services of all shards on their threads.
   void start();
 
   // stop cleanly shuts down a Runtime instance.
@@ -56,20 +79,42 @@ class Runtime : public DoNotCopyOrMove,
   // with components that expect a dispatcher for operation.
   std::function<void(std::function<void()>)> to_dispatcher_functional();
 
-  // service returns the underlying boost::asio::io_service that is executed
-  // by the Runtime.
+  // service returns the control service.
   boost::asio::io_service& service();
 
+  // Returns the service a new connection of |subsystem| is pinned to.
+  // Subsystems with more than one shard hand them out in turn.
+  boost::asio::io_service& service(Subsystem subsystem);
+
+  // Handlers are only tracked while statistics are set.
+  void set_handler_statistics(const std::shared_ptr<common::HandlerStatistics> &statistics);
+  std::shared_ptr<common::HandlerStatistics> handler_statistics() const;
+
+  // Posts a handler to every service which records how long it waited
+  // to run there.
+  void probe_queues();
+
  private:
-  // Runtime constructs a new instance, firing up pool_size
-  // worker threads.
+  struct Shard {
+    Shard(const std::string &name, std::uint32_t threads);
+
+    const std::string name;
+    const std::uint32_t threads;
+    boost::asio::io_service service;
+    boost::asio::io_service::work keep_alive;
+  };
+
+  // Runtime constructs a new instance with pool_size graphics shards.
   Runtime(std::uint32_t pool_size);
 
-  std::uint32_t pool_size_;
-  boost::asio::io_service service_;
+  Shard control_;
+  Shard audio_;
+  Shard input_;
+  std::vector<std::unique_ptr<Shard>> graphics_;
+  std::atomic<std::uint32_t> next_graphics_shard_;
   boost::asio::io_service::strand strand_;
-  boost::asio::io_service::work keep_alive_;
   std::vector<std::thread> workers_;
+  std::shared_ptr<common::HandlerStatistics> handler_statistics_;
 };
 
 }  // namespace anbox
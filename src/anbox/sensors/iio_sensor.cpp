@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "anbox/sensors/iio_sensor.h"
+#include "anbox/logger.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/throw_exception.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+namespace fs = boost::filesystem;
+
+namespace {
+const std::array<float, 9> identity{{1, 0, 0, 0, 1, 0, 0, 0, 1}};
+
+bool read_value(const std::string &path, double &value) {
+  std::ifstream in(path);
+  return static_cast<bool>(in >> value);
+}
+
+double read_value_or(const std::string &path, double fallback) {
+  double value = 0;
+  return read_value(path, value) ? value : fallback;
+}
+
+bool exists(const std::string &path) {
+  boost::system::error_code err;
+  return fs::exists(path, err);
+}
+
+// Channel files are named <prefix>_<axis>_<attribute> with the attributes
+// shared by all axes named <prefix>_<attribute>.
+const char *channel_prefix(anbox::sensors::IioSensor::Type type) {
+  switch (type) {
+    case anbox::sensors::IioSensor::Type::Accelerometer:
+      return "in_accel";
+    case anbox::sensors::IioSensor::Type::Gyroscope:
+      return "in_anglvel";
+    case anbox::sensors::IioSensor::Type::Light:
+      return "in_illuminance";
+  }
+  return "";
+}
+
+// The matrix is written as "x1, y1, z1; x2, y2, z2; x3, y3, z3".
+std::array<float, 9> read_mount_matrix(const std::string &path) {
+  std::ifstream in(path);
+  std::string text;
+  if (!std::getline(in, text))
+    return identity;
+
+  std::array<float, 9> m;
+  if (std::sscanf(text.c_str(), "%g, %g, %g; %g, %g, %g; %g, %g, %g",
+                  &m[0], &m[1], &m[2], &m[3], &m[4], &m[5], &m[6], &m[7], &m[8]) != 9) {
+    WARNING("Ignoring malformed mount matrix %s", path);
+    return identity;
+  }
+  return m;
+}
+}  // namespace
+
+namespace anbox {
+namespace sensors {
+constexpr const char *IioSensor::default_root;
+
+std::vector<std::shared_ptr<IioSensor>> IioSensor::find_all(const std::string &root) {
+  std::vector<std::shared_ptr<IioSensor>> sensors;
+
+  boost::system::error_code err;
+  for (fs::directory_iterator it(root, err), end; !err && it != end; it.increment(err)) {
+    const auto path = it->path().string();
+    for (const auto type : {Type::Accelerometer, Type::Gyroscope, Type::Light}) {
+      try {
+        sensors.push_back(std::make_shared<IioSensor>(type, path));
+      } catch (const std::exception &) {
+        // Not a sensor of this type.
+      }
+    }
+  }
+  return sensors;
+}
+
+IioSensor::IioSensor(Type type, const std::string &path)
+    : type_(type), path_(path), mount_matrix_(identity) {
+  const std::string prefix = path + "/" + channel_prefix(type);
+
+  if (type == Type::Light) {
+    // Most light sensors report processed values already.
+    if (exists(prefix + "_input")) {
+      channels_.push_back({prefix + "_input", 1.0, 0.0});
+    } else if (exists(prefix + "_raw")) {
+      channels_.push_back({prefix + "_raw", read_value_or(prefix + "_scale", 1.0),
+                           read_value_or(prefix + "_offset", 0.0)});
+    }
+  } else {
+    for (const auto axis : {"_x", "_y", "_z"}) {
+      const auto channel = prefix + axis;
+      if (!exists(channel + "_raw"))
+        break;
+      channels_.push_back({channel + "_raw",
+                           read_value_or(channel + "_scale", read_value_or(prefix + "_scale", 1.0)),
+                           read_value_or(channel + "_offset", read_value_or(prefix + "_offset", 0.0))});
+    }
+
+    if (exists(prefix + "_mount_matrix"))
+      mount_matrix_ = read_mount_matrix(prefix + "_mount_matrix");
+    else if (exists(path + "/mount_matrix"))
+      mount_matrix_ = read_mount_matrix(path + "/mount_matrix");
+  }
+
+  if (channels_.size() != (type == Type::Light ? 1 : 3))
+    BOOST_THROW_EXCEPTION(std::runtime_error("No " + std::string(channel_prefix(type)) +
+                                             " channels at " + path));
+}
+
+bool IioSensor::read(std::array<float, 3> &values) const {
+  std::array<float, 3> raw{{0, 0, 0}};
+  for (std::size_t n = 0; n < channels_.size(); n++) {
+    double value = 0;
+    if (!read_value(channels_[n].value_path, value))
+      return false;
+    raw[n] = static_cast<float>((value + channels_[n].offset) * channels_[n].scale);
+  }
+
+  if (type_ == Type::Light) {
+    values = raw;
+    return true;
+  }
+
+  for (std::size_t row = 0; row < 3; row++)
+    values[row] = mount_matrix_[row * 3 + 0] * raw[0] +
+                  mount_matrix_[row * 3 + 1] * raw[1] +
+                  mount_matrix_[row * 3 + 2] * raw[2];
+  return true;
+}
+}  // namespace sensors
+}  // namespace anbox
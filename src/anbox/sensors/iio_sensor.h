@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef ANBOX_SENSORS_IIO_SENSOR_H_
+#define ANBOX_SENSORS_IIO_SENSOR_H_
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace anbox {
+namespace sensors {
+// A sensor of the Linux Industrial I/O subsystem. Values are read from
+// the channel files in sysfs which unlike the buffered character device
+// needs neither privileges nor any trigger setup.
+class IioSensor {
+ public:
+  enum class Type { Accelerometer, Gyroscope, Light };
+
+  static constexpr const char *default_root{"/sys/bus/iio/devices"};
+
+  // Returns all sensors below |root|. A single device can provide more
+  // than one sensor, e.g. combined accelerometer and gyroscope chips.
+  static std::vector<std::shared_ptr<IioSensor>> find_all(
+      const std::string &root = default_root);
+
+  // Throws std::runtime_error if the device at |path| has no channels
+  // for |type|.
+  IioSensor(Type type, const std::string &path);
+
+  Type type() const { return type_; }
+  std::string path() const { return path_; }
+  // Three axes for motion sensors, one value for light.
+  std::size_t value_count() const { return channels_.size(); }
+
+  // Reads the current values in the units Android expects: m/s^2, rad/s
+  // and lux. Motion values are rotated by the mount matrix of the device
+  // so that they are relative to the screen.
+  bool read(std::array<float, 3> &values) const;
+
+ private:
+  struct Channel {
+    std::string value_path;
+    double scale;
+    double offset;
+  };
+
+  Type type_;
+  std::string path_;
+  std::vector<Channel> channels_;
+  std::array<float, 9> mount_matrix_;
+};
+}  // namespace sensors
+}  // namespace anbox
+
+#endif
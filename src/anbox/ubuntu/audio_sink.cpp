@@ -16,28 +16,44 @@
  */
 
 #include "anbox/ubuntu/audio_sink.h"
+#include "anbox/common/metrics.h"
+#include "anbox/common/tracer.h"
 #include "anbox/logger.h"
 
-#include <stdexcept>
-
-#include <boost/throw_exception.hpp>
-
-namespace {
-const constexpr size_t max_queue_size{16};
-}
-
 namespace anbox {
 namespace ubuntu {
-AudioSink::AudioSink() :
-  device_id_(0),
-  queue_(max_queue_size) {
+AudioSink::AudioSink(const audio::PlaybackBuffer::Config &config, const audio::ClientInfo &info) :
+  config_(config),
+  info_(info),
+  device_id_(0) {
+  // The guest wants to know our latency right away, which depends on
+  // the rate the device runs at.
+  std::lock_guard<std::mutex> l(lock_);
+  connect_audio();
 }
 
-AudioSink::~AudioSink() {}
+AudioSink::~AudioSink() {
+  if (!buffer_)
+    return;
+
+  buffer_->close();
+  disconnect_audio();
+
+  const auto stats = buffer_->statistics();
+  if (stats.underruns > 0 || stats.overruns > 0)
+    DEBUG("Audio stream had %d underruns and %d overruns", stats.underruns, stats.overruns);
+
+  if (auto metrics = common::Metrics::instance()) {
+    metrics->counter("anbox_audio_playback_underruns_total",
+                     "Audio device periods which ran out of data").add(stats.underruns);
+    metrics->counter("anbox_audio_playback_overruns_total",
+                     "Audio writes which waited for the device").add(stats.overruns);
+  }
+}
 
 void AudioSink::on_data_requested(void *user_data, std::uint8_t *buffer, int size) {
   auto thiz = static_cast<AudioSink*>(user_data);
-  thiz->read_data(buffer, size);
+  thiz->buffer_->read(buffer, static_cast<size_t>(size));
 }
 
 bool AudioSink::connect_audio() {
@@ -45,17 +61,30 @@ bool AudioSink::connect_audio() {
     return true;
 
   SDL_memset(&spec_, 0, sizeof(spec_));
-  spec_.freq = 44100;
-  spec_.format = AUDIO_S16;
-  spec_.channels = 2;
-  spec_.samples = 4096;
+  spec_.freq = static_cast<int>(info_.sample_rate);
+  spec_.format = info_.format == audio::ClientInfo::Format::Float ? AUDIO_F32SYS : AUDIO_S16SYS;
+  spec_.channels = info_.channels;
+  spec_.samples = static_cast<Uint16>(config_.period_frames);
   spec_.callback = &AudioSink::on_data_requested;
   spec_.userdata = this;
 
-  device_id_ = SDL_OpenAudioDevice(nullptr, 0, &spec_, nullptr, 0);
+  // Everything but the rate is converted by SDL for free. A different
+  // rate we rather resample ourselves before the data is queued so it
+  // only happens once and not in the realtime callback.
+  SDL_AudioSpec obtained;
+  device_id_ = SDL_OpenAudioDevice(nullptr, 0, &spec_, &obtained, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
   if (!device_id_)
     return false;
 
+  const auto rate = static_cast<std::uint32_t>(obtained.freq);
+  if (rate != info_.sample_rate) {
+    DEBUG("Audio device runs at %d Hz, resampling from %d Hz", rate, info_.sample_rate);
+    resampler_.reset(new audio::Resampler(info_.format, info_.channels, info_.sample_rate, rate));
+  }
+
+  if (!buffer_)
+    buffer_.reset(new audio::PlaybackBuffer(config_, rate, info_.frame_size()));
+
   SDL_PauseAudioDevice(device_id_, 0);
 
   return true;
@@ -69,49 +98,34 @@ void AudioSink::disconnect_audio() {
   device_id_ = 0;
 }
 
-void AudioSink::read_data(std::uint8_t *buffer, int size) {
-  std::unique_lock<std::mutex> l(lock_);
-  const auto wanted = size;
-  int count = 0;
-  auto dst = buffer;
-
-  while (count < wanted) {
-    if (read_buffer_left_ > 0) {
-      size_t avail = std::min<size_t>(wanted - count, read_buffer_left_);
-      memcpy(dst + count,
-             read_buffer_.data() + (read_buffer_.size() - read_buffer_left_),
-             avail);
-      count += avail;
-      read_buffer_left_ -= avail;
-      continue;
-    }
-
-    bool blocking = (count == 0);
-    auto result = -EIO;
-    if (blocking)
-      result = queue_.pop_locked(&read_buffer_, l);
-    else
-      result = queue_.try_pop_locked(&read_buffer_);
-
-    if (result == 0) {
-      read_buffer_left_ = read_buffer_.size();
-      continue;
+void AudioSink::write_data(const std::uint8_t *data, size_t size) {
+  ANBOX_TRACE_SPAN("audio", "write_data");
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    if (!connect_audio()) {
+      WARNING("Audio server not connected, skipping %d bytes", size);
+      return;
     }
-
-    if (count > 0) break;
-
-    return;
+  }
+  // Waits for the device when the buffer is full, outside of the lock so
+  // that the sink can still be torn down meanwhile.
+  if (resampler_) {
+    const auto &resampled = resampler_->process(data, size);
+    buffer_->write(resampled.data(), resampled.size());
+  } else {
+    buffer_->write(data, size);
   }
 }
 
-void AudioSink::write_data(const std::vector<std::uint8_t> &data) {
-  std::unique_lock<std::mutex> l(lock_);
-  if (!connect_audio()) {
-    WARNING("Audio server not connected, skipping %d bytes", data.size());
-    return;
-  }
-  graphics::Buffer buffer{data.data(), data.data() + data.size()};
-  queue_.push_locked(std::move(buffer), l);
+std::chrono::microseconds AudioSink::latency() const {
+  std::lock_guard<std::mutex> l(lock_);
+  if (!buffer_)
+    return std::chrono::microseconds{0};
+  return buffer_->latency();
+}
+
+size_t AudioSink::period_size() const {
+  return config_.period_frames * info_.frame_size();
 }
 } // namespace ubuntu
 } // namespace anbox
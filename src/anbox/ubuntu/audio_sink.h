@@ -18,35 +18,44 @@
 #ifndef ANBOX_UBUNTU_AUDIO_SINK_H_
 #define ANBOX_UBUNTU_AUDIO_SINK_H_
 
+#include "anbox/audio/client_info.h"
+#include "anbox/audio/playback_buffer.h"
+#include "anbox/audio/resampler.h"
 #include "anbox/audio/sink.h"
-#include "anbox/graphics/buffer_queue.h"
 
 #include <SDL2/SDL_audio.h>
 
-#include <thread>
+#include <memory>
+#include <mutex>
 
 namespace anbox {
 namespace ubuntu {
 class AudioSink : public audio::Sink {
  public:
-  AudioSink();
+  // Opens the audio device in the format the guest plays in, |info|
+  // has to be one the server accepted.
+  AudioSink(const audio::PlaybackBuffer::Config &config, const audio::ClientInfo &info);
   ~AudioSink();
 
-  void write_data(const std::vector<std::uint8_t> &data) override;
+  void write_data(const std::uint8_t *data, size_t size) override;
+  std::chrono::microseconds latency() const override;
+  size_t period_size() const override;
 
  private:
   bool connect_audio();
   void disconnect_audio();
-  void read_data(std::uint8_t *buffer, int size);
 
   static void on_data_requested(void *user_data, std::uint8_t *buffer, int size);
 
-  std::mutex lock_;
+  mutable std::mutex lock_;
+  const audio::PlaybackBuffer::Config config_;
+  const audio::ClientInfo info_;
   SDL_AudioSpec spec_;
   SDL_AudioDeviceID device_id_;
-  graphics::BufferQueue queue_;
-  graphics::Buffer read_buffer_;
-  size_t read_buffer_left_ = 0;
+  // Both are only set up once the device is open as they depend on the
+  // rate it actually runs at.
+  std::unique_ptr<audio::PlaybackBuffer> buffer_;
+  std::unique_ptr<audio::Resampler> resampler_;
 };
 } // namespace ubuntu
 } // namespace anbox
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/ubuntu/audio_source.h"
+#include "anbox/common/metrics.h"
+#include "anbox/logger.h"
+
+namespace anbox {
+namespace ubuntu {
+AudioSource::AudioSource(const audio::CaptureBuffer::Config &config, const audio::ClientInfo &info) :
+  config_(config),
+  info_(info),
+  device_id_(0),
+  device_rate_(info.sample_rate) {
+  SDL_memset(&spec_, 0, sizeof(spec_));
+  spec_.freq = static_cast<int>(info_.sample_rate);
+  spec_.format = info_.format == audio::ClientInfo::Format::Float ? AUDIO_F32SYS : AUDIO_S16SYS;
+  spec_.channels = info_.channels;
+  spec_.samples = static_cast<Uint16>(config_.chunk_frames);
+  spec_.callback = &AudioSource::on_data_captured;
+  spec_.userdata = this;
+
+  // Just like for playback we resample ourselves, on the reading side, if
+  // the device doesn't capture at the rate the guest wants.
+  SDL_AudioSpec obtained;
+  device_id_ = SDL_OpenAudioDevice(nullptr, 1, &spec_, &obtained, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+  if (!device_id_) {
+    WARNING("Failed to open audio capture device: %s", SDL_GetError());
+    return;
+  }
+
+  device_rate_ = static_cast<std::uint32_t>(obtained.freq);
+  if (device_rate_ != info_.sample_rate) {
+    DEBUG("Audio capture device runs at %d Hz, resampling to %d Hz", device_rate_, info_.sample_rate);
+    resampler_.reset(new audio::Resampler(info_.format, info_.channels, device_rate_, info_.sample_rate));
+  }
+
+  buffer_.reset(new audio::CaptureBuffer(config_, info_.frame_size()));
+  captured_.resize(config_.chunk_frames * info_.frame_size());
+
+  SDL_PauseAudioDevice(device_id_, 0);
+}
+
+AudioSource::~AudioSource() {
+  if (device_id_ == 0)
+    return;
+
+  close();
+  SDL_CloseAudioDevice(device_id_);
+
+  const auto stats = buffer_->statistics();
+  if (stats.overruns > 0)
+    DEBUG("Audio capture dropped data %d times", stats.overruns);
+
+  if (auto metrics = common::Metrics::instance())
+    metrics->counter("anbox_audio_capture_overruns_total",
+                     "Times recorded audio was dropped as Android didn't read it").add(stats.overruns);
+}
+
+void AudioSource::on_data_captured(void *user_data, std::uint8_t *buffer, int size) {
+  auto thiz = static_cast<AudioSource*>(user_data);
+  thiz->buffer_->write(buffer, static_cast<size_t>(size));
+}
+
+bool AudioSource::read_data(std::vector<std::uint8_t> &data) {
+  if (!buffer_)
+    return false;
+
+  const auto size = chunk_size();
+  while (pending_.size() < size) {
+    const auto count = buffer_->read(captured_.data(), captured_.size());
+    if (count == 0)
+      return false;
+
+    if (resampler_) {
+      const auto &resampled = resampler_->process(captured_.data(), count);
+      pending_.insert(pending_.end(), resampled.begin(), resampled.end());
+    } else {
+      pending_.insert(pending_.end(), captured_.begin(), captured_.begin() + count);
+    }
+  }
+
+  data.assign(pending_.begin(), pending_.begin() + size);
+  pending_.erase(pending_.begin(), pending_.begin() + size);
+  return true;
+}
+
+void AudioSource::close() {
+  if (buffer_)
+    buffer_->close();
+}
+
+std::chrono::microseconds AudioSource::latency() const {
+  // A chunk has to be captured by the device and then gathered for the
+  // guest before it is sent.
+  const auto frames = static_cast<std::uint64_t>(config_.chunk_frames);
+  return std::chrono::microseconds{frames * 1000000 / device_rate_ +
+                                   frames * 1000000 / info_.sample_rate};
+}
+
+size_t AudioSource::chunk_size() const {
+  return config_.chunk_frames * info_.frame_size();
+}
+} // namespace ubuntu
+} // namespace anbox
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_UBUNTU_AUDIO_SOURCE_H_
+#define ANBOX_UBUNTU_AUDIO_SOURCE_H_
+
+#include "anbox/audio/capture_buffer.h"
+#include "anbox/audio/client_info.h"
+#include "anbox/audio/resampler.h"
+#include "anbox/audio/source.h"
+
+#include <SDL2/SDL_audio.h>
+
+#include <memory>
+
+namespace anbox {
+namespace ubuntu {
+class AudioSource : public audio::Source {
+ public:
+  // Opens the default capture device in the format the guest records
+  // in, |info| has to be one the server accepted.
+  AudioSource(const audio::CaptureBuffer::Config &config, const audio::ClientInfo &info);
+  ~AudioSource();
+
+  bool is_open() const { return device_id_ > 0; }
+
+  bool read_data(std::vector<std::uint8_t> &data) override;
+  void close() override;
+  std::chrono::microseconds latency() const override;
+  size_t chunk_size() const override;
+
+ private:
+  static void on_data_captured(void *user_data, std::uint8_t *buffer, int size);
+
+  const audio::CaptureBuffer::Config config_;
+  const audio::ClientInfo info_;
+  SDL_AudioSpec spec_;
+  SDL_AudioDeviceID device_id_;
+  std::uint32_t device_rate_;
+  std::unique_ptr<audio::CaptureBuffer> buffer_;
+  std::unique_ptr<audio::Resampler> resampler_;
+  // Only touched by the reader.
+  std::vector<std::uint8_t> captured_;
+  std::vector<std::uint8_t> pending_;
+};
+} // namespace ubuntu
+} // namespace anbox
+
+#endif
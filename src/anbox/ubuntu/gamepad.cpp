@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "anbox/ubuntu/gamepad.h"
+#include "anbox/input/device.h"
+#include "anbox/input/manager.h"
+#include "anbox/logger.h"
+
+#include <limits>
+
+namespace {
+// What the Xbox 360 controller reports. SDL maps everything to its
+// layout and Android ships a key layout for it.
+constexpr std::uint16_t vendor_id{0x045e};
+constexpr std::uint16_t product_id{0x028e};
+
+constexpr std::int32_t stick_min{std::numeric_limits<std::int16_t>::min()};
+constexpr std::int32_t stick_max{std::numeric_limits<std::int16_t>::max()};
+
+std::uint16_t axis_code(std::uint8_t axis) {
+  switch (axis) {
+    case SDL_CONTROLLER_AXIS_LEFTX: return ABS_X;
+    case SDL_CONTROLLER_AXIS_LEFTY: return ABS_Y;
+    case SDL_CONTROLLER_AXIS_RIGHTX: return ABS_RX;
+    case SDL_CONTROLLER_AXIS_RIGHTY: return ABS_RY;
+    case SDL_CONTROLLER_AXIS_TRIGGERLEFT: return ABS_Z;
+    case SDL_CONTROLLER_AXIS_TRIGGERRIGHT: return ABS_RZ;
+    default: break;
+  }
+  return ABS_MAX;
+}
+
+std::uint16_t button_code(std::uint8_t button) {
+  switch (button) {
+    case SDL_CONTROLLER_BUTTON_A: return BTN_A;
+    case SDL_CONTROLLER_BUTTON_B: return BTN_B;
+    case SDL_CONTROLLER_BUTTON_X: return BTN_X;
+    case SDL_CONTROLLER_BUTTON_Y: return BTN_Y;
+    case SDL_CONTROLLER_BUTTON_BACK: return BTN_SELECT;
+    case SDL_CONTROLLER_BUTTON_GUIDE: return BTN_MODE;
+    case SDL_CONTROLLER_BUTTON_START: return BTN_START;
+    case SDL_CONTROLLER_BUTTON_LEFTSTICK: return BTN_THUMBL;
+    case SDL_CONTROLLER_BUTTON_RIGHTSTICK: return BTN_THUMBR;
+    case SDL_CONTROLLER_BUTTON_LEFTSHOULDER: return BTN_TL;
+    case SDL_CONTROLLER_BUTTON_RIGHTSHOULDER: return BTN_TR;
+    default: break;
+  }
+  return KEY_RESERVED;
+}
+}  // namespace
+
+namespace anbox {
+namespace ubuntu {
+std::shared_ptr<Gamepad> Gamepad::open(int index, const std::shared_ptr<input::Manager> &manager) {
+  if (!SDL_IsGameController(index))
+    return nullptr;
+
+  auto controller = SDL_GameControllerOpen(index);
+  if (!controller) {
+    WARNING("Failed to open game controller %d: %s", index, SDL_GetError());
+    return nullptr;
+  }
+
+  std::shared_ptr<Gamepad> gamepad{new Gamepad(controller, manager)};
+  std::weak_ptr<Gamepad> weak_gamepad = gamepad;
+  gamepad->device_->set_rumble_handler([weak_gamepad](const input::Device::Rumble &rumble) {
+    if (auto gamepad = weak_gamepad.lock())
+      gamepad->rumble(rumble.strong, rumble.weak, rumble.duration);
+  });
+  return gamepad;
+}
+
+Gamepad::Gamepad(SDL_GameController *controller, const std::shared_ptr<input::Manager> &manager)
+    : controller_(controller),
+      instance_id_(SDL_JoystickInstanceID(SDL_GameControllerGetJoystick(controller))),
+      manager_(manager),
+      device_(manager->create_device()),
+      dpad_x_(0),
+      dpad_y_(0) {
+  const auto name = SDL_GameControllerName(controller);
+  DEBUG("Game controller %s connected", name ? name : "unknown");
+
+  device_->set_name(name ? name : "anbox-gamepad");
+  device_->set_driver_version(1);
+  device_->set_input_id({BUS_VIRTUAL, vendor_id, product_id, 1});
+  device_->set_physical_location("none");
+
+  for (std::uint8_t button = 0; button < SDL_CONTROLLER_BUTTON_MAX; button++) {
+    const auto code = button_code(button);
+    if (code != KEY_RESERVED)
+      device_->set_key_bit(code);
+  }
+
+  for (const auto axis : {ABS_X, ABS_Y, ABS_RX, ABS_RY}) {
+    device_->set_abs_bit(axis);
+    device_->set_abs_min(axis, static_cast<std::uint32_t>(stick_min));
+    device_->set_abs_max(axis, stick_max);
+  }
+  for (const auto axis : {ABS_Z, ABS_RZ}) {
+    device_->set_abs_bit(axis);
+    device_->set_abs_max(axis, stick_max);
+  }
+  for (const auto axis : {ABS_HAT0X, ABS_HAT0Y}) {
+    device_->set_abs_bit(axis);
+    device_->set_abs_min(axis, static_cast<std::uint32_t>(-1));
+    device_->set_abs_max(axis, 1);
+  }
+
+  device_->set_ff_bit(FF_RUMBLE);
+
+  const auto device = device_;
+  batcher_.reset(new input::EventBatcher(
+      [device](const std::vector<input::Event> &events,
+               const input::EventBatcher::Clock::time_point &time) {
+        device->send_events(events, time);
+      }));
+}
+
+Gamepad::~Gamepad() {
+  manager_->remove_device(device_);
+
+  std::lock_guard<std::mutex> l(lock_);
+  SDL_GameControllerClose(controller_);
+  controller_ = nullptr;
+}
+
+void Gamepad::process_event(const SDL_Event &event, const input::EventBatcher::Clock::time_point &time) {
+  switch (event.type) {
+    case SDL_CONTROLLERAXISMOTION: {
+      const auto code = axis_code(event.caxis.axis);
+      if (code == ABS_MAX)
+        break;
+      batcher_->queue({EV_ABS, code, event.caxis.value}, time);
+      batcher_->queue({EV_SYN, SYN_REPORT, 0}, time);
+      break;
+    }
+    case SDL_CONTROLLERBUTTONDOWN:
+    case SDL_CONTROLLERBUTTONUP: {
+      const std::int32_t pressed = event.type == SDL_CONTROLLERBUTTONDOWN ? 1 : 0;
+      auto dpad_x = dpad_x_;
+      auto dpad_y = dpad_y_;
+      switch (event.cbutton.button) {
+        case SDL_CONTROLLER_BUTTON_DPAD_LEFT: dpad_x = pressed ? -1 : 0; break;
+        case SDL_CONTROLLER_BUTTON_DPAD_RIGHT: dpad_x = pressed ? 1 : 0; break;
+        case SDL_CONTROLLER_BUTTON_DPAD_UP: dpad_y = pressed ? -1 : 0; break;
+        case SDL_CONTROLLER_BUTTON_DPAD_DOWN: dpad_y = pressed ? 1 : 0; break;
+        default: {
+          const auto code = button_code(event.cbutton.button);
+          if (code == KEY_RESERVED)
+            break;
+          batcher_->queue({EV_KEY, code, pressed}, time);
+          batcher_->queue({EV_SYN, SYN_REPORT, 0}, time);
+          return;
+        }
+      }
+      // Axes are merged with other motion, like the sticks, which is
+      // fine as long as the hat doesn't move more than once a frame.
+      if (dpad_x != dpad_x_)
+        batcher_->queue({EV_ABS, ABS_HAT0X, dpad_x}, time);
+      if (dpad_y != dpad_y_)
+        batcher_->queue({EV_ABS, ABS_HAT0Y, dpad_y}, time);
+      batcher_->queue({EV_SYN, SYN_REPORT, 0}, time);
+      dpad_x_ = dpad_x;
+      dpad_y_ = dpad_y;
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+void Gamepad::flush() { batcher_->flush(); }
+
+void Gamepad::rumble(std::uint16_t strong, std::uint16_t weak,
+                     const std::chrono::milliseconds &duration) {
+  std::lock_guard<std::mutex> l(lock_);
+  if (!controller_)
+    return;
+#if SDL_VERSION_ATLEAST(2, 0, 9)
+  if (SDL_GameControllerRumble(controller_, strong, weak, duration.count()) != 0)
+    DEBUG("Game controller doesn't support rumble: %s", SDL_GetError());
+#else
+  (void)strong;
+  (void)weak;
+  (void)duration;
+#endif
+}
+}  // namespace ubuntu
+}  // namespace anbox
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef ANBOX_UBUNTU_GAMEPAD_H_
+#define ANBOX_UBUNTU_GAMEPAD_H_
+
+#include "anbox/input/event_batcher.h"
+
+#include <memory>
+#include <mutex>
+
+#include <SDL.h>
+
+namespace anbox {
+namespace input {
+class Device;
+class Manager;
+}  // namespace input
+namespace ubuntu {
+// A game controller exposed to Android as a joystick device laid out
+// like the one of the Linux xpad driver, which is what SDL maps all
+// controllers it knows to. Android picks the matching key layout by the
+// vendor and product ids we announce.
+//
+// Axis motion is collected until flush() so that Android gets one
+// frame with all axes changed meanwhile. Rumble Android plays on the
+// device is passed on to the controller.
+class Gamepad : public std::enable_shared_from_this<Gamepad> {
+ public:
+  // Returns nullptr if the joystick at |index| isn't a game controller
+  // SDL knows or can't be opened.
+  static std::shared_ptr<Gamepad> open(int index, const std::shared_ptr<input::Manager> &manager);
+
+  ~Gamepad();
+
+  SDL_JoystickID instance_id() const { return instance_id_; }
+
+  // Handles SDL_CONTROLLERAXISMOTION, SDL_CONTROLLERBUTTONDOWN and
+  // SDL_CONTROLLERBUTTONUP events of this controller.
+  void process_event(const SDL_Event &event, const input::EventBatcher::Clock::time_point &time);
+  void flush();
+
+ private:
+  Gamepad(SDL_GameController *controller, const std::shared_ptr<input::Manager> &manager);
+
+  void rumble(std::uint16_t strong, std::uint16_t weak, const std::chrono::milliseconds &duration);
+
+  std::mutex lock_;
+  SDL_GameController *controller_;
+  SDL_JoystickID instance_id_;
+  std::shared_ptr<input::Manager> manager_;
+  std::shared_ptr<input::Device> device_;
+  std::unique_ptr<input::EventBatcher> batcher_;
+  // The d-pad is reported as a hat with one axis per direction.
+  std::int32_t dpad_x_;
+  std::int32_t dpad_y_;
+};
+}  // namespace ubuntu
+}  // namespace anbox
+
+#endif
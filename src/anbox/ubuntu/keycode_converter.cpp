@@ -21,16 +21,9 @@
 
 #include <linux/input.h>
 
-namespace anbox {
-namespace ubuntu {
-std::uint16_t KeycodeConverter::convert(const SDL_Scancode &scan_code) {
-  for (std::uint16_t n = 0; n < code_map.size(); n++) {
-    if (code_map[n] == scan_code) return n;
-  }
-  return KEY_RESERVED;
-}
-
-const std::array<SDL_Scancode, 249> KeycodeConverter::code_map = {{
+namespace {
+// Indexed by the Linux keycode.
+constexpr SDL_Scancode code_map[] = {
     SDL_SCANCODE_UNKNOWN,        /*  KEY_RESERVED        0 */
     SDL_SCANCODE_ESCAPE,         /*  KEY_ESC         1 */
     SDL_SCANCODE_1,              /*  KEY_1           2 */
@@ -288,6 +281,45 @@ const std::array<SDL_Scancode, 249> KeycodeConverter::code_map = {{
     SDL_SCANCODE_UNKNOWN,        /*  KEY_RFKILL      247 Key that controls all radios
                              */
     SDL_SCANCODE_UNKNOWN         /*  KEY_MICMUTE     248 Mute / unmute the microphone */
-}};
+};
+constexpr std::size_t code_map_size = sizeof(code_map) / sizeof(code_map[0]);
+
+struct ScancodeMap {
+  std::uint16_t codes[SDL_NUM_SCANCODES];
+};
+
+// Some scancodes appear for more than one keycode, the first one wins.
+constexpr ScancodeMap invert_code_map() {
+  ScancodeMap map{};
+  for (auto n = code_map_size; n-- > 0;)
+    map.codes[code_map[n]] = static_cast<std::uint16_t>(n);
+  map.codes[SDL_SCANCODE_UNKNOWN] = KEY_RESERVED;
+  return map;
+}
+
+constexpr ScancodeMap scancode_map = invert_code_map();
+
+constexpr bool scancode_map_matches_code_map() {
+  for (std::size_t n = 0; n < code_map_size; n++) {
+    const auto code = scancode_map.codes[code_map[n]];
+    if (code_map[n] != SDL_SCANCODE_UNKNOWN && (code > n || code_map[code] != code_map[n]))
+      return false;
+  }
+  return true;
+}
+
+static_assert(code_map_size == KEY_MICMUTE + 1, "Every keycode up to KEY_MICMUTE needs an entry");
+static_assert(scancode_map_matches_code_map(), "Scancodes have to map back to their first keycode");
+static_assert(scancode_map.codes[SDL_SCANCODE_UNKNOWN] == KEY_RESERVED, "Unknown scancodes have no keycode");
+static_assert(scancode_map.codes[SDL_SCANCODE_A] == KEY_A, "Keycodes are indices of the code map");
+}  // namespace
+
+namespace anbox {
+namespace ubuntu {
+std::uint16_t KeycodeConverter::convert(const SDL_Scancode &scan_code) {
+  const auto index = static_cast<unsigned int>(scan_code);
+  if (index >= SDL_NUM_SCANCODES) return KEY_RESERVED;
+  return scancode_map.codes[index];
+}
 }  // namespace ubuntu
 }  // namespace anbox
@@ -22,16 +22,11 @@
 
 #include <cstdint>
 
-#include <array>
-
 namespace anbox {
 namespace ubuntu {
 class KeycodeConverter {
  public:
   static std::uint16_t convert(const SDL_Scancode &scan_code);
-
- private:
-  static const std::array<SDL_Scancode, 249> code_map;
 };
 }  // namespace ubuntu
 }  // namespace anbox
@@ -18,46 +18,83 @@
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wswitch-default"
 #include "anbox/ubuntu/platform_policy.h"
+#include "anbox/common/tracer.h"
 #include "anbox/input/device.h"
+#include "anbox/input/event_batch.h"
 #include "anbox/input/manager.h"
 #include "anbox/logger.h"
+#include "anbox/ubuntu/gamepad.h"
 #include "anbox/ubuntu/keycode_converter.h"
 #include "anbox/ubuntu/window.h"
 #include "anbox/ubuntu/audio_sink.h"
+#include "anbox/ubuntu/audio_source.h"
+#if defined(PULSEAUDIO_SUPPORT)
+#include "anbox/ubuntu/pulse_audio_output.h"
+#endif
 #include "anbox/wm/manager.h"
 
 #include <boost/throw_exception.hpp>
 
+#include <algorithm>
+
 #include <signal.h>
 #include <sys/types.h>
 #pragma GCC diagnostic pop
 
+namespace {
+// Mouse events SDL emulates for touches come from SDL_TOUCH_MOUSEID,
+// spelled out here as SDL defines it with a C style cast.
+constexpr std::uint32_t touch_mouse_id = ~std::uint32_t{0};
+
+// Pressed together with Ctrl and Alt it captures the pointer for the
+// focused window or releases it again, like virtual machine viewers do.
+constexpr SDL_Keycode pointer_capture_key = SDLK_g;
+}  // namespace
+
 namespace anbox {
 namespace ubuntu {
 PlatformPolicy::PlatformPolicy(
     const std::shared_ptr<input::Manager> &input_manager,
     const graphics::Rect &static_display_frame,
-    bool single_window)
+    bool single_window,
+    const std::chrono::milliseconds &input_batch_window)
     : input_manager_(input_manager),
       event_thread_running_(false),
+      window_event_thread_running_(true),
       single_window_(single_window) {
   if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_EVENTS) < 0) {
     const auto message = utils::string_format("Failed to initialize SDL: %s", SDL_GetError());
     BOOST_THROW_EXCEPTION(std::runtime_error(message));
   }
 
-  auto display_frame = graphics::Rect::Invalid;
-  if (static_display_frame == graphics::Rect::Invalid) {
-    for (auto n = 0; n < SDL_GetNumVideoDisplays(); n++) {
-      SDL_Rect r;
-      if (SDL_GetDisplayBounds(n, &r) != 0) continue;
+  // Game controllers are nice to have but nothing to fail for.
+  if (SDL_InitSubSystem(SDL_INIT_GAMECONTROLLER) < 0)
+    WARNING("Failed to initialize SDL game controller support: %s", SDL_GetError());
+
+  for (auto n = 0; n < SDL_GetNumVideoDisplays(); n++) {
+    SDL_Rect r;
+    if (SDL_GetDisplayBounds(n, &r) != 0) continue;
 
-      graphics::Rect frame{r.x, r.y, r.x + r.w, r.y + r.h};
+    SDL_DisplayMode mode;
+    const auto refresh_rate = SDL_GetCurrentDisplayMode(n, &mode) == 0 ? mode.refresh_rate : 0;
 
+    float dpi = 0.0f;
+    if (SDL_GetDisplayDPI(n, &dpi, nullptr, nullptr) != 0)
+      dpi = 0.0f;
+
+    DEBUG("Display %d at %d,%d %dx%d refreshes at %d Hz with %.0f dpi",
+          n, r.x, r.y, r.w, r.h, refresh_rate, dpi);
+    displays_.push_back(wm::Display{n, {r.x, r.y, r.x + r.w, r.y + r.h},
+                                    refresh_rate, static_cast<int>(dpi + 0.5f)});
+  }
+
+  auto display_frame = graphics::Rect::Invalid;
+  if (static_display_frame == graphics::Rect::Invalid) {
+    for (const auto &display : displays_) {
       if (display_frame == graphics::Rect::Invalid)
-        display_frame = frame;
+        display_frame = display.frame();
       else
-        display_frame.merge(frame);
+        display_frame.merge(display.frame());
     }
 
     if (display_frame == graphics::Rect::Invalid)
@@ -71,6 +108,18 @@ PlatformPolicy::PlatformPolicy(
   display_info_.horizontal_resolution = display_frame.width();
   display_info_.vertical_resolution = display_frame.height();
 
+  // The guest only sees a single display spanning all host displays. When
+  // they refresh at different rates we go with the fastest one so that
+  // windows on it don't judder. The compositor paces the windows on each
+  // host display at the rate of that display.
+  display_info_.refresh_rate = 0;
+  for (const auto &display : displays_)
+    display_info_.refresh_rate = std::max(display_info_.refresh_rate, display.refresh_rate());
+
+  // Android picks the size of everything it draws from this so we go with
+  // the primary display where windows show up first.
+  display_info_.dpi = displays_.empty() ? 0 : displays_.front().dpi();
+
   pointer_ = input_manager->create_device();
   pointer_->set_name("anbox-pointer");
   pointer_->set_driver_version(1);
@@ -85,6 +134,14 @@ PlatformPolicy::PlatformPolicy(
   pointer_->set_rel_bit(REL_WHEEL);
   pointer_->set_prop_bit(INPUT_PROP_POINTER);
 
+  const auto pointer = pointer_;
+  pointer_batcher_.reset(new input::EventBatcher(
+      [pointer](const std::vector<input::Event> &events,
+                const input::EventBatcher::Clock::time_point &time) {
+        pointer->send_events(events, time);
+      },
+      input_batch_window));
+
   keyboard_ = input_manager->create_device();
   keyboard_->set_name("anbox-keyboard");
   keyboard_->set_driver_version(1);
@@ -93,61 +150,276 @@ PlatformPolicy::PlatformPolicy(
   keyboard_->set_key_bit(BTN_MISC);
   keyboard_->set_key_bit(KEY_OK);
 
+  touch_ = input_manager->create_device();
+  touch_->set_name("anbox-touch");
+  touch_->set_driver_version(1);
+  touch_->set_input_id({BUS_VIRTUAL, 4, 4, 4});
+  touch_->set_physical_location("none");
+  touch_->set_key_bit(BTN_TOUCH);
+  touch_->set_abs_bit(ABS_MT_SLOT);
+  touch_->set_abs_max(ABS_MT_SLOT, input::MultiTouch::max_slots - 1);
+  touch_->set_abs_bit(ABS_MT_TRACKING_ID);
+  touch_->set_abs_max(ABS_MT_TRACKING_ID, input::MultiTouch::max_tracking_id);
+  touch_->set_abs_bit(ABS_MT_POSITION_X);
+  touch_->set_abs_max(ABS_MT_POSITION_X, display_info_.horizontal_resolution - 1);
+  touch_->set_abs_bit(ABS_MT_POSITION_Y);
+  touch_->set_abs_max(ABS_MT_POSITION_Y, display_info_.vertical_resolution - 1);
+  // Makes Android treat us as a touch screen rather than a touch pad.
+  touch_->set_prop_bit(INPUT_PROP_DIRECT);
+
+  const auto touch = touch_;
+  multi_touch_.reset(new input::MultiTouch(
+      [touch](const std::vector<input::Event> &events,
+              const input::MultiTouch::Clock::time_point &time) {
+        touch->send_events(events, time);
+      }));
+
+  window_event_thread_ = std::thread(&PlatformPolicy::process_window_events, this);
+  event_thread_running_ = true;
   event_thread_ = std::thread(&PlatformPolicy::process_events, this);
 }
 
 PlatformPolicy::~PlatformPolicy() {
-  if (event_thread_running_) {
-    event_thread_running_ = false;
-    event_thread_.join();
+  event_thread_running_ = false;
+  event_thread_.join();
+
+  {
+    std::lock_guard<std::mutex> l(window_events_lock_);
+    window_event_thread_running_ = false;
   }
+  window_events_changed_.notify_all();
+  window_event_thread_.join();
 }
 
 void PlatformPolicy::set_renderer(const std::shared_ptr<Renderer> &renderer) {
   renderer_ = renderer;
 }
 
+void PlatformPolicy::set_audio_config(const audio::PlaybackBuffer::Config &config) {
+  audio_config_ = config;
+}
+
+void PlatformPolicy::set_audio_capture_config(const audio::CaptureBuffer::Config &config) {
+  audio_capture_config_ = config;
+}
+
+void PlatformPolicy::set_audio_backend(const audio::Backend &backend) {
+  audio_backend_ = backend;
+}
+
+void PlatformPolicy::enable_display_scaling() {
+  scale_display_ = single_window_;
+  if (scale_display_)
+    window_size_immutable_ = false;
+}
+
 void PlatformPolicy::set_window_manager(const std::shared_ptr<wm::Manager> &window_manager) {
   window_manager_ = window_manager;
 }
 
 void PlatformPolicy::process_events() {
-  event_thread_running_ = true;
-
   while (event_thread_running_) {
     SDL_Event event;
-    while (SDL_WaitEventTimeout(&event, 100)) {
+    // Everything already queued is handled before the next flush so that
+    // mouse motion which piled up meanwhile goes out merged.
+    bool has_event = SDL_WaitEventTimeout(&event, event_timeout());
+    for (; has_event; has_event = SDL_PollEvent(&event)) {
       switch (event.type) {
         case SDL_QUIT:
           break;
-        case SDL_WINDOWEVENT:
-          for (auto &iter : windows_) {
-            if (auto w = iter.second.lock()) {
-              if (w->window_id() == event.window.windowID) {
-                w->process_event(event);
-                break;
-              }
-            }
-          }
+        case SDL_WINDOWEVENT: {
+          if (event.window.windowID == captured_window_ &&
+              (event.window.event == SDL_WINDOWEVENT_FOCUS_LOST ||
+               event.window.event == SDL_WINDOWEVENT_HIDDEN ||
+               event.window.event == SDL_WINDOWEVENT_CLOSE))
+            release_pointer();
+          std::lock_guard<std::mutex> l(window_events_lock_);
+          window_events_.push_back(event);
+          window_events_changed_.notify_all();
           break;
+        }
         case SDL_MOUSEMOTION:
         case SDL_MOUSEBUTTONDOWN:
         case SDL_MOUSEBUTTONUP:
         case SDL_MOUSEWHEEL:
         case SDL_KEYDOWN:
         case SDL_KEYUP:
+        case SDL_FINGERDOWN:
+        case SDL_FINGERUP:
+        case SDL_FINGERMOTION:
           process_input_event(event);
           break;
+        case SDL_CONTROLLERDEVICEADDED:
+        case SDL_CONTROLLERDEVICEREMOVED:
+        case SDL_CONTROLLERAXISMOTION:
+        case SDL_CONTROLLERBUTTONDOWN:
+        case SDL_CONTROLLERBUTTONUP:
+          process_gamepad_event(event);
+          break;
+        case SDL_CLIPBOARDUPDATE: {
+          std::lock_guard<std::mutex> l(clipboard_lock_);
+          if (clipboard_changed_)
+            clipboard_changed_();
+          break;
+        }
         default:
           break;
       }
     }
+    pointer_batcher_->flush_if_due();
+    for (const auto &gamepad : gamepads_)
+      gamepad.second->flush();
+    // All fingers which moved meanwhile go out in a single frame.
+    multi_touch_->flush();
+  }
+}
+
+void PlatformPolicy::process_window_events() {
+  std::unique_lock<std::mutex> l(window_events_lock_);
+  while (true) {
+    window_events_changed_.wait(l, [&]() {
+      return !window_events_.empty() || !window_event_thread_running_;
+    });
+    if (!window_event_thread_running_)
+      break;
+
+    const auto event = window_events_.front();
+    window_events_.pop_front();
+    l.unlock();
+
+    std::shared_ptr<Window> window;
+    {
+      std::lock_guard<std::mutex> wl(windows_lock_);
+      auto w = sdl_windows_.find(event.window.windowID);
+      if (w != sdl_windows_.end()) {
+        window = w->second.lock();
+        if (!window)
+          sdl_windows_.erase(w);
+      }
+    }
+    if (window)
+      window->process_event(event);
+
+    l.lock();
   }
 }
 
+void PlatformPolicy::process_gamepad_event(const SDL_Event &event) {
+  switch (event.type) {
+    case SDL_CONTROLLERDEVICEADDED: {
+      // Gives us the index of the joystick rather than its instance id.
+      auto gamepad = Gamepad::open(event.cdevice.which, input_manager_);
+      if (gamepad)
+        gamepads_[gamepad->instance_id()] = gamepad;
+      break;
+    }
+    case SDL_CONTROLLERDEVICEREMOVED:
+      gamepads_.erase(event.cdevice.which);
+      break;
+    default: {
+      // Axis and button events share the layout of the instance id.
+      auto gamepad = gamepads_.find(event.cbutton.which);
+      if (gamepad != gamepads_.end())
+        gamepad->second->process_event(event, event_time(event));
+      break;
+    }
+  }
+}
+
+input::EventBatcher::Clock::time_point PlatformPolicy::event_time(const SDL_Event &event) {
+  // SDL stamps events with the milliseconds passed since it was
+  // initialized. Anything off by more than a second comes from
+  // somewhere else and isn't worth more than the current time.
+  const auto now = input::EventBatcher::Clock::now();
+  const auto age = SDL_GetTicks() - event.common.timestamp;
+  if (age > 1000)
+    return now;
+  return now - std::chrono::milliseconds{age};
+}
+
+void PlatformPolicy::scale_to_display(std::int32_t width, std::int32_t height,
+                                      std::int32_t &x, std::int32_t &y) const {
+  if (!scale_display_ || width <= 0 || height <= 0)
+    return;
+  x = static_cast<std::int32_t>(static_cast<std::int64_t>(x) * display_info_.horizontal_resolution / width);
+  y = static_cast<std::int32_t>(static_cast<std::int64_t>(y) * display_info_.vertical_resolution / height);
+}
+
+bool PlatformPolicy::finger_position(const SDL_TouchFingerEvent &event,
+                                     std::int32_t &x, std::int32_t &y) const {
+#if SDL_VERSION_ATLEAST(2, 0, 12)
+  auto window = SDL_GetWindowFromID(event.windowID);
+#else
+  // Older versions don't tell us where the finger is so we go with the
+  // window SDL moves the emulated mouse pointer into.
+  auto window = SDL_GetMouseFocus();
+#endif
+  if (!window)
+    return false;
+
+  // Positions are normalized to the window.
+  std::int32_t width = 0, height = 0;
+  SDL_GetWindowSize(window, &width, &height);
+  x = static_cast<std::int32_t>(event.x * width);
+  y = static_cast<std::int32_t>(event.y * height);
+
+  if (single_window_) {
+    scale_to_display(width, height, x, y);
+  } else {
+    std::int32_t window_x = 0, window_y = 0;
+    SDL_GetWindowPosition(window, &window_x, &window_y);
+    x += window_x;
+    y += window_y;
+  }
+
+  x = std::max(0, std::min(x, display_info_.horizontal_resolution - 1));
+  y = std::max(0, std::min(y, display_info_.vertical_resolution - 1));
+  return true;
+}
+
+void PlatformPolicy::capture_pointer(std::uint32_t window_id) {
+  auto window = SDL_GetWindowFromID(window_id);
+  if (!window)
+    return;
+
+  // Android only ever sees the motion then, the pointer stays where it is
+  // and can't leave the window.
+  if (SDL_SetRelativeMouseMode(SDL_TRUE) != 0) {
+    WARNING("Failed to capture the pointer: %s", SDL_GetError());
+    return;
+  }
+  SDL_SetWindowGrab(window, SDL_TRUE);
+  captured_window_ = window_id;
+  DEBUG("Captured the pointer for window %d", window_id);
+}
+
+void PlatformPolicy::release_pointer() {
+  if (captured_window_ == 0)
+    return;
+
+  // Whatever motion is left belongs to the captured window.
+  pointer_batcher_->flush();
+  SDL_SetRelativeMouseMode(SDL_FALSE);
+  if (auto window = SDL_GetWindowFromID(captured_window_))
+    SDL_SetWindowGrab(window, SDL_FALSE);
+  DEBUG("Released the pointer of window %d", captured_window_);
+  captured_window_ = 0;
+}
+
+int PlatformPolicy::event_timeout() const {
+  if (pointer_batcher_->empty())
+    return 100;
+
+  const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+      pointer_batcher_->deadline() - input::EventBatcher::Clock::now());
+  return std::max<int>(0, remaining.count());
+}
+
 void PlatformPolicy::process_input_event(const SDL_Event &event) {
-  std::vector<input::Event> mouse_events;
-  std::vector<input::Event> keyboard_events;
+  ANBOX_TRACE_SPAN("input", "process_input_event");
+  auto &mouse = *pointer_batcher_;
+  input::EventBatch keyboard_events;
+  const auto time = event_time(event);
 
   std::int32_t x = 0;
   std::int32_t y = 0;
@@ -155,14 +427,26 @@ void PlatformPolicy::process_input_event(const SDL_Event &event) {
 
   switch (event.type) {
     case SDL_MOUSEBUTTONDOWN:
-      mouse_events.push_back({EV_KEY, BTN_LEFT, 1});
-      mouse_events.push_back({EV_SYN, SYN_REPORT, 0});
+      // Touches reach Android through the touch device already.
+      if (event.button.which == touch_mouse_id) break;
+      mouse.queue({EV_KEY, BTN_LEFT, 1}, time);
+      mouse.queue({EV_SYN, SYN_REPORT, 0}, time);
       break;
     case SDL_MOUSEBUTTONUP:
-      mouse_events.push_back({EV_KEY, BTN_LEFT, 0});
-      mouse_events.push_back({EV_SYN, SYN_REPORT, 0});
+      if (event.button.which == touch_mouse_id) break;
+      mouse.queue({EV_KEY, BTN_LEFT, 0}, time);
+      mouse.queue({EV_SYN, SYN_REPORT, 0}, time);
       break;
     case SDL_MOUSEMOTION:
+      if (event.motion.which == touch_mouse_id) break;
+      if (captured_window_ != 0) {
+        // Pure relative motion which the batcher adds up until it is
+        // sent, so there is no position to look up.
+        mouse.queue({EV_REL, REL_X, event.motion.xrel}, time);
+        mouse.queue({EV_REL, REL_Y, event.motion.yrel}, time);
+        mouse.queue({EV_SYN, SYN_REPORT, 0}, time);
+        break;
+      }
       if (!single_window_) {
         // As we get only absolute coordindates relative to our window we have to
         // calculate the correct position based on the current focused window
@@ -178,25 +462,55 @@ void PlatformPolicy::process_input_event(const SDL_Event &event) {
         // relative to our window.
         x = event.motion.x;
         y = event.motion.y;
+        if (scale_display_) {
+          window = SDL_GetWindowFromID(event.motion.windowID);
+          if (!window) break;
+
+          std::int32_t width = 0, height = 0;
+          SDL_GetWindowSize(window, &width, &height);
+          scale_to_display(width, height, x, y);
+        }
       }
 
       // NOTE: Sending relative move events doesn't really work and we have
       // changes in libinputflinger to take ABS_X/ABS_Y instead for absolute
       // position events.
-      mouse_events.push_back({EV_ABS, ABS_X, x});
-      mouse_events.push_back({EV_ABS, ABS_Y, y});
+      mouse.queue({EV_ABS, ABS_X, x}, time);
+      mouse.queue({EV_ABS, ABS_Y, y}, time);
       // We're sending relative position updates here too but they will be only
       // used by the Android side EventHub/InputReader to determine if the cursor
       // was moved. They are not used to find out the exact position.
-      mouse_events.push_back({EV_REL, REL_X, event.motion.xrel});
-      mouse_events.push_back({EV_REL, REL_Y, event.motion.yrel});
-      mouse_events.push_back({EV_SYN, SYN_REPORT, 0});
+      mouse.queue({EV_REL, REL_X, event.motion.xrel}, time);
+      mouse.queue({EV_REL, REL_Y, event.motion.yrel}, time);
+      mouse.queue({EV_SYN, SYN_REPORT, 0}, time);
       break;
     case SDL_MOUSEWHEEL:
-      mouse_events.push_back(
-          {EV_REL, REL_WHEEL, static_cast<std::int32_t>(event.wheel.y)});
+      mouse.queue(
+          {EV_REL, REL_WHEEL, static_cast<std::int32_t>(event.wheel.y)}, time);
+      mouse.queue({EV_SYN, SYN_REPORT, 0}, time);
+      break;
+    case SDL_FINGERDOWN:
+      if (finger_position(event.tfinger, x, y))
+        multi_touch_->down(event.tfinger.fingerId, x, y, time);
+      break;
+    case SDL_FINGERMOTION:
+      if (finger_position(event.tfinger, x, y))
+        multi_touch_->move(event.tfinger.fingerId, x, y, time);
+      break;
+    case SDL_FINGERUP:
+      multi_touch_->up(event.tfinger.fingerId, time);
       break;
     case SDL_KEYDOWN: {
+      if (event.key.keysym.sym == pointer_capture_key &&
+          (event.key.keysym.mod & KMOD_CTRL) && (event.key.keysym.mod & KMOD_ALT)) {
+        if (event.key.repeat)
+          break;
+        if (captured_window_ != 0)
+          release_pointer();
+        else
+          capture_pointer(event.key.windowID);
+        break;
+      }
       const auto code = KeycodeConverter::convert(event.key.keysym.scancode);
       if (code == KEY_RESERVED) break;
       keyboard_events.push_back({EV_KEY, code, 1});
@@ -212,9 +526,8 @@ void PlatformPolicy::process_input_event(const SDL_Event &event) {
       break;
   }
 
-  if (mouse_events.size() > 0) pointer_->send_events(mouse_events);
-
-  if (keyboard_events.size() > 0) keyboard_->send_events(keyboard_events);
+  if (!keyboard_events.empty())
+    keyboard_->send_events(keyboard_events.data(), keyboard_events.size(), time);
 }
 
 Window::Id PlatformPolicy::next_window_id() {
@@ -231,35 +544,45 @@ std::shared_ptr<wm::Window> PlatformPolicy::create_window(
 
   auto id = next_window_id();
   auto w = std::make_shared<Window>(renderer_, id, task, shared_from_this(), frame, title, !window_size_immutable_);
+  std::lock_guard<std::mutex> l(windows_lock_);
   windows_.insert({id, w});
+  sdl_windows_.insert({w->window_id(), w});
   return w;
 }
 
-void PlatformPolicy::window_deleted(const Window::Id &id) {
+std::shared_ptr<Window> PlatformPolicy::find_window(const Window::Id &id) {
+  std::lock_guard<std::mutex> l(windows_lock_);
   auto w = windows_.find(id);
-  if (w == windows_.end()) {
-    WARNING("Got window removed event for unknown window (id %d)", id);
-    return;
+  if (w == windows_.end()) return nullptr;
+  return w->second.lock();
+}
+
+void PlatformPolicy::window_deleted(const Window::Id &id) {
+  std::shared_ptr<Window> window;
+  {
+    std::lock_guard<std::mutex> l(windows_lock_);
+    auto w = windows_.find(id);
+    if (w == windows_.end()) {
+      WARNING("Got window removed event for unknown window (id %d)", id);
+      return;
+    }
+    window = w->second.lock();
+    windows_.erase(w);
+    if (window)
+      sdl_windows_.erase(window->window_id());
   }
-  if (auto window = w->second.lock())
+  if (window)
     window_manager_->remove_task(window->task());
-  windows_.erase(w);
 }
 
 void PlatformPolicy::window_wants_focus(const Window::Id &id) {
-  auto w = windows_.find(id);
-  if (w == windows_.end()) return;
-
-  if (auto window = w->second.lock())
+  if (auto window = find_window(id))
     window_manager_->set_focused_task(window->task());
 }
 
 void PlatformPolicy::window_moved(const Window::Id &id, const std::int32_t &x,
                                   const std::int32_t &y) {
-  auto w = windows_.find(id);
-  if (w == windows_.end()) return;
-
-  if (auto window = w->second.lock()) {
+  if (auto window = find_window(id)) {
     auto new_frame = window->frame();
     new_frame.translate(x, y);
     window->update_frame(new_frame);
@@ -270,10 +593,7 @@ void PlatformPolicy::window_moved(const Window::Id &id, const std::int32_t &x,
 void PlatformPolicy::window_resized(const Window::Id &id,
                                     const std::int32_t &width,
                                     const std::int32_t &height) {
-  auto w = windows_.find(id);
-  if (w == windows_.end()) return;
-
-  if (auto window = w->second.lock()) {
+  if (auto window = find_window(id)) {
     auto new_frame = window->frame();
     new_frame.resize(width, height);
     // We need to update the window frame in advance here as otherwise we may
@@ -289,6 +609,10 @@ DisplayManager::DisplayInfo PlatformPolicy::display_info() const {
   return display_info_;
 }
 
+wm::Display::List PlatformPolicy::displays() const {
+  return displays_;
+}
+
 void PlatformPolicy::set_clipboard_data(const ClipboardData &data) {
   if (data.text.empty())
     return;
@@ -308,13 +632,28 @@ PlatformPolicy::ClipboardData PlatformPolicy::get_clipboard_data() {
   return data;
 }
 
-std::shared_ptr<audio::Sink> PlatformPolicy::create_audio_sink() {
-  return std::make_shared<AudioSink>();
+void PlatformPolicy::register_clipboard_changed_handler(const std::function<void()> &handler) {
+  std::lock_guard<std::mutex> l(clipboard_lock_);
+  clipboard_changed_ = handler;
 }
 
-std::shared_ptr<audio::Source> PlatformPolicy::create_audio_source() {
-  ERROR("Not implemented");
-  return nullptr;
+std::shared_ptr<audio::Sink> PlatformPolicy::create_audio_sink(const audio::ClientInfo &info) {
+#if defined(PULSEAUDIO_SUPPORT)
+  if (audio_backend_ == audio::Backend::PulseAudio) {
+    std::lock_guard<std::mutex> l(audio_lock_);
+    if (!pulse_audio_output_)
+      pulse_audio_output_ = std::make_shared<PulseAudioOutput>(audio_config_);
+    return pulse_audio_output_->create_sink(info);
+  }
+#endif
+  return std::make_shared<AudioSink>(audio_config_, info);
+}
+
+std::shared_ptr<audio::Source> PlatformPolicy::create_audio_source(const audio::ClientInfo &info) {
+  auto source = std::make_shared<AudioSource>(audio_capture_config_, info);
+  if (!source->is_open())
+    return nullptr;
+  return source;
 }
 }  // namespace wm
 }  // namespace anbox
@@ -20,11 +20,23 @@
 
 #include "anbox/ubuntu/window.h"
 #include "anbox/platform/policy.h"
+#include "anbox/audio/backend.h"
+#include "anbox/audio/capture_buffer.h"
+#include "anbox/audio/playback_buffer.h"
 
 #include "anbox/graphics/emugl/DisplayManager.h"
+#include "anbox/input/event_batcher.h"
+#include "anbox/input/multi_touch.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <thread>
+#include <unordered_map>
 
 #include <SDL.h>
 
@@ -39,6 +51,8 @@ namespace wm {
 class Manager;
 } // namespace wm
 namespace ubuntu {
+class Gamepad;
+class PulseAudioOutput;
 class PlatformPolicy : public std::enable_shared_from_this<PlatformPolicy>,
                        public platform::Policy,
                        public Window::Observer,
@@ -46,7 +60,9 @@ class PlatformPolicy : public std::enable_shared_from_this<PlatformPolicy>,
  public:
   PlatformPolicy(const std::shared_ptr<input::Manager> &input_manager,
                  const graphics::Rect &static_display_frame = graphics::Rect::Invalid,
-                 bool single_window = false);
+                 bool single_window = false,
+                 const std::chrono::milliseconds &input_batch_window =
+                     input::EventBatcher::default_window);
   ~PlatformPolicy();
 
   std::shared_ptr<wm::Window> create_window(
@@ -62,36 +78,96 @@ class PlatformPolicy : public std::enable_shared_from_this<PlatformPolicy>,
                       const std::int32_t &height) override;
 
   DisplayInfo display_info() const override;
+  wm::Display::List displays() const override;
 
   void set_renderer(const std::shared_ptr<Renderer> &renderer);
   void set_window_manager(const std::shared_ptr<wm::Manager> &window_manager);
+  // Buffering of the audio sinks created afterwards.
+  void set_audio_config(const audio::PlaybackBuffer::Config &config);
+  // Buffering of the audio sources created afterwards.
+  void set_audio_capture_config(const audio::CaptureBuffer::Config &config);
+  // Where the audio sinks created afterwards play to.
+  void set_audio_backend(const audio::Backend &backend);
+
+  // In single window mode the window can then be resized freely while the
+  // display Android sees keeps its size. Input is scaled to the display.
+  void enable_display_scaling();
 
   void set_clipboard_data(const ClipboardData &data) override;
   ClipboardData get_clipboard_data() override;
+  void register_clipboard_changed_handler(const std::function<void()> &handler) override;
 
-  std::shared_ptr<audio::Sink> create_audio_sink() override;
-  std::shared_ptr<audio::Source> create_audio_source() override;
+  std::shared_ptr<audio::Sink> create_audio_sink(const audio::ClientInfo &info) override;
+  std::shared_ptr<audio::Source> create_audio_source(const audio::ClientInfo &info) override;
 
  private:
   void process_events();
+  void process_window_events();
   void process_input_event(const SDL_Event &event);
+  void process_gamepad_event(const SDL_Event &event);
+  // Converts the time SDL stamped an event with.
+  static input::EventBatcher::Clock::time_point event_time(const SDL_Event &event);
+  // Translates a finger position into display coordinates.
+  // Maps a position in a single window of the given size onto the display.
+  void scale_to_display(std::int32_t width, std::int32_t height,
+                        std::int32_t &x, std::int32_t &y) const;
+  bool finger_position(const SDL_TouchFingerEvent &event, std::int32_t &x,
+                       std::int32_t &y) const;
+  // Sends nothing but relative motion while the window with the given SDL
+  // id has the focus, until release_pointer().
+  void capture_pointer(std::uint32_t window_id);
+  void release_pointer();
+  // How long to wait for events until queued input has to be sent.
+  int event_timeout() const;
 
   static Window::Id next_window_id();
+  std::shared_ptr<Window> find_window(const Window::Id &id);
 
   std::shared_ptr<Renderer> renderer_;
   std::shared_ptr<input::Manager> input_manager_;
   std::shared_ptr<wm::Manager> window_manager_;
+  std::mutex clipboard_lock_;
+  std::function<void()> clipboard_changed_;
   // We don't own the windows anymore after the got created by us so we
   // need to be careful once we try to use them again.
-  std::map<Window::Id, std::weak_ptr<Window>> windows_;
+  std::mutex windows_lock_;
+  std::unordered_map<Window::Id, std::weak_ptr<Window>> windows_;
+  // The same windows by the id SDL knows them as.
+  std::unordered_map<std::uint32_t, std::weak_ptr<Window>> sdl_windows_;
   std::shared_ptr<Window> current_window_;
+  // Reads all SDL events and handles input. Window events can take long
+  // to handle, they are passed on to the window event thread instead so
+  // that they don't delay input.
   std::thread event_thread_;
-  bool event_thread_running_;
+  std::atomic<bool> event_thread_running_;
+  std::thread window_event_thread_;
+  std::mutex window_events_lock_;
+  std::condition_variable window_events_changed_;
+  std::deque<SDL_Event> window_events_;
+  bool window_event_thread_running_;
   std::shared_ptr<input::Device> pointer_;
   std::shared_ptr<input::Device> keyboard_;
+  std::unique_ptr<input::EventBatcher> pointer_batcher_;
+  // SDL id of the window the pointer is captured for or zero. Only used by
+  // the event thread.
+  std::uint32_t captured_window_ = 0;
+  std::shared_ptr<input::Device> touch_;
+  std::unique_ptr<input::MultiTouch> multi_touch_;
+  // Only used by the event thread.
+  std::map<SDL_JoystickID, std::shared_ptr<Gamepad>> gamepads_;
   DisplayManager::DisplayInfo display_info_;
+  wm::Display::List displays_;
   bool window_size_immutable_ = false;
   bool single_window_ = false;
+  bool scale_display_ = false;
+  audio::PlaybackBuffer::Config audio_config_{audio::PlaybackBuffer::default_period_frames,
+                                              audio::PlaybackBuffer::default_buffer_frames};
+  audio::CaptureBuffer::Config audio_capture_config_{audio::CaptureBuffer::default_chunk_frames,
+                                                     audio::CaptureBuffer::default_buffer_frames};
+  audio::Backend audio_backend_ = audio::Backend::SDL;
+  std::mutex audio_lock_;
+  // Shared by all sinks, created with the first one.
+  std::shared_ptr<PulseAudioOutput> pulse_audio_output_;
 };
 }  // namespace wm
 }  // namespace anbox
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/ubuntu/pulse_audio_output.h"
+#include "anbox/audio/sink.h"
+#include "anbox/logger.h"
+
+#include <pulse/error.h>
+#include <pulse/simple.h>
+
+#include <vector>
+
+namespace {
+constexpr std::chrono::seconds reconnect_delay{2};
+}  // namespace
+
+namespace anbox {
+namespace ubuntu {
+PulseAudioOutput::PulseAudioOutput(const audio::PlaybackBuffer::Config &config)
+    : mixer_(audio::Mixer::default_sample_rate, config),
+      stream_(nullptr),
+      thread_(&PulseAudioOutput::run, this) {}
+
+PulseAudioOutput::~PulseAudioOutput() {
+  mixer_.close();
+  thread_.join();
+}
+
+std::shared_ptr<audio::Sink> PulseAudioOutput::create_sink(const audio::ClientInfo &info) {
+  return mixer_.create_stream(info);
+}
+
+bool PulseAudioOutput::connect() {
+  pa_sample_spec spec;
+  spec.format = PA_SAMPLE_FLOAT32NE;
+  spec.rate = mixer_.sample_rate();
+  spec.channels = audio::Mixer::channels;
+
+  // Ask the server to keep no more queued than one of our buffers and to
+  // take data a period at a time.
+  const auto period = mixer_.config().period_frames * audio::Mixer::frame_size;
+  pa_buffer_attr attr;
+  attr.maxlength = static_cast<std::uint32_t>(-1);
+  attr.tlength = static_cast<std::uint32_t>(mixer_.config().buffer_frames * audio::Mixer::frame_size);
+  attr.prebuf = static_cast<std::uint32_t>(-1);
+  attr.minreq = static_cast<std::uint32_t>(period);
+  attr.fragsize = static_cast<std::uint32_t>(-1);
+
+  int error = 0;
+  stream_ = pa_simple_new(nullptr, "Anbox", PA_STREAM_PLAYBACK, nullptr, "Android",
+                          &spec, nullptr, &attr, &error);
+  if (!stream_) {
+    WARNING("Failed to connect to the PulseAudio server: %s", pa_strerror(error));
+    return false;
+  }
+  return true;
+}
+
+void PulseAudioOutput::disconnect() {
+  if (!stream_)
+    return;
+
+  int error = 0;
+  pa_simple_drain(stream_, &error);
+  pa_simple_free(stream_);
+  stream_ = nullptr;
+}
+
+void PulseAudioOutput::run() {
+  const auto frames = mixer_.config().period_frames;
+  const auto period = std::chrono::microseconds{frames * 1000000 / mixer_.sample_rate()};
+  std::vector<float> data(frames * audio::Mixer::channels);
+
+  auto next_connect = std::chrono::steady_clock::now();
+  while (mixer_.wait_for_streams()) {
+    if (!stream_ && std::chrono::steady_clock::now() >= next_connect && !connect())
+      next_connect = std::chrono::steady_clock::now() + reconnect_delay;
+
+    if (!stream_) {
+      // Keep the guest going, it just isn't heard.
+      std::this_thread::sleep_for(period);
+      mixer_.mix(data.data(), frames);
+      continue;
+    }
+
+    if (mixer_.mix(data.data(), frames) == 0) {
+      // Nobody plays anything anymore, let the sound server suspend.
+      disconnect();
+      continue;
+    }
+
+    int error = 0;
+    if (pa_simple_write(stream_, data.data(), data.size() * sizeof(float), &error) < 0) {
+      WARNING("Failed to write to the PulseAudio server: %s", pa_strerror(error));
+      pa_simple_free(stream_);
+      stream_ = nullptr;
+    }
+  }
+
+  disconnect();
+}
+}  // namespace ubuntu
+}  // namespace anbox
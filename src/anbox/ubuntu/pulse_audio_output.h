@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_UBUNTU_PULSE_AUDIO_OUTPUT_H_
+#define ANBOX_UBUNTU_PULSE_AUDIO_OUTPUT_H_
+
+#include "anbox/audio/client_info.h"
+#include "anbox/audio/mixer.h"
+
+#include <memory>
+#include <thread>
+
+struct pa_simple;
+
+namespace anbox {
+namespace audio {
+class Sink;
+}  // namespace audio
+namespace ubuntu {
+// Plays all guest streams mixed together through a single stream of the
+// PulseAudio server, or of PipeWire through its PulseAudio interface.
+//
+// Unlike the SDL sink this doesn't open a device per guest connection
+// and doesn't add SDL's own mixing thread and buffering: a thread of ours
+// mixes a period and hands it to the sound server, which paces us. The
+// stream is only kept open while the guest plays something.
+class PulseAudioOutput {
+ public:
+  explicit PulseAudioOutput(const audio::PlaybackBuffer::Config &config);
+  ~PulseAudioOutput();
+
+  std::shared_ptr<audio::Sink> create_sink(const audio::ClientInfo &info);
+
+ private:
+  void run();
+  bool connect();
+  void disconnect();
+
+  audio::Mixer mixer_;
+  pa_simple *stream_;
+  std::thread thread_;
+};
+}  // namespace ubuntu
+}  // namespace anbox
+
+#endif
@@ -88,6 +88,8 @@ Window::Window(const std::shared_ptr<Renderer> &renderer,
       BOOST_THROW_EXCEPTION(std::runtime_error("SDL subsystem not suported"));
   }
 
+  // SDL tells us once the window gets the focus.
+  set_focused(false);
   SDL_ShowWindow(window_);
 }
 
@@ -98,9 +100,11 @@ Window::~Window() {
 void Window::process_event(const SDL_Event &event) {
   switch (event.window.event) {
     case SDL_WINDOWEVENT_FOCUS_GAINED:
+      set_focused(true);
       if (observer_) observer_->window_wants_focus(id_);
       break;
     case SDL_WINDOWEVENT_FOCUS_LOST:
+      set_focused(false);
       break;
     // Not need to listen for SDL_WINDOWEVENT_RESIZED here as the
     // SDL_WINDOWEVENT_SIZE_CHANGED is always sent.
@@ -112,9 +116,16 @@ void Window::process_event(const SDL_Event &event) {
       if (observer_)
         observer_->window_moved(id_, event.window.data1, event.window.data2);
       break;
+    // SDL doesn't tell whether a window is covered by others, only when
+    // it can't be seen at all.
     case SDL_WINDOWEVENT_SHOWN:
+    case SDL_WINDOWEVENT_RESTORED:
+    case SDL_WINDOWEVENT_MAXIMIZED:
+      set_visible(true);
       break;
     case SDL_WINDOWEVENT_HIDDEN:
+    case SDL_WINDOWEVENT_MINIMIZED:
+      set_visible(false);
       break;
     case SDL_WINDOWEVENT_CLOSE:
       if (observer_) observer_->window_deleted(id_);
@@ -184,7 +184,7 @@ bool is_mounted(const std::string &path) {
   bool is_mounted = false;
   if ((mtab = setmntent("/etc/mtab", "r")) != nullptr) {
     while ((part = getmntent(mtab)) != nullptr) {
-      if ((part->mnt_fsname != nullptr) && (strcmp(part->mnt_fsname, path.c_str())) == 0)
+      if ((part->mnt_dir != nullptr) && (strcmp(part->mnt_dir, path.c_str())) == 0)
         is_mounted = true;
     }
     endmntent(mtab);
@@ -17,9 +17,41 @@
 
 #include "anbox/wm/display.h"
 
+#include <algorithm>
+
 namespace anbox {
 namespace wm {
 Display::Id Display::Invalid = -1;
 Display::Id Display::Default = 0;
+
+Display::Display(const Id &id, const graphics::Rect &frame, int refresh_rate, int dpi)
+    : id_(id), frame_(frame), refresh_rate_(refresh_rate), dpi_(dpi) {}
+
+Display::Id Display::id() const { return id_; }
+
+graphics::Rect Display::frame() const { return frame_; }
+
+int Display::refresh_rate() const { return refresh_rate_; }
+
+int Display::dpi() const { return dpi_; }
+
+const Display *Display::find(const List &displays, const graphics::Rect &frame) {
+  const Display *best = nullptr;
+  std::int64_t best_area = 0;
+  for (const auto &display : displays) {
+    const auto &d = display.frame();
+    const auto width = std::min(d.right(), frame.right()) - std::max(d.left(), frame.left());
+    const auto height = std::min(d.bottom(), frame.bottom()) - std::max(d.top(), frame.top());
+    if (width <= 0 || height <= 0)
+      continue;
+
+    const auto area = static_cast<std::int64_t>(width) * height;
+    if (area > best_area) {
+      best = &display;
+      best_area = area;
+    }
+  }
+  return best;
+}
 }  // namespace wm
 }  // namespace anbox
@@ -18,19 +18,40 @@
 #ifndef ANBOX_WM_DISPLAY_H_
 #define ANBOX_WM_DISPLAY_H_
 
+#include "anbox/graphics/rect.h"
+
 #include <cstdint>
+#include <vector>
 
 namespace anbox {
 namespace wm {
+// A display of the host. Its frame is given in the coordinate space
+// spanning all host displays which windows are placed in as well.
 class Display {
  public:
   typedef std::int32_t Id;
+  typedef std::vector<Display> List;
 
   static Id Invalid;
   static Id Default;
 
-  Display() = delete;
-  Display(const Display&) = delete;
+  // |refresh_rate| in Hz and |dpi| are zero when they aren't known.
+  Display(const Id &id, const graphics::Rect &frame, int refresh_rate, int dpi);
+
+  Id id() const;
+  graphics::Rect frame() const;
+  int refresh_rate() const;
+  int dpi() const;
+
+  // Returns the display which shows the largest part of |frame| or
+  // nullptr if none of |displays| shows anything of it.
+  static const Display *find(const List &displays, const graphics::Rect &frame);
+
+ private:
+  Id id_;
+  graphics::Rect frame_;
+  int refresh_rate_;
+  int dpi_;
 };
 }  // namespace wm
 }  // namespace anbox
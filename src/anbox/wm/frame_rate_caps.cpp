@@ -0,0 +1,28 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "anbox/wm/frame_rate_caps.h"
+
+namespace anbox {
+namespace wm {
+std::chrono::microseconds FrameRateCaps::interval(bool has_focus) const {
+  const auto fps = has_focus ? focused : unfocused;
+  if (fps == 0)
+    return std::chrono::microseconds{0};
+  return std::chrono::microseconds{1000000 / fps};
+}
+}  // namespace wm
+}  // namespace anbox
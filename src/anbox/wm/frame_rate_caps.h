@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef ANBOX_WM_FRAME_RATE_CAPS_H_
+#define ANBOX_WM_FRAME_RATE_CAPS_H_
+
+#include <chrono>
+
+namespace anbox {
+namespace wm {
+// How often the windows of an application may be composed per second,
+// zero for as often as the display allows. Hidden windows aren't
+// composed at all.
+struct FrameRateCaps {
+  unsigned int focused = 0;
+  unsigned int unfocused = 0;
+
+  // Shortest time between two frames, zero if there is no cap.
+  std::chrono::microseconds interval(bool has_focus) const;
+
+  bool operator==(const FrameRateCaps &other) const {
+    return focused == other.focused && unfocused == other.unfocused;
+  }
+};
+}  // namespace wm
+}  // namespace anbox
+
+#endif
@@ -21,6 +21,8 @@
 #include "anbox/wm/window.h"
 #include "anbox/wm/window_state.h"
 
+#include <atomic>
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -42,6 +44,16 @@ class Manager {
 
   // FIXME only applies for the multi-window case
   virtual std::shared_ptr<Window> find_window_for_task(const Task::Id &task) = 0;
+
+  // Changes whenever windows are added or removed. Results of
+  // find_window_for_task() can be cached for as long as it stays the same.
+  std::uint64_t generation() const { return generation_.load(); }
+
+ protected:
+  void windows_changed() { generation_++; }
+
+ private:
+  std::atomic<std::uint64_t> generation_{0};
 };
 }  // namespace wm
 }  // namespace anbox
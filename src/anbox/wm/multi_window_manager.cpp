@@ -23,12 +23,24 @@
 
 #include <algorithm>
 
+namespace {
+// Starting an activity takes a few seconds at most, anything beyond means
+// Android isn't going to show it.
+constexpr const std::chrono::seconds prepared_window_timeout{10};
+}
+
 namespace anbox {
 namespace wm {
 MultiWindowManager::MultiWindowManager(const std::shared_ptr<platform::Policy> &policy,
                                        const std::shared_ptr<bridge::AndroidApiStub> &android_api_stub,
                                        const std::shared_ptr<application::Database> &app_db)
-    : platform_policy_(policy), android_api_stub_(android_api_stub), app_db_(app_db) {}
+    : platform_policy_(policy),
+      android_api_stub_(android_api_stub),
+      app_db_(app_db),
+      task_windows_(std::make_shared<TaskWindows>()),
+      resizer_([this](const Task::Id &task, const graphics::Rect &frame, std::int32_t resize_mode) {
+        android_api_stub_->resize_task(task, frame, resize_mode);
+      }) {}
 
 MultiWindowManager::~MultiWindowManager() {}
 
@@ -41,7 +53,8 @@ void MultiWindowManager::apply_window_state_update(const WindowState::List &upda
   // layer updates from SurfaceFlinger will be mapped later into those windows
   // and eventually composited there via GLES (e.g. for popups, ..)
 
-  std::map<Task::Id, WindowState::List> task_updates;
+  for (auto &u : task_updates_)
+    u.second.clear();
 
   for (const auto &window : updated) {
     // Ignore all windows which are not part of the freeform task stack
@@ -54,27 +67,33 @@ void MultiWindowManager::apply_window_state_update(const WindowState::List &upda
     // for it so we can apply all of them together.
     auto w = windows_.find(window.task());
     if (w != windows_.end()) {
-      auto t = task_updates.find(window.task());
-      if (t == task_updates.end())
-        task_updates.insert({window.task(), {window}});
-      else
-        task_updates[window.task()].push_back(window);
+      task_updates_[window.task()].push_back(window);
       continue;
     }
 
-    auto title = window.package_name();
-    auto app = app_db_->find_by_package(window.package_name());
-    if (app.valid())
-      title = app.name;
-
-    auto platform_window = platform_policy_->create_window(window.task(), window.frame(), title);
-    platform_window->attach();
+    auto platform_window = take_prepared_window(window);
+    if (!platform_window) {
+      auto title = window.package_name();
+      auto app = app_db_->find_by_package(window.package_name());
+      if (app.valid())
+        title = app.name;
+
+      platform_window = platform_policy_->create_window(window.task(), window.frame(), title);
+      if (!platform_window) continue;
+      platform_window->set_package(window.package_name());
+      platform_window->set_frame_rate_caps(app_db_->frame_rate_caps_for(window.package_name()));
+      platform_window->attach();
+    }
     windows_.insert({window.task(), platform_window});
+    publish_windows();
+    windows_changed();
   }
 
   // Send updates we collected per task down to the corresponding window
   // so that they can update themself.
-  for (const auto &u : task_updates) {
+  for (const auto &u : task_updates_) {
+    if (u.second.empty()) continue;
+
     auto w = windows_.find(u.first);
     if (w == windows_.end()) continue;
 
@@ -89,33 +108,137 @@ void MultiWindowManager::apply_window_state_update(const WindowState::List &upda
     auto w = windows_.find(window.task());
     if (w == windows_.end()) continue;
 
-    if (task_updates.find(window.task()) == task_updates.end()) {
+    auto t = task_updates_.find(window.task());
+    if (t == task_updates_.end() || t->second.empty()) {
       auto platform_window = w->second;
       platform_window->release();
+      resizer_.forget(window.task());
       windows_.erase(w);
+      publish_windows();
+      windows_changed();
     }
   }
+
+  expire_prepared_windows();
+
+  // Forget the lists of tasks which are gone for good.
+  for (auto u = task_updates_.begin(); u != task_updates_.end();) {
+    if (windows_.find(u->first) == windows_.end())
+      u = task_updates_.erase(u);
+    else
+      ++u;
+  }
 }
 
-std::shared_ptr<Window> MultiWindowManager::find_window_for_task(const Task::Id &task) {
+void MultiWindowManager::prepare_launch(const std::string &package, const graphics::Rect &frame) {
+  // Android places the window where we asked it to, without bounds we
+  // can't know where it ends up.
+  if (package.empty() || frame == graphics::Rect::Invalid)
+    return;
+
   std::lock_guard<std::mutex> l(mutex_);
-  for (const auto &w : windows_) {
-    if (w.second->task() == task) return w.second;
+  expire_prepared_windows();
+  if (prepared_windows_.find(package) != prepared_windows_.end())
+    return;
+
+  auto title = package;
+  auto app = app_db_->find_by_package(package);
+  if (app.valid())
+    title = app.name;
+
+  auto window = platform_policy_->create_window(Task::Invalid, frame, title);
+  if (!window)
+    return;
+  window->set_package(package);
+  window->set_frame_rate_caps(app_db_->frame_rate_caps_for(package));
+
+  // Setting up the native window and its surface is what takes most of
+  // the time, getting it done while Android starts the activity saves
+  // that once the task shows up.
+  window->attach();
+  window->draw_placeholder();
+
+  prepared_windows_[package] = PreparedWindow{window, std::chrono::steady_clock::now() + prepared_window_timeout};
+}
+
+void MultiWindowManager::cancel_launch(const std::string &package) {
+  std::lock_guard<std::mutex> l(mutex_);
+  auto p = prepared_windows_.find(package);
+  if (p == prepared_windows_.end())
+    return;
+  p->second.window->release();
+  prepared_windows_.erase(p);
+}
+
+std::shared_ptr<Window> MultiWindowManager::take_prepared_window(const WindowState &state) {
+  auto p = prepared_windows_.find(state.package_name());
+  if (p == prepared_windows_.end())
+    return nullptr;
+
+  auto window = p->second.window;
+  prepared_windows_.erase(p);
+
+  // Android didn't use the bounds we gave it, so the window has to be
+  // created from scratch.
+  if (window->frame() != state.frame()) {
+    window->release();
+    return nullptr;
+  }
+
+  window->set_task(state.task());
+  return window;
+}
+
+void MultiWindowManager::expire_prepared_windows() {
+  const auto now = std::chrono::steady_clock::now();
+  for (auto p = prepared_windows_.begin(); p != prepared_windows_.end();) {
+    if (p->second.expires <= now) {
+      p->second.window->release();
+      p = prepared_windows_.erase(p);
+    } else {
+      ++p;
+    }
   }
-  return nullptr;
+}
+
+void MultiWindowManager::publish_windows() {
+  auto task_windows = std::make_shared<TaskWindows>(windows_.begin(), windows_.end());
+  std::atomic_store(&task_windows_, std::shared_ptr<const TaskWindows>(task_windows));
+}
+
+std::shared_ptr<Window> MultiWindowManager::find_window_for_task(const Task::Id &task) {
+  const auto task_windows = std::atomic_load(&task_windows_);
+  auto w = task_windows->find(task);
+  if (w == task_windows->end()) return nullptr;
+  return w->second;
 }
 
 void MultiWindowManager::resize_task(const Task::Id &task, const anbox::graphics::Rect &rect,
                                       const std::int32_t &resize_mode) {
-  android_api_stub_->resize_task(task, rect, resize_mode);
+  resizer_.resize(task, rect, resize_mode);
 }
 
+// Both are called from the event loop of the platform which must not wait
+// for Android to answer.
 void MultiWindowManager::set_focused_task(const Task::Id &task) {
-  android_api_stub_->set_focused_task(task);
+  if (task == Task::Invalid)
+    return;
+
+  android_api_stub_->set_focused_task_async(task, [task](const std::string &error) {
+    if (!error.empty())
+      WARNING("Failed to focus task %d: %s", task, error);
+  });
 }
 
 void MultiWindowManager::remove_task(const Task::Id &task) {
-  android_api_stub_->remove_task(task);
+  // Prepared windows don't have a task until Android reported it.
+  if (task == Task::Invalid)
+    return;
+
+  android_api_stub_->remove_task_async(task, [task](const std::string &error) {
+    if (!error.empty())
+      WARNING("Failed to remove task %d: %s", task, error);
+  });
 }
 }  // namespace wm
 }  // namespace anbox
@@ -19,10 +19,14 @@
 #define ANBOX_WM_MULTI_WINDOW_MANAGER_H_
 
 #include "anbox/wm/manager.h"
+#include "anbox/wm/task_resizer.h"
 
+#include <chrono>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <unordered_map>
 
 namespace anbox {
 namespace application {
@@ -51,12 +55,45 @@ class MultiWindowManager : public Manager {
   void set_focused_task(const Task::Id &task) override;
   void remove_task(const Task::Id &task) override;
 
+  // Creates the window for an application which is about to be launched
+  // in |frame| so that it is ready once Android reports the task. The
+  // window is dropped again when the launch failed or Android didn't
+  // report a matching task in time.
+  void prepare_launch(const std::string &package, const graphics::Rect &frame);
+  void cancel_launch(const std::string &package);
+
  private:
+  struct PreparedWindow {
+    std::shared_ptr<Window> window;
+    std::chrono::steady_clock::time_point expires;
+  };
+
+  // Hands out the window prepared for the package of |state| if it
+  // matches. Must be called with |mutex_| held.
+  std::shared_ptr<Window> take_prepared_window(const WindowState &state);
+  void expire_prepared_windows();
+
+  typedef std::unordered_map<Task::Id, std::shared_ptr<Window>> TaskWindows;
+
+  // Replaces the snapshot find_window_for_task() works on by one of the
+  // current |windows_|. Must be called with |mutex_| held.
+  void publish_windows();
+
   std::mutex mutex_;
   std::shared_ptr<platform::Policy> platform_policy_;
   std::shared_ptr<bridge::AndroidApiStub> android_api_stub_;
   std::shared_ptr<application::Database> app_db_;
   std::map<Task::Id, std::shared_ptr<Window>> windows_;
+  // Read by the compositor for every layer without taking |mutex_|. Only
+  // ever replaced as a whole, with std::atomic_load/store, whenever windows
+  // come or go.
+  std::shared_ptr<const TaskWindows> task_windows_;
+  // Kept around between updates so that the lists per task keep their
+  // storage while windows are only moved.
+  std::map<Task::Id, WindowState::List> task_updates_;
+  std::map<std::string, PreparedWindow> prepared_windows_;
+  // Goes first so that nothing is sent anymore when the rest goes.
+  TaskResizer resizer_;
 };
 }  // namespace wm
 }  // namespace anbox
@@ -37,6 +37,7 @@ void SingleWindowManager::setup() {
   window_ = platform_policy_->create_window(0, window_size_, "Anbox - Android in a Box");
   if (!window_->attach())
     WARNING("Failed to attach window to renderer");
+  windows_changed();
 }
 
 void SingleWindowManager::apply_window_state_update(const WindowState::List &updated, const WindowState::List &removed) {
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/wm/task_resizer.h"
+#include "anbox/logger.h"
+
+#include <algorithm>
+
+namespace anbox {
+namespace wm {
+constexpr std::chrono::milliseconds TaskResizer::default_interval;
+constexpr std::chrono::milliseconds TaskResizer::default_settle;
+
+TaskResizer::TaskResizer(const Sender &sender, const std::chrono::milliseconds &interval,
+                         const std::chrono::milliseconds &settle)
+    : sender_(sender), interval_(interval), settle_(settle), requests_(0), running_(true),
+      worker_(&TaskResizer::send_requests, this) {}
+
+TaskResizer::~TaskResizer() {
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    running_ = false;
+    changed_.notify_all();
+  }
+  worker_.join();
+}
+
+void TaskResizer::resize(const Task::Id &task, const graphics::Rect &frame,
+                         std::int32_t resize_mode) {
+  std::lock_guard<std::mutex> l(lock_);
+  pending_[task] = Request{frame, resize_mode, std::chrono::steady_clock::now()};
+  requests_++;
+  changed_.notify_all();
+}
+
+void TaskResizer::forget(const Task::Id &task) {
+  std::lock_guard<std::mutex> l(lock_);
+  pending_.erase(task);
+  sent_.erase(task);
+}
+
+void TaskResizer::send_requests() {
+  std::unique_lock<std::mutex> l(lock_);
+  auto next = std::chrono::steady_clock::now();
+  while (running_) {
+    changed_.wait(l, [&]() { return !running_ || !pending_.empty(); });
+    if (changed_.wait_until(l, next, [&]() { return !running_; }))
+      break;
+
+    const auto now = std::chrono::steady_clock::now();
+    auto settled = std::chrono::steady_clock::time_point::max();
+    std::map<Task::Id, Request> requests;
+    for (auto request = pending_.begin(); request != pending_.end();) {
+      const auto sent = sent_.find(request->first);
+      const auto &frame = request->second.frame;
+      const auto resized = sent != sent_.end() &&
+          (sent->second.width() != frame.width() || sent->second.height() != frame.height());
+      if (resized && now < request->second.made + settle_) {
+        settled = std::min(settled, request->second.made + settle_);
+        ++request;
+        continue;
+      }
+      sent_[request->first] = frame;
+      requests.insert(*request);
+      request = pending_.erase(request);
+    }
+
+    if (requests.empty()) {
+      // Whatever comes in meanwhile may be a move to send right away.
+      const auto seen = requests_;
+      changed_.wait_until(l, settled, [&]() { return !running_ || requests_ != seen; });
+      continue;
+    }
+
+    next = now + interval_;
+    l.unlock();
+
+    for (const auto &request : requests) {
+      try {
+        sender_(request.first, request.second.frame, request.second.resize_mode);
+      } catch (const std::exception &err) {
+        WARNING("Failed to resize task %d: %s", request.first, err.what());
+      }
+    }
+
+    l.lock();
+  }
+}
+}  // namespace wm
+}  // namespace anbox
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_WM_TASK_RESIZER_H_
+#define ANBOX_WM_TASK_RESIZER_H_
+
+#include "anbox/graphics/rect.h"
+#include "anbox/wm/task.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace anbox {
+namespace wm {
+// Coalesces the resize requests for tasks we get for every single event
+// while the user drags or resizes a window.
+//
+// Only the latest frame of each task is kept and all of them are sent at
+// most once per |interval|, from a thread of its own so that nobody waits
+// for Android. A request coming in after a quiet period goes out right
+// away and the last one of a drag at most one interval after it was made.
+class TaskResizer {
+ public:
+  typedef std::function<void(const Task::Id &task, const graphics::Rect &frame,
+                             std::int32_t resize_mode)> Sender;
+
+  // One frame of the host display.
+  static constexpr std::chrono::milliseconds default_interval{16};
+  static constexpr std::chrono::milliseconds default_settle{100};
+
+  explicit TaskResizer(const Sender &sender,
+                       const std::chrono::milliseconds &interval = default_interval,
+                       const std::chrono::milliseconds &settle = default_settle);
+  ~TaskResizer();
+
+  void resize(const Task::Id &task, const graphics::Rect &frame, std::int32_t resize_mode);
+  // Drops what we know about |task| once it is gone.
+  void forget(const Task::Id &task);
+
+ private:
+  struct Request {
+    graphics::Rect frame;
+    std::int32_t resize_mode;
+    std::chrono::steady_clock::time_point made;
+  };
+
+  void send_requests();
+
+  Sender sender_;
+  const std::chrono::milliseconds interval_;
+  const std::chrono::milliseconds settle_;
+  std::mutex lock_;
+  std::condition_variable changed_;
+  std::map<Task::Id, Request> pending_;
+  // The frame last sent for each task.
+  std::map<Task::Id, graphics::Rect> sent_;
+  // Counts the requests made so far so the worker can tell when a new one
+  // came in while it waits for others to settle.
+  std::uint64_t requests_;
+  bool running_;
+  std::thread worker_;
+};
+}  // namespace wm
+}  // namespace anbox
+
+#endif
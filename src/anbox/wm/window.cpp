@@ -40,19 +40,46 @@ void Window::update_frame(const graphics::Rect &frame) {
 
 Task::Id Window::task() const { return task_; }
 
+void Window::set_task(const Task::Id &task) { task_ = task; }
+
 graphics::Rect Window::frame() const { return frame_; }
 
 EGLNativeWindowType Window::native_handle() const { return 0; }
 
 std::string Window::title() const { return title_; }
 
+void Window::set_package(const std::string &package) { package_ = package; }
+
+std::string Window::package() const { return package_; }
+
+void Window::set_visible(bool visible) { visible_ = visible; }
+
+bool Window::visible() const { return visible_; }
+
+void Window::set_focused(bool focused) { focused_ = focused; }
+
+bool Window::focused() const { return focused_; }
+
+void Window::set_frame_rate_caps(const FrameRateCaps &caps) { frame_rate_caps_ = caps; }
+
+std::chrono::microseconds Window::frame_interval() const {
+  return frame_rate_caps_.interval(focused_);
+}
+
 bool Window::attach() {
   if (!renderer_)
     return false;
-  attached_ = renderer_->createNativeWindow(native_handle());
+  attached_ = renderer_->createNativeWindow(native_handle(), package_);
   return attached_;
 }
 
+bool Window::draw_placeholder() {
+  if (!renderer_ || !attached_)
+    return false;
+  // Without anything to draw the renderer just clears the window.
+  return renderer_->draw(native_handle(), graphics::Rect{0, 0, frame_.width(), frame_.height()}, {});
+}
+
 void Window::release() {
   if (!renderer_ || !attached_)
     return;
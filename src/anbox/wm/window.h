@@ -18,6 +18,7 @@
 #ifndef ANBOX_WM_WINDOW_H_
 #define ANBOX_WM_WINDOW_H_
 
+#include "anbox/wm/frame_rate_caps.h"
 #include "anbox/wm/window_state.h"
 
 #include <string>
@@ -25,6 +26,7 @@
 
 #include <EGL/egl.h>
 
+#include <atomic>
 #include <memory>
 
 class Renderer;
@@ -48,22 +50,48 @@ class Window {
   Window(const std::shared_ptr<Renderer> &renderer, const Task::Id &task, const graphics::Rect &frame, const std::string &title);
   virtual ~Window();
 
-  bool attach();
+  virtual bool attach();
   void release();
 
   void update_state(const WindowState::List &states);
   void update_frame(const graphics::Rect &frame);
 
+  // Fills the window until the first frame of its content is composed.
+  bool draw_placeholder();
+
   virtual EGLNativeWindowType native_handle() const;
   graphics::Rect frame() const;
   Task::Id task() const;
+  // Windows created ahead of a launch get their task only once Android
+  // reported it.
+  void set_task(const Task::Id &task);
   std::string title() const;
+  // The Android package the window shows, empty if it shows more than one.
+  // Has to be set before the window is attached.
+  void set_package(const std::string &package);
+  std::string package() const;
+  // Hidden windows are not composed, whatever is submitted for them while
+  // they are hidden is composed once they are shown again.
+  void set_visible(bool visible);
+  bool visible() const;
+  // Windows count as focused unless the platform tells otherwise.
+  void set_focused(bool focused);
+  bool focused() const;
+  // Has to be set before the window is attached.
+  void set_frame_rate_caps(const FrameRateCaps &caps);
+  // Shortest time between two frames of the window as it is now, zero if
+  // there is no cap.
+  std::chrono::microseconds frame_interval() const;
 
  private:
   std::shared_ptr<Renderer> renderer_;
-  Task::Id task_;
+  std::atomic<Task::Id> task_;
   graphics::Rect frame_;
   std::string title_;
+  std::string package_;
+  std::atomic<bool> visible_{true};
+  std::atomic<bool> focused_{true};
+  FrameRateCaps frame_rate_caps_;
   bool attached_ = false;
 };
 }  // namespace wm
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/wm/window_preparing_manager.h"
+#include "anbox/wm/multi_window_manager.h"
+
+namespace anbox {
+namespace wm {
+WindowPreparingManager::WindowPreparingManager(const std::shared_ptr<application::Manager> &other,
+                                               const std::shared_ptr<MultiWindowManager> &window_manager) :
+  other_(other),
+  window_manager_(window_manager) {}
+
+WindowPreparingManager::~WindowPreparingManager() {}
+
+std::string WindowPreparingManager::package_of(const android::Intent &intent) {
+  if (!intent.package.empty())
+    return intent.package;
+  // Components are given as <package>/<activity>.
+  return intent.component.substr(0, intent.component.find('/'));
+}
+
+void WindowPreparingManager::launch(const android::Intent &intent,
+                                    const graphics::Rect &launch_bounds,
+                                    const wm::Stack::Id &stack) {
+  const auto package = package_of(intent);
+  window_manager_->prepare_launch(package, launch_bounds);
+  try {
+    other_->launch(intent, launch_bounds, stack);
+  } catch (...) {
+    window_manager_->cancel_launch(package);
+    throw;
+  }
+}
+
+void WindowPreparingManager::launch_async(const android::Intent &intent,
+                                          const graphics::Rect &launch_bounds,
+                                          const wm::Stack::Id &stack,
+                                          const Completion &done) {
+  const auto package = package_of(intent);
+  window_manager_->prepare_launch(package, launch_bounds);
+
+  auto window_manager = window_manager_;
+  other_->launch_async(intent, launch_bounds, stack, [window_manager, package, done](const std::string &error) {
+    if (!error.empty())
+      window_manager->cancel_launch(package);
+    done(error);
+  });
+}
+
+core::Property<bool>& WindowPreparingManager::ready() { return other_->ready(); }
+}  // namespace wm
+}  // namespace anbox
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_WM_WINDOW_PREPARING_MANAGER_H_
+#define ANBOX_WM_WINDOW_PREPARING_MANAGER_H_
+
+#include "anbox/application/manager.h"
+
+#include <memory>
+
+namespace anbox {
+namespace wm {
+class MultiWindowManager;
+// Has the window manager create the window of an application while the
+// launch request is still on its way through Android.
+class WindowPreparingManager : public application::Manager {
+ public:
+  WindowPreparingManager(const std::shared_ptr<application::Manager> &other,
+                         const std::shared_ptr<MultiWindowManager> &window_manager);
+  ~WindowPreparingManager();
+
+  void launch(const android::Intent &intent,
+              const graphics::Rect &launch_bounds = graphics::Rect::Invalid,
+              const wm::Stack::Id &stack = wm::Stack::Id::Default) override;
+  void launch_async(const android::Intent &intent,
+                    const graphics::Rect &launch_bounds,
+                    const wm::Stack::Id &stack,
+                    const Completion &done) override;
+
+  core::Property<bool>& ready() override;
+
+  // The package the activity started by |intent| belongs to.
+  static std::string package_of(const android::Intent &intent);
+
+ private:
+  std::shared_ptr<application::Manager> other_;
+  std::shared_ptr<MultiWindowManager> window_manager_;
+};
+}  // namespace wm
+}  // namespace anbox
+
+#endif
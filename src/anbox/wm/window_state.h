@@ -41,10 +41,13 @@ class WindowState {
   Display::Id display() const { return display_; }
   bool has_surface() const { return has_surface_; }
   graphics::Rect frame() const { return frame_; }
-  std::string package_name() const { return package_name_; }
+  const std::string &package_name() const { return package_name_; }
   Task::Id task() const { return task_; }
   Stack::Id stack() const { return stack_; }
 
+  // Windows mostly only move, which this applies in place.
+  void set_frame(const graphics::Rect &frame) { frame_ = frame; }
+
  private:
   Display::Id display_;
   bool has_surface_;
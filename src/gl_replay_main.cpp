@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "anbox/cmds/gl_replay.h"
+#include "anbox/logger.h"
+#include "anbox/utils.h"
+
+#include <iostream>
+
+int main(int argc, char **argv) try {
+  anbox::Log().Init(anbox::Logger::Severity::kWarning);
+
+  const auto log_level = anbox::utils::get_env_value("ANBOX_LOG_LEVEL", "");
+  if (!log_level.empty() && !anbox::Log().SetSeverityFromString(log_level))
+    WARNING("Failed to set logging severity to '%s'", log_level);
+
+  anbox::cmds::GlReplay cmd;
+  return cmd.run({std::cin, std::cout, anbox::utils::collect_arguments(argc, argv)});
+} catch (std::exception &err) {
+  ERROR("%s", err.what());
+  return EXIT_FAILURE;
+}
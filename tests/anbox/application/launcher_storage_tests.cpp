@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/application/database.h"
+#include "anbox/application/icon_cache.h"
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <sstream>
+
+namespace fs = boost::filesystem;
+
+namespace {
+anbox::application::Database::Item make_item(const std::string &package, const std::string &name) {
+  anbox::application::Database::Item item;
+  item.package = package;
+  item.name = name;
+  item.launch_intent.package = package;
+  item.icon = {'P', 'N', 'G'};
+  return item;
+}
+
+std::string read_file(const fs::path &path) {
+  std::ifstream in(path.string());
+  std::stringstream s;
+  s << in.rdbuf();
+  return s.str();
+}
+
+class LauncherStorageTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    path_ = fs::temp_directory_path() / fs::unique_path("anbox-launcher-%%%%-%%%%");
+    icon_path_ = fs::temp_directory_path() / fs::unique_path("anbox-icons-%%%%-%%%%");
+  }
+
+  void TearDown() override {
+    fs::remove_all(path_);
+    fs::remove_all(icon_path_);
+  }
+
+  fs::path desktop_item(const std::string &name) const {
+    return path_ / ("anbox-" + name + ".desktop");
+  }
+
+  fs::path path_;
+  fs::path icon_path_;
+};
+}  // namespace
+
+namespace anbox {
+namespace application {
+TEST_F(LauncherStorageTest, WritesEntries) {
+  Database db(path_, icon_path_);
+  db.store_or_update(make_item("org.anbox.foo", "Foo"));
+  db.flush();
+
+  EXPECT_NE(std::string::npos, read_file(desktop_item("org-anbox-foo")).find("Name=Foo\n"));
+  EXPECT_EQ("PNG", read_file(path_ / "anbox-org-anbox-foo.png"));
+  EXPECT_EQ("Foo", db.find_by_package("org.anbox.foo").name);
+}
+
+TEST_F(LauncherStorageTest, SkipsUnchangedEntries) {
+  {
+    Database db(path_, icon_path_);
+    db.store_or_update(make_item("org.anbox.foo", "Foo"));
+    db.store_or_update(make_item("org.anbox.bar", "Bar"));
+  }
+
+  // Anything we find unchanged in the file shows it wasn't written again.
+  { std::ofstream(desktop_item("org-anbox-foo").string()) << "marker"; }
+
+  Database db(path_, icon_path_);
+  db.store_or_update(make_item("org.anbox.foo", "Foo"));
+  db.store_or_update(make_item("org.anbox.bar", "Bar 2"));
+  db.flush();
+
+  EXPECT_EQ("marker", read_file(desktop_item("org-anbox-foo")));
+  EXPECT_NE(std::string::npos, read_file(desktop_item("org-anbox-bar")).find("Name=Bar 2\n"));
+}
+
+TEST_F(LauncherStorageTest, RetriesEntriesAfterErrors) {
+  // Creating the directory throws while its parent is a regular file.
+  const auto launcher_path = path_ / "launcher";
+  { std::ofstream(path_.string()) << "blocker"; }
+
+  Database db(launcher_path, icon_path_);
+  db.store_or_update(make_item("org.anbox.foo", "Foo"));
+  db.flush();
+
+  fs::remove(path_);
+  db.store_or_update(make_item("org.anbox.foo", "Foo"));
+  db.flush();
+
+  EXPECT_NE(std::string::npos,
+            read_file(launcher_path / "anbox-org-anbox-foo.desktop").find("Name=Foo\n"));
+}
+
+TEST_F(LauncherStorageTest, RewritesMissingEntries) {
+  {
+    Database db(path_, icon_path_);
+    db.store_or_update(make_item("org.anbox.foo", "Foo"));
+  }
+
+  fs::remove(desktop_item("org-anbox-foo"));
+
+  Database db(path_, icon_path_);
+  db.store_or_update(make_item("org.anbox.foo", "Foo"));
+  db.flush();
+
+  EXPECT_TRUE(fs::exists(desktop_item("org-anbox-foo")));
+}
+
+TEST_F(LauncherStorageTest, RemovesStaleEntries) {
+  {
+    Database db(path_, icon_path_);
+    db.store_or_update(make_item("org.anbox.foo", "Foo"));
+    db.store_or_update(make_item("org.anbox.bar", "Bar"));
+  }
+
+  Database db(path_, icon_path_);
+  db.store_or_update(make_item("org.anbox.foo", "Foo"));
+  db.remove_stale();
+  db.flush();
+
+  EXPECT_TRUE(fs::exists(desktop_item("org-anbox-foo")));
+  EXPECT_FALSE(fs::exists(desktop_item("org-anbox-bar")));
+  EXPECT_FALSE(fs::exists(path_ / "anbox-org-anbox-bar.png"));
+}
+TEST_F(LauncherStorageTest, UsesCachedIcons) {
+  auto item = make_item("org.anbox.foo", "Foo");
+  item.icon.clear();
+  item.icon_hash = "0123456789abcdef";
+
+  {
+    Database db(path_, icon_path_);
+    EXPECT_FALSE(db.has_icon(item.icon_hash));
+    db.store_icon(item.icon_hash, {'I', 'C', 'O', 'N'});
+    db.store_or_update(item);
+  }
+
+  Database db(path_, icon_path_);
+  EXPECT_TRUE(db.has_icon(item.icon_hash));
+  db.flush();
+  EXPECT_EQ("ICON", read_file(path_ / "anbox-org-anbox-foo.png"));
+}
+
+TEST_F(LauncherStorageTest, ReadsFrameRateCaps) {
+  Database db(path_, icon_path_);
+
+  std::istringstream caps("# package focused unfocused\n"
+                          "* 60 10\n"
+                          "org.anbox.foo 30 0\n"
+                          "org.anbox.bar fast\n");
+  db.read_frame_rate_caps(caps);
+
+  EXPECT_EQ(30u, db.frame_rate_caps_for("org.anbox.foo").focused);
+  EXPECT_EQ(0u, db.frame_rate_caps_for("org.anbox.foo").unfocused);
+  EXPECT_EQ(60u, db.frame_rate_caps_for("org.anbox.bar").focused);
+  EXPECT_EQ(10u, db.frame_rate_caps_for("org.anbox.bar").unfocused);
+  EXPECT_EQ(std::chrono::microseconds{100000},
+            db.frame_rate_caps_for("org.anbox.baz").interval(false));
+}
+
+TEST(IconCache, AcceptsOnlyHexHashes) {
+  EXPECT_TRUE(IconCache::valid_hash("0123456789abcdef"));
+  EXPECT_FALSE(IconCache::valid_hash(""));
+  EXPECT_FALSE(IconCache::valid_hash("../../etc/passwd"));
+  EXPECT_FALSE(IconCache::valid_hash(std::string(65, 'a')));
+}
+}  // namespace application
+}  // namespace anbox
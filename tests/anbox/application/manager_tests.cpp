@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <gtest/gtest.h>
+
+#include "anbox/application/manager.h"
+
+#include <stdexcept>
+
+namespace {
+class FakeManager : public anbox::application::Manager {
+ public:
+  void launch(const anbox::android::Intent &intent,
+              const anbox::graphics::Rect &launch_bounds,
+              const anbox::wm::Stack::Id &stack) override {
+    (void) intent;
+    (void) launch_bounds;
+    if (fail)
+      throw std::runtime_error("Failed to launch");
+    launched_stack = stack;
+  }
+
+  core::Property<bool>& ready() override { return ready_; }
+
+  bool fail = false;
+  anbox::wm::Stack::Id launched_stack = anbox::wm::Stack::Id::Invalid;
+
+ private:
+  core::Property<bool> ready_;
+};
+}  // namespace
+
+namespace anbox {
+namespace application {
+TEST(Manager, LaunchAsyncReportsOutcome) {
+  FakeManager manager;
+
+  std::string error = "not called";
+  manager.launch_async(android::Intent{}, graphics::Rect::Invalid, wm::Stack::Id::Freeform,
+                       [&](const std::string &e) { error = e; });
+  EXPECT_TRUE(error.empty());
+  EXPECT_EQ(wm::Stack::Id::Freeform, manager.launched_stack);
+
+  manager.fail = true;
+  manager.launch_async(android::Intent{}, graphics::Rect::Invalid, wm::Stack::Id::Default,
+                       [&](const std::string &e) { error = e; });
+  EXPECT_EQ("Failed to launch", error);
+}
+
+TEST(RestrictedManager, LaunchAsyncUsesStaticStack) {
+  auto other = std::make_shared<FakeManager>();
+  RestrictedManager manager(other, wm::Stack::Id::Fullscreen);
+
+  std::string error = "not called";
+  manager.launch_async(android::Intent{}, graphics::Rect::Invalid, wm::Stack::Id::Freeform,
+                       [&](const std::string &e) { error = e; });
+  EXPECT_TRUE(error.empty());
+  EXPECT_EQ(wm::Stack::Id::Fullscreen, other->launched_stack);
+}
+}  // namespace application
+}  // namespace anbox
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "anbox/audio/capture_buffer.h"
+
+#include <thread>
+#include <vector>
+
+namespace anbox {
+namespace audio {
+TEST(CaptureBuffer, ReadsWholeFrames) {
+  CaptureBuffer buffer({160, 1000}, 2);
+  EXPECT_EQ(1024u, buffer.config().buffer_frames);
+
+  const std::vector<std::uint8_t> data{1, 2, 3, 4, 5, 6};
+  ASSERT_TRUE(buffer.write(data.data(), data.size()));
+  EXPECT_EQ(3u, buffer.buffered_frames());
+
+  std::vector<std::uint8_t> out(5);
+  ASSERT_EQ(4u, buffer.read(out.data(), out.size()));
+  EXPECT_EQ(1, out[0]);
+  EXPECT_EQ(4, out[3]);
+  EXPECT_EQ(1u, buffer.buffered_frames());
+}
+
+TEST(CaptureBuffer, DropsWhatDoesNotFit) {
+  CaptureBuffer buffer({4, 4}, 4);
+
+  const std::vector<std::uint8_t> data(3 * 4, 1);
+  ASSERT_TRUE(buffer.write(data.data(), data.size()));
+  // Doesn't wait for the reader.
+  EXPECT_FALSE(buffer.write(data.data(), data.size()));
+  EXPECT_EQ(1u, buffer.statistics().overruns);
+  EXPECT_EQ(3u, buffer.buffered_frames());
+
+  std::vector<std::uint8_t> out(data.size());
+  EXPECT_EQ(out.size(), buffer.read(out.data(), out.size()));
+  EXPECT_TRUE(buffer.write(data.data(), data.size()));
+}
+
+TEST(CaptureBuffer, ReaderWaitsForData) {
+  CaptureBuffer buffer({4, 16}, 4);
+
+  std::vector<std::uint8_t> out(16);
+  std::thread reader([&]() { EXPECT_EQ(8u, buffer.read(out.data(), out.size())); });
+
+  const std::vector<std::uint8_t> data(8, 7);
+  buffer.write(data.data(), data.size());
+  reader.join();
+  EXPECT_EQ(7, out[7]);
+}
+
+TEST(CaptureBuffer, CloseFailsWaitingReader) {
+  CaptureBuffer buffer({4, 16}, 4);
+
+  std::thread reader([&]() {
+    std::vector<std::uint8_t> out(16);
+    EXPECT_EQ(0u, buffer.read(out.data(), out.size()));
+  });
+  buffer.close();
+  reader.join();
+
+  const std::vector<std::uint8_t> data(4, 1);
+  EXPECT_FALSE(buffer.write(data.data(), data.size()));
+  EXPECT_EQ(0u, buffer.statistics().overruns);
+}
+}  // namespace audio
+}  // namespace anbox
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "anbox/audio/mixer.h"
+#include "anbox/audio/sink.h"
+
+#include <cstring>
+#include <vector>
+
+namespace {
+const anbox::audio::PlaybackBuffer::Config config{4, 16};
+
+anbox::audio::ClientInfo format(const anbox::audio::ClientInfo::Format &format, std::uint8_t channels) {
+  return anbox::audio::ClientInfo{anbox::audio::ClientInfo::Type::Playback, format, channels, 0,
+                                  anbox::audio::Mixer::default_sample_rate};
+}
+
+template <typename T>
+void write(const std::shared_ptr<anbox::audio::Sink> &sink, const std::vector<T> &samples) {
+  sink->write_data(reinterpret_cast<const std::uint8_t *>(samples.data()), samples.size() * sizeof(T));
+}
+}  // namespace
+
+namespace anbox {
+namespace audio {
+TEST(Mixer, SumsAllStreams) {
+  Mixer mixer(Mixer::default_sample_rate, config);
+
+  auto first = mixer.create_stream(format(ClientInfo::Format::Float, 2));
+  auto second = mixer.create_stream(format(ClientInfo::Format::Float, 2));
+  write(first, std::vector<float>{0.25f, -0.25f, 0.5f, -0.5f});
+  write(second, std::vector<float>{0.25f, 0.25f});
+
+  std::vector<float> out(4);
+  EXPECT_EQ(2u, mixer.mix(out.data(), 2));
+  // The second stream ran out of data after one frame.
+  const std::vector<float> expected{0.5f, 0.0f, 0.5f, -0.5f};
+  EXPECT_EQ(expected, out);
+}
+
+TEST(Mixer, ConvertsToFloatStereo) {
+  Mixer mixer(Mixer::default_sample_rate, config);
+
+  auto sink = mixer.create_stream(format(ClientInfo::Format::S16, 1));
+  write(sink, std::vector<std::int16_t>{16384, -32768});
+  EXPECT_EQ(4u * 2, sink->period_size());
+
+  std::vector<float> out(4);
+  mixer.mix(out.data(), 2);
+  const std::vector<float> expected{0.5f, 0.5f, -1.0f, -1.0f};
+  EXPECT_EQ(expected, out);
+}
+
+TEST(Mixer, ClampsToFullScale) {
+  Mixer mixer(Mixer::default_sample_rate, config);
+
+  auto first = mixer.create_stream(format(ClientInfo::Format::Float, 2));
+  auto second = mixer.create_stream(format(ClientInfo::Format::Float, 2));
+  write(first, std::vector<float>{0.75f, -0.75f});
+  write(second, std::vector<float>{0.75f, -0.75f});
+
+  std::vector<float> out(2);
+  mixer.mix(out.data(), 1);
+  const std::vector<float> expected{1.0f, -1.0f};
+  EXPECT_EQ(expected, out);
+}
+
+TEST(Mixer, ResamplesStreams) {
+  Mixer mixer(Mixer::default_sample_rate, config);
+
+  auto info = format(ClientInfo::Format::Float, 2);
+  info.sample_rate = Mixer::default_sample_rate / 2;
+  auto sink = mixer.create_stream(info);
+  write(sink, std::vector<float>{0.5f, 0.5f});
+
+  // Interpolated from the silence the stream starts with.
+  std::vector<float> out(4);
+  mixer.mix(out.data(), 2);
+  const std::vector<float> expected{0.0f, 0.0f, 0.25f, 0.25f};
+  EXPECT_EQ(expected, out);
+}
+
+TEST(Mixer, ForgetsStreamsOnceGone) {
+  Mixer mixer(Mixer::default_sample_rate, config);
+
+  auto sink = mixer.create_stream(format(ClientInfo::Format::S16, 2));
+  EXPECT_TRUE(mixer.wait_for_streams());
+  sink.reset();
+
+  std::vector<float> out(2, 1.0f);
+  EXPECT_EQ(0u, mixer.mix(out.data(), 1));
+  EXPECT_EQ(0.0f, out[0]);
+
+  mixer.close();
+  EXPECT_FALSE(mixer.wait_for_streams());
+}
+}  // namespace audio
+}  // namespace anbox
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/audio/playback_buffer.h"
+
+#include <thread>
+#include <vector>
+
+namespace anbox {
+namespace audio {
+TEST(PlaybackBuffer, FillsMissingDataWithSilence) {
+  PlaybackBuffer buffer({256, 1024});
+
+  const std::vector<std::uint8_t> data(8, 0xaa);
+  ASSERT_TRUE(buffer.write(data.data(), data.size()));
+  EXPECT_EQ(2u, buffer.buffered_frames());
+
+  std::vector<std::uint8_t> out(16, 0xff);
+  buffer.read(out.data(), out.size());
+  for (size_t n = 0; n < out.size(); n++)
+    EXPECT_EQ(n < data.size() ? 0xaa : 0x00, out[n]);
+  EXPECT_EQ(0u, buffer.buffered_frames());
+}
+
+TEST(PlaybackBuffer, CountsUnderrunsOnlyWhilePlaying) {
+  PlaybackBuffer buffer({256, 1024});
+  std::vector<std::uint8_t> out(16);
+
+  // Nothing played yet.
+  buffer.read(out.data(), out.size());
+  EXPECT_EQ(0u, buffer.statistics().underruns);
+
+  const std::vector<std::uint8_t> data(16, 1);
+  buffer.write(data.data(), data.size());
+  buffer.read(out.data(), out.size());
+  EXPECT_EQ(0u, buffer.statistics().underruns);
+
+  // The stream ran dry.
+  buffer.read(out.data(), out.size());
+  EXPECT_EQ(1u, buffer.statistics().underruns);
+  // The guest stopped playing.
+  buffer.read(out.data(), out.size());
+  EXPECT_EQ(1u, buffer.statistics().underruns);
+}
+
+TEST(PlaybackBuffer, WriterWaitsForRoom) {
+  PlaybackBuffer buffer({4, 4});
+  ASSERT_EQ(4u, buffer.config().buffer_frames);
+
+  const std::vector<std::uint8_t> data(8 * PlaybackBuffer::default_frame_size, 1);
+  std::thread writer([&]() { EXPECT_TRUE(buffer.write(data.data(), data.size())); });
+
+  std::vector<std::uint8_t> out(data.size());
+  size_t played = 0;
+  while (played < data.size()) {
+    const auto size = buffer.buffered_frames() * PlaybackBuffer::default_frame_size;
+    buffer.read(out.data() + played, size);
+    played += size;
+    std::this_thread::yield();
+  }
+  writer.join();
+
+  EXPECT_EQ(data, out);
+}
+
+TEST(PlaybackBuffer, CountsOverruns) {
+  PlaybackBuffer buffer({4, 4});
+
+  const std::vector<std::uint8_t> data(4 * PlaybackBuffer::default_frame_size, 1);
+  ASSERT_TRUE(buffer.write(data.data(), data.size()));
+  EXPECT_EQ(0u, buffer.statistics().overruns);
+
+  // Doesn't wait for room in a closed buffer.
+  buffer.close();
+  EXPECT_FALSE(buffer.write(data.data(), data.size()));
+  EXPECT_EQ(1u, buffer.statistics().overruns);
+}
+
+TEST(PlaybackBuffer, RoundsBufferUpAndReportsLatency) {
+  PlaybackBuffer buffer({441, 3000});
+  EXPECT_EQ(4096u, buffer.config().buffer_frames);
+  // 4096 + 441 frames at 44.1 kHz.
+  EXPECT_EQ(std::chrono::microseconds{102879}, buffer.latency());
+}
+
+TEST(PlaybackBuffer, UsesStreamFormat) {
+  // Mono S16 at 48 kHz.
+  PlaybackBuffer buffer({480, 2000}, 48000, 2);
+  EXPECT_EQ(2048u, buffer.config().buffer_frames);
+  EXPECT_EQ(std::chrono::microseconds{52666}, buffer.latency());
+
+  const std::vector<std::uint8_t> data(6, 1);
+  buffer.write(data.data(), data.size());
+  EXPECT_EQ(3u, buffer.buffered_frames());
+}
+
+TEST(PlaybackBuffer, CloseFailsWaitingWriter) {
+  PlaybackBuffer buffer({4, 4});
+  const std::vector<std::uint8_t> data(8 * PlaybackBuffer::default_frame_size, 1);
+
+  std::thread writer([&]() { EXPECT_FALSE(buffer.write(data.data(), data.size())); });
+  while (buffer.buffered_frames() < 4)
+    std::this_thread::yield();
+  buffer.close();
+  writer.join();
+}
+}  // namespace audio
+}  // namespace anbox
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "anbox/audio/resampler.h"
+
+#include <cstring>
+#include <vector>
+
+namespace {
+template <typename T>
+std::vector<T> samples_of(const std::vector<std::uint8_t> &data) {
+  std::vector<T> samples(data.size() / sizeof(T));
+  std::memcpy(samples.data(), data.data(), data.size());
+  return samples;
+}
+
+template <typename T>
+const std::uint8_t *bytes_of(const std::vector<T> &samples) {
+  return reinterpret_cast<const std::uint8_t *>(samples.data());
+}
+}  // namespace
+
+namespace anbox {
+namespace audio {
+TEST(Resampler, InterpolatesBetweenFrames) {
+  Resampler resampler(ClientInfo::Format::Float, 1, 24000, 48000);
+
+  const std::vector<float> in{0.5f, 1.0f};
+  const auto out = samples_of<float>(resampler.process(bytes_of(in), in.size() * sizeof(float)));
+
+  // Starts from silence and stops at the last frame which the next call
+  // continues from.
+  const std::vector<float> expected{0.0f, 0.25f, 0.5f, 0.75f};
+  EXPECT_EQ(expected, out);
+
+  const std::vector<float> more{1.0f};
+  const std::vector<float> expected_more{1.0f, 1.0f};
+  EXPECT_EQ(expected_more, samples_of<float>(resampler.process(bytes_of(more), sizeof(float))));
+}
+
+TEST(Resampler, KeepsChannelsApart) {
+  Resampler resampler(ClientInfo::Format::S16, 2, 22050, 44100);
+
+  const std::vector<std::int16_t> in{100, -100, 200, -200};
+  const auto out = samples_of<std::int16_t>(resampler.process(bytes_of(in), in.size() * sizeof(std::int16_t)));
+
+  const std::vector<std::int16_t> expected{0, 0, 50, -50, 100, -100, 150, -150};
+  EXPECT_EQ(expected, out);
+}
+
+TEST(Resampler, ProducesFramesAtOutputRate) {
+  Resampler resampler(ClientInfo::Format::S16, 2, 44100, 48000);
+
+  // One second in odd pieces.
+  const std::vector<std::int16_t> in(2 * 441, 1000);
+  std::size_t frames = 0;
+  for (int n = 0; n < 100; n++)
+    frames += resampler.process(bytes_of(in), in.size() * sizeof(std::int16_t)).size() / 4;
+
+  // Less the one frame we still hold back.
+  EXPECT_LE(47999u, frames);
+  EXPECT_GE(48000u, frames);
+}
+
+TEST(Resampler, KeepsFullScaleSamples) {
+  Resampler resampler(ClientInfo::Format::S16, 1, 48000, 44100);
+
+  const std::vector<std::int16_t> in(480, 32767);
+  resampler.process(bytes_of(in), in.size() * sizeof(std::int16_t));
+  for (const auto sample : samples_of<std::int16_t>(resampler.process(bytes_of(in), in.size() * sizeof(std::int16_t))))
+    EXPECT_EQ(32767, sample);
+
+  const std::vector<std::int16_t> low(480, -32768);
+  resampler.process(bytes_of(low), low.size() * sizeof(std::int16_t));
+  for (const auto sample : samples_of<std::int16_t>(resampler.process(bytes_of(low), low.size() * sizeof(std::int16_t))))
+    EXPECT_EQ(-32768, sample);
+}
+}  // namespace audio
+}  // namespace anbox
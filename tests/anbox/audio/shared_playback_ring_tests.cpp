@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "anbox/audio/shared_playback_ring.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <cstring>
+#include <vector>
+
+namespace {
+// Maps the ring the way the guest does to play the client.
+class Client {
+ public:
+  explicit Client(const anbox::Fd &fd) {
+    struct stat st;
+    fstat(fd, &st);
+    size_ = st.st_size;
+    ring_ = static_cast<anbox::audio::SharedRing *>(
+        ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+  }
+  ~Client() { ::munmap(ring_, size_); }
+
+  void write(const std::vector<std::uint8_t> &data) {
+    auto pos = ring_->write_pos.load();
+    for (const auto &byte : data)
+      ring_->data()[pos++ & (ring_->size - 1)] = byte;
+    ring_->write_pos.store(pos);
+  }
+
+  anbox::audio::SharedRing *ring() { return ring_; }
+
+ private:
+  std::size_t size_;
+  anbox::audio::SharedRing *ring_;
+};
+}  // namespace
+
+namespace anbox {
+namespace audio {
+TEST(SharedPlaybackRing, RoundsSizeUpToPowerOfTwo) {
+  SharedPlaybackRing ring(1000);
+  EXPECT_EQ(1024u, ring.size());
+
+  Client client(ring.fd());
+  ASSERT_NE(MAP_FAILED, static_cast<void *>(client.ring()));
+  EXPECT_EQ(1024u, client.ring()->size);
+  EXPECT_EQ(0u, ring.available());
+}
+
+TEST(SharedPlaybackRing, ConsumesWhatClientWrote) {
+  SharedPlaybackRing ring(16);
+  Client client(ring.fd());
+
+  client.write({1, 2, 3, 4});
+  EXPECT_EQ(4u, ring.available());
+
+  std::vector<std::uint8_t> out;
+  EXPECT_EQ(4u, ring.consume([&](const std::uint8_t *data, std::size_t size) {
+    out.insert(out.end(), data, data + size);
+  }));
+  EXPECT_EQ((std::vector<std::uint8_t>{1, 2, 3, 4}), out);
+  EXPECT_EQ(0u, ring.available());
+  EXPECT_EQ(4u, client.ring()->read_pos.load());
+}
+
+TEST(SharedPlaybackRing, ConsumesAcrossWrapAround) {
+  SharedPlaybackRing ring(16);
+  Client client(ring.fd());
+
+  client.write(std::vector<std::uint8_t>(12, 0));
+  ring.consume([](const std::uint8_t *, std::size_t) {});
+
+  client.write({1, 2, 3, 4, 5, 6, 7, 8});
+  std::vector<std::uint8_t> out;
+  std::size_t pieces = 0;
+  EXPECT_EQ(8u, ring.consume([&](const std::uint8_t *data, std::size_t size) {
+    out.insert(out.end(), data, data + size);
+    pieces++;
+  }));
+  EXPECT_EQ(2u, pieces);
+  EXPECT_EQ((std::vector<std::uint8_t>{1, 2, 3, 4, 5, 6, 7, 8}), out);
+}
+
+TEST(SharedPlaybackRing, ClampsBogusWritePosition) {
+  SharedPlaybackRing ring(16);
+  Client client(ring.fd());
+
+  client.ring()->write_pos.store(1000);
+  EXPECT_EQ(16u, ring.available());
+
+  std::size_t consumed = 0;
+  ring.consume([&](const std::uint8_t *, std::size_t size) { consumed += size; });
+  EXPECT_EQ(16u, consumed);
+}
+
+TEST(SharedPlaybackRing, ReportsWaitingWriter) {
+  SharedPlaybackRing ring(16);
+  Client client(ring.fd());
+
+  EXPECT_FALSE(ring.writer_waiting());
+  client.ring()->writer_waiting.store(1);
+  EXPECT_TRUE(ring.writer_waiting());
+}
+}  // namespace audio
+}  // namespace anbox
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/bridge/guest_frame_statistics.h"
+
+#include "anbox_bridge.pb.h"
+
+#include <sstream>
+
+using namespace anbox::bridge;
+
+namespace {
+std::string gfxinfo_for(int pid, const std::string &package, std::uint64_t frames,
+                        std::uint64_t janky, std::uint32_t p90_ms) {
+  std::ostringstream out;
+  out << "Applications Graphics Acceleration Info:\n"
+      << "Uptime: 1000 Realtime: 1000\n\n"
+      << "** Graphics info for pid " << pid << " [" << package << "] **\n\n"
+      << "Stats since: 123456ns\n"
+      << "Total frames rendered: " << frames << "\n"
+      << "Janky frames: " << janky << " (12.50%)\n"
+      << "50th percentile: 8ms\n"
+      << "90th percentile: " << p90_ms << "ms\n"
+      << "95th percentile: 24ms\n"
+      << "99th percentile: 48ms\n"
+      << "Number Missed Vsync: 1\n"
+      << "Number High input latency: 0\n"
+      << "Number Slow UI thread: " << janky << "\n"
+      << "Number Slow bitmap uploads: 0\n"
+      << "Number Slow issue draw commands: 2\n\n"
+      << "Caches:\n"
+      << "Current memory usage / total memory usage (bytes):\n";
+  return out.str();
+}
+}  // namespace
+
+TEST(GuestFrameStatistics, ParsesGfxinfo) {
+  GuestFrameStatistics statistics;
+  ASSERT_TRUE(statistics.update(gfxinfo_for(42, "com.example.app", 80, 10, 16)));
+
+  const auto &totals = statistics.totals();
+  EXPECT_EQ(80u, totals.frames);
+  EXPECT_EQ(10u, totals.janky_frames);
+  EXPECT_EQ(1u, totals.missed_vsync);
+  EXPECT_EQ(10u, totals.slow_ui_thread);
+  EXPECT_EQ(2u, totals.slow_draw_commands);
+
+  const auto &times = statistics.frame_times();
+  EXPECT_EQ("com.example.app", times.package);
+  EXPECT_EQ(8u, times.p50_ms);
+  EXPECT_EQ(16u, times.p90_ms);
+  EXPECT_EQ(48u, times.p99_ms);
+}
+
+TEST(GuestFrameStatistics, IgnoresOutputWithoutProcesses) {
+  GuestFrameStatistics statistics;
+  EXPECT_FALSE(statistics.update("Applications Graphics Acceleration Info:\n"));
+  EXPECT_EQ(0u, statistics.totals().frames);
+}
+
+TEST(GuestFrameStatistics, KeepsFramesOfProcessesWhichAreGone) {
+  GuestFrameStatistics statistics;
+  ASSERT_TRUE(statistics.update(gfxinfo_for(42, "com.example.app", 80, 10, 16)));
+  ASSERT_TRUE(statistics.update(gfxinfo_for(42, "com.example.app", 100, 12, 16)));
+  EXPECT_EQ(100u, statistics.totals().frames);
+  EXPECT_EQ(12u, statistics.totals().janky_frames);
+
+  // Another app got the pid, its frames count from zero.
+  ASSERT_TRUE(statistics.update(gfxinfo_for(42, "com.example.other", 30, 1, 33)));
+  EXPECT_EQ(130u, statistics.totals().frames);
+  EXPECT_EQ(13u, statistics.totals().janky_frames);
+  EXPECT_EQ("com.example.other", statistics.frame_times().package);
+  EXPECT_EQ(33u, statistics.frame_times().p90_ms);
+}
+
+TEST(GuestFrameStatistics, ReportsFrameTimesOfBusiestApp) {
+  GuestFrameStatistics statistics;
+  ASSERT_TRUE(statistics.update(gfxinfo_for(1, "com.example.busy", 500, 0, 16) +
+                                gfxinfo_for(2, "com.example.idle", 20, 0, 40)));
+  EXPECT_EQ("com.example.busy", statistics.frame_times().package);
+
+  ASSERT_TRUE(statistics.update(gfxinfo_for(1, "com.example.busy", 500, 0, 16) +
+                                gfxinfo_for(2, "com.example.idle", 60, 0, 40)));
+  EXPECT_EQ("com.example.idle", statistics.frame_times().package);
+  EXPECT_EQ(560u, statistics.totals().frames);
+}
+
+TEST(GuestFrameStatistics, SurvivesTheWayToTheHost) {
+  GuestFrameStatistics guest;
+  ASSERT_TRUE(guest.update(gfxinfo_for(42, "com.example.app", 80, 10, 16)));
+
+  anbox::protobuf::bridge::EventSequence seq;
+  guest.write(*seq.mutable_guest_frame_statistics());
+
+  anbox::protobuf::bridge::EventSequence received;
+  ASSERT_TRUE(received.ParseFromString(seq.SerializeAsString()));
+  ASSERT_TRUE(received.has_guest_frame_statistics());
+
+  GuestFrameStatistics host;
+  host.read(received.guest_frame_statistics());
+  EXPECT_EQ(80u, host.totals().frames);
+  EXPECT_EQ(10u, host.totals().janky_frames);
+  EXPECT_EQ("com.example.app", host.frame_times().package);
+  EXPECT_EQ(16u, host.frame_times().p90_ms);
+}
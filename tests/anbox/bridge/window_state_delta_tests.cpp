@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/bridge/window_state_decoder.h"
+#include "anbox/bridge/window_state_encoder.h"
+#include "anbox/bridge/window_state_frame.h"
+
+#include "anbox_bridge.pb.h"
+
+#include <vector>
+
+namespace {
+typedef anbox::protobuf::bridge::WindowStateUpdateEvent Event;
+
+void add_window(Event &event, const std::string &package, std::int32_t task,
+                std::int32_t left, std::int32_t top) {
+  auto window = event.add_windows();
+  window->set_display_id(0);
+  window->set_has_surface(true);
+  window->set_package_name(package);
+  window->set_frame_left(left);
+  window->set_frame_top(top);
+  window->set_frame_right(left + 100);
+  window->set_frame_bottom(top + 100);
+  window->set_task_id(task);
+  window->set_stack_id(2);
+}
+
+std::size_t count_valid(const anbox::wm::WindowState::List &windows) {
+  std::size_t count = 0;
+  for (const auto &window : windows) {
+    if (window.display() != anbox::wm::Display::Invalid)
+      count++;
+  }
+  return count;
+}
+
+std::vector<std::uint8_t> write_frame(const Event &delta) {
+  std::vector<std::uint8_t> data(anbox::bridge::WindowStateFrame::size(delta));
+  anbox::bridge::WindowStateFrame::write(delta, data.data());
+  return data;
+}
+}  // namespace
+
+namespace anbox {
+namespace bridge {
+TEST(WindowStateDelta, SendsOnlyWhatMoved) {
+  WindowStateEncoder encoder;
+  WindowStateDecoder decoder;
+
+  Event full, delta;
+  add_window(full, "org.anbox.foo", 1, 0, 0);
+  add_window(full, "org.anbox.bar", 2, 50, 50);
+  ASSERT_TRUE(encoder.encode(full, delta));
+  EXPECT_TRUE(delta.reset());
+  EXPECT_EQ(2, delta.packages_size());
+  ASSERT_TRUE(decoder.apply(delta));
+  EXPECT_EQ(2u, count_valid(decoder.windows()));
+
+  full.mutable_windows(1)->set_frame_left(60);
+  full.mutable_windows(1)->set_frame_right(160);
+  ASSERT_TRUE(encoder.encode(full, delta));
+  EXPECT_FALSE(delta.reset());
+  EXPECT_EQ(0, delta.packages_size());
+  ASSERT_EQ(1, delta.changed_windows_size());
+  EXPECT_TRUE(delta.changed_windows(0).has_frame_left());
+  EXPECT_FALSE(delta.changed_windows(0).has_frame_top());
+  EXPECT_FALSE(delta.changed_windows(0).has_package());
+  ASSERT_TRUE(decoder.apply(delta));
+
+  const auto &bar = decoder.windows()[delta.changed_windows(0).id()];
+  EXPECT_EQ("org.anbox.bar", bar.package_name());
+  EXPECT_EQ(graphics::Rect(60, 50, 160, 150), bar.frame());
+  EXPECT_TRUE(decoder.removed().empty());
+
+  EXPECT_FALSE(encoder.encode(full, delta));
+}
+
+TEST(WindowStateDelta, RemovesWindowsWhichAreGone) {
+  WindowStateEncoder encoder;
+  WindowStateDecoder decoder;
+
+  Event full, delta;
+  add_window(full, "org.anbox.foo", 1, 0, 0);
+  add_window(full, "org.anbox.foo", 1, 10, 10);
+  ASSERT_TRUE(encoder.encode(full, delta));
+  ASSERT_TRUE(decoder.apply(delta));
+
+  full.mutable_windows()->RemoveLast();
+  add_window(full, "org.anbox.bar", 3, 0, 0);
+  ASSERT_TRUE(encoder.encode(full, delta));
+  EXPECT_EQ(1, delta.removed_window_ids_size());
+  EXPECT_EQ(1, delta.packages_size());
+  ASSERT_TRUE(decoder.apply(delta));
+
+  ASSERT_EQ(1u, decoder.removed().size());
+  EXPECT_EQ(graphics::Rect(10, 10, 110, 110), decoder.removed()[0].frame());
+  EXPECT_EQ(2u, count_valid(decoder.windows()));
+}
+
+TEST(WindowStateDelta, ResetForgetsEverything) {
+  WindowStateDecoder decoder;
+
+  WindowStateEncoder encoder;
+  Event full, delta;
+  add_window(full, "org.anbox.foo", 1, 0, 0);
+  ASSERT_TRUE(encoder.encode(full, delta));
+  ASSERT_TRUE(decoder.apply(delta));
+
+  // A new instance of Android starts from scratch.
+  WindowStateEncoder restarted;
+  Event empty;
+  ASSERT_TRUE(restarted.encode(empty, delta));
+  ASSERT_TRUE(decoder.apply(delta));
+  EXPECT_EQ(1u, decoder.removed().size());
+  EXPECT_EQ(0u, count_valid(decoder.windows()));
+}
+
+TEST(WindowStateDelta, RejectsUnknownWindows) {
+  WindowStateDecoder decoder;
+
+  Event delta;
+  delta.set_incremental(true);
+  delta.add_changed_windows()->set_id(3);
+  delta.mutable_changed_windows(0)->set_frame_left(10);
+  EXPECT_FALSE(decoder.apply(delta));
+
+  delta.Clear();
+  delta.set_incremental(true);
+  delta.add_removed_window_ids(0);
+  EXPECT_FALSE(decoder.apply(delta));
+}
+
+TEST(WindowStateDelta, RejectsIdsAndPackagesBeyondLimits) {
+  WindowStateDecoder decoder;
+
+  for (const std::uint32_t id : {0xffffffffu, static_cast<std::uint32_t>(WindowStateDecoder::max_windows)}) {
+    Event delta;
+    delta.set_incremental(true);
+    delta.add_packages("org.anbox.foo");
+    auto change = delta.add_changed_windows();
+    change->set_id(id);
+    change->set_display_id(0);
+    change->set_has_surface(true);
+    change->set_package(0);
+    change->set_frame_left(0);
+    change->set_frame_top(0);
+    change->set_frame_right(100);
+    change->set_frame_bottom(100);
+    change->set_task_id(1);
+    change->set_stack_id(2);
+    EXPECT_FALSE(decoder.apply(delta)) << id;
+
+    const auto data = write_frame(delta);
+    EXPECT_FALSE(decoder.apply(WindowStateFrame(data.data(), data.size()))) << id;
+    EXPECT_TRUE(decoder.windows().empty());
+  }
+
+  Event delta;
+  delta.set_incremental(true);
+  for (std::size_t n = 0; n <= WindowStateDecoder::max_packages; n++)
+    delta.add_packages("org.anbox.foo");
+  EXPECT_FALSE(decoder.apply(delta));
+  const auto data = write_frame(delta);
+  EXPECT_FALSE(decoder.apply(WindowStateFrame(data.data(), data.size())));
+}
+
+TEST(WindowStateDelta, AppliesFullUpdates) {
+  WindowStateDecoder decoder;
+
+  Event full;
+  add_window(full, "org.anbox.foo", 1, 0, 0);
+  *full.add_removed_windows() = full.windows(0);
+  ASSERT_TRUE(decoder.apply(full));
+  EXPECT_EQ(1u, decoder.windows().size());
+  EXPECT_EQ(1u, decoder.removed().size());
+}
+
+TEST(WindowStateDelta, FramesMatchEvents) {
+  WindowStateEncoder encoder;
+  WindowStateDecoder from_events, from_frames;
+
+  Event full, delta;
+  add_window(full, "org.anbox.foo", 1, 0, 0);
+  add_window(full, "org.anbox.barbaz", 2, 50, 50);
+  for (int n = 0; n < 3; n++) {
+    if (n == 1) {
+      full.mutable_windows(1)->set_frame_top(-20);
+    } else if (n == 2) {
+      full.mutable_windows()->RemoveLast();
+      add_window(full, "org.anbox.qux", 3, 5, 5);
+    }
+    ASSERT_TRUE(encoder.encode(full, delta));
+    ASSERT_TRUE(from_events.apply(delta));
+
+    const auto data = write_frame(delta);
+    ASSERT_TRUE(from_frames.apply(WindowStateFrame(data.data(), data.size())));
+
+    ASSERT_EQ(from_events.windows().size(), from_frames.windows().size());
+    for (std::size_t m = 0; m < from_events.windows().size(); m++) {
+      const auto &a = from_events.windows()[m];
+      const auto &b = from_frames.windows()[m];
+      EXPECT_EQ(a.package_name(), b.package_name());
+      EXPECT_EQ(a.frame(), b.frame());
+      EXPECT_EQ(a.task(), b.task());
+    }
+    EXPECT_EQ(from_events.removed().size(), from_frames.removed().size());
+  }
+}
+
+TEST(WindowStateDelta, RejectsTruncatedFrames) {
+  WindowStateEncoder encoder;
+
+  Event full, delta;
+  add_window(full, "org.anbox.foo", 1, 0, 0);
+  ASSERT_TRUE(encoder.encode(full, delta));
+  const auto data = write_frame(delta);
+  EXPECT_TRUE(WindowStateFrame(data.data(), data.size()).valid());
+
+  for (std::size_t size = 0; size < data.size(); size++) {
+    WindowStateDecoder decoder;
+    EXPECT_FALSE(WindowStateFrame(data.data(), size).valid());
+    EXPECT_FALSE(decoder.apply(WindowStateFrame(data.data(), size)));
+  }
+}
+}  // namespace bridge
+}  // namespace anbox
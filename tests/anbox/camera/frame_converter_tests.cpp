@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "anbox/camera/frame_converter.h"
+
+#include <vector>
+
+#include <linux/videodev2.h>
+
+namespace anbox {
+namespace camera {
+TEST(FrameConverter, FrameSizes) {
+  EXPECT_EQ(16u, frame_size(V4L2_PIX_FMT_YUYV, 4, 2));
+  EXPECT_EQ(12u, frame_size(V4L2_PIX_FMT_NV21, 4, 2));
+  EXPECT_EQ(12u, frame_size(V4L2_PIX_FMT_YVU420, 4, 2));
+  EXPECT_EQ(32u, frame_size(V4L2_PIX_FMT_RGB32, 4, 2));
+  EXPECT_EQ(0u, frame_size(V4L2_PIX_FMT_NV21, 3, 2));
+  EXPECT_EQ(0u, frame_size(V4L2_PIX_FMT_MJPEG, 4, 2));
+}
+
+TEST(FrameConverter, YuyvToNv21) {
+  const std::vector<std::uint8_t> yuyv = {
+      0, 10, 1, 20, 2, 11, 3, 21,
+      4, 12, 5, 22, 6, 13, 7, 23,
+  };
+  std::vector<std::uint8_t> nv21(frame_size(V4L2_PIX_FMT_NV21, 4, 2));
+  ASSERT_TRUE(convert_frame(V4L2_PIX_FMT_YUYV, yuyv.data(), V4L2_PIX_FMT_NV21, nv21.data(), 4, 2));
+
+  // The chroma of the second row is dropped.
+  const std::vector<std::uint8_t> expected = {0, 1, 2, 3, 4, 5, 6, 7, 20, 10, 21, 11};
+  EXPECT_EQ(expected, nv21);
+}
+
+TEST(FrameConverter, Yuv420ToYvu420SwapsChromaPlanes) {
+  const std::vector<std::uint8_t> yuv420 = {0, 1, 2, 3, 4, 5, 6, 7, 10, 11, 20, 21};
+  std::vector<std::uint8_t> yvu420(yuv420.size());
+  ASSERT_TRUE(convert_frame(V4L2_PIX_FMT_YUV420, yuv420.data(), V4L2_PIX_FMT_YVU420,
+                            yvu420.data(), 4, 2));
+
+  const std::vector<std::uint8_t> expected = {0, 1, 2, 3, 4, 5, 6, 7, 20, 21, 10, 11};
+  EXPECT_EQ(expected, yvu420);
+}
+
+TEST(FrameConverter, Rgb32OfVideoRange) {
+  // Left half white, right half black and no color at all.
+  const std::vector<std::uint8_t> yuyv = {
+      235, 128, 235, 128, 16, 128, 16, 128,
+      235, 128, 235, 128, 16, 128, 16, 128,
+  };
+  std::vector<std::uint8_t> rgb32(frame_size(V4L2_PIX_FMT_RGB32, 4, 2));
+  ASSERT_TRUE(convert_frame(V4L2_PIX_FMT_YUYV, yuyv.data(), V4L2_PIX_FMT_RGB32, rgb32.data(), 4, 2));
+
+  for (std::size_t pixel = 0; pixel < 8; pixel++) {
+    const std::uint8_t value = (pixel % 4 < 2) ? 255 : 0;
+    EXPECT_EQ(value, rgb32[pixel * 4]);
+    EXPECT_EQ(value, rgb32[pixel * 4 + 1]);
+    EXPECT_EQ(value, rgb32[pixel * 4 + 2]);
+    EXPECT_EQ(0xff, rgb32[pixel * 4 + 3]);
+  }
+}
+
+TEST(FrameConverter, RejectsUnsupportedFormats) {
+  std::vector<std::uint8_t> src(64), dst(64);
+  EXPECT_FALSE(convert_frame(V4L2_PIX_FMT_NV21, src.data(), V4L2_PIX_FMT_YUV420, dst.data(), 4, 2));
+  EXPECT_FALSE(convert_frame(V4L2_PIX_FMT_YUV420, src.data(), V4L2_PIX_FMT_YUYV, dst.data(), 4, 2));
+  EXPECT_FALSE(convert_frame(V4L2_PIX_FMT_YUV420, src.data(), V4L2_PIX_FMT_NV21, dst.data(), 3, 2));
+}
+
+TEST(FrameConverter, FillsBlack) {
+  std::vector<std::uint8_t> nv12(frame_size(V4L2_PIX_FMT_NV12, 4, 2));
+  ASSERT_TRUE(fill_black(V4L2_PIX_FMT_NV12, nv12.data(), 4, 2));
+
+  const std::vector<std::uint8_t> expected = {16, 16, 16, 16, 16, 16, 16, 16, 128, 128, 128, 128};
+  EXPECT_EQ(expected, nv12);
+}
+}  // namespace camera
+}  // namespace anbox
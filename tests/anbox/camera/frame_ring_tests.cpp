@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "anbox/camera/frame_ring.h"
+
+#include <cstring>
+
+#include <sys/mman.h>
+
+namespace anbox {
+namespace camera {
+TEST(FrameRing, NeverWritesTheLentFrame) {
+  FrameRing ring(16);
+
+  auto slot = ring.begin_write();
+  std::memset(slot, 1, ring.slot_size());
+  ring.end_write();
+
+  const auto lent = ring.lend_newest();
+  EXPECT_EQ(1, ring.slot(lent)[0]);
+
+  // Capturing goes on while Android reads.
+  for (int n = 2; n < 10; n++) {
+    slot = ring.begin_write();
+    EXPECT_NE(ring.slot(lent), slot);
+    std::memset(slot, n, ring.slot_size());
+    ring.end_write();
+  }
+  EXPECT_EQ(1, ring.slot(lent)[0]);
+
+  EXPECT_EQ(9, ring.slot(ring.lend_newest())[0]);
+}
+
+TEST(FrameRing, KeepsTheNewestFrameWhileWriting) {
+  FrameRing ring(16);
+
+  auto slot = ring.begin_write();
+  std::memset(slot, 1, ring.slot_size());
+  ring.end_write();
+
+  // Frames being written are never lent out.
+  slot = ring.begin_write();
+  EXPECT_EQ(1, ring.slot(ring.lend_newest())[0]);
+  std::memset(slot, 2, ring.slot_size());
+  ring.end_write();
+  EXPECT_EQ(2, ring.slot(ring.lend_newest())[0]);
+}
+
+TEST(FrameRing, SharesFramesThroughFd) {
+  FrameRing ring(16);
+
+  const auto size = FrameRing::slot_count * ring.slot_size();
+  auto addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, ring.fd(), 0);
+  ASSERT_NE(MAP_FAILED, addr);
+  const auto memory = static_cast<const std::uint8_t *>(addr);
+
+  auto slot = ring.begin_write();
+  std::memset(slot, 42, ring.slot_size());
+  ring.end_write();
+
+  const auto lent = ring.lend_newest();
+  EXPECT_EQ(42, memory[lent * ring.slot_size()]);
+  EXPECT_EQ(42, memory[lent * ring.slot_size() + ring.slot_size() - 1]);
+
+  ::munmap(addr, size);
+}
+}  // namespace camera
+}  // namespace anbox
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "anbox/camera/yuv_rows.h"
+
+#include <random>
+#include <vector>
+
+namespace {
+std::vector<std::uint8_t> random_bytes(std::size_t count) {
+  std::mt19937 generator(count);
+  std::uniform_int_distribution<int> distribution(0, 255);
+  std::vector<std::uint8_t> bytes(count);
+  for (auto &byte : bytes) byte = static_cast<std::uint8_t>(distribution(generator));
+  return bytes;
+}
+}  // namespace
+
+namespace anbox {
+namespace camera {
+TEST(YuvRows, VectorizedRowsMatchScalarConversion) {
+  // Wide enough for vectorized blocks and a scalar tail, with all sorts
+  // of values that get clamped.
+  const std::size_t width = 38;
+  const auto y = random_bytes(width);
+  const auto uv = random_bytes(width * 2);
+
+  for (const std::size_t uv_step : {1u, 2u}) {
+    std::vector<std::uint8_t> rgb(width * 4);
+    yuv_row_to_rgb32(y.data(), uv.data(), uv.data() + width, uv_step, rgb.data(), width);
+
+    std::vector<std::uint8_t> expected(width * 4);
+    for (std::size_t x = 0; x < width; x++) {
+      const auto chroma = (x / 2) * uv_step;
+      detail::yuv_to_rgb32(y[x], uv[chroma], uv[width + chroma], expected.data() + x * 4);
+    }
+    EXPECT_EQ(expected, rgb) << "uv_step " << uv_step;
+  }
+}
+
+TEST(YuvRows, InterleavesSamples) {
+  const std::size_t count = 37;
+  const auto first = random_bytes(count);
+  const auto second = random_bytes(count + 1);
+
+  std::vector<std::uint8_t> dst(count * 2);
+  interleave_row(first.data(), second.data(), dst.data(), count);
+
+  for (std::size_t n = 0; n < count; n++) {
+    EXPECT_EQ(first[n], dst[2 * n]);
+    EXPECT_EQ(second[n], dst[2 * n + 1]);
+  }
+}
+}  // namespace camera
+}  // namespace anbox
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/common/async_logger.h"
+
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+class RecordingLogger : public anbox::Logger {
+ public:
+  struct Record {
+    Severity severity;
+    std::string message;
+    std::thread::id thread;
+  };
+
+  void Init(const Severity &severity) override { severity_ = severity; }
+  void SetSeverity(const Severity &severity) override { severity_ = severity; }
+  bool IsEnabled(Severity severity) const override { return severity >= severity_; }
+
+  void Log(Severity severity, const std::string &message,
+           const boost::optional<Location> &) override {
+    std::lock_guard<std::mutex> l(lock_);
+    records_.push_back({severity, message, std::this_thread::get_id()});
+  }
+
+  std::vector<Record> records() {
+    std::lock_guard<std::mutex> l(lock_);
+    return records_;
+  }
+
+ private:
+  Severity severity_ = Severity::kDebug;
+  std::mutex lock_;
+  std::vector<Record> records_;
+};
+}  // namespace
+
+namespace anbox {
+namespace common {
+TEST(AsyncLogger, WritesOnItsOwnThread) {
+  auto sink = std::make_shared<RecordingLogger>();
+  AsyncLogger logger(sink);
+
+  logger.Debugf(boost::none, "%s %d", "foo", 42);
+  logger.Flush();
+
+  const auto records = sink->records();
+  ASSERT_EQ(1u, records.size());
+  EXPECT_EQ(Logger::Severity::kDebug, records[0].severity);
+  EXPECT_EQ("foo 42", records[0].message);
+}
+
+TEST(AsyncLogger, TakesOverSeverityOfSink) {
+  auto sink = std::make_shared<RecordingLogger>();
+  AsyncLogger logger(sink);
+
+  EXPECT_FALSE(logger.IsEnabled(Logger::Severity::kTrace));
+  EXPECT_TRUE(logger.IsEnabled(Logger::Severity::kDebug));
+
+  logger.SetSeverity(Logger::Severity::kError);
+  logger.Warning("dropped");
+  logger.Error("kept");
+  logger.Flush();
+
+  const auto records = sink->records();
+  ASSERT_EQ(1u, records.size());
+  EXPECT_EQ("kept", records[0].message);
+}
+
+TEST(AsyncLogger, KeepsOrderOfEachThread) {
+  auto sink = std::make_shared<RecordingLogger>();
+  const int threads = 4;
+  const int messages = 200;
+  {
+    AsyncLogger logger(sink, messages);
+    std::vector<std::thread> loggers;
+    for (int t = 0; t < threads; t++) {
+      loggers.push_back(std::thread([&logger, t]() {
+        for (int n = 0; n < messages; n++)
+          logger.Infof(boost::none, "%d %d", t, n);
+      }));
+    }
+    for (auto &thread : loggers)
+      thread.join();
+  }
+
+  // Everything fits into the buffers so nothing is dropped and the
+  // shutdown writes whatever was still left.
+  const auto records = sink->records();
+  ASSERT_EQ(static_cast<std::size_t>(threads * messages), records.size());
+
+  std::vector<int> next(threads, 0);
+  for (const auto &record : records) {
+    EXPECT_NE(std::this_thread::get_id(), record.thread);
+    int t = 0, n = 0;
+    ASSERT_EQ(2, std::sscanf(record.message.c_str(), "%d %d", &t, &n));
+    EXPECT_EQ(next[t]++, n);
+  }
+}
+
+TEST(AsyncLogger, DropsMessagesButNoErrorsWhenFull) {
+  auto sink = std::make_shared<RecordingLogger>();
+  AsyncLogger logger(sink, 1);
+
+  for (int n = 0; n < 1000; n++)
+    logger.Info("spam");
+  for (int n = 0; n < 10; n++)
+    logger.Error("important");
+  logger.Flush();
+
+  std::size_t errors = 0;
+  bool reported = false;
+  for (const auto &record : sink->records()) {
+    if (record.message == "important")
+      errors++;
+    else if (record.message.find("Dropped") == 0)
+      reported = true;
+  }
+  EXPECT_EQ(10u, errors);
+  if (logger.dropped() > 0) {
+    EXPECT_TRUE(reported);
+  }
+}
+
+TEST(AsyncLogger, ReleasesBuffersOfExitedThreads) {
+  auto sink = std::make_shared<RecordingLogger>();
+  AsyncLogger logger(sink);
+
+  const int threads = 50;
+  for (int t = 0; t < threads; t++) {
+    std::thread([&logger, t]() { logger.Infof(boost::none, "%d", t); }).join();
+  }
+  logger.Flush();
+
+  EXPECT_EQ(static_cast<std::size_t>(threads), sink->records().size());
+  EXPECT_EQ(0u, logger.thread_buffers());
+}
+}  // namespace common
+}  // namespace anbox
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "anbox/common/boot_timeline.h"
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <sstream>
+
+using namespace std::chrono;
+
+namespace anbox {
+namespace common {
+TEST(BootTimeline, KeepsFirstMarkOfEachEventInOrder) {
+  BootTimeline timeline;
+  const auto now = BootTimeline::Clock::now();
+
+  timeline.mark("container_started", now + milliseconds{20});
+  timeline.mark("session_manager_started", now);
+  timeline.mark("container_started", now + milliseconds{30});
+
+  const auto events = timeline.events();
+  ASSERT_EQ(2u, events.size());
+  EXPECT_EQ("session_manager_started", events[0].name);
+  EXPECT_EQ("container_started", events[1].name);
+  EXPECT_LT(events[0].offset, events[1].offset);
+  EXPECT_EQ(milliseconds{20}, duration_cast<milliseconds>(events[1].offset - events[0].offset));
+}
+
+TEST(BootTimeline, StopsRecordingOnceBootFinished) {
+  BootTimeline timeline;
+  timeline.mark("session_manager_started");
+  EXPECT_FALSE(timeline.finished());
+
+  timeline.finish();
+  EXPECT_TRUE(timeline.finished());
+  timeline.mark("first_layer_posted");
+  timeline.finish();
+
+  const auto events = timeline.events();
+  ASSERT_EQ(2u, events.size());
+  EXPECT_EQ(BootTimeline::boot_finished, events[1].name);
+}
+
+TEST(BootTimeline, WritesReportWhenBootFinished) {
+  const auto path = boost::filesystem::temp_directory_path() /
+                    boost::filesystem::unique_path("boot-timeline-%%%%-%%%%");
+
+  BootTimeline timeline;
+  timeline.set_report_path(path.string());
+  const auto now = BootTimeline::Clock::now();
+  timeline.mark("qemu_pipe_\"quoted\"_connected", now);
+  EXPECT_FALSE(boost::filesystem::exists(path));
+  timeline.finish(now + milliseconds{1500});
+
+  std::ifstream in(path.string());
+  std::stringstream report;
+  report << in.rdbuf();
+  boost::filesystem::remove(path);
+
+  const auto text = report.str();
+  EXPECT_NE(std::string::npos, text.find("# TYPE anbox_boot_event_seconds gauge\n"));
+  EXPECT_NE(std::string::npos, text.find("anbox_boot_event_seconds{event=\"qemu_pipe_\\\"quoted\\\"_connected\"} "));
+  EXPECT_LT(text.find("qemu_pipe_"), text.find("anbox_boot_event_seconds{event=\"boot_finished\"} 1.5"));
+}
+}  // namespace common
+}  // namespace anbox
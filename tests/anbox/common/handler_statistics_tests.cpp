@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/common/handler_statistics.h"
+
+#include <sstream>
+
+using namespace std::chrono;
+
+namespace anbox {
+namespace common {
+TEST(HandlerStatistics, RecordsHandlersPerTag) {
+  HandlerStatistics stats;
+
+  const HandlerStatistics::Clock::time_point start;
+  const auto posted = start + milliseconds{1};
+  stats.handler_executed("rpc", posted, posted + milliseconds{2}, posted + milliseconds{5});
+  // Without knowing when it was posted only the execution counts.
+  stats.handler_executed("opengles", {}, start + milliseconds{1}, start + milliseconds{2});
+  stats.handler_executed("opengles", {}, start + milliseconds{3}, start + milliseconds{4});
+
+  const auto summary = stats.summary();
+  ASSERT_EQ(2u, summary.size());
+  EXPECT_EQ("opengles", summary[0].tag);
+  EXPECT_EQ(2u, summary[0].handlers);
+  EXPECT_EQ(nanoseconds{0}, summary[0].queued.max);
+  EXPECT_EQ(milliseconds{1}, summary[0].execution.max);
+  EXPECT_EQ("rpc", summary[1].tag);
+  EXPECT_EQ(1u, summary[1].handlers);
+  EXPECT_EQ(milliseconds{2}, summary[1].queued.p50);
+  EXPECT_EQ(milliseconds{3}, summary[1].execution.p50);
+}
+
+TEST(HandlerStatistics, RecordsQueueDelayPerService) {
+  HandlerStatistics stats;
+  stats.queue_probed("control", milliseconds{4});
+  stats.queue_probed("control", milliseconds{8});
+  stats.queue_probed("graphics-0", microseconds{10});
+
+  const auto queues = stats.queue_summary();
+  ASSERT_EQ(2u, queues.size());
+  EXPECT_EQ("control", queues[0].service);
+  EXPECT_EQ(2u, queues[0].probes);
+  EXPECT_EQ(milliseconds{8}, queues[0].delay.max);
+  EXPECT_EQ("graphics-0", queues[1].service);
+  EXPECT_EQ(microseconds{10}, queues[1].delay.max);
+}
+
+TEST(HandlerStatistics, WritesPrometheusTextFormat) {
+  HandlerStatistics stats;
+
+  const HandlerStatistics::Clock::time_point start;
+  stats.handler_executed("rpc", start, start + milliseconds{1}, start + milliseconds{3});
+  stats.queue_probed("audio", milliseconds{5});
+
+  std::stringstream out;
+  stats.write_prometheus(out);
+  const auto text = out.str();
+
+  EXPECT_NE(std::string::npos, text.find("# TYPE anbox_runtime_handlers_total counter\n"));
+  EXPECT_NE(std::string::npos, text.find("anbox_runtime_handlers_total{tag=\"rpc\"} 1\n"));
+  EXPECT_NE(std::string::npos,
+            text.find("anbox_runtime_handler_seconds{tag=\"rpc\",stage=\"execution\",quantile=\"0.5\"} 0.002\n"));
+  EXPECT_NE(std::string::npos,
+            text.find("anbox_runtime_queue_delay_seconds{service=\"audio\",quantile=\"1\"} 0.005\n"));
+}
+}  // namespace common
+}  // namespace anbox
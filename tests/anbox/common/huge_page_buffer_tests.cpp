@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/common/huge_page_buffer.h"
+
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+namespace anbox {
+namespace common {
+namespace {
+struct ModeGuard {
+  ~ModeGuard() { HugePageBuffer::set_mode(HugePageBuffer::Mode::Off); }
+};
+}  // namespace
+
+TEST(HugePageBuffer, SmallBuffersUseMalloc) {
+  ModeGuard guard;
+  HugePageBuffer::set_mode(HugePageBuffer::Mode::Transparent);
+
+  HugePageBuffer buffer(4096);
+  EXPECT_NE(nullptr, buffer.data());
+  EXPECT_EQ(4096u, buffer.size());
+  EXPECT_FALSE(buffer.huge_pages());
+}
+
+TEST(HugePageBuffer, LargeBuffersAreMarkedForHugePages) {
+  ModeGuard guard;
+  HugePageBuffer::set_mode(HugePageBuffer::Mode::Reserved);
+  const auto before = HugePageBuffer::statistics();
+
+  // Without reserved huge pages, like on most test machines, this falls
+  // back to transparent ones.
+  HugePageBuffer buffer(HugePageBuffer::huge_page_size + 1);
+  ASSERT_NE(nullptr, buffer.data());
+  EXPECT_TRUE(buffer.huge_pages());
+  std::memset(buffer.data(), 0xab, buffer.size());
+
+  const auto after = HugePageBuffer::statistics();
+  EXPECT_EQ(before.reserved + before.fallbacks + 1, after.reserved + after.fallbacks);
+
+  std::ostringstream out;
+  HugePageBuffer::write_prometheus(out);
+  EXPECT_NE(std::string::npos, out.str().find("anbox_huge_page_buffers_total{kind=\"reserved\"}"));
+}
+
+TEST(HugePageBuffer, MovesOwnership) {
+  HugePageBuffer a(100);
+  const auto data = a.data();
+
+  HugePageBuffer b(std::move(a));
+  EXPECT_EQ(nullptr, a.data());
+  EXPECT_EQ(data, b.data());
+
+  a = std::move(b);
+  EXPECT_EQ(data, a.data());
+  EXPECT_EQ(100u, a.size());
+}
+
+TEST(HugePageBuffer, ReportsFailedAllocations) {
+  HugePageBuffer buffer(std::numeric_limits<std::size_t>::max() / 2);
+  EXPECT_FALSE(buffer.valid());
+  EXPECT_EQ(nullptr, buffer.data());
+  EXPECT_EQ(0u, buffer.size());
+}
+
+TEST(HugePageBuffer, ParsesModes) {
+  HugePageBuffer::Mode mode;
+  std::istringstream("reserved") >> mode;
+  EXPECT_EQ(HugePageBuffer::Mode::Reserved, mode);
+  std::istringstream("off") >> mode;
+  EXPECT_EQ(HugePageBuffer::Mode::Off, mode);
+  std::istringstream in("huge");
+  EXPECT_THROW(in >> mode, std::runtime_error);
+}
+}  // namespace common
+}  // namespace anbox
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/common/image_mount.h"
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <vector>
+
+namespace fs = boost::filesystem;
+
+namespace {
+class ImageMountTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    path_ = fs::temp_directory_path() / fs::unique_path("anbox-image-%%%%-%%%%");
+  }
+
+  void TearDown() override {
+    fs::remove(path_);
+  }
+
+  void write_image(std::size_t offset, const std::vector<char> &magic) {
+    std::vector<char> data(4096, 0);
+    std::copy(magic.begin(), magic.end(), data.begin() + offset);
+    std::ofstream out(path_.string(), std::ios::binary);
+    out.write(data.data(), data.size());
+  }
+
+  fs::path path_;
+};
+}  // namespace
+
+namespace anbox {
+namespace common {
+TEST_F(ImageMountTest, DetectsSquashfs) {
+  write_image(0, {'h', 's', 'q', 's'});
+  EXPECT_EQ("squashfs", ImageMount::filesystem_type(path_));
+}
+
+TEST_F(ImageMountTest, DetectsErofs) {
+  write_image(1024, {'\xe2', '\xe1', '\xf5', '\xe0'});
+  EXPECT_EQ("erofs", ImageMount::filesystem_type(path_));
+}
+
+TEST_F(ImageMountTest, RejectsUnknownImages) {
+  write_image(0, {'e', 'x', 't', '4'});
+  EXPECT_EQ("", ImageMount::filesystem_type(path_));
+  EXPECT_EQ("", ImageMount::filesystem_type(path_.string() + ".missing"));
+}
+}  // namespace common
+}  // namespace anbox
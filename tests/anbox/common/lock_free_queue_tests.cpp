@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/common/lock_free_queue.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+// What the queues replace, to compare them against under contention.
+class LockedQueue {
+ public:
+  explicit LockedQueue(std::size_t capacity) : capacity_(capacity) {}
+
+  void push(std::uint64_t item) {
+    std::unique_lock<std::mutex> l(lock_);
+    can_push_.wait(l, [&]() { return items_.size() < capacity_; });
+    items_.push_back(item);
+    can_pop_.notify_one();
+  }
+
+  void pop(std::uint64_t *item) {
+    std::unique_lock<std::mutex> l(lock_);
+    can_pop_.wait(l, [&]() { return !items_.empty(); });
+    *item = items_.front();
+    items_.pop_front();
+    can_push_.notify_one();
+  }
+
+ private:
+  std::size_t capacity_;
+  std::mutex lock_;
+  std::condition_variable can_push_;
+  std::condition_variable can_pop_;
+  std::deque<std::uint64_t> items_;
+};
+
+constexpr std::size_t contention_capacity{64};
+constexpr std::uint64_t items_per_producer{100000};
+
+// Pushes from |producers| threads at once and checks that every item
+// arrives exactly once and in the order of its producer. Returns how
+// long it took.
+template <typename Queue>
+std::chrono::nanoseconds run_contention(Queue &queue, std::uint64_t producers) {
+  const auto start = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> threads;
+  for (std::uint64_t p = 0; p < producers; p++) {
+    threads.push_back(std::thread([&queue, p]() {
+      for (std::uint64_t n = 0; n < items_per_producer; n++)
+        queue.push(p * items_per_producer + n);
+    }));
+  }
+
+  std::vector<std::uint64_t> next(producers, 0);
+  for (std::uint64_t n = 0; n < producers * items_per_producer; n++) {
+    std::uint64_t item = 0;
+    queue.pop(&item);
+    const auto producer = item / items_per_producer;
+    EXPECT_EQ(next[producer]++, item % items_per_producer);
+  }
+
+  for (auto &thread : threads)
+    thread.join();
+
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start);
+}
+
+void record_throughput(const char *name, std::uint64_t items, const std::chrono::nanoseconds &elapsed) {
+  const auto per_second = static_cast<double>(items) * 1e9 / static_cast<double>(elapsed.count() + 1);
+  ::testing::Test::RecordProperty(name, std::to_string(static_cast<std::uint64_t>(per_second)));
+}
+}  // namespace
+
+namespace anbox {
+namespace common {
+template <typename Queue>
+class LockFreeQueue : public ::testing::Test {};
+
+typedef ::testing::Types<SpscQueue<std::string>, MpscQueue<std::string>> QueueTypes;
+TYPED_TEST_CASE(LockFreeQueue, QueueTypes);
+
+TYPED_TEST(LockFreeQueue, TryPushFailsWhenFull) {
+  TypeParam queue(2);
+
+  EXPECT_EQ(0, queue.try_push(std::string("Hello")));
+  EXPECT_EQ(0, queue.try_push(std::string("World")));
+
+  std::string item("You Shall Not Move");
+  EXPECT_EQ(-EAGAIN, queue.try_push(std::move(item)));
+  EXPECT_FALSE(item.empty()) << "Item should not be moved on failure!";
+}
+
+TYPED_TEST(LockFreeQueue, TryPushFailsOnClosedQueue) {
+  TypeParam queue(2);
+
+  EXPECT_EQ(0, queue.try_push(std::string("Hello")));
+  queue.close();
+  EXPECT_TRUE(queue.is_closed());
+  EXPECT_EQ(-EIO, queue.try_push(std::string("World")));
+}
+
+TYPED_TEST(LockFreeQueue, PopsInOrderOverManyLaps) {
+  TypeParam queue(3);
+
+  std::string item;
+  EXPECT_EQ(-EAGAIN, queue.try_pop(&item));
+
+  for (int n = 0; n < 10; n++) {
+    EXPECT_EQ(0, queue.try_push(std::to_string(n)));
+    EXPECT_EQ(0, queue.try_push(std::to_string(n + 100)));
+    EXPECT_EQ(0, queue.try_pop(&item));
+    EXPECT_EQ(std::to_string(n), item);
+    EXPECT_EQ(0, queue.try_pop(&item));
+    EXPECT_EQ(std::to_string(n + 100), item);
+  }
+
+  EXPECT_EQ(-EAGAIN, queue.try_pop(&item));
+}
+
+TYPED_TEST(LockFreeQueue, ClosedQueueIsDrainedFirst) {
+  TypeParam queue(2);
+
+  EXPECT_EQ(0, queue.try_push(std::string("Hello")));
+  EXPECT_EQ(0, queue.try_push(std::string("World")));
+  queue.close();
+
+  std::string item;
+  EXPECT_EQ(0, queue.pop(&item));
+  EXPECT_EQ("Hello", item);
+  EXPECT_EQ(0, queue.try_pop(&item));
+  EXPECT_EQ("World", item);
+  EXPECT_EQ(-EIO, queue.try_pop(&item));
+  EXPECT_EQ(-EIO, queue.pop(&item));
+  EXPECT_EQ("World", item);
+}
+
+TYPED_TEST(LockFreeQueue, PushBlocksUntilThereIsSpace) {
+  TypeParam queue(1);
+  EXPECT_EQ(0, queue.push(std::string("first")));
+
+  std::thread producer([&]() { EXPECT_EQ(0, queue.push(std::string("second"))); });
+
+  std::string item;
+  EXPECT_EQ(0, queue.pop(&item));
+  EXPECT_EQ("first", item);
+  EXPECT_EQ(0, queue.pop(&item));
+  EXPECT_EQ("second", item);
+
+  producer.join();
+}
+
+TYPED_TEST(LockFreeQueue, CloseWakesBlockedCalls) {
+  TypeParam empty(1);
+  std::thread consumer([&]() {
+    std::string item;
+    EXPECT_EQ(-EIO, empty.pop(&item));
+  });
+
+  TypeParam full(1);
+  EXPECT_EQ(0, full.push(std::string("first")));
+  std::thread producer([&]() { EXPECT_EQ(-EIO, full.push(std::string("second"))); });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  empty.close();
+  full.close();
+
+  consumer.join();
+  producer.join();
+}
+
+TEST(LockFreeQueue, SingleProducerContention) {
+  SpscQueue<std::uint64_t> queue(contention_capacity);
+  const auto elapsed = run_contention(queue, 1);
+  record_throughput("spsc_items_per_second", items_per_producer, elapsed);
+
+  LockedQueue locked(contention_capacity);
+  record_throughput("locked_items_per_second", items_per_producer, run_contention(locked, 1));
+}
+
+TEST(LockFreeQueue, MultipleProducerContention) {
+  const std::uint64_t producers = 4;
+
+  MpscQueue<std::uint64_t> queue(contention_capacity);
+  const auto elapsed = run_contention(queue, producers);
+  record_throughput("mpsc_items_per_second", producers * items_per_producer, elapsed);
+
+  LockedQueue locked(contention_capacity);
+  record_throughput("locked_items_per_second", producers * items_per_producer,
+                    run_contention(locked, producers));
+}
+}  // namespace common
+}  // namespace anbox
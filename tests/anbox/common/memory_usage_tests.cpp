@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/common/block_pool.h"
+#include "anbox/common/memory_usage.h"
+#include "anbox/graphics/ring_buffer.h"
+
+#include <sstream>
+
+namespace anbox {
+namespace common {
+TEST(MemoryUsage, FollowsAllocationsOfSubsystems) {
+  const auto transport = MemoryUsage::bytes(MemoryUsage::Subsystem::TransportBuffers);
+  const auto caches = MemoryUsage::bytes(MemoryUsage::Subsystem::Caches);
+  {
+    graphics::RingBuffer ring(4096);
+    EXPECT_EQ(transport + 4096, MemoryUsage::bytes(MemoryUsage::Subsystem::TransportBuffers));
+
+    BlockPool pool;
+    pool.release(pool.acquire(100), BlockPool::small_block_size);
+    EXPECT_EQ(caches + static_cast<std::int64_t>(BlockPool::small_block_size),
+              MemoryUsage::bytes(MemoryUsage::Subsystem::Caches));
+  }
+  EXPECT_EQ(transport, MemoryUsage::bytes(MemoryUsage::Subsystem::TransportBuffers));
+  EXPECT_EQ(caches, MemoryUsage::bytes(MemoryUsage::Subsystem::Caches));
+}
+
+TEST(MemoryUsage, ReportsEverySubsystem) {
+  MemoryUsage::add(MemoryUsage::Subsystem::DecoderContexts, 2048);
+
+  std::ostringstream out;
+  MemoryUsage::write_prometheus(out);
+  const auto report = out.str();
+  EXPECT_NE(std::string::npos, report.find("anbox_memory_bytes{subsystem=\"transport_buffers\"}"));
+  EXPECT_NE(std::string::npos, report.find("anbox_memory_bytes{subsystem=\"gl_objects\"}"));
+  EXPECT_NE(std::string::npos, report.find("anbox_memory_bytes{subsystem=\"decoder_contexts\"}"));
+  EXPECT_NE(std::string::npos, report.find("anbox_memory_bytes{subsystem=\"caches\"}"));
+  EXPECT_NE(std::string::npos, report.find("anbox_memory_resident_bytes "));
+  EXPECT_GT(MemoryUsage::resident_bytes(), 0u);
+
+  MemoryUsage::remove(MemoryUsage::Subsystem::DecoderContexts, 2048);
+}
+}  // namespace common
+}  // namespace anbox
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/common/metrics.h"
+
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace anbox {
+namespace common {
+TEST(Metrics, SeriesAreCreatedOnce) {
+  Metrics metrics;
+
+  auto &counter = metrics.counter("anbox_foo_total", "Foo", {{"kind", "a"}});
+  counter.add();
+  metrics.counter("anbox_foo_total", "Foo", {{"kind", "a"}}).add(2);
+  metrics.counter("anbox_foo_total", "Foo", {{"kind", "b"}}).add();
+
+  EXPECT_EQ(3u, counter.value());
+  EXPECT_THROW(metrics.gauge("anbox_foo_total", "Foo"), std::runtime_error);
+}
+
+TEST(Metrics, HistogramBucketsGrowWithTheValue) {
+  for (std::uint64_t value = 0; value < 8; value++)
+    EXPECT_EQ(value, Metrics::Histogram::lowest_value_of(Metrics::Histogram::bucket_for(value)));
+
+  for (const std::uint64_t value : {8ull, 9ull, 1000ull, 123456789ull, ~0ull}) {
+    const auto bucket = Metrics::Histogram::bucket_for(value);
+    ASSERT_LT(bucket, Metrics::Histogram::bucket_count);
+    const auto lowest = Metrics::Histogram::lowest_value_of(bucket);
+    EXPECT_LE(lowest, value);
+    EXPECT_LE(static_cast<double>(value - lowest), 0.125 * static_cast<double>(value));
+    if (bucket + 1 < Metrics::Histogram::bucket_count) {
+      EXPECT_GT(Metrics::Histogram::lowest_value_of(bucket + 1), value);
+    }
+  }
+}
+
+TEST(Metrics, HistogramQuantiles) {
+  Metrics::Histogram histogram;
+  EXPECT_EQ(0u, histogram.value_at(0.5));
+
+  for (std::uint64_t value = 1; value <= 100; value++)
+    histogram.record(value < 100 ? 4 : 1000000);
+
+  EXPECT_EQ(100u, histogram.count());
+  EXPECT_EQ(99u * 4 + 1000000, histogram.sum());
+  EXPECT_EQ(4u, histogram.value_at(0.5));
+  EXPECT_EQ(4u, histogram.value_at(0.99));
+  EXPECT_NEAR(1000000.0, static_cast<double>(histogram.value_at(1.0)), 0.125 * 1000000);
+}
+
+TEST(Metrics, WritesPrometheusTextFormat) {
+  Metrics metrics;
+  metrics.counter("anbox_foo_total", "Foo events", {{"window", "org.anbox.\"quoted\""}}).add(3);
+  metrics.gauge("anbox_bar", "Bar").set(-2);
+  metrics.histogram("anbox_baz_seconds", "Baz", {}, 1e-3).record(5);
+  metrics.add_collector("extra", [](std::ostream &out) { out << "anbox_extra 1\n"; });
+
+  std::stringstream out;
+  metrics.write_prometheus(out);
+  const auto text = out.str();
+
+  EXPECT_NE(std::string::npos, text.find("# TYPE anbox_foo_total counter\n"));
+  EXPECT_NE(std::string::npos, text.find("anbox_foo_total{window=\"org.anbox.\\\"quoted\\\"\"} 3\n"));
+  EXPECT_NE(std::string::npos, text.find("# TYPE anbox_bar gauge\nanbox_bar -2\n"));
+  EXPECT_NE(std::string::npos, text.find("# TYPE anbox_baz_seconds summary\n"));
+  EXPECT_NE(std::string::npos, text.find("anbox_baz_seconds{quantile=\"0.5\"} 0.005\n"));
+  EXPECT_NE(std::string::npos, text.find("anbox_baz_seconds_count 1\n"));
+  EXPECT_NE(std::string::npos, text.find("anbox_extra 1\n"));
+
+  metrics.remove_collector("extra");
+  std::stringstream without;
+  metrics.write_prometheus(without);
+  EXPECT_EQ(std::string::npos, without.str().find("anbox_extra"));
+}
+
+TEST(Metrics, ConcurrentUpdatesAreNotLost) {
+  Metrics metrics;
+  auto &counter = metrics.counter("anbox_foo_total", "Foo");
+  auto &histogram = metrics.histogram("anbox_bar", "Bar");
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.push_back(std::thread([&]() {
+      for (int n = 0; n < 10000; n++) {
+        counter.add();
+        histogram.record(static_cast<std::uint64_t>(n));
+      }
+    }));
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  EXPECT_EQ(40000u, counter.value());
+  EXPECT_EQ(40000u, histogram.count());
+}
+}  // namespace common
+}  // namespace anbox
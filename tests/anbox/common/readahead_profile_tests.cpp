@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/common/readahead_profile.h"
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <sstream>
+
+#include <unistd.h>
+
+namespace fs = boost::filesystem;
+
+namespace anbox {
+namespace common {
+TEST(ReadaheadProfile, WritesAndReadsProfiles) {
+  ReadaheadProfile::Image image;
+  image.size = 1024 * 1024;
+  image.mtime = 1234567890123456789;
+  const std::vector<ReadaheadProfile::Range> ranges{{0, 4096}, {65536, 12288}};
+
+  std::stringstream s;
+  ReadaheadProfile::write(s, image, ranges);
+
+  ReadaheadProfile::Image read_image;
+  std::vector<ReadaheadProfile::Range> read_ranges;
+  ASSERT_TRUE(ReadaheadProfile::read(s, read_image, read_ranges));
+  EXPECT_TRUE(image == read_image);
+  ASSERT_EQ(2u, read_ranges.size());
+  EXPECT_EQ(65536u, read_ranges[1].offset);
+  EXPECT_EQ(12288u, read_ranges[1].length);
+}
+
+TEST(ReadaheadProfile, RejectsInvalidProfiles) {
+  ReadaheadProfile::Image image;
+  std::vector<ReadaheadProfile::Range> ranges;
+
+  std::istringstream empty;
+  EXPECT_FALSE(ReadaheadProfile::read(empty, image, ranges));
+
+  std::istringstream garbage("# anbox readahead profile\nimage 1 2\n0 foo\n");
+  EXPECT_FALSE(ReadaheadProfile::read(garbage, image, ranges));
+}
+
+TEST(ReadaheadProfile, FindsResidentRanges) {
+  const auto path = fs::temp_directory_path() / fs::unique_path("anbox-readahead-%%%%-%%%%");
+  const auto page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+  {
+    // What was just written is still in the page cache.
+    std::ofstream out(path.string(), std::ios::binary);
+    const std::string data(page_size * 3 + 100, 'x');
+    out.write(data.data(), data.size());
+  }
+
+  const auto ranges = ReadaheadProfile::resident_ranges(path);
+  fs::remove(path);
+
+  ASSERT_EQ(1u, ranges.size());
+  EXPECT_EQ(0u, ranges[0].offset);
+  EXPECT_EQ(page_size * 3 + 100, ranges[0].length);
+}
+}  // namespace common
+}  // namespace anbox
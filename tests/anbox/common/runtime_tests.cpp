@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/runtime.h"
+
+#include <chrono>
+#include <future>
+#include <thread>
+
+namespace anbox {
+TEST(Runtime, SpreadsGraphicsOverItsShards) {
+  auto rt = Runtime::create(2);
+
+  auto &first = rt->service(Runtime::Subsystem::Graphics);
+  auto &second = rt->service(Runtime::Subsystem::Graphics);
+  EXPECT_NE(&first, &second);
+  EXPECT_EQ(&first, &rt->service(Runtime::Subsystem::Graphics));
+
+  EXPECT_EQ(&rt->service(), &rt->service(Runtime::Subsystem::Control));
+  EXPECT_NE(&rt->service(), &rt->service(Runtime::Subsystem::Audio));
+  EXPECT_NE(&rt->service(Runtime::Subsystem::Audio), &rt->service(Runtime::Subsystem::Input));
+}
+
+TEST(Runtime, BlockedSubsystemDoesNotHoldUpOthers) {
+  auto rt = Runtime::create(1);
+  rt->start();
+
+  std::promise<void> unblock;
+  auto blocked = unblock.get_future().share();
+  for (std::uint32_t n = 0; n < Runtime::control_threads; n++)
+    rt->service().post([blocked]() { blocked.wait(); });
+  rt->service(Runtime::Subsystem::Graphics).post([blocked]() { blocked.wait(); });
+
+  std::promise<void> audio;
+  rt->service(Runtime::Subsystem::Audio).post([&]() { audio.set_value(); });
+  std::promise<void> input;
+  rt->service(Runtime::Subsystem::Input).post([&]() { input.set_value(); });
+
+  EXPECT_EQ(std::future_status::ready, audio.get_future().wait_for(std::chrono::seconds{5}));
+  EXPECT_EQ(std::future_status::ready, input.get_future().wait_for(std::chrono::seconds{5}));
+
+  unblock.set_value();
+  rt->stop();
+}
+
+TEST(Runtime, ProbesQueueOfEveryService) {
+  auto rt = Runtime::create(2);
+  rt->probe_queues();
+
+  auto statistics = std::make_shared<common::HandlerStatistics>();
+  rt->set_handler_statistics(statistics);
+  rt->probe_queues();
+  rt->start();
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{5};
+  while (statistics->queue_summary().size() < 5 && std::chrono::steady_clock::now() < deadline)
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  rt->stop();
+
+  const auto queues = statistics->queue_summary();
+  ASSERT_EQ(5u, queues.size());
+  EXPECT_EQ("audio", queues[0].service);
+  EXPECT_EQ("control", queues[1].service);
+  EXPECT_EQ("graphics-0", queues[2].service);
+  EXPECT_EQ("graphics-1", queues[3].service);
+  EXPECT_EQ("input", queues[4].service);
+  for (const auto &q : queues)
+    EXPECT_EQ(1u, q.probes);
+}
+}  // namespace anbox
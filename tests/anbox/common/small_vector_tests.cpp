@@ -9,13 +9,17 @@
 // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
 // GNU General Public License for more details.
 
+#include "anbox/common/byte_buffer.h"
 #include "anbox/common/small_vector.h"
 #include "anbox/common/scope_ptr.h"
 #include "anbox/testing/gtest_utils.h"
 
 #include <gtest/gtest.h>
 
+#include <cstring>
 #include <string>
+#include <thread>
+#include <vector>
 
 namespace anbox {
 namespace common {
@@ -215,5 +219,124 @@ TEST(SmallVector, useThroughInterface) {
         EXPECT_EQ(2, destructedTimes);
     }
 }
+
+TEST(ByteBuffer, smallSizesDontAllocate) {
+    BlockPool pool;
+    ByteBuffer<16> buffer(pool);
+    buffer.resize_noinit(16);
+    EXPECT_FALSE(buffer.isAllocated());
+
+    std::memcpy(buffer.data(), "0123456789abcdef", 16);
+    ByteBuffer<16> moved(std::move(buffer));
+    EXPECT_EQ(0, std::memcmp(moved.data(), "0123456789abcdef", 16));
+    EXPECT_TRUE(buffer.empty());
+    EXPECT_EQ(0u, pool.statistics().allocations);
+}
+
+TEST(ByteBuffer, growsIntoPoolBlocks) {
+    BlockPool pool;
+    ByteBuffer<16> buffer(pool);
+    buffer.resize_noinit(10);
+    std::memcpy(buffer.data(), "0123456789", 10);
+
+    buffer.resize_noinit(100);
+    EXPECT_TRUE(buffer.isAllocated());
+    EXPECT_EQ(BlockPool::small_block_size, buffer.capacity());
+    EXPECT_EQ(0, std::memcmp(buffer.data(), "0123456789", 10));
+
+    // Stays within the block until it is outgrown.
+    buffer.resize_noinit(BlockPool::small_block_size);
+    EXPECT_EQ(1u, pool.statistics().allocations);
+    buffer.resize_noinit(BlockPool::small_block_size + 1);
+    EXPECT_EQ(BlockPool::medium_block_size, buffer.capacity());
+    EXPECT_EQ(2u, pool.statistics().allocations);
+
+    // Beyond the largest block we get exactly what we asked for.
+    buffer.resize_noinit(3 * BlockPool::large_block_size);
+    EXPECT_EQ(3 * BlockPool::large_block_size, buffer.capacity());
+}
+
+TEST(ByteBuffer, moveHandsTheBlockOver) {
+    BlockPool pool;
+    ByteBuffer<16> buffer(pool);
+    buffer.resize_noinit(1000);
+    const auto data = buffer.data();
+
+    ByteBuffer<16> moved(pool);
+    moved = std::move(buffer);
+    EXPECT_EQ(data, moved.data());
+    EXPECT_EQ(1000u, moved.size());
+    EXPECT_FALSE(buffer.isAllocated());
+    EXPECT_EQ(1u, pool.statistics().allocations);
+}
+
+TEST(ByteBuffer, releasedBlocksAreReused) {
+    BlockPool pool;
+    for (int n = 0; n < 100; n++) {
+        ByteBuffer<16> buffer(pool);
+        buffer.resize_noinit(2000);
+    }
+
+    const auto stats = pool.statistics();
+    EXPECT_EQ(1u, stats.allocations);
+    EXPECT_EQ(99u, stats.reuses);
+    EXPECT_EQ(BlockPool::small_block_size, stats.cached_bytes);
+}
+
+TEST(ByteBuffer, poolCachesOnlyUpToItsLimit) {
+    BlockPool pool(2 * BlockPool::small_block_size);
+    {
+        std::vector<ByteBuffer<16>> buffers;
+        for (int n = 0; n < 4; n++) {
+            buffers.emplace_back(pool);
+            buffers.back().resize_noinit(100);
+        }
+    }
+    EXPECT_EQ(4u, pool.statistics().allocations);
+    EXPECT_EQ(2 * BlockPool::small_block_size, pool.statistics().cached_bytes);
+}
+TEST(ByteBuffer, resetGivesLargeBlocksBack) {
+    BlockPool pool;
+    ByteBuffer<16> buffer(pool);
+    buffer.resize_noinit(BlockPool::large_block_size);
+    buffer.reset(100);
+    EXPECT_EQ(100u, buffer.size());
+    EXPECT_EQ(BlockPool::small_block_size, buffer.capacity());
+    EXPECT_EQ(BlockPool::large_block_size, pool.statistics().cached_bytes);
+}
+
+TEST(BlockPool, threadCacheKeepsSteadyStateOffTheSharedLists) {
+    auto &pool = BlockPool::instance();
+    // A fresh thread so nothing is cached for it yet.
+    std::thread([&]() {
+        for (int n = 0; n < 10; n++)
+            pool.release(pool.acquire(1000), BlockPool::small_block_size);
+
+        const auto before = pool.statistics().shared_transfers;
+        for (int n = 0; n < 10000; n++)
+            pool.release(pool.acquire(1000), BlockPool::small_block_size);
+        EXPECT_EQ(before, pool.statistics().shared_transfers);
+    }).join();
+}
+
+TEST(BlockPool, blocksMovingBetweenThreadsAreBatched) {
+    auto &pool = BlockPool::instance();
+    const std::size_t count = 1000;
+    std::vector<void *> blocks;
+
+    const auto before = pool.statistics().shared_transfers;
+    std::thread([&]() {
+        for (std::size_t n = 0; n < count; n++)
+            blocks.push_back(pool.acquire(1000));
+    }).join();
+    std::thread([&]() {
+        for (auto block : blocks)
+            pool.release(block, BlockPool::small_block_size);
+    }).join();
+
+    // Both sides go to the shared lists for a batch of blocks at a time
+    // and once more when their thread exits.
+    EXPECT_LT(pool.statistics().shared_transfers - before, count / 10);
+}
 }  // namespace common
 }  // namespace anbox
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/common/tracer.h"
+
+#include <sstream>
+#include <thread>
+
+namespace {
+std::size_t count_of(const std::string &haystack, const std::string &needle) {
+  std::size_t count = 0;
+  for (auto pos = haystack.find(needle); pos != std::string::npos;
+       pos = haystack.find(needle, pos + needle.size()))
+    count++;
+  return count;
+}
+
+std::string trace() {
+  std::stringstream out;
+  anbox::common::Tracer::instance().write_chrome_trace(out);
+  return out.str();
+}
+}  // namespace
+
+namespace anbox {
+namespace common {
+TEST(Tracer, RecordsNothingUntilEnabled) {
+  { Tracer::Span span{"test", "not_traced"}; }
+  EXPECT_EQ(0u, count_of(trace(), "not_traced"));
+}
+
+TEST(Tracer, RecordsSpansOfThreadsWhichAreGone) {
+  Tracer::instance().enable();
+  std::thread thread([]() {
+    Tracer::Span outer{"test", "outer_span"};
+    Tracer::Span inner{"test", "inner_span"};
+  });
+  thread.join();
+  Tracer::instance().disable();
+
+  const auto json = trace();
+  EXPECT_EQ(1u, count_of(json, "\"name\":\"outer_span\",\"cat\":\"test\",\"ph\":\"X\""));
+  EXPECT_EQ(1u, count_of(json, "\"name\":\"inner_span\""));
+  EXPECT_EQ(0u, count_of(json, "not_traced"));
+}
+
+TEST(Tracer, KeepsTheMostRecentSpansOfAThread) {
+  Tracer::instance().enable(2);
+  std::thread thread([]() {
+    { Tracer::Span span{"test", "dropped_span"}; }
+    { Tracer::Span span{"test", "kept_span"}; }
+    { Tracer::Span span{"test", "kept_span"}; }
+  });
+  thread.join();
+  Tracer::instance().disable();
+
+  const auto json = trace();
+  EXPECT_EQ(0u, count_of(json, "dropped_span"));
+  EXPECT_EQ(2u, count_of(json, "kept_span"));
+}
+}  // namespace common
+}  // namespace anbox
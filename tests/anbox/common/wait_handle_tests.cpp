@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/common/wait_handle.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+namespace anbox {
+namespace common {
+TEST(WaitHandle, TimedWaitSucceedsWhenResultArrives) {
+  WaitHandle handle;
+  handle.expect_result();
+
+  std::thread t([&]() { handle.result_received(); });
+  EXPECT_TRUE(handle.wait_for_all(std::chrono::seconds{10}));
+  t.join();
+
+  EXPECT_FALSE(handle.is_pending());
+}
+
+TEST(WaitHandle, TimedWaitFailsWithoutResult) {
+  WaitHandle handle;
+  handle.expect_result();
+
+  EXPECT_FALSE(handle.wait_for_all(std::chrono::milliseconds{10}));
+  EXPECT_TRUE(handle.is_pending());
+
+  handle.cancel_expected();
+  EXPECT_FALSE(handle.is_pending());
+  EXPECT_TRUE(handle.wait_for_all(std::chrono::milliseconds{10}));
+}
+}  // namespace common
+}  // namespace anbox
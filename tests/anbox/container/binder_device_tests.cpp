@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "anbox/container/binder_device.h"
+
+#include <sstream>
+
+namespace anbox {
+namespace container {
+TEST(BinderDevice, FindsBinderfsInFilesystems) {
+  std::istringstream filesystems(
+      "nodev\tsysfs\n"
+      "nodev\tproc\n"
+      "\text4\n"
+      "nodev\tbinder\n");
+  ASSERT_TRUE(BinderDevice::lists_binderfs(filesystems));
+}
+
+TEST(BinderDevice, IgnoresSimilarFilesystems) {
+  std::istringstream filesystems(
+      "nodev\tsysfs\n"
+      "nodev\tbinderfs2\n"
+      "\tbinder_ext\n");
+  ASSERT_FALSE(BinderDevice::lists_binderfs(filesystems));
+}
+}  // namespace container
+}  // namespace anbox
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/container/binder_statistics.h"
+
+#include <sstream>
+
+using namespace std::chrono;
+
+namespace {
+const char *transaction_line =
+    "   surfaceflinger-123   [001] d..1  5678.123456: binder_transaction: transaction=42 "
+    "dest_node=7 dest_proc=567 dest_thread=0 reply=0 flags=0x10 code=0x1";
+const char *received_line =
+    "     Binder:567_2-570   [000] ...1  5678.124456: binder_transaction_received: transaction=42";
+
+anbox::container::BinderStatistics::TraceEvent transaction(int id, pid_t dest, bool reply,
+                                                           const microseconds &time) {
+  return {anbox::container::BinderStatistics::TraceEvent::Type::transaction, time, id, dest, reply};
+}
+
+anbox::container::BinderStatistics::TraceEvent received(int id, const microseconds &time) {
+  return {anbox::container::BinderStatistics::TraceEvent::Type::received, time, id, 0, false};
+}
+}  // namespace
+
+namespace anbox {
+namespace container {
+TEST(BinderStatistics, ParsesTracepoints) {
+  BinderStatistics::TraceEvent event;
+  ASSERT_TRUE(BinderStatistics::parse_trace_line(transaction_line, event));
+  EXPECT_EQ(BinderStatistics::TraceEvent::Type::transaction, event.type);
+  EXPECT_EQ(seconds{5678} + microseconds{123456}, event.time);
+  EXPECT_EQ(42, event.transaction);
+  EXPECT_EQ(567, event.dest_proc);
+  EXPECT_FALSE(event.reply);
+
+  ASSERT_TRUE(BinderStatistics::parse_trace_line(received_line, event));
+  EXPECT_EQ(BinderStatistics::TraceEvent::Type::received, event.type);
+  EXPECT_EQ(seconds{5678} + microseconds{124456}, event.time);
+  EXPECT_EQ(42, event.transaction);
+}
+
+TEST(BinderStatistics, IgnoresOtherLines) {
+  BinderStatistics::TraceEvent event;
+  EXPECT_FALSE(BinderStatistics::parse_trace_line("", event));
+  EXPECT_FALSE(BinderStatistics::parse_trace_line(
+      "  foo-1 [000] ...1  1.000001: binder_ioctl: cmd=0xc0306201 arg=0x0", event));
+  EXPECT_FALSE(BinderStatistics::parse_trace_line(
+      "  foo-1 [000] ...1  garbage: binder_transaction_received: transaction=1", event));
+  EXPECT_FALSE(BinderStatistics::parse_trace_line(
+      "  foo-1 [000] ...1  1.000001: binder_transaction: transaction=1", event));
+}
+
+TEST(BinderStatistics, MeasuresDeliveryLatencyOfReceivingProcess) {
+  BinderStatistics stats;
+  stats.add(transaction(1, 100, false, microseconds{1000}));
+  stats.add(transaction(2, 200, true, microseconds{1000}));
+  stats.add(received(1, microseconds{1500}));
+  stats.add(received(2, microseconds{4000}));
+  // Never sent as far as we know.
+  stats.add(received(3, microseconds{5000}));
+
+  const auto summary = stats.summary();
+  ASSERT_EQ(2u, summary.size());
+  EXPECT_EQ(100, summary[0].pid);
+  EXPECT_EQ(1u, summary[0].calls);
+  EXPECT_EQ(0u, summary[0].replies);
+  EXPECT_EQ(microseconds{500}, summary[0].latency.max);
+  EXPECT_EQ(200, summary[1].pid);
+  EXPECT_EQ(1u, summary[1].replies);
+  EXPECT_EQ(milliseconds{3}, summary[1].latency.p99);
+}
+
+TEST(BinderStatistics, WritesKnownProcessesOnly) {
+  BinderStatistics stats;
+  stats.add(transaction(1, 100, false, microseconds{0}));
+  stats.add(received(1, microseconds{2000}));
+  stats.add(transaction(2, 200, false, microseconds{0}));
+
+  std::stringstream out;
+  stats.write_prometheus(out, [](pid_t pid, BinderStatistics::Process &process) {
+    if (pid != 100)
+      return false;
+    process.container = "default";
+    process.name = "system_server";
+    return true;
+  });
+  const auto text = out.str();
+
+  EXPECT_NE(std::string::npos, text.find("# TYPE anbox_binder_transactions_total counter\n"));
+  EXPECT_NE(std::string::npos,
+            text.find("anbox_binder_transactions_total{container=\"default\",process=\"system_server\",pid=\"100\",kind=\"call\"} 1\n"));
+  EXPECT_NE(std::string::npos,
+            text.find("anbox_binder_delivery_latency_seconds{container=\"default\",process=\"system_server\",pid=\"100\",quantile=\"0.99\"} 0.002\n"));
+  EXPECT_EQ(std::string::npos, text.find("pid=\"200\""));
+
+  // Gone processes are forgotten.
+  EXPECT_EQ(1u, stats.summary().size());
+}
+}  // namespace container
+}  // namespace anbox
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "anbox/config.h"
+#include "anbox/container/instance.h"
+
+#include <stdexcept>
+
+namespace anbox {
+namespace container {
+TEST(Instance, DefaultInstanceKeepsFirstIdRange) {
+  const auto instances = Instance::parse("foo,default,bar");
+  ASSERT_EQ(3u, instances.size());
+  EXPECT_EQ("default", instances[0].name);
+  EXPECT_EQ(100000u, instances[0].base_id);
+  EXPECT_EQ("foo", instances[1].name);
+  EXPECT_EQ(100000u + 65536u, instances[1].base_id);
+  EXPECT_EQ("bar", instances[2].name);
+  EXPECT_EQ(100000u + 2 * 65536u, instances[2].base_id);
+}
+
+TEST(Instance, RejectsInvalidNames) {
+  EXPECT_TRUE(Instance::is_valid_name("android-1_a"));
+  EXPECT_FALSE(Instance::is_valid_name(""));
+  EXPECT_FALSE(Instance::is_valid_name("-foo"));
+  EXPECT_FALSE(Instance::is_valid_name("../foo"));
+  EXPECT_FALSE(Instance::is_valid_name("Foo"));
+  EXPECT_FALSE(Instance::is_valid_name(std::string(33, 'a')));
+
+  EXPECT_THROW(Instance::parse(""), std::invalid_argument);
+  EXPECT_THROW(Instance::parse("foo,foo/bar"), std::invalid_argument);
+  EXPECT_THROW(Instance::parse("foo,bar,foo"), std::invalid_argument);
+  EXPECT_EQ(2u, Instance::parse("foo,,bar,").size());
+}
+
+TEST(Instance, PathsArePerInstance) {
+  auto &config = SystemConfiguration::instance();
+  config.set_data_path("/var/lib/anbox");
+
+  EXPECT_EQ("/var/lib/anbox/rootfs", config.image_dir());
+  EXPECT_EQ("/var/lib/anbox/rootfs", config.rootfs_dir("default"));
+  EXPECT_EQ("/var/lib/anbox/instances/foo/rootfs", config.rootfs_dir("foo"));
+  EXPECT_EQ("/var/lib/anbox/instances/foo", config.instance_dir("foo").string());
+  EXPECT_EQ("/run/anbox-container.socket", config.container_socket_path("default"));
+  EXPECT_EQ("/run/anbox-container-foo.socket", config.container_socket_path("foo"));
+
+  ::setenv("XDG_RUNTIME_DIR", "/run/user/1000", 1);
+  EXPECT_EQ("/run/user/1000/anbox/sockets", config.socket_dir());
+  config.set_instance_name("foo");
+  EXPECT_EQ("/var/lib/anbox/instances/foo/rootfs", config.rootfs_dir());
+  EXPECT_EQ("/run/user/1000/anbox/foo/sockets", config.socket_dir());
+  EXPECT_EQ("/run/user/1000/anbox/foo/input", config.input_device_dir());
+  config.set_instance_name(SystemConfiguration::default_instance);
+}
+}  // namespace container
+}  // namespace anbox
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "anbox/container/container.h"
+#include "anbox/container/management_api_skeleton.h"
+
+#include "anbox_container.pb.h"
+#include "anbox_rpc.pb.h"
+
+#include <google/protobuf/stubs/callback.h>
+
+#include <stdexcept>
+
+namespace {
+class FakeContainer : public anbox::container::Container {
+ public:
+  void start(const anbox::container::Configuration &) override {
+    state_ = State::running;
+  }
+
+  void stop() override {
+    stops++;
+    state_ = State::inactive;
+  }
+
+  void kill() override {
+    kills++;
+    state_ = State::inactive;
+  }
+
+  void checkpoint() override {
+    checkpoints++;
+    if (fail_checkpoint)
+      throw std::runtime_error("CRIU failed");
+    state_ = State::inactive;
+  }
+
+  bool restored() override { return restore; }
+  State state() override { return state_; }
+
+  State state_ = State::inactive;
+  bool restore = false;
+  bool fail_checkpoint = false;
+  int stops = 0;
+  int kills = 0;
+  int checkpoints = 0;
+};
+
+void nothing() {}
+}  // namespace
+
+namespace anbox {
+namespace container {
+TEST(ManagementApiSkeleton, ReportsRestoredContainers) {
+  auto container = std::make_shared<FakeContainer>();
+  container->restore = true;
+  ManagementApiSkeleton skeleton(nullptr, container);
+
+  protobuf::container::StartContainer request;
+  request.mutable_configuration();
+  protobuf::container::ContainerStarted response;
+  std::unique_ptr<google::protobuf::Closure> done(google::protobuf::NewPermanentCallback(&nothing));
+  skeleton.start_container(&request, &response, done.get());
+
+  EXPECT_FALSE(response.has_error());
+  EXPECT_TRUE(response.restored());
+}
+
+TEST(ManagementApiSkeleton, CheckpointsOnRequest) {
+  auto container = std::make_shared<FakeContainer>();
+  container->state_ = Container::State::running;
+  ManagementApiSkeleton skeleton(nullptr, container);
+
+  protobuf::container::StopContainer request;
+  request.set_checkpoint(true);
+  protobuf::rpc::Void response;
+  std::unique_ptr<google::protobuf::Closure> done(google::protobuf::NewPermanentCallback(&nothing));
+  skeleton.stop_container(&request, &response, done.get());
+
+  EXPECT_FALSE(response.has_error());
+  EXPECT_EQ(1, container->checkpoints);
+  EXPECT_EQ(0, container->stops);
+}
+
+TEST(ManagementApiSkeleton, StopsWhenCheckpointFails) {
+  auto container = std::make_shared<FakeContainer>();
+  container->state_ = Container::State::running;
+  container->fail_checkpoint = true;
+  ManagementApiSkeleton skeleton(nullptr, container);
+
+  protobuf::container::StopContainer request;
+  request.set_checkpoint(true);
+  protobuf::rpc::Void response;
+  std::unique_ptr<google::protobuf::Closure> done(google::protobuf::NewPermanentCallback(&nothing));
+  skeleton.stop_container(&request, &response, done.get());
+
+  EXPECT_FALSE(response.has_error());
+  EXPECT_EQ(1, container->checkpoints);
+  EXPECT_EQ(1, container->stops);
+  EXPECT_EQ(Container::State::inactive, container->state());
+}
+
+TEST(ManagementApiSkeleton, KillsOnForcedStop) {
+  auto container = std::make_shared<FakeContainer>();
+  container->state_ = Container::State::running;
+  ManagementApiSkeleton skeleton(nullptr, container);
+
+  protobuf::container::StopContainer request;
+  request.set_checkpoint(true);
+  request.set_force(true);
+  protobuf::rpc::Void response;
+  std::unique_ptr<google::protobuf::Closure> done(google::protobuf::NewPermanentCallback(&nothing));
+  skeleton.stop_container(&request, &response, done.get());
+
+  EXPECT_FALSE(response.has_error());
+  EXPECT_EQ(0, container->checkpoints);
+  EXPECT_EQ(0, container->stops);
+  EXPECT_EQ(1, container->kills);
+  EXPECT_EQ(Container::State::inactive, container->state());
+}
+}  // namespace container
+}  // namespace anbox
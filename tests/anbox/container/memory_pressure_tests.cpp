@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/container/memory_pressure.h"
+
+namespace anbox {
+namespace container {
+TEST(MemoryPressure, ParsesCgroupPressure) {
+  MemoryPressure pressure;
+  ASSERT_TRUE(MemoryPressure::parse(
+      "some avg10=12.50 avg60=3.00 avg300=1.00 total=123456\n"
+      "full avg10=1.25 avg60=0.50 avg300=0.10 total=2345\n",
+      pressure));
+  EXPECT_DOUBLE_EQ(12.5, pressure.some_avg10);
+  EXPECT_DOUBLE_EQ(1.25, pressure.full_avg10);
+  EXPECT_EQ(MemoryPressure::Level::low, pressure.level());
+}
+
+TEST(MemoryPressure, FullIsOptional) {
+  MemoryPressure pressure;
+  ASSERT_TRUE(MemoryPressure::parse("some avg10=0.00 avg60=0.00 avg300=0.00 total=0\n", pressure));
+  EXPECT_DOUBLE_EQ(0.0, pressure.full_avg10);
+  EXPECT_EQ(MemoryPressure::Level::none, pressure.level());
+}
+
+TEST(MemoryPressure, RejectsOtherText) {
+  MemoryPressure pressure;
+  EXPECT_FALSE(MemoryPressure::parse("", pressure));
+  EXPECT_FALSE(MemoryPressure::parse("some total=0\n", pressure));
+  EXPECT_FALSE(MemoryPressure::parse("some avg10=foo\n", pressure));
+}
+
+TEST(MemoryPressure, StallsOfAllTasksWeighMore) {
+  MemoryPressure pressure{MemoryPressure::medium_some_avg10, 0.0};
+  EXPECT_EQ(MemoryPressure::Level::medium, pressure.level());
+  pressure = MemoryPressure{1.0, MemoryPressure::medium_full_avg10};
+  EXPECT_EQ(MemoryPressure::Level::medium, pressure.level());
+  pressure = MemoryPressure{1.0, MemoryPressure::critical_full_avg10};
+  EXPECT_EQ(MemoryPressure::Level::critical, pressure.level());
+  EXPECT_EQ("critical", to_string(pressure.level()));
+}
+}  // namespace container
+}  // namespace anbox
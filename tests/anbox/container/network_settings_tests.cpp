@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "anbox/container/network_settings.h"
+
+#include <stdexcept>
+
+namespace anbox {
+namespace container {
+TEST(NetworkSettings, BridgesToAnboxBridgeByDefault) {
+  const NetworkSettings network;
+  const NetworkSettings::ConfigItems expected{
+      {"lxc.network.type", "veth"},
+      {"lxc.network.flags", "up"},
+      {"lxc.network.link", "anboxbr0"},
+  };
+  EXPECT_EQ(expected, network.lxc_config_items("anboxveth0"));
+}
+
+TEST(NetworkSettings, NamesVethPairForTuning) {
+  NetworkSettings network;
+  network.link = "br1";
+  network.gro = true;
+  network.queues = 4;
+  const NetworkSettings::ConfigItems expected{
+      {"lxc.network.type", "veth"},
+      {"lxc.network.flags", "up"},
+      {"lxc.network.link", "br1"},
+      {"lxc.network.veth.pair", "anboxveth1"},
+  };
+  EXPECT_EQ(expected, network.lxc_config_items("anboxveth1"));
+}
+
+TEST(NetworkSettings, PutsMacvlanOnLink) {
+  NetworkSettings network;
+  network.mode = NetworkSettings::parse_mode("macvlan");
+  network.link = "eno1";
+  const NetworkSettings::ConfigItems expected{
+      {"lxc.network.type", "macvlan"},
+      {"lxc.network.flags", "up"},
+      {"lxc.network.link", "eno1"},
+      {"lxc.network.macvlan.mode", "bridge"},
+      {"lxc.network.name", "eth0"},
+  };
+  EXPECT_EQ(expected, network.lxc_config_items("anboxveth0"));
+}
+
+TEST(NetworkSettings, SharesHostNamespace) {
+  NetworkSettings network;
+  network.mode = NetworkSettings::parse_mode("host");
+  const NetworkSettings::ConfigItems expected{{"lxc.network.type", "none"}};
+  EXPECT_EQ(expected, network.lxc_config_items("anboxveth0"));
+}
+
+TEST(NetworkSettings, RejectsInvalidSettings) {
+  EXPECT_THROW(NetworkSettings::parse_mode("ipvlan"), std::invalid_argument);
+
+  NetworkSettings network;
+  network.mode = NetworkSettings::Mode::macvlan;
+  EXPECT_THROW(network.validate(), std::invalid_argument);
+
+  network.link = "eno1";
+  network.gro = true;
+  EXPECT_THROW(network.validate(), std::invalid_argument);
+
+  network.mode = NetworkSettings::Mode::none;
+  network.gro = false;
+  EXPECT_THROW(network.validate(), std::invalid_argument);
+}
+}  // namespace container
+}  // namespace anbox
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/container/reattachable_container.h"
+
+namespace {
+class FakeContainer : public anbox::container::Container {
+ public:
+  void start(const anbox::container::Configuration &) override {
+    starts++;
+    state_ = State::running;
+  }
+
+  void stop() override { state_ = State::inactive; }
+  void kill() override { state_ = State::inactive; }
+  void checkpoint() override {}
+  bool restored() override { return false; }
+  State state() override { return state_; }
+
+  State state_ = State::inactive;
+  int starts = 0;
+};
+}  // namespace
+
+namespace anbox {
+namespace container {
+TEST(ReattachableContainer, ContinuesContainerLeftRunning) {
+  auto running = std::make_shared<FakeContainer>();
+  running->state_ = Container::State::running;
+
+  const auto configuration = Configuration::for_session("/run/user/1000/anbox/sockets",
+                                                        "/run/user/1000/anbox/input");
+  ReattachableContainer container(running, configuration, nullptr);
+  EXPECT_EQ(Container::State::inactive, container.state());
+
+  container.start(configuration);
+  EXPECT_EQ(0, running->starts);
+  EXPECT_EQ(Container::State::running, container.state());
+  EXPECT_TRUE(container.restored());
+}
+
+TEST(ReattachableContainer, RestartsForOtherConfiguration) {
+  auto running = std::make_shared<FakeContainer>();
+  running->state_ = Container::State::running;
+
+  ReattachableContainer container(
+      running, Configuration::for_session("/run/user/1000/anbox/sockets", "/run/user/1000/anbox/input"),
+      nullptr);
+  container.start(Configuration::for_session("/tmp/sockets", "/tmp/input"));
+  EXPECT_EQ(1, running->starts);
+  EXPECT_FALSE(container.restored());
+}
+
+TEST(ReattachableContainer, HandsOverContainerStillRunning) {
+  auto fresh = std::make_shared<FakeContainer>();
+  const auto configuration = Configuration::for_session("/tmp/sockets", "/tmp/input");
+
+  std::shared_ptr<Container> released;
+  Configuration released_configuration;
+  {
+    ReattachableContainer container(fresh, Configuration{},
+                                    [&](const std::shared_ptr<Container> &c, const Configuration &conf) {
+                                      released = c;
+                                      released_configuration = conf;
+                                    });
+    container.start(configuration);
+    EXPECT_FALSE(container.restored());
+  }
+  EXPECT_EQ(fresh, released);
+  EXPECT_EQ(configuration.bind_mounts, released_configuration.bind_mounts);
+}
+
+TEST(ReattachableContainer, HandsOverNothingOnceStopped) {
+  bool called = false;
+  std::shared_ptr<Container> released;
+  {
+    ReattachableContainer container(std::make_shared<FakeContainer>(), Configuration{},
+                                    [&](const std::shared_ptr<Container> &c, const Configuration &) {
+                                      called = true;
+                                      released = c;
+                                    });
+    container.start(Configuration::for_session("/tmp/sockets", "/tmp/input"));
+    container.stop();
+  }
+  EXPECT_TRUE(called);
+  EXPECT_EQ(nullptr, released);
+}
+}  // namespace container
+}  // namespace anbox
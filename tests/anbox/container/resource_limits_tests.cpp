@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/container/resource_limits.h"
+
+#include <stdexcept>
+
+namespace anbox {
+namespace container {
+TEST(ResourceLimits, OnlyLowersCpuWeightByDefault) {
+  const ResourceLimits limits;
+  const ResourceLimits::ConfigItems expected{{"lxc.cgroup2.cpu.weight", "50"}};
+  EXPECT_EQ(expected, limits.lxc_config_items(true));
+}
+
+TEST(ResourceLimits, UsesCgroup2Controls) {
+  ResourceLimits limits;
+  limits.cpu_max = 250;
+  limits.cpu_weight = ResourceLimits::kernel_cpu_weight;
+  limits.memory_high = 1024;
+  limits.memory_max = 2048;
+  limits.io_max = {"8:0 rbps=1048576 wiops=max"};
+
+  const ResourceLimits::ConfigItems expected{
+      {"lxc.cgroup2.cpu.max", "250000 100000"},
+      {"lxc.cgroup2.memory.high", "1024"},
+      {"lxc.cgroup2.memory.max", "2048"},
+      {"lxc.cgroup2.io.max", "8:0 rbps=1048576 wiops=max"},
+  };
+  EXPECT_EQ(expected, limits.lxc_config_items(true));
+}
+
+TEST(ResourceLimits, TranslatesToCgroup1Controls) {
+  ResourceLimits limits;
+  limits.cpu_max = 50;
+  limits.cpu_weight = 200;
+  limits.memory_high = 1024;
+  limits.memory_max = 2048;
+  limits.io_max = {"8:0 rbps=1048576 wiops=max riops=10"};
+
+  const ResourceLimits::ConfigItems expected{
+      {"lxc.cgroup.cpu.cfs_period_us", "100000"},
+      {"lxc.cgroup.cpu.cfs_quota_us", "50000"},
+      {"lxc.cgroup.cpu.shares", "2048"},
+      {"lxc.cgroup.memory.soft_limit_in_bytes", "1024"},
+      {"lxc.cgroup.memory.limit_in_bytes", "2048"},
+      {"lxc.cgroup.blkio.throttle.read_bps_device", "8:0 1048576"},
+      {"lxc.cgroup.blkio.throttle.read_iops_device", "8:0 10"},
+  };
+  EXPECT_EQ(expected, limits.lxc_config_items(false));
+}
+
+TEST(ResourceLimits, RejectsInvalidLimits) {
+  ResourceLimits limits;
+  limits.cpu_weight = 0;
+  EXPECT_THROW(limits.validate(), std::invalid_argument);
+
+  limits = ResourceLimits{};
+  limits.memory_high = 2;
+  limits.memory_max = 1;
+  EXPECT_THROW(limits.validate(), std::invalid_argument);
+
+  for (const auto &line : {"sda rbps=1", "8:0", "8:0 foo=1", "8:0 rbps=lots"}) {
+    limits = ResourceLimits{};
+    limits.io_max = {line};
+    EXPECT_THROW(limits.validate(), std::invalid_argument) << line;
+  }
+}
+}  // namespace container
+}  // namespace anbox
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/container/standby_container.h"
+
+namespace {
+class FakeContainer : public anbox::container::Container {
+ public:
+  void start(const anbox::container::Configuration &) override {
+    starts++;
+    state_ = State::running;
+  }
+
+  void stop() override { state_ = State::inactive; }
+  void kill() override { state_ = State::inactive; }
+  void checkpoint() override {}
+  bool restored() override { return false; }
+  State state() override { return state_; }
+
+  State state_ = State::inactive;
+  int starts = 0;
+};
+}  // namespace
+
+namespace anbox {
+namespace container {
+TEST(StandbyContainer, HandsOverBootedContainerAsItIs) {
+  auto booted = std::make_shared<FakeContainer>();
+  booted->state_ = Container::State::running;
+
+  const auto configuration = Configuration::for_session("/run/standby/sockets", "/run/standby/input");
+  StandbyContainer container(booted, configuration, nullptr);
+  EXPECT_EQ(Container::State::inactive, container.state());
+
+  container.start(configuration);
+  EXPECT_EQ(0, booted->starts);
+  EXPECT_EQ(Container::State::running, container.state());
+}
+
+TEST(StandbyContainer, RestartsForOtherConfiguration) {
+  auto booted = std::make_shared<FakeContainer>();
+  booted->state_ = Container::State::running;
+
+  StandbyContainer container(
+      booted, Configuration::for_session("/run/standby/sockets", "/run/standby/input"), nullptr);
+  container.start(Configuration::for_session("/run/user/1000/anbox/sockets", "/run/user/1000/anbox/input"));
+  EXPECT_EQ(1, booted->starts);
+
+  // Once handed over every start is a real one.
+  container.stop();
+  container.start(Configuration::for_session("/run/standby/sockets", "/run/standby/input"));
+  EXPECT_EQ(2, booted->starts);
+}
+
+TEST(StandbyContainer, ReleasesContainerBeforeTellingSo) {
+  auto booted = std::make_shared<FakeContainer>();
+  std::weak_ptr<FakeContainer> weak_booted = booted;
+
+  bool released = false;
+  {
+    StandbyContainer container(booted, Configuration{}, [&]() {
+      EXPECT_TRUE(weak_booted.expired());
+      released = true;
+    });
+    booted.reset();
+  }
+  EXPECT_TRUE(released);
+}
+
+TEST(Configuration, BindsSessionSocketsToDev) {
+  const auto configuration = Configuration::for_session("/tmp/sockets", "/tmp/input");
+  EXPECT_EQ("/dev/qemu_pipe", configuration.bind_mounts.at("/tmp/sockets/qemu_pipe"));
+  EXPECT_EQ("/dev/anbox_bridge", configuration.bind_mounts.at("/tmp/sockets/anbox_bridge"));
+  EXPECT_EQ("/dev/anbox_audio", configuration.bind_mounts.at("/tmp/sockets/anbox_audio"));
+  EXPECT_EQ("/dev/input", configuration.bind_mounts.at("/tmp/input"));
+  EXPECT_EQ("/dev/binder", configuration.bind_mounts.at("/dev/binder"));
+}
+}  // namespace container
+}  // namespace anbox
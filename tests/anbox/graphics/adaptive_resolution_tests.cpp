@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <gtest/gtest.h>
+
+#include "anbox/graphics/adaptive_resolution.h"
+
+#include <vector>
+
+namespace anbox {
+namespace graphics {
+namespace {
+void present_periods(AdaptiveResolution &resolution, unsigned int periods, bool late) {
+  for (std::uint64_t n = 0; n < periods * AdaptiveResolution::period_frames; n++)
+    resolution.frame_presented(late);
+}
+}  // namespace
+
+TEST(AdaptiveResolution, LowersResolutionOnlyWhenOverloadedForLong) {
+  std::vector<float> scales;
+  AdaptiveResolution resolution([&](float scale) { scales.push_back(scale); });
+
+  // A few late frames are nothing to react to.
+  for (std::uint64_t n = 0; n < 10 * AdaptiveResolution::period_frames; n++)
+    resolution.frame_presented(n % 10 == 0);
+  EXPECT_TRUE(scales.empty());
+
+  present_periods(resolution, AdaptiveResolution::overloaded_periods - 1, true);
+  EXPECT_TRUE(scales.empty());
+  present_periods(resolution, 1, true);
+  ASSERT_EQ(1u, scales.size());
+  EXPECT_FLOAT_EQ(1.0f - AdaptiveResolution::scale_step, scales.back());
+  EXPECT_FLOAT_EQ(scales.back(), resolution.scale());
+}
+
+TEST(AdaptiveResolution, StopsAtMinimumScale) {
+  AdaptiveResolution resolution(nullptr);
+  present_periods(resolution, 100, true);
+  EXPECT_FLOAT_EQ(AdaptiveResolution::min_scale, resolution.scale());
+}
+
+TEST(AdaptiveResolution, RestoresResolutionOnceLoadDrops) {
+  AdaptiveResolution resolution(nullptr);
+  present_periods(resolution, 2 * AdaptiveResolution::overloaded_periods, true);
+  EXPECT_FLOAT_EQ(1.0f - 2 * AdaptiveResolution::scale_step, resolution.scale());
+
+  present_periods(resolution, AdaptiveResolution::min_relaxed_periods, false);
+  EXPECT_FLOAT_EQ(1.0f - AdaptiveResolution::scale_step, resolution.scale());
+  present_periods(resolution, AdaptiveResolution::max_relaxed_periods, false);
+  EXPECT_FLOAT_EQ(1.0f, resolution.scale());
+}
+
+TEST(AdaptiveResolution, WaitsLongerAfterRaisingDidntHold) {
+  AdaptiveResolution resolution(nullptr);
+  present_periods(resolution, AdaptiveResolution::overloaded_periods, true);
+  present_periods(resolution, AdaptiveResolution::min_relaxed_periods, false);
+  EXPECT_FLOAT_EQ(1.0f, resolution.scale());
+
+  present_periods(resolution, AdaptiveResolution::overloaded_periods, true);
+  const auto lowered = resolution.scale();
+  present_periods(resolution, AdaptiveResolution::min_relaxed_periods, false);
+  EXPECT_FLOAT_EQ(lowered, resolution.scale());
+  present_periods(resolution, AdaptiveResolution::min_relaxed_periods, false);
+  EXPECT_FLOAT_EQ(1.0f, resolution.scale());
+}
+}  // namespace graphics
+}  // namespace anbox
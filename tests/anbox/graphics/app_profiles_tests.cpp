@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/graphics/app_profiles.h"
+
+#include <sstream>
+
+using namespace std::chrono;
+
+namespace anbox {
+namespace graphics {
+TEST(AppProfiles, PresentsThroughMailboxOnlyWhenOftenLate) {
+  AppProfiles profiles;
+  for (std::uint64_t n = 0; n < AppProfiles::min_frames; n++) {
+    profiles.frame_presented("org.anbox.smooth", milliseconds{2}, n % 10 == 0);
+    profiles.frame_presented("org.anbox.janky", milliseconds{2}, n % 2 == 0);
+  }
+  profiles.frame_presented("org.anbox.new", milliseconds{2}, true);
+
+  EXPECT_FALSE(profiles.settings_for("org.anbox.smooth").mailbox);
+  EXPECT_TRUE(profiles.settings_for("org.anbox.janky").mailbox);
+  // Too few frames to tell.
+  EXPECT_FALSE(profiles.settings_for("org.anbox.new").mailbox);
+  EXPECT_FALSE(profiles.settings_for("org.anbox.unknown").mailbox);
+}
+
+TEST(AppProfiles, IgnoresWindowsWithoutPackage) {
+  AppProfiles profiles;
+  profiles.frame_presented("", milliseconds{2}, true);
+  profiles.frame_dropped("");
+
+  std::stringstream out;
+  profiles.write(out);
+  EXPECT_EQ(std::string::npos, out.str().find('\n', out.str().find('\n') + 1));
+}
+
+TEST(AppProfiles, ReadsWhatItWrote) {
+  AppProfiles written;
+  written.frame_presented("org.anbox.foo", milliseconds{2}, true);
+  written.frame_presented("org.anbox.foo", milliseconds{3}, false);
+  written.frame_dropped("org.anbox.foo");
+
+  std::stringstream data;
+  written.write(data);
+  // Garbage from editing the file by hand is skipped.
+  data << "org.anbox.broken one two" << std::endl;
+
+  AppProfiles read;
+  read.read(data);
+  const auto profile = read.profile("org.anbox.foo");
+  EXPECT_EQ(2u, profile.presented_frames);
+  EXPECT_EQ(1u, profile.dropped_frames);
+  EXPECT_EQ(1u, profile.late_frames);
+  EXPECT_EQ(milliseconds{5}, profile.compose_time);
+  EXPECT_EQ(0u, read.profile("org.anbox.broken").presented_frames);
+}
+
+TEST(AppProfiles, HalvesProfilesWhichGrowTooLarge) {
+  AppProfiles profiles;
+  for (std::uint64_t n = 0; n < AppProfiles::max_frames; n++)
+    profiles.frame_presented("org.anbox.foo", microseconds{1}, false);
+
+  const auto profile = profiles.profile("org.anbox.foo");
+  EXPECT_EQ(AppProfiles::max_frames / 2, profile.presented_frames);
+  EXPECT_EQ(microseconds{AppProfiles::max_frames / 2}, profile.compose_time);
+}
+}  // namespace graphics
+}  // namespace anbox
@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/graphics/buffer_pool.h"
+
+namespace anbox {
+namespace graphics {
+TEST(BufferPool, ReusesBufferWithMatchingKey) {
+  BufferPool<int> pool(1024);
+
+  pool.release({10, 10, 1, 0}, 42, 100);
+
+  int buffer = 0;
+  ASSERT_TRUE(pool.acquire({10, 10, 1, 0}, buffer));
+  EXPECT_EQ(42, buffer);
+
+  // The buffer was handed out and isn't available anymore.
+  EXPECT_FALSE(pool.acquire({10, 10, 1, 0}, buffer));
+
+  const auto stats = pool.statistics();
+  EXPECT_EQ(1u, stats.hits);
+  EXPECT_EQ(1u, stats.misses);
+  EXPECT_EQ(0u, stats.buffers);
+  EXPECT_EQ(0u, stats.bytes);
+}
+
+TEST(BufferPool, DoesNotHandOutBuffersWithDifferentKey) {
+  BufferPool<int> pool(1024);
+
+  pool.release({10, 10, 1, 0}, 42, 100);
+
+  int buffer = 0;
+  EXPECT_FALSE(pool.acquire({10, 20, 1, 0}, buffer));
+  EXPECT_FALSE(pool.acquire({20, 10, 1, 0}, buffer));
+  EXPECT_FALSE(pool.acquire({10, 10, 2, 0}, buffer));
+  EXPECT_FALSE(pool.acquire({10, 10, 1, 1}, buffer));
+  EXPECT_EQ(0, buffer);
+
+  EXPECT_EQ(4u, pool.statistics().misses);
+  EXPECT_EQ(1u, pool.statistics().buffers);
+}
+
+TEST(BufferPool, EvictsLeastRecentlyReleasedBuffersAboveCap) {
+  BufferPool<int> pool(250);
+
+  pool.release({10, 10, 1, 0}, 1, 100);
+  pool.release({20, 20, 1, 0}, 2, 100);
+  pool.release({30, 30, 1, 0}, 3, 100);
+
+  const auto stats = pool.statistics();
+  EXPECT_EQ(1u, stats.evictions);
+  EXPECT_EQ(2u, stats.buffers);
+  EXPECT_EQ(200u, stats.bytes);
+
+  int buffer = 0;
+  EXPECT_FALSE(pool.acquire({10, 10, 1, 0}, buffer));
+  ASSERT_TRUE(pool.acquire({20, 20, 1, 0}, buffer));
+  EXPECT_EQ(2, buffer);
+  ASSERT_TRUE(pool.acquire({30, 30, 1, 0}, buffer));
+  EXPECT_EQ(3, buffer);
+}
+
+TEST(BufferPool, EvictsCorrectBufferAmongSameKey) {
+  BufferPool<int> pool(250);
+
+  pool.release({10, 10, 1, 0}, 1, 100);
+  pool.release({10, 10, 1, 0}, 2, 100);
+  pool.release({10, 10, 1, 0}, 3, 100);
+
+  int first = 0, second = 0, third = 0;
+  ASSERT_TRUE(pool.acquire({10, 10, 1, 0}, first));
+  ASSERT_TRUE(pool.acquire({10, 10, 1, 0}, second));
+  EXPECT_FALSE(pool.acquire({10, 10, 1, 0}, third));
+
+  // The oldest buffer is gone, the two remaining ones are handed out.
+  EXPECT_NE(1, first);
+  EXPECT_NE(1, second);
+  EXPECT_NE(first, second);
+}
+
+TEST(BufferPool, IgnoresBuffersLargerThanCap) {
+  BufferPool<int> pool(100);
+
+  pool.release({10, 10, 1, 0}, 1, 200);
+
+  EXPECT_EQ(0u, pool.statistics().buffers);
+  EXPECT_EQ(0u, pool.statistics().evictions);
+}
+
+TEST(BufferPool, ClearDropsAllBuffers) {
+  BufferPool<int> pool(1024);
+
+  pool.release({10, 10, 1, 0}, 1, 100);
+  pool.release({20, 20, 1, 0}, 2, 100);
+  pool.clear();
+
+  int buffer = 0;
+  EXPECT_FALSE(pool.acquire({10, 10, 1, 0}, buffer));
+  EXPECT_EQ(0u, pool.statistics().buffers);
+  EXPECT_EQ(0u, pool.statistics().bytes);
+}
+
+TEST(BufferPool, EvictsOldestBuffersOnRequest) {
+  BufferPool<int> pool(1024);
+
+  pool.release({10, 10, 1, 0}, 1, 100);
+  pool.release({20, 20, 1, 0}, 2, 100);
+  pool.release({30, 30, 1, 0}, 3, 100);
+  pool.evict(150);
+
+  const auto stats = pool.statistics();
+  EXPECT_EQ(2u, stats.evictions);
+  EXPECT_EQ(1u, stats.buffers);
+
+  int buffer = 0;
+  ASSERT_TRUE(pool.acquire({30, 30, 1, 0}, buffer));
+  EXPECT_EQ(3, buffer);
+
+  // Asking for more than there is just empties the pool.
+  pool.release({10, 10, 1, 0}, 1, 100);
+  pool.evict(1000);
+  EXPECT_EQ(0u, pool.statistics().buffers);
+}
+}  // namespace graphics
+}  // namespace anbox
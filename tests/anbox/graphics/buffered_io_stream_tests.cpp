@@ -18,6 +18,7 @@
 #include "anbox/graphics/buffered_io_stream.h"
 
 #include <chrono>
+#include <future>
 
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
@@ -43,6 +44,16 @@ class MockSocketMessenger :
   MOCK_METHOD1(receive_msg, boost::system::error_code(boost::asio::mutable_buffers_1 const&));
   MOCK_METHOD0(available_bytes, size_t());
 };
+
+class MockVectoredSocketMessenger : public MockSocketMessenger {
+ public:
+  MOCK_METHOD2(send_raw_vectored, ssize_t(const struct iovec*, size_t));
+};
+
+class MockWaitingSocketMessenger : public MockSocketMessenger {
+ public:
+  MOCK_METHOD1(wait_writable, bool(const std::chrono::milliseconds&));
+};
 }
 
 namespace anbox {
@@ -93,6 +104,78 @@ TEST(BufferedIOStream, WriterContinuesWhenSocketIsBusy) {
   ASSERT_EQ(stream.commitBuffer(buffer_size), buffer_size);
 }
 
+TEST(BufferedIOStream, WriterWaitsForBusySocket) {
+  auto messenger = std::make_shared<MockWaitingSocketMessenger>();
+  BufferedIOStream stream(messenger);
+
+  const size_t buffer_size{1000};
+  InSequence seq;
+  EXPECT_CALL(*messenger, send_raw(_, buffer_size))
+      .WillOnce(DoAll(Invoke([](char const*, size_t) { errno = EAGAIN; }), Return(-1)));
+  EXPECT_CALL(*messenger, wait_writable(_))
+      .WillOnce(Return(true));
+  EXPECT_CALL(*messenger, send_raw(_, buffer_size))
+      .WillOnce(Return(buffer_size));
+
+  ASSERT_NE(nullptr, stream.allocBuffer(buffer_size));
+  ASSERT_EQ(buffer_size, stream.commitBuffer(buffer_size));
+}
+
+TEST(BufferedIOStream, StoppedWriterGivesUpOnStuckSocket) {
+  auto messenger = std::make_shared<MockWaitingSocketMessenger>();
+  std::promise<void> waiting;
+  auto is_waiting = waiting.get_future();
+
+  EXPECT_CALL(*messenger, send_raw(_, _))
+      .WillRepeatedly(DoAll(Invoke([](char const*, size_t) { errno = EAGAIN; }), Return(-1)));
+  EXPECT_CALL(*messenger, wait_writable(_))
+      .WillOnce(DoAll(Invoke([&](const std::chrono::milliseconds&) { waiting.set_value(); }),
+                      Return(false)))
+      .WillRepeatedly(Return(false));
+
+  // Destroying the stream stops and joins the writer which must not wait
+  // forever for a guest which doesn't read anymore.
+  {
+    BufferedIOStream stream(messenger);
+    ASSERT_NE(nullptr, stream.allocBuffer(100));
+    ASSERT_EQ(100u, stream.commitBuffer(100));
+    is_waiting.wait();
+  }
+}
+
+TEST(BufferedIOStream, WriterBatchesQueuedBuffers) {
+  auto messenger = std::make_shared<MockVectoredSocketMessenger>();
+  BufferedIOStream stream(messenger);
+
+  const size_t buffer_size{100};
+  std::promise<void> writing, all_queued;
+  auto is_writing = writing.get_future();
+  auto queued = all_queued.get_future();
+
+  // The first write blocks until we have queued up two more buffers
+  // which the writer has to submit together with its next write.
+  EXPECT_CALL(*messenger, send_raw_vectored(_, 1))
+      .Times(1)
+      .WillOnce(Invoke([&](const struct iovec*, size_t) -> ssize_t {
+        writing.set_value();
+        queued.wait();
+        return buffer_size;
+      }));
+  EXPECT_CALL(*messenger, send_raw_vectored(_, 2))
+      .Times(1)
+      .WillOnce(Return(2 * buffer_size));
+
+  ASSERT_NE(nullptr, stream.allocBuffer(buffer_size));
+  ASSERT_EQ(buffer_size, stream.commitBuffer(buffer_size));
+  is_writing.wait();
+
+  for (int n = 0; n < 2; n++) {
+    ASSERT_NE(nullptr, stream.allocBuffer(buffer_size));
+    ASSERT_EQ(buffer_size, stream.commitBuffer(buffer_size));
+  }
+  all_queued.set_value();
+}
+
 TEST(BufferedIOStream, ReadWhenEnoughDataAvailable) {
   auto messenger = std::make_shared<MockSocketMessenger>();
   BufferedIOStream stream(messenger);
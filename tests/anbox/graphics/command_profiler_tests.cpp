@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/graphics/command_profiler.h"
+
+#include <sstream>
+
+using namespace std::chrono;
+
+namespace {
+const char *gles_name(std::uint32_t opcode) {
+  switch (opcode) {
+    case 100: return "glClear";
+    case 101: return "glDrawArrays";
+    default: return nullptr;
+  }
+}
+
+std::vector<anbox::graphics::CommandProfiler::OpcodeRange> test_ranges() {
+  return {{"gles", 100, 103, gles_name}, {"rc", 500, 502, nullptr}};
+}
+}  // namespace
+
+namespace anbox {
+namespace graphics {
+TEST(CommandProfiler, BucketsAreLog2OfDuration) {
+  EXPECT_EQ(0u, CommandProfiler::bucket_for_duration(0));
+  EXPECT_EQ(0u, CommandProfiler::bucket_for_duration(1));
+  EXPECT_EQ(1u, CommandProfiler::bucket_for_duration(2));
+  EXPECT_EQ(1u, CommandProfiler::bucket_for_duration(3));
+  EXPECT_EQ(10u, CommandProfiler::bucket_for_duration(1024));
+  EXPECT_EQ(CommandProfiler::num_buckets - 1,
+            CommandProfiler::bucket_for_duration(~std::uint64_t{0}));
+}
+
+TEST(CommandProfiler, MergesThreadsPerOpcode) {
+  CommandProfiler profiler(test_ranges());
+  auto first = profiler.register_thread();
+  auto second = profiler.register_thread();
+
+  const CommandProfiler::Clock::time_point start;
+  first->record(101, 64, start, start + microseconds{10});
+  second->record(101, 32, start, start + microseconds{30});
+  first->record(100, 8, start, start + microseconds{1});
+  // Not covered by any range.
+  first->record(42, 8, start, start + seconds{1});
+
+  const auto summary = profiler.summary();
+  ASSERT_EQ(2u, summary.size());
+
+  EXPECT_EQ("glDrawArrays", summary[0].name);
+  EXPECT_EQ("gles", summary[0].category);
+  EXPECT_EQ(2u, summary[0].count);
+  EXPECT_EQ(96u, summary[0].bytes);
+  EXPECT_EQ(microseconds{40}, summary[0].total);
+  EXPECT_EQ(microseconds{30}, summary[0].max);
+  EXPECT_LE(summary[0].p50, summary[0].p99);
+  EXPECT_LE(summary[0].p99, summary[0].max);
+
+  EXPECT_EQ("glClear", summary[1].name);
+  EXPECT_EQ(1u, summary[1].count);
+}
+
+TEST(CommandProfiler, PercentilesFollowTheHistogram) {
+  CommandProfiler profiler(test_ranges());
+  auto recorder = profiler.register_thread();
+
+  const CommandProfiler::Clock::time_point start;
+  for (int n = 0; n < 99; n++)
+    recorder->record(100, 8, start, start + nanoseconds{100});
+  recorder->record(100, 8, start, start + milliseconds{5});
+
+  const auto summary = profiler.summary();
+  ASSERT_EQ(1u, summary.size());
+  // 100ns falls into [64, 127].
+  EXPECT_EQ(nanoseconds{127}, summary[0].p50);
+  EXPECT_EQ(nanoseconds{127}, summary[0].p99);
+  EXPECT_EQ(milliseconds{5}, summary[0].max);
+}
+
+TEST(CommandProfiler, UnnamedOpcodesUseTheirCategory) {
+  CommandProfiler profiler(test_ranges());
+  auto recorder = profiler.register_thread();
+
+  const CommandProfiler::Clock::time_point start;
+  recorder->record(501, 8, start, start + nanoseconds{10});
+  recorder->record(102, 8, start, start + nanoseconds{5});
+
+  const auto summary = profiler.summary();
+  ASSERT_EQ(2u, summary.size());
+  EXPECT_EQ("rc#501", summary[0].name);
+  EXPECT_EQ("gles#102", summary[1].name);
+}
+
+TEST(CommandProfiler, StatisticsOutliveTheirThread) {
+  CommandProfiler profiler(test_ranges());
+  {
+    auto recorder = profiler.register_thread();
+    const CommandProfiler::Clock::time_point start;
+    recorder->record(100, 8, start, start + nanoseconds{10});
+  }
+  ASSERT_EQ(1u, profiler.summary().size());
+
+  // Only a bounded number of retired recorders is kept.
+  for (std::size_t n = 0; n < CommandProfiler::max_retired_recorders + 1; n++)
+    profiler.register_thread();
+  EXPECT_TRUE(profiler.summary().empty());
+}
+
+TEST(CommandProfiler, ChromeTraceKeepsMostRecentCommands) {
+  CommandProfiler profiler(test_ranges(), 2);
+  auto recorder = profiler.register_thread();
+
+  const auto start = CommandProfiler::Clock::now();
+  recorder->record(100, 8, start, start + nanoseconds{1500});
+  recorder->record(101, 16, start, start + nanoseconds{2500});
+  recorder->record(101, 24, start, start + nanoseconds{3500});
+
+  std::stringstream trace;
+  profiler.write_chrome_trace(trace);
+  const auto json = trace.str();
+
+  EXPECT_EQ(0u, json.find("{\"traceEvents\":["));
+  EXPECT_NE(std::string::npos, json.find("\"ph\":\"M\""));
+  EXPECT_EQ(std::string::npos, json.find("\"name\":\"glClear\""));
+  EXPECT_NE(std::string::npos, json.find("\"dur\":2.500"));
+  EXPECT_NE(std::string::npos, json.find("\"dur\":3.500"));
+  EXPECT_NE(std::string::npos, json.find("\"args\":{\"opcode\":101,\"bytes\":24}"));
+}
+}  // namespace graphics
+}  // namespace anbox
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <gtest/gtest.h>
+
+#include "anbox/graphics/frame_exporter.h"
+
+#include <boost/asio.hpp>
+
+#include <cstring>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+typedef boost::asio::local::stream_protocol::socket Socket;
+
+struct Client {
+  explicit Client(boost::asio::io_service &service)
+      : local(service), remote(std::make_shared<Socket>(service)) {
+    boost::asio::local::connect_pair(local, *remote);
+  }
+  Socket local;
+  // The end handed to the exporter.
+  std::shared_ptr<Socket> remote;
+};
+
+// Reads the next message and the file descriptor sent along with it, if any.
+bool receive(Socket &socket, anbox::graphics::FrameExporter::Message &message, int &fd) {
+  struct iovec iov;
+  iov.iov_base = &message;
+  iov.iov_len = sizeof(message);
+
+  char control[CMSG_SPACE(sizeof(int))];
+  struct msghdr header;
+  std::memset(&header, 0, sizeof(header));
+  header.msg_iov = &iov;
+  header.msg_iovlen = 1;
+  header.msg_control = control;
+  header.msg_controllen = sizeof(control);
+
+  if (::recvmsg(socket.native_handle(), &header, MSG_DONTWAIT) != sizeof(message))
+    return false;
+
+  fd = -1;
+  auto cmsg = CMSG_FIRSTHDR(&header);
+  if (cmsg && cmsg->cmsg_type == SCM_RIGHTS)
+    std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+  return true;
+}
+
+anbox::graphics::FrameExporter::Buffer make_buffer() {
+  int fds[2];
+  if (::pipe(fds) != 0)
+    return anbox::graphics::FrameExporter::Buffer{};
+  ::close(fds[1]);
+  return anbox::graphics::FrameExporter::Buffer{anbox::Fd{fds[0]}, 640, 480, 0x34324241, 2560, 0, 0};
+}
+}  // namespace
+
+namespace anbox {
+namespace graphics {
+TEST(FrameExporter, SendsBuffersAndFrames) {
+  boost::asio::io_service service;
+  Client client(service);
+
+  FrameExporter exporter;
+  exporter.create_connection_for(client.remote);
+  exporter.add_buffer(1, 0, make_buffer());
+  exporter.frame_ready(1, 0, 320, 200, std::chrono::steady_clock::time_point{std::chrono::seconds{1}});
+
+  FrameExporter::Message message;
+  int fd = -1;
+  ASSERT_TRUE(receive(client.local, message, fd));
+  EXPECT_EQ(FrameExporter::MessageType::Buffer, message.type);
+  EXPECT_EQ(1u, message.window);
+  EXPECT_EQ(640u, message.width);
+  EXPECT_EQ(2560u, message.stride);
+  EXPECT_EQ(0x34324241u, message.format);
+  EXPECT_NE(-1, fd);
+  ::close(fd);
+
+  ASSERT_TRUE(receive(client.local, message, fd));
+  EXPECT_EQ(FrameExporter::MessageType::Frame, message.type);
+  EXPECT_EQ(0u, message.buffer);
+  EXPECT_EQ(320u, message.width);
+  EXPECT_EQ(200u, message.height);
+  EXPECT_EQ(1000000000u, message.timestamp_ns);
+  EXPECT_EQ(-1, fd);
+
+  EXPECT_EQ(1u, exporter.statistics().frames_sent);
+}
+
+TEST(FrameExporter, LateClientsGetExistingBuffers) {
+  boost::asio::io_service service;
+  Client client(service);
+
+  FrameExporter exporter;
+  exporter.add_buffer(1, 0, make_buffer());
+  exporter.add_buffer(1, 1, make_buffer());
+  exporter.add_buffer(2, 0, make_buffer());
+  exporter.remove_window(2);
+  exporter.create_connection_for(client.remote);
+
+  FrameExporter::Message message;
+  int fd = -1;
+  for (std::uint32_t n = 0; n < 2; n++) {
+    ASSERT_TRUE(receive(client.local, message, fd));
+    EXPECT_EQ(FrameExporter::MessageType::Buffer, message.type);
+    EXPECT_EQ(1u, message.window);
+    EXPECT_EQ(n, message.buffer);
+    EXPECT_NE(-1, fd);
+    ::close(fd);
+  }
+  EXPECT_FALSE(receive(client.local, message, fd));
+}
+
+TEST(FrameExporter, DropsFramesForSlowClients) {
+  boost::asio::io_service service;
+  Client client(service);
+
+  FrameExporter exporter;
+  exporter.create_connection_for(client.remote);
+  exporter.add_buffer(1, 0, make_buffer());
+
+  // Nobody reads so the socket fills up at some point.
+  const std::size_t frames = 100000;
+  for (std::size_t n = 0; n < frames; n++)
+    exporter.frame_ready(1, 0, 640, 480, std::chrono::steady_clock::now());
+
+  const auto stats = exporter.statistics();
+  EXPECT_GT(stats.frames_dropped, 0u);
+  EXPECT_EQ(frames, stats.frames_sent + stats.frames_dropped);
+}
+
+TEST(FrameExporter, ForgetsDisconnectedClients) {
+  boost::asio::io_service service;
+  FrameExporter exporter;
+  {
+    Client client(service);
+    exporter.create_connection_for(client.remote);
+    client.local.close();
+    exporter.add_buffer(1, 0, make_buffer());
+  }
+
+  exporter.frame_ready(1, 0, 640, 480, std::chrono::steady_clock::now());
+  const auto stats = exporter.statistics();
+  EXPECT_EQ(0u, stats.frames_sent);
+  EXPECT_EQ(0u, stats.frames_dropped);
+}
+}  // namespace graphics
+}  // namespace anbox
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/graphics/frame_statistics.h"
+
+#include <sstream>
+
+using namespace std::chrono;
+
+namespace {
+const milliseconds refresh_period{16};
+
+anbox::graphics::FrameStatistics::Timestamps frame_at(
+    const anbox::graphics::FrameStatistics::Clock::time_point &submitted,
+    const milliseconds &transfer, const milliseconds &queued,
+    const milliseconds &compose) {
+  anbox::graphics::FrameStatistics::Timestamps t;
+  t.submitted = submitted;
+  t.decoded = t.submitted + transfer;
+  t.compose_started = t.decoded + queued;
+  t.presented = t.compose_started + compose;
+  return t;
+}
+}  // namespace
+
+namespace anbox {
+namespace graphics {
+TEST(FrameStatistics, BreaksLatencyDownIntoStages) {
+  FrameStatistics stats(refresh_period);
+
+  const FrameStatistics::Clock::time_point start;
+  stats.frame_presented("foo", frame_at(start, milliseconds{1}, milliseconds{2}, milliseconds{3}));
+
+  const auto summary = stats.summary();
+  ASSERT_EQ(1u, summary.size());
+  EXPECT_EQ("foo", summary[0].window);
+  EXPECT_EQ(1u, summary[0].presented_frames);
+  EXPECT_EQ(milliseconds{1}, summary[0].transfer.p50);
+  EXPECT_EQ(milliseconds{2}, summary[0].queued.p50);
+  EXPECT_EQ(milliseconds{3}, summary[0].compose.p50);
+  EXPECT_EQ(milliseconds{6}, summary[0].latency.p99);
+  // Frame times need two frames.
+  EXPECT_EQ(nanoseconds{0}, summary[0].frame_time.max);
+}
+
+TEST(FrameStatistics, PercentilesOfFrameTimes) {
+  FrameStatistics stats(refresh_period);
+
+  FrameStatistics::Clock::time_point submitted;
+  for (int n = 0; n < 101; n++) {
+    // Every tenth frame takes twice as long as the others.
+    submitted += (n % 10 == 0) ? 2 * refresh_period : refresh_period;
+    stats.frame_presented("foo", frame_at(submitted, milliseconds{0}, milliseconds{0}, milliseconds{1}));
+  }
+
+  const auto summary = stats.summary();
+  ASSERT_EQ(1u, summary.size());
+  EXPECT_EQ(refresh_period, summary[0].frame_time.p50);
+  EXPECT_EQ(refresh_period, summary[0].frame_time.p90);
+  EXPECT_EQ(2 * refresh_period, summary[0].frame_time.p99);
+  EXPECT_EQ(2 * refresh_period, summary[0].frame_time.max);
+}
+
+TEST(FrameStatistics, CountsDroppedAndLateFrames) {
+  FrameStatistics stats(refresh_period);
+
+  const FrameStatistics::Clock::time_point start;
+  stats.frame_dropped("foo");
+  stats.frame_presented("foo", frame_at(start, milliseconds{0}, milliseconds{5}, milliseconds{10}));
+  // Waited for more than two refresh cycles after it was decoded.
+  stats.frame_presented("foo", frame_at(start + milliseconds{20}, milliseconds{0},
+                                        milliseconds{30}, milliseconds{10}));
+  stats.frame_presented("bar", frame_at(start, milliseconds{1}, milliseconds{1}, milliseconds{1}));
+
+  const auto summary = stats.summary();
+  ASSERT_EQ(2u, summary.size());
+  EXPECT_EQ("bar", summary[0].window);
+  EXPECT_EQ(0u, summary[0].late_frames);
+  EXPECT_EQ(0u, summary[0].dropped_frames);
+  EXPECT_EQ("foo", summary[1].window);
+  EXPECT_EQ(2u, summary[1].presented_frames);
+  EXPECT_EQ(1u, summary[1].dropped_frames);
+  EXPECT_EQ(1u, summary[1].late_frames);
+
+  stats.remove("foo");
+  EXPECT_EQ(1u, stats.summary().size());
+}
+
+TEST(FrameStatistics, KeepsOnlyRecentSamples) {
+  FrameStatistics stats(refresh_period);
+
+  FrameStatistics::Clock::time_point submitted;
+  stats.frame_presented("foo", frame_at(submitted, seconds{1}, milliseconds{0}, milliseconds{0}));
+  for (std::size_t n = 0; n < FrameStatistics::max_samples; n++) {
+    submitted += refresh_period;
+    stats.frame_presented("foo", frame_at(submitted, milliseconds{1}, milliseconds{0}, milliseconds{0}));
+  }
+
+  EXPECT_EQ(milliseconds{1}, stats.summary()[0].transfer.max);
+}
+
+TEST(FrameStatistics, RejectsGuestTimesFromOtherClocks) {
+  const auto now = FrameStatistics::Clock::now();
+  const auto now_ns = duration_cast<nanoseconds>(now.time_since_epoch()).count();
+  const auto earlier = now - milliseconds{3};
+
+  EXPECT_EQ(earlier, FrameStatistics::guest_time(
+                         duration_cast<nanoseconds>(earlier.time_since_epoch()).count(), now));
+  EXPECT_EQ(now, FrameStatistics::guest_time(0, now));
+  EXPECT_EQ(now, FrameStatistics::guest_time(now_ns + 1000000, now));
+  EXPECT_EQ(now, FrameStatistics::guest_time(~std::uint64_t{0}, now));
+}
+
+TEST(FrameStatistics, WritesPrometheusTextFormat) {
+  FrameStatistics stats(refresh_period);
+
+  const FrameStatistics::Clock::time_point start;
+  stats.frame_dropped("org.anbox.\"quoted\"");
+  stats.frame_presented("org.anbox.foo", frame_at(start, milliseconds{1}, milliseconds{2}, milliseconds{3}));
+
+  std::stringstream out;
+  stats.write_prometheus(out);
+  const auto text = out.str();
+
+  EXPECT_NE(std::string::npos, text.find("# TYPE anbox_frames_presented_total counter\n"));
+  EXPECT_NE(std::string::npos, text.find("anbox_frames_presented_total{window=\"org.anbox.foo\"} 1\n"));
+  EXPECT_NE(std::string::npos, text.find("anbox_frames_dropped_total{window=\"org.anbox.\\\"quoted\\\"\"} 1\n"));
+  EXPECT_NE(std::string::npos,
+            text.find("anbox_frame_latency_seconds{window=\"org.anbox.foo\",stage=\"total\",quantile=\"0.5\"} 0.006\n"));
+}
+}  // namespace graphics
+}  // namespace anbox
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/graphics/gpu_device.h"
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <stdexcept>
+
+namespace fs = boost::filesystem;
+
+namespace {
+// Lays out what sysfs shows for a GPU, without the load if |busy_percent|
+// is negative.
+class GpuDeviceTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    root_ = fs::temp_directory_path() / fs::unique_path("anbox-drm-%%%%-%%%%");
+    fs::create_directories(root_ / "drm");
+    fs::create_directories(root_ / "bus" / "pci");
+  }
+
+  void TearDown() override {
+    fs::remove_all(root_);
+  }
+
+  void add_gpu(const std::string &node, const std::string &slot, int busy_percent,
+               std::uint64_t vram_total, std::uint64_t vram_used) {
+    const auto device = root_ / "devices" / slot;
+    fs::create_directories(device);
+    fs::create_directory_symlink(root_ / "bus" / "pci", device / "subsystem");
+    fs::create_directories(root_ / "drm" / node);
+    fs::create_directory_symlink(device, root_ / "drm" / node / "device");
+    if (busy_percent < 0)
+      return;
+    std::ofstream((device / "gpu_busy_percent").string()) << busy_percent << "\n";
+    std::ofstream((device / "mem_info_vram_total").string()) << vram_total << "\n";
+    std::ofstream((device / "mem_info_vram_used").string()) << vram_used << "\n";
+  }
+
+  std::string drm_dir() const { return (root_ / "drm").string(); }
+
+  fs::path root_;
+};
+}  // namespace
+
+namespace anbox {
+namespace graphics {
+TEST_F(GpuDeviceTest, FindsRenderNodes) {
+  add_gpu("renderD129", "0000:03:00.0", 10, 8192, 1024);
+  add_gpu("renderD128", "0000:00:02.0", -1, 0, 0);
+  fs::create_directories(root_ / "drm" / "card0");
+
+  const auto devices = GpuDevice::enumerate(drm_dir());
+  ASSERT_EQ(2u, devices.size());
+  EXPECT_EQ("/dev/dri/renderD128", devices[0].render_node);
+  EXPECT_EQ("0000:00:02.0", devices[0].pci_slot);
+  EXPECT_EQ(-1, devices[0].busy_percent);
+  EXPECT_EQ("/dev/dri/renderD129", devices[1].render_node);
+  EXPECT_EQ(10, devices[1].busy_percent);
+  EXPECT_EQ(8192u, devices[1].vram_total);
+  EXPECT_EQ(1024u, devices[1].vram_used);
+  EXPECT_EQ("pci-0000_03_00_0", devices[1].dri_prime_tag());
+}
+
+TEST_F(GpuDeviceTest, SelectsLeastLoaded) {
+  add_gpu("renderD128", "0000:03:00.0", 60, 8192, 1024);
+  add_gpu("renderD129", "0000:04:00.0", 20, 8192, 6144);
+  add_gpu("renderD130", "0000:05:00.0", 20, 8192, 1024);
+  add_gpu("renderD131", "0000:06:00.0", 20, 16384, 2048);
+
+  const auto devices = GpuDevice::enumerate(drm_dir());
+  // Equally loaded, but with more VRAM to spare.
+  EXPECT_EQ("/dev/dri/renderD131", GpuDevice::select(devices, GpuDevice::auto_select).render_node);
+}
+
+TEST_F(GpuDeviceTest, SelectsByNodeOrSlot) {
+  add_gpu("renderD128", "0000:03:00.0", 10, 8192, 1024);
+  add_gpu("renderD129", "0000:04:00.0", 10, 8192, 1024);
+
+  const auto devices = GpuDevice::enumerate(drm_dir());
+  EXPECT_EQ("/dev/dri/renderD129", GpuDevice::select(devices, "/dev/dri/renderD129").render_node);
+  EXPECT_EQ("/dev/dri/renderD129", GpuDevice::select(devices, "renderD129").render_node);
+  EXPECT_EQ("/dev/dri/renderD128", GpuDevice::select(devices, "0000:03:00.0").render_node);
+  EXPECT_THROW(GpuDevice::select(devices, "renderD130"), std::runtime_error);
+  EXPECT_THROW(GpuDevice::select({}, GpuDevice::auto_select), std::runtime_error);
+}
+}  // namespace graphics
+}  // namespace anbox
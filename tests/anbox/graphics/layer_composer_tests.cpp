@@ -28,6 +28,9 @@
 #include "anbox/graphics/layer_composer.h"
 #include "anbox/graphics/multi_window_composer_strategy.h"
 
+#include <future>
+#include <thread>
+
 using namespace ::testing;
 
 namespace {
@@ -35,6 +38,7 @@ class MockRenderer : public anbox::graphics::Renderer {
  public:
   MOCK_METHOD3(draw, bool(EGLNativeWindowType, const anbox::graphics::Rect&,
                           const RenderableList&));
+  MOCK_METHOD1(content_serial, std::uint64_t(const RenderableList&));
 };
 }
 
@@ -227,5 +231,468 @@ TEST(LayerComposer, PopupShouldNotCauseWindowLayerOffset) {
   composer.submit_layers(renderables);
 }
 
+TEST(LayerComposer, SkipsUnchangedFrames) {
+  auto renderer = std::make_shared<MockRenderer>();
+
+  auto platform_policy = std::make_shared<platform::DefaultPolicy>();
+  auto app_db = std::make_shared<application::Database>();
+  auto wm = std::make_shared<wm::MultiWindowManager>(platform_policy, nullptr, app_db);
+
+  auto window = wm::WindowState{
+      wm::Display::Id{1},
+      true,
+      graphics::Rect{0, 0, 1024, 768},
+      "org.anbox.foo",
+      wm::Task::Id{1},
+      wm::Stack::Id::Freeform,
+  };
+
+  wm->apply_window_state_update({window}, {});
+
+  LayerComposer composer(renderer, std::make_shared<MultiWindowComposerStrategy>(wm));
+
+  RenderableList renderables = {
+    {"org.anbox.surface.1", 0, {0, 0, 1024, 768}, {0, 0, 1024, 768}},
+  };
+
+  // The content of the buffers doesn't change between both frames so
+  // only the first one has to be drawn.
+  EXPECT_CALL(*renderer, content_serial(_))
+      .WillRepeatedly(Return(1));
+  EXPECT_CALL(*renderer, draw(_, _, _))
+      .Times(1)
+      .WillOnce(Return(true));
+
+  composer.submit_layers(renderables);
+  composer.submit_layers(renderables);
+}
+
+TEST(LayerComposer, RedrawsWhenContentChanges) {
+  auto renderer = std::make_shared<MockRenderer>();
+
+  auto platform_policy = std::make_shared<platform::DefaultPolicy>();
+  auto app_db = std::make_shared<application::Database>();
+  auto wm = std::make_shared<wm::MultiWindowManager>(platform_policy, nullptr, app_db);
+
+  auto window = wm::WindowState{
+      wm::Display::Id{1},
+      true,
+      graphics::Rect{0, 0, 1024, 768},
+      "org.anbox.foo",
+      wm::Task::Id{1},
+      wm::Stack::Id::Freeform,
+  };
+
+  wm->apply_window_state_update({window}, {});
+
+  LayerComposer composer(renderer, std::make_shared<MultiWindowComposerStrategy>(wm));
+
+  RenderableList renderables = {
+    {"org.anbox.surface.1", 0, {0, 0, 1024, 768}, {0, 0, 1024, 768}},
+  };
+
+  EXPECT_CALL(*renderer, content_serial(_))
+      .WillOnce(Return(1))
+      .WillOnce(Return(2));
+  EXPECT_CALL(*renderer, draw(_, _, _))
+      .Times(2)
+      .WillRepeatedly(Return(true));
+
+  composer.submit_layers(renderables);
+  composer.submit_layers(renderables);
+}
+
+TEST(LayerComposer, RedrawsWhenLayersChange) {
+  auto renderer = std::make_shared<MockRenderer>();
+
+  auto platform_policy = std::make_shared<platform::DefaultPolicy>();
+  auto app_db = std::make_shared<application::Database>();
+  auto wm = std::make_shared<wm::MultiWindowManager>(platform_policy, nullptr, app_db);
+
+  auto window = wm::WindowState{
+      wm::Display::Id{1},
+      true,
+      graphics::Rect{0, 0, 1024, 768},
+      "org.anbox.foo",
+      wm::Task::Id{1},
+      wm::Stack::Id::Freeform,
+  };
+
+  wm->apply_window_state_update({window}, {});
+
+  LayerComposer composer(renderer, std::make_shared<MultiWindowComposerStrategy>(wm));
+
+  RenderableList first_renderables = {
+    {"org.anbox.surface.1", 0, {0, 0, 1024, 768}, {0, 0, 1024, 768}},
+  };
+
+  // A popup appears on top of the window while the content of all
+  // buffers stays the same.
+  RenderableList second_renderables = {
+    {"org.anbox.surface.1", 0, {0, 0, 1024, 768}, {0, 0, 1024, 768}},
+    {"org.anbox.surface.1", 1, {0, 0, 100, 200}, {0, 0, 100, 200}},
+  };
+
+  EXPECT_CALL(*renderer, content_serial(_))
+      .WillRepeatedly(Return(1));
+  EXPECT_CALL(*renderer, draw(_, _, _))
+      .Times(2)
+      .WillRepeatedly(Return(true));
+
+  composer.submit_layers(first_renderables);
+  composer.submit_layers(second_renderables);
+}
+
+TEST(LayerComposer, ThreadedComposesOnCompositorThread) {
+  auto renderer = std::make_shared<MockRenderer>();
+
+  auto platform_policy = std::make_shared<platform::DefaultPolicy>();
+  auto app_db = std::make_shared<application::Database>();
+  auto wm = std::make_shared<wm::MultiWindowManager>(platform_policy, nullptr, app_db);
+
+  auto window = wm::WindowState{
+      wm::Display::Id{1},
+      true,
+      graphics::Rect{0, 0, 1024, 768},
+      "org.anbox.foo",
+      wm::Task::Id{1},
+      wm::Stack::Id::Freeform,
+  };
+
+  wm->apply_window_state_update({window}, {});
+
+  LayerComposer composer(renderer, std::make_shared<MultiWindowComposerStrategy>(wm),
+                         LayerComposer::Mode::Threaded);
+
+  RenderableList renderables = {
+    {"org.anbox.surface.1", 0, {0, 0, 1024, 768}, {0, 0, 1024, 768}},
+  };
+
+  std::promise<std::thread::id> drawn;
+  EXPECT_CALL(*renderer, draw(_, _, renderables))
+      .Times(1)
+      .WillOnce(Invoke([&](EGLNativeWindowType, const Rect&, const RenderableList&) {
+        drawn.set_value(std::this_thread::get_id());
+        return true;
+      }));
+
+  composer.submit_layers(renderables);
+
+  auto f = drawn.get_future();
+  ASSERT_EQ(std::future_status::ready, f.wait_for(std::chrono::seconds{5}));
+  EXPECT_NE(std::this_thread::get_id(), f.get());
+}
+
+TEST(LayerComposer, ThreadedPresentsOnlyLatestFrame) {
+  auto renderer = std::make_shared<MockRenderer>();
+
+  auto platform_policy = std::make_shared<platform::DefaultPolicy>();
+  auto app_db = std::make_shared<application::Database>();
+  auto wm = std::make_shared<wm::MultiWindowManager>(platform_policy, nullptr, app_db);
+
+  auto window = wm::WindowState{
+      wm::Display::Id{1},
+      true,
+      graphics::Rect{0, 0, 1024, 768},
+      "org.anbox.foo",
+      wm::Task::Id{1},
+      wm::Stack::Id::Freeform,
+  };
+
+  wm->apply_window_state_update({window}, {});
+
+  LayerComposer composer(renderer, std::make_shared<MultiWindowComposerStrategy>(wm),
+                         LayerComposer::Mode::Threaded);
+
+  RenderableList first_renderables = {
+    {"org.anbox.surface.1", 0, {0, 0, 1024, 768}, {0, 0, 1024, 768}},
+  };
+  RenderableList second_renderables = {
+    {"org.anbox.surface.1", 1, {0, 0, 1024, 768}, {0, 0, 1024, 768}},
+  };
+  RenderableList third_renderables = {
+    {"org.anbox.surface.1", 2, {0, 0, 1024, 768}, {0, 0, 1024, 768}},
+  };
+
+  // The first frame keeps the compositor busy until the guest submitted
+  // two more. Of those only the last one should make it to the screen.
+  std::promise<void> first_drawing, release_first, third_drawn;
+  auto release = release_first.get_future();
+
+  EXPECT_CALL(*renderer, draw(_, _, first_renderables))
+      .Times(1)
+      .WillOnce(Invoke([&](EGLNativeWindowType, const Rect&, const RenderableList&) {
+        first_drawing.set_value();
+        release.wait();
+        return true;
+      }));
+  EXPECT_CALL(*renderer, draw(_, _, second_renderables))
+      .Times(0);
+  EXPECT_CALL(*renderer, draw(_, _, third_renderables))
+      .Times(1)
+      .WillOnce(Invoke([&](EGLNativeWindowType, const Rect&, const RenderableList&) {
+        third_drawn.set_value();
+        return true;
+      }));
+
+  composer.submit_layers(first_renderables);
+  first_drawing.get_future().wait();
+
+  composer.submit_layers(second_renderables);
+  composer.submit_layers(third_renderables);
+  release_first.set_value();
+
+  auto f = third_drawn.get_future();
+  ASSERT_EQ(std::future_status::ready, f.wait_for(std::chrono::seconds{5}));
+}
+
+TEST(LayerComposer, RecordsFrameTimings) {
+  auto renderer = std::make_shared<MockRenderer>();
+
+  auto platform_policy = std::make_shared<platform::DefaultPolicy>();
+  auto app_db = std::make_shared<application::Database>();
+  auto wm = std::make_shared<wm::MultiWindowManager>(platform_policy, nullptr, app_db);
+
+  auto window = wm::WindowState{
+      wm::Display::Id{1},
+      true,
+      graphics::Rect{0, 0, 1024, 768},
+      "org.anbox.foo",
+      wm::Task::Id{1},
+      wm::Stack::Id::Freeform,
+  };
+
+  wm->apply_window_state_update({window}, {});
+
+  LayerComposer composer(renderer, std::make_shared<MultiWindowComposerStrategy>(wm));
+
+  RenderableList renderables = {
+    {"org.anbox.surface.1", 0, {0, 0, 1024, 768}, {0, 0, 1024, 768}},
+  };
+
+  EXPECT_CALL(*renderer, content_serial(_))
+      .WillRepeatedly(Return(0));
+  EXPECT_CALL(*renderer, draw(_, _, renderables))
+      .Times(2)
+      .WillOnce(Return(true))
+      .WillOnce(Return(false));
+
+  const auto submitted = FrameStatistics::Clock::now() - std::chrono::milliseconds{5};
+  composer.submit_layers(renderables, submitted);
+  // Frames which failed to draw are not accounted as presented.
+  composer.submit_layers(renderables);
+
+  const auto summary = composer.statistics()->summary();
+  ASSERT_EQ(1u, summary.size());
+  EXPECT_EQ("org.anbox.foo", summary[0].window);
+  EXPECT_EQ(1u, summary[0].presented_frames);
+  EXPECT_EQ(0u, summary[0].dropped_frames);
+  EXPECT_GE(summary[0].transfer.p50, std::chrono::milliseconds{5});
+  EXPECT_GE(summary[0].latency.p50, summary[0].transfer.p50);
+}
+
+TEST(LayerComposer, ThreadedCountsReplacedFramesAsDropped) {
+  auto renderer = std::make_shared<MockRenderer>();
+
+  auto platform_policy = std::make_shared<platform::DefaultPolicy>();
+  auto app_db = std::make_shared<application::Database>();
+  auto wm = std::make_shared<wm::MultiWindowManager>(platform_policy, nullptr, app_db);
+
+  auto window = wm::WindowState{
+      wm::Display::Id{1},
+      true,
+      graphics::Rect{0, 0, 1024, 768},
+      "org.anbox.foo",
+      wm::Task::Id{1},
+      wm::Stack::Id::Freeform,
+  };
+
+  wm->apply_window_state_update({window}, {});
+
+  RenderableList first_renderables = {
+    {"org.anbox.surface.1", 0, {0, 0, 1024, 768}, {0, 0, 1024, 768}},
+  };
+  RenderableList second_renderables = {
+    {"org.anbox.surface.1", 1, {0, 0, 1024, 768}, {0, 0, 1024, 768}},
+  };
+  RenderableList third_renderables = {
+    {"org.anbox.surface.1", 2, {0, 0, 1024, 768}, {0, 0, 1024, 768}},
+  };
+
+  std::promise<void> first_drawing, release_first, third_drawn;
+  auto release = release_first.get_future();
+
+  EXPECT_CALL(*renderer, draw(_, _, first_renderables))
+      .WillOnce(Invoke([&](EGLNativeWindowType, const Rect&, const RenderableList&) {
+        first_drawing.set_value();
+        release.wait();
+        return true;
+      }));
+  EXPECT_CALL(*renderer, draw(_, _, third_renderables))
+      .WillOnce(Invoke([&](EGLNativeWindowType, const Rect&, const RenderableList&) {
+        third_drawn.set_value();
+        return true;
+      }));
+
+  std::shared_ptr<FrameStatistics> statistics;
+  {
+    LayerComposer composer(renderer, std::make_shared<MultiWindowComposerStrategy>(wm),
+                           LayerComposer::Mode::Threaded);
+    statistics = composer.statistics();
+
+    composer.submit_layers(first_renderables);
+    first_drawing.get_future().wait();
+
+    composer.submit_layers(second_renderables);
+    composer.submit_layers(third_renderables);
+    release_first.set_value();
+
+    auto f = third_drawn.get_future();
+    ASSERT_EQ(std::future_status::ready, f.wait_for(std::chrono::seconds{5}));
+  }
+
+  const auto summary = statistics->summary();
+  ASSERT_EQ(1u, summary.size());
+  EXPECT_EQ(2u, summary[0].presented_frames);
+  EXPECT_EQ(1u, summary[0].dropped_frames);
+}
+
+TEST(LayerComposer, RoutesLayersAfterWindowsChange) {
+  auto renderer = std::make_shared<MockRenderer>();
+
+  auto platform_policy = std::make_shared<platform::DefaultPolicy>();
+  auto app_db = std::make_shared<application::Database>();
+  auto wm = std::make_shared<wm::MultiWindowManager>(platform_policy, nullptr, app_db);
+
+  auto window = wm::WindowState{
+      wm::Display::Id{1},
+      true,
+      graphics::Rect{0, 0, 1024, 768},
+      "org.anbox.foo",
+      wm::Task::Id{1},
+      wm::Stack::Id::Freeform,
+  };
+
+  LayerComposer composer(renderer, std::make_shared<MultiWindowComposerStrategy>(wm));
+
+  RenderableList first_renderables = {
+    {"org.anbox.surface.1", 0, {0, 0, 1024, 768}, {0, 0, 1024, 768}},
+  };
+  RenderableList second_renderables = {
+    {"org.anbox.surface.1", 1, {0, 0, 1024, 768}, {0, 0, 1024, 768}},
+  };
+  RenderableList third_renderables = {
+    {"org.anbox.surface.1", 2, {0, 0, 1024, 768}, {0, 0, 1024, 768}},
+  };
+
+  // The layer shows up before its window exists, once the window is
+  // there it has to be drawn and after removing the window not anymore.
+  EXPECT_CALL(*renderer, draw(_, _, first_renderables))
+      .Times(0);
+  EXPECT_CALL(*renderer, draw(_, _, second_renderables))
+      .Times(1)
+      .WillOnce(Return(true));
+  EXPECT_CALL(*renderer, draw(_, _, third_renderables))
+      .Times(0);
+
+  composer.submit_layers(first_renderables);
+
+  wm->apply_window_state_update({window}, {});
+  composer.submit_layers(second_renderables);
+
+  wm->apply_window_state_update({}, {window});
+  composer.submit_layers(third_renderables);
+}
+
+TEST(LayerComposer, ComposesHiddenWindowsOnceShown) {
+  auto renderer = std::make_shared<MockRenderer>();
+
+  auto platform_policy = std::make_shared<platform::DefaultPolicy>();
+  auto app_db = std::make_shared<application::Database>();
+  auto wm = std::make_shared<wm::MultiWindowManager>(platform_policy, nullptr, app_db);
+
+  auto window = wm::WindowState{
+      wm::Display::Id{1},
+      true,
+      graphics::Rect{0, 0, 1024, 768},
+      "org.anbox.foo",
+      wm::Task::Id{1},
+      wm::Stack::Id::Freeform,
+  };
+
+  wm->apply_window_state_update({window}, {});
+
+  LayerComposer composer(renderer, std::make_shared<MultiWindowComposerStrategy>(wm));
+
+  RenderableList first_renderables = {
+    {"org.anbox.surface.1", 0, {0, 0, 1024, 768}, {0, 0, 1024, 768}},
+  };
+  RenderableList second_renderables = {
+    {"org.anbox.surface.1", 1, {0, 0, 1024, 768}, {0, 0, 1024, 768}},
+  };
+  RenderableList unrelated_renderables = {
+    {"org.anbox.surface.2", 0, {0, 0, 1024, 768}, {0, 0, 1024, 768}},
+  };
+
+  // Only the latest frame submitted while the window was hidden is drawn
+  // and not before the window is shown again.
+  EXPECT_CALL(*renderer, draw(_, _, first_renderables))
+      .Times(0);
+  EXPECT_CALL(*renderer, draw(_, _, second_renderables))
+      .Times(1)
+      .WillOnce(Return(true));
+
+  wm->find_window_for_task(1)->set_visible(false);
+  composer.submit_layers(first_renderables);
+  composer.submit_layers(second_renderables);
+  composer.submit_layers(unrelated_renderables);
+
+  wm->find_window_for_task(1)->set_visible(true);
+  composer.submit_layers(unrelated_renderables);
+}
+
+TEST(LayerComposer, PacesGuestByVisibleWindows) {
+  auto renderer = std::make_shared<MockRenderer>();
+
+  auto platform_policy = std::make_shared<platform::DefaultPolicy>();
+  auto app_db = std::make_shared<application::Database>();
+  app_db->set_frame_rate_caps("org.anbox.foo", wm::FrameRateCaps{30, 10});
+  auto wm = std::make_shared<wm::MultiWindowManager>(platform_policy, nullptr, app_db);
+
+  auto window = wm::WindowState{
+      wm::Display::Id{1},
+      true,
+      graphics::Rect{0, 0, 1024, 768},
+      "org.anbox.foo",
+      wm::Task::Id{1},
+      wm::Stack::Id::Freeform,
+  };
+
+  LayerComposer composer(renderer, std::make_shared<MultiWindowComposerStrategy>(wm));
+
+  const std::chrono::nanoseconds display_period{16666667};
+  // Without windows the guest renders at the rate of the display.
+  EXPECT_EQ(display_period, composer.guest_frame_period(display_period));
+
+  wm->apply_window_state_update({window}, {});
+
+  RenderableList renderables = {
+    {"org.anbox.surface.1", 0, {0, 0, 1024, 768}, {0, 0, 1024, 768}},
+  };
+  EXPECT_CALL(*renderer, draw(_, _, _))
+      .WillRepeatedly(Return(true));
+  composer.submit_layers(renderables);
+
+  auto w = wm->find_window_for_task(1);
+  EXPECT_EQ(std::chrono::milliseconds{33}, std::chrono::duration_cast<std::chrono::milliseconds>(
+      composer.guest_frame_period(display_period)));
+
+  w->set_focused(false);
+  EXPECT_EQ(std::chrono::milliseconds{100}, composer.guest_frame_period(display_period));
+
+  w->set_visible(false);
+  EXPECT_EQ(LayerComposer::hidden_guest_frame_period, composer.guest_frame_period(display_period));
+}
+
 }  // namespace graphics
 }  // namespace anbox
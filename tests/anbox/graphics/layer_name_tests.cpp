@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/graphics/layer_name.h"
+#include "anbox/graphics/emugl/Renderable.h"
+
+#include <thread>
+#include <vector>
+
+namespace anbox {
+namespace graphics {
+TEST(LayerName, SameNamesShareStorage) {
+  const LayerName first{"org.anbox.surface.1"};
+  const LayerName second{std::string{"org.anbox.surface.1"}};
+
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(&first.str(), &second.str());
+  EXPECT_EQ("org.anbox.surface.1", first.str());
+}
+
+TEST(LayerName, DifferentNamesDiffer) {
+  const LayerName first{"org.anbox.surface.1"};
+  const LayerName second{"org.anbox.surface.2"};
+  // A prefix of an existing name is a name of its own.
+  const LayerName third{"org.anbox.surface."};
+
+  EXPECT_NE(first, second);
+  EXPECT_NE(first, third);
+  EXPECT_EQ("org.anbox.surface.2", second.str());
+  EXPECT_EQ("org.anbox.surface.", third.str());
+}
+
+TEST(LayerName, EmptyName) {
+  EXPECT_EQ(LayerName{}, LayerName{""});
+  EXPECT_TRUE(LayerName{}.str().empty());
+}
+
+TEST(LayerName, DropsNamesNoLongerUsed) {
+  const auto before = LayerName::interned();
+  {
+    const LayerName name{"org.anbox.surface.gone"};
+    auto copy = name;
+    EXPECT_EQ(before + 1, LayerName::interned());
+  }
+  EXPECT_EQ(before, LayerName::interned());
+
+  // Interning it again after it was dropped stores it anew.
+  const LayerName again{"org.anbox.surface.gone"};
+  EXPECT_EQ("org.anbox.surface.gone", again.str());
+  EXPECT_EQ(before + 1, LayerName::interned());
+}
+
+TEST(LayerName, InternsConcurrently) {
+  std::vector<std::thread> threads;
+  std::vector<LayerName> names(8);
+  for (size_t n = 0; n < names.size(); n++) {
+    threads.push_back(std::thread([&names, n]() {
+      for (int i = 0; i < 1000; i++)
+        names[n] = LayerName{"layer." + std::to_string(i)};
+    }));
+  }
+  for (auto &t : threads)
+    t.join();
+
+  for (const auto &name : names)
+    EXPECT_EQ(LayerName{"layer.999"}, name);
+}
+
+TEST(Renderable, UsesIdentityTransformationByDefault) {
+  const Renderable plain{LayerName{"a"}, 1, {0, 0, 10, 10}};
+  EXPECT_TRUE(plain.has_identity_transformation());
+
+  const Renderable scaled{LayerName{"a"}, 1, {0, 0, 10, 10}, {},
+                          glm::mat4(2.0f)};
+  EXPECT_FALSE(scaled.has_identity_transformation());
+  EXPECT_NE(plain, scaled);
+
+  // The compatibility constructor ends up with the same interned name.
+  const Renderable compat{std::string{"a"}, 1, {0, 0, 10, 10}};
+  EXPECT_EQ(plain, compat);
+  EXPECT_EQ(&plain.name(), &compat.name());
+}
+}  // namespace graphics
+}  // namespace anbox
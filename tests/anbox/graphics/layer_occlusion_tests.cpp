@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "anbox/graphics/layer_occlusion.h"
+
+namespace {
+Renderable layer(const std::string &name, const anbox::graphics::Rect &position,
+                 Renderable::Blending blending, float alpha = 1.0f) {
+  return Renderable{name, 1, position, {}, glm::mat4{}, alpha, blending};
+}
+}  // namespace
+
+namespace anbox {
+namespace graphics {
+TEST(LayerOcclusion, FullscreenOpaqueLayerHidesEverythingBelow) {
+  const RenderableList layers = {
+      layer("wallpaper", {0, 0, 1024, 768}, Renderable::Blending::None),
+      layer("launcher", {0, 0, 1024, 768}, Renderable::Blending::Premultiplied),
+      layer("app", {0, 0, 1024, 768}, Renderable::Blending::None),
+      layer("status bar", {0, 0, 1024, 24}, Renderable::Blending::Premultiplied),
+  };
+
+  std::vector<bool> visible;
+  EXPECT_EQ(2u, find_visible_layers(layers, visible));
+  EXPECT_EQ((std::vector<bool>{false, false, true, true}), visible);
+}
+
+TEST(LayerOcclusion, TranslucentLayersHideNothing) {
+  const RenderableList layers = {
+      layer("app", {0, 0, 1024, 768}, Renderable::Blending::None),
+      layer("dim", {0, 0, 1024, 768}, Renderable::Blending::Premultiplied),
+      layer("faded", {0, 0, 1024, 768}, Renderable::Blending::None, 0.5f),
+      layer("coverage", {0, 0, 1024, 768}, Renderable::Blending::Coverage),
+  };
+
+  std::vector<bool> visible;
+  EXPECT_EQ(0u, find_visible_layers(layers, visible));
+  EXPECT_EQ(std::vector<bool>(4, true), visible);
+}
+
+TEST(LayerOcclusion, OnlyFullyCoveredLayersAreHidden) {
+  const RenderableList layers = {
+      layer("inside", {10, 10, 20, 20}, Renderable::Blending::Premultiplied),
+      layer("sticks out", {90, 90, 110, 110}, Renderable::Blending::Premultiplied),
+      layer("dialog", {0, 0, 100, 100}, Renderable::Blending::None),
+  };
+
+  std::vector<bool> visible;
+  EXPECT_EQ(1u, find_visible_layers(layers, visible));
+  EXPECT_EQ((std::vector<bool>{false, true, true}), visible);
+}
+}  // namespace graphics
+}  // namespace anbox
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/graphics/memory_accounting.h"
+
+#include <sstream>
+
+namespace anbox {
+namespace graphics {
+TEST(MemoryAccounting, ChargesAllocationsToTheirOwner) {
+  MemoryAccounting accounting;
+
+  accounting.add(MemoryAccounting::Kind::ColorBuffer, 1, 10, 100);
+  accounting.add(MemoryAccounting::Kind::ColorBuffer, 2, 10, 200);
+  accounting.add(MemoryAccounting::Kind::WindowSurface, 1, 10, 50);
+  accounting.add(MemoryAccounting::Kind::ClientImage, 1, 20, 0);
+
+  const auto first = accounting.usage(10);
+  EXPECT_EQ(2u, first.color_buffers.count);
+  EXPECT_EQ(300u, first.color_buffers.bytes);
+  EXPECT_EQ(1u, first.window_surfaces.count);
+  EXPECT_EQ(350u, first.bytes());
+
+  const auto second = accounting.usage(20);
+  EXPECT_EQ(1u, second.client_images.count);
+  EXPECT_EQ(0u, second.bytes());
+
+  EXPECT_EQ(2u, accounting.usage().size());
+  EXPECT_EQ(0u, accounting.usage(30).bytes());
+}
+
+TEST(MemoryAccounting, ForgetsOwnersWithoutAllocations) {
+  MemoryAccounting accounting;
+
+  accounting.add(MemoryAccounting::Kind::ColorBuffer, 1, 10, 100);
+  accounting.add(MemoryAccounting::Kind::WindowSurface, 1, 10, 50);
+  accounting.resize(MemoryAccounting::Kind::WindowSurface, 1, 80);
+  EXPECT_EQ(180u, accounting.usage(10).bytes());
+
+  accounting.remove(MemoryAccounting::Kind::ColorBuffer, 1);
+  EXPECT_EQ(80u, accounting.usage(10).bytes());
+  accounting.remove(MemoryAccounting::Kind::WindowSurface, 1);
+  EXPECT_TRUE(accounting.usage().empty());
+
+  // Unknown allocations are ignored.
+  accounting.remove(MemoryAccounting::Kind::ColorBuffer, 1);
+  accounting.resize(MemoryAccounting::Kind::ColorBuffer, 1, 10);
+  EXPECT_TRUE(accounting.usage().empty());
+}
+
+TEST(MemoryAccounting, ReusedHandlesReplaceStaleAllocations) {
+  MemoryAccounting accounting;
+
+  accounting.add(MemoryAccounting::Kind::ColorBuffer, 1, 10, 100);
+  accounting.add(MemoryAccounting::Kind::ColorBuffer, 1, 20, 50);
+
+  EXPECT_EQ(0u, accounting.usage(10).bytes());
+  EXPECT_EQ(50u, accounting.usage(20).bytes());
+}
+
+TEST(MemoryAccounting, AdmitsAllocationsWithinQuota) {
+  MemoryAccounting accounting;
+  EXPECT_EQ(MemoryAccounting::Admission::Granted, accounting.admit(10, 1u << 30));
+
+  accounting.set_quota(MemoryAccounting::Quota{100, 200});
+  accounting.add(MemoryAccounting::Kind::ColorBuffer, 1, 10, 80);
+
+  EXPECT_EQ(MemoryAccounting::Admission::Granted, accounting.admit(10, 20));
+  EXPECT_EQ(MemoryAccounting::Admission::AboveSoftQuota, accounting.admit(10, 21));
+  EXPECT_EQ(MemoryAccounting::Admission::AboveSoftQuota, accounting.admit(10, 120));
+  EXPECT_EQ(MemoryAccounting::Admission::Denied, accounting.admit(10, 121));
+
+  // Quotas apply to each owner on its own.
+  EXPECT_EQ(MemoryAccounting::Admission::Granted, accounting.admit(20, 100));
+
+  accounting.remove(MemoryAccounting::Kind::ColorBuffer, 1);
+  EXPECT_EQ(MemoryAccounting::Admission::AboveSoftQuota, accounting.admit(10, 121));
+}
+
+TEST(MemoryAccounting, WritesPrometheusTextFormat) {
+  MemoryAccounting accounting;
+  accounting.add(MemoryAccounting::Kind::ColorBuffer, 1, 3, 100);
+
+  std::stringstream out;
+  MemoryAccounting::write_prometheus(out, accounting.usage());
+  const auto text = out.str();
+
+  EXPECT_NE(std::string::npos, text.find("# TYPE anbox_gpu_memory_bytes gauge\n"));
+  EXPECT_NE(std::string::npos,
+            text.find("anbox_gpu_memory_bytes{render_thread=\"3\",kind=\"color_buffer\"} 100\n"));
+  EXPECT_NE(std::string::npos,
+            text.find("anbox_gpu_allocations{render_thread=\"3\",kind=\"window_surface\"} 0\n"));
+}
+}  // namespace graphics
+}  // namespace anbox
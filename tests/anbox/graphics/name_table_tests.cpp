@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "GLcommon/objectNameManager.h"
+
+#include <map>
+#include <string>
+
+TEST(NameTable, FindsInsertedNames) {
+  NameTable<unsigned int> table;
+  EXPECT_EQ(nullptr, table.find(1));
+
+  table.insert(1, 10);
+  table.insert(2, 20);
+  ASSERT_NE(nullptr, table.find(1));
+  EXPECT_EQ(10u, *table.find(1));
+  ASSERT_NE(nullptr, table.find(2));
+  EXPECT_EQ(20u, *table.find(2));
+  EXPECT_EQ(nullptr, table.find(0));
+  EXPECT_EQ(nullptr, table.find(3));
+}
+
+TEST(NameTable, InsertKeepsExistingValue) {
+  NameTable<unsigned int> table;
+  EXPECT_EQ(10u, table.insert(5, 10));
+  EXPECT_EQ(10u, table.insert(5, 11));
+  EXPECT_EQ(10u, *table.find(5));
+
+  const unsigned long long large = 1ull << 40;
+  EXPECT_EQ(30u, table.insert(large, 30));
+  EXPECT_EQ(30u, table.insert(large, 31));
+  EXPECT_EQ(30u, *table.find(large));
+}
+
+TEST(NameTable, ValuesCanBeChangedThroughFind) {
+  NameTable<std::string> table;
+  table.insert(3, "a");
+  *table.find(3) = "b";
+  EXPECT_EQ("b", *table.find(3));
+}
+
+TEST(NameTable, EraseRemovesDenseAndSparseNames) {
+  NameTable<unsigned int> table;
+  const unsigned long long large = 70000;
+  table.insert(7, 1);
+  table.insert(large, 2);
+
+  table.erase(7);
+  table.erase(large);
+  EXPECT_EQ(nullptr, table.find(7));
+  EXPECT_EQ(nullptr, table.find(large));
+
+  // Unknown names are ignored.
+  table.erase(8);
+  table.erase(100000);
+  table.erase(large);
+
+  table.insert(7, 3);
+  ASSERT_NE(nullptr, table.find(7));
+  EXPECT_EQ(3u, *table.find(7));
+}
+
+TEST(NameTable, NamesAroundTheDenseLimit) {
+  NameTable<unsigned int> table;
+  table.insert(65535, 1);
+  table.insert(65536, 2);
+  table.insert(0xffffffffffffffffull, 3);
+
+  EXPECT_EQ(1u, *table.find(65535));
+  EXPECT_EQ(2u, *table.find(65536));
+  EXPECT_EQ(3u, *table.find(0xffffffffffffffffull));
+  EXPECT_EQ(nullptr, table.find(65534));
+}
+
+TEST(NameTable, ForEachVisitsAllEntries) {
+  NameTable<unsigned int> table;
+  std::map<unsigned long long, unsigned int> expected;
+  for (unsigned long long name : {1ull, 2ull, 40ull, 65536ull, 1ull << 33}) {
+    table.insert(name, name * 2);
+    expected[name] = name * 2;
+  }
+  table.erase(2);
+  expected.erase(2);
+
+  std::map<unsigned long long, unsigned int> visited;
+  EXPECT_FALSE(table.forEach([&](unsigned long long name, unsigned int value) {
+    visited[name] = value;
+    return false;
+  }));
+  EXPECT_EQ(expected, visited);
+}
+
+TEST(NameTable, ForEachStopsWhenAsked) {
+  NameTable<unsigned int> table;
+  table.insert(1, 1);
+  table.insert(2, 2);
+  table.insert(100000, 3);
+
+  size_t calls = 0;
+  EXPECT_TRUE(table.forEach([&](unsigned long long name, unsigned int) {
+    calls++;
+    return name == 2;
+  }));
+  EXPECT_EQ(2u, calls);
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "anbox/graphics/posted_layers.h"
+
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr std::uint32_t hwc_transform_rot_90{0x04};
+constexpr std::uint32_t hwc_transform_rot_180{0x03};
+constexpr std::uint32_t hwc_blending_none{0x0100};
+constexpr std::uint32_t hwc_blending_coverage{0x0405};
+
+void append_layer(std::vector<std::uint8_t> &data, const std::string &name,
+                  const anbox::graphics::PostedLayer &layer) {
+  auto record = layer;
+  record.name_size = static_cast<std::uint32_t>(name.size() + 1);
+  const auto offset = data.size();
+  data.resize(offset + sizeof(record) + ((record.name_size + 3) & ~3u), 0);
+  std::memcpy(data.data() + offset, &record, sizeof(record));
+  std::memcpy(data.data() + offset + sizeof(record), name.c_str(), record.name_size);
+}
+
+glm::vec4 transformed(const Renderable &r, float x, float y) {
+  // The renderer transforms around the center of the screen position.
+  const auto &rect = r.screen_position();
+  const auto cx = rect.left() + rect.width() / 2.0f;
+  const auto cy = rect.top() + rect.height() / 2.0f;
+  auto v = r.transformation() * glm::vec4{x - cx, y - cy, 0.0f, 1.0f};
+  return glm::vec4{v.x + cx, v.y + cy, 0.0f, 1.0f};
+}
+}  // namespace
+
+namespace anbox {
+namespace graphics {
+TEST(PostedLayers, DecodesAllLayers) {
+  std::vector<std::uint8_t> data;
+  append_layer(data, "com.android.systemui", {1, {0, 0, 100, 50}, {10, 20, 110, 70}, 0, hwc_blending_none, 255, 0});
+  append_layer(data, "Dim", {2, {0, 0, 4, 4}, {0, 0, 200, 100}, 0, hwc_blending_coverage, 51, 0});
+
+  RenderableList layers;
+  ASSERT_TRUE(decode_posted_layers(data.data(), data.size(), layers));
+  ASSERT_EQ(2u, layers.size());
+
+  EXPECT_EQ("com.android.systemui", layers[0].name());
+  EXPECT_EQ(1u, layers[0].buffer());
+  EXPECT_EQ(Rect(0, 0, 100, 50), layers[0].crop());
+  EXPECT_EQ(Rect(10, 20, 110, 70), layers[0].screen_position());
+  EXPECT_TRUE(layers[0].has_identity_transformation());
+  EXPECT_EQ(1.0f, layers[0].alpha());
+  EXPECT_EQ(Renderable::Blending::None, layers[0].blending());
+
+  EXPECT_EQ("Dim", layers[1].name());
+  EXPECT_FLOAT_EQ(0.2f, layers[1].alpha());
+  EXPECT_EQ(Renderable::Blending::Coverage, layers[1].blending());
+}
+
+TEST(PostedLayers, StopsAtBrokenRecords) {
+  std::vector<std::uint8_t> data;
+  append_layer(data, "foo", {1, {0, 0, 1, 1}, {0, 0, 1, 1}, 0, 0, 255, 0});
+  append_layer(data, "bar", {2, {0, 0, 1, 1}, {0, 0, 1, 1}, 0, 0, 255, 0});
+
+  RenderableList layers;
+  EXPECT_FALSE(decode_posted_layers(data.data(), data.size() - 1, layers));
+  ASSERT_EQ(1u, layers.size());
+  EXPECT_EQ("foo", layers[0].name());
+
+  // A name without its terminator.
+  data.back() = 'x';
+  data[data.size() - 2] = 'x';
+  data[data.size() - 3] = 'x';
+  data[data.size() - 4] = 'x';
+  layers.clear();
+  EXPECT_FALSE(decode_posted_layers(data.data(), data.size(), layers));
+  EXPECT_EQ(1u, layers.size());
+}
+
+TEST(PostedLayers, RotatedLayersEndUpInTheirDisplayFrame) {
+  std::vector<std::uint8_t> data;
+  append_layer(data, "foo", {1, {0, 0, 100, 200}, {0, 0, 200, 100}, hwc_transform_rot_90, 0, 255, 0});
+
+  RenderableList layers;
+  ASSERT_TRUE(decode_posted_layers(data.data(), data.size(), layers));
+  ASSERT_EQ(1u, layers.size());
+
+  // Drawn upright, centered on the display frame and then rotated
+  // clockwise so that its top left corner ends up top right.
+  const auto &rect = layers[0].screen_position();
+  EXPECT_EQ(Rect(50, -50, 150, 150), rect);
+  const auto corner = transformed(layers[0], rect.left(), rect.top());
+  EXPECT_NEAR(200.0f, corner.x, 0.001f);
+  EXPECT_NEAR(0.0f, corner.y, 0.001f);
+}
+
+TEST(PostedLayers, HalfTurnKeepsTheDisplayFrame) {
+  Rect rect{0, 0, 200, 100};
+  const auto transformation = transformation_for(hwc_transform_rot_180, rect);
+  EXPECT_EQ(Rect(0, 0, 200, 100), rect);
+
+  const auto v = transformation * glm::vec4{-100.0f, -50.0f, 0.0f, 1.0f};
+  EXPECT_NEAR(100.0f, v.x, 0.001f);
+  EXPECT_NEAR(50.0f, v.y, 0.001f);
+}
+}  // namespace graphics
+}  // namespace anbox
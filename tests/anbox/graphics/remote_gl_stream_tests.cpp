@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/graphics/remote_gl_stream.h"
+
+#include <zlib.h>
+
+#include <cstring>
+
+namespace {
+struct CollectingProcessor : public anbox::network::MessageProcessor {
+  bool process_data(const std::uint8_t *data, size_t size) override {
+    received.insert(received.end(), data, data + size);
+    return true;
+  }
+
+  std::string received;
+};
+
+typedef anbox::graphics::RemoteGlStream RemoteGlStream;
+
+RemoteGlStream::Token test_token() {
+  RemoteGlStream::Token token;
+  for (std::size_t n = 0; n < token.size(); n++)
+    token[n] = static_cast<std::uint8_t>(n);
+  return token;
+}
+
+RemoteGlStream::ProcessorFactory serve(const std::shared_ptr<CollectingProcessor> &processor) {
+  return [processor]() { return processor; };
+}
+
+std::string hello(RemoteGlStream::Compression compression, std::uint32_t cache_size,
+                  const RemoteGlStream::Token &token = test_token()) {
+  RemoteGlStream::Hello h{RemoteGlStream::magic, RemoteGlStream::version,
+                          static_cast<std::uint16_t>(compression), cache_size, 0, {}};
+  std::memcpy(h.token, token.data(), token.size());
+  return std::string(reinterpret_cast<const char*>(&h), sizeof(h));
+}
+
+std::string frame(RemoteGlStream::FrameType type, std::uint64_t key,
+                  const std::string &payload = std::string()) {
+  RemoteGlStream::FrameHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.type = static_cast<std::uint8_t>(type);
+  header.size = static_cast<std::uint32_t>(payload.size());
+  header.key = key;
+  return std::string(reinterpret_cast<const char*>(&header), sizeof(header)) + payload;
+}
+
+std::string deflated(const std::string &data) {
+  z_stream stream;
+  std::memset(&stream, 0, sizeof(stream));
+  deflateInit(&stream, Z_BEST_SPEED);
+  std::string out(deflateBound(&stream, data.size()) + 64, '\0');
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = data.size();
+  stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+  stream.avail_out = out.size();
+  deflate(&stream, Z_SYNC_FLUSH);
+  out.resize(out.size() - stream.avail_out);
+  deflateEnd(&stream);
+  return out;
+}
+
+bool send(RemoteGlStream &stream, const std::string &data, std::size_t chunk_size) {
+  for (std::size_t offset = 0; offset < data.size(); offset += chunk_size) {
+    const auto size = std::min(chunk_size, data.size() - offset);
+    if (!stream.process_data(reinterpret_cast<const std::uint8_t*>(data.data() + offset), size))
+      return false;
+  }
+  return true;
+}
+}  // namespace
+
+namespace anbox {
+namespace graphics {
+TEST(RemoteGlStream, PassesUncompressedFramesOn) {
+  auto processor = std::make_shared<CollectingProcessor>();
+  RemoteGlStream stream{serve(processor), "test", test_token()};
+
+  const auto data = hello(RemoteGlStream::Compression::None, 0) +
+                    frame(RemoteGlStream::FrameType::Data, 0, "glClear") +
+                    frame(RemoteGlStream::FrameType::Data, 0, "") +
+                    frame(RemoteGlStream::FrameType::Data, 0, "glFlush");
+  // Frames and the hello split across reads in every possible way.
+  ASSERT_TRUE(send(stream, data, 1));
+  EXPECT_EQ("glClearglFlush", processor->received);
+}
+
+TEST(RemoteGlStream, InflatesCompressedStreams) {
+  auto processor = std::make_shared<CollectingProcessor>();
+  RemoteGlStream stream{serve(processor), "test", test_token()};
+
+  const std::string commands(256 * 1024, 'x');
+  const auto data = hello(RemoteGlStream::Compression::Deflate, 0) +
+                    deflated(frame(RemoteGlStream::FrameType::Data, 0, commands));
+  ASSERT_TRUE(send(stream, data, 4096));
+  EXPECT_EQ(commands, processor->received);
+
+  const auto statistics = stream.statistics();
+  EXPECT_EQ(data.size(), statistics.received_bytes);
+  EXPECT_EQ(commands.size(), statistics.command_bytes);
+  EXPECT_GT(statistics.compression_ratio(), 10.0);
+}
+
+TEST(RemoteGlStream, ExpandsCachedPayloads) {
+  auto processor = std::make_shared<CollectingProcessor>();
+  RemoteGlStream stream{serve(processor), "test", test_token()};
+
+  const auto data = hello(RemoteGlStream::Compression::None, 8) +
+                    frame(RemoteGlStream::FrameType::CachePut, 1, "tex1") +
+                    frame(RemoteGlStream::FrameType::CachePut, 2, "tex2") +
+                    frame(RemoteGlStream::FrameType::CacheRef, 1) +
+                    // Evicts tex2 which was used least recently.
+                    frame(RemoteGlStream::FrameType::CachePut, 3, "tex3") +
+                    frame(RemoteGlStream::FrameType::CacheRef, 1) +
+                    frame(RemoteGlStream::FrameType::CacheRef, 3);
+  ASSERT_TRUE(send(stream, data, 5));
+  EXPECT_EQ("tex1tex2tex1tex3tex1tex3", processor->received);
+  EXPECT_EQ(3u, stream.statistics().cache_hits);
+
+  EXPECT_FALSE(send(stream, frame(RemoteGlStream::FrameType::CacheRef, 2), 64));
+}
+
+TEST(RemoteGlStream, RejectsClientsWithoutTheToken) {
+  bool created = false;
+  auto token = test_token();
+  token[7] ^= 1;
+  RemoteGlStream stream{[&created]() {
+                          created = true;
+                          return std::make_shared<CollectingProcessor>();
+                        },
+                        "test", test_token()};
+  EXPECT_FALSE(send(stream, hello(RemoteGlStream::Compression::None, 0, token) +
+                                frame(RemoteGlStream::FrameType::Data, 0, "glClear"), 64));
+  // Nobody got a render thread for it.
+  EXPECT_FALSE(created);
+}
+
+TEST(RemoteGlStream, ParsesTokens) {
+  RemoteGlStream::Token token;
+  EXPECT_TRUE(RemoteGlStream::parse_token(
+      "000102030405060708090a0b0c0d0e0f101112131415161718191A1B1C1D1E1F", token));
+  EXPECT_EQ(test_token(), token);
+
+  EXPECT_FALSE(RemoteGlStream::parse_token("0001", token));
+  EXPECT_FALSE(RemoteGlStream::parse_token(std::string(64, 'g'), token));
+}
+
+TEST(RemoteGlStream, RejectsInvalidStreams) {
+  auto processor = std::make_shared<CollectingProcessor>();
+
+  RemoteGlStream unknown_protocol{serve(processor), "test", test_token()};
+  EXPECT_FALSE(send(unknown_protocol, std::string(sizeof(RemoteGlStream::Hello), 'x'), 64));
+
+  RemoteGlStream large_cache{serve(processor), "test", test_token()};
+  EXPECT_FALSE(send(large_cache, hello(RemoteGlStream::Compression::None,
+                                       RemoteGlStream::max_cache_size + 1), 64));
+
+  RemoteGlStream oversized_put{serve(processor), "test", test_token()};
+  EXPECT_FALSE(send(oversized_put, hello(RemoteGlStream::Compression::None, 2) +
+                                       frame(RemoteGlStream::FrameType::CachePut, 1, "tex1"), 64));
+
+  RemoteGlStream garbage{serve(processor), "test", test_token()};
+  EXPECT_FALSE(send(garbage, hello(RemoteGlStream::Compression::Deflate, 0) + "garbage", 64));
+  EXPECT_TRUE(processor->received.empty());
+}
+}  // namespace graphics
+}  // namespace anbox
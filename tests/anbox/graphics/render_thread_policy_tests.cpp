@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/graphics/render_thread_policy.h"
+
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <future>
+#include <sstream>
+#include <thread>
+
+namespace {
+pid_t current_thread() { return static_cast<pid_t>(::syscall(SYS_gettid)); }
+
+anbox::graphics::RenderThreadPolicy::CpuSet parse(const std::string &str) {
+  anbox::graphics::RenderThreadPolicy::CpuSet cpus;
+  std::stringstream ss{str};
+  ss >> cpus;
+  return cpus;
+}
+
+// A render thread which stays alive until it is told to stop.
+class RenderThread {
+ public:
+  explicit RenderThread(anbox::graphics::RenderThreadPolicy &policy)
+      : thread_([&]() {
+          policy.thread_started();
+          started_.set_value(current_thread());
+          stop_.get_future().wait();
+          policy.thread_stopped();
+        }),
+        id_(started_.get_future().get()) {}
+
+  ~RenderThread() { stop(); }
+
+  pid_t id() const { return id_; }
+
+  void stop() {
+    if (!thread_.joinable())
+      return;
+    stop_.set_value();
+    thread_.join();
+  }
+
+ private:
+  std::promise<pid_t> started_;
+  std::promise<void> stop_;
+  std::thread thread_;
+  pid_t id_;
+};
+
+// Runs |f| on a render thread which started and stops again afterwards.
+template <typename F>
+void on_render_thread(anbox::graphics::RenderThreadPolicy &policy, F f) {
+  std::thread([&]() {
+    policy.thread_started();
+    f();
+    policy.thread_stopped();
+  }).join();
+}
+}  // namespace
+
+namespace anbox {
+namespace graphics {
+TEST(RenderThreadPolicy, ParsesCpuSets) {
+  const auto cpus = parse("0,2-4,7");
+  EXPECT_EQ((std::set<unsigned int>{0, 2, 3, 4, 7}), cpus.cpus());
+
+  std::stringstream out;
+  out << cpus;
+  EXPECT_EQ("0,2,3,4,7", out.str());
+
+  EXPECT_THROW(parse(""), std::runtime_error);
+  EXPECT_THROW(parse("a"), std::runtime_error);
+  EXPECT_THROW(parse("-1"), std::runtime_error);
+  EXPECT_THROW(parse("3-1"), std::runtime_error);
+  EXPECT_THROW(parse("100000"), std::runtime_error);
+}
+
+TEST(RenderThreadPolicy, FirstThreadPostingLayersIsTheCompositor) {
+  RenderThreadPolicy policy{RenderThreadPolicy::Config{}};
+  EXPECT_EQ(0, policy.compositor());
+
+  RenderThread app{policy};
+
+  pid_t compositor = 0;
+  on_render_thread(policy, [&]() {
+    compositor = current_thread();
+    EXPECT_FALSE(policy.serves_compositor());
+    policy.layers_posted();
+    EXPECT_EQ(compositor, policy.compositor());
+    EXPECT_TRUE(policy.serves_compositor());
+
+    // Nobody else can take over while it is alive.
+    std::thread([&]() {
+      policy.layers_posted();
+      EXPECT_FALSE(policy.serves_compositor());
+    }).join();
+    EXPECT_EQ(compositor, policy.compositor());
+  });
+
+  // A restarted compositor is picked up again.
+  EXPECT_EQ(0, policy.compositor());
+  on_render_thread(policy, [&]() {
+    policy.layers_posted();
+    EXPECT_EQ(current_thread(), policy.compositor());
+  });
+}
+
+TEST(RenderThreadPolicy, ClientsAreScheduledOnceTheCompositorIsKnown) {
+  errno = 0;
+  const auto nice = ::getpriority(PRIO_PROCESS, 0);
+  ASSERT_EQ(0, errno);
+  // Nothing left to lower.
+  if (nice > 17)
+    return;
+
+  RenderThreadPolicy::Config config;
+  config.clients.nice = nice + 2;
+  RenderThreadPolicy policy{config};
+
+  RenderThread early{policy};
+  EXPECT_EQ(nice, ::getpriority(PRIO_PROCESS, early.id()));
+
+  on_render_thread(policy, [&]() {
+    policy.layers_posted();
+    // Lowering the priority of the compositor again isn't our business.
+    EXPECT_EQ(nice, ::getpriority(PRIO_PROCESS, 0));
+    EXPECT_EQ(nice + 2, ::getpriority(PRIO_PROCESS, early.id()));
+
+    RenderThread late{policy};
+    EXPECT_EQ(nice + 2, ::getpriority(PRIO_PROCESS, late.id()));
+  });
+}
+
+TEST(RenderThreadPolicy, PinsThreadsToTheirCpus) {
+  cpu_set_t available;
+  ASSERT_EQ(0, ::sched_getaffinity(0, sizeof(available), &available));
+  unsigned int cpu = 0;
+  while (!CPU_ISSET(cpu, &available))
+    cpu++;
+
+  RenderThreadPolicy::Config config;
+  config.compositor.cpus.add(cpu);
+  RenderThreadPolicy policy{config};
+
+  std::thread([&]() {
+    policy.compositor_thread_started();
+
+    cpu_set_t set;
+    ASSERT_EQ(0, ::sched_getaffinity(0, sizeof(set), &set));
+    EXPECT_EQ(1, CPU_COUNT(&set));
+    EXPECT_TRUE(CPU_ISSET(cpu, &set));
+  }).join();
+}
+}  // namespace graphics
+}  // namespace anbox
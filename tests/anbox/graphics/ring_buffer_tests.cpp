@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/ring_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+namespace anbox {
+namespace graphics {
+TEST(RingBuffer, CapacityIsRoundedUpToPowerOfTwo) {
+  RingBuffer ring(1000);
+  EXPECT_EQ(1024U, ring.capacity());
+}
+
+TEST(RingBuffer, WriteAndRead) {
+  RingBuffer ring(16);
+
+  const std::uint8_t data[] = {0x1, 0x2, 0x3, 0x4};
+  EXPECT_EQ(sizeof(data), ring.write(data, sizeof(data)));
+  EXPECT_EQ(sizeof(data), ring.available());
+
+  std::uint8_t out[8] = {0};
+  EXPECT_EQ(sizeof(data), ring.read(out, sizeof(out), false));
+  EXPECT_EQ(0, memcmp(data, out, sizeof(data)));
+  EXPECT_EQ(0U, ring.available());
+  EXPECT_EQ(0U, ring.read(out, sizeof(out), false));
+}
+
+TEST(RingBuffer, PeekReturnsContiguousRegionUpToWrapAround) {
+  RingBuffer ring(8);
+
+  std::uint8_t data[6] = {0x1, 0x2, 0x3, 0x4, 0x5, 0x6};
+  ASSERT_EQ(6U, ring.write(data, 6));
+
+  std::uint8_t out[6] = {0};
+  ASSERT_EQ(6U, ring.read(out, 6, false));
+
+  // The next write wraps around the end of the ring
+  ASSERT_EQ(6U, ring.write(data, 6));
+
+  size_t size = 0;
+  auto region = ring.peek(&size);
+  ASSERT_NE(nullptr, region);
+  EXPECT_EQ(2U, size);
+  EXPECT_EQ(0x1, region[0]);
+  EXPECT_EQ(0x2, region[1]);
+  ring.consume(size);
+
+  region = ring.peek(&size);
+  ASSERT_NE(nullptr, region);
+  EXPECT_EQ(4U, size);
+  EXPECT_EQ(0x3, region[0]);
+  ring.consume(size);
+
+  EXPECT_EQ(0U, ring.available());
+}
+
+TEST(RingBuffer, ClosedRingIsDrainedBeforeFailing) {
+  RingBuffer ring(8);
+
+  const std::uint8_t data[] = {0x1, 0x2};
+  ASSERT_EQ(2U, ring.write(data, 2));
+  ring.close();
+
+  EXPECT_EQ(0U, ring.write(data, 2));
+
+  std::uint8_t out[2] = {0};
+  EXPECT_EQ(2U, ring.read(out, 2, true));
+  EXPECT_EQ(0U, ring.read(out, 2, true));
+
+  size_t size = 0;
+  EXPECT_EQ(nullptr, ring.peek(&size));
+  EXPECT_EQ(0U, size);
+}
+
+TEST(RingBuffer, CloseWakesUpBlockedReader) {
+  RingBuffer ring(8);
+
+  std::thread reader([&]() {
+    std::uint8_t out[2] = {0};
+    EXPECT_EQ(0U, ring.read(out, 2, true));
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  ring.close();
+  reader.join();
+}
+
+TEST(RingBuffer, TransfersMoreThanCapacityBetweenThreads) {
+  RingBuffer ring(64);
+
+  const size_t total = 64 * 1024;
+  std::vector<std::uint8_t> data(total);
+  for (size_t n = 0; n < total; n++)
+    data[n] = static_cast<std::uint8_t>(n % 251);
+
+  std::thread writer([&]() { EXPECT_EQ(total, ring.write(data.data(), total)); });
+
+  std::vector<std::uint8_t> received;
+  while (received.size() < total) {
+    std::uint8_t out[48];
+    const auto count = ring.read(out, sizeof(out), true);
+    ASSERT_GT(count, 0U);
+    received.insert(received.end(), out, out + count);
+  }
+
+  writer.join();
+  EXPECT_EQ(data, received);
+}
+}  // namespace graphics
+}  // namespace anbox
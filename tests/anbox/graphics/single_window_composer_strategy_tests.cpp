@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/graphics/single_window_composer_strategy.h"
+
+namespace anbox {
+namespace graphics {
+TEST(SingleWindowComposerStrategy, ScalesLayersToWindow) {
+  EXPECT_EQ((Rect{0, 0, 2560, 1440}),
+            SingleWindowComposerStrategy::scale(Rect{0, 0, 1280, 720}, 1280, 720, 2560, 1440));
+  EXPECT_EQ((Rect{100, 50, 300, 150}),
+            SingleWindowComposerStrategy::scale(Rect{200, 100, 600, 300}, 1280, 720, 640, 360));
+}
+
+TEST(SingleWindowComposerStrategy, KeepsAdjacentLayersAdjacent) {
+  const auto status_bar = SingleWindowComposerStrategy::scale(Rect{0, 0, 1024, 25}, 1024, 768, 1920, 1080);
+  const auto content = SingleWindowComposerStrategy::scale(Rect{0, 25, 1024, 768}, 1024, 768, 1920, 1080);
+  EXPECT_EQ(status_bar.bottom(), content.top());
+  EXPECT_EQ(1080, content.bottom());
+}
+}  // namespace graphics
+}  // namespace anbox
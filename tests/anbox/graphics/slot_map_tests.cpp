@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/graphics/slot_map.h"
+
+#include <memory>
+#include <set>
+
+namespace anbox {
+namespace graphics {
+TEST(SlotMap, InsertAndFind) {
+  SlotMap<int> map;
+
+  const auto first = map.insert(1);
+  const auto second = map.insert(2);
+  EXPECT_NE(0u, first);
+  EXPECT_NE(0u, second);
+  EXPECT_NE(first, second);
+
+  ASSERT_NE(nullptr, map.find(first));
+  EXPECT_EQ(1, *map.find(first));
+  ASSERT_NE(nullptr, map.find(second));
+  EXPECT_EQ(2, *map.find(second));
+  EXPECT_EQ(2u, map.size());
+}
+
+TEST(SlotMap, UnknownHandlesAreNotFound) {
+  SlotMap<int> map;
+  EXPECT_EQ(nullptr, map.find(0));
+  EXPECT_EQ(nullptr, map.find(1234));
+
+  map.insert(1);
+  EXPECT_EQ(nullptr, map.find(0));
+  EXPECT_FALSE(map.erase(0));
+}
+
+TEST(SlotMap, StaleHandleIsRejectedAfterSlotReuse) {
+  SlotMap<int> map;
+
+  const auto handle = map.insert(1);
+  EXPECT_TRUE(map.erase(handle));
+  EXPECT_EQ(nullptr, map.find(handle));
+  EXPECT_FALSE(map.erase(handle));
+
+  // Fill up all free slots so the one we released gets reused.
+  std::set<SlotMap<int>::Handle> handles;
+  for (int n = 0; n < 256; n++) handles.insert(map.insert(n));
+
+  EXPECT_EQ(0u, handles.count(handle));
+  EXPECT_EQ(nullptr, map.find(handle));
+}
+
+TEST(SlotMap, ErasingReleasesValue) {
+  SlotMap<std::shared_ptr<int>> map;
+
+  auto value = std::make_shared<int>(42);
+  const auto handle = map.insert(value);
+  EXPECT_EQ(2, value.use_count());
+
+  map.erase(handle);
+  EXPECT_EQ(1, value.use_count());
+}
+
+TEST(SlotMap, PointersStayValidWhileGrowing) {
+  SlotMap<int> map;
+
+  const auto handle = map.insert(42);
+  const auto value = map.find(handle);
+
+  for (int n = 0; n < 1024; n++) map.insert(n);
+
+  EXPECT_EQ(value, map.find(handle));
+  EXPECT_EQ(42, *value);
+}
+
+TEST(SlotMap, HandlesOfDifferentTagsDontCollide) {
+  SlotMap<int> first(1), second(2);
+
+  const auto a = first.insert(1);
+  const auto b = second.insert(2);
+  EXPECT_NE(a, b);
+  EXPECT_EQ(nullptr, first.find(b));
+  EXPECT_EQ(nullptr, second.find(a));
+  EXPECT_LT(static_cast<std::int32_t>(a), 1 << 30);
+  EXPECT_GT(static_cast<std::int32_t>(b), 0);
+}
+
+TEST(SlotMap, ClearErasesEverything) {
+  SlotMap<int> map;
+
+  const auto first = map.insert(1);
+  const auto second = map.insert(2);
+  map.clear();
+
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(nullptr, map.find(first));
+  EXPECT_EQ(nullptr, map.find(second));
+}
+
+TEST(SlotMap, InsertFailsWhenFull) {
+  SlotMap<char> map;
+
+  for (std::size_t n = 0; n < SlotMap<char>::max_size; n++)
+    ASSERT_NE(0u, map.insert('a'));
+
+  EXPECT_EQ(0u, map.insert('b'));
+}
+}  // namespace graphics
+}  // namespace anbox
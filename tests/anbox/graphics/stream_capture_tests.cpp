@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <gtest/gtest.h>
+
+#include "anbox/graphics/stream_capture.h"
+#include "anbox/graphics/stream_replayer.h"
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <thread>
+
+namespace fs = boost::filesystem;
+
+namespace {
+struct TemporaryFile {
+  TemporaryFile() : path((fs::temp_directory_path() / fs::unique_path()).string()) {}
+  ~TemporaryFile() { fs::remove(path); }
+  const std::string path;
+};
+
+std::vector<std::uint8_t> bytes(const std::string &str) {
+  return std::vector<std::uint8_t>(str.begin(), str.end());
+}
+}  // namespace
+
+namespace anbox {
+namespace graphics {
+TEST(StreamCapture, ReadsBackRecordedEvents) {
+  TemporaryFile file;
+  {
+    StreamCapture capture(file.path);
+    const auto first = capture.open_stream();
+    const auto second = capture.open_stream();
+    EXPECT_NE(first, second);
+
+    const auto data = bytes("foobar");
+    capture.data(second, data.data(), 3);
+    capture.data(first, data.data() + 3, 3);
+    capture.close_stream(first);
+  }
+
+  StreamCapture::Reader reader(file.path);
+  std::vector<StreamCapture::Event> events;
+  StreamCapture::Event event;
+  while (reader.next(event))
+    events.push_back(event);
+
+  ASSERT_EQ(5u, events.size());
+  EXPECT_EQ(StreamCapture::EventType::Opened, events[0].type);
+  EXPECT_EQ(StreamCapture::EventType::Opened, events[1].type);
+  EXPECT_EQ(StreamCapture::EventType::Data, events[2].type);
+  EXPECT_EQ(events[1].stream, events[2].stream);
+  EXPECT_EQ(bytes("foo"), events[2].data);
+  EXPECT_EQ(events[0].stream, events[3].stream);
+  EXPECT_EQ(bytes("bar"), events[3].data);
+  EXPECT_EQ(StreamCapture::EventType::Closed, events[4].type);
+  EXPECT_TRUE(events[4].data.empty());
+  EXPECT_LE(events[0].timestamp, events[4].timestamp);
+}
+
+TEST(StreamCapture, StopsAtOversizedEvents) {
+  TemporaryFile file;
+  {
+    StreamCapture capture(file.path);
+    capture.open_stream();
+  }
+  {
+    // A corrupted size must not make the reader allocate it.
+    std::ofstream out(file.path, std::ios::binary | std::ios::app);
+    const std::uint32_t stream = 1;
+    const auto type = static_cast<std::uint32_t>(StreamCapture::EventType::Data);
+    const std::uint64_t timestamp = 0;
+    const std::uint32_t size = 0xffffffff;
+    out.write(reinterpret_cast<const char*>(&stream), sizeof(stream));
+    out.write(reinterpret_cast<const char*>(&type), sizeof(type));
+    out.write(reinterpret_cast<const char*>(&timestamp), sizeof(timestamp));
+    out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+  }
+
+  StreamCapture::Reader reader(file.path);
+  StreamCapture::Event event;
+  EXPECT_TRUE(reader.next(event));
+  EXPECT_FALSE(reader.next(event));
+}
+
+TEST(StreamCapture, RejectsOtherFiles) {
+  TemporaryFile file;
+  std::ofstream(file.path) << "definitely not a capture";
+
+  EXPECT_THROW(StreamCapture::Reader{file.path}, std::runtime_error);
+  EXPECT_THROW(StreamCapture::Reader{file.path + ".missing"}, std::runtime_error);
+}
+
+TEST(StreamCapture, TruncatedEventEndsCapture) {
+  TemporaryFile file;
+  {
+    StreamCapture capture(file.path);
+    const auto stream = capture.open_stream();
+    const auto data = bytes("foobar");
+    capture.data(stream, data.data(), data.size());
+  }
+  fs::resize_file(file.path, fs::file_size(file.path) - 1);
+
+  StreamCapture::Reader reader(file.path);
+  StreamCapture::Event event;
+  EXPECT_TRUE(reader.next(event));
+  EXPECT_EQ(StreamCapture::EventType::Opened, event.type);
+  EXPECT_FALSE(reader.next(event));
+}
+
+TEST(ReplayStream, HandsFedDataToReader) {
+  ReplayStream stream;
+  std::vector<std::uint8_t> received;
+
+  std::thread reader([&]() {
+    unsigned char buf[4];
+    for (;;) {
+      size_t len = sizeof(buf);
+      if (!stream.read(buf, &len))
+        break;
+      received.insert(received.end(), buf, buf + len);
+    }
+  });
+
+  const auto data = bytes("foobarbaz");
+  stream.feed(data.data(), data.size());
+  stream.wait_until_idle();
+  EXPECT_EQ(data, received);
+
+  stream.forceStop();
+  reader.join();
+}
+
+TEST(ReplayStream, PeekedDataStaysUntilConsumed) {
+  ReplayStream stream;
+  const auto data = bytes("foobar");
+  stream.feed(data.data(), data.size());
+
+  size_t len = 0;
+  auto ptr = stream.peek(&len);
+  ASSERT_EQ(6u, len);
+  stream.consume(3);
+
+  ptr = stream.peek(&len);
+  ASSERT_EQ(3u, len);
+  EXPECT_EQ(0, std::memcmp("bar", ptr, len));
+
+  stream.forceStop();
+  stream.consume(3);
+  EXPECT_EQ(nullptr, stream.peek(&len));
+  EXPECT_EQ(0u, len);
+}
+}  // namespace graphics
+}  // namespace anbox
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/graphics/vsync_clock.h"
+
+using namespace std::chrono;
+
+namespace anbox {
+namespace graphics {
+TEST(VsyncClock, PeriodForRefreshRate) {
+  EXPECT_EQ(nanoseconds{16666666}, VsyncClock::period_for_refresh_rate(60));
+  EXPECT_EQ(nanoseconds{6944444}, VsyncClock::period_for_refresh_rate(144));
+}
+
+TEST(VsyncClock, UnknownRefreshRateFallsBackToDefault) {
+  const auto default_period = VsyncClock::period_for_refresh_rate(VsyncClock::default_refresh_rate);
+  EXPECT_EQ(default_period, VsyncClock::period_for_refresh_rate(0));
+  EXPECT_EQ(default_period, VsyncClock::period_for_refresh_rate(-1));
+}
+
+TEST(VsyncClock, NoPhaseBeforeFirstPresentation) {
+  VsyncClock clock;
+  EXPECT_EQ(nanoseconds{0}, clock.phase(VsyncClock::period_for_refresh_rate(60)));
+}
+
+TEST(VsyncClock, PhaseFollowsLastPresentation) {
+  VsyncClock clock;
+  const auto period = nanoseconds{16666666};
+
+  clock.presented(VsyncClock::Clock::time_point{period * 1000 + nanoseconds{1234}});
+  EXPECT_EQ(nanoseconds{1234}, clock.phase(period));
+
+  clock.presented(VsyncClock::Clock::time_point{period * 1001 + nanoseconds{5678}});
+  EXPECT_EQ(nanoseconds{5678}, clock.phase(period));
+}
+}  // namespace graphics
+}  // namespace anbox
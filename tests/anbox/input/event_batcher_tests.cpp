@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "anbox/input/event_batcher.h"
+
+namespace {
+bool operator==(const anbox::input::Event &a, const anbox::input::Event &b) {
+  return a.type == b.type && a.code == b.code && a.value == b.value;
+}
+
+void queue_motion(anbox::input::EventBatcher &batcher, std::int32_t x, std::int32_t dx,
+                  const anbox::input::EventBatcher::Clock::time_point &now) {
+  batcher.queue({EV_ABS, ABS_X, x}, now);
+  batcher.queue({EV_REL, REL_X, dx}, now);
+  batcher.queue({EV_SYN, SYN_REPORT, 0}, now);
+}
+anbox::input::EventBatcher::Sender record(std::vector<std::vector<anbox::input::Event>> &sent) {
+  return [&sent](const std::vector<anbox::input::Event> &events,
+                 const anbox::input::EventBatcher::Clock::time_point &) { sent.push_back(events); };
+}
+}  // namespace
+
+namespace anbox {
+namespace input {
+TEST(EventBatcher, MergesMotionFrames) {
+  std::vector<std::vector<Event>> sent;
+  EventBatcher batcher(record(sent));
+
+  const EventBatcher::Clock::time_point now;
+  queue_motion(batcher, 10, 1, now);
+  queue_motion(batcher, 12, 2, now);
+  batcher.queue({EV_REL, REL_WHEEL, 1}, now);
+  batcher.queue({EV_SYN, SYN_REPORT, 0}, now);
+  EXPECT_TRUE(sent.empty());
+
+  batcher.flush_if_due(now);
+  ASSERT_EQ(1u, sent.size());
+  const std::vector<Event> expected{
+      {EV_ABS, ABS_X, 12}, {EV_REL, REL_X, 3}, {EV_REL, REL_WHEEL, 1}, {EV_SYN, SYN_REPORT, 0}};
+  ASSERT_EQ(expected.size(), sent[0].size());
+  for (std::size_t n = 0; n < expected.size(); n++)
+    EXPECT_TRUE(expected[n] == sent[0][n]) << "event " << n;
+  EXPECT_TRUE(batcher.empty());
+}
+
+TEST(EventBatcher, FlushesOnButtons) {
+  std::vector<std::vector<Event>> sent;
+  EventBatcher batcher(record(sent), std::chrono::milliseconds{10});
+
+  const EventBatcher::Clock::time_point now;
+  queue_motion(batcher, 10, 1, now);
+  batcher.queue({EV_KEY, BTN_LEFT, 1}, now);
+  EXPECT_TRUE(sent.empty());
+  batcher.queue({EV_SYN, SYN_REPORT, 0}, now);
+
+  // The motion before the button isn't merged with the one after it.
+  ASSERT_EQ(1u, sent.size());
+  ASSERT_EQ(5u, sent[0].size());
+  EXPECT_TRUE((Event{EV_KEY, BTN_LEFT, 1}) == sent[0][3]);
+
+  queue_motion(batcher, 20, 1, now);
+  batcher.flush();
+  ASSERT_EQ(2u, sent.size());
+  EXPECT_EQ(3u, sent[1].size());
+}
+
+TEST(EventBatcher, HoldsMotionForWindow) {
+  std::vector<std::vector<Event>> sent;
+  EventBatcher batcher(record(sent), std::chrono::milliseconds{4});
+
+  const EventBatcher::Clock::time_point start;
+  queue_motion(batcher, 10, 1, start);
+  EXPECT_EQ(start + std::chrono::milliseconds{4}, batcher.deadline());
+
+  queue_motion(batcher, 11, 1, start + std::chrono::milliseconds{2});
+  batcher.flush_if_due(start + std::chrono::milliseconds{3});
+  EXPECT_TRUE(sent.empty());
+
+  batcher.flush_if_due(start + std::chrono::milliseconds{4});
+  ASSERT_EQ(1u, sent.size());
+  EXPECT_EQ(3u, sent[0].size());
+  EXPECT_EQ(2, sent[0][1].value);
+}
+
+TEST(EventBatcher, SendsTimeOfLastEvent) {
+  std::vector<EventBatcher::Clock::time_point> times;
+  EventBatcher batcher([&](const std::vector<Event> &, const EventBatcher::Clock::time_point &time) {
+    times.push_back(time);
+  });
+
+  const EventBatcher::Clock::time_point start;
+  queue_motion(batcher, 10, 1, start);
+  queue_motion(batcher, 11, 1, start + std::chrono::milliseconds{1});
+  batcher.flush();
+
+  ASSERT_EQ(1u, times.size());
+  EXPECT_EQ(start + std::chrono::milliseconds{1}, times[0]);
+}
+}  // namespace input
+}  // namespace anbox
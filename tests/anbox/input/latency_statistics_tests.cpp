@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "anbox/input/latency_statistics.h"
+
+#include <sstream>
+
+using namespace std::chrono;
+
+namespace anbox {
+namespace input {
+TEST(LatencyStatistics, MeasuresStagesPerDevice) {
+  LatencyStatistics stats;
+
+  const LatencyStatistics::Clock::time_point start;
+  stats.events_sent("pointer", start, start + milliseconds{1});
+  stats.events_received("pointer", start, start + milliseconds{2});
+  stats.events_sent("keyboard", start, start + milliseconds{3});
+
+  const auto summary = stats.summary();
+  ASSERT_EQ(2u, summary.size());
+  EXPECT_EQ("keyboard", summary[0].device);
+  EXPECT_EQ(1u, summary[0].sent_batches);
+  EXPECT_EQ(0u, summary[0].received_batches);
+  EXPECT_EQ(milliseconds{3}, summary[0].queued.p50);
+  EXPECT_EQ("pointer", summary[1].device);
+  EXPECT_EQ(1u, summary[1].received_batches);
+  EXPECT_EQ(milliseconds{1}, summary[1].queued.p50);
+  EXPECT_EQ(milliseconds{2}, summary[1].delivery.p50);
+}
+
+TEST(LatencyStatistics, MatchesEarliestInputWithNextFrame) {
+  LatencyStatistics stats;
+
+  const LatencyStatistics::Clock::time_point start;
+  stats.events_sent("pointer", start, start);
+  stats.events_sent("pointer", start + milliseconds{5}, start + milliseconds{5});
+  stats.frame_presented(start + milliseconds{20});
+  // Without new input the next frame has nothing to do with it.
+  stats.frame_presented(start + milliseconds{40});
+
+  const auto summary = stats.summary();
+  ASSERT_EQ(1u, summary.size());
+  EXPECT_EQ(milliseconds{20}, summary[0].photon.p50);
+  EXPECT_EQ(milliseconds{20}, summary[0].photon.max);
+}
+
+TEST(LatencyStatistics, IgnoresInputWithoutVisibleReaction) {
+  LatencyStatistics stats;
+
+  const LatencyStatistics::Clock::time_point start;
+  stats.events_sent("pointer", start, start);
+  stats.frame_presented(start + LatencyStatistics::max_photon_latency + milliseconds{1});
+  stats.events_sent("pointer", start + seconds{2}, start + seconds{2});
+  stats.frame_presented(start + seconds{2} + milliseconds{16});
+
+  EXPECT_EQ(milliseconds{16}, stats.summary()[0].photon.max);
+}
+
+TEST(LatencyStatistics, WritesPrometheusTextFormat) {
+  LatencyStatistics stats;
+
+  const LatencyStatistics::Clock::time_point start;
+  stats.events_sent("anbox-pointer", start, start + milliseconds{1});
+
+  std::stringstream out;
+  stats.write_prometheus(out);
+  const auto text = out.str();
+
+  EXPECT_NE(std::string::npos, text.find("anbox_input_batches_sent_total{device=\"anbox-pointer\"} 1\n"));
+  EXPECT_NE(std::string::npos,
+            text.find("anbox_input_latency_seconds{device=\"anbox-pointer\",stage=\"queued\",quantile=\"0.5\"} 0.001\n"));
+}
+}  // namespace input
+}  // namespace anbox
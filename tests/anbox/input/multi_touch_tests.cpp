@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "anbox/input/multi_touch.h"
+
+namespace {
+struct Expected {
+  std::uint16_t type;
+  std::uint16_t code;
+  std::int32_t value;
+};
+
+void expect_frame(const std::vector<Expected> &expected,
+                  const std::vector<anbox::input::Event> &frame) {
+  ASSERT_EQ(expected.size(), frame.size());
+  for (std::size_t n = 0; n < expected.size(); n++) {
+    EXPECT_EQ(expected[n].type, frame[n].type) << "event " << n;
+    EXPECT_EQ(expected[n].code, frame[n].code) << "event " << n;
+    EXPECT_EQ(expected[n].value, frame[n].value) << "event " << n;
+  }
+}
+anbox::input::MultiTouch::Sender record(std::vector<std::vector<anbox::input::Event>> &sent) {
+  return [&sent](const std::vector<anbox::input::Event> &events,
+                 const anbox::input::MultiTouch::Clock::time_point &) { sent.push_back(events); };
+}
+}  // namespace
+
+namespace anbox {
+namespace input {
+TEST(MultiTouch, SendsChangedSlotsInOneFrame) {
+  std::vector<std::vector<Event>> frames;
+  MultiTouch touch(record(frames));
+
+  touch.down(100, 10, 20);
+  touch.down(200, 30, 40);
+  touch.move(100, 11, 21);
+  EXPECT_TRUE(touch.pending());
+  touch.flush();
+  EXPECT_FALSE(touch.pending());
+
+  ASSERT_EQ(1u, frames.size());
+  expect_frame({{EV_ABS, ABS_MT_SLOT, 0},
+                {EV_ABS, ABS_MT_TRACKING_ID, 0},
+                {EV_ABS, ABS_MT_POSITION_X, 11},
+                {EV_ABS, ABS_MT_POSITION_Y, 21},
+                {EV_ABS, ABS_MT_SLOT, 1},
+                {EV_ABS, ABS_MT_TRACKING_ID, 1},
+                {EV_ABS, ABS_MT_POSITION_X, 30},
+                {EV_ABS, ABS_MT_POSITION_Y, 40},
+                {EV_KEY, BTN_TOUCH, 1},
+                {EV_SYN, SYN_REPORT, 0}},
+               frames[0]);
+
+  // Only the slot which changed and no slot selection as it's still
+  // the current one.
+  touch.move(200, 31, 41);
+  touch.flush();
+  ASSERT_EQ(2u, frames.size());
+  expect_frame({{EV_ABS, ABS_MT_POSITION_X, 31},
+                {EV_ABS, ABS_MT_POSITION_Y, 41},
+                {EV_SYN, SYN_REPORT, 0}},
+               frames[1]);
+
+  // Nothing changed, nothing to send.
+  touch.flush();
+  EXPECT_EQ(2u, frames.size());
+}
+
+TEST(MultiTouch, ReleasesSlots) {
+  std::vector<std::vector<Event>> frames;
+  MultiTouch touch(record(frames));
+
+  touch.down(100, 10, 20);
+  touch.flush();
+  touch.up(100);
+  touch.flush();
+
+  ASSERT_EQ(2u, frames.size());
+  expect_frame({{EV_ABS, ABS_MT_TRACKING_ID, -1},
+                {EV_KEY, BTN_TOUCH, 0},
+                {EV_SYN, SYN_REPORT, 0}},
+               frames[1]);
+
+  // The slot is free again and the finger gets a new tracking id.
+  touch.down(300, 1, 2);
+  touch.flush();
+  ASSERT_EQ(3u, frames.size());
+  EXPECT_EQ(ABS_MT_TRACKING_ID, frames[2][0].code);
+  EXPECT_EQ(1, frames[2][0].value);
+}
+
+TEST(MultiTouch, ShortTapReachesGuest) {
+  std::vector<std::vector<Event>> frames;
+  MultiTouch touch(record(frames));
+
+  touch.down(100, 10, 20);
+  touch.up(100);
+  touch.flush();
+
+  ASSERT_EQ(2u, frames.size());
+  EXPECT_EQ(BTN_TOUCH, frames[0][4].code);
+  EXPECT_EQ(1, frames[0][4].value);
+  EXPECT_EQ(ABS_MT_TRACKING_ID, frames[1][0].code);
+  EXPECT_EQ(-1, frames[1][0].value);
+}
+
+TEST(MultiTouch, IgnoresFingersWithoutSlot) {
+  std::vector<std::vector<Event>> frames;
+  MultiTouch touch(record(frames));
+
+  for (std::size_t n = 0; n <= MultiTouch::max_slots; n++)
+    touch.down(n, 0, 0);
+  touch.move(MultiTouch::max_slots, 5, 5);
+  touch.up(MultiTouch::max_slots);
+  touch.flush();
+
+  ASSERT_EQ(1u, frames.size());
+  EXPECT_EQ(MultiTouch::max_slots * 4 + 2, frames[0].size());
+}
+}  // namespace input
+}  // namespace anbox
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/network/adaptive_buffer_size.h"
+
+#include <gtest/gtest.h>
+
+namespace anbox {
+namespace network {
+TEST(AdaptiveBufferSize, StartsWithInitialSize) {
+  AdaptiveBufferSize size({1024, 512, 4096});
+  EXPECT_EQ(1024U, size.current());
+}
+
+TEST(AdaptiveBufferSize, InitialSizeIsClampedToLimits) {
+  AdaptiveBufferSize size({16, 512, 4096});
+  EXPECT_EQ(512U, size.current());
+}
+
+TEST(AdaptiveBufferSize, GrowsOnFullReadsUpToMaximum) {
+  AdaptiveBufferSize size({1024, 512, 4096});
+  EXPECT_TRUE(size.update(1024));
+  EXPECT_EQ(2048U, size.current());
+  EXPECT_TRUE(size.update(2048));
+  EXPECT_EQ(4096U, size.current());
+  EXPECT_FALSE(size.update(4096));
+  EXPECT_EQ(4096U, size.current());
+}
+
+TEST(AdaptiveBufferSize, ShrinksOnlyAfterRunOfSmallReads) {
+  AdaptiveBufferSize size({4096, 512, 4096});
+
+  bool changed = false;
+  unsigned int reads = 0;
+  while (!changed && reads < 1000) {
+    changed = size.update(10);
+    reads++;
+  }
+  EXPECT_TRUE(changed);
+  EXPECT_GT(reads, 1U);
+  EXPECT_EQ(2048U, size.current());
+}
+
+TEST(AdaptiveBufferSize, LargeReadResetsShrinking) {
+  AdaptiveBufferSize size({4096, 512, 4096});
+  for (int n = 0; n < 1000; n++) {
+    EXPECT_FALSE(size.update(10));
+    EXPECT_FALSE(size.update(2048));
+  }
+  EXPECT_EQ(4096U, size.current());
+}
+
+TEST(AdaptiveBufferSize, DoesNotShrinkBelowMinimum) {
+  AdaptiveBufferSize size({512, 512, 4096});
+  for (int n = 0; n < 1000; n++) EXPECT_FALSE(size.update(1));
+  EXPECT_EQ(512U, size.current());
+}
+}  // namespace network
+}  // namespace anbox
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/network/connections.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+namespace {
+class FakeConnection {
+ public:
+  explicit FakeConnection(int id) : id_(id) {}
+
+  int id() const { return id_; }
+
+  void send(char const* data, size_t length) { received.append(data, length); }
+
+  std::string received;
+
+ private:
+  int id_;
+};
+}  // namespace
+
+namespace anbox {
+namespace network {
+TEST(Connections, TracksConnectionsWithGapsInTheirIds) {
+  Connections<FakeConnection> connections;
+  for (const auto id : {3, 10, 42})
+    connections.add(std::make_shared<FakeConnection>(id));
+  // Ids are only added once.
+  connections.add(std::make_shared<FakeConnection>(10));
+  EXPECT_EQ(3u, connections.size());
+
+  connections.remove(3);
+  connections.remove(7);
+  EXPECT_EQ(2u, connections.size());
+  EXPECT_FALSE(connections.includes(3));
+  EXPECT_TRUE(connections.includes(10));
+  EXPECT_TRUE(connections.includes(42));
+
+  connections.remove(42);
+  connections.remove(10);
+  EXPECT_EQ(0u, connections.size());
+}
+
+TEST(Connections, SnapshotsDontChange) {
+  Connections<FakeConnection> connections;
+  connections.add(std::make_shared<FakeConnection>(1));
+  connections.add(std::make_shared<FakeConnection>(2));
+
+  const auto snapshot = connections.snapshot();
+  connections.remove(1);
+  connections.add(std::make_shared<FakeConnection>(3));
+  connections.clear();
+
+  ASSERT_EQ(2u, snapshot->size());
+  EXPECT_EQ(1, snapshot->at(0)->id());
+  EXPECT_EQ(2, snapshot->at(1)->id());
+  EXPECT_EQ(0u, connections.size());
+}
+
+TEST(Connections, BroadcastsToAllConnections) {
+  Connections<FakeConnection> connections;
+  const auto first = std::make_shared<FakeConnection>(5);
+  const auto second = std::make_shared<FakeConnection>(9);
+  connections.add(first);
+  connections.add(second);
+
+  EXPECT_EQ(2u, connections.broadcast("foo", 3));
+  connections.remove(5);
+  EXPECT_EQ(1u, connections.broadcast("bar", 3));
+
+  EXPECT_EQ("foo", first->received);
+  EXPECT_EQ("foobar", second->received);
+}
+
+TEST(Connections, BroadcastsWhileConnectionsComeAndGo) {
+  Connections<FakeConnection> connections;
+  const auto stable = std::make_shared<FakeConnection>(0);
+  connections.add(stable);
+
+  std::atomic<bool> done{false};
+  std::thread churn([&]() {
+    int id = 1;
+    while (!done) {
+      connections.add(std::make_shared<FakeConnection>(id));
+      connections.remove(id - 1 > 0 ? id - 1 : -1);
+      id++;
+    }
+  });
+
+  const int broadcasts = 10000;
+  for (int n = 0; n < broadcasts; n++)
+    EXPECT_LE(1u, connections.broadcast("x", 1));
+
+  done = true;
+  churn.join();
+
+  EXPECT_EQ(std::string(broadcasts, 'x'), stable->received);
+}
+}  // namespace network
+}  // namespace anbox
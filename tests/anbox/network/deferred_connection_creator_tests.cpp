@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/network/deferred_connection_creator.h"
+#include "anbox/network/delegate_connection_creator.h"
+
+#include <gtest/gtest.h>
+
+namespace anbox {
+namespace network {
+namespace {
+typedef boost::asio::local::stream_protocol Protocol;
+typedef boost::asio::basic_stream_socket<Protocol> Socket;
+}
+
+TEST(DeferredConnectionCreator, HandsOverConnectionsAcceptedBeforeCreatorIsSet) {
+  boost::asio::io_service service;
+  DeferredConnectionCreator<Protocol> deferred;
+
+  auto first = std::make_shared<Socket>(service);
+  auto second = std::make_shared<Socket>(service);
+  deferred.create_connection_for(first);
+  deferred.create_connection_for(second);
+
+  std::vector<std::shared_ptr<Socket>> created;
+  deferred.set_creator(std::make_shared<DelegateConnectionCreator<Protocol>>(
+      [&](const std::shared_ptr<Socket> &socket) { created.push_back(socket); }));
+
+  ASSERT_EQ(2U, created.size());
+  EXPECT_EQ(first, created[0]);
+  EXPECT_EQ(second, created[1]);
+}
+
+TEST(DeferredConnectionCreator, ForwardsConnectionsOnceCreatorIsSet) {
+  boost::asio::io_service service;
+  DeferredConnectionCreator<Protocol> deferred;
+
+  std::vector<std::shared_ptr<Socket>> created;
+  deferred.set_creator(std::make_shared<DelegateConnectionCreator<Protocol>>(
+      [&](const std::shared_ptr<Socket> &socket) { created.push_back(socket); }));
+  EXPECT_TRUE(created.empty());
+
+  auto socket = std::make_shared<Socket>(service);
+  deferred.create_connection_for(socket);
+
+  ASSERT_EQ(1U, created.size());
+  EXPECT_EQ(socket, created[0]);
+}
+}  // namespace network
+}  // namespace anbox
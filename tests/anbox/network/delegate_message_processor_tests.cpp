@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/network/delegate_message_processor.h"
+
+#include <gtest/gtest.h>
+
+namespace anbox {
+namespace network {
+TEST(DelegateMessageProcessor, ForwardsBorrowedDataAsVector) {
+  std::vector<std::vector<std::uint8_t>> received;
+  DelegateMessageProcessor processor(
+      [&](const std::vector<std::uint8_t> &data) {
+        received.push_back(data);
+        return true;
+      });
+
+  const std::uint8_t first[] = {1, 2, 3};
+  const std::uint8_t second[] = {4, 5};
+  EXPECT_TRUE(processor.process_data(first, sizeof(first)));
+  EXPECT_TRUE(processor.process_data(second, sizeof(second)));
+
+  ASSERT_EQ(2U, received.size());
+  EXPECT_EQ(std::vector<std::uint8_t>({1, 2, 3}), received[0]);
+  EXPECT_EQ(std::vector<std::uint8_t>({4, 5}), received[1]);
+}
+
+TEST(DelegateMessageProcessor, FailsWithoutDelegate) {
+  DelegateMessageProcessor processor(nullptr);
+  const std::uint8_t data[] = {1};
+  EXPECT_FALSE(processor.process_data(data, sizeof(data)));
+}
+
+TEST(DelegateMessageProcessor, VectorOverloadForwardsToSpan) {
+  size_t bytes_received = 0;
+  DelegateMessageProcessor processor(
+      [&](const std::vector<std::uint8_t> &data) {
+        bytes_received += data.size();
+        return true;
+      });
+
+  MessageProcessor &base = processor;
+  EXPECT_TRUE(base.process_data(std::vector<std::uint8_t>(42, 0)));
+  EXPECT_EQ(42U, bytes_received);
+}
+}  // namespace network
+}  // namespace anbox
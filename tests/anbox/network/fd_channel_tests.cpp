@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/network/fd_channel.h"
+#include "anbox/network/fd_socket_transmission.h"
+
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+struct SocketPair {
+  SocketPair() {
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == 0) {
+      sender = anbox::Fd{fds[0]};
+      receiver = anbox::Fd{fds[1]};
+    }
+  }
+
+  anbox::Fd sender;
+  anbox::Fd receiver;
+};
+
+anbox::Fd make_pipe_end() {
+  int fds[2];
+  if (::pipe2(fds, O_CLOEXEC) < 0)
+    return anbox::Fd{};
+  ::close(fds[1]);
+  return anbox::Fd{fds[0]};
+}
+
+ino_t inode_of(int fd) {
+  struct stat st;
+  if (::fstat(fd, &st) < 0)
+    return 0;
+  return st.st_ino;
+}
+}  // namespace
+
+namespace anbox {
+namespace network {
+TEST(FdChannel, PassesFdsWithTheirPayload) {
+  SocketPair sockets;
+  FdChannel sender{sockets.sender};
+  FdChannel receiver{sockets.receiver};
+
+  const auto first = make_pipe_end();
+  const auto second = make_pipe_end();
+  sender.send("two pipes", {first, second});
+
+  std::string payload;
+  std::vector<Fd> fds;
+  receiver.receive(payload, fds);
+
+  EXPECT_EQ("two pipes", payload);
+  ASSERT_EQ(2U, fds.size());
+  EXPECT_EQ(inode_of(first), inode_of(fds[0]));
+  EXPECT_EQ(inode_of(second), inode_of(fds[1]));
+}
+
+TEST(FdChannel, PassesEachInodeOnlyOnce) {
+  SocketPair sockets;
+  FdChannel sender{sockets.sender};
+  FdChannel receiver{sockets.receiver};
+
+  const auto fd = make_pipe_end();
+  // A duplicate refers to the same inode.
+  const Fd duplicate{::dup(fd)};
+  sender.send("first", {fd, duplicate});
+  sender.send("second", {fd});
+  EXPECT_EQ(1U, sender.sent_fds());
+
+  std::string payload;
+  std::vector<Fd> first, second;
+  receiver.receive(payload, first);
+  receiver.receive(payload, second);
+  EXPECT_EQ("second", payload);
+  EXPECT_EQ(1U, receiver.received_fds());
+
+  ASSERT_EQ(2U, first.size());
+  ASSERT_EQ(1U, second.size());
+  // It is the very same descriptor which came in only once.
+  EXPECT_EQ(static_cast<int>(first[0]), static_cast<int>(first[1]));
+  EXPECT_EQ(static_cast<int>(first[0]), static_cast<int>(second[0]));
+}
+
+TEST(FdChannel, ReleasedFdsArePassedAgain) {
+  SocketPair sockets;
+  FdChannel sender{sockets.sender};
+  FdChannel receiver{sockets.receiver};
+
+  const auto fd = make_pipe_end();
+  sender.send("", {fd});
+  sender.release(fd);
+  EXPECT_EQ(0U, sender.sent_fds());
+  sender.send("again", {fd});
+
+  std::string payload;
+  std::vector<Fd> first, second;
+  receiver.receive(payload, first);
+  // The release is handled while waiting for the next batch.
+  receiver.receive(payload, second);
+  EXPECT_EQ("again", payload);
+  ASSERT_EQ(1U, second.size());
+  EXPECT_EQ(inode_of(fd), inode_of(second[0]));
+  EXPECT_NE(static_cast<int>(first[0]), static_cast<int>(second[0]));
+  EXPECT_EQ(1U, receiver.received_fds());
+}
+
+TEST(FdChannel, ThrowsWhenThePeerIsGone) {
+  SocketPair sockets;
+  FdChannel receiver{sockets.receiver};
+  sockets.sender = Fd{};
+
+  std::string payload;
+  std::vector<Fd> fds;
+  EXPECT_THROW(receiver.receive(payload, fds), socket_disconnected_error);
+}
+}  // namespace network
+}  // namespace anbox
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/network/handshake.h"
+#include "anbox/network/fd_socket_transmission.h"
+
+#include <gtest/gtest.h>
+
+#include <boost/asio/local/connect_pair.hpp>
+
+#include <unistd.h>
+
+namespace ba = boost::asio;
+
+namespace anbox {
+namespace network {
+namespace {
+struct SocketPair {
+  SocketPair()
+      : local(std::make_shared<ba::local::stream_protocol::socket>(service)),
+        remote(service) {
+    ba::local::connect_pair(*local, remote);
+  }
+
+  void write(const std::string &data) {
+    ba::write(remote, ba::buffer(data.data(), data.size()));
+  }
+
+  std::string read_rest() {
+    remote.close();
+    std::string rest;
+    char buffer[64];
+    boost::system::error_code err;
+    while (auto size = local->read_some(ba::buffer(buffer), err))
+      rest.append(buffer, size);
+    return rest;
+  }
+
+  ba::io_service service;
+  std::shared_ptr<ba::local::stream_protocol::socket> local;
+  ba::local::stream_protocol::socket remote;
+};
+
+struct Result {
+  bool called = false;
+  boost::system::error_code err;
+  std::string data;
+  std::vector<Fd> fds;
+
+  Handshake::Handler handler() {
+    return [this](const boost::system::error_code &e, const std::string &d,
+                  const std::vector<Fd> &f) {
+      called = true;
+      err = e;
+      data = d;
+      fds = f;
+    };
+  }
+};
+}  // namespace
+
+TEST(Handshake, ReadsUpToTheTerminatorOnly) {
+  SocketPair sockets;
+  Result result;
+  Handshake::read_until(sockets.service, sockets.local, 0, 64, result.handler());
+
+  sockets.write(std::string("pipe:", 5));
+  sockets.service.poll();
+  EXPECT_FALSE(result.called);
+
+  sockets.write(std::string("opengles\0flags", 14));
+  sockets.service.run();
+  ASSERT_TRUE(result.called);
+  EXPECT_FALSE(result.err);
+  EXPECT_EQ("pipe:opengles", result.data);
+  EXPECT_EQ("flags", sockets.read_rest());
+}
+
+TEST(Handshake, ReadsExactSizeWithFileDescriptors) {
+  SocketPair sockets;
+  Result result;
+  Handshake::read(sockets.service, sockets.local, 4, result.handler());
+
+  int pipe[2];
+  ASSERT_EQ(0, ::pipe(pipe));
+  Fd read_end{pipe[0]};
+  Fd write_end{pipe[1]};
+  send_fds(Fd{IntOwnedFd{sockets.remote.native_handle()}}, {read_end});
+  sockets.write("bcdef");
+  sockets.service.run();
+
+  ASSERT_TRUE(result.called);
+  EXPECT_FALSE(result.err);
+  // send_fds sends a single byte along with the descriptors.
+  EXPECT_EQ("Mbcd", result.data);
+  ASSERT_EQ(1u, result.fds.size());
+  EXPECT_EQ(1, ::write(write_end, "x", 1));
+  char byte = 0;
+  EXPECT_EQ(1, ::read(result.fds[0], &byte, 1));
+  EXPECT_EQ('x', byte);
+  EXPECT_EQ("ef", sockets.read_rest());
+}
+
+TEST(Handshake, FailsWhenTheClientIsTooSlow) {
+  SocketPair sockets;
+  Result result;
+  Handshake::read(sockets.service, sockets.local, 8, result.handler(),
+                  boost::posix_time::milliseconds(10));
+  sockets.write("abc");
+  sockets.service.run();
+
+  ASSERT_TRUE(result.called);
+  EXPECT_EQ(ba::error::timed_out, result.err);
+}
+
+TEST(Handshake, FailsWhenTheClientGoesAway) {
+  SocketPair sockets;
+  Result result;
+  Handshake::read_until(sockets.service, sockets.local, 0, 64, result.handler());
+  sockets.write("pipe:");
+  sockets.remote.close();
+  sockets.service.run();
+
+  ASSERT_TRUE(result.called);
+  EXPECT_EQ(ba::error::eof, result.err);
+}
+
+TEST(Handshake, FailsForTooLongHandshakes) {
+  SocketPair sockets;
+  Result result;
+  Handshake::read_until(sockets.service, sockets.local, 0, 4, result.handler());
+  sockets.write("pipe:opengles");
+  sockets.service.run();
+
+  ASSERT_TRUE(result.called);
+  EXPECT_EQ(ba::error::message_size, result.err);
+}
+}  // namespace network
+}  // namespace anbox
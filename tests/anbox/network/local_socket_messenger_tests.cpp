@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/network/local_socket_messenger.h"
+
+#include <gtest/gtest.h>
+
+#include <boost/asio/local/connect_pair.hpp>
+
+#include <thread>
+#include <vector>
+
+namespace ba = boost::asio;
+
+namespace anbox {
+namespace network {
+namespace {
+struct SocketPair {
+  SocketPair()
+      : local(std::make_shared<ba::local::stream_protocol::socket>(service)),
+        remote(service) {
+    ba::local::connect_pair(*local, remote);
+  }
+
+  std::vector<char> read(size_t length) {
+    std::vector<char> data(length);
+    ba::read(remote, ba::buffer(data.data(), data.size()));
+    return data;
+  }
+
+  ba::io_service service;
+  std::shared_ptr<ba::local::stream_protocol::socket> local;
+  ba::local::stream_protocol::socket remote;
+};
+}
+
+TEST(LocalSocketMessenger, SendVectoredWritesAllBuffersInOrder) {
+  SocketPair sockets;
+  LocalSocketMessenger messenger(sockets.local);
+
+  char header[] = {'a', 'b'};
+  char body[] = {'c', 'd', 'e'};
+  struct iovec iov[3];
+  iov[0].iov_base = header;
+  iov[0].iov_len = sizeof(header);
+  iov[1].iov_base = nullptr;
+  iov[1].iov_len = 0;
+  iov[2].iov_base = body;
+  iov[2].iov_len = sizeof(body);
+
+  messenger.send_vectored(iov, 3);
+
+  const auto data = sockets.read(5);
+  EXPECT_EQ(std::string("abcde"), std::string(data.begin(), data.end()));
+}
+
+TEST(LocalSocketMessenger, SendVectoredHandlesPartialWrites) {
+  SocketPair sockets;
+  sockets.local->set_option(ba::socket_base::send_buffer_size(4096));
+  LocalSocketMessenger messenger(sockets.local);
+
+  // Large enough to not fit into the socket buffer at once so that the
+  // messenger has to continue in the middle of a buffer.
+  std::vector<char> first(256 * 1024, 'x');
+  std::vector<char> second(256 * 1024, 'y');
+  struct iovec iov[2];
+  iov[0].iov_base = first.data();
+  iov[0].iov_len = first.size();
+  iov[1].iov_base = second.data();
+  iov[1].iov_len = second.size();
+
+  std::thread reader([&]() {
+    const auto data = sockets.read(first.size() + second.size());
+    EXPECT_EQ(first, std::vector<char>(data.begin(), data.begin() + first.size()));
+    EXPECT_EQ(second, std::vector<char>(data.begin() + first.size(), data.end()));
+  });
+
+  messenger.send_vectored(iov, 2);
+  reader.join();
+}
+
+TEST(LocalSocketMessenger, SendDoesNotNeedStagingBuffer) {
+  SocketPair sockets;
+  LocalSocketMessenger messenger(sockets.local);
+
+  const std::string message(8192, 'z');
+  std::thread reader([&]() {
+    const auto data = sockets.read(message.size());
+    EXPECT_EQ(message, std::string(data.begin(), data.end()));
+  });
+
+  messenger.send(message.data(), message.size());
+  reader.join();
+}
+}  // namespace network
+}  // namespace anbox
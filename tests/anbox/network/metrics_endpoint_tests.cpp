@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/network/metrics_endpoint.h"
+
+#include <boost/asio.hpp>
+
+#include <thread>
+
+namespace anbox {
+namespace network {
+TEST(MetricsEndpoint, AnswersWithAllMetrics) {
+  auto metrics = std::make_shared<common::Metrics>();
+  metrics->counter("anbox_foo_total", "Foo").add(7);
+
+  boost::asio::io_service service;
+  auto server = std::make_shared<boost::asio::local::stream_protocol::socket>(service);
+  boost::asio::local::stream_protocol::socket client(service);
+  boost::asio::local::connect_pair(client, *server);
+
+  MetricsEndpoint endpoint(metrics);
+  endpoint.create_connection_for(server);
+  server.reset();
+
+  const std::string request{"GET /metrics HTTP/1.0\r\n\r\n"};
+  boost::asio::write(client, boost::asio::buffer(request));
+
+  std::string response;
+  std::thread runner([&]() { service.run(); });
+
+  boost::system::error_code err;
+  char buffer[256];
+  while (!err) {
+    const auto size = client.read_some(boost::asio::buffer(buffer), err);
+    response.append(buffer, size);
+  }
+  EXPECT_EQ(boost::asio::error::eof, err);
+
+  client.close();
+  runner.join();
+
+  EXPECT_EQ(0u, response.find("HTTP/1.0 200 OK\r\n"));
+  EXPECT_NE(std::string::npos, response.find("\r\n\r\n# HELP anbox_foo_total Foo\n"));
+  EXPECT_NE(std::string::npos, response.find("anbox_foo_total 7\n"));
+}
+}  // namespace network
+}  // namespace anbox
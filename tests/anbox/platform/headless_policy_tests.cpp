@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <gtest/gtest.h>
+
+#include "anbox/audio/client_info.h"
+#include "anbox/audio/sink.h"
+#include "anbox/platform/headless_policy.h"
+#include "anbox/wm/window.h"
+
+namespace anbox {
+namespace platform {
+TEST(HeadlessPolicy, ReportsConfiguredDisplay) {
+  HeadlessPolicy policy{graphics::Rect{0, 0, 1280, 800}};
+
+  const auto info = policy.display_info();
+  EXPECT_EQ(1280, info.horizontal_resolution);
+  EXPECT_EQ(800, info.vertical_resolution);
+  EXPECT_EQ(60, info.refresh_rate);
+}
+
+TEST(HeadlessPolicy, NeedsRendererForWindows) {
+  HeadlessPolicy policy{graphics::Rect{0, 0, 1280, 800}};
+  EXPECT_EQ(nullptr, policy.create_window(1, graphics::Rect{0, 0, 100, 100}, "foo"));
+}
+
+TEST(HeadlessPolicy, KeepsClipboardData) {
+  HeadlessPolicy policy{graphics::Rect{0, 0, 1280, 800}};
+  EXPECT_TRUE(policy.get_clipboard_data().text.empty());
+
+  policy.set_clipboard_data(Policy::ClipboardData{"foo"});
+  EXPECT_EQ("foo", policy.get_clipboard_data().text);
+}
+
+TEST(HeadlessPolicy, DiscardsAudio) {
+  HeadlessPolicy policy{graphics::Rect{0, 0, 1280, 800}};
+
+  const audio::ClientInfo info{audio::ClientInfo::Type::Playback,
+                               audio::ClientInfo::Format::S16, 2, 0, 44100};
+  auto sink = policy.create_audio_sink(info);
+  ASSERT_NE(nullptr, sink);
+
+  const std::uint8_t data[] = {1, 2, 3};
+  sink->write_data(data, sizeof(data));
+}
+}  // namespace platform
+}  // namespace anbox
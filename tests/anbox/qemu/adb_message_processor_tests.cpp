@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "anbox/network/socket_messenger.h"
+#include "anbox/qemu/adb_message_processor.h"
+#include "anbox/runtime.h"
+
+#include <string>
+
+using namespace ::testing;
+
+namespace {
+class MockSocketMessenger : public anbox::network::SocketMessenger {
+ public:
+  // anbox::network::SocketMessenger
+  MOCK_CONST_METHOD0(creds, anbox::network::Credentials());
+  MOCK_CONST_METHOD0(local_port, unsigned short());
+  MOCK_METHOD0(set_no_delay, void());
+  MOCK_METHOD0(close, void());
+
+  // anbox::network::MessageSender
+  MOCK_METHOD2(send, void(char const*, size_t));
+  MOCK_METHOD2(send_raw, ssize_t(char const*, size_t));
+
+  // anbox::network::MessageReceiver
+  MOCK_METHOD2(async_receive_msg, void(AnboxReadHandler const&, boost::asio::mutable_buffers_1 const&));
+  MOCK_METHOD1(receive_msg, boost::system::error_code(boost::asio::mutable_buffers_1 const&));
+  MOCK_METHOD0(available_bytes, size_t());
+};
+
+bool accept(anbox::qemu::AdbMessageProcessor &processor) {
+  const std::string command("accept");
+  return processor.process_data(reinterpret_cast<const std::uint8_t *>(command.data()),
+                                command.size());
+}
+}  // namespace
+
+namespace anbox {
+namespace qemu {
+TEST(AdbMessageProcessor, SecondConnectionWaitsWithoutBlocking) {
+  // Nothing runs the runtime, so neither processor ever gets to talk to
+  // the host.
+  auto rt = Runtime::create(1);
+  auto messenger = std::make_shared<NiceMock<MockSocketMessenger>>();
+
+  auto first = std::make_shared<AdbMessageProcessor>(rt, messenger, Fd{});
+  EXPECT_TRUE(accept(*first));
+
+  // Used to wait for the first one on the very thread the first one needs
+  // to make progress on.
+  auto second = std::make_shared<AdbMessageProcessor>(rt, messenger, Fd{});
+  EXPECT_TRUE(accept(*second));
+
+  // Once the first one is gone the second one gets its turn.
+  first.reset();
+  EXPECT_EQ(1u, rt->service().poll_one());
+  second.reset();
+}
+}  // namespace qemu
+}  // namespace anbox
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "anbox/qemu/boot_properties.h"
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+
+namespace {
+const anbox::qemu::BootProperties::Host host{96, 4, std::uint64_t{3} * 1024 * 1024 * 1024};
+}  // namespace
+
+namespace anbox {
+namespace qemu {
+TEST(BootProperties, SnapsDensityToBuckets) {
+  EXPECT_EQ(graphics::DensityType::medium, BootProperties::density_for(0));
+  EXPECT_EQ(graphics::DensityType::medium, BootProperties::density_for(96));
+  EXPECT_EQ(graphics::DensityType::medium, BootProperties::density_for(110));
+  EXPECT_EQ(graphics::DensityType::high, BootProperties::density_for(144));
+  EXPECT_EQ(graphics::DensityType::xhigh, BootProperties::density_for(192));
+  EXPECT_EQ(graphics::DensityType::xxhigh, BootProperties::density_for(400));
+}
+
+TEST(BootProperties, DerivedFromHost) {
+  BootProperties properties(host);
+  EXPECT_EQ("160", properties.get("ro.sf.lcd_density"));
+  EXPECT_EQ("131072", properties.get("ro.opengles.version"));
+  EXPECT_EQ("4", properties.get("dalvik.vm.dex2oat-threads"));
+  EXPECT_EQ("192m", properties.get("dalvik.vm.heapgrowthlimit"));
+  EXPECT_EQ("512m", properties.get("dalvik.vm.heapsize"));
+  EXPECT_EQ("", properties.get("ro.unknown"));
+}
+
+TEST(BootProperties, ReplyIsFramedAndTerminated) {
+  BootProperties properties(host);
+  properties.set("ro.sf.lcd_density", "240");
+  properties.set("anbox.foo", "bar");
+
+  const auto &reply = properties.reply();
+  ASSERT_FALSE(reply.empty());
+  EXPECT_EQ('\0', reply.back());
+  EXPECT_EQ(0u, reply.find("0015ro.sf.lcd_density=240"));
+  EXPECT_NE(std::string::npos, reply.find("000danbox.foo=bar"));
+}
+
+TEST(BootProperties, RejectsPropertiesTooLongForAndroid) {
+  BootProperties properties(host);
+  properties.set("anbox.foo", std::string(92, 'a'));
+  properties.set(std::string(32, 'a'), "bar");
+  EXPECT_EQ("", properties.get("anbox.foo"));
+  EXPECT_EQ(std::string::npos, properties.reply().find("bar"));
+}
+
+TEST(BootProperties, LoadsOverrides) {
+  const auto path = boost::filesystem::temp_directory_path() /
+                    boost::filesystem::unique_path("boot-properties-%%%%-%%%%");
+  {
+    std::ofstream out(path.string());
+    out << "# Comments and empty lines are skipped\n"
+        << "\n"
+        << "ro.sf.lcd_density = 320\n"
+        << "invalid\n"
+        << "anbox.foo=bar=baz\n";
+  }
+
+  BootProperties properties(host);
+  properties.load_overrides(path.string());
+  boost::filesystem::remove(path);
+
+  EXPECT_EQ("320", properties.get("ro.sf.lcd_density"));
+  EXPECT_EQ("bar=baz", properties.get("anbox.foo"));
+  EXPECT_EQ("", properties.get("invalid"));
+  EXPECT_THROW(properties.load_overrides(path.string()), std::runtime_error);
+}
+}  // namespace qemu
+}  // namespace anbox
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "anbox/network/socket_messenger.h"
+#include "anbox/qemu/camera_message_processor.h"
+
+#include <string>
+
+using namespace ::testing;
+
+namespace {
+class MockSocketMessenger : public anbox::network::SocketMessenger {
+ public:
+  // anbox::network::SocketMessenger
+  MOCK_CONST_METHOD0(creds, anbox::network::Credentials());
+  MOCK_CONST_METHOD0(local_port, unsigned short());
+  MOCK_METHOD0(set_no_delay, void());
+  MOCK_METHOD0(close, void());
+
+  // anbox::network::MessageSender
+  MOCK_METHOD2(send, void(char const*, size_t));
+  MOCK_METHOD2(send_raw, ssize_t(char const*, size_t));
+
+  // anbox::network::MessageReceiver
+  MOCK_METHOD2(async_receive_msg, void(AnboxReadHandler const&, boost::asio::mutable_buffers_1 const&));
+  MOCK_METHOD1(receive_msg, boost::system::error_code(boost::asio::mutable_buffers_1 const&));
+  MOCK_METHOD0(available_bytes, size_t());
+};
+
+// Connects to the camera named |name| and returns the reply without its
+// size prefix and terminating zero.
+std::string connect(const std::string &name, bool host_cameras) {
+  auto messenger = std::make_shared<MockSocketMessenger>();
+  std::string written;
+  EXPECT_CALL(*messenger, send(_, _))
+      .WillRepeatedly(Invoke([&](const char *data, size_t size) {
+        written.append(data, size);
+      }));
+
+  anbox::qemu::CameraMessageProcessor processor(
+      messenger, anbox::Fd{}, "name=" + name, host_cameras);
+  const std::string query("connect", sizeof("connect"));
+  EXPECT_TRUE(processor.process_data(
+      reinterpret_cast<const std::uint8_t *>(query.data()), query.size()));
+
+  if (written.size() <= 9) return written;
+  return written.substr(8, written.size() - 9);
+}
+}  // namespace
+
+namespace anbox {
+namespace qemu {
+TEST(CameraMessageProcessor, RefusesPathsWhichAreNoHostCamera) {
+  for (const auto name : {"/etc/passwd", "/dev/tty", "/dev/video0/../null", "video0"}) {
+    // Refused before even trying to open it.
+    EXPECT_EQ("ko:Unknown camera", connect(name, true)) << name;
+  }
+}
+
+TEST(CameraMessageProcessor, RefusesAllCamerasWhenHostCamerasAreDisabled) {
+  for (const auto name : {"/dev/video0", "/dev/null"}) {
+    EXPECT_EQ("ko:Unknown camera", connect(name, false)) << name;
+  }
+}
+}  // namespace qemu
+}  // namespace anbox
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "anbox/network/socket_messenger.h"
+#include "anbox/qemu/gsm_message_processor.h"
+
+#include <string>
+#include <vector>
+
+using namespace ::testing;
+
+namespace {
+class MockSocketMessenger : public anbox::network::SocketMessenger {
+ public:
+  // anbox::network::SocketMessenger
+  MOCK_CONST_METHOD0(creds, anbox::network::Credentials());
+  MOCK_CONST_METHOD0(local_port, unsigned short());
+  MOCK_METHOD0(set_no_delay, void());
+  MOCK_METHOD0(close, void());
+
+  // anbox::network::MessageSender
+  MOCK_METHOD2(send, void(char const*, size_t));
+  MOCK_METHOD2(send_raw, ssize_t(char const*, size_t));
+
+  // anbox::network::MessageReceiver
+  MOCK_METHOD2(async_receive_msg, void(AnboxReadHandler const&, boost::asio::mutable_buffers_1 const&));
+  MOCK_METHOD1(receive_msg, boost::system::error_code(boost::asio::mutable_buffers_1 const&));
+  MOCK_METHOD0(available_bytes, size_t());
+};
+
+void send_command(anbox::qemu::GsmMessageProcessor &processor, const std::string &command) {
+  const auto line = command + "\n";
+  ASSERT_TRUE(processor.process_data(reinterpret_cast<const std::uint8_t*>(line.data()),
+                                     line.size()));
+}
+}  // namespace
+
+namespace anbox {
+namespace qemu {
+TEST(GsmMessageProcessor, RepliesReflectTheNetworkState) {
+  auto messenger = std::make_shared<MockSocketMessenger>();
+  GsmMessageProcessor processor(messenger);
+
+  std::vector<std::string> written;
+  EXPECT_CALL(*messenger, send(_, _))
+      .WillRepeatedly(Invoke([&](const char* data, size_t size) {
+        written.emplace_back(data, size);
+      }));
+
+  send_command(processor, "AT+CSQ");
+  send_command(processor, "AT+CREG?");
+
+  GsmMessageProcessor::NetworkState state;
+  state.status = GsmMessageProcessor::registration::home;
+  state.signal_strength = 20;
+  processor.set_network_state(state);
+
+  // Nothing asked for unsolicited registration results.
+  ASSERT_EQ(3u, written.size());
+  EXPECT_EQ("+CSQ: 20,99\r\n", written[2]);
+
+  send_command(processor, "AT+CSQ");
+  send_command(processor, "AT+CREG?");
+  ASSERT_EQ(5u, written.size());
+  EXPECT_EQ("+CSQ: 99,99\rOK\n", written[0]);
+  EXPECT_EQ("+CREG: 0,0\rOK\n", written[1]);
+  EXPECT_EQ("+CSQ: 20,99\rOK\n", written[3]);
+  EXPECT_EQ("+CREG: 0,1\rOK\n", written[4]);
+}
+
+TEST(GsmMessageProcessor, SendsRegistrationChangesWhenAskedTo) {
+  auto messenger = std::make_shared<MockSocketMessenger>();
+  GsmMessageProcessor processor(messenger);
+
+  std::vector<std::string> written;
+  EXPECT_CALL(*messenger, send(_, _))
+      .WillRepeatedly(Invoke([&](const char* data, size_t size) {
+        written.emplace_back(data, size);
+      }));
+
+  send_command(processor, "AT+CREG=2");
+  ASSERT_EQ(1u, written.size());
+  EXPECT_EQ("\rOK\n", written[0]);
+
+  GsmMessageProcessor::NetworkState state;
+  state.status = GsmMessageProcessor::registration::roaming;
+  processor.set_network_state(state);
+  ASSERT_EQ(2u, written.size());
+  EXPECT_EQ("+CREG: 5\r\n", written[1]);
+
+  // Setting the same state again doesn't wake the guest up.
+  processor.set_network_state(state);
+  EXPECT_EQ(2u, written.size());
+
+  send_command(processor, "AT+CREG?");
+  ASSERT_EQ(3u, written.size());
+  EXPECT_EQ("+CREG: 2,5\rOK\n", written[2]);
+}
+}  // namespace qemu
+}  // namespace anbox
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "anbox/network/socket_messenger.h"
+#include "anbox/qemu/fingerprint_message_processor.h"
+
+#include <string>
+
+using namespace ::testing;
+
+namespace {
+class MockSocketMessenger : public anbox::network::SocketMessenger {
+ public:
+  // anbox::network::SocketMessenger
+  MOCK_CONST_METHOD0(creds, anbox::network::Credentials());
+  MOCK_CONST_METHOD0(local_port, unsigned short());
+  MOCK_METHOD0(set_no_delay, void());
+  MOCK_METHOD0(close, void());
+
+  // anbox::network::MessageSender
+  MOCK_METHOD2(send, void(char const*, size_t));
+  MOCK_METHOD2(send_raw, ssize_t(char const*, size_t));
+  MOCK_METHOD2(send_vectored, void(const struct iovec*, size_t));
+
+  // anbox::network::MessageReceiver
+  MOCK_METHOD2(async_receive_msg, void(AnboxReadHandler const&, boost::asio::mutable_buffers_1 const&));
+  MOCK_METHOD1(receive_msg, boost::system::error_code(boost::asio::mutable_buffers_1 const&));
+  MOCK_METHOD0(available_bytes, size_t());
+};
+
+std::string join(const struct iovec* iov, size_t count) {
+  std::string data;
+  for (size_t n = 0; n < count; n++)
+    data.append(static_cast<const char*>(iov[n].iov_base), iov[n].iov_len);
+  return data;
+}
+}  // namespace
+
+namespace anbox {
+namespace qemu {
+TEST(QemudMessageProcessor, RepliesWithASingleWrite) {
+  auto messenger = std::make_shared<MockSocketMessenger>();
+  FingerprintMessageProcessor processor(messenger);
+
+  std::string written;
+  EXPECT_CALL(*messenger, send(_, _)).Times(0);
+  EXPECT_CALL(*messenger, send_vectored(_, _))
+      .WillOnce(Invoke([&](const struct iovec* iov, size_t count) {
+        written = join(iov, count);
+      }));
+
+  const std::string command{"0006listen"};
+  ASSERT_TRUE(processor.process_data(reinterpret_cast<const std::uint8_t*>(command.data()),
+                                     command.size()));
+  EXPECT_EQ(std::string("0003off\0", 8), written);
+}
+}  // namespace qemu
+}  // namespace anbox
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/rpc/framing.h"
+#include "anbox/rpc/constants.h"
+
+#include <gtest/gtest.h>
+
+namespace anbox {
+namespace rpc {
+TEST(RpcFraming, UsesLegacyHeaderUntilPeerAnnouncesSupport) {
+  Framing framing;
+  std::uint8_t header[long_header_size];
+
+  ASSERT_EQ(static_cast<size_t>(header_size),
+            framing.write_header(header, MessageType::response, 0x1234));
+  EXPECT_EQ(0x12, header[0]);
+  EXPECT_EQ(0x34, header[1]);
+  EXPECT_EQ(MessageType::response, header[2]);
+}
+
+TEST(RpcFraming, RefusesLargeMessagesForLegacyPeers) {
+  Framing framing;
+  std::uint8_t header[long_header_size];
+  EXPECT_EQ(0U, framing.write_header(header, MessageType::response,
+                                     max_legacy_message_size + 1));
+}
+
+TEST(RpcFraming, UsesLongHeaderOnceNegotiated) {
+  Framing framing;
+  framing.set_peer_protocol_version(protocol_version);
+
+  std::uint8_t header[long_header_size];
+  ASSERT_EQ(static_cast<size_t>(long_header_size),
+            framing.write_header(header, MessageType::invocation, 0x123456));
+  EXPECT_EQ(MessageType::invocation | long_frame_flag, header[2]);
+  EXPECT_EQ(0x00, header[3]);
+  EXPECT_EQ(0x12, header[4]);
+  EXPECT_EQ(0x34, header[5]);
+  EXPECT_EQ(0x56, header[6]);
+}
+
+TEST(RpcFraming, PeerVersionNeverDecreases) {
+  Framing framing;
+  framing.set_peer_protocol_version(protocol_version);
+  framing.set_peer_protocol_version(legacy_protocol_version);
+  EXPECT_EQ(protocol_version, framing.peer_protocol_version());
+}
+}  // namespace rpc
+}  // namespace anbox
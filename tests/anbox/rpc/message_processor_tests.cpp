@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/rpc/message_processor.h"
+#include "anbox/rpc/constants.h"
+#include "anbox/rpc/pending_call_cache.h"
+#include "anbox/rpc/send_buffer.h"
+
+#include "anbox_rpc.pb.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+namespace anbox {
+namespace rpc {
+namespace {
+class EventRecorder : public MessageProcessor {
+ public:
+  EventRecorder(const std::shared_ptr<Framing> &framing =
+                    std::make_shared<Framing>())
+      : MessageProcessor(nullptr, std::make_shared<PendingCallCache>(),
+                         framing) {}
+
+  void process_event_sequence(const std::string &event) override {
+    events.push_back(event);
+  }
+
+  void process_raw_event(std::uint16_t kind, const std::uint8_t *data,
+                         size_t size) override {
+    raw_events.emplace_back(kind, std::string(data, data + size));
+  }
+
+  std::vector<std::string> events;
+  std::vector<std::pair<std::uint16_t, std::string>> raw_events;
+};
+
+void append_event(std::vector<std::uint8_t> &stream, const std::string &event,
+                  const Framing &framing = Framing{}) {
+  anbox::protobuf::rpc::Result result;
+  result.add_events(event);
+
+  const size_t size = result.ByteSize();
+  std::uint8_t header[long_header_size];
+  const auto header_length =
+      framing.write_header(header, MessageType::response, size);
+  ASSERT_NE(0U, header_length);
+  stream.insert(stream.end(), header, header + header_length);
+
+  const auto offset = stream.size();
+  stream.resize(offset + size);
+  result.SerializeToArray(stream.data() + offset, size);
+}
+}
+
+TEST(RpcMessageProcessor, HandlesManyMessagesInOneRead) {
+  std::vector<std::uint8_t> stream;
+  for (int n = 0; n < 1000; n++) append_event(stream, std::to_string(n));
+
+  EventRecorder processor;
+  EXPECT_TRUE(processor.process_data(stream.data(), stream.size()));
+
+  ASSERT_EQ(1000U, processor.events.size());
+  for (int n = 0; n < 1000; n++)
+    EXPECT_EQ(std::to_string(n), processor.events[n]);
+}
+
+TEST(RpcMessageProcessor, HandlesMessagesSplitAcrossReads) {
+  std::vector<std::uint8_t> stream;
+  for (int n = 0; n < 10; n++) append_event(stream, std::to_string(n));
+
+  // Feed the stream byte by byte so we also see partial headers
+  EventRecorder processor;
+  for (const auto &byte : stream) EXPECT_TRUE(processor.process_data(&byte, 1));
+
+  ASSERT_EQ(10U, processor.events.size());
+  for (int n = 0; n < 10; n++)
+    EXPECT_EQ(std::to_string(n), processor.events[n]);
+}
+TEST(RpcMessageProcessor, AcceptsLongFramesAboveLegacyLimit) {
+  Framing long_frames;
+  long_frames.set_peer_protocol_version(protocol_version);
+
+  const std::string large_event(200 * 1024, 'x');
+  std::vector<std::uint8_t> stream;
+  append_event(stream, large_event, long_frames);
+  append_event(stream, "small");
+
+  auto framing = std::make_shared<Framing>();
+  EventRecorder processor(framing);
+
+  // Deliver in chunks like a socket would
+  const size_t chunk_size = 8192;
+  for (size_t offset = 0; offset < stream.size(); offset += chunk_size)
+    EXPECT_TRUE(processor.process_data(
+        stream.data() + offset, std::min(chunk_size, stream.size() - offset)));
+
+  ASSERT_EQ(2U, processor.events.size());
+  EXPECT_EQ(large_event, processor.events[0]);
+  EXPECT_EQ("small", processor.events[1]);
+
+  // Receiving a long frame means the peer can take them as well
+  EXPECT_EQ(long_frame_protocol_version, framing->peer_protocol_version());
+}
+
+TEST(RpcMessageProcessor, LearnsPeerVersionFromAnnouncement) {
+  anbox::protobuf::rpc::Result result;
+  result.set_protocol_version(protocol_version);
+
+  const size_t size = result.ByteSize();
+  std::vector<std::uint8_t> stream = {
+      static_cast<std::uint8_t>((size >> 8) & 0xff),
+      static_cast<std::uint8_t>((size >> 0) & 0xff), MessageType::response};
+  stream.resize(header_size + size);
+  result.SerializeToArray(stream.data() + header_size, size);
+
+  auto framing = std::make_shared<Framing>();
+  EventRecorder processor(framing);
+  EXPECT_TRUE(processor.process_data(stream.data(), stream.size()));
+  EXPECT_EQ(0U, processor.events.size());
+  EXPECT_EQ(protocol_version, framing->peer_protocol_version());
+}
+
+TEST(RpcMessageProcessor, HandsOnRawEvents) {
+  Framing framing;
+  framing.set_peer_protocol_version(raw_event_protocol_version);
+  SendBuffer buffer;
+  const std::string payload("window");
+  std::memcpy(buffer.write_raw_event(framing, 7, payload.size()),
+              payload.data(), payload.size());
+
+  std::vector<std::uint8_t> stream(buffer.data(), buffer.data() + buffer.size());
+  append_event(stream, "after");
+
+  EventRecorder processor;
+  for (const auto &byte : stream) EXPECT_TRUE(processor.process_data(&byte, 1));
+
+  ASSERT_EQ(1U, processor.raw_events.size());
+  EXPECT_EQ(7U, processor.raw_events[0].first);
+  EXPECT_EQ(payload, processor.raw_events[0].second);
+  ASSERT_EQ(1U, processor.events.size());
+  EXPECT_EQ("after", processor.events[0]);
+}
+
+TEST(RpcMessageProcessor, RejectsOversizedFrames) {
+  const size_t size = max_message_size + 1;
+  const std::uint8_t header[] = {0,
+                                 0,
+                                 MessageType::response | long_frame_flag,
+                                 static_cast<std::uint8_t>((size >> 24) & 0xff),
+                                 static_cast<std::uint8_t>((size >> 16) & 0xff),
+                                 static_cast<std::uint8_t>((size >> 8) & 0xff),
+                                 static_cast<std::uint8_t>((size >> 0) & 0xff)};
+  EventRecorder processor;
+  EXPECT_FALSE(processor.process_data(header, sizeof(header)));
+}
+}  // namespace rpc
+}  // namespace anbox
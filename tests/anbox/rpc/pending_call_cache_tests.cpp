@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/rpc/pending_call_cache.h"
+
+#include "anbox_rpc.pb.h"
+
+#include <gtest/gtest.h>
+
+#include <google/protobuf/stubs/common.h>
+
+#include <algorithm>
+#include <random>
+
+namespace anbox {
+namespace rpc {
+namespace {
+void count_completion(int *counter) { (*counter)++; }
+
+anbox::protobuf::rpc::Result result_for(std::uint32_t id) {
+  anbox::protobuf::rpc::Result result;
+  result.set_id(id);
+  return result;
+}
+}
+
+TEST(PendingCallCache, CompletesCallsInAnyOrder) {
+  PendingCallCache cache;
+  const std::uint32_t num_calls = 1000;
+  std::vector<int> completions(num_calls, 0);
+
+  for (std::uint32_t id = 0; id < num_calls; id++)
+    cache.save_completion_details(
+        id, nullptr,
+        google::protobuf::NewCallback(&count_completion, &completions[id]));
+  EXPECT_FALSE(cache.empty());
+
+  std::vector<std::uint32_t> ids(num_calls);
+  for (std::uint32_t id = 0; id < num_calls; id++) ids[id] = id;
+  std::shuffle(ids.begin(), ids.end(), std::mt19937{42});
+
+  for (const auto id : ids) {
+    auto result = result_for(id);
+    cache.complete_response(result);
+  }
+
+  EXPECT_TRUE(cache.empty());
+  for (const auto count : completions) EXPECT_EQ(1, count);
+}
+
+TEST(PendingCallCache, PopulatesResponseOfMatchingCall) {
+  PendingCallCache cache;
+  anbox::protobuf::rpc::Void response;
+  int completions = 0;
+  cache.save_completion_details(
+      7, &response,
+      google::protobuf::NewCallback(&count_completion, &completions));
+
+  auto result = result_for(7);
+  google::protobuf::MessageLite *populated = nullptr;
+  cache.populate_message_for_result(
+      result, [&](google::protobuf::MessageLite *m) { populated = m; });
+  EXPECT_EQ(&response, populated);
+
+  auto unknown = result_for(8);
+  populated = nullptr;
+  cache.populate_message_for_result(
+      unknown, [&](google::protobuf::MessageLite *m) { populated = m; });
+  EXPECT_EQ(nullptr, populated);
+
+  cache.complete_response(result);
+  EXPECT_EQ(1, completions);
+}
+
+TEST(PendingCallCache, CancelledCallsDoNotComplete) {
+  PendingCallCache cache;
+  int completions = 0;
+  for (std::uint32_t id = 0; id < 64; id++)
+    cache.save_completion_details(
+        id, nullptr,
+        google::protobuf::NewCallback(&count_completion, &completions));
+
+  for (std::uint32_t id = 0; id < 64; id += 2) EXPECT_TRUE(cache.cancel(id));
+  EXPECT_FALSE(cache.cancel(0));
+
+  for (std::uint32_t id = 0; id < 64; id++) {
+    auto result = result_for(id);
+    cache.complete_response(result);
+  }
+
+  EXPECT_EQ(32, completions);
+  EXPECT_TRUE(cache.empty());
+}
+
+TEST(PendingCallCache, ForceCompletionRunsAllPendingCalls) {
+  PendingCallCache cache;
+  int completions = 0;
+  for (std::uint32_t id = 0; id < 100; id++)
+    cache.save_completion_details(
+        id, nullptr,
+        google::protobuf::NewCallback(&count_completion, &completions));
+
+  cache.force_completion();
+  EXPECT_EQ(100, completions);
+  EXPECT_TRUE(cache.empty());
+
+  auto result = result_for(5);
+  cache.complete_response(result);
+  EXPECT_EQ(100, completions);
+}
+}  // namespace rpc
+}  // namespace anbox
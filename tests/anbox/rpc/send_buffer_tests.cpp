@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/rpc/send_buffer.h"
+#include "anbox/rpc/constants.h"
+#include "anbox/rpc/framing.h"
+
+#include "anbox_rpc.pb.h"
+
+#include <gtest/gtest.h>
+
+namespace anbox {
+namespace rpc {
+namespace {
+anbox::protobuf::rpc::StructuredError make_message(std::uint32_t code) {
+  anbox::protobuf::rpc::StructuredError message;
+  message.set_domain(42);
+  message.set_code(code);
+  return message;
+}
+
+template <typename T>
+T parse_frame(const SendBuffer &buffer, std::uint8_t type) {
+  EXPECT_LE(static_cast<size_t>(header_size), buffer.size());
+  const size_t size = (buffer.data()[0] << 8) + buffer.data()[1];
+  EXPECT_EQ(type, buffer.data()[2]);
+  EXPECT_EQ(buffer.size() - header_size, size);
+
+  T message;
+  EXPECT_TRUE(message.ParseFromArray(buffer.data() + header_size, size));
+  return message;
+}
+}
+
+TEST(RpcSendBuffer, EncodesInvocation) {
+  Framing framing;
+  SendBuffer buffer;
+  const auto parameters = make_message(7);
+  buffer.write_invocation(framing, 300, "launch_application", parameters);
+
+  const auto invocation = parse_frame<anbox::protobuf::rpc::Invocation>(
+      buffer, MessageType::invocation);
+  EXPECT_EQ(300U, invocation.id());
+  EXPECT_EQ("launch_application", invocation.method_name());
+  EXPECT_EQ(parameters.SerializeAsString(), invocation.parameters());
+  EXPECT_EQ(protocol_version, invocation.protocol_version());
+}
+
+TEST(RpcSendBuffer, EncodesResponse) {
+  Framing framing;
+  SendBuffer buffer;
+  const auto response = make_message(8);
+  buffer.write_response(framing, 5, response);
+
+  const auto result = parse_frame<anbox::protobuf::rpc::Result>(
+      buffer, MessageType::response);
+  EXPECT_EQ(5U, result.id());
+  EXPECT_EQ(response.SerializeAsString(), result.response());
+  EXPECT_EQ(0, result.events_size());
+}
+
+TEST(RpcSendBuffer, EncodesEvent) {
+  Framing framing;
+  SendBuffer buffer;
+  const auto event = make_message(9);
+  buffer.write_event(framing, event);
+
+  const auto result = parse_frame<anbox::protobuf::rpc::Result>(
+      buffer, MessageType::response);
+  EXPECT_FALSE(result.has_id());
+  ASSERT_EQ(1, result.events_size());
+  EXPECT_EQ(event.SerializeAsString(), result.events(0));
+}
+
+TEST(RpcSendBuffer, EncodesProtocolVersion) {
+  Framing framing;
+  SendBuffer buffer;
+  buffer.write_protocol_version(framing, protocol_version);
+
+  const auto result = parse_frame<anbox::protobuf::rpc::Result>(
+      buffer, MessageType::response);
+  EXPECT_EQ(protocol_version, result.protocol_version());
+}
+
+TEST(RpcSendBuffer, ReusesStorageForFollowingMessages) {
+  Framing framing;
+  SendBuffer buffer;
+  for (std::uint32_t n = 0; n < 100; n++)
+    buffer.write_response(framing, n, make_message(n));
+
+  const auto statistics = buffer.statistics();
+  EXPECT_EQ(100U, statistics.messages);
+  EXPECT_GE(3U, statistics.allocations);
+}
+
+TEST(RpcSendBuffer, ThrowsWhenMessageExceedsFraming) {
+  Framing framing;
+  SendBuffer buffer;
+  anbox::protobuf::rpc::Invocation large;
+  large.set_id(0);
+  large.set_method_name("");
+  large.set_parameters(std::string(max_legacy_message_size, 'x'));
+  large.set_protocol_version(0);
+  EXPECT_THROW(buffer.write_event(framing, large), std::runtime_error);
+}
+
+TEST(RpcSendBuffer, ThrowsOnRawEventsForOlderPeers) {
+  Framing framing;
+  framing.set_peer_protocol_version(long_frame_protocol_version);
+  SendBuffer buffer;
+  EXPECT_THROW(buffer.write_raw_event(framing, 1, 16), std::runtime_error);
+}
+}  // namespace rpc
+}  // namespace anbox
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/sensors/iio_sensor.h"
+#include "anbox/qemu/sensors_message_processor.h"
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+
+namespace fs = boost::filesystem;
+
+namespace {
+// A sysfs tree with the IIO devices the tests put into it.
+class FakeSysfs {
+ public:
+  FakeSysfs() : root_(fs::temp_directory_path() / fs::unique_path()) {
+    fs::create_directories(root_);
+  }
+  ~FakeSysfs() { fs::remove_all(root_); }
+
+  void write(const std::string &path, const std::string &value) {
+    const auto file = root_ / path;
+    fs::create_directories(file.parent_path());
+    std::ofstream(file.string()) << value << "\n";
+  }
+
+  std::string path(const std::string &device = "") const { return (root_ / device).string(); }
+
+ private:
+  fs::path root_;
+};
+}  // namespace
+
+namespace anbox {
+namespace sensors {
+TEST(IioSensor, FindsAllSensorsOfADevice) {
+  FakeSysfs sysfs;
+  for (const auto axis : {"x", "y", "z"}) {
+    sysfs.write(std::string("iio:device0/in_accel_") + axis + "_raw", "0");
+    sysfs.write(std::string("iio:device0/in_anglvel_") + axis + "_raw", "0");
+  }
+  sysfs.write("iio:device1/in_illuminance_input", "0");
+  // Without all three axes it's no accelerometer.
+  sysfs.write("iio:device2/in_accel_x_raw", "0");
+
+  const auto sensors = IioSensor::find_all(sysfs.path());
+  ASSERT_EQ(3u, sensors.size());
+
+  std::size_t motion = 0, light = 0;
+  for (const auto &sensor : sensors) {
+    if (sensor->type() == IioSensor::Type::Light) {
+      light++;
+      EXPECT_EQ(1u, sensor->value_count());
+    } else {
+      motion++;
+      EXPECT_EQ(sysfs.path("iio:device0"), sensor->path());
+      EXPECT_EQ(3u, sensor->value_count());
+    }
+  }
+  EXPECT_EQ(2u, motion);
+  EXPECT_EQ(1u, light);
+
+  EXPECT_TRUE(IioSensor::find_all(sysfs.path("missing")).empty());
+}
+
+TEST(IioSensor, AppliesOffsetScaleAndMountMatrix) {
+  FakeSysfs sysfs;
+  sysfs.write("iio:device0/in_accel_x_raw", "10");
+  sysfs.write("iio:device0/in_accel_y_raw", "20");
+  sysfs.write("iio:device0/in_accel_z_raw", "-30");
+  sysfs.write("iio:device0/in_accel_scale", "0.5");
+  // A per axis attribute wins over the shared one.
+  sysfs.write("iio:device0/in_accel_z_offset", "10");
+  // Rotated by 90 degrees around z.
+  sysfs.write("iio:device0/in_accel_mount_matrix", "0, -1, 0; 1, 0, 0; 0, 0, 1");
+
+  IioSensor sensor(IioSensor::Type::Accelerometer, sysfs.path("iio:device0"));
+  std::array<float, 3> values;
+  ASSERT_TRUE(sensor.read(values));
+  EXPECT_FLOAT_EQ(-10.0f, values[0]);
+  EXPECT_FLOAT_EQ(5.0f, values[1]);
+  EXPECT_FLOAT_EQ(-10.0f, values[2]);
+
+  // Values are read again every time.
+  sysfs.write("iio:device0/in_accel_x_raw", "0");
+  ASSERT_TRUE(sensor.read(values));
+  EXPECT_FLOAT_EQ(0.0f, values[1]);
+}
+
+TEST(IioSensor, ReadsRawLightWithoutProcessedValue) {
+  FakeSysfs sysfs;
+  sysfs.write("iio:device0/in_illuminance_raw", "300");
+  sysfs.write("iio:device0/in_illuminance_scale", "0.1");
+
+  IioSensor sensor(IioSensor::Type::Light, sysfs.path("iio:device0"));
+  std::array<float, 3> values;
+  ASSERT_TRUE(sensor.read(values));
+  EXPECT_FLOAT_EQ(30.0f, values[0]);
+
+  EXPECT_EQ("light:30", qemu::SensorsMessageProcessor::format_event(sensor, values));
+
+  EXPECT_THROW(IioSensor(IioSensor::Type::Gyroscope, sysfs.path("iio:device0")),
+               std::runtime_error);
+}
+
+TEST(IioSensor, FormatsMotionEventsForTheGuest) {
+  FakeSysfs sysfs;
+  for (const auto axis : {"x", "y", "z"})
+    sysfs.write(std::string("iio:device0/in_anglvel_") + axis + "_raw", "0");
+
+  IioSensor sensor(IioSensor::Type::Gyroscope, sysfs.path("iio:device0"));
+  EXPECT_EQ("gyroscope:0.5:-1:9.81",
+            qemu::SensorsMessageProcessor::format_event(sensor, {{0.5f, -1.0f, 9.81f}}));
+}
+}  // namespace sensors
+}  // namespace anbox
@@ -45,3 +45,56 @@ TEST(AtParser, BasicCommands) {
 
     ASSERT_EQ(commands_expected, commands_found);
 }
+
+TEST(AtParser, ShortestRegisteredPrefixWins) {
+    anbox::qemu::AtParser parser;
+
+    std::vector<std::string> handled;
+    auto handler = [&](const std::string &name) {
+        return [&, name](const std::string &command) { handled.push_back(name + ":" + command); };
+    };
+
+    parser.register_command("+CREG", handler("creg"));
+    parser.register_command("+CREG=", handler("creg-set"));
+    parser.register_command("+CGREG", handler("cgreg"));
+    // Registering a command twice keeps the first handler.
+    parser.register_command("+CGREG", handler("other"));
+
+    parser.process_command("AT+CREG?");
+    parser.process_command("AT+CREG=2");
+    parser.process_command("AT+CGREG?");
+    parser.process_command("AT+CSQ");
+    parser.process_command("+CREG?");
+
+    ASSERT_EQ(3u, handled.size());
+    EXPECT_EQ("creg:+CREG?", handled[0]);
+    EXPECT_EQ("creg:+CREG=2", handled[1]);
+    EXPECT_EQ("cgreg:+CGREG?", handled[2]);
+}
+
+TEST(AtParser, RilPollMix) {
+    anbox::qemu::AtParser parser;
+
+    // The commands the GSM service registers.
+    const std::vector<std::string> commands = {
+        "E0Q0V1", "S0=0", "+CTEC", "+CMEE=1", "+CCWA=1", "+CMOD=0", "+CMUT=0",
+        "+CSSN=0,1", "+COLP=0", "+CSCS=\"HEX\"", "+CUSD=1", "+CGEREP=1,0", "+CMGF",
+        "%CPI=3", "%CSTAT=1", "+CREG", "+CGREG", "+CFUN", "+CSQ", "+COPS", "+CPIN",
+    };
+    std::size_t handled = 0;
+    for (const auto &command : commands)
+        parser.register_command(command, [&](const std::string &) { handled++; });
+
+    // What the RIL keeps asking while idle. See at_parser_benchmark.cpp in
+    // tests/benchmarks for how fast we are at it.
+    std::string poll = "AT+CREG?\rAT+CGREG?\rAT+CSQ\rAT+COPS?\rAT+CFUN?\rAT+CPIN?\r";
+    std::vector<uint8_t> data;
+    const std::size_t rounds = 100;
+    for (std::size_t n = 0; n < rounds; n++)
+        std::copy(poll.begin(), poll.end(), std::back_inserter(data));
+
+    parser.process_data(data);
+
+    EXPECT_EQ(6 * rounds, handled);
+    EXPECT_TRUE(data.empty());
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/qemu/message_framer.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+namespace {
+void append(anbox::qemu::MessageFramer &framer, const std::string &data) {
+  framer.append(reinterpret_cast<const std::uint8_t *>(data.data()), data.size());
+}
+}  // namespace
+
+namespace anbox {
+namespace qemu {
+TEST(MessageFramer, SplitsBackToBackQemudMessages) {
+  MessageFramer framer(MessageFramer::Framing::Qemud);
+  append(framer, "0003foo000aset-delay0000");
+
+  std::string message;
+  ASSERT_TRUE(framer.next(message));
+  EXPECT_EQ("foo", message);
+  ASSERT_TRUE(framer.next(message));
+  EXPECT_EQ("set-delay", message.substr(0, 9));
+  EXPECT_EQ(10u, message.size());
+  ASSERT_FALSE(framer.next(message));
+}
+
+TEST(MessageFramer, WaitsForTheRestOfAMessage) {
+  MessageFramer framer(MessageFramer::Framing::Qemud);
+  std::string message;
+
+  append(framer, "00");
+  EXPECT_FALSE(framer.next(message));
+  append(framer, "0Bhello");
+  EXPECT_FALSE(framer.next(message));
+  append(framer, " world00");
+  ASSERT_TRUE(framer.next(message));
+  EXPECT_EQ("hello world", message);
+  EXPECT_FALSE(framer.next(message));
+  EXPECT_EQ(2u, framer.pending());
+
+  append(framer, "01!");
+  ASSERT_TRUE(framer.next(message));
+  EXPECT_EQ("!", message);
+  EXPECT_EQ(0u, framer.pending());
+}
+
+TEST(MessageFramer, DropsDataAfterMalformedHeader) {
+  MessageFramer framer(MessageFramer::Framing::Qemud);
+  append(framer, "zzzzfoo");
+
+  std::string message;
+  EXPECT_FALSE(framer.next(message));
+  EXPECT_EQ(0u, framer.pending());
+
+  append(framer, "0002ok");
+  ASSERT_TRUE(framer.next(message));
+  EXPECT_EQ("ok", message);
+}
+
+TEST(MessageFramer, SplitsTerminatedMessages) {
+  MessageFramer framer(MessageFramer::Framing::NullTerminated);
+  const char queries[] = "connect\0start dim=640x480\0fra";
+  framer.append(reinterpret_cast<const std::uint8_t *>(queries), sizeof(queries) - 1);
+
+  std::string message;
+  ASSERT_TRUE(framer.next(message));
+  EXPECT_EQ("connect", message);
+  ASSERT_TRUE(framer.next(message));
+  EXPECT_EQ("start dim=640x480", message);
+  EXPECT_FALSE(framer.next(message));
+
+  const char rest[] = "me";
+  framer.append(reinterpret_cast<const std::uint8_t *>(rest), sizeof(rest));
+  ASSERT_TRUE(framer.next(message));
+  EXPECT_EQ("frame", message);
+
+  MessageFramer lines(MessageFramer::Framing::Line);
+  append(lines, "ATE0\rAT+CFUN=1\n");
+  ASSERT_TRUE(lines.next(message));
+  EXPECT_EQ("ATE0", message);
+  ASSERT_TRUE(lines.next(message));
+  EXPECT_EQ("AT+CFUN=1", message);
+  EXPECT_FALSE(lines.next(message));
+}
+
+TEST(MessageFramer, HandlesMessagesSplitAcrossReads) {
+  MessageFramer framer(MessageFramer::Framing::Qemud);
+  std::string message;
+  append(framer, "0004pi");
+  for (int n = 0; n < 10000; n++) {
+    // Every read ends in the middle of a message.
+    EXPECT_FALSE(framer.next(message));
+    append(framer, "ng0004pi");
+    ASSERT_TRUE(framer.next(message));
+    EXPECT_EQ("ping", message);
+    EXPECT_EQ(6u, framer.pending());
+  }
+}
+
+TEST(MessageFramer, OverflowsOnceAnIncompleteMessageExceedsTheLimit) {
+  MessageFramer framer(MessageFramer::Framing::Line, 8);
+  std::string message;
+
+  // Complete messages in a single read don't count against the limit.
+  append(framer, "line 1\nline 2\n1234567");
+  ASSERT_TRUE(framer.next(message));
+  ASSERT_TRUE(framer.next(message));
+  EXPECT_FALSE(framer.next(message));
+  EXPECT_FALSE(framer.overflowed());
+
+  append(framer, "89");
+  EXPECT_FALSE(framer.next(message));
+  EXPECT_TRUE(framer.overflowed());
+}
+}  // namespace qemu
+}  // namespace anbox
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/wm/display.h"
+
+namespace anbox {
+namespace wm {
+TEST(Display, FindsDisplayShowingMostOfAFrame) {
+  const Display::List displays{
+      Display{0, {0, 0, 1920, 1080}, 60, 96},
+      Display{1, {1920, 0, 4480, 1440}, 144, 163}};
+
+  auto display = Display::find(displays, {100, 100, 500, 500});
+  ASSERT_NE(nullptr, display);
+  EXPECT_EQ(0, display->id());
+
+  // Most of the frame is on the second display.
+  display = Display::find(displays, {1800, 100, 2400, 500});
+  ASSERT_NE(nullptr, display);
+  EXPECT_EQ(1, display->id());
+  EXPECT_EQ(144, display->refresh_rate());
+  EXPECT_EQ(163, display->dpi());
+}
+
+TEST(Display, FindsNothingOutsideOfAllDisplays) {
+  const Display::List displays{Display{0, {0, 0, 1920, 1080}, 60, 96}};
+
+  EXPECT_EQ(nullptr, Display::find(displays, {2000, 0, 2400, 400}));
+  // Only touching a display doesn't count.
+  EXPECT_EQ(nullptr, Display::find(displays, {1920, 0, 2400, 400}));
+  EXPECT_EQ(nullptr, Display::find({}, {0, 0, 100, 100}));
+}
+}  // namespace wm
+}  // namespace anbox
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/wm/task_resizer.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+struct Recorder {
+  struct Call {
+    anbox::wm::Task::Id task;
+    anbox::graphics::Rect frame;
+  };
+
+  void record(const anbox::wm::Task::Id &task, const anbox::graphics::Rect &frame) {
+    std::lock_guard<std::mutex> l(lock);
+    calls.push_back(Call{task, frame});
+    changed.notify_all();
+  }
+
+  bool wait_for(std::size_t count) {
+    std::unique_lock<std::mutex> l(lock);
+    return changed.wait_for(l, std::chrono::seconds{5}, [&]() { return calls.size() >= count; });
+  }
+
+  std::mutex lock;
+  std::condition_variable changed;
+  std::vector<Call> calls;
+};
+}  // namespace
+
+namespace anbox {
+namespace wm {
+TEST(TaskResizer, SendsOnlyTheLatestFramePerTask) {
+  Recorder recorder;
+  std::mutex blocked;
+  std::unique_lock<std::mutex> block(blocked);
+
+  TaskResizer resizer([&](const Task::Id &task, const graphics::Rect &frame, std::int32_t) {
+    recorder.record(task, frame);
+    // Keeps the worker busy until everything else is queued up.
+    std::lock_guard<std::mutex> l(blocked);
+  }, std::chrono::milliseconds{1});
+
+  resizer.resize(1, graphics::Rect(0, 0, 10, 10), 3);
+  ASSERT_TRUE(recorder.wait_for(1));
+
+  for (int n = 1; n <= 10; n++)
+    resizer.resize(1, graphics::Rect(n, 0, n + 10, 10), 3);
+  resizer.resize(2, graphics::Rect(0, 0, 20, 20), 3);
+  block.unlock();
+
+  ASSERT_TRUE(recorder.wait_for(3));
+  std::lock_guard<std::mutex> l(recorder.lock);
+  ASSERT_EQ(3u, recorder.calls.size());
+  EXPECT_EQ(1, recorder.calls[1].task);
+  EXPECT_EQ(graphics::Rect(10, 0, 20, 10), recorder.calls[1].frame);
+  EXPECT_EQ(2, recorder.calls[2].task);
+}
+
+TEST(TaskResizer, WaitsAnIntervalBetweenRequests) {
+  Recorder recorder;
+  const std::chrono::milliseconds interval{50};
+  TaskResizer resizer([&](const Task::Id &task, const graphics::Rect &frame, std::int32_t) {
+    recorder.record(task, frame);
+  }, interval);
+
+  const auto start = std::chrono::steady_clock::now();
+  resizer.resize(1, graphics::Rect(0, 0, 10, 10), 3);
+  ASSERT_TRUE(recorder.wait_for(1));
+  resizer.resize(1, graphics::Rect(5, 0, 15, 10), 3);
+  ASSERT_TRUE(recorder.wait_for(2));
+  EXPECT_GE(std::chrono::steady_clock::now() - start, interval);
+}
+
+TEST(TaskResizer, HoldsBackNewSizesUntilTheySettle) {
+  Recorder recorder;
+  const std::chrono::milliseconds settle{100};
+  TaskResizer resizer([&](const Task::Id &task, const graphics::Rect &frame, std::int32_t) {
+    recorder.record(task, frame);
+  }, std::chrono::milliseconds{1}, settle);
+
+  resizer.resize(1, graphics::Rect(0, 0, 10, 10), 3);
+  ASSERT_TRUE(recorder.wait_for(1));
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int n = 1; n <= 10; n++)
+    resizer.resize(1, graphics::Rect(0, 0, 10 + n, 10 + n), 3);
+  // Other tasks don't wait for it.
+  resizer.resize(2, graphics::Rect(0, 0, 20, 20), 3);
+  ASSERT_TRUE(recorder.wait_for(2));
+  EXPECT_LT(std::chrono::steady_clock::now() - start, settle);
+  ASSERT_TRUE(recorder.wait_for(3));
+  EXPECT_GE(std::chrono::steady_clock::now() - start, settle);
+
+  std::lock_guard<std::mutex> l(recorder.lock);
+  ASSERT_EQ(3u, recorder.calls.size());
+  EXPECT_EQ(2, recorder.calls[1].task);
+  EXPECT_EQ(1, recorder.calls[2].task);
+  EXPECT_EQ(graphics::Rect(0, 0, 20, 20), recorder.calls[2].frame);
+}
+
+TEST(TaskResizer, KeepsGoingWhenSendingFails) {
+  Recorder recorder;
+  TaskResizer resizer([&](const Task::Id &task, const graphics::Rect &frame, std::int32_t) {
+    recorder.record(task, frame);
+    throw std::runtime_error("No remote client connected");
+  }, std::chrono::milliseconds{1});
+
+  resizer.resize(1, graphics::Rect(0, 0, 10, 10), 3);
+  ASSERT_TRUE(recorder.wait_for(1));
+  resizer.resize(1, graphics::Rect(5, 0, 15, 10), 3);
+  EXPECT_TRUE(recorder.wait_for(2));
+}
+}  // namespace wm
+}  // namespace anbox
@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/wm/window_preparing_manager.h"
+
+namespace anbox {
+namespace wm {
+TEST(WindowPreparingManager, FindsPackageOfIntent) {
+  android::Intent intent;
+  intent.component = "org.anbox.foo/.MainActivity";
+  EXPECT_EQ("org.anbox.foo", WindowPreparingManager::package_of(intent));
+
+  intent.package = "org.anbox.bar";
+  EXPECT_EQ("org.anbox.bar", WindowPreparingManager::package_of(intent));
+
+  EXPECT_EQ("", WindowPreparingManager::package_of(android::Intent{}));
+}
+}  // namespace wm
+}  // namespace anbox
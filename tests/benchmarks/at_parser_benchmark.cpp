@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/qemu/at_parser.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+// The commands the GSM service registers.
+const std::vector<std::string> gsm_commands = {
+    "E0Q0V1", "S0=0", "+CTEC", "+CMEE=1", "+CCWA=1", "+CMOD=0", "+CMUT=0",
+    "+CSSN=0,1", "+COLP=0", "+CSCS=\"HEX\"", "+CUSD=1", "+CGEREP=1,0", "+CMGF",
+    "%CPI=3", "%CSTAT=1", "+CREG", "+CGREG", "+CFUN", "+CSQ", "+COPS", "+CPIN",
+};
+
+// What the RIL keeps asking while idle.
+const std::string idle_poll = "AT+CREG?\rAT+CGREG?\rAT+CSQ\rAT+COPS?\rAT+CFUN?\rAT+CPIN?\r";
+constexpr std::size_t idle_poll_commands{6};
+}  // namespace
+
+// A batch of idle polls as a single read of the GSM pipe hands them to us.
+static void BM_RilPollMix(benchmark::State &state) {
+  anbox::qemu::AtParser parser;
+  std::size_t handled = 0;
+  for (const auto &command : gsm_commands)
+    parser.register_command(command, [&](const std::string &) { handled++; });
+
+  std::vector<uint8_t> batch;
+  for (int n = 0; n < state.range(0); n++)
+    std::copy(idle_poll.begin(), idle_poll.end(), std::back_inserter(batch));
+
+  std::vector<uint8_t> data;
+  for (auto _ : state) {
+    data = batch;
+    parser.process_data(data);
+  }
+  benchmark::DoNotOptimize(handled);
+  state.SetItemsProcessed(state.iterations() * state.range(0) * idle_poll_commands);
+}
+BENCHMARK(BM_RilPollMix)->Arg(1)->Arg(100);
+
+BENCHMARK_MAIN();
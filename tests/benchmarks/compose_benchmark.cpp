@@ -0,0 +1,260 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/application/database.h"
+#include "anbox/graphics/emugl/DispatchTables.h"
+#include "anbox/graphics/emugl/DisplayManager.h"
+#include "anbox/graphics/emugl/Renderer.h"
+#include "anbox/graphics/gl_renderer_server.h"
+#include "anbox/graphics/multi_window_composer_strategy.h"
+#include "anbox/graphics/single_window_composer_strategy.h"
+#include "anbox/platform/headless_policy.h"
+#include "anbox/wm/multi_window_manager.h"
+#include "anbox/wm/single_window_manager.h"
+#include "anbox/wm/window_state.h"
+
+#include <benchmark/benchmark.h>
+
+#include <boost/filesystem.hpp>
+
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace fs = boost::filesystem;
+
+using namespace anbox;
+
+namespace {
+const graphics::Rect display_frame{0, 0, 1920, 1080};
+// Layers are spread over that many windows in multi window mode.
+const int max_windows{4};
+
+std::shared_ptr<::Renderer> renderer;
+std::shared_ptr<platform::HeadlessPolicy> policy;
+
+// Every GLESv2 call goes through s_gles2 so we count them by putting a
+// wrapper in front of each entry of the table.
+std::atomic<std::uint64_t> gl_calls{0};
+
+#define COUNTING_GLES2_CALL(return_type, func_name, signature, callargs) \
+  func_name##_t real_##func_name = nullptr;                             \
+  return_type KHRONOS_APIENTRY counting_##func_name signature {          \
+    gl_calls.fetch_add(1, std::memory_order_relaxed);                   \
+    return real_##func_name callargs;                                   \
+  }
+LIST_GLES2_FUNCTIONS(COUNTING_GLES2_CALL, COUNTING_GLES2_CALL)
+#undef COUNTING_GLES2_CALL
+
+void install_gl_call_counters() {
+#define INSTALL_GLES2_COUNTER(return_type, func_name, signature, callargs) \
+  if (s_gles2.func_name) {                                                \
+    real_##func_name = s_gles2.func_name;                                 \
+    s_gles2.func_name = counting_##func_name;                             \
+  }
+  LIST_GLES2_FUNCTIONS(INSTALL_GLES2_COUNTER, INSTALL_GLES2_COUNTER)
+#undef INSTALL_GLES2_COUNTER
+}
+
+enum class Strategy { MultiWindow, SingleWindow };
+
+graphics::Rect window_frame(int task) {
+  const auto left = (task - 1) * 200, top = (task - 1) * 100;
+  return graphics::Rect{left, top, left + 800, top + 600};
+}
+
+// A synthetic stack of |count| layers like SurfaceFlinger would hand it
+// to us. Each window gets an opaque layer covering all of it, everything
+// above alternates between opaque, translucent, cropped and rotated
+// layers.
+class LayerStack {
+ public:
+  LayerStack(int count, int windows) {
+    for (int n = 0; n < count; n++) {
+      const auto task = 1 + n % windows;
+      const auto depth = n / windows;
+      const auto frame = window_frame(task);
+
+      auto position = frame;
+      if (depth > 0) {
+        const auto offset = 16 * depth;
+        position = graphics::Rect{frame.left() + offset, frame.top() + offset,
+                                  frame.left() + offset + 400, frame.top() + offset + 300};
+      }
+
+      const auto width = position.width(), height = position.height();
+      const auto buffer = renderer->createColorBuffer(width, height, GL_RGBA);
+      std::vector<std::uint8_t> pixels(static_cast<size_t>(width * height * 4), 0xff);
+      renderer->updateColorBuffer(buffer, 0, 0, width, height, GL_RGBA,
+                                  GL_UNSIGNED_BYTE, pixels.data());
+      buffers_.push_back(buffer);
+
+      auto crop = graphics::Rect{0, 0, width, height};
+      glm::mat4 transformation;
+      float alpha = 1.0f;
+      switch (depth > 0 ? n % 4 : 0) {
+        case 1:
+          alpha = 0.5f;
+          break;
+        case 2:
+          crop = graphics::Rect{width / 4, height / 4, width * 3 / 4, height * 3 / 4};
+          break;
+        case 3:
+          // Rotated by 90 degrees around the center of the layer.
+          transformation = glm::mat4{0.0f, 1.0f, 0.0f, 0.0f,
+                                     -1.0f, 0.0f, 0.0f, 0.0f,
+                                     0.0f, 0.0f, 1.0f, 0.0f,
+                                     0.0f, 0.0f, 0.0f, 1.0f};
+          break;
+        default:
+          break;
+      }
+
+      renderables_.push_back({"org.anbox.surface." + std::to_string(task), buffer,
+                              position, crop, transformation, alpha});
+    }
+  }
+
+  ~LayerStack() {
+    for (const auto buffer : buffers_)
+      renderer->closeColorBuffer(buffer);
+  }
+
+  const RenderableList &renderables() const { return renderables_; }
+
+  // The top most layer is never hidden by another one, so it is always
+  // composed.
+  HandleType top_buffer() const { return buffers_.back(); }
+
+ private:
+  std::vector<HandleType> buffers_;
+  RenderableList renderables_;
+};
+}  // namespace
+
+// range(0) layers composed with the strategy given by range(1). CPU time
+// covers the strategy and Renderer::draw, real time also waits for the
+// GPU to finish the frame.
+static void BM_Compose(benchmark::State &state) {
+  const auto layers = static_cast<int>(state.range(0));
+  const auto strategy_type = static_cast<Strategy>(state.range(1));
+
+  const auto data_path = fs::temp_directory_path() / fs::unique_path("anbox-compose-bench-%%%%-%%%%");
+  auto app_db = std::make_shared<application::Database>(data_path / "launchers",
+                                                        data_path / "icons");
+
+  std::shared_ptr<wm::Manager> wm;
+  std::shared_ptr<graphics::LayerComposer::Strategy> strategy;
+  int windows = 1;
+  if (strategy_type == Strategy::MultiWindow) {
+    windows = std::min(layers, max_windows);
+    wm::WindowState::List states;
+    for (int task = 1; task <= windows; task++)
+      states.push_back(wm::WindowState{wm::Display::Default, true, window_frame(task),
+                                       "org.anbox.application" + std::to_string(task),
+                                       wm::Task::Id{task}, wm::Stack::Id::Freeform});
+    wm = std::make_shared<wm::MultiWindowManager>(policy, nullptr, app_db);
+    wm->apply_window_state_update(states, {});
+    strategy = std::make_shared<graphics::MultiWindowComposerStrategy>(wm);
+    state.SetLabel("multi-window");
+  } else {
+    wm = std::make_shared<wm::SingleWindowManager>(policy, display_frame, app_db);
+    wm->setup();
+    strategy = std::make_shared<graphics::SingleWindowComposerStrategy>(wm);
+    state.SetLabel("single-window");
+  }
+
+  {
+    LayerStack stack(layers, windows);
+    const auto probe = stack.top_buffer();
+    std::uint32_t pixel = 0xffffffff;
+
+    std::uint64_t calls = 0;
+    for (auto _ : state) {
+      for (const auto &w : strategy->process_layers(stack.renderables())) {
+        const auto frame = graphics::Rect{0, 0, w.first->frame().width(),
+                                          w.first->frame().height()};
+        const auto before = gl_calls.load(std::memory_order_relaxed);
+        renderer->draw(w.first->native_handle(), frame, w.second);
+        calls += gl_calls.load(std::memory_order_relaxed) - before;
+      }
+
+      // Updating a buffer waits until the last composition sampling it is
+      // done, which is how we learn when the GPU finished the frame. Hosts
+      // without fence syncs don't wait here.
+      renderer->updateColorBuffer(probe, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, &pixel);
+    }
+
+    state.counters["gl_calls_per_frame"] =
+        benchmark::Counter(static_cast<double>(calls), benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+  }
+
+  strategy.reset();
+  wm.reset();
+  app_db->flush();
+  app_db.reset();
+  boost::system::error_code ec;
+  fs::remove_all(data_path, ec);
+}
+static void layer_stacks(benchmark::internal::Benchmark *b) {
+  for (const auto strategy : {Strategy::MultiWindow, Strategy::SingleWindow}) {
+    for (int64_t layers = 1; layers <= 64; layers *= 2)
+      b->Args({layers, static_cast<int64_t>(strategy)});
+  }
+  b->Unit(benchmark::kMicrosecond);
+}
+BENCHMARK(BM_Compose)->Apply(layer_stacks);
+
+int main(int argc, char **argv) {
+  // Like anbox-gl-replay we use the translator unless told otherwise.
+  auto driver = graphics::GLRendererServer::Config::Driver::Translator;
+  int args = 1;
+  for (int n = 1; n < argc; n++) {
+    if (std::strcmp(argv[n], "--gles-driver=host") == 0)
+      driver = graphics::GLRendererServer::Config::Driver::Host;
+    else if (std::strcmp(argv[n], "--gles-driver=translator") != 0)
+      argv[args++] = argv[n];
+  }
+  argc = args;
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    return EXIT_FAILURE;
+
+  graphics::GLRendererServer::initialize_gl_libraries(driver);
+
+  renderer = std::make_shared<::Renderer>();
+  if (!renderer->initialize(0, true)) {
+    std::cerr << "Failed to initialize offscreen renderer" << std::endl;
+    return EXIT_FAILURE;
+  }
+  install_gl_call_counters();
+
+  policy = std::make_shared<platform::HeadlessPolicy>(display_frame);
+  policy->set_renderer(renderer);
+  registerDisplayManager(policy);
+
+  benchmark::RunSpecifiedBenchmarks();
+
+  registerDisplayManager(nullptr);
+  policy.reset();
+  renderer->finalize();
+  renderer.reset();
+  return EXIT_SUCCESS;
+}
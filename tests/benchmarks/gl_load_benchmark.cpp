@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "anbox/graphics/emugl/DisplayManager.h"
+#include "anbox/graphics/emugl/RenderControl.h"
+#include "anbox/graphics/emugl/Renderer.h"
+#include "anbox/graphics/gl_renderer_server.h"
+#include "anbox/platform/headless_policy.h"
+#include "anbox/qemu/pipe_connection_creator.h"
+#include "anbox/runtime.h"
+
+#include <benchmark/benchmark.h>
+
+#include <boost/asio/local/connect_pair.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ba = boost::asio;
+
+using namespace anbox;
+
+namespace {
+// Opcodes and arguments as the guest's renderControl encoder sends them,
+// see renderControl.in.
+constexpr std::uint32_t op_rcGetRendererVersion{10000};
+constexpr std::uint32_t op_rcCreateColorBuffer{10012};
+constexpr std::uint32_t op_rcCloseColorBuffer{10014};
+constexpr std::uint32_t op_rcUpdateColorBuffer{10024};
+constexpr std::uint32_t gl_rgba{0x1908};
+constexpr std::uint32_t gl_unsigned_byte{0x1401};
+
+// Every client updates a color buffer of this size in the upload mixes.
+constexpr std::uint32_t upload_width{256};
+constexpr std::uint32_t upload_height{256};
+// The mixed load uploads once every that many commands.
+constexpr std::int64_t mixed_upload_interval{8};
+
+enum class Mix { RoundTrip, Upload, Mixed };
+
+std::shared_ptr<::Renderer> renderer;
+std::shared_ptr<platform::HeadlessPolicy> policy;
+std::shared_ptr<Runtime> runtime;
+std::shared_ptr<qemu::PipeConnectionCreator> creator;
+
+// Time every core spent busy and in total, from /proc/stat.
+struct CpuTimes {
+  std::vector<std::uint64_t> busy;
+  std::vector<std::uint64_t> total;
+};
+
+CpuTimes read_cpu_times() {
+  CpuTimes times;
+  std::ifstream in("/proc/stat");
+  std::string line;
+  while (std::getline(in, line)) {
+    // The first line sums up all cores.
+    if (line.compare(0, 3, "cpu") != 0 || line.compare(0, 4, "cpu ") == 0)
+      continue;
+
+    std::istringstream fields(line.substr(line.find(' ')));
+    std::uint64_t value = 0, total = 0, idle = 0;
+    for (int n = 0; fields >> value; n++) {
+      total += value;
+      // idle and iowait
+      if (n == 3 || n == 4)
+        idle += value;
+    }
+    times.busy.push_back(total - idle);
+    times.total.push_back(total);
+  }
+  return times;
+}
+
+// A guest GL client talking to the host through its own qemu pipe.
+class Client {
+ public:
+  Client()
+      : host_(std::make_shared<ba::local::stream_protocol::socket>(
+            runtime->service(Runtime::Subsystem::Graphics))),
+        guest_(service_) {
+    ba::local::connect_pair(*host_, guest_);
+    creator->create_connection_for(host_);
+
+    const char header[] = "pipe:opengles";
+    ba::write(guest_, ba::buffer(header, sizeof(header)));
+    const std::uint32_t flags = 0;
+    ba::write(guest_, ba::buffer(&flags, sizeof(flags)));
+  }
+
+  ~Client() {
+    boost::system::error_code ec;
+    guest_.close(ec);
+  }
+
+  std::uint32_t create_color_buffer(std::uint32_t width, std::uint32_t height) {
+    const std::uint32_t command[] = {op_rcCreateColorBuffer, 5 * 4, width, height, gl_rgba};
+    ba::write(guest_, ba::buffer(command));
+    return read_reply();
+  }
+
+  void close_color_buffer(std::uint32_t color_buffer) {
+    const std::uint32_t command[] = {op_rcCloseColorBuffer, 3 * 4, color_buffer};
+    ba::write(guest_, ba::buffer(command));
+  }
+
+  void get_renderer_version() {
+    const std::uint32_t command[] = {op_rcGetRendererVersion, 2 * 4};
+    ba::write(guest_, ba::buffer(command));
+    read_reply();
+  }
+
+  void update_color_buffer(std::uint32_t color_buffer, const std::vector<std::uint8_t> &pixels) {
+    const auto size = static_cast<std::uint32_t>(pixels.size());
+    const std::uint32_t command[] = {op_rcUpdateColorBuffer, 10 * 4 + size, color_buffer,
+                                     0, 0, upload_width, upload_height, gl_rgba,
+                                     gl_unsigned_byte, size};
+    const std::array<ba::const_buffer, 2> buffers{{ba::buffer(command), ba::buffer(pixels)}};
+    ba::write(guest_, buffers);
+    read_reply();
+  }
+
+ private:
+  std::uint32_t read_reply() {
+    std::uint32_t reply = 0;
+    ba::read(guest_, ba::buffer(&reply, sizeof(reply)));
+    return reply;
+  }
+
+  ba::io_service service_;
+  std::shared_ptr<ba::local::stream_protocol::socket> host_;
+  ba::local::stream_protocol::socket guest_;
+};
+
+std::chrono::microseconds percentile(std::vector<std::chrono::nanoseconds> &latencies,
+                                     double fraction) {
+  if (latencies.empty())
+    return std::chrono::microseconds{0};
+  const auto n = static_cast<std::size_t>(fraction * (latencies.size() - 1));
+  std::nth_element(latencies.begin(), latencies.begin() + n, latencies.end());
+  return std::chrono::duration_cast<std::chrono::microseconds>(latencies[n]);
+}
+}  // namespace
+
+// Every benchmark thread is a guest GL client with its own connection
+// sending the command mix given by range(0) as fast as the host
+// answers. Throughput adds up over all clients, latencies are per
+// command and averaged over the clients. cpu<n> is how busy core n was
+// while the clients ran, cpu_cores how many cores that adds up to.
+static void BM_GlLoad(benchmark::State &state) {
+  static CpuTimes before;
+  const auto mix = static_cast<Mix>(state.range(0));
+
+  Client client;
+  std::uint32_t color_buffer = 0;
+  std::vector<std::uint8_t> pixels;
+  if (mix != Mix::RoundTrip) {
+    color_buffer = client.create_color_buffer(upload_width, upload_height);
+    pixels.resize(upload_width * upload_height * 4, 0xff);
+  }
+
+  std::vector<std::chrono::nanoseconds> latencies;
+  latencies.reserve(1024 * 1024);
+  std::int64_t bytes = 0;
+
+  if (state.thread_index() == 0)
+    before = read_cpu_times();
+
+  std::int64_t n = 0;
+  for (auto _ : state) {
+    const auto started = std::chrono::steady_clock::now();
+    if (mix == Mix::Upload || (mix == Mix::Mixed && n % mixed_upload_interval == 0)) {
+      client.update_color_buffer(color_buffer, pixels);
+      bytes += static_cast<std::int64_t>(pixels.size());
+    } else {
+      client.get_renderer_version();
+    }
+    latencies.push_back(std::chrono::steady_clock::now() - started);
+    n++;
+  }
+
+  if (color_buffer != 0)
+    client.close_color_buffer(color_buffer);
+
+  state.SetBytesProcessed(bytes);
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()));
+  state.counters["latency_p50_us"] = benchmark::Counter(
+      static_cast<double>(percentile(latencies, 0.5).count()), benchmark::Counter::kAvgThreads);
+  state.counters["latency_p99_us"] = benchmark::Counter(
+      static_cast<double>(percentile(latencies, 0.99).count()), benchmark::Counter::kAvgThreads);
+
+  if (state.thread_index() == 0) {
+    const auto after = read_cpu_times();
+    double cores = 0.0;
+    for (std::size_t core = 0; core < after.busy.size() && core < before.busy.size(); core++) {
+      const auto total = after.total[core] - before.total[core];
+      const auto busy = total > 0 ? static_cast<double>(after.busy[core] - before.busy[core]) / total : 0.0;
+      state.counters["cpu" + std::to_string(core)] = busy;
+      cores += busy;
+    }
+    state.counters["cpu_cores"] = cores;
+  }
+
+  switch (mix) {
+    case Mix::RoundTrip:
+      state.SetLabel("round-trip");
+      break;
+    case Mix::Upload:
+      state.SetLabel("upload");
+      break;
+    case Mix::Mixed:
+      state.SetLabel("mixed");
+      break;
+  }
+}
+static void client_counts(benchmark::internal::Benchmark *b) {
+  for (const auto mix : {Mix::RoundTrip, Mix::Upload, Mix::Mixed})
+    b->Arg(static_cast<int64_t>(mix));
+  b->ThreadRange(1, static_cast<int>(std::max(2u, 2 * std::thread::hardware_concurrency())));
+  b->UseRealTime();
+  b->Unit(benchmark::kMicrosecond);
+}
+BENCHMARK(BM_GlLoad)->Apply(client_counts);
+
+int main(int argc, char **argv) {
+  auto driver = graphics::GLRendererServer::Config::Driver::Translator;
+  int args = 1;
+  for (int n = 1; n < argc; n++) {
+    if (std::strcmp(argv[n], "--gles-driver=host") == 0)
+      driver = graphics::GLRendererServer::Config::Driver::Host;
+    else if (std::strcmp(argv[n], "--gles-driver=translator") != 0)
+      argv[args++] = argv[n];
+  }
+  argc = args;
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    return EXIT_FAILURE;
+
+  graphics::GLRendererServer::initialize_gl_libraries(driver);
+
+  renderer = std::make_shared<::Renderer>();
+  if (!renderer->initialize(0, true)) {
+    std::cerr << "Failed to initialize offscreen renderer" << std::endl;
+    return EXIT_FAILURE;
+  }
+  registerRenderer(renderer);
+
+  policy = std::make_shared<platform::HeadlessPolicy>(graphics::Rect{0, 0, 1920, 1080});
+  policy->set_renderer(renderer);
+  registerDisplayManager(policy);
+
+  runtime = Runtime::create();
+  runtime->start();
+  creator = std::make_shared<qemu::PipeConnectionCreator>(renderer, runtime);
+
+  benchmark::RunSpecifiedBenchmarks();
+
+  creator.reset();
+  runtime->stop();
+  runtime.reset();
+  registerDisplayManager(nullptr);
+  policy.reset();
+  registerRenderer(nullptr);
+  renderer->finalize();
+  renderer.reset();
+  return EXIT_SUCCESS;
+}
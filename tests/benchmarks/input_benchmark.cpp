@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/input/device.h"
+#include "anbox/input/event_batch.h"
+#include "anbox/input/event_batcher.h"
+#include "anbox/input/latency_statistics.h"
+#include "anbox/input/multi_touch.h"
+#include "anbox/runtime.h"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace anbox;
+
+namespace {
+std::atomic<std::uint64_t> allocations{0};
+}  // namespace
+
+void *operator new(std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (auto ptr = std::malloc(size ? size : 1))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace {
+// A device with Android connected to it, which reads and drops all
+// events on a thread of its own. Latency statistics are on, as they are
+// with metrics enabled.
+class ConnectedDevice {
+ public:
+  explicit ConnectedDevice(const std::string &name) : fd_(-1) {
+    runtime_ = Runtime::create(1);
+    runtime_->start();
+
+    const auto path = "/tmp/anbox-input-bench-" + std::to_string(::getpid()) + "-" + name;
+    device_ = input::Device::create(path, runtime_);
+    device_->set_name(name);
+    device_->set_latency_statistics(std::make_shared<input::LatencyStatistics>());
+
+    fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    ::snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", device_->socket_path().c_str());
+    if (::connect(fd_, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0)
+      std::abort();
+
+    // The device info comes after the connection was added, events sent
+    // from then on reach us.
+    char byte;
+    if (::read(fd_, &byte, 1) != 1)
+      std::abort();
+    reader_ = std::thread([this]() {
+      char buffer[4096];
+      while (::read(fd_, buffer, sizeof(buffer)) > 0) {
+      }
+    });
+  }
+
+  ~ConnectedDevice() {
+    device_->close();
+    ::shutdown(fd_, SHUT_RDWR);
+    reader_.join();
+    ::close(fd_);
+    runtime_->stop();
+  }
+
+  input::Device &device() { return *device_; }
+
+ private:
+  std::shared_ptr<Runtime> runtime_;
+  std::shared_ptr<input::Device> device_;
+  int fd_;
+  std::thread reader_;
+};
+
+void report_allocations(benchmark::State &state, std::uint64_t count) {
+  state.counters["allocs_per_event"] =
+      benchmark::Counter(static_cast<double>(count), benchmark::Counter::kAvgIterations);
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+}  // namespace
+
+// A key press as PlatformPolicy translates it from SDL.
+static void BM_KeyPress(benchmark::State &state) {
+  ConnectedDevice keyboard("anbox-benchmark-keyboard");
+  const auto send = [&](std::int32_t value) {
+    input::EventBatch events;
+    events.push_back({EV_KEY, KEY_A, value});
+    keyboard.device().send_events(events.data(), events.size(),
+                                  std::chrono::steady_clock::now());
+  };
+  // The first batch sizes the buffers which are reused from then on.
+  send(1);
+
+  const auto before = allocations.load();
+  std::int32_t value = 0;
+  for (auto _ : state) {
+    send(value);
+    value ^= 1;
+  }
+  report_allocations(state, allocations.load() - before);
+}
+BENCHMARK(BM_KeyPress)->UseRealTime();
+
+// Absolute mouse motion, flushed right away as without a batching window.
+static void BM_PointerMotion(benchmark::State &state) {
+  ConnectedDevice pointer("anbox-benchmark-pointer");
+  input::EventBatcher batcher([&](const std::vector<input::Event> &events,
+                                  const input::EventBatcher::Clock::time_point &time) {
+    pointer.device().send_events(events, time);
+  });
+  std::int32_t x = 0;
+  const auto move = [&]() {
+    const auto time = input::EventBatcher::Clock::now();
+    batcher.queue({EV_ABS, ABS_X, x}, time);
+    batcher.queue({EV_ABS, ABS_Y, x}, time);
+    batcher.queue({EV_REL, REL_X, 1}, time);
+    batcher.queue({EV_REL, REL_Y, 1}, time);
+    batcher.queue({EV_SYN, SYN_REPORT, 0}, time);
+    batcher.flush();
+    x = (x + 1) % 1000;
+  };
+  move();
+
+  const auto before = allocations.load();
+  for (auto _ : state)
+    move();
+  report_allocations(state, allocations.load() - before);
+}
+BENCHMARK(BM_PointerMotion)->UseRealTime();
+
+// A finger dragged across the screen.
+static void BM_TouchMotion(benchmark::State &state) {
+  ConnectedDevice touch("anbox-benchmark-touch");
+  input::MultiTouch multi_touch([&](const std::vector<input::Event> &events,
+                                    const input::MultiTouch::Clock::time_point &time) {
+    touch.device().send_events(events, time);
+  });
+  multi_touch.down(1, 0, 0);
+  multi_touch.flush();
+
+  const auto before = allocations.load();
+  std::int32_t x = 0;
+  for (auto _ : state) {
+    multi_touch.move(1, x, x);
+    multi_touch.flush();
+    x = (x + 1) % 1000;
+  }
+  report_allocations(state, allocations.load() - before);
+}
+BENCHMARK(BM_TouchMotion)->UseRealTime();
+
+BENCHMARK_MAIN();
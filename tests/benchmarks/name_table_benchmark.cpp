@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "GLcommon/objectNameManager.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace {
+// Objects a typical app keeps alive in one share group.
+constexpr unsigned int live_names{2000};
+
+// Names in the order a frame binds them: pseudo random over the live set,
+// the way glBindTexture and glBindBuffer jump between objects.
+std::vector<ObjectLocalName> bind_order() {
+  std::vector<ObjectLocalName> names(1 << 16);
+  std::uint32_t state = 12345;
+  for (auto &name : names) {
+    state = state * 1103515245 + 12345;
+    name = 1 + (state >> 8) % live_names;
+  }
+  return names;
+}
+
+// What NameSpace used before NameTable.
+struct MapTable {
+  std::map<ObjectLocalName, unsigned int> names;
+
+  unsigned int *find(ObjectLocalName name) {
+    auto it = names.find(name);
+    return it != names.end() ? &it->second : nullptr;
+  }
+  void insert(ObjectLocalName name, unsigned int value) {
+    names.insert(std::make_pair(name, value));
+  }
+  void erase(ObjectLocalName name) { names.erase(name); }
+};
+
+template <typename Table>
+void fill(Table &table) {
+  for (unsigned int n = 1; n <= live_names; n++) table.insert(n, n + 100);
+}
+
+// Every bind looks the name up, isObject and getGlobalName each once.
+template <typename Table>
+void BM_Bind(benchmark::State &state) {
+  Table table;
+  fill(table);
+  const auto names = bind_order();
+  size_t next = 0;
+  for (auto _ : state) {
+    const auto name = names[next++ & (names.size() - 1)];
+    auto value = table.find(name);
+    benchmark::DoNotOptimize(value);
+    value = table.find(name);
+    benchmark::DoNotOptimize(value);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Apps which recreate their textures every frame delete and generate a
+// name for every few binds.
+template <typename Table>
+void BM_BindWithChurn(benchmark::State &state) {
+  Table table;
+  fill(table);
+  const auto names = bind_order();
+  size_t next = 0;
+  for (auto _ : state) {
+    const auto name = names[next++ & (names.size() - 1)];
+    if ((next & 7) == 0) {
+      table.erase(name);
+      table.insert(name, static_cast<unsigned int>(next));
+    }
+    auto value = table.find(name);
+    benchmark::DoNotOptimize(value);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_Bind, MapTable);
+BENCHMARK_TEMPLATE(BM_Bind, NameTable<unsigned int>);
+BENCHMARK_TEMPLATE(BM_BindWithChurn, MapTable);
+BENCHMARK_TEMPLATE(BM_BindWithChurn, NameTable<unsigned int>);
+}
+
+BENCHMARK_MAIN();
@@ -0,0 +1,319 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/application/database.h"
+#include "anbox/bridge/platform_api_skeleton.h"
+#include "anbox/bridge/platform_message_processor.h"
+#include "anbox/bridge/window_state_encoder.h"
+#include "anbox/network/connections.h"
+#include "anbox/network/local_socket_messenger.h"
+#include "anbox/network/socket_connection.h"
+#include "anbox/platform/policy.h"
+#include "anbox/rpc/channel.h"
+#include "anbox/rpc/constants.h"
+#include "anbox/rpc/message_processor.h"
+#include "anbox/rpc/pending_call_cache.h"
+#include "anbox/wm/manager.h"
+
+#include "anbox_bridge.pb.h"
+#include "anbox_rpc.pb.h"
+
+#include <benchmark/benchmark.h>
+
+#include <boost/asio/local/connect_pair.hpp>
+#include <boost/filesystem.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <thread>
+
+namespace ba = boost::asio;
+namespace fs = boost::filesystem;
+
+using namespace anbox;
+
+namespace {
+// Counts every allocation of the process, including those of the thread
+// processing the messages on the host side.
+std::atomic<std::uint64_t> allocations{0};
+}  // namespace
+
+void *operator new(std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (auto ptr = std::malloc(size ? size : 1))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace {
+class NullPolicy : public platform::Policy {
+ public:
+  std::shared_ptr<wm::Window> create_window(const wm::Task::Id &,
+                                            const graphics::Rect &,
+                                            const std::string &) override {
+    return nullptr;
+  }
+
+  void set_clipboard_data(const ClipboardData &data) override { clipboard_ = data; }
+  ClipboardData get_clipboard_data() override { return clipboard_; }
+
+  std::shared_ptr<audio::Sink> create_audio_sink(const audio::ClientInfo &) override {
+    return nullptr;
+  }
+  std::shared_ptr<audio::Source> create_audio_source(const audio::ClientInfo &) override {
+    return nullptr;
+  }
+
+ private:
+  ClipboardData clipboard_;
+};
+
+class NullWindowManager : public wm::Manager {
+ public:
+  void apply_window_state_update(const wm::WindowState::List &,
+                                 const wm::WindowState::List &) override {}
+  void resize_task(const wm::Task::Id &, const graphics::Rect &,
+                   const std::int32_t &) override {}
+  void set_focused_task(const wm::Task::Id &) override {}
+  void remove_task(const wm::Task::Id &) override {}
+  std::shared_ptr<wm::Window> find_window_for_task(const wm::Task::Id &) override {
+    return nullptr;
+  }
+};
+
+// Android on one end of a socketpair with its Channel to call into the
+// host and a MessageProcessor for the responses, the host on the other
+// one with the PlatformMessageProcessor session manager sets up.
+class Bridge {
+ public:
+  Bridge()
+      : data_path_(fs::temp_directory_path() / fs::unique_path("anbox-rpc-bench-%%%%-%%%%")),
+        android_socket_(std::make_shared<ba::local::stream_protocol::socket>(service_)),
+        host_socket_(std::make_shared<ba::local::stream_protocol::socket>(service_)) {
+    ba::local::connect_pair(*android_socket_, *host_socket_);
+
+    // Both sides speak the current protocol so large events don't get
+    // rejected by the legacy framing.
+    auto android_framing = std::make_shared<rpc::Framing>();
+    android_framing->set_peer_protocol_version(rpc::protocol_version);
+    auto host_framing = std::make_shared<rpc::Framing>();
+    host_framing->set_peer_protocol_version(rpc::protocol_version);
+
+    auto android_pending_calls = std::make_shared<rpc::PendingCallCache>();
+    auto android_messenger = std::make_shared<network::LocalSocketMessenger>(android_socket_);
+    channel_ = std::make_shared<rpc::Channel>(android_pending_calls, android_messenger,
+                                              android_framing);
+    android_ = make_connection(
+        android_messenger, 0,
+        std::make_shared<rpc::MessageProcessor>(android_messenger, android_pending_calls,
+                                                android_framing));
+
+    app_db_ = std::make_shared<application::Database>(data_path_ / "launchers",
+                                                      data_path_ / "icons");
+    auto host_pending_calls = std::make_shared<rpc::PendingCallCache>();
+    auto host_messenger = std::make_shared<network::LocalSocketMessenger>(host_socket_);
+    auto server = std::make_shared<bridge::PlatformApiSkeleton>(
+        host_pending_calls, std::make_shared<NullPolicy>(),
+        std::make_shared<NullWindowManager>(), app_db_);
+    host_ = make_connection(
+        host_messenger, 1,
+        std::make_shared<bridge::PlatformMessageProcessor>(host_messenger, server,
+                                                           host_pending_calls, host_framing));
+
+    io_ = std::thread([this]() { service_.run(); });
+  }
+
+  ~Bridge() {
+    host_socket_->shutdown(ba::local::stream_protocol::socket::shutdown_both);
+    android_socket_->shutdown(ba::local::stream_protocol::socket::shutdown_both);
+    io_.join();
+    app_db_->flush();
+    app_db_.reset();
+    boost::system::error_code ec;
+    fs::remove_all(data_path_, ec);
+  }
+
+  // Calls get_clipboard_data on the host and waits for the response. As
+  // the host handles everything in order, all events sent before were
+  // processed once this returns.
+  void call() {
+    protobuf::rpc::Void request;
+    protobuf::bridge::ClipboardData response;
+    done_ = false;
+    channel_->call_method("get_clipboard_data", &request, &response,
+                          google::protobuf::NewCallback(this, &Bridge::call_completed));
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this]() { return done_; });
+  }
+
+  void send_event(const protobuf::bridge::EventSequence &event) {
+    channel_->send_event(event);
+  }
+
+ private:
+  std::shared_ptr<network::SocketConnection> make_connection(
+      const std::shared_ptr<network::LocalSocketMessenger> &messenger, int id,
+      const std::shared_ptr<network::MessageProcessor> &processor) {
+    auto connection = std::make_shared<network::SocketConnection>(
+        messenger, messenger, id, connections_, processor);
+    connections_->add(connection);
+    connection->read_next_message();
+    return connection;
+  }
+
+  void call_completed() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    done_ = true;
+    cv_.notify_one();
+  }
+
+  fs::path data_path_;
+  ba::io_service service_;
+  std::shared_ptr<ba::local::stream_protocol::socket> android_socket_;
+  std::shared_ptr<ba::local::stream_protocol::socket> host_socket_;
+  std::shared_ptr<network::Connections<network::SocketConnection>> connections_ =
+      std::make_shared<network::Connections<network::SocketConnection>>();
+  std::shared_ptr<rpc::Channel> channel_;
+  std::shared_ptr<network::SocketConnection> android_;
+  std::shared_ptr<network::SocketConnection> host_;
+  std::shared_ptr<application::Database> app_db_;
+  std::thread io_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool done_ = false;
+};
+
+void set_window_states(protobuf::bridge::WindowStateUpdateEvent &event,
+                       std::int32_t offset) {
+  event.Clear();
+  for (std::int32_t n = 0; n < 20; n++) {
+    auto window = event.add_windows();
+    window->set_display_id(0);
+    window->set_has_surface(true);
+    window->set_package_name("org.anbox.application" + std::to_string(n % 5));
+    window->set_frame_left(n * 10 + offset);
+    window->set_frame_top(n * 10);
+    window->set_frame_right(n * 10 + offset + 800);
+    window->set_frame_bottom(n * 10 + 600);
+    window->set_task_id(n + 1);
+    window->set_stack_id(2);
+  }
+}
+
+void report_allocations(benchmark::State &state, std::uint64_t count) {
+  state.counters["allocs_per_msg"] =
+      benchmark::Counter(static_cast<double>(count), benchmark::Counter::kAvgIterations);
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+}  // namespace
+
+// A call from Android into the host and its response.
+static void BM_InvocationRoundTrip(benchmark::State &state) {
+  Bridge bridge;
+  bridge.call();
+
+  const auto before = allocations.load();
+  for (auto _ : state)
+    bridge.call();
+  report_allocations(state, allocations.load() - before);
+}
+BENCHMARK(BM_InvocationRoundTrip)->UseRealTime();
+
+// Android moving all of its windows, either with all 20 windows in every
+// event (range(0) = 0) or as what WindowStateEncoder makes out of it.
+static void BM_WindowStateUpdateEvent(benchmark::State &state) {
+  const bool incremental = state.range(0) != 0;
+  protobuf::bridge::WindowStateUpdateEvent layouts[2];
+  set_window_states(layouts[0], 0);
+  set_window_states(layouts[1], 1);
+
+  // events[0] goes from the second layout to the first one and events[1]
+  // the other way around. In incremental mode the first event announces
+  // all windows and is only sent once at the beginning.
+  protobuf::bridge::EventSequence initial, events[2];
+  bridge::WindowStateEncoder encoder;
+  if (incremental) {
+    encoder.encode(layouts[0], *initial.mutable_window_state_update());
+    encoder.encode(layouts[1], *events[1].mutable_window_state_update());
+    encoder.encode(layouts[0], *events[0].mutable_window_state_update());
+  } else {
+    *initial.mutable_window_state_update() = layouts[0];
+    *events[0].mutable_window_state_update() = layouts[0];
+    *events[1].mutable_window_state_update() = layouts[1];
+  }
+
+  Bridge bridge;
+  bridge.send_event(initial);
+  bridge.call();
+
+  const auto before = allocations.load();
+  size_t n = 1;
+  for (auto _ : state) {
+    bridge.send_event(events[n]);
+    n ^= 1;
+  }
+  bridge.call();
+  report_allocations(state, allocations.load() - before);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          events[0].ByteSize());
+}
+BENCHMARK(BM_WindowStateUpdateEvent)->Arg(0)->Arg(1)->UseRealTime();
+
+// The application list Android sends on boot and whenever a package
+// changes, range(0) applications with an icon of range(1) bytes each.
+static void BM_ApplicationListUpdateEvent(benchmark::State &state) {
+  protobuf::bridge::EventSequence events;
+  auto list = events.mutable_application_list_update();
+  const std::string icon(static_cast<size_t>(state.range(1)), '\x42');
+  for (int64_t n = 0; n < state.range(0); n++) {
+    auto app = list->add_applications();
+    app->set_name("Application " + std::to_string(n));
+    app->set_package("org.anbox.application" + std::to_string(n));
+    auto intent = app->mutable_launch_intent();
+    intent->set_action("android.intent.action.MAIN");
+    intent->set_package(app->package());
+    intent->set_component(app->package() + "/.MainActivity");
+    intent->add_categories("android.intent.category.LAUNCHER");
+    app->set_icon(icon);
+  }
+
+  Bridge bridge;
+  bridge.call();
+
+  const auto before = allocations.load();
+  for (auto _ : state)
+    bridge.send_event(events);
+  bridge.call();
+  report_allocations(state, allocations.load() - before);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          events.ByteSize());
+}
+BENCHMARK(BM_ApplicationListUpdateEvent)
+    ->Args({10, 8 * 1024})
+    ->Args({50, 8 * 1024})
+    ->Args({50, 32 * 1024})
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "anbox/graphics/emugl/RenderThreadInfo.h"
+
+#include "emugl/common/thread_store.h"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+namespace {
+// What RenderThreadInfo::get() and the translator's thread info lookups
+// went through before they became thread_local.
+class Store : public emugl::ThreadStore {
+ public:
+  Store() : emugl::ThreadStore(nullptr) {}
+};
+}  // namespace
+
+static void BM_ThreadStoreGet(benchmark::State &state) {
+  Store store;
+  int value = 0;
+  store.set(&value);
+  for (auto _ : state)
+    benchmark::DoNotOptimize(store.get());
+  store.set(nullptr);
+}
+BENCHMARK(BM_ThreadStoreGet);
+
+// Done for every command a render thread decodes.
+static void BM_RenderThreadInfoGet(benchmark::State &state) {
+  std::unique_ptr<RenderThreadInfo> info(new RenderThreadInfo());
+  for (auto _ : state)
+    benchmark::DoNotOptimize(RenderThreadInfo::get());
+}
+BENCHMARK(BM_RenderThreadInfoGet);
+
+BENCHMARK_MAIN();
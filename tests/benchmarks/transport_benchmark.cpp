@@ -0,0 +1,312 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/common/lock_free_queue.h"
+#include "anbox/graphics/buffered_io_stream.h"
+#include "anbox/graphics/ring_buffer.h"
+#include "anbox/network/connections.h"
+#include "anbox/network/local_socket_messenger.h"
+#include "anbox/network/socket_connection.h"
+
+#include <benchmark/benchmark.h>
+
+#include <boost/asio/local/connect_pair.hpp>
+
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ba = boost::asio;
+
+using anbox::graphics::Buffer;
+using anbox::graphics::BufferedIOStream;
+using anbox::graphics::RingBuffer;
+using anbox::network::Connections;
+using anbox::network::LocalSocketMessenger;
+using anbox::network::MessageProcessor;
+using anbox::network::SocketConnection;
+
+namespace {
+const int64_t min_message_size{64};
+const int64_t max_message_size{4 * 1024 * 1024};
+
+void message_sizes(benchmark::internal::Benchmark *b) {
+  b->RangeMultiplier(8)->Range(min_message_size, max_message_size);
+  b->UseRealTime();
+}
+
+void set_bytes_processed(benchmark::State &state) {
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+struct SocketPair {
+  SocketPair()
+      : local(std::make_shared<ba::local::stream_protocol::socket>(service)),
+        remote(std::make_shared<ba::local::stream_protocol::socket>(service)) {
+    ba::local::connect_pair(*local, *remote);
+  }
+
+  // Reads |size| bytes from the remote end on a separate thread.
+  std::thread drain(size_t size) {
+    return std::thread([this, size]() {
+      std::vector<char> data(std::min<size_t>(size, 256 * 1024));
+      size_t left = size;
+      boost::system::error_code ec;
+      while (left > 0 && !ec)
+        left -= remote->read_some(ba::buffer(data.data(), std::min(left, data.size())), ec);
+    });
+  }
+
+  ba::io_service service;
+  std::shared_ptr<ba::local::stream_protocol::socket> local;
+  std::shared_ptr<ba::local::stream_protocol::socket> remote;
+};
+
+// What the graphics path does with everything the SocketConnection
+// receives: hand it over to the stream of the render thread.
+class StreamProcessor : public MessageProcessor {
+ public:
+  explicit StreamProcessor(BufferedIOStream &stream) : stream_(stream) {}
+
+  bool process_data(const std::uint8_t *data, size_t size) override {
+    stream_.post_data(data, size);
+    return true;
+  }
+
+ private:
+  BufferedIOStream &stream_;
+};
+
+void read_fully(BufferedIOStream &stream, std::vector<char> &data) {
+  size_t done = 0;
+  while (done < data.size()) {
+    size_t len = data.size() - done;
+    if (!stream.read(data.data() + done, &len)) break;
+    done += len;
+  }
+}
+}  // namespace
+
+// Replies of the render thread go through a SpscQueue of Buffers to the
+// writer thread of BufferedIOStream.
+static void BM_SpscQueue(benchmark::State &state) {
+  const auto size = static_cast<size_t>(state.range(0));
+  anbox::common::SpscQueue<Buffer> queue(1024);
+
+  std::thread consumer([&]() {
+    Buffer buffer;
+    while (queue.pop(&buffer) == 0)
+      benchmark::DoNotOptimize(buffer.data());
+  });
+
+  std::vector<char> data(size, 'x');
+  for (auto _ : state) {
+    Buffer buffer(data.data(), data.data() + data.size());
+    queue.push(std::move(buffer));
+  }
+  queue.close();
+  consumer.join();
+  set_bytes_processed(state);
+}
+BENCHMARK(BM_SpscQueue)->Apply(message_sizes);
+
+// Several producer threads feeding one consumer.
+static void BM_MpscQueue(benchmark::State &state) {
+  static anbox::common::MpscQueue<Buffer> *queue{nullptr};
+  static std::thread consumer;
+  const auto size = static_cast<size_t>(state.range(0));
+
+  if (state.thread_index() == 0) {
+    queue = new anbox::common::MpscQueue<Buffer>(1024);
+    consumer = std::thread([]() {
+      Buffer buffer;
+      while (queue->pop(&buffer) == 0)
+        benchmark::DoNotOptimize(buffer.data());
+    });
+  }
+
+  std::vector<char> data(size, 'x');
+  for (auto _ : state) {
+    Buffer buffer(data.data(), data.data() + data.size());
+    queue->push(std::move(buffer));
+  }
+
+  if (state.thread_index() == 0) {
+    queue->close();
+    consumer.join();
+    delete queue;
+    queue = nullptr;
+  }
+  set_bytes_processed(state);
+}
+BENCHMARK(BM_MpscQueue)
+    ->RangeMultiplier(8)
+    ->Range(min_message_size, 64 * 1024)
+    ->ThreadRange(1, 4)
+    ->UseRealTime();
+
+// Incoming data goes through a RingBuffer from the socket thread to the
+// render thread.
+static void BM_RingBuffer(benchmark::State &state) {
+  const auto size = static_cast<size_t>(state.range(0));
+  RingBuffer ring(BufferedIOStream::default_in_buffer_size);
+
+  std::thread producer([&]() {
+    std::vector<char> data(size, 'x');
+    while (ring.write(data.data(), data.size()) == data.size()) {}
+  });
+
+  std::vector<char> data(size);
+  for (auto _ : state) {
+    size_t done = 0;
+    while (done < size)
+      done += ring.read(data.data() + done, size - done, true);
+  }
+  ring.close();
+  producer.join();
+  set_bytes_processed(state);
+}
+BENCHMARK(BM_RingBuffer)->Apply(message_sizes);
+
+static void BM_RingBufferPeek(benchmark::State &state) {
+  const auto size = static_cast<size_t>(state.range(0));
+  RingBuffer ring(BufferedIOStream::default_in_buffer_size);
+
+  std::thread producer([&]() {
+    std::vector<char> data(size, 'x');
+    while (ring.write(data.data(), data.size()) == data.size()) {}
+  });
+
+  for (auto _ : state) {
+    size_t done = 0;
+    while (done < size) {
+      size_t len = 0;
+      const auto data = ring.peek(&len);
+      len = std::min(len, size - done);
+      benchmark::DoNotOptimize(data);
+      ring.consume(len);
+      done += len;
+    }
+  }
+  ring.close();
+  producer.join();
+  set_bytes_processed(state);
+}
+BENCHMARK(BM_RingBufferPeek)->Apply(message_sizes);
+
+// Replies from the render thread until they are written to the socket.
+static void BM_BufferedIOStreamWrite(benchmark::State &state) {
+  const auto size = static_cast<size_t>(state.range(0));
+  SocketPair sockets;
+  auto reader = sockets.drain(size * state.max_iterations);
+
+  {
+    BufferedIOStream stream(std::make_shared<LocalSocketMessenger>(sockets.local));
+    for (auto _ : state) {
+      auto data = stream.allocBuffer(size);
+      std::memset(data, 'x', size);
+      stream.commitBuffer(size);
+    }
+    // Waits for the writer thread to flush everything.
+  }
+  reader.join();
+  set_bytes_processed(state);
+}
+BENCHMARK(BM_BufferedIOStreamWrite)->Apply(message_sizes);
+
+// Data arriving on the socket until the render thread read it out of
+// the stream.
+static void BM_SocketConnectionToBufferedIOStream(benchmark::State &state) {
+  const auto size = static_cast<size_t>(state.range(0));
+  SocketPair sockets;
+  auto messenger = std::make_shared<LocalSocketMessenger>(sockets.local);
+  BufferedIOStream stream(messenger);
+
+  auto connections = std::make_shared<Connections<SocketConnection>>();
+  auto connection = std::make_shared<SocketConnection>(
+      messenger, messenger, 0, connections,
+      std::make_shared<StreamProcessor>(stream));
+  connections->add(connection);
+  connection->read_next_message();
+  std::thread io([&]() { sockets.service.run(); });
+
+  std::thread writer([&]() {
+    std::vector<char> data(size, 'x');
+    boost::system::error_code ec;
+    for (benchmark::IterationCount n = 0; n < state.max_iterations && !ec; n++)
+      ba::write(*sockets.remote, ba::buffer(data), ec);
+  });
+
+  std::vector<char> data(size);
+  for (auto _ : state)
+    read_fully(stream, data);
+
+  writer.join();
+  sockets.remote->close();
+  io.join();
+  set_bytes_processed(state);
+}
+BENCHMARK(BM_SocketConnectionToBufferedIOStream)->Apply(message_sizes);
+
+static void BM_LocalSocketMessengerSend(benchmark::State &state) {
+  const auto size = static_cast<size_t>(state.range(0));
+  SocketPair sockets;
+  LocalSocketMessenger messenger(sockets.local);
+  auto reader = sockets.drain(size * state.max_iterations);
+
+  std::vector<char> data(size, 'x');
+  for (auto _ : state)
+    messenger.send(data.data(), data.size());
+
+  reader.join();
+  set_bytes_processed(state);
+}
+BENCHMARK(BM_LocalSocketMessengerSend)->Apply(message_sizes);
+
+// Sends a message and waits for a one byte answer, which is what a
+// synchronous GL call costs on the transport.
+static void BM_LocalSocketMessengerRoundTrip(benchmark::State &state) {
+  const auto size = static_cast<size_t>(state.range(0));
+  SocketPair sockets;
+  LocalSocketMessenger messenger(sockets.local);
+
+  std::thread peer([&]() {
+    std::vector<char> data(size);
+    boost::system::error_code ec;
+    while (!ec) {
+      ba::read(*sockets.remote, ba::buffer(data), ec);
+      if (!ec) ba::write(*sockets.remote, ba::buffer(data.data(), 1), ec);
+    }
+  });
+
+  std::vector<char> data(size, 'x');
+  char reply;
+  for (auto _ : state) {
+    messenger.send(data.data(), data.size());
+    messenger.receive_msg(ba::buffer(&reply, 1));
+  }
+
+  sockets.local->shutdown(ba::local::stream_protocol::socket::shutdown_both);
+  peer.join();
+  set_bytes_processed(state);
+}
+BENCHMARK(BM_LocalSocketMessengerRoundTrip)->Apply(message_sizes);
+
+BENCHMARK_MAIN();